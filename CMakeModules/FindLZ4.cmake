@@ -0,0 +1,32 @@
+# Find the LZ4 library
+#
+# This module defines
+# LZ4_INCLUDE_DIR, where to find lz4.h
+# LZ4_LIBRARIES, the libraries to link against to use LZ4.
+# LZ4_FOUND, If false, do not try to use LZ4
+#
+# The user may specify LZ4_INCLUDE_DIR and LZ4_LIBRARY_DIR variables
+# to locate include and library files
+#
+include(CheckLibraryExists)
+include(CheckIncludeFile)
+
+set(LZ4_INCLUDE_DIR CACHE STRING "Location of LZ4 include files")
+set(LZ4_LIBRARY_DIR CACHE STRING "Location of LZ4 library files")
+
+if(LZ4_INCLUDE_DIR)
+  set(CMAKE_REQUIRED_INCLUDES ${LZ4_INCLUDE_DIR})
+endif(LZ4_INCLUDE_DIR)
+
+check_include_file(lz4.h HAVE_LZ4_H)
+
+find_library(LZ4_LIBRARY NAMES lz4 liblz4 PATHS ${LZ4_LIBRARY_DIR})
+if(LZ4_LIBRARY)
+  check_library_exists(${LZ4_LIBRARY} LZ4_compress_default "" HAVE_LZ4_LIBRARY)
+endif(LZ4_LIBRARY)
+if(HAVE_LZ4_LIBRARY)
+  set(LZ4_LIBRARIES ${LZ4_LIBRARY})
+endif(HAVE_LZ4_LIBRARY)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LZ4 DEFAULT_MSG HAVE_LZ4_LIBRARY HAVE_LZ4_H)
@@ -0,0 +1,32 @@
+# Find the Zstandard library
+#
+# This module defines
+# ZSTD_INCLUDE_DIR, where to find zstd.h
+# ZSTD_LIBRARIES, the libraries to link against to use Zstandard.
+# ZSTD_FOUND, If false, do not try to use Zstandard
+#
+# The user may specify ZSTD_INCLUDE_DIR and ZSTD_LIBRARY_DIR variables
+# to locate include and library files
+#
+include(CheckLibraryExists)
+include(CheckIncludeFile)
+
+set(ZSTD_INCLUDE_DIR CACHE STRING "Location of ZSTD include files")
+set(ZSTD_LIBRARY_DIR CACHE STRING "Location of ZSTD library files")
+
+if(ZSTD_INCLUDE_DIR)
+  set(CMAKE_REQUIRED_INCLUDES ${ZSTD_INCLUDE_DIR})
+endif(ZSTD_INCLUDE_DIR)
+
+check_include_file(zstd.h HAVE_ZSTD_H)
+
+find_library(ZSTD_LIBRARY NAMES zstd libzstd PATHS ${ZSTD_LIBRARY_DIR})
+if(ZSTD_LIBRARY)
+  check_library_exists(${ZSTD_LIBRARY} ZSTD_compress "" HAVE_ZSTD_LIBRARY)
+endif(ZSTD_LIBRARY)
+if(HAVE_ZSTD_LIBRARY)
+  set(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+endif(HAVE_ZSTD_LIBRARY)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD DEFAULT_MSG HAVE_ZSTD_LIBRARY HAVE_ZSTD_H)
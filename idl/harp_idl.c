@@ -44,6 +44,9 @@
 #define HARP_IDL_ERR_INVALID_VARIABLE                             (-911)
 #define HARP_IDL_ERR_UNKNOWN_OPTION                               (-921)
 
+#define HARP_IDL_MAX_CACHED_STRUCT_DEFS                           256
+#define HARP_IDL_MAX_VARIABLE_SIGNATURE_LENGTH                    256
+
 /* ---------- typedefs ---------- */
 
 typedef struct harp_IDLError
@@ -52,6 +55,17 @@ typedef struct harp_IDLError
     IDL_STRING message;
 } harp_IDLError;
 
+/* Struct definitions that were created for earlier imports, by signature of the layout of the variable/product.
+ * The cached definitions are named IDL structures, since IDL keeps those alive for the rest of the session (an
+ * anonymous structure definition is released once no IDL variable refers to it anymore).
+ */
+typedef struct harp_idl_struct_def_cache
+{
+    int num_entries;
+    char *signature[HARP_IDL_MAX_CACHED_STRUCT_DEFS];
+    IDL_StructDefPtr sdef[HARP_IDL_MAX_CACHED_STRUCT_DEFS];
+} harp_idl_struct_def_cache;
+
 /* ---------- global variables ---------- */
 
 IDL_StructDefPtr harp_error_sdef;
@@ -60,6 +74,10 @@ static int harp_idl_initialised = 0;
 
 static int harp_idl_option_verbose = 1;
 
+static harp_idl_struct_def_cache harp_idl_variable_sdef_cache = { 0 };
+static harp_idl_struct_def_cache harp_idl_product_sdef_cache = { 0 };
+static long harp_idl_num_named_sdefs = 0;
+
 /* ---------- code ---------- */
 
 static int harp_idl_init(void)
@@ -154,12 +172,81 @@ static IDL_VPTR harp_idl_get_error_struct(const int err)
     return retval;
 }
 
+static IDL_StructDefPtr harp_idl_struct_def_cache_find(harp_idl_struct_def_cache *cache, const char *signature)
+{
+    int i;
+
+    for (i = 0; i < cache->num_entries; i++)
+    {
+        if (strcmp(cache->signature[i], signature) == 0)
+        {
+            return cache->sdef[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Create a struct definition from the tags, which is added to the cache (using a copy of the signature) if the cache
+ * is not full yet */
+static IDL_StructDefPtr harp_idl_struct_def_cache_make_struct(harp_idl_struct_def_cache *cache, const char *signature,
+                                                              const char *prefix, IDL_STRUCT_TAG_DEF *tags)
+{
+    IDL_StructDefPtr sdef;
+    char name[64];
+    char *signature_copy;
+
+    if (cache->num_entries == HARP_IDL_MAX_CACHED_STRUCT_DEFS)
+    {
+        return IDL_MakeStruct(0, tags);
+    }
+    signature_copy = strdup(signature);
+    if (signature_copy == NULL)
+    {
+        return IDL_MakeStruct(0, tags);
+    }
+
+    sprintf(name, "%s%ld", prefix, harp_idl_num_named_sdefs);
+    harp_idl_num_named_sdefs++;
+    sdef = IDL_MakeStruct(name, tags);
+    cache->signature[cache->num_entries] = signature_copy;
+    cache->sdef[cache->num_entries] = sdef;
+    cache->num_entries++;
+
+    return sdef;
+}
+
+/* The signature covers everything that determines the struct definition of a variable */
+static void harp_idl_get_signature_for_variable(harp_variable *variable, char *signature)
+{
+    int length;
+    int i;
+
+    length = sprintf(signature, "%d:%d:%d:%d:%d:%d", (int)variable->data_type, variable->num_enum_values,
+                     variable->unit != NULL, variable->data_type != harp_type_string &&
+                     !harp_is_valid_min_for_type(variable->data_type, variable->valid_min),
+                     variable->data_type != harp_type_string &&
+                     !harp_is_valid_max_for_type(variable->data_type, variable->valid_max), variable->num_dimensions);
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        length += sprintf(&signature[length], ",%ld", variable->dimension[i]);
+    }
+}
+
 static int harp_idl_get_struct_def_for_variable(harp_variable *variable, IDL_StructDefPtr *sdef)
 {
+    char signature[HARP_IDL_MAX_VARIABLE_SIGNATURE_LENGTH];
     IDL_STRUCT_TAG_DEF *record_tags;
     int index = 0;
     int i;
 
+    harp_idl_get_signature_for_variable(variable, signature);
+    *sdef = harp_idl_struct_def_cache_find(&harp_idl_variable_sdef_cache, signature);
+    if (*sdef != NULL)
+    {
+        return 0;
+    }
+
     record_tags = (IDL_STRUCT_TAG_DEF *)malloc(8 * sizeof(IDL_STRUCT_TAG_DEF));
     if (record_tags == NULL)
     {
@@ -355,7 +442,8 @@ static int harp_idl_get_struct_def_for_variable(harp_variable *variable, IDL_Str
     record_tags[index].type = 0;
     record_tags[index].flags = 0;
 
-    *sdef = IDL_MakeStruct(0, record_tags);
+    *sdef = harp_idl_struct_def_cache_make_struct(&harp_idl_variable_sdef_cache, signature, "HARP_VARIABLE_",
+                                                  record_tags);
 
     for (i = 0; i < index; i++)
     {
@@ -369,9 +457,45 @@ static int harp_idl_get_struct_def_for_variable(harp_variable *variable, IDL_Str
     return 0;
 }
 
+/* The signature of a product consists of the name and signature of each variable (in order), followed by the presence
+ * of the product attributes */
+static char *harp_idl_get_signature_for_product(harp_product *product)
+{
+    char *signature;
+    long length = 0;
+    int i;
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        length += (long)strlen(product->variable[i]->name) + HARP_IDL_MAX_VARIABLE_SIGNATURE_LENGTH + 2;
+    }
+    signature = (char *)malloc(length + 3);
+    if (signature == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)(length + 3), __FILE__, __LINE__);
+        return NULL;
+    }
+
+    length = 0;
+    for (i = 0; i < product->num_variables; i++)
+    {
+        length += sprintf(&signature[length], "%s=", product->variable[i]->name);
+        harp_idl_get_signature_for_variable(product->variable[i], &signature[length]);
+        length += (long)strlen(&signature[length]);
+        signature[length++] = ';';
+    }
+    signature[length++] = product->source_product != NULL ? 'S' : '-';
+    signature[length++] = product->history != NULL ? 'H' : '-';
+    signature[length] = '\0';
+
+    return signature;
+}
+
 static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_StructDefPtr *sdef)
 {
     IDL_STRUCT_TAG_DEF *record_tags;
+    char *signature;
     int num_fields;
     int index;
     int i;
@@ -383,6 +507,19 @@ static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_Struct
         return -1;
     }
 
+    /* products with the same layout (e.g. repeated imports of similar files) share a struct definition */
+    signature = harp_idl_get_signature_for_product(product);
+    if (signature == NULL)
+    {
+        return -1;
+    }
+    *sdef = harp_idl_struct_def_cache_find(&harp_idl_product_sdef_cache, signature);
+    if (*sdef != NULL)
+    {
+        free(signature);
+        return 0;
+    }
+
     num_fields = product->num_variables;
     if (product->source_product != NULL)
     {
@@ -398,6 +535,7 @@ static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_Struct
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        sizeof(IDL_STRUCT_TAG_DEF) * (num_fields + 1), __FILE__, __LINE__);
+        free(signature);
         return -1;
     }
 
@@ -418,6 +556,7 @@ static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_Struct
             free(record_tags);
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                            (long)(field_name_length + 1), __FILE__, __LINE__);
+            free(signature);
             return -1;
         }
         for (i = 0; i < field_name_length; i++)
@@ -433,6 +572,7 @@ static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_Struct
                 free(record_tags[i].name);
             }
             free(record_tags);
+            free(signature);
             return -1;
         }
         record_tags[index].dims = NULL;
@@ -448,8 +588,10 @@ static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_Struct
             {
                 free(record_tags[i].name);
             }
+            free(record_tags);
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
                            __LINE__);
+            free(signature);
             return -1;
         }
         record_tags[index].dims = NULL;
@@ -466,8 +608,10 @@ static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_Struct
             {
                 free(record_tags[i].name);
             }
+            free(record_tags);
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
                            __LINE__);
+            free(signature);
             return -1;
         }
         record_tags[index].dims = NULL;
@@ -481,13 +625,15 @@ static int harp_idl_get_struct_def_for_product(harp_product *product, IDL_Struct
     record_tags[index].type = 0;
     record_tags[index].flags = 0;
 
-    *sdef = IDL_MakeStruct(0, record_tags);
+    *sdef = harp_idl_struct_def_cache_make_struct(&harp_idl_product_sdef_cache, signature, "HARP_PRODUCT_",
+                                                  record_tags);
 
-    for (i = 0; i < product->num_variables; i++)
+    for (i = 0; i < index; i++)
     {
         free(record_tags[i].name);
     }
     free(record_tags);
+    free(signature);
 
     return 0;
 }
@@ -625,13 +771,13 @@ static int harp_idl_get_struct_data_for_variable(harp_variable *variable, IDL_St
         }
     }
 
-    /* description */
+    /* description (the struct definition always has this field) */
     if (variable->description != NULL)
     {
         idl_data = data + IDL_StructTagInfoByIndex(sdef, index, IDL_MSG_LONGJMP, &field_info);
         IDL_StrStore((IDL_STRING *)idl_data, variable->description);
-        index++;
     }
+    index++;
 
     /* enum */
     if (variable->num_enum_values > 0)
@@ -84,14 +84,40 @@ static double get_equation_of_time_from_datetime(double datetime)
     return 720 * (angle_difference - floor(angle_difference + 0.5));
 }
 
+static double get_frequency_from_wavelength(double wavelength)
+{
+    /* frequency = c / wavelength */
+    return (double)CONST_SPEED_OF_LIGHT / wavelength;
+}
+
 /** Convert (electromagnetic wave) wavelength to (electromagnetic wave) frequency
  * \param wavelength      Wavelength [m]
  * \return the frequency [Hz]
  */
 double harp_frequency_from_wavelength(double wavelength)
 {
-    /* frequency = c / wavelength */
-    return (double)CONST_SPEED_OF_LIGHT / wavelength;
+    return get_frequency_from_wavelength(wavelength);
+}
+
+/** Array version of harp_frequency_from_wavelength().
+ * \param num_elements Number of elements of each array.
+ * \param wavelength Wavelength [m] (array of \a num_elements values)
+ * \param result Array in which the frequency [Hz] values will be stored.
+ */
+void harp_frequency_from_wavelength_array(long num_elements, const double *wavelength, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_frequency_from_wavelength(wavelength[i]);
+    }
+}
+
+static double get_frequency_from_wavenumber(double wavenumber)
+{
+    /* frequency = c * wavenumber */
+    return (double)CONST_SPEED_OF_LIGHT *wavenumber;
 }
 
 /** Convert (electromagnetic wave) wavenumber to (electromagnetic wave) frequency
@@ -100,8 +126,22 @@ double harp_frequency_from_wavelength(double wavelength)
  */
 double harp_frequency_from_wavenumber(double wavenumber)
 {
-    /* frequency = c * wavenumber */
-    return (double)CONST_SPEED_OF_LIGHT *wavenumber;
+    return get_frequency_from_wavenumber(wavenumber);
+}
+
+/** Array version of harp_frequency_from_wavenumber().
+ * \param num_elements Number of elements of each array.
+ * \param wavenumber Wavenumber [1/m] (array of \a num_elements values)
+ * \param result Array in which the frequency [Hz] values will be stored.
+ */
+void harp_frequency_from_wavenumber_array(long num_elements, const double *wavenumber, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_frequency_from_wavenumber(wavenumber[i]);
+    }
 }
 
 /* Calculate the gravitational acceleration gsurf at the Earth's surface for a given latitude
@@ -125,13 +165,40 @@ double harp_gravity_at_surface_from_latitude(double latitude)
  * \return the gravitational acceleration at the Earth's surface gsurf [m/s2] */
 double harp_gravity_from_latitude_and_height(double latitude, double height)
 {
-    double a = 6378137.0;
+    double surface_gravity;
+    double height_factor;
+
+    harp_gravity_terms_from_latitude(latitude, &surface_gravity, &height_factor);
+
+    return harp_gravity_from_gravity_terms_and_height(surface_gravity, height_factor, height);
+}
+
+/* Calculate the latitude dependent terms of the WGS84 Gravity formula used by harp_gravity_from_latitude_and_height().
+ * This allows calculating the gravitational acceleration for many heights at the same latitude using
+ * harp_gravity_from_gravity_terms_and_height() without recalculating these terms.
+ * \param latitude  Latitude [degree_north]
+ * \param surface_gravity  The gravitational acceleration at the Earth's surface gsurf [m/s2]
+ * \param height_factor  Latitude dependent factor of the height correction [1] */
+void harp_gravity_terms_from_latitude(double latitude, double *surface_gravity, double *height_factor)
+{
     double f = 1 / 298.257223563;
     double m = 0.00344978650684;
     double sinphi = sin(latitude * CONST_DEG2RAD);
 
-    return harp_gravity_at_surface_from_latitude(latitude) *
-        (1 - (2 * (1 + f + m - 2 * f * sinphi * sinphi) + 3 * height / a) * height / a);
+    *surface_gravity = harp_gravity_at_surface_from_latitude(latitude);
+    *height_factor = 2 * (1 + f + m - 2 * f * sinphi * sinphi);
+}
+
+/* Calculate the gravitational acceleration g for a given height from the terms of harp_gravity_terms_from_latitude().
+ * \param surface_gravity  The gravitational acceleration at the Earth's surface gsurf [m/s2]
+ * \param height_factor  Latitude dependent factor of the height correction [1]
+ * \param height    Height [m]
+ * \return the gravitational acceleration g [m/s2] */
+double harp_gravity_from_gravity_terms_and_height(double surface_gravity, double height_factor, double height)
+{
+    double a = 6378137.0;
+
+    return surface_gravity * (1 - (height_factor + 3 * height / a) * height / a);
 }
 
 /* Calculate the local curvature radius Rsurf at the Earth's surface for a given latitude
@@ -237,6 +304,16 @@ double harp_reflectance_from_normalized_radiance_and_solar_zenith_angle(double n
     return reflectance;
 }
 
+static double get_scattering_angle_from_sensor_and_solar_angles(double sensor_zenith_angle, double solar_zenith_angle,
+                                                                double relative_azimuth_angle)
+{
+    double cosangle = -cos(sensor_zenith_angle * CONST_DEG2RAD) * cos(solar_zenith_angle * CONST_DEG2RAD) -
+        sin(sensor_zenith_angle * CONST_DEG2RAD) * sin(solar_zenith_angle * CONST_DEG2RAD) *
+        cos(relative_azimuth_angle * CONST_DEG2RAD);
+    HARP_CLAMP(cosangle, -1.0, 1.0);
+    return CONST_RAD2DEG * acos(cosangle);
+}
+
 /** Convert sensor and solar angles into scattering angle
  * \param sensor_zenith_angle Sensor Zenith Angle [degree]
  * \param solar_zenith_angle Solar Zenith Angle [degree]
@@ -246,22 +323,32 @@ double harp_reflectance_from_normalized_radiance_and_solar_zenith_angle(double n
 double harp_scattering_angle_from_sensor_and_solar_angles(double sensor_zenith_angle, double solar_zenith_angle,
                                                           double relative_azimuth_angle)
 {
-    double cosangle = -cos(sensor_zenith_angle * CONST_DEG2RAD) * cos(solar_zenith_angle * CONST_DEG2RAD) -
-        sin(sensor_zenith_angle * CONST_DEG2RAD) * sin(solar_zenith_angle * CONST_DEG2RAD) *
-        cos(relative_azimuth_angle * CONST_DEG2RAD);
-    HARP_CLAMP(cosangle, -1.0, 1.0);
-    return CONST_RAD2DEG * acos(cosangle);
+    return get_scattering_angle_from_sensor_and_solar_angles(sensor_zenith_angle, solar_zenith_angle,
+                                                             relative_azimuth_angle);
 }
 
-/** Calculate the solar azimuth angle for the given time and location
- * \param latitude Latitude [degree_north]
- * \param solar_declination_angle Solar declination angle [deg]
- * \param solar_hour_angle Solar hour angle [deg]
- * \param solar_zenith_angle Solar zenith angle [deg]
- * \return the solar elevation angle [degree]
+/** Array version of harp_scattering_angle_from_sensor_and_solar_angles().
+ * \param num_elements Number of elements of each array.
+ * \param sensor_zenith_angle Sensor Zenith Angle [degree] (array of \a num_elements values)
+ * \param solar_zenith_angle Solar Zenith Angle [degree] (array of \a num_elements values)
+ * \param relative_azimuth_angle Relative Azimuth Angle [degree] (array of \a num_elements values)
+ * \param result Array in which the scattering angle [degree] values will be stored.
  */
-double harp_solar_azimuth_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
-                                                               double solar_hour_angle, double solar_zenith_angle)
+void harp_scattering_angle_from_sensor_and_solar_angles_array(long num_elements, const double *sensor_zenith_angle,
+                                                              const double *solar_zenith_angle,
+                                                              const double *relative_azimuth_angle, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_scattering_angle_from_sensor_and_solar_angles(sensor_zenith_angle[i], solar_zenith_angle[i],
+                                                                      relative_azimuth_angle[i]);
+    }
+}
+
+static double get_solar_azimuth_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
+                                                                     double solar_hour_angle, double solar_zenith_angle)
 {
     double cosangle;
     double angle;
@@ -292,11 +379,43 @@ double harp_solar_azimuth_angle_from_latitude_and_solar_angles(double latitude,
     return angle;
 }
 
-/** Calculate the solar declination angle
- * \param datetime   Datetime [s since 2000-01-01]
- * \return the solar declination angle [degree]
+/** Calculate the solar azimuth angle for the given time and location
+ * \param latitude Latitude [degree_north]
+ * \param solar_declination_angle Solar declination angle [deg]
+ * \param solar_hour_angle Solar hour angle [deg]
+ * \param solar_zenith_angle Solar zenith angle [deg]
+ * \return the solar elevation angle [degree]
  */
-double harp_solar_declination_angle_from_datetime(double datetime)
+double harp_solar_azimuth_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
+                                                               double solar_hour_angle, double solar_zenith_angle)
+{
+    return get_solar_azimuth_angle_from_latitude_and_solar_angles(latitude, solar_declination_angle, solar_hour_angle,
+                                                                  solar_zenith_angle);
+}
+
+/** Array version of harp_solar_azimuth_angle_from_latitude_and_solar_angles().
+ * \param num_elements Number of elements of each array.
+ * \param latitude Latitude [degree_north] (array of \a num_elements values)
+ * \param solar_declination_angle Solar declination angle [deg] (array of \a num_elements values)
+ * \param solar_hour_angle Solar hour angle [deg] (array of \a num_elements values)
+ * \param solar_zenith_angle Solar zenith angle [deg] (array of \a num_elements values)
+ * \param result Array in which the solar elevation angle [degree] values will be stored.
+ */
+void harp_solar_azimuth_angle_from_latitude_and_solar_angles_array(long num_elements, const double *latitude,
+                                                                   const double *solar_declination_angle,
+                                                                   const double *solar_hour_angle,
+                                                                   const double *solar_zenith_angle, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_solar_azimuth_angle_from_latitude_and_solar_angles(latitude[i], solar_declination_angle[i],
+                                                                           solar_hour_angle[i], solar_zenith_angle[i]);
+    }
+}
+
+static double get_solar_declination_angle_from_datetime(double datetime)
 {
     double mean_angle, corrected_angle;
     double sinangle;
@@ -316,12 +435,31 @@ double harp_solar_declination_angle_from_datetime(double datetime)
     return CONST_RAD2DEG * -asin(sinangle);
 }
 
-/** Calculate the solar hour angle for the given time and location
- * \param datetime Datetime [s since 2000-01-01]
- * \param longitude Longitude [degree_east]
- * \return the solar hour angle [degree]
+/** Calculate the solar declination angle
+ * \param datetime   Datetime [s since 2000-01-01]
+ * \return the solar declination angle [degree]
  */
-double harp_solar_hour_angle_from_datetime_and_longitude(double datetime, double longitude)
+double harp_solar_declination_angle_from_datetime(double datetime)
+{
+    return get_solar_declination_angle_from_datetime(datetime);
+}
+
+/** Array version of harp_solar_declination_angle_from_datetime().
+ * \param num_elements Number of elements of each array.
+ * \param datetime Datetime [s since 2000-01-01] (array of \a num_elements values)
+ * \param result Array in which the solar declination angle [degree] values will be stored.
+ */
+void harp_solar_declination_angle_from_datetime_array(long num_elements, const double *datetime, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_solar_declination_angle_from_datetime(datetime[i]);
+    }
+}
+
+static double get_solar_hour_angle_from_datetime_and_longitude(double datetime, double longitude)
 {
     double local_fraction_of_day;
 
@@ -331,14 +469,35 @@ double harp_solar_hour_angle_from_datetime_and_longitude(double datetime, double
     return harp_wrap(longitude + 360 * local_fraction_of_day - 180, -180, 180);
 }
 
-/** Calculate the solar zenith angle for the given time and location
- * \param latitude Latitude [degree_north]
- * \param solar_declination_angle Solar declination angle [deg]
- * \param solar_hour_angle Solar hour angle [deg]
- * \return the solar zenith angle [degree]
+/** Calculate the solar hour angle for the given time and location
+ * \param datetime Datetime [s since 2000-01-01]
+ * \param longitude Longitude [degree_east]
+ * \return the solar hour angle [degree]
  */
-double harp_solar_zenith_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
-                                                              double solar_hour_angle)
+double harp_solar_hour_angle_from_datetime_and_longitude(double datetime, double longitude)
+{
+    return get_solar_hour_angle_from_datetime_and_longitude(datetime, longitude);
+}
+
+/** Array version of harp_solar_hour_angle_from_datetime_and_longitude().
+ * \param num_elements Number of elements of each array.
+ * \param datetime Datetime [s since 2000-01-01] (array of \a num_elements values)
+ * \param longitude Longitude [degree_east] (array of \a num_elements values)
+ * \param result Array in which the solar hour angle [degree] values will be stored.
+ */
+void harp_solar_hour_angle_from_datetime_and_longitude_array(long num_elements, const double *datetime,
+                                                             const double *longitude, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_solar_hour_angle_from_datetime_and_longitude(datetime[i], longitude[i]);
+    }
+}
+
+static double get_solar_zenith_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
+                                                                    double solar_hour_angle)
 {
     double cosangle;
 
@@ -353,13 +512,40 @@ double harp_solar_zenith_angle_from_latitude_and_solar_angles(double latitude, d
     return CONST_RAD2DEG * acos(cosangle);
 }
 
-/** Convert sensor and solar azimuth angles to relative azimuth angle
- * \param sensor_azimuth_angle Sensor azimuth angle[degree]
- * \param solar_azimuth_angle Solar azimuth angle[degree]
- * \return the relative azimuth angle [degree]
+/** Calculate the solar zenith angle for the given time and location
+ * \param latitude Latitude [degree_north]
+ * \param solar_declination_angle Solar declination angle [deg]
+ * \param solar_hour_angle Solar hour angle [deg]
+ * \return the solar zenith angle [degree]
  */
-double harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(double sensor_azimuth_angle,
-                                                                        double solar_azimuth_angle)
+double harp_solar_zenith_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
+                                                              double solar_hour_angle)
+{
+    return get_solar_zenith_angle_from_latitude_and_solar_angles(latitude, solar_declination_angle, solar_hour_angle);
+}
+
+/** Array version of harp_solar_zenith_angle_from_latitude_and_solar_angles().
+ * \param num_elements Number of elements of each array.
+ * \param latitude Latitude [degree_north] (array of \a num_elements values)
+ * \param solar_declination_angle Solar declination angle [deg] (array of \a num_elements values)
+ * \param solar_hour_angle Solar hour angle [deg] (array of \a num_elements values)
+ * \param result Array in which the solar zenith angle [degree] values will be stored.
+ */
+void harp_solar_zenith_angle_from_latitude_and_solar_angles_array(long num_elements, const double *latitude,
+                                                                  const double *solar_declination_angle,
+                                                                  const double *solar_hour_angle, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_solar_zenith_angle_from_latitude_and_solar_angles(latitude[i], solar_declination_angle[i],
+                                                                          solar_hour_angle[i]);
+    }
+}
+
+static double get_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(double sensor_azimuth_angle,
+                                                                              double solar_azimuth_angle)
 {
     double angle = sensor_azimuth_angle - solar_azimuth_angle;
 
@@ -380,13 +566,69 @@ double harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(double s
     return angle;
 }
 
+/** Convert sensor and solar azimuth angles to relative azimuth angle
+ * \param sensor_azimuth_angle Sensor azimuth angle[degree]
+ * \param solar_azimuth_angle Solar azimuth angle[degree]
+ * \return the relative azimuth angle [degree]
+ */
+double harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(double sensor_azimuth_angle,
+                                                                        double solar_azimuth_angle)
+{
+    return get_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(sensor_azimuth_angle, solar_azimuth_angle);
+}
+
+/** Array version of harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles().
+ * \param num_elements Number of elements of each array.
+ * \param sensor_azimuth_angle Sensor azimuth angle[degree] (array of \a num_elements values)
+ * \param solar_azimuth_angle Solar azimuth angle[degree] (array of \a num_elements values)
+ * \param result Array in which the relative azimuth angle [degree] values will be stored.
+ */
+void harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles_array(long num_elements,
+                                                                            const double *sensor_azimuth_angle,
+                                                                            const double *solar_azimuth_angle,
+                                                                            double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(sensor_azimuth_angle[i],
+                                                                                    solar_azimuth_angle[i]);
+    }
+}
+
+static double get_elevation_angle_from_zenith_angle(double zenith_angle)
+{
+    return 90.0 - zenith_angle;
+}
+
 /** Convert zenith angle to elevation angle
  * \param zenith_angle Zenith angle[degree]
  * \return the elevation angle [degree]
  */
 double harp_elevation_angle_from_zenith_angle(double zenith_angle)
 {
-    return 90.0 - zenith_angle;
+    return get_elevation_angle_from_zenith_angle(zenith_angle);
+}
+
+/** Array version of harp_elevation_angle_from_zenith_angle().
+ * \param num_elements Number of elements of each array.
+ * \param zenith_angle Zenith angle[degree] (array of \a num_elements values)
+ * \param result Array in which the elevation angle [degree] values will be stored.
+ */
+void harp_elevation_angle_from_zenith_angle_array(long num_elements, const double *zenith_angle, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_elevation_angle_from_zenith_angle(zenith_angle[i]);
+    }
+}
+
+static double get_zenith_angle_from_elevation_angle(double elevation_angle)
+{
+    return 90.0 - elevation_angle;
 }
 
 /** Convert zenith angle to elevation angle
@@ -395,7 +637,27 @@ double harp_elevation_angle_from_zenith_angle(double zenith_angle)
  */
 double harp_zenith_angle_from_elevation_angle(double elevation_angle)
 {
-    return 90.0 - elevation_angle;
+    return get_zenith_angle_from_elevation_angle(elevation_angle);
+}
+
+/** Array version of harp_zenith_angle_from_elevation_angle().
+ * \param num_elements Number of elements of each array.
+ * \param elevation_angle elevation angle [degree] (array of \a num_elements values)
+ * \param result Array in which the zenith angle [degree] values will be stored.
+ */
+void harp_zenith_angle_from_elevation_angle_array(long num_elements, const double *elevation_angle, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_zenith_angle_from_elevation_angle(elevation_angle[i]);
+    }
+}
+
+static double get_sensor_angle_from_viewing_angle(double viewing_angle)
+{
+    return 180.0 - viewing_angle;
 }
 
 /** Convert viewing angle (zenith, elevation, or azimuth) to sensor angle
@@ -404,7 +666,27 @@ double harp_zenith_angle_from_elevation_angle(double elevation_angle)
  */
 double harp_sensor_angle_from_viewing_angle(double viewing_angle)
 {
-    return 180.0 - viewing_angle;
+    return get_sensor_angle_from_viewing_angle(viewing_angle);
+}
+
+/** Array version of harp_sensor_angle_from_viewing_angle().
+ * \param num_elements Number of elements of each array.
+ * \param viewing_angle Viewing angle[degree] (array of \a num_elements values)
+ * \param result Array in which the sensor angle [degree] values will be stored.
+ */
+void harp_sensor_angle_from_viewing_angle_array(long num_elements, const double *viewing_angle, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_sensor_angle_from_viewing_angle(viewing_angle[i]);
+    }
+}
+
+static double get_viewing_angle_from_sensor_angle(double sensor_angle)
+{
+    return 180.0 - sensor_angle;
 }
 
 /** Convert sensor angle (zenith, elevation, or azimuth) to viewing angle
@@ -413,7 +695,22 @@ double harp_sensor_angle_from_viewing_angle(double viewing_angle)
  */
 double harp_viewing_angle_from_sensor_angle(double sensor_angle)
 {
-    return 180.0 - sensor_angle;
+    return get_viewing_angle_from_sensor_angle(sensor_angle);
+}
+
+/** Array version of harp_viewing_angle_from_sensor_angle().
+ * \param num_elements Number of elements of each array.
+ * \param sensor_angle sensor angle [degree] (array of \a num_elements values)
+ * \param result Array in which the viewing angle [degree] values will be stored.
+ */
+void harp_viewing_angle_from_sensor_angle_array(long num_elements, const double *sensor_angle, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_viewing_angle_from_sensor_angle(sensor_angle[i]);
+    }
 }
 
 /** Convert the solar zenith angle, the sensor zenith angle and relative azimuth angle at one height to another height
@@ -586,13 +883,38 @@ int harp_sensor_geometry_angle_profiles_from_sensor_geometry_angles(double altit
     return 0;
 }
 
+static double get_wavelength_from_frequency(double frequency)
+{
+    return (double)CONST_SPEED_OF_LIGHT / frequency;
+}
+
 /** Convert (electromagnetic wave) frequency to (electromagnetic wave) wavelength
  * \param frequency Frequency [Hz]
  * \return Wavelength [m]
  */
 double harp_wavelength_from_frequency(double frequency)
 {
-    return (double)CONST_SPEED_OF_LIGHT / frequency;
+    return get_wavelength_from_frequency(frequency);
+}
+
+/** Array version of harp_wavelength_from_frequency().
+ * \param num_elements Number of elements of each array.
+ * \param frequency Frequency [Hz] (array of \a num_elements values)
+ * \param result Array in which the Wavelength [m] values will be stored.
+ */
+void harp_wavelength_from_frequency_array(long num_elements, const double *frequency, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_wavelength_from_frequency(frequency[i]);
+    }
+}
+
+static double get_wavelength_from_wavenumber(double wavenumber)
+{
+    return 1.0 / wavenumber;
 }
 
 /** Convert (electromagnetic wave) wavenumber to (electromagnetic wave) wavelength
@@ -601,7 +923,27 @@ double harp_wavelength_from_frequency(double frequency)
  */
 double harp_wavelength_from_wavenumber(double wavenumber)
 {
-    return 1.0 / wavenumber;
+    return get_wavelength_from_wavenumber(wavenumber);
+}
+
+/** Array version of harp_wavelength_from_wavenumber().
+ * \param num_elements Number of elements of each array.
+ * \param wavenumber Wavenumber [1/m] (array of \a num_elements values)
+ * \param result Array in which the Wavelength [m] values will be stored.
+ */
+void harp_wavelength_from_wavenumber_array(long num_elements, const double *wavenumber, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_wavelength_from_wavenumber(wavenumber[i]);
+    }
+}
+
+static double get_wavenumber_from_frequency(double frequency)
+{
+    return frequency / (double)CONST_SPEED_OF_LIGHT;
 }
 
 /** Convert (electromagnetic wave) frequency to (electromagnetic wave) wavenumber
@@ -610,7 +952,27 @@ double harp_wavelength_from_wavenumber(double wavenumber)
  */
 double harp_wavenumber_from_frequency(double frequency)
 {
-    return frequency / (double)CONST_SPEED_OF_LIGHT;
+    return get_wavenumber_from_frequency(frequency);
+}
+
+/** Array version of harp_wavenumber_from_frequency().
+ * \param num_elements Number of elements of each array.
+ * \param frequency Frequency [Hz] (array of \a num_elements values)
+ * \param result Array in which the Wavenumber [1/m] values will be stored.
+ */
+void harp_wavenumber_from_frequency_array(long num_elements, const double *frequency, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_wavenumber_from_frequency(frequency[i]);
+    }
+}
+
+static double get_wavenumber_from_wavelength(double wavelength)
+{
+    return 1.0 / wavelength;
 }
 
 /** Convert (electromagnetic wave) wavelength to (electromagnetic wave) wavenumber
@@ -619,7 +981,22 @@ double harp_wavenumber_from_frequency(double frequency)
  */
 double harp_wavenumber_from_wavelength(double wavelength)
 {
-    return 1.0 / wavelength;
+    return get_wavenumber_from_wavelength(wavelength);
+}
+
+/** Array version of harp_wavenumber_from_wavelength().
+ * \param num_elements Number of elements of each array.
+ * \param wavelength Wavelength [m] (array of \a num_elements values)
+ * \param result Array in which the Wavenumber [1/m] values will be stored.
+ */
+void harp_wavenumber_from_wavelength_array(long num_elements, const double *wavelength, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_wavenumber_from_wavelength(wavelength[i]);
+    }
 }
 
 /** Wrap a value to the given min/max range
@@ -631,9 +1008,41 @@ double harp_wavenumber_from_wavelength(double wavelength)
  */
 double harp_wrap(double value, double min, double max)
 {
+    if (value >= min && value < max)
+    {
+        /* most values are already within range (this also avoids rounding errors for those values) */
+        return value;
+    }
     if (value < min)
     {
-        return max + fmod(value - min, max - min);
+        value = max + fmod(value - min, max - min);
+        /* values at a multiple of the range below min map onto min (not max) */
+        return value >= max ? min : value;
     }
     return min + fmod(value - min, max - min);
 }
+
+/** Wrap an array of values to the given min/max range
+ * This gives the same result as applying harp_wrap() to each element, but uses floor() instead of the (much more
+ * expensive) fmod() to map values that are outside the range.
+ * \param num_elements Number of elements in the array
+ * \param value Array of values that will be wrapped in place to the given range
+ * \param min Minimum value of the range
+ * \param max Maximum value of the range
+ */
+void harp_wrap_array(long num_elements, double *value, double min, double max)
+{
+    double range = max - min;
+    double inverse_range = 1.0 / range;
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        double v = value[i];
+        double wrapped = v - range * floor((v - min) * inverse_range);
+
+        /* guard against rounding that moves a value just below min onto max */
+        wrapped = wrapped >= max ? min : wrapped;
+        value[i] = (v >= min && v < max) ? v : wrapped;
+    }
+}
@@ -0,0 +1,856 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "harp-internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* An archive index file contains the metadata of a (large) set of products together with a packed R-tree over the
+ * datetime range and spatial extent of the products, such that the products that can pass the leading filters of a set
+ * of operations are found without having to go over all entries. The file has the following layout:
+ *   - a fixed size header (archive_index_header)
+ *   - the ingestion options with which the metadata was retrieved (zero terminated, padded to a multiple of 8 bytes)
+ *   - the nodes of the tree (archive_index_node); the leaf nodes come first and the root node is the last node
+ *   - an entry for each product (archive_index_entry)
+ *   - a string area with the (zero terminated) filename and source product of each entry
+ * The entries are ordered by time bucket (of ARCHIVE_INDEX_TIME_BUCKET days) of their start time and, within a time
+ * bucket, by the position (in Z-order) of the center of their spatial extent. Each leaf node covers up to
+ * ARCHIVE_INDEX_FANOUT consecutive entries and each other node covers up to ARCHIVE_INDEX_FANOUT consecutive nodes of
+ * the level below. The strings of the entries of a leaf node are stored consecutively, such that they can be read at
+ * once.
+ * All offsets are in bytes; node, entry, and string offsets in the header are relative to the start of the file and
+ * string offsets of entries are relative to the start of the string area. All values use the native byte order.
+ */
+
+#define ARCHIVE_INDEX_MAGIC "HARPAIX"
+#define ARCHIVE_INDEX_FORMAT_VERSION 1
+#define ARCHIVE_INDEX_BYTE_ORDER_MARK 0x01020304
+#define ARCHIVE_INDEX_FANOUT 32
+#define ARCHIVE_INDEX_TIME_BUCKET 1.0
+
+/* the extent of an entry or node is stored as: datetime_start, datetime_stop, latitude_min, latitude_max,
+ * longitude_min, longitude_max (in days since 2000-01-01, degree_north, and degree_east; NaN if unknown).
+ * Even elements are lower bounds and odd elements are upper bounds.
+ */
+#define ARCHIVE_INDEX_EXTENT_SIZE 6
+
+typedef struct archive_index_header_struct
+{
+    char magic[8];      /* ARCHIVE_INDEX_MAGIC (zero terminated) */
+    uint32_t version;   /* ARCHIVE_INDEX_FORMAT_VERSION */
+    uint32_t byte_order_mark;   /* ARCHIVE_INDEX_BYTE_ORDER_MARK */
+    uint32_t num_dim_types;     /* HARP_NUM_DIM_TYPES */
+    uint32_t options_length;    /* length of the options string (excluding the terminating zero) */
+    int64_t num_entries;
+    int64_t num_nodes;
+    int64_t num_leaf_nodes;
+    int64_t node_offset;
+    int64_t entry_offset;
+    int64_t string_offset;
+} archive_index_header;
+
+typedef struct archive_index_node_struct
+{
+    double extent[ARCHIVE_INDEX_EXTENT_SIZE];  /* union of the extents of the entries/nodes that are covered */
+    int64_t first;      /* index of the first entry (leaf nodes) or of the first child node (other nodes) */
+    int64_t count;
+} archive_index_node;
+
+typedef struct archive_index_entry_struct
+{
+    double extent[ARCHIVE_INDEX_EXTENT_SIZE];
+    int64_t dimension[HARP_NUM_DIM_TYPES];
+    int64_t string_offset;      /* the filename, which is directly followed by the source product */
+    int32_t filename_length;
+    int32_t source_product_length;
+} archive_index_entry;
+
+/* position of an entry in the index (used when building the index) */
+typedef struct archive_index_sort_key_struct
+{
+    double time_bucket;
+    uint32_t spatial_key;
+    double datetime_start;
+    long index; /* position of the product in the sorted order of the dataset */
+} archive_index_sort_key;
+
+/* state while searching the tree of an index */
+typedef struct archive_index_reader_struct
+{
+    const char *filename;
+    FILE *stream;
+    archive_index_header header;
+    archive_index_node *node;
+    const harp_program *program;
+    harp_dataset *dataset;
+    archive_index_entry entry[ARCHIVE_INDEX_FANOUT];
+    char *string_buffer;
+    long string_buffer_size;
+} archive_index_reader;
+
+static void get_metadata_extent(const harp_product_metadata *metadata, double *extent)
+{
+    extent[0] = metadata->datetime_start;
+    extent[1] = metadata->datetime_stop;
+    extent[2] = metadata->latitude_min;
+    extent[3] = metadata->latitude_max;
+    extent[4] = metadata->longitude_min;
+    extent[5] = metadata->longitude_max;
+}
+
+/* Extend extent such that it also covers other; an unknown (NaN) bound stays unknown */
+static void extent_add(double *extent, const double *other)
+{
+    int k;
+
+    for (k = 0; k < ARCHIVE_INDEX_EXTENT_SIZE; k++)
+    {
+        if (harp_isnan(extent[k]))
+        {
+            continue;
+        }
+        if (harp_isnan(other[k]))
+        {
+            extent[k] = harp_nan();
+        }
+        else if (k % 2 == 0 ? other[k] < extent[k] : other[k] > extent[k])
+        {
+            extent[k] = other[k];
+        }
+    }
+}
+
+static int extent_can_pass(const harp_program *program, const double *extent)
+{
+    return harp_program_datetime_range_can_pass(program, extent[0], extent[1]) &&
+        harp_program_spatial_extent_can_pass(program, extent[2], extent[3], extent[4], extent[5]);
+}
+
+/* Interleave the bits of the quantized center latitude and longitude of the extent (entries with an unknown extent
+ * go last).
+ */
+static uint32_t get_spatial_key(const double *extent)
+{
+    double latitude;
+    double longitude;
+    uint32_t y;
+    uint32_t x;
+    uint32_t key = 0;
+    int i;
+
+    if (harp_isnan(extent[2]) || harp_isnan(extent[3]) || harp_isnan(extent[4]) || harp_isnan(extent[5]))
+    {
+        return 0xFFFFFFFF;
+    }
+    latitude = (extent[2] + extent[3]) / 2;
+    longitude = fmod((extent[4] + extent[5]) / 2 + 180.0, 360.0);
+    if (longitude < 0)
+    {
+        longitude += 360.0;
+    }
+    latitude = (latitude + 90.0) / 180.0;
+    latitude = latitude < 0 ? 0 : (latitude > 1 ? 1 : latitude);
+    y = (uint32_t)(latitude * 65535);
+    x = (uint32_t)(longitude / 360.0 * 65535);
+    for (i = 0; i < 16; i++)
+    {
+        key |= ((x >> i) & 1) << (2 * i);
+        key |= ((y >> i) & 1) << (2 * i + 1);
+    }
+
+    return key;
+}
+
+static int compare_sort_keys(const void *a, const void *b)
+{
+    const archive_index_sort_key *key_a = (const archive_index_sort_key *)a;
+    const archive_index_sort_key *key_b = (const archive_index_sort_key *)b;
+
+    if (key_a->time_bucket != key_b->time_bucket)
+    {
+        return key_a->time_bucket < key_b->time_bucket ? -1 : 1;
+    }
+    if (key_a->spatial_key != key_b->spatial_key)
+    {
+        return key_a->spatial_key < key_b->spatial_key ? -1 : 1;
+    }
+    if (key_a->datetime_start != key_b->datetime_start)
+    {
+        return key_a->datetime_start < key_b->datetime_start ? -1 : 1;
+    }
+
+    return key_a->index < key_b->index ? -1 : (key_a->index > key_b->index ? 1 : 0);
+}
+
+/* Determine the order of the entries in the index; returns the indices of the dataset products in index order */
+static int get_entry_order(const harp_dataset *dataset, long **new_order)
+{
+    archive_index_sort_key *key;
+    long *order;
+    long i;
+
+    key = malloc(dataset->num_products * sizeof(archive_index_sort_key));
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(archive_index_sort_key), __FILE__, __LINE__);
+        return -1;
+    }
+    order = malloc(dataset->num_products * sizeof(long));
+    if (order == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(long), __FILE__, __LINE__);
+        free(key);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        const harp_product_metadata *metadata = dataset->metadata[dataset->sorted_index[i]];
+        double extent[ARCHIVE_INDEX_EXTENT_SIZE];
+
+        get_metadata_extent(metadata, extent);
+        if (harp_isnan(metadata->datetime_start))
+        {
+            key[i].time_bucket = harp_plusinf();
+            key[i].datetime_start = harp_plusinf();
+        }
+        else
+        {
+            key[i].time_bucket = floor(metadata->datetime_start / ARCHIVE_INDEX_TIME_BUCKET);
+            key[i].datetime_start = metadata->datetime_start;
+        }
+        key[i].spatial_key = get_spatial_key(extent);
+        key[i].index = i;
+    }
+    qsort(key, dataset->num_products, sizeof(archive_index_sort_key), compare_sort_keys);
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        order[i] = dataset->sorted_index[key[i].index];
+    }
+    free(key);
+
+    *new_order = order;
+
+    return 0;
+}
+
+/* Build the nodes of the tree on top of the given entries (with the leaf nodes first and the root node last) */
+static int build_nodes(const archive_index_entry *entry, int64_t num_entries, archive_index_node **new_node,
+                       int64_t *num_nodes, int64_t *num_leaf_nodes)
+{
+    archive_index_node *node;
+    int64_t level_start;
+    int64_t level_count;
+    int64_t count;
+    int64_t i, j;
+
+    /* determine the total number of nodes */
+    *num_leaf_nodes = (num_entries + ARCHIVE_INDEX_FANOUT - 1) / ARCHIVE_INDEX_FANOUT;
+    *num_nodes = 0;
+    count = *num_leaf_nodes;
+    while (count > 0)
+    {
+        *num_nodes += count;
+        count = count > 1 ? (count + ARCHIVE_INDEX_FANOUT - 1) / ARCHIVE_INDEX_FANOUT : 0;
+    }
+    if (*num_nodes == 0)
+    {
+        *new_node = NULL;
+        return 0;
+    }
+
+    node = malloc((size_t)*num_nodes * sizeof(archive_index_node));
+    if (node == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)*num_nodes * sizeof(archive_index_node), __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < *num_leaf_nodes; i++)
+    {
+        node[i].first = i * ARCHIVE_INDEX_FANOUT;
+        node[i].count = num_entries - node[i].first;
+        if (node[i].count > ARCHIVE_INDEX_FANOUT)
+        {
+            node[i].count = ARCHIVE_INDEX_FANOUT;
+        }
+        memcpy(node[i].extent, entry[node[i].first].extent, sizeof(node[i].extent));
+        for (j = 1; j < node[i].count; j++)
+        {
+            extent_add(node[i].extent, entry[node[i].first + j].extent);
+        }
+    }
+
+    level_start = 0;
+    level_count = *num_leaf_nodes;
+    while (level_count > 1)
+    {
+        int64_t next_start = level_start + level_count;
+        int64_t next_count = (level_count + ARCHIVE_INDEX_FANOUT - 1) / ARCHIVE_INDEX_FANOUT;
+
+        for (i = 0; i < next_count; i++)
+        {
+            archive_index_node *parent = &node[next_start + i];
+
+            parent->first = level_start + i * ARCHIVE_INDEX_FANOUT;
+            parent->count = level_start + level_count - parent->first;
+            if (parent->count > ARCHIVE_INDEX_FANOUT)
+            {
+                parent->count = ARCHIVE_INDEX_FANOUT;
+            }
+            memcpy(parent->extent, node[parent->first].extent, sizeof(parent->extent));
+            for (j = 1; j < parent->count; j++)
+            {
+                extent_add(parent->extent, node[parent->first + j].extent);
+            }
+        }
+        level_start = next_start;
+        level_count = next_count;
+    }
+    assert(level_start + level_count == *num_nodes);
+
+    *new_node = node;
+
+    return 0;
+}
+
+static int write_index(FILE *stream, const harp_dataset *dataset, const long *order, const char *options)
+{
+    archive_index_header header;
+    archive_index_entry *entry;
+    archive_index_node *node;
+    int64_t string_size = 0;
+    int64_t options_size;
+    long i;
+
+    if (options == NULL)
+    {
+        options = "";
+    }
+
+    entry = malloc(dataset->num_products * sizeof(archive_index_entry));
+    if (entry == NULL && dataset->num_products > 0)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(archive_index_entry), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        const harp_product_metadata *metadata = dataset->metadata[order[i]];
+        int k;
+
+        memset(&entry[i], 0, sizeof(archive_index_entry));
+        get_metadata_extent(metadata, entry[i].extent);
+        for (k = 0; k < HARP_NUM_DIM_TYPES; k++)
+        {
+            entry[i].dimension[k] = metadata->dimension[k];
+        }
+        entry[i].string_offset = string_size;
+        entry[i].filename_length = (int32_t)strlen(metadata->filename);
+        entry[i].source_product_length = (int32_t)strlen(metadata->source_product);
+        string_size += entry[i].filename_length + 1 + entry[i].source_product_length + 1;
+    }
+    if (build_nodes(entry, dataset->num_products, &node, &header.num_nodes, &header.num_leaf_nodes) != 0)
+    {
+        free(entry);
+        return -1;
+    }
+
+    memset(header.magic, 0, sizeof(header.magic));
+    strcpy(header.magic, ARCHIVE_INDEX_MAGIC);
+    header.version = ARCHIVE_INDEX_FORMAT_VERSION;
+    header.byte_order_mark = ARCHIVE_INDEX_BYTE_ORDER_MARK;
+    header.num_dim_types = HARP_NUM_DIM_TYPES;
+    header.options_length = (uint32_t)strlen(options);
+    header.num_entries = dataset->num_products;
+    options_size = ((int64_t)header.options_length + 1 + 7) & ~(int64_t)7;
+    header.node_offset = sizeof(archive_index_header) + options_size;
+    header.entry_offset = header.node_offset + header.num_nodes * sizeof(archive_index_node);
+    header.string_offset = header.entry_offset + header.num_entries * sizeof(archive_index_entry);
+
+    if (fwrite(&header, sizeof(archive_index_header), 1, stream) != 1)
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "could not write archive index (%s)", strerror(errno));
+        free(node);
+        free(entry);
+        return -1;
+    }
+    for (i = 0; i < options_size; i++)
+    {
+        if (fputc(i < (long)header.options_length ? options[i] : '\0', stream) == EOF)
+        {
+            harp_set_error(HARP_ERROR_FILE_WRITE, "could not write archive index (%s)", strerror(errno));
+            free(node);
+            free(entry);
+            return -1;
+        }
+    }
+    if ((header.num_nodes > 0 &&
+         fwrite(node, sizeof(archive_index_node), (size_t)header.num_nodes, stream) != (size_t)header.num_nodes) ||
+        (header.num_entries > 0 &&
+         fwrite(entry, sizeof(archive_index_entry), (size_t)header.num_entries, stream) != (size_t)header.num_entries))
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "could not write archive index (%s)", strerror(errno));
+        free(node);
+        free(entry);
+        return -1;
+    }
+    free(node);
+    free(entry);
+
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        const harp_product_metadata *metadata = dataset->metadata[order[i]];
+
+        if (fwrite(metadata->filename, strlen(metadata->filename) + 1, 1, stream) != 1 ||
+            fwrite(metadata->source_product, strlen(metadata->source_product) + 1, 1, stream) != 1)
+        {
+            harp_set_error(HARP_ERROR_FILE_WRITE, "could not write archive index (%s)", strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int read_at(archive_index_reader *reader, int64_t offset, void *buffer, size_t size)
+{
+    if (fseek(reader->stream, (long)offset, SEEK_SET) != 0 || fread(buffer, size, 1, reader->stream) != 1)
+    {
+        harp_set_error(HARP_ERROR_FILE_READ, "could not read archive index '%s'", reader->filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int invalid_index(archive_index_reader *reader)
+{
+    harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid archive index '%s'", reader->filename);
+    return -1;
+}
+
+static int add_entry(archive_index_reader *reader, const archive_index_entry *entry, const char *str)
+{
+    harp_product_metadata *metadata;
+    int k;
+
+    if (harp_product_metadata_new(&metadata) != 0)
+    {
+        return -1;
+    }
+    metadata->filename = strdup(str);
+    metadata->source_product = strdup(&str[entry->filename_length + 1]);
+    if (metadata->filename == NULL || metadata->source_product == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_product_metadata_delete(metadata);
+        return -1;
+    }
+    metadata->datetime_start = entry->extent[0];
+    metadata->datetime_stop = entry->extent[1];
+    metadata->latitude_min = entry->extent[2];
+    metadata->latitude_max = entry->extent[3];
+    metadata->longitude_min = entry->extent[4];
+    metadata->longitude_max = entry->extent[5];
+    for (k = 0; k < HARP_NUM_DIM_TYPES; k++)
+    {
+        metadata->dimension[k] = (long)entry->dimension[k];
+    }
+
+    if (harp_dataset_add_product_unsorted(reader->dataset, metadata->source_product, metadata) != 0)
+    {
+        harp_product_metadata_delete(metadata);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int search_leaf_node(archive_index_reader *reader, const archive_index_node *node)
+{
+    int64_t string_start;
+    int64_t string_end;
+    int pass[ARCHIVE_INDEX_FANOUT];
+    int num_pass = 0;
+    int i;
+
+    if (node->count < 1 || node->count > ARCHIVE_INDEX_FANOUT || node->first < 0 ||
+        node->first > reader->header.num_entries - node->count)
+    {
+        return invalid_index(reader);
+    }
+    if (read_at(reader, reader->header.entry_offset + node->first * (int64_t)sizeof(archive_index_entry),
+                reader->entry, (size_t)node->count * sizeof(archive_index_entry)) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < node->count; i++)
+    {
+        pass[i] = extent_can_pass(reader->program, reader->entry[i].extent);
+        num_pass += pass[i];
+    }
+    if (num_pass == 0)
+    {
+        return 0;
+    }
+
+    /* read the strings of all entries of the leaf at once */
+    string_start = reader->entry[0].string_offset;
+    string_end = string_start;
+    for (i = 0; i < node->count; i++)
+    {
+        const archive_index_entry *entry = &reader->entry[i];
+
+        if (entry->string_offset != string_end || entry->filename_length < 1 || entry->source_product_length < 1)
+        {
+            return invalid_index(reader);
+        }
+        string_end += (int64_t)entry->filename_length + 1 + entry->source_product_length + 1;
+    }
+    if (string_start < 0 || string_end - string_start > 0x7FFFFFFF)
+    {
+        return invalid_index(reader);
+    }
+    if (string_end - string_start > reader->string_buffer_size)
+    {
+        char *buffer;
+
+        buffer = realloc(reader->string_buffer, (size_t)(string_end - string_start));
+        if (buffer == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (long)(string_end - string_start), __FILE__, __LINE__);
+            return -1;
+        }
+        reader->string_buffer = buffer;
+        reader->string_buffer_size = (long)(string_end - string_start);
+    }
+    if (read_at(reader, reader->header.string_offset + string_start, reader->string_buffer,
+                (size_t)(string_end - string_start)) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < node->count; i++)
+    {
+        const archive_index_entry *entry = &reader->entry[i];
+        const char *str = &reader->string_buffer[entry->string_offset - string_start];
+
+        if (!pass[i])
+        {
+            continue;
+        }
+        if (str[entry->filename_length] != '\0' ||
+            str[entry->filename_length + 1 + entry->source_product_length] != '\0')
+        {
+            return invalid_index(reader);
+        }
+        if (add_entry(reader, entry, str) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int search_node(archive_index_reader *reader, int64_t index)
+{
+    const archive_index_node *node = &reader->node[index];
+    int64_t i;
+
+    if (!extent_can_pass(reader->program, node->extent))
+    {
+        return 0;
+    }
+    if (index < reader->header.num_leaf_nodes)
+    {
+        return search_leaf_node(reader, node);
+    }
+
+    /* child nodes always come before their parent node (which also guarantees that the search ends) */
+    if (node->count < 1 || node->count > ARCHIVE_INDEX_FANOUT || node->first < 0 || node->first > index - node->count)
+    {
+        return invalid_index(reader);
+    }
+    for (i = node->first; i < node->first + node->count; i++)
+    {
+        if (search_node(reader, i) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int read_header(archive_index_reader *reader, const char *options)
+{
+    archive_index_header *header = &reader->header;
+    char *index_options;
+
+    if (read_at(reader, 0, header, sizeof(archive_index_header)) != 0)
+    {
+        return -1;
+    }
+    if (memcmp(header->magic, ARCHIVE_INDEX_MAGIC, sizeof(ARCHIVE_INDEX_MAGIC)) != 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "file '%s' is not a HARP archive index", reader->filename);
+        return -1;
+    }
+    if (header->version != ARCHIVE_INDEX_FORMAT_VERSION)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "unsupported archive index format version %u for '%s'",
+                       (unsigned int)header->version, reader->filename);
+        return -1;
+    }
+    if (header->byte_order_mark != ARCHIVE_INDEX_BYTE_ORDER_MARK || header->num_dim_types != HARP_NUM_DIM_TYPES)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "archive index '%s' was created on an incompatible platform or "
+                       "with an incompatible version of HARP", reader->filename);
+        return -1;
+    }
+    if (header->num_entries < 0 || header->num_leaf_nodes < 0 || header->num_nodes < header->num_leaf_nodes ||
+        (header->num_entries > 0) != (header->num_leaf_nodes > 0) ||
+        header->node_offset < (int64_t)(sizeof(archive_index_header) + header->options_length + 1) ||
+        header->entry_offset < header->node_offset + header->num_nodes * (int64_t)sizeof(archive_index_node) ||
+        header->string_offset < header->entry_offset + header->num_entries * (int64_t)sizeof(archive_index_entry))
+    {
+        return invalid_index(reader);
+    }
+
+    /* the metadata in the index is only valid for the ingestion options that were used to create the index */
+    index_options = malloc(header->options_length + 1);
+    if (index_options == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)header->options_length + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    if (read_at(reader, sizeof(archive_index_header), index_options, header->options_length + 1) != 0)
+    {
+        free(index_options);
+        return -1;
+    }
+    index_options[header->options_length] = '\0';
+    if (strcmp(index_options, options == NULL ? "" : options) != 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "archive index '%s' was created using ingestion options '%s' "
+                       "(instead of '%s')", reader->filename, index_options, options == NULL ? "" : options);
+        free(index_options);
+        return -1;
+    }
+    free(index_options);
+
+    return 0;
+}
+
+/* Add all products of an archive index to the dataset (without sorting the dataset) that can pass the leading
+ * datetime/latitude/longitude filters of the program (see harp_program_datetime_range_can_pass() and
+ * harp_program_spatial_extent_can_pass()). If program is NULL then all products are added.
+ * The options should be the same ingestion options as the ones that were used when creating the index.
+ */
+int harp_archive_index_import(harp_dataset *dataset, const char *filename, const char *options,
+                              const harp_program *program)
+{
+    archive_index_reader reader;
+    int result;
+
+    reader.filename = filename;
+    reader.node = NULL;
+    reader.program = program;
+    reader.dataset = dataset;
+    reader.string_buffer = NULL;
+    reader.string_buffer_size = 0;
+
+    reader.stream = fopen(filename, "rb");
+    if (reader.stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "cannot open archive index '%s'", filename);
+        return -1;
+    }
+    if (read_header(&reader, options) != 0)
+    {
+        fclose(reader.stream);
+        return -1;
+    }
+    if (reader.header.num_nodes == 0)
+    {
+        fclose(reader.stream);
+        return 0;
+    }
+
+    reader.node = malloc((size_t)reader.header.num_nodes * sizeof(archive_index_node));
+    if (reader.node == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)reader.header.num_nodes * sizeof(archive_index_node), __FILE__, __LINE__);
+        fclose(reader.stream);
+        return -1;
+    }
+    result = read_at(&reader, reader.header.node_offset, reader.node,
+                     (size_t)reader.header.num_nodes * sizeof(archive_index_node));
+    if (result == 0)
+    {
+        /* the root node is the last node */
+        result = search_node(&reader, reader.header.num_nodes - 1);
+    }
+
+    free(reader.string_buffer);
+    free(reader.node);
+    fclose(reader.stream);
+
+    return result;
+}
+
+/** \addtogroup harp_dataset
+ * @{
+ */
+
+/** Write an archive index for the products of a dataset.
+ * An archive index contains the metadata of all products together with a spatio-temporal index (a packed R-tree on
+ * the datetime range and spatial extent of the products). When an archive index file (which should have the
+ * extension '.harpidx') is used as path for harp_dataset_import() all products from the index are added. With
+ * harp_dataset_import_with_prefilter() only the products that can pass the leading datetime, latitude, and longitude
+ * filters of the operations are added, where the index is used to skip groups of products that can not pass the
+ * filters. This makes it possible to quickly select products from archives with a very large number of products.
+ * Filenames are stored as they appear in the product metadata, so relative paths are interpreted relative to the
+ * current working directory of the process that uses the index.
+ * \param dataset Dataset for which to write the index; all products should have metadata (including a filename).
+ * \param filename Name of the archive index file that should be written.
+ * \param options Ingestion options that were used to import the dataset (can be NULL); the index can only be used
+ * with the same ingestion options.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_dataset_write_archive_index(harp_dataset *dataset, const char *filename, const char *options)
+{
+    char *temp_filename;
+    FILE *stream;
+    long *order;
+    long i;
+    int result;
+
+    if (dataset == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dataset is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        if (dataset->metadata[i] == NULL || dataset->metadata[i]->filename == NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "no metadata available for product '%s'",
+                           dataset->source_product[i]);
+            return -1;
+        }
+        if (strlen(dataset->metadata[i]->filename) == 0 || strlen(dataset->metadata[i]->filename) > 0x7FFFFFFF / 2 ||
+            strlen(dataset->metadata[i]->source_product) > 0x7FFFFFFF / 2)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid metadata for product '%s'",
+                           dataset->source_product[i]);
+            return -1;
+        }
+    }
+
+    if (get_entry_order(dataset, &order) != 0)
+    {
+        return -1;
+    }
+
+    /* write to a temporary file first, such that a reader never sees a partially written index */
+    temp_filename = malloc(strlen(filename) + 4 + 1);
+    if (temp_filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(filename) + 4 + 1, __FILE__, __LINE__);
+        free(order);
+        return -1;
+    }
+    sprintf(temp_filename, "%s.tmp", filename);
+
+    stream = fopen(temp_filename, "wb");
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create archive index '%s' (%s)", temp_filename,
+                       strerror(errno));
+        free(temp_filename);
+        free(order);
+        return -1;
+    }
+    result = write_index(stream, dataset, order, options);
+    free(order);
+    if (fclose(stream) != 0 && result == 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "could not write archive index '%s' (%s)", temp_filename,
+                       strerror(errno));
+        result = -1;
+    }
+    if (result == 0)
+    {
+#ifdef WIN32
+        /* rename() on Windows does not replace existing files */
+        remove(filename);
+#endif
+        if (rename(temp_filename, filename) != 0)
+        {
+            harp_set_error(HARP_ERROR_FILE_WRITE, "could not create archive index '%s' (%s)", filename,
+                           strerror(errno));
+            result = -1;
+        }
+    }
+    if (result != 0)
+    {
+        remove(temp_filename);
+    }
+    free(temp_filename);
+
+    return result;
+}
+
+/** @} */
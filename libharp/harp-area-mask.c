@@ -32,6 +32,7 @@
 #include "harp-area-mask.h"
 
 #include <ctype.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -39,6 +40,166 @@
 #define AREA_MASK_BLOCK_SIZE 1024
 #define AREA_MASK_MAX_LINE_SIZE 1024
 
+/* polygons with a bounding cap radius above this value [rad] are kept out of the latitude sorted part of the index */
+#define AREA_MASK_MAX_NARROW_RADIUS (10.0 * CONST_DEG2RAD)
+
+/* margin [rad] that is added to each bounding cap to stay clear of the tolerances of the exact polygon tests */
+#define AREA_MASK_CAP_MARGIN 1.0E-8
+
+typedef struct polygon_test_struct
+{
+    int (*test) (const harp_spherical_polygon *mask_polygon, const struct polygon_test_struct *test);
+    const harp_spherical_point *point;
+    const harp_spherical_polygon *area;
+    double min_fraction;
+} polygon_test;
+
+/* Determine a spherical cap that encloses the polygon.
+ * If the polygon does not fit in a hemisphere a cap with radius M_PI (i.e. the full sphere) is returned.
+ */
+static void get_bounding_cap(const harp_spherical_polygon *polygon, harp_area_mask_cap *cap)
+{
+    harp_vector3d vector;
+    double norm;
+    double min_cos;
+    int32_t i;
+
+    cap->centre.x = 0;
+    cap->centre.y = 0;
+    cap->centre.z = 1;
+    cap->latitude = M_PI_2;
+    cap->radius = M_PI;
+
+    harp_spherical_polygon_centre(&vector, polygon);
+    norm = harp_vector3d_norm(&vector);
+    if (HARP_GEOMETRY_FPzero(norm))
+    {
+        return;
+    }
+    vector.x /= norm;
+    vector.y /= norm;
+    vector.z /= norm;
+
+    min_cos = 1.0;
+    for (i = 0; i < polygon->numberofpoints; i++)
+    {
+        harp_vector3d vector_point;
+        double cos_distance;
+
+        harp_vector3d_from_spherical_point(&vector_point, &polygon->point[i]);
+        cos_distance = harp_vector3d_dotproduct(&vector, &vector_point);
+        if (cos_distance < min_cos)
+        {
+            min_cos = cos_distance;
+        }
+    }
+    if (min_cos <= 0)
+    {
+        /* a cap that is not smaller than a hemisphere does not necessarily enclose the polygon */
+        return;
+    }
+
+    cap->centre = vector;
+    cap->latitude = asin(vector.z > 1.0 ? 1.0 : vector.z);
+    cap->radius = acos(min_cos) + AREA_MASK_CAP_MARGIN;
+}
+
+static void get_point_cap(const harp_spherical_point *point, harp_area_mask_cap *cap)
+{
+    harp_vector3d_from_spherical_point(&cap->centre, point);
+    cap->latitude = point->lat;
+    cap->radius = AREA_MASK_CAP_MARGIN;
+}
+
+static int caps_overlap(const harp_area_mask_cap *cap_a, const harp_area_mask_cap *cap_b)
+{
+    double radius = cap_a->radius + cap_b->radius;
+
+    if (radius >= M_PI)
+    {
+        return 1;
+    }
+
+    return harp_vector3d_dotproduct(&cap_a->centre, &cap_b->centre) >= cos(radius);
+}
+
+/* Returns true (1) if at least one polygon of the mask passes the test.
+ * Only polygons whose bounding cap overlaps 'cap' (which should enclose the point or area of the test) are tested.
+ */
+static int find_polygon(const harp_area_mask *area_mask, const harp_area_mask_cap *cap, const polygon_test *test)
+{
+    long i;
+
+    if (area_mask->num_narrow > 0 && cap->radius < M_PI)
+    {
+        double min_latitude = cap->latitude - (cap->radius + area_mask->max_narrow_radius);
+        double max_latitude = cap->latitude + (cap->radius + area_mask->max_narrow_radius);
+        long low = 0;
+        long high = area_mask->num_narrow;
+
+        /* find first polygon with a latitude >= min_latitude */
+        while (low < high)
+        {
+            long middle = low + (high - low) / 2;
+
+            if (area_mask->cap[area_mask->narrow[middle]].latitude < min_latitude)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        for (i = low; i < area_mask->num_narrow; i++)
+        {
+            long index = area_mask->narrow[i];
+
+            if (area_mask->cap[index].latitude > max_latitude)
+            {
+                break;
+            }
+            if (caps_overlap(&area_mask->cap[index], cap) && test->test(area_mask->polygon[index], test))
+            {
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        for (i = 0; i < area_mask->num_narrow; i++)
+        {
+            long index = area_mask->narrow[i];
+
+            if (test->test(area_mask->polygon[index], test))
+            {
+                return 1;
+            }
+        }
+    }
+
+    for (i = 0; i < area_mask->num_wide; i++)
+    {
+        long index = area_mask->wide[i];
+
+        if (caps_overlap(&area_mask->cap[index], cap) && test->test(area_mask->polygon[index], test))
+        {
+            return 1;
+        }
+    }
+
+    /* polygons that were added after the index was last updated */
+    for (i = area_mask->num_indexed; i < area_mask->num_polygons; i++)
+    {
+        if (caps_overlap(&area_mask->cap[i], cap) && test->test(area_mask->polygon[i], test))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int harp_area_mask_new(harp_area_mask **new_area_mask)
 {
     harp_area_mask *area_mask;
@@ -53,6 +214,13 @@ int harp_area_mask_new(harp_area_mask **new_area_mask)
 
     area_mask->num_polygons = 0;
     area_mask->polygon = NULL;
+    area_mask->cap = NULL;
+    area_mask->num_indexed = 0;
+    area_mask->num_narrow = 0;
+    area_mask->narrow = NULL;
+    area_mask->max_narrow_radius = 0;
+    area_mask->num_wide = 0;
+    area_mask->wide = NULL;
 
     *new_area_mask = area_mask;
     return 0;
@@ -73,6 +241,18 @@ void harp_area_mask_delete(harp_area_mask *area_mask)
 
             free(area_mask->polygon);
         }
+        if (area_mask->cap != NULL)
+        {
+            free(area_mask->cap);
+        }
+        if (area_mask->narrow != NULL)
+        {
+            free(area_mask->narrow);
+        }
+        if (area_mask->wide != NULL)
+        {
+            free(area_mask->wide);
+        }
 
         free(area_mask);
     }
@@ -88,6 +268,7 @@ int harp_area_mask_add_polygon(harp_area_mask *area_mask, harp_spherical_polygon
     if (area_mask->num_polygons % AREA_MASK_BLOCK_SIZE == 0)
     {
         harp_spherical_polygon **new_polygon = NULL;
+        harp_area_mask_cap *new_cap = NULL;
 
         new_polygon = realloc(area_mask->polygon, (area_mask->num_polygons + AREA_MASK_BLOCK_SIZE)
                               * sizeof(harp_spherical_polygon *));
@@ -98,110 +279,248 @@ int harp_area_mask_add_polygon(harp_area_mask *area_mask, harp_spherical_polygon
                            __FILE__, __LINE__);
             return -1;
         }
-
         area_mask->polygon = new_polygon;
+
+        new_cap = realloc(area_mask->cap, (area_mask->num_polygons + AREA_MASK_BLOCK_SIZE) *
+                          sizeof(harp_area_mask_cap));
+        if (new_cap == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (area_mask->num_polygons + AREA_MASK_BLOCK_SIZE) * sizeof(harp_area_mask_cap),
+                           __FILE__, __LINE__);
+            return -1;
+        }
+        area_mask->cap = new_cap;
     }
 
+    get_bounding_cap(polygon, &area_mask->cap[area_mask->num_polygons]);
     area_mask->polygon[area_mask->num_polygons] = polygon;
     area_mask->num_polygons++;
     return 0;
 }
 
-/* returns true (1) if at least one polygon of the mask covers the given point */
-int harp_area_mask_covers_point(const harp_area_mask *area_mask, const harp_spherical_point *point)
+typedef struct latitude_sort_key_struct
 {
-    long i;
+    double latitude;
+    long index;
+} latitude_sort_key;
 
-    for (i = 0; i < area_mask->num_polygons; i++)
+static int compare_latitude_sort_keys(const void *a, const void *b)
+{
+    const latitude_sort_key *key_a = (const latitude_sort_key *)a;
+    const latitude_sort_key *key_b = (const latitude_sort_key *)b;
+
+    if (key_a->latitude != key_b->latitude)
     {
-        if (harp_spherical_polygon_contains_point(area_mask->polygon[i], point))
-        {
-            return 1;
-        }
+        return key_a->latitude < key_b->latitude ? -1 : 1;
     }
 
-    return 0;
+    /* qsort() is not stable, so use the polygon index to keep the order deterministic */
+    return (key_a->index > key_b->index) - (key_a->index < key_b->index);
 }
 
-/* returns true (1) if at least one polygon of the mask covers the given polygon */
-int harp_area_mask_covers_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+/* (Re)build the spatial index for all polygons of the mask.
+ * Polygons with a small bounding cap are sorted by latitude of the cap centre, so a query only needs to look at the
+ * polygons within a latitude band around the query point or area. Polygons that are added after the index has been
+ * built are still found (using a linear search) until the index is updated again.
+ */
+int harp_area_mask_update_index(harp_area_mask *area_mask)
 {
+    long *narrow = NULL;
+    long *wide = NULL;
+    long num_narrow = 0;
+    long num_wide = 0;
+    double max_narrow_radius = 0;
     long i;
 
+    if (area_mask->num_polygons > 0)
+    {
+        narrow = (long *)malloc(area_mask->num_polygons * sizeof(long));
+        if (narrow == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           area_mask->num_polygons * sizeof(long), __FILE__, __LINE__);
+            return -1;
+        }
+        wide = (long *)malloc(area_mask->num_polygons * sizeof(long));
+        if (wide == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           area_mask->num_polygons * sizeof(long), __FILE__, __LINE__);
+            free(narrow);
+            return -1;
+        }
+    }
+
     for (i = 0; i < area_mask->num_polygons; i++)
     {
-        if (harp_spherical_polygon_spherical_polygon_relationship(area_mask->polygon[i], area, 0)
-            == HARP_GEOMETRY_POLY_CONTAINS)
+        if (area_mask->cap[i].radius <= AREA_MASK_MAX_NARROW_RADIUS)
         {
-            return 1;
+            narrow[num_narrow] = i;
+            num_narrow++;
+            if (area_mask->cap[i].radius > max_narrow_radius)
+            {
+                max_narrow_radius = area_mask->cap[i].radius;
+            }
+        }
+        else
+        {
+            wide[num_wide] = i;
+            num_wide++;
+        }
+    }
+    if (num_narrow > 1)
+    {
+        latitude_sort_key *key;
+
+        key = (latitude_sort_key *)malloc(num_narrow * sizeof(latitude_sort_key));
+        if (key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_narrow * sizeof(latitude_sort_key), __FILE__, __LINE__);
+            free(wide);
+            free(narrow);
+            return -1;
+        }
+        for (i = 0; i < num_narrow; i++)
+        {
+            key[i].latitude = area_mask->cap[narrow[i]].latitude;
+            key[i].index = narrow[i];
         }
+        qsort(key, num_narrow, sizeof(latitude_sort_key), compare_latitude_sort_keys);
+        for (i = 0; i < num_narrow; i++)
+        {
+            narrow[i] = key[i].index;
+        }
+        free(key);
+    }
+
+    if (area_mask->narrow != NULL)
+    {
+        free(area_mask->narrow);
+    }
+    if (area_mask->wide != NULL)
+    {
+        free(area_mask->wide);
     }
+    area_mask->narrow = narrow;
+    area_mask->num_narrow = num_narrow;
+    area_mask->max_narrow_radius = max_narrow_radius;
+    area_mask->wide = wide;
+    area_mask->num_wide = num_wide;
+    area_mask->num_indexed = area_mask->num_polygons;
 
     return 0;
 }
 
+static int test_contains_point(const harp_spherical_polygon *mask_polygon, const polygon_test *test)
+{
+    return harp_spherical_polygon_contains_point(mask_polygon, test->point);
+}
+
+/* returns true (1) if at least one polygon of the mask covers the given point */
+int harp_area_mask_covers_point(const harp_area_mask *area_mask, const harp_spherical_point *point)
+{
+    harp_area_mask_cap cap;
+    polygon_test test;
+
+    get_point_cap(point, &cap);
+    test.test = test_contains_point;
+    test.point = point;
+
+    return find_polygon(area_mask, &cap, &test);
+}
+
+static int test_contains_area(const harp_spherical_polygon *mask_polygon, const polygon_test *test)
+{
+    return harp_spherical_polygon_spherical_polygon_relationship(mask_polygon, test->area, 0) ==
+        HARP_GEOMETRY_POLY_CONTAINS;
+}
+
+/* returns true (1) if at least one polygon of the mask covers the given polygon */
+int harp_area_mask_covers_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+{
+    harp_area_mask_cap cap;
+    polygon_test test;
+
+    /* a polygon of the mask can only contain the area if it contains the first vertex of the area */
+    get_point_cap(&area->point[0], &cap);
+    test.test = test_contains_area;
+    test.area = area;
+
+    return find_polygon(area_mask, &cap, &test);
+}
+
+static int test_inside_area(const harp_spherical_polygon *mask_polygon, const polygon_test *test)
+{
+    return harp_spherical_polygon_spherical_polygon_relationship(mask_polygon, test->area, 0) ==
+        HARP_GEOMETRY_POLY_CONTAINED;
+}
+
 /* returns true (1) if at least one polygon of the mask falls inside the given polygon */
 int harp_area_mask_inside_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
 {
-    long i;
+    harp_area_mask_cap cap;
+    polygon_test test;
 
-    for (i = 0; i < area_mask->num_polygons; i++)
+    get_bounding_cap(area, &cap);
+    test.test = test_inside_area;
+    test.area = area;
+
+    return find_polygon(area_mask, &cap, &test);
+}
+
+static int test_intersects_area(const harp_spherical_polygon *mask_polygon, const polygon_test *test)
+{
+    int has_overlap;
+
+    if (harp_spherical_polygon_overlapping(mask_polygon, test->area, &has_overlap) != 0)
     {
-        if (harp_spherical_polygon_spherical_polygon_relationship(area_mask->polygon[i], area, 0)
-            == HARP_GEOMETRY_POLY_CONTAINED)
-        {
-            return 1;
-        }
+        return 0;
     }
 
-    return 0;
+    return has_overlap;
 }
 
 /* returns true (1) if at least one polygon of the mask intersects the given polygon */
 int harp_area_mask_intersects_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
 {
-    long i;
+    harp_area_mask_cap cap;
+    polygon_test test;
 
-    for (i = 0; i < area_mask->num_polygons; i++)
-    {
-        int has_overlap;
+    get_bounding_cap(area, &cap);
+    test.test = test_intersects_area;
+    test.area = area;
 
-        if (harp_spherical_polygon_overlapping(area_mask->polygon[i], area, &has_overlap) != 0)
-        {
-            continue;
-        }
-        if (has_overlap)
-        {
-            return 1;
-        }
+    return find_polygon(area_mask, &cap, &test);
+}
+
+static int test_intersects_area_with_fraction(const harp_spherical_polygon *mask_polygon, const polygon_test *test)
+{
+    int has_overlap;
+    double fraction;
+
+    if (harp_spherical_polygon_overlapping_fraction(mask_polygon, test->area, &has_overlap, &fraction) != 0)
+    {
+        return 0;
     }
 
-    return 0;
+    return has_overlap && fraction >= test->min_fraction;
 }
 
 /* returns true (1) if at least one polygon of the mask intersects the given polygon for at least the given fraction */
 int harp_area_mask_intersects_area_with_fraction(const harp_area_mask *area_mask, const harp_spherical_polygon *area,
                                                  double min_fraction)
 {
-    long i;
-
-    for (i = 0; i < area_mask->num_polygons; i++)
-    {
-        int has_overlap;
-        double fraction;
-
-        if (harp_spherical_polygon_overlapping_fraction(area_mask->polygon[i], area, &has_overlap, &fraction) != 0)
-        {
-            continue;
-        }
+    harp_area_mask_cap cap;
+    polygon_test test;
 
-        if (has_overlap && fraction >= min_fraction)
-        {
-            return 1;
-        }
-    }
+    get_bounding_cap(area, &cap);
+    test.test = test_intersects_area_with_fraction;
+    test.area = area;
+    test.min_fraction = min_fraction;
 
-    return 0;
+    return find_polygon(area_mask, &cap, &test);
 }
 
 static int is_blank_line(const char *str)
@@ -398,6 +717,12 @@ static int read_area_mask(FILE *stream, harp_area_mask **new_area_mask)
         return -1;
     }
 
+    if (harp_area_mask_update_index(area_mask) != 0)
+    {
+        harp_area_mask_delete(area_mask);
+        return -1;
+    }
+
     *new_area_mask = area_mask;
     return 0;
 }
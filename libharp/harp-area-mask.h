@@ -34,15 +34,33 @@
 
 #include "harp-geometry.h"
 
+/* Spherical cap (all points within 'radius' [rad] of 'centre') that encloses a polygon */
+typedef struct harp_area_mask_cap_struct
+{
+    harp_vector3d centre;       /* unit vector */
+    double latitude;    /* latitude of the centre [rad] */
+    double radius;      /* angular radius [rad]; M_PI if the polygon has no usable bounding cap */
+} harp_area_mask_cap;
+
 typedef struct harp_area_mask_struct
 {
     long num_polygons;
     harp_spherical_polygon **polygon;
+    harp_area_mask_cap *cap;    /* bounding cap for each polygon */
+
+    /* Spatial index (see harp_area_mask_update_index()); covers the first 'num_indexed' polygons */
+    long num_indexed;
+    long num_narrow;
+    long *narrow;       /* polygons with a small bounding cap, sorted by latitude of the cap centre */
+    double max_narrow_radius;   /* largest bounding cap radius of the polygons in 'narrow' */
+    long num_wide;
+    long *wide; /* polygons with a large bounding cap */
 } harp_area_mask;
 
 int harp_area_mask_new(harp_area_mask **new_area_mask);
 void harp_area_mask_delete(harp_area_mask *area_mask);
 int harp_area_mask_add_polygon(harp_area_mask *area_mask, harp_spherical_polygon *polygon);
+int harp_area_mask_update_index(harp_area_mask *area_mask);
 
 int harp_area_mask_covers_point(const harp_area_mask *area_mask, const harp_spherical_point *point);
 int harp_area_mask_covers_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area);
@@ -0,0 +1,1472 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+#include "harp-thread.h"
+#include "hashtable.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A product is exported as an Arrow IPC file (also known as Feather version 2) with one column per variable; each
+ * time sample is a row. Variables with additional dimensions become (nested) fixed size list columns. Datetime
+ * variables (i.e. floating point variables with a '<unit> since <epoch>' unit) are stored as UTC timestamps with
+ * microsecond resolution (NaN values become nulls) and string variables are dictionary encoded. The HARP attributes
+ * are stored as custom metadata of the schema and of each field.
+ * The rows are split into record batches (see harp_set_option_arrow_batch_size()). The record batches are encoded in
+ * parallel and are written to the file one after another, such that only a limited number of encoded record batches
+ * are kept in memory.
+ */
+
+#define ARROW_METADATA_VERSION_V5 4
+
+#define ARROW_MESSAGE_HEADER_SCHEMA 1
+#define ARROW_MESSAGE_HEADER_DICTIONARY_BATCH 2
+#define ARROW_MESSAGE_HEADER_RECORD_BATCH 3
+
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_TIMESTAMP 10
+#define ARROW_TYPE_FIXED_SIZE_LIST 16
+
+#define ARROW_PRECISION_SINGLE 1
+#define ARROW_PRECISION_DOUBLE 2
+
+#define ARROW_TIME_UNIT_MICROSECOND 2
+
+#define ARROW_BUFFER_ALIGNMENT 8
+
+/* maximum number of fields of the flatbuffer tables that are written */
+#define FB_MAX_FIELDS 8
+
+typedef enum arrow_type_enum
+{
+    arrow_type_int8,
+    arrow_type_int16,
+    arrow_type_int32,
+    arrow_type_float,
+    arrow_type_double,
+    arrow_type_timestamp,
+    arrow_type_dictionary
+} arrow_type;
+
+/* Builder for flatbuffers, the serialization format of the Arrow metadata.
+ * As with the reference implementation, a flatbuffer is built back to front: the content occupies the last 'size'
+ * bytes of 'data' and objects are referred to by their offset from the end of the buffer. Nested objects must be
+ * created before the object that refers to them.
+ * To keep the construction of the (many small) objects readable, a failed allocation is recorded in 'error' and all
+ * later operations on the builder are ignored; the error is reported by fb_finish().
+ */
+typedef struct fb_builder_struct
+{
+    uint8_t *data;
+    long capacity;
+    long size;
+    long min_align;
+    long object_start;
+    long slot[FB_MAX_FIELDS];
+    int num_slots;
+    int error;
+} fb_builder;
+
+typedef struct arrow_column_struct
+{
+    const harp_variable *variable;
+    arrow_type type;
+    int num_list_dimensions;    /* number of dimensions after the time dimension */
+    long num_values_per_row;
+    int64_t *timestamp; /* datetime values in microseconds since 1970-01-01 (only for timestamp columns) */
+    long dictionary_id; /* only for dictionary columns */
+    long num_dictionary_values;
+    int32_t *dictionary_index;  /* index into the dictionary of each element of the variable */
+    const char **dictionary_value;
+} arrow_column;
+
+/* location of an encapsulated message in the file */
+typedef struct arrow_block_struct
+{
+    int64_t offset;
+    int32_t metadata_length;
+    int64_t body_length;
+} arrow_block;
+
+/* an encoded record batch */
+typedef struct arrow_batch_struct
+{
+    const arrow_column *column;
+    int num_columns;
+    long first_row;
+    long num_rows;
+    uint8_t *message;
+    long message_length;
+    uint8_t *body;
+    long body_length;
+} arrow_batch;
+
+static void put_uint16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void put_uint32(uint8_t *buffer, uint32_t value)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        buffer[i] = (uint8_t)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static void put_uint64(uint8_t *buffer, uint64_t value)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        buffer[i] = (uint8_t)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static long round_up(long size, long alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static void fb_init(fb_builder *builder)
+{
+    builder->data = NULL;
+    builder->capacity = 0;
+    builder->size = 0;
+    builder->min_align = 1;
+    builder->object_start = 0;
+    builder->num_slots = 0;
+    builder->error = 0;
+}
+
+static void fb_done(fb_builder *builder)
+{
+    if (builder->data != NULL)
+    {
+        free(builder->data);
+    }
+    fb_init(builder);
+}
+
+/* Make sure there is room for 'num_bytes' more bytes in front of the current content */
+static int fb_reserve(fb_builder *builder, long num_bytes)
+{
+    uint8_t *data;
+    long capacity;
+
+    if (builder->error)
+    {
+        return -1;
+    }
+    if (builder->size + num_bytes <= builder->capacity)
+    {
+        return 0;
+    }
+
+    capacity = builder->capacity > 0 ? builder->capacity : 1024;
+    while (capacity < builder->size + num_bytes)
+    {
+        capacity *= 2;
+    }
+    data = malloc(capacity);
+    if (data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)capacity, __FILE__, __LINE__);
+        builder->error = 1;
+        return -1;
+    }
+    if (builder->size > 0)
+    {
+        memcpy(&data[capacity - builder->size], &builder->data[builder->capacity - builder->size], builder->size);
+    }
+    if (builder->data != NULL)
+    {
+        free(builder->data);
+    }
+    builder->data = data;
+    builder->capacity = capacity;
+
+    return 0;
+}
+
+static void fb_push(fb_builder *builder, const void *bytes, long num_bytes)
+{
+    if (fb_reserve(builder, num_bytes) != 0)
+    {
+        return;
+    }
+    builder->size += num_bytes;
+    if (bytes != NULL)
+    {
+        memcpy(&builder->data[builder->capacity - builder->size], bytes, num_bytes);
+    }
+    else
+    {
+        memset(&builder->data[builder->capacity - builder->size], 0, num_bytes);
+    }
+}
+
+/* Add padding such that the content will be aligned to 'alignment' bytes after 'num_bytes' more bytes are pushed */
+static void fb_prep(fb_builder *builder, long alignment, long num_bytes)
+{
+    long padding;
+
+    if (alignment > builder->min_align)
+    {
+        builder->min_align = alignment;
+    }
+    padding = (alignment - (builder->size + num_bytes) % alignment) % alignment;
+    if (padding > 0)
+    {
+        fb_push(builder, NULL, padding);
+    }
+}
+
+static void fb_push_uint16(fb_builder *builder, uint16_t value)
+{
+    uint8_t buffer[2];
+
+    put_uint16(buffer, value);
+    fb_prep(builder, 2, 0);
+    fb_push(builder, buffer, 2);
+}
+
+static void fb_push_uint32(fb_builder *builder, uint32_t value)
+{
+    uint8_t buffer[4];
+
+    put_uint32(buffer, value);
+    fb_prep(builder, 4, 0);
+    fb_push(builder, buffer, 4);
+}
+
+/* Push a reference to the object at offset 'target' */
+static void fb_push_offset(fb_builder *builder, long target)
+{
+    fb_prep(builder, 4, 0);
+    fb_push_uint32(builder, (uint32_t)(builder->size + 4 - target));
+}
+
+static long fb_create_string(fb_builder *builder, const char *str)
+{
+    long length = (long)strlen(str);
+
+    fb_prep(builder, 4, length + 1);
+    fb_push(builder, NULL, 1);
+    fb_push(builder, str, length);
+    fb_push_uint32(builder, (uint32_t)length);
+
+    return builder->size;
+}
+
+static long fb_create_offset_vector(fb_builder *builder, long num_elements, const long *element)
+{
+    long i;
+
+    fb_prep(builder, 4, 4 * num_elements);
+    for (i = num_elements - 1; i >= 0; i--)
+    {
+        fb_push_offset(builder, element[i]);
+    }
+    fb_push_uint32(builder, (uint32_t)num_elements);
+
+    return builder->size;
+}
+
+/* Create a vector of structs; 'element' contains the serialized structs (in order) */
+static long fb_create_struct_vector(fb_builder *builder, long num_elements, long element_size, long alignment,
+                                    const uint8_t *element)
+{
+    fb_prep(builder, 4, num_elements * element_size);
+    fb_prep(builder, alignment, num_elements * element_size);
+    if (num_elements > 0)
+    {
+        fb_push(builder, element, num_elements * element_size);
+    }
+    fb_push_uint32(builder, (uint32_t)num_elements);
+
+    return builder->size;
+}
+
+static void fb_start_table(fb_builder *builder)
+{
+    int i;
+
+    builder->object_start = builder->size;
+    for (i = 0; i < FB_MAX_FIELDS; i++)
+    {
+        builder->slot[i] = 0;
+    }
+    builder->num_slots = 0;
+}
+
+static void fb_set_slot(fb_builder *builder, int id)
+{
+    assert(id < FB_MAX_FIELDS);
+    builder->slot[id] = builder->size;
+    if (id >= builder->num_slots)
+    {
+        builder->num_slots = id + 1;
+    }
+}
+
+static void fb_add_uint8(fb_builder *builder, int id, uint8_t value)
+{
+    fb_push(builder, &value, 1);
+    fb_set_slot(builder, id);
+}
+
+static void fb_add_int16(fb_builder *builder, int id, int16_t value)
+{
+    fb_push_uint16(builder, (uint16_t)value);
+    fb_set_slot(builder, id);
+}
+
+static void fb_add_int32(fb_builder *builder, int id, int32_t value)
+{
+    fb_push_uint32(builder, (uint32_t)value);
+    fb_set_slot(builder, id);
+}
+
+static void fb_add_int64(fb_builder *builder, int id, int64_t value)
+{
+    uint8_t buffer[8];
+
+    put_uint64(buffer, (uint64_t)value);
+    fb_prep(builder, 8, 0);
+    fb_push(builder, buffer, 8);
+    fb_set_slot(builder, id);
+}
+
+static void fb_add_offset(fb_builder *builder, int id, long target)
+{
+    fb_push_offset(builder, target);
+    fb_set_slot(builder, id);
+}
+
+static long fb_end_table(fb_builder *builder)
+{
+    long object_offset;
+    int i;
+
+    /* placeholder for the offset to the vtable */
+    fb_push_uint32(builder, 0);
+    object_offset = builder->size;
+
+    for (i = builder->num_slots - 1; i >= 0; i--)
+    {
+        fb_push_uint16(builder, (uint16_t)(builder->slot[i] != 0 ? object_offset - builder->slot[i] : 0));
+    }
+    fb_push_uint16(builder, (uint16_t)(object_offset - builder->object_start));
+    fb_push_uint16(builder, (uint16_t)((builder->num_slots + 2) * 2));
+
+    if (!builder->error)
+    {
+        put_uint32(&builder->data[builder->capacity - object_offset], (uint32_t)(builder->size - object_offset));
+    }
+
+    return object_offset;
+}
+
+/* Finish the buffer with the given root table; the result is stored in data/length (owned by the builder) */
+static int fb_finish(fb_builder *builder, long root, const uint8_t **data, long *length)
+{
+    fb_prep(builder, builder->min_align, 4);
+    fb_push_offset(builder, root);
+    if (builder->error)
+    {
+        return -1;
+    }
+    *data = &builder->data[builder->capacity - builder->size];
+    *length = builder->size;
+
+    return 0;
+}
+
+static long create_key_value(fb_builder *builder, const char *key, const char *value)
+{
+    long key_offset;
+    long value_offset;
+
+    key_offset = fb_create_string(builder, key);
+    value_offset = fb_create_string(builder, value);
+    fb_start_table(builder);
+    fb_add_offset(builder, 0, key_offset);
+    fb_add_offset(builder, 1, value_offset);
+
+    return fb_end_table(builder);
+}
+
+static long create_int_type(fb_builder *builder, int bit_width)
+{
+    fb_start_table(builder);
+    fb_add_int32(builder, 0, bit_width);
+    fb_add_uint8(builder, 1, 1);
+
+    return fb_end_table(builder);
+}
+
+/* Create the field of a column; level is the (list) dimension of the variable that the field represents */
+static long create_field(fb_builder *builder, const arrow_column *column, int level)
+{
+    const harp_variable *variable = column->variable;
+    long metadata[4];
+    long dictionary = 0;
+    long children;
+    long name;
+    long type;
+    int num_metadata = 0;
+    int type_type;
+
+    if (level < column->num_list_dimensions)
+    {
+        long child = create_field(builder, column, level + 1);
+
+        children = fb_create_offset_vector(builder, 1, &child);
+        fb_start_table(builder);
+        fb_add_int32(builder, 0, (int32_t)variable->dimension[level + 1]);
+        type = fb_end_table(builder);
+        type_type = ARROW_TYPE_FIXED_SIZE_LIST;
+    }
+    else
+    {
+        children = fb_create_offset_vector(builder, 0, NULL);
+        switch (column->type)
+        {
+            case arrow_type_int8:
+            case arrow_type_int16:
+            case arrow_type_int32:
+                type = create_int_type(builder, column->type == arrow_type_int8 ? 8 :
+                                       column->type == arrow_type_int16 ? 16 : 32);
+                type_type = ARROW_TYPE_INT;
+                break;
+            case arrow_type_float:
+            case arrow_type_double:
+                fb_start_table(builder);
+                fb_add_int16(builder, 0, column->type == arrow_type_float ? ARROW_PRECISION_SINGLE :
+                             ARROW_PRECISION_DOUBLE);
+                type = fb_end_table(builder);
+                type_type = ARROW_TYPE_FLOATING_POINT;
+                break;
+            case arrow_type_timestamp:
+                {
+                    long timezone = fb_create_string(builder, "UTC");
+
+                    fb_start_table(builder);
+                    fb_add_offset(builder, 1, timezone);
+                    fb_add_int16(builder, 0, ARROW_TIME_UNIT_MICROSECOND);
+                    type = fb_end_table(builder);
+                    type_type = ARROW_TYPE_TIMESTAMP;
+                }
+                break;
+            case arrow_type_dictionary:
+                {
+                    long index_type = create_int_type(builder, 32);
+
+                    fb_start_table(builder);
+                    fb_add_int64(builder, 0, column->dictionary_id);
+                    fb_add_offset(builder, 1, index_type);
+                    fb_add_uint8(builder, 2, 0);
+                    dictionary = fb_end_table(builder);
+                }
+                fb_start_table(builder);
+                type = fb_end_table(builder);
+                type_type = ARROW_TYPE_UTF8;
+                break;
+            default:
+                assert(0);
+                exit(1);
+        }
+    }
+
+    if (level == 0)
+    {
+        char dimensions[HARP_MAX_NUM_DIMS * 32];
+        long metadata_vector;
+        int i;
+
+        dimensions[0] = '\0';
+        for (i = 0; i < variable->num_dimensions; i++)
+        {
+            if (i > 0)
+            {
+                strcat(dimensions, ",");
+            }
+            if (variable->dimension_type[i] == harp_dimension_independent)
+            {
+                sprintf(&dimensions[strlen(dimensions)], "independent_%ld", variable->dimension[i]);
+            }
+            else
+            {
+                strcat(dimensions, harp_get_dimension_type_name(variable->dimension_type[i]));
+            }
+        }
+        metadata[num_metadata++] = create_key_value(builder, "dimensions", dimensions);
+        if (variable->description != NULL && strcmp(variable->description, "") != 0)
+        {
+            metadata[num_metadata++] = create_key_value(builder, "description", variable->description);
+        }
+        /* timestamps have a fixed unit */
+        if (variable->unit != NULL && column->type != arrow_type_timestamp)
+        {
+            metadata[num_metadata++] = create_key_value(builder, "units", variable->unit);
+        }
+        if (variable->num_enum_values > 0 && variable->data_type == harp_type_int8)
+        {
+            char *flag_meanings;
+
+            if (harp_variable_get_flag_meanings_string(variable, &flag_meanings) != 0)
+            {
+                builder->error = 1;
+                return 0;
+            }
+            metadata[num_metadata++] = create_key_value(builder, "flag_meanings", flag_meanings);
+            free(flag_meanings);
+        }
+        metadata_vector = fb_create_offset_vector(builder, num_metadata, metadata);
+        name = fb_create_string(builder, variable->name);
+        fb_start_table(builder);
+        fb_add_offset(builder, 6, metadata_vector);
+    }
+    else
+    {
+        name = fb_create_string(builder, "item");
+        fb_start_table(builder);
+    }
+    fb_add_offset(builder, 0, name);
+    fb_add_offset(builder, 3, type);
+    if (dictionary != 0)
+    {
+        fb_add_offset(builder, 4, dictionary);
+    }
+    fb_add_offset(builder, 5, children);
+    fb_add_uint8(builder, 1, column->type == arrow_type_timestamp && level == column->num_list_dimensions);
+    fb_add_uint8(builder, 2, (uint8_t)type_type);
+
+    return fb_end_table(builder);
+}
+
+static long create_schema(fb_builder *builder, const harp_product *product, int num_columns,
+                          const arrow_column *column)
+{
+    long metadata[3];
+    long metadata_vector;
+    long *field;
+    long fields;
+    int num_metadata = 0;
+    int i;
+
+    field = malloc((num_columns + 1) * sizeof(long));
+    if (field == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (num_columns + 1) * sizeof(long), __FILE__, __LINE__);
+        builder->error = 1;
+        return 0;
+    }
+    for (i = 0; i < num_columns; i++)
+    {
+        field[i] = create_field(builder, &column[i], 0);
+    }
+    fields = fb_create_offset_vector(builder, num_columns, field);
+    free(field);
+
+    metadata[num_metadata++] = create_key_value(builder, "Conventions", HARP_CONVENTION);
+    if (product->source_product != NULL && strcmp(product->source_product, "") != 0)
+    {
+        metadata[num_metadata++] = create_key_value(builder, "source_product", product->source_product);
+    }
+    if (product->history != NULL && strcmp(product->history, "") != 0)
+    {
+        metadata[num_metadata++] = create_key_value(builder, "history", product->history);
+    }
+    metadata_vector = fb_create_offset_vector(builder, num_metadata, metadata);
+
+    fb_start_table(builder);
+    fb_add_offset(builder, 1, fields);
+    fb_add_offset(builder, 2, metadata_vector);
+#ifdef WORDS_BIGENDIAN
+    fb_add_int16(builder, 0, 1);
+#else
+    fb_add_int16(builder, 0, 0);
+#endif
+
+    return fb_end_table(builder);
+}
+
+/* Create a RecordBatch table from the field nodes (length, null count) and buffers (offset, length) */
+static long create_record_batch(fb_builder *builder, long num_rows, long num_nodes, const int64_t *node,
+                                long num_buffers, const int64_t *buffer)
+{
+    uint8_t *element;
+    long nodes;
+    long buffers;
+    long i;
+
+    element = malloc(((num_nodes > num_buffers ? num_nodes : num_buffers) + 1) * 16);
+    if (element == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)((num_nodes > num_buffers ? num_nodes : num_buffers) + 1) * 16, __FILE__,
+                       __LINE__);
+        builder->error = 1;
+        return 0;
+    }
+    for (i = 0; i < 2 * num_nodes; i++)
+    {
+        put_uint64(&element[i * 8], (uint64_t)node[i]);
+    }
+    nodes = fb_create_struct_vector(builder, num_nodes, 16, 8, element);
+    for (i = 0; i < 2 * num_buffers; i++)
+    {
+        put_uint64(&element[i * 8], (uint64_t)buffer[i]);
+    }
+    buffers = fb_create_struct_vector(builder, num_buffers, 16, 8, element);
+    free(element);
+
+    fb_start_table(builder);
+    fb_add_int64(builder, 0, num_rows);
+    fb_add_offset(builder, 1, nodes);
+    fb_add_offset(builder, 2, buffers);
+
+    return fb_end_table(builder);
+}
+
+/* Finish a Message with the given header; the result is owned by the builder */
+static int finish_message(fb_builder *builder, int header_type, long header, long body_length, const uint8_t **data,
+                          long *length)
+{
+    long message;
+
+    fb_start_table(builder);
+    fb_add_int64(builder, 3, body_length);
+    fb_add_offset(builder, 2, header);
+    fb_add_int16(builder, 0, ARROW_METADATA_VERSION_V5);
+    fb_add_uint8(builder, 1, (uint8_t)header_type);
+    message = fb_end_table(builder);
+
+    return fb_finish(builder, message, data, length);
+}
+
+static int write_bytes(FILE *f, const char *filename, const void *data, long length, int64_t *offset)
+{
+    if (length > 0 && fwrite(data, 1, length, f) != (size_t)length)
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "could not write to %s (%s)", filename, strerror(errno));
+        return -1;
+    }
+    *offset += length;
+
+    return 0;
+}
+
+/* Write an encapsulated message (continuation marker, metadata length, metadata, padding, body) */
+static int write_message(FILE *f, const char *filename, const uint8_t *message, long message_length,
+                         const uint8_t *body, long body_length, int64_t *offset, arrow_block *block)
+{
+    static const uint8_t padding[ARROW_BUFFER_ALIGNMENT] = { 0 };
+    uint8_t prefix[8];
+    long padded_length = round_up(message_length, ARROW_BUFFER_ALIGNMENT);
+
+    if (block != NULL)
+    {
+        block->offset = *offset;
+        block->metadata_length = (int32_t)(8 + padded_length);
+        block->body_length = body_length;
+    }
+    put_uint32(prefix, 0xFFFFFFFF);
+    put_uint32(&prefix[4], (uint32_t)padded_length);
+    if (write_bytes(f, filename, prefix, 8, offset) != 0)
+    {
+        return -1;
+    }
+    if (write_bytes(f, filename, message, message_length, offset) != 0)
+    {
+        return -1;
+    }
+    if (write_bytes(f, filename, padding, padded_length - message_length, offset) != 0)
+    {
+        return -1;
+    }
+
+    return write_bytes(f, filename, body, body_length, offset);
+}
+
+static int encode_batch(void *arg)
+{
+    arrow_batch *batch = (arrow_batch *)arg;
+    int64_t *node;
+    int64_t *buffer;
+    long num_nodes = 0;
+    long num_buffers = 0;
+    long max_num_nodes = 0;
+    long body_length = 0;
+    const uint8_t *message;
+    fb_builder builder;
+    long record_batch;
+    int i;
+
+    for (i = 0; i < batch->num_columns; i++)
+    {
+        max_num_nodes += batch->column[i].num_list_dimensions + 1;
+    }
+    /* each list level has a validity buffer and each leaf has a validity and a data buffer */
+    node = malloc((2 * max_num_nodes + 1) * sizeof(int64_t));
+    buffer = malloc((2 * (max_num_nodes + batch->num_columns) + 1) * sizeof(int64_t));
+    if (node == NULL || buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (2 * (max_num_nodes + batch->num_columns) + 1) * sizeof(int64_t), __FILE__, __LINE__);
+        if (node != NULL)
+        {
+            free(node);
+        }
+        return -1;
+    }
+
+    /* determine the layout of the body */
+    for (i = 0; i < batch->num_columns; i++)
+    {
+        const arrow_column *column = &batch->column[i];
+        long length = batch->num_rows;
+        long element_size;
+        int j;
+
+        for (j = 0; j < column->num_list_dimensions; j++)
+        {
+            node[2 * num_nodes] = length;
+            node[2 * num_nodes + 1] = 0;
+            num_nodes++;
+            buffer[2 * num_buffers] = body_length;
+            buffer[2 * num_buffers + 1] = 0;
+            num_buffers++;
+            length *= column->variable->dimension[j + 1];
+        }
+        node[2 * num_nodes] = length;
+        node[2 * num_nodes + 1] = 0;
+        buffer[2 * num_buffers] = body_length;
+        buffer[2 * num_buffers + 1] = 0;
+        if (column->type == arrow_type_timestamp)
+        {
+            const int64_t *timestamp = &column->timestamp[batch->first_row * column->num_values_per_row];
+            long null_count = 0;
+            long k;
+
+            for (k = 0; k < length; k++)
+            {
+                null_count += timestamp[k] == INT64_MIN;
+            }
+            if (null_count > 0)
+            {
+                node[2 * num_nodes + 1] = null_count;
+                buffer[2 * num_buffers + 1] = (length + 7) / 8;
+                body_length += round_up((length + 7) / 8, ARROW_BUFFER_ALIGNMENT);
+            }
+            element_size = 8;
+        }
+        else if (column->type == arrow_type_dictionary)
+        {
+            element_size = 4;
+        }
+        else
+        {
+            element_size = harp_get_size_for_type(column->variable->data_type);
+        }
+        num_nodes++;
+        num_buffers++;
+        buffer[2 * num_buffers] = body_length;
+        buffer[2 * num_buffers + 1] = length * element_size;
+        num_buffers++;
+        body_length += round_up(length * element_size, ARROW_BUFFER_ALIGNMENT);
+    }
+
+    batch->body_length = body_length;
+    batch->body = calloc(body_length > 0 ? body_length : 1, 1);
+    if (batch->body == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)body_length, __FILE__, __LINE__);
+        free(buffer);
+        free(node);
+        return -1;
+    }
+
+    /* fill the body (using the buffer layout from above, skipping the validity buffers of the list levels) */
+    num_buffers = 0;
+    for (i = 0; i < batch->num_columns; i++)
+    {
+        const arrow_column *column = &batch->column[i];
+        long first_element = batch->first_row * column->num_values_per_row;
+        long num_elements = batch->num_rows * column->num_values_per_row;
+        int64_t *validity = &buffer[2 * (num_buffers + column->num_list_dimensions)];
+        int64_t *values = &buffer[2 * (num_buffers + column->num_list_dimensions + 1)];
+        uint8_t *data = &batch->body[values[0]];
+        long k;
+
+        switch (column->type)
+        {
+            case arrow_type_timestamp:
+                if (validity[1] > 0)
+                {
+                    uint8_t *bitmap = &batch->body[validity[0]];
+
+                    for (k = 0; k < num_elements; k++)
+                    {
+                        if (column->timestamp[first_element + k] != INT64_MIN)
+                        {
+                            bitmap[k / 8] |= (uint8_t)(1 << (k % 8));
+                        }
+                    }
+                }
+                for (k = 0; k < num_elements; k++)
+                {
+                    int64_t value = column->timestamp[first_element + k];
+
+                    ((int64_t *)data)[k] = value == INT64_MIN ? 0 : value;
+                }
+                break;
+            case arrow_type_dictionary:
+                memcpy(data, &column->dictionary_index[first_element], num_elements * sizeof(int32_t));
+                break;
+            default:
+                memcpy(data, &column->variable->data.int8_data[first_element *
+                                                               harp_get_size_for_type(column->variable->data_type)],
+                       values[1]);
+                break;
+        }
+        num_buffers += column->num_list_dimensions + 2;
+    }
+
+    fb_init(&builder);
+    record_batch = create_record_batch(&builder, batch->num_rows, num_nodes, node, num_buffers, buffer);
+    free(buffer);
+    free(node);
+    if (finish_message(&builder, ARROW_MESSAGE_HEADER_RECORD_BATCH, record_batch, body_length, &message,
+                       &batch->message_length) != 0)
+    {
+        fb_done(&builder);
+        return -1;
+    }
+    batch->message = malloc(batch->message_length);
+    if (batch->message == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)batch->message_length, __FILE__, __LINE__);
+        fb_done(&builder);
+        return -1;
+    }
+    memcpy(batch->message, message, batch->message_length);
+    fb_done(&builder);
+
+    return 0;
+}
+
+static int write_dictionary(FILE *f, const char *filename, const arrow_column *column, int64_t *offset,
+                            arrow_block *block)
+{
+    const uint8_t *message;
+    long message_length;
+    fb_builder builder;
+    int64_t node[2];
+    int64_t buffer[6];
+    uint8_t *body;
+    long data_length = 0;
+    long body_length;
+    long dictionary_batch;
+    long record_batch;
+    long i;
+
+    for (i = 0; i < column->num_dictionary_values; i++)
+    {
+        data_length += (long)strlen(column->dictionary_value[i]);
+        if (data_length > INT32_MAX)
+        {
+            harp_set_error(HARP_ERROR_EXPORT, "string data of variable '%s' is too large for Arrow export",
+                           column->variable->name);
+            return -1;
+        }
+    }
+
+    node[0] = column->num_dictionary_values;
+    node[1] = 0;
+    /* validity, offsets, and data buffers */
+    buffer[0] = 0;
+    buffer[1] = 0;
+    buffer[2] = 0;
+    buffer[3] = (column->num_dictionary_values + 1) * 4;
+    buffer[4] = round_up(buffer[3], ARROW_BUFFER_ALIGNMENT);
+    buffer[5] = data_length;
+    body_length = buffer[4] + round_up(data_length, ARROW_BUFFER_ALIGNMENT);
+
+    body = calloc(body_length, 1);
+    if (body == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)body_length, __FILE__, __LINE__);
+        return -1;
+    }
+    data_length = 0;
+    for (i = 0; i < column->num_dictionary_values; i++)
+    {
+        long length = (long)strlen(column->dictionary_value[i]);
+
+        ((int32_t *)body)[i] = (int32_t)data_length;
+        memcpy(&body[buffer[4] + data_length], column->dictionary_value[i], length);
+        data_length += length;
+    }
+    ((int32_t *)body)[column->num_dictionary_values] = (int32_t)data_length;
+
+    fb_init(&builder);
+    record_batch = create_record_batch(&builder, column->num_dictionary_values, 1, node, 3, buffer);
+    fb_start_table(&builder);
+    fb_add_int64(&builder, 0, column->dictionary_id);
+    fb_add_offset(&builder, 1, record_batch);
+    fb_add_uint8(&builder, 2, 0);
+    dictionary_batch = fb_end_table(&builder);
+    if (finish_message(&builder, ARROW_MESSAGE_HEADER_DICTIONARY_BATCH, dictionary_batch, body_length, &message,
+                       &message_length) != 0)
+    {
+        fb_done(&builder);
+        free(body);
+        return -1;
+    }
+    if (write_message(f, filename, message, message_length, body, body_length, offset, block) != 0)
+    {
+        fb_done(&builder);
+        free(body);
+        return -1;
+    }
+    fb_done(&builder);
+    free(body);
+
+    return 0;
+}
+
+static long create_block_vector(fb_builder *builder, long num_blocks, const arrow_block *block)
+{
+    uint8_t *element;
+    long vector;
+    long i;
+
+    element = calloc((num_blocks + 1) * 24, 1);
+    if (element == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)(num_blocks + 1) * 24, __FILE__, __LINE__);
+        builder->error = 1;
+        return 0;
+    }
+    for (i = 0; i < num_blocks; i++)
+    {
+        put_uint64(&element[i * 24], (uint64_t)block[i].offset);
+        put_uint32(&element[i * 24 + 8], (uint32_t)block[i].metadata_length);
+        put_uint64(&element[i * 24 + 16], (uint64_t)block[i].body_length);
+    }
+    vector = fb_create_struct_vector(builder, num_blocks, 24, 8, element);
+    free(element);
+
+    return vector;
+}
+
+static int write_footer(FILE *f, const char *filename, const harp_product *product, int num_columns,
+                        const arrow_column *column, long num_dictionaries, const arrow_block *dictionary_block,
+                        long num_batches, const arrow_block *batch_block, int64_t *offset)
+{
+    const uint8_t *footer_data;
+    long footer_length;
+    fb_builder builder;
+    long schema;
+    long dictionaries;
+    long record_batches;
+    long footer;
+    uint8_t buffer[4];
+
+    fb_init(&builder);
+    schema = create_schema(&builder, product, num_columns, column);
+    dictionaries = create_block_vector(&builder, num_dictionaries, dictionary_block);
+    record_batches = create_block_vector(&builder, num_batches, batch_block);
+    fb_start_table(&builder);
+    fb_add_offset(&builder, 1, schema);
+    fb_add_offset(&builder, 2, dictionaries);
+    fb_add_offset(&builder, 3, record_batches);
+    fb_add_int16(&builder, 0, ARROW_METADATA_VERSION_V5);
+    footer = fb_end_table(&builder);
+    if (fb_finish(&builder, footer, &footer_data, &footer_length) != 0)
+    {
+        fb_done(&builder);
+        return -1;
+    }
+    if (write_bytes(f, filename, footer_data, footer_length, offset) != 0)
+    {
+        fb_done(&builder);
+        return -1;
+    }
+    fb_done(&builder);
+
+    put_uint32(buffer, (uint32_t)footer_length);
+    if (write_bytes(f, filename, buffer, 4, offset) != 0)
+    {
+        return -1;
+    }
+
+    return write_bytes(f, filename, "ARROW1", 6, offset);
+}
+
+static void column_done(arrow_column *column)
+{
+    if (column->timestamp != NULL)
+    {
+        free(column->timestamp);
+    }
+    if (column->dictionary_index != NULL)
+    {
+        free(column->dictionary_index);
+    }
+    if (column->dictionary_value != NULL)
+    {
+        free(column->dictionary_value);
+    }
+}
+
+/* Returns whether the unit of the variable is a time reference (i.e. '<unit> since <epoch>') */
+static int is_datetime_variable(const harp_variable *variable)
+{
+    return (variable->data_type == harp_type_float || variable->data_type == harp_type_double) &&
+        variable->unit != NULL && strstr(variable->unit, " since ") != NULL;
+}
+
+static int column_init_timestamps(arrow_column *column)
+{
+    const harp_variable *variable = column->variable;
+    harp_unit_converter *unit_converter;
+    long i;
+
+    if (harp_unit_converter_new(variable->unit, "s since 1970-01-01", &unit_converter) != 0)
+    {
+        harp_add_error_message(" (variable '%s')", variable->name);
+        return -1;
+    }
+    column->timestamp = malloc((variable->num_elements + 1) * sizeof(int64_t));
+    if (column->timestamp == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (variable->num_elements + 1) * sizeof(int64_t), __FILE__, __LINE__);
+        harp_unit_converter_delete(unit_converter);
+        return -1;
+    }
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        double value;
+
+        value = variable->data_type == harp_type_float ? variable->data.float_data[i] : variable->data.double_data[i];
+        value = harp_unit_converter_convert(unit_converter, value);
+        /* INT64_MIN marks a null value */
+        column->timestamp[i] = (harp_isnan(value) || harp_isinf(value)) ? INT64_MIN :
+            (int64_t)floor(value * 1e6 + 0.5);
+    }
+    harp_unit_converter_delete(unit_converter);
+
+    return 0;
+}
+
+static int column_init_dictionary(arrow_column *column)
+{
+    const harp_variable *variable = column->variable;
+    hashtable *table;
+    long i;
+
+    if (variable->num_elements > INT32_MAX)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "variable '%s' has too many elements for Arrow export", variable->name);
+        return -1;
+    }
+    column->dictionary_index = malloc((variable->num_elements + 1) * sizeof(int32_t));
+    column->dictionary_value = malloc((variable->num_elements + 1) * sizeof(const char *));
+    if (column->dictionary_index == NULL || column->dictionary_value == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (variable->num_elements + 1) * sizeof(int32_t), __FILE__, __LINE__);
+        return -1;
+    }
+    table = hashtable_new(1);
+    if (table == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    column->num_dictionary_values = 0;
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        const char *str = variable->data.string_data[i] != NULL ? variable->data.string_data[i] : "";
+        long index;
+
+        index = hashtable_get_index_from_name(table, str);
+        if (index < 0)
+        {
+            if (hashtable_add_name(table, str) != 0)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not add to hashtable) (%s:%u)",
+                               __FILE__, __LINE__);
+                hashtable_delete(table);
+                return -1;
+            }
+            index = column->num_dictionary_values;
+            column->dictionary_value[column->num_dictionary_values++] = str;
+        }
+        column->dictionary_index[i] = (int32_t)index;
+    }
+    hashtable_delete(table);
+
+    return 0;
+}
+
+static int column_init(arrow_column *column, const harp_variable *variable, long dictionary_id)
+{
+    int i;
+
+    column->variable = variable;
+    column->num_list_dimensions = variable->num_dimensions - 1;
+    column->num_values_per_row = 1;
+    for (i = 1; i < variable->num_dimensions; i++)
+    {
+        column->num_values_per_row *= variable->dimension[i];
+    }
+    column->timestamp = NULL;
+    column->dictionary_id = dictionary_id;
+    column->num_dictionary_values = 0;
+    column->dictionary_index = NULL;
+    column->dictionary_value = NULL;
+
+    if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "variable '%s' does not depend on the time dimension (Arrow export "
+                       "requires all variables to have time as first dimension)", variable->name);
+        return -1;
+    }
+
+    switch (variable->data_type)
+    {
+        case harp_type_int8:
+            column->type = arrow_type_int8;
+            break;
+        case harp_type_int16:
+            column->type = arrow_type_int16;
+            break;
+        case harp_type_int32:
+            column->type = arrow_type_int32;
+            break;
+        case harp_type_float:
+            column->type = arrow_type_float;
+            break;
+        case harp_type_double:
+            column->type = arrow_type_double;
+            break;
+        case harp_type_string:
+            column->type = arrow_type_dictionary;
+            return column_init_dictionary(column);
+    }
+
+    if (is_datetime_variable(variable))
+    {
+        column->type = arrow_type_timestamp;
+        return column_init_timestamps(column);
+    }
+
+    return 0;
+}
+
+/* Encode the record batches in groups (one task per record batch) and write each group once it is encoded */
+static int write_record_batches(FILE *f, const char *filename, int num_columns, const arrow_column *column,
+                                long num_rows, long num_batches, long batch_size, int64_t *offset,
+                                arrow_block *block)
+{
+    arrow_batch *batch;
+    harp_task *task;
+    long first_batch = 0;
+    int max_num_tasks;
+    int i;
+
+    max_num_tasks = harp_get_num_tasks(num_batches, 1);
+    batch = malloc(max_num_tasks * sizeof(arrow_batch));
+    task = malloc(max_num_tasks * sizeof(harp_task));
+    if (batch == NULL || task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       max_num_tasks * sizeof(arrow_batch), __FILE__, __LINE__);
+        if (batch != NULL)
+        {
+            free(batch);
+        }
+        return -1;
+    }
+
+    while (first_batch < num_batches)
+    {
+        int num_tasks = num_batches - first_batch < max_num_tasks ? (int)(num_batches - first_batch) : max_num_tasks;
+        int result;
+
+        for (i = 0; i < num_tasks; i++)
+        {
+            batch[i].column = column;
+            batch[i].num_columns = num_columns;
+            batch[i].first_row = (first_batch + i) * batch_size;
+            batch[i].num_rows = batch[i].first_row + batch_size > num_rows ? num_rows - batch[i].first_row :
+                batch_size;
+            batch[i].message = NULL;
+            batch[i].body = NULL;
+            task[i].function = encode_batch;
+            task[i].arg = &batch[i];
+        }
+        result = harp_run_tasks(num_tasks, task);
+        for (i = 0; i < num_tasks; i++)
+        {
+            if (result == 0 && write_message(f, filename, batch[i].message, batch[i].message_length, batch[i].body,
+                                             batch[i].body_length, offset, &block[first_batch + i]) != 0)
+            {
+                result = -1;
+            }
+            if (batch[i].message != NULL)
+            {
+                free(batch[i].message);
+            }
+            if (batch[i].body != NULL)
+            {
+                free(batch[i].body);
+            }
+        }
+        if (result != 0)
+        {
+            free(task);
+            free(batch);
+            return -1;
+        }
+        first_batch += num_tasks;
+    }
+
+    free(task);
+    free(batch);
+
+    return 0;
+}
+
+static int write_product(FILE *f, const char *filename, const harp_product *product, int num_columns,
+                         const arrow_column *column)
+{
+    static const uint8_t eos[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0 };
+    arrow_block *dictionary_block;
+    arrow_block *batch_block;
+    const uint8_t *message;
+    long message_length;
+    fb_builder builder;
+    long num_dictionaries = 0;
+    long num_rows = product->dimension[harp_dimension_time];
+    long batch_size = harp_get_option_arrow_batch_size();
+    long num_batches;
+    int64_t offset = 0;
+    long schema;
+    int i;
+
+    if (num_columns == 0)
+    {
+        num_rows = 0;
+    }
+    if (batch_size == 0 || batch_size > num_rows)
+    {
+        batch_size = num_rows > 0 ? num_rows : 1;
+    }
+    num_batches = (num_rows + batch_size - 1) / batch_size;
+
+    if (write_bytes(f, filename, "ARROW1\0\0", 8, &offset) != 0)
+    {
+        return -1;
+    }
+
+    fb_init(&builder);
+    schema = create_schema(&builder, product, num_columns, column);
+    if (finish_message(&builder, ARROW_MESSAGE_HEADER_SCHEMA, schema, 0, &message, &message_length) != 0)
+    {
+        fb_done(&builder);
+        return -1;
+    }
+    if (write_message(f, filename, message, message_length, NULL, 0, &offset, NULL) != 0)
+    {
+        fb_done(&builder);
+        return -1;
+    }
+    fb_done(&builder);
+
+    dictionary_block = malloc((num_columns + 1) * sizeof(arrow_block));
+    batch_block = malloc((num_batches + 1) * sizeof(arrow_block));
+    if (dictionary_block == NULL || batch_block == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (num_batches + 1) * sizeof(arrow_block), __FILE__, __LINE__);
+        if (dictionary_block != NULL)
+        {
+            free(dictionary_block);
+        }
+        return -1;
+    }
+
+    for (i = 0; i < num_columns; i++)
+    {
+        if (column[i].type == arrow_type_dictionary)
+        {
+            if (write_dictionary(f, filename, &column[i], &offset, &dictionary_block[num_dictionaries]) != 0)
+            {
+                free(batch_block);
+                free(dictionary_block);
+                return -1;
+            }
+            num_dictionaries++;
+        }
+    }
+
+    if (write_record_batches(f, filename, num_columns, column, num_rows, num_batches, batch_size, &offset,
+                             batch_block) != 0)
+    {
+        free(batch_block);
+        free(dictionary_block);
+        return -1;
+    }
+
+    if (write_bytes(f, filename, eos, 8, &offset) != 0 ||
+        write_footer(f, filename, product, num_columns, column, num_dictionaries, dictionary_block, num_batches,
+                     batch_block, &offset) != 0)
+    {
+        free(batch_block);
+        free(dictionary_block);
+        return -1;
+    }
+
+    free(batch_block);
+    free(dictionary_block);
+
+    return 0;
+}
+
+int harp_export_arrow(const char *filename, const harp_product *product)
+{
+    arrow_column *column;
+    long num_dictionaries = 0;
+    FILE *f;
+    int i;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL");
+        return -1;
+    }
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL");
+        return -1;
+    }
+
+    column = malloc((product->num_variables + 1) * sizeof(arrow_column));
+    if (column == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (product->num_variables + 1) * sizeof(arrow_column), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < product->num_variables; i++)
+    {
+        if (column_init(&column[i], product->variable[i], num_dictionaries) != 0)
+        {
+            for (; i >= 0; i--)
+            {
+                column_done(&column[i]);
+            }
+            free(column);
+            return -1;
+        }
+        if (column[i].type == arrow_type_dictionary)
+        {
+            num_dictionaries++;
+        }
+    }
+
+    f = fopen(filename, "wb");
+    if (f == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create %s (%s)", filename, strerror(errno));
+        for (i = 0; i < product->num_variables; i++)
+        {
+            column_done(&column[i]);
+        }
+        free(column);
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_arrow);
+
+    if (write_product(f, filename, product, product->num_variables, column) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        fclose(f);
+        harp_io_statistics_add_close(harp_io_backend_arrow);
+        for (i = 0; i < product->num_variables; i++)
+        {
+            column_done(&column[i]);
+        }
+        free(column);
+        return -1;
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        column_done(&column[i]);
+    }
+    free(column);
+
+    harp_io_statistics_add_close(harp_io_backend_arrow);
+    if (fclose(f) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "could not close %s (%s)", filename, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
@@ -31,8 +31,11 @@
 
 #include "harp-internal.h"
 #include "harp-geometry.h"
+#include "harp-thread.h"
 
 #include <assert.h>
+#include <ctype.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -40,6 +43,19 @@
 
 #define MAX_NAME_LENGTH 128
 #define LATLON_BLOCK_SIZE 1024
+#define ACCUMULATOR_BLOCK_SIZE 16
+
+/* maximum deviation of an edge from its regular position, relative to the edge spacing, for a grid to be regular */
+#define REGULAR_GRID_TOLERANCE 1.0e-3
+
+/* minimum number of samples (footprints) per thread when computing cell overlaps using multiple threads */
+#define MIN_NUM_SAMPLES_PER_THREAD 64
+
+/* minimum number of summations per thread when summing up samples into grid cells using multiple threads */
+#define MIN_NUM_SUMMATIONS_PER_THREAD 65536
+
+/* minimum number of variable elements per thread when converting the variables of a product using multiple threads */
+#define MIN_NUM_ELEMENTS_PER_THREAD 65536
 
 typedef enum binning_type_enum
 {
@@ -55,6 +71,83 @@ typedef enum binning_type_enum
 } binning_type;
 
 
+/* If the 'keep_float' option is enabled, mark the variables that are of type float such that they can be converted back
+ * to float after the binning (which is performed in double precision). Sets *is_float to NULL if the option is
+ * disabled.
+ */
+static int get_float_variables(const harp_product *product, const binning_type *bintype, uint8_t **is_float)
+{
+    long k;
+
+    *is_float = NULL;
+    if (!harp_option_keep_float || product->num_variables == 0)
+    {
+        return 0;
+    }
+
+    *is_float = malloc(product->num_variables * sizeof(uint8_t));
+    if (*is_float == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        (*is_float)[k] = product->variable[k]->data_type == harp_type_float && bintype[k] != binning_skip &&
+            bintype[k] != binning_remove;
+    }
+
+    return 0;
+}
+
+/* shared data for restore_float_variables() */
+typedef struct restore_float_info_struct
+{
+    harp_product *product;
+    const binning_type *bintype;
+    const uint8_t *is_float;
+} restore_float_info;
+
+static int restore_float_variable(void *arg, long index)
+{
+    restore_float_info *info = (restore_float_info *)arg;
+
+    if (info->is_float[index] && info->bintype[index] != binning_remove &&
+        info->product->variable[index]->data_type == harp_type_double)
+    {
+        return harp_variable_convert_data_type(info->product->variable[index], harp_type_float);
+    }
+
+    return 0;
+}
+
+/* convert the binned variables that were marked by get_float_variables() back to float (in parallel) */
+static int restore_float_variables(harp_product *product, const binning_type *bintype, const uint8_t *is_float,
+                                   long num_variables)
+{
+    restore_float_info info;
+    long num_elements = 0;
+    long k;
+
+    if (is_float == NULL)
+    {
+        return 0;
+    }
+    for (k = 0; k < num_variables; k++)
+    {
+        if (is_float[k] && bintype[k] != binning_remove)
+        {
+            num_elements += product->variable[k]->num_elements;
+        }
+    }
+    info.product = product;
+    info.bintype = bintype;
+    info.is_float = is_float;
+
+    return harp_run_for_each(num_variables, num_elements, MIN_NUM_ELEMENTS_PER_THREAD, restore_float_variable, &info);
+}
+
 static binning_type get_binning_type(harp_variable *variable)
 {
     int i;
@@ -576,13 +669,20 @@ static int add_cell_index(long cell_index, long *cumsum_index, long **latlon_cel
     return 0;
 }
 
-/* latitude_edges and longitude_edges and should contain just 2 times (bounds of the cell) */
+/* latitude_edges and longitude_edges and should contain just 2 times (bounds of the cell)
+ * the polygon needs to be closed (i.e. the last point is equal to the first point) and the poly_*_min/max values
+ * should provide the bounding box of the polygon
+ */
 static double find_weight_for_polygon_and_cell(long num_points, double *poly_latitude, double *poly_longitude,
+                                               double poly_latitude_min, double poly_latitude_max,
+                                               double poly_longitude_min, double poly_longitude_max,
                                                double *temp_latitude, double *temp_longitude,
                                                double *latitude_edges, double *longitude_edges)
 {
     double latitude, longitude, next_latitude, next_longitude;
     double cell_area, poly_area;
+    double *latitude_vertex = poly_latitude;    /* points of the clamped polygon */
+    double *longitude_vertex = poly_longitude;
     long offset = num_points;
     long num_temp = 0;
     long i;
@@ -594,133 +694,149 @@ static double find_weight_for_polygon_and_cell(long num_points, double *poly_lat
 
     /* we start with filling temp_latitude and temp_longitude at offset 'num_points' */
     /* this allows us to use the same temp buffers in-place for the longitude clamping in the second step */
+    /* clamping to a range is skipped if the polygon already lies within that range (this gives the same polygon) */
 
     /* clamp to latitude range */
-    for (i = 0; i < num_points - 1; i++)
+    if (poly_latitude_min < latitude_edges[0] || poly_latitude_max > latitude_edges[1])
     {
-        latitude = poly_latitude[i];
-        longitude = poly_longitude[i];
-        next_latitude = poly_latitude[i + 1];
-        next_longitude = poly_longitude[i + 1];
-
-        if (latitude < latitude_edges[0])
-        {
-            if (next_latitude > latitude_edges[0])
-            {
-                longitude += (latitude_edges[0] - latitude) * (next_longitude - longitude) / (next_latitude - latitude);
-                latitude = latitude_edges[0];
-            }
-        }
-        else if (latitude > latitude_edges[1])
+        for (i = 0; i < num_points - 1; i++)
         {
-            if (next_latitude < latitude_edges[1])
+            latitude = poly_latitude[i];
+            longitude = poly_longitude[i];
+            next_latitude = poly_latitude[i + 1];
+            next_longitude = poly_longitude[i + 1];
+
+            if (latitude < latitude_edges[0])
             {
-                longitude += (latitude_edges[1] - latitude) * (next_longitude - longitude) / (next_latitude - latitude);
-                latitude = latitude_edges[1];
+                if (next_latitude > latitude_edges[0])
+                {
+                    longitude +=
+                        (latitude_edges[0] - latitude) * (next_longitude - longitude) / (next_latitude - latitude);
+                    latitude = latitude_edges[0];
+                }
             }
-        }
-        if (latitude >= latitude_edges[0] && latitude <= latitude_edges[1])
-        {
-            temp_latitude[offset + num_temp] = latitude;
-            temp_longitude[offset + num_temp] = longitude;
-            num_temp++;
-            if (next_latitude < latitude_edges[0])
+            else if (latitude > latitude_edges[1])
             {
-                temp_longitude[offset + num_temp] = longitude + (latitude_edges[0] - latitude) *
-                    (next_longitude - longitude) / (next_latitude - latitude);
-                temp_latitude[offset + num_temp] = latitude_edges[0];
-                num_temp++;
+                if (next_latitude < latitude_edges[1])
+                {
+                    longitude +=
+                        (latitude_edges[1] - latitude) * (next_longitude - longitude) / (next_latitude - latitude);
+                    latitude = latitude_edges[1];
+                }
             }
-            else if (next_latitude > latitude_edges[1])
+            if (latitude >= latitude_edges[0] && latitude <= latitude_edges[1])
             {
-                temp_longitude[offset + num_temp] = longitude + (latitude_edges[1] - latitude) *
-                    (next_longitude - longitude) / (next_latitude - latitude);
-                temp_latitude[offset + num_temp] = latitude_edges[1];
+                temp_latitude[offset + num_temp] = latitude;
+                temp_longitude[offset + num_temp] = longitude;
                 num_temp++;
+                if (next_latitude < latitude_edges[0])
+                {
+                    temp_longitude[offset + num_temp] = longitude + (latitude_edges[0] - latitude) *
+                        (next_longitude - longitude) / (next_latitude - latitude);
+                    temp_latitude[offset + num_temp] = latitude_edges[0];
+                    num_temp++;
+                }
+                else if (next_latitude > latitude_edges[1])
+                {
+                    temp_longitude[offset + num_temp] = longitude + (latitude_edges[1] - latitude) *
+                        (next_longitude - longitude) / (next_latitude - latitude);
+                    temp_latitude[offset + num_temp] = latitude_edges[1];
+                    num_temp++;
+                }
             }
         }
-    }
 
-    if (num_temp < 3)
-    {
-        return 0.0;
-    }
+        if (num_temp < 3)
+        {
+            return 0.0;
+        }
 
-    if (temp_latitude[offset] != temp_latitude[offset + num_temp - 1] ||
-        temp_longitude[offset] != temp_longitude[offset + num_temp - 1])
-    {
-        temp_latitude[offset + num_temp] = temp_latitude[offset];
-        temp_longitude[offset + num_temp] = temp_longitude[offset];
-        num_temp++;
+        if (temp_latitude[offset] != temp_latitude[offset + num_temp - 1] ||
+            temp_longitude[offset] != temp_longitude[offset + num_temp - 1])
+        {
+            temp_latitude[offset + num_temp] = temp_latitude[offset];
+            temp_longitude[offset + num_temp] = temp_longitude[offset];
+            num_temp++;
+        }
+
+        latitude_vertex = &temp_latitude[offset];
+        longitude_vertex = &temp_longitude[offset];
+        num_points = num_temp;
     }
 
-    /* clamp to longitude range */
-    num_points = num_temp;
-    num_temp = 0;
-    for (i = 0; i < num_points - 1; i++)
+    /* clamp to longitude range (clamping to the latitude range will not have extended the longitude range) */
+    if (poly_longitude_min < longitude_edges[0] || poly_longitude_max > longitude_edges[1])
     {
-        latitude = temp_latitude[offset + i];
-        longitude = temp_longitude[offset + i];
-        next_latitude = temp_latitude[offset + i + 1];
-        next_longitude = temp_longitude[offset + i + 1];
-
-        if (longitude < longitude_edges[0])
-        {
-            if (next_longitude > longitude_edges[0])
-            {
-                latitude +=
-                    (longitude_edges[0] - longitude) * (next_latitude - latitude) / (next_longitude - longitude);
-                longitude = longitude_edges[0];
-            }
-        }
-        else if (longitude > longitude_edges[1])
+        num_temp = 0;
+        for (i = 0; i < num_points - 1; i++)
         {
-            if (next_longitude < longitude_edges[1])
+            latitude = latitude_vertex[i];
+            longitude = longitude_vertex[i];
+            next_latitude = latitude_vertex[i + 1];
+            next_longitude = longitude_vertex[i + 1];
+
+            if (longitude < longitude_edges[0])
             {
-                latitude +=
-                    (longitude_edges[1] - longitude) * (next_latitude - latitude) / (next_longitude - longitude);
-                longitude = longitude_edges[1];
+                if (next_longitude > longitude_edges[0])
+                {
+                    latitude +=
+                        (longitude_edges[0] - longitude) * (next_latitude - latitude) / (next_longitude - longitude);
+                    longitude = longitude_edges[0];
+                }
             }
-        }
-        if (longitude >= longitude_edges[0] && longitude <= longitude_edges[1])
-        {
-            temp_latitude[num_temp] = latitude;
-            temp_longitude[num_temp] = longitude;
-            num_temp++;
-            if (next_longitude < longitude_edges[0])
+            else if (longitude > longitude_edges[1])
             {
-                temp_latitude[num_temp] = latitude + (longitude_edges[0] - longitude) *
-                    (next_latitude - latitude) / (next_longitude - longitude);
-                temp_longitude[num_temp] = longitude_edges[0];
-                num_temp++;
+                if (next_longitude < longitude_edges[1])
+                {
+                    latitude +=
+                        (longitude_edges[1] - longitude) * (next_latitude - latitude) / (next_longitude - longitude);
+                    longitude = longitude_edges[1];
+                }
             }
-            else if (next_longitude > longitude_edges[1])
+            if (longitude >= longitude_edges[0] && longitude <= longitude_edges[1])
             {
-                temp_latitude[num_temp] = latitude + (longitude_edges[1] - longitude) *
-                    (next_latitude - latitude) / (next_longitude - longitude);
-                temp_longitude[num_temp] = longitude_edges[1];
+                temp_latitude[num_temp] = latitude;
+                temp_longitude[num_temp] = longitude;
                 num_temp++;
+                if (next_longitude < longitude_edges[0])
+                {
+                    temp_latitude[num_temp] = latitude + (longitude_edges[0] - longitude) *
+                        (next_latitude - latitude) / (next_longitude - longitude);
+                    temp_longitude[num_temp] = longitude_edges[0];
+                    num_temp++;
+                }
+                else if (next_longitude > longitude_edges[1])
+                {
+                    temp_latitude[num_temp] = latitude + (longitude_edges[1] - longitude) *
+                        (next_latitude - latitude) / (next_longitude - longitude);
+                    temp_longitude[num_temp] = longitude_edges[1];
+                    num_temp++;
+                }
             }
         }
-    }
 
-    if (num_temp < 3)
-    {
-        return 0.0;
-    }
+        if (num_temp < 3)
+        {
+            return 0.0;
+        }
 
-    if (temp_latitude[0] != temp_latitude[num_temp - 1] || temp_longitude[0] != temp_longitude[num_temp - 1])
-    {
-        temp_latitude[num_temp] = temp_latitude[0];
-        temp_longitude[num_temp] = temp_longitude[0];
-        num_temp++;
+        if (temp_latitude[0] != temp_latitude[num_temp - 1] || temp_longitude[0] != temp_longitude[num_temp - 1])
+        {
+            temp_latitude[num_temp] = temp_latitude[0];
+            temp_longitude[num_temp] = temp_longitude[0];
+            num_temp++;
+        }
+
+        latitude_vertex = temp_latitude;
+        longitude_vertex = temp_longitude;
+        num_points = num_temp;
     }
 
     /* calculate polygon area */
     poly_area = 0;
-    for (i = 0; i < num_temp - 1; i++)
+    for (i = 0; i < num_points - 1; i++)
     {
-        poly_area += (temp_longitude[i] + temp_longitude[i + 1]) * (temp_latitude[i] - temp_latitude[i + 1]);
+        poly_area += (longitude_vertex[i] + longitude_vertex[i + 1]) * (latitude_vertex[i] - latitude_vertex[i + 1]);
     }
     poly_area /= 2.0;
     if (poly_area < 0)
@@ -732,11 +848,29 @@ static double find_weight_for_polygon_and_cell(long num_points, double *poly_lat
     return poly_area / cell_area;
 }
 
-static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bounds, harp_variable *longitude_bounds,
-                                                      long num_latitude_edges, double *latitude_edges,
-                                                      long num_longitude_edges, double *longitude_edges,
-                                                      long *num_latlon_index, long **latlon_cell_index,
-                                                      double **latlon_weight)
+/* Determine matching cells and weights for the samples [first_element, first_element + num_elements) */
+/* returns the grid index as used by find_matching_cells_and_weights_for_bounds_range() for the cell that contains the
+ * value (-1 if the value lies below the grid, num_edges - 1 if it lies above or on the last edge) */
+static long find_cell_index_for_edges(long num_edges, const double *edges, double value)
+{
+    long index = -1;
+
+    harp_interpolate_find_index(num_edges, edges, value, &index);
+    if (index == num_edges)
+    {
+        index = num_edges - 1;
+    }
+
+    return index;
+}
+
+static int find_matching_cells_and_weights_for_bounds_range(harp_variable *latitude_bounds,
+                                                            harp_variable *longitude_bounds, long num_latitude_edges,
+                                                            double *latitude_edges, long num_longitude_edges,
+                                                            double *longitude_edges, long first_element,
+                                                            long num_elements, long *num_latlon_index,
+                                                            long *num_latlon_cells, long **latlon_cell_index,
+                                                            double **latlon_weight)
 {
     double *temp_poly_latitude = NULL;
     double *temp_poly_longitude = NULL;
@@ -747,11 +881,9 @@ static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bo
     long *min_lat_id = NULL, *max_lat_id = NULL;        /* min/max grid latitude index for each longitude grid row */
     long *min_lon_id = NULL, *max_lon_id = NULL;        /* min/max grid longitude index for each latitude grid row */
     long cumsum_index = 0;
-    long num_elements;
     long max_num_vertices;
     long i, j, k;
 
-    num_elements = latitude_bounds->dimension[0];
     max_num_vertices = latitude_bounds->dimension[latitude_bounds->num_dimensions - 1];
 
     /* add 1 point to allow closing the polygon (i.e. repeat first point at the end) */
@@ -816,9 +948,11 @@ static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bo
         goto error;
     }
 
-    for (i = 0; i < num_elements; i++)
+    for (i = first_element; i < first_element + num_elements; i++)
     {
         double lat_min, lat_max, lon_min, lon_max;
+        double vertex_lat_min, vertex_lat_max, vertex_lon_min, vertex_lon_max;
+        long first_lat_id, last_lat_id, first_lon_id, last_lon_id;
         long num_vertices = max_num_vertices;
         int loop;
 
@@ -887,12 +1021,41 @@ static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bo
                 continue;
             }
 
-            for (j = 0; j < num_longitude_cells + 2; j++)
+            /* all cells that the polygon crosses lie within the grid index range of its vertices, so only that part
+             * of the min/max arrays needs to be initialized and scanned (which keeps the cost per polygon independent
+             * of the size of the grid) */
+            vertex_lat_min = vertex_lat_max = poly_latitude[0];
+            vertex_lon_min = vertex_lon_max = poly_longitude[0];
+            for (k = 1; k < num_vertices; k++)
+            {
+                if (poly_latitude[k] < vertex_lat_min)
+                {
+                    vertex_lat_min = poly_latitude[k];
+                }
+                else if (poly_latitude[k] > vertex_lat_max)
+                {
+                    vertex_lat_max = poly_latitude[k];
+                }
+                if (poly_longitude[k] < vertex_lon_min)
+                {
+                    vertex_lon_min = poly_longitude[k];
+                }
+                else if (poly_longitude[k] > vertex_lon_max)
+                {
+                    vertex_lon_max = poly_longitude[k];
+                }
+            }
+            first_lat_id = find_cell_index_for_edges(num_latitude_edges, latitude_edges, vertex_lat_min);
+            last_lat_id = find_cell_index_for_edges(num_latitude_edges, latitude_edges, vertex_lat_max);
+            first_lon_id = find_cell_index_for_edges(num_longitude_edges, longitude_edges, vertex_lon_min);
+            last_lon_id = find_cell_index_for_edges(num_longitude_edges, longitude_edges, vertex_lon_max);
+
+            for (j = first_lon_id + 1; j <= last_lon_id + 1; j++)
             {
                 min_lat_id[j] = num_latitude_cells;
                 max_lat_id[j] = -1;
             }
-            for (j = 0; j < num_latitude_cells + 2; j++)
+            for (j = first_lat_id + 1; j <= last_lat_id + 1; j++)
             {
                 min_lon_id[j] = num_longitude_cells;
                 max_lon_id[j] = -1;
@@ -1077,13 +1240,14 @@ static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bo
                 lat_id = (*latlon_cell_index)[j] / num_longitude_cells;
                 lon_id = (*latlon_cell_index)[j] - lat_id * num_longitude_cells;
                 (*latlon_weight)[j] = find_weight_for_polygon_and_cell(num_vertices, poly_latitude, poly_longitude,
+                                                                       lat_min, lat_max, lon_min, lon_max,
                                                                        temp_poly_latitude, temp_poly_longitude,
                                                                        &latitude_edges[lat_id],
                                                                        &longitude_edges[lon_id]);
             }
 
             /* add all grid cells that lie fully within the polygon */
-            for (j = 0; j < num_latitude_cells; j++)
+            for (j = (first_lat_id > 0 ? first_lat_id : 0); j <= last_lat_id && j < num_latitude_cells; j++)
             {
                 if (min_lon_id[j + 1] < max_lon_id[j + 1])
                 {
@@ -1115,6 +1279,8 @@ static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bo
     free(min_lon_id);
     free(max_lon_id);
 
+    *num_latlon_cells = cumsum_index;
+
     return 0;
 
   error:
@@ -1154,6 +1320,212 @@ static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bo
     return -1;
 }
 
+typedef struct bounds_task_struct
+{
+    harp_variable *latitude_bounds;
+    harp_variable *longitude_bounds;
+    long num_latitude_edges;
+    double *latitude_edges;
+    long num_longitude_edges;
+    double *longitude_edges;
+    long first_element;
+    long num_elements;
+    long *num_latlon_index;
+    long num_latlon_cells;
+    long *latlon_cell_index;
+    double *latlon_weight;
+} bounds_task;
+
+static int bounds_task_run(void *arg)
+{
+    bounds_task *task = (bounds_task *)arg;
+
+    return find_matching_cells_and_weights_for_bounds_range(task->latitude_bounds, task->longitude_bounds,
+                                                            task->num_latitude_edges, task->latitude_edges,
+                                                            task->num_longitude_edges, task->longitude_edges,
+                                                            task->first_element, task->num_elements,
+                                                            task->num_latlon_index, &task->num_latlon_cells,
+                                                            &task->latlon_cell_index, &task->latlon_weight);
+}
+
+/* The samples are divided into consecutive blocks that are processed in parallel (see harp_set_option_num_threads()).
+ * The cells of each block are concatenated in block order, so the result does not depend on the number of threads.
+ */
+static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bounds, harp_variable *longitude_bounds,
+                                                      long num_latitude_edges, double *latitude_edges,
+                                                      long num_longitude_edges, double *longitude_edges,
+                                                      long *num_latlon_index, long **latlon_cell_index,
+                                                      double **latlon_weight)
+{
+    harp_task *task;
+    bounds_task *bounds;
+    long num_elements;
+    long num_latlon_cells = 0;
+    int num_tasks;
+    int result;
+    int i;
+
+    num_elements = latitude_bounds->dimension[0];
+    num_tasks = harp_get_num_tasks(num_elements, MIN_NUM_SAMPLES_PER_THREAD);
+    if (num_tasks == 1)
+    {
+        return find_matching_cells_and_weights_for_bounds_range(latitude_bounds, longitude_bounds, num_latitude_edges,
+                                                                latitude_edges, num_longitude_edges, longitude_edges,
+                                                                0, num_elements, num_latlon_index, &num_latlon_cells,
+                                                                latlon_cell_index, latlon_weight);
+    }
+
+    bounds = malloc(num_tasks * sizeof(bounds_task));
+    if (bounds == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(bounds_task), __FILE__, __LINE__);
+        return -1;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        free(bounds);
+        return -1;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        bounds[i].latitude_bounds = latitude_bounds;
+        bounds[i].longitude_bounds = longitude_bounds;
+        bounds[i].num_latitude_edges = num_latitude_edges;
+        bounds[i].latitude_edges = latitude_edges;
+        bounds[i].num_longitude_edges = num_longitude_edges;
+        bounds[i].longitude_edges = longitude_edges;
+        bounds[i].first_element = (num_elements * i) / num_tasks;
+        bounds[i].num_elements = (num_elements * (i + 1)) / num_tasks - bounds[i].first_element;
+        bounds[i].num_latlon_index = num_latlon_index;
+        bounds[i].num_latlon_cells = 0;
+        bounds[i].latlon_cell_index = NULL;
+        bounds[i].latlon_weight = NULL;
+        task[i].function = bounds_task_run;
+        task[i].arg = &bounds[i];
+    }
+
+    result = harp_run_tasks(num_tasks, task);
+
+    if (result == 0)
+    {
+        for (i = 0; i < num_tasks; i++)
+        {
+            num_latlon_cells += bounds[i].num_latlon_cells;
+        }
+        if (num_latlon_cells > 0)
+        {
+            *latlon_cell_index = malloc(num_latlon_cells * sizeof(long));
+            if (*latlon_cell_index == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_latlon_cells * sizeof(long), __FILE__, __LINE__);
+                result = -1;
+            }
+        }
+        if (result == 0 && num_latlon_cells > 0)
+        {
+            *latlon_weight = malloc(num_latlon_cells * sizeof(double));
+            if (*latlon_weight == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_latlon_cells * sizeof(double), __FILE__, __LINE__);
+                result = -1;
+            }
+        }
+        if (result == 0)
+        {
+            num_latlon_cells = 0;
+            for (i = 0; i < num_tasks; i++)
+            {
+                if (bounds[i].num_latlon_cells > 0)
+                {
+                    memcpy(&(*latlon_cell_index)[num_latlon_cells], bounds[i].latlon_cell_index,
+                           bounds[i].num_latlon_cells * sizeof(long));
+                    memcpy(&(*latlon_weight)[num_latlon_cells], bounds[i].latlon_weight,
+                           bounds[i].num_latlon_cells * sizeof(double));
+                    num_latlon_cells += bounds[i].num_latlon_cells;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < num_tasks; i++)
+    {
+        if (bounds[i].latlon_cell_index != NULL)
+        {
+            free(bounds[i].latlon_cell_index);
+        }
+        if (bounds[i].latlon_weight != NULL)
+        {
+            free(bounds[i].latlon_weight);
+        }
+    }
+    free(task);
+    free(bounds);
+
+    return result;
+}
+
+/* Returns 1 if the (strictly ascending) edges are equidistant, in which case 'inverse_step' is set to the inverse of
+ * the edge spacing. Returns 0 otherwise.
+ */
+static int get_regular_grid_inverse_step(long num_edges, const double *edges, double *inverse_step)
+{
+    double step;
+    long i;
+
+    step = (edges[num_edges - 1] - edges[0]) / (num_edges - 1);
+    for (i = 1; i < num_edges - 1; i++)
+    {
+        if (fabs(edges[i] - (edges[0] + i * step)) > REGULAR_GRID_TOLERANCE * step)
+        {
+            return 0;
+        }
+    }
+    *inverse_step = 1.0 / step;
+
+    return 1;
+}
+
+/* Equivalent of harp_interpolate_find_index() for a regular grid (see get_regular_grid_inverse_step()).
+ * The index is computed directly from the edge spacing and then corrected against the actual edge values, such that
+ * the result is identical to that of the search: -1 if value < edges[0] (or NaN), num_edges - 1 if
+ * value >= edges[num_edges - 1], and otherwise the index i for which edges[i] <= value < edges[i + 1].
+ */
+static long find_regular_grid_index(long num_edges, const double *edges, double inverse_step, double value)
+{
+    double offset;
+    long index;
+
+    offset = (value - edges[0]) * inverse_step;
+    if (!(offset >= 0))
+    {
+        return -1;
+    }
+    if (offset >= num_edges - 1)
+    {
+        index = num_edges - 1;
+    }
+    else
+    {
+        index = (long)offset;
+    }
+    while (index > 0 && value < edges[index])
+    {
+        index--;
+    }
+    while (index < num_edges - 1 && value >= edges[index + 1])
+    {
+        index++;
+    }
+
+    return index;
+}
+
 static int find_matching_cells_for_points(harp_variable *latitude, harp_variable *longitude, long num_latitude_edges,
                                           double *latitude_edges, long num_longitude_edges, double *longitude_edges,
                                           long *num_latlon_index, long **latlon_cell_index)
@@ -1162,21 +1534,51 @@ static int find_matching_cells_for_points(harp_variable *latitude, harp_variable
     long longitude_index = -1;
     long cumsum_index = 0;
     long num_elements;
+    double latitude_inverse_step = 0;
+    double longitude_inverse_step = 0;
+    int regular_latitude;
+    int regular_longitude;
     long i;
 
+    regular_latitude = get_regular_grid_inverse_step(num_latitude_edges, latitude_edges, &latitude_inverse_step);
+    regular_longitude = get_regular_grid_inverse_step(num_longitude_edges, longitude_edges, &longitude_inverse_step);
+
     num_elements = latitude->dimension[0];
     for (i = 0; i < num_elements; i++)
     {
         double wrapped_longitude;
 
-        harp_interpolate_find_index(num_latitude_edges, latitude_edges, latitude->data.double_data[i], &latitude_index);
+        if (harp_isnan(latitude->data.double_data[i]) || harp_isnan(longitude->data.double_data[i]))
+        {
+            /* don't let the search continue from the index of a previous point */
+            num_latlon_index[i] = 0;
+            continue;
+        }
+        if (regular_latitude)
+        {
+            latitude_index = find_regular_grid_index(num_latitude_edges, latitude_edges, latitude_inverse_step,
+                                                     latitude->data.double_data[i]);
+        }
+        else
+        {
+            harp_interpolate_find_index(num_latitude_edges, latitude_edges, latitude->data.double_data[i],
+                                        &latitude_index);
+        }
         if (latitude_index < 0 || latitude_index >= num_latitude_edges - 1)
         {
             num_latlon_index[i] = 0;
             continue;
         }
         wrapped_longitude = harp_wrap(longitude->data.double_data[i], longitude_edges[0], longitude_edges[0] + 360);
-        harp_interpolate_find_index(num_longitude_edges, longitude_edges, wrapped_longitude, &longitude_index);
+        if (regular_longitude)
+        {
+            longitude_index = find_regular_grid_index(num_longitude_edges, longitude_edges, longitude_inverse_step,
+                                                      wrapped_longitude);
+        }
+        else
+        {
+            harp_interpolate_find_index(num_longitude_edges, longitude_edges, wrapped_longitude, &longitude_index);
+        }
         if (longitude_index < 0 || longitude_index >= num_longitude_edges - 1)
         {
             num_latlon_index[i] = 0;
@@ -1203,849 +1605,1567 @@ static int find_matching_cells_for_points(harp_variable *latitude, harp_variable
     return 0;
 }
 
-/** \addtogroup harp_product
- * @{
+typedef struct sum_task_struct
+{
+    harp_variable *variable;
+    harp_variable *new_variable;
+    binning_type type;
+    int area_binning;
+    long num_time_elements;
+    long *time_bin_index;
+    long spatial_block_length;
+    long *num_latlon_index;
+    long *latlon_cell_index;
+    double *latlon_weight;
+    int32_t *filtered_count;
+    double *filtered_weight;
+    long first_target_index;
+    long num_target_index;
+    int store_count_variable;
+} sum_task;
+
+/* Sum up all samples that contribute to the target cells [first_target_index, first_target_index + num_target_index)
+ * (where the target index is the flat [time,latitude,longitude] index into the binned variable).
  */
+static int sum_task_run(void *arg)
+{
+    sum_task *task = (sum_task *)arg;
+    harp_variable *variable = task->variable;
+    harp_variable *new_variable = task->new_variable;
+    binning_type type = task->type;
+    int area_binning = task->area_binning;
+    long num_time_elements = task->num_time_elements;
+    long *time_bin_index = task->time_bin_index;
+    long spatial_block_length = task->spatial_block_length;
+    long *num_latlon_index = task->num_latlon_index;
+    long *latlon_cell_index = task->latlon_cell_index;
+    double *latlon_weight = task->latlon_weight;
+    int32_t *filtered_count = task->filtered_count;
+    double *filtered_weight = task->filtered_weight;
+    long num_sub_elements = variable->num_elements / num_time_elements;
+    long cumsum_index = 0;
+    long i, j, l;
 
-/** Bin the product's variables.
- * This will bin all variables in the time dimension. Each time sample will be put in the bin defined by bin_index.
- * All variables with a time dimension will then be resampled using these bins.
- * The resulting value for each variable will be the average of all values for the bin (using existing count variables
- * as weighting factors where available).
- * Variables with multiple dimensions will have all elements in the sub dimensions averaged on an element by element
- * basis.
- *
- * Variables that have a time dimension but no unit (or using a string data type) will be removed.
- *
- * All variables that are binned (except existing 'count' variables) are converted to a double data type.
- * Bins that have no samples will end up with a NaN value.
- *
- * If the product did not already have a 'count' variable then a 'count' variable will be added to the product that
- * will contain the number of samples per bin.
- *
- * Only non-NaN values will contribute to a bin. If there are NaN values then a separate variable-specific count
- * variable will be created that will contain the number of non-NaN values that contributed to each bin. This
- * count variable will have the same dimensions as the variable it provides the count for.
- *
- * \param product Product to regrid.
- * \param num_bins Number of target bins.
- * \param num_elements Length of bin_index array (should equal the length of the time dimension)
- * \param bin_index Array of target bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
- *
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
+    task->store_count_variable = 0;
+    for (i = 0; i < num_time_elements; i++)
+    {
+        long index_offset = time_bin_index[i] * spatial_block_length;
+
+        for (l = 0; l < num_latlon_index[i]; l++)
+        {
+            long target_index = index_offset + latlon_cell_index[cumsum_index];
+
+            if (target_index < task->first_target_index ||
+                target_index >= task->first_target_index + task->num_target_index)
+            {
+                /* cell is handled by another task */
+                cumsum_index++;
+                continue;
+            }
+
+            if (area_binning)
+            {
+                double weight = latlon_weight[cumsum_index];
+
+                assert(variable->data_type == harp_type_double);
+                if (type == binning_angle)
+                {
+                    /* for angle variables we use one filtered_weight element per complex pair */
+                    for (j = 0; j < num_sub_elements; j += 2)
+                    {
+                        if (!harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
+                        {
+                            filtered_weight[(target_index * num_sub_elements + j) / 2] += weight;
+                            new_variable->data.double_data[target_index * num_sub_elements + j] +=
+                                weight * variable->data.double_data[i * num_sub_elements + j];
+                            new_variable->data.double_data[target_index * num_sub_elements + j + 1] +=
+                                weight * variable->data.double_data[i * num_sub_elements + j + 1];
+                        }
+                    }
+                }
+                else
+                {
+                    for (j = 0; j < num_sub_elements; j++)
+                    {
+                        if (!harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
+                        {
+                            filtered_weight[target_index * num_sub_elements + j] += weight;
+                            new_variable->data.double_data[target_index * num_sub_elements + j] +=
+                                weight * variable->data.double_data[i * num_sub_elements + j];
+                        }
+                    }
+                }
+            }
+            else
+            {
+                if (type == binning_angle)
+                {
+                    /* for angle variables we use one filtered_count element per complex pair */
+                    for (j = 0; j < num_sub_elements; j += 2)
+                    {
+                        if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
+                        {
+                            filtered_count[(i * num_sub_elements + j) / 2] = 0;
+                            task->store_count_variable = 1;
+                        }
+                        else
+                        {
+                            new_variable->data.double_data[target_index * num_sub_elements + j] +=
+                                variable->data.double_data[i * num_sub_elements + j];
+                            new_variable->data.double_data[target_index * num_sub_elements + j + 1] +=
+                                variable->data.double_data[i * num_sub_elements + j + 1];
+                        }
+                    }
+                }
+                else if (variable->data_type == harp_type_int32)
+                {
+                    for (j = 0; j < num_sub_elements; j++)
+                    {
+                        new_variable->data.int32_data[target_index * num_sub_elements + j] +=
+                            variable->data.int32_data[i * num_sub_elements + j];
+                    }
+                }
+                else
+                {
+                    for (j = 0; j < num_sub_elements; j++)
+                    {
+                        if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
+                        {
+                            filtered_count[i * num_sub_elements + j] = 0;
+                            task->store_count_variable = 1;
+                        }
+                        else
+                        {
+                            new_variable->data.double_data[target_index * num_sub_elements + j] +=
+                                variable->data.double_data[i * num_sub_elements + j];
+                        }
+                    }
+                }
+            }
+            cumsum_index++;
+        }
+    }
+
+    return 0;
+}
+
+/* Sum up all samples into the spatial bins of new_variable.
+ * The cells are divided into consecutive blocks that are processed in parallel (see harp_set_option_num_threads()).
+ * Each cell is only updated by a single thread (and in sample order), so the result does not depend on the number of
+ * threads.
  */
-LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_elements, long *bin_index)
+static int sum_samples_into_cells(harp_variable *variable, harp_variable *new_variable, binning_type type,
+                                  int area_binning, long num_time_bins, long num_time_elements, long *time_bin_index,
+                                  long spatial_block_length, long *num_latlon_index, long *latlon_cell_index,
+                                  double *latlon_weight, int32_t *filtered_count, double *filtered_weight,
+                                  int *store_count_variable)
 {
-    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
-    binning_type *bintype = NULL;
-    long filtered_count_size = 0;
-    int32_t *filtered_count = NULL;
-    int32_t *count = NULL;
-    long *index = NULL;
-    long i, j, k;
+    harp_task *task;
+    sum_task *sum;
+    long num_target_index = num_time_bins * spatial_block_length;
+    long num_latlon_cells = 0;
+    int num_tasks;
+    int i;
 
-    if (num_elements != product->dimension[harp_dimension_time])
+    for (i = 0; i < num_time_elements; i++)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_elements (%ld) does not match time dimension length (%ld) "
-                       "(%s:%u)", num_elements, product->dimension[harp_dimension_time], __FILE__, __LINE__);
+        num_latlon_cells += num_latlon_index[i];
+    }
+    num_tasks = harp_get_num_tasks(num_latlon_cells * (variable->num_elements / num_time_elements),
+                                      MIN_NUM_SUMMATIONS_PER_THREAD);
+
+    sum = malloc(num_tasks * sizeof(sum_task));
+    if (sum == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(sum_task), __FILE__, __LINE__);
+        return -1;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        free(sum);
+        return -1;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        sum[i].variable = variable;
+        sum[i].new_variable = new_variable;
+        sum[i].type = type;
+        sum[i].area_binning = area_binning;
+        sum[i].num_time_elements = num_time_elements;
+        sum[i].time_bin_index = time_bin_index;
+        sum[i].spatial_block_length = spatial_block_length;
+        sum[i].num_latlon_index = num_latlon_index;
+        sum[i].latlon_cell_index = latlon_cell_index;
+        sum[i].latlon_weight = latlon_weight;
+        sum[i].filtered_count = filtered_count;
+        sum[i].filtered_weight = filtered_weight;
+        sum[i].first_target_index = (num_target_index * i) / num_tasks;
+        sum[i].num_target_index = (num_target_index * (i + 1)) / num_tasks - sum[i].first_target_index;
+        task[i].function = sum_task_run;
+        task[i].arg = &sum[i];
+    }
+
+    if (harp_run_tasks(num_tasks, task) != 0)
+    {
+        free(task);
+        free(sum);
         return -1;
     }
 
-    for (i = 0; i < num_elements; i++)
+    for (i = 0; i < num_tasks; i++)
     {
-        if (bin_index[i] < 0 || bin_index[i] >= num_bins)
+        if (sum[i].store_count_variable)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "bin_index[%ld] (%ld) should be in the range [0..%ld) (%s:%u)",
-                           i, bin_index[i], num_bins, __FILE__, __LINE__);
-            return -1;
+            *store_count_variable = 1;
         }
     }
 
-    /* make 'bintype' big enough to also store any count variables that we may want to add (i.e. 1 + factor 2) */
-    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
-    if (bintype == NULL)
+    free(task);
+    free(sum);
+
+    return 0;
+}
+
+/* Merging t-digest (see T. Dunning and O. Ertl, "Computing extremely accurate quantiles using t-digests") that is
+ * used to estimate the median and percentiles of the samples of a single cell.
+ * Samples are buffered as centroids (of a single sample each) and, once the buffer is full, the centroids are sorted
+ * and neighbouring centroids are merged as long as the merged centroid does not span more than one unit of the k1 scale
+ * function k(q) = compression / (2 pi) * asin(2q - 1). This keeps at most about compression / 2 centroids, with
+ * smaller centroids near the tails of the distribution. Sketches of different sets of samples can be merged by
+ * combining their centroids.
+ */
+typedef struct quantile_centroid_struct
+{
+    double mean;
+    double weight;
+} quantile_centroid;
+
+typedef struct quantile_sketch_struct
+{
+    quantile_centroid *centroid;        /* NULL if no samples were added */
+    int num_centroids;
+    int max_centroids;
+    double minimum;
+    double maximum;
+} quantile_sketch;
+
+static void quantile_sketch_done(quantile_sketch *sketch)
+{
+    if (sketch->centroid != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
-        goto error;
+        free(sketch->centroid);
     }
-    for (k = 0; k < product->num_variables; k++)
+}
+
+static int compare_centroid(const void *a, const void *b)
+{
+    double mean_a = ((const quantile_centroid *)a)->mean;
+    double mean_b = ((const quantile_centroid *)b)->mean;
+
+    return (mean_a < mean_b) ? -1 : (mean_a > mean_b ? 1 : 0);
+}
+
+/* upper bound of the quantile range of a centroid that starts at quantile q */
+static double quantile_sketch_limit(double q, int compression)
+{
+    double k = compression / (2 * M_PI) * asin(2 * q - 1) + 1;
+
+    if (k >= compression / 4.0)
     {
-        bintype[k] = get_binning_type(product->variable[k]);
+        return 1.0;
+    }
+    return (sin(k * 2 * M_PI / compression) + 1) / 2;
+}
 
-        /* determine the maximum number of elements (as size for the 'filtered_count' array) */
-        if (bintype[k] != binning_remove && bintype[k] != binning_skip)
+static void quantile_sketch_compress(quantile_sketch *sketch, int compression)
+{
+    double total_weight = 0;
+    double cumulative_weight = 0;
+    double limit;
+    int num_centroids = 0;
+    int i;
+
+    if (sketch->num_centroids <= 1)
+    {
+        return;
+    }
+    qsort(sketch->centroid, sketch->num_centroids, sizeof(quantile_centroid), compare_centroid);
+    for (i = 0; i < sketch->num_centroids; i++)
+    {
+        total_weight += sketch->centroid[i].weight;
+    }
+    limit = quantile_sketch_limit(0, compression) * total_weight;
+    for (i = 1; i < sketch->num_centroids; i++)
+    {
+        quantile_centroid *current = &sketch->centroid[num_centroids];
+        const quantile_centroid *next = &sketch->centroid[i];
+
+        if (cumulative_weight + current->weight + next->weight <= limit)
         {
-            long total_num_elements = product->variable[k]->num_elements;
+            current->weight += next->weight;
+            current->mean += (next->mean - current->mean) * next->weight / current->weight;
+        }
+        else
+        {
+            cumulative_weight += current->weight;
+            limit = quantile_sketch_limit(cumulative_weight / total_weight, compression) * total_weight;
+            num_centroids++;
+            sketch->centroid[num_centroids] = *next;
+        }
+    }
+    sketch->num_centroids = num_centroids + 1;
+}
 
-            if (num_bins > num_elements)
+static int quantile_sketch_add(quantile_sketch *sketch, double value, double weight, int compression)
+{
+    if (sketch->num_centroids == sketch->max_centroids)
+    {
+        /* compress once the buffer is full, otherwise (or if compressing did not help) grow the buffer */
+        if (sketch->max_centroids >= 2 * compression)
+        {
+            quantile_sketch_compress(sketch, compression);
+        }
+        if (sketch->num_centroids == sketch->max_centroids)
+        {
+            quantile_centroid *new_centroid;
+            int new_max_centroids = (sketch->max_centroids == 0 ? 4 : 2 * sketch->max_centroids);
+
+            if (new_max_centroids > 2 * compression && sketch->max_centroids < 2 * compression)
             {
-                /* use longest time dimension (before vs. after binning) */
-                total_num_elements = num_bins * (total_num_elements / num_elements);
+                new_max_centroids = 2 * compression;
             }
-            if (total_num_elements > filtered_count_size)
+            new_centroid = realloc(sketch->centroid, new_max_centroids * sizeof(quantile_centroid));
+            if (new_centroid == NULL)
             {
-                filtered_count_size = total_num_elements;
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               new_max_centroids * sizeof(quantile_centroid), __FILE__, __LINE__);
+                return -1;
             }
+            sketch->centroid = new_centroid;
+            sketch->max_centroids = new_max_centroids;
         }
     }
 
-    index = malloc(num_bins * sizeof(long));
-    if (index == NULL)
+    if (sketch->num_centroids == 0 || value < sketch->minimum)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_bins * sizeof(long), __FILE__, __LINE__);
-        goto error;
+        sketch->minimum = value;
     }
-    count = malloc(num_bins * sizeof(int32_t));
-    if (count == NULL)
+    if (sketch->num_centroids == 0 || value > sketch->maximum)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_bins * sizeof(int32_t), __FILE__, __LINE__);
-        goto error;
+        sketch->maximum = value;
     }
-    filtered_count = malloc(filtered_count_size * sizeof(int32_t));
-    if (filtered_count == NULL)
+    sketch->centroid[sketch->num_centroids].mean = value;
+    sketch->centroid[sketch->num_centroids].weight = weight;
+    sketch->num_centroids++;
+
+    return 0;
+}
+
+/* estimate the value at quantile q (0 <= q <= 1) from the sorted centroids of a sketch.
+ * Each centroid mean is taken to be located at the center of the weight that it covers and values in between are
+ * linearly interpolated (using the minimum and maximum for the outer halves of the first and last centroid).
+ */
+static double quantile_from_centroids(const quantile_centroid *centroid, int num_centroids, double minimum,
+                                      double maximum, double q)
+{
+    double total_weight = 0;
+    double target;
+    double position;
+    int i;
+
+    if (num_centroids == 1)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       filtered_count_size * sizeof(int32_t), __FILE__, __LINE__);
-        goto error;
+        return centroid[0].mean;
+    }
+    for (i = 0; i < num_centroids; i++)
+    {
+        total_weight += centroid[i].weight;
     }
+    target = q * total_weight;
 
-    /* for each bin, store the index of the first sample that contributes to the bin */
-    for (i = 0; i < num_bins; i++)
+    position = centroid[0].weight / 2;
+    if (target < position)
     {
-        index[i] = 0;   /* initialize with 0 so harp_variable_rearrange_dimension will get valid indices for all bins */
-        count[i] = 0;
+        return minimum + (centroid[0].mean - minimum) * target / position;
     }
-    for (i = 0; i < num_elements; i++)
+    for (i = 0; i < num_centroids - 1; i++)
     {
-        if (count[bin_index[i]] == 0)
+        double next_position = position + (centroid[i].weight + centroid[i + 1].weight) / 2;
+
+        if (target <= next_position)
         {
-            index[bin_index[i]] = i;
+            return centroid[i].mean + (centroid[i + 1].mean - centroid[i].mean) * (target - position) /
+                (next_position - position);
         }
-        count[bin_index[i]]++;
+        position = next_position;
     }
+    if (target < total_weight)
+    {
+        return centroid[i].mean + (maximum - centroid[i].mean) * (target - position) / (total_weight - position);
+    }
+    return maximum;
+}
 
-    /* pre-process all variables */
-    for (k = 0; k < product->num_variables; k++)
+/* get the sorted centroids of a sketch in 'sorted' (which needs room for sketch->num_centroids entries) */
+static void quantile_sketch_sort(const quantile_sketch *sketch, quantile_centroid *sorted)
+{
+    memcpy(sorted, sketch->centroid, sketch->num_centroids * sizeof(quantile_centroid));
+    qsort(sorted, sketch->num_centroids, sizeof(quantile_centroid), compare_centroid);
+}
+
+/* persistent sketches for the percentile aggregations of one variable of a spatial accumulator */
+typedef struct percentile_sketch_struct
+{
+    char *variable_name;
+    char *unit; /* unit of the accumulated samples */
+    int num_dimensions;
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    long num_cells;
+    quantile_sketch *sketch;    /* [num_cells]; NULL until the first product that contains the variable is added */
+} percentile_sketch;
+
+typedef struct percentile_sketch_list_struct
+{
+    int num_variables;
+    percentile_sketch *variable;
+} percentile_sketch_list;
+
+/* names of the aggregation types (as used in the aggregation specifications and as suffix for the result variables);
+ * percentile aggregations use 'p<N>' instead */
+static const char *aggregation_type_name[] = {
+    "mean", "sum", "count", "min", "max", "stdev", "weighted_mean", "median", "percentile"
+};
+
+#define NUM_AGGREGATION_TYPES 9
+
+int harp_bin_aggregation_list_new(harp_bin_aggregation_list **new_list)
+{
+    harp_bin_aggregation_list *list;
+
+    list = (harp_bin_aggregation_list *)malloc(sizeof(harp_bin_aggregation_list));
+    if (list == NULL)
     {
-        harp_variable *variable;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_bin_aggregation_list), __FILE__, __LINE__);
+        return -1;
+    }
+    list->num_aggregations = 0;
+    list->variable_name = NULL;
+    list->type = NULL;
+    list->percentile = NULL;
 
-        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
-        {
-            continue;
-        }
+    *new_list = list;
+    return 0;
+}
 
-        variable = product->variable[k];
+void harp_bin_aggregation_list_delete(harp_bin_aggregation_list *list)
+{
+    long i;
 
-        /* convert variables to double */
-        if (bintype[k] != binning_sum)
+    if (list != NULL)
+    {
+        if (list->variable_name != NULL)
         {
-            if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
+            for (i = 0; i < list->num_aggregations; i++)
             {
-                goto error;
+                free(list->variable_name[i]);
             }
+            free(list->variable_name);
         }
-
-        if (bintype[k] == binning_angle)
+        if (list->type != NULL)
         {
-            /* convert all angles to complex values [cos(x),sin(x)] */
-            if (harp_convert_unit(variable->unit, "rad", variable->num_elements, variable->data.double_data) != 0)
-            {
-                goto error;
-            }
-            if (harp_variable_add_dimension(variable, variable->num_dimensions, harp_dimension_independent, 2) != 0)
-            {
-                goto error;
-            }
-            for (i = 0; i < variable->num_elements; i += 2)
-            {
-                variable->data.double_data[i] = cos(variable->data.double_data[i]);
-                variable->data.double_data[i + 1] = sin(variable->data.double_data[i + 1]);
-            }
+            free(list->type);
         }
-
-        /* pre-multiply variables by existing counts */
-        if (bintype[k] == binning_average)
+        if (list->percentile != NULL)
         {
-            int result;
+            free(list->percentile);
+        }
+        free(list);
+    }
+}
 
-            result = get_count_for_variable(product, variable, bintype, filtered_count);
-            if (result < 0)
-            {
-                goto error;
-            }
-            if (result == 1)
-            {
-                /* multiply by the count */
-                for (i = 0; i < variable->num_elements; i++)
-                {
-                    variable->data.double_data[i] *= filtered_count[i];
-                }
-            }
+static int aggregation_list_add_entry(harp_bin_aggregation_list *list, const char *variable_name,
+                                      harp_bin_aggregation_type type, int percentile)
+{
+    long i;
+
+    for (i = 0; i < list->num_aggregations; i++)
+    {
+        if (list->type[i] == type && list->percentile[i] == percentile &&
+            strcmp(list->variable_name[i], variable_name) == 0)
+        {
+            /* aggregation is already in the list */
+            return 0;
         }
     }
 
-    /* sum up all samples into bins (in place) and create count variables where needed */
-    for (k = 0; k < product->num_variables; k++)
+    if (list->num_aggregations % ACCUMULATOR_BLOCK_SIZE == 0)
     {
-        harp_variable *variable;
-        long num_sub_elements;
+        long new_size = list->num_aggregations + ACCUMULATOR_BLOCK_SIZE;
+        harp_bin_aggregation_type *new_type;
+        char **new_variable_name;
+        int *new_percentile;
 
-        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
+        new_variable_name = realloc(list->variable_name, new_size * sizeof(char *));
+        if (new_variable_name == NULL)
         {
-            continue;
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           new_size * sizeof(char *), __FILE__, __LINE__);
+            return -1;
+        }
+        list->variable_name = new_variable_name;
+        new_type = realloc(list->type, new_size * sizeof(harp_bin_aggregation_type));
+        if (new_type == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           new_size * sizeof(harp_bin_aggregation_type), __FILE__, __LINE__);
+            return -1;
+        }
+        list->type = new_type;
+        new_percentile = realloc(list->percentile, new_size * sizeof(int));
+        if (new_percentile == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           new_size * sizeof(int), __FILE__, __LINE__);
+            return -1;
         }
+        list->percentile = new_percentile;
+    }
 
-        variable = product->variable[k];
-        assert(variable->dimension[0] == num_elements);
-        num_sub_elements = variable->num_elements / num_elements;
+    list->variable_name[list->num_aggregations] = strdup(variable_name);
+    if (list->variable_name[list->num_aggregations] == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    list->type[list->num_aggregations] = type;
+    list->percentile[list->num_aggregations] = percentile;
+    list->num_aggregations++;
 
-        if (bintype[k] == binning_time_min)
+    return 0;
+}
+
+/* Add the aggregations of a '<variable>:<statistic>[,<statistic>...]' specification to the list.
+ * Supported statistics are 'mean', 'sum', 'count', 'min', 'max', 'stdev', 'weighted_mean', 'median', and 'p<N>'
+ * (the N-th percentile, with N an integer in the range 0..100).
+ */
+int harp_bin_aggregation_list_add(harp_bin_aggregation_list *list, const char *specification)
+{
+    char variable_name[MAX_NAME_LENGTH];
+    const char *separator;
+    const char *type_name;
+    long name_length;
+
+    separator = strchr(specification, ':');
+    if (separator == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid aggregation '%s' (expected "
+                       "'<variable>:<statistic>[,<statistic>...]')", specification);
+        return -1;
+    }
+    name_length = (long)(separator - specification);
+    if (name_length >= MAX_NAME_LENGTH)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable name in aggregation '%s' is too long", specification);
+        return -1;
+    }
+    memcpy(variable_name, specification, name_length);
+    variable_name[name_length] = '\0';
+    if (!harp_is_identifier(variable_name))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid variable name '%s' in aggregation '%s'", variable_name,
+                       specification);
+        return -1;
+    }
+
+    type_name = separator + 1;
+    for (;;)
+    {
+        const char *end = strchr(type_name, ',');
+        long type_length = (end == NULL ? (long)strlen(type_name) : (long)(end - type_name));
+        int percentile = 0;
+        int type;
+
+        if (type_length >= 2 && type_length <= 4 && type_name[0] == 'p')
         {
-            /* take minimum of all values per bin */
-            assert(num_sub_elements == 1);
-            for (i = 0; i < num_elements; i++)
-            {
-                long target_index = index[bin_index[i]];
+            long k;
 
-                if (variable->data.double_data[i] < variable->data.double_data[target_index])
+            type = harp_bin_aggregation_percentile;
+            for (k = 1; k < type_length; k++)
+            {
+                if (!isdigit((unsigned char)type_name[k]))
                 {
-                    variable->data.double_data[target_index] = variable->data.double_data[i];
+                    type = NUM_AGGREGATION_TYPES;
+                    break;
                 }
+                percentile = 10 * percentile + (type_name[k] - '0');
             }
-        }
-        else if (bintype[k] == binning_time_max)
-        {
-            /* take maximum of all values per bin */
-            assert(num_sub_elements == 1);
-            for (i = 0; i < num_elements; i++)
+            if (type == harp_bin_aggregation_percentile && percentile > 100)
             {
-                long target_index = index[bin_index[i]];
-
-                if (variable->data.double_data[i] > variable->data.double_data[target_index])
-                {
-                    variable->data.double_data[target_index] = variable->data.double_data[i];
-                }
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid percentile '%.*s' in aggregation '%s' "
+                               "(percentile should be in the range 0..100)", (int)type_length, type_name,
+                               specification);
+                return -1;
             }
         }
         else
         {
-            int store_count_variable = 0;
-
-            /* sum up all values of a bin into the location of the first sample */
-
-            if (bintype[k] == binning_angle)
-            {
-                /* for angle variables we use one filtered_count element per complex pair (and don't pre-multiply) */
-                for (i = 0; i < variable->num_elements / 2; i++)
-                {
-                    filtered_count[i] = 1;
-                }
-            }
-            else if (variable->data_type != harp_type_int32)
+            for (type = 0; type < harp_bin_aggregation_percentile; type++)
             {
-                int result = 0;
-
-                result = get_count_for_variable(product, variable, bintype, filtered_count);
-                if (result < 0)
+                if ((long)strlen(aggregation_type_name[type]) == type_length &&
+                    strncmp(type_name, aggregation_type_name[type], type_length) == 0)
                 {
-                    goto error;
-                }
-                if (result == 0)
-                {
-                    /* if there is no pre-existing count then set all counts to 1 */
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        filtered_count[i] = 1;
-                    }
+                    break;
                 }
             }
-
-            for (i = 0; i < num_elements; i++)
+            if (type == harp_bin_aggregation_percentile)
             {
-                long target_index = index[bin_index[i]];
-
-                if (target_index != i)
-                {
-                    if (bintype[k] == binning_angle)
-                    {
-                        /* for angle variables we use one filtered_count element per complex pair */
-                        for (j = 0; j < num_sub_elements; j += 2)
-                        {
-                            if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                            {
-                                filtered_count[(i * num_sub_elements + j) / 2] = 0;
-                                store_count_variable = 1;
-                            }
-                            else
-                            {
-                                variable->data.double_data[target_index * num_sub_elements + j] +=
-                                    variable->data.double_data[i * num_sub_elements + j];
-                                variable->data.double_data[target_index * num_sub_elements + j + 1] +=
-                                    variable->data.double_data[i * num_sub_elements + j + 1];
-                            }
-                        }
-                    }
-                    else if (variable->data_type == harp_type_int32)
-                    {
-                        for (j = 0; j < num_sub_elements; j++)
-                        {
-                            variable->data.int32_data[target_index * num_sub_elements + j] +=
-                                variable->data.int32_data[i * num_sub_elements + j];
-                        }
-                    }
-                    else
-                    {
-                        for (j = 0; j < num_sub_elements; j++)
-                        {
-                            if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                            {
-                                filtered_count[i * num_sub_elements + j] = 0;
-                                store_count_variable = 1;
-                            }
-                            else
-                            {
-                                variable->data.double_data[target_index * num_sub_elements + j] +=
-                                    variable->data.double_data[i * num_sub_elements + j];
-                            }
-                        }
-                    }
-                }
-                else if (variable->data_type != harp_type_int32)
-                {
-                    if (bintype[k] == binning_angle)
-                    {
-                        for (j = 0; j < num_sub_elements; j += 2)
-                        {
-                            if (harp_isnan(variable->data.double_data[target_index * num_sub_elements + j]))
-                            {
-                                filtered_count[(target_index * num_sub_elements + j) / 2] = 0;
-                                variable->data.double_data[target_index * num_sub_elements + j] = 0;
-                                variable->data.double_data[target_index * num_sub_elements + j + 1] = 0;
-                                store_count_variable = 1;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        for (j = 0; j < num_sub_elements; j++)
-                        {
-                            if (harp_isnan(variable->data.double_data[target_index * num_sub_elements + j]))
-                            {
-                                filtered_count[target_index * num_sub_elements + j] = 0;
-                                variable->data.double_data[target_index * num_sub_elements + j] = 0;
-                                store_count_variable = 1;
-                            }
-                        }
-                    }
-                }
+                type = NUM_AGGREGATION_TYPES;
             }
-            if (store_count_variable)
+            else if (type == harp_bin_aggregation_median)
             {
-                if (bintype[k] == binning_angle)
-                {
-                    /* we store the count for angles (temporarily) to be able to set the count=0 values to NaN */
-                    /* don't include the 'complex' dimension for the count variable for angles */
-                    if (add_count_variable(product, bintype, binning_sum, variable->name, variable->num_dimensions - 1,
-                                           variable->dimension_type, variable->dimension, filtered_count) != 0)
-                    {
-                        goto error;
-                    }
-                }
-                else
-                {
-                    if (add_count_variable(product, bintype, binning_sum, variable->name, variable->num_dimensions,
-                                           variable->dimension_type, variable->dimension, filtered_count) != 0)
-                    {
-                        goto error;
-                    }
-                }
+                percentile = 50;
             }
         }
+        if (type == NUM_AGGREGATION_TYPES)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid statistic '%.*s' in aggregation '%s' (supported "
+                           "statistics are mean, sum, count, min, max, stdev, weighted_mean, median, and p<N>)",
+                           (int)type_length, type_name, specification);
+            return -1;
+        }
+        if (aggregation_list_add_entry(list, variable_name, (harp_bin_aggregation_type)type, percentile) != 0)
+        {
+            return -1;
+        }
+        if (end == NULL)
+        {
+            break;
+        }
+        type_name = end + 1;
     }
 
-    /* resample variables */
-    for (k = 0; k < product->num_variables; k++)
+    return 0;
+}
+
+/* binned variables for the aggregations of a binning operation (to be added to the product after the binning) */
+typedef struct aggregation_result_struct
+{
+    long num_variables;
+    harp_variable **variable;
+    uint8_t *keep_existing;     /* keep a variable with the same name if the product already has one after binning */
+} aggregation_result;
+
+static void aggregation_result_delete(aggregation_result *result)
+{
+    long i;
+
+    if (result != NULL)
     {
-        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
+        if (result->variable != NULL)
         {
-            continue;
+            for (i = 0; i < result->num_variables; i++)
+            {
+                harp_variable_delete(result->variable[i]);
+            }
+            free(result->variable);
         }
-
-        /* resample the time dimension to the target bins */
-        if (harp_variable_rearrange_dimension(product->variable[k], 0, num_bins, index) != 0)
+        if (result->keep_existing != NULL)
         {
-            goto error;
+            free(result->keep_existing);
         }
+        free(result);
     }
+}
 
-    /* update product dimensions */
-    product->dimension[harp_dimension_time] = num_bins;
+static int aggregation_result_new(long max_num_variables, aggregation_result **new_result)
+{
+    aggregation_result *result;
 
-    /* add global count variable if it didn't exist yet */
-    dimension_type[0] = harp_dimension_time;
-    if (add_count_variable(product, bintype, binning_sum, NULL, 1, dimension_type, &num_bins, count) != 0)
+    result = (aggregation_result *)malloc(sizeof(aggregation_result));
+    if (result == NULL)
     {
-        goto error;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(aggregation_result), __FILE__, __LINE__);
+        return -1;
     }
+    result->num_variables = 0;
+    result->variable = NULL;
+    result->keep_existing = NULL;
 
-    /* post-process all variables */
-    for (k = 0; k < product->num_variables; k++)
+    result->variable = malloc(max_num_variables * sizeof(harp_variable *));
+    if (result->variable == NULL)
     {
-        harp_variable *variable;
-        long num_sub_elements;
-        int count_applied = 0;
-
-        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
-        {
-            continue;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       max_num_variables * sizeof(harp_variable *), __FILE__, __LINE__);
+        aggregation_result_delete(result);
+        return -1;
+    }
+    result->keep_existing = malloc(max_num_variables * sizeof(uint8_t));
+    if (result->keep_existing == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       max_num_variables * sizeof(uint8_t), __FILE__, __LINE__);
+        aggregation_result_delete(result);
+        return -1;
+    }
+
+    *new_result = result;
+    return 0;
+}
+
+/* create the '<variable>_<statistic>' (or '<variable>_p<N>') result variable with the binned grid dimensions followed
+ * by the sub dimensions of the source variable and add it to the aggregation result
+ */
+static int aggregation_result_add_variable(aggregation_result *result, const harp_variable *source,
+                                           harp_bin_aggregation_type type, int percentile, int num_grid_dims,
+                                           const harp_dimension_type *grid_dimension_type, const long *grid_dimension,
+                                           harp_variable **new_variable)
+{
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    char variable_name[MAX_NAME_LENGTH];
+    harp_variable *variable;
+    int num_dimensions = 0;
+    int i;
+
+    if (num_grid_dims + source->num_dimensions - 1 > HARP_MAX_NUM_DIMS)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "binned variable '%s' would have more than %d dimensions",
+                       source->name, HARP_MAX_NUM_DIMS);
+        return -1;
+    }
+    for (i = 0; i < num_grid_dims; i++)
+    {
+        dimension_type[num_dimensions] = grid_dimension_type[i];
+        dimension[num_dimensions] = grid_dimension[i];
+        num_dimensions++;
+    }
+    for (i = 1; i < source->num_dimensions; i++)
+    {
+        dimension_type[num_dimensions] = source->dimension_type[i];
+        dimension[num_dimensions] = source->dimension[i];
+        num_dimensions++;
+    }
+
+    if (type == harp_bin_aggregation_percentile)
+    {
+        snprintf(variable_name, MAX_NAME_LENGTH, "%s_p%d", source->name, percentile);
+    }
+    else
+    {
+        snprintf(variable_name, MAX_NAME_LENGTH, "%s_%s", source->name, aggregation_type_name[type]);
+    }
+    if (harp_variable_new(variable_name, type == harp_bin_aggregation_count ? harp_type_int32 : harp_type_double,
+                          num_dimensions, dimension_type, dimension, &variable) != 0)
+    {
+        return -1;
+    }
+    if (type != harp_bin_aggregation_count && source->unit != NULL)
+    {
+        if (harp_variable_set_unit(variable, source->unit) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
         }
+    }
 
-        variable = product->variable[k];
-        num_sub_elements = variable->num_elements / num_elements;
+    result->variable[result->num_variables] = variable;
+    /* a pre-existing '<variable>_count' is propagated by the binning itself and is kept as is */
+    result->keep_existing[result->num_variables] = (type == harp_bin_aggregation_count);
+    result->num_variables++;
 
-        if (bintype[k] == binning_angle)
+    *new_variable = variable;
+    return 0;
+}
+
+/* create the result variables for the median and percentile aggregations of a variable from the sketches of all cells
+ * (there are num_cells = product of the grid dimensions and the sub dimensions of the source variable)
+ */
+static int add_percentile_variables(const harp_bin_aggregation_list *aggregation, const harp_variable *source,
+                                    int num_grid_dims, const harp_dimension_type *grid_dimension_type,
+                                    const long *grid_dimension, long num_cells, const quantile_sketch *sketch,
+                                    aggregation_result *result)
+{
+    harp_variable **percentile_variable;
+    quantile_centroid *sorted = NULL;
+    double *quantile;
+    int max_centroids = 0;
+    long num_percentiles = 0;
+    long i, j;
+
+    percentile_variable = malloc(aggregation->num_aggregations * sizeof(harp_variable *));
+    if (percentile_variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       aggregation->num_aggregations * sizeof(harp_variable *), __FILE__, __LINE__);
+        return -1;
+    }
+    quantile = malloc(aggregation->num_aggregations * sizeof(double));
+    if (quantile == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       aggregation->num_aggregations * sizeof(double), __FILE__, __LINE__);
+        free(percentile_variable);
+        return -1;
+    }
+    for (j = 0; j < aggregation->num_aggregations; j++)
+    {
+        if ((aggregation->type[j] != harp_bin_aggregation_median &&
+             aggregation->type[j] != harp_bin_aggregation_percentile) ||
+            strcmp(aggregation->variable_name[j], source->name) != 0)
         {
-            harp_variable *count_variable;
+            continue;
+        }
+        /* the result takes ownership of the variables */
+        if (aggregation_result_add_variable(result, source, aggregation->type[j], aggregation->percentile[j],
+                                            num_grid_dims, grid_dimension_type, grid_dimension,
+                                            &percentile_variable[num_percentiles]) != 0)
+        {
+            free(quantile);
+            free(percentile_variable);
+            return -1;
+        }
+        quantile[num_percentiles] = aggregation->percentile[j] / 100.0;
+        num_percentiles++;
+    }
 
-            /* convert angle variables back from complex values to angles */
-            for (i = 0; i < variable->num_elements; i += 2)
+    for (i = 0; i < num_cells; i++)
+    {
+        if (sketch[i].num_centroids > max_centroids)
+        {
+            max_centroids = sketch[i].num_centroids;
+        }
+    }
+    if (max_centroids > 0)
+    {
+        sorted = malloc(max_centroids * sizeof(quantile_centroid));
+        if (sorted == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           max_centroids * sizeof(quantile_centroid), __FILE__, __LINE__);
+            free(quantile);
+            free(percentile_variable);
+            return -1;
+        }
+    }
+    for (i = 0; i < num_cells; i++)
+    {
+        if (sketch[i].num_centroids > 0)
+        {
+            quantile_sketch_sort(&sketch[i], sorted);
+        }
+        for (j = 0; j < num_percentiles; j++)
+        {
+            percentile_variable[j]->data.double_data[i] = sketch[i].num_centroids == 0 ? harp_nan() :
+                quantile_from_centroids(sorted, sketch[i].num_centroids, sketch[i].minimum, sketch[i].maximum,
+                                        quantile[j]);
+        }
+    }
+    if (sorted != NULL)
+    {
+        free(sorted);
+    }
+    free(quantile);
+
+    if (harp_option_keep_float && source->data_type == harp_type_float)
+    {
+        for (j = 0; j < num_percentiles; j++)
+        {
+            if (harp_variable_convert_data_type(percentile_variable[j], harp_type_float) != 0)
             {
-                variable->data.double_data[i] = atan2(variable->data.double_data[i + 1], variable->data.double_data[i]);
+                free(percentile_variable);
+                return -1;
             }
-            if (harp_variable_remove_dimension(variable, variable->num_dimensions - 1, 0) != 0)
+        }
+    }
+    free(percentile_variable);
+
+    return 0;
+}
+
+/* Compute the requested statistics for a single variable in one pass over all samples.
+ * Each time sample i contributes to the cells time_bin_index[i] * spatial_block_length + latlon_cell_index[c] (using
+ * weight latlon_weight[c]) for the num_latlon_index[i] consecutive entries c of that sample. For binning in the time
+ * dimension only, num_latlon_index, latlon_cell_index, and latlon_weight are NULL (one cell per sample with weight 1).
+ * The standard deviation is calculated using the weighted incremental (Welford) algorithm. Medians and percentiles
+ * (taken from the aggregation list) are estimated using a (weighted) sketch per cell.
+ * If target is set then the samples are added to the persistent sketches of target instead and no result variables
+ * are created for the medians and percentiles.
+ */
+static int aggregate_variable(harp_product *product, const harp_bin_aggregation_list *aggregation,
+                              const char *variable_name, const uint8_t *requested, int num_grid_dims,
+                              const harp_dimension_type *grid_dimension_type, const long *grid_dimension,
+                              long num_time_elements, const long *time_bin_index, const long *num_latlon_index,
+                              const long *latlon_cell_index, const double *latlon_weight, binning_type type,
+                              percentile_sketch *target, aggregation_result *result)
+{
+    char uncertainty_name[MAX_NAME_LENGTH];
+    harp_variable *source_variable;
+    harp_variable *variable = NULL;
+    harp_variable *uncertainty = NULL;
+    harp_variable *new_variable;
+    int32_t *count = NULL;
+    double *sum = NULL;
+    double *minimum = NULL;
+    double *maximum = NULL;
+    double *weight_sum = NULL;
+    double *mean = NULL;
+    double *m2 = NULL;
+    double *weighted_sum = NULL;
+    double *inverse_variance_sum = NULL;
+    quantile_sketch *sketch = NULL;
+    double nan_value = harp_nan();
+    long spatial_block_length;
+    long num_sub_elements;
+    long num_cells;
+    long cumsum_index;
+    long i, j, l;
+    int k;
+
+    if (harp_product_get_variable_by_name(product, variable_name, &source_variable) != 0)
+    {
+        return -1;
+    }
+    if (type != binning_average)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "aggregations are only supported for variables that are "
+                       "averaged by the binning (variable '%s')", variable_name);
+        return -1;
+    }
+    assert(source_variable->dimension[0] == num_time_elements);
+    num_sub_elements = source_variable->num_elements / num_time_elements;
+    num_cells = 1;
+    for (k = 0; k < num_grid_dims; k++)
+    {
+        num_cells *= grid_dimension[k];
+    }
+    spatial_block_length = num_cells / grid_dimension[0];
+    num_cells *= num_sub_elements;
+
+    if (harp_variable_copy(source_variable, &variable) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
+    {
+        goto error;
+    }
+    if (target != NULL)
+    {
+        if (target->sketch == NULL)
+        {
+            /* first product that contains the variable */
+            if (num_grid_dims + source_variable->num_dimensions - 1 > HARP_MAX_NUM_DIMS)
             {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "binned variable '%s' would have more than %d "
+                               "dimensions", variable_name, HARP_MAX_NUM_DIMS);
                 goto error;
             }
-            num_sub_elements /= 2;
-            /* convert all angles back to the original unit */
-            if (harp_convert_unit("rad", variable->unit, variable->num_elements, variable->data.double_data) != 0)
+            target->num_dimensions = 0;
+            for (k = 0; k < num_grid_dims; k++)
             {
-                goto error;
+                target->dimension_type[target->num_dimensions] = grid_dimension_type[k];
+                target->dimension[target->num_dimensions] = grid_dimension[k];
+                target->num_dimensions++;
             }
-
-            /* set values to NaN if count==0 */
-            if (get_count_variable_for_variable(product, variable, bintype, &count_variable) != 0)
+            for (k = 1; k < source_variable->num_dimensions; k++)
             {
-                goto error;
+                target->dimension_type[target->num_dimensions] = source_variable->dimension_type[k];
+                target->dimension[target->num_dimensions] = source_variable->dimension[k];
+                target->num_dimensions++;
             }
-            if (count_variable != NULL)
+            if (source_variable->unit != NULL)
             {
-                double nan_value = harp_nan();
-                int count_index;
-
-                for (i = 0; i < variable->num_elements; i++)
-                {
-                    if (count_variable->data.int32_data[i] == 0)
-                    {
-                        variable->data.double_data[i] = nan_value;
-                    }
-                }
-                count_applied = 1;
-
-                /* remove the count variable for angles, since it is meaningless for further propagation of averages */
-                if (harp_product_get_variable_index_by_name(product, count_variable->name, &count_index) != 0)
+                target->unit = strdup(source_variable->unit);
+                if (target->unit == NULL)
                 {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)",
+                                   __FILE__, __LINE__);
                     goto error;
                 }
-                bintype[count_index] = binning_remove;
             }
+            target->sketch = calloc(num_cells, sizeof(quantile_sketch));
+            if (target->sketch == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_cells * sizeof(quantile_sketch), __FILE__, __LINE__);
+                goto error;
+            }
+            target->num_cells = num_cells;
         }
-
-        /* divide variables by the sample count and/or set values to NaN if count==0 */
-        if (bintype[k] == binning_average)
+        else
         {
-            double nan_value = harp_nan();
-            int result;
-
-            result = get_count_for_variable(product, variable, bintype, filtered_count);
-            if (result < 0)
+            if (target->num_cells != num_cells)
             {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable '%s' of product does not match the variable of "
+                               "the previously accumulated products", variable_name);
                 goto error;
             }
-            if (result == 1)
+            if (target->unit != NULL && variable->unit != NULL)
             {
-                /* divide by the count (or set value to NaN if count==0) */
-                for (i = 0; i < variable->num_elements; i++)
+                if (harp_variable_convert_unit(variable, target->unit) != 0)
                 {
-                    if (filtered_count[i] == 0)
-                    {
-                        variable->data.double_data[i] = nan_value;
-                    }
-                    else if (filtered_count[i] > 1)
-                    {
-                        variable->data.double_data[i] /= filtered_count[i];
-                    }
+                    goto error;
                 }
-                count_applied = 1;
             }
         }
-
-        /* set all empty bins to NaN (for double) or 0 (for int32) */
-        if (!count_applied)
+        sketch = target->sketch;
+    }
+    else if (requested[harp_bin_aggregation_median] || requested[harp_bin_aggregation_percentile])
+    {
+        sketch = calloc(num_cells, sizeof(quantile_sketch));
+        if (sketch == NULL)
         {
-            for (i = 0; i < num_bins; i++)
-            {
-                if (count[i] == 0)
-                {
-                    double nan_value = harp_nan();
-
-                    if (variable->data_type == harp_type_int32)
-                    {
-                        for (j = 0; j < num_sub_elements; j++)
-                        {
-                            variable->data.int32_data[i * num_sub_elements + j] = 0;
-                        }
-                    }
-                    else
-                    {
-                        for (j = 0; j < num_sub_elements; j++)
-                        {
-                            variable->data.double_data[i * num_sub_elements + j] = nan_value;
-                        }
-                    }
-                }
-            }
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_cells * sizeof(quantile_sketch), __FILE__, __LINE__);
+            goto error;
         }
     }
-
-    /* remove all variables that need to be removed (in reverse order!) */
-    for (k = product->num_variables - 1; k >= 0; k--)
+    if (requested[harp_bin_aggregation_weighted_mean])
     {
-        if (bintype[k] == binning_remove)
+        harp_variable *uncertainty_variable;
+
+        snprintf(uncertainty_name, MAX_NAME_LENGTH, "%s_uncertainty", variable_name);
+        if (harp_product_get_variable_by_name(product, uncertainty_name, &uncertainty_variable) != 0)
         {
-            if (harp_product_remove_variable(product, product->variable[k]) != 0)
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "weighted_mean aggregation of variable '%s' requires a "
+                           "'%s' variable", variable_name, uncertainty_name);
+            goto error;
+        }
+        if (uncertainty_variable->num_dimensions != source_variable->num_dimensions ||
+            uncertainty_variable->num_elements != source_variable->num_elements ||
+            uncertainty_variable->dimension_type[0] != harp_dimension_time)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dimensions of variable '%s' do not match those of variable "
+                           "'%s'", uncertainty_name, variable_name);
+            goto error;
+        }
+        if (harp_variable_copy(uncertainty_variable, &uncertainty) != 0)
+        {
+            goto error;
+        }
+        if (source_variable->unit != NULL)
+        {
+            if (harp_variable_convert_unit(uncertainty, source_variable->unit) != 0)
             {
                 goto error;
             }
         }
+        if (harp_variable_convert_data_type(uncertainty, harp_type_double) != 0)
+        {
+            goto error;
+        }
     }
 
-    free(bintype);
-    free(filtered_count);
-    free(count);
-    free(index);
-
-    return 0;
-
-  error:
-    if (bintype != NULL)
+    count = calloc(num_cells, sizeof(int32_t));
+    if (count == NULL)
     {
-        free(bintype);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_cells * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
     }
-    if (filtered_count != NULL)
+    if (requested[harp_bin_aggregation_sum])
     {
-        free(filtered_count);
+        sum = calloc(num_cells, sizeof(double));
+        if (sum == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_cells * sizeof(double), __FILE__, __LINE__);
+            goto error;
+        }
     }
-    if (count != NULL)
+    if (requested[harp_bin_aggregation_min])
     {
-        free(count);
+        minimum = malloc(num_cells * sizeof(double));
+        if (minimum == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_cells * sizeof(double), __FILE__, __LINE__);
+            goto error;
+        }
     }
-    if (index != NULL)
+    if (requested[harp_bin_aggregation_max])
     {
-        free(index);
+        maximum = malloc(num_cells * sizeof(double));
+        if (maximum == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_cells * sizeof(double), __FILE__, __LINE__);
+            goto error;
+        }
     }
-    return -1;
-}
-
-/** Bin the product's variables into a spatial grid.
- * This will bin all variables with a time dimension into a three dimensional time x latitude x longitude grid.
- * Each time sample will first be allocated to a time bin defined by time_bin_index (similar to \a harp_product_bin).
- * Then within that time bin the sample will be allocated to the appropriate cell(s) in the latitude/longitude grid as
- * defined by the latitude_edges and longitude_edges variables.
- *
- * The lat/lon grid will be a fixed time-independent grid and will have 'num_latitude_edges-1' latitudes and
- * 'num_longitude_edges-1' longitudes.
- * The latitude_edges and longitude_edges arrays provide the boundaries of the grid cells in degrees and need to be
- * provided in a strict ascending order. The latitude edge values need to be between -90 and 90 and for the longitude
- * edge values the constraint is that the difference between the last and first edge should be <= 360.
- *
- * If the product has latitude_bounds {time,independent} and longitude_bounds {time,independent} variables then an area
- * binning is performed. This means that each sample will be allocated to each lat/lon grid cell based on the amount of
- * overlap. This overlap calculation will treat lines between points as straight lines within the carthesian plane
- * (i.e. using a Plate Carree projection, and not using great circle arcs between points on a sphere).
- *
- * If the product doesn't have lat/lon bounds per sample, it should have latitude {time} and longitude {time} variables.
- * The binning onto the lat/lon grid will then be a point binning. This means that each sample is allocated to only one
- * grid cell based on its lat/lon coordinate. To achieve a unique assignment, for each cell the lower edge will be
- * considered inclusive and the upper edge exclusive (except for the last cell (when there is now wrap-around)).
- *
- * The resulting value for each time/lat/lon cell will be the average of all values for that cell.
- * This will be a weighted average in case an area binning is performed and a straight average for point binning.
- * Variables with multiple dimensions will have all elements in its sub dimensions averaged on an element by element
- * basis (i.e. sub dimensions will be retained).
- *
- * Variables that have a time dimension but no unit (or using a string data type) will be removed.
- *
- * All variables that are binned (except existing 'count' variables) are converted to a double data type.
- * Cells that have no samples will end up with a NaN value.
- *
- * In case of point binning, if the product did not already have a 'count' variable then a 'count' variable will be
- * added to the product that will contain the number of samples per cell. In case of area binning, any existing 'count'
- * variables will be removed.
- *
- * Axis variables for the time dimension such as datetime, datetime_length, datetime_start, and datetime_stop will only
- * be binned in the time dimension (but will not gain a latitude or longitude dimension)
- *
- * \param product Product to regrid.
- * \param num_time_bins Number of target bins in the time dimension.
- * \param num_time_elements Length of bin_index array (should equal the length of the time dimension)
- * \param time_bin_index Array of target time bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
- * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
- * \param latitude_edges latitude grid edge vales
- * \param num_longitude_edges Number of edges for the longitude grid
- *        (number of longitude columns = num_longitude_edges - 1)
- * \param longitude_edges longitude grid edge vales
- *
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
- */
-LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bins, long num_time_elements,
-                                         long *time_bin_index, long num_latitude_edges, double *latitude_edges,
-                                         long num_longitude_edges, double *longitude_edges)
-{
-    long spatial_block_length = (num_latitude_edges - 1) * (num_longitude_edges - 1);
-    harp_data_type data_type = harp_type_double;
-    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
-    long dimension[HARP_MAX_NUM_DIMS];
-    harp_variable *latitude = NULL;
-    harp_variable *longitude = NULL;
-    binning_type *bintype = NULL;
-    long *num_latlon_index = NULL;      /* number of matching latlon cells for each sample [num_time_elements] */
-    long *latlon_cell_index = NULL;     /* flat latlon cell index for each matching cell for each sample [sum(num_latlon_index)] */
-    double *latlon_weight = NULL;       /* weight for each matching cell for each sample [sum(num_latlon_index)] */
-    long *time_index = NULL;    /* index of first contributing sample for each bin */
-    int32_t *time_count = NULL; /* number of samples per time bin */
-    long filtered_count_size = 0;
-    int32_t *filtered_count = NULL;
-    double *filtered_weight = NULL;
-    int32_t *count = NULL;      /* number of samples per latlon cell for each time bin [num_time_bins, num_latitude_edges-1, num_longitude_edges-1] */
-    long cumsum_index;  /* index into latlon_cell_index and latlon_weight */
-    int area_binning = 0;
-    long i, j, k, l;
-
-    if (product->dimension[harp_dimension_latitude] > 0 || product->dimension[harp_dimension_longitude] > 0)
+    if (requested[harp_bin_aggregation_stdev])
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial binning cannot be performed on products that already "
-                       "have a latitude and/or longitude dimension");
-        return -1;
+        weight_sum = calloc(3 * num_cells, sizeof(double));
+        if (weight_sum == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           3 * num_cells * sizeof(double), __FILE__, __LINE__);
+            goto error;
+        }
+        mean = &weight_sum[num_cells];
+        m2 = &weight_sum[2 * num_cells];
     }
-
-    if (num_time_elements != product->dimension[harp_dimension_time])
+    if (requested[harp_bin_aggregation_weighted_mean])
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_time_elements (%ld) does not match time dimension length "
-                       "(%ld) (%s:%u)", num_time_elements, product->dimension[harp_dimension_time], __FILE__, __LINE__);
-        return -1;
+        weighted_sum = calloc(2 * num_cells, sizeof(double));
+        if (weighted_sum == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           2 * num_cells * sizeof(double), __FILE__, __LINE__);
+            goto error;
+        }
+        inverse_variance_sum = &weighted_sum[num_cells];
     }
 
+    /* accumulate all statistics in a single pass over the samples */
+    cumsum_index = 0;
     for (i = 0; i < num_time_elements; i++)
     {
-        if (time_bin_index[i] < 0 || time_bin_index[i] >= num_time_bins)
+        long num_sample_cells = (num_latlon_index == NULL ? 1 : num_latlon_index[i]);
+
+        for (l = 0; l < num_sample_cells; l++)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "time_bin_index[%ld] (%ld) should be in the range [0..%ld) "
-                           "(%s:%u)", i, time_bin_index[i], num_time_bins, __FILE__, __LINE__);
-            return -1;
+            long target_index = time_bin_index[i] * spatial_block_length;
+            double weight = 1.0;
+
+            if (latlon_cell_index != NULL)
+            {
+                target_index += latlon_cell_index[cumsum_index];
+            }
+            if (latlon_weight != NULL)
+            {
+                weight = latlon_weight[cumsum_index];
+            }
+            cumsum_index++;
+
+            for (j = 0; j < num_sub_elements; j++)
+            {
+                double value = variable->data.double_data[i * num_sub_elements + j];
+                long index = target_index * num_sub_elements + j;
+
+                if (harp_isnan(value))
+                {
+                    continue;
+                }
+                count[index]++;
+                if (sum != NULL)
+                {
+                    sum[index] += weight * value;
+                }
+                if (minimum != NULL && (count[index] == 1 || value < minimum[index]))
+                {
+                    minimum[index] = value;
+                }
+                if (maximum != NULL && (count[index] == 1 || value > maximum[index]))
+                {
+                    maximum[index] = value;
+                }
+                if (mean != NULL && weight > 0)
+                {
+                    double delta = value - mean[index];
+
+                    weight_sum[index] += weight;
+                    mean[index] += (weight / weight_sum[index]) * delta;
+                    m2[index] += weight * delta * (value - mean[index]);
+                }
+                if (weighted_sum != NULL)
+                {
+                    double sigma = uncertainty->data.double_data[i * num_sub_elements + j];
+
+                    if (sigma > 0 && !harp_isinf(sigma))
+                    {
+                        double inverse_variance = weight / (sigma * sigma);
+
+                        weighted_sum[index] += inverse_variance * value;
+                        inverse_variance_sum[index] += inverse_variance;
+                    }
+                }
+                if (sketch != NULL && weight > 0)
+                {
+                    if (quantile_sketch_add(&sketch[index], value, weight, harp_option_percentile_compression) != 0)
+                    {
+                        goto error;
+                    }
+                }
+            }
         }
     }
 
-    if (num_latitude_edges < 2)
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "need at least 2 latitude edges to perform spatial binning");
-        return -1;
-    }
-    if (num_longitude_edges < 2)
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "need at least 2 longitude edges to perform spatial binning");
-        return -1;
-    }
-    for (i = 0; i < num_latitude_edges; i++)
+    /* create the result variables */
+    for (k = 0; k < NUM_AGGREGATION_TYPES; k++)
     {
-        if (latitude_edges[i] < -90.0 || latitude_edges[i] > 90.0)
+        if (!requested[k] || k == harp_bin_aggregation_mean || k == harp_bin_aggregation_median ||
+            k == harp_bin_aggregation_percentile)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "latitude edge value (%lf) needs to be in the range [-90,90] "
-                           "for spatial binning", latitude_edges[i]);
-            return -1;
+            continue;
         }
-    }
-    for (i = 1; i < num_latitude_edges; i++)
-    {
-        if (latitude_edges[i] <= latitude_edges[i - 1])
+        if (aggregation_result_add_variable(result, source_variable, (harp_bin_aggregation_type)k, 0, num_grid_dims,
+                                            grid_dimension_type, grid_dimension, &new_variable) != 0)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
-                           "latitude edge values need to be in strict ascending order for spatial binning");
-            return -1;
+            goto error;
         }
-    }
-    for (i = 1; i < num_longitude_edges; i++)
-    {
-        if (longitude_edges[i] <= longitude_edges[i - 1])
+        for (i = 0; i < num_cells; i++)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
-                           "longitude edge values need to be in strict ascending order for spatial binning");
-            return -1;
+            switch (k)
+            {
+                case harp_bin_aggregation_count:
+                    new_variable->data.int32_data[i] = count[i];
+                    break;
+                case harp_bin_aggregation_sum:
+                    new_variable->data.double_data[i] = count[i] > 0 ? sum[i] : nan_value;
+                    break;
+                case harp_bin_aggregation_min:
+                    new_variable->data.double_data[i] = count[i] > 0 ? minimum[i] : nan_value;
+                    break;
+                case harp_bin_aggregation_max:
+                    new_variable->data.double_data[i] = count[i] > 0 ? maximum[i] : nan_value;
+                    break;
+                case harp_bin_aggregation_stdev:
+                    new_variable->data.double_data[i] = weight_sum[i] > 0 ? sqrt(m2[i] / weight_sum[i]) : nan_value;
+                    break;
+                case harp_bin_aggregation_weighted_mean:
+                    new_variable->data.double_data[i] = inverse_variance_sum[i] > 0 ?
+                        weighted_sum[i] / inverse_variance_sum[i] : nan_value;
+                    break;
+            }
         }
-    }
-    if (longitude_edges[num_longitude_edges - 1] - longitude_edges[0] > 360)
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "longitude edge range (%lf .. %lf) cannot exceed 360 degrees",
-                       latitude_edges[0], longitude_edges[num_longitude_edges - 1]);
-        return -1;
-    }
-
-
-    num_latlon_index = malloc(num_time_elements * sizeof(long));
-    if (num_latlon_index == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_time_elements * sizeof(long), __FILE__, __LINE__);
-        goto error;
-    }
-
-    dimension_type[0] = harp_dimension_time;
-    dimension_type[1] = harp_dimension_independent;
-    if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, "degree_north", 2, dimension_type,
-                                          &latitude) == 0)
-    {
-        if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, "degree_east", 2, dimension_type,
-                                              &longitude) == 0)
+        if (harp_option_keep_float && source_variable->data_type == harp_type_float &&
+            new_variable->data_type == harp_type_double)
         {
-            area_binning = 1;
-            /* determine matching cells and weighting factors */
-            if (find_matching_cells_and_weights_for_bounds(latitude, longitude, num_latitude_edges, latitude_edges,
-                                                           num_longitude_edges, longitude_edges, num_latlon_index,
-                                                           &latlon_cell_index, &latlon_weight) != 0)
+            if (harp_variable_convert_data_type(new_variable, harp_type_float) != 0)
             {
-                harp_variable_delete(latitude);
-                harp_variable_delete(longitude);
                 goto error;
             }
-            harp_variable_delete(longitude);
         }
-        harp_variable_delete(latitude);
     }
-    if (!area_binning)
+    if (sketch != NULL && target == NULL)
     {
-        if (harp_product_get_derived_variable(product, "latitude", &data_type, "degree_north", 1, dimension_type,
-                                              &latitude) != 0)
-        {
-            goto error;
-        }
-        if (harp_product_get_derived_variable(product, "longitude", &data_type, "degree_east", 1, dimension_type,
-                                              &longitude) != 0)
+        if (add_percentile_variables(aggregation, source_variable, num_grid_dims, grid_dimension_type, grid_dimension,
+                                     num_cells, sketch, result) != 0)
         {
             goto error;
         }
-        if (find_matching_cells_for_points(latitude, longitude, num_latitude_edges, latitude_edges, num_longitude_edges,
-                                           longitude_edges, num_latlon_index, &latlon_cell_index) != 0)
+        for (i = 0; i < num_cells; i++)
         {
-            harp_variable_delete(latitude);
-            harp_variable_delete(longitude);
-            goto error;
+            quantile_sketch_done(&sketch[i]);
         }
-        harp_variable_delete(latitude);
-        harp_variable_delete(longitude);
+        free(sketch);
     }
 
-    /* make 'bintype' big enough to also store any count/weight variables that we may want to add (i.e. 1 + factor 2) */
-    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
-    if (bintype == NULL)
+    harp_variable_delete(variable);
+    if (uncertainty != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
-        goto error;
+        harp_variable_delete(uncertainty);
     }
-    for (k = 0; k < product->num_variables; k++)
+    free(count);
+    if (sum != NULL)
     {
-        bintype[k] = get_spatial_binning_type(product->variable[k], area_binning);
-
-        /* determine the maximum number of elements (as size for the 'filtered_count' array) */
-        if (bintype[k] != binning_remove && bintype[k] != binning_skip)
-        {
-            long total_num_elements = product->variable[k]->num_elements;
-
-            /* is the resulting [time,latitude,longitude,...] larger than the input [time,...] ? */
-            if (num_time_bins * spatial_block_length > num_time_elements)
-            {
-                /* use largest size (before vs. after binning) */
-                total_num_elements = num_time_bins * spatial_block_length * (total_num_elements / num_time_elements);
-            }
-            if (total_num_elements > filtered_count_size)
-            {
-                filtered_count_size = total_num_elements;
-            }
-        }
+        free(sum);
     }
-    time_index = malloc(num_time_bins * sizeof(long));
-    if (time_index == NULL)
+    if (minimum != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_time_bins * sizeof(long), __FILE__, __LINE__);
-        goto error;
+        free(minimum);
     }
-    time_count = malloc(num_time_bins * sizeof(long));
-    if (time_count == NULL)
+    if (maximum != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_time_bins * sizeof(long), __FILE__, __LINE__);
-        goto error;
+        free(maximum);
     }
-    count = malloc(num_time_bins * spatial_block_length * sizeof(int32_t));
-    if (count == NULL)
+    if (weight_sum != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_time_bins * spatial_block_length * sizeof(int32_t), __FILE__, __LINE__);
-        goto error;
+        free(weight_sum);
     }
-    memset(count, 0, num_time_bins * spatial_block_length * sizeof(int32_t));
-    filtered_count = malloc(filtered_count_size * sizeof(int32_t));
-    if (filtered_count == NULL)
+    if (weighted_sum != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       filtered_count_size * sizeof(int32_t), __FILE__, __LINE__);
-        goto error;
+        free(weighted_sum);
     }
-    if (area_binning)
+
+    return 0;
+
+  error:
+    harp_variable_delete(variable);
+    if (uncertainty != NULL)
     {
-        filtered_weight = malloc(filtered_count_size * sizeof(double));
-        if (filtered_weight == NULL)
+        harp_variable_delete(uncertainty);
+    }
+    if (count != NULL)
+    {
+        free(count);
+    }
+    if (sum != NULL)
+    {
+        free(sum);
+    }
+    if (minimum != NULL)
+    {
+        free(minimum);
+    }
+    if (maximum != NULL)
+    {
+        free(maximum);
+    }
+    if (weight_sum != NULL)
+    {
+        free(weight_sum);
+    }
+    if (weighted_sum != NULL)
+    {
+        free(weighted_sum);
+    }
+    if (sketch != NULL && target == NULL)
+    {
+        for (i = 0; i < num_cells; i++)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                           filtered_count_size * sizeof(double), __FILE__, __LINE__);
-            goto error;
+            quantile_sketch_done(&sketch[i]);
         }
+        free(sketch);
     }
+    return -1;
+}
 
-    /* for each time bin, store the index of the first sample that contributes to the bin */
-    for (i = 0; i < num_time_bins; i++)
+/* Compute the binned results of all aggregations in the list (see aggregate_variable() for the sample to cell mapping).
+ * This needs to be called before the binning itself modifies any of the variables.
+ * If spatial is set then the variables are checked against the spatial binning rules.
+ * If sketches is set then the samples of the median and percentile aggregations are added to the sketches of the
+ * corresponding variable in this list (see aggregate_variable()).
+ */
+static int get_aggregation_result(harp_product *product, const harp_bin_aggregation_list *aggregation,
+                                  int num_grid_dims, const harp_dimension_type *grid_dimension_type,
+                                  const long *grid_dimension, long num_time_elements, const long *time_bin_index,
+                                  const long *num_latlon_index, const long *latlon_cell_index,
+                                  const double *latlon_weight, int spatial, int area_binning,
+                                  percentile_sketch_list *sketches, aggregation_result **new_result)
+{
+    aggregation_result *result;
+    long i, j;
+
+    *new_result = NULL;
+    if (aggregation == NULL || aggregation->num_aggregations == 0)
     {
-        time_index[i] = 0;
-        time_count[i] = 0;
+        return 0;
     }
-    for (i = 0; i < num_time_elements; i++)
+
+    if (aggregation_result_new(aggregation->num_aggregations, &result) != 0)
     {
-        if (time_count[time_bin_index[i]] == 0)
+        return -1;
+    }
+    for (i = 0; i < aggregation->num_aggregations; i++)
+    {
+        uint8_t requested[NUM_AGGREGATION_TYPES];
+        percentile_sketch *target = NULL;
+        harp_variable *variable;
+        binning_type type;
+        int is_new = 1;
+
+        /* handle all aggregations of a variable together (at the position of its first aggregation) */
+        for (j = 0; j < i; j++)
         {
-            time_index[time_bin_index[i]] = i;
+            if (strcmp(aggregation->variable_name[j], aggregation->variable_name[i]) == 0)
+            {
+                is_new = 0;
+                break;
+            }
+        }
+        if (!is_new)
+        {
+            continue;
+        }
+        memset(requested, 0, NUM_AGGREGATION_TYPES);
+        for (j = i; j < aggregation->num_aggregations; j++)
+        {
+            if (strcmp(aggregation->variable_name[j], aggregation->variable_name[i]) == 0)
+            {
+                requested[aggregation->type[j]] = 1;
+            }
+        }
+
+        if (harp_product_get_variable_by_name(product, aggregation->variable_name[i], &variable) != 0)
+        {
+            aggregation_result_delete(result);
+            return -1;
+        }
+        type = spatial ? get_spatial_binning_type(variable, area_binning) : get_binning_type(variable);
+        if (sketches != NULL)
+        {
+            int k;
+
+            for (k = 0; k < sketches->num_variables; k++)
+            {
+                if (strcmp(sketches->variable[k].variable_name, aggregation->variable_name[i]) == 0)
+                {
+                    target = &sketches->variable[k];
+                    break;
+                }
+            }
+        }
+        if (aggregate_variable(product, aggregation, aggregation->variable_name[i], requested, num_grid_dims,
+                               grid_dimension_type, grid_dimension, num_time_elements, time_bin_index,
+                               num_latlon_index, latlon_cell_index, latlon_weight, type, target, result) != 0)
+        {
+            aggregation_result_delete(result);
+            return -1;
         }
-        time_count[time_bin_index[i]]++;
     }
 
-    /* determine number of samples (unfiltered for NaN) that contribute to each lat/lon cell */
-    cumsum_index = 0;
-    for (i = 0; i < num_time_elements; i++)
+    *new_result = result;
+    return 0;
+}
+
+/* move the aggregation result variables into the (binned) product; takes ownership of the result */
+static int add_aggregation_result(harp_product *product, aggregation_result *result)
+{
+    long i;
+
+    if (result == NULL)
     {
-        long index_offset = time_bin_index[i] * spatial_block_length;
+        return 0;
+    }
 
-        for (l = 0; l < num_latlon_index[i]; l++)
+    for (i = 0; i < result->num_variables; i++)
+    {
+        harp_variable *variable = result->variable[i];
+
+        if (harp_product_has_variable(product, variable->name))
         {
-            count[index_offset + latlon_cell_index[cumsum_index]] += 1;
-            cumsum_index++;
+            if (result->keep_existing[i])
+            {
+                continue;
+            }
+            if (harp_product_replace_variable(product, variable) != 0)
+            {
+                aggregation_result_delete(result);
+                return -1;
+            }
+        }
+        else if (harp_product_add_variable(product, variable) != 0)
+        {
+            aggregation_result_delete(result);
+            return -1;
+        }
+        /* ownership has moved to the product */
+        result->variable[i] = NULL;
+    }
+    aggregation_result_delete(result);
+
+    return 0;
+}
+
+/* bin all variables in the time dimension (see harp_product_bin()) and add the results of the aggregations */
+static int bin_time(harp_product *product, long num_bins, long num_elements, long *bin_index,
+                    const harp_bin_aggregation_list *aggregation)
+{
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    aggregation_result *aggregated = NULL;
+    binning_type *bintype = NULL;
+    uint8_t *is_float = NULL;
+    long num_original_variables;
+    long filtered_count_size = 0;
+    int32_t *filtered_count = NULL;
+    int32_t *count = NULL;
+    long *index = NULL;
+    long i, j, k;
+
+    if (num_elements != product->dimension[harp_dimension_time])
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_elements (%ld) does not match time dimension length (%ld) "
+                       "(%s:%u)", num_elements, product->dimension[harp_dimension_time], __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < num_elements; i++)
+    {
+        if (bin_index[i] < 0 || bin_index[i] >= num_bins)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "bin_index[%ld] (%ld) should be in the range [0..%ld) (%s:%u)",
+                           i, bin_index[i], num_bins, __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    /* compute the aggregations before any of the variables gets modified */
+    dimension_type[0] = harp_dimension_time;
+    if (get_aggregation_result(product, aggregation, 1, dimension_type, &num_bins, num_elements, bin_index, NULL, NULL,
+                               NULL, 0, 0, NULL, &aggregated) != 0)
+    {
+        return -1;
+    }
+
+    /* make 'bintype' big enough to also store any count variables that we may want to add (i.e. 1 + factor 2) */
+    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
+    if (bintype == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
+        goto error;
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        bintype[k] = get_binning_type(product->variable[k]);
+
+        /* determine the maximum number of elements (as size for the 'filtered_count' array) */
+        if (bintype[k] != binning_remove && bintype[k] != binning_skip)
+        {
+            long total_num_elements = product->variable[k]->num_elements;
+
+            if (num_bins > num_elements)
+            {
+                /* use longest time dimension (before vs. after binning) */
+                total_num_elements = num_bins * (total_num_elements / num_elements);
+            }
+            if (total_num_elements > filtered_count_size)
+            {
+                filtered_count_size = total_num_elements;
+            }
+        }
+    }
+    num_original_variables = product->num_variables;
+    if (get_float_variables(product, bintype, &is_float) != 0)
+    {
+        goto error;
+    }
+
+    index = malloc(num_bins * sizeof(long));
+    if (index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_bins * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+    count = malloc(num_bins * sizeof(int32_t));
+    if (count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_bins * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
+    }
+    filtered_count = malloc(filtered_count_size * sizeof(int32_t));
+    if (filtered_count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       filtered_count_size * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
+    }
+
+    /* for each bin, store the index of the first sample that contributes to the bin */
+    for (i = 0; i < num_bins; i++)
+    {
+        index[i] = 0;   /* initialize with 0 so harp_variable_rearrange_dimension will get valid indices for all bins */
+        count[i] = 0;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        if (count[bin_index[i]] == 0)
+        {
+            index[bin_index[i]] = i;
         }
+        count[bin_index[i]]++;
     }
 
     /* pre-process all variables */
@@ -2061,13 +3181,18 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
         variable = product->variable[k];
 
         /* convert variables to double */
-        if (bintype[k] != binning_sum && bintype[k] != binning_time_sum)
+        if (bintype[k] != binning_sum)
         {
             if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
             {
                 goto error;
             }
         }
+        /* the variable data is modified in place (this is a no-op if the data type conversion already made a copy) */
+        if (harp_variable_make_data_owned(variable) != 0)
+        {
+            goto error;
+        }
 
         if (bintype[k] == binning_angle)
         {
@@ -2088,7 +3213,7 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
         }
 
         /* pre-multiply variables by existing counts */
-        if (bintype[k] == binning_time_average || (bintype[k] == binning_average && !area_binning))
+        if (bintype[k] == binning_average)
         {
             int result;
 
@@ -2108,7 +3233,7 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
         }
     }
 
-    /* sum up all samples into spatial bins (replacing variables) and create count variables where needed */
+    /* sum up all samples into bins (in place) and create count variables where needed */
     for (k = 0; k < product->num_variables; k++)
     {
         harp_variable *variable;
@@ -2120,59 +3245,53 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
         }
 
         variable = product->variable[k];
-        assert(variable->dimension[0] == num_time_elements);
-        num_sub_elements = variable->num_elements / num_time_elements;
+        assert(variable->dimension[0] == num_elements);
+        num_sub_elements = variable->num_elements / num_elements;
 
-        if (bintype[k] == binning_time_max || bintype[k] == binning_time_min || bintype[k] == binning_time_sum ||
-            bintype[k] == binning_time_average)
+        if (bintype[k] == binning_time_min)
         {
-            /* datetime variables are only binned temporally, not spatially */
-            if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
-            {
-                goto error;
-            }
-            if (bintype[k] == binning_time_min)
+            /* take minimum of all values per bin */
+            assert(num_sub_elements == 1);
+            for (i = 0; i < num_elements; i++)
             {
-                /* take minimum of all values per bin */
-                for (i = 0; i < num_time_elements; i++)
-                {
-                    long target_index = time_index[time_bin_index[i]];
+                long target_index = index[bin_index[i]];
 
-                    if (variable->data.double_data[i] < variable->data.double_data[target_index])
-                    {
-                        variable->data.double_data[target_index] = variable->data.double_data[i];
-                    }
+                if (variable->data.double_data[i] < variable->data.double_data[target_index])
+                {
+                    variable->data.double_data[target_index] = variable->data.double_data[i];
                 }
             }
-            else if (bintype[k] == binning_time_max)
+        }
+        else if (bintype[k] == binning_time_max)
+        {
+            /* take maximum of all values per bin */
+            assert(num_sub_elements == 1);
+            for (i = 0; i < num_elements; i++)
             {
-                /* take maximum of all values per bin */
-                for (i = 0; i < num_time_elements; i++)
-                {
-                    long target_index = time_index[time_bin_index[i]];
+                long target_index = index[bin_index[i]];
 
-                    if (variable->data.double_data[i] > variable->data.double_data[target_index])
-                    {
-                        variable->data.double_data[target_index] = variable->data.double_data[i];
-                    }
-                }
+                if (variable->data.double_data[i] > variable->data.double_data[target_index])
+                {
+                    variable->data.double_data[target_index] = variable->data.double_data[i];
+                }
             }
-            else if (bintype[k] == binning_time_sum)
+        }
+        else
+        {
+            int store_count_variable = 0;
+
+            /* sum up all values of a bin into the location of the first sample */
+
+            if (bintype[k] == binning_angle)
             {
-                /* sum up all values of a bin into the location of the first sample */
-                for (i = 0; i < num_time_elements; i++)
+                /* for angle variables we use one filtered_count element per complex pair (and don't pre-multiply) */
+                for (i = 0; i < variable->num_elements / 2; i++)
                 {
-                    long target_index = time_index[time_bin_index[i]];
-
-                    if (i != target_index)
-                    {
-                        variable->data.int32_data[target_index] += variable->data.int32_data[i];
-                    }
+                    filtered_count[i] = 1;
                 }
             }
-            else
+            else if (variable->data_type != harp_type_int32)
             {
-                int store_count_variable = 0;
                 int result = 0;
 
                 result = get_count_for_variable(product, variable, bintype, filtered_count);
@@ -2188,628 +3307,3852 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
                         filtered_count[i] = 1;
                     }
                 }
+            }
 
-                /* sum up all values of a bin into the location of the first sample */
-                for (i = 0; i < num_time_elements; i++)
-                {
-                    long target_index = time_index[time_bin_index[i]];
+            for (i = 0; i < num_elements; i++)
+            {
+                long target_index = index[bin_index[i]];
 
-                    if (target_index == i)
+                if (target_index != i)
+                {
+                    if (bintype[k] == binning_angle)
                     {
-                        if (harp_isnan(variable->data.double_data[target_index]))
+                        /* for angle variables we use one filtered_count element per complex pair */
+                        for (j = 0; j < num_sub_elements; j += 2)
                         {
-                            filtered_count[target_index] = 0;
-                            variable->data.double_data[target_index] = 0;
-                            store_count_variable = 1;
+                            if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
+                            {
+                                filtered_count[(i * num_sub_elements + j) / 2] = 0;
+                                store_count_variable = 1;
+                            }
+                            else
+                            {
+                                variable->data.double_data[target_index * num_sub_elements + j] +=
+                                    variable->data.double_data[i * num_sub_elements + j];
+                                variable->data.double_data[target_index * num_sub_elements + j + 1] +=
+                                    variable->data.double_data[i * num_sub_elements + j + 1];
+                            }
                         }
                     }
-                    else
+                    else if (variable->data_type == harp_type_int32)
                     {
-                        if (harp_isnan(variable->data.double_data[target_index]))
+                        for (j = 0; j < num_sub_elements; j++)
                         {
-                            filtered_count[target_index] = 0;
-                            store_count_variable = 1;
+                            variable->data.int32_data[target_index * num_sub_elements + j] +=
+                                variable->data.int32_data[i * num_sub_elements + j];
                         }
-                        else
+                    }
+                    else
+                    {
+                        for (j = 0; j < num_sub_elements; j++)
                         {
-                            variable->data.double_data[target_index] += variable->data.double_data[i];
+                            if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
+                            {
+                                filtered_count[i * num_sub_elements + j] = 0;
+                                store_count_variable = 1;
+                            }
+                            else
+                            {
+                                variable->data.double_data[target_index * num_sub_elements + j] +=
+                                    variable->data.double_data[i * num_sub_elements + j];
+                            }
                         }
                     }
                 }
-                if (store_count_variable)
+                else if (variable->data_type != harp_type_int32)
                 {
-                    if (add_count_variable(product, bintype, binning_time_sum, variable->name, variable->num_dimensions,
-                                           variable->dimension_type, variable->dimension, filtered_count) != 0)
+                    if (bintype[k] == binning_angle)
                     {
-                        goto error;
+                        for (j = 0; j < num_sub_elements; j += 2)
+                        {
+                            if (harp_isnan(variable->data.double_data[target_index * num_sub_elements + j]))
+                            {
+                                filtered_count[(target_index * num_sub_elements + j) / 2] = 0;
+                                variable->data.double_data[target_index * num_sub_elements + j] = 0;
+                                variable->data.double_data[target_index * num_sub_elements + j + 1] = 0;
+                                store_count_variable = 1;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        for (j = 0; j < num_sub_elements; j++)
+                        {
+                            if (harp_isnan(variable->data.double_data[target_index * num_sub_elements + j]))
+                            {
+                                filtered_count[target_index * num_sub_elements + j] = 0;
+                                variable->data.double_data[target_index * num_sub_elements + j] = 0;
+                                store_count_variable = 1;
+                            }
+                        }
                     }
                 }
             }
-            if (harp_variable_rearrange_dimension(variable, 0, num_time_bins, time_index) != 0)
-            {
-                goto error;
-            }
-        }
-        else
-        {
-            harp_variable *new_variable = NULL;
-            int store_count_variable = 0;
-
-            assert(bintype[k] == binning_average || bintype[k] == binning_sum || bintype[k] == binning_angle);
-
-            if (area_binning)
-            {
-                memset(filtered_weight, 0, filtered_count_size * sizeof(double));
-            }
-            else
+            if (store_count_variable)
             {
                 if (bintype[k] == binning_angle)
                 {
-                    /* for angle variables we use one filtered_count element per complex pair (and don't pre-multiply) */
-                    for (i = 0; i < variable->num_elements / 2; i++)
+                    /* we store the count for angles (temporarily) to be able to set the count=0 values to NaN */
+                    /* don't include the 'complex' dimension for the count variable for angles */
+                    if (add_count_variable(product, bintype, binning_sum, variable->name, variable->num_dimensions - 1,
+                                           variable->dimension_type, variable->dimension, filtered_count) != 0)
                     {
-                        filtered_count[i] = 1;
+                        goto error;
                     }
                 }
-                else if (variable->data_type != harp_type_int32)
+                else
                 {
-                    int result = 0;
-
-                    result = get_count_for_variable(product, variable, bintype, filtered_count);
-                    if (result < 0)
+                    if (add_count_variable(product, bintype, binning_sum, variable->name, variable->num_dimensions,
+                                           variable->dimension_type, variable->dimension, filtered_count) != 0)
                     {
                         goto error;
                     }
-                    if (result == 0)
-                    {
-                        /* if there is no pre-existing count then set all counts to 1 */
-                        for (i = 0; i < variable->num_elements; i++)
-                        {
-                            filtered_count[i] = 1;
-                        }
-                    }
                 }
             }
+        }
+    }
 
-            /* we need to create a new variable that includes the lat/lon dimensions and uses the binned time dimension */
-            if (variable->num_dimensions + 2 >= HARP_MAX_NUM_DIMS)
+    /* resample variables */
+    for (k = 0; k < product->num_variables; k++)
+    {
+        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
+        {
+            continue;
+        }
+
+        /* resample the time dimension to the target bins */
+        if (harp_variable_rearrange_dimension(product->variable[k], 0, num_bins, index) != 0)
+        {
+            goto error;
+        }
+    }
+
+    /* update product dimensions */
+    product->dimension[harp_dimension_time] = num_bins;
+
+    /* add global count variable if it didn't exist yet */
+    dimension_type[0] = harp_dimension_time;
+    if (add_count_variable(product, bintype, binning_sum, NULL, 1, dimension_type, &num_bins, count) != 0)
+    {
+        goto error;
+    }
+
+    /* post-process all variables */
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable;
+        long num_sub_elements;
+        int count_applied = 0;
+
+        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
+        {
+            continue;
+        }
+
+        variable = product->variable[k];
+        num_sub_elements = variable->num_elements / num_elements;
+
+        if (bintype[k] == binning_angle)
+        {
+            harp_variable *count_variable;
+
+            /* convert angle variables back from complex values to angles */
+            for (i = 0; i < variable->num_elements; i += 2)
             {
-                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "too many dimensions (%d) for variables %s to perform "
-                               "spatial binning", variable->num_dimensions, variable->name);
-                goto error;
+                variable->data.double_data[i] = atan2(variable->data.double_data[i + 1], variable->data.double_data[i]);
             }
-            dimension_type[0] = harp_dimension_time;
-            dimension[0] = num_time_bins;
-            dimension_type[1] = harp_dimension_latitude;
-            dimension[1] = num_latitude_edges - 1;
-            dimension_type[2] = harp_dimension_longitude;
-            dimension[2] = num_longitude_edges - 1;
-            for (i = 1; i < variable->num_dimensions; i++)
+            if (harp_variable_remove_dimension(variable, variable->num_dimensions - 1, 0) != 0)
             {
-                dimension_type[i + 2] = variable->dimension_type[i];
-                dimension[i + 2] = variable->dimension[i];
+                goto error;
             }
-            if (harp_variable_new(variable->name, variable->data_type, variable->num_dimensions + 2, dimension_type,
-                                  dimension, &new_variable) != 0)
+            num_sub_elements /= 2;
+            /* convert all angles back to the original unit */
+            if (harp_convert_unit("rad", variable->unit, variable->num_elements, variable->data.double_data) != 0)
             {
                 goto error;
             }
-            if (harp_variable_copy_attributes(variable, new_variable) != 0)
+
+            /* set values to NaN if count==0 */
+            if (get_count_variable_for_variable(product, variable, bintype, &count_variable) != 0)
             {
                 goto error;
             }
-
-            /* sum up all values per cell */
-            cumsum_index = 0;
-            for (i = 0; i < num_time_elements; i++)
+            if (count_variable != NULL)
             {
-                long index_offset = time_bin_index[i] * spatial_block_length;
+                double nan_value = harp_nan();
+                int count_index;
 
-                for (l = 0; l < num_latlon_index[i]; l++)
+                for (i = 0; i < variable->num_elements; i++)
                 {
-                    long target_index = index_offset + latlon_cell_index[cumsum_index];
-
-                    if (area_binning)
+                    if (count_variable->data.int32_data[i] == 0)
                     {
-                        double weight = latlon_weight[cumsum_index];
-
-                        assert(variable->data_type == harp_type_double);
-                        if (bintype[k] == binning_angle)
-                        {
-                            /* for angle variables we use one filtered_weight element per complex pair */
-                            for (j = 0; j < num_sub_elements; j += 2)
-                            {
-                                if (!harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                                {
-                                    filtered_weight[(target_index * num_sub_elements + j) / 2] += weight;
-                                    new_variable->data.double_data[target_index * num_sub_elements + j] +=
-                                        weight * variable->data.double_data[i * num_sub_elements + j];
-                                    new_variable->data.double_data[target_index * num_sub_elements + j + 1] +=
-                                        weight * variable->data.double_data[i * num_sub_elements + j + 1];
-                                }
-                            }
-                        }
-                        else
-                        {
-                            for (j = 0; j < num_sub_elements; j++)
-                            {
-                                if (!harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                                {
-                                    filtered_weight[target_index * num_sub_elements + j] += weight;
-                                    new_variable->data.double_data[target_index * num_sub_elements + j] +=
-                                        weight * variable->data.double_data[i * num_sub_elements + j];
-                                }
-                            }
-                        }
+                        variable->data.double_data[i] = nan_value;
                     }
-                    else
-                    {
-                        if (bintype[k] == binning_angle)
-                        {
-                            /* for angle variables we use one filtered_count element per complex pair */
-                            for (j = 0; j < num_sub_elements; j += 2)
-                            {
-                                if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                                {
-                                    filtered_count[(i * num_sub_elements + j) / 2] = 0;
-                                    store_count_variable = 1;
-                                }
-                                else
-                                {
-                                    new_variable->data.double_data[target_index * num_sub_elements + j] +=
-                                        variable->data.double_data[i * num_sub_elements + j];
-                                    new_variable->data.double_data[target_index * num_sub_elements + j + 1] +=
-                                        variable->data.double_data[i * num_sub_elements + j + 1];
-                                }
-                            }
-                        }
-                        else if (variable->data_type == harp_type_int32)
-                        {
-                            for (j = 0; j < num_sub_elements; j++)
-                            {
-                                new_variable->data.int32_data[target_index * num_sub_elements + j] +=
-                                    variable->data.int32_data[i * num_sub_elements + j];
-                            }
-                        }
-                        else
-                        {
-                            for (j = 0; j < num_sub_elements; j++)
-                            {
-                                if (harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                                {
-                                    filtered_count[i * num_sub_elements + j] = 0;
-                                    store_count_variable = 1;
-                                }
-                                else
-                                {
-                                    new_variable->data.double_data[target_index * num_sub_elements + j] +=
-                                        variable->data.double_data[i * num_sub_elements + j];
-                                }
-                            }
-                        }
-                    }
-                    cumsum_index++;
                 }
+                count_applied = 1;
+
+                /* remove the count variable for angles, since it is meaningless for further propagation of averages */
+                if (harp_product_get_variable_index_by_name(product, count_variable->name, &count_index) != 0)
+                {
+                    goto error;
+                }
+                bintype[count_index] = binning_remove;
             }
-            if (area_binning)
-            {
-                double nan_value = harp_nan();
+        }
 
-                /* divide variable by the weights and/or set values to NaN if weights==0 */
-                if (bintype[k] == binning_angle)
+        /* divide variables by the sample count and/or set values to NaN if count==0 */
+        if (bintype[k] == binning_average)
+        {
+            double nan_value = harp_nan();
+            int result;
+
+            result = get_count_for_variable(product, variable, bintype, filtered_count);
+            if (result < 0)
+            {
+                goto error;
+            }
+            if (result == 1)
+            {
+                /* divide by the count (or set value to NaN if count==0) */
+                for (i = 0; i < variable->num_elements; i++)
                 {
-                    for (i = 0; i < new_variable->num_elements; i += 2)
+                    if (filtered_count[i] == 0)
                     {
-                        if (filtered_weight[i / 2] == 0)
-                        {
-                            new_variable->data.double_data[i] = nan_value;
-                            new_variable->data.double_data[i + 1] = nan_value;
-                        }
+                        variable->data.double_data[i] = nan_value;
                     }
-                }
-                else
-                {
-                    for (i = 0; i < new_variable->num_elements; i++)
+                    else if (filtered_count[i] > 1)
                     {
-                        if (filtered_weight[i] == 0)
-                        {
-                            new_variable->data.double_data[i] = nan_value;
-                        }
-                        else if (bintype[k] == binning_average)
-                        {
-                            /* divide by the sum of the weights */
-                            new_variable->data.double_data[i] /= filtered_weight[i];
-                        }
+                        variable->data.double_data[i] /= filtered_count[i];
                     }
                 }
+                count_applied = 1;
             }
-            else
+        }
+
+        /* set all empty bins to NaN (for double) or 0 (for int32) */
+        if (!count_applied)
+        {
+            for (i = 0; i < num_bins; i++)
             {
-                if (store_count_variable)
+                if (count[i] == 0)
                 {
-                    if (bintype[k] == binning_angle)
+                    double nan_value = harp_nan();
+
+                    if (variable->data_type == harp_type_int32)
                     {
-                        /* we store the count for angles (temporarily) to be able to set the count=0 values to NaN */
-                        /* don't include the 'complex' dimension for the count variable for angles */
-                        if (add_count_variable(product, bintype, binning_sum, variable->name,
-                                               variable->num_dimensions - 1, variable->dimension_type,
-                                               variable->dimension, filtered_count) != 0)
+                        for (j = 0; j < num_sub_elements; j++)
                         {
-                            goto error;
+                            variable->data.int32_data[i * num_sub_elements + j] = 0;
                         }
                     }
                     else
                     {
-                        if (add_count_variable(product, bintype, binning_sum, variable->name, variable->num_dimensions,
-                                               variable->dimension_type, variable->dimension, filtered_count) != 0)
+                        for (j = 0; j < num_sub_elements; j++)
                         {
-                            goto error;
+                            variable->data.double_data[i * num_sub_elements + j] = nan_value;
                         }
                     }
                 }
             }
-
-            /* replace variable in product with new variable */
-            product->variable[k] = new_variable;
-            harp_variable_delete(variable);
         }
     }
 
-    product->dimension[harp_dimension_time] = num_time_bins;
-    product->dimension[harp_dimension_latitude] = num_latitude_edges - 1;
-    product->dimension[harp_dimension_longitude] = num_longitude_edges - 1;
+    if (restore_float_variables(product, bintype, is_float, num_original_variables) != 0)
+    {
+        goto error;
+    }
 
-    /* add global count variable if it didn't exist yet */
-    if (area_binning)
+    /* remove all variables that need to be removed (in reverse order!) */
+    for (k = product->num_variables - 1; k >= 0; k--)
     {
-        /* we only store the total number of samples per temporal bin */
-        dimension_type[0] = harp_dimension_time;
-        dimension[0] = num_time_bins;
-        if (add_count_variable(product, bintype, binning_sum, NULL, 1, dimension_type, dimension, time_count) != 0)
+        if (bintype[k] == binning_remove)
         {
-            goto error;
+            if (harp_product_remove_variable(product, product->variable[k]) != 0)
+            {
+                goto error;
+            }
         }
     }
-    else
+
+    /* add the aggregation results (add_aggregation_result() takes ownership, also on failure) */
+    if (add_aggregation_result(product, aggregated) != 0)
     {
-        /* store counts per time x latitude x longitude */
-        dimension_type[0] = harp_dimension_time;
-        dimension[0] = num_time_bins;
-        dimension_type[1] = harp_dimension_latitude;
-        dimension[1] = num_latitude_edges - 1;
-        dimension_type[2] = harp_dimension_longitude;
-        dimension[2] = num_longitude_edges - 1;
-        if (add_count_variable(product, bintype, binning_sum, NULL, 3, dimension_type, dimension, count) != 0)
-        {
-            goto error;
-        }
+        aggregated = NULL;
+        goto error;
     }
 
-    /* post-process all variables */
-    for (k = 0; k < product->num_variables; k++)
+    free(bintype);
+    if (is_float != NULL)
     {
-        double nan_value = harp_nan();
-        harp_variable *variable;
+        free(is_float);
+    }
+    free(filtered_count);
+    free(count);
+    free(index);
 
-        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
-        {
-            continue;
-        }
+    return 0;
 
-        variable = product->variable[k];
+  error:
+    aggregation_result_delete(aggregated);
+    if (bintype != NULL)
+    {
+        free(bintype);
+    }
+    if (is_float != NULL)
+    {
+        free(is_float);
+    }
+    if (filtered_count != NULL)
+    {
+        free(filtered_count);
+    }
+    if (count != NULL)
+    {
+        free(count);
+    }
+    if (index != NULL)
+    {
+        free(index);
+    }
+    return -1;
+}
 
-        if (bintype[k] == binning_time_min || bintype[k] == binning_time_max)
+/** \addtogroup harp_product
+ * @{
+ */
+
+/** Bin the product's variables.
+ * This will bin all variables in the time dimension. Each time sample will be put in the bin defined by bin_index.
+ * All variables with a time dimension will then be resampled using these bins.
+ * The resulting value for each variable will be the average of all values for the bin (using existing count variables
+ * as weighting factors where available).
+ * Variables with multiple dimensions will have all elements in the sub dimensions averaged on an element by element
+ * basis.
+ *
+ * Variables that have a time dimension but no unit (or using a string data type) will be removed.
+ *
+ * All variables that are binned (except existing 'count' variables) are converted to a double data type.
+ * Bins that have no samples will end up with a NaN value.
+ *
+ * If the product did not already have a 'count' variable then a 'count' variable will be added to the product that
+ * will contain the number of samples per bin.
+ *
+ * Only non-NaN values will contribute to a bin. If there are NaN values then a separate variable-specific count
+ * variable will be created that will contain the number of non-NaN values that contributed to each bin. This
+ * count variable will have the same dimensions as the variable it provides the count for.
+ *
+ * \param product Product to regrid.
+ * \param num_bins Number of target bins.
+ * \param num_elements Length of bin_index array (should equal the length of the time dimension)
+ * \param bin_index Array of target bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_elements, long *bin_index)
+{
+    return bin_time(product, num_bins, num_elements, bin_index, NULL);
+}
+
+/* verify that the latitude/longitude edges define a valid grid for spatial binning */
+static int check_spatial_grid(long num_latitude_edges, const double *latitude_edges, long num_longitude_edges,
+                              const double *longitude_edges)
+{
+    long i;
+
+    if (num_latitude_edges < 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "need at least 2 latitude edges to perform spatial binning");
+        return -1;
+    }
+    if (num_longitude_edges < 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "need at least 2 longitude edges to perform spatial binning");
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges; i++)
+    {
+        if (latitude_edges[i] < -90.0 || latitude_edges[i] > 90.0)
         {
-            /* set all empty bins to NaN */
-            for (i = 0; i < variable->num_elements; i++)
-            {
-                if (time_count[i] == 0)
-                {
-                    variable->data.double_data[i] = nan_value;
-                }
-            }
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "latitude edge value (%lf) needs to be in the range [-90,90] "
+                           "for spatial binning", latitude_edges[i]);
+            return -1;
         }
-        else if (bintype[k] == binning_time_sum)
+    }
+    for (i = 1; i < num_latitude_edges; i++)
+    {
+        if (latitude_edges[i] <= latitude_edges[i - 1])
         {
-            /* set all empty bins to 0 */
-            for (i = 0; i < variable->num_elements; i++)
-            {
-                if (time_count[i] == 0)
-                {
-                    variable->data.int32_data[i] = 0;
-                }
-            }
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
+                           "latitude edge values need to be in strict ascending order for spatial binning");
+            return -1;
         }
-        else if (bintype[k] == binning_time_average)
+    }
+    for (i = 1; i < num_longitude_edges; i++)
+    {
+        if (longitude_edges[i] <= longitude_edges[i - 1])
         {
-            harp_variable *count_variable;
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
+                           "longitude edge values need to be in strict ascending order for spatial binning");
+            return -1;
+        }
+    }
+    if (longitude_edges[num_longitude_edges - 1] - longitude_edges[0] > 360)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "longitude edge range (%lf .. %lf) cannot exceed 360 degrees",
+                       latitude_edges[0], longitude_edges[num_longitude_edges - 1]);
+        return -1;
+    }
 
-            /* divide variable by the sample count and/or set values to NaN if count==0 */
-            if (get_count_variable_for_variable(product, variable, bintype, &count_variable) != 0)
+    return 0;
+}
+
+/* the spatial weights file format starts with this magic sequence, followed by a format version number */
+#define SPATIAL_WEIGHTS_MAGIC "HARPSPWT"
+#define SPATIAL_WEIGHTS_MAGIC_LENGTH 8
+#define SPATIAL_WEIGHTS_FORMAT_VERSION 1
+
+struct harp_spatial_weights_struct
+{
+    long num_latitude_edges;
+    double *latitude_edges;
+    long num_longitude_edges;
+    double *longitude_edges;
+    long num_elements;  /* number of source samples */
+    long num_vertices;  /* number of vertices of the latitude/longitude bounds of each source sample */
+    uint64_t fingerprint;       /* FNV-1a hash of the latitude/longitude bounds of the source samples */
+    long *num_latlon_index;     /* number of matching latlon cells for each sample [num_elements] */
+    long num_cells;     /* total number of matching cells (sum of num_latlon_index) */
+    long *latlon_cell_index;    /* flat latlon cell index for each matching cell for each sample [num_cells] */
+    double *latlon_weight;      /* weight for each matching cell for each sample [num_cells] */
+};
+
+/* 64-bit FNV-1a hash of the latitude/longitude bounds (both as double data) */
+static uint64_t get_bounds_fingerprint(const harp_variable *latitude_bounds, const harp_variable *longitude_bounds)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const harp_variable *bounds[2];
+    long i, k;
+
+    bounds[0] = latitude_bounds;
+    bounds[1] = longitude_bounds;
+    for (k = 0; k < 2; k++)
+    {
+        const unsigned char *data = (const unsigned char *)bounds[k]->data.double_data;
+        long num_bytes = bounds[k]->num_elements * (long)sizeof(double);
+
+        for (i = 0; i < num_bytes; i++)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+/* get the matching cells and weighting factors for the samples from precomputed spatial weights.
+ * This verifies that the weights were determined for the same grid and the same latitude/longitude bounds.
+ * num_latlon_index should already be allocated (with latitude_bounds->dimension[0] elements).
+ */
+static int get_matching_cells_and_weights_from_spatial_weights(const harp_spatial_weights *weights,
+                                                               const harp_variable *latitude_bounds,
+                                                               const harp_variable *longitude_bounds,
+                                                               long num_latitude_edges, const double *latitude_edges,
+                                                               long num_longitude_edges,
+                                                               const double *longitude_edges, long *num_latlon_index,
+                                                               long **latlon_cell_index, double **latlon_weight)
+{
+    long i;
+
+    if (weights->num_latitude_edges != num_latitude_edges || weights->num_longitude_edges != num_longitude_edges)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weights were determined for a different grid");
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges; i++)
+    {
+        if (weights->latitude_edges[i] != latitude_edges[i])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weights were determined for a different grid");
+            return -1;
+        }
+    }
+    for (i = 0; i < num_longitude_edges; i++)
+    {
+        if (weights->longitude_edges[i] != longitude_edges[i])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weights were determined for a different grid");
+            return -1;
+        }
+    }
+    if (weights->num_elements != latitude_bounds->dimension[0] ||
+        weights->num_vertices != latitude_bounds->dimension[1] ||
+        weights->fingerprint != get_bounds_fingerprint(latitude_bounds, longitude_bounds))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weights were determined for a different geometry "
+                       "(latitude/longitude bounds) of the samples");
+        return -1;
+    }
+
+    for (i = 0; i < weights->num_elements; i++)
+    {
+        num_latlon_index[i] = weights->num_latlon_index[i];
+    }
+    if (weights->num_cells > 0)
+    {
+        *latlon_cell_index = malloc(weights->num_cells * sizeof(long));
+        if (*latlon_cell_index == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           weights->num_cells * sizeof(long), __FILE__, __LINE__);
+            return -1;
+        }
+        *latlon_weight = malloc(weights->num_cells * sizeof(double));
+        if (*latlon_weight == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           weights->num_cells * sizeof(double), __FILE__, __LINE__);
+            free(*latlon_cell_index);
+            *latlon_cell_index = NULL;
+            return -1;
+        }
+        memcpy(*latlon_cell_index, weights->latlon_cell_index, weights->num_cells * sizeof(long));
+        memcpy(*latlon_weight, weights->latlon_weight, weights->num_cells * sizeof(double));
+    }
+
+    return 0;
+}
+
+/* spatial binning; if store_weights is set then a '<variable>_weight' variable is added for each averaged variable for
+ * which the count of the binned result is not enough to combine it with other binned results (these are used by the
+ * spatial accumulator). For area binning this is the sum of the weights per cell. For angles this is the length of the
+ * sum of the (weighted) unit vectors.
+ * If sketches is set then the samples for the median and percentile aggregations are added to these sketches (also used
+ * by the spatial accumulator) instead of being turned into result variables.
+ * If weights is set then the matching cells and weighting factors of the samples are taken from these precomputed
+ * spatial weights instead of being calculated from the latitude/longitude bounds (this requires area binning).
+ */
+static int bin_spatial(harp_product *product, long num_time_bins, long num_time_elements, long *time_bin_index,
+                       long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
+                       double *longitude_edges, int store_weights, const harp_bin_aggregation_list *aggregation,
+                       percentile_sketch_list *sketches, const harp_spatial_weights *weights)
+{
+    long spatial_block_length = (num_latitude_edges - 1) * (num_longitude_edges - 1);
+    harp_data_type data_type = harp_type_double;
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    harp_variable *latitude = NULL;
+    harp_variable *longitude = NULL;
+    aggregation_result *aggregated = NULL;
+    binning_type *bintype = NULL;
+    uint8_t *is_float = NULL;
+    long num_original_variables;
+    long *num_latlon_index = NULL;      /* number of matching latlon cells for each sample [num_time_elements] */
+    long *latlon_cell_index = NULL;     /* flat latlon cell index for each matching cell for each sample [sum(num_latlon_index)] */
+    double *latlon_weight = NULL;       /* weight for each matching cell for each sample [sum(num_latlon_index)] */
+    long *time_index = NULL;    /* index of first contributing sample for each bin */
+    int32_t *time_count = NULL; /* number of samples per time bin */
+    long filtered_count_size = 0;
+    int32_t *filtered_count = NULL;
+    double *filtered_weight = NULL;
+    int32_t *count = NULL;      /* number of samples per latlon cell for each time bin [num_time_bins, num_latitude_edges-1, num_longitude_edges-1] */
+    harp_variable **weight_variable = NULL;     /* '<variable>_weight' variables (only when store_weights is set) */
+    long cumsum_index;  /* index into latlon_cell_index and latlon_weight */
+    int area_binning = 0;
+    long i, j, k, l;
+
+    if (product->dimension[harp_dimension_latitude] > 0 || product->dimension[harp_dimension_longitude] > 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial binning cannot be performed on products that already "
+                       "have a latitude and/or longitude dimension");
+        return -1;
+    }
+
+    if (num_time_elements != product->dimension[harp_dimension_time])
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_time_elements (%ld) does not match time dimension length "
+                       "(%ld) (%s:%u)", num_time_elements, product->dimension[harp_dimension_time], __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < num_time_elements; i++)
+    {
+        if (time_bin_index[i] < 0 || time_bin_index[i] >= num_time_bins)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "time_bin_index[%ld] (%ld) should be in the range [0..%ld) "
+                           "(%s:%u)", i, time_bin_index[i], num_time_bins, __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    if (check_spatial_grid(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges) != 0)
+    {
+        return -1;
+    }
+
+    num_latlon_index = malloc(num_time_elements * sizeof(long));
+    if (num_latlon_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_time_elements * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+
+    dimension_type[0] = harp_dimension_time;
+    dimension_type[1] = harp_dimension_independent;
+    if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, "degree_north", 2, dimension_type,
+                                          &latitude) == 0)
+    {
+        if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, "degree_east", 2, dimension_type,
+                                              &longitude) == 0)
+        {
+            area_binning = 1;
+            /* determine matching cells and weighting factors */
+            if (weights != NULL)
+            {
+                if (get_matching_cells_and_weights_from_spatial_weights(weights, latitude, longitude,
+                                                                        num_latitude_edges, latitude_edges,
+                                                                        num_longitude_edges, longitude_edges,
+                                                                        num_latlon_index, &latlon_cell_index,
+                                                                        &latlon_weight) != 0)
+                {
+                    harp_variable_delete(latitude);
+                    harp_variable_delete(longitude);
+                    goto error;
+                }
+            }
+            else if (find_matching_cells_and_weights_for_bounds(latitude, longitude, num_latitude_edges,
+                                                                latitude_edges, num_longitude_edges, longitude_edges,
+                                                                num_latlon_index, &latlon_cell_index,
+                                                                &latlon_weight) != 0)
             {
+                harp_variable_delete(latitude);
+                harp_variable_delete(longitude);
                 goto error;
             }
-            if (count_variable != NULL)
+            harp_variable_delete(longitude);
+        }
+        harp_variable_delete(latitude);
+    }
+    if (!area_binning)
+    {
+        if (weights != NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weights can only be used for products with "
+                           "latitude_bounds and longitude_bounds variables");
+            goto error;
+        }
+        if (harp_product_get_derived_variable(product, "latitude", &data_type, "degree_north", 1, dimension_type,
+                                              &latitude) != 0)
+        {
+            goto error;
+        }
+        if (harp_product_get_derived_variable(product, "longitude", &data_type, "degree_east", 1, dimension_type,
+                                              &longitude) != 0)
+        {
+            goto error;
+        }
+        if (find_matching_cells_for_points(latitude, longitude, num_latitude_edges, latitude_edges, num_longitude_edges,
+                                           longitude_edges, num_latlon_index, &latlon_cell_index) != 0)
+        {
+            harp_variable_delete(latitude);
+            harp_variable_delete(longitude);
+            goto error;
+        }
+        harp_variable_delete(latitude);
+        harp_variable_delete(longitude);
+    }
+
+    /* compute the aggregations before any of the variables gets modified */
+    dimension_type[0] = harp_dimension_time;
+    dimension[0] = num_time_bins;
+    dimension_type[1] = harp_dimension_latitude;
+    dimension[1] = num_latitude_edges - 1;
+    dimension_type[2] = harp_dimension_longitude;
+    dimension[2] = num_longitude_edges - 1;
+    if (get_aggregation_result(product, aggregation, 3, dimension_type, dimension, num_time_elements, time_bin_index,
+                               num_latlon_index, latlon_cell_index, latlon_weight, 1, area_binning, sketches,
+                               &aggregated) != 0)
+    {
+        goto error;
+    }
+
+    /* make 'bintype' big enough to also store any count/weight variables that we may want to add (i.e. 1 + factor 2) */
+    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
+    if (bintype == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
+        goto error;
+    }
+    if (area_binning && store_weights)
+    {
+        weight_variable = malloc((2 * product->num_variables + 1) * sizeof(harp_variable *));
+        if (weight_variable == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (2 * product->num_variables + 1) * sizeof(harp_variable *), __FILE__, __LINE__);
+            goto error;
+        }
+        for (k = 0; k < 2 * product->num_variables + 1; k++)
+        {
+            weight_variable[k] = NULL;
+        }
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        bintype[k] = get_spatial_binning_type(product->variable[k], area_binning);
+
+        /* determine the maximum number of elements (as size for the 'filtered_count' array) */
+        if (bintype[k] != binning_remove && bintype[k] != binning_skip)
+        {
+            long total_num_elements = product->variable[k]->num_elements;
+
+            /* is the resulting [time,latitude,longitude,...] larger than the input [time,...] ? */
+            if (num_time_bins * spatial_block_length > num_time_elements)
             {
-                for (i = 0; i < variable->num_elements; i++)
+                /* use largest size (before vs. after binning) */
+                total_num_elements = num_time_bins * spatial_block_length * (total_num_elements / num_time_elements);
+            }
+            if (total_num_elements > filtered_count_size)
+            {
+                filtered_count_size = total_num_elements;
+            }
+        }
+    }
+    num_original_variables = product->num_variables;
+    if (get_float_variables(product, bintype, &is_float) != 0)
+    {
+        goto error;
+    }
+    time_index = malloc(num_time_bins * sizeof(long));
+    if (time_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_time_bins * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+    time_count = malloc(num_time_bins * sizeof(long));
+    if (time_count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_time_bins * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+    count = malloc(num_time_bins * spatial_block_length * sizeof(int32_t));
+    if (count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_time_bins * spatial_block_length * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
+    }
+    memset(count, 0, num_time_bins * spatial_block_length * sizeof(int32_t));
+    filtered_count = malloc(filtered_count_size * sizeof(int32_t));
+    if (filtered_count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       filtered_count_size * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
+    }
+    if (area_binning)
+    {
+        filtered_weight = malloc(filtered_count_size * sizeof(double));
+        if (filtered_weight == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           filtered_count_size * sizeof(double), __FILE__, __LINE__);
+            goto error;
+        }
+    }
+
+    /* for each time bin, store the index of the first sample that contributes to the bin */
+    for (i = 0; i < num_time_bins; i++)
+    {
+        time_index[i] = 0;
+        time_count[i] = 0;
+    }
+    for (i = 0; i < num_time_elements; i++)
+    {
+        if (time_count[time_bin_index[i]] == 0)
+        {
+            time_index[time_bin_index[i]] = i;
+        }
+        time_count[time_bin_index[i]]++;
+    }
+
+    /* determine number of samples (unfiltered for NaN) that contribute to each lat/lon cell */
+    cumsum_index = 0;
+    for (i = 0; i < num_time_elements; i++)
+    {
+        long index_offset = time_bin_index[i] * spatial_block_length;
+
+        for (l = 0; l < num_latlon_index[i]; l++)
+        {
+            count[index_offset + latlon_cell_index[cumsum_index]] += 1;
+            cumsum_index++;
+        }
+    }
+
+    /* pre-process all variables */
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable;
+
+        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
+        {
+            continue;
+        }
+
+        variable = product->variable[k];
+
+        /* convert variables to double */
+        if (bintype[k] != binning_sum && bintype[k] != binning_time_sum)
+        {
+            if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
+            {
+                goto error;
+            }
+        }
+        /* the variable data is modified in place (this is a no-op if the data type conversion already made a copy) */
+        if (harp_variable_make_data_owned(variable) != 0)
+        {
+            goto error;
+        }
+
+        if (bintype[k] == binning_angle)
+        {
+            /* convert all angles to complex values [cos(x),sin(x)] */
+            if (harp_convert_unit(variable->unit, "rad", variable->num_elements, variable->data.double_data) != 0)
+            {
+                goto error;
+            }
+            if (harp_variable_add_dimension(variable, variable->num_dimensions, harp_dimension_independent, 2) != 0)
+            {
+                goto error;
+            }
+            for (i = 0; i < variable->num_elements; i += 2)
+            {
+                variable->data.double_data[i] = cos(variable->data.double_data[i]);
+                variable->data.double_data[i + 1] = sin(variable->data.double_data[i + 1]);
+            }
+        }
+
+        /* pre-multiply variables by existing counts */
+        if (bintype[k] == binning_time_average || (bintype[k] == binning_average && !area_binning))
+        {
+            int result;
+
+            result = get_count_for_variable(product, variable, bintype, filtered_count);
+            if (result < 0)
+            {
+                goto error;
+            }
+            if (result == 1)
+            {
+                /* multiply by the count */
+                for (i = 0; i < variable->num_elements; i++)
+                {
+                    variable->data.double_data[i] *= filtered_count[i];
+                }
+            }
+        }
+    }
+
+    /* sum up all samples into spatial bins (replacing variables) and create count variables where needed */
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable;
+
+        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
+        {
+            continue;
+        }
+
+        variable = product->variable[k];
+        assert(variable->dimension[0] == num_time_elements);
+
+        if (bintype[k] == binning_time_max || bintype[k] == binning_time_min || bintype[k] == binning_time_sum ||
+            bintype[k] == binning_time_average)
+        {
+            /* datetime variables are only binned temporally, not spatially */
+            if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
+            {
+                goto error;
+            }
+            if (bintype[k] == binning_time_min)
+            {
+                /* take minimum of all values per bin */
+                for (i = 0; i < num_time_elements; i++)
+                {
+                    long target_index = time_index[time_bin_index[i]];
+
+                    if (variable->data.double_data[i] < variable->data.double_data[target_index])
+                    {
+                        variable->data.double_data[target_index] = variable->data.double_data[i];
+                    }
+                }
+            }
+            else if (bintype[k] == binning_time_max)
+            {
+                /* take maximum of all values per bin */
+                for (i = 0; i < num_time_elements; i++)
+                {
+                    long target_index = time_index[time_bin_index[i]];
+
+                    if (variable->data.double_data[i] > variable->data.double_data[target_index])
+                    {
+                        variable->data.double_data[target_index] = variable->data.double_data[i];
+                    }
+                }
+            }
+            else if (bintype[k] == binning_time_sum)
+            {
+                /* sum up all values of a bin into the location of the first sample */
+                for (i = 0; i < num_time_elements; i++)
+                {
+                    long target_index = time_index[time_bin_index[i]];
+
+                    if (i != target_index)
+                    {
+                        variable->data.int32_data[target_index] += variable->data.int32_data[i];
+                    }
+                }
+            }
+            else
+            {
+                int store_count_variable = 0;
+                int result = 0;
+
+                result = get_count_for_variable(product, variable, bintype, filtered_count);
+                if (result < 0)
+                {
+                    goto error;
+                }
+                if (result == 0)
+                {
+                    /* if there is no pre-existing count then set all counts to 1 */
+                    for (i = 0; i < variable->num_elements; i++)
+                    {
+                        filtered_count[i] = 1;
+                    }
+                }
+
+                /* sum up all values of a bin into the location of the first sample */
+                for (i = 0; i < num_time_elements; i++)
+                {
+                    long target_index = time_index[time_bin_index[i]];
+
+                    if (target_index == i)
+                    {
+                        if (harp_isnan(variable->data.double_data[target_index]))
+                        {
+                            filtered_count[target_index] = 0;
+                            variable->data.double_data[target_index] = 0;
+                            store_count_variable = 1;
+                        }
+                    }
+                    else
+                    {
+                        if (harp_isnan(variable->data.double_data[target_index]))
+                        {
+                            filtered_count[target_index] = 0;
+                            store_count_variable = 1;
+                        }
+                        else
+                        {
+                            variable->data.double_data[target_index] += variable->data.double_data[i];
+                        }
+                    }
+                }
+                if (store_count_variable)
+                {
+                    if (add_count_variable(product, bintype, binning_time_sum, variable->name, variable->num_dimensions,
+                                           variable->dimension_type, variable->dimension, filtered_count) != 0)
+                    {
+                        goto error;
+                    }
+                }
+            }
+            if (harp_variable_rearrange_dimension(variable, 0, num_time_bins, time_index) != 0)
+            {
+                goto error;
+            }
+        }
+        else
+        {
+            harp_variable *new_variable = NULL;
+            int store_count_variable = 0;
+
+            assert(bintype[k] == binning_average || bintype[k] == binning_sum || bintype[k] == binning_angle);
+
+            if (area_binning)
+            {
+                memset(filtered_weight, 0, filtered_count_size * sizeof(double));
+            }
+            else
+            {
+                if (bintype[k] == binning_angle)
+                {
+                    /* for angle variables we use one filtered_count element per complex pair (and don't pre-multiply) */
+                    for (i = 0; i < variable->num_elements / 2; i++)
+                    {
+                        filtered_count[i] = 1;
+                    }
+                }
+                else if (variable->data_type != harp_type_int32)
+                {
+                    int result = 0;
+
+                    result = get_count_for_variable(product, variable, bintype, filtered_count);
+                    if (result < 0)
+                    {
+                        goto error;
+                    }
+                    if (result == 0)
+                    {
+                        /* if there is no pre-existing count then set all counts to 1 */
+                        for (i = 0; i < variable->num_elements; i++)
+                        {
+                            filtered_count[i] = 1;
+                        }
+                    }
+                }
+            }
+
+            /* we need to create a new variable that includes the lat/lon dimensions and uses the binned time dimension */
+            if (variable->num_dimensions + 2 >= HARP_MAX_NUM_DIMS)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "too many dimensions (%d) for variables %s to perform "
+                               "spatial binning", variable->num_dimensions, variable->name);
+                goto error;
+            }
+            dimension_type[0] = harp_dimension_time;
+            dimension[0] = num_time_bins;
+            dimension_type[1] = harp_dimension_latitude;
+            dimension[1] = num_latitude_edges - 1;
+            dimension_type[2] = harp_dimension_longitude;
+            dimension[2] = num_longitude_edges - 1;
+            for (i = 1; i < variable->num_dimensions; i++)
+            {
+                dimension_type[i + 2] = variable->dimension_type[i];
+                dimension[i + 2] = variable->dimension[i];
+            }
+            if (harp_variable_new(variable->name, variable->data_type, variable->num_dimensions + 2, dimension_type,
+                                  dimension, &new_variable) != 0)
+            {
+                goto error;
+            }
+            if (harp_variable_copy_attributes(variable, new_variable) != 0)
+            {
+                goto error;
+            }
+
+            /* sum up all values per cell */
+            if (sum_samples_into_cells(variable, new_variable, bintype[k], area_binning, num_time_bins,
+                                       num_time_elements, time_bin_index, spatial_block_length, num_latlon_index,
+                                       latlon_cell_index, latlon_weight, filtered_count, filtered_weight,
+                                       &store_count_variable) != 0)
+            {
+                harp_variable_delete(new_variable);
+                goto error;
+            }
+            if (area_binning)
+            {
+                double nan_value = harp_nan();
+
+                /* divide variable by the weights and/or set values to NaN if weights==0 */
+                if (bintype[k] == binning_angle)
+                {
+                    for (i = 0; i < new_variable->num_elements; i += 2)
+                    {
+                        if (filtered_weight[i / 2] == 0)
+                        {
+                            new_variable->data.double_data[i] = nan_value;
+                            new_variable->data.double_data[i + 1] = nan_value;
+                        }
+                    }
+                }
+                else
+                {
+                    for (i = 0; i < new_variable->num_elements; i++)
+                    {
+                        if (filtered_weight[i] == 0)
+                        {
+                            new_variable->data.double_data[i] = nan_value;
+                        }
+                        else if (bintype[k] == binning_average)
+                        {
+                            /* divide by the sum of the weights */
+                            new_variable->data.double_data[i] /= filtered_weight[i];
+                        }
+                    }
+                }
+                if (weight_variable != NULL && bintype[k] != binning_angle)
+                {
+                    char weight_variable_name[MAX_NAME_LENGTH];
+
+                    snprintf(weight_variable_name, MAX_NAME_LENGTH, "%s_weight", variable->name);
+                    if (harp_variable_new(weight_variable_name, harp_type_double, new_variable->num_dimensions,
+                                          new_variable->dimension_type, new_variable->dimension,
+                                          &weight_variable[k]) != 0)
+                    {
+                        harp_variable_delete(new_variable);
+                        goto error;
+                    }
+                    memcpy(weight_variable[k]->data.double_data, filtered_weight,
+                           weight_variable[k]->num_elements * sizeof(double));
+                }
+            }
+            else
+            {
+                if (store_count_variable)
+                {
+                    if (bintype[k] == binning_angle)
+                    {
+                        /* we store the count for angles (temporarily) to be able to set the count=0 values to NaN */
+                        /* don't include the 'complex' dimension for the count variable for angles */
+                        if (add_count_variable(product, bintype, binning_sum, variable->name,
+                                               variable->num_dimensions - 1, variable->dimension_type,
+                                               variable->dimension, filtered_count) != 0)
+                        {
+                            goto error;
+                        }
+                    }
+                    else
+                    {
+                        if (add_count_variable(product, bintype, binning_sum, variable->name, variable->num_dimensions,
+                                               variable->dimension_type, variable->dimension, filtered_count) != 0)
+                        {
+                            goto error;
+                        }
+                    }
+                }
+            }
+
+            /* replace variable in product with new variable */
+            product->variable[k] = new_variable;
+            harp_variable_delete(variable);
+        }
+    }
+
+    product->dimension[harp_dimension_time] = num_time_bins;
+    product->dimension[harp_dimension_latitude] = num_latitude_edges - 1;
+    product->dimension[harp_dimension_longitude] = num_longitude_edges - 1;
+
+    if (weight_variable != NULL)
+    {
+        int num_variables = product->num_variables;
+        int index;
+
+        /* add the weight variables (these don't need any post-processing) */
+        for (k = 0; k < num_variables; k++)
+        {
+            if (weight_variable[k] == NULL)
+            {
+                continue;
+            }
+            if (harp_product_has_variable(product, weight_variable[k]->name))
+            {
+                if (harp_product_get_variable_index_by_name(product, weight_variable[k]->name, &index) != 0)
+                {
+                    goto error;
+                }
+                if (harp_product_replace_variable(product, weight_variable[k]) != 0)
+                {
+                    goto error;
+                }
+            }
+            else
+            {
+                if (harp_product_add_variable(product, weight_variable[k]) != 0)
+                {
+                    goto error;
+                }
+                index = product->num_variables - 1;
+            }
+            weight_variable[k] = NULL;
+            bintype[index] = binning_skip;
+        }
+        free(weight_variable);
+        weight_variable = NULL;
+    }
+
+    /* add global count variable if it didn't exist yet */
+    if (area_binning)
+    {
+        /* we only store the total number of samples per temporal bin */
+        dimension_type[0] = harp_dimension_time;
+        dimension[0] = num_time_bins;
+        if (add_count_variable(product, bintype, binning_sum, NULL, 1, dimension_type, dimension, time_count) != 0)
+        {
+            goto error;
+        }
+    }
+    else
+    {
+        /* store counts per time x latitude x longitude */
+        dimension_type[0] = harp_dimension_time;
+        dimension[0] = num_time_bins;
+        dimension_type[1] = harp_dimension_latitude;
+        dimension[1] = num_latitude_edges - 1;
+        dimension_type[2] = harp_dimension_longitude;
+        dimension[2] = num_longitude_edges - 1;
+        if (add_count_variable(product, bintype, binning_sum, NULL, 3, dimension_type, dimension, count) != 0)
+        {
+            goto error;
+        }
+    }
+
+    /* post-process all variables */
+    for (k = 0; k < product->num_variables; k++)
+    {
+        double nan_value = harp_nan();
+        harp_variable *variable;
+
+        if (bintype[k] == binning_skip || bintype[k] == binning_remove)
+        {
+            continue;
+        }
+
+        variable = product->variable[k];
+
+        if (bintype[k] == binning_time_min || bintype[k] == binning_time_max)
+        {
+            /* set all empty bins to NaN */
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                if (time_count[i] == 0)
+                {
+                    variable->data.double_data[i] = nan_value;
+                }
+            }
+        }
+        else if (bintype[k] == binning_time_sum)
+        {
+            /* set all empty bins to 0 */
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                if (time_count[i] == 0)
+                {
+                    variable->data.int32_data[i] = 0;
+                }
+            }
+        }
+        else if (bintype[k] == binning_time_average)
+        {
+            harp_variable *count_variable;
+
+            /* divide variable by the sample count and/or set values to NaN if count==0 */
+            if (get_count_variable_for_variable(product, variable, bintype, &count_variable) != 0)
+            {
+                goto error;
+            }
+            if (count_variable != NULL)
+            {
+                for (i = 0; i < variable->num_elements; i++)
+                {
+                    if (count_variable->data.int32_data[i] == 0)
+                    {
+                        variable->data.double_data[i] = nan_value;
+                    }
+                    else if (count_variable->data.int32_data[i] > 1)
+                    {
+                        variable->data.double_data[i] /= count_variable->data.int32_data[i];
+                    }
+                }
+            }
+            else
+            {
+                for (i = 0; i < variable->num_elements; i++)
+                {
+                    if (time_count[i] == 0)
+                    {
+                        variable->data.double_data[i] = nan_value;
+                    }
+                    else if (time_count[i] > 1)
+                    {
+                        variable->data.double_data[i] /= time_count[i];
+                    }
+                }
+            }
+        }
+        else
+        {
+            long num_sub_elements;
+            int count_applied = 0;
+
+            num_sub_elements = variable->num_elements / (num_time_bins * spatial_block_length);
+
+            if (bintype[k] == binning_angle)
+            {
+                if (store_weights)
+                {
+                    char weight_variable_name[MAX_NAME_LENGTH];
+                    harp_variable *angle_weight_variable;
+
+                    /* for angles the weight is the length of the sum of the (weighted) unit vectors; this is the
+                     * information that is lost when converting the sum back to an angle */
+                    snprintf(weight_variable_name, MAX_NAME_LENGTH, "%s_weight", variable->name);
+                    if (harp_variable_new(weight_variable_name, harp_type_double, variable->num_dimensions - 1,
+                                          variable->dimension_type, variable->dimension, &angle_weight_variable) != 0)
+                    {
+                        goto error;
+                    }
+                    for (i = 0; i < angle_weight_variable->num_elements; i++)
+                    {
+                        angle_weight_variable->data.double_data[i] = hypot(variable->data.double_data[2 * i],
+                                                                           variable->data.double_data[2 * i + 1]);
+                    }
+                    if (harp_product_has_variable(product, weight_variable_name))
+                    {
+                        int index;
+
+                        if (harp_product_get_variable_index_by_name(product, weight_variable_name, &index) != 0)
+                        {
+                            harp_variable_delete(angle_weight_variable);
+                            goto error;
+                        }
+                        if (harp_product_replace_variable(product, angle_weight_variable) != 0)
+                        {
+                            harp_variable_delete(angle_weight_variable);
+                            goto error;
+                        }
+                        bintype[index] = binning_skip;
+                    }
+                    else
+                    {
+                        if (harp_product_add_variable(product, angle_weight_variable) != 0)
+                        {
+                            harp_variable_delete(angle_weight_variable);
+                            goto error;
+                        }
+                        bintype[product->num_variables - 1] = binning_skip;
+                    }
+                }
+
+                /* convert angle variables back from complex values to angles */
+                for (i = 0; i < variable->num_elements; i += 2)
+                {
+                    variable->data.double_data[i] = atan2(variable->data.double_data[i + 1],
+                                                          variable->data.double_data[i]);
+                }
+                if (harp_variable_remove_dimension(variable, variable->num_dimensions - 1, 0) != 0)
+                {
+                    goto error;
+                }
+                num_sub_elements /= 2;
+                /* convert all angles back to the original unit */
+                if (harp_convert_unit("rad", variable->unit, variable->num_elements, variable->data.double_data) != 0)
+                {
+                    goto error;
+                }
+
+                if (!area_binning)
+                {
+                    harp_variable *count_variable;
+
+                    /* set values to NaN if count==0 */
+                    if (get_count_variable_for_variable(product, variable, bintype, &count_variable) != 0)
+                    {
+                        goto error;
+                    }
+                    if (count_variable != NULL)
+                    {
+                        int count_index;
+
+                        for (i = 0; i < variable->num_elements; i++)
+                        {
+                            if (count_variable->data.int32_data[i] == 0)
+                            {
+                                variable->data.double_data[i] = nan_value;
+                            }
+                        }
+                        count_applied = 1;
+
+                        /* remove the count variable for angles, since it is meaningless for further propagation of averages */
+                        if (harp_product_get_variable_index_by_name(product, count_variable->name, &count_index) != 0)
+                        {
+                            goto error;
+                        }
+                        bintype[count_index] = binning_remove;
+                    }
+                }
+            }
+
+            if (!area_binning && !count_applied)
+            {
+                double nan_value = harp_nan();
+
+                /* divide variables by the sample count and/or set values to NaN if count==0 */
+                if (bintype[k] == binning_average)
+                {
+                    int result;
+
+                    result = get_count_for_variable(product, variable, bintype, filtered_count);
+                    if (result < 0)
+                    {
+                        goto error;
+                    }
+                    if (result == 1)
+                    {
+                        /* divide by the count (or set value to NaN if count==0) */
+                        for (i = 0; i < variable->num_elements; i++)
+                        {
+                            if (filtered_count[i] == 0)
+                            {
+                                variable->data.double_data[i] = nan_value;
+                            }
+                            else if (filtered_count[i] > 1)
+                            {
+                                variable->data.double_data[i] /= filtered_count[i];
+                            }
+                        }
+                    }
+                    else
+                    {
+                        for (i = 0; i < num_time_bins * spatial_block_length; i++)
+                        {
+                            if (count[i] == 0)
+                            {
+                                for (j = 0; j < num_sub_elements; j++)
+                                {
+                                    variable->data.double_data[i * num_sub_elements + j] = nan_value;
+                                }
+                            }
+                            else
+                            {
+                                for (j = 0; j < num_sub_elements; j++)
+                                {
+                                    variable->data.double_data[i * num_sub_elements + j] /= count[i];
+                                }
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    /* set all empty bins to NaN (for double) or 0 (for int32) */
+                    for (i = 0; i < num_time_bins * spatial_block_length; i++)
+                    {
+                        if (count[i] == 0)
+                        {
+                            if (variable->data_type == harp_type_int32)
+                            {
+                                for (j = 0; j < num_sub_elements; j++)
+                                {
+                                    variable->data.int32_data[i * num_sub_elements + j] = 0;
+                                }
+                            }
+                            else
+                            {
+                                for (j = 0; j < num_sub_elements; j++)
+                                {
+                                    variable->data.double_data[i * num_sub_elements + j] = nan_value;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (restore_float_variables(product, bintype, is_float, num_original_variables) != 0)
+    {
+        goto error;
+    }
+
+    /* remove all variables that need to be removed (in reverse order!) */
+    for (k = product->num_variables - 1; k >= 0; k--)
+    {
+        if (bintype[k] == binning_remove)
+        {
+            if (harp_product_remove_variable(product, product->variable[k]) != 0)
+            {
+                goto error;
+            }
+        }
+    }
+
+    free(bintype);
+    if (is_float != NULL)
+    {
+        free(is_float);
+    }
+    free(filtered_count);
+    if (area_binning)
+    {
+        free(filtered_weight);
+    }
+    free(time_index);
+    free(time_count);
+    free(count);
+    free(num_latlon_index);
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+    if (latlon_weight != NULL)
+    {
+        free(latlon_weight);
+    }
+
+    /* add the aggregation results (add_aggregation_result() takes ownership, also on failure) */
+    if (add_aggregation_result(product, aggregated) != 0)
+    {
+        return -1;
+    }
+
+    /* add latitude_bounds and longitude_bounds variables */
+    dimension_type[0] = harp_dimension_latitude;
+    dimension[0] = num_latitude_edges - 1;
+    dimension_type[1] = harp_dimension_independent;
+    dimension[1] = 2;
+    if (harp_variable_new("latitude_bounds", harp_type_double, 2, dimension_type, dimension, &latitude) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        latitude->data.double_data[2 * i] = latitude_edges[i];
+        latitude->data.double_data[2 * i + 1] = latitude_edges[i + 1];
+    }
+    if (harp_product_add_variable(product, latitude) != 0)
+    {
+        harp_variable_delete(latitude);
+        return -1;
+    }
+    if (harp_variable_set_unit(latitude, HARP_UNIT_LATITUDE) != 0)
+    {
+        return -1;
+    }
+
+    dimension_type[0] = harp_dimension_longitude;
+    dimension[0] = num_longitude_edges - 1;
+    if (harp_variable_new("longitude_bounds", harp_type_double, 2, dimension_type, dimension, &longitude) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        longitude->data.double_data[2 * i] = longitude_edges[i];
+        longitude->data.double_data[2 * i + 1] = longitude_edges[i + 1];
+    }
+    if (harp_product_add_variable(product, longitude) != 0)
+    {
+        harp_variable_delete(longitude);
+        return -1;
+    }
+    if (harp_variable_set_unit(longitude, HARP_UNIT_LONGITUDE) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+
+  error:
+    aggregation_result_delete(aggregated);
+    if (bintype != NULL)
+    {
+        free(bintype);
+    }
+    if (is_float != NULL)
+    {
+        free(is_float);
+    }
+    if (time_index != NULL)
+    {
+        free(time_index);
+    }
+    if (time_count != NULL)
+    {
+        free(time_count);
+    }
+    if (count != NULL)
+    {
+        free(count);
+    }
+    if (filtered_count != NULL)
+    {
+        free(filtered_count);
+    }
+    if (filtered_weight != NULL)
+    {
+        free(filtered_weight);
+    }
+    if (weight_variable != NULL)
+    {
+        for (k = 0; k < product->num_variables; k++)
+        {
+            if (weight_variable[k] != NULL)
+            {
+                harp_variable_delete(weight_variable[k]);
+            }
+        }
+        free(weight_variable);
+    }
+    if (num_latlon_index != NULL)
+    {
+        free(num_latlon_index);
+    }
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+    if (latlon_weight != NULL)
+    {
+        free(latlon_weight);
+    }
+    return -1;
+}
+
+/** Bin the product's variables into a spatial grid.
+ * This will bin all variables with a time dimension into a three dimensional time x latitude x longitude grid.
+ * Each time sample will first be allocated to a time bin defined by time_bin_index (similar to \a harp_product_bin).
+ * Then within that time bin the sample will be allocated to the appropriate cell(s) in the latitude/longitude grid as
+ * defined by the latitude_edges and longitude_edges variables.
+ *
+ * The lat/lon grid will be a fixed time-independent grid and will have 'num_latitude_edges-1' latitudes and
+ * 'num_longitude_edges-1' longitudes.
+ * The latitude_edges and longitude_edges arrays provide the boundaries of the grid cells in degrees and need to be
+ * provided in a strict ascending order. The latitude edge values need to be between -90 and 90 and for the longitude
+ * edge values the constraint is that the difference between the last and first edge should be <= 360.
+ *
+ * If the product has latitude_bounds {time,independent} and longitude_bounds {time,independent} variables then an area
+ * binning is performed. This means that each sample will be allocated to each lat/lon grid cell based on the amount of
+ * overlap. This overlap calculation will treat lines between points as straight lines within the carthesian plane
+ * (i.e. using a Plate Carree projection, and not using great circle arcs between points on a sphere).
+ *
+ * If the product doesn't have lat/lon bounds per sample, it should have latitude {time} and longitude {time} variables.
+ * The binning onto the lat/lon grid will then be a point binning. This means that each sample is allocated to only one
+ * grid cell based on its lat/lon coordinate. To achieve a unique assignment, for each cell the lower edge will be
+ * considered inclusive and the upper edge exclusive (except for the last cell (when there is now wrap-around)).
+ *
+ * The resulting value for each time/lat/lon cell will be the average of all values for that cell.
+ * This will be a weighted average in case an area binning is performed and a straight average for point binning.
+ * Variables with multiple dimensions will have all elements in its sub dimensions averaged on an element by element
+ * basis (i.e. sub dimensions will be retained).
+ *
+ * Variables that have a time dimension but no unit (or using a string data type) will be removed.
+ *
+ * All variables that are binned (except existing 'count' variables) are converted to a double data type.
+ * Cells that have no samples will end up with a NaN value.
+ *
+ * In case of point binning, if the product did not already have a 'count' variable then a 'count' variable will be
+ * added to the product that will contain the number of samples per cell. In case of area binning, any existing 'count'
+ * variables will be removed.
+ *
+ * Axis variables for the time dimension such as datetime, datetime_length, datetime_start, and datetime_stop will only
+ * be binned in the time dimension (but will not gain a latitude or longitude dimension)
+ *
+ * \param product Product to regrid.
+ * \param num_time_bins Number of target bins in the time dimension.
+ * \param num_time_elements Length of bin_index array (should equal the length of the time dimension)
+ * \param time_bin_index Array of target time bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
+ * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
+ * \param latitude_edges latitude grid edge vales
+ * \param num_longitude_edges Number of edges for the longitude grid
+ *        (number of longitude columns = num_longitude_edges - 1)
+ * \param longitude_edges longitude grid edge vales
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bins, long num_time_elements,
+                                         long *time_bin_index, long num_latitude_edges, double *latitude_edges,
+                                         long num_longitude_edges, double *longitude_edges)
+{
+    return bin_spatial(product, num_time_bins, num_time_elements, time_bin_index, num_latitude_edges, latitude_edges,
+                       num_longitude_edges, longitude_edges, 0, NULL, NULL, NULL);
+}
+
+/* spatial binning of all samples into a single time bin */
+static int bin_spatial_single_time_bin(harp_product *product, long num_latitude_edges, double *latitude_edges,
+                                       long num_longitude_edges, double *longitude_edges,
+                                       const harp_bin_aggregation_list *aggregation,
+                                       const harp_spatial_weights *weights)
+{
+    long *bin_index;
+    long num_elements;
+    long i;
+
+    num_elements = product->dimension[harp_dimension_time];
+    if (num_elements == 0)
+    {
+        /* nothing to do */
+        return 0;
+    }
+
+    bin_index = malloc(num_elements * sizeof(long));
+    if (bin_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        bin_index[i] = 0;
+    }
+
+    if (bin_spatial(product, 1, num_elements, bin_index, num_latitude_edges, latitude_edges, num_longitude_edges,
+                    longitude_edges, 0, aggregation, NULL, weights) != 0)
+    {
+        free(bin_index);
+        return -1;
+    }
+
+    free(bin_index);
+    return 0;
+}
+
+/* The spatial weights file format consists of (all numbers are stored in little endian byte order):
+ *   - the magic sequence "HARPSPWT" followed by the format version (int32)
+ *   - num_latitude_edges (int64) followed by the latitude edges (doubles)
+ *   - num_longitude_edges (int64) followed by the longitude edges (doubles)
+ *   - num_elements (int64), num_vertices (int64), and the fingerprint of the latitude/longitude bounds (uint64)
+ *   - num_cells (int64)
+ *   - the number of matching cells for each sample (num_elements int64 values)
+ *   - the flat latitude/longitude cell index of each matching cell (num_cells int64 values)
+ *   - the weight of each matching cell (num_cells doubles)
+ */
+
+static int write_spatial_weights_int64(FILE *file, int64_t value)
+{
+    unsigned char buffer[8];
+    uint64_t v = (uint64_t)value;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        buffer[i] = (unsigned char)(v & 0xff);
+        v >>= 8;
+    }
+    if (fwrite(buffer, 1, 8, file) != 8)
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "error writing spatial weights file");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int write_spatial_weights_double(FILE *file, double value)
+{
+    uint64_t v;
+
+    memcpy(&v, &value, sizeof(double));
+
+    return write_spatial_weights_int64(file, (int64_t)v);
+}
+
+static int read_spatial_weights_int64(FILE *file, int64_t *value)
+{
+    unsigned char buffer[8];
+    uint64_t v = 0;
+    int i;
+
+    if (fread(buffer, 1, 8, file) != 8)
+    {
+        if (ferror(file))
+        {
+            harp_set_error(HARP_ERROR_FILE_READ, "error reading spatial weights file");
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "unexpected end of spatial weights file");
+        }
+        return -1;
+    }
+    for (i = 7; i >= 0; i--)
+    {
+        v = (v << 8) | buffer[i];
+    }
+    *value = (int64_t)v;
+
+    return 0;
+}
+
+static int read_spatial_weights_double(FILE *file, double *value)
+{
+    int64_t v;
+
+    if (read_spatial_weights_int64(file, &v) != 0)
+    {
+        return -1;
+    }
+    memcpy(value, &v, sizeof(double));
+
+    return 0;
+}
+
+/* read a non-negative int64 value that should be usable as an array length */
+static int read_spatial_weights_length(FILE *file, long *length)
+{
+    int64_t value;
+
+    if (read_spatial_weights_int64(file, &value) != 0)
+    {
+        return -1;
+    }
+    if (value < 0 || value > LONG_MAX / (long)sizeof(double))
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid length (%ld) in spatial weights file", (long)value);
+        return -1;
+    }
+    *length = (long)value;
+
+    return 0;
+}
+
+static harp_spatial_weights *spatial_weights_alloc(void)
+{
+    harp_spatial_weights *weights;
+
+    weights = (harp_spatial_weights *)malloc(sizeof(harp_spatial_weights));
+    if (weights == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_spatial_weights), __FILE__, __LINE__);
+        return NULL;
+    }
+    weights->num_latitude_edges = 0;
+    weights->latitude_edges = NULL;
+    weights->num_longitude_edges = 0;
+    weights->longitude_edges = NULL;
+    weights->num_elements = 0;
+    weights->num_vertices = 0;
+    weights->fingerprint = 0;
+    weights->num_latlon_index = NULL;
+    weights->num_cells = 0;
+    weights->latlon_cell_index = NULL;
+    weights->latlon_weight = NULL;
+
+    return weights;
+}
+
+/* allocate an array of 'length' elements of 'element_size' bytes (a zero length results in a one element array) */
+static int spatial_weights_alloc_array(long length, size_t element_size, void **array)
+{
+    size_t num_bytes = (length > 0 ? length : 1) * element_size;
+
+    *array = malloc(num_bytes);
+    if (*array == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", num_bytes,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Determine the spatial weights for binning the samples of a product onto a latitude/longitude grid.
+ * The spatial weights consist of the sparse table of (sample, grid cell, weight) triplets that an area binning of the
+ * product onto the grid (see harp_product_bin_spatial()) uses. Calculating this table (the overlap of the area of each
+ * sample with each grid cell) is the most expensive part of an area binning. When many products share the same fixed
+ * geometry (e.g. level 3 or model data on a fixed grid that is rebinned onto another grid) the table only needs to be
+ * determined once; it can be stored using harp_spatial_weights_write() and be applied to each of the products using
+ * harp_product_bin_spatial_with_weights().
+ *
+ * The product should have latitude_bounds {time,independent} and longitude_bounds {time,independent} variables (or
+ * variables from which these can be derived).
+ *
+ * \param product Product with the samples (the product is not modified).
+ * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
+ * \param latitude_edges latitude grid edge vales
+ * \param num_longitude_edges Number of edges for the longitude grid
+ *        (number of longitude columns = num_longitude_edges - 1)
+ * \param longitude_edges longitude grid edge vales
+ * \param new_weights Pointer to the C variable where the new spatial weights will be stored.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_weights_new(harp_product *product, long num_latitude_edges, const double *latitude_edges,
+                                         long num_longitude_edges, const double *longitude_edges,
+                                         harp_spatial_weights **new_weights)
+{
+    harp_data_type data_type = harp_type_double;
+    harp_dimension_type dimension_type[2];
+    harp_variable *latitude_bounds = NULL;
+    harp_variable *longitude_bounds = NULL;
+    harp_spatial_weights *weights;
+    long i;
+
+    if (check_spatial_grid(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges) != 0)
+    {
+        return -1;
+    }
+
+    dimension_type[0] = harp_dimension_time;
+    dimension_type[1] = harp_dimension_independent;
+    if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, "degree_north", 2, dimension_type,
+                                          &latitude_bounds) != 0)
+    {
+        return -1;
+    }
+    if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, "degree_east", 2, dimension_type,
+                                          &longitude_bounds) != 0)
+    {
+        harp_variable_delete(latitude_bounds);
+        return -1;
+    }
+
+    weights = spatial_weights_alloc();
+    if (weights == NULL)
+    {
+        goto error;
+    }
+    weights->num_latitude_edges = num_latitude_edges;
+    weights->num_longitude_edges = num_longitude_edges;
+    weights->num_elements = latitude_bounds->dimension[0];
+    weights->num_vertices = latitude_bounds->dimension[1];
+    weights->fingerprint = get_bounds_fingerprint(latitude_bounds, longitude_bounds);
+    if (spatial_weights_alloc_array(num_latitude_edges, sizeof(double), (void **)&weights->latitude_edges) != 0)
+    {
+        goto error;
+    }
+    memcpy(weights->latitude_edges, latitude_edges, num_latitude_edges * sizeof(double));
+    if (spatial_weights_alloc_array(num_longitude_edges, sizeof(double), (void **)&weights->longitude_edges) != 0)
+    {
+        goto error;
+    }
+    memcpy(weights->longitude_edges, longitude_edges, num_longitude_edges * sizeof(double));
+    if (spatial_weights_alloc_array(weights->num_elements, sizeof(long), (void **)&weights->num_latlon_index) != 0)
+    {
+        goto error;
+    }
+    if (weights->num_elements > 0)
+    {
+        if (find_matching_cells_and_weights_for_bounds(latitude_bounds, longitude_bounds, num_latitude_edges,
+                                                       weights->latitude_edges, num_longitude_edges,
+                                                       weights->longitude_edges, weights->num_latlon_index,
+                                                       &weights->latlon_cell_index, &weights->latlon_weight) != 0)
+        {
+            goto error;
+        }
+    }
+    for (i = 0; i < weights->num_elements; i++)
+    {
+        weights->num_cells += weights->num_latlon_index[i];
+    }
+
+    harp_variable_delete(latitude_bounds);
+    harp_variable_delete(longitude_bounds);
+
+    *new_weights = weights;
+    return 0;
+
+  error:
+    harp_variable_delete(latitude_bounds);
+    harp_variable_delete(longitude_bounds);
+    harp_spatial_weights_delete(weights);
+    return -1;
+}
+
+/** Remove spatial weights.
+ * \param weights Spatial weights that should be removed.
+ */
+LIBHARP_API void harp_spatial_weights_delete(harp_spatial_weights *weights)
+{
+    if (weights != NULL)
+    {
+        if (weights->latitude_edges != NULL)
+        {
+            free(weights->latitude_edges);
+        }
+        if (weights->longitude_edges != NULL)
+        {
+            free(weights->longitude_edges);
+        }
+        if (weights->num_latlon_index != NULL)
+        {
+            free(weights->num_latlon_index);
+        }
+        if (weights->latlon_cell_index != NULL)
+        {
+            free(weights->latlon_cell_index);
+        }
+        if (weights->latlon_weight != NULL)
+        {
+            free(weights->latlon_weight);
+        }
+        free(weights);
+    }
+}
+
+/** Write spatial weights to a file.
+ * The file can be read again using harp_spatial_weights_read().
+ * \param filename Path of the file that will be (over)written.
+ * \param weights Spatial weights that should be written.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_weights_write(const char *filename, const harp_spatial_weights *weights)
+{
+    unsigned char version[4];
+    FILE *file;
+    long i;
+
+    file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening '%s' for writing", filename);
+        return -1;
+    }
+
+    version[0] = SPATIAL_WEIGHTS_FORMAT_VERSION;
+    version[1] = 0;
+    version[2] = 0;
+    version[3] = 0;
+    if (fwrite(SPATIAL_WEIGHTS_MAGIC, 1, SPATIAL_WEIGHTS_MAGIC_LENGTH, file) != SPATIAL_WEIGHTS_MAGIC_LENGTH ||
+        fwrite(version, 1, 4, file) != 4)
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "error writing spatial weights file");
+        goto error;
+    }
+    if (write_spatial_weights_int64(file, weights->num_latitude_edges) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < weights->num_latitude_edges; i++)
+    {
+        if (write_spatial_weights_double(file, weights->latitude_edges[i]) != 0)
+        {
+            goto error;
+        }
+    }
+    if (write_spatial_weights_int64(file, weights->num_longitude_edges) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < weights->num_longitude_edges; i++)
+    {
+        if (write_spatial_weights_double(file, weights->longitude_edges[i]) != 0)
+        {
+            goto error;
+        }
+    }
+    if (write_spatial_weights_int64(file, weights->num_elements) != 0 ||
+        write_spatial_weights_int64(file, weights->num_vertices) != 0 ||
+        write_spatial_weights_int64(file, (int64_t)weights->fingerprint) != 0 ||
+        write_spatial_weights_int64(file, weights->num_cells) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < weights->num_elements; i++)
+    {
+        if (write_spatial_weights_int64(file, weights->num_latlon_index[i]) != 0)
+        {
+            goto error;
+        }
+    }
+    for (i = 0; i < weights->num_cells; i++)
+    {
+        if (write_spatial_weights_int64(file, weights->latlon_cell_index[i]) != 0)
+        {
+            goto error;
+        }
+    }
+    for (i = 0; i < weights->num_cells; i++)
+    {
+        if (write_spatial_weights_double(file, weights->latlon_weight[i]) != 0)
+        {
+            goto error;
+        }
+    }
+
+    if (fclose(file) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "error closing spatial weights file");
+        return -1;
+    }
+
+    return 0;
+
+  error:
+    fclose(file);
+    return -1;
+}
+
+/** Read spatial weights from a file.
+ * \param filename Path of a file that was written using harp_spatial_weights_write().
+ * \param new_weights Pointer to the C variable where the spatial weights will be stored.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_weights_read(const char *filename, harp_spatial_weights **new_weights)
+{
+    harp_spatial_weights *weights;
+    unsigned char header[SPATIAL_WEIGHTS_MAGIC_LENGTH + 4];
+    long spatial_block_length;
+    long num_cells = 0;
+    int64_t value;
+    FILE *file;
+    long i;
+
+    file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening spatial weights file '%s'", filename);
+        return -1;
+    }
+
+    weights = spatial_weights_alloc();
+    if (weights == NULL)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    if (fread(header, 1, SPATIAL_WEIGHTS_MAGIC_LENGTH + 4, file) != SPATIAL_WEIGHTS_MAGIC_LENGTH + 4 ||
+        memcmp(header, SPATIAL_WEIGHTS_MAGIC, SPATIAL_WEIGHTS_MAGIC_LENGTH) != 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "'%s' is not a spatial weights file", filename);
+        goto error;
+    }
+    if (header[SPATIAL_WEIGHTS_MAGIC_LENGTH] != SPATIAL_WEIGHTS_FORMAT_VERSION ||
+        header[SPATIAL_WEIGHTS_MAGIC_LENGTH + 1] != 0 || header[SPATIAL_WEIGHTS_MAGIC_LENGTH + 2] != 0 ||
+        header[SPATIAL_WEIGHTS_MAGIC_LENGTH + 3] != 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "unsupported format version of spatial weights file '%s'",
+                       filename);
+        goto error;
+    }
+
+    if (read_spatial_weights_length(file, &weights->num_latitude_edges) != 0 ||
+        spatial_weights_alloc_array(weights->num_latitude_edges, sizeof(double),
+                                    (void **)&weights->latitude_edges) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < weights->num_latitude_edges; i++)
+    {
+        if (read_spatial_weights_double(file, &weights->latitude_edges[i]) != 0)
+        {
+            goto error;
+        }
+    }
+    if (read_spatial_weights_length(file, &weights->num_longitude_edges) != 0 ||
+        spatial_weights_alloc_array(weights->num_longitude_edges, sizeof(double),
+                                    (void **)&weights->longitude_edges) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < weights->num_longitude_edges; i++)
+    {
+        if (read_spatial_weights_double(file, &weights->longitude_edges[i]) != 0)
+        {
+            goto error;
+        }
+    }
+    if (check_spatial_grid(weights->num_latitude_edges, weights->latitude_edges, weights->num_longitude_edges,
+                           weights->longitude_edges) != 0)
+    {
+        goto error;
+    }
+    spatial_block_length = (weights->num_latitude_edges - 1) * (weights->num_longitude_edges - 1);
+
+    if (read_spatial_weights_length(file, &weights->num_elements) != 0 ||
+        read_spatial_weights_length(file, &weights->num_vertices) != 0 ||
+        read_spatial_weights_int64(file, &value) != 0 || read_spatial_weights_length(file, &weights->num_cells) != 0)
+    {
+        goto error;
+    }
+    weights->fingerprint = (uint64_t)value;
+
+    if (spatial_weights_alloc_array(weights->num_elements, sizeof(long), (void **)&weights->num_latlon_index) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < weights->num_elements; i++)
+    {
+        if (read_spatial_weights_length(file, &weights->num_latlon_index[i]) != 0)
+        {
+            goto error;
+        }
+        num_cells += weights->num_latlon_index[i];
+    }
+    if (num_cells != weights->num_cells)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "inconsistent number of cells in spatial weights file '%s'",
+                       filename);
+        goto error;
+    }
+    if (spatial_weights_alloc_array(weights->num_cells, sizeof(long), (void **)&weights->latlon_cell_index) != 0 ||
+        spatial_weights_alloc_array(weights->num_cells, sizeof(double), (void **)&weights->latlon_weight) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < weights->num_cells; i++)
+    {
+        if (read_spatial_weights_length(file, &weights->latlon_cell_index[i]) != 0)
+        {
+            goto error;
+        }
+        if (weights->latlon_cell_index[i] >= spatial_block_length)
+        {
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid cell index (%ld) in spatial weights file '%s'",
+                           weights->latlon_cell_index[i], filename);
+            goto error;
+        }
+    }
+    for (i = 0; i < weights->num_cells; i++)
+    {
+        if (read_spatial_weights_double(file, &weights->latlon_weight[i]) != 0)
+        {
+            goto error;
+        }
+    }
+
+    fclose(file);
+
+    *new_weights = weights;
+    return 0;
+
+  error:
+    fclose(file);
+    harp_spatial_weights_delete(weights);
+    return -1;
+}
+
+/** Bin the product's variables into a spatial grid using precomputed spatial weights.
+ * This performs the same area binning as harp_product_bin_spatial() with a single time bin, onto the grid for which
+ * the spatial weights were determined (see harp_spatial_weights_new()). Instead of calculating the overlap of each
+ * sample with the grid cells, the matching cells and weights are taken from the spatial weights.
+ *
+ * The spatial weights should have been determined for samples with exactly the same latitude/longitude bounds as the
+ * product (this is verified using a fingerprint of the bounds).
+ *
+ * \param product Product to regrid.
+ * \param weights Spatial weights for the geometry of the product.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_bin_spatial_with_weights(harp_product *product, const harp_spatial_weights *weights)
+{
+    return bin_spatial_single_time_bin(product, weights->num_latitude_edges, weights->latitude_edges,
+                                       weights->num_longitude_edges, weights->longitude_edges, NULL, weights);
+}
+
+/* sum of the weights for each element of one or more variables of a compact spatial accumulator.
+ * Variables start out sharing the weights with all variables of the same size that were added for the same product.
+ * A variable gets its own copy of the weights as soon as the weights that it adds for a product differ from those of
+ * the other variables (i.e. because its validity mask differs).
+ */
+typedef struct accumulator_weight_struct
+{
+    long num_elements;
+    double *weight;     /* accumulated sum of the weights */
+    double *pending;    /* weights of the product that is being added (NULL if these are all zero) */
+    int num_users;      /* number of variables that use these weights */
+    int num_pending_users;      /* number of variables that added the pending weights for the current product */
+    int is_empty;       /* whether all accumulated weights are still zero */
+} accumulator_weight;
+
+/* accumulated values of a single variable of a spatial accumulator */
+typedef struct accumulator_variable_struct
+{
+    binning_type type;
+    harp_variable *variable;    /* weighted sums (average/angle; float in compact mode), sums (int32), or
+                                 * minimum/maximum values */
+    double *weight;     /* sum of the weights for each element (only for average/angle variables) */
+    double *imag;       /* weighted sum of the sine of the angles (only for angle variables) */
+    /* compact mode only (for average/angle variables) */
+    float *compensation;        /* compensation terms of the (float) weighted sums */
+    float *compact_imag;        /* weighted float sum of the sine of the angles (only for angle variables) */
+    float *imag_compensation;   /* compensation terms of compact_imag (only for angle variables) */
+    accumulator_weight *shared_weight;  /* (possibly shared) sum of the weights for each element */
+    int has_pending_weight;     /* whether the weights for the current product were added */
+    int has_count;      /* whether a '<variable>_count' variable should be included in the result */
+} accumulator_variable;
+
+struct harp_spatial_accumulator_struct
+{
+    long num_latitude_edges;
+    double *latitude_edges;
+    long num_longitude_edges;
+    double *longitude_edges;
+    int num_variables;
+    accumulator_variable *variable;
+    int compact;        /* use float sums with compensated summation and shared weights */
+    harp_bin_aggregation_list *aggregation;     /* median and percentile aggregations (NULL if there are none) */
+    percentile_sketch_list percentile;  /* sketches for the variables of the aggregations */
+};
+
+/* returns whether the name of the variable is '<name><suffix>' for a variable <name> that exists in the product */
+static int is_companion_variable(const harp_product *product, const harp_variable *variable, const char *suffix)
+{
+    char variable_name[MAX_NAME_LENGTH];
+    long name_length = (long)strlen(variable->name);
+    long suffix_length = (long)strlen(suffix);
+
+    if (name_length <= suffix_length || name_length - suffix_length >= MAX_NAME_LENGTH ||
+        strcmp(&variable->name[name_length - suffix_length], suffix) != 0)
+    {
+        return 0;
+    }
+    memcpy(variable_name, variable->name, name_length - suffix_length);
+    variable_name[name_length - suffix_length] = '\0';
+
+    return harp_product_has_variable(product, variable_name);
+}
+
+/* determine how a variable of a spatially binned product gets accumulated;
+ * binning_skip is used for variables without time dimension (these are taken from the first product) and
+ * binning_remove for weight/count variables (these are used when accumulating the variable they belong to).
+ */
+static binning_type get_accumulator_binning_type(const harp_product *product, harp_variable *variable)
+{
+    if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        return binning_skip;
+    }
+    if (is_companion_variable(product, variable, "_weight") || is_companion_variable(product, variable, "_count"))
+    {
+        return binning_remove;
+    }
+    if (variable->data_type == harp_type_int32)
+    {
+        return binning_sum;
+    }
+    if (variable->data_type != harp_type_double)
+    {
+        return binning_remove;
+    }
+    if (variable->num_dimensions == 1)
+    {
+        if (strcmp(variable->name, "datetime_start") == 0)
+        {
+            return binning_time_min;
+        }
+        if (strcmp(variable->name, "datetime_stop") == 0)
+        {
+            return binning_time_max;
+        }
+    }
+    if (get_binning_type(variable) == binning_angle)
+    {
+        return binning_angle;
+    }
+
+    return binning_average;
+}
+
+static int has_same_dimensions(const harp_variable *variable, const harp_variable *other_variable)
+{
+    int i;
+
+    if (variable->num_dimensions != other_variable->num_dimensions)
+    {
+        return 0;
+    }
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        if (variable->dimension_type[i] != other_variable->dimension_type[i] ||
+            variable->dimension[i] != other_variable->dimension[i])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* get the weight of each element of a variable of a spatially binned product.
+ * the weights are taken from the '<variable>_weight' (area binning) or '<variable>_count' (point binning) variable or,
+ * if these don't exist, from the 'count' variable. *has_count is set if a '<variable>_count' variable was used.
+ */
+static int get_accumulator_weights(const harp_product *product, const harp_variable *variable, double *weight,
+                                   int *has_count)
+{
+    char variable_name[MAX_NAME_LENGTH];
+    harp_variable *weight_variable;
+    long i, j;
+
+    *has_count = 0;
+
+    snprintf(variable_name, MAX_NAME_LENGTH, "%s_weight", variable->name);
+    if (harp_product_get_variable_by_name(product, variable_name, &weight_variable) == 0 &&
+        weight_variable->data_type == harp_type_double && weight_variable->num_elements == variable->num_elements)
+    {
+        memcpy(weight, weight_variable->data.double_data, variable->num_elements * sizeof(double));
+        return 0;
+    }
+
+    snprintf(variable_name, MAX_NAME_LENGTH, "%s_count", variable->name);
+    if (harp_product_get_variable_by_name(product, variable_name, &weight_variable) == 0 &&
+        weight_variable->data_type == harp_type_int32 && has_same_dimensions(weight_variable, variable))
+    {
+        for (i = 0; i < variable->num_elements; i++)
+        {
+            weight[i] = weight_variable->data.int32_data[i];
+        }
+        *has_count = 1;
+        return 0;
+    }
+
+    if (harp_product_get_variable_by_name(product, "count", &weight_variable) == 0 &&
+        weight_variable->data_type == harp_type_int32)
+    {
+        int num_dimensions = weight_variable->num_dimensions;
+        int match = 1;
+
+        /* the dimensions of one variable should match the leading dimensions of the other */
+        if (num_dimensions > variable->num_dimensions)
+        {
+            num_dimensions = variable->num_dimensions;
+        }
+        for (i = 0; i < num_dimensions; i++)
+        {
+            if (weight_variable->dimension_type[i] != variable->dimension_type[i] ||
+                weight_variable->dimension[i] != variable->dimension[i])
+            {
+                match = 0;
+                break;
+            }
+        }
+        if (match)
+        {
+            if (weight_variable->num_elements <= variable->num_elements)
+            {
+                long num_sub_elements = variable->num_elements / weight_variable->num_elements;
+
+                for (i = 0; i < weight_variable->num_elements; i++)
                 {
-                    if (count_variable->data.int32_data[i] == 0)
-                    {
-                        variable->data.double_data[i] = nan_value;
-                    }
-                    else if (count_variable->data.int32_data[i] > 1)
+                    for (j = 0; j < num_sub_elements; j++)
                     {
-                        variable->data.double_data[i] /= count_variable->data.int32_data[i];
+                        weight[i * num_sub_elements + j] = weight_variable->data.int32_data[i];
                     }
                 }
             }
             else
             {
+                long num_sub_elements = weight_variable->num_elements / variable->num_elements;
+
                 for (i = 0; i < variable->num_elements; i++)
                 {
-                    if (time_count[i] == 0)
+                    weight[i] = 0;
+                    for (j = 0; j < num_sub_elements; j++)
                     {
-                        variable->data.double_data[i] = nan_value;
-                    }
-                    else if (time_count[i] > 1)
-                    {
-                        variable->data.double_data[i] /= time_count[i];
+                        weight[i] += weight_variable->data.int32_data[i * num_sub_elements + j];
                     }
                 }
             }
+            return 0;
+        }
+    }
+
+    /* use equal weights if there is no count information */
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        weight[i] = 1;
+    }
+
+    return 0;
+}
+
+static void accumulator_weight_delete(accumulator_weight *weight)
+{
+    if (weight->weight != NULL)
+    {
+        free(weight->weight);
+    }
+    if (weight->pending != NULL)
+    {
+        free(weight->pending);
+    }
+    free(weight);
+}
+
+/* create new (unshared) weights; the accumulated weights are copied from 'weight' (or set to zero if it is NULL) */
+static int accumulator_weight_new(long num_elements, const double *weight, accumulator_weight **new_weight)
+{
+    accumulator_weight *shared_weight;
+    long i;
+
+    shared_weight = malloc(sizeof(accumulator_weight));
+    if (shared_weight == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(accumulator_weight), __FILE__, __LINE__);
+        return -1;
+    }
+    shared_weight->num_elements = num_elements;
+    shared_weight->pending = NULL;
+    shared_weight->num_users = 1;
+    shared_weight->num_pending_users = 0;
+    shared_weight->is_empty = 1;
+    shared_weight->weight = malloc(num_elements * sizeof(double));
+    if (shared_weight->weight == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(double), __FILE__, __LINE__);
+        free(shared_weight);
+        return -1;
+    }
+    if (weight != NULL)
+    {
+        memcpy(shared_weight->weight, weight, num_elements * sizeof(double));
+    }
+    else
+    {
+        for (i = 0; i < num_elements; i++)
+        {
+            shared_weight->weight[i] = 0;
+        }
+    }
+
+    *new_weight = shared_weight;
+    return 0;
+}
+
+/* returns whether the pending weights of two products are the same (NULL means all weights are zero) */
+static int is_same_pending_weight(long num_elements, const double *weight, const double *other_weight)
+{
+    long i;
+
+    if (weight == NULL && other_weight == NULL)
+    {
+        return 1;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        if ((weight == NULL ? 0 : weight[i]) != (other_weight == NULL ? 0 : other_weight[i]))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Register the weights that a variable of a compact accumulator adds for the current product (NULL if all weights
+ * are zero). The first user of the shared weights stores them as the pending weights; the other users only compare
+ * against them and get their own copy of the (not yet updated) accumulated weights if they differ.
+ */
+static int accumulator_add_pending_weight(accumulator_variable *entry, const double *weight)
+{
+    accumulator_weight *shared_weight = entry->shared_weight;
+    accumulator_weight *own_weight;
+    long num_elements = shared_weight->num_elements;
+
+    assert(!entry->has_pending_weight);
+    entry->has_pending_weight = 1;
+
+    if (shared_weight->num_pending_users > 0 &&
+        is_same_pending_weight(num_elements, shared_weight->pending, weight))
+    {
+        shared_weight->num_pending_users++;
+        return 0;
+    }
+    if (shared_weight->num_pending_users > 0)
+    {
+        /* the validity mask of this variable differs from that of the other users */
+        if (accumulator_weight_new(num_elements, shared_weight->weight, &own_weight) != 0)
+        {
+            return -1;
+        }
+        own_weight->is_empty = shared_weight->is_empty;
+        shared_weight->num_users--;
+        entry->shared_weight = own_weight;
+        shared_weight = own_weight;
+    }
+
+    if (weight != NULL)
+    {
+        shared_weight->pending = malloc(num_elements * sizeof(double));
+        if (shared_weight->pending == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_elements * sizeof(double), __FILE__, __LINE__);
+            return -1;
+        }
+        memcpy(shared_weight->pending, weight, num_elements * sizeof(double));
+    }
+    shared_weight->num_pending_users = 1;
+
+    return 0;
+}
+
+/* add the pending weights of the current product to the accumulated weights of a compact accumulator */
+static int accumulator_apply_pending_weights(harp_spatial_accumulator *accumulator)
+{
+    int k;
+
+    /* variables that were not part of the product add zero weights */
+    for (k = 0; k < accumulator->num_variables; k++)
+    {
+        accumulator_variable *entry = &accumulator->variable[k];
+
+        if (entry->shared_weight != NULL && !entry->has_pending_weight)
+        {
+            if (accumulator_add_pending_weight(entry, NULL) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+    for (k = 0; k < accumulator->num_variables; k++)
+    {
+        accumulator_variable *entry = &accumulator->variable[k];
+        accumulator_weight *shared_weight = entry->shared_weight;
+
+        if (shared_weight == NULL)
+        {
+            continue;
+        }
+        entry->has_pending_weight = 0;
+        if (shared_weight->num_pending_users == 0)
+        {
+            /* already applied via another user */
+            continue;
+        }
+        if (shared_weight->pending != NULL)
+        {
+            long i;
+
+            for (i = 0; i < shared_weight->num_elements; i++)
+            {
+                shared_weight->weight[i] += shared_weight->pending[i];
+            }
+            free(shared_weight->pending);
+            shared_weight->pending = NULL;
+            shared_weight->is_empty = 0;
+        }
+        shared_weight->num_pending_users = 0;
+    }
+
+    return 0;
+}
+
+/* Add value to a float sum using Neumaier's variant of Kahan summation. The part of the (double) value that can not be
+ * represented as a float is added to the compensation directly.
+ */
+static void compensated_add(float *sum, float *compensation, double value)
+{
+    float x = (float)value;
+    float t = *sum + x;
+
+    if (fabsf(*sum) >= fabsf(x))
+    {
+        *compensation += (*sum - t) + x;
+    }
+    else
+    {
+        *compensation += (x - t) + *sum;
+    }
+    *compensation += (float)(value - x);
+    *sum = t;
+}
+
+static const double *accumulator_variable_get_weight(const accumulator_variable *entry)
+{
+    if (entry->shared_weight != NULL)
+    {
+        return entry->shared_weight->weight;
+    }
+    return entry->weight;
+}
+
+static void accumulator_variable_done(accumulator_variable *entry)
+{
+    if (entry->variable != NULL)
+    {
+        harp_variable_delete(entry->variable);
+    }
+    if (entry->weight != NULL)
+    {
+        free(entry->weight);
+    }
+    if (entry->imag != NULL)
+    {
+        free(entry->imag);
+    }
+    if (entry->compensation != NULL)
+    {
+        free(entry->compensation);
+    }
+    if (entry->compact_imag != NULL)
+    {
+        free(entry->compact_imag);
+    }
+    if (entry->imag_compensation != NULL)
+    {
+        free(entry->imag_compensation);
+    }
+    if (entry->shared_weight != NULL)
+    {
+        entry->shared_weight->num_users--;
+        if (entry->shared_weight->num_users == 0)
+        {
+            accumulator_weight_delete(entry->shared_weight);
+        }
+    }
+}
+
+/* allocate a float array of num_elements zeros */
+static int new_zero_float_array(long num_elements, float **array)
+{
+    long i;
+
+    *array = malloc(num_elements * sizeof(float));
+    if (*array == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(float), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        (*array)[i] = 0;
+    }
+
+    return 0;
+}
+
+/* add a new (empty) average/angle entry to a compact accumulator using the given variable as template */
+static int accumulator_init_compact_variable(harp_spatial_accumulator *accumulator, accumulator_variable *entry,
+                                             const harp_variable *variable)
+{
+    long num_elements = variable->num_elements;
+    int k;
+
+    if (harp_variable_new(variable->name, harp_type_float, variable->num_dimensions, variable->dimension_type,
+                          variable->dimension, &entry->variable) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_copy_attributes(variable, entry->variable) != 0)
+    {
+        return -1;
+    }
+    memset(entry->variable->data.float_data, 0, num_elements * sizeof(float));
+    if (new_zero_float_array(num_elements, &entry->compensation) != 0)
+    {
+        return -1;
+    }
+    if (entry->type == binning_angle)
+    {
+        if (new_zero_float_array(num_elements, &entry->compact_imag) != 0)
+        {
+            return -1;
+        }
+        if (new_zero_float_array(num_elements, &entry->imag_compensation) != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* share the weights with a variable of the same size for which no weights have been accumulated yet */
+    for (k = 0; k < accumulator->num_variables; k++)
+    {
+        accumulator_weight *shared_weight = accumulator->variable[k].shared_weight;
+
+        if (shared_weight != NULL && shared_weight->is_empty && shared_weight->num_elements == num_elements)
+        {
+            shared_weight->num_users++;
+            entry->shared_weight = shared_weight;
+            return 0;
+        }
+    }
+
+    return accumulator_weight_new(num_elements, NULL, &entry->shared_weight);
+}
+
+/* add a new (empty) entry to the accumulator using the given variable as template */
+static int accumulator_add_variable(harp_spatial_accumulator *accumulator, binning_type type,
+                                    const harp_variable *variable)
+{
+    accumulator_variable *entry;
+    long i;
+
+    if (accumulator->num_variables % ACCUMULATOR_BLOCK_SIZE == 0)
+    {
+        accumulator_variable *new_variable;
+
+        new_variable = realloc(accumulator->variable,
+                               (accumulator->num_variables + ACCUMULATOR_BLOCK_SIZE) * sizeof(accumulator_variable));
+        if (new_variable == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (accumulator->num_variables + ACCUMULATOR_BLOCK_SIZE) * sizeof(accumulator_variable),
+                           __FILE__, __LINE__);
+            return -1;
+        }
+        accumulator->variable = new_variable;
+    }
+    entry = &accumulator->variable[accumulator->num_variables];
+    entry->type = type;
+    entry->variable = NULL;
+    entry->weight = NULL;
+    entry->imag = NULL;
+    entry->compensation = NULL;
+    entry->compact_imag = NULL;
+    entry->imag_compensation = NULL;
+    entry->shared_weight = NULL;
+    entry->has_pending_weight = 0;
+    entry->has_count = 0;
+
+    if (accumulator->compact && (type == binning_average || type == binning_angle))
+    {
+        if (accumulator_init_compact_variable(accumulator, entry, variable) != 0)
+        {
+            accumulator_variable_done(entry);
+            return -1;
+        }
+        accumulator->num_variables++;
+        return 0;
+    }
+
+    if (harp_variable_copy(variable, &entry->variable) != 0)
+    {
+        return -1;
+    }
+    if (type == binning_skip)
+    {
+        accumulator->num_variables++;
+        return 0;
+    }
+
+    if (type == binning_average || type == binning_angle)
+    {
+        entry->weight = malloc(variable->num_elements * sizeof(double));
+        if (entry->weight == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           variable->num_elements * sizeof(double), __FILE__, __LINE__);
+            accumulator_variable_done(entry);
+            return -1;
+        }
+        if (type == binning_angle)
+        {
+            entry->imag = malloc(variable->num_elements * sizeof(double));
+            if (entry->imag == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               variable->num_elements * sizeof(double), __FILE__, __LINE__);
+                accumulator_variable_done(entry);
+                return -1;
+            }
+        }
+    }
+
+    /* initialize the accumulated values */
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        if (type == binning_sum)
+        {
+            entry->variable->data.int32_data[i] = 0;
+        }
+        else if (type == binning_time_min || type == binning_time_max)
+        {
+            entry->variable->data.double_data[i] = harp_nan();
         }
         else
         {
-            long num_sub_elements;
-            int count_applied = 0;
+            entry->variable->data.double_data[i] = 0;
+            entry->weight[i] = 0;
+            if (entry->imag != NULL)
+            {
+                entry->imag[i] = 0;
+            }
+        }
+    }
+    accumulator->num_variables++;
 
-            num_sub_elements = variable->num_elements / (num_time_bins * spatial_block_length);
+    return 0;
+}
+
+/* find the accumulator entry for a variable; returns -1 if there is none */
+static int accumulator_find_variable(const harp_spatial_accumulator *accumulator, const char *name)
+{
+    int i;
+
+    for (i = 0; i < accumulator->num_variables; i++)
+    {
+        if (strcmp(accumulator->variable[i].variable->name, name) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* add the values of a variable of a spatially binned product to the accumulated values */
+static int accumulate_variable(accumulator_variable *entry, const harp_product *product, harp_variable *variable,
+                               double *weight)
+{
+    double *data = entry->variable->data.double_data;
+    int has_count;
+    long i;
 
-            if (bintype[k] == binning_angle)
+    switch (entry->type)
+    {
+        case binning_skip:
+            break;
+        case binning_sum:
+            for (i = 0; i < variable->num_elements; i++)
             {
-                /* convert angle variables back from complex values to angles */
-                for (i = 0; i < variable->num_elements; i += 2)
-                {
-                    variable->data.double_data[i] = atan2(variable->data.double_data[i + 1],
-                                                          variable->data.double_data[i]);
-                }
-                if (harp_variable_remove_dimension(variable, variable->num_dimensions - 1, 0) != 0)
+                entry->variable->data.int32_data[i] += variable->data.int32_data[i];
+            }
+            break;
+        case binning_time_min:
+        case binning_time_max:
+            if (harp_variable_convert_unit(variable, entry->variable->unit) != 0)
+            {
+                return -1;
+            }
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                double value = variable->data.double_data[i];
+
+                if (!harp_isnan(value) && (harp_isnan(data[i]) || (entry->type == binning_time_min && value < data[i])
+                                           || (entry->type == binning_time_max && value > data[i])))
                 {
-                    goto error;
+                    data[i] = value;
                 }
-                num_sub_elements /= 2;
-                /* convert all angles back to the original unit */
-                if (harp_convert_unit("rad", variable->unit, variable->num_elements, variable->data.double_data) != 0)
+            }
+            break;
+        case binning_average:
+        case binning_angle:
+            if (get_accumulator_weights(product, variable, weight, &has_count) != 0)
+            {
+                return -1;
+            }
+            entry->has_count |= has_count;
+            if (entry->type == binning_angle)
+            {
+                if (harp_variable_convert_unit(variable, "rad") != 0)
                 {
-                    goto error;
+                    return -1;
                 }
+            }
+            else if (harp_variable_convert_unit(variable, entry->variable->unit) != 0)
+            {
+                return -1;
+            }
+            if (entry->shared_weight != NULL)
+            {
+                float *sum = entry->variable->data.float_data;
+                int has_weight = 0;
 
-                if (!area_binning)
+                for (i = 0; i < variable->num_elements; i++)
                 {
-                    harp_variable *count_variable;
+                    double value = variable->data.double_data[i];
 
-                    /* set values to NaN if count==0 */
-                    if (get_count_variable_for_variable(product, variable, bintype, &count_variable) != 0)
-                    {
-                        goto error;
-                    }
-                    if (count_variable != NULL)
+                    if (weight[i] > 0 && !harp_isnan(value))
                     {
-                        int count_index;
-
-                        for (i = 0; i < variable->num_elements; i++)
+                        if (entry->type == binning_angle)
                         {
-                            if (count_variable->data.int32_data[i] == 0)
-                            {
-                                variable->data.double_data[i] = nan_value;
-                            }
+                            compensated_add(&sum[i], &entry->compensation[i], weight[i] * cos(value));
+                            compensated_add(&entry->compact_imag[i], &entry->imag_compensation[i],
+                                            weight[i] * sin(value));
                         }
-                        count_applied = 1;
-
-                        /* remove the count variable for angles, since it is meaningless for further propagation of averages */
-                        if (harp_product_get_variable_index_by_name(product, count_variable->name, &count_index) != 0)
+                        else
                         {
-                            goto error;
+                            compensated_add(&sum[i], &entry->compensation[i], weight[i] * value);
                         }
-                        bintype[count_index] = binning_remove;
+                        has_weight = 1;
+                    }
+                    else
+                    {
+                        /* the weight array now contains the weights of the elements that were added */
+                        weight[i] = 0;
                     }
                 }
+                if (accumulator_add_pending_weight(entry, has_weight ? weight : NULL) != 0)
+                {
+                    return -1;
+                }
+                break;
             }
-
-            if (!area_binning && !count_applied)
+            for (i = 0; i < variable->num_elements; i++)
             {
-                double nan_value = harp_nan();
+                double value = variable->data.double_data[i];
 
-                /* divide variables by the sample count and/or set values to NaN if count==0 */
-                if (bintype[k] == binning_average)
+                if (weight[i] > 0 && !harp_isnan(value))
                 {
-                    int result;
-
-                    result = get_count_for_variable(product, variable, bintype, filtered_count);
-                    if (result < 0)
-                    {
-                        goto error;
-                    }
-                    if (result == 1)
+                    if (entry->type == binning_angle)
                     {
-                        /* divide by the count (or set value to NaN if count==0) */
-                        for (i = 0; i < variable->num_elements; i++)
-                        {
-                            if (filtered_count[i] == 0)
-                            {
-                                variable->data.double_data[i] = nan_value;
-                            }
-                            else if (filtered_count[i] > 1)
-                            {
-                                variable->data.double_data[i] /= filtered_count[i];
-                            }
-                        }
+                        data[i] += weight[i] * cos(value);
+                        entry->imag[i] += weight[i] * sin(value);
                     }
                     else
                     {
-                        for (i = 0; i < num_time_bins * spatial_block_length; i++)
-                        {
-                            if (count[i] == 0)
-                            {
-                                for (j = 0; j < num_sub_elements; j++)
-                                {
-                                    variable->data.double_data[i * num_sub_elements + j] = nan_value;
-                                }
-                            }
-                            else
-                            {
-                                for (j = 0; j < num_sub_elements; j++)
-                                {
-                                    variable->data.double_data[i * num_sub_elements + j] /= count[i];
-                                }
-                            }
-                        }
-                    }
-                }
-                else
-                {
-                    /* set all empty bins to NaN (for double) or 0 (for int32) */
-                    for (i = 0; i < num_time_bins * spatial_block_length; i++)
-                    {
-                        if (count[i] == 0)
-                        {
-                            if (variable->data_type == harp_type_int32)
-                            {
-                                for (j = 0; j < num_sub_elements; j++)
-                                {
-                                    variable->data.int32_data[i * num_sub_elements + j] = 0;
-                                }
-                            }
-                            else
-                            {
-                                for (j = 0; j < num_sub_elements; j++)
-                                {
-                                    variable->data.double_data[i * num_sub_elements + j] = nan_value;
-                                }
-                            }
-                        }
+                        data[i] += weight[i] * value;
                     }
+                    entry->weight[i] += weight[i];
                 }
             }
+            break;
+        default:
+            assert(0);
+            exit(1);
+    }
+
+    return 0;
+}
+
+/** Create a new spatial accumulator.
+ * A spatial accumulator can be used to spatially bin a (possibly very large) series of products onto a single
+ * latitude/longitude grid (e.g. to create a level 3 product from many orbits of level 2 data) without having to merge
+ * all products first. Only the accumulated values per grid cell are kept in memory, so memory usage depends on the
+ * size of the grid and not on the number of products that are added.
+ *
+ * Products are added using harp_spatial_accumulator_add_product() and the final result can be retrieved using
+ * harp_spatial_accumulator_get_product(). The result is the same as performing a harp_product_bin_spatial() with a
+ * single time bin on the concatenation of all added products (up to rounding differences).
+ *
+ * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
+ * \param latitude_edges latitude grid edge vales
+ * \param num_longitude_edges Number of edges for the longitude grid
+ *        (number of longitude columns = num_longitude_edges - 1)
+ * \param longitude_edges longitude grid edge vales
+ * \param new_accumulator Pointer to the C variable where the new spatial accumulator will be stored.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_accumulator_new(long num_latitude_edges, const double *latitude_edges,
+                                             long num_longitude_edges, const double *longitude_edges,
+                                             harp_spatial_accumulator **new_accumulator)
+{
+    harp_spatial_accumulator *accumulator;
+
+    if (check_spatial_grid(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges) != 0)
+    {
+        return -1;
+    }
+
+    accumulator = (harp_spatial_accumulator *)malloc(sizeof(harp_spatial_accumulator));
+    if (accumulator == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_spatial_accumulator), __FILE__, __LINE__);
+        return -1;
+    }
+    accumulator->num_latitude_edges = num_latitude_edges;
+    accumulator->latitude_edges = NULL;
+    accumulator->num_longitude_edges = num_longitude_edges;
+    accumulator->longitude_edges = NULL;
+    accumulator->num_variables = 0;
+    accumulator->variable = NULL;
+    accumulator->compact = 0;
+    accumulator->aggregation = NULL;
+    accumulator->percentile.num_variables = 0;
+    accumulator->percentile.variable = NULL;
+
+    accumulator->latitude_edges = malloc(num_latitude_edges * sizeof(double));
+    if (accumulator->latitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_latitude_edges * sizeof(double), __FILE__, __LINE__);
+        harp_spatial_accumulator_delete(accumulator);
+        return -1;
+    }
+    memcpy(accumulator->latitude_edges, latitude_edges, num_latitude_edges * sizeof(double));
+    accumulator->longitude_edges = malloc(num_longitude_edges * sizeof(double));
+    if (accumulator->longitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_longitude_edges * sizeof(double), __FILE__, __LINE__);
+        harp_spatial_accumulator_delete(accumulator);
+        return -1;
+    }
+    memcpy(accumulator->longitude_edges, longitude_edges, num_longitude_edges * sizeof(double));
+
+    *new_accumulator = accumulator;
+    return 0;
+}
+
+/** Delete a spatial accumulator.
+ * \param accumulator Spatial accumulator to delete.
+ */
+LIBHARP_API void harp_spatial_accumulator_delete(harp_spatial_accumulator *accumulator)
+{
+    int i;
+
+    if (accumulator == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < accumulator->num_variables; i++)
+    {
+        accumulator_variable_done(&accumulator->variable[i]);
+    }
+    if (accumulator->variable != NULL)
+    {
+        free(accumulator->variable);
+    }
+    if (accumulator->aggregation != NULL)
+    {
+        harp_bin_aggregation_list_delete(accumulator->aggregation);
+    }
+    for (i = 0; i < accumulator->percentile.num_variables; i++)
+    {
+        percentile_sketch *entry = &accumulator->percentile.variable[i];
+
+        if (entry->sketch != NULL)
+        {
+            long j;
+
+            for (j = 0; j < entry->num_cells; j++)
+            {
+                quantile_sketch_done(&entry->sketch[j]);
+            }
+            free(entry->sketch);
+        }
+        free(entry->variable_name);
+        if (entry->unit != NULL)
+        {
+            free(entry->unit);
+        }
+    }
+    if (accumulator->percentile.variable != NULL)
+    {
+        free(accumulator->percentile.variable);
+    }
+    if (accumulator->latitude_edges != NULL)
+    {
+        free(accumulator->latitude_edges);
+    }
+    if (accumulator->longitude_edges != NULL)
+    {
+        free(accumulator->longitude_edges);
+    }
+    free(accumulator);
+}
+
+/** Add median and/or percentile aggregations to a spatial accumulator.
+ * The specification has the form '<variable>:<statistic>[,<statistic>...]' where each statistic is either 'median' or
+ * 'p<N>' (the N-th percentile, with N an integer in the range 0..100). For each statistic the product that is
+ * retrieved with harp_spatial_accumulator_get_product() will contain a '<variable>_median' or '<variable>_p<N>'
+ * variable with the same dimensions as the binned variable.
+ * The samples of all added products are kept in a sketch per grid cell (see
+ * harp_set_option_percentile_compression()), so memory usage is bounded independent of the number of products that
+ * are added.
+ * Aggregations can only be added before the first (non-empty) product is added to the accumulator. The variable needs
+ * to be a variable that is averaged by the spatial binning.
+ *
+ * \param accumulator Spatial accumulator.
+ * \param specification Aggregation specification.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_accumulator_add_aggregation(harp_spatial_accumulator *accumulator,
+                                                         const char *specification)
+{
+    harp_bin_aggregation_list *aggregation;
+    percentile_sketch *entry;
+    const char *variable_name;
+    long i;
+    int j;
+
+    if (accumulator->num_variables > 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "aggregations need to be added to the spatial accumulator before "
+                       "the first product");
+        return -1;
+    }
+    /* verify the specification before changing the accumulator */
+    if (harp_bin_aggregation_list_new(&aggregation) != 0)
+    {
+        return -1;
+    }
+    if (harp_bin_aggregation_list_add(aggregation, specification) != 0)
+    {
+        harp_bin_aggregation_list_delete(aggregation);
+        return -1;
+    }
+    for (i = 0; i < aggregation->num_aggregations; i++)
+    {
+        if (aggregation->type[i] != harp_bin_aggregation_median &&
+            aggregation->type[i] != harp_bin_aggregation_percentile)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid aggregation '%s' (only median and percentile "
+                           "statistics are supported by the spatial accumulator)", specification);
+            harp_bin_aggregation_list_delete(aggregation);
+            return -1;
+        }
+    }
+
+    if (accumulator->aggregation == NULL)
+    {
+        accumulator->aggregation = aggregation;
+    }
+    else
+    {
+        harp_bin_aggregation_list_delete(aggregation);
+        if (harp_bin_aggregation_list_add(accumulator->aggregation, specification) != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* all statistics of a specification are for the same variable */
+    variable_name = accumulator->aggregation->variable_name[accumulator->aggregation->num_aggregations - 1];
+    for (j = 0; j < accumulator->percentile.num_variables; j++)
+    {
+        if (strcmp(accumulator->percentile.variable[j].variable_name, variable_name) == 0)
+        {
+            return 0;
+        }
+    }
+    if (accumulator->percentile.num_variables % ACCUMULATOR_BLOCK_SIZE == 0)
+    {
+        percentile_sketch *new_variable;
+
+        new_variable = realloc(accumulator->percentile.variable,
+                               (accumulator->percentile.num_variables + ACCUMULATOR_BLOCK_SIZE) *
+                               sizeof(percentile_sketch));
+        if (new_variable == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (accumulator->percentile.num_variables + ACCUMULATOR_BLOCK_SIZE) *
+                           sizeof(percentile_sketch), __FILE__, __LINE__);
+            return -1;
         }
+        accumulator->percentile.variable = new_variable;
+    }
+    entry = &accumulator->percentile.variable[accumulator->percentile.num_variables];
+    entry->variable_name = strdup(variable_name);
+    if (entry->variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    entry->unit = NULL;
+    entry->num_dimensions = 0;
+    entry->num_cells = 0;
+    entry->sketch = NULL;
+    accumulator->percentile.num_variables++;
+
+    return 0;
+}
+
+/** Enable or disable the compact mode of a spatial accumulator.
+ * By default the weighted sums and the sum of the weights of each averaged variable are accumulated as doubles.
+ * In compact mode the weighted sums are accumulated as floats using compensated (Kahan/Neumaier) summation, which
+ * keeps the accuracy of the accumulated values close to that of a double sum, even when many products are added.
+ * In addition, the sum of the weights is shared between all variables that have the same dimensions and the same
+ * validity mask (i.e. the same NaN values) in each of the added products. Variables whose validity mask starts to
+ * differ from that of the other variables automatically get their own copy of the weights.
+ * For products that consist of many variables with a common validity mask this reduces the memory that is needed
+ * for the accumulated values of these variables by about a factor of two.
+ * Accumulated values need to stay within the range of a float.
+ *
+ * The compact mode can only be changed before the first (non-empty) product is added to the accumulator.
+ *
+ * \param accumulator Spatial accumulator.
+ * \param enable 0: disable compact mode (default), 1: enable compact mode.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_accumulator_set_compact(harp_spatial_accumulator *accumulator, int enable)
+{
+    if (accumulator == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "accumulator is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (accumulator->num_variables > 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "compact mode of the spatial accumulator can only be changed "
+                       "before the first product is added");
+        return -1;
     }
+    accumulator->compact = (enable != 0);
 
-    /* remove all variables that need to be removed (in reverse order!) */
-    for (k = product->num_variables - 1; k >= 0; k--)
+    return 0;
+}
+
+/** Estimate the memory that a spatial accumulator needs for accumulating products that are like the given product.
+ * The product should be a product as it would be passed to harp_spatial_accumulator_add_product() (i.e. before the
+ * spatial binning); the product is not modified. The estimate covers the accumulated values of all variables of the
+ * product that get binned (this memory is kept until the accumulator is deleted), but not the memory that is
+ * temporarily needed to bin each individual product.
+ * For a compact accumulator (see harp_spatial_accumulator_set_compact()) the estimate assumes that all variables with
+ * the same dimensions can share their weights.
+ *
+ * \param accumulator Spatial accumulator.
+ * \param product Product whose variables are used for the estimate.
+ * \param size Pointer to the C variable where the estimated memory size (in bytes) will be stored.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_accumulator_estimate_memory_usage(const harp_spatial_accumulator *accumulator,
+                                                               const harp_product *product, int64_t *size)
+{
+    int64_t num_cells;
+    int64_t total_size = 0;
+    int64_t *weight_size = NULL;        /* sizes of the (shared) weights of a compact accumulator */
+    int num_weights = 0;
+    int area_binning;
+    int k;
+
+    if (accumulator == NULL || product == NULL || size == NULL)
     {
-        if (bintype[k] == binning_remove)
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "accumulator, product, or size is NULL (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    num_cells = (int64_t)(accumulator->num_latitude_edges - 1) * (accumulator->num_longitude_edges - 1);
+    area_binning = harp_product_has_variable(product, "latitude_bounds") &&
+        harp_product_has_variable(product, "longitude_bounds");
+    if (!area_binning)
+    {
+        /* the 'count' variable with the number of samples per cell */
+        total_size += num_cells * sizeof(int32_t);
+    }
+
+    if (accumulator->compact && product->num_variables > 0)
+    {
+        weight_size = malloc(product->num_variables * sizeof(int64_t));
+        if (weight_size == NULL)
         {
-            if (harp_product_remove_variable(product, product->variable[k]) != 0)
-            {
-                goto error;
-            }
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           product->num_variables * sizeof(int64_t), __FILE__, __LINE__);
+            return -1;
         }
     }
 
-    free(bintype);
-    free(filtered_count);
-    if (area_binning)
+    for (k = 0; k < product->num_variables; k++)
     {
-        free(filtered_weight);
+        harp_variable *variable = product->variable[k];
+        binning_type type = get_spatial_binning_type(variable, area_binning);
+        int64_t num_sub_elements;
+        int64_t num_elements;
+        int i;
+
+        switch (type)
+        {
+            case binning_remove:
+                break;
+            case binning_skip:
+                /* these are copied from the first product */
+                total_size += (int64_t)variable->num_elements * harp_get_size_for_type(variable->data_type);
+                break;
+            case binning_time_min:
+            case binning_time_max:
+            case binning_time_average:
+            case binning_time_sum:
+                /* these are only binned in time (to a single time bin) */
+                num_sub_elements = variable->num_elements / variable->dimension[0];
+                total_size += num_sub_elements * sizeof(double);
+                break;
+            case binning_sum:
+                num_sub_elements = variable->num_elements / variable->dimension[0];
+                total_size += num_cells * num_sub_elements * sizeof(int32_t);
+                break;
+            case binning_average:
+            case binning_angle:
+                num_sub_elements = variable->num_elements / variable->dimension[0];
+                num_elements = num_cells * num_sub_elements;
+                if (!accumulator->compact)
+                {
+                    /* weighted sum and sum of weights (and weighted sum of the sine for angles) */
+                    total_size += num_elements * (type == binning_angle ? 3 : 2) * sizeof(double);
+                    break;
+                }
+                /* float weighted sum and compensation (for both the cosine and sine for angles) */
+                total_size += num_elements * (type == binning_angle ? 4 : 2) * sizeof(float);
+                for (i = 0; i < num_weights; i++)
+                {
+                    if (weight_size[i] == num_elements)
+                    {
+                        break;
+                    }
+                }
+                if (i == num_weights)
+                {
+                    weight_size[num_weights] = num_elements;
+                    num_weights++;
+                    total_size += num_elements * sizeof(double);
+                }
+                break;
+        }
     }
-    free(time_index);
-    free(time_count);
-    free(count);
-    free(num_latlon_index);
-    if (latlon_cell_index != NULL)
+
+    if (weight_size != NULL)
     {
-        free(latlon_cell_index);
+        free(weight_size);
     }
-    if (latlon_weight != NULL)
+
+    *size = total_size;
+    return 0;
+}
+
+/** Add a product to a spatial accumulator.
+ * The product is spatially binned (all samples end up in a single time bin) and the binned values are then added to
+ * the values that were accumulated so far. Averages are accumulated using the number of samples (point binning) or
+ * the amount of overlap (area binning) of each grid cell as weight.
+ *
+ * The binning is performed in-place, so the product will be modified (the caller remains the owner of the product).
+ * Products with an empty time dimension are ignored.
+ *
+ * \param accumulator Spatial accumulator.
+ * \param product Product to add.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_accumulator_add_product(harp_spatial_accumulator *accumulator, harp_product *product)
+{
+    long *bin_index;
+    double *weight = NULL;
+    long max_num_elements = 0;
+    long num_elements;
+    long i;
+    int j, k;
+
+    num_elements = product->dimension[harp_dimension_time];
+    if (num_elements == 0)
     {
-        free(latlon_weight);
+        /* nothing to do */
+        return 0;
     }
 
-    /* add latitude_bounds and longitude_bounds variables */
-    dimension_type[0] = harp_dimension_latitude;
-    dimension[0] = num_latitude_edges - 1;
-    dimension_type[1] = harp_dimension_independent;
-    dimension[1] = 2;
-    if (harp_variable_new("latitude_bounds", harp_type_double, 2, dimension_type, dimension, &latitude) != 0)
+    bin_index = malloc(num_elements * sizeof(long));
+    if (bin_index == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(long), __FILE__, __LINE__);
         return -1;
     }
-    for (i = 0; i < dimension[0]; i++)
+    for (i = 0; i < num_elements; i++)
     {
-        latitude->data.double_data[2 * i] = latitude_edges[i];
-        latitude->data.double_data[2 * i + 1] = latitude_edges[i + 1];
+        bin_index[i] = 0;
     }
-    if (harp_product_add_variable(product, latitude) != 0)
+    if (bin_spatial(product, 1, num_elements, bin_index, accumulator->num_latitude_edges, accumulator->latitude_edges,
+                    accumulator->num_longitude_edges, accumulator->longitude_edges, 1, accumulator->aggregation,
+                    &accumulator->percentile, NULL) != 0)
     {
-        harp_variable_delete(latitude);
+        free(bin_index);
         return -1;
     }
-    if (harp_variable_set_unit(latitude, HARP_UNIT_LATITUDE) != 0)
+    free(bin_index);
+
+    for (k = 0; k < product->num_variables; k++)
     {
-        return -1;
+        if (product->variable[k]->num_elements > max_num_elements)
+        {
+            max_num_elements = product->variable[k]->num_elements;
+        }
+    }
+    if (max_num_elements > 0)
+    {
+        weight = malloc(max_num_elements * sizeof(double));
+        if (weight == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           max_num_elements * sizeof(double), __FILE__, __LINE__);
+            return -1;
+        }
     }
 
-    dimension_type[0] = harp_dimension_longitude;
-    dimension[0] = num_longitude_edges - 1;
-    if (harp_variable_new("longitude_bounds", harp_type_double, 2, dimension_type, dimension, &longitude) != 0)
+    /* verify that the product is consistent with the already accumulated products before changing anything */
+    for (k = 0; k < product->num_variables; k++)
     {
-        return -1;
+        harp_variable *variable = product->variable[k];
+        binning_type type;
+
+        type = get_accumulator_binning_type(product, variable);
+        if (type == binning_remove)
+        {
+            continue;
+        }
+        j = accumulator_find_variable(accumulator, variable->name);
+        if (j >= 0 && (accumulator->variable[j].type != type ||
+                       (accumulator->variable[j].shared_weight == NULL &&
+                        accumulator->variable[j].variable->data_type != variable->data_type) ||
+                       !has_same_dimensions(accumulator->variable[j].variable, variable)))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable '%s' of product does not match the variable of the "
+                           "previously accumulated products", variable->name);
+            if (weight != NULL)
+            {
+                free(weight);
+            }
+            return -1;
+        }
     }
-    for (i = 0; i < dimension[0]; i++)
+
+    for (k = 0; k < product->num_variables; k++)
     {
-        longitude->data.double_data[2 * i] = longitude_edges[i];
-        longitude->data.double_data[2 * i + 1] = longitude_edges[i + 1];
+        harp_variable *variable = product->variable[k];
+        binning_type type;
+
+        type = get_accumulator_binning_type(product, variable);
+        if (type == binning_remove)
+        {
+            continue;
+        }
+        j = accumulator_find_variable(accumulator, variable->name);
+        if (j < 0)
+        {
+            if (accumulator_add_variable(accumulator, type, variable) != 0)
+            {
+                if (weight != NULL)
+                {
+                    free(weight);
+                }
+                return -1;
+            }
+            if (type == binning_skip)
+            {
+                continue;
+            }
+            j = accumulator->num_variables - 1;
+        }
+        if (accumulate_variable(&accumulator->variable[j], product, variable, weight) != 0)
+        {
+            if (weight != NULL)
+            {
+                free(weight);
+            }
+            return -1;
+        }
     }
-    if (harp_product_add_variable(product, longitude) != 0)
+
+    if (weight != NULL)
     {
-        harp_variable_delete(longitude);
-        return -1;
+        free(weight);
     }
-    if (harp_variable_set_unit(longitude, HARP_UNIT_LONGITUDE) != 0)
+
+    if (accumulator->compact)
     {
-        return -1;
+        return accumulator_apply_pending_weights(accumulator);
     }
 
     return 0;
+}
 
-  error:
-    if (bintype != NULL)
+/* add the '<variable>_median' and '<variable>_p<N>' variables for the aggregations of the accumulator to the product */
+static int accumulator_add_percentile_variables(const harp_spatial_accumulator *accumulator, harp_product *product)
+{
+    quantile_centroid *sorted = NULL;
+    int max_centroids = 0;
+    long i, j;
+    int k;
+
+    for (k = 0; k < accumulator->percentile.num_variables; k++)
     {
-        free(bintype);
+        const percentile_sketch *entry = &accumulator->percentile.variable[k];
+
+        if (entry->sketch != NULL)
+        {
+            for (i = 0; i < entry->num_cells; i++)
+            {
+                if (entry->sketch[i].num_centroids > max_centroids)
+                {
+                    max_centroids = entry->sketch[i].num_centroids;
+                }
+            }
+        }
     }
-    if (time_index != NULL)
+    if (max_centroids == 0)
     {
-        free(time_index);
+        /* no samples were accumulated */
+        return 0;
     }
-    if (time_count != NULL)
+    sorted = malloc(max_centroids * sizeof(quantile_centroid));
+    if (sorted == NULL)
     {
-        free(time_count);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       max_centroids * sizeof(quantile_centroid), __FILE__, __LINE__);
+        return -1;
     }
-    if (count != NULL)
+
+    for (j = 0; j < accumulator->aggregation->num_aggregations; j++)
     {
-        free(count);
+        const percentile_sketch *entry = NULL;
+        char variable_name[MAX_NAME_LENGTH];
+        harp_variable *variable;
+        double quantile;
+
+        for (k = 0; k < accumulator->percentile.num_variables; k++)
+        {
+            if (strcmp(accumulator->percentile.variable[k].variable_name,
+                       accumulator->aggregation->variable_name[j]) == 0)
+            {
+                entry = &accumulator->percentile.variable[k];
+                break;
+            }
+        }
+        assert(entry != NULL);
+        if (entry->sketch == NULL)
+        {
+            /* none of the products contained the variable */
+            continue;
+        }
+
+        if (accumulator->aggregation->type[j] == harp_bin_aggregation_percentile)
+        {
+            snprintf(variable_name, MAX_NAME_LENGTH, "%s_p%d", entry->variable_name,
+                     accumulator->aggregation->percentile[j]);
+        }
+        else
+        {
+            snprintf(variable_name, MAX_NAME_LENGTH, "%s_median", entry->variable_name);
+        }
+        if (harp_variable_new(variable_name, harp_type_double, entry->num_dimensions, entry->dimension_type,
+                              entry->dimension, &variable) != 0)
+        {
+            free(sorted);
+            return -1;
+        }
+        if (entry->unit != NULL)
+        {
+            if (harp_variable_set_unit(variable, entry->unit) != 0)
+            {
+                harp_variable_delete(variable);
+                free(sorted);
+                return -1;
+            }
+        }
+        quantile = accumulator->aggregation->percentile[j] / 100.0;
+        for (i = 0; i < entry->num_cells; i++)
+        {
+            const quantile_sketch *sketch = &entry->sketch[i];
+
+            if (sketch->num_centroids == 0)
+            {
+                variable->data.double_data[i] = harp_nan();
+                continue;
+            }
+            quantile_sketch_sort(sketch, sorted);
+            variable->data.double_data[i] = quantile_from_centroids(sorted, sketch->num_centroids, sketch->minimum,
+                                                                    sketch->maximum, quantile);
+        }
+        if (harp_product_add_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            free(sorted);
+            return -1;
+        }
     }
-    if (filtered_count != NULL)
+    free(sorted);
+
+    return 0;
+}
+
+/** Import a product in chunks and add each chunk to a spatial accumulator.
+ * The product is read with an import stream (see harp_import_stream_open()) and each chunk of at most \a chunk_size
+ * time samples is filtered, derived and binned directly after it has been read, such that the full product is never
+ * kept in memory. For products that are not in HARP format, memory usage is limited to a single chunk together with
+ * the accumulated grid. The result is the same as importing the product with the same operations and adding it with
+ * harp_spatial_accumulator_add_product().
+ *
+ * Because the operations are performed on each chunk separately, only operations that treat each time sample
+ * independently are allowed.
+ *
+ * \param accumulator Spatial accumulator.
+ * \param filename Path to the file that is to be imported.
+ * \param operations string (optional) containing actions to apply to each chunk; should be specified as a
+ * semi-colon separated string of operations.
+ * \param options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used if the file is not in HARP format.
+ * \param chunk_size Maximum number of time samples that is read for each chunk.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_accumulator_add_file(harp_spatial_accumulator *accumulator, const char *filename,
+                                                  const char *operations, const char *options, long chunk_size)
+{
+    harp_import_stream *stream;
+    harp_product *product;
+
+    if (accumulator == NULL)
     {
-        free(filtered_count);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "accumulator is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
     }
-    if (filtered_weight != NULL)
+
+    if (harp_import_stream_open(filename, operations, options, chunk_size, &stream) != 0)
     {
-        free(filtered_weight);
+        return -1;
     }
-    if (num_latlon_index != NULL)
+    for (;;)
+    {
+        if (harp_import_stream_next(stream, &product) != 0)
+        {
+            harp_import_stream_close(stream);
+            return -1;
+        }
+        if (product == NULL)
+        {
+            break;
+        }
+        if (harp_spatial_accumulator_add_product(accumulator, product) != 0)
+        {
+            harp_product_delete(product);
+            harp_import_stream_close(stream);
+            return -1;
+        }
+        harp_product_delete(product);
+    }
+    harp_import_stream_close(stream);
+
+    return 0;
+}
+
+/** Retrieve the spatially binned product from a spatial accumulator.
+ * The resulting product has a time dimension of length 1 and latitude/longitude dimensions as defined by the grid
+ * of the accumulator. Cells to which no samples were allocated will have a NaN value.
+ * The estimated medians and percentiles of the aggregations of the accumulator (see
+ * harp_spatial_accumulator_add_aggregation()) are included as '<variable>_median' and '<variable>_p<N>' variables.
+ * The accumulator is not modified, so more products can still be added afterwards.
+ * If no (non-empty) products were added, the resulting product will be empty.
+ *
+ * \param accumulator Spatial accumulator.
+ * \param product Pointer to the C variable where the new product will be stored.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_spatial_accumulator_get_product(const harp_spatial_accumulator *accumulator,
+                                                     harp_product **product)
+{
+    harp_product *new_product;
+    int k;
+
+    if (harp_product_new(&new_product) != 0)
     {
-        free(num_latlon_index);
+        return -1;
     }
-    if (latlon_cell_index != NULL)
+
+    for (k = 0; k < accumulator->num_variables; k++)
     {
-        free(latlon_cell_index);
+        const accumulator_variable *entry = &accumulator->variable[k];
+        const double *weight = accumulator_variable_get_weight(entry);
+        harp_variable *variable;
+        long i;
+
+        if (harp_variable_copy(entry->variable, &variable) != 0)
+        {
+            harp_product_delete(new_product);
+            return -1;
+        }
+        if (entry->shared_weight != NULL)
+        {
+            /* add the compensation terms to the float sums */
+            if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
+            {
+                harp_variable_delete(variable);
+                harp_product_delete(new_product);
+                return -1;
+            }
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                variable->data.double_data[i] += entry->compensation[i];
+            }
+        }
+        if (entry->type == binning_average || entry->type == binning_angle)
+        {
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                if (weight[i] == 0)
+                {
+                    variable->data.double_data[i] = harp_nan();
+                }
+                else if (entry->type == binning_angle)
+                {
+                    double imag;
+
+                    if (entry->shared_weight != NULL)
+                    {
+                        imag = (double)entry->compact_imag[i] + entry->imag_compensation[i];
+                    }
+                    else
+                    {
+                        imag = entry->imag[i];
+                    }
+                    variable->data.double_data[i] = atan2(imag, variable->data.double_data[i]);
+                }
+                else
+                {
+                    variable->data.double_data[i] /= weight[i];
+                }
+            }
+            if (entry->type == binning_angle)
+            {
+                /* convert all angles back to the original unit */
+                if (harp_convert_unit("rad", variable->unit, variable->num_elements, variable->data.double_data) != 0)
+                {
+                    harp_variable_delete(variable);
+                    harp_product_delete(new_product);
+                    return -1;
+                }
+            }
+        }
+        if (harp_product_add_variable(new_product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            harp_product_delete(new_product);
+            return -1;
+        }
+        if (entry->has_count)
+        {
+            char count_variable_name[MAX_NAME_LENGTH];
+            harp_variable *count_variable;
+
+            snprintf(count_variable_name, MAX_NAME_LENGTH, "%s_count", variable->name);
+            if (harp_variable_new(count_variable_name, harp_type_int32, variable->num_dimensions,
+                                  variable->dimension_type, variable->dimension, &count_variable) != 0)
+            {
+                harp_product_delete(new_product);
+                return -1;
+            }
+            for (i = 0; i < count_variable->num_elements; i++)
+            {
+                count_variable->data.int32_data[i] = (int32_t)(weight[i] + 0.5);
+            }
+            if (harp_product_add_variable(new_product, count_variable) != 0)
+            {
+                harp_variable_delete(count_variable);
+                harp_product_delete(new_product);
+                return -1;
+            }
+        }
     }
-    if (latlon_weight != NULL)
+
+    if (accumulator->aggregation != NULL)
     {
-        free(latlon_weight);
+        if (accumulator_add_percentile_variables(accumulator, new_product) != 0)
+        {
+            harp_product_delete(new_product);
+            return -1;
+        }
     }
-    return -1;
+
+    *product = new_product;
+    return 0;
 }
 
 /**
@@ -2819,12 +7162,13 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
 /** Bin the product's variables such that all samples end up in a single bin.
  *
  * \param product Product to regrid.
+ * \param aggregation Additional statistics to compute per variable (can be NULL).
  *
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-int harp_product_bin_full(harp_product *product)
+int harp_product_bin_full(harp_product *product, const harp_bin_aggregation_list *aggregation)
 {
     long *bin_index;
     long num_elements;
@@ -2849,7 +7193,7 @@ int harp_product_bin_full(harp_product *product)
         bin_index[i] = 0;
     }
 
-    if (harp_product_bin(product, 1, num_elements, bin_index) != 0)
+    if (bin_time(product, 1, num_elements, bin_index, aggregation) != 0)
     {
         free(bin_index);
         return -1;
@@ -2859,24 +7203,192 @@ int harp_product_bin_full(harp_product *product)
     return 0;
 }
 
+static void bin_hash_update(uint64_t *hash, const void *data, size_t length)
+{
+    const unsigned char *byte = (const unsigned char *)data;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        *hash ^= byte[i];
+        *hash *= 1099511628211ULL;
+    }
+}
+
+/* Assign a bin to each of the num_elements samples such that samples with an equal key end up in the same bin.
+ * Bins are numbered in order of the first occurrence of their key; index[b] receives the first sample of bin b.
+ * The samples are grouped in a single pass using an open addressing hash table on the hash values of the keys.
+ */
+static int assign_bins_by_key(long num_elements, const uint64_t *hash,
+                              int (*is_equal) (const void *user_data, long i, long j), const void *user_data,
+                              long *index, long *bin_index, long *num_bins)
+{
+    long *slot;
+    long num_slots = 16;
+    long mask;
+    long i;
+
+    while (num_slots < 2 * num_elements)
+    {
+        num_slots *= 2;
+    }
+    mask = num_slots - 1;
+    slot = malloc(num_slots * sizeof(long));
+    if (slot == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_slots * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_slots; i++)
+    {
+        slot[i] = -1;
+    }
+
+    *num_bins = 0;
+    for (i = 0; i < num_elements; i++)
+    {
+        long position = (long)(hash[i] & (uint64_t)mask);
+
+        /* slots contain bin numbers; use linear probing until we find the bin of the key or an empty slot */
+        while (slot[position] >= 0)
+        {
+            long first = index[slot[position]];
+
+            if (hash[first] == hash[i] && is_equal(user_data, first, i))
+            {
+                break;
+            }
+            position = (position + 1) & mask;
+        }
+        if (slot[position] < 0)
+        {
+            /* add new bin */
+            slot[position] = *num_bins;
+            index[*num_bins] = i;
+            (*num_bins)++;
+        }
+        bin_index[i] = slot[position];
+    }
+
+    free(slot);
+
+    return 0;
+}
+
+static int is_equal_collocated_sample(const void *user_data, long i, long j)
+{
+    const harp_collocation_result *collocation_result = (const harp_collocation_result *)user_data;
+
+    return collocation_result->pair[i]->product_index_b == collocation_result->pair[j]->product_index_b &&
+        collocation_result->pair[i]->sample_index_b == collocation_result->pair[j]->sample_index_b;
+}
+
+/* all NaN values are considered equal (as are 0 and -0) */
+static int is_equal_variable_element(const void *user_data, long i, long j)
+{
+    const harp_variable *variable = (const harp_variable *)user_data;
+
+    switch (variable->data_type)
+    {
+        case harp_type_int8:
+            return variable->data.int8_data[i] == variable->data.int8_data[j];
+        case harp_type_int16:
+            return variable->data.int16_data[i] == variable->data.int16_data[j];
+        case harp_type_int32:
+            return variable->data.int32_data[i] == variable->data.int32_data[j];
+        case harp_type_float:
+            if (harp_isnan(variable->data.float_data[i]))
+            {
+                return harp_isnan(variable->data.float_data[j]);
+            }
+            return variable->data.float_data[i] == variable->data.float_data[j];
+        case harp_type_double:
+            if (harp_isnan(variable->data.double_data[i]))
+            {
+                return harp_isnan(variable->data.double_data[j]);
+            }
+            return variable->data.double_data[i] == variable->data.double_data[j];
+        case harp_type_string:
+            if (variable->data.string_data[i] == NULL || variable->data.string_data[j] == NULL)
+            {
+                return variable->data.string_data[i] == variable->data.string_data[j];
+            }
+            return strcmp(variable->data.string_data[i], variable->data.string_data[j]) == 0;
+    }
+
+    assert(0);
+    exit(1);
+}
+
+/* hash value of each element of a variable, consistent with is_equal_variable_element() */
+static void get_variable_element_hashes(const harp_variable *variable, uint64_t *hash)
+{
+    long i;
+
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        hash[i] = 14695981039346656037ULL;
+        switch (variable->data_type)
+        {
+            case harp_type_int8:
+                bin_hash_update(&hash[i], &variable->data.int8_data[i], sizeof(int8_t));
+                break;
+            case harp_type_int16:
+                bin_hash_update(&hash[i], &variable->data.int16_data[i], sizeof(int16_t));
+                break;
+            case harp_type_int32:
+                bin_hash_update(&hash[i], &variable->data.int32_data[i], sizeof(int32_t));
+                break;
+            case harp_type_float:
+            case harp_type_double:
+                {
+                    double value = variable->data_type == harp_type_float ? variable->data.float_data[i] :
+                        variable->data.double_data[i];
+
+                    /* NaN values keep the initial hash */
+                    if (!harp_isnan(value))
+                    {
+                        if (value == 0)
+                        {
+                            value = 0;
+                        }
+                        bin_hash_update(&hash[i], &value, sizeof(double));
+                    }
+                }
+                break;
+            case harp_type_string:
+                if (variable->data.string_data[i] != NULL)
+                {
+                    /* include the terminating zero to distinguish the empty string from NULL */
+                    bin_hash_update(&hash[i], variable->data.string_data[i], strlen(variable->data.string_data[i]) + 1);
+                }
+                break;
+        }
+    }
+}
+
 /** Bin the product's variables (from dataset a in the collocation result) such that all pairs that have the same
  * item in dataset b are averaged together.
  *
  * \param product Product to regrid.
  * \param collocation_result The collocation result containing the list of matching pairs.
+ * \param aggregation Additional statistics to compute per variable (can be NULL).
  *
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-int harp_product_bin_with_collocated_dataset(harp_product *product, harp_collocation_result *collocation_result)
+int harp_product_bin_with_collocated_dataset(harp_product *product, harp_collocation_result *collocation_result,
+                                             const harp_bin_aggregation_list *aggregation)
 {
     harp_collocation_result *filtered_collocation_result = NULL;
     harp_variable *collocation_index = NULL;
     long *index;        /* contains index of first sample for each bin */
     long *bin_index;
+    uint64_t *hash;
     long num_bins;
-    long i, j;
+    long i;
 
     /* Get the source product's collocation index variable */
     if (harp_product_get_variable_by_name(product, "collocation_index", &collocation_index) != 0)
@@ -2884,24 +7396,17 @@ int harp_product_bin_with_collocated_dataset(harp_product *product, harp_colloca
         return -1;
     }
 
-    /* copy the collocation result for filtering */
-    if (harp_collocation_result_shallow_copy(collocation_result, &filtered_collocation_result) != 0)
-    {
-        return -1;
-    }
-
-    /* Reduce the collocation result to only pairs that include the source product */
-    if (harp_collocation_result_filter_for_collocation_indices(filtered_collocation_result,
-                                                               collocation_index->num_elements,
-                                                               collocation_index->data.int32_data) != 0)
+    /* Get a view on the pairs of the collocation result that include the source product */
+    if (harp_collocation_result_get_view_for_collocation_indices(collocation_result, collocation_index->num_elements,
+                                                                 collocation_index->data.int32_data,
+                                                                 &filtered_collocation_result) != 0)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
         return -1;
     }
     if (filtered_collocation_result->num_pairs != collocation_index->num_elements)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product and collocation result are inconsistent");
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -2910,7 +7415,7 @@ int harp_product_bin_with_collocated_dataset(harp_product *product, harp_colloca
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        collocation_index->num_elements * sizeof(long), __FILE__, __LINE__);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
     bin_index = malloc(collocation_index->num_elements * sizeof(long));
@@ -2918,44 +7423,49 @@ int harp_product_bin_with_collocated_dataset(harp_product *product, harp_colloca
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        collocation_index->num_elements * sizeof(long), __FILE__, __LINE__);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         free(index);
         return -1;
     }
 
-    num_bins = 0;
+    hash = malloc(collocation_index->num_elements * sizeof(uint64_t));
+    if (hash == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       collocation_index->num_elements * sizeof(uint64_t), __FILE__, __LINE__);
+        harp_collocation_result_view_delete(filtered_collocation_result);
+        free(bin_index);
+        free(index);
+        return -1;
+    }
     for (i = 0; i < collocation_index->num_elements; i++)
     {
-        for (j = 0; j < num_bins; j++)
-        {
-            if (filtered_collocation_result->pair[index[j]]->product_index_b ==
-                filtered_collocation_result->pair[i]->product_index_b &&
-                filtered_collocation_result->pair[index[j]]->sample_index_b ==
-                filtered_collocation_result->pair[i]->sample_index_b)
-            {
-                break;
-            }
-        }
-        if (j == num_bins)
-        {
-            /* add new value to bin */
-            index[num_bins] = i;
-            num_bins++;
-        }
-        bin_index[i] = j;
+        hash[i] = 14695981039346656037ULL;
+        bin_hash_update(&hash[i], &filtered_collocation_result->pair[i]->product_index_b, sizeof(long));
+        bin_hash_update(&hash[i], &filtered_collocation_result->pair[i]->sample_index_b, sizeof(long));
+    }
+    if (assign_bins_by_key(collocation_index->num_elements, hash, is_equal_collocated_sample,
+                           filtered_collocation_result, index, bin_index, &num_bins) != 0)
+    {
+        harp_collocation_result_view_delete(filtered_collocation_result);
+        free(hash);
+        free(bin_index);
+        free(index);
+        return -1;
     }
+    free(hash);
 
     if (harp_product_detach_variable(product, collocation_index) != 0)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         free(bin_index);
         free(index);
         return -1;
     }
 
-    if (harp_product_bin(product, num_bins, collocation_index->num_elements, bin_index) != 0)
+    if (bin_time(product, num_bins, collocation_index->num_elements, bin_index, aggregation) != 0)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         harp_variable_delete(collocation_index);
         free(bin_index);
         free(index);
@@ -2964,14 +7474,14 @@ int harp_product_bin_with_collocated_dataset(harp_product *product, harp_colloca
 
     if (harp_variable_rearrange_dimension(collocation_index, 0, num_bins, index) != 0)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         harp_variable_delete(collocation_index);
         free(bin_index);
         free(index);
         return -1;
     }
 
-    harp_collocation_result_shallow_delete(filtered_collocation_result);
+    harp_collocation_result_view_delete(filtered_collocation_result);
     free(bin_index);
     free(index);
 
@@ -2990,19 +7500,21 @@ int harp_product_bin_with_collocated_dataset(harp_product *product, harp_colloca
  *
  * \param product Product to regrid.
  * \param variable_name Name of the variable that defines the bins (based on equal value).
+ * \param aggregation Additional statistics to compute per variable (can be NULL).
  *
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-int harp_product_bin_with_variable(harp_product *product, const char *variable_name)
+int harp_product_bin_with_variable(harp_product *product, const char *variable_name,
+                                   const harp_bin_aggregation_list *aggregation)
 {
     harp_variable *variable;
     long *index;        /* contains index of first sample for each bin */
     long *bin_index;
+    uint64_t *hash;
     long num_elements;
     long num_bins;
-    long i, j;
 
     if (harp_product_get_variable_by_name(product, variable_name, &variable) != 0)
     {
@@ -3033,82 +7545,24 @@ int harp_product_bin_with_variable(harp_product *product, const char *variable_n
         return -1;
     }
 
-    num_bins = 0;
-    for (i = 0; i < num_elements; i++)
+    hash = malloc(num_elements * sizeof(uint64_t));
+    if (hash == NULL)
     {
-        int check_nan = 0;
-
-        if (variable->data_type == harp_type_float)
-        {
-            check_nan = harp_isnan(variable->data.float_data[i]);
-        }
-        else if (variable->data_type == harp_type_double)
-        {
-            check_nan = harp_isnan(variable->data.double_data[i]);
-        }
-        for (j = 0; j < num_bins; j++)
-        {
-            int equal = 0;
-
-            switch (variable->data_type)
-            {
-                case harp_type_int8:
-                    equal = variable->data.int8_data[index[j]] == variable->data.int8_data[i];
-                    break;
-                case harp_type_int16:
-                    equal = variable->data.int16_data[index[j]] == variable->data.int16_data[i];
-                    break;
-                case harp_type_int32:
-                    equal = variable->data.int32_data[index[j]] == variable->data.int32_data[i];
-                    break;
-                case harp_type_float:
-                    if (check_nan)
-                    {
-                        equal = harp_isnan(variable->data.float_data[index[j]]);
-                    }
-                    else
-                    {
-                        equal = variable->data.float_data[index[j]] == variable->data.float_data[i];
-                    }
-                    break;
-                case harp_type_double:
-                    if (check_nan)
-                    {
-                        equal = harp_isnan(variable->data.double_data[index[j]]);
-                    }
-                    else
-                    {
-                        equal = variable->data.double_data[index[j]] == variable->data.double_data[i];
-                    }
-                    break;
-                case harp_type_string:
-                    if (variable->data.string_data[i] == NULL)
-                    {
-                        equal = variable->data.string_data[index[j]] == NULL;
-                    }
-                    else if (variable->data.string_data[index[j]] == NULL)
-                    {
-                        equal = 0;
-                    }
-                    else
-                    {
-                        equal = strcmp(variable->data.string_data[index[j]], variable->data.string_data[i]) == 0;
-                    }
-                    break;
-            }
-            if (equal)
-            {
-                break;
-            }
-        }
-        if (j == num_bins)
-        {
-            /* add new value to bin */
-            index[num_bins] = i;
-            num_bins++;
-        }
-        bin_index[i] = j;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(uint64_t), __FILE__, __LINE__);
+        free(bin_index);
+        free(index);
+        return -1;
+    }
+    get_variable_element_hashes(variable, hash);
+    if (assign_bins_by_key(num_elements, hash, is_equal_variable_element, variable, index, bin_index, &num_bins) != 0)
+    {
+        free(hash);
+        free(bin_index);
+        free(index);
+        return -1;
     }
+    free(hash);
 
     if (get_binning_type(variable) == binning_remove)
     {
@@ -3136,7 +7590,7 @@ int harp_product_bin_with_variable(harp_product *product, const char *variable_n
 
     free(index);
 
-    if (harp_product_bin(product, num_bins, num_elements, bin_index) != 0)
+    if (bin_time(product, num_bins, num_elements, bin_index, aggregation) != 0)
     {
         if (variable != NULL)
         {
@@ -3170,44 +7624,54 @@ int harp_product_bin_with_variable(harp_product *product, const char *variable_n
  * \param num_longitude_edges Number of edges for the longitude grid
  *        (number of longitude columns = num_longitude_edges - 1)
  * \param longitude_edges longitude grid edge vales
+ * \param aggregation Additional statistics to compute per variable (can be NULL).
+ * \param weights_filename Spatial weights file to use for an area binning (can be NULL). If the file does not exist
+ *        yet, the spatial weights are determined from the product and written to this file.
  *
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
 int harp_product_bin_spatial_full(harp_product *product, long num_latitude_edges, double *latitude_edges,
-                                  long num_longitude_edges, double *longitude_edges)
+                                  long num_longitude_edges, double *longitude_edges,
+                                  const harp_bin_aggregation_list *aggregation, const char *weights_filename)
 {
-    long *bin_index;
-    long num_elements;
-    long i;
+    harp_spatial_weights *weights = NULL;
+    FILE *file;
+    int result;
 
-    num_elements = product->dimension[harp_dimension_time];
-    if (num_elements == 0)
+    if (weights_filename == NULL || product->dimension[harp_dimension_time] == 0)
     {
-        /* nothing to do */
-        return 0;
+        return bin_spatial_single_time_bin(product, num_latitude_edges, latitude_edges, num_longitude_edges,
+                                           longitude_edges, aggregation, NULL);
     }
 
-    bin_index = malloc(num_elements * sizeof(long));
-    if (bin_index == NULL)
+    file = fopen(weights_filename, "rb");
+    if (file != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_elements * sizeof(long), __FILE__, __LINE__);
-        return -1;
+        fclose(file);
+        if (harp_spatial_weights_read(weights_filename, &weights) != 0)
+        {
+            return -1;
+        }
     }
-    for (i = 0; i < num_elements; i++)
+    else
     {
-        bin_index[i] = 0;
+        if (harp_spatial_weights_new(product, num_latitude_edges, latitude_edges, num_longitude_edges,
+                                     longitude_edges, &weights) != 0)
+        {
+            return -1;
+        }
+        if (harp_spatial_weights_write(weights_filename, weights) != 0)
+        {
+            harp_spatial_weights_delete(weights);
+            return -1;
+        }
     }
 
-    if (harp_product_bin_spatial(product, 1, num_elements, bin_index, num_latitude_edges, latitude_edges,
-                                 num_longitude_edges, longitude_edges) != 0)
-    {
-        free(bin_index);
-        return -1;
-    }
+    result = bin_spatial_single_time_bin(product, num_latitude_edges, latitude_edges, num_longitude_edges,
+                                         longitude_edges, aggregation, weights);
+    harp_spatial_weights_delete(weights);
 
-    free(bin_index);
-    return 0;
+    return result;
 }
@@ -227,13 +227,59 @@ double harp_density_from_partial_column_and_altitude_bounds(double partial_colum
     return (height < EPSILON ? 0 : partial_column / height);
 }
 
+static double get_mass_density_from_number_density(double number_density, double molar_mass)
+{
+    return 1e-3 * number_density * molar_mass / CONST_NUM_AVOGADRO;
+}
+
 /* Convert number density to mass density
  * \param number_density Number density [molec/m3]
  * \param molar_mass Molar mass [g/mol]
  * \return the mass density [kg/m3] */
 double harp_mass_density_from_number_density(double number_density, double molar_mass)
 {
-    return 1e-3 * number_density * molar_mass / CONST_NUM_AVOGADRO;
+    return get_mass_density_from_number_density(number_density, molar_mass);
+}
+
+/** Array version of harp_mass_density_from_number_density().
+ * \param num_elements Number of elements of each array.
+ * \param number_density Number density [molec/m3] (array of \a num_elements values)
+ * \param molar_mass Molar mass [g/mol] (array of \a num_elements values)
+ * \param result Array in which the mass density [kg/m3] values will be stored.
+ */
+void harp_mass_density_from_number_density_array(long num_elements, const double *number_density,
+                                                 const double *molar_mass, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_mass_density_from_number_density(number_density[i], molar_mass[i]);
+    }
+}
+
+/** Convert number density to mass density for all elements of an array of a single species.
+ * The molar mass of the species is only resolved once and the conversion is applied as a single scale factor.
+ * \param num_elements Number of elements of each array.
+ * \param species Species of the air component.
+ * \param number_density Number density [molec/m3] (array of \a num_elements values)
+ * \param result Array in which the mass density [kg/m3] values will be stored.
+ */
+void harp_mass_density_from_number_density_for_species_array(long num_elements, harp_chemical_species species,
+                                                             const double *number_density, double *result)
+{
+    double factor = 1e-3 * harp_molar_mass_for_species(species) / CONST_NUM_AVOGADRO;
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = number_density[i] * factor;
+    }
+}
+
+static double get_mass_mixing_ratio_from_density(double density, double density_air)
+{
+    return density / density_air;
 }
 
 /** Convert mass density to mass mixing ratio
@@ -243,7 +289,24 @@ double harp_mass_density_from_number_density(double number_density, double molar
  */
 double harp_mass_mixing_ratio_from_density(double density, double density_air)
 {
-    return density / density_air;
+    return get_mass_mixing_ratio_from_density(density, density_air);
+}
+
+/** Array version of harp_mass_mixing_ratio_from_density().
+ * \param num_elements Number of elements of each array.
+ * \param density Mass density of air component [kg/m3] (array of \a num_elements values)
+ * \param density_air Mass density of air [kg/cm3] (array of \a num_elements values)
+ * \param result Array in which the mass mixing ratio [kg/kg] values will be stored.
+ */
+void harp_mass_mixing_ratio_from_density_array(long num_elements, const double *density, const double *density_air,
+                                               double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_mass_mixing_ratio_from_density(density[i], density_air[i]);
+    }
 }
 
 /* Convert volume mixing ratio to mass mixing ratio
@@ -257,6 +320,44 @@ double harp_mass_mixing_ratio_from_volume_mixing_ratio(double volume_mixing_rati
     return volume_mixing_ratio * molar_mass_species / molar_mass_air;
 }
 
+/** Convert volume mixing ratio to mass mixing ratio for all elements of an array of a single species.
+ * \param num_elements Number of elements of each array.
+ * \param species Species of the air component.
+ * \param volume_mixing_ratio Volume mixing ratio of the air component [ppv] (array of \a num_elements values)
+ * \param molar_mass_air Molar mass of air [g/mol] (array of \a num_elements values); if NULL then the molar mass
+ * of dry air is used for all elements (i.e. conversion of dry air mixing ratios).
+ * \param result Array in which the mass mixing ratio [kg/kg] values will be stored.
+ */
+void harp_mass_mixing_ratio_from_volume_mixing_ratio_for_species_array(long num_elements,
+                                                                       harp_chemical_species species,
+                                                                       const double *volume_mixing_ratio,
+                                                                       const double *molar_mass_air, double *result)
+{
+    double molar_mass_species = harp_molar_mass_for_species(species);
+    long i;
+
+    if (molar_mass_air == NULL)
+    {
+        double factor = molar_mass_species / harp_molar_mass_for_species(harp_chemical_species_dry_air);
+
+        for (i = 0; i < num_elements; i++)
+        {
+            result[i] = volume_mixing_ratio[i] * factor;
+        }
+        return;
+    }
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = volume_mixing_ratio[i] * molar_mass_species / molar_mass_air[i];
+    }
+}
+
+static double get_molar_mass_air_from_density_and_number_density(double density, double number_density)
+{
+    return 1e3 * density * CONST_NUM_AVOGADRO / number_density;
+}
+
 /** Get molar mass of total (wet) air from density and number density
  * \param density mass density of total air [kg/kg]
  * \param number_density number density of total air [molec/m3]
@@ -264,7 +365,30 @@ double harp_mass_mixing_ratio_from_volume_mixing_ratio(double volume_mixing_rati
  */
 double harp_molar_mass_air_from_density_and_number_density(double density, double number_density)
 {
-    return 1e3 * density * CONST_NUM_AVOGADRO / number_density;
+    return get_molar_mass_air_from_density_and_number_density(density, number_density);
+}
+
+/** Array version of harp_molar_mass_air_from_density_and_number_density().
+ * \param num_elements Number of elements of each array.
+ * \param density mass density of total air [kg/kg] (array of \a num_elements values)
+ * \param number_density number density of total air [molec/m3] (array of \a num_elements values)
+ * \param result Array in which the molar mass of total air [g/mol] values will be stored.
+ */
+void harp_molar_mass_air_from_density_and_number_density_array(long num_elements, const double *density,
+                                                               const double *number_density, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_molar_mass_air_from_density_and_number_density(density[i], number_density[i]);
+    }
+}
+
+static double get_molar_mass_air_from_h2o_mass_mixing_ratio(double h2o_mass_mixing_ratio)
+{
+    return (CONST_MOLAR_MASS_DRY_AIR * CONST_MOLAR_MASS_H2O) /
+        ((1 - h2o_mass_mixing_ratio) * CONST_MOLAR_MASS_H2O + h2o_mass_mixing_ratio * CONST_MOLAR_MASS_DRY_AIR);
 }
 
 /** Get molar mass of total (wet) air from H2O mass mixing ratio
@@ -273,8 +397,28 @@ double harp_molar_mass_air_from_density_and_number_density(double density, doubl
  */
 double harp_molar_mass_air_from_h2o_mass_mixing_ratio(double h2o_mass_mixing_ratio)
 {
-    return (CONST_MOLAR_MASS_DRY_AIR * CONST_MOLAR_MASS_H2O) /
-        ((1 - h2o_mass_mixing_ratio) * CONST_MOLAR_MASS_H2O + h2o_mass_mixing_ratio * CONST_MOLAR_MASS_DRY_AIR);
+    return get_molar_mass_air_from_h2o_mass_mixing_ratio(h2o_mass_mixing_ratio);
+}
+
+/** Array version of harp_molar_mass_air_from_h2o_mass_mixing_ratio().
+ * \param num_elements Number of elements of each array.
+ * \param h2o_mass_mixing_ratio H2O mass mixing ratio [kg/kg] (array of \a num_elements values)
+ * \param result Array in which the molar mass of total air [g/mol] values will be stored.
+ */
+void harp_molar_mass_air_from_h2o_mass_mixing_ratio_array(long num_elements, const double *h2o_mass_mixing_ratio,
+                                                          double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_molar_mass_air_from_h2o_mass_mixing_ratio(h2o_mass_mixing_ratio[i]);
+    }
+}
+
+static double get_molar_mass_air_from_h2o_volume_mixing_ratio(double h2o_volume_mixing_ratio)
+{
+    return CONST_MOLAR_MASS_DRY_AIR * (1 - h2o_volume_mixing_ratio) + CONST_MOLAR_MASS_H2O * h2o_volume_mixing_ratio;
 }
 
 /** Get molar mass of total (wet) air from H2O volume mixing ratio
@@ -283,7 +427,23 @@ double harp_molar_mass_air_from_h2o_mass_mixing_ratio(double h2o_mass_mixing_rat
  */
 double harp_molar_mass_air_from_h2o_volume_mixing_ratio(double h2o_volume_mixing_ratio)
 {
-    return CONST_MOLAR_MASS_DRY_AIR * (1 - h2o_volume_mixing_ratio) + CONST_MOLAR_MASS_H2O * h2o_volume_mixing_ratio;
+    return get_molar_mass_air_from_h2o_volume_mixing_ratio(h2o_volume_mixing_ratio);
+}
+
+/** Array version of harp_molar_mass_air_from_h2o_volume_mixing_ratio().
+ * \param num_elements Number of elements of each array.
+ * \param h2o_volume_mixing_ratio H2O volume mixing ratio [ppv] (array of \a num_elements values)
+ * \param result Array in which the molar mass of total air [g/mol] values will be stored.
+ */
+void harp_molar_mass_air_from_h2o_volume_mixing_ratio_array(long num_elements, const double *h2o_volume_mixing_ratio,
+                                                            double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_molar_mass_air_from_h2o_volume_mixing_ratio(h2o_volume_mixing_ratio[i]);
+    }
 }
 
 /** Get molar mass of species of interest
@@ -297,6 +457,11 @@ double harp_molar_mass_for_species(harp_chemical_species species)
     return chemical_species_molar_mass[species];
 }
 
+static double get_number_density_from_mass_density(double mass_density, double molar_mass)
+{
+    return 1e3 * mass_density * CONST_NUM_AVOGADRO / molar_mass;
+}
+
 /** Convert mass density to number_density
  * \param mass_density Mass density [kg/m3]
  * \param molar_mass Molar mass [g/mol]
@@ -304,7 +469,48 @@ double harp_molar_mass_for_species(harp_chemical_species species)
  */
 double harp_number_density_from_mass_density(double mass_density, double molar_mass)
 {
-    return 1e3 * mass_density * CONST_NUM_AVOGADRO / molar_mass;
+    return get_number_density_from_mass_density(mass_density, molar_mass);
+}
+
+/** Array version of harp_number_density_from_mass_density().
+ * \param num_elements Number of elements of each array.
+ * \param mass_density Mass density [kg/m3] (array of \a num_elements values)
+ * \param molar_mass Molar mass [g/mol] (array of \a num_elements values)
+ * \param result Array in which the number density [molec/m3] values will be stored.
+ */
+void harp_number_density_from_mass_density_array(long num_elements, const double *mass_density,
+                                                 const double *molar_mass, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_number_density_from_mass_density(mass_density[i], molar_mass[i]);
+    }
+}
+
+/** Convert mass density to number density for all elements of an array of a single species.
+ * The molar mass of the species is only resolved once and the conversion is applied as a single scale factor.
+ * \param num_elements Number of elements of each array.
+ * \param species Species of the air component.
+ * \param mass_density Mass density [kg/m3] (array of \a num_elements values)
+ * \param result Array in which the number density [molec/m3] values will be stored.
+ */
+void harp_number_density_from_mass_density_for_species_array(long num_elements, harp_chemical_species species,
+                                                             const double *mass_density, double *result)
+{
+    double factor = 1e3 * CONST_NUM_AVOGADRO / harp_molar_mass_for_species(species);
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = mass_density[i] * factor;
+    }
+}
+
+static double get_number_density_from_pressure_and_temperature(double pressure, double temperature)
+{
+    return pressure / (CONST_BOLTZMANN * temperature);
 }
 
 /** Convert (partial) pressure and temperature to number_density
@@ -314,7 +520,29 @@ double harp_number_density_from_mass_density(double mass_density, double molar_m
  */
 double harp_number_density_from_pressure_and_temperature(double pressure, double temperature)
 {
-    return pressure / (CONST_BOLTZMANN * temperature);
+    return get_number_density_from_pressure_and_temperature(pressure, temperature);
+}
+
+/** Array version of harp_number_density_from_pressure_and_temperature().
+ * \param num_elements Number of elements of each array.
+ * \param pressure (Partial) pressure [Pa] (array of \a num_elements values)
+ * \param temperature Temperature [K] (array of \a num_elements values)
+ * \param result Array in which the number density [molec/m3] values will be stored.
+ */
+void harp_number_density_from_pressure_and_temperature_array(long num_elements, const double *pressure,
+                                                             const double *temperature, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_number_density_from_pressure_and_temperature(pressure[i], temperature[i]);
+    }
+}
+
+static double get_number_density_from_volume_mixing_ratio(double volume_mixing_ratio, double number_density_air)
+{
+    return volume_mixing_ratio * number_density_air;
 }
 
 /** Convert volume mixing ratio to number_density
@@ -324,7 +552,24 @@ double harp_number_density_from_pressure_and_temperature(double pressure, double
  */
 double harp_number_density_from_volume_mixing_ratio(double volume_mixing_ratio, double number_density_air)
 {
-    return volume_mixing_ratio * number_density_air;
+    return get_number_density_from_volume_mixing_ratio(volume_mixing_ratio, number_density_air);
+}
+
+/** Array version of harp_number_density_from_volume_mixing_ratio().
+ * \param num_elements Number of elements of each array.
+ * \param volume_mixing_ratio Volume mixing ratio [ppv] (array of \a num_elements values)
+ * \param number_density_air Number density of air [molec/cm3] (array of \a num_elements values)
+ * \param result Array in which the number density [molec/m3] values will be stored.
+ */
+void harp_number_density_from_volume_mixing_ratio_array(long num_elements, const double *volume_mixing_ratio,
+                                                        const double *number_density_air, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_number_density_from_volume_mixing_ratio(volume_mixing_ratio[i], number_density_air[i]);
+    }
 }
 
 /** Convert a density to a partial column using the altitude boundaries
@@ -362,6 +607,11 @@ double harp_partial_column_number_density_from_volume_mixing_ratio(double volume
         (10e-3 * molar_mass_air * g);
 }
 
+static double get_partial_pressure_from_volume_mixing_ratio_and_pressure(double volume_mixing_ratio, double pressure)
+{
+    return volume_mixing_ratio * pressure;
+}
+
 /** Convert volume mixing ratio to partial pressure
  * \param volume_mixing_ratio Volume mixing ratio [ppv]
  * \param pressure Pressure [Pa]
@@ -369,7 +619,30 @@ double harp_partial_column_number_density_from_volume_mixing_ratio(double volume
  */
 double harp_partial_pressure_from_volume_mixing_ratio_and_pressure(double volume_mixing_ratio, double pressure)
 {
-    return volume_mixing_ratio * pressure;
+    return get_partial_pressure_from_volume_mixing_ratio_and_pressure(volume_mixing_ratio, pressure);
+}
+
+/** Array version of harp_partial_pressure_from_volume_mixing_ratio_and_pressure().
+ * \param num_elements Number of elements of each array.
+ * \param volume_mixing_ratio Volume mixing ratio [ppv] (array of \a num_elements values)
+ * \param pressure Pressure [Pa] (array of \a num_elements values)
+ * \param result Array in which the partial pressure [Pa] values will be stored.
+ */
+void harp_partial_pressure_from_volume_mixing_ratio_and_pressure_array(long num_elements,
+                                                                       const double *volume_mixing_ratio,
+                                                                       const double *pressure, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_partial_pressure_from_volume_mixing_ratio_and_pressure(volume_mixing_ratio[i], pressure[i]);
+    }
+}
+
+static double get_pressure_from_number_density_and_temperature(double number_density, double temperature)
+{
+    return number_density * CONST_BOLTZMANN * temperature;
 }
 
 /** Convert number density to (partial) pressure
@@ -379,7 +652,24 @@ double harp_partial_pressure_from_volume_mixing_ratio_and_pressure(double volume
  */
 double harp_pressure_from_number_density_and_temperature(double number_density, double temperature)
 {
-    return number_density * CONST_BOLTZMANN * temperature;
+    return get_pressure_from_number_density_and_temperature(number_density, temperature);
+}
+
+/** Array version of harp_pressure_from_number_density_and_temperature().
+ * \param num_elements Number of elements of each array.
+ * \param number_density Number density [molec/m3] (array of \a num_elements values)
+ * \param temperature Temperature [K] (array of \a num_elements values)
+ * \param result Array in which the (partial) pressure [Pa] values will be stored.
+ */
+void harp_pressure_from_number_density_and_temperature_array(long num_elements, const double *number_density,
+                                                             const double *temperature, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_pressure_from_number_density_and_temperature(number_density[i], temperature[i]);
+    }
 }
 
 /** Calculate the relative humidity from the given temperature and water vapour partial pressure.
@@ -394,6 +684,11 @@ double harp_relative_humidity_from_h2o_partial_pressure_and_temperature(double p
     return partial_pressure_h2o / get_water_vapour_saturation_pressure_from_temperature(temperature);
 }
 
+static double get_temperature_from_number_density_and_pressure(double number_density, double pressure)
+{
+    return pressure / (number_density * CONST_BOLTZMANN);
+}
+
 /** Convert number density to temperature
  * \param number_density Number density [molec/m3]
  * \param pressure (partial) Pressure [Pa]
@@ -401,7 +696,29 @@ double harp_relative_humidity_from_h2o_partial_pressure_and_temperature(double p
  */
 double harp_temperature_from_number_density_and_pressure(double number_density, double pressure)
 {
-    return pressure / (number_density * CONST_BOLTZMANN);
+    return get_temperature_from_number_density_and_pressure(number_density, pressure);
+}
+
+/** Array version of harp_temperature_from_number_density_and_pressure().
+ * \param num_elements Number of elements of each array.
+ * \param number_density Number density [molec/m3] (array of \a num_elements values)
+ * \param pressure (partial) Pressure [Pa] (array of \a num_elements values)
+ * \param result Array in which the temperature [K] values will be stored.
+ */
+void harp_temperature_from_number_density_and_pressure_array(long num_elements, const double *number_density,
+                                                             const double *pressure, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_temperature_from_number_density_and_pressure(number_density[i], pressure[i]);
+    }
+}
+
+static double get_temperature_from_virtual_temperature(double virtual_temperature, double molar_mass_air)
+{
+    return virtual_temperature * molar_mass_air / CONST_MOLAR_MASS_DRY_AIR;
 }
 
 /** Calculate temperature from virtual temperature
@@ -411,7 +728,29 @@ double harp_temperature_from_number_density_and_pressure(double number_density,
  */
 double harp_temperature_from_virtual_temperature(double virtual_temperature, double molar_mass_air)
 {
-    return virtual_temperature * molar_mass_air / CONST_MOLAR_MASS_DRY_AIR;
+    return get_temperature_from_virtual_temperature(virtual_temperature, molar_mass_air);
+}
+
+/** Array version of harp_temperature_from_virtual_temperature().
+ * \param num_elements Number of elements of each array.
+ * \param virtual_temperature Virtual temperature [K] (array of \a num_elements values)
+ * \param molar_mass_air Molar mass of air [g/mol] (array of \a num_elements values)
+ * \param result Array in which the temperature [K] values will be stored.
+ */
+void harp_temperature_from_virtual_temperature_array(long num_elements, const double *virtual_temperature,
+                                                     const double *molar_mass_air, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_temperature_from_virtual_temperature(virtual_temperature[i], molar_mass_air[i]);
+    }
+}
+
+static double get_virtual_temperature_from_temperature(double temperature, double molar_mass_air)
+{
+    return temperature * CONST_MOLAR_MASS_DRY_AIR / molar_mass_air;
 }
 
 /** Calculate virtual temperature from temperature
@@ -421,7 +760,24 @@ double harp_temperature_from_virtual_temperature(double virtual_temperature, dou
  */
 double harp_virtual_temperature_from_temperature(double temperature, double molar_mass_air)
 {
-    return temperature * CONST_MOLAR_MASS_DRY_AIR / molar_mass_air;
+    return get_virtual_temperature_from_temperature(temperature, molar_mass_air);
+}
+
+/** Array version of harp_virtual_temperature_from_temperature().
+ * \param num_elements Number of elements of each array.
+ * \param temperature Temperature [K] (array of \a num_elements values)
+ * \param molar_mass_air Molar mass of air [g/mol] (array of \a num_elements values)
+ * \param result Array in which the virtual temperature [K] values will be stored.
+ */
+void harp_virtual_temperature_from_temperature_array(long num_elements, const double *temperature,
+                                                     const double *molar_mass_air, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_virtual_temperature_from_temperature(temperature[i], molar_mass_air[i]);
+    }
 }
 
 /** Convert mass mixing ratio to volume mixing ratio
@@ -436,6 +792,44 @@ double harp_volume_mixing_ratio_from_mass_mixing_ratio(double mass_mixing_ratio,
     return mass_mixing_ratio * molar_mass_air / molar_mass_species;
 }
 
+/** Convert mass mixing ratio to volume mixing ratio for all elements of an array of a single species.
+ * \param num_elements Number of elements of each array.
+ * \param species Species of the air component.
+ * \param mass_mixing_ratio Mass mixing ratio [ug/g] (array of \a num_elements values)
+ * \param molar_mass_air Molar mass of air [g/mol] (array of \a num_elements values); if NULL then the molar mass
+ * of dry air is used for all elements (i.e. conversion of dry air mixing ratios).
+ * \param result Array in which the volume mixing ratio [ppmv] values will be stored.
+ */
+void harp_volume_mixing_ratio_from_mass_mixing_ratio_for_species_array(long num_elements,
+                                                                       harp_chemical_species species,
+                                                                       const double *mass_mixing_ratio,
+                                                                       const double *molar_mass_air, double *result)
+{
+    double molar_mass_species = harp_molar_mass_for_species(species);
+    long i;
+
+    if (molar_mass_air == NULL)
+    {
+        double factor = harp_molar_mass_for_species(harp_chemical_species_dry_air) / molar_mass_species;
+
+        for (i = 0; i < num_elements; i++)
+        {
+            result[i] = mass_mixing_ratio[i] * factor;
+        }
+        return;
+    }
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = mass_mixing_ratio[i] * molar_mass_air[i] / molar_mass_species;
+    }
+}
+
+static double get_volume_mixing_ratio_from_number_density(double number_density, double number_density_air)
+{
+    return number_density / number_density_air;
+}
+
 /** Convert number density to volume mixing ratio
  * \param number_density Number density of air component [molec/m3]
  * \param number_density_air Number density of air [molec/cm3]
@@ -443,7 +837,29 @@ double harp_volume_mixing_ratio_from_mass_mixing_ratio(double mass_mixing_ratio,
  */
 double harp_volume_mixing_ratio_from_number_density(double number_density, double number_density_air)
 {
-    return number_density / number_density_air;
+    return get_volume_mixing_ratio_from_number_density(number_density, number_density_air);
+}
+
+/** Array version of harp_volume_mixing_ratio_from_number_density().
+ * \param num_elements Number of elements of each array.
+ * \param number_density Number density of air component [molec/m3] (array of \a num_elements values)
+ * \param number_density_air Number density of air [molec/cm3] (array of \a num_elements values)
+ * \param result Array in which the volume mixing ratio [ppv] values will be stored.
+ */
+void harp_volume_mixing_ratio_from_number_density_array(long num_elements, const double *number_density,
+                                                        const double *number_density_air, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_volume_mixing_ratio_from_number_density(number_density[i], number_density_air[i]);
+    }
+}
+
+static double get_volume_mixing_ratio_from_partial_pressure_and_pressure(double partial_pressure, double pressure)
+{
+    return partial_pressure / pressure;
 }
 
 /** Convert partial pressure to volume mixing ratio
@@ -453,7 +869,25 @@ double harp_volume_mixing_ratio_from_number_density(double number_density, doubl
  */
 double harp_volume_mixing_ratio_from_partial_pressure_and_pressure(double partial_pressure, double pressure)
 {
-    return partial_pressure / pressure;
+    return get_volume_mixing_ratio_from_partial_pressure_and_pressure(partial_pressure, pressure);
+}
+
+/** Array version of harp_volume_mixing_ratio_from_partial_pressure_and_pressure().
+ * \param num_elements Number of elements of each array.
+ * \param partial_pressure Partial pressure of constituent [Pa] (array of \a num_elements values)
+ * \param pressure Pressure of air [Pa] (array of \a num_elements values)
+ * \param result Array in which the volume mixing ratio [ppv] values will be stored.
+ */
+void harp_volume_mixing_ratio_from_partial_pressure_and_pressure_array(long num_elements,
+                                                                       const double *partial_pressure,
+                                                                       const double *pressure, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_volume_mixing_ratio_from_partial_pressure_and_pressure(partial_pressure[i], pressure[i]);
+    }
 }
 
 /**
@@ -112,32 +112,76 @@ harp_chemical_species harp_chemical_species_from_variable_name(const char *varia
 double harp_density_from_partial_column_and_altitude_bounds(double partial_column, const double *altitude_bounds);
 
 double harp_mass_density_from_number_density(double number_density, double molar_mass);
+void harp_mass_density_from_number_density_array(long num_elements, const double *number_density,
+                                                 const double *molar_mass, double *result);
+void harp_mass_density_from_number_density_for_species_array(long num_elements, harp_chemical_species species,
+                                                             const double *number_density, double *result);
 double harp_mass_mixing_ratio_from_density(double density, double density_air);
+void harp_mass_mixing_ratio_from_density_array(long num_elements, const double *density, const double *density_air,
+                                               double *result);
 double harp_mass_mixing_ratio_from_volume_mixing_ratio(double volume_mixing_ratio, double molar_mass_species,
                                                        double molar_mass_air);
+void harp_mass_mixing_ratio_from_volume_mixing_ratio_for_species_array(long num_elements,
+                                                                       harp_chemical_species species,
+                                                                       const double *volume_mixing_ratio,
+                                                                       const double *molar_mass_air, double *result);
 double harp_molar_mass_air_from_density_and_number_density(double density, double number_density);
+void harp_molar_mass_air_from_density_and_number_density_array(long num_elements, const double *density,
+                                                               const double *number_density, double *result);
 double harp_molar_mass_air_from_h2o_mass_mixing_ratio(double h2o_mass_mixing_ratio);
+void harp_molar_mass_air_from_h2o_mass_mixing_ratio_array(long num_elements, const double *h2o_mass_mixing_ratio,
+                                                          double *result);
 double harp_molar_mass_air_from_h2o_volume_mixing_ratio(double h2o_volume_mixing_ratio);
+void harp_molar_mass_air_from_h2o_volume_mixing_ratio_array(long num_elements, const double *h2o_volume_mixing_ratio,
+                                                            double *result);
 double harp_molar_mass_for_species(harp_chemical_species species);
 
 double harp_number_density_from_mass_density(double mass_density, double molar_mass);
+void harp_number_density_from_mass_density_array(long num_elements, const double *mass_density,
+                                                 const double *molar_mass, double *result);
+void harp_number_density_from_mass_density_for_species_array(long num_elements, harp_chemical_species species,
+                                                             const double *mass_density, double *result);
 double harp_number_density_from_pressure_and_temperature(double pressure, double temperature);
+void harp_number_density_from_pressure_and_temperature_array(long num_elements, const double *pressure,
+                                                             const double *temperature, double *result);
 double harp_number_density_from_volume_mixing_ratio(double volume_mixing_ratio, double number_density_air);
+void harp_number_density_from_volume_mixing_ratio_array(long num_elements, const double *volume_mixing_ratio,
+                                                        const double *number_density_air, double *result);
 double harp_partial_column_from_density_and_altitude_bounds(double density, const double *altitude_bounds);
 double harp_partial_column_number_density_from_volume_mixing_ratio(double volume_mixing_ratio, double latitude,
                                                                    double molar_mass_air,
                                                                    const double *pressure_bounds);
 double harp_partial_pressure_from_volume_mixing_ratio_and_pressure(double volume_mixing_ratio, double pressure);
+void harp_partial_pressure_from_volume_mixing_ratio_and_pressure_array(long num_elements,
+                                                                       const double *volume_mixing_ratio,
+                                                                       const double *pressure, double *result);
 double harp_pressure_from_number_density_and_temperature(double number_density, double temperature);
+void harp_pressure_from_number_density_and_temperature_array(long num_elements, const double *number_density,
+                                                             const double *temperature, double *result);
 double harp_relative_humidity_from_h2o_partial_pressure_and_temperature(double partial_pressure_h2o,
                                                                         double temperature);
 
 double harp_temperature_from_number_density_and_pressure(double number_density, double pressure);
+void harp_temperature_from_number_density_and_pressure_array(long num_elements, const double *number_density,
+                                                             const double *pressure, double *result);
 double harp_temperature_from_virtual_temperature(double virtual_temperature, double molar_mass_air);
+void harp_temperature_from_virtual_temperature_array(long num_elements, const double *virtual_temperature,
+                                                     const double *molar_mass_air, double *result);
 double harp_virtual_temperature_from_temperature(double virtual_temperature, double molar_mass_air);
+void harp_virtual_temperature_from_temperature_array(long num_elements, const double *temperature,
+                                                     const double *molar_mass_air, double *result);
 double harp_volume_mixing_ratio_from_mass_mixing_ratio(double mass_mixing_ratio, double molar_mass_species,
                                                        double molar_mass_air);
+void harp_volume_mixing_ratio_from_mass_mixing_ratio_for_species_array(long num_elements,
+                                                                       harp_chemical_species species,
+                                                                       const double *mass_mixing_ratio,
+                                                                       const double *molar_mass_air, double *result);
 double harp_volume_mixing_ratio_from_number_density(double number_density, double number_density_air);
+void harp_volume_mixing_ratio_from_number_density_array(long num_elements, const double *number_density,
+                                                        const double *number_density_air, double *result);
 double harp_volume_mixing_ratio_from_partial_pressure_and_pressure(double partial_pressure, double pressure);
+void harp_volume_mixing_ratio_from_partial_pressure_and_pressure_array(long num_elements,
+                                                                       const double *partial_pressure,
+                                                                       const double *pressure, double *result);
 
 #endif
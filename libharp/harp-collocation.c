@@ -31,6 +31,7 @@
 
 #include "harp-internal.h"
 #include "harp-csv.h"
+#include "harp-thread.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -39,6 +40,14 @@
 
 #define COLLOCATION_RESULT_BLOCK_SIZE 1024
 
+/* the binary collocation result format starts with this magic sequence, followed by a format version number */
+#define BINARY_MAGIC "HARPCOLR"
+#define BINARY_MAGIC_LENGTH 8
+#define BINARY_FORMAT_VERSION 1
+
+/* number of pair records that are read/written at once for the binary format */
+#define BINARY_PAIR_BLOCK_SIZE 4096
+
 /** \defgroup harp_collocation HARP Collocation
  * The HARP Collocation module contains the functionality that deals with collocation two datasets
  * of products. The two datasets are referred to as dataset A (primary) and dataset B (secondary).
@@ -60,15 +69,11 @@ static void collocation_pair_swap_datasets(harp_collocation_pair *pair)
     pair->sample_index_b = sample_a;
 }
 
+/* A pair and its differences are stored in a single allocation (the difference array directly follows the pair) */
 static void collocation_pair_delete(harp_collocation_pair *pair)
 {
     if (pair != NULL)
     {
-        if (pair->difference != NULL)
-        {
-            free(pair->difference);
-        }
-
         free(pair);
     }
 }
@@ -80,11 +85,11 @@ static int collocation_pair_new(long collocation_index, long product_index_a, lo
     harp_collocation_pair *pair;
     int i;
 
-    pair = (harp_collocation_pair *)malloc(sizeof(harp_collocation_pair));
+    pair = (harp_collocation_pair *)malloc(sizeof(harp_collocation_pair) + num_differences * sizeof(double));
     if (pair == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       sizeof(harp_collocation_pair), __FILE__, __LINE__);
+                       sizeof(harp_collocation_pair) + num_differences * sizeof(double), __FILE__, __LINE__);
         return -1;
     }
 
@@ -97,23 +102,156 @@ static int collocation_pair_new(long collocation_index, long product_index_a, lo
     pair->sample_index_b = sample_index_b;
 
     pair->num_differences = num_differences;
-    pair->difference = NULL;
+    pair->difference = (double *)(pair + 1);
+
+    for (i = 0; i < num_differences; i++)
+    {
+        pair->difference[i] = difference[i];
+    }
+
+    *new_pair = pair;
+    return 0;
+}
+
+/* Lookup indices on the pairs of a collocation result. Each index is built on first use and all indices are dropped
+ * as soon as the set or the order of the pairs of the collocation result changes.
+ * The pairs of product i of dataset A are pair_by_a[offset_a[i]] .. pair_by_a[offset_a[i + 1] - 1] (in the order of
+ * the collocation result), and similarly for dataset B.
+ */
+struct harp_collocation_result_index_struct
+{
+    long num_products_a;
+    long *offset_a;
+    harp_collocation_pair **pair_by_a;
+    long num_products_b;
+    long *offset_b;
+    harp_collocation_pair **pair_by_b;
+    harp_collocation_pair **pair_by_collocation_index;  /* pairs sorted by collocation_index */
+};
+
+static void collocation_result_index_delete(struct harp_collocation_result_index_struct *index)
+{
+    if (index->offset_a != NULL)
+    {
+        free(index->offset_a);
+    }
+    if (index->pair_by_a != NULL)
+    {
+        free(index->pair_by_a);
+    }
+    if (index->offset_b != NULL)
+    {
+        free(index->offset_b);
+    }
+    if (index->pair_by_b != NULL)
+    {
+        free(index->pair_by_b);
+    }
+    if (index->pair_by_collocation_index != NULL)
+    {
+        free(index->pair_by_collocation_index);
+    }
+    free(index);
+}
+
+/* needs to be called by every function that adds, removes, or reorders pairs */
+static void collocation_result_reset_index(harp_collocation_result *collocation_result)
+{
+    if (collocation_result->index != NULL)
+    {
+        collocation_result_index_delete(collocation_result->index);
+        collocation_result->index = NULL;
+    }
+}
+
+/* the lookup indices are a cache and are the only part of the collocation result that gets updated */
+static int collocation_result_get_index(const harp_collocation_result *collocation_result,
+                                        struct harp_collocation_result_index_struct **index)
+{
+    if (collocation_result->index == NULL)
+    {
+        struct harp_collocation_result_index_struct *new_index;
+
+        new_index = (struct harp_collocation_result_index_struct *)
+            malloc(sizeof(struct harp_collocation_result_index_struct));
+        if (new_index == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(struct harp_collocation_result_index_struct), __FILE__, __LINE__);
+            return -1;
+        }
+        new_index->num_products_a = 0;
+        new_index->offset_a = NULL;
+        new_index->pair_by_a = NULL;
+        new_index->num_products_b = 0;
+        new_index->offset_b = NULL;
+        new_index->pair_by_b = NULL;
+        new_index->pair_by_collocation_index = NULL;
+        ((harp_collocation_result *)collocation_result)->index = new_index;
+    }
+
+    *index = collocation_result->index;
+    return 0;
+}
+
+/* group the pairs by product of dataset A (use_b = 0) or dataset B (use_b = 1) using a counting sort */
+static int collocation_result_index_products(const harp_collocation_result *collocation_result, int use_b,
+                                             long *num_products, long **offset, harp_collocation_pair ***pair)
+{
+    harp_collocation_pair **grouped_pair;
+    long *product_offset;
+    long *position;
+    long i;
 
-    pair->difference = malloc(num_differences * sizeof(double));
-    if (pair->difference == NULL)
+    *num_products = use_b ? collocation_result->dataset_b->num_products : collocation_result->dataset_a->num_products;
+    product_offset = (long *)calloc(*num_products + 1, sizeof(long));
+    if (product_offset == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (*num_products + 1) * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    grouped_pair = malloc((collocation_result->num_pairs > 0 ? collocation_result->num_pairs : 1) *
+                          sizeof(harp_collocation_pair *));
+    if (grouped_pair == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       collocation_result->num_pairs * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
+        free(product_offset);
+        return -1;
+    }
+    position = (long *)malloc((*num_products + 1) * sizeof(long));
+    if (position == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       sizeof(harp_collocation_pair), __FILE__, __LINE__);
-        collocation_pair_delete(pair);
+                       (*num_products + 1) * sizeof(long), __FILE__, __LINE__);
+        free(grouped_pair);
+        free(product_offset);
         return -1;
     }
 
-    for (i = 0; i < num_differences; i++)
+    for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        pair->difference[i] = difference[i];
+        const harp_collocation_pair *pair = collocation_result->pair[i];
+
+        product_offset[(use_b ? pair->product_index_b : pair->product_index_a) + 1]++;
+    }
+    for (i = 0; i < *num_products; i++)
+    {
+        product_offset[i + 1] += product_offset[i];
     }
+    memcpy(position, product_offset, (*num_products + 1) * sizeof(long));
+    for (i = 0; i < collocation_result->num_pairs; i++)
+    {
+        harp_collocation_pair *pair = collocation_result->pair[i];
+
+        grouped_pair[position[use_b ? pair->product_index_b : pair->product_index_a]++] = pair;
+    }
+    free(position);
+
+    *offset = product_offset;
+    *pair = grouped_pair;
 
-    *new_pair = pair;
     return 0;
 }
 
@@ -152,6 +290,7 @@ LIBHARP_API int harp_collocation_result_new(harp_collocation_result **new_colloc
     collocation_result->difference_unit = NULL;
     collocation_result->num_pairs = 0;
     collocation_result->pair = NULL;
+    collocation_result->index = NULL;
 
     if (harp_dataset_new(&collocation_result->dataset_a) != 0)
     {
@@ -178,6 +317,7 @@ LIBHARP_API int harp_collocation_result_new(harp_collocation_result **new_colloc
         {
             collocation_result->difference_variable_name[i] = NULL;
         }
+        collocation_result->num_differences = num_differences;
         collocation_result->difference_unit = malloc(num_differences * sizeof(char *));
         if (collocation_result->difference_unit == NULL)
         {
@@ -282,6 +422,7 @@ LIBHARP_API void harp_collocation_result_delete(harp_collocation_result *colloca
         }
         free(collocation_result->pair);
     }
+    collocation_result_reset_index(collocation_result);
 
     free(collocation_result);
 }
@@ -328,107 +469,214 @@ int harp_collocation_result_add_difference(harp_collocation_result *collocation_
                        __FILE__, __LINE__);
         return -1;
     }
-    collocation_result->difference_unit[index] = strdup(difference_unit);
-    if (collocation_result->difference_unit[index] == NULL)
+    if (difference_unit != NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)",
-                       __FILE__, __LINE__);
-        return -1;
+        collocation_result->difference_unit[index] = strdup(difference_unit);
+        if (collocation_result->difference_unit[index] == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)",
+                           __FILE__, __LINE__);
+            return -1;
+        }
     }
 
     return 0;
 }
 
-static harp_dataset *sort_dataset_a = NULL;
-static harp_dataset *sort_dataset_b = NULL;
+/* sort key for a collocation pair; the key fields are compared in order (key[0] being the most significant) */
+typedef struct pair_sort_key_struct
+{
+    uint64_t key[4];
+    harp_collocation_pair *pair;
+} pair_sort_key;
+
+/* map a signed value to an unsigned value with the same ordering */
+static uint64_t get_sort_key_value(long value)
+{
+    return (uint64_t)(int64_t)value ^ ((uint64_t)1 << 63);
+}
 
-static int compare_by_a(const void *a, const void *b)
+/* Sort the keys on the first num_fields key fields using a (stable) LSD radix sort with 8-bit digits.
+ * Passes for a digit that is the same for all keys (such as the upper bytes of indices) are skipped.
+ * On return *key will point to the sorted keys (which can be a different buffer than the one that was passed).
+ */
+static int radix_sort_pair_keys(long num_keys, int num_fields, pair_sort_key **key)
 {
-    harp_collocation_pair *pair_a = *(harp_collocation_pair **)a;
-    harp_collocation_pair *pair_b = *(harp_collocation_pair **)b;
+    pair_sort_key *source = *key;
+    pair_sort_key *target;
+    long *count;
+    long i;
+    int f, d;
 
-    if (pair_a->product_index_a != pair_b->product_index_a)
+    count = calloc(num_fields * 8 * 256, sizeof(long));
+    if (count == NULL)
     {
-        return strcmp(sort_dataset_a->source_product[pair_a->product_index_a],
-                      sort_dataset_a->source_product[pair_b->product_index_a]);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_fields * 8 * 256 * sizeof(long), __FILE__, __LINE__);
+        return -1;
     }
-    if (pair_a->sample_index_a < pair_b->sample_index_a)
+    target = malloc(num_keys * sizeof(pair_sort_key));
+    if (target == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_keys * sizeof(pair_sort_key), __FILE__, __LINE__);
+        free(count);
         return -1;
     }
-    if (pair_a->sample_index_a > pair_b->sample_index_a)
+
+    /* determine the histograms for all digits in a single pass */
+    for (i = 0; i < num_keys; i++)
+    {
+        for (f = 0; f < num_fields; f++)
+        {
+            for (d = 0; d < 8; d++)
+            {
+                count[(f * 8 + d) * 256 + ((source[i].key[f] >> (8 * d)) & 0xff)]++;
+            }
+        }
+    }
+
+    for (f = num_fields - 1; f >= 0; f--)
     {
-        return 1;
+        for (d = 0; d < 8; d++)
+        {
+            long *digit_count = &count[(f * 8 + d) * 256];
+            long offset = 0;
+            int shift = 8 * d;
+
+            if (digit_count[(source[0].key[f] >> shift) & 0xff] == num_keys)
+            {
+                continue;
+            }
+            /* turn the histogram into the start offset for each digit value */
+            for (i = 0; i < 256; i++)
+            {
+                long digit_num_keys = digit_count[i];
+
+                digit_count[i] = offset;
+                offset += digit_num_keys;
+            }
+            for (i = 0; i < num_keys; i++)
+            {
+                target[digit_count[(source[i].key[f] >> shift) & 0xff]++] = source[i];
+            }
+            {
+                pair_sort_key *swap = source;
+
+                source = target;
+                target = swap;
+            }
+        }
     }
 
-    /* If a is equal, then further sort by b to get a fixed ordering. */
-    if (pair_a->product_index_b != pair_b->product_index_b)
+    free(target);
+    free(count);
+    *key = source;
+
+    return 0;
+}
+
+/* Set the sort key fields of a pair for the given order and return the number of key fields that are used.
+ * rank_a and rank_b give the position of each product in the sorted product list of dataset A and B (see
+ * get_product_rank()); they are not used when sorting by collocation index.
+ */
+static int set_pair_sort_key(uint64_t *key, const harp_collocation_pair *pair, harp_collocation_sort_order sort_order,
+                             const long *rank_a, const long *rank_b)
+{
+    int offset_a = sort_order == harp_collocation_sort_by_b ? 2 : 0;
+    int offset_b = sort_order == harp_collocation_sort_by_b ? 0 : 2;
+
+    if (sort_order == harp_collocation_sort_by_collocation_index)
     {
-        return strcmp(sort_dataset_b->source_product[pair_a->product_index_b],
-                      sort_dataset_b->source_product[pair_b->product_index_b]);
+        key[0] = get_sort_key_value(pair->collocation_index);
+        return 1;
     }
-    if (pair_a->sample_index_b < pair_b->sample_index_b)
+    key[offset_a] = get_sort_key_value(rank_a[pair->product_index_a]);
+    key[offset_a + 1] = get_sort_key_value(pair->sample_index_a);
+    key[offset_b] = get_sort_key_value(rank_b[pair->product_index_b]);
+    key[offset_b + 1] = get_sort_key_value(pair->sample_index_b);
+
+    return 4;
+}
+
+/* determine for each product in the dataset its position in the sorted list of source product names */
+static int get_product_rank(harp_dataset *dataset, long **new_rank)
+{
+    long *rank;
+    long i;
+
+    rank = malloc((dataset->num_products > 0 ? dataset->num_products : 1) * sizeof(long));
+    if (rank == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(long), __FILE__, __LINE__);
         return -1;
     }
-    if (pair_a->sample_index_b > pair_b->sample_index_b)
+    for (i = 0; i < dataset->num_products; i++)
     {
-        return 1;
+        rank[dataset->sorted_index[i]] = i;
     }
 
+    *new_rank = rank;
     return 0;
 }
 
-static int compare_by_b(const void *a, const void *b)
+/* Sort the pairs by dataset A (by_a = 1) or by dataset B (by_a = 0).
+ * Pairs are sorted on source product name and sample index of the first dataset and then on source product name and
+ * sample index of the other dataset (to get a fixed ordering). Source product names are compared using their position
+ * in the sorted product list of the dataset, such that the sort only needs to compare integers.
+ */
+static int sort_pairs(harp_collocation_result *collocation_result, int by_a)
 {
-    harp_collocation_pair *pair_a = *(harp_collocation_pair **)a;
-    harp_collocation_pair *pair_b = *(harp_collocation_pair **)b;
+    pair_sort_key *key;
+    long *rank_a = NULL;
+    long *rank_b = NULL;
+    long i;
 
-    if (pair_a->product_index_b != pair_b->product_index_b)
+    collocation_result_reset_index(collocation_result);
+    if (collocation_result->num_pairs == 0)
     {
-        return strcmp(sort_dataset_b->source_product[pair_a->product_index_b],
-                      sort_dataset_b->source_product[pair_b->product_index_b]);
+        return 0;
     }
-    if (pair_a->sample_index_b < pair_b->sample_index_b)
+
+    if (get_product_rank(collocation_result->dataset_a, &rank_a) != 0)
     {
         return -1;
     }
-    if (pair_a->sample_index_b > pair_b->sample_index_b)
-    {
-        return 1;
-    }
-
-    /* If b is equal, then further sort by a to get a fixed ordering. */
-    if (pair_a->product_index_a != pair_b->product_index_a)
+    if (get_product_rank(collocation_result->dataset_b, &rank_b) != 0)
     {
-        return strcmp(sort_dataset_a->source_product[pair_a->product_index_b],
-                      sort_dataset_a->source_product[pair_b->product_index_b]);
+        free(rank_a);
+        return -1;
     }
-    if (pair_a->sample_index_a < pair_b->sample_index_a)
+    key = malloc(collocation_result->num_pairs * sizeof(pair_sort_key));
+    if (key == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       collocation_result->num_pairs * sizeof(pair_sort_key), __FILE__, __LINE__);
+        free(rank_b);
+        free(rank_a);
         return -1;
     }
-    if (pair_a->sample_index_a > pair_b->sample_index_a)
+    for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        return 1;
+        set_pair_sort_key(key[i].key, collocation_result->pair[i],
+                          by_a ? harp_collocation_sort_by_a : harp_collocation_sort_by_b, rank_a, rank_b);
+        key[i].pair = collocation_result->pair[i];
     }
+    free(rank_b);
+    free(rank_a);
 
-    return 0;
-}
-
-static int compare_by_collocation_index(const void *a, const void *b)
-{
-    harp_collocation_pair *pair_a = *(harp_collocation_pair **)a;
-    harp_collocation_pair *pair_b = *(harp_collocation_pair **)b;
-
-    if (pair_a->collocation_index < pair_b->collocation_index)
+    if (radix_sort_pair_keys(collocation_result->num_pairs, 4, &key) != 0)
     {
+        free(key);
         return -1;
     }
-    if (pair_a->collocation_index > pair_b->collocation_index)
+
+    for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        return 1;
+        collocation_result->pair[i] = key[i].pair;
     }
+    free(key);
 
     return 0;
 }
@@ -446,12 +694,7 @@ static int compare_by_collocation_index(const void *a, const void *b)
  */
 LIBHARP_API int harp_collocation_result_sort_by_a(harp_collocation_result *collocation_result)
 {
-    sort_dataset_a = collocation_result->dataset_a;
-    sort_dataset_b = collocation_result->dataset_b;
-    qsort(collocation_result->pair, collocation_result->num_pairs, sizeof(harp_collocation_pair *), compare_by_a);
-    sort_dataset_a = NULL;
-    sort_dataset_b = NULL;
-    return 0;
+    return sort_pairs(collocation_result, 1);
 }
 
 /** Sort the collocation result pairs by dataset B
@@ -463,12 +706,7 @@ LIBHARP_API int harp_collocation_result_sort_by_a(harp_collocation_result *collo
  */
 LIBHARP_API int harp_collocation_result_sort_by_b(harp_collocation_result *collocation_result)
 {
-    sort_dataset_a = collocation_result->dataset_a;
-    sort_dataset_b = collocation_result->dataset_b;
-    qsort(collocation_result->pair, collocation_result->num_pairs, sizeof(harp_collocation_pair *), compare_by_b);
-    sort_dataset_a = NULL;
-    sort_dataset_b = NULL;
-    return 0;
+    return sort_pairs(collocation_result, 0);
 }
 
 /** Sort the collocation result pairs by collocation index
@@ -479,8 +717,40 @@ LIBHARP_API int harp_collocation_result_sort_by_b(harp_collocation_result *collo
  */
 LIBHARP_API int harp_collocation_result_sort_by_collocation_index(harp_collocation_result *collocation_result)
 {
-    qsort(collocation_result->pair, collocation_result->num_pairs, sizeof(harp_collocation_pair *),
-          compare_by_collocation_index);
+    pair_sort_key *key;
+    long i;
+
+    collocation_result_reset_index(collocation_result);
+    if (collocation_result->num_pairs == 0)
+    {
+        return 0;
+    }
+
+    key = malloc(collocation_result->num_pairs * sizeof(pair_sort_key));
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       collocation_result->num_pairs * sizeof(pair_sort_key), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < collocation_result->num_pairs; i++)
+    {
+        key[i].key[0] = get_sort_key_value(collocation_result->pair[i]->collocation_index);
+        key[i].pair = collocation_result->pair[i];
+    }
+
+    if (radix_sort_pair_keys(collocation_result->num_pairs, 1, &key) != 0)
+    {
+        free(key);
+        return -1;
+    }
+
+    for (i = 0; i < collocation_result->num_pairs; i++)
+    {
+        collocation_result->pair[i] = key[i].pair;
+    }
+    free(key);
+
     return 0;
 }
 
@@ -496,24 +766,27 @@ LIBHARP_API int harp_collocation_result_filter_for_source_product_a(harp_colloca
                                                                     const char *source_product)
 {
     long product_index;
-    long i, j;
+    long num_pairs = 0;
+    long i;
 
     if (harp_dataset_get_index_from_source_product(collocation_result->dataset_a, source_product, &product_index) != 0)
     {
         return -1;
     }
-    for (i = collocation_result->num_pairs - 1; i >= 0; i--)
+    collocation_result_reset_index(collocation_result);
+    for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        if (collocation_result->pair[i]->product_index_a != product_index)
+        if (collocation_result->pair[i]->product_index_a == product_index)
+        {
+            collocation_result->pair[num_pairs] = collocation_result->pair[i];
+            num_pairs++;
+        }
+        else
         {
             collocation_pair_delete(collocation_result->pair[i]);
-            for (j = i + 1; j < collocation_result->num_pairs; j++)
-            {
-                collocation_result->pair[j - 1] = collocation_result->pair[j];
-            }
-            collocation_result->num_pairs--;
         }
     }
+    collocation_result->num_pairs = num_pairs;
     return 0;
 }
 
@@ -529,36 +802,39 @@ LIBHARP_API int harp_collocation_result_filter_for_source_product_b(harp_colloca
                                                                     const char *source_product)
 {
     long product_index;
-    long i, j;
+    long num_pairs = 0;
+    long i;
 
     if (harp_dataset_get_index_from_source_product(collocation_result->dataset_b, source_product, &product_index) != 0)
     {
         return -1;
     }
-    for (i = collocation_result->num_pairs - 1; i >= 0; i--)
+    collocation_result_reset_index(collocation_result);
+    for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        if (collocation_result->pair[i]->product_index_b != product_index)
+        if (collocation_result->pair[i]->product_index_b == product_index)
+        {
+            collocation_result->pair[num_pairs] = collocation_result->pair[i];
+            num_pairs++;
+        }
+        else
         {
             collocation_pair_delete(collocation_result->pair[i]);
-            for (j = i + 1; j < collocation_result->num_pairs; j++)
-            {
-                collocation_result->pair[j - 1] = collocation_result->pair[j];
-            }
-            collocation_result->num_pairs--;
         }
     }
+    collocation_result->num_pairs = num_pairs;
     return 0;
 }
 
-/* This function uses a binary search and assumes the collocation result to be sorted by collocation index */
-static int find_collocation_pair_for_collocation_index(harp_collocation_result *collocation_result,
+/* This function uses a binary search and assumes the pairs to be sorted by collocation index */
+static int find_collocation_pair_for_collocation_index(long num_pairs, harp_collocation_pair **pair,
                                                        long collocation_index, long *index)
 {
     long lower_index;
     long upper_index;
 
     lower_index = 0;
-    upper_index = collocation_result->num_pairs - 1;
+    upper_index = num_pairs - 1;
 
     while (upper_index >= lower_index)
     {
@@ -566,14 +842,14 @@ static int find_collocation_pair_for_collocation_index(harp_collocation_result *
         long pivot_index = lower_index + ((upper_index - lower_index) / 2);
 
         /* If the pivot equals the key, terminate early. */
-        if (collocation_result->pair[pivot_index]->collocation_index == collocation_index)
+        if (pair[pivot_index]->collocation_index == collocation_index)
         {
             *index = pivot_index;
             return 0;
         }
 
         /* If the pivot is smaller than the key, search the upper sub array, otherwise search the lower sub array. */
-        if (collocation_result->pair[pivot_index]->collocation_index < collocation_index)
+        if (pair[pivot_index]->collocation_index < collocation_index)
         {
             lower_index = pivot_index + 1;
         }
@@ -583,7 +859,7 @@ static int find_collocation_pair_for_collocation_index(harp_collocation_result *
         }
     }
 
-    harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot find collocation index %d in collocation results",
+    harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot find collocation index %ld in collocation results",
                    collocation_index);
     return -1;
 }
@@ -602,7 +878,8 @@ LIBHARP_API int harp_collocation_result_filter_for_collocation_indices(harp_coll
                                                                        long num_indices, int32_t *collocation_index)
 {
     harp_collocation_pair **pair = NULL;
-    long num_pairs = 0;
+    uint8_t *found = NULL;
+    long num_allocated;
     long i;
 
     if (harp_collocation_result_sort_by_collocation_index(collocation_result) != 0)
@@ -610,48 +887,61 @@ LIBHARP_API int harp_collocation_result_filter_for_collocation_indices(harp_coll
         return -1;
     }
 
-    /* create a temporary array to store all pairs */
-    pair = malloc(collocation_result->num_pairs * sizeof(harp_collocation_pair *));
+    /* create a new array for the selected pairs (the size should be a multiple of the block size, as expected by
+     * harp_collocation_result_add_pair) */
+    num_allocated = (num_indices / COLLOCATION_RESULT_BLOCK_SIZE + 1) * COLLOCATION_RESULT_BLOCK_SIZE;
+    pair = malloc(num_allocated * sizeof(harp_collocation_pair *));
     if (!pair)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       collocation_result->num_pairs * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
+                       num_allocated * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
+        return -1;
+    }
+    found = calloc(collocation_result->num_pairs, sizeof(uint8_t));
+    if (collocation_result->num_pairs > 0 && found == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       collocation_result->num_pairs * sizeof(uint8_t), __FILE__, __LINE__);
+        free(pair);
         return -1;
     }
 
     for (i = 0; i < num_indices; i++)
     {
         long index;
-        long j;
 
-        if (find_collocation_pair_for_collocation_index(collocation_result, collocation_index[i], &index) != 0)
+        if (find_collocation_pair_for_collocation_index(collocation_result->num_pairs, collocation_result->pair,
+                                                        collocation_index[i], &index) != 0)
         {
             goto error;
         }
-        pair[num_pairs] = collocation_result->pair[index];
-        num_pairs++;
-        for (j = index + 1; j < collocation_result->num_pairs; j++)
+        if (found[index])
         {
-            collocation_result->pair[j - 1] = collocation_result->pair[j];
+            /* each pair can only be selected once */
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot find collocation index %d in collocation results",
+                           collocation_index[i]);
+            goto error;
         }
-        collocation_result->num_pairs--;
+        found[index] = 1;
+        pair[i] = collocation_result->pair[index];
     }
 
     for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        collocation_pair_delete(collocation_result->pair[i]);
+        if (!found[i])
+        {
+            collocation_pair_delete(collocation_result->pair[i]);
+        }
     }
+    free(found);
     free(collocation_result->pair);
     collocation_result->pair = pair;
-    collocation_result->num_pairs = num_pairs;
+    collocation_result->num_pairs = num_indices;
 
     return 0;
 
   error:
-    for (i = 0; i < num_pairs; i++)
-    {
-        collocation_pair_delete(pair[i]);
-    }
+    free(found);
     free(pair);
 
     return -1;
@@ -732,6 +1022,7 @@ LIBHARP_API int harp_collocation_result_add_pair(harp_collocation_result *colloc
         collocation_result->pair = new_pair;
     }
 
+    collocation_result_reset_index(collocation_result);
     collocation_result->pair[collocation_result->num_pairs] = pair;
     collocation_result->num_pairs++;
     return 0;
@@ -755,6 +1046,7 @@ LIBHARP_API int harp_collocation_result_remove_pair_at_index(harp_collocation_re
         return -1;
     }
 
+    collocation_result_reset_index(collocation_result);
     collocation_pair_delete(collocation_result->pair[index]);
     for (i = index + 1; i < collocation_result->num_pairs; i++)
     {
@@ -765,6 +1057,49 @@ LIBHARP_API int harp_collocation_result_remove_pair_at_index(harp_collocation_re
     return 0;
 }
 
+/** Filter collocation result entries using a mask
+ * Only the entries for which the corresponding mask value is non-zero will be retained. The relative order of the
+ * retained entries is preserved. This takes time linear in the number of entries.
+ * \param collocation_result Result set that will be filtered in place.
+ * \param mask Array of length collocation_result->num_pairs with a keep (non-zero) or remove (zero) value per entry.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_collocation_result_filter(harp_collocation_result *collocation_result, const uint8_t *mask)
+{
+    long num_pairs = 0;
+    long i;
+
+    if (collocation_result == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocation_result is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (mask == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "mask is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    collocation_result_reset_index(collocation_result);
+    for (i = 0; i < collocation_result->num_pairs; i++)
+    {
+        if (mask[i])
+        {
+            collocation_result->pair[num_pairs] = collocation_result->pair[i];
+            num_pairs++;
+        }
+        else
+        {
+            collocation_pair_delete(collocation_result->pair[i]);
+        }
+    }
+    collocation_result->num_pairs = num_pairs;
+
+    return 0;
+}
+
 /**
  * @}
  */
@@ -840,17 +1175,38 @@ static int read_header(FILE *file, harp_collocation_result *collocation_result)
     return 0;
 }
 
+/* Parse a (trimmed) csv pair line; the source product names will point into the line */
+static int parse_pair(char *line, int num_differences, long *collocation_index, char **source_product_a,
+                      long *index_a, char **source_product_b, long *index_b, double *difference)
+{
+    char *cursor = line;
+    int i;
+
+    harp_csv_parse_long(&cursor, collocation_index);
+    harp_csv_parse_string(&cursor, source_product_a);
+    harp_csv_parse_long(&cursor, index_a);
+    harp_csv_parse_string(&cursor, source_product_b);
+    harp_csv_parse_long(&cursor, index_b);
+    for (i = 0; i < num_differences; i++)
+    {
+        if (harp_csv_parse_double(&cursor, &difference[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 static int read_pair(FILE *file, harp_collocation_result *collocation_result)
 {
     char line[HARP_CSV_LINE_LENGTH];
-    char *cursor = line;
     long collocation_index;
     char *source_product_a;
     char *source_product_b;
     long index_a;
     long index_b;
     double *difference = NULL;
-    int i;
 
     if (fgets(line, HARP_CSV_LINE_LENGTH, file) == NULL)
     {
@@ -860,13 +1216,6 @@ static int read_pair(FILE *file, harp_collocation_result *collocation_result)
 
     harp_csv_rtrim(line);
 
-    /* Parse line */
-    harp_csv_parse_long(&cursor, &collocation_index);
-    harp_csv_parse_string(&cursor, &source_product_a);
-    harp_csv_parse_long(&cursor, &index_a);
-    harp_csv_parse_string(&cursor, &source_product_b);
-    harp_csv_parse_long(&cursor, &index_b);
-
     if (collocation_result->num_differences > 0)
     {
         difference = malloc(collocation_result->num_differences * sizeof(double));
@@ -876,187 +1225,2095 @@ static int read_pair(FILE *file, harp_collocation_result *collocation_result)
                            collocation_result->num_differences * sizeof(double), __FILE__, __LINE__);
             return -1;
         }
-        for (i = 0; i < collocation_result->num_differences; i++)
-        {
-            if (harp_csv_parse_double(&cursor, &difference[i]) != 0)
-            {
-                free(difference);
+    }
+
+    /* Parse line */
+    if (parse_pair(line, collocation_result->num_differences, &collocation_index, &source_product_a, &index_a,
+                   &source_product_b, &index_b, difference) != 0)
+    {
+        if (difference != NULL)
+        {
+            free(difference);
+        }
+        return -1;
+    }
+
+    /* add the products to the datasets without sorting; the datasets are sorted once all pairs have been read */
+    if (harp_dataset_add_product_unsorted(collocation_result->dataset_a, source_product_a, NULL) != 0 ||
+        harp_dataset_add_product_unsorted(collocation_result->dataset_b, source_product_b, NULL) != 0)
+    {
+        if (difference != NULL)
+        {
+            free(difference);
+        }
+        return -1;
+    }
+
+    if (harp_collocation_result_add_pair(collocation_result, collocation_index, source_product_a, index_a,
+                                         source_product_b, index_b, collocation_result->num_differences, difference)
+        != 0)
+    {
+        if (difference != NULL)
+        {
+            free(difference);
+        }
+        return -1;
+    }
+
+    if (difference != NULL)
+    {
+        free(difference);
+    }
+
+    return 0;
+}
+
+/* The binary collocation result format consists of (all numbers are stored in little endian byte order):
+ *   - the magic sequence "HARPCOLR" followed by the format version (int32)
+ *   - num_differences (int32) followed by the variable name and unit of each difference (strings)
+ *   - the number of products in dataset A (int64) followed by the source product names (strings)
+ *   - the number of products in dataset B (int64) followed by the source product names (strings)
+ *   - num_pairs (int64) followed by a fixed size record per pair:
+ *     collocation_index (int64), product_index_a (int32), product_index_b (int32), sample_index_a (int64),
+ *     sample_index_b (int64), difference values (num_differences doubles)
+ * A string is stored as its length (int32) followed by the characters (without terminating zero). A length of -1
+ * indicates a NULL string (which is used for a difference without unit).
+ * The product indices of a pair refer to the position of the product in the list of source product names.
+ */
+
+static void encode_int32(unsigned char *buffer, int32_t value)
+{
+    uint32_t v = (uint32_t)value;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        buffer[i] = (unsigned char)(v & 0xff);
+        v >>= 8;
+    }
+}
+
+static void encode_int64(unsigned char *buffer, int64_t value)
+{
+    uint64_t v = (uint64_t)value;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        buffer[i] = (unsigned char)(v & 0xff);
+        v >>= 8;
+    }
+}
+
+static void encode_double(unsigned char *buffer, double value)
+{
+    uint64_t v;
+
+    memcpy(&v, &value, sizeof(double));
+    encode_int64(buffer, (int64_t)v);
+}
+
+static int32_t decode_int32(const unsigned char *buffer)
+{
+    uint32_t v = 0;
+    int i;
+
+    for (i = 3; i >= 0; i--)
+    {
+        v = (v << 8) | buffer[i];
+    }
+
+    return (int32_t)v;
+}
+
+static int64_t decode_int64(const unsigned char *buffer)
+{
+    uint64_t v = 0;
+    int i;
+
+    for (i = 7; i >= 0; i--)
+    {
+        v = (v << 8) | buffer[i];
+    }
+
+    return (int64_t)v;
+}
+
+static double decode_double(const unsigned char *buffer)
+{
+    uint64_t v = (uint64_t)decode_int64(buffer);
+    double value;
+
+    memcpy(&value, &v, sizeof(double));
+
+    return value;
+}
+
+static int write_binary_data(FILE *file, const void *data, size_t length)
+{
+    if (length > 0 && fwrite(data, 1, length, file) != length)
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "error writing collocation result file");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int write_binary_int32(FILE *file, int32_t value)
+{
+    unsigned char buffer[4];
+
+    encode_int32(buffer, value);
+
+    return write_binary_data(file, buffer, 4);
+}
+
+static int write_binary_int64(FILE *file, int64_t value)
+{
+    unsigned char buffer[8];
+
+    encode_int64(buffer, value);
+
+    return write_binary_data(file, buffer, 8);
+}
+
+static int write_binary_string(FILE *file, const char *str)
+{
+    if (str == NULL)
+    {
+        return write_binary_int32(file, -1);
+    }
+    if (write_binary_int32(file, (int32_t)strlen(str)) != 0)
+    {
+        return -1;
+    }
+
+    return write_binary_data(file, str, strlen(str));
+}
+
+static int read_binary_data(FILE *file, void *data, size_t length)
+{
+    if (length > 0 && fread(data, 1, length, file) != length)
+    {
+        if (ferror(file))
+        {
+            harp_set_error(HARP_ERROR_FILE_READ, "error reading collocation result file");
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "unexpected end of collocation result file");
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_binary_int32(FILE *file, int32_t *value)
+{
+    unsigned char buffer[4];
+
+    if (read_binary_data(file, buffer, 4) != 0)
+    {
+        return -1;
+    }
+    *value = decode_int32(buffer);
+
+    return 0;
+}
+
+static int read_binary_int64(FILE *file, int64_t *value)
+{
+    unsigned char buffer[8];
+
+    if (read_binary_data(file, buffer, 8) != 0)
+    {
+        return -1;
+    }
+    *value = decode_int64(buffer);
+
+    return 0;
+}
+
+static int read_binary_string(FILE *file, char **new_str)
+{
+    char *str;
+    int32_t length;
+
+    if (read_binary_int32(file, &length) != 0)
+    {
+        return -1;
+    }
+    if (length == -1)
+    {
+        *new_str = NULL;
+        return 0;
+    }
+    if (length < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid string length (%ld) in collocation result file",
+                       (long)length);
+        return -1;
+    }
+
+    str = malloc((size_t)length + 1);
+    if (str == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)length + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    if (read_binary_data(file, str, (size_t)length) != 0)
+    {
+        free(str);
+        return -1;
+    }
+    str[length] = '\0';
+
+    *new_str = str;
+    return 0;
+}
+
+static int read_binary_dataset(FILE *file, harp_dataset *dataset)
+{
+    int64_t num_products;
+    int64_t i;
+
+    if (read_binary_int64(file, &num_products) != 0)
+    {
+        return -1;
+    }
+    if (num_products < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid number of products (%ld) in collocation result file",
+                       (long)num_products);
+        return -1;
+    }
+    for (i = 0; i < num_products; i++)
+    {
+        char *source_product;
+
+        if (read_binary_string(file, &source_product) != 0)
+        {
+            return -1;
+        }
+        if (source_product == NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "missing source product name in collocation result file");
+            return -1;
+        }
+        if (harp_dataset_add_product_unsorted(dataset, source_product, NULL) != 0)
+        {
+            free(source_product);
+            return -1;
+        }
+        if (dataset->num_products != i + 1)
+        {
+            /* the product indices of the pairs would no longer match the position in the dataset */
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "duplicate source product '%s' in collocation result file",
+                           source_product);
+            free(source_product);
+            return -1;
+        }
+        free(source_product);
+    }
+
+    return harp_dataset_sort_products(dataset);
+}
+
+static int read_binary_pairs(FILE *file, harp_collocation_result *collocation_result)
+{
+    int num_differences = collocation_result->num_differences;
+    size_t record_size = 32 + 8 * (size_t)num_differences;
+    unsigned char *buffer = NULL;
+    double *difference = NULL;
+    int64_t num_pairs;
+    long num_allocated;
+    long i;
+
+    if (read_binary_int64(file, &num_pairs) != 0)
+    {
+        return -1;
+    }
+    if (num_pairs < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid number of pairs (%ld) in collocation result file",
+                       (long)num_pairs);
+        return -1;
+    }
+    if (num_pairs == 0)
+    {
+        return 0;
+    }
+
+    /* keep the size of the pair array a multiple of the block size (as expected by harp_collocation_result_add_pair) */
+    num_allocated = (((long)num_pairs - 1) / COLLOCATION_RESULT_BLOCK_SIZE + 1) * COLLOCATION_RESULT_BLOCK_SIZE;
+    collocation_result->pair = malloc(num_allocated * sizeof(harp_collocation_pair *));
+    if (collocation_result->pair == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_allocated * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
+        return -1;
+    }
+    buffer = malloc(BINARY_PAIR_BLOCK_SIZE * record_size);
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       BINARY_PAIR_BLOCK_SIZE * record_size, __FILE__, __LINE__);
+        return -1;
+    }
+    if (num_differences > 0)
+    {
+        difference = malloc(num_differences * sizeof(double));
+        if (difference == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_differences * sizeof(double), __FILE__, __LINE__);
+            free(buffer);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < (long)num_pairs; i += BINARY_PAIR_BLOCK_SIZE)
+    {
+        long num_records = (long)num_pairs - i < BINARY_PAIR_BLOCK_SIZE ? (long)num_pairs - i : BINARY_PAIR_BLOCK_SIZE;
+        long j;
+
+        if (read_binary_data(file, buffer, num_records * record_size) != 0)
+        {
+            free(difference);
+            free(buffer);
+            return -1;
+        }
+        for (j = 0; j < num_records; j++)
+        {
+            const unsigned char *record = &buffer[j * record_size];
+            long product_index_a = (long)decode_int32(&record[8]);
+            long product_index_b = (long)decode_int32(&record[12]);
+            int k;
+
+            if (product_index_a < 0 || product_index_a >= collocation_result->dataset_a->num_products ||
+                product_index_b < 0 || product_index_b >= collocation_result->dataset_b->num_products)
+            {
+                harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid product index for pair %ld in collocation result "
+                               "file", i + j);
+                free(difference);
+                free(buffer);
+                return -1;
+            }
+            for (k = 0; k < num_differences; k++)
+            {
+                difference[k] = decode_double(&record[32 + 8 * k]);
+            }
+            if (collocation_pair_new((long)decode_int64(record), product_index_a, (long)decode_int64(&record[16]),
+                                     product_index_b, (long)decode_int64(&record[24]), num_differences, difference,
+                                     &collocation_result->pair[collocation_result->num_pairs]) != 0)
+            {
+                free(difference);
+                free(buffer);
+                return -1;
+            }
+            collocation_result->num_pairs++;
+        }
+    }
+
+    free(difference);
+    free(buffer);
+
+    return 0;
+}
+
+/* Read the differences and datasets of a binary collocation result file; the magic sequence has already been read */
+static int read_binary_header(FILE *file, harp_collocation_result *collocation_result)
+{
+    int32_t version;
+    int32_t num_differences;
+    int32_t i;
+
+    if (read_binary_int32(file, &version) != 0)
+    {
+        return -1;
+    }
+    if (version != BINARY_FORMAT_VERSION)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "unsupported binary collocation result format version (%ld)",
+                       (long)version);
+        return -1;
+    }
+    if (read_binary_int32(file, &num_differences) != 0)
+    {
+        return -1;
+    }
+    if (num_differences < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid number of differences (%ld) in collocation result file",
+                       (long)num_differences);
+        return -1;
+    }
+    for (i = 0; i < num_differences; i++)
+    {
+        char *variable_name;
+        char *unit;
+
+        if (read_binary_string(file, &variable_name) != 0)
+        {
+            return -1;
+        }
+        if (variable_name == NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "missing difference variable name in collocation result file");
+            return -1;
+        }
+        if (read_binary_string(file, &unit) != 0)
+        {
+            free(variable_name);
+            return -1;
+        }
+        if (harp_collocation_result_add_difference(collocation_result, variable_name, unit) != 0)
+        {
+            free(variable_name);
+            if (unit != NULL)
+            {
+                free(unit);
+            }
+            return -1;
+        }
+        free(variable_name);
+        if (unit != NULL)
+        {
+            free(unit);
+        }
+    }
+
+    if (read_binary_dataset(file, collocation_result->dataset_a) != 0)
+    {
+        return -1;
+    }
+
+    return read_binary_dataset(file, collocation_result->dataset_b);
+}
+
+/* Read a binary collocation result file; the magic sequence has already been read from the file */
+static int read_binary(FILE *file, harp_collocation_result *collocation_result)
+{
+    if (read_binary_header(file, collocation_result) != 0)
+    {
+        return -1;
+    }
+
+    return read_binary_pairs(file, collocation_result);
+}
+
+/* Determine whether the file starts with the magic sequence of the binary collocation result format */
+static int is_binary_file(const char *collocation_result_filename, int *is_binary)
+{
+    char magic[BINARY_MAGIC_LENGTH];
+    FILE *file;
+
+    file = fopen(collocation_result_filename, "rb");
+    if (file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", collocation_result_filename);
+        return -1;
+    }
+    *is_binary = fread(magic, 1, BINARY_MAGIC_LENGTH, file) == BINARY_MAGIC_LENGTH &&
+        memcmp(magic, BINARY_MAGIC, BINARY_MAGIC_LENGTH) == 0;
+    fclose(file);
+
+    return 0;
+}
+
+static int read_binary_file(const char *collocation_result_filename, harp_collocation_result **new_collocation_result)
+{
+    harp_collocation_result *collocation_result = NULL;
+    char magic[BINARY_MAGIC_LENGTH];
+    FILE *file;
+
+    file = fopen(collocation_result_filename, "rb");
+    if (file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", collocation_result_filename);
+        return -1;
+    }
+    if (read_binary_data(file, magic, BINARY_MAGIC_LENGTH) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+    if (harp_collocation_result_new(&collocation_result, 0, NULL, NULL) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+    if (read_binary(file, collocation_result) != 0)
+    {
+        harp_collocation_result_delete(collocation_result);
+        fclose(file);
+        return -1;
+    }
+    if (fclose(file) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "error closing collocation result file");
+        harp_collocation_result_delete(collocation_result);
+        return -1;
+    }
+
+    *new_collocation_result = collocation_result;
+    return 0;
+}
+
+/** \addtogroup harp_collocation
+ * @{
+ */
+
+/** Read collocation result set from a file
+ * The file should follow the HARP format for collocation result files. Both the csv format and the binary format (as
+ * written by harp_collocation_result_write_binary()) are supported; the format is detected automatically.
+ * \param collocation_result_filename Full file path to the collocation result file.
+ * \param new_collocation_result Pointer to the C variable where the new result set will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_collocation_result_read(const char *collocation_result_filename,
+                                             harp_collocation_result **new_collocation_result)
+{
+    harp_collocation_result *collocation_result = NULL;
+    FILE *file;
+    long i;
+    long num_lines;
+    int is_binary;
+
+    if (collocation_result_filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocation_result_filename is NULL");
+        return -1;
+    }
+
+    if (is_binary_file(collocation_result_filename, &is_binary) != 0)
+    {
+        return -1;
+    }
+    if (is_binary)
+    {
+        return read_binary_file(collocation_result_filename, new_collocation_result);
+    }
+
+    /* Open the collocation result file */
+    file = fopen(collocation_result_filename, "r");
+    if (file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", collocation_result_filename);
+        return -1;
+    }
+
+    /* Get number of lines */
+    if (harp_csv_get_num_lines(file, collocation_result_filename, &num_lines) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    /* Start new collocation result */
+    if (harp_collocation_result_new(&collocation_result, 0, NULL, NULL) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    /* Exclude the header line */
+    num_lines--;
+    if (num_lines < 1)
+    {
+        /* No lines to read */
+        fclose(file);
+
+        /* Return an empty collocation result */
+        *new_collocation_result = collocation_result;
+        return 0;
+    }
+
+    /* Initialize the collocation result and update the collocation differences with the information in the header */
+    if (read_header(file, collocation_result) != 0)
+    {
+        harp_collocation_result_delete(collocation_result);
+        fclose(file);
+        return -1;
+    }
+
+    /* Read the matching pairs */
+    for (i = 0; i < num_lines; i++)
+    {
+        if (read_pair(file, collocation_result) != 0)
+        {
+            harp_collocation_result_delete(collocation_result);
+            fclose(file);
+            return -1;
+        }
+    }
+    if (harp_dataset_sort_products(collocation_result->dataset_a) != 0 ||
+        harp_dataset_sort_products(collocation_result->dataset_b) != 0)
+    {
+        harp_collocation_result_delete(collocation_result);
+        fclose(file);
+        return -1;
+    }
+
+    /* Close the collocation result file */
+    if (fclose(file) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "error closing collocation result file");
+        harp_collocation_result_delete(collocation_result);
+        return -1;
+    }
+
+    *new_collocation_result = collocation_result;
+    return 0;
+}
+
+/**
+ * @}
+ */
+
+static void write_header(FILE *file, const harp_collocation_result *collocation_result)
+{
+    int i;
+
+    fprintf(file, "collocation_index,source_product_a,index_a,source_product_b,index_b");
+    for (i = 0; i < collocation_result->num_differences; i++)
+    {
+        fprintf(file, ",%s", collocation_result->difference_variable_name[i]);
+        if (collocation_result->difference_unit[i] != NULL)
+        {
+            fprintf(file, " [%s]", collocation_result->difference_unit[i]);
+        }
+    }
+    fprintf(file, "\n");
+}
+
+static void write_pair(FILE *file, const harp_collocation_result *collocation_result, const harp_collocation_pair *pair)
+{
+    int i;
+
+    assert(pair != NULL);
+
+    /* Write filenames and measurement indices */
+    fprintf(file, "%ld,%s,%ld,%s,%ld", pair->collocation_index,
+            collocation_result->dataset_a->source_product[pair->product_index_a], pair->sample_index_a,
+            collocation_result->dataset_b->source_product[pair->product_index_b], pair->sample_index_b);
+
+    /* Write differences */
+    for (i = 0; i < pair->num_differences; i++)
+    {
+        fprintf(file, ",%.8g", pair->difference[i]);
+    }
+    fprintf(file, "\n");
+}
+
+/* Store a pair as a fixed size record of the binary format */
+static void encode_pair(unsigned char *record, const harp_collocation_pair *pair, int num_differences)
+{
+    int k;
+
+    encode_int64(record, pair->collocation_index);
+    encode_int32(&record[8], (int32_t)pair->product_index_a);
+    encode_int32(&record[12], (int32_t)pair->product_index_b);
+    encode_int64(&record[16], pair->sample_index_a);
+    encode_int64(&record[24], pair->sample_index_b);
+    for (k = 0; k < num_differences; k++)
+    {
+        encode_double(&record[32 + 8 * k], pair->difference[k]);
+    }
+}
+
+/* Write everything that precedes the pair records of a binary collocation result file */
+static int write_binary_header(FILE *file, const harp_collocation_result *collocation_result, long num_pairs)
+{
+    long i;
+
+    if (write_binary_data(file, BINARY_MAGIC, BINARY_MAGIC_LENGTH) != 0)
+    {
+        return -1;
+    }
+    if (write_binary_int32(file, BINARY_FORMAT_VERSION) != 0)
+    {
+        return -1;
+    }
+    if (write_binary_int32(file, collocation_result->num_differences) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < collocation_result->num_differences; i++)
+    {
+        if (write_binary_string(file, collocation_result->difference_variable_name[i]) != 0)
+        {
+            return -1;
+        }
+        if (write_binary_string(file, collocation_result->difference_unit[i]) != 0)
+        {
+            return -1;
+        }
+    }
+    if (write_binary_int64(file, collocation_result->dataset_a->num_products) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < collocation_result->dataset_a->num_products; i++)
+    {
+        if (write_binary_string(file, collocation_result->dataset_a->source_product[i]) != 0)
+        {
+            return -1;
+        }
+    }
+    if (write_binary_int64(file, collocation_result->dataset_b->num_products) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < collocation_result->dataset_b->num_products; i++)
+    {
+        if (write_binary_string(file, collocation_result->dataset_b->source_product[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return write_binary_int64(file, num_pairs);
+}
+
+static int write_binary(FILE *file, const harp_collocation_result *collocation_result)
+{
+    size_t record_size = 32 + 8 * (size_t)collocation_result->num_differences;
+    unsigned char *buffer;
+    long i;
+
+    if (write_binary_header(file, collocation_result, collocation_result->num_pairs) != 0)
+    {
+        return -1;
+    }
+    if (collocation_result->num_pairs == 0)
+    {
+        return 0;
+    }
+
+    buffer = malloc(BINARY_PAIR_BLOCK_SIZE * record_size);
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       BINARY_PAIR_BLOCK_SIZE * record_size, __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < collocation_result->num_pairs; i += BINARY_PAIR_BLOCK_SIZE)
+    {
+        long num_records = collocation_result->num_pairs - i < BINARY_PAIR_BLOCK_SIZE ?
+            collocation_result->num_pairs - i : BINARY_PAIR_BLOCK_SIZE;
+        long j;
+
+        for (j = 0; j < num_records; j++)
+        {
+            encode_pair(&buffer[j * record_size], collocation_result->pair[i + j], collocation_result->num_differences);
+        }
+        if (write_binary_data(file, buffer, num_records * record_size) != 0)
+        {
+            free(buffer);
+            return -1;
+        }
+    }
+    free(buffer);
+
+    return 0;
+}
+
+/* External sort of collocation result files.
+ * The pairs of all input files are read in batches that fit within the memory limit. Each batch is sorted in memory
+ * in one or more slices (which are sorted in parallel) using the same sort keys as the in-memory sort functions. If all
+ * pairs fit in a single batch the sorted slices are kept in memory, otherwise each sorted slice is written as a run to
+ * a temporary file using the pair record layout of the binary format. The sorted runs are then combined using a k-way
+ * merge while the output file is written. Only the differences and source product names are kept in memory for all
+ * pairs. The product indices of the pairs refer to the combined datasets of all inputs. Products are only appended to
+ * these datasets, so the indices in the runs stay valid and the relative order of the products (by name) that is used
+ * for the sorting is the same for all runs.
+ */
+
+/* amount of memory that is used for a batch of pairs if no memory limit is given */
+#define EXTERNAL_SORT_DEFAULT_MEMORY_LIMIT ((int64_t)256 * 1024 * 1024)
+
+/* minimum number of pairs in a batch */
+#define EXTERNAL_SORT_MIN_BATCH_SIZE 4096
+
+/* minimum number of pairs of a batch that is sorted by a separate task */
+#define EXTERNAL_SORT_MIN_PAIRS_PER_TASK 65536
+
+/* minimum number of records that is read at once from a run during the merge */
+#define EXTERNAL_SORT_MIN_RUN_BLOCK_SIZE 64
+
+/* a sorted sequence of pairs that is either kept in memory or stored in a temporary file */
+typedef struct sorted_run_struct
+{
+    FILE *file; /* temporary file with the pair records of the run (NULL if the run is kept in memory) */
+    pair_sort_key *key; /* sorted keys of a run that is kept in memory */
+    long num_pairs;
+    long num_read;      /* number of pairs that have been taken from the run */
+    unsigned char *buffer;      /* block of pair records that was read from the file */
+    long block_size;    /* maximum number of records in buffer */
+    long buffer_offset; /* index in buffer of the next record */
+    long buffer_length; /* number of records in buffer */
+    harp_collocation_pair pair; /* storage for the current pair of a run that is stored in a file */
+    harp_collocation_pair *current;     /* current pair of the run (NULL if all pairs have been merged) */
+    uint64_t current_key[4];    /* sort key of the current pair */
+} sorted_run;
+
+typedef struct external_sort_struct
+{
+    harp_collocation_result *collocation_result;        /* differences and combined datasets (without pairs) */
+    int has_differences;        /* whether the differences have been taken from an input file */
+    harp_collocation_sort_order sort_order;
+    int num_key_fields;
+    int64_t memory_limit;
+    long max_batch_size;        /* maximum number of pairs in a batch */
+    long batch_size;    /* number of pairs in the current batch */
+    long batch_capacity;        /* number of pairs for which the batch arrays have been allocated */
+    harp_collocation_pair *batch_pair;
+    double *batch_difference;
+    int keep_in_memory; /* whether the slices of the current batch are kept in memory instead of written to file */
+    long slice_size;    /* number of pairs per slice of the current batch */
+    long first_slice_run;       /* index of the run of the first slice of the current batch */
+    long *rank_a;
+    long *rank_b;
+    long num_runs;
+    sorted_run *run;
+} external_sort;
+
+/* reader for the pairs of an input file of an external sort */
+typedef struct pair_reader_struct
+{
+    FILE *file;
+    const char *filename;
+    int is_binary;
+    int num_differences;
+    long num_products_a;        /* number of products of dataset A in a binary file */
+    long num_products_b;        /* number of products of dataset B in a binary file */
+    long *product_index_a;      /* index in the combined dataset A for each product of dataset A in a binary file */
+    long *product_index_b;      /* index in the combined dataset B for each product of dataset B in a binary file */
+    long num_pairs;     /* number of pairs in a binary file */
+    long num_read;      /* number of pairs that have been read from a binary file */
+    unsigned char *buffer;      /* block of pair records that was read from a binary file */
+    long buffer_offset;
+    long buffer_length;
+    char line[HARP_CSV_LINE_LENGTH];
+} pair_reader;
+
+static long get_record_size(int num_differences)
+{
+    return 32 + 8 * (long)num_differences;
+}
+
+static void decode_pair(const unsigned char *record, int num_differences, harp_collocation_pair *pair)
+{
+    int k;
+
+    pair->collocation_index = (long)decode_int64(record);
+    pair->product_index_a = (long)decode_int32(&record[8]);
+    pair->product_index_b = (long)decode_int32(&record[12]);
+    pair->sample_index_a = (long)decode_int64(&record[16]);
+    pair->sample_index_b = (long)decode_int64(&record[24]);
+    pair->num_differences = num_differences;
+    for (k = 0; k < num_differences; k++)
+    {
+        pair->difference[k] = decode_double(&record[32 + 8 * k]);
+    }
+}
+
+static int check_compatible_differences(const harp_collocation_result *collocation_result,
+                                        const harp_collocation_result *other_result, const char *filename)
+{
+    int i;
+
+    if (other_result->num_differences != collocation_result->num_differences)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocation result '%s' has %d differences (expected %d)",
+                       filename, other_result->num_differences, collocation_result->num_differences);
+        return -1;
+    }
+    for (i = 0; i < collocation_result->num_differences; i++)
+    {
+        const char *name = collocation_result->difference_variable_name[i];
+        const char *unit = collocation_result->difference_unit[i];
+        const char *other_name = other_result->difference_variable_name[i];
+        const char *other_unit = other_result->difference_unit[i];
+
+        if (strcmp(other_name, name) != 0 || (unit == NULL) != (other_unit == NULL) ||
+            (unit != NULL && strcmp(other_unit, unit) != 0))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "difference '%s [%s]' of collocation result '%s' does not "
+                           "match '%s [%s]'", other_name, other_unit == NULL ? "" : other_unit, filename, name,
+                           unit == NULL ? "" : unit);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* take the differences from the first input file and verify that the differences of all other files are the same */
+static int external_sort_add_differences(external_sort *sort, const harp_collocation_result *header_result,
+                                         const char *filename)
+{
+    int i;
+
+    if (sort->has_differences)
+    {
+        return check_compatible_differences(sort->collocation_result, header_result, filename);
+    }
+    for (i = 0; i < header_result->num_differences; i++)
+    {
+        if (harp_collocation_result_add_difference(sort->collocation_result,
+                                                   header_result->difference_variable_name[i],
+                                                   header_result->difference_unit[i]) != 0)
+        {
+            return -1;
+        }
+    }
+    sort->has_differences = 1;
+
+    return 0;
+}
+
+/* determine for each product of a dataset of an input file its index in the combined dataset */
+static int map_products(harp_dataset *dataset, harp_dataset *combined_dataset, long **new_product_index)
+{
+    long *product_index;
+    long i;
+
+    product_index = malloc((dataset->num_products > 0 ? dataset->num_products : 1) * sizeof(long));
+    if (product_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        if (harp_dataset_add_product_unsorted(combined_dataset, dataset->source_product[i], NULL) != 0 ||
+            harp_dataset_get_index_from_source_product(combined_dataset, dataset->source_product[i],
+                                                       &product_index[i]) != 0)
+        {
+            free(product_index);
+            return -1;
+        }
+    }
+
+    *new_product_index = product_index;
+    return 0;
+}
+
+static void pair_reader_delete(pair_reader *reader)
+{
+    if (reader->file != NULL)
+    {
+        fclose(reader->file);
+    }
+    if (reader->product_index_a != NULL)
+    {
+        free(reader->product_index_a);
+    }
+    if (reader->product_index_b != NULL)
+    {
+        free(reader->product_index_b);
+    }
+    if (reader->buffer != NULL)
+    {
+        free(reader->buffer);
+    }
+    free(reader);
+}
+
+/* read the header of an input file; the differences of the file are added to (or checked against) the sort */
+static int pair_reader_read_header(pair_reader *reader, external_sort *sort)
+{
+    harp_collocation_result *header_result;
+
+    if (harp_collocation_result_new(&header_result, 0, NULL, NULL) != 0)
+    {
+        return -1;
+    }
+    if (reader->is_binary)
+    {
+        char magic[BINARY_MAGIC_LENGTH];
+        int64_t num_pairs;
+
+        if (read_binary_data(reader->file, magic, BINARY_MAGIC_LENGTH) != 0 ||
+            read_binary_header(reader->file, header_result) != 0 || read_binary_int64(reader->file, &num_pairs) != 0)
+        {
+            harp_collocation_result_delete(header_result);
+            return -1;
+        }
+        if (num_pairs < 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid number of pairs (%ld) in collocation result file",
+                           (long)num_pairs);
+            harp_collocation_result_delete(header_result);
+            return -1;
+        }
+        reader->num_pairs = (long)num_pairs;
+        reader->num_products_a = header_result->dataset_a->num_products;
+        reader->num_products_b = header_result->dataset_b->num_products;
+        if (map_products(header_result->dataset_a, sort->collocation_result->dataset_a, &reader->product_index_a)
+            != 0 ||
+            map_products(header_result->dataset_b, sort->collocation_result->dataset_b, &reader->product_index_b)
+            != 0)
+        {
+            harp_collocation_result_delete(header_result);
+            return -1;
+        }
+    }
+    else
+    {
+        int c = fgetc(reader->file);
+
+        if (c == EOF)
+        {
+            /* an empty file has no header and no pairs (as for harp_collocation_result_read()) */
+            harp_collocation_result_delete(header_result);
+            reader->num_differences = -1;
+            return 0;
+        }
+        /* read_header() starts reading from the beginning of the file */
+        if (read_header(reader->file, header_result) != 0)
+        {
+            harp_collocation_result_delete(header_result);
+            return -1;
+        }
+    }
+    if (external_sort_add_differences(sort, header_result, reader->filename) != 0)
+    {
+        harp_collocation_result_delete(header_result);
+        return -1;
+    }
+    reader->num_differences = header_result->num_differences;
+    harp_collocation_result_delete(header_result);
+
+    if (reader->is_binary)
+    {
+        reader->buffer = malloc(BINARY_PAIR_BLOCK_SIZE * get_record_size(reader->num_differences));
+        if (reader->buffer == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           BINARY_PAIR_BLOCK_SIZE * get_record_size(reader->num_differences), __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int pair_reader_new(const char *filename, external_sort *sort, pair_reader **new_reader)
+{
+    pair_reader *reader;
+
+    reader = malloc(sizeof(pair_reader));
+    if (reader == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(pair_reader), __FILE__, __LINE__);
+        return -1;
+    }
+    reader->file = NULL;
+    reader->filename = filename;
+    reader->is_binary = 0;
+    reader->num_differences = 0;
+    reader->num_products_a = 0;
+    reader->num_products_b = 0;
+    reader->product_index_a = NULL;
+    reader->product_index_b = NULL;
+    reader->num_pairs = 0;
+    reader->num_read = 0;
+    reader->buffer = NULL;
+    reader->buffer_offset = 0;
+    reader->buffer_length = 0;
+
+    if (is_binary_file(filename, &reader->is_binary) != 0)
+    {
+        pair_reader_delete(reader);
+        return -1;
+    }
+    reader->file = fopen(filename, reader->is_binary ? "rb" : "r");
+    if (reader->file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", filename);
+        pair_reader_delete(reader);
+        return -1;
+    }
+    if (pair_reader_read_header(reader, sort) != 0)
+    {
+        pair_reader_delete(reader);
+        return -1;
+    }
+
+    *new_reader = reader;
+    return 0;
+}
+
+/* Read the next pair of an input file. The differences are stored in pair->difference, which should have space for
+ * the differences of the sort. The product indices of the pair refer to the combined datasets of the sort.
+ * Returns 1 if a pair was read, 0 if there are no more pairs in the file, and -1 on error.
+ */
+static int pair_reader_next(pair_reader *reader, external_sort *sort, harp_collocation_pair *pair)
+{
+    char *source_product_a;
+    char *source_product_b;
+
+    if (reader->is_binary)
+    {
+        long record_size = get_record_size(reader->num_differences);
+
+        if (reader->num_read == reader->num_pairs)
+        {
+            return 0;
+        }
+        if (reader->buffer_offset == reader->buffer_length)
+        {
+            reader->buffer_length = reader->num_pairs - reader->num_read;
+            if (reader->buffer_length > BINARY_PAIR_BLOCK_SIZE)
+            {
+                reader->buffer_length = BINARY_PAIR_BLOCK_SIZE;
+            }
+            if (read_binary_data(reader->file, reader->buffer, reader->buffer_length * record_size) != 0)
+            {
+                return -1;
+            }
+            reader->buffer_offset = 0;
+        }
+        decode_pair(&reader->buffer[reader->buffer_offset * record_size], reader->num_differences, pair);
+        if (pair->product_index_a < 0 || pair->product_index_a >= reader->num_products_a ||
+            pair->product_index_b < 0 || pair->product_index_b >= reader->num_products_b)
+        {
+            harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid product index for pair %ld in collocation result "
+                           "file '%s'", reader->num_read, reader->filename);
+            return -1;
+        }
+        pair->product_index_a = reader->product_index_a[pair->product_index_a];
+        pair->product_index_b = reader->product_index_b[pair->product_index_b];
+        reader->buffer_offset++;
+        reader->num_read++;
+
+        return 1;
+    }
+
+    if (reader->num_differences < 0)
+    {
+        /* empty file */
+        return 0;
+    }
+    do
+    {
+        if (fgets(reader->line, HARP_CSV_LINE_LENGTH, reader->file) == NULL)
+        {
+            if (ferror(reader->file))
+            {
+                harp_set_error(HARP_ERROR_FILE_READ, "error reading collocation result file '%s'", reader->filename);
+                return -1;
+            }
+            return 0;
+        }
+        harp_csv_rtrim(reader->line);
+    }
+    while (reader->line[0] == '\0');
+
+    if (parse_pair(reader->line, reader->num_differences, &pair->collocation_index, &source_product_a,
+                   &pair->sample_index_a, &source_product_b, &pair->sample_index_b, pair->difference) != 0)
+    {
+        return -1;
+    }
+    pair->num_differences = reader->num_differences;
+    if (harp_dataset_add_product_unsorted(sort->collocation_result->dataset_a, source_product_a, NULL) != 0 ||
+        harp_dataset_get_index_from_source_product(sort->collocation_result->dataset_a, source_product_a,
+                                                   &pair->product_index_a) != 0)
+    {
+        return -1;
+    }
+    if (harp_dataset_add_product_unsorted(sort->collocation_result->dataset_b, source_product_b, NULL) != 0 ||
+        harp_dataset_get_index_from_source_product(sort->collocation_result->dataset_b, source_product_b,
+                                                   &pair->product_index_b) != 0)
+    {
+        return -1;
+    }
+
+    return 1;
+}
+
+static void sorted_run_done(sorted_run *run)
+{
+    if (run->file != NULL)
+    {
+        /* this also removes the temporary file */
+        fclose(run->file);
+    }
+    if (run->key != NULL)
+    {
+        free(run->key);
+    }
+    if (run->buffer != NULL)
+    {
+        free(run->buffer);
+    }
+    if (run->pair.difference != NULL)
+    {
+        free(run->pair.difference);
+    }
+}
+
+static int write_run(FILE *file, const pair_sort_key *key, long num_pairs, int num_differences)
+{
+    long record_size = get_record_size(num_differences);
+    unsigned char *buffer;
+    long i;
+
+    buffer = malloc(BINARY_PAIR_BLOCK_SIZE * record_size);
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       BINARY_PAIR_BLOCK_SIZE * record_size, __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_pairs; i += BINARY_PAIR_BLOCK_SIZE)
+    {
+        long num_records = num_pairs - i < BINARY_PAIR_BLOCK_SIZE ? num_pairs - i : BINARY_PAIR_BLOCK_SIZE;
+        long j;
+
+        for (j = 0; j < num_records; j++)
+        {
+            encode_pair(&buffer[j * record_size], key[i + j].pair, num_differences);
+        }
+        if (fwrite(buffer, record_size, num_records, file) != (size_t)num_records)
+        {
+            harp_set_error(HARP_ERROR_FILE_WRITE, "error writing temporary file for sorting collocation result");
+            free(buffer);
+            return -1;
+        }
+    }
+    free(buffer);
+
+    return 0;
+}
+
+/* sort one slice of the current batch and store it as a run (this is called for each slice in parallel) */
+static int sort_batch_slice(void *arg, long index)
+{
+    external_sort *sort = (external_sort *)arg;
+    sorted_run *run = &sort->run[sort->first_slice_run + index];
+    long offset = index * sort->slice_size;
+    long num_pairs = sort->batch_size - offset < sort->slice_size ? sort->batch_size - offset : sort->slice_size;
+    pair_sort_key *key;
+    long i;
+
+    if (num_pairs <= 0)
+    {
+        return 0;
+    }
+    key = malloc(num_pairs * sizeof(pair_sort_key));
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_pairs * sizeof(pair_sort_key), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_pairs; i++)
+    {
+        set_pair_sort_key(key[i].key, &sort->batch_pair[offset + i], sort->sort_order, sort->rank_a, sort->rank_b);
+        key[i].pair = &sort->batch_pair[offset + i];
+    }
+    if (radix_sort_pair_keys(num_pairs, sort->num_key_fields, &key) != 0)
+    {
+        free(key);
+        return -1;
+    }
+    run->num_pairs = num_pairs;
+    if (sort->keep_in_memory)
+    {
+        run->key = key;
+        return 0;
+    }
+
+    run->file = tmpfile();
+    if (run->file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create temporary file for sorting collocation result");
+        free(key);
+        return -1;
+    }
+    if (write_run(run->file, key, num_pairs, sort->collocation_result->num_differences) != 0)
+    {
+        free(key);
+        return -1;
+    }
+    free(key);
+
+    return 0;
+}
+
+/* determine the rank of each product of the combined datasets in the sorted product lists */
+static int external_sort_update_ranks(external_sort *sort)
+{
+    if (sort->rank_a != NULL)
+    {
+        free(sort->rank_a);
+        sort->rank_a = NULL;
+    }
+    if (sort->rank_b != NULL)
+    {
+        free(sort->rank_b);
+        sort->rank_b = NULL;
+    }
+    if (harp_dataset_sort_products(sort->collocation_result->dataset_a) != 0 ||
+        harp_dataset_sort_products(sort->collocation_result->dataset_b) != 0)
+    {
+        return -1;
+    }
+    if (get_product_rank(sort->collocation_result->dataset_a, &sort->rank_a) != 0)
+    {
+        return -1;
+    }
+
+    return get_product_rank(sort->collocation_result->dataset_b, &sort->rank_b);
+}
+
+/* sort the pairs of the current batch into one run per slice */
+static int external_sort_flush_batch(external_sort *sort, int keep_in_memory)
+{
+    int num_differences = sort->collocation_result->num_differences;
+    sorted_run *new_run;
+    long num_slices;
+    long i;
+
+    if (sort->batch_size == 0)
+    {
+        return 0;
+    }
+    if (external_sort_update_ranks(sort) != 0)
+    {
+        return -1;
+    }
+
+    num_slices = harp_get_num_tasks(sort->batch_size, EXTERNAL_SORT_MIN_PAIRS_PER_TASK);
+    new_run = realloc(sort->run, (sort->num_runs + num_slices) * sizeof(sorted_run));
+    if (new_run == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (sort->num_runs + num_slices) * sizeof(sorted_run), __FILE__, __LINE__);
+        return -1;
+    }
+    sort->run = new_run;
+    for (i = sort->num_runs; i < sort->num_runs + num_slices; i++)
+    {
+        sorted_run *run = &sort->run[i];
+
+        run->file = NULL;
+        run->key = NULL;
+        run->num_pairs = 0;
+        run->num_read = 0;
+        run->buffer = NULL;
+        run->block_size = 0;
+        run->buffer_offset = 0;
+        run->buffer_length = 0;
+        run->pair.difference = NULL;
+        run->current = NULL;
+    }
+    sort->first_slice_run = sort->num_runs;
+    sort->num_runs += num_slices;
+
+    /* the differences are stored separately, since the pair array may have been moved while the batch was read */
+    for (i = 0; i < sort->batch_size; i++)
+    {
+        sort->batch_pair[i].difference = num_differences > 0 ? &sort->batch_difference[i * num_differences] : NULL;
+    }
+    sort->keep_in_memory = keep_in_memory;
+    sort->slice_size = (sort->batch_size + num_slices - 1) / num_slices;
+    if (harp_run_for_each(num_slices, sort->batch_size, EXTERNAL_SORT_MIN_PAIRS_PER_TASK, sort_batch_slice, sort)
+        != 0)
+    {
+        return -1;
+    }
+    if (!keep_in_memory)
+    {
+        sort->batch_size = 0;
+    }
+
+    return 0;
+}
+
+/* make room for one more pair in the current batch */
+static int external_sort_grow_batch(external_sort *sort)
+{
+    int num_differences = sort->collocation_result->num_differences;
+    harp_collocation_pair *new_pair;
+    long new_capacity;
+
+    if (sort->batch_size < sort->batch_capacity)
+    {
+        return 0;
+    }
+    new_capacity = sort->batch_capacity == 0 ? EXTERNAL_SORT_MIN_BATCH_SIZE : 2 * sort->batch_capacity;
+    if (new_capacity > sort->max_batch_size)
+    {
+        new_capacity = sort->max_batch_size;
+    }
+    new_pair = realloc(sort->batch_pair, new_capacity * sizeof(harp_collocation_pair));
+    if (new_pair == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       new_capacity * sizeof(harp_collocation_pair), __FILE__, __LINE__);
+        return -1;
+    }
+    sort->batch_pair = new_pair;
+    if (num_differences > 0)
+    {
+        double *new_difference;
+
+        new_difference = realloc(sort->batch_difference, new_capacity * num_differences * sizeof(double));
+        if (new_difference == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           new_capacity * num_differences * sizeof(double), __FILE__, __LINE__);
+            return -1;
+        }
+        sort->batch_difference = new_difference;
+    }
+    sort->batch_capacity = new_capacity;
+
+    return 0;
+}
+
+/* read all pairs of an input file into sorted runs */
+static int external_sort_add_file(external_sort *sort, const char *filename)
+{
+    pair_reader *reader;
+
+    if (pair_reader_new(filename, sort, &reader) != 0)
+    {
+        return -1;
+    }
+    if (!sort->has_differences)
+    {
+        /* an empty csv file (without header) has no pairs */
+        pair_reader_delete(reader);
+        return 0;
+    }
+    if (sort->max_batch_size == 0)
+    {
+        int64_t pair_size = sizeof(harp_collocation_pair) + sort->collocation_result->num_differences * sizeof(double)
+            + 2 * sizeof(pair_sort_key);
+
+        /* the key arrays (and the buffer of the radix sort) are only allocated while a batch is being sorted */
+        sort->max_batch_size = (long)(sort->memory_limit / pair_size);
+        if (sort->max_batch_size < EXTERNAL_SORT_MIN_BATCH_SIZE)
+        {
+            sort->max_batch_size = EXTERNAL_SORT_MIN_BATCH_SIZE;
+        }
+    }
+    for (;;)
+    {
+        harp_collocation_pair *pair;
+        int result;
+
+        if (sort->batch_size == sort->max_batch_size)
+        {
+            if (external_sort_flush_batch(sort, 0) != 0)
+            {
+                pair_reader_delete(reader);
+                return -1;
+            }
+        }
+        if (external_sort_grow_batch(sort) != 0)
+        {
+            pair_reader_delete(reader);
+            return -1;
+        }
+        pair = &sort->batch_pair[sort->batch_size];
+        pair->difference = sort->collocation_result->num_differences > 0 ?
+            &sort->batch_difference[sort->batch_size * sort->collocation_result->num_differences] : NULL;
+        result = pair_reader_next(reader, sort, pair);
+        if (result < 0)
+        {
+            pair_reader_delete(reader);
+            return -1;
+        }
+        if (result == 0)
+        {
+            break;
+        }
+        sort->batch_size++;
+    }
+    pair_reader_delete(reader);
+
+    return 0;
+}
+
+/* take the next pair of a run (and determine its sort key) */
+static int sorted_run_next(sorted_run *run, const external_sort *sort)
+{
+    if (run->num_read == run->num_pairs)
+    {
+        run->current = NULL;
+        return 0;
+    }
+    if (run->file == NULL)
+    {
+        run->current = run->key[run->num_read].pair;
+    }
+    else
+    {
+        long record_size = get_record_size(sort->collocation_result->num_differences);
+
+        if (run->buffer_offset == run->buffer_length)
+        {
+            run->buffer_length = run->num_pairs - run->num_read < run->block_size ?
+                run->num_pairs - run->num_read : run->block_size;
+            if (fread(run->buffer, record_size, run->buffer_length, run->file) != (size_t)run->buffer_length)
+            {
+                harp_set_error(HARP_ERROR_FILE_READ, "error reading temporary file for sorting collocation result");
+                return -1;
+            }
+            run->buffer_offset = 0;
+        }
+        decode_pair(&run->buffer[run->buffer_offset * record_size], sort->collocation_result->num_differences,
+                    &run->pair);
+        run->buffer_offset++;
+        run->current = &run->pair;
+    }
+    run->num_read++;
+    set_pair_sort_key(run->current_key, run->current, sort->sort_order, sort->rank_a, sort->rank_b);
+
+    return 0;
+}
+
+/* whether the current pair of run a should be merged before the current pair of run b; pairs with equal keys are
+ * merged in run order, which keeps the order of the input files (i.e. the sort is stable)
+ */
+static int sorted_run_precedes(const external_sort *sort, long a, long b)
+{
+    const uint64_t *key_a = sort->run[a].current_key;
+    const uint64_t *key_b = sort->run[b].current_key;
+    int f;
+
+    for (f = 0; f < sort->num_key_fields; f++)
+    {
+        if (key_a[f] != key_b[f])
+        {
+            return key_a[f] < key_b[f];
+        }
+    }
+
+    return a < b;
+}
+
+/* restore the heap property for the element at the given position in the heap of run indices */
+static void run_heap_sift_down(const external_sort *sort, long *heap, long heap_size, long position)
+{
+    for (;;)
+    {
+        long first = position;
+        long child = 2 * position + 1;
+
+        if (child < heap_size && sorted_run_precedes(sort, heap[child], heap[first]))
+        {
+            first = child;
+        }
+        if (child + 1 < heap_size && sorted_run_precedes(sort, heap[child + 1], heap[first]))
+        {
+            first = child + 1;
+        }
+        if (first == position)
+        {
+            return;
+        }
+        {
+            long swap = heap[position];
+
+            heap[position] = heap[first];
+            heap[first] = swap;
+        }
+        position = first;
+    }
+}
+
+/* prepare all runs for the merge and put the runs that have pairs in a heap */
+static int external_sort_start_merge(external_sort *sort, long *heap, long *heap_size)
+{
+    int num_differences = sort->collocation_result->num_differences;
+    long record_size = get_record_size(num_differences);
+    long num_file_runs = 0;
+    long block_size = BINARY_PAIR_BLOCK_SIZE;
+    long i;
+
+    /* divide the memory limit over the read buffers of the runs that are stored in a file */
+    for (i = 0; i < sort->num_runs; i++)
+    {
+        if (sort->run[i].file != NULL)
+        {
+            num_file_runs++;
+        }
+    }
+    if (num_file_runs > 0 && sort->memory_limit / (num_file_runs * record_size) < block_size)
+    {
+        block_size = (long)(sort->memory_limit / (num_file_runs * record_size));
+        if (block_size < EXTERNAL_SORT_MIN_RUN_BLOCK_SIZE)
+        {
+            block_size = EXTERNAL_SORT_MIN_RUN_BLOCK_SIZE;
+        }
+    }
+
+    *heap_size = 0;
+    for (i = 0; i < sort->num_runs; i++)
+    {
+        sorted_run *run = &sort->run[i];
+
+        if (run->file != NULL)
+        {
+            if (fseek(run->file, 0, SEEK_SET) != 0)
+            {
+                harp_set_error(HARP_ERROR_FILE_READ, "error reading temporary file for sorting collocation result");
+                return -1;
+            }
+            run->block_size = block_size;
+            run->buffer = malloc(block_size * record_size);
+            if (run->buffer == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               block_size * record_size, __FILE__, __LINE__);
                 return -1;
             }
+            if (num_differences > 0)
+            {
+                run->pair.difference = malloc(num_differences * sizeof(double));
+                if (run->pair.difference == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   num_differences * sizeof(double), __FILE__, __LINE__);
+                    return -1;
+                }
+            }
+        }
+        if (sorted_run_next(run, sort) != 0)
+        {
+            return -1;
+        }
+        if (run->current != NULL)
+        {
+            heap[(*heap_size)++] = i;
+        }
+    }
+    for (i = *heap_size / 2 - 1; i >= 0; i--)
+    {
+        run_heap_sift_down(sort, heap, *heap_size, i);
+    }
+
+    return 0;
+}
+
+/* merge the sorted runs into the output file */
+static int external_sort_write(external_sort *sort, int remove_duplicates, const char *output_filename,
+                               int binary_output)
+{
+    const harp_collocation_result *collocation_result = sort->collocation_result;
+    int num_differences = collocation_result->num_differences;
+    long record_size = get_record_size(num_differences);
+    unsigned char *buffer = NULL;
+    long num_buffered = 0;
+    long num_pairs = 0;
+    long num_written = 0;
+    long previous[4] = { 0, 0, 0, 0 };
+    long count_offset = 0;
+    long heap_size;
+    long *heap;
+    FILE *file;
+    long i;
+
+    if (external_sort_update_ranks(sort) != 0)
+    {
+        return -1;
+    }
+    heap = malloc((sort->num_runs > 0 ? sort->num_runs : 1) * sizeof(long));
+    if (heap == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sort->num_runs * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    if (external_sort_start_merge(sort, heap, &heap_size) != 0)
+    {
+        free(heap);
+        return -1;
+    }
+    for (i = 0; i < sort->num_runs; i++)
+    {
+        num_pairs += sort->run[i].num_pairs;
+    }
+
+    /* all input files have been read completely at this point, so the output file can be one of the input files */
+    file = fopen(output_filename, binary_output ? "wb" : "w");
+    if (file == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", output_filename);
+        free(heap);
+        return -1;
+    }
+    if (binary_output)
+    {
+        /* the number of pairs is updated at the end if duplicate pairs were removed */
+        if (write_binary_header(file, collocation_result, num_pairs) != 0)
+        {
+            goto error;
+        }
+        count_offset = ftell(file) - 8;
+        buffer = malloc(BINARY_PAIR_BLOCK_SIZE * record_size);
+        if (buffer == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           BINARY_PAIR_BLOCK_SIZE * record_size, __FILE__, __LINE__);
+            goto error;
+        }
+    }
+    else
+    {
+        write_header(file, collocation_result);
+    }
+
+    while (heap_size > 0)
+    {
+        sorted_run *run = &sort->run[heap[0]];
+        harp_collocation_pair *pair = run->current;
+        int skip = 0;
+
+        if (remove_duplicates)
+        {
+            /* keep the first occurrence of a pair and number the remaining pairs in order */
+            skip = num_written > 0 && pair->product_index_a == previous[0] && pair->sample_index_a == previous[1] &&
+                pair->product_index_b == previous[2] && pair->sample_index_b == previous[3];
+            previous[0] = pair->product_index_a;
+            previous[1] = pair->sample_index_a;
+            previous[2] = pair->product_index_b;
+            previous[3] = pair->sample_index_b;
+            pair->collocation_index = num_written;
+        }
+        if (!skip)
+        {
+            if (binary_output)
+            {
+                encode_pair(&buffer[num_buffered * record_size], pair, num_differences);
+                num_buffered++;
+                if (num_buffered == BINARY_PAIR_BLOCK_SIZE)
+                {
+                    if (write_binary_data(file, buffer, num_buffered * record_size) != 0)
+                    {
+                        goto error;
+                    }
+                    num_buffered = 0;
+                }
+            }
+            else
+            {
+                write_pair(file, collocation_result, pair);
+            }
+            num_written++;
+        }
+        if (sorted_run_next(run, sort) != 0)
+        {
+            goto error;
+        }
+        if (run->current == NULL)
+        {
+            heap_size--;
+            heap[0] = heap[heap_size];
+        }
+        run_heap_sift_down(sort, heap, heap_size, 0);
+    }
+
+    if (binary_output)
+    {
+        if (write_binary_data(file, buffer, num_buffered * record_size) != 0)
+        {
+            goto error;
+        }
+        if (num_written != num_pairs)
+        {
+            if (fseek(file, count_offset, SEEK_SET) != 0)
+            {
+                harp_set_error(HARP_ERROR_FILE_WRITE, "error positioning in collocation result file '%s'",
+                               output_filename);
+                goto error;
+            }
+            if (write_binary_int64(file, num_written) != 0)
+            {
+                goto error;
+            }
+        }
+        free(buffer);
+    }
+    free(heap);
+    if (fclose(file) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "error closing collocation result file");
+        return -1;
+    }
+
+    return 0;
+
+  error:
+    if (buffer != NULL)
+    {
+        free(buffer);
+    }
+    free(heap);
+    fclose(file);
+
+    return -1;
+}
+
+static void external_sort_done(external_sort *sort)
+{
+    long i;
+
+    for (i = 0; i < sort->num_runs; i++)
+    {
+        sorted_run_done(&sort->run[i]);
+    }
+    if (sort->run != NULL)
+    {
+        free(sort->run);
+    }
+    if (sort->rank_a != NULL)
+    {
+        free(sort->rank_a);
+    }
+    if (sort->rank_b != NULL)
+    {
+        free(sort->rank_b);
+    }
+    if (sort->batch_pair != NULL)
+    {
+        free(sort->batch_pair);
+    }
+    if (sort->batch_difference != NULL)
+    {
+        free(sort->batch_difference);
+    }
+    harp_collocation_result_delete(sort->collocation_result);
+}
+
+static int sort_files(int num_input_files, const char **input_filename, harp_collocation_sort_order sort_order,
+                      int remove_duplicates, int64_t memory_limit, const char *output_filename, int binary_output)
+{
+    external_sort sort;
+    int i;
+
+    if (num_input_files < 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_input_files argument should be at least 1 (%s:%u)",
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    if (input_filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "input_filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_input_files; i++)
+    {
+        if (input_filename[i] == NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "input_filename[%d] is NULL (%s:%u)", i, __FILE__, __LINE__);
+            return -1;
+        }
+    }
+    if (output_filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "output_filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (memory_limit < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "memory_limit argument is negative (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (harp_collocation_result_new(&sort.collocation_result, 0, NULL, NULL) != 0)
+    {
+        return -1;
+    }
+    sort.has_differences = 0;
+    sort.sort_order = sort_order;
+    sort.num_key_fields = sort_order == harp_collocation_sort_by_collocation_index ? 1 : 4;
+    sort.memory_limit = memory_limit > 0 ? memory_limit : EXTERNAL_SORT_DEFAULT_MEMORY_LIMIT;
+    sort.max_batch_size = 0;
+    sort.batch_size = 0;
+    sort.batch_capacity = 0;
+    sort.batch_pair = NULL;
+    sort.batch_difference = NULL;
+    sort.keep_in_memory = 0;
+    sort.slice_size = 0;
+    sort.first_slice_run = 0;
+    sort.rank_a = NULL;
+    sort.rank_b = NULL;
+    sort.num_runs = 0;
+    sort.run = NULL;
+
+    for (i = 0; i < num_input_files; i++)
+    {
+        if (external_sort_add_file(&sort, input_filename[i]) != 0)
+        {
+            external_sort_done(&sort);
+            return -1;
         }
     }
+    /* if all pairs fit in a single batch then the sorted slices do not need to be written to file */
+    if (external_sort_flush_batch(&sort, sort.num_runs == 0) != 0)
+    {
+        external_sort_done(&sort);
+        return -1;
+    }
+    if (external_sort_write(&sort, remove_duplicates, output_filename, binary_output) != 0)
+    {
+        external_sort_done(&sort);
+        return -1;
+    }
+    external_sort_done(&sort);
+
+    return 0;
+}
+
+/** \addtogroup harp_collocation
+ * @{
+ */
+
+/** Read collocation result set to a csv file
+ * The csv file will follow the HARP format for collocation result files.
+ * \param collocation_result_filename Full file path to the csv file.
+ * \param collocation_result Collocation result set that will be written to file.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_collocation_result_write(const char *collocation_result_filename,
+                                              harp_collocation_result *collocation_result)
+{
+    FILE *file;
+    long i;
+
+    if (collocation_result_filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocation_result_filename is NULL");
+        return -1;
+    }
+    if (collocation_result == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocation_result is NULL");
+        return -1;
+    }
 
-    if (harp_collocation_result_add_pair(collocation_result, collocation_index, source_product_a, index_a,
-                                         source_product_b, index_b, collocation_result->num_differences, difference)
-        != 0)
+    /* Open the collocation result file */
+    file = fopen(collocation_result_filename, "w");
+    if (file == NULL)
     {
-        if (difference != NULL)
-        {
-            free(difference);
-        }
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", collocation_result_filename);
         return -1;
     }
 
-    if (difference != NULL)
+    /* Write the header */
+    write_header(file, collocation_result);
+
+    /* Write the matching pairs */
+    for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        free(difference);
+        write_pair(file, collocation_result, collocation_result->pair[i]);
+    }
+
+    /* Close the collocation result file */
+    if (fclose(file) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_READ, "error closing collocation result file");
+        return -1;
     }
 
     return 0;
 }
 
-/** \addtogroup harp_collocation
- * @{
- */
-
-/** Read collocation result set from a csv file
- * The csv file should follow the HARP format for collocation result files.
+/** Append the pairs of a collocation result set to a csv file
+ * This can be used to write a large collocation result in parts (e.g. while it is being computed), such that not all
+ * pairs need to be kept in memory. If the file does not exist yet or is empty, the header is written first. Otherwise
+ * the pairs are appended to the existing file, which should have been written using the same differences (this is not
+ * verified).
  * \param collocation_result_filename Full file path to the csv file.
- * \param new_collocation_result Pointer to the C variable where the new result set will be stored.
+ * \param collocation_result Collocation result set with the pairs that will be appended to the file.
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_collocation_result_read(const char *collocation_result_filename,
-                                             harp_collocation_result **new_collocation_result)
+LIBHARP_API int harp_collocation_result_append(const char *collocation_result_filename,
+                                               harp_collocation_result *collocation_result)
 {
-    harp_collocation_result *collocation_result = NULL;
     FILE *file;
     long i;
-    long num_lines;
 
     if (collocation_result_filename == NULL)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocation_result_filename is NULL");
         return -1;
     }
-
-    /* Open the collocation result file */
-    file = fopen(collocation_result_filename, "r");
-    if (file == NULL)
+    if (collocation_result == NULL)
     {
-        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", collocation_result_filename);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocation_result is NULL");
         return -1;
     }
 
-    /* Get number of lines */
-    if (harp_csv_get_num_lines(file, collocation_result_filename, &num_lines) != 0)
+    file = fopen(collocation_result_filename, "a");
+    if (file == NULL)
     {
-        fclose(file);
+        harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", collocation_result_filename);
         return -1;
     }
 
-    /* Start new collocation result */
-    if (harp_collocation_result_new(&collocation_result, 0, NULL, NULL) != 0)
+    /* only a new file gets a header */
+    if (fseek(file, 0, SEEK_END) != 0)
     {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "error positioning in collocation result file '%s'",
+                       collocation_result_filename);
         fclose(file);
         return -1;
     }
-
-    /* Exclude the header line */
-    num_lines--;
-    if (num_lines < 1)
-    {
-        /* No lines to read */
-        fclose(file);
-
-        /* Return an empty collocation result */
-        *new_collocation_result = collocation_result;
-        return 0;
-    }
-
-    /* Initialize the collocation result and update the collocation differences with the information in the header */
-    if (read_header(file, collocation_result) != 0)
+    if (ftell(file) == 0)
     {
-        harp_collocation_result_delete(collocation_result);
-        fclose(file);
-        return -1;
+        write_header(file, collocation_result);
     }
 
-    /* Read the matching pairs */
-    for (i = 0; i < num_lines; i++)
+    for (i = 0; i < collocation_result->num_pairs; i++)
     {
-        if (read_pair(file, collocation_result) != 0)
-        {
-            harp_collocation_result_delete(collocation_result);
-            fclose(file);
-            return -1;
-        }
+        write_pair(file, collocation_result, collocation_result->pair[i]);
     }
 
-    /* Close the collocation result file */
     if (fclose(file) != 0)
     {
-        harp_set_error(HARP_ERROR_FILE_CLOSE, "error closing collocation result file");
-        harp_collocation_result_delete(collocation_result);
+        harp_set_error(HARP_ERROR_FILE_WRITE, "error closing collocation result file");
         return -1;
     }
 
-    *new_collocation_result = collocation_result;
     return 0;
 }
 
-/**
- * @}
- */
-
-static void write_header(FILE *file, const harp_collocation_result *collocation_result)
-{
-    int i;
-
-    fprintf(file, "collocation_index,source_product_a,index_a,source_product_b,index_b");
-    for (i = 0; i < collocation_result->num_differences; i++)
-    {
-        fprintf(file, ",%s", collocation_result->difference_variable_name[i]);
-        if (collocation_result->difference_unit[i] != NULL)
-        {
-            fprintf(file, " [%s]", collocation_result->difference_unit[i]);
-        }
-    }
-    fprintf(file, "\n");
-}
-
-static void write_pair(FILE *file, const harp_collocation_result *collocation_result, long index)
-{
-    harp_collocation_pair *pair;
-    int i;
-
-    assert(collocation_result->pair != NULL);
-    assert(index >= 0 && index < collocation_result->num_pairs);
-    assert(collocation_result->pair[index] != NULL);
-
-    pair = collocation_result->pair[index];
-
-    /* Write filenames and measurement indices */
-    fprintf(file, "%ld,%s,%ld,%s,%ld", pair->collocation_index,
-            collocation_result->dataset_a->source_product[pair->product_index_a], pair->sample_index_a,
-            collocation_result->dataset_b->source_product[pair->product_index_b], pair->sample_index_b);
-
-    /* Write differences */
-    for (i = 0; i < pair->num_differences; i++)
-    {
-        fprintf(file, ",%.8g", pair->difference[i]);
-    }
-    fprintf(file, "\n");
-}
-
-/** \addtogroup harp_collocation
- * @{
- */
-
-/** Read collocation result set to a csv file
- * The csv file will follow the HARP format for collocation result files.
- * \param collocation_result_filename Full file path to the csv file.
+/** Write collocation result set to a binary file
+ * The binary format is a compact alternative to the csv format for large collocation results. It stores each source
+ * product name only once and contains a fixed size record per pair (with the differences at full double precision).
+ * Binary collocation result files can be read using harp_collocation_result_read().
+ * \param collocation_result_filename Full file path to the binary file.
  * \param collocation_result Collocation result set that will be written to file.
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_collocation_result_write(const char *collocation_result_filename,
-                                              harp_collocation_result *collocation_result)
+LIBHARP_API int harp_collocation_result_write_binary(const char *collocation_result_filename,
+                                                     harp_collocation_result *collocation_result)
 {
     FILE *file;
-    long i;
 
     if (collocation_result_filename == NULL)
     {
@@ -1069,33 +3326,73 @@ LIBHARP_API int harp_collocation_result_write(const char *collocation_result_fil
         return -1;
     }
 
-    /* Open the collocation result file */
-    file = fopen(collocation_result_filename, "w");
+    file = fopen(collocation_result_filename, "wb");
     if (file == NULL)
     {
         harp_set_error(HARP_ERROR_FILE_OPEN, "error opening collocation result file '%s'", collocation_result_filename);
         return -1;
     }
-
-    /* Write the header */
-    write_header(file, collocation_result);
-
-    /* Write the matching pairs */
-    for (i = 0; i < collocation_result->num_pairs; i++)
+    if (write_binary(file, collocation_result) != 0)
     {
-        write_pair(file, collocation_result, i);
+        fclose(file);
+        return -1;
     }
-
-    /* Close the collocation result file */
     if (fclose(file) != 0)
     {
-        harp_set_error(HARP_ERROR_FILE_READ, "error closing collocation result file");
+        harp_set_error(HARP_ERROR_FILE_WRITE, "error closing collocation result file");
         return -1;
     }
 
     return 0;
 }
 
+/** Sort the pairs of one or more collocation result files into a new collocation result file
+ * The pairs of all input files are combined (in the order of the files) and sorted in the same way as
+ * harp_collocation_result_sort_by_a(), harp_collocation_result_sort_by_b(), or
+ * harp_collocation_result_sort_by_collocation_index() would do. Pairs with equal sort keys keep their relative order.
+ * The sort does not require all pairs to fit in memory: the pairs are read in batches of at most \a memory_limit bytes,
+ * each batch is sorted (using multiple threads if set by harp_set_option_num_threads()) and stored in temporary files,
+ * and the sorted parts are merged into the output file. Only the source product names of all pairs are kept in memory.
+ * All input files need to have the same differences. The input files can be in csv or binary format and the output
+ * file can be one of the input files.
+ * \param num_input_files Number of collocation result files to sort.
+ * \param input_filename Full file paths of the collocation result files.
+ * \param sort_order Order of the pairs in the output file.
+ * \param memory_limit Maximum number of bytes that is used for a batch of pairs (0 = 256 MB).
+ * \param output_filename Full file path of the sorted collocation result file.
+ * \param binary_output Write the output file in the binary format instead of csv if set.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_collocation_result_sort_files(int num_input_files, const char **input_filename,
+                                                   harp_collocation_sort_order sort_order, int64_t memory_limit,
+                                                   const char *output_filename, int binary_output)
+{
+    return sort_files(num_input_files, input_filename, sort_order, 0, memory_limit, output_filename, binary_output);
+}
+
+/** Merge collocation result files (e.g. the results of separate shards of a collocation) into a single file
+ * This sorts the pairs of all input files by dataset A (see harp_collocation_result_sort_files()), only keeps the first
+ * occurrence of pairs that have the same samples of A and B, and renumbers the collocation_index values from 0 in the
+ * sorted order. The result is independent of how the pairs were distributed over the input files.
+ * \param num_input_files Number of collocation result files to merge.
+ * \param input_filename Full file paths of the collocation result files.
+ * \param memory_limit Maximum number of bytes that is used for a batch of pairs (0 = 256 MB).
+ * \param output_filename Full file path of the merged collocation result file.
+ * \param binary_output Write the output file in the binary format instead of csv if set.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_collocation_result_merge_files(int num_input_files, const char **input_filename,
+                                                    int64_t memory_limit, const char *output_filename,
+                                                    int binary_output)
+{
+    return sort_files(num_input_files, input_filename, harp_collocation_sort_by_a, 1, memory_limit, output_filename,
+                      binary_output);
+}
+
 /** Swap the columns of this collocation result inplace.
  *
  * This swaps datasets A and B (such that A becomes B and B becomes A).
@@ -1106,6 +3403,7 @@ LIBHARP_API void harp_collocation_result_swap_datasets(harp_collocation_result *
     long i;
     harp_dataset *data_a;
 
+    collocation_result_reset_index(collocation_result);
     for (i = 0; i < collocation_result->num_pairs; i++)
     {
         collocation_pair_swap_datasets(collocation_result->pair[i]);
@@ -1121,76 +3419,257 @@ LIBHARP_API void harp_collocation_result_swap_datasets(harp_collocation_result *
  * @}
  */
 
-/* Creates a shallow copy of a collocation result for filtering purposes */
-int harp_collocation_result_shallow_copy(const harp_collocation_result *collocation_result,
-                                         harp_collocation_result **new_result)
+/* A view on a collocation result is a collocation result that references a subset of the pairs (and the datasets and
+ * difference descriptions) of another collocation result. A view is only valid as long as the collocation result it
+ * was created from is not modified, should not be modified itself, and should be removed with
+ * harp_collocation_result_view_delete(). Lookup indices that are built on a view are owned by the view.
+ */
+static int collocation_result_view_new(const harp_collocation_result *collocation_result, long num_pairs,
+                                       harp_collocation_result **new_view)
 {
-    harp_collocation_result *result = NULL;
-    long i;
+    harp_collocation_result *view;
 
-    /* allocate memory for the result struct */
-    result = (harp_collocation_result *)malloc(sizeof(harp_collocation_result));
-    if (result == NULL)
+    view = (harp_collocation_result *)malloc(sizeof(harp_collocation_result));
+    if (view == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        sizeof(harp_collocation_result), __FILE__, __LINE__);
         return -1;
     }
-    result->dataset_a = collocation_result->dataset_a;
-    result->dataset_b = collocation_result->dataset_b;
-    result->num_differences = collocation_result->num_differences;
-    result->difference_variable_name = collocation_result->difference_variable_name;
-    result->difference_unit = collocation_result->difference_unit;
-    result->num_pairs = collocation_result->num_pairs;
-    result->pair = NULL;
+    view->dataset_a = collocation_result->dataset_a;
+    view->dataset_b = collocation_result->dataset_b;
+    view->num_differences = collocation_result->num_differences;
+    view->difference_variable_name = collocation_result->difference_variable_name;
+    view->difference_unit = collocation_result->difference_unit;
+    view->num_pairs = num_pairs;
+    view->index = NULL;
 
-    result->pair = malloc(collocation_result->num_pairs * sizeof(harp_collocation_pair *));
-    if (result->pair == NULL)
+    view->pair = malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(harp_collocation_pair *));
+    if (view->pair == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       collocation_result->num_pairs * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
-        harp_collocation_result_shallow_delete(result);
+                       num_pairs * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
+        free(view);
         return -1;
     }
-    for (i = 0; i < collocation_result->num_pairs; i++)
+
+    *new_view = view;
+    return 0;
+}
+
+static int get_view_for_product(const harp_collocation_result *collocation_result, int use_b,
+                                const char *source_product, harp_collocation_result **new_view)
+{
+    struct harp_collocation_result_index_struct *index;
+    harp_collocation_result *view;
+    harp_collocation_pair **grouped_pair;
+    long *offset;
+    long num_products;
+    long product_index;
+
+    if (harp_dataset_get_index_from_source_product(use_b ? collocation_result->dataset_b :
+                                                   collocation_result->dataset_a, source_product, &product_index) != 0)
     {
-        result->pair[i] = NULL;
+        return -1;
     }
-
-    for (i = 0; i < collocation_result->num_pairs; i++)
+    if (collocation_result_get_index(collocation_result, &index) != 0)
     {
-        harp_collocation_pair *pair = collocation_result->pair[i];
-
-        if (collocation_pair_new(pair->collocation_index, pair->product_index_a, pair->sample_index_a,
-                                 pair->product_index_b, pair->sample_index_b, pair->num_differences, pair->difference,
-                                 &result->pair[i]) != 0)
+        return -1;
+    }
+    if (use_b)
+    {
+        if (index->offset_b == NULL)
         {
-            harp_collocation_result_shallow_delete(result);
-            return -1;
+            if (collocation_result_index_products(collocation_result, 1, &index->num_products_b, &index->offset_b,
+                                                  &index->pair_by_b) != 0)
+            {
+                return -1;
+            }
+        }
+        num_products = index->num_products_b;
+        offset = index->offset_b;
+        grouped_pair = index->pair_by_b;
+    }
+    else
+    {
+        if (index->offset_a == NULL)
+        {
+            if (collocation_result_index_products(collocation_result, 0, &index->num_products_a, &index->offset_a,
+                                                  &index->pair_by_a) != 0)
+            {
+                return -1;
+            }
         }
+        num_products = index->num_products_a;
+        offset = index->offset_a;
+        grouped_pair = index->pair_by_a;
     }
 
-    *new_result = result;
+    if (product_index >= num_products)
+    {
+        /* the product was added to the dataset after the index was built (and is not referenced by any pair) */
+        return collocation_result_view_new(collocation_result, 0, new_view);
+    }
+    if (collocation_result_view_new(collocation_result, offset[product_index + 1] - offset[product_index], &view) != 0)
+    {
+        return -1;
+    }
+    memcpy(view->pair, &grouped_pair[offset[product_index]], view->num_pairs * sizeof(harp_collocation_pair *));
 
+    *new_view = view;
     return 0;
 }
 
-void harp_collocation_result_shallow_delete(harp_collocation_result *collocation_result)
+/* Get a view on the pairs of the collocation result that reference the given source product from dataset A.
+ * The pairs keep their relative order. Except for the first call, which builds the lookup index on the collocation
+ * result, this takes time linear in the number of selected pairs.
+ */
+int harp_collocation_result_get_view_for_source_product_a(const harp_collocation_result *collocation_result,
+                                                         const char *source_product,
+                                                         harp_collocation_result **new_view)
+{
+    return get_view_for_product(collocation_result, 0, source_product, new_view);
+}
+
+/* Get a view on the pairs of the collocation result that reference the given source product from dataset B.
+ * The pairs keep their relative order. Except for the first call, which builds the lookup index on the collocation
+ * result, this takes time linear in the number of selected pairs.
+ */
+int harp_collocation_result_get_view_for_source_product_b(const harp_collocation_result *collocation_result,
+                                                         const char *source_product,
+                                                         harp_collocation_result **new_view)
+{
+    return get_view_for_product(collocation_result, 1, source_product, new_view);
+}
+
+static int compare_pair_pointer(const void *a, const void *b)
+{
+    const harp_collocation_pair *pair_a = *(harp_collocation_pair * const *)a;
+    const harp_collocation_pair *pair_b = *(harp_collocation_pair * const *)b;
+
+    return (pair_a > pair_b) - (pair_a < pair_b);
+}
+
+/* Get a view on the pairs with the given collocation indices (in the order of the collocation_index array).
+ * If a collocation index cannot be found in the collocation result, or if a pair is selected more than once, an error
+ * will be thrown. Except for the first call, which builds the lookup index on the collocation result, this takes
+ * O(k log n) time for k indices.
+ */
+int harp_collocation_result_get_view_for_collocation_indices(const harp_collocation_result *collocation_result,
+                                                             long num_indices, const int32_t *collocation_index,
+                                                             harp_collocation_result **new_view)
 {
-    if (collocation_result != NULL)
+    struct harp_collocation_result_index_struct *index;
+    harp_collocation_result *view;
+    harp_collocation_pair **selected_pair;
+    long i;
+
+    if (collocation_result_get_index(collocation_result, &index) != 0)
     {
-        if (collocation_result->pair != NULL)
-        {
-            long i;
+        return -1;
+    }
+    if (index->pair_by_collocation_index == NULL)
+    {
+        pair_sort_key *key;
 
+        index->pair_by_collocation_index = malloc((collocation_result->num_pairs > 0 ?
+                                                   collocation_result->num_pairs : 1) *
+                                                  sizeof(harp_collocation_pair *));
+        if (index->pair_by_collocation_index == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           collocation_result->num_pairs * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
+            return -1;
+        }
+        if (collocation_result->num_pairs > 0)
+        {
+            key = malloc(collocation_result->num_pairs * sizeof(pair_sort_key));
+            if (key == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               collocation_result->num_pairs * sizeof(pair_sort_key), __FILE__, __LINE__);
+                free(index->pair_by_collocation_index);
+                index->pair_by_collocation_index = NULL;
+                return -1;
+            }
+            for (i = 0; i < collocation_result->num_pairs; i++)
+            {
+                key[i].key[0] = get_sort_key_value(collocation_result->pair[i]->collocation_index);
+                key[i].pair = collocation_result->pair[i];
+            }
+            if (radix_sort_pair_keys(collocation_result->num_pairs, 1, &key) != 0)
+            {
+                free(key);
+                free(index->pair_by_collocation_index);
+                index->pair_by_collocation_index = NULL;
+                return -1;
+            }
             for (i = 0; i < collocation_result->num_pairs; i++)
             {
-                collocation_pair_delete(collocation_result->pair[i]);
+                index->pair_by_collocation_index[i] = key[i].pair;
             }
+            free(key);
+        }
+    }
+
+    if (collocation_result_view_new(collocation_result, num_indices, &view) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < num_indices; i++)
+    {
+        long pair_index;
+
+        if (find_collocation_pair_for_collocation_index(collocation_result->num_pairs,
+                                                        index->pair_by_collocation_index, collocation_index[i],
+                                                        &pair_index) != 0)
+        {
+            harp_collocation_result_view_delete(view);
+            return -1;
+        }
+        view->pair[i] = index->pair_by_collocation_index[pair_index];
+    }
 
-            free(collocation_result->pair);
+    /* each pair can only be selected once */
+    if (num_indices > 1)
+    {
+        selected_pair = malloc(num_indices * sizeof(harp_collocation_pair *));
+        if (selected_pair == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_indices * sizeof(harp_collocation_pair *), __FILE__, __LINE__);
+            harp_collocation_result_view_delete(view);
+            return -1;
+        }
+        memcpy(selected_pair, view->pair, num_indices * sizeof(harp_collocation_pair *));
+        qsort(selected_pair, num_indices, sizeof(harp_collocation_pair *), compare_pair_pointer);
+        for (i = 1; i < num_indices; i++)
+        {
+            if (selected_pair[i] == selected_pair[i - 1])
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot find collocation index %ld in collocation "
+                               "results", selected_pair[i]->collocation_index);
+                free(selected_pair);
+                harp_collocation_result_view_delete(view);
+                return -1;
+            }
         }
+        free(selected_pair);
+    }
+
+    *new_view = view;
+    return 0;
+}
 
-        free(collocation_result);
+void harp_collocation_result_view_delete(harp_collocation_result *view)
+{
+    if (view != NULL)
+    {
+        if (view->pair != NULL)
+        {
+            free(view->pair);
+        }
+        collocation_result_reset_index(view);
+        free(view);
     }
 }
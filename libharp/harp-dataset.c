@@ -30,6 +30,8 @@
  */
 
 #include "harp-internal.h"
+#include "harp-csv.h"
+#include "harp-thread.h"
 #include "hashtable.h"
 
 #include <sys/types.h>
@@ -47,6 +49,8 @@
 #include "windows.h"
 #endif
 
+static int import_path(harp_dataset *dataset, const char *path, const char *options, const harp_program *program);
+
 /** \defgroup harp_dataset HARP harp_dataset
  * The HARP harp_dataset module contains everything regarding HARP datasets.
  *
@@ -54,6 +58,15 @@
  * The primary reference to a product is the value of the 'source_product' global attribute of a HARP product.
  */
 
+/* Check whether filename has the extension of an archive index file (see harp_dataset_write_archive_index()) */
+static int is_archive_index(const char *filename)
+{
+    long length = (long)strlen(filename);
+    long extension_length = (long)strlen(HARP_ARCHIVE_INDEX_EXTENSION);
+
+    return length > extension_length && strcmp(&filename[length - extension_length], HARP_ARCHIVE_INDEX_EXTENSION) == 0;
+}
+
 /**
  * Check that filename is a directory and can be read.
  */
@@ -86,7 +99,207 @@ static int is_directory(const char *directoryname)
     return 0;
 }
 
-static int add_path_file(harp_dataset *dataset, const char *filename, const char *options)
+/* Add a product reference to a dataset.
+ * If update_sorted_index is not set then the new entry is just appended at the end of sorted_index and
+ * harp_dataset_sort_products() should be called once all products have been added. This allows a large number of
+ * products to be added with a single sort at the end instead of performing a sorted insert for each product.
+ */
+static int add_product(harp_dataset *dataset, const char *source_product, harp_product_metadata *metadata,
+                       int update_sorted_index)
+{
+    if (metadata != NULL && strcmp(metadata->source_product, source_product) != 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid source product '%s' in metadata, expected '%s'",
+                       metadata->source_product, source_product);
+        return -1;
+    }
+
+    /* if source product does not already appear, add it */
+    if (!harp_dataset_has_product(dataset, source_product))
+    {
+        long index;
+        long i;
+
+        /* Make space for new entry */
+        if (dataset->num_products % BLOCK_SIZE == 0)
+        {
+            char **new_source_product;
+            long *new_sorted_index;
+            harp_product_metadata **new_metadata;
+
+            /* grow the source_product array by one block */
+            new_source_product = realloc(dataset->source_product,
+                                         (dataset->num_products + BLOCK_SIZE) * sizeof(char **));
+            if (new_source_product == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               (dataset->num_products + BLOCK_SIZE) * sizeof(char **), __FILE__, __LINE__);
+                return -1;
+            }
+            dataset->source_product = new_source_product;
+
+            new_sorted_index = realloc(dataset->sorted_index, (dataset->num_products + BLOCK_SIZE) * sizeof(long));
+            if (new_sorted_index == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               (dataset->num_products + BLOCK_SIZE) * sizeof(long), __FILE__, __LINE__);
+                return -1;
+            }
+            dataset->sorted_index = new_sorted_index;
+
+            new_metadata = realloc(dataset->metadata,
+                                   (dataset->num_products + BLOCK_SIZE) * sizeof(harp_product_metadata *));
+            if (new_metadata == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               (dataset->num_products + BLOCK_SIZE) * sizeof(harp_product_metadata *), __FILE__,
+                               __LINE__);
+                return -1;
+            }
+            dataset->metadata = new_metadata;
+
+            /* zero-out metadata entries; as these are only optionally set in the future */
+            for (i = dataset->num_products; i < (dataset->num_products + BLOCK_SIZE); i++)
+            {
+                dataset->metadata[i] = NULL;
+            }
+        }
+
+        /* add newly appended item into the list of sorted indices */
+        index = dataset->num_products;
+        if (update_sorted_index && dataset->num_products > 0 &&
+            strcmp(source_product, dataset->source_product[dataset->sorted_index[dataset->num_products - 1]]) < 0)
+        {
+            long low = 0;
+            long high = dataset->num_products - 1;
+
+            /* find the first entry that sorts after source_product */
+            while (low < high)
+            {
+                long mid = low + (high - low) / 2;
+
+                if (strcmp(source_product, dataset->source_product[dataset->sorted_index[mid]]) < 0)
+                {
+                    high = mid;
+                }
+                else
+                {
+                    low = mid + 1;
+                }
+            }
+            index = low;
+            memmove(&dataset->sorted_index[index + 1], &dataset->sorted_index[index],
+                    (dataset->num_products - index) * sizeof(long));
+        }
+        dataset->sorted_index[index] = dataset->num_products;
+
+        dataset->num_products++;
+
+        dataset->source_product[dataset->num_products - 1] = strdup(source_product);
+        if (dataset->source_product[dataset->num_products - 1] == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (failed to duplicate string) (%s:%u)",
+                           __FILE__, __LINE__);
+            return -1;
+        }
+
+        if (hashtable_add_name(dataset->product_to_index, dataset->source_product[dataset->num_products - 1]) != 0)
+        {
+            assert(0);
+            exit(1);
+        }
+    }
+
+    if (metadata)
+    {
+        long index;
+
+        if (harp_dataset_get_index_from_source_product(dataset, source_product, &index))
+        {
+            return -1;
+        }
+
+        /* Delete existing metadata for this product */
+        if (dataset->metadata[index] != NULL)
+        {
+            harp_product_metadata_delete(dataset->metadata[index]);
+        }
+
+        /* Set the metadata for this source_product */
+        dataset->metadata[index] = metadata;
+    }
+
+    return 0;
+}
+
+/* Add a product reference to a dataset without keeping sorted_index ordered.
+ * harp_dataset_sort_products() should be called after all products have been added.
+ */
+int harp_dataset_add_product_unsorted(harp_dataset *dataset, const char *source_product,
+                                      harp_product_metadata *metadata)
+{
+    return add_product(dataset, source_product, metadata, 0);
+}
+
+typedef struct source_product_sort_key_struct
+{
+    const char *source_product;
+    long index;
+} source_product_sort_key;
+
+static int compare_source_product_sort_keys(const void *a, const void *b)
+{
+    return strcmp(((const source_product_sort_key *)a)->source_product,
+                  ((const source_product_sort_key *)b)->source_product);
+}
+
+/* Restore the ordering of sorted_index after calls to harp_dataset_add_product_unsorted() */
+int harp_dataset_sort_products(harp_dataset *dataset)
+{
+    source_product_sort_key *key;
+    long i;
+
+    /* nothing to do if the products were added in sorted order */
+    for (i = 1; i < dataset->num_products; i++)
+    {
+        if (strcmp(dataset->source_product[dataset->sorted_index[i - 1]],
+                   dataset->source_product[dataset->sorted_index[i]]) > 0)
+        {
+            break;
+        }
+    }
+    if (i >= dataset->num_products)
+    {
+        return 0;
+    }
+
+    key = malloc(dataset->num_products * sizeof(source_product_sort_key));
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(source_product_sort_key), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        key[i].source_product = dataset->source_product[dataset->sorted_index[i]];
+        key[i].index = dataset->sorted_index[i];
+    }
+
+    /* source_product values are unique, so the sort result is fully determined */
+    qsort(key, dataset->num_products, sizeof(source_product_sort_key), compare_source_product_sort_keys);
+
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        dataset->sorted_index[i] = key[i].index;
+    }
+    free(key);
+
+    return 0;
+}
+
+static int add_path_file(harp_dataset *dataset, const char *filename, const char *options,
+                         const harp_program *program)
 {
     char line[HARP_MAX_PATH_LENGTH];
     FILE *stream;
@@ -112,7 +325,7 @@ static int add_path_file(harp_dataset *dataset, const char *filename, const char
         /* skip empty lines and lines starting with '#' */
         if (length > 0 && line[0] != '#')
         {
-            if (harp_dataset_import(dataset, line, options) != 0)
+            if (import_path(dataset, line, options, program) != 0)
             {
                 fclose(stream);
                 return -1;
@@ -125,19 +338,750 @@ static int add_path_file(harp_dataset *dataset, const char *filename, const char
     return 0;
 }
 
+/* Name of the (optional) file in each directory that caches the product metadata of the files in that directory */
+#define DATASET_INDEX_FILENAME ".harp_dataset_index"
+#define DATASET_INDEX_TEMP_FILENAME ".harp_dataset_index.tmp"
+#define DATASET_INDEX_HEADER "# HARP dataset index 2"
+#define DATASET_INDEX_OPTIONS_PREFIX "# options="
+
+/* Cached product metadata of a single file */
+typedef struct dataset_index_entry_struct
+{
+    char *filename;     /* name of the file within the directory */
+    long mtime;         /* modification time of the file at the time the metadata was retrieved */
+    long size;          /* size of the file at the time the metadata was retrieved */
+    double datetime_start;
+    double datetime_stop;
+    double spatial_extent[4];   /* latitude_min, latitude_max, longitude_min, longitude_max (NaN if unknown) */
+    long dimension[HARP_NUM_DIM_TYPES];
+    char *source_product;
+    int used;   /* set if the file was encountered while scanning the directory */
+} dataset_index_entry;
+
+/* Cached product metadata of all files in a single directory */
+typedef struct dataset_index_struct
+{
+    char *filename;     /* path of the index file */
+    long num_entries;
+    dataset_index_entry **entry;
+    hashtable *filename_to_index;
+    int modified;       /* set if the index file needs to be (re)written */
+} dataset_index;
+
+static void dataset_index_entry_delete(dataset_index_entry *entry)
+{
+    if (entry->filename != NULL)
+    {
+        free(entry->filename);
+    }
+    if (entry->source_product != NULL)
+    {
+        free(entry->source_product);
+    }
+    free(entry);
+}
+
+static void dataset_index_delete_entries(dataset_index *index)
+{
+    long i;
+
+    if (index->entry != NULL)
+    {
+        for (i = 0; i < index->num_entries; i++)
+        {
+            dataset_index_entry_delete(index->entry[i]);
+        }
+        free(index->entry);
+        index->entry = NULL;
+    }
+    index->num_entries = 0;
+}
+
+/* Remove all entries from the index */
+static int dataset_index_clear(dataset_index *index)
+{
+    dataset_index_delete_entries(index);
+    hashtable_delete(index->filename_to_index);
+    index->filename_to_index = hashtable_new(1);
+    if (index->filename_to_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void dataset_index_delete(dataset_index *index)
+{
+    dataset_index_delete_entries(index);
+    if (index->filename_to_index != NULL)
+    {
+        hashtable_delete(index->filename_to_index);
+    }
+    if (index->filename != NULL)
+    {
+        free(index->filename);
+    }
+    free(index);
+}
+
+static int dataset_index_new(const char *pathname, dataset_index **new_index)
+{
+    dataset_index *index;
+
+    index = (dataset_index *)malloc(sizeof(dataset_index));
+    if (index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(dataset_index), __FILE__, __LINE__);
+        return -1;
+    }
+    index->filename = NULL;
+    index->num_entries = 0;
+    index->entry = NULL;
+    index->filename_to_index = hashtable_new(1);
+    index->modified = 0;
+
+    if (index->filename_to_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        dataset_index_delete(index);
+        return -1;
+    }
+
+    index->filename = malloc(strlen(pathname) + 1 + strlen(DATASET_INDEX_FILENAME) + 1);
+    if (index->filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(pathname) + 1 + strlen(DATASET_INDEX_FILENAME) + 1, __FILE__, __LINE__);
+        dataset_index_delete(index);
+        return -1;
+    }
+#ifdef WIN32
+    sprintf(index->filename, "%s\\%s", pathname, DATASET_INDEX_FILENAME);
+#else
+    sprintf(index->filename, "%s/%s", pathname, DATASET_INDEX_FILENAME);
+#endif
+
+    *new_index = index;
+
+    return 0;
+}
+
+/* the index uses a plain comma separated format, so only strings without commas, line breaks, and leading/trailing
+ * white space can be stored */
+static int can_store_in_index(const char *str)
+{
+    size_t length = strlen(str);
+
+    return length > 0 && strpbrk(str, ",\r\n") == NULL && str[0] != ' ' && str[length - 1] != ' ' &&
+        str[length - 1] != '\t';
+}
+
+/* Store the metadata of a file in the index (replacing any existing entry for that file) */
+static int dataset_index_set_entry(dataset_index *index, const char *filename, long mtime, long size,
+                                   const harp_product_metadata *metadata)
+{
+    dataset_index_entry *entry;
+    long entry_index;
+    int i;
+
+    entry = (dataset_index_entry *)malloc(sizeof(dataset_index_entry));
+    if (entry == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(dataset_index_entry), __FILE__, __LINE__);
+        return -1;
+    }
+    entry->filename = NULL;
+    entry->source_product = NULL;
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->datetime_start = metadata->datetime_start;
+    entry->datetime_stop = metadata->datetime_stop;
+    entry->spatial_extent[0] = metadata->latitude_min;
+    entry->spatial_extent[1] = metadata->latitude_max;
+    entry->spatial_extent[2] = metadata->longitude_min;
+    entry->spatial_extent[3] = metadata->longitude_max;
+    for (i = 0; i < HARP_NUM_DIM_TYPES; i++)
+    {
+        entry->dimension[i] = metadata->dimension[i];
+    }
+    entry->used = 1;
+
+    entry->filename = strdup(filename);
+    if (entry->filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (failed to duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        dataset_index_entry_delete(entry);
+        return -1;
+    }
+    entry->source_product = strdup(metadata->source_product);
+    if (entry->source_product == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (failed to duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        dataset_index_entry_delete(entry);
+        return -1;
+    }
+
+    entry_index = hashtable_get_index_from_name(index->filename_to_index, filename);
+    if (entry_index >= 0)
+    {
+        /* the hashtable references the filename of the entry, so keep the old filename string */
+        free(entry->filename);
+        entry->filename = index->entry[entry_index]->filename;
+        index->entry[entry_index]->filename = NULL;
+        dataset_index_entry_delete(index->entry[entry_index]);
+        index->entry[entry_index] = entry;
+        return 0;
+    }
+
+    if (index->num_entries % BLOCK_SIZE == 0)
+    {
+        dataset_index_entry **new_entry;
+
+        new_entry = realloc(index->entry, (index->num_entries + BLOCK_SIZE) * sizeof(dataset_index_entry *));
+        if (new_entry == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (index->num_entries + BLOCK_SIZE) * sizeof(dataset_index_entry *), __FILE__, __LINE__);
+            dataset_index_entry_delete(entry);
+            return -1;
+        }
+        index->entry = new_entry;
+    }
+    index->entry[index->num_entries] = entry;
+    if (hashtable_add_name(index->filename_to_index, entry->filename) != 0)
+    {
+        /* duplicate filename; this cannot happen since we checked the hashtable above */
+        assert(0);
+        exit(1);
+    }
+    index->num_entries++;
+
+    return 0;
+}
+
+static int parse_index_line(char *line, char **filename, long *mtime, long *size, harp_product_metadata *metadata)
+{
+    char *cursor = line;
+    int i;
+
+    harp_csv_parse_string(&cursor, filename);
+    if (harp_csv_parse_long(&cursor, mtime) != 0)
+    {
+        return -1;
+    }
+    if (harp_csv_parse_long(&cursor, size) != 0)
+    {
+        return -1;
+    }
+    if (harp_csv_parse_double(&cursor, &metadata->datetime_start) != 0)
+    {
+        return -1;
+    }
+    if (harp_csv_parse_double(&cursor, &metadata->datetime_stop) != 0)
+    {
+        return -1;
+    }
+    if (harp_csv_parse_double(&cursor, &metadata->latitude_min) != 0)
+    {
+        return -1;
+    }
+    if (harp_csv_parse_double(&cursor, &metadata->latitude_max) != 0)
+    {
+        return -1;
+    }
+    if (harp_csv_parse_double(&cursor, &metadata->longitude_min) != 0)
+    {
+        return -1;
+    }
+    if (harp_csv_parse_double(&cursor, &metadata->longitude_max) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < HARP_NUM_DIM_TYPES; i++)
+    {
+        if (harp_csv_parse_long(&cursor, &metadata->dimension[i]) != 0)
+        {
+            return -1;
+        }
+    }
+    harp_csv_parse_string(&cursor, &metadata->source_product);
+    if (**filename == '\0' || *metadata->source_product == '\0')
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Read the index file of a directory.
+ * A missing, unreadable, or outdated index file (e.g. one that was created using different ingestion options) is not
+ * an error; the index will then just start out empty.
+ */
+static int dataset_index_read(dataset_index *index, const char *options)
+{
+    char line[HARP_CSV_LINE_LENGTH];
+    FILE *stream;
+    long length;
+
+    index->modified = 1;
+
+    stream = fopen(index->filename, "r");
+    if (stream == NULL)
+    {
+        return 0;
+    }
+
+    /* check the header */
+    if (fgets(line, HARP_CSV_LINE_LENGTH, stream) == NULL)
+    {
+        fclose(stream);
+        return 0;
+    }
+    harp_csv_rtrim(line);
+    if (strcmp(line, DATASET_INDEX_HEADER) != 0)
+    {
+        fclose(stream);
+        return 0;
+    }
+    if (fgets(line, HARP_CSV_LINE_LENGTH, stream) == NULL)
+    {
+        fclose(stream);
+        return 0;
+    }
+    length = (long)strlen(line);
+    while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n'))
+    {
+        length--;
+    }
+    line[length] = '\0';
+    if (strncmp(line, DATASET_INDEX_OPTIONS_PREFIX, strlen(DATASET_INDEX_OPTIONS_PREFIX)) != 0 ||
+        strcmp(&line[strlen(DATASET_INDEX_OPTIONS_PREFIX)], options == NULL ? "" : options) != 0)
+    {
+        fclose(stream);
+        return 0;
+    }
+
+    while (fgets(line, HARP_CSV_LINE_LENGTH, stream) != NULL)
+    {
+        harp_product_metadata metadata;
+        char *filename;
+        long mtime;
+        long size;
+
+        length = (long)strlen(line);
+        if (length == 0 || line[length - 1] != '\n')
+        {
+            /* truncated line */
+            fclose(stream);
+            return dataset_index_clear(index);
+        }
+        harp_csv_rtrim(line);
+        if (parse_index_line(line, &filename, &mtime, &size, &metadata) != 0)
+        {
+            fclose(stream);
+            return dataset_index_clear(index);
+        }
+        if (dataset_index_set_entry(index, filename, mtime, size, &metadata) != 0)
+        {
+            fclose(stream);
+            return -1;
+        }
+        /* entries only become used once the file is found in the directory */
+        index->entry[hashtable_get_index_from_name(index->filename_to_index, filename)]->used = 0;
+    }
+    if (ferror(stream))
+    {
+        fclose(stream);
+        return dataset_index_clear(index);
+    }
+    fclose(stream);
+
+    index->modified = 0;
+
+    return 0;
+}
+
+/* (Re)write the index file of a directory if its content has changed.
+ * The index is first written to a temporary file which then replaces the existing index file, such that concurrent
+ * readers never see a partially written index.
+ * Failure to write the index (e.g. because the directory is read-only) only results in a warning.
+ */
+static void dataset_index_write(dataset_index *index, const char *options)
+{
+    char *temp_filename;
+    FILE *stream;
+    long i;
+    int result;
+
+    for (i = 0; i < index->num_entries; i++)
+    {
+        if (!index->entry[i]->used)
+        {
+            /* file was removed from the directory */
+            index->modified = 1;
+        }
+    }
+    if (!index->modified)
+    {
+        return;
+    }
+
+    temp_filename = malloc(strlen(index->filename) + 4 + 1);
+    if (temp_filename == NULL)
+    {
+        harp_report_warning("could not write dataset index '%s' (out of memory)", index->filename);
+        return;
+    }
+    sprintf(temp_filename, "%s.tmp", index->filename);
+
+    stream = fopen(temp_filename, "w");
+    if (stream == NULL)
+    {
+        harp_report_warning("could not write dataset index '%s' (%s)", index->filename, strerror(errno));
+        free(temp_filename);
+        return;
+    }
+
+    result = fprintf(stream, "%s\n%s%s\n", DATASET_INDEX_HEADER, DATASET_INDEX_OPTIONS_PREFIX,
+                     options == NULL ? "" : options) < 0;
+    for (i = 0; i < index->num_entries && !result; i++)
+    {
+        dataset_index_entry *entry = index->entry[i];
+        int j;
+
+        if (!entry->used)
+        {
+            continue;
+        }
+        result = fprintf(stream, "%s,%ld,%ld,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g", entry->filename, entry->mtime,
+                         entry->size, entry->datetime_start, entry->datetime_stop, entry->spatial_extent[0],
+                         entry->spatial_extent[1], entry->spatial_extent[2], entry->spatial_extent[3]) < 0;
+        for (j = 0; j < HARP_NUM_DIM_TYPES && !result; j++)
+        {
+            result = fprintf(stream, ",%ld", entry->dimension[j]) < 0;
+        }
+        if (!result)
+        {
+            result = fprintf(stream, ",%s\n", entry->source_product) < 0;
+        }
+    }
+    if (fclose(stream) != 0)
+    {
+        result = 1;
+    }
+
+#ifdef WIN32
+    /* rename() on Windows does not replace existing files */
+    if (!result)
+    {
+        remove(index->filename);
+    }
+#endif
+    if (result || rename(temp_filename, index->filename) != 0)
+    {
+        harp_report_warning("could not write dataset index '%s' (%s)", index->filename, strerror(errno));
+        remove(temp_filename);
+    }
+    else
+    {
+        index->modified = 0;
+    }
+
+    free(temp_filename);
+}
+
+/* Add a file from a directory using the metadata cached in the directory index (if it is still up to date) */
+static int add_indexed_file(harp_dataset *dataset, dataset_index *index, const char *filename, const char *filepath,
+                            const char *options)
+{
+    harp_product_metadata *metadata = NULL;
+    struct stat statbuf;
+    long length = (long)strlen(filename);
+    long entry_index;
+
+    if (stat(filepath, &statbuf) != 0 || (statbuf.st_mode & S_IFDIR) ||
+        (length > 4 && strcmp(&filename[length - 4], ".pth") == 0) || !can_store_in_index(filename))
+    {
+        /* only regular product files are cached */
+        return import_path(dataset, filepath, options, NULL);
+    }
+
+    entry_index = hashtable_get_index_from_name(index->filename_to_index, filename);
+    if (entry_index >= 0 && index->entry[entry_index]->mtime == (long)statbuf.st_mtime &&
+        index->entry[entry_index]->size == (long)statbuf.st_size)
+    {
+        dataset_index_entry *entry = index->entry[entry_index];
+        int i;
+
+        entry->used = 1;
+
+        if (harp_product_metadata_new(&metadata) != 0)
+        {
+            return -1;
+        }
+        metadata->datetime_start = entry->datetime_start;
+        metadata->datetime_stop = entry->datetime_stop;
+        metadata->latitude_min = entry->spatial_extent[0];
+        metadata->latitude_max = entry->spatial_extent[1];
+        metadata->longitude_min = entry->spatial_extent[2];
+        metadata->longitude_max = entry->spatial_extent[3];
+        for (i = 0; i < HARP_NUM_DIM_TYPES; i++)
+        {
+            metadata->dimension[i] = entry->dimension[i];
+        }
+        metadata->filename = strdup(filepath);
+        if (metadata->filename == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (failed to duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            harp_product_metadata_delete(metadata);
+            return -1;
+        }
+        metadata->source_product = strdup(entry->source_product);
+        if (metadata->source_product == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (failed to duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            harp_product_metadata_delete(metadata);
+            return -1;
+        }
+
+        return add_product(dataset, metadata->source_product, metadata, 0);
+    }
+
+    if (harp_import_product_metadata(filepath, options, &metadata) != 0)
+    {
+        return -1;
+    }
+    if (can_store_in_index(metadata->source_product))
+    {
+        if (dataset_index_set_entry(index, filename, (long)statbuf.st_mtime, (long)statbuf.st_size, metadata) != 0)
+        {
+            harp_product_metadata_delete(metadata);
+            return -1;
+        }
+        index->modified = 1;
+    }
+
+    return add_product(dataset, metadata->source_product, metadata, 0);
+}
+
+/* minimum number of directory entries for each thread that retrieves product metadata (see add_directory()) */
+#define MIN_NUM_ENTRIES_PER_THREAD 8
+
+/* A file in a directory that is being added to a dataset */
+typedef struct directory_entry_struct
+{
+    char *filename;     /* name of the file within the directory */
+    char *filepath;     /* path of the file */
+    harp_product_metadata *metadata;    /* metadata of the product file (if it was retrieved in advance) */
+} directory_entry;
+
+/* All files in a directory that is being added to a dataset */
+typedef struct directory_scan_struct
+{
+    const char *pathname;
+    const char *options;
+    dataset_index *index;       /* directory index (NULL if not used) */
+    long num_entries;
+    directory_entry *entry;
+} directory_scan;
+
+static void directory_scan_clear(directory_scan *scan)
+{
+    long i;
+
+    for (i = 0; i < scan->num_entries; i++)
+    {
+        free(scan->entry[i].filename);
+        free(scan->entry[i].filepath);
+        if (scan->entry[i].metadata != NULL)
+        {
+            harp_product_metadata_delete(scan->entry[i].metadata);
+        }
+    }
+    if (scan->entry != NULL)
+    {
+        free(scan->entry);
+    }
+}
+
+static int directory_scan_add_entry(directory_scan *scan, const char *filename)
+{
+    directory_entry *entry;
+
+    /* never treat the index files themselves as products */
+    if (strcmp(filename, DATASET_INDEX_FILENAME) == 0 || strcmp(filename, DATASET_INDEX_TEMP_FILENAME) == 0)
+    {
+        return 0;
+    }
+
+    if (scan->num_entries % BLOCK_SIZE == 0)
+    {
+        directory_entry *new_entry;
+
+        new_entry = realloc(scan->entry, (scan->num_entries + BLOCK_SIZE) * sizeof(directory_entry));
+        if (new_entry == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (scan->num_entries + BLOCK_SIZE) * sizeof(directory_entry), __FILE__, __LINE__);
+            return -1;
+        }
+        scan->entry = new_entry;
+    }
+    entry = &scan->entry[scan->num_entries];
+
+    entry->filename = strdup(filename);
+    if (entry->filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (failed to duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    /* Add path before filename */
+    entry->filepath = malloc(strlen(scan->pathname) + 1 + strlen(filename) + 1);
+    if (entry->filepath == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(scan->pathname) + 1 + strlen(filename) + 1, __FILE__, __LINE__);
+        free(entry->filename);
+        return -1;
+    }
+#ifdef WIN32
+    sprintf(entry->filepath, "%s\\%s", scan->pathname, filename);
+#else
+    sprintf(entry->filepath, "%s/%s", scan->pathname, filename);
+#endif
+    entry->metadata = NULL;
+    scan->num_entries++;
+
+    return 0;
+}
+
+/* Retrieve the metadata of a directory entry if it is a product file whose metadata is not available in the directory
+ * index. Entries that are directories, .pth files, or archive index files (or that can not be accessed) are left to
+ * add_directory_entry().
+ * This is called for several entries at the same time (see add_directory()), such that the time spent waiting for the
+ * storage (file opens on network file systems in particular) overlaps.
+ */
+static int scan_directory_entry(void *arg, long i)
+{
+    directory_scan *scan = (directory_scan *)arg;
+    directory_entry *entry = &scan->entry[i];
+    struct stat statbuf;
+    long length = (long)strlen(entry->filename);
+
+    if (stat(entry->filepath, &statbuf) != 0 || (statbuf.st_mode & S_IFDIR) ||
+        (length > 4 && strcmp(&entry->filename[length - 4], ".pth") == 0) || is_archive_index(entry->filename))
+    {
+        return 0;
+    }
+    if (scan->index != NULL && can_store_in_index(entry->filename))
+    {
+        long entry_index = hashtable_get_index_from_name(scan->index->filename_to_index, entry->filename);
+
+        if (entry_index >= 0 && scan->index->entry[entry_index]->mtime == (long)statbuf.st_mtime &&
+            scan->index->entry[entry_index]->size == (long)statbuf.st_size)
+        {
+            /* the cached metadata is used */
+            return 0;
+        }
+    }
+
+    return harp_import_product_metadata(entry->filepath, scan->options, &entry->metadata);
+}
+
+static int add_directory_entry(harp_dataset *dataset, directory_scan *scan, directory_entry *entry)
+{
+    harp_product_metadata *metadata = entry->metadata;
+
+    if (metadata == NULL)
+    {
+        if (scan->index != NULL)
+        {
+            return add_indexed_file(dataset, scan->index, entry->filename, entry->filepath, scan->options);
+        }
+        return import_path(dataset, entry->filepath, scan->options, NULL);
+    }
+
+    /* the dataset takes over the metadata */
+    entry->metadata = NULL;
+    if (scan->index != NULL && can_store_in_index(entry->filename) && can_store_in_index(metadata->source_product))
+    {
+        struct stat statbuf;
+
+        if (stat(entry->filepath, &statbuf) == 0)
+        {
+            if (dataset_index_set_entry(scan->index, entry->filename, (long)statbuf.st_mtime, (long)statbuf.st_size,
+                                        metadata) != 0)
+            {
+                harp_product_metadata_delete(metadata);
+                return -1;
+            }
+            scan->index->modified = 1;
+        }
+    }
+
+    return add_product(dataset, metadata->source_product, metadata, 0);
+}
+
+/* Add all files of a directory to the dataset (in the order in which they are listed).
+ * The directory is listed first, after which the metadata of the product files is retrieved using multiple threads
+ * (one file per thread at a time, see harp_set_option_num_threads()). The products are then added in order, such that
+ * the result does not depend on the number of threads.
+ */
 static int add_directory(harp_dataset *dataset, const char *pathname, const char *options)
 {
+    directory_scan scan;
+    dataset_index *index = NULL;
+    long i;
 #ifdef WIN32
     WIN32_FIND_DATA FileData;
     HANDLE hSearch;
     BOOL fFinished;
     char *pattern;
+#else
+    DIR *dirp = NULL;
+    struct dirent *dp = NULL;
+#endif
+
+    if (harp_option_enable_dataset_index)
+    {
+        if (dataset_index_new(pathname, &index) != 0)
+        {
+            return -1;
+        }
+        if (dataset_index_read(index, options) != 0)
+        {
+            dataset_index_delete(index);
+            return -1;
+        }
+    }
+
+    scan.pathname = pathname;
+    scan.options = options;
+    scan.index = index;
+    scan.num_entries = 0;
+    scan.entry = NULL;
 
+#ifdef WIN32
     pattern = malloc(strlen(pathname) + 4 + 1);
     if (pattern == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        (long)strlen(pathname) + 4 + 1, __FILE__, __LINE__);
+        if (index != NULL)
+        {
+            dataset_index_delete(index);
+        }
         return -1;
     }
     sprintf(pattern, "%s\\*.*", pathname);
@@ -146,6 +1090,10 @@ static int add_directory(harp_dataset *dataset, const char *pathname, const char
 
     if (hSearch == INVALID_HANDLE_VALUE)
     {
+        if (index != NULL)
+        {
+            dataset_index_delete(index);
+        }
         if (GetLastError() == ERROR_FILE_NOT_FOUND || GetLastError() == ERROR_NO_MORE_FILES)
         {
             /* no files found */
@@ -160,24 +1108,16 @@ static int add_directory(harp_dataset *dataset, const char *pathname, const char
     {
         if (!(FileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
         {
-            char *filepath;
-
-            filepath = malloc(strlen(pathname) + 1 + strlen(FileData.cFileName) + 1);
-            if (filepath == NULL)
+            if (directory_scan_add_entry(&scan, FileData.cFileName) != 0)
             {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (long)strlen(pathname) + 1 + strlen(FileData.cFileName) + 1, __FILE__, __LINE__);
                 FindClose(hSearch);
+                directory_scan_clear(&scan);
+                if (index != NULL)
+                {
+                    dataset_index_delete(index);
+                }
                 return -1;
             }
-            sprintf(filepath, "%s\\%s", pathname, FileData.cFileName);
-            if (harp_dataset_import(dataset, filepath, options) != 0)
-            {
-                free(filepath);
-                FindClose(hSearch);
-                return -1;
-            }
-            free(filepath);
         }
 
         if (!FindNextFile(hSearch, &FileData))
@@ -190,61 +1130,128 @@ static int add_directory(harp_dataset *dataset, const char *pathname, const char
             {
                 harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not retrieve directory entry");
                 FindClose(hSearch);
+                directory_scan_clear(&scan);
+                if (index != NULL)
+                {
+                    dataset_index_delete(index);
+                }
                 return -1;
             }
         }
     }
     FindClose(hSearch);
 #else
-    DIR *dirp = NULL;
-    struct dirent *dp = NULL;
-
     /* Open the directory */
     dirp = opendir(pathname);
 
     if (dirp == NULL)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not open directory %s", pathname);
+        if (index != NULL)
+        {
+            dataset_index_delete(index);
+        }
         return -1;
     }
 
     /* Walk through files in directory and add filenames to dataset */
     while ((dp = readdir(dirp)) != NULL)
     {
-        char *filepath = NULL;
-
         /* Skip '.' and '..' */
         if (strcmp(dp->d_name, ".") == 0 || strcmp(dp->d_name, "..") == 0)
         {
             continue;
         }
 
-        /* Add path before filename */
-        filepath = malloc(strlen(pathname) + 1 + strlen(dp->d_name) + 1);
-        if (filepath == NULL)
+        if (directory_scan_add_entry(&scan, dp->d_name) != 0)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                           (long)strlen(pathname) + 1 + strlen(dp->d_name) + 1, __FILE__, __LINE__);
             closedir(dirp);
+            directory_scan_clear(&scan);
+            if (index != NULL)
+            {
+                dataset_index_delete(index);
+            }
             return -1;
         }
-        sprintf(filepath, "%s/%s", pathname, dp->d_name);
+    }
+
+    closedir(dirp);
+#endif
 
-        if (harp_dataset_import(dataset, filepath, options) != 0)
+    if (harp_run_for_each(scan.num_entries, scan.num_entries, MIN_NUM_ENTRIES_PER_THREAD, scan_directory_entry,
+                          &scan) != 0)
+    {
+        directory_scan_clear(&scan);
+        if (index != NULL)
         {
-            free(filepath);
-            closedir(dirp);
+            dataset_index_delete(index);
+        }
+        return -1;
+    }
+    for (i = 0; i < scan.num_entries; i++)
+    {
+        if (add_directory_entry(dataset, &scan, &scan.entry[i]) != 0)
+        {
+            directory_scan_clear(&scan);
+            if (index != NULL)
+            {
+                dataset_index_delete(index);
+            }
             return -1;
         }
-        free(filepath);
     }
+    directory_scan_clear(&scan);
 
-    closedir(dirp);
-#endif
+    if (index != NULL)
+    {
+        dataset_index_write(index, options);
+        dataset_index_delete(index);
+    }
 
     return 0;
 }
 
+/* Import product metadata from a directory, .pth file, archive index file, or product file without sorting the dataset.
+ * If program is not NULL then products from archive index files that can not pass the leading filters of the program
+ * are skipped.
+ */
+static int import_path(harp_dataset *dataset, const char *path, const char *options, const harp_program *program)
+{
+    int result;
+
+    result = is_directory(path);
+    if (result == -1)
+    {
+        return -1;
+    }
+    if (result)
+    {
+        return add_directory(dataset, path, options);
+    }
+    else
+    {
+        harp_product_metadata *metadata = NULL;
+        long length = (long)strlen(path);
+
+        if (length > 4 && strcmp(&path[length - 4], ".pth") == 0)
+        {
+            return add_path_file(dataset, path, options, program);
+        }
+        if (is_archive_index(path))
+        {
+            return harp_archive_index_import(dataset, path, options, program);
+        }
+
+        /* Import the metadata */
+        if (harp_import_product_metadata(path, options, &metadata) != 0)
+        {
+            return -1;
+        }
+
+        return add_product(dataset, metadata->source_product, metadata, 0);
+    }
+}
+
 /** \addtogroup harp_dataset
  * @{
  */
@@ -352,15 +1359,21 @@ LIBHARP_API void harp_dataset_print(harp_dataset *dataset, int (*print) (const c
  * If path is a directory then all files (recursively) from that directory are added to the dataset.
  * If path references a .pth file then the file paths from that text file (one per line) are imported.
  * These file paths can be absolute or relative and can point to files, directories, or other .pth files.
+ * If path references an archive index file (with extension '.harpidx', see harp_dataset_write_archive_index()) then
+ * all products from the index are added, using the metadata stored in the index.
  * If path references a product file then that file is added to the dataset. Trying to add a file that is not supported
  * by HARP will result in an error.
+ * If the dataset index option is enabled (see harp_set_option_enable_dataset_index()) then the metadata of the files
+ * in a directory is cached in an index file within that directory, such that unchanged files do not need to be opened
+ * again when importing the same directory another time.
  *
  * Note that datasets cannot have multiple entries with the same 'source_product' value. Therefore, for each product
  * where the dataset already contained an entry with the same 'source_product' value, the metadata of that entry is
  * replaced with the new metadata (instead of adding a new entry to the dataset or raising an error).
  *
  * \param dataset Dataset into which to import the metadata.
- * \param path Path to either a directory containing product files, a .pth file, or a single product file.
+ * \param path Path to either a directory containing product files, a .pth file, an archive index file, or a single
+ * product file.
  * \param options Ingestion module specific options (optional); should be specified as a semi-colon separated
  * string of key=value pair; only used for product files that are not already in HARP format.
  * \return
@@ -371,33 +1384,14 @@ LIBHARP_API int harp_dataset_import(harp_dataset *dataset, const char *path, con
 {
     int result;
 
-    result = is_directory(path);
-    if (result == -1)
+    /* products are added in directory order; sort them once all products have been added */
+    result = import_path(dataset, path, options, NULL);
+    if (harp_dataset_sort_products(dataset) != 0)
     {
         return -1;
     }
-    if (result)
-    {
-        return add_directory(dataset, path, options);
-    }
-    else
-    {
-        harp_product_metadata *metadata = NULL;
-        long length = (long)strlen(path);
-
-        if (length > 4 && strcmp(&path[length - 4], ".pth") == 0)
-        {
-            return add_path_file(dataset, path, options);
-        }
-
-        /* Import the metadata */
-        if (harp_import_product_metadata(path, options, &metadata) != 0)
-        {
-            return -1;
-        }
 
-        return harp_dataset_add_product(dataset, metadata->source_product, metadata);
-    }
+    return result;
 }
 
 /** Lookup the index of source_product in the given dataset.
@@ -448,114 +1442,262 @@ LIBHARP_API int harp_dataset_has_product(harp_dataset *dataset, const char *sour
 LIBHARP_API int harp_dataset_add_product(harp_dataset *dataset, const char *source_product,
                                          harp_product_metadata *metadata)
 {
-    if (metadata != NULL && strcmp(metadata->source_product, source_product) != 0)
+    return add_product(dataset, source_product, metadata, 1);
+}
+
+/* Remove all products from the dataset for which new_index is negative and move the other products to the position
+ * given by new_index (this should keep their relative order); num_products is the number of remaining products.
+ * This takes ownership of new_index.
+ */
+static int compact_products(harp_dataset *dataset, long *new_index, long num_products)
+{
+    hashtable *product_to_index;
+    long num_sorted = 0;
+    long i;
+
+    if (num_products == dataset->num_products)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid source product '%s' in metadata, expected '%s'",
-                       metadata->source_product, source_product);
-        return -1;
+        free(new_index);
+        return 0;
     }
 
-    /* if source product does not already appear, add it */
-    if (!harp_dataset_has_product(dataset, source_product))
+    product_to_index = hashtable_new(0);
+    if (product_to_index == NULL)
     {
-        long index;
-        long i;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        free(new_index);
+        return -1;
+    }
 
-        /* Make space for new entry */
-        if (dataset->num_products % BLOCK_SIZE == 0)
+    /* compact the products (this keeps their relative order) */
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        if (new_index[i] < 0)
         {
-            char **new_source_product;
-            long *new_sorted_index;
-            harp_product_metadata **new_metadata;
-
-            /* grow the source_product array by one block */
-            new_source_product = realloc(dataset->source_product,
-                                         (dataset->num_products + BLOCK_SIZE) * sizeof(char **));
-            if (new_source_product == NULL)
+            free(dataset->source_product[i]);
+            harp_product_metadata_delete(dataset->metadata[i]);
+        }
+        else
+        {
+            dataset->source_product[new_index[i]] = dataset->source_product[i];
+            dataset->metadata[new_index[i]] = dataset->metadata[i];
+            if (hashtable_add_name(product_to_index, dataset->source_product[new_index[i]]) != 0)
             {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (dataset->num_products + BLOCK_SIZE) * sizeof(char **), __FILE__, __LINE__);
-                return -1;
+                assert(0);
+                exit(1);
             }
-            dataset->source_product = new_source_product;
+        }
+    }
+    for (i = num_products; i < dataset->num_products; i++)
+    {
+        dataset->source_product[i] = NULL;
+        dataset->metadata[i] = NULL;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        if (new_index[dataset->sorted_index[i]] >= 0)
+        {
+            dataset->sorted_index[num_sorted] = new_index[dataset->sorted_index[i]];
+            num_sorted++;
+        }
+    }
+    assert(num_sorted == num_products);
+    free(new_index);
 
-            new_sorted_index = realloc(dataset->sorted_index, (dataset->num_products + BLOCK_SIZE) * sizeof(long));
-            if (new_sorted_index == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (dataset->num_products + BLOCK_SIZE) * sizeof(long), __FILE__, __LINE__);
-                return -1;
-            }
-            dataset->sorted_index = new_sorted_index;
+    hashtable_delete(dataset->product_to_index);
+    dataset->product_to_index = product_to_index;
+    dataset->num_products = num_products;
 
-            new_metadata = realloc(dataset->metadata,
-                                   (dataset->num_products + BLOCK_SIZE) * sizeof(harp_product_metadata *));
-            if (new_metadata == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (dataset->num_products + BLOCK_SIZE) * sizeof(harp_product_metadata *), __FILE__,
-                               __LINE__);
-                return -1;
-            }
-            dataset->metadata = new_metadata;
+    return 0;
+}
 
-            /* zero-out metadata entries; as these are only optionally set in the future */
-            for (i = dataset->num_products; i < (dataset->num_products + BLOCK_SIZE); i++)
-            {
-                dataset->metadata[i] = NULL;
-            }
-        }
+/* Remove all products (that have metadata) that can not pass the leading filters of the program */
+static int prefilter_products(harp_dataset *dataset, const harp_program *program)
+{
+    long *new_index;
+    long num_products = 0;
+    long i;
 
-        /* add newly appended item into the list of sorted indices */
-        index = 0;
-        while (index < dataset->num_products &&
-               strcmp(source_product, dataset->source_product[dataset->sorted_index[index]]) > 0)
+    if (dataset->num_products == 0)
+    {
+        return 0;
+    }
+
+    new_index = malloc(dataset->num_products * sizeof(long));
+    if (new_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        harp_product_metadata *metadata = dataset->metadata[i];
+
+        if (metadata == NULL ||
+            (harp_program_datetime_range_can_pass(program, metadata->datetime_start, metadata->datetime_stop) &&
+             harp_program_spatial_extent_can_pass(program, metadata->latitude_min, metadata->latitude_max,
+                                                  metadata->longitude_min, metadata->longitude_max)))
         {
-            index++;
+            new_index[i] = num_products;
+            num_products++;
         }
-        for (i = dataset->num_products; i > index; i--)
+        else
         {
-            dataset->sorted_index[i] = dataset->sorted_index[i - 1];
+            new_index[i] = -1;
         }
-        dataset->sorted_index[index] = dataset->num_products;
+    }
 
-        dataset->num_products++;
+    return compact_products(dataset, new_index, num_products);
+}
 
-        dataset->source_product[dataset->num_products - 1] = strdup(source_product);
-        if (dataset->source_product[dataset->num_products - 1] == NULL)
-        {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (failed to duplicate string) (%s:%u)",
-                           __FILE__, __LINE__);
-            return -1;
-        }
+/** Remove all products from a dataset for which all samples would be removed by the given operations.
+ * This only uses the metadata of the products (no products are imported), such that the products that are not
+ * relevant for the operations can be skipped quickly. Currently only comparison and membership filters (with an
+ * explicit unit) that appear at the start of the operations (optionally preceded by keep() and exclude() operations)
+ * are used. Filters on the datetime, datetime_start, and datetime_stop variables are compared against the datetime
+ * range of each product and filters on the latitude, longitude, latitude_bounds, and longitude_bounds variables are
+ * compared against the spatial extent of each product (if known). Products for which the dataset holds no metadata
+ * are kept.
+ * \param dataset Dataset from which products should be removed.
+ * \param operations Operations that are going to be applied to each product of the dataset.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_dataset_prefilter(harp_dataset *dataset, const char *operations)
+{
+    harp_program *program;
+    int result;
 
-        if (hashtable_add_name(dataset->product_to_index, dataset->source_product[dataset->num_products - 1]) != 0)
-        {
-            assert(0);
-            exit(1);
-        }
+    if (dataset == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dataset is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (operations == NULL || dataset->num_products == 0)
+    {
+        return 0;
     }
 
-    if (metadata)
+    if (harp_program_from_string(operations, &program) != 0)
     {
-        long index;
+        return -1;
+    }
+    result = prefilter_products(dataset, program);
+    harp_program_delete(program);
 
-        if (harp_dataset_get_index_from_source_product(dataset, source_product, &index))
+    return result;
+}
+
+/** Import metadata for the products that can pass the leading filters of the given operations into the dataset.
+ * This gives the same result as harp_dataset_import() followed by harp_dataset_prefilter(), except that for archive
+ * index files (see harp_dataset_write_archive_index()) the spatio-temporal index is used to only retrieve the
+ * products that can pass the filters, which is much faster for indices that contain a large number of products.
+ * \param dataset Dataset into which to import the metadata.
+ * \param path Path to either a directory containing product files, a .pth file, an archive index file, or a single
+ * product file.
+ * \param options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used for product files that are not already in HARP format.
+ * \param operations Operations that are going to be applied to each product of the dataset (optional).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_dataset_import_with_prefilter(harp_dataset *dataset, const char *path, const char *options,
+                                                   const char *operations)
+{
+    harp_program *program = NULL;
+    int result;
+
+    if (dataset == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dataset is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (operations != NULL)
+    {
+        if (harp_program_from_string(operations, &program) != 0)
         {
             return -1;
         }
+    }
 
-        /* Delete existing metadata for this product */
-        if (dataset->metadata[index] != NULL)
+    result = import_path(dataset, path, options, program);
+    if (harp_dataset_sort_products(dataset) != 0)
+    {
+        result = -1;
+    }
+    if (result == 0 && program != NULL)
+    {
+        result = prefilter_products(dataset, program);
+    }
+    if (program != NULL)
+    {
+        harp_program_delete(program);
+    }
+
+    return result;
+}
+
+/** Remove all products from a dataset except for a range of products in sorted order.
+ * Products are sorted by their source_product value. This can be used to divide the processing of a dataset over
+ * several processes (e.g. the jobs of a cluster), where each process handles a disjoint range of products.
+ * \param dataset Dataset from which products should be removed.
+ * \param offset Position (in sorted order) of the first product that should be kept.
+ * \param length Number of products that should be kept (the range is truncated at the end of the dataset).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_dataset_keep_sorted_range(harp_dataset *dataset, long offset, long length)
+{
+    long *new_index;
+    long num_products = 0;
+    long i;
+
+    if (dataset == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dataset is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (offset < 0 || length < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid product range (offset %ld, length %ld) (%s:%u)", offset,
+                       length, __FILE__, __LINE__);
+        return -1;
+    }
+    if (dataset->num_products == 0)
+    {
+        return 0;
+    }
+
+    new_index = malloc(dataset->num_products * sizeof(long));
+    if (new_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        new_index[i] = -1;
+    }
+    for (i = offset; i < dataset->num_products && i - offset < length; i++)
+    {
+        new_index[dataset->sorted_index[i]] = 0;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        if (new_index[i] == 0)
         {
-            harp_product_metadata_delete(dataset->metadata[index]);
+            new_index[i] = num_products;
+            num_products++;
         }
-
-        /* Set the metadata for this source_product */
-        dataset->metadata[index] = metadata;
     }
 
-    return 0;
+    return compact_products(dataset, new_index, num_products);
 }
 
 /** @} */
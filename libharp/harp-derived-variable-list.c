@@ -32,6 +32,7 @@
 #include "harp-internal.h"
 #include "harp-constants.h"
 #include "harp-geometry.h"
+#include "harp-thread.h"
 
 #include "hashtable.h"
 
@@ -43,8 +44,13 @@
 
 #define MAX_NAME_LENGTH 128
 
+/* number of distinct profiles per quantity in the AFGL86 climatology (tropic, midlat/subarctic summer/winter) */
+#define MAX_NUM_AFGL86_PROFILES 5
+
 harp_derived_variable_list *harp_derived_variable_conversions = NULL;
 
+static harp_mutex derived_variable_list_mutex = HARP_MUTEX_INITIALIZER;
+
 static int get_air_from_dry_air_and_h2o(harp_variable *variable, const harp_variable **source_variable)
 {
     long i;
@@ -60,13 +66,8 @@ static int get_air_from_dry_air_and_h2o(harp_variable *variable, const harp_vari
 
 static int get_altitude_from_gph_and_latitude(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_altitude_from_gph_and_latitude(source_variable[0]->data.double_data[i],
-                                                                            source_variable[1]->data.double_data[i]);
-    }
+    harp_altitude_from_gph_and_latitude_array(variable->num_elements, source_variable[0]->data.double_data,
+                                              source_variable[1]->data.double_data, variable->data.double_data);
 
     return 0;
 }
@@ -74,19 +75,14 @@ static int get_altitude_from_gph_and_latitude(harp_variable *variable, const har
 static int get_altitude_from_pressure(harp_variable *variable, const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / length;
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_profile_altitude_from_pressure(length, &source_variable[0]->data.double_data[i * length],
-                                            &source_variable[1]->data.double_data[i * length],
-                                            &source_variable[2]->data.double_data[i * length],
-                                            source_variable[3]->data.double_data[i],
-                                            source_variable[4]->data.double_data[i],
-                                            source_variable[5]->data.double_data[i],
-                                            &variable->data.double_data[i * length]);
-    }
+    harp_profile_altitude_from_pressure_array(variable->num_elements / length, length,
+                                              source_variable[0]->data.double_data,
+                                              source_variable[1]->data.double_data,
+                                              source_variable[2]->data.double_data,
+                                              source_variable[3]->data.double_data,
+                                              source_variable[4]->data.double_data,
+                                              source_variable[5]->data.double_data, variable->data.double_data);
 
     return 0;
 }
@@ -113,30 +109,85 @@ static int get_area(harp_variable *variable, const harp_variable **source_variab
 
 static int get_aux_variable_afgl86(harp_variable *variable, const harp_variable **source_variable)
 {
+    long num_levels = variable->dimension[1];
+    harp_interpolation_weight *weight;
+    const double *target_grid = NULL;
+    const double *profile[MAX_NUM_AFGL86_PROFILES];
+    const double *result[MAX_NUM_AFGL86_PROFILES];
+    const double *altitude;
+    int num_levels_afgl86;
+    int num_profiles = 0;
     long i;
 
+    if (variable->dimension[0] == 0)
+    {
+        return 0;
+    }
+
+    /* the climatology profiles all share the same altitude grid */
+    if (harp_aux_afgl86_get_profile("altitude", source_variable[0]->data.double_data[0],
+                                    source_variable[1]->data.double_data[0], &num_levels_afgl86, &altitude) != 0)
+    {
+        return -1;
+    }
+
+    weight = malloc(num_levels * sizeof(harp_interpolation_weight));
+    if (weight == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_levels * sizeof(harp_interpolation_weight), __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* there are only a few distinct climatology profiles and target altitude grids are often the same for all
+     * samples, so the interpolation weights are only recalculated when the target grid changes, and the profile
+     * for a sample is copied from an earlier sample with the same target grid and climatology profile if possible */
     for (i = 0; i < variable->dimension[0]; i++)
     {
-        long num_levels = variable->dimension[1];
-        int num_levels_afgl86;
-        const double *altitude;
+        const double *sample_grid = &source_variable[2]->data.double_data[i * num_levels];
+        double *sample_result = &variable->data.double_data[i * num_levels];
         const double *values;
+        int k;
 
-        if (harp_aux_afgl86_get_profile("altitude", source_variable[0]->data.double_data[i],
-                                        source_variable[1]->data.double_data[i], &num_levels_afgl86, &altitude) != 0)
-        {
-            return -1;
-        }
         if (harp_aux_afgl86_get_profile(variable->name, source_variable[0]->data.double_data[i],
                                         source_variable[1]->data.double_data[i], &num_levels_afgl86, &values) != 0)
         {
+            free(weight);
             return -1;
         }
-        harp_interpolate_array_linear(num_levels_afgl86, altitude, values, num_levels,
-                                      &source_variable[2]->data.double_data[i * num_levels], 0,
-                                      &variable->data.double_data[i * num_levels]);
+
+        if (target_grid == NULL || memcmp(sample_grid, target_grid, num_levels * sizeof(double)) != 0)
+        {
+            harp_interpolate_weights_linear(num_levels_afgl86, altitude, num_levels, sample_grid, 0, weight);
+            target_grid = sample_grid;
+            num_profiles = 0;
+        }
+
+        for (k = 0; k < num_profiles; k++)
+        {
+            if (profile[k] == values)
+            {
+                break;
+            }
+        }
+        if (k < num_profiles)
+        {
+            memcpy(sample_result, result[k], num_levels * sizeof(double));
+        }
+        else
+        {
+            harp_interpolate_profiles_linear_with_weights(num_levels, weight, 1, values, sample_result);
+            if (num_profiles < MAX_NUM_AFGL86_PROFILES)
+            {
+                profile[num_profiles] = values;
+                result[num_profiles] = sample_result;
+                num_profiles++;
+            }
+        }
     }
 
+    free(weight);
+
     return 0;
 }
 
@@ -231,15 +282,42 @@ static int get_bounds_from_midpoints_log(harp_variable *variable, const harp_var
 static int get_column_from_partial_column(harp_variable *variable, const harp_variable **source_variable)
 {
     long num_levels;
-    long i;
 
     num_levels = source_variable[0]->dimension[source_variable[0]->num_dimensions - 1];
     assert(variable->num_elements == source_variable[0]->num_elements / num_levels);
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_profile_column_from_partial_column(num_levels, &source_variable[0]->data.double_data[i * num_levels]);
-    }
+    harp_profile_column_from_partial_column_array(variable->num_elements, num_levels,
+                                                  source_variable[0]->data.double_data, variable->data.double_data);
+
+    return 0;
+}
+
+static int get_stratospheric_column_from_partial_column(harp_variable *variable,
+                                                        const harp_variable **source_variable)
+{
+    long num_levels;
+
+    num_levels = source_variable[0]->dimension[source_variable[0]->num_dimensions - 1];
+    assert(variable->num_elements == source_variable[0]->num_elements / num_levels);
+    harp_profile_tropopause_columns_from_partial_column_array(variable->num_elements, num_levels,
+                                                              source_variable[0]->data.double_data,
+                                                              source_variable[1]->data.double_data,
+                                                              source_variable[2]->data.double_data, NULL,
+                                                              variable->data.double_data);
+
+    return 0;
+}
+
+static int get_tropospheric_column_from_partial_column(harp_variable *variable, const harp_variable **source_variable)
+{
+    long num_levels;
+
+    num_levels = source_variable[0]->dimension[source_variable[0]->num_dimensions - 1];
+    assert(variable->num_elements == source_variable[0]->num_elements / num_levels);
+    harp_profile_tropopause_columns_from_partial_column_array(variable->num_elements, num_levels,
+                                                              source_variable[0]->data.double_data,
+                                                              source_variable[1]->data.double_data,
+                                                              source_variable[2]->data.double_data,
+                                                              variable->data.double_data, NULL);
 
     return 0;
 }
@@ -278,30 +356,19 @@ static int get_copy(harp_variable *variable, const harp_variable **source_variab
 
 static int get_density_from_nd_for_air(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_mass_density_from_number_density(source_variable[0]->data.double_data[i],
-                                                  source_variable[1]->data.double_data[i]);
-    }
+    harp_mass_density_from_number_density_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                source_variable[1]->data.double_data, variable->data.double_data);
 
     return 0;
 }
 
 static int get_density_from_nd_for_species(harp_variable *variable, const harp_variable **source_variable)
 {
-    double molar_mass_species;
-    long i;
-
-    molar_mass_species = harp_molar_mass_for_species(harp_chemical_species_from_variable_name(variable->name));
+    harp_chemical_species species = harp_chemical_species_from_variable_name(variable->name);
 
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_mass_density_from_number_density(source_variable[0]->data.double_data[i], molar_mass_species);
-    }
+    harp_mass_density_from_number_density_for_species_array(variable->num_elements, species,
+                                                            source_variable[0]->data.double_data,
+                                                            variable->data.double_data);
 
     return 0;
 }
@@ -325,15 +392,11 @@ static int get_density_avk_from_partial_column_avk_and_alt_bounds(harp_variable
                                                                   const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / (length * length);
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_density_avk_from_partial_column_avk_and_altitude_bounds
-            (length, &source_variable[0]->data.double_data[i * length * length],
-             &source_variable[1]->data.double_data[i * length * 2], &variable->data.double_data[i * length * length]);
-    }
+    harp_density_avk_from_partial_column_avk_and_altitude_bounds(variable->num_elements / (length * length), length,
+                                                                 source_variable[0]->data.double_data,
+                                                                 source_variable[1]->data.double_data,
+                                                                 variable->data.double_data);
 
     return 0;
 }
@@ -375,12 +438,8 @@ static int get_dry_air_from_air_and_h2o(harp_variable *variable, const harp_vari
 
 static int get_elevation_angle_from_zenith_angle(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_elevation_angle_from_zenith_angle(source_variable[0]->data.double_data[i]);
-    }
+    harp_elevation_angle_from_zenith_angle_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                 variable->data.double_data);
 
     return 0;
 }
@@ -459,49 +518,32 @@ static int get_expanded_dimension(harp_variable *variable, const harp_variable *
 
 static int get_frequency_from_wavelength(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_frequency_from_wavelength(source_variable[0]->data.double_data[i]);
-    }
+    harp_frequency_from_wavelength_array(variable->num_elements, source_variable[0]->data.double_data,
+                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_frequency_from_wavenumber(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_frequency_from_wavenumber(source_variable[0]->data.double_data[i]);
-    }
+    harp_frequency_from_wavenumber_array(variable->num_elements, source_variable[0]->data.double_data,
+                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_geopotential_from_gph(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_geopotential_from_gph(source_variable[0]->data.double_data[i]);
-    }
+    harp_geopotential_from_gph_array(variable->num_elements, source_variable[0]->data.double_data,
+                                     variable->data.double_data);
 
     return 0;
 }
 
 static int get_gph_from_altitude_and_latitude(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_gph_from_altitude_and_latitude(source_variable[0]->data.double_data[i],
-                                                                            source_variable[1]->data.double_data[i]);
-    }
+    harp_gph_from_altitude_and_latitude_array(variable->num_elements, source_variable[0]->data.double_data,
+                                              source_variable[1]->data.double_data, variable->data.double_data);
 
     return 0;
 }
@@ -509,29 +551,19 @@ static int get_gph_from_altitude_and_latitude(harp_variable *variable, const har
 static int get_gph_from_pressure(harp_variable *variable, const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / length;
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_profile_gph_from_pressure(length, &source_variable[0]->data.double_data[i * length],
-                                       &source_variable[1]->data.double_data[i * length],
-                                       &source_variable[2]->data.double_data[i * length],
-                                       source_variable[3]->data.double_data[i], source_variable[4]->data.double_data[i],
-                                       &variable->data.double_data[i * length]);
-    }
+    harp_profile_gph_from_pressure_array(variable->num_elements / length, length, source_variable[0]->data.double_data,
+                                         source_variable[1]->data.double_data, source_variable[2]->data.double_data,
+                                         source_variable[3]->data.double_data, source_variable[4]->data.double_data,
+                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_gph_from_geopotential(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_gph_from_geopotential(source_variable[0]->data.double_data[i]);
-    }
+    harp_gph_from_geopotential_array(variable->num_elements, source_variable[0]->data.double_data,
+                                     variable->data.double_data);
 
     return 0;
 }
@@ -708,91 +740,57 @@ static int get_midpoint_from_bounds_log(harp_variable *variable, const harp_vari
 
 static int get_mmr_from_density(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_mass_mixing_ratio_from_density(source_variable[0]->data.double_data[i],
-                                                source_variable[1]->data.double_data[i]);
-    }
+    harp_mass_mixing_ratio_from_density_array(variable->num_elements, source_variable[0]->data.double_data,
+                                              source_variable[1]->data.double_data, variable->data.double_data);
 
     return 0;
 }
 
 static int get_mmr_from_vmr(harp_variable *variable, const harp_variable **source_variable)
 {
-    double molar_mass_species;
-    long i;
+    harp_chemical_species species = harp_chemical_species_from_variable_name(variable->name);
 
-    molar_mass_species = harp_molar_mass_for_species(harp_chemical_species_from_variable_name(variable->name));
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_mass_mixing_ratio_from_volume_mixing_ratio(source_variable[0]->data.double_data[i],
-                                                            molar_mass_species,
-                                                            source_variable[1]->data.double_data[i]);
-    }
+    harp_mass_mixing_ratio_from_volume_mixing_ratio_for_species_array(variable->num_elements, species,
+                                                                      source_variable[0]->data.double_data,
+                                                                      source_variable[1]->data.double_data,
+                                                                      variable->data.double_data);
 
     return 0;
 }
 
 static int get_mmr_from_vmr_dry(harp_variable *variable, const harp_variable **source_variable)
 {
-    double molar_mass_species;
-    double molar_mass_dry_air;
-    long i;
+    harp_chemical_species species = harp_chemical_species_from_variable_name(variable->name);
 
-    molar_mass_species = harp_molar_mass_for_species(harp_chemical_species_from_variable_name(variable->name));
-    molar_mass_dry_air = harp_molar_mass_for_species(harp_chemical_species_dry_air);
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_mass_mixing_ratio_from_volume_mixing_ratio(source_variable[0]->data.double_data[i],
-                                                            molar_mass_species, molar_mass_dry_air);
-    }
+    harp_mass_mixing_ratio_from_volume_mixing_ratio_for_species_array(variable->num_elements, species,
+                                                                      source_variable[0]->data.double_data, NULL,
+                                                                      variable->data.double_data);
 
     return 0;
 }
 
 static int get_molar_mass_from_density_and_nd(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_molar_mass_air_from_density_and_number_density(source_variable[0]->data.double_data[i],
-                                                                source_variable[1]->data.double_data[i]);
-    }
+    harp_molar_mass_air_from_density_and_number_density_array(variable->num_elements,
+                                                              source_variable[0]->data.double_data,
+                                                              source_variable[1]->data.double_data,
+                                                              variable->data.double_data);
 
     return 0;
 }
 
 static int get_molar_mass_from_h2o_mmr(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_molar_mass_air_from_h2o_mass_mixing_ratio(source_variable[0]->data.double_data[i]);
-    }
+    harp_molar_mass_air_from_h2o_mass_mixing_ratio_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_molar_mass_from_h2o_vmr(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_molar_mass_air_from_h2o_volume_mixing_ratio(source_variable[0]->data.double_data[i]);
-    }
+    harp_molar_mass_air_from_h2o_volume_mixing_ratio_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                           variable->data.double_data);
 
     return 0;
 }
@@ -827,30 +825,19 @@ static int get_month(harp_variable *variable, const harp_variable **source_varia
 
 static int get_nd_from_density_for_air(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_number_density_from_mass_density(source_variable[0]->data.double_data[i],
-                                                  source_variable[1]->data.double_data[i]);
-    }
+    harp_number_density_from_mass_density_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                source_variable[1]->data.double_data, variable->data.double_data);
 
     return 0;
 }
 
 static int get_nd_from_density_for_species(harp_variable *variable, const harp_variable **source_variable)
 {
-    double molar_mass_species;
-    long i;
+    harp_chemical_species species = harp_chemical_species_from_variable_name(variable->name);
 
-    molar_mass_species = harp_molar_mass_for_species(harp_chemical_species_from_variable_name(variable->name));
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_number_density_from_mass_density(source_variable[0]->data.double_data[i], molar_mass_species);
-    }
+    harp_number_density_from_mass_density_for_species_array(variable->num_elements, species,
+                                                            source_variable[0]->data.double_data,
+                                                            variable->data.double_data);
 
     return 0;
 }
@@ -858,28 +845,19 @@ static int get_nd_from_density_for_species(harp_variable *variable, const harp_v
 
 static int get_nd_from_pressure_and_temperature(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_number_density_from_pressure_and_temperature(source_variable[0]->data.double_data[i],
-                                                              source_variable[1]->data.double_data[i]);
-    }
+    harp_number_density_from_pressure_and_temperature_array(variable->num_elements,
+                                                            source_variable[0]->data.double_data,
+                                                            source_variable[1]->data.double_data,
+                                                            variable->data.double_data);
 
     return 0;
 }
 
 static int get_nd_from_vmr(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_number_density_from_volume_mixing_ratio(source_variable[0]->data.double_data[i],
-                                                         source_variable[1]->data.double_data[i]);
-    }
+    harp_number_density_from_volume_mixing_ratio_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                       source_variable[1]->data.double_data,
+                                                       variable->data.double_data);
 
     return 0;
 }
@@ -887,15 +865,9 @@ static int get_nd_from_vmr(harp_variable *variable, const harp_variable **source
 static int get_nd_column_avk_from_nd_avk(harp_variable *variable, const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / length;
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_profile_column_avk_from_partial_column_avk(length,
-                                                        &source_variable[0]->data.double_data[i * length * length],
-                                                        &variable->data.double_data[i * length]);
-    }
+    harp_profile_column_avk_from_partial_column_avk(variable->num_elements / length, length,
+                                                    source_variable[0]->data.double_data, variable->data.double_data);
 
     return 0;
 }
@@ -903,16 +875,11 @@ static int get_nd_column_avk_from_nd_avk(harp_variable *variable, const harp_var
 static int get_nd_avk_from_vmr_avk(harp_variable *variable, const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / (length * length);
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_number_density_avk_from_volume_mixing_ratio_avk(length,
-                                                             &source_variable[0]->data.double_data[i * length * length],
-                                                             &source_variable[1]->data.double_data[i * length],
-                                                             &variable->data.double_data[i * length * length]);
-    }
+    harp_number_density_avk_from_volume_mixing_ratio_avk(variable->num_elements / (length * length), length,
+                                                         source_variable[0]->data.double_data,
+                                                         source_variable[1]->data.double_data,
+                                                         variable->data.double_data);
 
     return 0;
 }
@@ -936,15 +903,11 @@ static int get_partial_column_avk_from_density_avk_and_alt_bounds(harp_variable
                                                                   const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / (length * length);
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_partial_column_avk_from_density_avk_and_altitude_bounds
-            (length, &source_variable[0]->data.double_data[i * length * length],
-             &source_variable[1]->data.double_data[i * length * 2], &variable->data.double_data[i * length * length]);
-    }
+    harp_partial_column_avk_from_density_avk_and_altitude_bounds(variable->num_elements / (length * length), length,
+                                                                 source_variable[0]->data.double_data,
+                                                                 source_variable[1]->data.double_data,
+                                                                 variable->data.double_data);
 
     return 0;
 }
@@ -990,14 +953,10 @@ static int get_partial_column_nd_from_vmr_dry_and_pressure_bounds(harp_variable
 
 static int get_partial_pressure_from_vmr_and_pressure(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_partial_pressure_from_volume_mixing_ratio_and_pressure(source_variable[0]->data.double_data[i],
-                                                                        source_variable[1]->data.double_data[i]);
-    }
+    harp_partial_pressure_from_volume_mixing_ratio_and_pressure_array(variable->num_elements,
+                                                                      source_variable[0]->data.double_data,
+                                                                      source_variable[1]->data.double_data,
+                                                                      variable->data.double_data);
 
     return 0;
 }
@@ -1005,19 +964,14 @@ static int get_partial_pressure_from_vmr_and_pressure(harp_variable *variable, c
 static int get_pressure_from_altitude(harp_variable *variable, const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / length;
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_profile_pressure_from_altitude(length, &source_variable[0]->data.double_data[i * length],
-                                            &source_variable[1]->data.double_data[i * length],
-                                            &source_variable[2]->data.double_data[i * length],
-                                            source_variable[3]->data.double_data[i],
-                                            source_variable[4]->data.double_data[i],
-                                            source_variable[5]->data.double_data[i],
-                                            &variable->data.double_data[i * length]);
-    }
+    harp_profile_pressure_from_altitude_array(variable->num_elements / length, length,
+                                              source_variable[0]->data.double_data,
+                                              source_variable[1]->data.double_data,
+                                              source_variable[2]->data.double_data,
+                                              source_variable[3]->data.double_data,
+                                              source_variable[4]->data.double_data,
+                                              source_variable[5]->data.double_data, variable->data.double_data);
 
     return 0;
 }
@@ -1025,31 +979,21 @@ static int get_pressure_from_altitude(harp_variable *variable, const harp_variab
 static int get_pressure_from_gph(harp_variable *variable, const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / length;
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_profile_pressure_from_gph(length, &source_variable[0]->data.double_data[i * length],
-                                       &source_variable[1]->data.double_data[i * length],
-                                       &source_variable[2]->data.double_data[i * length],
-                                       source_variable[3]->data.double_data[i], source_variable[4]->data.double_data[i],
-                                       &variable->data.double_data[i * length]);
-    }
+    harp_profile_pressure_from_gph_array(variable->num_elements / length, length, source_variable[0]->data.double_data,
+                                         source_variable[1]->data.double_data, source_variable[2]->data.double_data,
+                                         source_variable[3]->data.double_data, source_variable[4]->data.double_data,
+                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_pressure_from_nd_and_temperature(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_pressure_from_number_density_and_temperature(source_variable[0]->data.double_data[i],
-                                                              source_variable[1]->data.double_data[i]);
-    }
+    harp_pressure_from_number_density_and_temperature_array(variable->num_elements,
+                                                            source_variable[0]->data.double_data,
+                                                            source_variable[1]->data.double_data,
+                                                            variable->data.double_data);
 
     return 0;
 }
@@ -1058,14 +1002,10 @@ static int get_pressure_from_nd_and_temperature(harp_variable *variable, const h
 static int get_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(harp_variable *variable,
                                                                            const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(source_variable[0]->data.double_data[i],
-                                                                             source_variable[1]->data.double_data[i]);
-    }
+    harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles_array(variable->num_elements,
+                                                                           source_variable[0]->data.double_data,
+                                                                           source_variable[1]->data.double_data,
+                                                                           variable->data.double_data);
 
     return 0;
 }
@@ -1073,27 +1013,19 @@ static int get_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(harp_
 static int get_scattering_angle_from_sensor_and_solar_angles(harp_variable *variable,
                                                              const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_scattering_angle_from_sensor_and_solar_angles(source_variable[0]->data.double_data[i],
-                                                               source_variable[1]->data.double_data[i],
-                                                               source_variable[2]->data.double_data[i]);
-    }
+    harp_scattering_angle_from_sensor_and_solar_angles_array(variable->num_elements,
+                                                             source_variable[0]->data.double_data,
+                                                             source_variable[1]->data.double_data,
+                                                             source_variable[2]->data.double_data,
+                                                             variable->data.double_data);
 
     return 0;
 }
 
 static int get_sensor_angle_from_viewing_angle(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_sensor_angle_from_viewing_angle(source_variable[0]->data.double_data[i]);
-    }
+    harp_sensor_angle_from_viewing_angle_array(variable->num_elements, source_variable[0]->data.double_data,
+                                               variable->data.double_data);
 
     return 0;
 }
@@ -1101,29 +1033,20 @@ static int get_sensor_angle_from_viewing_angle(harp_variable *variable, const ha
 static int get_solar_azimuth_angle_from_latitude_and_solar_angles(harp_variable *variable,
                                                                   const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_solar_azimuth_angle_from_latitude_and_solar_angles(source_variable[0]->data.double_data[i],
-                                                                    source_variable[1]->data.double_data[i],
-                                                                    source_variable[2]->data.double_data[i],
-                                                                    source_variable[3]->data.double_data[i]);
-    }
+    harp_solar_azimuth_angle_from_latitude_and_solar_angles_array(variable->num_elements,
+                                                                  source_variable[0]->data.double_data,
+                                                                  source_variable[1]->data.double_data,
+                                                                  source_variable[2]->data.double_data,
+                                                                  source_variable[3]->data.double_data,
+                                                                  variable->data.double_data);
 
     return 0;
 }
 
 static int get_solar_declination_angle_from_datetime(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_solar_declination_angle_from_datetime(source_variable[0]->data.double_data[i]);
-    }
+    harp_solar_declination_angle_from_datetime_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                     variable->data.double_data);
 
     return 0;
 }
@@ -1131,14 +1054,10 @@ static int get_solar_declination_angle_from_datetime(harp_variable *variable, co
 static int get_solar_hour_angle_from_datetime_and_longitude(harp_variable *variable,
                                                             const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_solar_hour_angle_from_datetime_and_longitude(source_variable[0]->data.double_data[i],
-                                                              source_variable[1]->data.double_data[i]);
-    }
+    harp_solar_hour_angle_from_datetime_and_longitude_array(variable->num_elements,
+                                                            source_variable[0]->data.double_data,
+                                                            source_variable[1]->data.double_data,
+                                                            variable->data.double_data);
 
     return 0;
 }
@@ -1146,15 +1065,11 @@ static int get_solar_hour_angle_from_datetime_and_longitude(harp_variable *varia
 static int get_solar_zenith_angle_from_latitude_and_solar_angles(harp_variable *variable,
                                                                  const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_solar_zenith_angle_from_latitude_and_solar_angles(source_variable[0]->data.double_data[i],
-                                                                   source_variable[1]->data.double_data[i],
-                                                                   source_variable[2]->data.double_data[i]);
-    }
+    harp_solar_zenith_angle_from_latitude_and_solar_angles_array(variable->num_elements,
+                                                                 source_variable[0]->data.double_data,
+                                                                 source_variable[1]->data.double_data,
+                                                                 source_variable[2]->data.double_data,
+                                                                 variable->data.double_data);
 
     return 0;
 }
@@ -1182,31 +1097,20 @@ static int get_sqrt_trace_from_matrix(harp_variable *variable, const harp_variab
 
 static int get_temperature_from_nd_and_pressure(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_temperature_from_number_density_and_pressure(source_variable[0]->data.double_data[i],
-                                                              source_variable[1]->data.double_data[i]);
-    }
+    harp_temperature_from_number_density_and_pressure_array(variable->num_elements,
+                                                            source_variable[0]->data.double_data,
+                                                            source_variable[1]->data.double_data,
+                                                            variable->data.double_data);
 
     return 0;
 }
 
 static int get_temperature_from_virtual_temperature(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_temperature_from_virtual_temperature(source_variable[0]->data.double_data[i],
-                                                      source_variable[1]->data.double_data[i]);
-    }
+    harp_temperature_from_virtual_temperature_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                    source_variable[1]->data.double_data, variable->data.double_data);
 
     return 0;
-
 }
 
 static int get_tropopause_altitude_from_temperature(harp_variable *variable, const harp_variable **source_variable)
@@ -1280,12 +1184,8 @@ static int get_uncertainty_from_systematic_and_random_uncertainty(harp_variable
 
 static int get_viewing_angle_from_sensor_angle(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_viewing_angle_from_sensor_angle(source_variable[0]->data.double_data[i]);
-    }
+    harp_viewing_angle_from_sensor_angle_array(variable->num_elements, source_variable[0]->data.double_data,
+                                               variable->data.double_data);
 
     return 0;
 }
@@ -1313,66 +1213,40 @@ static int get_vertical_mid_point(harp_variable *variable, const harp_variable *
 
 static int get_virtual_temperature_from_temperature(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_virtual_temperature_from_temperature(source_variable[0]->data.double_data[i],
-                                                      source_variable[1]->data.double_data[i]);
-    }
+    harp_virtual_temperature_from_temperature_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                    source_variable[1]->data.double_data, variable->data.double_data);
 
     return 0;
-
 }
 
 static int get_vmr_from_mmr(harp_variable *variable, const harp_variable **source_variable)
 {
-    double molar_mass_species;
-    long i;
+    harp_chemical_species species = harp_chemical_species_from_variable_name(variable->name);
 
-    molar_mass_species = harp_molar_mass_for_species(harp_chemical_species_from_variable_name(variable->name));
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_volume_mixing_ratio_from_mass_mixing_ratio(source_variable[0]->data.double_data[i],
-                                                            molar_mass_species,
-                                                            source_variable[1]->data.double_data[i]);
-    }
+    harp_volume_mixing_ratio_from_mass_mixing_ratio_for_species_array(variable->num_elements, species,
+                                                                      source_variable[0]->data.double_data,
+                                                                      source_variable[1]->data.double_data,
+                                                                      variable->data.double_data);
 
     return 0;
 }
 
 static int get_vmr_from_mmr_dry(harp_variable *variable, const harp_variable **source_variable)
 {
-    double molar_mass_species;
-    double molar_mass_dry_air;
-    long i;
+    harp_chemical_species species = harp_chemical_species_from_variable_name(variable->name);
 
-    molar_mass_species = harp_molar_mass_for_species(harp_chemical_species_from_variable_name(variable->name));
-    molar_mass_dry_air = harp_molar_mass_for_species(harp_chemical_species_dry_air);
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_volume_mixing_ratio_from_mass_mixing_ratio(source_variable[0]->data.double_data[i],
-                                                            molar_mass_species, molar_mass_dry_air);
-    }
+    harp_volume_mixing_ratio_from_mass_mixing_ratio_for_species_array(variable->num_elements, species,
+                                                                      source_variable[0]->data.double_data, NULL,
+                                                                      variable->data.double_data);
 
     return 0;
 }
 
 static int get_vmr_from_nd(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_volume_mixing_ratio_from_number_density(source_variable[0]->data.double_data[i],
-                                                         source_variable[1]->data.double_data[i]);
-    }
+    harp_volume_mixing_ratio_from_number_density_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                       source_variable[1]->data.double_data,
+                                                       variable->data.double_data);
 
     return 0;
 }
@@ -1380,77 +1254,53 @@ static int get_vmr_from_nd(harp_variable *variable, const harp_variable **source
 static int get_vmr_avk_from_nd_avk(harp_variable *variable, const harp_variable **source_variable)
 {
     long length = variable->dimension[variable->num_dimensions - 1];
-    long num_profiles = variable->num_elements / (length * length);
-    long i;
 
-    for (i = 0; i < num_profiles; i++)
-    {
-        harp_volume_mixing_ratio_avk_from_number_density_avk(length,
-                                                             &source_variable[0]->data.double_data[i * length * length],
-                                                             &source_variable[1]->data.double_data[i * length],
-                                                             &variable->data.double_data[i * length * length]);
-    }
+    harp_volume_mixing_ratio_avk_from_number_density_avk(variable->num_elements / (length * length), length,
+                                                         source_variable[0]->data.double_data,
+                                                         source_variable[1]->data.double_data,
+                                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_vmr_from_partial_pressure_and_pressure(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
+    harp_volume_mixing_ratio_from_partial_pressure_and_pressure_array(variable->num_elements,
+                                                                      source_variable[0]->data.double_data,
+                                                                      source_variable[1]->data.double_data,
+                                                                      variable->data.double_data);
 
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] =
-            harp_volume_mixing_ratio_from_partial_pressure_and_pressure(source_variable[0]->data.double_data[i],
-                                                                        source_variable[1]->data.double_data[i]);
-    }
     return 0;
 }
 
 static int get_wavelength_from_frequency(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_wavelength_from_frequency(source_variable[0]->data.double_data[i]);
-    }
+    harp_wavelength_from_frequency_array(variable->num_elements, source_variable[0]->data.double_data,
+                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_wavelength_from_wavenumber(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_wavelength_from_wavenumber(source_variable[0]->data.double_data[i]);
-    }
+    harp_wavelength_from_wavenumber_array(variable->num_elements, source_variable[0]->data.double_data,
+                                          variable->data.double_data);
 
     return 0;
 }
 
 static int get_wavenumber_from_frequency(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_wavenumber_from_frequency(source_variable[0]->data.double_data[i]);
-    }
+    harp_wavenumber_from_frequency_array(variable->num_elements, source_variable[0]->data.double_data,
+                                         variable->data.double_data);
 
     return 0;
 }
 
 static int get_wavenumber_from_wavelength(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_wavenumber_from_wavelength(source_variable[0]->data.double_data[i]);
-    }
+    harp_wavenumber_from_wavelength_array(variable->num_elements, source_variable[0]->data.double_data,
+                                          variable->data.double_data);
 
     return 0;
 }
@@ -1557,12 +1407,8 @@ static int get_year(harp_variable *variable, const harp_variable **source_variab
 
 static int get_zenith_angle_from_elevation_angle(harp_variable *variable, const harp_variable **source_variable)
 {
-    long i;
-
-    for (i = 0; i < variable->num_elements; i++)
-    {
-        variable->data.double_data[i] = harp_zenith_angle_from_elevation_angle(source_variable[0]->data.double_data[i]);
-    }
+    harp_zenith_angle_from_elevation_angle_array(variable->num_elements, source_variable[0]->data.double_data,
+                                                 variable->data.double_data);
 
     return 0;
 }
@@ -1979,6 +1825,10 @@ static int add_dfs_from_avk_conversion(const char *variable_name, int num_dimens
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_dfs, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                             num_dimensions + 1, vertical_dimension_type, 0) != 0)
     {
@@ -2000,6 +1850,52 @@ static int add_dfs_from_avk_conversion(const char *variable_name, int num_dimens
     return 0;
 }
 
+/* tropospheric/stratospheric column from partial column profile, altitude bounds, and tropopause altitude */
+static int add_tropopause_column_conversion(const char *variable_name, const char *partial_column_name,
+                                            const char *unit, int num_dimensions,
+                                            harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS],
+                                            harp_conversion_function get_column)
+{
+    harp_variable_conversion *conversion;
+    harp_dimension_type vertical_dimension_type[HARP_MAX_NUM_DIMS];
+    int i;
+
+    assert(num_dimensions + 2 <= HARP_MAX_NUM_DIMS);
+    for (i = 0; i < num_dimensions; i++)
+    {
+        vertical_dimension_type[i] = dimension_type[i];
+    }
+    vertical_dimension_type[num_dimensions] = harp_dimension_vertical;
+    vertical_dimension_type[num_dimensions + 1] = harp_dimension_independent;
+
+    if (harp_variable_conversion_new(variable_name, harp_type_double, unit, num_dimensions, vertical_dimension_type, 0,
+                                     get_column, &conversion) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_conversion_add_source(conversion, partial_column_name, harp_type_double, unit,
+                                            num_dimensions + 1, vertical_dimension_type, 0) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_conversion_add_source(conversion, "altitude_bounds", harp_type_double, HARP_UNIT_LENGTH,
+                                            num_dimensions + 2, vertical_dimension_type, 2) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_conversion_add_source(conversion, "tropopause_altitude", harp_type_double, HARP_UNIT_LENGTH,
+                                            num_dimensions, vertical_dimension_type, 0) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
 static int add_species_conversions_for_grid(const char *species, int num_dimensions,
                                             harp_dimension_type target_dimension_type[HARP_MAX_NUM_DIMS],
                                             int has_vertical)
@@ -2124,6 +2020,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         dimension_type[num_dimensions] = harp_dimension_vertical;
         if (harp_variable_conversion_add_source(conversion, name_column_density, harp_type_double,
                                                 HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions + 1, dimension_type, 0)
@@ -2141,6 +2041,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_density, harp_type_double, HARP_UNIT_MASS_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -2159,6 +2063,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_nd, harp_type_double,
                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -2182,6 +2090,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_nd_apriori, harp_type_double,
                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -2216,6 +2128,14 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+
+        /* column from partial column profile, bounded by the tropopause */
+        if (add_tropopause_column_conversion(name_strato_column_density, name_column_density,
+                                             HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions, dimension_type,
+                                             get_stratospheric_column_from_partial_column) != 0)
+        {
+            return -1;
+        }
     }
 
     /*** stratospheric column (mass) density apriori ***/
@@ -2259,6 +2179,14 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+
+        /* column from partial column profile, bounded by the tropopause */
+        if (add_tropopause_column_conversion(name_tropo_column_density, name_column_density,
+                                             HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions, dimension_type,
+                                             get_tropospheric_column_from_partial_column) != 0)
+        {
+            return -1;
+        }
     }
 
     /*** tropospheric column (mass) density apriori ***/
@@ -2309,6 +2237,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         dimension_type[num_dimensions] = harp_dimension_vertical;
         if (harp_variable_conversion_add_source(conversion, name_column_nd, harp_type_double,
                                                 HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions + 1, dimension_type, 0)
@@ -2326,6 +2258,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_nd, harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -2344,6 +2280,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_density, harp_type_double,
                                             HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -2358,6 +2298,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -2387,6 +2331,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_dry, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -2422,6 +2370,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         dimension_type[num_dimensions] = harp_dimension_vertical;
         if (harp_variable_conversion_add_source(conversion, name_column_nd_apriori, harp_type_double,
                                                 HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions + 1, dimension_type, 0)
@@ -2439,6 +2391,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_nd_apriori, harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -2457,6 +2413,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_density_apriori, harp_type_double,
                                             HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -2471,6 +2431,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_apriori, harp_type_double,
                                             HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
     {
@@ -2500,6 +2464,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_dry_apriori, harp_type_double,
                                             HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
     {
@@ -2535,6 +2503,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_nd_avk, harp_type_double,
                                                 HARP_UNIT_DIMENSIONLESS, num_dimensions + 1, dimension_type, 0) != 0)
         {
@@ -2548,6 +2520,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_nd_avk, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                                 num_dimensions + 1, dimension_type, 0) != 0)
         {
@@ -2589,6 +2565,14 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+
+        /* column from partial column profile, bounded by the tropopause */
+        if (add_tropopause_column_conversion(name_strato_column_nd, name_column_nd,
+                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type,
+                                             get_stratospheric_column_from_partial_column) != 0)
+        {
+            return -1;
+        }
     }
 
     /*** stratospheric column number density apriori ***/
@@ -2632,6 +2616,14 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+
+        /* column from partial column profile, bounded by the tropopause */
+        if (add_tropopause_column_conversion(name_tropo_column_nd, name_column_nd,
+                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type,
+                                             get_tropospheric_column_from_partial_column) != 0)
+        {
+            return -1;
+        }
     }
 
     /*** tropospheric column number density apriori ***/
@@ -2698,6 +2690,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_vmr, harp_type_double,
                                                 HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -2762,6 +2758,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_vmr_dry, harp_type_double,
                                                 HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -2834,6 +2834,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_strato_column_vmr_dry, harp_type_double,
                                                 HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -2906,6 +2910,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_tropo_column_vmr_dry, harp_type_double,
                                                 HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -2948,6 +2956,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_nd, harp_type_double,
                                                 HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) !=
             0)
@@ -2967,6 +2979,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_mmr, harp_type_double,
                                                 HARP_UNIT_MASS_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -3014,6 +3030,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_nd, harp_type_double,
                                                 HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) !=
             0)
@@ -3033,6 +3053,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_mmr_dry, harp_type_double,
                                                 HARP_UNIT_MASS_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -3105,6 +3129,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_strato_column_mmr_dry, harp_type_double,
                                                 HARP_UNIT_MASS_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -3177,6 +3205,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_tropo_column_mmr_dry, harp_type_double,
                                                 HARP_UNIT_MASS_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
         {
@@ -3215,6 +3247,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_nd, harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3228,6 +3264,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_density, harp_type_double,
                                             HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3278,6 +3318,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3304,6 +3348,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_apriori, harp_type_double,
                                             HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3346,6 +3394,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_density, harp_type_double, HARP_UNIT_MASS_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3363,6 +3415,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_dry, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3384,6 +3440,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_dry_apriori, harp_type_double,
                                             HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3421,6 +3481,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_density, harp_type_double, HARP_UNIT_MASS_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3433,6 +3497,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3450,6 +3518,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_dry, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3468,6 +3540,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_nd, harp_type_double,
                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3495,6 +3571,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_apriori, harp_type_double,
                                             HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3512,6 +3592,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_dry_apriori, harp_type_double,
                                             HARP_UNIT_VOLUME_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3530,6 +3614,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_nd_apriori, harp_type_double,
                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3561,6 +3649,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_vmr_avk, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                                 num_dimensions + 1, dimension_type, 0) != 0)
         {
@@ -3579,6 +3671,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_vmr_dry_avk, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                                 num_dimensions + 1, dimension_type, 0) != 0)
         {
@@ -3597,6 +3693,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_column_nd_avk, harp_type_double,
                                                 HARP_UNIT_DIMENSIONLESS, num_dimensions + 1, dimension_type, 0) != 0)
         {
@@ -3641,6 +3741,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3658,6 +3762,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_vmr_dry, harp_type_double, HARP_UNIT_VOLUME_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3690,6 +3798,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_nd, harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3707,6 +3819,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_mmr, harp_type_double, HARP_UNIT_MASS_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3724,6 +3840,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_pp, harp_type_double, HARP_UNIT_PRESSURE, num_dimensions,
                                             dimension_type, 0) != 0)
     {
@@ -3750,6 +3870,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_nd_apriori, harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3767,6 +3891,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_mmr_apriori, harp_type_double, HARP_UNIT_MASS_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3797,6 +3925,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_nd_avk, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                                 num_dimensions + 1, dimension_type, 0) != 0)
         {
@@ -3840,6 +3972,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_nd, harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3857,6 +3993,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_mmr_dry, harp_type_double, HARP_UNIT_MASS_MIXING_RATIO,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3869,6 +4009,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_pp, harp_type_double, HARP_UNIT_PRESSURE,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3896,6 +4040,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_nd_apriori, harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -3913,6 +4061,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_mmr_dry_apriori, harp_type_double,
                                             HARP_UNIT_MASS_MIXING_RATIO, num_dimensions, dimension_type, 0) != 0)
     {
@@ -3938,6 +4090,10 @@ static int add_species_conversions_for_grid(const char *species, int num_dimensi
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, name_nd_avk, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                                 num_dimensions + 1, dimension_type, 0) != 0)
         {
@@ -4014,6 +4170,10 @@ static int add_particulate_matter_conversions_for_grid(const char *pm, int num_d
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         dimension_type[num_dimensions] = harp_dimension_vertical;
         if (harp_variable_conversion_add_source(conversion, name_column_density, harp_type_double,
                                                 HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions + 1, dimension_type, 0)
@@ -4031,6 +4191,10 @@ static int add_particulate_matter_conversions_for_grid(const char *pm, int num_d
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_density, harp_type_double, HARP_UNIT_MASS_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -4060,6 +4224,14 @@ static int add_particulate_matter_conversions_for_grid(const char *pm, int num_d
         {
             return -1;
         }
+
+        /* column from partial column profile, bounded by the tropopause */
+        if (add_tropopause_column_conversion(name_strato_column_density, name_column_density,
+                                             HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions, dimension_type,
+                                             get_stratospheric_column_from_partial_column) != 0)
+        {
+            return -1;
+        }
     }
 
     /*** tropospheric column (mass) density ***/
@@ -4080,6 +4252,14 @@ static int add_particulate_matter_conversions_for_grid(const char *pm, int num_d
         {
             return -1;
         }
+
+        /* column from partial column profile, bounded by the tropopause */
+        if (add_tropopause_column_conversion(name_tropo_column_density, name_column_density,
+                                             HARP_UNIT_COLUMN_MASS_DENSITY, num_dimensions, dimension_type,
+                                             get_tropospheric_column_from_partial_column) != 0)
+        {
+            return -1;
+        }
     }
 
     /*** (mass) density ***/
@@ -4104,6 +4284,10 @@ static int add_particulate_matter_conversions_for_grid(const char *pm, int num_d
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, name_column_density, harp_type_double,
                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -4158,6 +4342,10 @@ static int add_aerosol_conversions_for_grid(int num_dimensions, harp_dimension_t
             {
                 return -1;
             }
+            if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+            {
+                return -1;
+            }
             if (harp_variable_conversion_add_source(conversion, name_aod, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                                     num_dimensions, dimension_type, 0) != 0)
             {
@@ -4203,6 +4391,10 @@ static int add_aerosol_conversions_for_grid(int num_dimensions, harp_dimension_t
             {
                 return -1;
             }
+            if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+            {
+                return -1;
+            }
             dimension_type[num_dimensions] = harp_dimension_vertical;
             if (harp_variable_conversion_add_source(conversion, name_aod, harp_type_double, HARP_UNIT_DIMENSIONLESS,
                                                     num_dimensions + 1, dimension_type, 0) != 0)
@@ -4220,6 +4412,10 @@ static int add_aerosol_conversions_for_grid(int num_dimensions, harp_dimension_t
             {
                 return -1;
             }
+            if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+            {
+                return -1;
+            }
             if (harp_variable_conversion_add_source
                 (conversion, name_ext, harp_type_double, HARP_UNIT_AEROSOL_EXTINCTION, num_dimensions, dimension_type,
                  0) != 0)
@@ -4341,6 +4537,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "geopotential_height", harp_type_double, HARP_UNIT_LENGTH,
                                                 num_dimensions, dimension_type, 0) != 0)
         {
@@ -4361,6 +4561,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "pressure", harp_type_double, HARP_UNIT_PRESSURE,
                                                 num_dimensions, dimension_type, 0) != 0)
         {
@@ -4566,6 +4770,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         dimension_type[num_dimensions] = harp_dimension_vertical;
         if (harp_variable_conversion_add_source(conversion, "column_number_density", harp_type_double,
                                                 HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions + 1, dimension_type, 0)
@@ -4582,6 +4790,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, "number_density", harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -4711,6 +4923,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, "column_density", harp_type_double,
                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -4830,6 +5046,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "altitude", harp_type_double, HARP_UNIT_LENGTH,
                                                 num_dimensions, dimension_type, 0) != 0)
         {
@@ -4965,6 +5185,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, "pressure", harp_type_double, HARP_UNIT_PRESSURE,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -4983,6 +5207,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, "column_number_density", harp_type_double,
                                             HARP_UNIT_COLUMN_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
     {
@@ -5061,6 +5289,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, "number_density", harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -5080,6 +5312,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_time_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "altitude", harp_type_double, HARP_UNIT_LENGTH,
                                                 num_dimensions, dimension_type, 0) != 0)
         {
@@ -5239,6 +5475,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "surface_geopotential_height", harp_type_double,
                                                 HARP_UNIT_LENGTH, num_dimensions, dimension_type, 0) != 0)
         {
@@ -5268,6 +5508,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "surface_number_density", harp_type_double,
                                                 HARP_UNIT_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
         {
@@ -5336,6 +5580,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "surface_altitude", harp_type_double, HARP_UNIT_LENGTH,
                                                 num_dimensions, dimension_type, 0) != 0)
         {
@@ -5374,6 +5622,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "surface_pressure", harp_type_double, HARP_UNIT_PRESSURE,
                                                 num_dimensions, dimension_type, 0) != 0)
         {
@@ -5410,6 +5662,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
         {
             return -1;
         }
+        if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+        {
+            return -1;
+        }
         if (harp_variable_conversion_add_source(conversion, "surface_number_density", harp_type_double,
                                                 HARP_UNIT_NUMBER_DENSITY, num_dimensions, dimension_type, 0) != 0)
         {
@@ -5443,6 +5699,10 @@ static int add_conversions_for_grid(int num_dimensions, harp_dimension_type dime
     {
         return -1;
     }
+    if (harp_variable_conversion_set_parallelism(conversion, harp_conversion_element_parallel) != 0)
+    {
+        return -1;
+    }
     if (harp_variable_conversion_add_source(conversion, "number_density", harp_type_double, HARP_UNIT_NUMBER_DENSITY,
                                             num_dimensions, dimension_type, 0) != 0)
     {
@@ -7046,7 +7306,7 @@ int harp_derived_variable_list_sort(void)
     return 0;
 }
 
-int harp_derived_variable_list_init(void)
+static int derived_variable_list_init(void)
 {
     assert(harp_derived_variable_conversions == NULL);
     harp_derived_variable_conversions = malloc(sizeof(harp_derived_variable_list));
@@ -7148,8 +7408,30 @@ int harp_derived_variable_list_add_conversion(harp_variable_conversion *conversi
     return 0;
 }
 
+/* Initialize the list of derived variable conversions if this was not done yet.
+ * The list is only built on first use (e.g. the first harp_product_get_derived_variable() call), since building it is
+ * a significant part of the startup time of short running programs that never derive variables.
+ * This function can be called from multiple threads at the same time.
+ */
+int harp_derived_variable_list_init(void)
+{
+    int result = 0;
+
+    harp_mutex_lock(&derived_variable_list_mutex);
+    if (harp_derived_variable_conversions == NULL)
+    {
+        result = derived_variable_list_init();
+    }
+    harp_mutex_unlock(&derived_variable_list_mutex);
+
+    return result;
+}
+
 void harp_derived_variable_list_done(void)
 {
+    /* cached derivation plans refer to the conversions, so remove them first */
+    harp_derived_variable_plan_cache_done();
+
     if (harp_derived_variable_conversions != NULL)
     {
         if (harp_derived_variable_conversions->hash_data != NULL)
@@ -30,6 +30,7 @@
  */
 
 #include "harp-internal.h"
+#include "harp-thread.h"
 
 #include "hashtable.h"
 
@@ -38,6 +39,62 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* maximum number of derivation plans that will be kept in the cache */
+#define MAX_NUM_CACHED_PLANS 1024
+
+/* minimum number of elements of a derived variable that each thread should calculate */
+#define MIN_NUM_ELEMENTS_PER_THREAD 65536
+
+/* A derivation plan contains the chain of conversions that was used to derive a variable.
+ * For each source variable of the conversion there is either a plan to derive that source variable or NULL if the
+ * source variable was taken directly from the product.
+ */
+typedef struct derivation_plan_struct
+{
+    const harp_variable_conversion *conversion;
+    struct derivation_plan_struct *source_plan[MAX_NUM_SOURCE_VARIABLES];
+} derivation_plan;
+
+/* The plan cache maps a key (the target variable together with the layout of the product) to a derivation plan.
+ * Since the search for a conversion only depends on the names and dimensions of the variables in the product (and on
+ * the options that enable/disable conversions), any product with the same layout can use the cached plan directly.
+ * Plans are never removed from the cache (until harp_derived_variable_plan_cache_done() is called), such that a plan
+ * can be used without holding the lock.
+ */
+typedef struct derivation_plan_cache_struct
+{
+    int num_plans;
+    char **key;
+    derivation_plan **plan;
+    hashtable *hash_data;
+} derivation_plan_cache;
+
+static harp_mutex plan_cache_mutex = HARP_MUTEX_INITIALIZER;
+static derivation_plan_cache *plan_cache = NULL;
+
+/* A derivation session keeps the intermediate (source) variables that were derived for a product, such that later
+ * derivations on the same (unchanged) product can reuse them instead of deriving them again.
+ * Each variable is stored under its dimsvar_name and the unit in which it was requested, together with the plan that
+ * was used to derive it. A cached variable is not reused if its plan derives one of the variables that is
+ * currently being derived (since the search would then have had to choose a different conversion).
+ * If the derivations that will be performed are registered up front (see harp_derivation_session_add_target()), the
+ * session knows how often each intermediate variable is needed and releases it after its last use.
+ * A session is only used by the thread that entered it, and only for derivations from the product of the session.
+ */
+struct harp_derivation_session_struct
+{
+    const harp_product *product;
+    int num_variables;
+    char **key;
+    harp_variable **variable;   /* NULL if the variable was not derived yet (or is no longer needed) */
+    derivation_plan **plan;
+    long *num_uses;     /* number of remaining planned uses of the variable (-1 if unknown) */
+    hashtable *hash_data;
+    struct harp_derivation_session_struct *previous;    /* session that was active when this one was entered */
+};
+
+static HARP_THREAD_LOCAL harp_derivation_session *current_session = NULL;
+
 typedef struct conversion_info_struct
 {
     const harp_product *product;
@@ -50,6 +107,8 @@ typedef struct conversion_info_struct
     int depth;
     int max_depth;
     harp_variable *variable;
+    const derivation_plan *plan;        /* plan that should be executed (if NULL, a conversion will be searched) */
+    derivation_plan *new_plan;  /* plan of the conversions that were performed during a search */
 } conversion_info;
 
 static int find_and_execute_conversion(conversion_info *info);
@@ -96,6 +155,28 @@ static int has_dimension_types(const harp_variable *variable, int num_dimensions
     return 1;
 }
 
+static char get_dimension_type_code(harp_dimension_type dimension_type)
+{
+    switch (dimension_type)
+    {
+        case harp_dimension_independent:
+            return 'I';
+        case harp_dimension_time:
+            return 'T';
+        case harp_dimension_latitude:
+            return 'A';
+        case harp_dimension_longitude:
+            return 'O';
+        case harp_dimension_vertical:
+            return 'V';
+        case harp_dimension_spectral:
+            return 'S';
+    }
+
+    assert(0);
+    exit(1);
+}
+
 static char *get_dimsvar_name(const char *variable_name, int num_dimensions, const harp_dimension_type *dimension_type)
 {
     char *dimsvar_name;
@@ -113,30 +194,7 @@ static char *get_dimsvar_name(const char *variable_name, int num_dimensions, con
 
     for (i = 0; i < num_dimensions; i++)
     {
-        switch (dimension_type[i])
-        {
-            case harp_dimension_independent:
-                dimsvar_name[i] = 'I';
-                break;
-            case harp_dimension_time:
-                dimsvar_name[i] = 'T';
-                break;
-            case harp_dimension_latitude:
-                dimsvar_name[i] = 'A';
-                break;
-            case harp_dimension_longitude:
-                dimsvar_name[i] = 'O';
-                break;
-            case harp_dimension_vertical:
-                dimsvar_name[i] = 'V';
-                break;
-            case harp_dimension_spectral:
-                dimsvar_name[i] = 'S';
-                break;
-            default:
-                assert(0);
-                exit(1);
-        }
+        dimsvar_name[i] = get_dimension_type_code(dimension_type[i]);
     }
     for (i = num_dimensions; i < HARP_MAX_NUM_DIMS; i++)
     {
@@ -147,6 +205,544 @@ static char *get_dimsvar_name(const char *variable_name, int num_dimensions, con
     return dimsvar_name;
 }
 
+static derivation_plan *derivation_plan_new(const harp_variable_conversion *conversion)
+{
+    derivation_plan *plan;
+    int i;
+
+    plan = (derivation_plan *)malloc(sizeof(derivation_plan));
+    if (plan == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(derivation_plan), __FILE__, __LINE__);
+        return NULL;
+    }
+    plan->conversion = conversion;
+    for (i = 0; i < MAX_NUM_SOURCE_VARIABLES; i++)
+    {
+        plan->source_plan[i] = NULL;
+    }
+
+    return plan;
+}
+
+static void derivation_plan_delete(derivation_plan *plan)
+{
+    if (plan != NULL)
+    {
+        int i;
+
+        for (i = 0; i < plan->conversion->num_source_variables; i++)
+        {
+            derivation_plan_delete(plan->source_plan[i]);
+        }
+        free(plan);
+    }
+}
+
+static derivation_plan *derivation_plan_copy(const derivation_plan *plan)
+{
+    derivation_plan *new_plan;
+    int i;
+
+    new_plan = derivation_plan_new(plan->conversion);
+    if (new_plan == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0; i < plan->conversion->num_source_variables; i++)
+    {
+        if (plan->source_plan[i] != NULL)
+        {
+            new_plan->source_plan[i] = derivation_plan_copy(plan->source_plan[i]);
+            if (new_plan->source_plan[i] == NULL)
+            {
+                derivation_plan_delete(new_plan);
+                return NULL;
+            }
+        }
+    }
+
+    return new_plan;
+}
+
+/* Create the key for the plan cache.
+ * The key consists of the dimsvar_name of the target variable, the options that influence which conversions are
+ * enabled, and the name, dimension types and length of independent dimensions of each variable in the product.
+ */
+static char *get_plan_key(const harp_product *product, const char *dimsvar_name)
+{
+    char *key;
+    long length;
+    long offset;
+    int i, j;
+
+    length = strlen(dimsvar_name) + 4;
+    for (i = 0; i < product->num_variables; i++)
+    {
+        length += strlen(product->variable[i]->name) + 2 + product->variable[i]->num_dimensions * 22;
+    }
+
+    key = malloc(length);
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", length,
+                       __FILE__, __LINE__);
+        return NULL;
+    }
+
+    offset = sprintf(key, "%s;%d%d;", dimsvar_name, harp_get_option_enable_aux_afgl86(),
+                     harp_get_option_enable_aux_usstd76());
+    for (i = 0; i < product->num_variables; i++)
+    {
+        const harp_variable *variable = product->variable[i];
+
+        offset += sprintf(&key[offset], "%s:", variable->name);
+        for (j = 0; j < variable->num_dimensions; j++)
+        {
+            key[offset++] = get_dimension_type_code(variable->dimension_type[j]);
+            if (variable->dimension_type[j] == harp_dimension_independent)
+            {
+                offset += sprintf(&key[offset], "%ld,", variable->dimension[j]);
+            }
+        }
+        key[offset++] = ';';
+    }
+    key[offset] = '\0';
+
+    return key;
+}
+
+static const derivation_plan *find_cached_plan(const char *key)
+{
+    const derivation_plan *plan = NULL;
+
+    harp_mutex_lock(&plan_cache_mutex);
+    if (plan_cache != NULL)
+    {
+        long index;
+
+        index = hashtable_get_index_from_name(plan_cache->hash_data, key);
+        if (index >= 0)
+        {
+            plan = plan_cache->plan[index];
+        }
+    }
+    harp_mutex_unlock(&plan_cache_mutex);
+
+    return plan;
+}
+
+/* Add the plan to the cache; the cache takes ownership of both key and plan (also in case of an error) */
+static int add_cached_plan(char *key, derivation_plan *plan)
+{
+    harp_mutex_lock(&plan_cache_mutex);
+
+    if (plan_cache == NULL)
+    {
+        plan_cache = (derivation_plan_cache *)malloc(sizeof(derivation_plan_cache));
+        if (plan_cache == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(derivation_plan_cache), __FILE__, __LINE__);
+            harp_mutex_unlock(&plan_cache_mutex);
+            free(key);
+            derivation_plan_delete(plan);
+            return -1;
+        }
+        plan_cache->num_plans = 0;
+        plan_cache->key = NULL;
+        plan_cache->plan = NULL;
+        plan_cache->hash_data = hashtable_new(1);
+        if (plan_cache->hash_data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                           __LINE__);
+            free(plan_cache);
+            plan_cache = NULL;
+            harp_mutex_unlock(&plan_cache_mutex);
+            free(key);
+            derivation_plan_delete(plan);
+            return -1;
+        }
+    }
+
+    if (plan_cache->num_plans == MAX_NUM_CACHED_PLANS ||
+        hashtable_get_index_from_name(plan_cache->hash_data, key) >= 0)
+    {
+        /* cache is full or the plan was already added by another thread */
+        harp_mutex_unlock(&plan_cache_mutex);
+        free(key);
+        derivation_plan_delete(plan);
+        return 0;
+    }
+
+    if (plan_cache->num_plans % BLOCK_SIZE == 0)
+    {
+        char **new_key;
+        derivation_plan **new_plan;
+
+        new_key = realloc(plan_cache->key, (plan_cache->num_plans + BLOCK_SIZE) * sizeof(char *));
+        if (new_key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (plan_cache->num_plans + BLOCK_SIZE) * sizeof(char *), __FILE__, __LINE__);
+            harp_mutex_unlock(&plan_cache_mutex);
+            free(key);
+            derivation_plan_delete(plan);
+            return -1;
+        }
+        plan_cache->key = new_key;
+        new_plan = realloc(plan_cache->plan, (plan_cache->num_plans + BLOCK_SIZE) * sizeof(derivation_plan *));
+        if (new_plan == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (plan_cache->num_plans + BLOCK_SIZE) * sizeof(derivation_plan *), __FILE__, __LINE__);
+            harp_mutex_unlock(&plan_cache_mutex);
+            free(key);
+            derivation_plan_delete(plan);
+            return -1;
+        }
+        plan_cache->plan = new_plan;
+    }
+
+    plan_cache->key[plan_cache->num_plans] = key;
+    plan_cache->plan[plan_cache->num_plans] = plan;
+    if (hashtable_add_name(plan_cache->hash_data, key) != 0)
+    {
+        /* should not happen since we checked for existence above */
+        assert(0);
+        exit(1);
+    }
+    plan_cache->num_plans++;
+
+    harp_mutex_unlock(&plan_cache_mutex);
+
+    return 0;
+}
+
+/* Remove all plans from the cache (the plans refer to the conversions in harp_derived_variable_conversions, so this
+ * should be called before the list of conversions is removed).
+ */
+void harp_derived_variable_plan_cache_done(void)
+{
+    harp_mutex_lock(&plan_cache_mutex);
+    if (plan_cache != NULL)
+    {
+        int i;
+
+        for (i = 0; i < plan_cache->num_plans; i++)
+        {
+            free(plan_cache->key[i]);
+            derivation_plan_delete(plan_cache->plan[i]);
+        }
+        if (plan_cache->key != NULL)
+        {
+            free(plan_cache->key);
+        }
+        if (plan_cache->plan != NULL)
+        {
+            free(plan_cache->plan);
+        }
+        hashtable_delete(plan_cache->hash_data);
+        free(plan_cache);
+        plan_cache = NULL;
+    }
+    harp_mutex_unlock(&plan_cache_mutex);
+}
+
+static void derivation_session_remove_variables(harp_derivation_session *session)
+{
+    int i;
+
+    for (i = 0; i < session->num_variables; i++)
+    {
+        free(session->key[i]);
+        harp_variable_delete(session->variable[i]);
+        derivation_plan_delete(session->plan[i]);
+    }
+    if (session->key != NULL)
+    {
+        free(session->key);
+        session->key = NULL;
+    }
+    if (session->variable != NULL)
+    {
+        free(session->variable);
+        session->variable = NULL;
+    }
+    if (session->plan != NULL)
+    {
+        free(session->plan);
+        session->plan = NULL;
+    }
+    if (session->num_uses != NULL)
+    {
+        free(session->num_uses);
+        session->num_uses = NULL;
+    }
+    session->num_variables = 0;
+    if (session->hash_data != NULL)
+    {
+        hashtable_delete(session->hash_data);
+        session->hash_data = NULL;
+    }
+}
+
+/* Create the key of a variable in the session; variables are identified by their dimsvar_name and (requested) unit */
+static char *get_session_key(const char *dimsvar_name, const char *unit)
+{
+    long length;
+    char *key;
+
+    length = strlen(dimsvar_name) + (unit != NULL ? strlen(unit) : 0) + 3;
+    key = malloc(length);
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", length,
+                       __FILE__, __LINE__);
+        return NULL;
+    }
+    sprintf(key, "%s[%s]", dimsvar_name, unit != NULL ? unit : "");
+
+    return key;
+}
+
+/* Return the index of the entry with the given key, adding an (empty) entry if the key is not yet in the session.
+ * The session takes ownership of the key (also in case of an error). Returns -1 on error.
+ */
+static long derivation_session_get_entry(harp_derivation_session *session, char *key)
+{
+    long index;
+
+    if (session->hash_data == NULL)
+    {
+        session->hash_data = hashtable_new(1);
+        if (session->hash_data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                           __LINE__);
+            free(key);
+            return -1;
+        }
+    }
+
+    index = hashtable_get_index_from_name(session->hash_data, key);
+    if (index >= 0)
+    {
+        free(key);
+        return index;
+    }
+
+    if (session->num_variables % BLOCK_SIZE == 0)
+    {
+        char **new_key;
+        harp_variable **new_variable;
+        derivation_plan **new_plan;
+        long *new_num_uses;
+
+        new_key = realloc(session->key, (session->num_variables + BLOCK_SIZE) * sizeof(char *));
+        if (new_key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (session->num_variables + BLOCK_SIZE) * sizeof(char *), __FILE__, __LINE__);
+            free(key);
+            return -1;
+        }
+        session->key = new_key;
+        new_variable = realloc(session->variable, (session->num_variables + BLOCK_SIZE) * sizeof(harp_variable *));
+        if (new_variable == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (session->num_variables + BLOCK_SIZE) * sizeof(harp_variable *), __FILE__, __LINE__);
+            free(key);
+            return -1;
+        }
+        session->variable = new_variable;
+        new_plan = realloc(session->plan, (session->num_variables + BLOCK_SIZE) * sizeof(derivation_plan *));
+        if (new_plan == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (session->num_variables + BLOCK_SIZE) * sizeof(derivation_plan *), __FILE__, __LINE__);
+            free(key);
+            return -1;
+        }
+        session->plan = new_plan;
+        new_num_uses = realloc(session->num_uses, (session->num_variables + BLOCK_SIZE) * sizeof(long));
+        if (new_num_uses == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (session->num_variables + BLOCK_SIZE) * sizeof(long), __FILE__, __LINE__);
+            free(key);
+            return -1;
+        }
+        session->num_uses = new_num_uses;
+    }
+
+    index = session->num_variables;
+    session->key[index] = key;
+    session->variable[index] = NULL;
+    session->plan[index] = NULL;
+    session->num_uses[index] = -1;
+    if (hashtable_add_name(session->hash_data, key) != 0)
+    {
+        /* should not happen since we checked for existence above */
+        assert(0);
+        exit(1);
+    }
+    session->num_variables++;
+
+    return index;
+}
+
+/* Store a (copy-on-write) copy of the variable and a copy of its plan in the entry of the session */
+static int derivation_session_set_variable(harp_derivation_session *session, long index, const harp_variable *variable,
+                                           const derivation_plan *plan)
+{
+    assert(session->variable[index] == NULL);
+
+    if (session->plan[index] != NULL)
+    {
+        derivation_plan_delete(session->plan[index]);
+    }
+    session->plan[index] = derivation_plan_copy(plan);
+    if (session->plan[index] == NULL)
+    {
+        return -1;
+    }
+    if (harp_variable_copy_shared(variable, &session->variable[index]) != 0)
+    {
+        session->variable[index] = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Register a use of the variable in the entry; the variable is released once all its planned uses have been done */
+static void derivation_session_use_variable(harp_derivation_session *session, long index)
+{
+    if (session->num_uses[index] < 0)
+    {
+        return;
+    }
+    if (session->num_uses[index] > 0)
+    {
+        session->num_uses[index]--;
+    }
+    if (session->num_uses[index] == 0 && session->variable[index] != NULL)
+    {
+        harp_variable_delete(session->variable[index]);
+        session->variable[index] = NULL;
+    }
+}
+
+/* Add the uses of intermediate variables by the plan to the planned number of uses. This follows the order in which
+ * perform_conversion() derives the source variables: only the first use of a variable actually derives it (and uses
+ * its own sources), later uses take it from the session.
+ */
+static int derivation_session_add_planned_uses(harp_derivation_session *session, const derivation_plan *plan)
+{
+    int i;
+
+    for (i = 0; i < plan->conversion->num_source_variables; i++)
+    {
+        const harp_source_variable_definition *source_definition = &plan->conversion->source_definition[i];
+        char *key;
+        long index;
+
+        if (plan->source_plan[i] == NULL)
+        {
+            /* source variable is taken from the product */
+            continue;
+        }
+
+        key = get_session_key(source_definition->dimsvar_name, source_definition->unit);
+        if (key == NULL)
+        {
+            return -1;
+        }
+        index = derivation_session_get_entry(session, key);
+        if (index < 0)
+        {
+            return -1;
+        }
+        if (session->num_uses[index] < 0)
+        {
+            session->num_uses[index] = 0;
+        }
+        session->num_uses[index]++;
+        if (session->num_uses[index] == 1 && session->variable[index] == NULL)
+        {
+            if (derivation_session_add_planned_uses(session, plan->source_plan[i]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Create a session for reusing intermediate derived variables of the given product.
+ * The session is only used while it is entered (see harp_derivation_session_enter()). Since the session does not
+ * detect modifications of the product, harp_derivation_session_clear() should be called whenever the product changes.
+ */
+int harp_derivation_session_new(const harp_product *product, harp_derivation_session **new_session)
+{
+    harp_derivation_session *session;
+
+    session = (harp_derivation_session *)malloc(sizeof(harp_derivation_session));
+    if (session == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_derivation_session), __FILE__, __LINE__);
+        return -1;
+    }
+    session->product = product;
+    session->num_variables = 0;
+    session->key = NULL;
+    session->variable = NULL;
+    session->plan = NULL;
+    session->num_uses = NULL;
+    session->hash_data = NULL;
+    session->previous = NULL;
+
+    *new_session = session;
+
+    return 0;
+}
+
+/* Make the session the active session of the calling thread (until harp_derivation_session_leave() is called) */
+void harp_derivation_session_enter(harp_derivation_session *session)
+{
+    session->previous = current_session;
+    current_session = session;
+}
+
+void harp_derivation_session_leave(harp_derivation_session *session)
+{
+    assert(current_session == session);
+
+    current_session = session->previous;
+    session->previous = NULL;
+}
+
+/* Remove all cached variables from the session (should be called when the product of the session was modified) */
+void harp_derivation_session_clear(harp_derivation_session *session)
+{
+    derivation_session_remove_variables(session);
+}
+
+void harp_derivation_session_delete(harp_derivation_session *session)
+{
+    if (session != NULL)
+    {
+        derivation_session_remove_variables(session);
+        free(session);
+    }
+}
+
 static int conversion_info_init(conversion_info *info, const harp_product *product)
 {
     info->product = product;
@@ -158,6 +754,8 @@ static int conversion_info_init(conversion_info *info, const harp_product *produ
     info->depth = 0;
     info->max_depth = 10;
     info->variable = NULL;
+    info->plan = NULL;
+    info->new_plan = NULL;
 
     info->skip = malloc(harp_derived_variable_conversions->num_variables);
     if (info->skip == NULL)
@@ -224,47 +822,146 @@ static void conversion_info_done(conversion_info *info)
     {
         harp_variable_delete(info->variable);
     }
+    derivation_plan_delete(info->new_plan);
+}
+
+static int create_variable(conversion_info *info)
+{
+    const harp_variable_conversion *conversion = info->conversion;
+    long dimension[HARP_MAX_NUM_DIMS];
+    harp_variable *variable = NULL;
+    int i;
+
+    for (i = 0; i < conversion->num_dimensions; i++)
+    {
+        if (conversion->dimension_type[i] == harp_dimension_independent)
+        {
+            dimension[i] = conversion->independent_dimension_length;
+        }
+        else
+        {
+            dimension[i] = info->product->dimension[conversion->dimension_type[i]];
+        }
+    }
+
+    if (harp_variable_new(conversion->variable_name, conversion->data_type, conversion->num_dimensions,
+                          conversion->dimension_type, dimension, &variable) != 0)
+    {
+        return -1;
+    }
+
+    /* Set unit */
+    if (conversion->unit != NULL)
+    {
+        variable->unit = strdup(conversion->unit);
+        if (variable->unit == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+
+    info->variable = variable;
+
+    return 0;
+}
+
+/* Returns whether the plan derives one of the variables that are currently being derived (i.e. for which the entry in
+ * 'skip' is 1). Reusing such a variable would introduce a cycle in the derivation.
+ */
+static int plan_uses_skipped_variable(const derivation_plan *plan, const uint8_t *skip)
+{
+    long index;
+    int i;
+
+    index = hashtable_get_index_from_name(harp_derived_variable_conversions->hash_data, plan->conversion->dimsvar_name);
+    if (index >= 0 && skip[index] == 1)
+    {
+        return 1;
+    }
+    for (i = 0; i < plan->conversion->num_source_variables; i++)
+    {
+        if (plan->source_plan[i] != NULL && plan_uses_skipped_variable(plan->source_plan[i], skip))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
 }
 
-static int create_variable(conversion_info *info)
+/* Derive a source variable (and convert it to the given unit), reusing the result of an earlier derivation in the
+ * active derivation session (if any).
+ */
+static int find_and_execute_source_conversion(conversion_info *info, const char *unit)
 {
-    const harp_variable_conversion *conversion = info->conversion;
-    long dimension[HARP_MAX_NUM_DIMS];
-    harp_variable *variable = NULL;
-    int i;
+    harp_derivation_session *session = current_session;
+    long index = -1;
 
-    for (i = 0; i < conversion->num_dimensions; i++)
+    if (session != NULL && session->product == info->product)
     {
-        if (conversion->dimension_type[i] == harp_dimension_independent)
+        char *key;
+
+        key = get_session_key(info->dimsvar_name, unit);
+        if (key == NULL)
         {
-            dimension[i] = conversion->independent_dimension_length;
+            return -1;
         }
-        else
+        index = derivation_session_get_entry(session, key);
+        if (index < 0)
         {
-            dimension[i] = info->product->dimension[conversion->dimension_type[i]];
+            return -1;
+        }
+        if (session->variable[index] != NULL)
+        {
+            if (!plan_uses_skipped_variable(session->plan[index], info->skip))
+            {
+                if (harp_variable_copy_shared(session->variable[index], &info->variable) != 0)
+                {
+                    info->variable = NULL;
+                    return -1;
+                }
+                if (info->plan == NULL)
+                {
+                    /* the parent conversion is building a plan, so provide the plan for this variable */
+                    info->new_plan = derivation_plan_copy(session->plan[index]);
+                    if (info->new_plan == NULL)
+                    {
+                        return -1;
+                    }
+                }
+                derivation_session_use_variable(session, index);
+                return 0;
+            }
+            /* the cached variable can not be used in this context, so derive it without the session */
+            index = -1;
         }
     }
 
-    if (harp_variable_new(conversion->variable_name, conversion->data_type, conversion->num_dimensions,
-                          conversion->dimension_type, dimension, &variable) != 0)
+    if (find_and_execute_conversion(info) != 0)
     {
         return -1;
     }
 
-    /* Set unit */
-    if (conversion->unit != NULL)
+    if (unit != NULL)
     {
-        variable->unit = strdup(conversion->unit);
-        if (variable->unit == NULL)
+        if (harp_variable_convert_unit(info->variable, unit) != 0)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                           __LINE__);
-            harp_variable_delete(variable);
             return -1;
         }
     }
 
-    info->variable = variable;
+    if (index >= 0)
+    {
+        if (derivation_session_set_variable(session, index, info->variable,
+                                            info->plan != NULL ? info->plan : info->new_plan) != 0)
+        {
+            return -1;
+        }
+        derivation_session_use_variable(session, index);
+    }
 
     return 0;
 }
@@ -316,22 +1013,163 @@ static int get_source_variable(conversion_info *info, harp_data_type data_type,
 
     *is_temp = 1;
 
-    if (find_and_execute_conversion(info) != 0)
+    return find_and_execute_source_conversion(info, unit);
+}
+
+/* A part of a parallel conversion (a range of time samples or elements) that is calculated by a single task */
+typedef struct conversion_task_struct
+{
+    const harp_variable_conversion *conversion;
+    harp_variable *variable;
+    const harp_variable **source_variable;
+    long first;
+    long end;
+} conversion_task;
+
+/* Initialize 'part' as a view on the range [first, end) of the time samples (time parallel) or of the elements
+ * (element parallel) of the variable. The view borrows the data of the variable.
+ */
+static void get_variable_part(const harp_variable *variable, harp_conversion_parallelism parallelism, long first,
+                              long end, harp_variable *part)
+{
+    long block_size = 1;
+
+    *part = *variable;
+    if (parallelism == harp_conversion_time_parallel)
     {
-        return -1;
+        block_size = variable->num_elements / variable->dimension[0];
+    }
+    else
+    {
+        part->num_dimensions = 1;
+        part->dimension_type[0] = harp_dimension_independent;
     }
+    part->dimension[0] = end - first;
+    part->num_elements = (end - first) * block_size;
+    part->num_allocated_elements = part->num_elements;
+    part->data.ptr = (char *)variable->data.ptr + first * block_size * harp_get_size_for_type(variable->data_type);
+    part->borrowed_data = 1;
+    part->shared_data = NULL;
+}
 
-    if (unit != NULL)
+static int conversion_task_run(void *arg)
+{
+    conversion_task *task = (conversion_task *)arg;
+    const harp_variable_conversion *conversion = task->conversion;
+    harp_variable source_part[MAX_NUM_SOURCE_VARIABLES];
+    const harp_variable *source_variable[MAX_NUM_SOURCE_VARIABLES];
+    harp_variable part;
+    int i;
+
+    get_variable_part(task->variable, conversion->parallelism, task->first, task->end, &part);
+    for (i = 0; i < conversion->num_source_variables; i++)
     {
-        if (harp_variable_convert_unit(info->variable, unit) != 0)
-        {
-            return -1;
-        }
+        get_variable_part(task->source_variable[i], conversion->parallelism, task->first, task->end, &source_part[i]);
+        source_variable[i] = &source_part[i];
+    }
+
+    return conversion->set_variable_data(&part, source_variable);
+}
+
+/* Determine the number of time samples (time parallel) or elements (element parallel) over which the conversion
+ * can be split. Returns 0 if the conversion has to be performed in one go.
+ */
+static long get_num_parallel_items(const harp_variable_conversion *conversion, const harp_variable *variable,
+                                   const harp_variable **source_variable)
+{
+    long length;
+    int i;
+
+    switch (conversion->parallelism)
+    {
+        case harp_conversion_element_parallel:
+            length = variable->num_elements;
+            for (i = 0; i < conversion->num_source_variables; i++)
+            {
+                if (source_variable[i]->num_elements != length)
+                {
+                    return 0;
+                }
+            }
+            return length;
+        case harp_conversion_time_parallel:
+            if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+            {
+                return 0;
+            }
+            length = variable->dimension[0];
+            for (i = 0; i < conversion->num_source_variables; i++)
+            {
+                if (source_variable[i]->num_dimensions == 0 ||
+                    source_variable[i]->dimension_type[0] != harp_dimension_time ||
+                    source_variable[i]->dimension[0] != length)
+                {
+                    return 0;
+                }
+            }
+            return length;
+        case harp_conversion_sequential:
+            break;
     }
 
     return 0;
 }
 
+/* Calculate the data of the variable, splitting the work over multiple threads if the conversion allows it */
+static int run_conversion_function(const harp_variable_conversion *conversion, harp_variable *variable,
+                                   const harp_variable **source_variable)
+{
+    conversion_task *conversion_task_list;
+    harp_task *task;
+    long num_items;
+    int num_tasks;
+    int result;
+    int i;
+
+    num_items = get_num_parallel_items(conversion, variable, source_variable);
+    num_tasks = harp_get_num_tasks(variable->num_elements, MIN_NUM_ELEMENTS_PER_THREAD);
+    if (num_tasks > num_items)
+    {
+        num_tasks = (int)num_items;
+    }
+    if (num_tasks <= 1)
+    {
+        return conversion->set_variable_data(variable, source_variable);
+    }
+
+    conversion_task_list = malloc(num_tasks * sizeof(conversion_task));
+    if (conversion_task_list == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(conversion_task), __FILE__, __LINE__);
+        return -1;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        free(conversion_task_list);
+        return -1;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        conversion_task_list[i].conversion = conversion;
+        conversion_task_list[i].variable = variable;
+        conversion_task_list[i].source_variable = source_variable;
+        conversion_task_list[i].first = num_items * i / num_tasks;
+        conversion_task_list[i].end = num_items * (i + 1) / num_tasks;
+        task[i].function = conversion_task_run;
+        task[i].arg = &conversion_task_list[i];
+    }
+    result = harp_run_tasks(num_tasks, task);
+
+    free(task);
+    free(conversion_task_list);
+
+    return result;
+}
+
 static int perform_conversion(conversion_info *info)
 {
     harp_variable *source_variable[MAX_NUM_SOURCE_VARIABLES];
@@ -339,6 +1177,16 @@ static int perform_conversion(conversion_info *info)
     int result;
     int i, j;
 
+    if (info->plan == NULL)
+    {
+        /* keep track of the performed conversions such that they can be stored as a plan */
+        info->new_plan = derivation_plan_new(info->conversion);
+        if (info->new_plan == NULL)
+        {
+            return -1;
+        }
+    }
+
     for (i = 0; i < info->conversion->num_source_variables; i++)
     {
         conversion_info source_info;
@@ -352,6 +1200,10 @@ static int perform_conversion(conversion_info *info)
         }
         memcpy(source_info.skip, info->skip, harp_derived_variable_conversions->num_variables);
         source_info.depth = info->depth + 1;
+        if (info->plan != NULL)
+        {
+            source_info.plan = info->plan->source_plan[i];
+        }
 
         if (get_source_variable(&source_info, source_definition->data_type, source_definition->unit, &is_temp[i]) != 0)
         {
@@ -362,17 +1214,23 @@ static int perform_conversion(conversion_info *info)
                     harp_variable_delete(source_variable[j]);
                 }
             }
+            conversion_info_done(&source_info);
             return -1;
         }
         source_variable[i] = source_info.variable;
         source_info.variable = NULL;
+        if (info->new_plan != NULL)
+        {
+            info->new_plan->source_plan[i] = source_info.new_plan;
+            source_info.new_plan = NULL;
+        }
         conversion_info_done(&source_info);
     }
 
     result = create_variable(info);
     if (result == 0)
     {
-        result = info->conversion->set_variable_data(info->variable, (const harp_variable **)source_variable);
+        result = run_conversion_function(info->conversion, info->variable, (const harp_variable **)source_variable);
         /* TODO: set description of variable based on the applied conversion
          * e.g. <target_var_name> from (<source_var_name> from ...), (<source_var_2_name> from ...)
          */
@@ -495,15 +1353,18 @@ static int find_source_variables(conversion_info *info, harp_source_variable_def
     return 1 + has_cycle;
 }
 
-static int find_and_execute_conversion(conversion_info *info)
+/* Search for a conversion that can create the variable. On success info->conversion is set and the variable is
+ * marked as being derived (info->skip[*index] is 1); the caller should reset this mark once the conversion is done.
+ */
+static int find_conversion(conversion_info *info, int *index)
 {
-    int index;
+    int variable_index;
 
-    index = hashtable_get_index_from_name(harp_derived_variable_conversions->hash_data, info->dimsvar_name);
-    if (index >= 0)
+    variable_index = hashtable_get_index_from_name(harp_derived_variable_conversions->hash_data, info->dimsvar_name);
+    if (variable_index >= 0)
     {
         harp_variable_conversion_list *conversion_list =
-            harp_derived_variable_conversions->conversions_for_variable[index];
+            harp_derived_variable_conversions->conversions_for_variable[variable_index];
         int i;
 
         for (i = 0; i < conversion_list->num_conversions; i++)
@@ -515,7 +1376,7 @@ static int find_and_execute_conversion(conversion_info *info)
             {
                 continue;
             }
-            if (info->skip[index])
+            if (info->skip[variable_index])
             {
                 continue;
             }
@@ -537,7 +1398,7 @@ static int find_and_execute_conversion(conversion_info *info)
                 continue;
             }
 
-            info->skip[index] = 1;
+            info->skip[variable_index] = 1;
 
             for (j = 0; j < conversion->num_source_variables; j++)
             {
@@ -553,16 +1414,13 @@ static int find_and_execute_conversion(conversion_info *info)
 
             if (j == conversion->num_source_variables)
             {
-                int result;
-
                 /* conversion should be possible */
                 info->conversion = conversion;
-                result = perform_conversion(info);
-                info->skip[index] = 0;
-                return result;
+                *index = variable_index;
+                return 0;
             }
 
-            info->skip[index] = 0;
+            info->skip[variable_index] = 0;
         }
     }
 
@@ -570,6 +1428,131 @@ static int find_and_execute_conversion(conversion_info *info)
     return -1;
 }
 
+static int find_and_execute_conversion(conversion_info *info)
+{
+    int result;
+    int index;
+
+    if (info->plan != NULL)
+    {
+        /* use the conversion from the plan instead of searching for one; the variable is marked as being derived
+         * (just as with a search), such that a derivation session makes the same decisions for both cases */
+        index = hashtable_get_index_from_name(harp_derived_variable_conversions->hash_data, info->dimsvar_name);
+        assert(index >= 0);
+        info->conversion = info->plan->conversion;
+    }
+    else if (find_conversion(info, &index) != 0)
+    {
+        return -1;
+    }
+
+    info->skip[index] = 1;
+    result = perform_conversion(info);
+    info->skip[index] = 0;
+
+    return result;
+}
+
+/* Determine the plan for deriving the variable (stored in info->new_plan) without performing any of the conversions.
+ * This follows the same search as find_and_execute_conversion() and perform_conversion().
+ */
+static int find_conversion_plan(conversion_info *info)
+{
+    int index;
+    int i;
+
+    if (find_conversion(info, &index) != 0)
+    {
+        return -1;
+    }
+
+    info->new_plan = derivation_plan_new(info->conversion);
+    if (info->new_plan == NULL)
+    {
+        info->skip[index] = 0;
+        return -1;
+    }
+
+    for (i = 0; i < info->conversion->num_source_variables; i++)
+    {
+        conversion_info source_info;
+        harp_source_variable_definition *source_definition = &info->conversion->source_definition[i];
+        harp_variable *variable;
+
+        if (harp_product_get_variable_by_name(info->product, source_definition->variable_name, &variable) == 0 &&
+            harp_variable_has_dimension_types(variable, source_definition->num_dimensions,
+                                              source_definition->dimension_type))
+        {
+            /* the source variable is taken directly from the product */
+            continue;
+        }
+
+        if (conversion_info_init_with_variable(&source_info, info->product, source_definition->variable_name,
+                                               source_definition->num_dimensions, source_definition->dimension_type) !=
+            0)
+        {
+            conversion_info_done(&source_info);
+            info->skip[index] = 0;
+            return -1;
+        }
+        memcpy(source_info.skip, info->skip, harp_derived_variable_conversions->num_variables);
+        source_info.depth = info->depth + 1;
+
+        if (find_conversion_plan(&source_info) != 0)
+        {
+            conversion_info_done(&source_info);
+            info->skip[index] = 0;
+            return -1;
+        }
+        info->new_plan->source_plan[i] = source_info.new_plan;
+        source_info.new_plan = NULL;
+        conversion_info_done(&source_info);
+    }
+
+    info->skip[index] = 0;
+
+    return 0;
+}
+
+/* Register that the variable will be derived from the product of the session while the session is entered.
+ * The derivation is planned up front, such that the session knows how often each intermediate variable is needed and
+ * can release it after its last use. The targets should be registered in the order in which they will be derived.
+ * Returns an error if the variable can not be derived.
+ */
+int harp_derivation_session_add_target(harp_derivation_session *session, const char *name, int num_dimensions,
+                                       const harp_dimension_type *dimension_type)
+{
+    conversion_info info;
+    harp_variable *variable;
+    int result;
+
+    if (harp_product_get_variable_by_name(session->product, name, &variable) == 0 &&
+        harp_variable_has_dimension_types(variable, num_dimensions, dimension_type))
+    {
+        /* variable is taken directly from the product */
+        return 0;
+    }
+
+    if (harp_derived_variable_list_init() != 0)
+    {
+        return -1;
+    }
+    if (conversion_info_init_with_variable(&info, session->product, name, num_dimensions, dimension_type) != 0)
+    {
+        conversion_info_done(&info);
+        return -1;
+    }
+    if (find_conversion_plan(&info) != 0)
+    {
+        conversion_info_done(&info);
+        return -1;
+    }
+    result = derivation_session_add_planned_uses(session, info.new_plan);
+    conversion_info_done(&info);
+
+    return result;
+}
+
 static void print_conversion(conversion_info *info, int (*print) (const char *, ...));
 
 static int find_and_print_conversion(conversion_info *info, int (*print) (const char *, ...))
@@ -860,6 +1843,7 @@ int harp_variable_conversion_new(const char *variable_name, harp_data_type data_
     conversion->source_description = NULL;
     conversion->set_variable_data = set_variable_data;
     conversion->enabled = NULL;
+    conversion->parallelism = harp_conversion_sequential;
 
     conversion->dimsvar_name = get_dimsvar_name(variable_name, num_dimensions, dimension_type);
     if (conversion->dimsvar_name == NULL)
@@ -956,6 +1940,16 @@ int harp_variable_conversion_set_enabled_function(harp_variable_conversion *conv
     return 0;
 }
 
+int harp_variable_conversion_set_parallelism(harp_variable_conversion *conversion,
+                                              harp_conversion_parallelism parallelism)
+{
+    assert(conversion->parallelism == harp_conversion_sequential);
+
+    conversion->parallelism = parallelism;
+
+    return 0;
+}
+
 int harp_variable_conversion_set_source_description(harp_variable_conversion *conversion, const char *description)
 {
     assert(conversion->source_description == NULL);
@@ -993,12 +1987,9 @@ LIBHARP_API int harp_doc_list_conversions(const harp_product *product, const cha
     conversion_info info;
     int i, j;
 
-    if (harp_derived_variable_conversions == NULL)
+    if (harp_derived_variable_list_init() != 0)
     {
-        if (harp_derived_variable_list_init() != 0)
-        {
-            return -1;
-        }
+        return -1;
     }
 
     if (product == NULL)
@@ -1146,6 +2137,7 @@ LIBHARP_API int harp_product_get_derived_variable(const harp_product *product, c
                                                   const harp_dimension_type *dimension_type, harp_variable **variable)
 {
     conversion_info info;
+    char *plan_key;
 
     if (name == NULL)
     {
@@ -1179,7 +2171,7 @@ LIBHARP_API int harp_product_get_derived_variable(const harp_product *product, c
                 }
                 else
                 {
-                    if (harp_variable_convert_unit(info.variable, unit) != 0)
+                    if (harp_variable_convert_unit_keep_float(info.variable, unit) != 0)
                     {
                         return -1;
                     }
@@ -1197,12 +2189,9 @@ LIBHARP_API int harp_product_get_derived_variable(const harp_product *product, c
         }
     }
 
-    if (harp_derived_variable_conversions == NULL)
+    if (harp_derived_variable_list_init() != 0)
     {
-        if (harp_derived_variable_list_init() != 0)
-        {
-            return -1;
-        }
+        return -1;
     }
 
     if (conversion_info_init_with_variable(&info, product, name, num_dimensions, dimension_type) != 0)
@@ -1210,15 +2199,41 @@ LIBHARP_API int harp_product_get_derived_variable(const harp_product *product, c
         return -1;
     }
 
+    /* products with the same layout will use the same conversions, so try to reuse the result of an earlier search */
+    plan_key = get_plan_key(product, info.dimsvar_name);
+    if (plan_key == NULL)
+    {
+        conversion_info_done(&info);
+        return -1;
+    }
+    info.plan = find_cached_plan(plan_key);
+
     if (find_and_execute_conversion(&info) != 0)
     {
+        free(plan_key);
         conversion_info_done(&info);
         return -1;
     }
 
+    if (info.plan == NULL)
+    {
+        /* the cache takes ownership of the key and the plan */
+        if (add_cached_plan(plan_key, info.new_plan) != 0)
+        {
+            info.new_plan = NULL;
+            conversion_info_done(&info);
+            return -1;
+        }
+        info.new_plan = NULL;
+    }
+    else
+    {
+        free(plan_key);
+    }
+
     if (unit != NULL)
     {
-        if (harp_variable_convert_unit(info.variable, unit) != 0)
+        if (harp_variable_convert_unit_keep_float(info.variable, unit) != 0)
         {
             conversion_info_done(&info);
             return -1;
@@ -1288,7 +2303,7 @@ LIBHARP_API int harp_product_add_derived_variable(harp_product *product, const c
                 }
                 else
                 {
-                    if (harp_variable_convert_unit(variable, unit) != 0)
+                    if (harp_variable_convert_unit_keep_float(variable, unit) != 0)
                     {
                         return -1;
                     }
@@ -1305,12 +2320,9 @@ LIBHARP_API int harp_product_add_derived_variable(harp_product *product, const c
         }
     }
 
-    if (harp_derived_variable_conversions == NULL)
+    if (harp_derived_variable_list_init() != 0)
     {
-        if (harp_derived_variable_list_init() != 0)
-        {
-            return -1;
-        }
+        return -1;
     }
 
     /* variable with right dimensions does not yet exist -> create and add it */
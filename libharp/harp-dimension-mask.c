@@ -69,10 +69,7 @@ int harp_dimension_mask_new(int num_dimensions, const long *dimension, harp_dime
     }
 
     /* Initialize the mask to all 1's. */
-    for (i = 0; i < dimension_mask->num_elements; i++)
-    {
-        dimension_mask->mask[i] = 1;
-    }
+    memset(dimension_mask->mask, 1, (size_t)dimension_mask->num_elements * sizeof(uint8_t));
 
     *new_dimension_mask = dimension_mask;
     return 0;
@@ -192,15 +189,37 @@ int harp_dimension_mask_fill_false(harp_dimension_mask *dimension_mask)
     return 0;
 }
 
+/* Mask values are stored as one byte per element, but any non-zero byte counts as true. The helpers below process
+ * the mask eight elements at a time by loading a 64-bit word and normalizing each byte to 0 or 1, which turns counting
+ * into a population count and intersection into a bitwise and.
+ */
+#define MASK_WORD_ONES  ((uint64_t)0x0101010101010101ULL)
+#define MASK_WORD_LOW7  ((uint64_t)0x7f7f7f7f7f7f7f7fULL)
+
+static uint64_t load_normalized_word(const uint8_t *mask)
+{
+    uint64_t word;
+
+    memcpy(&word, mask, sizeof(uint64_t));
+
+    /* Set the high bit of every non-zero byte and move it to the low bit. */
+    return ((((word & MASK_WORD_LOW7) + MASK_WORD_LOW7) | word) >> 7) & MASK_WORD_ONES;
+}
+
 static long count(long num_elements, const uint8_t *mask)
 {
-    const uint8_t *mask_end;
     long count;
+    long i;
 
     count = 0;
-    for (mask_end = mask + num_elements; mask != mask_end; mask++)
+    for (i = 0; i + (long)sizeof(uint64_t) <= num_elements; i += sizeof(uint64_t))
+    {
+        /* Each byte of the normalized word is 0 or 1, so the sum of the bytes ends up in the most significant byte. */
+        count += (long)((load_normalized_word(&mask[i]) * MASK_WORD_ONES) >> 56);
+    }
+    for (; i < num_elements; i++)
     {
-        if (*mask)
+        if (mask[i])
         {
             count++;
         }
@@ -209,6 +228,48 @@ static long count(long num_elements, const uint8_t *mask)
     return count;
 }
 
+static int any(long num_elements, const uint8_t *mask)
+{
+    long i;
+
+    for (i = 0; i + (long)sizeof(uint64_t) <= num_elements; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+
+        memcpy(&word, &mask[i], sizeof(uint64_t));
+        if (word != 0)
+        {
+            return 1;
+        }
+    }
+    for (; i < num_elements; i++)
+    {
+        if (mask[i])
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void intersect(long num_elements, const uint8_t *mask, uint8_t *merged_mask)
+{
+    long i;
+
+    for (i = 0; i + (long)sizeof(uint64_t) <= num_elements; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+
+        word = load_normalized_word(&mask[i]) & load_normalized_word(&merged_mask[i]);
+        memcpy(&merged_mask[i], &word, sizeof(uint64_t));
+    }
+    for (; i < num_elements; i++)
+    {
+        merged_mask[i] = mask[i] && merged_mask[i];
+    }
+}
+
 int harp_dimension_mask_update_masked_length(harp_dimension_mask *dimension_mask)
 {
     long num_blocks;
@@ -261,6 +322,7 @@ int harp_dimension_mask_outer_product(const harp_dimension_mask *row_mask, const
     dimension_mask->dimension[1] = col_mask->num_elements;
     dimension_mask->num_elements = dimension_mask->dimension[0] * dimension_mask->dimension[1];
 
+    dimension_mask->masked_dimension_length = 0;
     if (row_mask->masked_dimension_length != 0)
     {
         dimension_mask->masked_dimension_length = col_mask->masked_dimension_length;
@@ -438,24 +500,9 @@ int harp_dimension_mask_reduce(const harp_dimension_mask *dimension_mask, int di
 
         for (j = 0; j < num_groups; j++)
         {
-            const uint8_t *block_ptr;
-            const uint8_t *block_end_ptr;
-
-            block_ptr = dimension_mask->mask + (j * num_blocks + i) * num_block_elements;
-            block_end_ptr = block_ptr + num_block_elements;
-
-            for (; block_ptr != block_end_ptr; block_ptr++)
+            if (any(num_block_elements, dimension_mask->mask + (j * num_blocks + i) * num_block_elements))
             {
-                if (*block_ptr)
-                {
-                    break;
-                }
-            }
-
-            if (block_ptr != block_end_ptr)
-            {
-                /* If any value in the block is set to true, the loop above will exit early, and therefore block_ptr
-                 * will not equal block_end_ptr. In this case, the corresponding value in the reduced mask can be set
+                /* If any value in the block is set to true, the corresponding value in the reduced mask can be set
                  * to true and no additional blocks related to this index need to be examined.
                  */
                 reduced_dimension_mask->mask[i] = 1;
@@ -504,10 +551,7 @@ int harp_dimension_mask_merge(const harp_dimension_mask *dimension_mask, int dim
     {
         assert(dimension_mask->num_elements == merged_dimension_mask->num_elements);
 
-        for (i = 0; i < merged_dimension_mask->num_elements; i++)
-        {
-            merged_dimension_mask->mask[i] = dimension_mask->mask[i] && merged_dimension_mask->mask[i];
-        }
+        intersect(merged_dimension_mask->num_elements, dimension_mask->mask, merged_dimension_mask->mask);
     }
     else
     {
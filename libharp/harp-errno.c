@@ -30,6 +30,7 @@
  */
 
 #include "harp-internal.h"
+#include "harp-thread.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -39,17 +40,19 @@
 #define MAX_ERROR_INFO_LENGTH	4096
 
 static int (*harp_warning_handler) (const char *, va_list ap) = NULL;
-static char harp_error_message_buffer[MAX_ERROR_INFO_LENGTH + 1];
+static HARP_THREAD_LOCAL char harp_error_message_buffer[MAX_ERROR_INFO_LENGTH + 1];
+static HARP_THREAD_LOCAL int harp_errno_value = HARP_SUCCESS;
 
 /** \defgroup harp_error HARP Error
  * With a few exceptions almost all HARP functions return an integer that indicate whether the function was able to
  * perform its operations successfully. The return value will be 0 on success and -1 otherwise. In case you get a -1
- * you can look at the global variable #harp_errno for a precise error code. Each error code and its meaning is
- * described in this section. You will also be able to retrieve a character string with an error description via
- * the harp_errno_to_string() function. This function will return either the default error message for the error
- * code, or a custom error message. A custom error message will only be returned if the error code you pass to
- * harp_errno_to_string() is equal to the last error that occurred and if this last error was set with a custom error
- * message. The HARP error state can be set with the harp_set_error() function.<br>
+ * you can look at the variable #harp_errno for a precise error code (the error state is kept separately for each
+ * thread). Each error code and its meaning is described in this section. You will also be able to retrieve a
+ * character string with an error description via the harp_errno_to_string() function. This function will return
+ * either the default error message for the error code, or a custom error message. A custom error message will only
+ * be returned if the error code you pass to harp_errno_to_string() is equal to the last error that occurred (in the
+ * same thread) and if this last error was set with a custom error message. The HARP error state can be set with the
+ * harp_set_error() function.<br>
  */
 
 /** \addtogroup harp_error
@@ -172,11 +175,16 @@ static char harp_error_message_buffer[MAX_ERROR_INFO_LENGTH + 1];
 
 /** @} */
 
-/** Variable that contains the error type.
- * If no error has occurred the variable contains #HARP_SUCCESS (0).
- * \hideinitializer
+/** Get a reference to the error type of the current thread.
+ * The error state (error type and error message) is kept separately for each thread, so an error raised in one
+ * thread will never overwrite the error of a HARP function call in another thread.
+ * This function is used by the #harp_errno definition and should normally not be called directly.
+ * \return Pointer to the thread specific error type.
  */
-LIBHARP_API int harp_errno = HARP_SUCCESS;
+LIBHARP_API int *harp_get_errno(void)
+{
+    return &harp_errno_value;
+}
 
 /** @} */
 
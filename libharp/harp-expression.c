@@ -0,0 +1,1127 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of elements that are evaluated together by each instruction of an expression.
+ * The evaluation stack only holds blocks of this size, so no arrays of the size of the full result are created for
+ * intermediate values.
+ */
+#define EXPRESSION_BLOCK_SIZE 512
+
+typedef struct expression_function_struct
+{
+    const char *name;
+    harp_expression_opcode opcode;
+} expression_function;
+
+static const expression_function function_list[] = {
+    {"abs", harp_expression_abs},
+    {"acos", harp_expression_acos},
+    {"asin", harp_expression_asin},
+    {"atan", harp_expression_atan},
+    {"atan2", harp_expression_atan2},
+    {"ceil", harp_expression_ceil},
+    {"cos", harp_expression_cos},
+    {"exp", harp_expression_exp},
+    {"floor", harp_expression_floor},
+    {"isnan", harp_expression_isnan},
+    {"log", harp_expression_log},
+    {"log10", harp_expression_log10},
+    {"max", harp_expression_max},
+    {"min", harp_expression_min},
+    {"pow", harp_expression_power},
+    {"round", harp_expression_round},
+    {"sin", harp_expression_sin},
+    {"sqrt", harp_expression_sqrt},
+    {"tan", harp_expression_tan},
+    {"where", harp_expression_where}
+};
+
+#define NUM_FUNCTIONS ((int)(sizeof(function_list) / sizeof(function_list[0])))
+
+/* variable that is used as input of an expression, bound to a product at evaluation time */
+typedef struct expression_operand_struct
+{
+    const harp_variable *variable;
+    harp_unit_converter *unit_converter;        /* NULL if no unit conversion is needed */
+    long inner_size;    /* number of consecutive result elements that share the same operand element */
+    int is_full;        /* whether the operand has the same shape as the result */
+} expression_operand;
+
+static int get_num_arguments(harp_expression_opcode opcode)
+{
+    switch (opcode)
+    {
+        case harp_expression_push_constant:
+        case harp_expression_push_variable:
+            return 0;
+        case harp_expression_negate:
+        case harp_expression_logical_not:
+        case harp_expression_abs:
+        case harp_expression_sqrt:
+        case harp_expression_exp:
+        case harp_expression_log:
+        case harp_expression_log10:
+        case harp_expression_sin:
+        case harp_expression_cos:
+        case harp_expression_tan:
+        case harp_expression_asin:
+        case harp_expression_acos:
+        case harp_expression_atan:
+        case harp_expression_floor:
+        case harp_expression_ceil:
+        case harp_expression_round:
+        case harp_expression_isnan:
+            return 1;
+        case harp_expression_where:
+            return 3;
+        default:
+            break;
+    }
+
+    return 2;
+}
+
+static int expression_new(harp_expression **new_expression)
+{
+    harp_expression *expression;
+
+    expression = (harp_expression *)malloc(sizeof(harp_expression));
+    if (expression == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_expression), __FILE__, __LINE__);
+        return -1;
+    }
+    expression->num_instructions = 0;
+    expression->instruction = NULL;
+    expression->num_constants = 0;
+    expression->constant = NULL;
+    expression->num_variables = 0;
+    expression->variable_name = NULL;
+    expression->variable_unit = NULL;
+    expression->stack_size = 0;
+
+    *new_expression = expression;
+    return 0;
+}
+
+void harp_expression_delete(harp_expression *expression)
+{
+    if (expression != NULL)
+    {
+        if (expression->instruction != NULL)
+        {
+            free(expression->instruction);
+        }
+        if (expression->constant != NULL)
+        {
+            free(expression->constant);
+        }
+        if (expression->variable_name != NULL)
+        {
+            int i;
+
+            for (i = 0; i < expression->num_variables; i++)
+            {
+                free(expression->variable_name[i]);
+            }
+            free(expression->variable_name);
+        }
+        if (expression->variable_unit != NULL)
+        {
+            int i;
+
+            for (i = 0; i < expression->num_variables; i++)
+            {
+                if (expression->variable_unit[i] != NULL)
+                {
+                    free(expression->variable_unit[i]);
+                }
+            }
+            free(expression->variable_unit);
+        }
+        free(expression);
+    }
+}
+
+static int add_instruction(harp_expression *expression, harp_expression_opcode opcode, int argument)
+{
+    harp_expression_instruction *instruction;
+
+    instruction = (harp_expression_instruction *)realloc(expression->instruction, (expression->num_instructions + 1) *
+                                                         sizeof(harp_expression_instruction));
+    if (instruction == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (expression->num_instructions + 1) * sizeof(harp_expression_instruction), __FILE__, __LINE__);
+        return -1;
+    }
+    expression->instruction = instruction;
+    expression->instruction[expression->num_instructions].opcode = opcode;
+    expression->instruction[expression->num_instructions].argument = argument;
+    expression->num_instructions++;
+
+    return 0;
+}
+
+static int add_constant(harp_expression *expression, double value, int *index)
+{
+    double *constant;
+
+    constant = (double *)realloc(expression->constant, (expression->num_constants + 1) * sizeof(double));
+    if (constant == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (expression->num_constants + 1) * sizeof(double), __FILE__, __LINE__);
+        return -1;
+    }
+    expression->constant = constant;
+    expression->constant[expression->num_constants] = value;
+    *index = expression->num_constants;
+    expression->num_constants++;
+
+    return 0;
+}
+
+/* add a variable reference; references to the same variable (in the same unit) share a single entry */
+static int add_variable(harp_expression *expression, const char *variable_name, const char *unit, int *index)
+{
+    char **new_variable_name;
+    char **new_variable_unit;
+    int i;
+
+    for (i = 0; i < expression->num_variables; i++)
+    {
+        if (strcmp(expression->variable_name[i], variable_name) == 0)
+        {
+            if (unit == NULL ? expression->variable_unit[i] == NULL :
+                (expression->variable_unit[i] != NULL && strcmp(expression->variable_unit[i], unit) == 0))
+            {
+                *index = i;
+                return 0;
+            }
+        }
+    }
+
+    new_variable_name = (char **)realloc(expression->variable_name, (expression->num_variables + 1) * sizeof(char *));
+    if (new_variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (expression->num_variables + 1) * sizeof(char *), __FILE__, __LINE__);
+        return -1;
+    }
+    expression->variable_name = new_variable_name;
+    new_variable_unit = (char **)realloc(expression->variable_unit, (expression->num_variables + 1) * sizeof(char *));
+    if (new_variable_unit == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (expression->num_variables + 1) * sizeof(char *), __FILE__, __LINE__);
+        return -1;
+    }
+    expression->variable_unit = new_variable_unit;
+
+    expression->variable_name[expression->num_variables] = strdup(variable_name);
+    if (expression->variable_name[expression->num_variables] == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    expression->variable_unit[expression->num_variables] = NULL;
+    if (unit != NULL)
+    {
+        expression->variable_unit[expression->num_variables] = strdup(unit);
+        if (expression->variable_unit[expression->num_variables] == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            free(expression->variable_name[expression->num_variables]);
+            return -1;
+        }
+    }
+    *index = expression->num_variables;
+    expression->num_variables++;
+
+    return 0;
+}
+
+/* append the instructions of 'other' to 'expression', remapping the constant and variable references */
+static int append_expression(harp_expression *expression, const harp_expression *other)
+{
+    int i;
+
+    for (i = 0; i < other->num_instructions; i++)
+    {
+        harp_expression_instruction instruction = other->instruction[i];
+
+        if (instruction.opcode == harp_expression_push_constant)
+        {
+            if (add_constant(expression, other->constant[instruction.argument], &instruction.argument) != 0)
+            {
+                return -1;
+            }
+        }
+        else if (instruction.opcode == harp_expression_push_variable)
+        {
+            if (add_variable(expression, other->variable_name[instruction.argument],
+                             other->variable_unit[instruction.argument], &instruction.argument) != 0)
+            {
+                return -1;
+            }
+        }
+        if (add_instruction(expression, instruction.opcode, instruction.argument) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void update_stack_size(harp_expression *expression)
+{
+    int depth = 0;
+    int i;
+
+    expression->stack_size = 0;
+    for (i = 0; i < expression->num_instructions; i++)
+    {
+        depth += 1 - get_num_arguments(expression->instruction[i].opcode);
+        if (depth > expression->stack_size)
+        {
+            expression->stack_size = depth;
+        }
+    }
+    assert(depth == 1);
+}
+
+static double round_value(double value)
+{
+    /* round half away from zero */
+    return value < 0 ? ceil(value - 0.5) : floor(value + 0.5);
+}
+
+static double bit_and(double a, double b)
+{
+    if (a != a || b != b)
+    {
+        return harp_nan();
+    }
+    return (double)((int64_t)a & (int64_t)b);
+}
+
+static double bit_or(double a, double b)
+{
+    if (a != a || b != b)
+    {
+        return harp_nan();
+    }
+    return (double)((int64_t)a | (int64_t)b);
+}
+
+/* read a block of values of an operand (converted to double and to the requested unit) */
+static void load_operand(const expression_operand *operand, long offset, long num_elements, double *block)
+{
+    const harp_variable *variable = operand->variable;
+    long index[EXPRESSION_BLOCK_SIZE];
+    long i;
+
+    if (operand->is_full)
+    {
+        switch (variable->data_type)
+        {
+            case harp_type_int8:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.int8_data[offset + i];
+                }
+                break;
+            case harp_type_int16:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.int16_data[offset + i];
+                }
+                break;
+            case harp_type_int32:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.int32_data[offset + i];
+                }
+                break;
+            case harp_type_float:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.float_data[offset + i];
+                }
+                break;
+            case harp_type_double:
+                memcpy(block, &variable->data.double_data[offset], num_elements * sizeof(double));
+                break;
+            case harp_type_string:
+                assert(0);
+                exit(1);
+        }
+    }
+    else
+    {
+        /* the operand dimensions are a contiguous subset of the result dimensions */
+        for (i = 0; i < num_elements; i++)
+        {
+            index[i] = ((offset + i) / operand->inner_size) % variable->num_elements;
+        }
+        switch (variable->data_type)
+        {
+            case harp_type_int8:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.int8_data[index[i]];
+                }
+                break;
+            case harp_type_int16:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.int16_data[index[i]];
+                }
+                break;
+            case harp_type_int32:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.int32_data[index[i]];
+                }
+                break;
+            case harp_type_float:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = (double)variable->data.float_data[index[i]];
+                }
+                break;
+            case harp_type_double:
+                for (i = 0; i < num_elements; i++)
+                {
+                    block[i] = variable->data.double_data[index[i]];
+                }
+                break;
+            case harp_type_string:
+                assert(0);
+                exit(1);
+        }
+    }
+
+    if (operand->unit_converter != NULL)
+    {
+        harp_unit_converter_convert_array(operand->unit_converter, num_elements, block);
+    }
+}
+
+/* Evaluate the expression for a block of elements.
+ * The stack should have room for expression->stack_size * EXPRESSION_BLOCK_SIZE values. The result ends up at the
+ * start of the stack.
+ */
+static void evaluate_block(const harp_expression *expression, const expression_operand *operand, long offset,
+                           long num_elements, double *stack)
+{
+    double *a = NULL;
+    double *b = NULL;
+    double *c = NULL;
+    int depth = 0;
+    int i;
+    long j;
+
+    for (i = 0; i < expression->num_instructions; i++)
+    {
+        harp_expression_opcode opcode = expression->instruction[i].opcode;
+        int num_arguments = get_num_arguments(opcode);
+
+        /* a is the first argument and also receives the result */
+        depth -= num_arguments;
+        a = &stack[depth * EXPRESSION_BLOCK_SIZE];
+        b = a + EXPRESSION_BLOCK_SIZE;
+        c = b + EXPRESSION_BLOCK_SIZE;
+        depth++;
+
+        switch (opcode)
+        {
+            case harp_expression_push_constant:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = expression->constant[expression->instruction[i].argument];
+                }
+                break;
+            case harp_expression_push_variable:
+                load_operand(&operand[expression->instruction[i].argument], offset, num_elements, a);
+                break;
+            case harp_expression_negate:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = -a[j];
+                }
+                break;
+            case harp_expression_logical_not:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] == 0);
+                }
+                break;
+            case harp_expression_add:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = a[j] + b[j];
+                }
+                break;
+            case harp_expression_subtract:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = a[j] - b[j];
+                }
+                break;
+            case harp_expression_multiply:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = a[j] * b[j];
+                }
+                break;
+            case harp_expression_divide:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = a[j] / b[j];
+                }
+                break;
+            case harp_expression_power:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = pow(a[j], b[j]);
+                }
+                break;
+            case harp_expression_equal:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] == b[j]);
+                }
+                break;
+            case harp_expression_not_equal:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] != b[j]);
+                }
+                break;
+            case harp_expression_less:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] < b[j]);
+                }
+                break;
+            case harp_expression_less_equal:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] <= b[j]);
+                }
+                break;
+            case harp_expression_greater:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] > b[j]);
+                }
+                break;
+            case harp_expression_greater_equal:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] >= b[j]);
+                }
+                break;
+            case harp_expression_logical_and:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] != 0 && b[j] != 0);
+                }
+                break;
+            case harp_expression_logical_or:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] != 0 || b[j] != 0);
+                }
+                break;
+            case harp_expression_bit_and:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = bit_and(a[j], b[j]);
+                }
+                break;
+            case harp_expression_bit_or:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = bit_or(a[j], b[j]);
+                }
+                break;
+            case harp_expression_abs:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = fabs(a[j]);
+                }
+                break;
+            case harp_expression_sqrt:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = sqrt(a[j]);
+                }
+                break;
+            case harp_expression_exp:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = exp(a[j]);
+                }
+                break;
+            case harp_expression_log:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = log(a[j]);
+                }
+                break;
+            case harp_expression_log10:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = log10(a[j]);
+                }
+                break;
+            case harp_expression_sin:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = sin(a[j]);
+                }
+                break;
+            case harp_expression_cos:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = cos(a[j]);
+                }
+                break;
+            case harp_expression_tan:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = tan(a[j]);
+                }
+                break;
+            case harp_expression_asin:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = asin(a[j]);
+                }
+                break;
+            case harp_expression_acos:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = acos(a[j]);
+                }
+                break;
+            case harp_expression_atan:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = atan(a[j]);
+                }
+                break;
+            case harp_expression_floor:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = floor(a[j]);
+                }
+                break;
+            case harp_expression_ceil:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = ceil(a[j]);
+                }
+                break;
+            case harp_expression_round:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = round_value(a[j]);
+                }
+                break;
+            case harp_expression_isnan:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] != a[j]);
+                }
+                break;
+            case harp_expression_atan2:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = atan2(a[j], b[j]);
+                }
+                break;
+            case harp_expression_min:
+                /* NaN values are ignored (as long as one of the values is valid) */
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (b[j] < a[j] || a[j] != a[j]) ? b[j] : a[j];
+                }
+                break;
+            case harp_expression_max:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (b[j] > a[j] || a[j] != a[j]) ? b[j] : a[j];
+                }
+                break;
+            case harp_expression_where:
+                for (j = 0; j < num_elements; j++)
+                {
+                    a[j] = (a[j] != 0 && a[j] == a[j]) ? b[j] : c[j];
+                }
+                break;
+        }
+    }
+    assert(depth == 1);
+}
+
+/** Create an expression that consists of a single constant value.
+ */
+int harp_expression_new_constant(double value, harp_expression **new_expression)
+{
+    harp_expression *expression;
+    int index;
+
+    if (expression_new(&expression) != 0)
+    {
+        return -1;
+    }
+    if (add_constant(expression, value, &index) != 0)
+    {
+        harp_expression_delete(expression);
+        return -1;
+    }
+    if (add_instruction(expression, harp_expression_push_constant, index) != 0)
+    {
+        harp_expression_delete(expression);
+        return -1;
+    }
+    expression->stack_size = 1;
+
+    *new_expression = expression;
+    return 0;
+}
+
+/** Create an expression that consists of a reference to a variable.
+ * If \a unit is not NULL, the values of the variable will be converted to this unit before the expression is
+ * evaluated.
+ */
+int harp_expression_new_variable(const char *variable_name, const char *unit, harp_expression **new_expression)
+{
+    harp_expression *expression;
+    int index;
+
+    assert(variable_name != NULL);
+
+    if (expression_new(&expression) != 0)
+    {
+        return -1;
+    }
+    if (add_variable(expression, variable_name, unit, &index) != 0)
+    {
+        harp_expression_delete(expression);
+        return -1;
+    }
+    if (add_instruction(expression, harp_expression_push_variable, index) != 0)
+    {
+        harp_expression_delete(expression);
+        return -1;
+    }
+    expression->stack_size = 1;
+
+    *new_expression = expression;
+    return 0;
+}
+
+/** Create an expression that applies an operation to the results of \a num_arguments other expressions.
+ * Ownership of all argument expressions is transferred to this function (also when an error occurs).
+ * If none of the arguments depend on a variable, the result is reduced to a single constant.
+ */
+int harp_expression_new_operation(harp_expression_opcode opcode, int num_arguments, harp_expression **argument,
+                                  harp_expression **new_expression)
+{
+    harp_expression *expression;
+    int i;
+
+    assert(num_arguments == get_num_arguments(opcode));
+    assert(num_arguments > 0);
+
+    expression = argument[0];
+    argument[0] = NULL;
+    for (i = 1; i < num_arguments; i++)
+    {
+        if (append_expression(expression, argument[i]) != 0)
+        {
+            harp_expression_delete(expression);
+            for (; i < num_arguments; i++)
+            {
+                harp_expression_delete(argument[i]);
+            }
+            return -1;
+        }
+        harp_expression_delete(argument[i]);
+        argument[i] = NULL;
+    }
+    if (add_instruction(expression, opcode, 0) != 0)
+    {
+        harp_expression_delete(expression);
+        return -1;
+    }
+    update_stack_size(expression);
+
+    if (expression->num_variables == 0)
+    {
+        harp_expression *constant_expression;
+        double *stack;
+
+        /* constant folding */
+        stack = (double *)malloc(expression->stack_size * EXPRESSION_BLOCK_SIZE * sizeof(double));
+        if (stack == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           expression->stack_size * EXPRESSION_BLOCK_SIZE * sizeof(double), __FILE__, __LINE__);
+            harp_expression_delete(expression);
+            return -1;
+        }
+        evaluate_block(expression, NULL, 0, 1, stack);
+        harp_expression_delete(expression);
+        if (harp_expression_new_constant(stack[0], &constant_expression) != 0)
+        {
+            free(stack);
+            return -1;
+        }
+        free(stack);
+        expression = constant_expression;
+    }
+
+    *new_expression = expression;
+    return 0;
+}
+
+/** Create an expression that applies the function \a function_name to the results of other expressions.
+ * Ownership of all argument expressions is transferred to this function (also when an error occurs).
+ */
+int harp_expression_new_function(const char *function_name, int num_arguments, harp_expression **argument,
+                                 harp_expression **new_expression)
+{
+    int i;
+
+    for (i = 0; i < NUM_FUNCTIONS; i++)
+    {
+        if (strcmp(function_list[i].name, function_name) == 0)
+        {
+            break;
+        }
+    }
+    if (i == NUM_FUNCTIONS)
+    {
+        harp_set_error(HARP_ERROR_OPERATION_SYNTAX, "unknown function '%s' in expression", function_name);
+    }
+    else if (get_num_arguments(function_list[i].opcode) != num_arguments)
+    {
+        harp_set_error(HARP_ERROR_OPERATION_SYNTAX, "function '%s' takes %d argument(s) (%d given)", function_name,
+                       get_num_arguments(function_list[i].opcode), num_arguments);
+    }
+    else
+    {
+        return harp_expression_new_operation(function_list[i].opcode, num_arguments, argument, new_expression);
+    }
+
+    for (i = 0; i < num_arguments; i++)
+    {
+        harp_expression_delete(argument[i]);
+    }
+    return -1;
+}
+
+/* find the position at which the dimensions of 'variable' occur (as a contiguous range) in the dimensions of 'shape'
+ * returns -1 if the dimensions of the variable are not part of the dimensions of 'shape'
+ */
+static int find_dimension_offset(const harp_variable *shape, const harp_variable *variable)
+{
+    int offset;
+    int i;
+
+    for (offset = 0; offset + variable->num_dimensions <= shape->num_dimensions; offset++)
+    {
+        for (i = 0; i < variable->num_dimensions; i++)
+        {
+            if (shape->dimension_type[offset + i] != variable->dimension_type[i] ||
+                shape->dimension[offset + i] != variable->dimension[i])
+            {
+                break;
+            }
+        }
+        if (i == variable->num_dimensions)
+        {
+            return offset;
+        }
+    }
+
+    return -1;
+}
+
+/* store a block of (double) expression results in the result variable */
+static void store_result(harp_variable *variable, long offset, long num_elements, const double *block)
+{
+    long i;
+
+    switch (variable->data_type)
+    {
+        case harp_type_int8:
+            for (i = 0; i < num_elements; i++)
+            {
+                variable->data.int8_data[offset + i] = (block[i] == block[i] ? (int8_t)block[i] : 0);
+            }
+            break;
+        case harp_type_int16:
+            for (i = 0; i < num_elements; i++)
+            {
+                variable->data.int16_data[offset + i] = (block[i] == block[i] ? (int16_t)block[i] : 0);
+            }
+            break;
+        case harp_type_int32:
+            for (i = 0; i < num_elements; i++)
+            {
+                variable->data.int32_data[offset + i] = (block[i] == block[i] ? (int32_t)block[i] : 0);
+            }
+            break;
+        case harp_type_float:
+            for (i = 0; i < num_elements; i++)
+            {
+                variable->data.float_data[offset + i] = (float)block[i];
+            }
+            break;
+        case harp_type_double:
+            memcpy(&variable->data.double_data[offset], block, num_elements * sizeof(double));
+            break;
+        case harp_type_string:
+            assert(0);
+            exit(1);
+    }
+}
+
+static void operand_list_delete(int num_operands, expression_operand *operand)
+{
+    int i;
+
+    for (i = 0; i < num_operands; i++)
+    {
+        if (operand[i].unit_converter != NULL)
+        {
+            harp_unit_converter_delete(operand[i].unit_converter);
+        }
+    }
+    free(operand);
+}
+
+/** Evaluate an expression on a product and store the result as a new variable in the product.
+ * The result gets the dimensions of the operand variable that has the most dimensions. All other operand variables
+ * should have dimensions that form a contiguous subset of these dimensions (e.g. {time} or {vertical} for a
+ * {time,vertical} result); their values are repeated along the remaining dimensions.
+ * If the product already contains a variable with the given name it will be replaced.
+ * \param product Product on which the expression should be evaluated.
+ * \param variable_name Name of the result variable.
+ * \param data_type Data type of the result variable (pass NULL to use double).
+ * \param unit Unit of the result variable (can be NULL).
+ * \param expression Compiled expression.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_product_compute_variable(harp_product *product, const char *variable_name, const harp_data_type *data_type,
+                                  const char *unit, const harp_expression *expression)
+{
+    const harp_variable *shape = NULL;
+    expression_operand *operand = NULL;
+    harp_variable *variable;
+    double *stack;
+    long offset;
+    int i;
+
+    if (data_type != NULL && *data_type == harp_type_string)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "result of expression can not be of type string");
+        return -1;
+    }
+
+    if (expression->num_variables > 0)
+    {
+        operand = (expression_operand *)malloc(expression->num_variables * sizeof(expression_operand));
+        if (operand == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           expression->num_variables * sizeof(expression_operand), __FILE__, __LINE__);
+            return -1;
+        }
+        for (i = 0; i < expression->num_variables; i++)
+        {
+            operand[i].unit_converter = NULL;
+        }
+    }
+
+    for (i = 0; i < expression->num_variables; i++)
+    {
+        harp_variable *operand_variable;
+
+        if (harp_product_get_variable_by_name(product, expression->variable_name[i], &operand_variable) != 0)
+        {
+            operand_list_delete(expression->num_variables, operand);
+            return -1;
+        }
+        if (operand_variable->data_type == harp_type_string)
+        {
+            harp_set_error(HARP_ERROR_INVALID_VARIABLE, "variable '%s' of type string can not be used in an "
+                           "expression", operand_variable->name);
+            operand_list_delete(expression->num_variables, operand);
+            return -1;
+        }
+        operand[i].variable = operand_variable;
+        if (expression->variable_unit[i] != NULL)
+        {
+            if (harp_unit_converter_new(operand_variable->unit, expression->variable_unit[i],
+                                        &operand[i].unit_converter) != 0)
+            {
+                harp_add_error_message(" (in unit conversion of variable '%s')", operand_variable->name);
+                operand_list_delete(expression->num_variables, operand);
+                return -1;
+            }
+        }
+        if (shape == NULL || operand_variable->num_dimensions > shape->num_dimensions)
+        {
+            shape = operand_variable;
+        }
+    }
+
+    if (shape == NULL)
+    {
+        if (harp_variable_new(variable_name, data_type == NULL ? harp_type_double : *data_type, 0, NULL, NULL,
+                              &variable) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        if (harp_variable_new(variable_name, data_type == NULL ? harp_type_double : *data_type,
+                              shape->num_dimensions, shape->dimension_type, shape->dimension, &variable) != 0)
+        {
+            operand_list_delete(expression->num_variables, operand);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < expression->num_variables; i++)
+    {
+        int dimension_offset;
+        int k;
+
+        dimension_offset = find_dimension_offset(shape, operand[i].variable);
+        if (dimension_offset < 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_VARIABLE, "dimensions of variable '%s' are incompatible with those of "
+                           "variable '%s' in expression", operand[i].variable->name, shape->name);
+            harp_variable_delete(variable);
+            operand_list_delete(expression->num_variables, operand);
+            return -1;
+        }
+        operand[i].inner_size = 1;
+        for (k = dimension_offset + operand[i].variable->num_dimensions; k < shape->num_dimensions; k++)
+        {
+            operand[i].inner_size *= shape->dimension[k];
+        }
+        operand[i].is_full = (operand[i].variable->num_elements == variable->num_elements);
+    }
+
+    stack = (double *)malloc(expression->stack_size * EXPRESSION_BLOCK_SIZE * sizeof(double));
+    if (stack == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       expression->stack_size * EXPRESSION_BLOCK_SIZE * sizeof(double), __FILE__, __LINE__);
+        harp_variable_delete(variable);
+        if (operand != NULL)
+        {
+            operand_list_delete(expression->num_variables, operand);
+        }
+        return -1;
+    }
+
+    for (offset = 0; offset < variable->num_elements; offset += EXPRESSION_BLOCK_SIZE)
+    {
+        long num_elements = variable->num_elements - offset;
+
+        if (num_elements > EXPRESSION_BLOCK_SIZE)
+        {
+            num_elements = EXPRESSION_BLOCK_SIZE;
+        }
+        evaluate_block(expression, operand, offset, num_elements, stack);
+        store_result(variable, offset, num_elements, stack);
+    }
+
+    free(stack);
+    if (operand != NULL)
+    {
+        operand_list_delete(expression->num_variables, operand);
+    }
+
+    if (unit != NULL)
+    {
+        if (harp_variable_set_unit(variable, unit) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+
+    if (harp_product_has_variable(product, variable_name))
+    {
+        if (harp_product_replace_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+    else
+    {
+        if (harp_product_add_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -31,13 +31,183 @@
 
 #include "harp-filter-collocation.h"
 #include "harp-dimension-mask.h"
+#include "harp-thread.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define COLLOCATION_MASK_BLOCK_SIZE 1024
 
+/* In-memory cache of imported collocated (dataset B) products.
+ * Operations such as regrid() and smooth() with a collocated dataset import the collocated product for each product
+ * of dataset A that they get applied to. When many products collocate with the same collocated product (e.g. a
+ * ground station file) this cache avoids importing that file over and over again. Callers get a copy of the cached
+ * product that shares the variable data with the cache (see harp_product_copy_shared()), so the variables only get
+ * copied when the copy gets modified.
+ */
+typedef struct collocated_product_cache_entry_struct
+{
+    char *filename;
+    time_t modification_time;
+    int64_t file_size;
+    harp_product *product;
+    int64_t size;       /* storage size of the product */
+    unsigned long last_use;
+    struct collocated_product_cache_entry_struct *next;
+} collocated_product_cache_entry;
+
+static harp_mutex collocated_product_cache_mutex = HARP_MUTEX_INITIALIZER;
+static collocated_product_cache_entry *collocated_product_cache = NULL;
+static int64_t collocated_product_cache_size = 0;
+static unsigned long collocated_product_cache_use_counter = 0;
+
+static void collocated_product_cache_entry_delete(collocated_product_cache_entry *entry)
+{
+    if (entry->filename != NULL)
+    {
+        free(entry->filename);
+    }
+    if (entry->product != NULL)
+    {
+        harp_product_delete(entry->product);
+    }
+    free(entry);
+}
+
+/* Remove the entry for the given file (if any) and, if needed, the least recently used entries such that an
+ * additional 'size' bytes fit within the cache size limit; should be called with the cache lock held.
+ */
+static void collocated_product_cache_make_room(const char *filename, int64_t size)
+{
+    collocated_product_cache_entry **entry = &collocated_product_cache;
+
+    while (*entry != NULL)
+    {
+        if (strcmp((*entry)->filename, filename) == 0)
+        {
+            collocated_product_cache_entry *stale_entry = *entry;
+
+            *entry = stale_entry->next;
+            collocated_product_cache_size -= stale_entry->size;
+            collocated_product_cache_entry_delete(stale_entry);
+            break;
+        }
+        entry = &(*entry)->next;
+    }
+
+    while (collocated_product_cache != NULL &&
+           collocated_product_cache_size + size > harp_option_collocated_product_cache_size)
+    {
+        collocated_product_cache_entry **oldest_entry = &collocated_product_cache;
+        collocated_product_cache_entry *removed_entry;
+
+        for (entry = &collocated_product_cache->next; *entry != NULL; entry = &(*entry)->next)
+        {
+            if ((*entry)->last_use < (*oldest_entry)->last_use)
+            {
+                oldest_entry = entry;
+            }
+        }
+        removed_entry = *oldest_entry;
+        *oldest_entry = removed_entry->next;
+        collocated_product_cache_size -= removed_entry->size;
+        collocated_product_cache_entry_delete(removed_entry);
+    }
+}
+
+/* Import a collocated product, using the cache of collocated products when possible. */
+int harp_import_collocated_product(const char *filename, harp_product **product)
+{
+    collocated_product_cache_entry *entry;
+    harp_product *imported_product;
+    struct stat statbuf;
+    int64_t size;
+
+    if (harp_option_collocated_product_cache_size <= 0 || stat(filename, &statbuf) != 0)
+    {
+        return harp_import(filename, NULL, NULL, product);
+    }
+
+    harp_mutex_lock(&collocated_product_cache_mutex);
+    for (entry = collocated_product_cache; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->filename, filename) == 0 && entry->modification_time == statbuf.st_mtime &&
+            entry->file_size == (int64_t)statbuf.st_size)
+        {
+            int result = harp_product_copy_shared(entry->product, product);
+
+            entry->last_use = ++collocated_product_cache_use_counter;
+            harp_mutex_unlock(&collocated_product_cache_mutex);
+            return result;
+        }
+    }
+    harp_mutex_unlock(&collocated_product_cache_mutex);
+
+    if (harp_import(filename, NULL, NULL, &imported_product) != 0)
+    {
+        return -1;
+    }
+    if (harp_product_get_storage_size(imported_product, 1, &size) != 0 ||
+        size > harp_option_collocated_product_cache_size)
+    {
+        /* products that do not fit in the cache are not cached */
+        *product = imported_product;
+        return 0;
+    }
+    if (harp_product_copy_shared(imported_product, product) != 0)
+    {
+        harp_product_delete(imported_product);
+        return -1;
+    }
+
+    entry = (collocated_product_cache_entry *)malloc(sizeof(collocated_product_cache_entry));
+    if (entry == NULL)
+    {
+        /* not being able to cache the product is not an error */
+        harp_product_delete(imported_product);
+        return 0;
+    }
+    entry->filename = strdup(filename);
+    if (entry->filename == NULL)
+    {
+        free(entry);
+        harp_product_delete(imported_product);
+        return 0;
+    }
+    entry->modification_time = statbuf.st_mtime;
+    entry->file_size = (int64_t)statbuf.st_size;
+    entry->product = imported_product;
+    entry->size = size;
+
+    harp_mutex_lock(&collocated_product_cache_mutex);
+    collocated_product_cache_make_room(filename, size);
+    entry->last_use = ++collocated_product_cache_use_counter;
+    entry->next = collocated_product_cache;
+    collocated_product_cache = entry;
+    collocated_product_cache_size += size;
+    harp_mutex_unlock(&collocated_product_cache_mutex);
+
+    return 0;
+}
+
+/* Remove all products from the cache of collocated products. */
+void harp_collocated_product_cache_clear(void)
+{
+    harp_mutex_lock(&collocated_product_cache_mutex);
+    while (collocated_product_cache != NULL)
+    {
+        collocated_product_cache_entry *entry = collocated_product_cache;
+
+        collocated_product_cache = entry->next;
+        collocated_product_cache_entry_delete(entry);
+    }
+    collocated_product_cache_size = 0;
+    harp_mutex_unlock(&collocated_product_cache_mutex);
+}
+
 static int compare_by_index(const void *a, const void *b)
 {
     harp_collocation_index_pair *pair_a = (harp_collocation_index_pair *)a;
@@ -220,11 +390,140 @@ static int collocation_mask_from_result(const harp_collocation_result *collocati
     return 0;
 }
 
-int harp_collocation_mask_import(const char *filename, harp_collocation_filter_type filter_type,
-                                 const char *source_product, harp_collocation_mask **new_mask)
+void harp_collocation_mask_set_delete(harp_collocation_mask_set *mask_set)
+{
+    if (mask_set != NULL)
+    {
+        if (mask_set->dataset != NULL)
+        {
+            harp_dataset_delete(mask_set->dataset);
+        }
+        if (mask_set->product_offset != NULL)
+        {
+            free(mask_set->product_offset);
+        }
+        if (mask_set->index_pair != NULL)
+        {
+            free(mask_set->index_pair);
+        }
+        free(mask_set);
+    }
+}
+
+static int collocation_mask_set_from_result(harp_collocation_result *collocation_result,
+                                            harp_collocation_filter_type filter_type,
+                                            harp_collocation_mask_set **new_mask_set)
+{
+    harp_collocation_mask_set *mask_set;
+    long num_products;
+    long *position;
+    long i;
+
+    mask_set = (harp_collocation_mask_set *)malloc(sizeof(harp_collocation_mask_set));
+    if (mask_set == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_collocation_mask_set), __FILE__, __LINE__);
+        return -1;
+    }
+    mask_set->filter_type = filter_type;
+    mask_set->dataset = NULL;
+    mask_set->product_offset = NULL;
+    mask_set->index_pair = NULL;
+
+    /* take over the dataset from the collocation result; it provides the source product lookup */
+    if (filter_type == harp_collocation_left)
+    {
+        mask_set->dataset = collocation_result->dataset_a;
+        collocation_result->dataset_a = NULL;
+    }
+    else
+    {
+        mask_set->dataset = collocation_result->dataset_b;
+        collocation_result->dataset_b = NULL;
+    }
+    num_products = mask_set->dataset->num_products;
+
+    mask_set->product_offset = (long *)calloc(num_products + 1, sizeof(long));
+    if (mask_set->product_offset == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (num_products + 1) * sizeof(long), __FILE__, __LINE__);
+        harp_collocation_mask_set_delete(mask_set);
+        return -1;
+    }
+    if (collocation_result->num_pairs > 0)
+    {
+        mask_set->index_pair = (harp_collocation_index_pair *)malloc(collocation_result->num_pairs *
+                                                                     sizeof(harp_collocation_index_pair));
+        if (mask_set->index_pair == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           collocation_result->num_pairs * sizeof(harp_collocation_index_pair), __FILE__, __LINE__);
+            harp_collocation_mask_set_delete(mask_set);
+            return -1;
+        }
+    }
+
+    /* group the pairs by product, keeping the order of the pairs within each product */
+    for (i = 0; i < collocation_result->num_pairs; i++)
+    {
+        const harp_collocation_pair *pair = collocation_result->pair[i];
+
+        if (filter_type == harp_collocation_left)
+        {
+            mask_set->product_offset[pair->product_index_a + 1]++;
+        }
+        else
+        {
+            mask_set->product_offset[pair->product_index_b + 1]++;
+        }
+    }
+    for (i = 0; i < num_products; i++)
+    {
+        mask_set->product_offset[i + 1] += mask_set->product_offset[i];
+    }
+
+    position = (long *)malloc((num_products + 1) * sizeof(long));
+    if (position == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (num_products + 1) * sizeof(long), __FILE__, __LINE__);
+        harp_collocation_mask_set_delete(mask_set);
+        return -1;
+    }
+    memcpy(position, mask_set->product_offset, (num_products + 1) * sizeof(long));
+    for (i = 0; i < collocation_result->num_pairs; i++)
+    {
+        const harp_collocation_pair *pair = collocation_result->pair[i];
+        harp_collocation_index_pair *index_pair;
+
+        if (filter_type == harp_collocation_left)
+        {
+            index_pair = &mask_set->index_pair[position[pair->product_index_a]++];
+            index_pair->index = pair->sample_index_a;
+        }
+        else
+        {
+            index_pair = &mask_set->index_pair[position[pair->product_index_b]++];
+            index_pair->index = pair->sample_index_b;
+        }
+        index_pair->collocation_index = pair->collocation_index;
+    }
+    free(position);
+
+    *new_mask_set = mask_set;
+    return 0;
+}
+
+/* Read a collocation result file once and keep the collocation masks of all products of the given dataset.
+ * Use harp_collocation_mask_set_get_mask() to get the mask for a single product.
+ */
+int harp_collocation_mask_set_import(const char *filename, harp_collocation_filter_type filter_type,
+                                     harp_collocation_mask_set **new_mask_set)
 {
     harp_collocation_result *collocation_result;
-    harp_collocation_mask *mask;
+    harp_collocation_mask_set *mask_set;
 
     if (filename == NULL)
     {
@@ -237,13 +536,78 @@ int harp_collocation_mask_import(const char *filename, harp_collocation_filter_t
         return -1;
     }
 
-    if (collocation_mask_from_result(collocation_result, filter_type, source_product, &mask) != 0)
+    if (collocation_mask_set_from_result(collocation_result, filter_type, &mask_set) != 0)
     {
         harp_collocation_result_delete(collocation_result);
         return -1;
     }
     harp_collocation_result_delete(collocation_result);
 
+    *new_mask_set = mask_set;
+    return 0;
+}
+
+/* Create the collocation mask for a single product. The caller owns the returned mask (which may be reordered by
+ * harp_product_apply_collocation_mask()). An empty mask is returned if source_product is not part of the set.
+ */
+int harp_collocation_mask_set_get_mask(const harp_collocation_mask_set *mask_set, const char *source_product,
+                                       harp_collocation_mask **new_mask)
+{
+    harp_collocation_mask *mask;
+    long product_index;
+    long num_index_pairs;
+
+    if (collocation_mask_new(&mask) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_dataset_get_index_from_source_product(mask_set->dataset, source_product, &product_index) != 0)
+    {
+        /* source_product does not appear in the collocation result column */
+        *new_mask = mask;
+        return 0;
+    }
+
+    num_index_pairs = mask_set->product_offset[product_index + 1] - mask_set->product_offset[product_index];
+    if (num_index_pairs > 0)
+    {
+        mask->index_pair = (harp_collocation_index_pair *)malloc(num_index_pairs *
+                                                                 sizeof(harp_collocation_index_pair));
+        if (mask->index_pair == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_index_pairs * sizeof(harp_collocation_index_pair), __FILE__, __LINE__);
+            harp_collocation_mask_delete(mask);
+            return -1;
+        }
+        memcpy(mask->index_pair, &mask_set->index_pair[mask_set->product_offset[product_index]],
+               num_index_pairs * sizeof(harp_collocation_index_pair));
+        mask->num_index_pairs = num_index_pairs;
+    }
+
+    *new_mask = mask;
+    return 0;
+}
+
+int harp_collocation_mask_import(const char *filename, harp_collocation_filter_type filter_type,
+                                 const char *source_product, harp_collocation_mask **new_mask)
+{
+    harp_collocation_mask_set *mask_set;
+    harp_collocation_mask *mask;
+
+    if (harp_collocation_mask_set_import(filename, filter_type, &mask_set) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_collocation_mask_set_get_mask(mask_set, source_product, &mask) != 0)
+    {
+        harp_collocation_mask_set_delete(mask_set);
+        return -1;
+    }
+    harp_collocation_mask_set_delete(mask_set);
+
     *new_mask = mask;
     return 0;
 }
@@ -507,6 +871,7 @@ int harp_product_apply_collocation_mask(harp_product *product, harp_collocation_
     return 0;
 }
 
+/* the collocation result should only contain pairs that reference source_product_b */
 static int get_collocated_product(harp_collocation_result *collocation_result, const char *source_product_b,
                                   harp_product **product)
 {
@@ -515,10 +880,6 @@ static int get_collocated_product(harp_collocation_result *collocation_result, c
     harp_product *collocated_product;
     harp_collocation_pair *pair;
 
-    if (harp_collocation_result_filter_for_source_product_b(collocation_result, source_product_b) != 0)
-    {
-        return -1;
-    }
     if (collocation_result->num_pairs == 0)
     {
         *product = NULL;
@@ -539,7 +900,7 @@ static int get_collocated_product(harp_collocation_result *collocation_result, c
         return -1;
     }
 
-    if (harp_import(product_metadata->filename, NULL, NULL, &collocated_product) != 0)
+    if (harp_import_collocated_product(product_metadata->filename, &collocated_product) != 0)
     {
         harp_set_error(HARP_ERROR_IMPORT, "could not import file %s", product_metadata->filename);
         harp_collocation_mask_delete(mask);
@@ -561,20 +922,20 @@ static int get_collocated_product(harp_collocation_result *collocation_result, c
 int harp_collocation_result_get_filtered_product_b(harp_collocation_result *collocation_result,
                                                    const char *source_product, harp_product **product)
 {
-    harp_collocation_result *result_copy;
+    harp_collocation_result *product_view;
 
-    if (harp_collocation_result_shallow_copy(collocation_result, &result_copy) != 0)
+    if (harp_collocation_result_get_view_for_source_product_b(collocation_result, source_product, &product_view) != 0)
     {
         return -1;
     }
 
-    if (get_collocated_product(result_copy, source_product, product) != 0)
+    if (get_collocated_product(product_view, source_product, product) != 0)
     {
-        harp_collocation_result_shallow_delete(result_copy);
+        harp_collocation_result_view_delete(product_view);
         return -1;
     }
 
-    harp_collocation_result_shallow_delete(result_copy);
+    harp_collocation_result_view_delete(product_view);
 
     return 0;
 }
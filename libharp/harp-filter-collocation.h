@@ -46,10 +46,25 @@ typedef struct harp_collocation_mask_struct
     harp_collocation_index_pair *index_pair;
 } harp_collocation_mask;
 
+/* The collocation masks for all products of one dataset of a collocation result, partitioned by source product */
+typedef struct harp_collocation_mask_set_struct
+{
+    harp_collocation_filter_type filter_type;
+    harp_dataset *dataset;      /* dataset A (left) or B (right) of the collocation result */
+    long *product_offset;       /* index pairs of product i are in [product_offset[i], product_offset[i + 1]) */
+    harp_collocation_index_pair *index_pair;
+} harp_collocation_mask_set;
+
 void harp_collocation_mask_delete(harp_collocation_mask *mask);
 int harp_collocation_mask_import(const char *filename, harp_collocation_filter_type filter_type,
                                  const char *original_filename, harp_collocation_mask **new_mask);
 
+void harp_collocation_mask_set_delete(harp_collocation_mask_set *mask_set);
+int harp_collocation_mask_set_import(const char *filename, harp_collocation_filter_type filter_type,
+                                     harp_collocation_mask_set **new_mask_set);
+int harp_collocation_mask_set_get_mask(const harp_collocation_mask_set *mask_set, const char *source_product,
+                                       harp_collocation_mask **new_mask);
+
 int harp_product_apply_collocation_mask(harp_product *product, harp_collocation_mask *collocation_mask);
 
 #endif
@@ -30,11 +30,15 @@
  */
 
 #include "harp-filter.h"
+#include "harp-thread.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* minimum number of variable elements for which an additional thread is used when filtering a product */
+#define MIN_NUM_ELEMENTS_PER_THREAD 65536
+
 static void free_string_data(char **first, char **last)
 {
     for (; first != last; first++)
@@ -362,6 +366,209 @@ void harp_array_filter(harp_data_type data_type, int num_dimensions, const long
     }
 }
 
+/* Shrink the data of a variable after its elements have been compacted to the front of the data array. */
+static int shrink_variable(harp_variable *variable, long new_num_elements, const long *new_dimension)
+{
+    /* Adjust the size of the variable. */
+    if (new_num_elements < variable->num_elements)
+    {
+        if (harp_variable_reallocate_data(variable, new_num_elements) != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* Update variable attributes. */
+    variable->num_elements = new_num_elements;
+    memcpy(variable->dimension, new_dimension, variable->num_dimensions * sizeof(long));
+
+    return 0;
+}
+
+/* Ranges of consecutive indices that are set in a 1-D dimension mask. */
+typedef struct mask_runs_struct
+{
+    long num_runs;
+    long *start;
+    long *length;
+} mask_runs;
+
+static void mask_runs_delete(mask_runs *runs)
+{
+    if (runs != NULL)
+    {
+        if (runs->start != NULL)
+        {
+            free(runs->start);
+        }
+        if (runs->length != NULL)
+        {
+            free(runs->length);
+        }
+        free(runs);
+    }
+}
+
+static int mask_runs_new(const harp_dimension_mask *dimension_mask, mask_runs **new_runs)
+{
+    mask_runs *runs;
+    long num_runs;
+    long i;
+
+    assert(dimension_mask->num_dimensions == 1);
+
+    num_runs = 0;
+    for (i = 0; i < dimension_mask->num_elements; i++)
+    {
+        if (dimension_mask->mask[i] && (i == 0 || !dimension_mask->mask[i - 1]))
+        {
+            num_runs++;
+        }
+    }
+
+    runs = (mask_runs *)malloc(sizeof(mask_runs));
+    if (runs == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(mask_runs), __FILE__, __LINE__);
+        return -1;
+    }
+    runs->num_runs = 0;
+    runs->start = NULL;
+    runs->length = NULL;
+
+    if (num_runs > 0)
+    {
+        runs->start = (long *)malloc(num_runs * sizeof(long));
+        if (runs->start == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_runs * sizeof(long), __FILE__, __LINE__);
+            mask_runs_delete(runs);
+            return -1;
+        }
+        runs->length = (long *)malloc(num_runs * sizeof(long));
+        if (runs->length == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_runs * sizeof(long), __FILE__, __LINE__);
+            mask_runs_delete(runs);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < dimension_mask->num_elements; i++)
+    {
+        if (dimension_mask->mask[i])
+        {
+            if (i == 0 || !dimension_mask->mask[i - 1])
+            {
+                runs->start[runs->num_runs] = i;
+                runs->length[runs->num_runs] = 0;
+                runs->num_runs++;
+            }
+            runs->length[runs->num_runs - 1]++;
+        }
+    }
+    assert(runs->num_runs == num_runs);
+
+    *new_runs = runs;
+    return 0;
+}
+
+/* Filter the first dimension of a variable in place by moving each run of kept indices with a single memmove().
+ * No other dimension of the variable is allowed to be filtered.
+ */
+static int variable_filter_runs(harp_variable *variable, const mask_runs *runs, long masked_dimension_length)
+{
+    long new_dimension[HARP_MAX_NUM_DIMS];
+    long num_block_elements;
+    long block_size;
+    long target_index;
+    long i;
+
+    assert(variable->num_dimensions > 0);
+
+    if (masked_dimension_length == variable->dimension[0])
+    {
+        return 0;
+    }
+
+    /* the data is filtered in place */
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
+
+    num_block_elements = variable->num_elements / variable->dimension[0];
+    block_size = num_block_elements * harp_get_size_for_type(variable->data_type);
+
+    if (variable->data_type == harp_type_string)
+    {
+        long source_index = 0;
+
+        /* Free the strings in between the runs (and after the last run). */
+        for (i = 0; i <= runs->num_runs; i++)
+        {
+            long end_index = (i < runs->num_runs ? runs->start[i] : variable->dimension[0]);
+
+            harp_variable_free_strings(variable, source_index * num_block_elements,
+                                       (end_index - source_index) * num_block_elements);
+            if (i < runs->num_runs)
+            {
+                source_index = runs->start[i] + runs->length[i];
+            }
+        }
+    }
+
+    target_index = 0;
+    for (i = 0; i < runs->num_runs; i++)
+    {
+        if (runs->start[i] != target_index)
+        {
+            memmove((char *)variable->data.ptr + target_index * block_size,
+                    (char *)variable->data.ptr + runs->start[i] * block_size, runs->length[i] * block_size);
+        }
+        target_index += runs->length[i];
+    }
+    assert(target_index == masked_dimension_length);
+
+    if (variable->data_type == harp_type_string)
+    {
+        /* The trailing pointers have been moved and are no longer owned by this part of the array. */
+        memset(variable->data.string_data + target_index * num_block_elements, 0,
+               (variable->num_elements - target_index * num_block_elements) * sizeof(char *));
+    }
+
+    new_dimension[0] = masked_dimension_length;
+    memcpy(&new_dimension[1], &variable->dimension[1], (variable->num_dimensions - 1) * sizeof(long));
+
+    return shrink_variable(variable, target_index * num_block_elements, new_dimension);
+}
+
+/* Returns 1 if the time dimension is the only dimension of the variable that is filtered by the dimension mask set. */
+static int is_filtered_on_time_only(const harp_variable *variable, const harp_dimension_mask_set *dimension_mask_set)
+{
+    int i;
+
+    if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        return 0;
+    }
+
+    for (i = 1; i < variable->num_dimensions; i++)
+    {
+        harp_dimension_type dimension_type = variable->dimension_type[i];
+
+        if (dimension_type != harp_dimension_independent && dimension_mask_set[dimension_type] != NULL)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 int harp_variable_filter(harp_variable *variable, const harp_dimension_mask_set *dimension_mask_set)
 {
     const uint8_t *mask[HARP_MAX_NUM_DIMS] = { 0 };
@@ -442,6 +649,17 @@ int harp_variable_filter(harp_variable *variable, const harp_dimension_mask_set
         return 0;
     }
 
+    /* the generic filter routines free strings individually */
+    if (variable->data_type == harp_type_string && harp_variable_make_strings_owned(variable) != 0)
+    {
+        return -1;
+    }
+    /* the data is filtered in place */
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
+
     if (!has_2D_masks)
     {
         harp_array_filter(variable->data_type, variable->num_dimensions, variable->dimension, mask, variable->data,
@@ -520,30 +738,71 @@ int harp_variable_filter(harp_variable *variable, const harp_dimension_mask_set
                          variable->data.string_data + variable->num_elements);
     }
 
-    /* Adjust the size of the variable. */
-    if (new_num_elements < variable->num_elements)
+    return shrink_variable(variable, new_num_elements, new_dimension);
+}
+
+/* shared data for filtering the variables of a product in parallel */
+typedef struct product_filter_info_struct
+{
+    harp_product *product;
+    const harp_dimension_mask_set *dimension_mask_set;
+    const mask_runs *time_runs;
+} product_filter_info;
+
+static int product_filter_variable(void *arg, long index)
+{
+    product_filter_info *info = (product_filter_info *)arg;
+    const harp_dimension_mask_set *dimension_mask_set = info->dimension_mask_set;
+    harp_variable *variable = info->product->variable[index];
+
+    if (info->time_runs != NULL && is_filtered_on_time_only(variable, dimension_mask_set))
     {
-        void *new_data;
+        assert(variable->dimension[0] == dimension_mask_set[harp_dimension_time]->num_elements);
 
-        new_data = realloc(variable->data.ptr, new_num_elements * harp_get_size_for_type(variable->data_type));
-        if (new_data == NULL)
+        return variable_filter_runs(variable, info->time_runs,
+                                    dimension_mask_set[harp_dimension_time]->masked_dimension_length);
+    }
+
+    /* if we have a 2D dim filter then make sure that the variable has a time dimension */
+    if (variable->num_dimensions > 0 && variable->dimension_type[0] != harp_dimension_time)
+    {
+        int j;
+
+        for (j = 0; j < variable->num_dimensions; j++)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %u bytes) (%s:%u)",
-                           new_num_elements * harp_get_size_for_type(variable->data_type), __FILE__, __LINE__);
-            return -1;
+            harp_dimension_type dimension_type = variable->dimension_type[j];
+
+            if (dimension_type == harp_dimension_independent || dimension_mask_set[dimension_type] == NULL)
+            {
+                continue;
+            }
+
+            if (dimension_mask_set[dimension_type]->num_dimensions == 2)
+            {
+                break;
+            }
         }
-        variable->data.ptr = new_data;
-    }
 
-    /* Update variable attributes. */
-    variable->num_elements = new_num_elements;
-    memcpy(variable->dimension, new_dimension, variable->num_dimensions * sizeof(long));
+        if (j != variable->num_dimensions)
+        {
+            assert(info->product->dimension[harp_dimension_time] > 0);
 
-    return 0;
+            if (harp_variable_add_dimension(variable, 0, harp_dimension_time,
+                                            info->product->dimension[harp_dimension_time]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return harp_variable_filter(variable, dimension_mask_set);
 }
 
 int harp_product_filter(harp_product *product, const harp_dimension_mask_set *dimension_mask_set)
 {
+    product_filter_info info;
+    mask_runs *time_runs = NULL;
+    long num_elements = 0;
     int i;
 
     if (dimension_mask_set == NULL)
@@ -563,49 +822,34 @@ int harp_product_filter(harp_product *product, const harp_dimension_mask_set *di
         }
     }
 
-    /* Filter all variables in the product. */
-    for (i = 0; i < product->num_variables; i++)
+    /* The mask for the time dimension is shared by most variables, so convert it into runs of consecutive indices once.
+     */
+    if (dimension_mask_set[harp_dimension_time] != NULL)
     {
-        harp_variable *variable = product->variable[i];
-
-        /* if we have a 2D dim filter then make sure that the variable has a time dimension */
-        if (variable->num_dimensions > 0 && variable->dimension_type[0] != harp_dimension_time)
-        {
-            int j;
-
-            for (j = 0; j < variable->num_dimensions; j++)
-            {
-                harp_dimension_type dimension_type = variable->dimension_type[j];
-
-                if (dimension_type == harp_dimension_independent || dimension_mask_set[dimension_type] == NULL)
-                {
-                    continue;
-                }
-
-                if (dimension_mask_set[dimension_type]->num_dimensions == 2)
-                {
-                    break;
-                }
-            }
-
-            if (j != variable->num_dimensions)
-            {
-                assert(product->dimension[harp_dimension_time] > 0);
-
-                if (harp_variable_add_dimension(variable, 0, harp_dimension_time,
-                                                product->dimension[harp_dimension_time]) != 0)
-                {
-                    return -1;
-                }
-            }
-        }
-
-        if (harp_variable_filter(variable, dimension_mask_set) != 0)
+        if (mask_runs_new(dimension_mask_set[harp_dimension_time], &time_runs) != 0)
         {
             return -1;
         }
     }
 
+    /* Filter all variables in the product. The variables are independent of each other, so they can be filtered in
+     * parallel.
+     */
+    for (i = 0; i < product->num_variables; i++)
+    {
+        num_elements += product->variable[i]->num_elements;
+    }
+    info.product = product;
+    info.dimension_mask_set = dimension_mask_set;
+    info.time_runs = time_runs;
+    if (harp_run_for_each(product->num_variables, num_elements, MIN_NUM_ELEMENTS_PER_THREAD, product_filter_variable,
+                          &info) != 0)
+    {
+        mask_runs_delete(time_runs);
+        return -1;
+    }
+    mask_runs_delete(time_runs);
+
     /* Update product dimensions. */
     for (i = 0; i < HARP_NUM_DIM_TYPES; i++)
     {
@@ -734,6 +734,284 @@ int harp_spherical_polygon_overlapping(const harp_spherical_polygon *polygon_a,
     return 0;
 }
 
+/* Maximum combined number of vertices of two polygons for which the convex clipping kernel is used */
+#define CONVEX_CLIP_MAX_VERTICES 32
+
+/* Convert the vertices of a polygon to unit vectors and determine the inward pointing unit normals of the great
+ * circles through its edges.
+ * Returns 1 if the polygon is strictly convex (all vertices are on the inner side of all edge planes), 0 otherwise.
+ */
+static int convex_polygon_from_spherical_polygon(const harp_spherical_polygon *polygon, harp_vector3d *vertex,
+                                                 harp_vector3d *normal)
+{
+    int32_t num_vertices = polygon->numberofpoints;
+    double orientation = 0;
+    int32_t i, j;
+
+    for (i = 0; i < num_vertices; i++)
+    {
+        harp_vector3d_from_spherical_point(&vertex[i], &polygon->point[i]);
+    }
+    for (i = 0; i < num_vertices; i++)
+    {
+        double norm;
+
+        harp_vector3d_crossproduct(&normal[i], &vertex[i], &vertex[i == num_vertices - 1 ? 0 : i + 1]);
+        norm = harp_vector3d_norm(&normal[i]);
+        if (HARP_GEOMETRY_FPzero(norm))
+        {
+            /* degenerate edge */
+            return 0;
+        }
+        normal[i].x /= norm;
+        normal[i].y /= norm;
+        normal[i].z /= norm;
+    }
+
+    /* all vertices that are not on an edge need to be strictly on the same side of that edge */
+    for (i = 0; i < num_vertices; i++)
+    {
+        for (j = 0; j < num_vertices; j++)
+        {
+            double distance;
+
+            if (j == i || j == (i == num_vertices - 1 ? 0 : i + 1))
+            {
+                continue;
+            }
+            distance = harp_vector3d_dotproduct(&normal[i], &vertex[j]);
+            if (orientation == 0)
+            {
+                orientation = distance;
+            }
+            if (HARP_GEOMETRY_FPzero(distance) || (distance < 0) != (orientation < 0))
+            {
+                return 0;
+            }
+        }
+    }
+
+    if (orientation < 0)
+    {
+        for (i = 0; i < num_vertices; i++)
+        {
+            normal[i].x = -normal[i].x;
+            normal[i].y = -normal[i].y;
+            normal[i].z = -normal[i].z;
+        }
+    }
+
+    return 1;
+}
+
+/* Return the surface area (in [rad2]) of a convex polygon given as unit vectors.
+ * The polygon is split into a fan of triangles for which the area is calculated using the formula of
+ * Van Oosterom and Strackee: tan(E/2) = a.(b x c) / (1 + a.b + b.c + c.a)
+ */
+static double convex_polygon_get_surface_area(int num_vertices, const harp_vector3d *vertex)
+{
+    double area = 0;
+    int i;
+
+    for (i = 1; i < num_vertices - 1; i++)
+    {
+        harp_vector3d cross;
+        double numerator;
+        double denominator;
+
+        harp_vector3d_crossproduct(&cross, &vertex[i], &vertex[i + 1]);
+        numerator = harp_vector3d_dotproduct(&vertex[0], &cross);
+        denominator = 1 + harp_vector3d_dotproduct(&vertex[0], &vertex[i]) +
+            harp_vector3d_dotproduct(&vertex[i], &vertex[i + 1]) +
+            harp_vector3d_dotproduct(&vertex[i + 1], &vertex[0]);
+        area += 2 * atan2(numerator, denominator);
+    }
+
+    return fabs(area);
+}
+
+/* Determine whether all vertices are (within the geometry tolerance) on the inner side of all given edge planes */
+static int convex_polygon_inside_planes(int num_vertices, const harp_vector3d *vertex, int num_planes,
+                                        const harp_vector3d *normal)
+{
+    int i, j;
+
+    for (j = 0; j < num_planes; j++)
+    {
+        for (i = 0; i < num_vertices; i++)
+        {
+            if (harp_vector3d_dotproduct(&normal[j], &vertex[i]) < -HARP_GEOMETRY_EPSILON)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Determine whether all vertices are strictly on the outer side of one of the given edge planes */
+static int convex_polygon_outside_planes(int num_vertices, const harp_vector3d *vertex, int num_planes,
+                                         const harp_vector3d *normal)
+{
+    int i, j;
+
+    for (j = 0; j < num_planes; j++)
+    {
+        for (i = 0; i < num_vertices; i++)
+        {
+            if (harp_vector3d_dotproduct(&normal[j], &vertex[i]) >= -HARP_GEOMETRY_EPSILON)
+            {
+                break;
+            }
+        }
+        if (i == num_vertices)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Calculate the overlapping fraction of two polygons if both polygons are strictly convex.
+ * The intersection is computed by clipping polygon a against the great circle planes through the edges of polygon b
+ * (Sutherland-Hodgman) using only vector arithmetic and stack buffers.
+ * Returns 1 if the result could be determined, and 0 if the general algorithm should be used instead (non-convex or
+ * large polygons, or polygons that only touch each other).
+ */
+static int convex_polygon_overlapping_fraction(const harp_spherical_polygon *polygon_a,
+                                               const harp_spherical_polygon *polygon_b, int *polygons_are_overlapping,
+                                               double *overlapping_fraction)
+{
+    harp_vector3d vertex_a[CONVEX_CLIP_MAX_VERTICES];
+    harp_vector3d vertex_b[CONVEX_CLIP_MAX_VERTICES];
+    harp_vector3d normal_a[CONVEX_CLIP_MAX_VERTICES];
+    harp_vector3d normal_b[CONVEX_CLIP_MAX_VERTICES];
+    harp_vector3d buffer[2][CONVEX_CLIP_MAX_VERTICES];
+    harp_vector3d *clip_in;
+    harp_vector3d *clip_out;
+    int32_t num_a = polygon_a->numberofpoints;
+    int32_t num_b = polygon_b->numberofpoints;
+    int num_clip;
+    double area_a;
+    double area_b;
+    double area_ab;
+    double min_area_a_area_b;
+    int32_t i, j;
+
+    if (num_a < 3 || num_b < 3 || num_a + num_b > CONVEX_CLIP_MAX_VERTICES)
+    {
+        return 0;
+    }
+    if (!convex_polygon_from_spherical_polygon(polygon_a, vertex_a, normal_a) ||
+        !convex_polygon_from_spherical_polygon(polygon_b, vertex_b, normal_b))
+    {
+        return 0;
+    }
+
+    if (convex_polygon_outside_planes(num_a, vertex_a, num_b, normal_b) ||
+        convex_polygon_outside_planes(num_b, vertex_b, num_a, normal_a))
+    {
+        /* there is a separating edge */
+        *overlapping_fraction = 0.0;
+        *polygons_are_overlapping = 0;
+        return 1;
+    }
+    if (convex_polygon_inside_planes(num_a, vertex_a, num_b, normal_b) ||
+        convex_polygon_inside_planes(num_b, vertex_b, num_a, normal_a))
+    {
+        /* one polygon contains the other */
+        *overlapping_fraction = 1.0;
+        *polygons_are_overlapping = 1;
+        return 1;
+    }
+
+    memcpy(buffer[0], vertex_a, num_a * sizeof(harp_vector3d));
+    clip_in = buffer[0];
+    clip_out = buffer[1];
+    num_clip = num_a;
+    for (j = 0; j < num_b && num_clip >= 3; j++)
+    {
+        int num_out = 0;
+        harp_vector3d *start = &clip_in[num_clip - 1];
+        double distance_start = harp_vector3d_dotproduct(&normal_b[j], start);
+
+        for (i = 0; i < num_clip; i++)
+        {
+            harp_vector3d *end = &clip_in[i];
+            double distance_end = harp_vector3d_dotproduct(&normal_b[j], end);
+
+            if ((distance_start < 0) != (distance_end < 0))
+            {
+                /* the point on the great circle arc between start and end that lies on the edge plane */
+                harp_vector3d *crossing = &clip_out[num_out];
+                double norm;
+
+                if (num_out == CONVEX_CLIP_MAX_VERTICES)
+                {
+                    return 0;
+                }
+                crossing->x = distance_start * end->x - distance_end * start->x;
+                crossing->y = distance_start * end->y - distance_end * start->y;
+                crossing->z = distance_start * end->z - distance_end * start->z;
+                norm = harp_vector3d_norm(crossing);
+                if (distance_start < 0)
+                {
+                    norm = -norm;
+                }
+                crossing->x /= norm;
+                crossing->y /= norm;
+                crossing->z /= norm;
+                num_out++;
+            }
+            if (distance_end >= 0)
+            {
+                if (num_out == CONVEX_CLIP_MAX_VERTICES)
+                {
+                    return 0;
+                }
+                clip_out[num_out] = *end;
+                num_out++;
+            }
+            start = end;
+            distance_start = distance_end;
+        }
+        clip_in = clip_out;
+        clip_out = (clip_in == buffer[0] ? buffer[1] : buffer[0]);
+        num_clip = num_out;
+    }
+
+    area_ab = num_clip >= 3 ? convex_polygon_get_surface_area(num_clip, clip_in) : 0.0;
+    if (HARP_GEOMETRY_FPzero(area_ab))
+    {
+        /* the polygons (almost) only touch; leave this to the general algorithm */
+        return 0;
+    }
+
+    area_a = convex_polygon_get_surface_area(num_a, vertex_a);
+    area_b = convex_polygon_get_surface_area(num_b, vertex_b);
+
+    /* Overlapping fraction = areaAB / min(areaA, areaB) */
+    min_area_a_area_b = (area_a < area_b ? area_a : area_b);
+    if (HARP_GEOMETRY_FPzero(CONST_EARTH_RADIUS_WGS84_SPHERE * CONST_EARTH_RADIUS_WGS84_SPHERE * min_area_a_area_b))
+    {
+        /* just set to 1 if area_a/area_b is too small */
+        *overlapping_fraction = 1.0;
+    }
+    else
+    {
+        *overlapping_fraction = area_ab / min_area_a_area_b;
+        if (*overlapping_fraction > 1.0)
+        {
+            *overlapping_fraction = 1.0;
+        }
+    }
+    *polygons_are_overlapping = 1;
+
+    return 1;
+}
+
 /* Determine whether two polygons overlap, and if so
  * calculate the overlapping fraction of the two polygons */
 int harp_spherical_polygon_overlapping_fraction(const harp_spherical_polygon *polygon_a,
@@ -742,6 +1020,12 @@ int harp_spherical_polygon_overlapping_fraction(const harp_spherical_polygon *po
 {
     int8_t relationship;
 
+    /* Footprints are almost always small convex polygons, for which there is a much cheaper algorithm */
+    if (convex_polygon_overlapping_fraction(polygon_a, polygon_b, polygons_are_overlapping, overlapping_fraction))
+    {
+        return 0;
+    }
+
     /* First, determine relationship of two areas */
     relationship = harp_spherical_polygon_spherical_polygon_relationship(polygon_a, polygon_b, 0);
     if (relationship == HARP_GEOMETRY_POLY_CONTAINS || relationship == HARP_GEOMETRY_POLY_CONTAINED)
@@ -806,7 +1090,7 @@ int harp_spherical_polygon_overlapping_fraction(const harp_spherical_polygon *po
 
         if (harp_spherical_polygon_new(num_intersection_points, &polygon_intersect) != 0)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create polygon) (%s:%u)" __FILE__,
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create polygon) (%s:%u)", __FILE__,
                            __LINE__);
             free(point_a_in_polygon_b);
             free(point_b_in_polygon_a);
@@ -921,6 +1205,7 @@ int harp_spherical_polygon_overlapping_fraction(const harp_spherical_polygon *po
         if (harp_spherical_polygon_check(polygon_intersect) != 0)
         {
             harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid intersection polygon");
+            harp_spherical_polygon_delete(polygon_intersect);
             return -1;
         }
 
@@ -1240,6 +1525,7 @@ LIBHARP_API int harp_geometry_has_area_overlap(int num_vertices_a, double *latit
     if (harp_spherical_polygon_from_latitude_longitude_bounds(0, num_vertices_b, latitude_bounds_b, longitude_bounds_b,
                                                               &polygon_b) != 0)
     {
+        harp_spherical_polygon_delete(polygon_a);
         return -1;
     }
 
@@ -1269,6 +1555,201 @@ LIBHARP_API int harp_geometry_has_area_overlap(int num_vertices_a, double *latit
     return 0;
 }
 
+struct harp_area_cache_struct
+{
+    long num_areas;
+    int num_vertices;
+    const double *latitude_bounds;
+    const double *longitude_bounds;
+    harp_spherical_polygon **polygon;   /* NULL for areas that have not been converted yet (or that are invalid) */
+};
+
+/** Create a cache for the spherical polygons of an array of areas.
+ * \ingroup harp_geometry
+ * The polygon for an area is constructed (and checked) the first time it is needed and is then reused for all
+ * subsequent tests on that area. This makes the cache functions much faster than harp_geometry_has_point_in_area()
+ * or harp_geometry_has_area_overlap() when the same area is tested many times.
+ * The cache only keeps a reference to the latitude/longitude bounds, so these arrays should remain valid (and
+ * unmodified) for the lifetime of the cache. An area cache should not be used from multiple threads simultaneously.
+ * \param num_areas The number of areas
+ * \param num_vertices The number of vertices of the bounding polygon of each area
+ * \param latitude_bounds Latitude values of the bounds of the areas (num_areas x num_vertices values)
+ * \param longitude_bounds Longitude values of the bounds of the areas (num_areas x num_vertices values)
+ * \param new_cache Pointer to the C variable where the new area cache will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_area_cache_new(long num_areas, int num_vertices, const double *latitude_bounds,
+                                    const double *longitude_bounds, harp_area_cache **new_cache)
+{
+    harp_area_cache *cache;
+    long i;
+
+    if (num_areas < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_areas argument < 0 (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (num_areas > 0 && (latitude_bounds == NULL || longitude_bounds == NULL))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "latitude_bounds or longitude_bounds is NULL (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    cache = (harp_area_cache *)malloc(sizeof(harp_area_cache));
+    if (cache == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_area_cache), __FILE__, __LINE__);
+        return -1;
+    }
+    cache->num_areas = num_areas;
+    cache->num_vertices = num_vertices;
+    cache->latitude_bounds = latitude_bounds;
+    cache->longitude_bounds = longitude_bounds;
+    cache->polygon = NULL;
+
+    if (num_areas > 0)
+    {
+        cache->polygon = (harp_spherical_polygon **)malloc(num_areas * sizeof(harp_spherical_polygon *));
+        if (cache->polygon == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_areas * sizeof(harp_spherical_polygon *), __FILE__, __LINE__);
+            harp_area_cache_delete(cache);
+            return -1;
+        }
+        for (i = 0; i < num_areas; i++)
+        {
+            cache->polygon[i] = NULL;
+        }
+    }
+
+    *new_cache = cache;
+    return 0;
+}
+
+/** Delete an area cache.
+ * \ingroup harp_geometry
+ * \param cache Area cache that should be deleted.
+ */
+LIBHARP_API void harp_area_cache_delete(harp_area_cache *cache)
+{
+    if (cache != NULL)
+    {
+        if (cache->polygon != NULL)
+        {
+            long i;
+
+            for (i = 0; i < cache->num_areas; i++)
+            {
+                if (cache->polygon[i] != NULL)
+                {
+                    harp_spherical_polygon_delete(cache->polygon[i]);
+                }
+            }
+            free(cache->polygon);
+        }
+        free(cache);
+    }
+}
+
+static int area_cache_get_polygon(harp_area_cache *cache, long index, harp_spherical_polygon **polygon)
+{
+    if (index < 0 || index >= cache->num_areas)
+    {
+        harp_set_error(HARP_ERROR_INVALID_INDEX, "index (%ld) is not in the range [0,%ld) (%s:%u)", index,
+                       cache->num_areas, __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (cache->polygon[index] == NULL)
+    {
+        /* for invalid areas the conversion is repeated, so each failing test produces the proper error message */
+        if (harp_spherical_polygon_from_latitude_longitude_bounds(index, cache->num_vertices, cache->latitude_bounds,
+                                                                  cache->longitude_bounds, &cache->polygon[index]) != 0)
+        {
+            cache->polygon[index] = NULL;
+            return -1;
+        }
+    }
+
+    *polygon = cache->polygon[index];
+    return 0;
+}
+
+/** Determine whether a point is in an area of an area cache
+ * \ingroup harp_geometry
+ * This function assumes a spherical earth. It gives the same result as harp_geometry_has_point_in_area().
+ * \param cache Area cache.
+ * \param index Index of the area in the cache.
+ * \param latitude_point Latitude of the point
+ * \param longitude_point Longitude of the point
+ * \param in_area Pointer to the C variable where the result will be stored (1 if point is in the area, 0 otherwise).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_area_cache_has_point_in_area(harp_area_cache *cache, long index, double latitude_point,
+                                                  double longitude_point, int *in_area)
+{
+    harp_spherical_polygon *polygon;
+    harp_spherical_point point;
+
+    if (area_cache_get_polygon(cache, index, &polygon) != 0)
+    {
+        return -1;
+    }
+
+    point.lat = latitude_point;
+    point.lon = longitude_point;
+    harp_spherical_point_rad_from_deg(&point);
+    harp_spherical_point_check(&point);
+
+    *in_area = harp_spherical_polygon_contains_point(polygon, &point);
+
+    return 0;
+}
+
+/** Determine whether two areas from area caches overlap
+ * \ingroup harp_geometry
+ * This function assumes a spherical earth. It gives the same result as harp_geometry_has_area_overlap().
+ * The overlap fraction is calculated as area(intersection)/min(area(A),area(B)).
+ * \param cache_a Area cache for the first area.
+ * \param index_a Index of the first area in \a cache_a.
+ * \param cache_b Area cache for the second area (can be the same as \a cache_a).
+ * \param index_b Index of the second area in \a cache_b.
+ * \param has_overlap Pointer to the C variable where the result will be stored (1 if there is overlap, 0 otherwise).
+ * \param fraction Pointer to the C variable where the overlap fraction will be stored (use NULL if not needed).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_area_cache_has_area_overlap(harp_area_cache *cache_a, long index_a, harp_area_cache *cache_b,
+                                                 long index_b, int *has_overlap, double *fraction)
+{
+    harp_spherical_polygon *polygon_a;
+    harp_spherical_polygon *polygon_b;
+
+    if (area_cache_get_polygon(cache_a, index_a, &polygon_a) != 0)
+    {
+        return -1;
+    }
+    if (area_cache_get_polygon(cache_b, index_b, &polygon_b) != 0)
+    {
+        return -1;
+    }
+
+    if (fraction != NULL)
+    {
+        return harp_spherical_polygon_overlapping_fraction(polygon_a, polygon_b, has_overlap, fraction);
+    }
+
+    return harp_spherical_polygon_overlapping(polygon_a, polygon_b, has_overlap);
+}
+
 /** Calculate the area size for a polygon on the surface of the Earth
  * \ingroup harp_geometry
  * This function assumes a spherical earth.
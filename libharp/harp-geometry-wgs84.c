@@ -174,7 +174,7 @@ int harp_wgs84_ellipsoid_point_distance_from_latitude_and_longitude(double latit
 
         sin_sigma =
             sqrt(cos_ub * cos_ub * sin_lambda * sin_lambda +
-                 (cos_ub * sin_ua - sin_ua * cos_ub * cos_lambda) * (cos_ub * sin_ua - sin_ua * cos_ub * cos_lambda));
+                 (cos_ua * sin_ub - sin_ua * cos_ub * cos_lambda) * (cos_ua * sin_ub - sin_ua * cos_ub * cos_lambda));
 
         if (sin_sigma == 0.0)
         {
@@ -187,7 +187,7 @@ int harp_wgs84_ellipsoid_point_distance_from_latitude_and_longitude(double latit
         cos_sigma = sin_ua * sin_ub + cos_ua * cos_ub * cos_lambda;
         sigma = atan2(sin_sigma, cos_sigma);
 
-        sin_alpha = cos_ua * sin_ua * sin_lambda / sin_sigma;
+        sin_alpha = cos_ua * cos_ub * sin_lambda / sin_sigma;
 
         /* cos2alpha = cos(alpha) * cos(alpha) */
         cos2alpha = 1.0 - sin_alpha * sin_alpha;
@@ -204,7 +204,7 @@ int harp_wgs84_ellipsoid_point_distance_from_latitude_and_longitude(double latit
             cos2sigmam = cos_sigma - 2.0 * sin_ua * sin_ub / cos2alpha;
         }
 
-        C = f / 16.0 * cos2alpha * (4.0 - 3.0 * cos2alpha);
+        C = f / 16.0 * cos2alpha * (4.0 + f * (4.0 - 3.0 * cos2alpha));
 
         lambda_previous = lambda;
 
@@ -233,3 +233,107 @@ int harp_wgs84_ellipsoid_point_distance_from_latitude_and_longitude(double latit
     *new_point_distance = point_distance;
     return 0;
 }
+
+/* Convert a point [rad] to the unit vector of the corresponding point on the auxiliary sphere of the WGS84 ellipsoid
+ * (i.e. using the parametric latitude instead of the geodetic latitude).
+ */
+void harp_wgs84_ellipsoid_parametric_vector3d_from_spherical_point(harp_vector3d *vector,
+                                                                   const harp_spherical_point *point)
+{
+    double f = (double)(CONST_FLATTENING_WGS84_ELLIPSOID);
+    double sin_phi = sin(point->lat);
+    double cos_phi = cos(point->lat);
+    double norm = sqrt(cos_phi * cos_phi + (1.0 - f) * (1.0 - f) * sin_phi * sin_phi);
+    double cos_u = cos_phi / norm;
+
+    vector->x = cos_u * cos(point->lon);
+    vector->y = cos_u * sin(point->lon);
+    vector->z = (1.0 - f) * sin_phi / norm;
+}
+
+/* Return the point distance [m] on the WGS84 ellipsoid between two points that are given as unit vectors on the
+ * auxiliary sphere (see harp_wgs84_ellipsoid_parametric_vector3d_from_spherical_point()).
+ * This uses the Andoyer-Lambert formula, which is first order in the flattening. Compared to the iterative solution
+ * of harp_wgs84_ellipsoid_point_distance_from_latitude_and_longitude() the relative error is below 1.5e-6 (i.e. at
+ * most 0.15m per 100km) for all points that are not nearly antipodal, but the computational cost is comparable to that
+ * of a spherical distance. Unlike the iterative solution, the formula remains well defined for antipodal points.
+ */
+double harp_wgs84_ellipsoid_parametric_vector3d_distance(const harp_vector3d *vector_a, const harp_vector3d *vector_b)
+{
+    double a = (double)(CONST_SEMI_MAJOR_AXIS_WGS84_ELLIPSOID);
+    double f = (double)(CONST_FLATTENING_WGS84_ELLIPSOID);
+    harp_vector3d cross;
+    harp_vector3d sum;
+    harp_vector3d difference;
+    double sin_sigma;
+    double sigma;
+    double sum_norm_squared;
+    double difference_norm_squared;
+    double X = 0.0;
+    double Y = 0.0;
+
+    harp_vector3d_crossproduct(&cross, vector_a, vector_b);
+    sin_sigma = harp_vector3d_norm(&cross);
+    sigma = atan2(sin_sigma, harp_vector3d_dotproduct(vector_a, vector_b));
+    if (sigma == 0.0)
+    {
+        return 0.0;
+    }
+
+    /* with P and Q the mean and half difference of the parametric latitudes we have
+     * sin(P)cos(Q) = (sum.z)/2, cos(P)sin(Q) = (difference.z)/2, cos^2(sigma/2) = |sum|^2/4 and
+     * sin^2(sigma/2) = |difference|^2/4 */
+    sum.x = vector_a->x + vector_b->x;
+    sum.y = vector_a->y + vector_b->y;
+    sum.z = vector_a->z + vector_b->z;
+    difference.x = vector_b->x - vector_a->x;
+    difference.y = vector_b->y - vector_a->y;
+    difference.z = vector_b->z - vector_a->z;
+    sum_norm_squared = harp_vector3d_dotproduct(&sum, &sum);
+    difference_norm_squared = harp_vector3d_dotproduct(&difference, &difference);
+    if (sum_norm_squared > 0)
+    {
+        X = (sigma - sin_sigma) * sum.z * sum.z / sum_norm_squared;
+    }
+    if (difference_norm_squared > 0)
+    {
+        Y = (sigma + sin_sigma) * difference.z * difference.z / difference_norm_squared;
+    }
+
+    return a * (sigma - f / 2.0 * (X + Y));
+}
+
+/** Calculate the distance between two points on the surface of the WGS84 ellipsoid in meters
+ * \ingroup harp_geometry
+ * This uses the Andoyer-Lambert approximation of the geodesic distance on the ellipsoid.
+ * The relative error of the result is less than 1.5e-6 (i.e. at most 0.15m per 100km of distance) for all points
+ * that are not nearly antipodal.
+ * \param latitude_a Latitude of first point
+ * \param longitude_a Longitude of first point
+ * \param latitude_b Latitude of second point
+ * \param longitude_b Longitude of second point
+ * \param distance Pointer to the C variable where the surface distance in [m] between the two points will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_geometry_get_point_distance_wgs84(double latitude_a, double longitude_a, double latitude_b,
+                                                       double longitude_b, double *distance)
+{
+    harp_spherical_point point_a, point_b;
+    harp_vector3d vector_a, vector_b;
+
+    point_a.lat = latitude_a * (double)(CONST_DEG2RAD);
+    point_a.lon = longitude_a * (double)(CONST_DEG2RAD);
+    point_b.lat = latitude_b * (double)(CONST_DEG2RAD);
+    point_b.lon = longitude_b * (double)(CONST_DEG2RAD);
+
+    harp_spherical_point_check(&point_a);
+    harp_spherical_point_check(&point_b);
+
+    harp_wgs84_ellipsoid_parametric_vector3d_from_spherical_point(&vector_a, &point_a);
+    harp_wgs84_ellipsoid_parametric_vector3d_from_spherical_point(&vector_b, &point_b);
+    *distance = harp_wgs84_ellipsoid_parametric_vector3d_distance(&vector_a, &vector_b);
+
+    return 0;
+}
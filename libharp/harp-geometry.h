@@ -264,6 +264,9 @@ void harp_wgs84_ellipsoid_latitude_longitude_from_cartesian_coordinates(double x
 int harp_wgs84_ellipsoid_point_distance_from_latitude_and_longitude(double latitude_a, double longitude_a,
                                                                     double latitude_b, double longitude_b,
                                                                     double *point_distance);
+void harp_wgs84_ellipsoid_parametric_vector3d_from_spherical_point(harp_vector3d *vector,
+                                                                   const harp_spherical_point *point);
+double harp_wgs84_ellipsoid_parametric_vector3d_distance(const harp_vector3d *vector_a, const harp_vector3d *vector_b);
 
 void harp_geographic_average(double latitude_p, double longitude_p, double latitude_q, double longitude_q,
                              double *average_latitude, double *average_longitude);
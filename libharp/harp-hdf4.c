@@ -33,6 +33,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "hdf.h"
 #include "mfhdf.h"
@@ -52,6 +53,12 @@ typedef enum hdf4_dimension_type_enum
     hdf4_dimension_scalar
 } hdf4_dimension_type;
 
+static intn close_file(int32 sd_id)
+{
+    harp_io_statistics_add_close(harp_io_backend_hdf4);
+    return SDend(sd_id);
+}
+
 static const char *get_dimension_type_name(hdf4_dimension_type dimension_type)
 {
     switch (dimension_type)
@@ -389,7 +396,50 @@ static int read_dimensions(int32 sds_id, int *num_dimensions, hdf4_dimension_typ
     return 0;
 }
 
-static int read_variable(harp_product *product, int32 sds_id)
+/* Make sure the chunk cache of a chunked dataset can hold all chunks that cover a single row of chunks along the first
+ * dimension. SDreaddata() traverses the data in row-major order, so with a smaller cache each chunk would be read (and
+ * decompressed) once for every row of elements that it contains.
+ */
+static int set_chunk_cache(int32 sds_id, int32 num_dimensions, const int32 *dimension)
+{
+    HDF_CHUNK_DEF chunk_def;
+    int32 flags;
+    int32 num_chunks = 1;
+    int i;
+
+    if (SDgetchunkinfo(sds_id, &chunk_def, &flags) != 0)
+    {
+        harp_set_error(HARP_ERROR_HDF4, NULL);
+        return -1;
+    }
+    if (flags == HDF_NONE)
+    {
+        /* dataset is not chunked */
+        return 0;
+    }
+
+    for (i = 1; i < num_dimensions; i++)
+    {
+        if (chunk_def.chunk_lengths[i] > 0)
+        {
+            num_chunks *= (dimension[i] + chunk_def.chunk_lengths[i] - 1) / chunk_def.chunk_lengths[i];
+        }
+    }
+    if (SDsetchunkcache(sds_id, num_chunks, 0) == FAIL)
+    {
+        harp_set_error(HARP_ERROR_HDF4, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Read a dataset as a HARP variable. If time_length >= 0 and the first dimension of the variable is the time dimension
+ * then only the time samples in the range [time_offset, time_offset + time_length) are read. String data is read via
+ * the (growing) buffer that is passed by the caller such that it can be reused for all datasets of a product.
+ */
+static int read_variable(harp_product *product, int32 sds_id, long time_offset, long time_length, char **buffer,
+                         long *buffer_size)
 {
     char hdf4_name[MAX_HDF4_NAME_LENGTH + 1];
     int32 hdf4_dimension[MAX_HDF4_VAR_DIMS];
@@ -500,6 +550,14 @@ static int read_variable(harp_product *product, int32 sds_id)
         dimension[i] = (long)hdf4_dimension[i];
     }
 
+    if (time_length >= 0 && num_dimensions > 0 && dimension_type[0] == harp_dimension_time)
+    {
+        assert(time_offset + time_length <= dimension[0]);
+        hdf4_start[0] = (int32)time_offset;
+        hdf4_dimension[0] = (int32)time_length;
+        dimension[0] = time_length;
+    }
+
     /* Create HARP variable. */
     if (harp_variable_new(hdf4_name, data_type, num_dimensions, dimension_type, dimension, &variable) != 0)
     {
@@ -512,54 +570,55 @@ static int read_variable(harp_product *product, int32 sds_id)
         return -1;
     }
 
+    if (variable->num_elements > 0 && set_chunk_cache(sds_id, hdf4_num_dimensions, hdf4_dimension) != 0)
+    {
+        harp_add_error_message(" (dataset '%s')", hdf4_name);
+        return -1;
+    }
+
     /* Read data. */
     if (data_type == harp_type_string)
     {
-        char *buffer = NULL;
         long length = hdf4_dimension[hdf4_num_dimensions - 1];
+        long size = variable->num_elements * length;
 
-        buffer = malloc(variable->num_elements * length * sizeof(char));
-        if (buffer == NULL)
+        if (size > *buffer_size)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                           variable->num_elements * length * sizeof(char), __FILE__, __LINE__);
-            return -1;
+            char *new_buffer;
+
+            new_buffer = realloc(*buffer, size * sizeof(char));
+            if (new_buffer == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               size * sizeof(char), __FILE__, __LINE__);
+                return -1;
+            }
+            *buffer = new_buffer;
+            *buffer_size = size;
         }
 
-        if (SDreaddata(sds_id, hdf4_start, NULL, hdf4_dimension, buffer) != 0)
+        if (SDreaddata(sds_id, hdf4_start, NULL, hdf4_dimension, *buffer) != 0)
         {
             harp_set_error(HARP_ERROR_HDF4, NULL);
-            free(buffer);
             return -1;
         }
+        harp_io_statistics_add_read(harp_io_backend_hdf4, size * sizeof(char));
 
-        for (i = 0; i < variable->num_elements; i++)
+        if (harp_variable_set_string_data_from_char_array(variable, (long)length, *buffer) != 0)
         {
-            char *str;
-
-            str = malloc((length + 1) * sizeof(char));
-            if (str == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (length + 1) * sizeof(char), __FILE__, __LINE__);
-                free(buffer);
-                return -1;
-            }
-
-            memcpy(str, &buffer[i * length], length);
-            str[length] = '\0';
-            variable->data.string_data[i] = str;
+            return -1;
         }
-
-        free(buffer);
     }
     else
     {
+        /* read directly into the data of the variable */
         if (SDreaddata(sds_id, hdf4_start, NULL, hdf4_dimension, variable->data.ptr) != 0)
         {
             harp_set_error(HARP_ERROR_HDF4, NULL);
             return -1;
         }
+        harp_io_statistics_add_read(harp_io_backend_hdf4,
+                                    variable->num_elements * harp_get_size_for_type(variable->data_type));
     }
 
     /* Read attributes. */
@@ -643,40 +702,216 @@ static int read_variable(harp_product *product, int32 sds_id)
     return 0;
 }
 
-static int read_product(harp_product *product, int32 sd_id)
+/* Determine which variables need to be read, based on the keep()/exclude() operations at the start of the program,
+ * and which of them are used by the value filters that directly follow these operations (filter_include).
+ */
+static int get_included_variables(int32 sd_id, int32 num_sds, const harp_program *program, uint8_t *include,
+                                  uint8_t *filter_include)
 {
-    int32 num_sds;
-    int32 hdf4_num_attributes;
-    int32 hdf4_index;
+    char (*name)[MAX_HDF4_NAME_LENGTH + 1];
+    const char **variable_name;
     int i;
 
-    if (SDfileinfo(sd_id, &num_sds, &hdf4_num_attributes) != 0)
+    if (program == NULL)
     {
-        harp_set_error(HARP_ERROR_HDF4, NULL);
+        memset(include, 1, num_sds * sizeof(uint8_t));
+        memset(filter_include, 0, num_sds * sizeof(uint8_t));
+        return 0;
+    }
+
+    name = malloc(num_sds * sizeof(*name));
+    if (name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_sds * sizeof(*name), __FILE__, __LINE__);
+        return -1;
+    }
+    variable_name = (const char **)malloc(num_sds * sizeof(const char *));
+    if (variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_sds * sizeof(const char *), __FILE__, __LINE__);
+        free(name);
         return -1;
     }
 
-    /* Read variables. */
     for (i = 0; i < num_sds; i++)
     {
+        int32 hdf4_dimension[MAX_HDF4_VAR_DIMS];
+        int32 hdf4_data_type;
+        int32 hdf4_num_dimensions;
+        int32 hdf4_dont_care;
         int32 sds_id;
 
         sds_id = SDselect(sd_id, i);
         if (sds_id == -1)
         {
             harp_set_error(HARP_ERROR_HDF4, NULL);
+            free(variable_name);
+            free(name);
+            return -1;
+        }
+        if (SDgetinfo(sds_id, name[i], &hdf4_num_dimensions, hdf4_dimension, &hdf4_data_type, &hdf4_dont_care) != 0)
+        {
+            harp_set_error(HARP_ERROR_HDF4, NULL);
+            SDendaccess(sds_id);
+            free(variable_name);
+            free(name);
             return -1;
         }
+        SDendaccess(sds_id);
+        variable_name[i] = name[i];
+    }
+
+    harp_program_get_included_variables(program, num_sds, variable_name, include);
+    for (i = 0; i < num_sds; i++)
+    {
+        filter_include[i] = include[i] && harp_program_is_leading_value_filter_variable(program, variable_name[i]);
+    }
+
+    free(variable_name);
+    free(name);
+
+    return 0;
+}
+
+static int read_selected_variables(harp_product *product, int32 sd_id, int32 num_sds, const uint8_t *include,
+                                   long time_offset, long time_length)
+{
+    char *buffer = NULL;
+    long buffer_size = 0;
+    int i;
+
+    for (i = 0; i < num_sds; i++)
+    {
+        int32 sds_id;
+
+        if (!include[i])
+        {
+            /* Variable would be removed by the program anyway, so don't read its data. */
+            continue;
+        }
 
-        if (read_variable(product, sds_id) != 0)
+        sds_id = SDselect(sd_id, i);
+        if (sds_id == -1)
+        {
+            harp_set_error(HARP_ERROR_HDF4, NULL);
+            if (buffer != NULL)
+            {
+                free(buffer);
+            }
+            return -1;
+        }
+
+        if (read_variable(product, sds_id, time_offset, time_length, &buffer, &buffer_size) != 0)
         {
             SDendaccess(sds_id);
+            if (buffer != NULL)
+            {
+                free(buffer);
+            }
             return -1;
         }
 
         SDendaccess(sds_id);
     }
 
+    if (buffer != NULL)
+    {
+        free(buffer);
+    }
+
+    return 0;
+}
+
+static int read_variables(harp_product *product, harp_program *program, int32 sd_id, int32 num_sds)
+{
+    uint8_t *include;
+    uint8_t *filter_include;
+    long time_offset = 0;
+    long time_length = -1;
+    int has_filter_variables = 0;
+    int result;
+    int i;
+
+    include = (uint8_t *)malloc(2 * num_sds * sizeof(uint8_t));
+    if (include == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       2 * num_sds * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    filter_include = &include[num_sds];
+
+    if (get_included_variables(sd_id, num_sds, program, include, filter_include) != 0)
+    {
+        free(include);
+        return -1;
+    }
+    for (i = 0; i < num_sds; i++)
+    {
+        has_filter_variables |= filter_include[i];
+    }
+
+    if (has_filter_variables)
+    {
+        harp_product *filter_product;
+        long offset;
+        long length;
+
+        /* Determine the range of time samples that needs to be read by evaluating the filters. */
+        if (harp_product_new(&filter_product) != 0)
+        {
+            free(include);
+            return -1;
+        }
+        if (read_selected_variables(filter_product, sd_id, num_sds, filter_include, 0, -1) != 0)
+        {
+            harp_product_delete(filter_product);
+            free(include);
+            return -1;
+        }
+        if (harp_program_get_leading_value_filter_time_range(program, filter_product, &offset, &length) != 0)
+        {
+            harp_product_delete(filter_product);
+            free(include);
+            return -1;
+        }
+        if (length < filter_product->dimension[harp_dimension_time])
+        {
+            time_offset = offset;
+            time_length = length;
+        }
+        harp_product_delete(filter_product);
+    }
+
+    result = read_selected_variables(product, sd_id, num_sds, include, time_offset, time_length);
+    free(include);
+
+    return result;
+}
+
+static int read_product(harp_product *product, harp_program *program, int32 sd_id)
+{
+    int32 num_sds;
+    int32 hdf4_num_attributes;
+    int32 hdf4_index;
+
+    if (SDfileinfo(sd_id, &num_sds, &hdf4_num_attributes) != 0)
+    {
+        harp_set_error(HARP_ERROR_HDF4, NULL);
+        return -1;
+    }
+
+    /* Read variables. */
+    if (num_sds > 0)
+    {
+        if (read_variables(product, program, sd_id, num_sds) != 0)
+        {
+            return -1;
+        }
+    }
+
     /* Read attributes. */
     hdf4_index = SDfindattr(sd_id, "source_product");
     if (hdf4_index >= 0)
@@ -731,7 +966,7 @@ static int verify_product(int32 sd_id)
     return -1;
 }
 
-int harp_import_hdf4(const char *filename, harp_product **product)
+int harp_import_hdf4(const char *filename, harp_program *program, harp_product **product)
 {
     harp_product *new_product;
     int32 sd_id;
@@ -743,28 +978,29 @@ int harp_import_hdf4(const char *filename, harp_product **product)
         harp_add_error_message(" (%s)", filename);
         return -1;
     }
+    harp_io_statistics_add_open(harp_io_backend_hdf4);
 
     if (verify_product(sd_id) != 0)
     {
-        SDend(sd_id);
+        close_file(sd_id);
         return -1;
     }
 
     if (harp_product_new(&new_product) != 0)
     {
-        SDend(sd_id);
+        close_file(sd_id);
         return -1;
     }
 
-    if (read_product(new_product, sd_id) != 0)
+    if (read_product(new_product, program, sd_id) != 0)
     {
         harp_add_error_message(" (%s)", filename);
         harp_product_delete(new_product);
-        SDend(sd_id);
+        close_file(sd_id);
         return -1;
     }
 
-    SDend(sd_id);
+    close_file(sd_id);
 
     *product = new_product;
     return 0;
@@ -831,12 +1067,17 @@ static int update_dimensions_with_variable(long dimension[], int32 sds_id)
     return 0;
 }
 
+static const char *spatial_extent_attribute_name[4] = {
+    "geospatial_lat_min", "geospatial_lat_max", "geospatial_lon_min", "geospatial_lon_max"
+};
+
 int harp_import_global_attributes_hdf4(const char *filename, double *datetime_start, double *datetime_stop,
-                                       long dimension[], char **source_product)
+                                       double *spatial_extent, long dimension[], char **source_product)
 {
     char *attr_source_product = NULL;
     harp_scalar attr_datetime_start;
     harp_scalar attr_datetime_stop;
+    double attr_spatial_extent[4];
     harp_data_type attr_data_type;
     long attr_dimension[HARP_NUM_DIM_TYPES];
     int32 hdf4_index;
@@ -856,10 +1097,11 @@ int harp_import_global_attributes_hdf4(const char *filename, double *datetime_st
         harp_add_error_message(" (%s)", filename);
         return -1;
     }
+    harp_io_statistics_add_open(harp_io_backend_hdf4);
 
     if (verify_product(sd_id) != 0)
     {
-        SDend(sd_id);
+        close_file(sd_id);
         return -1;
     }
 
@@ -870,14 +1112,14 @@ int harp_import_global_attributes_hdf4(const char *filename, double *datetime_st
         {
             if (read_numeric_attribute(sd_id, hdf4_index, &attr_data_type, &attr_datetime_start) != 0)
             {
-                SDend(sd_id);
+                close_file(sd_id);
                 return -1;
             }
 
             if (attr_data_type != harp_type_double)
             {
                 harp_set_error(HARP_ERROR_IMPORT, "attribute 'datetime_start' has invalid type");
-                SDend(sd_id);
+                close_file(sd_id);
                 return -1;
             }
         }
@@ -894,14 +1136,14 @@ int harp_import_global_attributes_hdf4(const char *filename, double *datetime_st
         {
             if (read_numeric_attribute(sd_id, hdf4_index, &attr_data_type, &attr_datetime_stop) != 0)
             {
-                SDend(sd_id);
+                close_file(sd_id);
                 return -1;
             }
 
             if (attr_data_type != harp_type_double)
             {
                 harp_set_error(HARP_ERROR_IMPORT, "attribute 'datetime_stop' has invalid type");
-                SDend(sd_id);
+                close_file(sd_id);
                 return -1;
             }
         }
@@ -911,6 +1153,33 @@ int harp_import_global_attributes_hdf4(const char *filename, double *datetime_st
         }
     }
 
+    if (spatial_extent != NULL)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            attr_spatial_extent[i] = harp_nan();
+            hdf4_index = SDfindattr(sd_id, spatial_extent_attribute_name[i]);
+            if (hdf4_index >= 0)
+            {
+                harp_scalar value;
+
+                if (read_numeric_attribute(sd_id, hdf4_index, &attr_data_type, &value) != 0)
+                {
+                    close_file(sd_id);
+                    return -1;
+                }
+                if (attr_data_type != harp_type_double)
+                {
+                    harp_set_error(HARP_ERROR_IMPORT, "attribute '%s' has invalid type",
+                                   spatial_extent_attribute_name[i]);
+                    close_file(sd_id);
+                    return -1;
+                }
+                attr_spatial_extent[i] = value.double_data;
+            }
+        }
+    }
+
     if (dimension != NULL)
     {
         int32 hdf4_num_attributes;
@@ -924,7 +1193,7 @@ int harp_import_global_attributes_hdf4(const char *filename, double *datetime_st
         if (SDfileinfo(sd_id, &num_sds, &hdf4_num_attributes) != 0)
         {
             harp_set_error(HARP_ERROR_HDF4, NULL);
-            SDend(sd_id);
+            close_file(sd_id);
             return -1;
         }
 
@@ -972,7 +1241,7 @@ int harp_import_global_attributes_hdf4(const char *filename, double *datetime_st
         }
     }
 
-    SDend(sd_id);
+    close_file(sd_id);
 
     if (datetime_start != NULL)
     {
@@ -984,6 +1253,14 @@ int harp_import_global_attributes_hdf4(const char *filename, double *datetime_st
         *datetime_stop = attr_datetime_stop.double_data;
     }
 
+    if (spatial_extent != NULL)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            spatial_extent[i] = attr_spatial_extent[i];
+        }
+    }
+
     if (source_product != NULL)
     {
         *source_product = attr_source_product;
@@ -1263,6 +1540,7 @@ static int write_product(const harp_product *product, int32 sd_id)
 {
     harp_scalar datetime_start;
     harp_scalar datetime_stop;
+    harp_scalar spatial_extent[4];
     int i;
 
     /* Write file convention. */
@@ -1285,6 +1563,19 @@ static int write_product(const harp_product *product, int32 sd_id)
         }
     }
 
+    if (harp_product_get_spatial_extent(product, &spatial_extent[0].double_data, &spatial_extent[1].double_data,
+                                        &spatial_extent[2].double_data, &spatial_extent[3].double_data) == 0)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            if (write_numeric_attribute(sd_id, spatial_extent_attribute_name[i], harp_type_double,
+                                        spatial_extent[i]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
     if (product->source_product != NULL && strcmp(product->source_product, "") != 0)
     {
         if (write_string_attribute(sd_id, "source_product", product->source_product) != 0)
@@ -1304,10 +1595,13 @@ static int write_product(const harp_product *product, int32 sd_id)
     /* Write variables. */
     for (i = 0; i < product->num_variables; i++)
     {
+        harp_trace_begin("export(%s)", product->variable[i]->name);
         if (write_variable(product->variable[i], sd_id) != 0)
         {
+            harp_trace_end();
             return -1;
         }
+        harp_trace_end();
     }
 
     return 0;
@@ -1336,15 +1630,16 @@ int harp_export_hdf4(const char *filename, const harp_product *product)
         harp_add_error_message(" (%s)", filename);
         return -1;
     }
+    harp_io_statistics_add_open(harp_io_backend_hdf4);
 
     if (write_product(product, sd_id) != 0)
     {
         harp_add_error_message(" (%s)", filename);
-        SDend(sd_id);
+        close_file(sd_id);
         return -1;
     }
 
-    if (SDend(sd_id) != 0)
+    if (close_file(sd_id) != 0)
     {
         harp_set_error(HARP_ERROR_HDF4, NULL);
         harp_add_error_message(" (%s)", filename);
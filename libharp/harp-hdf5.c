@@ -30,6 +30,7 @@
  */
 
 #include "harp-internal.h"
+#include "harp-thread.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -38,6 +39,33 @@
 #include "hdf5.h"
 #include "hdf5_hl.h"
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+/* Compressed variables can be written (read) with chunks that were compressed (decompressed) in parallel if
+ * H5Dwrite_chunk() and H5Dread_chunk() (HDF5 1.10.2 or later) are available together with the library for the
+ * compression filter that is used (zlib for deflate, libzstd for zstd, and liblz4 for lz4). */
+#if (defined(HAVE_ZLIB) || defined(HAVE_ZSTD) || defined(HAVE_LZ4)) && defined(H5_VERSION_GE)
+#if H5_VERSION_GE(1, 10, 2)
+#define HAVE_HDF5_DIRECT_CHUNK_WRITE
+#define HAVE_HDF5_DIRECT_CHUNK_READ
+#endif
+#endif
+
+/* The paged file space strategy (used when a page size is set) is available since HDF5 1.10.1 */
+#if defined(H5_VERSION_GE)
+#if H5_VERSION_GE(1, 10, 1)
+#define HAVE_HDF5_PAGED_FILE_SPACE
+#endif
+#endif
+
 /* String value used in netCDF-4 files as the NAME attribute for dimension scales without coordinate variables. This
  * #define statement was copied verbatim from netcdf.h and should be kept in sync with future updates of the netCDF-4
  * library.
@@ -57,6 +85,34 @@
  */
 #define NC_DIMID_ATT_NAME "_Netcdf4Dimid"
 
+/* Registered HDF5 filter identifiers of the Zstandard and LZ4 filter plugins. */
+#define HDF5_FILTER_ZSTD 32015
+#define HDF5_FILTER_LZ4 32004
+
+/* Maximum size of the blocks into which the lz4 filter plugin splits a chunk (its default block size). */
+#define HDF5_FILTER_LZ4_MAX_BLOCK_SIZE (1 << 30)
+
+/* Amount by which the memory of an in-memory HDF5 file is grown. */
+#define HDF5_CORE_INCREMENT 1048576
+
+/* Adaptive compression (see harp_set_option_hdf5_adaptive_compression()) compresses a sample of this many bytes of
+ * each variable, taken as ADAPTIVE_NUM_SAMPLE_BLOCKS blocks spread evenly over the data. */
+#define ADAPTIVE_SAMPLE_SIZE 65536
+#define ADAPTIVE_NUM_SAMPLE_BLOCKS 4
+
+/* A variable is stored uncompressed if compression of the sample (at the lowest level) saves less than this fraction
+ * of its size, and with the lowest compression level if the requested level reduces the compressed size of the sample
+ * by less than ADAPTIVE_MIN_LEVEL_GAIN (higher levels take considerably more time). */
+#define ADAPTIVE_MIN_SAVING 0.1
+#define ADAPTIVE_MIN_LEVEL_GAIN 0.1
+
+/* Compression settings of a single variable */
+typedef struct hdf5_compression_struct
+{
+    int level;  /* 0 if the variable is stored without compression */
+    int shuffle;
+} hdf5_compression;
+
 /* List of shared dimensions. */
 typedef struct hdf5_dimensions_struct
 {
@@ -86,6 +142,177 @@ typedef struct hdf5_dimension_ids_struct
     long length[HARP_NUM_DIM_TYPES];
 } hdf5_dimension_ids;
 
+static herr_t close_file(hid_t file_id)
+{
+    harp_io_statistics_add_close(harp_io_backend_hdf5);
+    return H5Fclose(file_id);
+}
+
+#ifdef H5_HAVE_ROS3_VFD
+/* Copy an environment variable into a fixed size field of the read-only S3 driver configuration */
+static int get_ros3_fapl_field(const char *name, const char *default_value, char *field, size_t max_length)
+{
+    const char *value;
+
+    value = getenv(name);
+    if (value == NULL)
+    {
+        value = default_value;
+    }
+    if (strlen(value) > max_length)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "value of environment variable %s is too long (max %lu characters)",
+                       name, (unsigned long)max_length);
+        return -1;
+    }
+    strcpy(field, value);
+
+    return 0;
+}
+
+/* Open a file in (S3 compatible) object storage using ranged reads via the read-only S3 driver of HDF5.
+ * An s3://<bucket>/<key> url is mapped to https://<bucket>.s3.<region>.amazonaws.com/<key>, or to
+ * <endpoint>/<bucket>/<key> if the AWS_ENDPOINT_URL environment variable is set.
+ * Requests are signed if both AWS_ACCESS_KEY_ID and AWS_SECRET_ACCESS_KEY are set; otherwise anonymous access is used.
+ */
+static int open_remote_file(const char *filename, hid_t *file_id)
+{
+    H5FD_ros3_fapl_t fa;
+    const char *endpoint;
+    char *url;
+    hid_t fapl_id;
+
+    fa.version = H5FD_CURR_ROS3_FAPL_T_VERSION;
+    fa.authenticate = getenv("AWS_ACCESS_KEY_ID") != NULL && getenv("AWS_SECRET_ACCESS_KEY") != NULL;
+    fa.aws_region[0] = '\0';
+    fa.secret_id[0] = '\0';
+    fa.secret_key[0] = '\0';
+    if (get_ros3_fapl_field("AWS_REGION", "us-east-1", fa.aws_region, H5FD_ROS3_MAX_REGION_LEN) != 0)
+    {
+        return -1;
+    }
+    if (fa.authenticate)
+    {
+        if (get_ros3_fapl_field("AWS_ACCESS_KEY_ID", "", fa.secret_id, H5FD_ROS3_MAX_SECRET_ID_LEN) != 0)
+        {
+            return -1;
+        }
+        if (get_ros3_fapl_field("AWS_SECRET_ACCESS_KEY", "", fa.secret_key, H5FD_ROS3_MAX_SECRET_KEY_LEN) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (strncmp(filename, "s3://", 5) == 0)
+    {
+        const char *bucket = &filename[5];
+        const char *key;
+        size_t bucket_length;
+
+        key = strchr(bucket, '/');
+        if (key == NULL || key == bucket)
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "invalid url '%s' (expected s3://<bucket>/<key>)", filename);
+            return -1;
+        }
+        bucket_length = key - bucket;
+        key++;
+
+        endpoint = getenv("AWS_ENDPOINT_URL");
+        if (endpoint != NULL)
+        {
+            url = malloc(strlen(endpoint) + bucket_length + strlen(key) + 3);
+            if (url == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               strlen(endpoint) + bucket_length + strlen(key) + 3, __FILE__, __LINE__);
+                return -1;
+            }
+            sprintf(url, "%s/%.*s/%s", endpoint, (int)bucket_length, bucket, key);
+        }
+        else
+        {
+            url = malloc(bucket_length + strlen(fa.aws_region) + strlen(key) + 30);
+            if (url == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               bucket_length + strlen(fa.aws_region) + strlen(key) + 30, __FILE__, __LINE__);
+                return -1;
+            }
+            sprintf(url, "https://%.*s.s3.%s.amazonaws.com/%s", (int)bucket_length, bucket, fa.aws_region, key);
+        }
+    }
+    else
+    {
+        url = strdup(filename);
+        if (url == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)",
+                           __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    fapl_id = H5Pcreate(H5P_FILE_ACCESS);
+    if (fapl_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        free(url);
+        return -1;
+    }
+    if (H5Pset_fapl_ros3(fapl_id, &fa) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Pclose(fapl_id);
+        free(url);
+        return -1;
+    }
+
+    *file_id = H5Fopen(url, H5F_ACC_RDONLY, fapl_id);
+    H5Pclose(fapl_id);
+    free(url);
+    if (*file_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+/* Open a file read-only; the filename can be a local path or an s3://, http:// or https:// url */
+static int open_file(const char *filename, hid_t *file_id)
+{
+    if (harp_is_remote_url(filename))
+    {
+#ifdef H5_HAVE_ROS3_VFD
+        if (open_remote_file(filename, file_id) != 0)
+        {
+            harp_add_error_message(" (%s)", filename);
+            return -1;
+        }
+#else
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not open %s (HDF5 library was built without support for the "
+                       "read-only S3 driver)", filename);
+        return -1;
+#endif
+    }
+    else
+    {
+        *file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+        if (*file_id < 0)
+        {
+            harp_add_error_message(" (%s)", filename);
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
+        }
+    }
+    harp_io_statistics_add_open(harp_io_backend_hdf5);
+
+    return 0;
+}
+
 static void dimensions_init(hdf5_dimensions *dimensions)
 {
     dimensions->num_dimensions = 0;
@@ -371,27 +598,225 @@ static int get_link_iteration_index_type(hid_t group_id, H5_index_t * index_type
     return 0;
 }
 
-static int set_compression(hid_t plist_id, harp_variable *variable)
+/* Returns the HDF5 filter to use for compression; this falls back to deflate if the selected filter is not available.
+ */
+static H5Z_filter_t get_compression_filter(void)
+{
+    const char *name = harp_get_option_hdf5_compression_filter();
+    H5Z_filter_t filter_id = H5Z_FILTER_DEFLATE;
+
+    if (strcmp(name, "zstd") == 0)
+    {
+        filter_id = HDF5_FILTER_ZSTD;
+    }
+    else if (strcmp(name, "lz4") == 0)
+    {
+        filter_id = HDF5_FILTER_LZ4;
+    }
+    if (filter_id != H5Z_FILTER_DEFLATE && H5Zfilter_avail(filter_id) <= 0)
+    {
+        filter_id = H5Z_FILTER_DEFLATE;
+    }
+
+    return filter_id;
+}
+
+#ifdef HAVE_ZLIB
+/* Returns the total size of the blocks of the sample after deflate compression (or -1 on error) */
+static long get_compressed_sample_size(const uint8_t *data, long num_bytes, long element_size, int shuffle, int level)
+{
+    uint8_t block[ADAPTIVE_SAMPLE_SIZE / ADAPTIVE_NUM_SAMPLE_BLOCKS];
+    uint8_t buffer[ADAPTIVE_SAMPLE_SIZE / ADAPTIVE_NUM_SAMPLE_BLOCKS + 1024];
+    long block_size;
+    long total_size = 0;
+    int i;
+
+    block_size = ADAPTIVE_SAMPLE_SIZE / ADAPTIVE_NUM_SAMPLE_BLOCKS;
+    if (block_size > num_bytes)
+    {
+        block_size = num_bytes;
+    }
+    block_size -= block_size % element_size;
+
+    for (i = 0; i < ADAPTIVE_NUM_SAMPLE_BLOCKS; i++)
+    {
+        long offset = (long)(((double)(num_bytes - block_size) * i) / (ADAPTIVE_NUM_SAMPLE_BLOCKS - 1));
+        uLongf buffer_size = sizeof(buffer);
+
+        offset -= offset % element_size;
+        if (shuffle)
+        {
+            long num_elements = block_size / element_size;
+            long j;
+            int k;
+
+            for (k = 0; k < element_size; k++)
+            {
+                for (j = 0; j < num_elements; j++)
+                {
+                    block[k * num_elements + j] = data[offset + j * element_size + k];
+                }
+            }
+        }
+        else
+        {
+            memcpy(block, &data[offset], block_size);
+        }
+        if (compress2(buffer, &buffer_size, block, block_size, level) != Z_OK)
+        {
+            return -1;
+        }
+        total_size += (long)buffer_size;
+    }
+
+    return total_size;
+}
+#endif
+
+/* Determine how a variable (whose raw data is given by data and num_bytes) gets compressed.
+ * This uses the compression level and shuffle options, unless adaptive compression is enabled, in which case the
+ * compression ratio of a sample of the data determines whether the data gets compressed, with which level, and whether
+ * the shuffle filter is used (see harp_set_option_hdf5_adaptive_compression()).
+ */
+static void get_variable_compression(const char *name, const harp_variable *variable, const void *data,
+                                     long num_bytes, long element_size, hdf5_compression *compression)
+{
+    compression->level = harp_get_option_hdf5_compression();
+    compression->shuffle = harp_get_option_hdf5_shuffle() && variable->data_type != harp_type_string &&
+        element_size > 1;
+    if (compression->level == 0 || variable->num_dimensions == 0 || !harp_get_option_hdf5_adaptive_compression())
+    {
+        return;
+    }
+
+#ifdef HAVE_ZLIB
+    {
+        long sample_size;
+        long compressed_size;
+
+        sample_size = ADAPTIVE_SAMPLE_SIZE / ADAPTIVE_NUM_SAMPLE_BLOCKS;
+        if (sample_size > num_bytes)
+        {
+            sample_size = num_bytes;
+        }
+        sample_size = (sample_size - sample_size % element_size) * ADAPTIVE_NUM_SAMPLE_BLOCKS;
+        if (sample_size == 0)
+        {
+            return;
+        }
+
+        compressed_size = get_compressed_sample_size(data, num_bytes, element_size, 0, 1);
+        compression->shuffle = 0;
+        if (variable->data_type != harp_type_string && element_size > 1)
+        {
+            long shuffled_size = get_compressed_sample_size(data, num_bytes, element_size, 1, 1);
+
+            if (shuffled_size >= 0 && (compressed_size < 0 || shuffled_size < compressed_size))
+            {
+                compressed_size = shuffled_size;
+                compression->shuffle = 1;
+            }
+        }
+        if (compressed_size < 0)
+        {
+            /* keep the regular settings */
+            compression->level = harp_get_option_hdf5_compression();
+            compression->shuffle = harp_get_option_hdf5_shuffle() && variable->data_type != harp_type_string &&
+                element_size > 1;
+            return;
+        }
+        if (compressed_size > (1 - ADAPTIVE_MIN_SAVING) * sample_size)
+        {
+            compression->level = 0;
+            compression->shuffle = 0;
+        }
+        else if (compression->level > 1)
+        {
+            long level_size = get_compressed_sample_size(data, num_bytes, element_size, compression->shuffle,
+                                                         compression->level);
+
+            if (level_size >= 0 && level_size > (1 - ADAPTIVE_MIN_LEVEL_GAIN) * compressed_size)
+            {
+                compression->level = 1;
+            }
+            else if (level_size >= 0)
+            {
+                compressed_size = level_size;
+            }
+        }
+        /* record the choice in the trace, such that it can be reviewed and the settings can be tuned */
+        if (compression->level == 0)
+        {
+            harp_trace_begin("compression of %s: none (sample compressed to %.1f%%)", name,
+                             100.0 * compressed_size / sample_size);
+        }
+        else
+        {
+            harp_trace_begin("compression of %s: level %d%s (sample compressed to %.1f%%)", name, compression->level,
+                             compression->shuffle ? " with shuffle" : "", 100.0 * compressed_size / sample_size);
+        }
+        harp_trace_end();
+    }
+#else
+    (void)name;
+    (void)data;
+    (void)num_bytes;
+#endif
+}
+
+static int set_compression(hid_t plist_id, harp_variable *variable, long element_size,
+                           const hdf5_compression *compression)
 {
-    int level = harp_get_option_hdf5_compression();
+    int level = compression->level;
 
     if (level > 0 && variable->num_dimensions > 0)
     {
         long max_length = 4294967295;
+        long chunk_size = harp_get_option_hdf5_chunk_size();
         hsize_t dimension[HARP_MAX_NUM_DIMS];
+        H5Z_filter_t filter_id;
         int i;
 
         /* set chunk configuration (we need chunking to enable compression) */
-        /* we want to use the largest block possible while staying within the 2^32-1 elements per chunk limit */
         for (i = 0; i < variable->num_dimensions; i++)
         {
             dimension[i] = variable->dimension[i];
         }
-        if (variable->num_elements > max_length)
+        if (chunk_size > 0)
+        {
+            long max_chunk_elements = chunk_size / element_size;
+            long num_elements = 1;
+
+            /* keep the trailing dimensions whole and take as many samples of the leading dimension(s) as fit within
+             * the target chunk size, such that reading a range of samples only needs to decompress a few chunks */
+            if (max_chunk_elements < 1)
+            {
+                max_chunk_elements = 1;
+            }
+            if (max_chunk_elements > max_length)
+            {
+                max_chunk_elements = max_length;
+            }
+            for (i = variable->num_dimensions - 1; i >= 0; i--)
+            {
+                if (variable->dimension[i] > max_chunk_elements / num_elements)
+                {
+                    dimension[i] = max_chunk_elements / num_elements;
+                    while (--i >= 0)
+                    {
+                        dimension[i] = 1;
+                    }
+                    break;
+                }
+                num_elements *= variable->dimension[i] > 0 ? variable->dimension[i] : 1;
+            }
+        }
+        else if (variable->num_elements > max_length)
         {
             long num_elements = variable->num_elements;
             int i = 0;
 
+            /* we want to use the largest block possible while staying within the 2^32-1 elements per chunk limit */
             while (i < variable->num_dimensions - 1)
             {
                 num_elements /= (long)dimension[i];
@@ -409,12 +834,50 @@ static int set_compression(hid_t plist_id, harp_variable *variable)
                 dimension[i] = max_length;
             }
         }
+        for (i = 0; i < variable->num_dimensions; i++)
+        {
+            /* chunk dimensions need to be positive */
+            if (dimension[i] == 0)
+            {
+                dimension[i] = 1;
+            }
+        }
         if (H5Pset_chunk(plist_id, variable->num_dimensions, dimension) < 0)
         {
             harp_set_error(HARP_ERROR_HDF5, NULL);
             return -1;
         }
-        if (H5Pset_deflate(plist_id, level) < 0)
+        /* the shuffle filter needs to come before the compression filter in the filter pipeline */
+        if (compression->shuffle)
+        {
+            if (H5Pset_shuffle(plist_id) < 0)
+            {
+                harp_set_error(HARP_ERROR_HDF5, NULL);
+                return -1;
+            }
+        }
+        filter_id = get_compression_filter();
+        if (filter_id == HDF5_FILTER_ZSTD)
+        {
+            unsigned int cd_values[1];
+
+            cd_values[0] = level;
+            if (H5Pset_filter(plist_id, filter_id, H5Z_FLAG_OPTIONAL, 1, cd_values) < 0)
+            {
+                harp_set_error(HARP_ERROR_HDF5, NULL);
+                return -1;
+            }
+        }
+        else if (filter_id == HDF5_FILTER_LZ4)
+        {
+            /* use the default block size of the lz4 filter */
+            if (H5Pset_filter(plist_id, filter_id, H5Z_FLAG_OPTIONAL, 0, NULL) < 0)
+            {
+                harp_set_error(HARP_ERROR_HDF5, NULL);
+                return -1;
+            }
+        }
+        else if (H5Pset_deflate(plist_id, level) < 0)
         {
             harp_set_error(HARP_ERROR_HDF5, NULL);
             return -1;
@@ -423,47 +886,502 @@ static int set_compression(hid_t plist_id, harp_variable *variable)
     return 0;
 }
 
-static int read_string_attribute(hid_t obj_id, const char *name, char **data)
+#ifdef HAVE_HDF5_DIRECT_CHUNK_WRITE
+/* A chunk of a variable that gets compressed by a worker task and then written using H5Dwrite_chunk(). */
+typedef struct export_chunk_struct
 {
-    char *str;
-    hid_t attr_id;
-    hid_t data_type_id;
-    hid_t space_id;
-    hsize_t size;
+    hsize_t offset[HARP_MAX_NUM_DIMS];
+    const uint8_t *data;        /* start of the chunk within the variable data */
+    long data_size;     /* size in bytes of the part of the chunk that lies within the variable */
+    long chunk_size;    /* size in bytes of a full chunk */
+    int element_size;
+    int shuffle;
+    H5Z_filter_t filter_id;
+    int level;
+    uint8_t *buffer;    /* compressed chunk */
+    long buffer_size;
+} export_chunk;
+
+typedef struct chunk_writer_struct
+{
+    hid_t dataset_id;
+    int num_chunks;
+    export_chunk *chunk;
+} chunk_writer;
 
-    attr_id = H5Aopen_by_name(obj_id, ".", name, H5P_DEFAULT, H5P_DEFAULT);
-    if (attr_id < 0)
+/* Returns whether chunks can be compressed and decompressed by HARP itself for the given compression filter. */
+static int is_supported_chunk_filter(H5Z_filter_t filter_id)
+{
+    switch (filter_id)
     {
-        harp_set_error(HARP_ERROR_HDF5, NULL);
-        return -1;
+#ifdef HAVE_ZLIB
+        case H5Z_FILTER_DEFLATE:
+            return 1;
+#endif
+#ifdef HAVE_ZSTD
+        case HDF5_FILTER_ZSTD:
+            return 1;
+#endif
+#ifdef HAVE_LZ4
+        case HDF5_FILTER_LZ4:
+            return 1;
+#endif
+        default:
+            break;
     }
 
-    space_id = H5Aget_space(attr_id);
-    if (space_id < 0)
+    return 0;
+}
+
+#ifdef HAVE_ZLIB
+static int deflate_chunk(export_chunk *chunk, const uint8_t *data)
+{
+    uLongf buffer_size;
+    int result;
+
+    buffer_size = compressBound(chunk->chunk_size);
+    chunk->buffer = malloc(buffer_size);
+    if (chunk->buffer == NULL)
     {
-        harp_set_error(HARP_ERROR_HDF5, NULL);
-        H5Aclose(attr_id);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)buffer_size, __FILE__, __LINE__);
         return -1;
     }
-
-    if (H5Sget_simple_extent_type(space_id) == H5S_NULL)
+    result = compress2(chunk->buffer, &buffer_size, data, chunk->chunk_size, chunk->level);
+    if (result != Z_OK)
     {
-        /* this is an empty string */
-        H5Sclose(space_id);
-        H5Aclose(attr_id);
-        *data = strdup("");
-        if (*data == NULL)
-        {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                           __LINE__);
-            return -1;
-        }
-        return 0;
+        harp_set_error(HARP_ERROR_EXPORT, "could not compress chunk (zlib error %d)", result);
+        return -1;
     }
+    chunk->buffer_size = (long)buffer_size;
 
-    if (H5Sis_simple(space_id) <= 0 || H5Sget_simple_extent_type(space_id) != H5S_SCALAR)
-    {
-        harp_set_error(HARP_ERROR_IMPORT, "attribute '%s' has invalid format", name);
+    return 0;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/* The zstd filter plugin stores a chunk as a single zstd frame. */
+static int zstd_compress_chunk(export_chunk *chunk, const uint8_t *data)
+{
+    size_t buffer_size;
+    size_t result;
+
+    buffer_size = ZSTD_compressBound(chunk->chunk_size);
+    chunk->buffer = malloc(buffer_size);
+    if (chunk->buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)buffer_size, __FILE__, __LINE__);
+        return -1;
+    }
+    result = ZSTD_compress(chunk->buffer, buffer_size, data, chunk->chunk_size, chunk->level);
+    if (ZSTD_isError(result))
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "could not compress chunk (zstd error '%s')", ZSTD_getErrorName(result));
+        return -1;
+    }
+    chunk->buffer_size = (long)result;
+
+    return 0;
+}
+#endif
+
+#ifdef HAVE_LZ4
+static void put_uint32_be(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)value;
+}
+
+/* The lz4 filter plugin stores a chunk as the (big endian) 64-bit uncompressed size and 32-bit block size, followed by
+ * each block as a (big endian) 32-bit compressed size and the compressed data. A block that does not get smaller is
+ * stored uncompressed (with the block size as compressed size).
+ */
+static int lz4_compress_chunk(export_chunk *chunk, const uint8_t *data)
+{
+    long block_size = chunk->chunk_size;
+    long num_blocks;
+    long buffer_size;
+    long offset;
+    uint8_t *dst;
+
+    if (block_size > HDF5_FILTER_LZ4_MAX_BLOCK_SIZE)
+    {
+        block_size = HDF5_FILTER_LZ4_MAX_BLOCK_SIZE;
+    }
+    num_blocks = (chunk->chunk_size + block_size - 1) / block_size;
+    buffer_size = 12 + num_blocks * (4 + (long)LZ4_compressBound((int)block_size));
+    chunk->buffer = malloc(buffer_size);
+    if (chunk->buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)buffer_size, __FILE__, __LINE__);
+        return -1;
+    }
+
+    dst = chunk->buffer;
+    put_uint32_be(dst, (uint32_t)((uint64_t)chunk->chunk_size >> 32));
+    put_uint32_be(&dst[4], (uint32_t)chunk->chunk_size);
+    put_uint32_be(&dst[8], (uint32_t)block_size);
+    dst += 12;
+    for (offset = 0; offset < chunk->chunk_size; offset += block_size)
+    {
+        int size = (int)(chunk->chunk_size - offset < block_size ? chunk->chunk_size - offset : block_size);
+        int compressed_size;
+
+        compressed_size = LZ4_compress_default((const char *)&data[offset], (char *)&dst[4], size,
+                                               LZ4_compressBound(size));
+        if (compressed_size <= 0 || compressed_size >= size)
+        {
+            memcpy(&dst[4], &data[offset], size);
+            compressed_size = size;
+        }
+        put_uint32_be(dst, (uint32_t)compressed_size);
+        dst += 4 + compressed_size;
+    }
+    chunk->buffer_size = (long)(dst - chunk->buffer);
+
+    return 0;
+}
+#endif
+
+/* Apply the same shuffle and compression filters to a chunk as the HDF5 filter pipeline of the dataset would do.
+ * The compressed chunk is encoded in the same way as the (plugin) filter of the dataset, so the chunks can be read
+ * back by any HDF5 installation that has that filter.
+ */
+static int compress_chunk(void *arg)
+{
+    export_chunk *chunk = (export_chunk *)arg;
+    uint8_t *data;
+    int result;
+
+    data = malloc(chunk->chunk_size);
+    if (data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)chunk->chunk_size, __FILE__, __LINE__);
+        return -1;
+    }
+    if (chunk->data_size < chunk->chunk_size)
+    {
+        /* edge chunks are padded with zeros */
+        memset(data, 0, chunk->chunk_size);
+    }
+    if (chunk->shuffle)
+    {
+        long num_elements = chunk->chunk_size / chunk->element_size;
+        long num_data_elements = chunk->data_size / chunk->element_size;
+        long i;
+        int j;
+
+        for (j = 0; j < chunk->element_size; j++)
+        {
+            uint8_t *dst = &data[j * num_elements];
+            const uint8_t *src = &chunk->data[j];
+
+            for (i = 0; i < num_data_elements; i++)
+            {
+                dst[i] = src[i * chunk->element_size];
+            }
+        }
+    }
+    else
+    {
+        memcpy(data, chunk->data, chunk->data_size);
+    }
+
+    switch (chunk->filter_id)
+    {
+#ifdef HAVE_ZSTD
+        case HDF5_FILTER_ZSTD:
+            result = zstd_compress_chunk(chunk, data);
+            break;
+#endif
+#ifdef HAVE_LZ4
+        case HDF5_FILTER_LZ4:
+            result = lz4_compress_chunk(chunk, data);
+            break;
+#endif
+#ifdef HAVE_ZLIB
+        case H5Z_FILTER_DEFLATE:
+            result = deflate_chunk(chunk, data);
+            break;
+#endif
+        default:
+            assert(0);
+            exit(1);
+    }
+    free(data);
+
+    return result;
+}
+
+static int write_chunks(void *arg)
+{
+    chunk_writer *writer = (chunk_writer *)arg;
+    int i;
+
+    for (i = 0; i < writer->num_chunks; i++)
+    {
+        export_chunk *chunk = &writer->chunk[i];
+
+        if (H5Dwrite_chunk(writer->dataset_id, H5P_DEFAULT, 0, chunk->offset, chunk->buffer_size, chunk->buffer) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
+        }
+        free(chunk->buffer);
+        chunk->buffer = NULL;
+    }
+
+    return 0;
+}
+
+/* Retrieve the chunk layout of a dataset. This returns 1 if each chunk covers a contiguous block of the variable data
+ * (i.e. all chunk dimensions are 1 up to some dimension and cover the full dimension after it), and 0 otherwise.
+ * On success, split_dim is the dimension that is divided over multiple chunks.
+ */
+static int get_contiguous_chunks(hid_t dataset_id, const harp_variable *variable, hsize_t *chunk_dimension,
+                                 int *split_dim, long *num_chunks)
+{
+    hid_t plist_id;
+    int i;
+
+    plist_id = H5Dget_create_plist(dataset_id);
+    if (plist_id < 0)
+    {
+        return 0;
+    }
+    if (H5Pget_layout(plist_id) != H5D_CHUNKED ||
+        H5Pget_chunk(plist_id, variable->num_dimensions, chunk_dimension) != variable->num_dimensions)
+    {
+        H5Pclose(plist_id);
+        return 0;
+    }
+    H5Pclose(plist_id);
+
+    *split_dim = variable->num_dimensions - 1;
+    while (*split_dim > 0 && (long)chunk_dimension[*split_dim] == variable->dimension[*split_dim])
+    {
+        (*split_dim)--;
+    }
+    *num_chunks = 1;
+    for (i = 0; i < *split_dim; i++)
+    {
+        if (chunk_dimension[i] != 1)
+        {
+            return 0;
+        }
+        *num_chunks *= variable->dimension[i];
+    }
+    *num_chunks *= (variable->dimension[*split_dim] + (long)chunk_dimension[*split_dim] - 1) /
+        (long)chunk_dimension[*split_dim];
+
+    return 1;
+}
+
+/* Compress the chunks of a variable using worker tasks and write them with H5Dwrite_chunk().
+ * In each round, the calling thread writes the chunks that were compressed in the previous round while the other
+ * tasks compress the next batch of chunks. This keeps at most two batches of compressed chunks in memory.
+ */
+static int write_chunks_in_parallel(hid_t dataset_id, const harp_variable *variable, const hsize_t *chunk_dimension,
+                                    int split_dim, long num_chunks, int num_tasks, H5Z_filter_t filter_id,
+                                    const hdf5_compression *compression)
+{
+    export_chunk *chunk;
+    harp_task *task;
+    chunk_writer writer;
+    long element_size = harp_get_size_for_type(variable->data_type);
+    long num_trailing_elements = 1;
+    long num_split_chunks;
+    long next_chunk = 0;
+    int batch_size = num_tasks - 1;
+    int round = 0;
+    int result = 0;
+    int i;
+
+    for (i = split_dim + 1; i < variable->num_dimensions; i++)
+    {
+        num_trailing_elements *= variable->dimension[i];
+    }
+    num_split_chunks = (variable->dimension[split_dim] + (long)chunk_dimension[split_dim] - 1) /
+        (long)chunk_dimension[split_dim];
+
+    chunk = malloc(2 * batch_size * sizeof(export_chunk));
+    if (chunk == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       2 * batch_size * sizeof(export_chunk), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < 2 * batch_size; i++)
+    {
+        chunk[i].buffer = NULL;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        free(chunk);
+        return -1;
+    }
+
+    writer.dataset_id = dataset_id;
+    writer.num_chunks = 0;
+    writer.chunk = NULL;
+    while (next_chunk < num_chunks || writer.num_chunks > 0)
+    {
+        export_chunk *batch = &chunk[(round % 2) * batch_size];
+        int num_batch_chunks = 0;
+
+        task[0].function = write_chunks;
+        task[0].arg = &writer;
+        while (num_batch_chunks < batch_size && next_chunk < num_chunks)
+        {
+            export_chunk *current = &batch[num_batch_chunks];
+            long outer_index = next_chunk / num_split_chunks;
+            long split_index = next_chunk % num_split_chunks;
+            long split_length = (long)chunk_dimension[split_dim];
+            long element_offset;
+
+            for (i = split_dim - 1; i >= 0; i--)
+            {
+                current->offset[i] = outer_index % variable->dimension[i];
+                outer_index /= variable->dimension[i];
+            }
+            current->offset[split_dim] = split_index * split_length;
+            for (i = split_dim + 1; i < variable->num_dimensions; i++)
+            {
+                current->offset[i] = 0;
+            }
+            element_offset = ((next_chunk / num_split_chunks) * variable->dimension[split_dim] +
+                              split_index * split_length) * num_trailing_elements;
+            if (split_index * split_length + split_length > variable->dimension[split_dim])
+            {
+                split_length = variable->dimension[split_dim] - split_index * split_length;
+            }
+            current->data = (const uint8_t *)variable->data.ptr + element_offset * element_size;
+            current->data_size = split_length * num_trailing_elements * element_size;
+            current->chunk_size = (long)chunk_dimension[split_dim] * num_trailing_elements * element_size;
+            current->element_size = (int)element_size;
+            current->shuffle = compression->shuffle;
+            current->filter_id = filter_id;
+            current->level = compression->level;
+            current->buffer = NULL;
+            task[1 + num_batch_chunks].function = compress_chunk;
+            task[1 + num_batch_chunks].arg = current;
+            num_batch_chunks++;
+            next_chunk++;
+        }
+
+        if (harp_run_tasks(1 + num_batch_chunks, task) != 0)
+        {
+            result = -1;
+            break;
+        }
+        writer.num_chunks = num_batch_chunks;
+        writer.chunk = batch;
+        round++;
+    }
+
+    for (i = 0; i < 2 * batch_size; i++)
+    {
+        if (chunk[i].buffer != NULL)
+        {
+            free(chunk[i].buffer);
+        }
+    }
+    free(task);
+    free(chunk);
+
+    return result;
+}
+#endif
+
+/* Write the data of a numeric variable. If the variable is compressed (using deflate, or using zstd or lz4 if the
+ * corresponding library is available) and multiple threads are enabled (see harp_set_option_num_threads()), the
+ * chunks are compressed in parallel and the writing of compressed chunks is overlapped with the compression of the
+ * next chunks.
+ */
+static int write_numeric_data(hid_t dataset_id, const harp_variable *variable, const hdf5_compression *compression)
+{
+#ifdef HAVE_HDF5_DIRECT_CHUNK_WRITE
+    H5Z_filter_t filter_id = get_compression_filter();
+
+    if (compression->level > 0 && variable->num_dimensions > 0 && variable->num_elements > 0 &&
+        is_supported_chunk_filter(filter_id))
+    {
+        hsize_t chunk_dimension[HARP_MAX_NUM_DIMS];
+        long num_chunks;
+        int split_dim;
+
+        if (get_contiguous_chunks(dataset_id, variable, chunk_dimension, &split_dim, &num_chunks) && num_chunks > 1)
+        {
+            int num_tasks = harp_get_num_tasks(num_chunks + 1, 1);
+
+            if (num_tasks > 1)
+            {
+                return write_chunks_in_parallel(dataset_id, variable, chunk_dimension, split_dim, num_chunks,
+                                                num_tasks, filter_id, compression);
+            }
+        }
+    }
+#endif
+
+    if (H5Dwrite(dataset_id, get_hdf5_type(variable->data_type), H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                 variable->data.ptr) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_string_attribute(hid_t obj_id, const char *name, char **data)
+{
+    char *str;
+    hid_t attr_id;
+    hid_t data_type_id;
+    hid_t space_id;
+    hsize_t size;
+
+    attr_id = H5Aopen_by_name(obj_id, ".", name, H5P_DEFAULT, H5P_DEFAULT);
+    if (attr_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    space_id = H5Aget_space(attr_id);
+    if (space_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Aclose(attr_id);
+        return -1;
+    }
+
+    if (H5Sget_simple_extent_type(space_id) == H5S_NULL)
+    {
+        /* this is an empty string */
+        H5Sclose(space_id);
+        H5Aclose(attr_id);
+        *data = strdup("");
+        if (*data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (H5Sis_simple(space_id) <= 0 || H5Sget_simple_extent_type(space_id) != H5S_SCALAR)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "attribute '%s' has invalid format", name);
         H5Sclose(space_id);
         H5Aclose(attr_id);
         return -1;
@@ -670,120 +1588,750 @@ static int read_variable_dimensions(const char *variable_name, hid_t dataset_id,
     hsize_t hdf5_dimension[HARP_MAX_NUM_DIMS];
     int i, j;
 
-    space_id = H5Dget_space(dataset_id);
-    if (space_id < 0)
+    space_id = H5Dget_space(dataset_id);
+    if (space_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    if (H5Sis_simple(space_id) <= 0)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "dataspace is complex; only simple dataspaces are supported");
+        H5Sclose(space_id);
+        return -1;
+    }
+
+    hdf5_num_dimensions = H5Sget_simple_extent_ndims(space_id);
+    if (hdf5_num_dimensions < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Sclose(space_id);
+        return -1;
+    }
+
+    if (hdf5_num_dimensions > HARP_MAX_NUM_DIMS)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "dataspace has %d dimensions; expected <= %d", hdf5_num_dimensions,
+                       HARP_MAX_NUM_DIMS);
+        H5Sclose(space_id);
+        return -1;
+    }
+
+    if (H5Sget_simple_extent_dims(space_id, hdf5_dimension, NULL) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Sclose(space_id);
+        return -1;
+    }
+
+    H5Sclose(space_id);
+
+    for (i = 0; i < hdf5_num_dimensions; i++)
+    {
+        int hdf5_num_scales;
+
+        hdf5_num_scales = H5DSget_num_scales(dataset_id, i);
+        if (hdf5_num_scales < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
+        }
+
+        if (hdf5_num_scales == 0)
+        {
+            hdf5_dimension_type[i] = harp_dimension_independent;
+            if ((i == 0) && H5DSis_scale(dataset_id))
+            {
+                /* This variable has the same name as a dimension */
+                for (j = 0; j < HARP_NUM_DIM_TYPES; j++)
+                {
+                    if (strcmp(harp_get_dimension_type_name(j), variable_name) == 0)
+                    {
+                        hdf5_dimension_type[i] = (harp_dimension_type)j;
+                        break;
+                    }
+                }
+            }
+        }
+        else if (hdf5_num_scales == 1)
+        {
+            hdf5_object_id hdf5_dimensions_id;
+            int j;
+
+            if (H5DSiterate_scales(dataset_id, i, NULL, hdf5_read_dimension_scale_func, &hdf5_dimensions_id) != 0)
+            {
+                return -1;
+            }
+
+            hdf5_dimension_type[i] = harp_dimension_independent;
+
+            for (j = 0; j < HARP_NUM_DIM_TYPES; j++)
+            {
+                if (!dimension_ids->is_valid[j])
+                {
+                    continue;
+                }
+
+                if (dimension_ids->object_id[j].fileno == hdf5_dimensions_id.fileno
+                    && dimension_ids->object_id[j].addr == hdf5_dimensions_id.addr)
+                {
+                    hdf5_dimension_type[i] = (harp_dimension_type)j;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "dimension at index %d has %d attached dimension scales; expected 0 or 1",
+                           i, hdf5_num_scales);
+            return -1;
+        }
+    }
+
+    *num_dimensions = hdf5_num_dimensions;
+    for (i = 0; i < hdf5_num_dimensions; i++)
+    {
+        dimension_type[i] = hdf5_dimension_type[i];
+        dimension[i] = (long)hdf5_dimension[i];
+    }
+
+    return 0;
+}
+
+#ifdef HAVE_HDF5_DIRECT_CHUNK_READ
+/* The chunk layout of a dataset and the hyperslab of the dataset that gets read. */
+typedef struct import_layout_struct
+{
+    int num_dimensions;
+    hsize_t chunk_dimension[HARP_MAX_NUM_DIMS];
+    long start[HARP_MAX_NUM_DIMS];      /* start of the hyperslab */
+    long count[HARP_MAX_NUM_DIMS];      /* size of the hyperslab (and of the destination buffer) */
+    long first_chunk[HARP_MAX_NUM_DIMS];        /* index of the first chunk that intersects the hyperslab */
+    long num_chunks[HARP_MAX_NUM_DIMS]; /* number of chunks that intersect the hyperslab */
+    long element_size;
+    long chunk_size;    /* size in bytes of a full (uncompressed) chunk */
+    int shuffle_index;  /* index of the shuffle filter in the filter pipeline (or -1 if not used) */
+    int filter_index;   /* index of the compression filter in the filter pipeline */
+    H5Z_filter_t filter_id;
+    uint8_t *buffer;    /* destination buffer */
+} import_layout;
+
+/* A chunk of a variable that gets read using H5Dread_chunk() and then decompressed by a worker task. */
+typedef struct import_chunk_struct
+{
+    const import_layout *layout;
+    hsize_t offset[HARP_MAX_NUM_DIMS];
+    uint32_t filter_mask;       /* filters that were skipped for this chunk */
+    uint8_t *buffer;    /* compressed chunk */
+    long buffer_size;
+} import_chunk;
+
+typedef struct chunk_reader_struct
+{
+    hid_t dataset_id;
+    int num_chunks;
+    import_chunk *chunk;
+    int unallocated;    /* set if a chunk was never written (in which case H5Dread() needs to provide fill values) */
+} chunk_reader;
+
+/* Determine whether the chunks of a dataset can be read directly and decompressed by HARP. This requires a chunked
+ * dataset with a filter pipeline consisting of an optional shuffle filter followed by a supported compression filter,
+ * and a file data type that needs no conversion to the memory data type.
+ */
+static int get_import_layout(hid_t dataset_id, hid_t mem_type_id, int num_dimensions, import_layout *layout)
+{
+    hid_t plist_id;
+    hid_t type_id;
+    int num_filters;
+    int i;
+
+    type_id = H5Dget_type(dataset_id);
+    if (type_id < 0)
+    {
+        return 0;
+    }
+    if (H5Tequal(type_id, mem_type_id) <= 0)
+    {
+        H5Tclose(type_id);
+        return 0;
+    }
+    H5Tclose(type_id);
+
+    plist_id = H5Dget_create_plist(dataset_id);
+    if (plist_id < 0)
+    {
+        return 0;
+    }
+    if (H5Pget_layout(plist_id) != H5D_CHUNKED ||
+        H5Pget_chunk(plist_id, num_dimensions, layout->chunk_dimension) != num_dimensions)
+    {
+        H5Pclose(plist_id);
+        return 0;
+    }
+    num_filters = H5Pget_nfilters(plist_id);
+    if (num_filters < 1 || num_filters > 2)
+    {
+        H5Pclose(plist_id);
+        return 0;
+    }
+    layout->shuffle_index = -1;
+    layout->filter_index = -1;
+    for (i = 0; i < num_filters; i++)
+    {
+        H5Z_filter_t filter_id;
+        unsigned int flags;
+        size_t cd_nelmts = 0;
+        unsigned int filter_config;
+
+        filter_id = H5Pget_filter2(plist_id, i, &flags, &cd_nelmts, NULL, 0, NULL, &filter_config);
+        if (filter_id == H5Z_FILTER_SHUFFLE && i == 0 && num_filters == 2)
+        {
+            layout->shuffle_index = i;
+        }
+        else if (i == num_filters - 1 && is_supported_chunk_filter(filter_id))
+        {
+            layout->filter_index = i;
+            layout->filter_id = filter_id;
+        }
+        else
+        {
+            H5Pclose(plist_id);
+            return 0;
+        }
+    }
+    H5Pclose(plist_id);
+
+    layout->num_dimensions = num_dimensions;
+    layout->element_size = (long)H5Tget_size(mem_type_id);
+    layout->chunk_size = layout->element_size;
+    for (i = 0; i < num_dimensions; i++)
+    {
+        layout->chunk_size *= (long)layout->chunk_dimension[i];
+    }
+
+    return 1;
+}
+
+static int read_chunks(void *arg)
+{
+    chunk_reader *reader = (chunk_reader *)arg;
+    int i;
+
+    for (i = 0; i < reader->num_chunks; i++)
+    {
+        import_chunk *chunk = &reader->chunk[i];
+        hsize_t chunk_bytes;
+
+        if (H5Dget_chunk_storage_size(reader->dataset_id, chunk->offset, &chunk_bytes) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
+        }
+        if (chunk_bytes == 0)
+        {
+            reader->unallocated = 1;
+            return 0;
+        }
+        chunk->buffer = malloc((size_t)chunk_bytes);
+        if (chunk->buffer == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (unsigned long)chunk_bytes, __FILE__, __LINE__);
+            return -1;
+        }
+        chunk->buffer_size = (long)chunk_bytes;
+        if (H5Dread_chunk(reader->dataset_id, H5P_DEFAULT, chunk->offset, &chunk->filter_mask, chunk->buffer) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef HAVE_ZLIB
+static int inflate_chunk(const import_chunk *chunk, uint8_t *data)
+{
+    uLongf data_size = chunk->layout->chunk_size;
+    int result;
+
+    result = uncompress(data, &data_size, chunk->buffer, chunk->buffer_size);
+    if (result != Z_OK || (long)data_size != chunk->layout->chunk_size)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (zlib error %d)", result);
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static int zstd_decompress_chunk(const import_chunk *chunk, uint8_t *data)
+{
+    size_t result;
+
+    result = ZSTD_decompress(data, chunk->layout->chunk_size, chunk->buffer, chunk->buffer_size);
+    if (ZSTD_isError(result))
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (zstd error '%s')", ZSTD_getErrorName(result));
+        return -1;
+    }
+    if ((long)result != chunk->layout->chunk_size)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (invalid zstd data size)");
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef HAVE_LZ4
+static uint32_t get_uint32_be(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+/* Decode a chunk in the format of the lz4 filter plugin (see lz4_compress_chunk()). */
+static int lz4_decompress_chunk(const import_chunk *chunk, uint8_t *data)
+{
+    const uint8_t *src = chunk->buffer;
+    const uint8_t *src_end = chunk->buffer + chunk->buffer_size;
+    uint64_t data_size;
+    long block_size;
+    long offset;
+
+    if (chunk->buffer_size < 12)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (invalid lz4 header)");
+        return -1;
+    }
+    data_size = ((uint64_t)get_uint32_be(src) << 32) | get_uint32_be(&src[4]);
+    block_size = (long)get_uint32_be(&src[8]);
+    if (data_size != (uint64_t)chunk->layout->chunk_size || block_size <= 0)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (invalid lz4 header)");
+        return -1;
+    }
+    src += 12;
+    for (offset = 0; offset < chunk->layout->chunk_size; offset += block_size)
+    {
+        long size = chunk->layout->chunk_size - offset < block_size ? chunk->layout->chunk_size - offset : block_size;
+        long compressed_size;
+
+        if (src_end - src < 4)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (truncated lz4 data)");
+            return -1;
+        }
+        compressed_size = (long)get_uint32_be(src);
+        src += 4;
+        if (compressed_size > src_end - src)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (truncated lz4 data)");
+            return -1;
+        }
+        if (compressed_size == size)
+        {
+            /* block was stored uncompressed */
+            memcpy(&data[offset], src, size);
+        }
+        else if (LZ4_decompress_safe((const char *)src, (char *)&data[offset], (int)compressed_size, (int)size) !=
+                 size)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk (invalid lz4 data)");
+            return -1;
+        }
+        src += compressed_size;
+    }
+
+    return 0;
+}
+#endif
+
+/* Copy the part of a decompressed chunk that lies within the hyperslab to the destination buffer. */
+static void copy_chunk_to_hyperslab(const import_chunk *chunk, const uint8_t *data)
+{
+    const import_layout *layout = chunk->layout;
+    long begin[HARP_MAX_NUM_DIMS];
+    long end[HARP_MAX_NUM_DIMS];
+    long index[HARP_MAX_NUM_DIMS];
+    int last_dim = layout->num_dimensions - 1;
+    long run_size;
+    int i;
+
+    for (i = 0; i < layout->num_dimensions; i++)
+    {
+        long chunk_end = (long)(chunk->offset[i] + layout->chunk_dimension[i]);
+
+        begin[i] = (long)chunk->offset[i] > layout->start[i] ? (long)chunk->offset[i] : layout->start[i];
+        end[i] = chunk_end < layout->start[i] + layout->count[i] ? chunk_end : layout->start[i] + layout->count[i];
+        index[i] = begin[i];
+    }
+    run_size = (end[last_dim] - begin[last_dim]) * layout->element_size;
+
+    for (;;)
+    {
+        long src_offset = 0;
+        long dst_offset = 0;
+
+        for (i = 0; i < layout->num_dimensions; i++)
+        {
+            src_offset = src_offset * (long)layout->chunk_dimension[i] + (index[i] - (long)chunk->offset[i]);
+            dst_offset = dst_offset * layout->count[i] + (index[i] - layout->start[i]);
+        }
+        memcpy(&layout->buffer[dst_offset * layout->element_size], &data[src_offset * layout->element_size], run_size);
+
+        /* advance to the next run of the last dimension */
+        i = last_dim - 1;
+        while (i >= 0)
+        {
+            index[i]++;
+            if (index[i] < end[i])
+            {
+                break;
+            }
+            index[i] = begin[i];
+            i--;
+        }
+        if (i < 0)
+        {
+            break;
+        }
+    }
+}
+
+/* Undo the filter pipeline of the dataset for a chunk and store the result in the destination buffer. */
+static int decompress_chunk(void *arg)
+{
+    import_chunk *chunk = (import_chunk *)arg;
+    const import_layout *layout = chunk->layout;
+    uint8_t *data;
+    int result = 0;
+
+    data = malloc(layout->chunk_size);
+    if (data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)layout->chunk_size, __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (chunk->filter_mask & (1 << layout->filter_index))
+    {
+        /* the (optional) compression filter was skipped for this chunk */
+        if (chunk->buffer_size != layout->chunk_size)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "invalid size for uncompressed chunk");
+            free(data);
+            return -1;
+        }
+        memcpy(data, chunk->buffer, layout->chunk_size);
+    }
+    else
+    {
+        switch (layout->filter_id)
+        {
+#ifdef HAVE_ZSTD
+            case HDF5_FILTER_ZSTD:
+                result = zstd_decompress_chunk(chunk, data);
+                break;
+#endif
+#ifdef HAVE_LZ4
+            case HDF5_FILTER_LZ4:
+                result = lz4_decompress_chunk(chunk, data);
+                break;
+#endif
+#ifdef HAVE_ZLIB
+            case H5Z_FILTER_DEFLATE:
+                result = inflate_chunk(chunk, data);
+                break;
+#endif
+            default:
+                assert(0);
+                exit(1);
+        }
+    }
+    free(chunk->buffer);
+    chunk->buffer = NULL;
+    if (result != 0)
+    {
+        free(data);
+        return -1;
+    }
+
+    if (layout->shuffle_index >= 0 && !(chunk->filter_mask & (1 << layout->shuffle_index)))
+    {
+        long num_elements = layout->chunk_size / layout->element_size;
+        uint8_t *unshuffled;
+        long i;
+        long j;
+
+        unshuffled = malloc(layout->chunk_size);
+        if (unshuffled == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (unsigned long)layout->chunk_size, __FILE__, __LINE__);
+            free(data);
+            return -1;
+        }
+        for (j = 0; j < layout->element_size; j++)
+        {
+            const uint8_t *src = &data[j * num_elements];
+            uint8_t *dst = &unshuffled[j];
+
+            for (i = 0; i < num_elements; i++)
+            {
+                dst[i * layout->element_size] = src[i];
+            }
+        }
+        free(data);
+        data = unshuffled;
+    }
+
+    copy_chunk_to_hyperslab(chunk, data);
+    free(data);
+
+    return 0;
+}
+
+/* Read the chunks of a dataset that intersect the hyperslab [start, start + count) with H5Dread_chunk() and decompress
+ * them using worker tasks. In each round, one task reads the next batch of (compressed) chunks while the other tasks
+ * decompress the chunks that were read in the previous round into the destination buffer.
+ * Returns 1 if the chunks could not be read this way (without having set an error), in which case the caller should
+ * use H5Dread() instead.
+ */
+static int read_chunks_in_parallel(hid_t dataset_id, hid_t mem_type_id, int num_dimensions, const long *start,
+                                   const long *count, void *buffer)
+{
+    import_layout layout;
+    import_chunk *chunk;
+    import_chunk *previous_batch = NULL;
+    harp_task *task;
+    chunk_reader reader;
+    long num_chunks = 1;
+    long next_chunk = 0;
+    int num_previous_chunks = 0;
+    int batch_size;
+    int num_tasks;
+    int round = 0;
+    int result = 0;
+    int i;
+
+    if (num_dimensions == 0 || !get_import_layout(dataset_id, mem_type_id, num_dimensions, &layout))
     {
-        harp_set_error(HARP_ERROR_HDF5, NULL);
-        return -1;
+        return 1;
     }
+    for (i = 0; i < num_dimensions; i++)
+    {
+        long chunk_length = (long)layout.chunk_dimension[i];
 
-    if (H5Sis_simple(space_id) <= 0)
+        if (count[i] == 0)
+        {
+            return 1;
+        }
+        layout.start[i] = start[i];
+        layout.count[i] = count[i];
+        layout.first_chunk[i] = start[i] / chunk_length;
+        layout.num_chunks[i] = (start[i] + count[i] - 1) / chunk_length - layout.first_chunk[i] + 1;
+        num_chunks *= layout.num_chunks[i];
+    }
+    layout.buffer = (uint8_t *)buffer;
+    if (num_chunks < 2)
     {
-        harp_set_error(HARP_ERROR_IMPORT, "dataspace is complex; only simple dataspaces are supported");
-        H5Sclose(space_id);
-        return -1;
+        return 1;
     }
-
-    hdf5_num_dimensions = H5Sget_simple_extent_ndims(space_id);
-    if (hdf5_num_dimensions < 0)
+    num_tasks = harp_get_num_tasks(num_chunks + 1, 1);
+    if (num_tasks < 2)
     {
-        harp_set_error(HARP_ERROR_HDF5, NULL);
-        H5Sclose(space_id);
-        return -1;
+        return 1;
     }
+    batch_size = num_tasks - 1;
 
-    if (hdf5_num_dimensions > HARP_MAX_NUM_DIMS)
+    chunk = malloc(2 * batch_size * sizeof(import_chunk));
+    if (chunk == NULL)
     {
-        harp_set_error(HARP_ERROR_IMPORT, "dataspace has %d dimensions; expected <= %d", hdf5_num_dimensions,
-                       HARP_MAX_NUM_DIMS);
-        H5Sclose(space_id);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       2 * batch_size * sizeof(import_chunk), __FILE__, __LINE__);
         return -1;
     }
-
-    if (H5Sget_simple_extent_dims(space_id, hdf5_dimension, NULL) < 0)
+    for (i = 0; i < 2 * batch_size; i++)
     {
-        harp_set_error(HARP_ERROR_HDF5, NULL);
-        H5Sclose(space_id);
+        chunk[i].layout = &layout;
+        chunk[i].buffer = NULL;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        free(chunk);
         return -1;
     }
 
-    H5Sclose(space_id);
-
-    for (i = 0; i < hdf5_num_dimensions; i++)
+    reader.dataset_id = dataset_id;
+    reader.unallocated = 0;
+    while (next_chunk < num_chunks || num_previous_chunks > 0)
     {
-        int hdf5_num_scales;
+        import_chunk *batch = &chunk[(round % 2) * batch_size];
+        int num_batch_chunks = 0;
+        int num_round_tasks = 0;
 
-        hdf5_num_scales = H5DSget_num_scales(dataset_id, i);
-        if (hdf5_num_scales < 0)
+        while (num_batch_chunks < batch_size && next_chunk < num_chunks)
         {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
-            return -1;
-        }
+            import_chunk *current = &batch[num_batch_chunks];
+            long index = next_chunk;
 
-        if (hdf5_num_scales == 0)
-        {
-            hdf5_dimension_type[i] = harp_dimension_independent;
-            if ((i == 0) && H5DSis_scale(dataset_id))
+            for (i = num_dimensions - 1; i >= 0; i--)
             {
-                /* This variable has the same name as a dimension */
-                for (j = 0; j < HARP_NUM_DIM_TYPES; j++)
-                {
-                    if (strcmp(harp_get_dimension_type_name(j), variable_name) == 0)
-                    {
-                        hdf5_dimension_type[i] = (harp_dimension_type)j;
-                        break;
-                    }
-                }
+                current->offset[i] = (layout.first_chunk[i] + index % layout.num_chunks[i]) *
+                    layout.chunk_dimension[i];
+                index /= layout.num_chunks[i];
             }
+            current->filter_mask = 0;
+            current->buffer = NULL;
+            num_batch_chunks++;
+            next_chunk++;
         }
-        else if (hdf5_num_scales == 1)
+        if (num_batch_chunks > 0)
         {
-            hdf5_object_id hdf5_dimensions_id;
-            int j;
+            reader.num_chunks = num_batch_chunks;
+            reader.chunk = batch;
+            task[num_round_tasks].function = read_chunks;
+            task[num_round_tasks].arg = &reader;
+            num_round_tasks++;
+        }
+        for (i = 0; i < num_previous_chunks; i++)
+        {
+            task[num_round_tasks].function = decompress_chunk;
+            task[num_round_tasks].arg = &previous_batch[i];
+            num_round_tasks++;
+        }
 
-            if (H5DSiterate_scales(dataset_id, i, NULL, hdf5_read_dimension_scale_func, &hdf5_dimensions_id) != 0)
-            {
-                return -1;
-            }
+        if (harp_run_tasks(num_round_tasks, task) != 0)
+        {
+            result = -1;
+            break;
+        }
+        if (reader.unallocated)
+        {
+            result = 1;
+            break;
+        }
+        previous_batch = batch;
+        num_previous_chunks = num_batch_chunks;
+        round++;
+    }
 
-            hdf5_dimension_type[i] = harp_dimension_independent;
+    for (i = 0; i < 2 * batch_size; i++)
+    {
+        if (chunk[i].buffer != NULL)
+        {
+            free(chunk[i].buffer);
+        }
+    }
+    free(task);
+    free(chunk);
 
-            for (j = 0; j < HARP_NUM_DIM_TYPES; j++)
-            {
-                if (!dimension_ids->is_valid[j])
-                {
-                    continue;
-                }
+    return result;
+}
+#endif
 
-                if (dimension_ids->object_id[j].fileno == hdf5_dimensions_id.fileno
-                    && dimension_ids->object_id[j].addr == hdf5_dimensions_id.addr)
-                {
-                    hdf5_dimension_type[i] = (harp_dimension_type)j;
-                    break;
-                }
-            }
+/* Read the data of a dataset. If read_time_range is set then the first dimension is the time dimension and only the
+ * time samples in the range [time_offset, time_offset + dimension[0]) are read (using a hyperslab selection).
+ * If the dataset is compressed (using deflate, or using zstd or lz4 if the corresponding library is available) and
+ * multiple threads are enabled (see harp_set_option_num_threads()), only the chunks that intersect the selection are
+ * read and these are decompressed in parallel.
+ */
+static int read_dataset(hid_t dataset_id, hid_t mem_type_id, int num_dimensions, const long *dimension,
+                        int read_time_range, long time_offset, void *buffer)
+{
+    hsize_t start[HARP_MAX_NUM_DIMS];
+    hsize_t count[HARP_MAX_NUM_DIMS];
+    hid_t file_space_id;
+    hid_t mem_space_id;
+    int i;
+
+    harp_io_statistics_add_read(harp_io_backend_hdf5,
+                                harp_get_num_elements(num_dimensions, dimension) * H5Tget_size(mem_type_id));
+
+#ifdef HAVE_HDF5_DIRECT_CHUNK_READ
+    {
+        long chunk_start[HARP_MAX_NUM_DIMS];
+        int result;
+
+        for (i = 0; i < num_dimensions; i++)
+        {
+            chunk_start[i] = 0;
         }
-        else
+        if (read_time_range)
         {
-            harp_set_error(HARP_ERROR_IMPORT, "dimension at index %d has %d attached dimension scales; expected 0 or 1",
-                           i, hdf5_num_scales);
+            chunk_start[0] = time_offset;
+        }
+        result = read_chunks_in_parallel(dataset_id, mem_type_id, num_dimensions, chunk_start, dimension, buffer);
+        if (result <= 0)
+        {
+            return result;
+        }
+    }
+#endif
+
+    if (!read_time_range)
+    {
+        if (H5Dread(dataset_id, mem_type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
             return -1;
         }
+        return 0;
     }
 
-    *num_dimensions = hdf5_num_dimensions;
-    for (i = 0; i < hdf5_num_dimensions; i++)
+    for (i = 0; i < num_dimensions; i++)
     {
-        dimension_type[i] = hdf5_dimension_type[i];
-        dimension[i] = (long)hdf5_dimension[i];
+        start[i] = 0;
+        count[i] = dimension[i];
+    }
+    start[0] = time_offset;
+
+    file_space_id = H5Dget_space(dataset_id);
+    if (file_space_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+    if (H5Sselect_hyperslab(file_space_id, H5S_SELECT_SET, start, NULL, count, NULL) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Sclose(file_space_id);
+        return -1;
+    }
+    mem_space_id = H5Screate_simple(num_dimensions, count, NULL);
+    if (mem_space_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Sclose(file_space_id);
+        return -1;
+    }
+    if (H5Dread(dataset_id, mem_type_id, mem_space_id, file_space_id, H5P_DEFAULT, buffer) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Sclose(mem_space_id);
+        H5Sclose(file_space_id);
+        return -1;
     }
+    H5Sclose(mem_space_id);
+    H5Sclose(file_space_id);
 
     return 0;
 }
 
 static int read_variable(hid_t dataset_id, const char *name, const hdf5_dimension_ids *dimension_ids,
-                         harp_product *product)
+                         long time_offset, long time_length, harp_product *product)
 {
+    int read_time_range = 0;
     const char *variable_name;
     harp_variable *variable;
     harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
@@ -802,6 +2350,13 @@ static int read_variable(hid_t dataset_id, const char *name, const hdf5_dimensio
         return -1;
     }
 
+    if (time_length >= 0 && num_dimensions > 0 && dimension_type[0] == harp_dimension_time)
+    {
+        assert(time_offset + time_length <= dimension[0]);
+        dimension[0] = time_length;
+        read_time_range = 1;
+    }
+
     variable_name = name;
     if (strncmp(name, "_nc4_non_coord_", 15) == 0)
     {
@@ -825,7 +2380,6 @@ static int read_variable(hid_t dataset_id, const char *name, const hdf5_dimensio
         hid_t type_id;
         hsize_t type_size;
         hid_t mem_type_id;
-        long i;
 
         type_id = H5Dget_type(dataset_id);
         if (type_id < 0)
@@ -874,9 +2428,9 @@ static int read_variable(hid_t dataset_id, const char *name, const hdf5_dimensio
             return -1;
         }
 
-        if (H5Dread(dataset_id, mem_type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer) < 0)
+        if (read_dataset(dataset_id, mem_type_id, num_dimensions, dimension, read_time_range, time_offset, buffer)
+            != 0)
         {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
             free(buffer);
             H5Tclose(mem_type_id);
             return -1;
@@ -884,32 +2438,19 @@ static int read_variable(hid_t dataset_id, const char *name, const hdf5_dimensio
 
         H5Tclose(mem_type_id);
 
-        for (i = 0; i < variable->num_elements; i++)
+        if (harp_variable_set_string_data_from_char_array(variable, (long)type_size, buffer) != 0)
         {
-            char *str;
-
-            str = malloc((type_size + 1) * sizeof(char));
-            if (str == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (type_size + 1) * sizeof(char), __FILE__, __LINE__);
-                free(buffer);
-                return -1;
-            }
-
-            memcpy(str, &buffer[i * type_size], type_size);
-            str[type_size] = '\0';
-            variable->data.string_data[i] = str;
+            free(buffer);
+            return -1;
         }
 
         free(buffer);
     }
     else
     {
-        if (H5Dread(dataset_id, get_hdf5_type(variable->data_type), H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                    variable->data.ptr) < 0)
+        if (read_dataset(dataset_id, get_hdf5_type(variable->data_type), num_dimensions, dimension, read_time_range,
+                         time_offset, variable->data.ptr) != 0)
         {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
             return -1;
         }
     }
@@ -1138,11 +2679,21 @@ static int find_dimensions(hid_t group_id, hdf5_dimension_ids *dimension_ids)
 
 /* Additional arguments for hdf5_read_variable_func(), which is a visitor function that is called for all variables in
  * the root group via H5Literate(), see also read_variables().
+ * If collect_names is set, the visitor only collects the names of all variables. Otherwise, it reads each variable for
+ * which the corresponding entry in include is set (if include is NULL, all variables are read). If time_length >= 0,
+ * only the time samples in the range [time_offset, time_offset + time_length) are read.
  */
 typedef struct hdf5_read_variable_func_args_struct
 {
     hdf5_dimension_ids *dimension_ids;
     harp_product *product;
+    int collect_names;
+    int num_variables;
+    char **variable_name;
+    const uint8_t *include;
+    int variable_index;
+    long time_offset;
+    long time_length;
 } hdf5_read_variable_func_args;
 
 /* don't use -1 on error, otherwise the HDF5 library starts printing error messages to the console */
@@ -1203,7 +2754,45 @@ static herr_t hdf5_read_variable_func(hid_t group_id, const char *name, const H5
         }
     }
 
-    if (read_variable(dataset_id, name, args->dimension_ids, args->product) != 0)
+    if (args->collect_names)
+    {
+        char **variable_name;
+
+        H5Dclose(dataset_id);
+
+        if (args->num_variables % BLOCK_SIZE == 0)
+        {
+            variable_name = (char **)realloc(args->variable_name,
+                                             (args->num_variables + BLOCK_SIZE) * sizeof(char *));
+            if (variable_name == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               (args->num_variables + BLOCK_SIZE) * sizeof(char *), __FILE__, __LINE__);
+                return 1;
+            }
+            args->variable_name = variable_name;
+        }
+
+        args->variable_name[args->num_variables] = strdup(name);
+        if (args->variable_name[args->num_variables] == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            return 1;
+        }
+        args->num_variables++;
+
+        return 0;
+    }
+
+    if (args->include != NULL && !args->include[args->variable_index++])
+    {
+        /* Skip variables that would be removed by the program anyway. */
+        H5Dclose(dataset_id);
+        return 0;
+    }
+
+    if (read_variable(dataset_id, name, args->dimension_ids, args->time_offset, args->time_length, args->product) != 0)
     {
         H5Dclose(dataset_id);
         return 1;
@@ -1214,10 +2803,78 @@ static herr_t hdf5_read_variable_func(hid_t group_id, const char *name, const H5
     return 0;
 }
 
-static int read_variables(hid_t group_id, hdf5_dimension_ids *dimension_ids, harp_product *product)
+static int iterate_variables(hid_t group_id, H5_index_t index_type, hdf5_read_variable_func_args *args)
+{
+    args->variable_index = 0;
+
+    return (H5Literate(group_id, index_type, H5_ITER_INC, NULL, hdf5_read_variable_func, args) != 0 ? -1 : 0);
+}
+
+static void free_variable_names(hdf5_read_variable_func_args *args)
+{
+    if (args->variable_name != NULL)
+    {
+        int i;
+
+        for (i = 0; i < args->num_variables; i++)
+        {
+            if (args->variable_name[i] != NULL)
+            {
+                free(args->variable_name[i]);
+            }
+        }
+        free(args->variable_name);
+        args->variable_name = NULL;
+    }
+    args->num_variables = 0;
+}
+
+static int read_attributes(hid_t group_id, harp_product *product)
+{
+    htri_t result;
+
+    result = H5Aexists(group_id, "source_product");
+    if (result > 0)
+    {
+        if (read_string_attribute(group_id, "source_product", &product->source_product) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (result < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    result = H5Aexists(group_id, "history");
+    if (result > 0)
+    {
+        if (read_string_attribute(group_id, "history", &product->history) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (result < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int read_variables(hid_t group_id, hdf5_dimension_ids *dimension_ids, harp_program *program,
+                          harp_product *product)
 {
     hdf5_read_variable_func_args args;
     H5_index_t index_type;
+    uint8_t *include;
+    uint8_t *filter_include;
+    int has_filter_variables = 0;
+    int num_variables;
+    int result;
+    int i;
 
     if (get_link_iteration_index_type(group_id, &index_type) != 0)
     {
@@ -1226,46 +2883,105 @@ static int read_variables(hid_t group_id, hdf5_dimension_ids *dimension_ids, har
 
     args.dimension_ids = dimension_ids;
     args.product = product;
+    args.collect_names = 0;
+    args.num_variables = 0;
+    args.variable_name = NULL;
+    args.include = NULL;
+    args.variable_index = 0;
+    args.time_offset = 0;
+    args.time_length = -1;
 
-    return (H5Literate(group_id, index_type, H5_ITER_INC, NULL, hdf5_read_variable_func, &args) != 0 ? -1 : 0);
-}
+    if (program == NULL)
+    {
+        return iterate_variables(group_id, index_type, &args);
+    }
 
-static int read_attributes(hid_t group_id, harp_product *product)
-{
-    htri_t result;
+    /* Determine which variables need to be read, based on the keep()/exclude() operations at the start of the
+     * program, and which of them are used by the value filters that directly follow these operations. */
+    args.collect_names = 1;
+    if (iterate_variables(group_id, index_type, &args) != 0)
+    {
+        free_variable_names(&args);
+        return -1;
+    }
+    args.collect_names = 0;
 
-    result = H5Aexists(group_id, "source_product");
-    if (result > 0)
+    num_variables = args.num_variables;
+    if (num_variables == 0)
     {
-        if (read_string_attribute(group_id, "source_product", &product->source_product) != 0)
+        free_variable_names(&args);
+        return 0;
+    }
+
+    include = (uint8_t *)malloc(2 * num_variables * sizeof(uint8_t));
+    if (include == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       2 * num_variables * sizeof(uint8_t), __FILE__, __LINE__);
+        free_variable_names(&args);
+        return -1;
+    }
+    filter_include = &include[num_variables];
+
+    harp_program_get_included_variables(program, num_variables, (const char **)args.variable_name, include);
+    for (i = 0; i < num_variables; i++)
+    {
+        filter_include[i] = include[i] &&
+            harp_program_is_leading_value_filter_variable(program, args.variable_name[i]);
+        has_filter_variables |= filter_include[i];
+    }
+    free_variable_names(&args);
+
+    if (has_filter_variables)
+    {
+        harp_product *filter_product;
+        long offset;
+        long length;
+
+        /* Determine the range of time samples that needs to be read by evaluating the filters. */
+        if (harp_product_new(&filter_product) != 0)
+        {
+            free(include);
+            return -1;
+        }
+        args.product = filter_product;
+        args.include = filter_include;
+        if (iterate_variables(group_id, index_type, &args) != 0)
+        {
+            harp_product_delete(filter_product);
+            free(include);
+            return -1;
+        }
+        /* collocation filters need the source product to select the collocation mask */
+        if (read_attributes(group_id, filter_product) != 0)
         {
+            harp_product_delete(filter_product);
+            free(include);
             return -1;
         }
-    }
-    else if (result < 0)
-    {
-        harp_set_error(HARP_ERROR_HDF5, NULL);
-        return -1;
-    }
-
-    result = H5Aexists(group_id, "history");
-    if (result > 0)
-    {
-        if (read_string_attribute(group_id, "history", &product->history) != 0)
+        if (harp_program_get_leading_value_filter_time_range(program, filter_product, &offset, &length) != 0)
         {
+            harp_product_delete(filter_product);
+            free(include);
             return -1;
         }
-    }
-    else if (result < 0)
-    {
-        harp_set_error(HARP_ERROR_HDF5, NULL);
-        return -1;
+        if (length < filter_product->dimension[harp_dimension_time])
+        {
+            args.time_offset = offset;
+            args.time_length = length;
+        }
+        harp_product_delete(filter_product);
+        args.product = product;
     }
 
-    return 0;
+    args.include = include;
+    result = iterate_variables(group_id, index_type, &args);
+    free(include);
+
+    return result;
 }
 
-static int read_product(hid_t file_id, harp_product *product)
+static int read_product(hid_t file_id, harp_program *program, harp_product *product)
 {
     hdf5_dimension_ids dimension_ids = { {0}, {{0, 0}}, {0} };
     hid_t root_id;
@@ -1285,7 +3001,7 @@ static int read_product(hid_t file_id, harp_product *product)
     }
 
     /* Read variables. */
-    if (read_variables(root_id, &dimension_ids, product) != 0)
+    if (read_variables(root_id, &dimension_ids, program, product) != 0)
     {
         H5Gclose(root_id);
         return -1;
@@ -1335,52 +3051,161 @@ static int verify_product(hid_t file_id)
     return -1;
 }
 
-int harp_import_hdf5(const char *filename, harp_product **product)
+/* read the product from an opened HDF5 file; the file will always be closed by this function */
+static int import_and_close(hid_t file_id, harp_program *program, harp_product **product)
 {
     harp_product *new_product;
+
+    if (verify_product(file_id) != 0)
+    {
+        close_file(file_id);
+        return -1;
+    }
+
+    if (harp_product_new(&new_product) != 0)
+    {
+        close_file(file_id);
+        return -1;
+    }
+
+    if (read_product(file_id, program, new_product) != 0)
+    {
+        harp_product_delete(new_product);
+        close_file(file_id);
+        return -1;
+    }
+
+    *product = new_product;
+
+    close_file(file_id);
+
+    return 0;
+}
+
+int harp_import_hdf5(const char *filename, harp_program *program, harp_product **product)
+{
     hid_t file_id;
 
-    file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
-    if (file_id < 0)
+    if (open_file(filename, &file_id) != 0)
+    {
+        return -1;
+    }
+
+    if (import_and_close(file_id, program, product) != 0)
     {
         harp_add_error_message(" (%s)", filename);
-        harp_set_error(HARP_ERROR_HDF5, NULL);
         return -1;
     }
 
-    if (verify_product(file_id) != 0)
+    return 0;
+}
+
+struct harp_hdf5_file_struct
+{
+    hid_t file_id;
+};
+
+/* Same as harp_import_hdf5(), but if the file is not a HARP product then the file is not closed; it is returned in
+ * 'held_file' instead (and the function fails with HARP_ERROR_UNSUPPORTED_PRODUCT).
+ * As long as the file is held, any other read-only open of the same file (such as the one performed by CODA when the
+ * product gets ingested) reuses the already opened file and its cached metadata inside the HDF5 library.
+ * A held file should be closed using harp_hdf5_release_file().
+ */
+int harp_import_hdf5_or_hold(const char *filename, harp_program *program, harp_product **product,
+                             harp_hdf5_file **held_file)
+{
+    harp_hdf5_file *file;
+    hid_t file_id;
+
+    *held_file = NULL;
+
+    if (open_file(filename, &file_id) != 0)
     {
-        H5Fclose(file_id);
         return -1;
     }
 
-    if (harp_product_new(&new_product) != 0)
+    if (verify_product(file_id) != 0)
     {
-        H5Fclose(file_id);
+        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
+        {
+            close_file(file_id);
+            harp_add_error_message(" (%s)", filename);
+            return -1;
+        }
+
+        file = (harp_hdf5_file *)malloc(sizeof(harp_hdf5_file));
+        if (file == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(harp_hdf5_file), __FILE__, __LINE__);
+            close_file(file_id);
+            return -1;
+        }
+        file->file_id = file_id;
+        *held_file = file;
+
+        harp_add_error_message(" (%s)", filename);
         return -1;
     }
 
-    if (read_product(file_id, new_product) != 0)
+    if (import_and_close(file_id, program, product) != 0)
     {
         harp_add_error_message(" (%s)", filename);
-        harp_product_delete(new_product);
-        H5Fclose(file_id);
         return -1;
     }
 
-    *product = new_product;
+    return 0;
+}
+
+void harp_hdf5_release_file(harp_hdf5_file *file)
+{
+    if (file != NULL)
+    {
+        close_file(file->file_id);
+        free(file);
+    }
+}
 
-    H5Fclose(file_id);
+/* the buffer is only read from and needs to remain available until the import is finished */
+int harp_import_hdf5_from_memory(const void *buffer, long size, harp_program *program, harp_product **product)
+{
+    hid_t file_id;
 
-    return 0;
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "buffer is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (size <= 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid buffer size (%ld) (%s:%u)", size, __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* open the file image read-only, without copying the buffer and without taking ownership of it */
+    file_id = H5LTopen_file_image((void *)buffer, (size_t)size, H5LT_FILE_IMAGE_DONT_COPY |
+                                  H5LT_FILE_IMAGE_DONT_RELEASE);
+    if (file_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_hdf5);
+
+    return import_and_close(file_id, program, product);
 }
 
+static const char *spatial_extent_attribute_name[4] = {
+    "geospatial_lat_min", "geospatial_lat_max", "geospatial_lon_min", "geospatial_lon_max"
+};
+
 int harp_import_global_attributes_hdf5(const char *filename, double *datetime_start, double *datetime_stop,
-                                       long dimension[], char **source_product)
+                                       double *spatial_extent, long dimension[], char **source_product)
 {
     char *attr_source_product = NULL;
     harp_scalar attr_datetime_start;
     harp_scalar attr_datetime_stop;
+    double attr_spatial_extent[4];
     harp_data_type attr_data_type;
     long attr_dimension[HARP_NUM_DIM_TYPES];
     hid_t file_id;
@@ -1394,17 +3219,14 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
         return -1;
     }
 
-    file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
-    if (file_id < 0)
+    if (open_file(filename, &file_id) != 0)
     {
-        harp_add_error_message(" (%s)", filename);
-        harp_set_error(HARP_ERROR_HDF5, NULL);
         return -1;
     }
 
     if (verify_product(file_id) != 0)
     {
-        H5Fclose(file_id);
+        close_file(file_id);
         return -1;
     }
 
@@ -1412,7 +3234,7 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
     if (root_id < 0)
     {
         harp_set_error(HARP_ERROR_HDF5, NULL);
-        H5Fclose(file_id);
+        close_file(file_id);
         return -1;
     }
 
@@ -1424,14 +3246,14 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
             if (read_numeric_attribute(root_id, "datetime_start", &attr_data_type, &attr_datetime_start) != 0)
             {
                 H5Gclose(root_id);
-                H5Fclose(file_id);
+                close_file(file_id);
                 return -1;
             }
             if (attr_data_type != harp_type_double)
             {
                 harp_set_error(HARP_ERROR_IMPORT, "attribute 'datetime_start' has invalid type");
                 H5Gclose(root_id);
-                H5Fclose(file_id);
+                close_file(file_id);
                 return -1;
             }
         }
@@ -1439,7 +3261,7 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
         {
             harp_set_error(HARP_ERROR_HDF5, NULL);
             H5Gclose(root_id);
-            H5Fclose(file_id);
+            close_file(file_id);
             return -1;
         }
         else
@@ -1456,14 +3278,14 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
             if (read_numeric_attribute(root_id, "datetime_stop", &attr_data_type, &attr_datetime_stop) != 0)
             {
                 H5Gclose(root_id);
-                H5Fclose(file_id);
+                close_file(file_id);
                 return -1;
             }
             if (attr_data_type != harp_type_double)
             {
                 harp_set_error(HARP_ERROR_IMPORT, "attribute 'datetime_stop' has invalid type");
                 H5Gclose(root_id);
-                H5Fclose(file_id);
+                close_file(file_id);
                 return -1;
             }
         }
@@ -1471,7 +3293,7 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
         {
             harp_set_error(HARP_ERROR_HDF5, NULL);
             H5Gclose(root_id);
-            H5Fclose(file_id);
+            close_file(file_id);
             return -1;
         }
         else
@@ -1480,6 +3302,42 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
         }
     }
 
+    if (spatial_extent != NULL)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            attr_spatial_extent[i] = harp_nan();
+            result = H5Aexists(root_id, spatial_extent_attribute_name[i]);
+            if (result > 0)
+            {
+                harp_scalar value;
+
+                if (read_numeric_attribute(root_id, spatial_extent_attribute_name[i], &attr_data_type, &value) != 0)
+                {
+                    H5Gclose(root_id);
+                    close_file(file_id);
+                    return -1;
+                }
+                if (attr_data_type != harp_type_double)
+                {
+                    harp_set_error(HARP_ERROR_IMPORT, "attribute '%s' has invalid type",
+                                   spatial_extent_attribute_name[i]);
+                    H5Gclose(root_id);
+                    close_file(file_id);
+                    return -1;
+                }
+                attr_spatial_extent[i] = value.double_data;
+            }
+            else if (result < 0)
+            {
+                harp_set_error(HARP_ERROR_HDF5, NULL);
+                H5Gclose(root_id);
+                close_file(file_id);
+                return -1;
+            }
+        }
+    }
+
     if (dimension != NULL)
     {
         hdf5_dimension_ids dimension_ids = { {0}, {{0, 0}}, {0} };
@@ -1488,7 +3346,7 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
         if (find_dimensions(root_id, &dimension_ids) != 0)
         {
             H5Gclose(root_id);
-            H5Fclose(file_id);
+            close_file(file_id);
             return -1;
         }
 
@@ -1513,7 +3371,7 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
             if (read_string_attribute(root_id, "source_product", &attr_source_product) != 0)
             {
                 H5Gclose(root_id);
-                H5Fclose(file_id);
+                close_file(file_id);
                 return -1;
             }
         }
@@ -1521,7 +3379,7 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
         {
             harp_set_error(HARP_ERROR_HDF5, NULL);
             H5Gclose(root_id);
-            H5Fclose(file_id);
+            close_file(file_id);
             return -1;
         }
         else
@@ -1533,13 +3391,13 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
                 harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
                                __LINE__);
                 H5Gclose(root_id);
-                H5Fclose(file_id);
+                close_file(file_id);
                 return -1;
             }
         }
     }
 
-    H5Fclose(file_id);
+    close_file(file_id);
 
     if (datetime_start != NULL)
     {
@@ -1551,6 +3409,14 @@ int harp_import_global_attributes_hdf5(const char *filename, double *datetime_st
         *datetime_stop = attr_datetime_stop.double_data;
     }
 
+    if (spatial_extent != NULL)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            spatial_extent[i] = attr_spatial_extent[i];
+        }
+    }
+
     if (source_product != NULL)
     {
         *source_product = attr_source_product;
@@ -1701,6 +3567,7 @@ static int write_numeric_attribute(hid_t obj_id, const char *name, harp_data_typ
 
 static int write_variable(hid_t group_id, const char *name, harp_variable *variable)
 {
+    hdf5_compression compression;
     hsize_t dimension[HARP_MAX_NUM_DIMS];
     hid_t space_id;
     hid_t dcpl_id;
@@ -1778,7 +3645,8 @@ static int write_variable(hid_t group_id, const char *name, harp_variable *varia
             return -1;
         }
 
-        if (set_compression(dcpl_id, variable) != 0)
+        get_variable_compression(name, variable, buffer, variable->num_elements * length, length, &compression);
+        if (set_compression(dcpl_id, variable, length, &compression) != 0)
         {
             H5Pclose(dcpl_id);
             H5Sclose(space_id);
@@ -1839,7 +3707,10 @@ static int write_variable(hid_t group_id, const char *name, harp_variable *varia
             return -1;
         }
 
-        if (set_compression(dcpl_id, variable) != 0)
+        get_variable_compression(name, variable, variable->data.ptr,
+                                 variable->num_elements * harp_get_size_for_type(variable->data_type),
+                                 harp_get_size_for_type(variable->data_type), &compression);
+        if (set_compression(dcpl_id, variable, harp_get_size_for_type(variable->data_type), &compression) != 0)
         {
             H5Pclose(dcpl_id);
             H5Sclose(space_id);
@@ -1858,10 +3729,8 @@ static int write_variable(hid_t group_id, const char *name, harp_variable *varia
         H5Pclose(dcpl_id);
         H5Sclose(space_id);
 
-        if (H5Dwrite(dataset_id, get_hdf5_type(variable->data_type), H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                     variable->data.ptr) < 0)
+        if (write_numeric_data(dataset_id, variable, &compression) != 0)
         {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
             H5Dclose(dataset_id);
             return -1;
         }
@@ -2272,6 +4141,7 @@ static int write_attributes(hid_t group_id, const harp_product *product)
 {
     harp_scalar datetime_start;
     harp_scalar datetime_stop;
+    harp_scalar spatial_extent[4];
 
     if (harp_product_get_datetime_range(product, &datetime_start.double_data, &datetime_stop.double_data) == 0)
     {
@@ -2286,6 +4156,21 @@ static int write_attributes(hid_t group_id, const harp_product *product)
         }
     }
 
+    if (harp_product_get_spatial_extent(product, &spatial_extent[0].double_data, &spatial_extent[1].double_data,
+                                        &spatial_extent[2].double_data, &spatial_extent[3].double_data) == 0)
+    {
+        int i;
+
+        for (i = 0; i < 4; i++)
+        {
+            if (write_numeric_attribute(group_id, spatial_extent_attribute_name[i], harp_type_double,
+                                        spatial_extent[i]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
     if (product->source_product != NULL && strcmp(product->source_product, "") != 0)
     {
         if (write_string_attribute(group_id, "source_product", product->source_product) != 0)
@@ -2358,13 +4243,16 @@ static int write_product(hid_t file_id, const harp_product *product)
         {
             return -1;
         }
+        harp_trace_begin("export(%s)", product->variable[i]->name);
         if (write_variable(root_id, name, product->variable[i]) != 0)
         {
+            harp_trace_end();
             free(name);
             dimensions_done(&dimensions);
             H5Gclose(root_id);
             return -1;
         }
+        harp_trace_end();
         free(name);
     }
 
@@ -2388,21 +4276,17 @@ static int write_product(hid_t file_id, const harp_product *product)
     return 0;
 }
 
-int harp_export_hdf5(const char *filename, const harp_product *product)
+/* create a new HDF5 file using the given file access property list; filename is only used as name for the file */
+static int create_file(const char *filename, hid_t fapl_id, hid_t *file_id)
 {
-    hid_t file_id;
     hid_t fcpl_id;
 
-    if (filename == NULL)
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL");
-        return -1;
-    }
-
-    if (product == NULL)
+    if (harp_get_option_hdf5_compression() > 0 &&
+        strcmp(harp_get_option_hdf5_compression_filter(), "deflate") != 0 &&
+        get_compression_filter() == H5Z_FILTER_DEFLATE)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL");
-        return -1;
+        harp_report_warning("HDF5 %s filter is not available; using deflate compression instead",
+                            harp_get_option_hdf5_compression_filter());
     }
 
     /* Setup file creation property list to enable link and attribute creation
@@ -2429,25 +4313,89 @@ int harp_export_hdf5(const char *filename, const harp_product *product)
         return -1;
     }
 
-    file_id = H5Fcreate(filename, H5F_ACC_TRUNC, fcpl_id, H5P_DEFAULT);
-    if (file_id < 0)
+    if (harp_get_option_hdf5_page_size() > 0)
+    {
+#ifdef HAVE_HDF5_PAGED_FILE_SPACE
+        hid_t page_fapl_id;
+
+        /* aggregate metadata and raw data into separate pages, such that the metadata is stored together */
+        if (H5Pset_file_space_strategy(fcpl_id, H5F_FSPACE_STRATEGY_PAGE, 0, 1) < 0 ||
+            H5Pset_file_space_page_size(fcpl_id, (hsize_t)harp_get_option_hdf5_page_size()) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            H5Pclose(fcpl_id);
+            return -1;
+        }
+
+        page_fapl_id = H5Pcopy(fapl_id == H5P_DEFAULT ? H5P_FILE_ACCESS_DEFAULT : fapl_id);
+        if (page_fapl_id < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            H5Pclose(fcpl_id);
+            return -1;
+        }
+        if (H5Pset_meta_block_size(page_fapl_id, (hsize_t)harp_get_option_hdf5_page_size()) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            H5Pclose(page_fapl_id);
+            H5Pclose(fcpl_id);
+            return -1;
+        }
+
+        *file_id = H5Fcreate(filename, H5F_ACC_TRUNC, fcpl_id, page_fapl_id);
+        H5Pclose(page_fapl_id);
+#else
+        harp_report_warning("HDF5 paged file space management requires HDF5 1.10.1 or later; ignoring page size");
+        *file_id = H5Fcreate(filename, H5F_ACC_TRUNC, fcpl_id, fapl_id);
+#endif
+    }
+    else
+    {
+        *file_id = H5Fcreate(filename, H5F_ACC_TRUNC, fcpl_id, fapl_id);
+    }
+    if (*file_id < 0)
     {
         harp_set_error(HARP_ERROR_HDF5, NULL);
-        harp_add_error_message(" (%s)", filename);
         H5Pclose(fcpl_id);
         return -1;
     }
+    harp_io_statistics_add_open(harp_io_backend_hdf5);
 
     H5Pclose(fcpl_id);
 
+    return 0;
+}
+
+int harp_export_hdf5(const char *filename, const harp_product *product)
+{
+    hid_t file_id;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL");
+        return -1;
+    }
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL");
+        return -1;
+    }
+
+    if (create_file(filename, H5P_DEFAULT, &file_id) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        return -1;
+    }
+
     if (write_product(file_id, product) != 0)
     {
         harp_add_error_message(" (%s)", filename);
-        H5Fclose(file_id);
+        close_file(file_id);
         return -1;
     }
 
-    if (H5Fclose(file_id) < 0)
+    if (close_file(file_id) < 0)
     {
         harp_set_error(HARP_ERROR_HDF5, NULL);
         harp_add_error_message(" (%s)", filename);
@@ -2457,6 +4405,98 @@ int harp_export_hdf5(const char *filename, const harp_product *product)
     return 0;
 }
 
+/* the returned buffer should be freed by the caller using free() */
+int harp_export_hdf5_to_memory(const harp_product *product, void **buffer, long *size)
+{
+    hid_t fapl_id;
+    hid_t file_id;
+    ssize_t image_size;
+    void *image;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL");
+        return -1;
+    }
+    if (buffer == NULL || size == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "buffer is NULL");
+        return -1;
+    }
+
+    /* use the core driver without backing store such that the file only exists in memory */
+    fapl_id = H5Pcreate(H5P_FILE_ACCESS);
+    if (fapl_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+    if (H5Pset_fapl_core(fapl_id, HDF5_CORE_INCREMENT, 0) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Pclose(fapl_id);
+        return -1;
+    }
+
+    if (create_file("<memory>", fapl_id, &file_id) != 0)
+    {
+        H5Pclose(fapl_id);
+        return -1;
+    }
+
+    H5Pclose(fapl_id);
+
+    if (write_product(file_id, product) != 0)
+    {
+        close_file(file_id);
+        return -1;
+    }
+
+    if (H5Fflush(file_id, H5F_SCOPE_LOCAL) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        close_file(file_id);
+        return -1;
+    }
+
+    image_size = H5Fget_file_image(file_id, NULL, 0);
+    if (image_size < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        close_file(file_id);
+        return -1;
+    }
+
+    image = malloc(image_size > 0 ? (size_t)image_size : 1);
+    if (image == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)image_size, __FILE__, __LINE__);
+        close_file(file_id);
+        return -1;
+    }
+
+    if (H5Fget_file_image(file_id, image, (size_t)image_size) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        free(image);
+        close_file(file_id);
+        return -1;
+    }
+
+    if (close_file(file_id) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        free(image);
+        return -1;
+    }
+
+    *buffer = image;
+    *size = (long)image_size;
+
+    return 0;
+}
+
 static herr_t add_error_message(int n, H5E_error_t *err_desc, void *client_data)
 {
     (void)client_data;
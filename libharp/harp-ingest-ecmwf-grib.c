@@ -818,34 +818,49 @@ static int read_2d_grid_data(ingest_info *info, grib_parameter parameter, long i
     return read_grid_data(info, info->grid_data_index[parameter * info->num_levels], index, data);
 }
 
-static int read_3d_grid_data(ingest_info *info, grib_parameter parameter, long index, harp_array data)
+static int read_3d_grid_data(ingest_info *info, grib_parameter parameter, harp_array data)
 {
-    long dimension_transpose[2];
-    long i;
+    float *message_data;
+    long i, j, k;
 
     assert(info->has_parameter[parameter]);
 
-    dimension_transpose[0] = info->num_levels;
-    dimension_transpose[1] = info->num_longitudes;
+    message_data = malloc(info->num_latitudes * info->num_longitudes * sizeof(float));
+    if (message_data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->num_latitudes * info->num_longitudes * sizeof(float), __FILE__, __LINE__);
+        return -1;
+    }
 
-    /* we read the data as [vertical,longitude] */
+    /* decode each message in one go and store its values directly at their [latitude,longitude,vertical] position */
     for (i = 0; i < info->num_levels; i++)
     {
-        harp_array subgrid;
-
-        subgrid.float_data = &data.float_data[i * info->num_longitudes];
         /* invert the loop because level 0 = TOA */
-        if (read_grid_data(info, info->grid_data_index[(parameter + 1) * info->num_levels - 1 - i], index, subgrid) !=
-            0)
+        long grid_data_index = info->grid_data_index[(parameter + 1) * info->num_levels - 1 - i];
+
+        assert(grid_data_index >= 0);
+        if (coda_cursor_read_float_array(&info->parameter_cursor[grid_data_index], message_data,
+                                         coda_array_ordering_c) != 0)
         {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            free(message_data);
             return -1;
         }
+        for (j = 0; j < info->num_latitudes; j++)
+        {
+            /* flip latitude dimension, so it becomes ascending */
+            const float *row = &message_data[(info->num_latitudes - j - 1) * info->num_longitudes];
+            float *target = &data.float_data[j * info->num_longitudes * info->num_levels + i];
+
+            for (k = 0; k < info->num_longitudes; k++)
+            {
+                target[k * info->num_levels] = row[k];
+            }
+        }
     }
-    /* and then reorder dimensions from [vertical,longitude] to [longitude,vertical] */
-    if (harp_array_transpose(harp_type_float, 2, dimension_transpose, NULL, data) != 0)
-    {
-        return -1;
-    }
+
+    free(message_data);
 
     return 0;
 }
@@ -933,14 +948,14 @@ static int read_z(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_z, index, data);
 }
 
-static int read_t(void *user_data, long index, harp_array data)
+static int read_t(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_t, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_t, data);
 }
 
-static int read_q(void *user_data, long index, harp_array data)
+static int read_q(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_q, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_q, data);
 }
 
 static int read_tcwv(void *user_data, long index, harp_array data)
@@ -948,9 +963,9 @@ static int read_tcwv(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_tcwv, index, data);
 }
 
-static int read_vo(void *user_data, long index, harp_array data)
+static int read_vo(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_vo, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_vo, data);
 }
 
 static int read_lnsp(void *user_data, long index, harp_array data)
@@ -1057,24 +1072,24 @@ static int read_lsm(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_lsm, index, data);
 }
 
-static int read_clwc(void *user_data, long index, harp_array data)
+static int read_clwc(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_clwc, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_clwc, data);
 }
 
-static int read_ciwc(void *user_data, long index, harp_array data)
+static int read_ciwc(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_ciwc, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_ciwc, data);
 }
 
-static int read_co2(void *user_data, long index, harp_array data)
+static int read_co2(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_co2, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_co2, data);
 }
 
-static int read_ch4(void *user_data, long index, harp_array data)
+static int read_ch4(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_ch4, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_ch4, data);
 }
 
 static int read_pm1(void *user_data, long index, harp_array data)
@@ -1092,24 +1107,24 @@ static int read_pm10(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_pm10, index, data);
 }
 
-static int read_no2(void *user_data, long index, harp_array data)
+static int read_no2(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_no2, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_no2, data);
 }
 
-static int read_so2(void *user_data, long index, harp_array data)
+static int read_so2(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_so2, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_so2, data);
 }
 
-static int read_co(void *user_data, long index, harp_array data)
+static int read_co(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_co, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_co, data);
 }
 
-static int read_hcho(void *user_data, long index, harp_array data)
+static int read_hcho(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_hcho, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_hcho, data);
 }
 
 static int read_tcno2(void *user_data, long index, harp_array data)
@@ -1132,9 +1147,9 @@ static int read_tchcho(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_tchcho, index, data);
 }
 
-static int read_go3(void *user_data, long index, harp_array data)
+static int read_go3(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_go3, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_go3, data);
 }
 
 static int read_gtco3(void *user_data, long index, harp_array data)
@@ -1226,39 +1241,39 @@ static int read_suaod(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_suaod550, index, data);
 }
 
-static int read_hno3(void *user_data, long index, harp_array data)
+static int read_hno3(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_hno3, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_hno3, data);
 }
 
-static int read_pan(void *user_data, long index, harp_array data)
+static int read_pan(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_pan, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_pan, data);
 }
 
-static int read_c5h8(void *user_data, long index, harp_array data)
+static int read_c5h8(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_c5h8, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_c5h8, data);
 }
 
-static int read_no(void *user_data, long index, harp_array data)
+static int read_no(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_no, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_no, data);
 }
 
-static int read_oh(void *user_data, long index, harp_array data)
+static int read_oh(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_oh, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_oh, data);
 }
 
-static int read_c2h6(void *user_data, long index, harp_array data)
+static int read_c2h6(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_c2h6, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_c2h6, data);
 }
 
-static int read_c3h8(void *user_data, long index, harp_array data)
+static int read_c3h8(void *user_data, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_c3h8, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_c3h8, data);
 }
 
 static int read_tc_ch4(void *user_data, long index, harp_array data)
@@ -3053,17 +3068,17 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* t: temperature */
     description = "temperature";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "temperature",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "K", exclude_t, read_t);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "temperature", harp_type_float,
+                                                                     3, &dimension_type[1], NULL, description, "K",
+                                                                     exclude_t, read_t);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,130), (160,130), (170,130), (180,130), "
                                "or (190,130)", "(discipline,category,number) = (0,0,0)");
 
     /* q: H2O_mass_mixing_ratio */
     description = "specific humidity";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "H2O_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_q, read_q);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "H2O_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_q, read_q);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,133), (160,133), (170,133), (180,133), "
                                "or (190,133)", "(discipline,category,number) = (0,1,0)");
 
@@ -3077,9 +3092,9 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* vo: relative_vorticity */
     description = "relative vorticity";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "relative_vorticity",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "1/s", exclude_vo, read_vo);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "relative_vorticity",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "1/s", exclude_vo, read_vo);
     add_value_variable_mapping(variable_definition,
                                "(table,indicator) = (160,138), (128,138), (170,138), (180, 138) or (190,138)",
                                "(discipline,category,number) = (0,2,12)");
@@ -3170,33 +3185,33 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* clwc: LWC_mass_mixing_ratio */
     description = "specific cloud liquid water content";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "LWC_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_clwc, read_clwc);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "LWC_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_clwc, read_clwc);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,246)",
                                "(discipline,category,number) = (0,1,83)");
 
     /* ciwc: IWC_mass_mixing_ratio */
     description = "specific cloud ice water content";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "IWC_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_ciwc, read_ciwc);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "IWC_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_ciwc, read_ciwc);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,247)",
                                "(discipline,category,number) = (0,1,84)");
 
     /* co2: CO2_mass_mixing_ratio */
     description = "carbon dioxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "CO2_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_co2, read_co2);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "CO2_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_co2, read_co2);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,61)",
                                "(discipline,category,number) = (192,210,61)");
 
     /* ch4: CH4_mass_mixing_ratio */
     description = "methane mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "CH4_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_ch4, read_ch4);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "CH4_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_ch4, read_ch4);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,62) or (217,4)",
                                "(discipline,category,number) = (192,210,62) or (192,217,4)");
 
@@ -3226,33 +3241,33 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* no2: NO2_mass_mixing_ratio */
     description = "nitrogen dioxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "NO2_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_no2, read_no2);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "NO2_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_no2, read_no2);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,121)",
                                "(discipline,category,number) = (192,210,121)");
 
     /* so2: SO2_mass_mixing_ratio */
     description = "sulphur dioxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "SO2_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_so2, read_so2);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "SO2_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_so2, read_so2);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,122)",
                                "(discipline,category,number) = (192,210,122)");
 
     /* co: CO_mass_mixing_ratio */
     description = "carbon monoxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "CO_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_co, read_co);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "CO_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_co, read_co);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,123)",
                                "(discipline,category,number) = (192,210,123)");
 
     /* hcho: HCHO_mass_mixing_ratio */
     description = "formaldehyde mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "HCHO_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_hcho, read_hcho);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "HCHO_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_hcho, read_hcho);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,124)",
                                "(discipline,category,number) = (192,210,124)");
 
@@ -3291,9 +3306,9 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* go3: O3_mass_mixing_ratio */
     description = "ozone mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "O3_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_go3, read_go3);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "O3_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_go3, read_go3);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,203)",
                                "(discipline,category,number) = (192,210,203)");
 
@@ -3368,57 +3383,57 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* hno3: HNO3_mass_mixing_ratio */
     description = "nitric acid mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "HNO3_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_hno3, read_hno3);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "HNO3_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_hno3, read_hno3);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,6)",
                                "(discipline,category,number) = (192,217,6)");
 
     /* pan: C2H3NO5_mass_mixing_ratio */
     description = "peroxyacetyl nitrate (PAN) mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "C2H3NO5_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_pan, read_pan);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "C2H3NO5_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_pan, read_pan);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,13)",
                                "(discipline,category,number) = (192,217,13)");
 
     /* c5h8: C5H8_mass_mixing_ratio */
     description = "isoprene mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "C5H8_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_c5h8, read_c5h8);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "C5H8_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_c5h8, read_c5h8);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,16)",
                                "(discipline,category,number) = (192,217,16)");
 
     /* no: NO_mass_mixing_ratio */
     description = "nitrogen monoxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "NO_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_no, read_no);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "NO_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_no, read_no);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,27)",
                                "(discipline,category,number) = (192,217,27)");
 
     /* oh: OH_mass_mixing_ratio */
     description = "hydroxyl radical mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "OH_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_oh, read_oh);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "OH_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_oh, read_oh);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,30)",
                                "(discipline,category,number) = (192,217,30)");
 
     /* c2h6: C2H6_mass_mixing_ratio */
     description = "ethane mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "C2H6_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_c2h6, read_c2h6);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "C2H6_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_c2h6, read_c2h6);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,45)",
                                "(discipline,category,number) = (192,217,45)");
 
     /* c3h8: C3H8_mass_mixing_ratio */
     description = "propane mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "C3H8_mass_mixing_ratio",
-                                                                      harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", exclude_c3h8, read_c3h8);
+    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "C3H8_mass_mixing_ratio",
+                                                                     harp_type_float, 3, &dimension_type[1], NULL,
+                                                                     description, "kg/kg", exclude_c3h8, read_c3h8);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,47)",
                                "(discipline,category,number) = (192,217,47)");
 
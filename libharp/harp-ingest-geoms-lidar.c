@@ -95,8 +95,8 @@ static int read_attribute(void *user_data, const char *path, harp_array data)
 static int read_variable_double(void *user_data, const char *path, long num_elements, harp_array data)
 {
     coda_cursor cursor;
-    long actual_num_elements, i;
-    double fill_value;
+    long actual_num_elements;
+    harp_scalar fill_value;
 
     if (coda_cursor_set_product(&cursor, ((ingest_info *)user_data)->product) != 0)
     {
@@ -129,21 +129,12 @@ static int read_variable_double(void *user_data, const char *path, long num_elem
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (coda_cursor_read_double(&cursor, &fill_value) != 0)
+    if (coda_cursor_read_double(&cursor, &fill_value.double_data) != 0)
     {
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (!harp_isnan(fill_value))
-    {
-        for (i = 0; i < num_elements; i++)
-        {
-            if (data.double_data[i] == fill_value)
-            {
-                data.double_data[i] = harp_nan();
-            }
-        }
-    }
+    harp_array_replace_fill_value(harp_type_double, num_elements, data, fill_value);
 
     return 0;
 }
@@ -274,7 +265,6 @@ static int get_product_definition(const harp_ingestion_module *module, coda_prod
 {
     coda_cursor cursor;
     char template_name[100];
-    int i;
 
     if (coda_cursor_set_product(&cursor, product) != 0)
     {
@@ -292,13 +282,10 @@ static int get_product_definition(const harp_ingestion_module *module, coda_prod
         return -1;
     }
 
-    for (i = 0; i < module->num_product_definitions; i++)
+    *definition = harp_ingestion_module_find_product_definition(module, template_name);
+    if (*definition != NULL)
     {
-        if (strcmp(template_name, module->product_definition[i]->name) == 0)
-        {
-            *definition = module->product_definition[i];
-            return 0;
-        }
+        return 0;
     }
 
     harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, "GEOMS template '%s' not supported", template_name);
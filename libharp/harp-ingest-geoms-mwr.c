@@ -128,8 +128,8 @@ static int read_attribute(void *user_data, const char *path, harp_array data)
 static int read_variable_double(void *user_data, const char *path, long num_elements, harp_array data)
 {
     coda_cursor cursor;
-    long actual_num_elements, i;
-    double fill_value;
+    long actual_num_elements;
+    harp_scalar fill_value;
 
     if (coda_cursor_set_product(&cursor, ((ingest_info *)user_data)->product) != 0)
     {
@@ -162,21 +162,12 @@ static int read_variable_double(void *user_data, const char *path, long num_elem
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (coda_cursor_read_double(&cursor, &fill_value) != 0)
+    if (coda_cursor_read_double(&cursor, &fill_value.double_data) != 0)
     {
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (!harp_isnan(fill_value))
-    {
-        for (i = 0; i < num_elements; i++)
-        {
-            if (data.double_data[i] == fill_value)
-            {
-                data.double_data[i] = harp_nan();
-            }
-        }
-    }
+    harp_array_replace_fill_value(harp_type_double, num_elements, data, fill_value);
 
     return 0;
 }
@@ -186,7 +177,7 @@ static int read_variable_double_replicated(void *user_data, const char *path, lo
 {
     coda_cursor cursor;
     long actual_num_elements, i;
-    double fill_value;
+    harp_scalar fill_value;
 
     if (coda_cursor_set_product(&cursor, ((ingest_info *)user_data)->product) != 0)
     {
@@ -219,21 +210,12 @@ static int read_variable_double_replicated(void *user_data, const char *path, lo
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (coda_cursor_read_double(&cursor, &fill_value) != 0)
+    if (coda_cursor_read_double(&cursor, &fill_value.double_data) != 0)
     {
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (!harp_isnan(fill_value))
-    {
-        for (i = 0; i < actual_num_elements; i++)
-        {
-            if (data.double_data[i] == fill_value)
-            {
-                data.double_data[i] = harp_nan();
-            }
-        }
-    }
+    harp_array_replace_fill_value(harp_type_double, actual_num_elements, data, fill_value);
     if (actual_num_elements < num_elements)
     {
         for (i = 1; i < num_time; i++)
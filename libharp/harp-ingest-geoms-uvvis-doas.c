@@ -170,8 +170,8 @@ static int read_attribute(void *user_data, const char *path, harp_array data)
 static int read_variable_double(void *user_data, const char *path, long num_elements, harp_array data)
 {
     coda_cursor cursor;
-    long actual_num_elements, i;
-    double fill_value;
+    long actual_num_elements;
+    harp_scalar fill_value;
 
     if (coda_cursor_set_product(&cursor, ((ingest_info *)user_data)->product) != 0)
     {
@@ -204,21 +204,12 @@ static int read_variable_double(void *user_data, const char *path, long num_elem
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (coda_cursor_read_double(&cursor, &fill_value) != 0)
+    if (coda_cursor_read_double(&cursor, &fill_value.double_data) != 0)
     {
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (!harp_isnan(fill_value))
-    {
-        for (i = 0; i < num_elements; i++)
-        {
-            if (data.double_data[i] == fill_value)
-            {
-                data.double_data[i] = harp_nan();
-            }
-        }
-    }
+    harp_array_replace_fill_value(harp_type_double, num_elements, data, fill_value);
 
     return 0;
 }
@@ -322,7 +313,7 @@ static int read_vertical_variable_double_replicated(void *user_data, const char
 {
     coda_cursor cursor;
     long actual_num_elements, i;
-    double fill_value;
+    harp_scalar fill_value;
 
     if (coda_cursor_set_product(&cursor, ((ingest_info *)user_data)->product) != 0)
     {
@@ -355,21 +346,12 @@ static int read_vertical_variable_double_replicated(void *user_data, const char
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (coda_cursor_read_double(&cursor, &fill_value) != 0)
+    if (coda_cursor_read_double(&cursor, &fill_value.double_data) != 0)
     {
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (!harp_isnan(fill_value))
-    {
-        for (i = 0; i < actual_num_elements; i++)
-        {
-            if (data.double_data[i] == fill_value)
-            {
-                data.double_data[i] = harp_nan();
-            }
-        }
-    }
+    harp_array_replace_fill_value(harp_type_double, actual_num_elements, data, fill_value);
 
     if (actual_num_elements < num_elements)
     {
@@ -1416,14 +1398,11 @@ static int get_product_definition(const harp_ingestion_module *module, coda_prod
 
     if (expected_type == uvvis_doas_offaxis_aerosol)
     {
-        for (i = 0; i < module->num_product_definitions; i++)
+        /* match against product definition name: '<template_name>' */
+        *definition = harp_ingestion_module_find_product_definition(module, template_name);
+        if (*definition != NULL)
         {
-            /* match against product definition name: '<template_name>' */
-            if (strcmp(template_name, module->product_definition[i]->name) == 0)
-            {
-                *definition = module->product_definition[i];
-                return 0;
-            }
+            return 0;
         }
         harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, "GEOMS template '%s' not supported", template_name);
     }
@@ -175,30 +175,39 @@ static void copy_double_data_to_following_rows(long num_rows_with_data, long num
     }
 }
 
-static int get_main_datetime_data(ingest_info *info, double *double_data_array)
+static int get_record_start_time(ingest_info *info, long mdr_record, double *time_from_record)
 {
     coda_cursor cursor;
+
+    cursor = info->mdr_lightsource_cursors[mdr_record];
+    if (coda_cursor_goto(&cursor, "RECORD_HEADER") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_goto_record_field_by_name(&cursor, "RECORD_START_TIME") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_double(&cursor, time_from_record) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+static int get_main_datetime_data(ingest_info *info, double *double_data_array)
+{
     double *double_data, time_from_record;
     long i, j;
 
     double_data = double_data_array;
     for (i = 0; i < info->num_mdr_records; i++)
     {
-        cursor = info->mdr_lightsource_cursors[i];
-
-        if (coda_cursor_goto(&cursor, "RECORD_HEADER") != 0)
-        {
-            harp_set_error(HARP_ERROR_CODA, NULL);
-            return -1;
-        }
-        if (coda_cursor_goto_record_field_by_name(&cursor, "RECORD_START_TIME") != 0)
-        {
-            harp_set_error(HARP_ERROR_CODA, NULL);
-            return -1;
-        }
-        if (coda_cursor_read_double(&cursor, &time_from_record) != 0)
+        if (get_record_start_time(info, i, &time_from_record) != 0)
         {
-            harp_set_error(HARP_ERROR_CODA, NULL);
             return -1;
         }
         for (j = info->readout_offset[i]; j < MAX_READOUTS_PER_MDR_RECORD; j++)
@@ -516,9 +525,9 @@ static int get_spectral_data_per_band(coda_cursor cursor_start_of_band, ingest_i
                                       double *data_startposition)
 {
     const double undefined_int32_vsf_value = -2147483648.0E128;
-    coda_cursor cursor, start_of_band_array_element;
+    coda_cursor cursor;
     double *double_data, *dest_data, rad, nan, integration_time_this_band;
-    long i, j, k, double_data_row;
+    long i, j, k, double_data_row, field_index;
     uint16_t num_recs_of_band;
 
     cursor = cursor_start_of_band;
@@ -552,25 +561,31 @@ static int get_spectral_data_per_band(coda_cursor cursor_start_of_band, ingest_i
                 harp_set_error(HARP_ERROR_CODA, NULL);
                 return -1;
             }
+            /* look up the field in the readout record once instead of by name for each pixel */
+            if (coda_cursor_get_record_field_index_from_name(&cursor, fieldname, &field_index) != 0)
+            {
+                harp_set_error(HARP_ERROR_CODA, NULL);
+                return -1;
+            }
             double_data_row = 0;
             for (i = 0; i < num_recs_of_band; i++)
             {
                 double_data = data_startposition + (info->total_num_pixels_all_bands * double_data_row);
                 for (j = 0; j < info->num_pixels[band_nr]; j++)
                 {
-                    start_of_band_array_element = cursor;
-                    if (coda_cursor_goto_record_field_by_name(&cursor, fieldname) != 0)
-                    {
-                        harp_set_error(HARP_ERROR_CODA, NULL);
-                        return -1;
-                    }
                     if (i >= info->readout_offset[mdr_record])
                     {
+                        if (coda_cursor_goto_record_field_by_index(&cursor, field_index) != 0)
+                        {
+                            harp_set_error(HARP_ERROR_CODA, NULL);
+                            return -1;
+                        }
                         if (coda_cursor_read_double(&cursor, &rad) != 0)
                         {
                             harp_set_error(HARP_ERROR_CODA, NULL);
                             return -1;
                         }
+                        coda_cursor_goto_parent(&cursor);
                         /* We do a compare on the difference because absolute
                          * comparison of rad against undefined_int32_vsf_value
                          * may sometimes incorrectly return false due to
@@ -588,7 +603,6 @@ static int get_spectral_data_per_band(coda_cursor cursor_start_of_band, ingest_i
                                                            double_data);
                         double_data++;
                     }
-                    cursor = start_of_band_array_element;
                     if ((j < (info->num_pixels[band_nr] - 1)) || (i < (num_recs_of_band - 1)))
                     {
                         if (coda_cursor_goto_next_array_element(&cursor) != 0)
@@ -735,6 +749,26 @@ static int read_datetime(void *user_data, harp_array data)
     return get_main_datetime_data((ingest_info *)user_data, data.double_data);
 }
 
+/* The MDRs are in chronological order, so the datetime range follows from the first and the last MDR */
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    long last = info->num_mdr_records - 1;
+
+    if (get_record_start_time(info, 0, datetime_start) != 0)
+    {
+        return -1;
+    }
+    *datetime_start += 0.1875;
+    if (get_record_start_time(info, last, datetime_stop) != 0)
+    {
+        return -1;
+    }
+    *datetime_stop += (MAX_READOUTS_PER_MDR_RECORD - info->readout_offset[last]) * 0.1875;
+
+    return 0;
+}
+
 static int read_orbit_index(void *user_data, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -2120,6 +2154,7 @@ static harp_product_definition *register_measurement_product(harp_ingestion_modu
 
     product_definition = harp_ingestion_register_product(module, product_name, product_description,
                                                          read_dimensions_measurements_fields);
+    harp_product_definition_set_datetime_range_read(product_definition, read_datetime_range);
     description = "The GOME2 spectral data in the GOME2 L1b product is stored inside MDRs. There are separate MDRs for "
         "Earthshine, Calibration, Sun, and Moon measurements. In addition there are also 'Dummy Records' (DMDR) that "
         "can be present when there is lost data in the product. With HARP only Earthshine, Sun, and Moon "
@@ -356,6 +356,53 @@ static int read_dataset(ingest_info *info, const char *path, harp_data_type data
     return 0;
 }
 
+static int read_partial_dataset(ingest_info *info, const char *path, long offset, long length, harp_array data)
+{
+    coda_cursor cursor;
+    double fill_value;
+
+    if (coda_cursor_set_product(&cursor, info->product) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_goto(&cursor, path) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_double_partial_array(&cursor, offset, length, data.double_data) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_goto(&cursor, "@FillValue[0]") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_double(&cursor, &fill_value) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (!coda_isNaN(fill_value))
+    {
+        long i;
+
+        /* Replace fill values with NaN. */
+        for (i = 0; i < length; i++)
+        {
+            if (data.double_data[i] == fill_value)
+            {
+                data.double_data[i] = coda_NaN();
+            }
+        }
+    }
+
+    return 0;
+}
+
 /* read relative uncertainty [%] and turn it into an absolute uncertainty */
 static int read_relative_uncertainty(ingest_info *info, const char *path_quantity, const char *path_error,
                                      long num_elements, harp_array data)
@@ -589,6 +636,14 @@ static int read_quality_flags(ingest_info *info, species_type species, harp_arra
     return 0;
 }
 
+static long get_optimal_range_length(void *user_data)
+{
+    (void)user_data;
+
+    /* read (at least) the ground pixels of a full forward scan at a time */
+    return 32;
+}
+
 static int read_dimensions(void *user_data, long dimension[HARP_NUM_DIM_TYPES])
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -688,18 +743,18 @@ static int read_time(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_longitude(void *user_data, harp_array data)
+static int read_longitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "GEOLOCATION/LongitudeCentre", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "GEOLOCATION/LongitudeCentre", index_offset, index_length, data);
 }
 
-static int read_latitude(void *user_data, harp_array data)
+static int read_latitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "GEOLOCATION/LatitudeCentre", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "GEOLOCATION/LatitudeCentre", index_offset, index_length, data);
 }
 
 static int read_longitude_bounds(void *user_data, harp_array data)
@@ -780,39 +835,39 @@ static int read_latitude_bounds(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_solar_zenith_angle_sensor(void *user_data, harp_array data)
+static int read_solar_zenith_angle_sensor(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "GEOLOCATION/SolarZenithAngleSatCentre", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "GEOLOCATION/SolarZenithAngleSatCentre", index_offset, index_length, data);
 }
 
-static int read_solar_zenith_angle(void *user_data, harp_array data)
+static int read_solar_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "GEOLOCATION/SolarZenithAngleCentre", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "GEOLOCATION/SolarZenithAngleCentre", index_offset, index_length, data);
 }
 
-static int read_viewing_zenith_angle(void *user_data, harp_array data)
+static int read_viewing_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "GEOLOCATION/LineOfSightZenithAngleCentre", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "GEOLOCATION/LineOfSightZenithAngleCentre", index_offset, index_length, data);
 }
 
-static int read_relative_azimuth_angle(void *user_data, harp_array data)
+static int read_relative_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "GEOLOCATION/RelativeAzimuthCentre", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "GEOLOCATION/RelativeAzimuthCentre", index_offset, index_length, data);
 }
 
-static int read_bro_column(void *user_data, harp_array data)
+static int read_bro_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "TOTAL_COLUMNS/BrO", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "TOTAL_COLUMNS/BrO", index_offset, index_length, data);
 }
 
 static int read_bro_column_error(void *user_data, harp_array data)
@@ -827,11 +882,11 @@ static int read_bro_column_error(void *user_data, harp_array data)
     return read_dataset(info, "TOTAL_COLUMNS/BrO_Error", harp_type_double, info->num_main, data);
 }
 
-static int read_h2o_column(void *user_data, harp_array data)
+static int read_h2o_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "TOTAL_COLUMNS/H2O", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "TOTAL_COLUMNS/H2O", index_offset, index_length, data);
 }
 
 static int read_h2o_column_error(void *user_data, harp_array data)
@@ -841,11 +896,11 @@ static int read_h2o_column_error(void *user_data, harp_array data)
     return read_relative_uncertainty(info, "TOTAL_COLUMNS/H2O", "TOTAL_COLUMNS/H2O_Error", info->num_main, data);
 }
 
-static int read_hcho_column(void *user_data, harp_array data)
+static int read_hcho_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "TOTAL_COLUMNS/HCHO", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "TOTAL_COLUMNS/HCHO", index_offset, index_length, data);
 }
 
 static int read_hcho_column_error(void *user_data, harp_array data)
@@ -860,11 +915,11 @@ static int read_hcho_column_error(void *user_data, harp_array data)
     return read_dataset(info, "TOTAL_COLUMNS/HCHO_Error", harp_type_double, info->num_main, data);
 }
 
-static int read_no2_column(void *user_data, harp_array data)
+static int read_no2_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "TOTAL_COLUMNS/NO2", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "TOTAL_COLUMNS/NO2", index_offset, index_length, data);
 }
 
 static int read_no2_column_error(void *user_data, harp_array data)
@@ -904,11 +959,11 @@ static int read_no2_column_tropospheric_error(void *user_data, harp_array data)
     return read_dataset(info, "TOTAL_COLUMNS/NO2Tropo_Error", harp_type_double, info->num_main, data);
 }
 
-static int read_o3_column(void *user_data, harp_array data)
+static int read_o3_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "TOTAL_COLUMNS/O3", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "TOTAL_COLUMNS/O3", index_offset, index_length, data);
 }
 
 static int read_o3_column_error(void *user_data, harp_array data)
@@ -923,11 +978,11 @@ static int read_o3_column_error(void *user_data, harp_array data)
     return read_dataset(info, "TOTAL_COLUMNS/O3_Error", harp_type_double, info->num_main, data);
 }
 
-static int read_oclo_column(void *user_data, harp_array data)
+static int read_oclo_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "TOTAL_COLUMNS/OClO", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "TOTAL_COLUMNS/OClO", index_offset, index_length, data);
 }
 
 static int read_oclo_column_error(void *user_data, harp_array data)
@@ -942,11 +997,11 @@ static int read_oclo_column_error(void *user_data, harp_array data)
     return read_dataset(info, "TOTAL_COLUMNS/OClO_Error", harp_type_double, info->num_main, data);
 }
 
-static int read_so2_column(void *user_data, harp_array data)
+static int read_so2_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "TOTAL_COLUMNS/SO2", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "TOTAL_COLUMNS/SO2", index_offset, index_length, data);
 }
 
 static int read_so2_column_error(void *user_data, harp_array data)
@@ -1017,11 +1072,11 @@ static int read_amf_no2_error(void *user_data, harp_array data)
     return read_amf_error(info, species_type_no2, data);
 }
 
-static int read_amf_no2_tropospheric(void *user_data, harp_array data)
+static int read_amf_no2_tropospheric(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "DETAILED_RESULTS/NO2/AMFTropo", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "DETAILED_RESULTS/NO2/AMFTropo", index_offset, index_length, data);
 }
 
 static int read_amf_no2_tropospheric_error(void *user_data, harp_array data)
@@ -1123,11 +1178,11 @@ static int read_quality_flags_so2(void *user_data, harp_array data)
     return read_quality_flags(info, species_type_so2, data);
 }
 
-static int read_o3_temperature(void *user_data, harp_array data)
+static int read_o3_temperature(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "DETAILED_RESULTS/O3/O3Temperature", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "DETAILED_RESULTS/O3/O3Temperature", index_offset, index_length, data);
 }
 
 static int read_pressure(void *user_data, harp_array data)
@@ -1396,25 +1451,25 @@ static int read_cloud_optical_thickness_error(void *user_data, harp_array data)
                                      "CLOUD_PROPERTIES/CloudOpticalThickness_Error", info->num_main, data);
 }
 
-static int read_absorbing_aerosol_index(void *user_data, harp_array data)
+static int read_absorbing_aerosol_index(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "DETAILED_RESULTS/AAI", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "DETAILED_RESULTS/AAI", index_offset, index_length, data);
 }
 
-static int read_surface_height(void *user_data, harp_array data)
+static int read_surface_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "DETAILED_RESULTS/SurfaceHeight", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "DETAILED_RESULTS/SurfaceHeight", index_offset, index_length, data);
 }
 
-static int read_surface_pressure(void *user_data, harp_array data)
+static int read_surface_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info, "DETAILED_RESULTS/SurfacePressure", harp_type_double, info->num_main, data);
+    return read_partial_dataset(info, "DETAILED_RESULTS/SurfacePressure", index_offset, index_length, data);
 }
 
 static int read_index_in_scan(void *user_data, harp_array data)
@@ -1807,18 +1862,20 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* longitude */
     description = "longitude of the measurement";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "longitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_east", NULL, read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -180.0, 180.0);
     path = "/GEOLOCATION/LongitudeCentre[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* latitude */
     description = "latitude of the measurement";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "latitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_north", NULL, read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     path = "/GEOLOCATION/LatitudeCentre[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -1847,50 +1904,54 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* sensor_solar_zenith_angle */
     description = "solar zenith angle at the sensor";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "sensor_solar_zenith_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_solar_zenith_angle_sensor);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_solar_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_zenith_angle_sensor);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/GEOLOCATION/SolarZenithAngleSatCentre[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* solar_zenith_angle */
     description = "solar zenith angle at top of atmosphere";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "solar_zenith_angle", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "degree", NULL,
-                                                   read_solar_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/GEOLOCATION/SolarZenithAngleCentre[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* viewing_zenith_angle */
     description = "viewing zenith angle at top of atmosphere";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "viewing_zenith_angle", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "degree", NULL,
-                                                   read_viewing_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "viewing_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_viewing_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/GEOLOCATION/LineOfSightZenithAngleCentre[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* relative_azimuth_angle */
     description = "relative azimuth angle at top of atmosphere";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "relative_azimuth_angle", harp_type_double,
-                                                   1, dimension_type, NULL, description, "degree", NULL,
-                                                   read_relative_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "relative_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_relative_azimuth_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 360.0);
     path = "/GEOLOCATION/RelativeAzimuthCentre[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* BrO_column_number_density */
     description = "BrO column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "BrO_column_number_density", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "molec/cm^2", exclude_bro,
-                                                   read_bro_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "BrO_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_bro,
+                                                                      get_optimal_range_length, read_bro_column);
     path = "/TOTAL_COLUMNS/BrO[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -1918,10 +1979,10 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* H2O_column_density */
     description = "H2O column mass density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "H2O_column_density", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "kg/m^2", exclude_h2o,
-                                                   read_h2o_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "H2O_column_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "kg/m^2", exclude_h2o,
+                                                                      get_optimal_range_length, read_h2o_column);
     path = "/TOTAL_COLUMNS/H2O[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -1949,10 +2010,10 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* HCHO_column_number_density */
     description = "HCHO column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "HCHO_column_number_density", harp_type_double,
-                                                   1, dimension_type, NULL, description, "molec/cm^2", exclude_hcho,
-                                                   read_hcho_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "HCHO_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_hcho,
+                                                                      get_optimal_range_length, read_hcho_column);
     path = "/TOTAL_COLUMNS/HCHO[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -1980,10 +2041,10 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* NO2_column_number_density */
     description = "NO2 column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "NO2_column_number_density", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "molec/cm^2", exclude_no2,
-                                                   read_no2_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "NO2_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_no2,
+                                                                      get_optimal_range_length, read_no2_column);
     path = "/TOTAL_COLUMNS/NO2[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -2033,9 +2094,10 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* O3_column_number_density */
     description = "O3 column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "DU", exclude_o3, read_o3_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "DU", exclude_o3,
+                                                                      get_optimal_range_length, read_o3_column);
     path = "/TOTAL_COLUMNS/O3[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -2063,10 +2125,10 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* OClO_column_number_density */
     description = "OClO column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "OClO_column_number_density", harp_type_double,
-                                                   1, dimension_type, NULL, description, "molec/cm^2", exclude_oclo,
-                                                   read_oclo_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "OClO_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_oclo,
+                                                                      get_optimal_range_length, read_oclo_column);
     path = "/TOTAL_COLUMNS/OClO[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -2094,10 +2156,10 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* SO2_column_number_density */
     description = "SO2 column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "SO2_column_number_density", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "DU", exclude_so2,
-                                                   read_so2_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "SO2_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "DU", exclude_so2,
+                                                                      get_optimal_range_length, read_so2_column);
     path = "/TOTAL_COLUMNS/SO2[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -2209,10 +2271,12 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* tropospheric_NO2_column_number_density_amf */
     description = "tropospheric NO2 air mass factor";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "tropospheric_NO2_column_number_density_amf",
-                                                   harp_type_double, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, exclude_no2_v2, read_amf_no2_tropospheric);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "tropospheric_NO2_column_number_density_amf",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS,
+                                                                      exclude_no2_v2, get_optimal_range_length,
+                                                                      read_amf_no2_tropospheric);
     path = "/DETAILED_RESULTS/NO2/AMFTropo[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "CODA product version >= 2", path, NULL);
 
@@ -2293,10 +2357,11 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* O3_effective_temperature */
     description = "fitted ozone temperature";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_effective_temperature",
-                                                   harp_type_double, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, exclude_o3_details, read_o3_temperature);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_effective_temperature",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS,
+                                                                      exclude_o3_details, get_optimal_range_length,
+                                                                      read_o3_temperature);
     path = "/DETAILED_RESULTS/O3/O3Temperature";
     harp_variable_definition_add_mapping(variable_definition, "detailed_results=O3", "CODA product version >= 2", path,
                                          NULL);
@@ -2491,27 +2556,29 @@ static void register_common_variables(harp_product_definition *product_definitio
 
     /* absorbing_aerosol_index */
     description = "absorbing aerosol index";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "absorbing_aerosol_index", harp_type_double, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_absorbing_aerosol_index);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "absorbing_aerosol_index",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_absorbing_aerosol_index);
     path = "/DETAILED_RESULTS/AAI[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_height */
     description = "surface height";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_heigth", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "km", NULL, read_surface_height);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_heigth",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "km", NULL, get_optimal_range_length,
+                                                                      read_surface_height);
     path = "/DETAILED_RESULTS/SurfaceHeight[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_pressure */
     description = "surface pressure";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_pressure", harp_type_double, 1,
-                                                   dimension_type, NULL, description, "hPa", NULL,
-                                                   read_surface_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length, read_surface_pressure);
     path = "/DETAILED_RESULTS/SurfacePressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
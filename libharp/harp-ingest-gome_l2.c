@@ -41,6 +41,7 @@ typedef struct ingest_info_struct
     coda_product *product;
     long num_time;
     coda_cursor *ddr_cursor;
+    harp_coda_path_cache *path_cache;   /* paths within a ddr record, resolved once for all records */
     int format_version;
     int ozone_vcd;
 } ingest_info;
@@ -111,9 +112,8 @@ static int get_data(void *user_data, long index, const char *path, harp_array da
     coda_cursor cursor;
 
     cursor = info->ddr_cursor[index];
-    if (coda_cursor_goto(&cursor, path) != 0)
+    if (harp_coda_path_cache_goto(info->path_cache, &cursor, path) != 0)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
     if (coda_cursor_read_double(&cursor, data.double_data) != 0)
@@ -203,9 +203,8 @@ static int read_latitude_bounds(void *user_data, long index, harp_array data)
     int i;
 
     cursor = info->ddr_cursor[index];
-    if (coda_cursor_goto(&cursor, "glr/corners[0]") != 0)
+    if (harp_coda_path_cache_goto(info->path_cache, &cursor, "glr/corners[0]") != 0)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
     for (i = 0; i < 4; i++)
@@ -247,9 +246,8 @@ static int read_longitude_bounds(void *user_data, long index, harp_array data)
     int i;
 
     cursor = info->ddr_cursor[index];
-    if (coda_cursor_goto(&cursor, "glr/corners[0]") != 0)
+    if (harp_coda_path_cache_goto(info->path_cache, &cursor, "glr/corners[0]") != 0)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
     for (i = 0; i < 4; i++)
@@ -416,9 +414,8 @@ static int read_scan_subindex(void *user_data, long index, harp_array data)
     int32_t counter;
 
     cursor = info->ddr_cursor[index];
-    if (coda_cursor_goto(&cursor, "glr/subset_counter") != 0)
+    if (harp_coda_path_cache_goto(info->path_cache, &cursor, "glr/subset_counter") != 0)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
     if (coda_cursor_read_int32(&cursor, &counter) != 0)
@@ -438,9 +435,8 @@ static int read_scan_direction_type(void *user_data, long index, harp_array data
     int32_t counter;
 
     cursor = info->ddr_cursor[index];
-    if (coda_cursor_goto(&cursor, "glr/subset_counter") != 0)
+    if (harp_coda_path_cache_goto(info->path_cache, &cursor, "glr/subset_counter") != 0)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
     if (coda_cursor_read_int32(&cursor, &counter) != 0)
@@ -468,6 +464,10 @@ static void ingestion_done(void *user_data)
     {
         free(info->ddr_cursor);
     }
+    if (info->path_cache != NULL)
+    {
+        harp_coda_path_cache_delete(info->path_cache);
+    }
 
     free(info);
 }
@@ -490,6 +490,7 @@ static int ingestion_init(const harp_ingestion_module *module, coda_product *pro
     info->product = product;
     info->num_time = 0;
     info->ddr_cursor = NULL;
+    info->path_cache = NULL;
     info->format_version = -1;
     info->ozone_vcd = 0;
 
@@ -518,6 +519,11 @@ static int ingestion_init(const harp_ingestion_module *module, coda_product *pro
         ingestion_done(info);
         return -1;
     }
+    if (harp_coda_path_cache_new(&info->path_cache) != 0)
+    {
+        ingestion_done(info);
+        return -1;
+    }
 
     *definition = *module->product_definition;
     *user_data = info;
@@ -61,6 +61,7 @@ typedef struct ingest_info_struct
     long num_pixels;    /* Number of pixels in 1 scan (will usually be 8700) */
     int16_t nr_scale_factors;
     int16_t *scale_factors;
+    double *scale_multiplier;   /* 10^-scale_factor for each scale factor */
     int16_t *channel_first;
     int16_t *channel_last;
 } ingest_info;
@@ -123,17 +124,62 @@ static int get_main_data(ingest_info *info, const char *fieldname, main_data_var
     return 0;
 }
 
-static int get_spectra_sample_data(ingest_info *info, long row, float *float_data_array)
+static int get_location_data(ingest_info *info, main_data_variable var_type, long offset, long length,
+                             double *double_data_array)
+{
+    coda_cursor cursor;
+    double *double_data;
+    double locations[SPECTRA_PER_SCANLINE * 2];
+    long row, first, num_rows, i;
+
+    double_data = double_data_array;
+    row = offset;
+    while (row < offset + length)
+    {
+        /* read the locations of all requested spectra of this scanline at once */
+        first = row % SPECTRA_PER_SCANLINE;
+        num_rows = SPECTRA_PER_SCANLINE - first;
+        if (num_rows > offset + length - row)
+        {
+            num_rows = offset + length - row;
+        }
+        cursor = info->mdr_cursors[row / SPECTRA_PER_SCANLINE];
+        if (coda_cursor_goto_record_field_by_name(&cursor, "GGeoSondLoc") != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_double_partial_array(&cursor, first * 2, num_rows * 2, locations) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        for (i = 0; i < num_rows; i++)
+        {
+            *double_data = locations[2 * i + (var_type == LONGITUDE ? 0 : 1)];
+            double_data++;
+        }
+        row += num_rows;
+    }
+
+    return 0;
+}
+
+/* Read num_rows consecutive spectra starting at row; all spectra need to be part of the same scanline. */
+static int get_spectra_data(ingest_info *info, long row, long num_rows, float *float_data_array)
 {
     int32_t first_channel;
-    int16_t measured_spectrum_data[8700];
+    int16_t *measured_spectrum_data;
     int16_t *spectrum_data;
     coda_cursor cursor;
     float *float_data;
     int16_t scale_nr, channel_nr;
     int16_t *start_of_this_spectrum;
+    double multiplier;
+    long i;
+
+    assert(row % SPECTRA_PER_SCANLINE + num_rows <= SPECTRA_PER_SCANLINE);
 
-    float_data = float_data_array;
     cursor = info->mdr_cursors[row / SPECTRA_PER_SCANLINE];
     if (coda_cursor_goto_record_field_by_name(&cursor, "IDefNsfirst1b") != 0)
     {
@@ -157,28 +203,35 @@ static int get_spectra_sample_data(ingest_info *info, long row, float *float_dat
         return -1;
     }
 
+    CHECKED_MALLOC(measured_spectrum_data, num_rows * info->num_pixels * sizeof(int16_t));
     if (coda_cursor_read_int16_partial_array(&cursor, (row % SPECTRA_PER_SCANLINE) * info->num_pixels,
-                                             info->num_pixels, measured_spectrum_data) != 0)
+                                             num_rows * info->num_pixels, measured_spectrum_data) != 0)
     {
         harp_set_error(HARP_ERROR_CODA, NULL);
+        free(measured_spectrum_data);
         return -1;
     }
-    spectrum_data = measured_spectrum_data;
 
-    start_of_this_spectrum = spectrum_data;
-    for (scale_nr = 0; scale_nr < info->nr_scale_factors; scale_nr++)
+    for (i = 0; i < num_rows; i++)
     {
-        spectrum_data = start_of_this_spectrum + info->channel_first[scale_nr] - first_channel;
-        for (channel_nr = info->channel_first[scale_nr]; channel_nr <= info->channel_last[scale_nr]; channel_nr++)
+        float_data = float_data_array + i * info->num_pixels;
+        start_of_this_spectrum = measured_spectrum_data + i * info->num_pixels;
+        for (scale_nr = 0; scale_nr < info->nr_scale_factors; scale_nr++)
         {
-            /* Because this data has limited precision (it was stored in */
-            /* an int16), we store the radiance in a float.              */
-            *float_data = (float)((*spectrum_data) * pow(10.0, -(info->scale_factors[scale_nr])));
-            float_data++;
-            spectrum_data++;
+            spectrum_data = start_of_this_spectrum + info->channel_first[scale_nr] - first_channel;
+            multiplier = info->scale_multiplier[scale_nr];
+            for (channel_nr = info->channel_first[scale_nr]; channel_nr <= info->channel_last[scale_nr];
+                 channel_nr++)
+            {
+                /* Because this data has limited precision (it was stored in */
+                /* an int16), we store the radiance in a float.              */
+                *float_data = (float)((*spectrum_data) * multiplier);
+                float_data++;
+                spectrum_data++;
+            }
         }
     }
-    spectrum_data = start_of_this_spectrum + info->num_pixels;
+    free(measured_spectrum_data);
 
     return 0;
 }
@@ -255,6 +308,10 @@ static void ingestion_done(void *user_data)
     {
         free(info->scale_factors);
     }
+    if (info->scale_multiplier != NULL)
+    {
+        free(info->scale_multiplier);
+    }
     if (info->channel_first != NULL)
     {
         free(info->channel_first);
@@ -327,19 +384,45 @@ static int read_orbit_index(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_latitude(void *user_data, harp_array data)
+static long get_optimal_range_length(void *user_data)
 {
-    return get_main_data((ingest_info *)user_data, "GGeoSondLoc", LATITUDE, data.double_data);
+    (void)user_data;
+
+    /* read (at least) a full scanline at a time */
+    return SPECTRA_PER_SCANLINE;
 }
 
-static int read_longitude(void *user_data, harp_array data)
+static int read_latitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_main_data((ingest_info *)user_data, "GGeoSondLoc", LONGITUDE, data.double_data);
+    return get_location_data((ingest_info *)user_data, LATITUDE, index_offset, index_length, data.double_data);
 }
 
-static int read_spectral_radiance_sample(void *user_data, long index, harp_array data)
+static int read_longitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_spectra_sample_data((ingest_info *)user_data, index, data.float_data);
+    return get_location_data((ingest_info *)user_data, LONGITUDE, index_offset, index_length, data.double_data);
+}
+
+static int read_spectral_radiance(void *user_data, long index_offset, long index_length, harp_array data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    long row, num_rows;
+
+    row = index_offset;
+    while (row < index_offset + index_length)
+    {
+        num_rows = SPECTRA_PER_SCANLINE - row % SPECTRA_PER_SCANLINE;
+        if (num_rows > index_offset + index_length - row)
+        {
+            num_rows = index_offset + index_length - row;
+        }
+        if (get_spectra_data(info, row, num_rows, data.float_data + (row - index_offset) * info->num_pixels) != 0)
+        {
+            return -1;
+        }
+        row += num_rows;
+    }
+
+    return 0;
 }
 
 static int read_wavenumber_sample(void *user_data, long index, harp_array data)
@@ -455,6 +538,7 @@ static int read_GIADR_scalefactors(ingest_info *info)
 {
     coda_cursor cursor;
     long max_scale_factors;
+    long i;
 
     if (coda_cursor_set_product(&cursor, info->product) != 0)
     {
@@ -494,6 +578,12 @@ static int read_GIADR_scalefactors(ingest_info *info)
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
+    /* calculate the multipliers once instead of for each sample of each spectrum */
+    CHECKED_MALLOC(info->scale_multiplier, max_scale_factors * sizeof(double));
+    for (i = 0; i < max_scale_factors; i++)
+    {
+        info->scale_multiplier[i] = pow(10.0, -(info->scale_factors[i]));
+    }
 
     coda_cursor_goto_parent(&cursor);
     if (coda_cursor_goto_record_field_by_name(&cursor, "IDefScaleSondNsfirst") != 0)
@@ -600,18 +690,20 @@ int harp_ingestion_module_iasi_l1_init(void)
 
     /* latitude */
     description = "center latitude of the measurement";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "latitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_north", NULL, read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     path = "/MDR[]/MDR/GGeoSondLoc[,,1]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* longitude */
     description = "center longitude of the measurement";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "longitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_east", NULL, read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -180.0, 180.0);
     path = "/MDR[]/MDR/GGeoSondLoc[,,0]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -619,9 +711,9 @@ int harp_ingestion_module_iasi_l1_init(void)
     /* wavenumber_radiance */
     description = "measured radiances";
     variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "wavenumber_radiance", harp_type_float, 2,
+        harp_ingestion_register_variable_range_read(product_definition, "wavenumber_radiance", harp_type_float, 2,
                                                     dimension_type, NULL, description, "W/m^2.sr.m^-1", NULL,
-                                                    read_spectral_radiance_sample);
+                                                    get_optimal_range_length, read_spectral_radiance);
     path = "/MDR[]/MDR/GS1cSpect[], /MDR[]/MDR/IDefNsfirst1b, /GIADR_ScaleFactors/IDefScaleSondNbScale, "
         "/GIADR_ScaleFactors/IDefScaleSondScaleFactor[], /GIADR_ScaleFactors/IdefScaleSondNsfirst[], "
         "/GIADR_ScaleFactors/IDefScaleSondNslast[]";
@@ -202,56 +202,68 @@ static int read_orbit_index(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_latitude(void *user_data, long index, harp_array data)
+/* read element value_id of the [120,num_values] array 'fieldname' for measurements offset up to offset + length */
+static int get_mdr_data(ingest_info *info, const char *fieldname, int num_values, int value_id, long offset,
+                        long length, double *double_data)
 {
-    ingest_info *info = (ingest_info *)user_data;
+    double values[120 * 4];
     coda_cursor cursor;
+    long index;
+    long first;
+    long num_measurements;
+    long i;
 
-    cursor = info->mdr_cursor[index / 120];
-    if (coda_cursor_goto_record_field_by_name(&cursor, "EARTH_LOCATION") != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    /* flat index in [120,2] array */
-    if (coda_cursor_goto_array_element_by_index(&cursor, (index % 120) * 2) != 0)
+    index = offset;
+    while (index < offset + length)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_read_double(&cursor, data.double_data) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
+        /* read all requested measurements of this MDR at once */
+        first = index % 120;
+        num_measurements = 120 - first;
+        if (num_measurements > offset + length - index)
+        {
+            num_measurements = offset + length - index;
+        }
+        cursor = info->mdr_cursor[index / 120];
+        if (coda_cursor_goto_record_field_by_name(&cursor, fieldname) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_double_partial_array(&cursor, first * num_values, num_measurements * num_values, values)
+            != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        for (i = 0; i < num_measurements; i++)
+        {
+            *double_data = values[i * num_values + value_id];
+            double_data++;
+        }
+        index += num_measurements;
     }
 
     return 0;
 }
 
-static int read_longitude(void *user_data, long index, harp_array data)
+static long get_optimal_range_length(void *user_data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    coda_cursor cursor;
+    (void)user_data;
 
-    cursor = info->mdr_cursor[index / 120];
-    if (coda_cursor_goto_record_field_by_name(&cursor, "EARTH_LOCATION") != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    /* flat index in [120,2] array */
-    if (coda_cursor_goto_array_element_by_index(&cursor, (index % 120) * 2 + 1) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_read_double(&cursor, data.double_data) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
+    /* read (at least) a full MDR at a time */
+    return 120;
+}
 
-    return 0;
+static int read_latitude(void *user_data, long index_offset, long index_length, harp_array data)
+{
+    return get_mdr_data((ingest_info *)user_data, "EARTH_LOCATION", 2, 0, index_offset, index_length,
+                        data.double_data);
+}
+
+static int read_longitude(void *user_data, long index_offset, long index_length, harp_array data)
+{
+    return get_mdr_data((ingest_info *)user_data, "EARTH_LOCATION", 2, 1, index_offset, index_length,
+                        data.double_data);
 }
 
 static int get_corner_coordinates(ingest_info *info, long scan_id)
@@ -473,100 +485,54 @@ static int read_corner_longitude(void *user_data, long index, harp_array data)
     return 0;
 }
 
-static int get_angle_data(void *user_data, long index, int angle_id, harp_array data)
-{
-    ingest_info *info = (ingest_info *)user_data;
-    coda_cursor cursor;
-
-    cursor = info->mdr_cursor[index / 120];
-    if (coda_cursor_goto_record_field_by_name(&cursor, "ANGULAR_RELATION") != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    /* flat index in [120,4] array */
-    if (coda_cursor_goto_array_element_by_index(&cursor, (index % 120) * 4 + angle_id) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_read_double(&cursor, data.double_data) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-
-    return 0;
-}
-
-static int read_solar_zenith_angle(void *user_data, long index, harp_array data)
+static int read_solar_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_angle_data(user_data, index, 0, data);
+    return get_mdr_data((ingest_info *)user_data, "ANGULAR_RELATION", 4, 0, index_offset, index_length,
+                        data.double_data);
 }
 
-static int read_sensor_zenith_angle(void *user_data, long index, harp_array data)
+static int read_sensor_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_angle_data(user_data, index, 1, data);
+    return get_mdr_data((ingest_info *)user_data, "ANGULAR_RELATION", 4, 1, index_offset, index_length,
+                        data.double_data);
 }
 
-static int read_solar_azimuth_angle(void *user_data, long index, harp_array data)
+static int read_solar_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_angle_data(user_data, index, 2, data);
+    return get_mdr_data((ingest_info *)user_data, "ANGULAR_RELATION", 4, 2, index_offset, index_length,
+                        data.double_data);
 }
 
-static int read_sensor_azimuth_angle(void *user_data, long index, harp_array data)
+static int read_sensor_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_angle_data(user_data, index, 3, data);
+    return get_mdr_data((ingest_info *)user_data, "ANGULAR_RELATION", 4, 3, index_offset, index_length,
+                        data.double_data);
 }
 
-static int get_species_data(void *user_data, long index, const char *fieldname, harp_array data)
+static int read_o3_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    coda_cursor cursor;
-
-    cursor = info->mdr_cursor[index / 120];
-    if (coda_cursor_goto_record_field_by_name(&cursor, fieldname) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_goto_array_element_by_index(&cursor, (index % 120)) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_read_double(&cursor, data.double_data) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-
-    return 0;
-}
-
-static int read_o3_column(void *user_data, long index, harp_array data)
-{
-    return get_species_data(user_data, index, "INTEGRATED_OZONE", data);
+    return get_mdr_data((ingest_info *)user_data, "INTEGRATED_OZONE", 1, 0, index_offset, index_length,
+                        data.double_data);
 }
 
-static int read_n2o_column(void *user_data, long index, harp_array data)
+static int read_n2o_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_species_data(user_data, index, "INTEGRATED_N2O", data);
+    return get_mdr_data((ingest_info *)user_data, "INTEGRATED_N2O", 1, 0, index_offset, index_length, data.double_data);
 }
 
-static int read_co_column(void *user_data, long index, harp_array data)
+static int read_co_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_species_data(user_data, index, "INTEGRATED_CO", data);
+    return get_mdr_data((ingest_info *)user_data, "INTEGRATED_CO", 1, 0, index_offset, index_length, data.double_data);
 }
 
-static int read_ch4_column(void *user_data, long index, harp_array data)
+static int read_ch4_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_species_data(user_data, index, "INTEGRATED_CH4", data);
+    return get_mdr_data((ingest_info *)user_data, "INTEGRATED_CH4", 1, 0, index_offset, index_length, data.double_data);
 }
 
-static int read_co2_column(void *user_data, long index, harp_array data)
+static int read_co2_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_species_data(user_data, index, "INTEGRATED_CO2", data);
+    return get_mdr_data((ingest_info *)user_data, "INTEGRATED_CO2", 1, 0, index_offset, index_length, data.double_data);
 }
 
 static int read_scan_subindex(void *user_data, long index, harp_array data)
@@ -657,20 +623,20 @@ int harp_ingestion_module_iasi_l2_init(void)
 
     /* longitude */
     description = "center longitude of the measurement";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "longitude", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "degree_east", NULL,
-                                                    read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -180.0, 180.0);
     path = "/MDR[]/MDR/EARTH_LOCATION[,1]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* latitude */
     description = "center latitude of the measurement";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "latitude", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "degree_north", NULL,
-                                                    read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     path = "/MDR[]/MDR/EARTH_LOCATION[,0]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -703,81 +669,90 @@ int harp_ingestion_module_iasi_l2_init(void)
 
     /* solar_azimuth_angle */
     description = "solar azimuth angle at the surface";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "solar_azimuth_angle", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "degree", NULL,
-                                                    read_solar_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_azimuth_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 360.0);
     path = "/MDR[]/MDR/ANGULAR_RELATION[,2]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* solar_zenith_angle */
     description = "solar zenith angle at the surface";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "solar_zenith_angle", harp_type_double,
-                                                    1, dimension_type, NULL, description, "degree", NULL,
-                                                    read_solar_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/MDR[]/MDR/ANGULAR_RELATION[,0]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* sensor_azimuth_angle */
     description = "sensor azimuth angle at the surface";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "sensor_azimuth_angle", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "degree", NULL,
-                                                    read_sensor_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_sensor_azimuth_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 360.0);
     path = "/MDR[]/MDR/ANGULAR_RELATION[,3]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* sensor_zenith_angle */
     description = "sensor angle at the surface";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "sensor_zenith_angle", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "degree", NULL,
-                                                    read_sensor_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_sensor_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/MDR[]/MDR/ANGULAR_RELATION[,1]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* CH4_column_density */
     description = "CH4 column mass density";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "CH4_column_density", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "kg/m^2", NULL, read_ch4_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "CH4_column_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "kg/m^2", NULL,
+                                                                      get_optimal_range_length, read_ch4_column);
     path = "/MDR[]/MDR/INTEGRATED_CH4[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* CO_column_density */
     description = "CO column mass density";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "CO_column_density", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "kg/m^2", NULL, read_co_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "CO_column_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "kg/m^2", NULL,
+                                                                      get_optimal_range_length, read_co_column);
     path = "/MDR[]/MDR/INTEGRATED_CO[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* CO2_column_density */
     description = "CO2 column mass density";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "CO2_column_density", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "kg/m^2", NULL, read_co2_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "CO2_column_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "kg/m^2", NULL,
+                                                                      get_optimal_range_length, read_co2_column);
     path = "/MDR[]/MDR/INTEGRATED_CO2[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_column_density */
     description = "O3 column mass density";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "O3_column_density", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "kg/m^2", NULL, read_o3_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_column_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "kg/m^2", NULL,
+                                                                      get_optimal_range_length, read_o3_column);
     path = "/MDR[]/MDR/INTEGRATED_OZONE[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* N2O_column_density */
     description = "N2O column mass density";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "N2O_column_density", harp_type_double, 1,
-                                                    dimension_type, NULL, description, "kg/m^2", NULL, read_n2o_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "N2O_column_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "kg/m^2", NULL,
+                                                                      get_optimal_range_length, read_n2o_column);
     path = "/MDR[]/MDR/INTEGRATED_N2O[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
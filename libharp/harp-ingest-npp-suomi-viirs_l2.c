@@ -182,6 +182,71 @@ static int read_variable(coda_cursor *cursor, const char *name, int num_dimensio
     return 0;
 }
 
+static int read_partial_variable(coda_cursor *cursor, const char *name, long dimension_0, long dimension_1,
+                                 long offset, long length, double error_range_start, double error_range_end,
+                                 harp_array data)
+{
+    double *double_data;
+    long coda_dimension[CODA_MAX_NUM_DIMS];
+    int num_coda_dimensions;
+    long i;
+
+    if (coda_cursor_goto_record_field_by_name(cursor, name) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_get_array_dim(cursor, &num_coda_dimensions, coda_dimension) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (num_coda_dimensions != 2)
+    {
+        harp_set_error(HARP_ERROR_INGESTION,
+                       "product error detected in NPP Suomi L2 product (variable %s has %d dimensions, " "expected 2)",
+                       name, num_coda_dimensions);
+        return -1;
+    }
+    if (dimension_0 != coda_dimension[0] || dimension_1 != coda_dimension[1])
+    {
+        harp_set_error(HARP_ERROR_INGESTION, "product error detected in NPP Suomi L2 product (variable %s has "
+                       "dimensions [%ld,%ld], expected [%ld,%ld])", name, coda_dimension[0], coda_dimension[1],
+                       dimension_0, dimension_1);
+        return -1;
+    }
+    if (coda_cursor_read_double_partial_array(cursor, offset, length, data.double_data) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+
+    if (error_range_start <= error_range_end)
+    {
+        double_data = data.double_data;
+        for (i = 0; i < length; i++)
+        {
+            if ((*double_data >= error_range_start) && (*double_data <= error_range_end))
+            {
+                *double_data = nan;
+            }
+            double_data++;
+        }
+    }
+
+    coda_cursor_goto_parent(cursor);
+
+    return 0;
+}
+
+static long get_optimal_range_length(void *user_data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+
+    /* read (at least) a full scanline at a time */
+    return info->num_crosstracks;
+}
+
 static int read_dimensions(void *user_data, long dimension[HARP_NUM_DIM_TYPES])
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -245,52 +310,52 @@ static int read_datetime(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_latitude(void *user_data, harp_array data)
+static int read_latitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable(&info->geo_cursor, "Latitude", 2, info->num_measurements_alongtrack, info->num_crosstracks,
-                         -1000.0, -999.0, data);
+    return read_partial_variable(&info->geo_cursor, "Latitude", info->num_measurements_alongtrack,
+                                 info->num_crosstracks, index_offset, index_length, -1000.0, -999.0, data);
 }
 
-static int read_longitude(void *user_data, harp_array data)
+static int read_longitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable(&info->geo_cursor, "Longitude", 2, info->num_measurements_alongtrack, info->num_crosstracks,
-                         -1000.0, -999.0, data);
+    return read_partial_variable(&info->geo_cursor, "Longitude", info->num_measurements_alongtrack,
+                                 info->num_crosstracks, index_offset, index_length, -1000.0, -999.0, data);
 }
 
-static int read_sensor_azimuth_angle(void *user_data, harp_array data)
+static int read_sensor_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable(&info->geo_cursor, "SatelliteAzimuthAngle", 2, info->num_measurements_alongtrack,
-                         info->num_crosstracks, -1000.0, -999.0, data);
+    return read_partial_variable(&info->geo_cursor, "SatelliteAzimuthAngle", info->num_measurements_alongtrack,
+                                 info->num_crosstracks, index_offset, index_length, -1000.0, -999.0, data);
 }
 
-static int read_sensor_zenith_angle(void *user_data, harp_array data)
+static int read_sensor_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable(&info->geo_cursor, "SatelliteZenithAngle", 2, info->num_measurements_alongtrack,
-                         info->num_crosstracks, -1000.0, -999.0, data);
+    return read_partial_variable(&info->geo_cursor, "SatelliteZenithAngle", info->num_measurements_alongtrack,
+                                 info->num_crosstracks, index_offset, index_length, -1000.0, -999.0, data);
 }
 
-static int read_solar_azimuth_angle(void *user_data, harp_array data)
+static int read_solar_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable(&info->geo_cursor, "SolarAzimuthAngle", 2, info->num_measurements_alongtrack,
-                         info->num_crosstracks, -1000.0, -999.0, data);
+    return read_partial_variable(&info->geo_cursor, "SolarAzimuthAngle", info->num_measurements_alongtrack,
+                                 info->num_crosstracks, index_offset, index_length, -1000.0, -999.0, data);
 }
 
-static int read_solar_zenith_angle(void *user_data, harp_array data)
+static int read_solar_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable(&info->geo_cursor, "SolarZenithAngle", 2, info->num_measurements_alongtrack,
-                         info->num_crosstracks, -1000.0, -999.0, data);
+    return read_partial_variable(&info->geo_cursor, "SolarZenithAngle", info->num_measurements_alongtrack,
+                                 info->num_crosstracks, index_offset, index_length, -1000.0, -999.0, data);
 }
 
 static int read_aerosol_optical_depth(void *user_data, harp_array data)
@@ -342,20 +407,21 @@ static int read_wavelength(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_cloud_base_height(void *user_data, harp_array data)
+static int read_scaled_cloud_variable(ingest_info *info, VIIRS_product_type product_type, const char *name,
+                                      const char *factors_name, long index_offset, long index_length,
+                                      harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
     double *double_data, scale, offset;
     harp_array factors;
     long i;
 
-    if (read_variable(&info->viirs_cursors[CLOUD_BASE_HEIGHT], "AverageCloudBaseHeight", 2,
-                      info->num_measurements_alongtrack, info->num_crosstracks, 65527.5, 65535.5, data) != 0)
+    if (read_partial_variable(&info->viirs_cursors[product_type], name, info->num_measurements_alongtrack,
+                              info->num_crosstracks, index_offset, index_length, 65527.5, 65535.5, data) != 0)
     {
         return -1;
     }
     CHECKED_MALLOC(factors.double_data, 8 * sizeof(double));
-    if (read_variable(&info->viirs_cursors[CLOUD_BASE_HEIGHT], "CBHFactors", 1, 8, 0, 1.0, 0.0, factors) != 0)
+    if (read_variable(&info->viirs_cursors[product_type], factors_name, 1, 8, 0, 1.0, 0.0, factors) != 0)
     {
         free(factors.double_data);
         return -1;
@@ -365,7 +431,7 @@ static int read_cloud_base_height(void *user_data, harp_array data)
     free(factors.double_data);
 
     double_data = data.double_data;
-    for (i = 0; i < (info->num_measurements_alongtrack * info->num_crosstracks); i++)
+    for (i = 0; i < index_length; i++)
     {
         if (!coda_isNaN(*double_data))
         {
@@ -376,209 +442,47 @@ static int read_cloud_base_height(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_cloud_top_height(void *user_data, harp_array data)
+static int read_cloud_base_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    double *double_data, scale, offset;
-    harp_array factors;
-    long i;
-
-    if (read_variable(&info->viirs_cursors[CLOUD_TOP_HEIGHT], "AverageCloudTopHeight", 2,
-                      info->num_measurements_alongtrack, info->num_crosstracks, 65527.5, 65535.5, data) != 0)
-    {
-        return -1;
-    }
-    CHECKED_MALLOC(factors.double_data, 8 * sizeof(double));
-    if (read_variable(&info->viirs_cursors[CLOUD_TOP_HEIGHT], "CTHFactors", 1, 8, 0, 1.0, 0.0, factors) != 0)
-    {
-        free(factors.double_data);
-        return -1;
-    }
-    scale = factors.double_data[0];
-    offset = factors.double_data[1];
-    free(factors.double_data);
-
-    double_data = data.double_data;
-    for (i = 0; i < (info->num_measurements_alongtrack * info->num_crosstracks); i++)
-    {
-        if (!coda_isNaN(*double_data))
-        {
-            *double_data = *double_data * scale + offset;
-        }
-        double_data++;
-    }
-    return 0;
+    return read_scaled_cloud_variable((ingest_info *)user_data, CLOUD_BASE_HEIGHT, "AverageCloudBaseHeight",
+                                      "CBHFactors", index_offset, index_length, data);
 }
 
-static int read_cloud_top_pressure(void *user_data, harp_array data)
+static int read_cloud_top_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    double *double_data, scale, offset;
-    harp_array factors;
-    long i;
-
-    if (read_variable(&info->viirs_cursors[CLOUD_TOP_PRESSURE], "AverageCloudTopPressure", 2,
-                      info->num_measurements_alongtrack, info->num_crosstracks, 65527.5, 65535.5, data) != 0)
-    {
-        return -1;
-    }
-    CHECKED_MALLOC(factors.double_data, 8 * sizeof(double));
-    if (read_variable(&info->viirs_cursors[CLOUD_TOP_PRESSURE], "CTPFactors", 1, 8, 0, 1.0, 0.0, factors) != 0)
-    {
-        free(factors.double_data);
-        return -1;
-    }
-    scale = factors.double_data[0];
-    offset = factors.double_data[1];
-    free(factors.double_data);
-
-    double_data = data.double_data;
-    for (i = 0; i < (info->num_measurements_alongtrack * info->num_crosstracks); i++)
-    {
-        if (!coda_isNaN(*double_data))
-        {
-            *double_data = *double_data * scale + offset;
-        }
-        double_data++;
-    }
-    return 0;
+    return read_scaled_cloud_variable((ingest_info *)user_data, CLOUD_TOP_HEIGHT, "AverageCloudTopHeight", "CTHFactors",
+                                      index_offset, index_length, data);
 }
 
-static int read_cloud_top_temperature(void *user_data, harp_array data)
+static int read_cloud_top_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    double *double_data, scale, offset;
-    harp_array factors;
-    long i;
-
-    if (read_variable(&info->viirs_cursors[CLOUD_TOP_TEMPERATURE], "AverageCloudTopTemperature", 2,
-                      info->num_measurements_alongtrack, info->num_crosstracks, 65527.5, 65535.5, data) != 0)
-    {
-        return -1;
-    }
-    CHECKED_MALLOC(factors.double_data, 8 * sizeof(double));
-    if (read_variable(&info->viirs_cursors[CLOUD_TOP_TEMPERATURE], "CTTFactors", 1, 8, 0, 1.0, 0.0, factors) != 0)
-    {
-        free(factors.double_data);
-        return -1;
-    }
-    scale = factors.double_data[0];
-    offset = factors.double_data[1];
-    free(factors.double_data);
-
-    double_data = data.double_data;
-    for (i = 0; i < (info->num_measurements_alongtrack * info->num_crosstracks); i++)
-    {
-        if (!coda_isNaN(*double_data))
-        {
-            *double_data = *double_data * scale + offset;
-        }
-        double_data++;
-    }
-    return 0;
+    return read_scaled_cloud_variable((ingest_info *)user_data, CLOUD_TOP_PRESSURE, "AverageCloudTopPressure",
+                                      "CTPFactors", index_offset, index_length, data);
 }
 
-static int read_cloud_fraction(void *user_data, harp_array data)
+static int read_cloud_top_temperature(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    double *double_data, scale, offset;
-    harp_array factors;
-    long i;
-
-    if (read_variable(&info->viirs_cursors[CLOUD_FRACTION], "SummedCloudCover", 2,
-                      info->num_measurements_alongtrack, info->num_crosstracks, 65527.5, 65535.5, data) != 0)
-    {
-        return -1;
-    }
-    CHECKED_MALLOC(factors.double_data, 8 * sizeof(double));
-    if (read_variable(&info->viirs_cursors[CLOUD_FRACTION], "CCLFactors", 1, 8, 0, 1.0, 0.0, factors) != 0)
-    {
-        free(factors.double_data);
-        return -1;
-    }
-    scale = factors.double_data[0];
-    offset = factors.double_data[1];
-    free(factors.double_data);
-
-    double_data = data.double_data;
-    for (i = 0; i < (info->num_measurements_alongtrack * info->num_crosstracks); i++)
-    {
-        if (!coda_isNaN(*double_data))
-        {
-            *double_data = *double_data * scale + offset;
-        }
-        double_data++;
-    }
-    return 0;
+    return read_scaled_cloud_variable((ingest_info *)user_data, CLOUD_TOP_TEMPERATURE, "AverageCloudTopTemperature",
+                                      "CTTFactors", index_offset, index_length, data);
 }
 
-static int read_cloud_effective_particle_size(void *user_data, harp_array data)
+static int read_cloud_fraction(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    double *double_data, scale, offset;
-    harp_array factors;
-    long i;
-
-    if (read_variable(&info->viirs_cursors[CLOUD_EFFECTIVE_PARTICLE_SIZE], "AverageCloudEffectiveParticleSize", 2,
-                      info->num_measurements_alongtrack, info->num_crosstracks, 65527.5, 65535.5, data) != 0)
-    {
-        return -1;
-    }
-    CHECKED_MALLOC(factors.double_data, 8 * sizeof(double));
-    if (read_variable
-        (&info->viirs_cursors[CLOUD_EFFECTIVE_PARTICLE_SIZE], "CEPSFactors", 1, 8, 0, 1.0, 0.0, factors) != 0)
-    {
-        free(factors.double_data);
-        return -1;
-    }
-    scale = factors.double_data[0];
-    offset = factors.double_data[1];
-    free(factors.double_data);
-
-    double_data = data.double_data;
-    for (i = 0; i < (info->num_measurements_alongtrack * info->num_crosstracks); i++)
-    {
-        if (!coda_isNaN(*double_data))
-        {
-            *double_data = *double_data * scale + offset;
-        }
-        double_data++;
-    }
-    return 0;
+    return read_scaled_cloud_variable((ingest_info *)user_data, CLOUD_FRACTION, "SummedCloudCover", "CCLFactors",
+                                      index_offset, index_length, data);
 }
 
-static int read_cloud_optical_depth(void *user_data, harp_array data)
+static int read_cloud_effective_particle_size(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    ingest_info *info = (ingest_info *)user_data;
-    double *double_data, scale, offset;
-    harp_array factors;
-    long i;
-
-    if (read_variable(&info->viirs_cursors[CLOUD_OPTICAL_DEPTH], "AverageCloudOpticalThickness", 2,
-                      info->num_measurements_alongtrack, info->num_crosstracks, 65527.5, 65535.5, data) != 0)
-    {
-        return -1;
-    }
-    CHECKED_MALLOC(factors.double_data, 8 * sizeof(double));
-    if (read_variable(&info->viirs_cursors[CLOUD_OPTICAL_DEPTH], "COTFactors", 1, 8, 0, 1.0, 0.0, factors) != 0)
-    {
-        free(factors.double_data);
-        return -1;
-    }
-    scale = factors.double_data[0];
-    offset = factors.double_data[1];
-    free(factors.double_data);
+    return read_scaled_cloud_variable((ingest_info *)user_data, CLOUD_EFFECTIVE_PARTICLE_SIZE,
+                                      "AverageCloudEffectiveParticleSize", "CEPSFactors", index_offset, index_length,
+                                      data);
+}
 
-    double_data = data.double_data;
-    for (i = 0; i < (info->num_measurements_alongtrack * info->num_crosstracks); i++)
-    {
-        if (!coda_isNaN(*double_data))
-        {
-            *double_data = *double_data * scale + offset;
-        }
-        double_data++;
-    }
-    return 0;
+static int read_cloud_optical_depth(void *user_data, long index_offset, long index_length, harp_array data)
+{
+    return read_scaled_cloud_variable((ingest_info *)user_data, CLOUD_OPTICAL_DEPTH, "AverageCloudOpticalThickness",
+                                      "COTFactors", index_offset, index_length, data);
 }
 
 static int init_swath_names_and_cursors(ingest_info *info)
@@ -772,18 +676,20 @@ static void register_aeros_product_type(const char *product_type)
 
     /* latitude */
     description = "tangent latitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "latitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_north", NULL, read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     path = "/All_Data/VIIRS-Aeros-EDR-GEO_All/Latitude";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* longitude */
     description = "tangent longitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "longitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_east", NULL, read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -180.0, 180.0);
     path = "/All_Data/VIIRS-Aeros-EDR-GEO_All/Longitude";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -794,40 +700,44 @@ static void register_aeros_product_type(const char *product_type)
 
     /* sensor_azimuth_angle */
     description = "azimuth angle (measured clockwise positive from North) to Satellite at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "sensor_azimuth_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_sensor_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_sensor_azimuth_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-Aeros-EDR-GEO_All/SatelliteAzimuthAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* sensor_zenith_angle */
     description = "zenith angle to Satellite at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "sensor_zenith_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_sensor_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_sensor_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-Aeros-EDR-GEO_All/SatelliteZenithAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* solar_azimuth_angle */
     description = "azimuth angle of sun (measured clockwise positive from North) at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "solar_azimuth_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_solar_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_azimuth_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-Aeros-EDR-GEO_All/SatelliteAzimuthAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* solar_zenith_angle */
     description = "zenith angle of sun at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "solar_zenith_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_solar_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-Aeros-EDR-GEO_All/SatelliteZenithAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -876,18 +786,20 @@ static void register_cloud_product_type(const char *product_type, const char *pr
 
     /* latitude */
     description = "tangent latitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "latitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_north", NULL, read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     path = "/All_Data/VIIRS-CLD-AGG-GEO_All/Latitude";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* longitude */
     description = "tangent longitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "longitude", harp_type_double, 1, dimension_type,
-                                                   NULL, description, "degree_east", NULL, read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -180.0, 180.0);
     path = "/All_Data/VIIRS-CLD-AGG-GEO_All/Longitude";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -898,40 +810,44 @@ static void register_cloud_product_type(const char *product_type, const char *pr
 
     /* sensor_azimuth_angle */
     description = "azimuth angle (measured clockwise positive from North) to Satellite at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "sensor_azimuth_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_sensor_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_sensor_azimuth_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-CLD-AGG-GEO_All/SatelliteAzimuthAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* sensor_zenith_angle */
     description = "zenith angle to Satellite at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "sensor_zenith_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_sensor_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_sensor_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-CLD-AGG-GEO_All/SatelliteZenithAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* solar_azimuth_angle */
     description = "azimuth angle of sun (measured clockwise positive from North) at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "solar_azimuth_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_solar_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_azimuth_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-CLD-AGG-GEO_All/SatelliteAzimuthAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* solar_zenith_angle */
     description = "zenith angle of sun at each retrieval position";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "solar_zenith_angle",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "degree",
-                                                   NULL, read_solar_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_zenith_angle);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     path = "/All_Data/VIIRS-CLD-AGG-GEO_All/SatelliteZenithAngle";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -939,78 +855,76 @@ static void register_cloud_product_type(const char *product_type, const char *pr
     /* cloud_base_height */
     description = "cloud_base_height";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_height",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "km",
-                                                   (type_nr ==
+        harp_ingestion_register_variable_range_read(product_definition, "cloud_base_height", harp_type_double, 1,
+                                                    dimension_type, NULL, description, "km",
+                                                    (type_nr ==
                                                     CLOUD_BASE_HEIGHT) ? NULL : exclude_non_cloud_base_height,
-                                                   read_cloud_base_height);
+                                                    get_optimal_range_length, read_cloud_base_height);
     path = "/All_Data/VIIRS-CBH-EDR_All/AverageCloudBaseHeight";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_top_height */
     description = "cloud_top_height";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_height",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "km",
-                                                   (type_nr == CLOUD_TOP_HEIGHT) ? NULL : exclude_non_cloud_top_height,
-                                                   read_cloud_top_height);
+        harp_ingestion_register_variable_range_read(product_definition, "cloud_top_height", harp_type_double, 1,
+                                                    dimension_type, NULL, description, "km",
+                                                    (type_nr == CLOUD_TOP_HEIGHT) ? NULL : exclude_non_cloud_top_height,
+                                                    get_optimal_range_length, read_cloud_top_height);
     path = "/All_Data/VIIRS-CTH-EDR_All/AverageCloudTopHeight";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_top_pressure */
     description = "cloud_top_pressure";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_pressure",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "hPa",
-                                                   (type_nr ==
+        harp_ingestion_register_variable_range_read(product_definition, "cloud_top_pressure", harp_type_double, 1,
+                                                    dimension_type, NULL, description, "hPa",
+                                                    (type_nr ==
                                                     CLOUD_TOP_PRESSURE) ? NULL : exclude_non_cloud_top_pressure,
-                                                   read_cloud_top_pressure);
+                                                    get_optimal_range_length, read_cloud_top_pressure);
     path = "/All_Data/VIIRS-CTP-EDR_All/AverageCloudTopPressure";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_top_temperature */
     description = "cloud_top_temperature";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_temperature",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "K",
-                                                   (type_nr ==
+        harp_ingestion_register_variable_range_read(product_definition, "cloud_top_temperature", harp_type_double, 1,
+                                                    dimension_type, NULL, description, "K",
+                                                    (type_nr ==
                                                     CLOUD_TOP_TEMPERATURE) ? NULL : exclude_non_cloud_top_temperature,
-                                                   read_cloud_top_temperature);
+                                                    get_optimal_range_length, read_cloud_top_temperature);
     path = "/All_Data/VIIRS-CTT-EDR_All/AverageCloudTopTemperature";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction */
     description = "cloud_fraction";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction",
-                                                   harp_type_double, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS,
-                                                   (type_nr == CLOUD_FRACTION) ? NULL : exclude_non_cloud_fraction,
-                                                   read_cloud_fraction);
+        harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction", harp_type_double, 1,
+                                                    dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS,
+                                                    (type_nr == CLOUD_FRACTION) ? NULL : exclude_non_cloud_fraction,
+                                                    get_optimal_range_length, read_cloud_fraction);
     path = "/All_Data/VIIRS-CCL-EDR_All/SummedCloudCover";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_effective_particle_size */
     description = "cloud_effective_particle_size";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_effective_particle_size",
-                                                   harp_type_double, 1, dimension_type, NULL, description, "µm",
-                                                   (type_nr ==
+        harp_ingestion_register_variable_range_read(product_definition, "cloud_effective_particle_size",
+                                                    harp_type_double, 1, dimension_type, NULL, description, "µm",
+                                                    (type_nr ==
                                                     CLOUD_EFFECTIVE_PARTICLE_SIZE) ? NULL :
                                                    exclude_non_cloud_effective_particle_size,
-                                                   read_cloud_effective_particle_size);
+                                                    get_optimal_range_length, read_cloud_effective_particle_size);
     path = "/All_Data/VIIRS-CEPS-EDR_All/AverageCloudEffectiveParticleSize";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_optical_depth */
     description = "cloud_optical_depth";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_optical_depth",
-                                                   harp_type_double, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS,
-                                                   (type_nr ==
+        harp_ingestion_register_variable_range_read(product_definition, "cloud_optical_depth", harp_type_double, 1,
+                                                    dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS,
+                                                    (type_nr ==
                                                     CLOUD_OPTICAL_DEPTH) ? NULL : exclude_non_cloud_optical_depth,
-                                                   read_cloud_optical_depth);
+                                                    get_optimal_range_length, read_cloud_optical_depth);
     path = "/All_Data/VIIRS-COT-EDR_All/AverageCloudOpticalThickness";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
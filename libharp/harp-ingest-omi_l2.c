@@ -523,6 +523,42 @@ static int read_variable_double(ingest_info *info, coda_cursor *cursor, const ch
     return 0;
 }
 
+static int read_variable_range_double(ingest_info *info, coda_cursor *cursor, const char *name, long offset,
+                                      long length, harp_array data)
+{
+    long dimension[2];
+    double missing_value;
+    double scale_factor;
+    double scale_offset;
+
+    dimension[0] = info->dimension[omi_dim_time];
+    dimension[1] = info->dimension[omi_dim_xtrack];
+    if (coda_cursor_goto_record_field_by_name(cursor, name) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (verify_variable_dimensions(cursor, 2, dimension) != 0)
+    {
+        return -1;
+    }
+    if (get_variable_attributes(cursor, &missing_value, &scale_factor, &scale_offset) != 0)
+    {
+        return -1;
+    }
+    if (coda_cursor_read_double_partial_array(cursor, offset, length, data.double_data) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    coda_cursor_goto_parent(cursor);
+
+    /* apply scaling and filter for NaN */
+    transform_array_double(length, data.double_data, missing_value, scale_factor, scale_offset);
+
+    return 0;
+}
+
 static int read_variable_partial_double(ingest_info *info, variable_descriptor *descriptor, long index, harp_array data)
 {
     long offset;
@@ -837,6 +873,14 @@ static void ingest_info_delete(ingest_info *info)
     free(info);
 }
 
+static long get_optimal_range_length(void *user_data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+
+    /* read (at least) a full scanline at a time */
+    return info->dimension[omi_dim_xtrack];
+}
+
 static int read_dimensions(void *user_data, long dimension[HARP_NUM_DIM_TYPES])
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -943,18 +987,18 @@ static int read_latitude_bounds(void *user_data, long index, harp_array data)
     return 0;
 }
 
-static int read_longitude(void *user_data, harp_array data)
+static int read_longitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->geo_cursor, "Longitude", 2, NULL, data);
+    return read_variable_range_double(info, &info->geo_cursor, "Longitude", index_offset, index_length, data);
 }
 
-static int read_latitude(void *user_data, harp_array data)
+static int read_latitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->geo_cursor, "Latitude", 2, NULL, data);
+    return read_variable_range_double(info, &info->geo_cursor, "Latitude", index_offset, index_length, data);
 }
 
 static int read_longitude_bounds_domino(void *user_data, harp_array data)
@@ -1064,18 +1108,19 @@ static int read_o3_error(void *user_data, long index, harp_array data)
     return read_variable_partial_double(info, &info->omo3pr_o3_precision, index, data);
 }
 
-static int read_o3_column(void *user_data, harp_array data)
+static int read_o3_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnAmountO3", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnAmountO3", index_offset, index_length, data);
 }
 
-static int read_o3_column_error(void *user_data, harp_array data)
+static int read_o3_column_error(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnAmountO3Precision", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnAmountO3Precision", index_offset, index_length,
+                                      data);
 }
 
 static int read_so2_column(void *user_data, harp_array data)
@@ -1123,60 +1168,68 @@ static int read_so2_column(void *user_data, harp_array data)
     return status;
 }
 
-static int read_no2_column(void *user_data, harp_array data)
+static int read_no2_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnAmountNO2", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnAmountNO2", index_offset, index_length, data);
 }
 
-static int read_no2_column_error(void *user_data, harp_array data)
+static int read_no2_column_error(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnAmountNO2Std", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnAmountNO2Std", index_offset, index_length,
+                                      data);
 }
 
-static int read_no2_column_tropospheric(void *user_data, harp_array data)
+static int read_no2_column_tropospheric(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnAmountNO2Trop", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnAmountNO2Trop", index_offset, index_length,
+                                      data);
 }
 
-static int read_no2_column_tropospheric_error(void *user_data, harp_array data)
+static int read_no2_column_tropospheric_error(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnAmountNO2TropStd", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnAmountNO2TropStd", index_offset, index_length,
+                                      data);
 }
 
-static int read_no2_column_domino(void *user_data, harp_array data)
+static int read_no2_column_domino(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "TotalVerticalColumn", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "TotalVerticalColumn", index_offset, index_length,
+                                      data);
 }
 
-static int read_no2_column_error_domino(void *user_data, harp_array data)
+static int read_no2_column_error_domino(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "TotalVerticalColumnError", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "TotalVerticalColumnError", index_offset, index_length,
+                                      data);
 }
 
-static int read_no2_column_tropospheric_domino(void *user_data, harp_array data)
+static int read_no2_column_tropospheric_domino(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "TroposphericVerticalColumn", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "TroposphericVerticalColumn", index_offset,
+                                      index_length, data);
 }
 
-static int read_no2_column_tropospheric_error_domino(void *user_data, harp_array data)
+static int read_no2_column_tropospheric_error_domino(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "TroposphericVerticalColumnError", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "TroposphericVerticalColumnError", index_offset,
+                                      index_length, data);
 }
 
 static int read_no2_column_tropospheric_validity_domino(void *user_data, harp_array data)
@@ -1203,11 +1256,11 @@ static int read_bro_column(void *user_data, harp_array data)
     return status;
 }
 
-static int read_bro_column_error(void *user_data, harp_array data)
+static int read_bro_column_error(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnUncertainty", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnUncertainty", index_offset, index_length, data);
 }
 
 static int read_chocho_column(void *user_data, harp_array data)
@@ -1227,11 +1280,11 @@ static int read_chocho_column(void *user_data, harp_array data)
     return status;
 }
 
-static int read_chocho_column_error(void *user_data, harp_array data)
+static int read_chocho_column_error(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnUncertainty", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnUncertainty", index_offset, index_length, data);
 }
 
 static int read_hcho_column(void *user_data, harp_array data)
@@ -1251,11 +1304,11 @@ static int read_hcho_column(void *user_data, harp_array data)
     return status;
 }
 
-static int read_hcho_column_error(void *user_data, harp_array data)
+static int read_hcho_column_error(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnUncertainty", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnUncertainty", index_offset, index_length, data);
 }
 
 static int read_oclo_column(void *user_data, harp_array data)
@@ -1275,11 +1328,11 @@ static int read_oclo_column(void *user_data, harp_array data)
     return status;
 }
 
-static int read_oclo_column_error(void *user_data, harp_array data)
+static int read_oclo_column_error(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "ColumnUncertainty", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "ColumnUncertainty", index_offset, index_length, data);
 }
 
 static int read_cloud_fraction(void *user_data, harp_array data)
@@ -1310,60 +1363,64 @@ static int read_cloud_fraction(void *user_data, harp_array data)
     return status;
 }
 
-static int read_cloud_fraction_for_o3(void *user_data, harp_array data)
+static int read_cloud_fraction_for_o3(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudFractionforO3", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudFractionforO3", index_offset, index_length,
+                                      data);
 }
 
-static int read_cloud_fraction_precision(void *user_data, harp_array data)
+static int read_cloud_fraction_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudFractionPrecision", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudFractionPrecision", index_offset, index_length,
+                                      data);
 }
 
-static int read_cloud_fraction_std(void *user_data, harp_array data)
+static int read_cloud_fraction_std(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudFractionStd", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudFractionStd", index_offset, index_length, data);
 }
 
-static int read_pressure_cloud(void *user_data, harp_array data)
+static int read_pressure_cloud(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudPressure", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudPressure", index_offset, index_length, data);
 }
 
-static int read_pressure_cloud_for_o3(void *user_data, harp_array data)
+static int read_pressure_cloud_for_o3(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudPressureforO3", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudPressureforO3", index_offset, index_length,
+                                      data);
 }
 
-static int read_pressure_cloud_top(void *user_data, harp_array data)
+static int read_pressure_cloud_top(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudTopPressure", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudTopPressure", index_offset, index_length, data);
 }
 
-static int read_pressure_cloud_precision(void *user_data, harp_array data)
+static int read_pressure_cloud_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudPressurePrecision", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudPressurePrecision", index_offset, index_length,
+                                      data);
 }
 
-static int read_pressure_cloud_std(void *user_data, harp_array data)
+static int read_pressure_cloud_std(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "CloudPressureStd", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "CloudPressureStd", index_offset, index_length, data);
 }
 
 static int read_uv_irradiance_surface(void *user_data, harp_array data)
@@ -1418,53 +1475,54 @@ static int read_aerosol_absorbing_optical_depth(void *user_data, long index, har
     return read_variable_partial_double(info, &info->omaeruv_aaod, index, data);
 }
 
-static int read_uv_aerosol_index(void *user_data, harp_array data)
+static int read_uv_aerosol_index(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "UVAerosolIndex", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "UVAerosolIndex", index_offset, index_length, data);
 }
 
-static int read_vis_aerosol_index(void *user_data, harp_array data)
+static int read_vis_aerosol_index(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->swath_cursor, "VISAerosolIndex", 2, NULL, data);
+    return read_variable_range_double(info, &info->swath_cursor, "VISAerosolIndex", index_offset, index_length, data);
 }
 
-static int read_solar_zenith_angle_wgs84(void *user_data, harp_array data)
+static int read_solar_zenith_angle_wgs84(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->geo_cursor, "SolarZenithAngle", 2, NULL, data);
+    return read_variable_range_double(info, &info->geo_cursor, "SolarZenithAngle", index_offset, index_length, data);
 }
 
-static int read_solar_azimuth_angle_wgs84(void *user_data, harp_array data)
+static int read_solar_azimuth_angle_wgs84(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->geo_cursor, "SolarAzimuthAngle", 2, NULL, data);
+    return read_variable_range_double(info, &info->geo_cursor, "SolarAzimuthAngle", index_offset, index_length, data);
 }
 
-static int read_viewing_zenith_angle_wgs84(void *user_data, harp_array data)
+static int read_viewing_zenith_angle_wgs84(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->geo_cursor, "ViewingZenithAngle", 2, NULL, data);
+    return read_variable_range_double(info, &info->geo_cursor, "ViewingZenithAngle", index_offset, index_length, data);
 }
 
-static int read_viewing_azimuth_angle_wgs84(void *user_data, harp_array data)
+static int read_viewing_azimuth_angle_wgs84(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->geo_cursor, "ViewingAzimuthAngle", 2, NULL, data);
+    return read_variable_range_double(info, &info->geo_cursor, "ViewingAzimuthAngle", index_offset, index_length, data);
 }
 
-static int read_relative_azimuth_angle_wgs84(void *user_data, harp_array data)
+static int read_relative_azimuth_angle_wgs84(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_variable_double(info, &info->geo_cursor, "RelativeAzimuthAngle", 2, NULL, data);
+    return read_variable_range_double(info, &info->geo_cursor, "RelativeAzimuthAngle", index_offset, index_length,
+                                      data);
 }
 
 static int exclude_destriped(void *user_data)
@@ -2053,9 +2111,10 @@ static void register_longitude_variable(harp_product_definition *product_definit
     const char *description;
 
     description = "longitude of the ground pixel center (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "longitude",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "degree_east", NULL, read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -180.0, 180.0);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2067,9 +2126,10 @@ static void register_latitude_variable(harp_product_definition *product_definiti
     const char *description;
 
     description = "latitude of the ground pixel center (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "latitude", harp_type_double,
-                                                                     1, dimension_type, NULL, description,
-                                                                     "degree_north", NULL, read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2134,10 +2194,11 @@ static void register_solar_zenith_angle_variable(harp_product_definition *produc
     const char *description;
 
     description = "solar zenith angle at WGS84 ellipsoid for center co-ordinate of the ground pixel";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "solar_zenith_angle",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_solar_zenith_angle_wgs84);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_zenith_angle_wgs84);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2150,10 +2211,11 @@ static void register_solar_azimuth_angle_variable(harp_product_definition *produ
 
     description = "solar azimuth angle at WGS84 ellipsoid for center co-ordinate of the ground pixel, defined East-of"
         "-North";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "solar_azimuth_angle",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_solar_azimuth_angle_wgs84);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_azimuth_angle_wgs84);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 360.0);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2165,10 +2227,11 @@ static void register_viewing_zenith_angle_variable(harp_product_definition *prod
     const char *description;
 
     description = "viewing zenith angle at WGS84 ellipsoid for center co-ordinate of the ground pixel";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "viewing_zenith_angle",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_viewing_zenith_angle_wgs84);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "viewing_zenith_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_viewing_zenith_angle_wgs84);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 180.0);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2181,10 +2244,11 @@ static void register_viewing_azimuth_angle_variable(harp_product_definition *pro
 
     description = "viewing azimuth angle at WGS84 ellipsoid for center co-ordinate of the ground pixel, defined East-of"
         "-North";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "viewing_azimuth_angle",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_viewing_azimuth_angle_wgs84);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "viewing_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_viewing_azimuth_angle_wgs84);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 360.0);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2251,19 +2315,19 @@ static void register_omaeruv_product(void)
 
     /* uv_aerosol_index */
     description = "UV aerosol index";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "uv_aerosol_index",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                                     read_uv_aerosol_index);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "uv_aerosol_index",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length, read_uv_aerosol_index);
     path = "/HDFEOS/SWATHS/Aerosol_NearUV_Swath/Data_Fields/UVAerosolIndex[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* vis_aerosol_index */
     description = "VIS aerosol index";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "vis_aerosol_index",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                                     read_vis_aerosol_index);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "vis_aerosol_index",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length, read_vis_aerosol_index);
     path = "/HDFEOS/SWATHS/Aerosol_NearUV_Swath/Data_Fields/VISAerosolIndex[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2314,11 +2378,11 @@ static void register_ombro_product(void)
 
     /* BrO_column_number_density_uncertainty */
     description = "uncertainty of the BrO vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "BrO_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", exclude_destriped,
-                                                                     read_bro_column_error);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "BrO_column_number_density_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_destriped,
+                                                                      get_optimal_range_length, read_bro_column_error);
     path = "/HDFEOS/SWATHS/OMI_Total_Column_Amount_BRO/Data_Fields/ColumnUncertainty[]";
     harp_variable_definition_add_mapping(variable_definition, "destriped unset", NULL, path, NULL);
 }
@@ -2371,11 +2435,12 @@ static void register_omchocho_product(void)
 
     /* BrO_column_number_density_uncertainty */
     description = "uncertainty of the CHOCHO vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "C2H2O2_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", exclude_destriped,
-                                                                     read_chocho_column_error);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "C2H2O2_column_number_density_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_destriped,
+                                                                      get_optimal_range_length,
+                                                                      read_chocho_column_error);
     path = "/HDFEOS/SWATHS/OMI_Total_Column_Amount_CHOCHO/Data_Fields/ColumnUncertainty[]";
     harp_variable_definition_add_mapping(variable_definition, "destriped unset", NULL, path, NULL);
 }
@@ -2445,27 +2510,30 @@ static void register_omcldo2_product(void)
 
     /* cloud_fraction_uncertainty */
     description = "uncertainty of the effective cloud fraction";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                                     read_cloud_fraction_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_cloud_fraction_precision);
     path = "/HDFEOS/SWATHS/CloudFractionAndPressure/Data_Fields/CloudFractionPrecision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL, read_pressure_cloud);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length, read_pressure_cloud);
     path = "/HDFEOS/SWATHS/CloudFractionAndPressure/Data_Fields/CloudPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "uncertainty of the effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL,
-                                                                     read_pressure_cloud_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_pressure_cloud_precision);
     path = "/HDFEOS/SWATHS/CloudFractionAndPressure/Data_Fields/CloudPressurePrecision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2511,29 +2579,32 @@ static void register_omcldrr_product(void)
     /* relative_azimuth_angle */
     description = "relative (sun + 180 - view) azimuth angle at WGS84 ellipsoid for center co-ordinate of the ground"
         " pixel";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "relative_azimuth_angle",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_relative_azimuth_angle_wgs84);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "relative_azimuth_angle",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_relative_azimuth_angle_wgs84);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 360.0);
     path = "/HDFEOS/SWATHS/Cloud_Product/Geolocation_Fields/RelativeAzimuthAngle[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction */
     description = "effective cloud fraction";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                                     read_cloud_fraction_for_o3);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_cloud_fraction_for_o3);
     path = "/HDFEOS/SWATHS/Cloud_Product/Data_Fields/CloudFractionforO3[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL,
-                                                                     read_pressure_cloud_for_o3);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_pressure_cloud_for_o3);
     path = "/HDFEOS/SWATHS/Cloud_Product/Data_Fields/CloudPressureforO3[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2585,18 +2656,20 @@ static void register_omdoao3_product(void)
 
     /* O3_column_number_density */
     description = "O3 vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "DU", NULL, read_o3_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "DU", NULL, get_optimal_range_length,
+                                                                      read_o3_column);
     path = "/HDFEOS/SWATHS/ColumnAmountO3/Data_Fields/ColumnAmountO3[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_column_number_density_uncertainty */
     description = "uncertainty of the O3 vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "O3_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "DU", NULL, read_o3_column_error);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_column_number_density_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "DU", NULL, get_optimal_range_length,
+                                                                      read_o3_column_error);
     path = "/HDFEOS/SWATHS/ColumnAmountO3/Data_Fields/ColumnAmountO3Precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -2622,18 +2695,20 @@ static void register_omdoao3_product(void)
 
     /* cloud_pressure */
     description = "effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL, read_pressure_cloud);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length, read_pressure_cloud);
     path = "/HDFEOS/SWATHS/ColumnAmountO3/Data_Fields/CloudPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "uncertainty of the effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL,
-                                                                     read_pressure_cloud_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_pressure_cloud_precision);
     path = "/HDFEOS/SWATHS/ColumnAmountO3/Data_Fields/CloudPressurePrecision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2662,18 +2737,20 @@ static void register_omdomino_product(void)
 
     /* longitude */
     description = "longitude of the ground pixel center";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "longitude", harp_type_double,
-                                                                     1, dimension_type, NULL, description,
-                                                                     "degree_east", NULL, read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -180.0, 180.0);
     path = "/HDFEOS/SWATHS/DominoNO2/Geolocation_Fields/Longitude[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* latitude */
     description = "latitude of the ground pixel center";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "latitude", harp_type_double,
-                                                                     1, dimension_type, NULL, description,
-                                                                     "degree_north", NULL, read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     path = "/HDFEOS/SWATHS/DominoNO2/Geolocation_Fields/Latitude[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -2718,40 +2795,43 @@ static void register_omdomino_product(void)
 
     /* NO2_column_number_density */
     description = "NO2 vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "NO2_column_number_density",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL,
-                                                                     read_no2_column_domino);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "NO2_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", NULL,
+                                                                      get_optimal_range_length, read_no2_column_domino);
     path = "/HDFEOS/SWATHS/DominoNO2/Data_Fields/TotalVerticalColumn[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* NO2_column_number_density_uncertainty */
     description = "uncertainty of the NO2 vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "NO2_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL,
-                                                                     read_no2_column_error_domino);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "NO2_column_number_density_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_no2_column_error_domino);
     path = "/HDFEOS/SWATHS/DominoNO2/Data_Fields/TotalVerticalColumnError[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_NO2_column_number_density */
     description = "NO2 tropospheric column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "tropospheric_NO2_column_number_density",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL,
-                                                                     read_no2_column_tropospheric_domino);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "tropospheric_NO2_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_no2_column_tropospheric_domino);
     path = "/HDFEOS/SWATHS/DominoNO2/Data_Fields/TroposphericVerticalColumn[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_NO2_column_number_density_uncertainty */
     description = "uncertainty of the NO2 tropospheric column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "tropospheric_NO2_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL,
-                                                                     read_no2_column_tropospheric_error_domino);
+    variable_definition =
+        harp_ingestion_register_variable_range_read(product_definition,
+                                                    "tropospheric_NO2_column_number_density_uncertainty",
+                                                    harp_type_double, 1, dimension_type, NULL, description,
+                                                    "molec/cm^2", NULL, get_optimal_range_length,
+                                                    read_no2_column_tropospheric_error_domino);
     path = "/HDFEOS/SWATHS/DominoNO2/Data_Fields/TroposphericVerticalColumnError[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -2777,26 +2857,30 @@ static void register_omdomino_product(void)
 
     /* cloud_fraction_uncertainty */
     description = "uncertainty of the effective cloud fraction";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                                     read_cloud_fraction_std);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_cloud_fraction_std);
     path = "/HDFEOS/SWATHS/DominoNO2/Data_Fields/CloudFractionStd[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL, read_pressure_cloud);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length, read_pressure_cloud);
     path = "/HDFEOS/SWATHS/DominoNO2/Data_Fields/CloudPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "uncertainty of the effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL, read_pressure_cloud_std);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_pressure_cloud_std);
     path = "/HDFEOS/SWATHS/DominoNO2/Data_Fields/CloudPressureStd[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -2847,11 +2931,11 @@ static void register_omhcho_product(void)
 
     /* HCHO_column_number_density_uncertainty */
     description = "uncertainty of the HCHO vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "HCHO_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", exclude_destriped,
-                                                                     read_hcho_column_error);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "HCHO_column_number_density_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_destriped,
+                                                                      get_optimal_range_length, read_hcho_column_error);
     path = "/HDFEOS/SWATHS/OMI_Total_Column_Amount_HCHO/Data_Fields/ColumnUncertainty[]";
     harp_variable_definition_add_mapping(variable_definition, "destriped unset", NULL, path, NULL);
 }
@@ -2904,39 +2988,42 @@ static void register_omno2_product(void)
 
     /* NO2_column_number_density */
     description = "NO2 vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "NO2_column_number_density",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL, read_no2_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "NO2_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", NULL,
+                                                                      get_optimal_range_length, read_no2_column);
     path = "/HDFEOS/SWATHS/ColumnAmountNO2/Data_Fields/ColumnAmountNO2[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* NO2_column_number_density_uncertainty */
     description = "uncertainty of the NO2 vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "NO2_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL,
-                                                                     read_no2_column_error);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "NO2_column_number_density_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", NULL,
+                                                                      get_optimal_range_length, read_no2_column_error);
     path = "/HDFEOS/SWATHS/ColumnAmountNO2/Data_Fields/ColumnAmountNO2Std[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_NO2_column_number_density */
     description = "NO2 tropospheric column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "tropospheric_NO2_column_number_density",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL,
-                                                                     read_no2_column_tropospheric);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "tropospheric_NO2_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_no2_column_tropospheric);
     path = "/HDFEOS/SWATHS/ColumnAmountNO2/Data_Fields/ColumnAmountNO2Trop[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_NO2_column_number_density_uncertainty */
     description = "uncertainty of the NO2 tropospheric column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "tropospheric_NO2_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", NULL,
-                                                                     read_no2_column_tropospheric_error);
+    variable_definition =
+        harp_ingestion_register_variable_range_read(product_definition,
+                                                    "tropospheric_NO2_column_number_density_uncertainty",
+                                                    harp_type_double, 1, dimension_type, NULL, description,
+                                                    "molec/cm^2", NULL, get_optimal_range_length,
+                                                    read_no2_column_tropospheric_error);
     path = "/HDFEOS/SWATHS/ColumnAmountNO2/Data_Fields/ColumnAmountNO2TropStd[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -2951,26 +3038,30 @@ static void register_omno2_product(void)
 
     /* cloud_fraction_uncertainty */
     description = "uncertainty of the effective cloud fraction";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                                     read_cloud_fraction_std);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_cloud_fraction_std);
     path = "/HDFEOS/SWATHS/ColumnAmountNO2/Data_Fields/CloudFractionStd[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL, read_pressure_cloud);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length, read_pressure_cloud);
     path = "/HDFEOS/SWATHS/ColumnAmountNO2/Data_Fields/CloudPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "uncertainty of the effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", NULL, read_pressure_cloud_std);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_pressure_cloud_std);
     path = "/HDFEOS/SWATHS/ColumnAmountNO2/Data_Fields/CloudPressureStd[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -3101,11 +3192,11 @@ static void register_omoclo_product(void)
 
     /* OClO_column_number_density_uncertainty */
     description = "uncertainty of the OClO vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition,
-                                                                     "OClO_column_number_density_uncertainty",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "molec/cm^2", exclude_destriped,
-                                                                     read_oclo_column_error);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "OClO_column_number_density_uncertainty",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "molec/cm^2", exclude_destriped,
+                                                                      get_optimal_range_length, read_oclo_column_error);
     path = "/HDFEOS/SWATHS/OMI_Total_Column_Amount_OClO/Data_Fields/ColumnUncertainty[]";
     harp_variable_definition_add_mapping(variable_definition, "destriped unset", NULL, path, description);
 }
@@ -3196,20 +3287,21 @@ static void register_omso2_product(void)
 
     /* cloud_pressure */
     description = "effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", exclude_cloud_pressure,
-                                                                     read_pressure_cloud);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", exclude_cloud_pressure,
+                                                                      get_optimal_range_length, read_pressure_cloud);
     path = "/HDFEOS/SWATHS/OMI_Total_Column_Amount_SO2/Data_Fields/CloudPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "V3 product", path, NULL);
 
 
     /* cloud_top_pressure */
     description = "cloud top pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_top_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", exclude_cloud_top_pressure,
-                                                                     read_pressure_cloud_top);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_top_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", exclude_cloud_top_pressure,
+                                                                      get_optimal_range_length,
+                                                                      read_pressure_cloud_top);
     path = "/HDFEOS/SWATHS/OMI_Total_Column_Amount_SO2/Data_Fields/CloudTopPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "V2 product", path, NULL);
 }
@@ -3267,9 +3359,10 @@ static void register_omto3_product(void)
 
     /* O3_column_number_density */
     description = "ozone vertical column density";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "DU", NULL, read_o3_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "DU", NULL, get_optimal_range_length,
+                                                                      read_o3_column);
     path = "/HDFEOS/SWATHS/OMI_Column_Amount_O3/Data_Fields/ColumnAmountO3[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -3300,19 +3393,20 @@ static void register_omto3_product(void)
 
     /* cloud_pressure */
     description = "effective cloud pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", exclude_cloud_pressure,
-                                                                     read_pressure_cloud);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", exclude_cloud_pressure,
+                                                                      get_optimal_range_length, read_pressure_cloud);
     path = "/HDFEOS/SWATHS/OMI_Column_Amount_O3/Data_Fields/CloudPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "V3 product", path, NULL);
 
     /* cloud_top_pressure */
     description = "cloud top pressure";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "cloud_top_pressure",
-                                                                     harp_type_double, 1, dimension_type, NULL,
-                                                                     description, "hPa", exclude_cloud_top_pressure,
-                                                                     read_pressure_cloud_top);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_top_pressure",
+                                                                      harp_type_double, 1, dimension_type, NULL,
+                                                                      description, "hPa", exclude_cloud_top_pressure,
+                                                                      get_optimal_range_length,
+                                                                      read_pressure_cloud_top);
     path = "/HDFEOS/SWATHS/OMI_Column_Amount_O3/Data_Fields/CloudTopPressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "V2 product", path, NULL);
 }
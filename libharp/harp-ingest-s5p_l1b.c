@@ -207,6 +207,38 @@ static int read_partial_dataset(const coda_cursor *cursor, long offset, long len
     return 0;
 }
 
+static int read_dataset_range(coda_cursor cursor, const char *dataset_name, long offset, long length,
+                              harp_array data)
+{
+    harp_scalar fill_value;
+
+    if (coda_cursor_goto_record_field_by_name(&cursor, dataset_name) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_float_partial_array(&cursor, offset, length, data.float_data) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_goto(&cursor, "@FillValue[0]") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_float(&cursor, &fill_value.float_data) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+
+    /* Replace values equal to the _FillValue variable attribute by NaN. */
+    harp_array_replace_fill_value(harp_type_float, length, data, fill_value);
+
+    return 0;
+}
+
 static int init_cursors(ingest_info *info, const char *product_group_name)
 {
     coda_cursor cursor;
@@ -501,12 +533,23 @@ static int read_dimensions(void *user_data, long dimension[HARP_NUM_DIM_TYPES])
     return 0;
 }
 
-static int read_scan_subindex(void *user_data, long index, harp_array data)
+static long get_optimal_range_length(void *user_data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+
+    /* read (at least) a full scanline at a time */
+    return info->num_pixels;
+}
+
+static int read_scan_subindex(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
+    long i;
 
-    index = index - (index / info->num_pixels) * info->num_pixels;
-    *data.int16_data = (int16_t)index;
+    for (i = 0; i < index_length; i++)
+    {
+        data.int16_data[i] = (int16_t)((index_offset + i) % info->num_pixels);
+    }
 
     return 0;
 }
@@ -645,32 +688,32 @@ static int read_orbit_index(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_longitude(void *user_data, harp_array data)
+static int read_longitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "longitude", info->num_scanlines * info->num_pixels, data);
+    return read_dataset_range(info->geo_data_cursor, "longitude", index_offset, index_length, data);
 }
 
-static int read_longitude_bounds(void *user_data, harp_array data)
+static int read_longitude_bounds(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "longitude_bounds", info->num_scanlines * info->num_pixels * 4, data);
+    return read_dataset_range(info->geo_data_cursor, "longitude_bounds", index_offset * 4, index_length * 4, data);
 }
 
-static int read_latitude(void *user_data, harp_array data)
+static int read_latitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "latitude", info->num_scanlines * info->num_pixels, data);
+    return read_dataset_range(info->geo_data_cursor, "latitude", index_offset, index_length, data);
 }
 
-static int read_latitude_bounds(void *user_data, harp_array data)
+static int read_latitude_bounds(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "latitude_bounds", info->num_scanlines * info->num_pixels * 4, data);
+    return read_dataset_range(info->geo_data_cursor, "latitude_bounds", index_offset * 4, index_length * 4, data);
 }
 
 static int read_sensor_longitude(void *user_data, harp_array data)
@@ -715,54 +758,86 @@ static int read_sensor_altitude(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_solar_azimuth_angle(void *user_data, harp_array data)
+static int read_solar_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "solar_azimuth_angle", info->num_scanlines * info->num_pixels, data);
+    return read_dataset_range(info->geo_data_cursor, "solar_azimuth_angle", index_offset, index_length, data);
 }
 
-static int read_solar_zenith_angle(void *user_data, harp_array data)
+static int read_solar_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "solar_zenith_angle", info->num_scanlines * info->num_pixels, data);
+    return read_dataset_range(info->geo_data_cursor, "solar_zenith_angle", index_offset, index_length, data);
 }
 
-static int read_viewing_azimuth_angle(void *user_data, harp_array data)
+static int read_viewing_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "viewing_azimuth_angle", info->num_scanlines * info->num_pixels, data);
+    return read_dataset_range(info->geo_data_cursor, "viewing_azimuth_angle", index_offset, index_length, data);
 }
 
-static int read_viewing_zenith_angle(void *user_data, harp_array data)
+static int read_viewing_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geo_data_cursor, "viewing_zenith_angle", info->num_scanlines * info->num_pixels, data);
+    return read_dataset_range(info->geo_data_cursor, "viewing_zenith_angle", index_offset, index_length, data);
 }
 
-static int read_wavelength(void *user_data, long index, harp_array data)
+static int read_wavelength(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
-    long offset;
 
-    /* Compute the offset into an array of dimensions #pixels x #channels (either calibrated_wavelength or
-     * nominal_wavelength) using a pixel index derived from the provided index on the time dimension (of length
-     * #scanlines x #pixels).
+    /* The wavelengths are stored in an array of dimensions #pixels x #channels (either calibrated_wavelength or
+     * nominal_wavelength), so the range on the time dimension (of length #scanlines x #pixels) is read in parts that
+     * each cover consecutive pixels within a single scanline.
      */
-    offset = (index - (index / info->num_pixels) * info->num_pixels) * info->num_channels;
+    while (index_length > 0)
+    {
+        long pixel_index = index_offset % info->num_pixels;
+        long length = info->num_pixels - pixel_index;
 
-    return read_partial_dataset(&info->wavelength_cursor, offset, info->num_channels, data,
-                                info->wavelength_fill_value);
+        if (length > index_length)
+        {
+            length = index_length;
+        }
+        if (read_partial_dataset(&info->wavelength_cursor, pixel_index * info->num_channels,
+                                 length * info->num_channels, data, info->wavelength_fill_value) != 0)
+        {
+            return -1;
+        }
+        data.float_data += length * info->num_channels;
+        index_offset += length;
+        index_length -= length;
+    }
+
+    return 0;
 }
 
-static int read_observable(void *user_data, long index, harp_array data)
+static int read_observable(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_partial_dataset(&info->observable_cursor, index * info->num_channels, info->num_channels, data,
+    return read_partial_dataset(&info->observable_cursor, index_offset * info->num_channels,
+                                index_length * info->num_channels, data, info->observable_fill_value);
+}
+
+static int read_wavelength_sub_range(void *user_data, long index, long sub_offset, long sub_length, harp_array data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    long pixel_index = index % info->num_pixels;
+
+    return read_partial_dataset(&info->wavelength_cursor, pixel_index * info->num_channels + sub_offset, sub_length,
+                                data, info->wavelength_fill_value);
+}
+
+static int read_observable_sub_range(void *user_data, long index, long sub_offset, long sub_length, harp_array data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+
+    return read_partial_dataset(&info->observable_cursor, index * info->num_channels + sub_offset, sub_length, data,
                                 info->observable_fill_value);
 }
 
@@ -775,9 +850,10 @@ static void register_irradiance_product_variables(harp_product_definition *produ
     char path[MAX_PATH_LENGTH];
 
     description = "zero-based index of the pixel within the scanline";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "scan_subindex", harp_type_int16, 1,
-                                                    dimension_type, NULL, description, NULL, NULL, read_scan_subindex);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "scan_subindex",
+                                                                      harp_type_int16, 1, dimension_type, NULL,
+                                                                      description, NULL, NULL, get_optimal_range_length,
+                                                                      read_scan_subindex);
     description =
         "the scanline and pixel dimensions are collapsed into a temporal dimension; the index of the pixel within the "
         "scanline is computed as the index on the temporal dimension modulo the number of scanlines";
@@ -804,17 +880,19 @@ static void register_irradiance_product_variables(harp_product_definition *produ
 
     /* Irradiance. */
     description = "calibrated wavelength";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "wavelength", harp_type_float, 2,
-                                                    dimension_type, NULL, description, "nm", NULL, read_wavelength);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "wavelength", harp_type_float,
+                                                                      2, dimension_type, NULL, description, "nm", NULL,
+                                                                      get_optimal_range_length, read_wavelength);
+    harp_variable_definition_set_sub_range_read(variable_definition, read_wavelength_sub_range);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/INSTRUMENT/calibrated_wavelength[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "spectral photon irradiance";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "photon_irradiance", harp_type_float, 2,
-                                                    dimension_type, NULL, description, "mol/(s.m^2.nm)", NULL,
-                                                    read_observable);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "photon_irradiance",
+                                                                      harp_type_float, 2, dimension_type, NULL,
+                                                                      description, "mol/(s.m^2.nm)", NULL,
+                                                                      get_optimal_range_length, read_observable);
+    harp_variable_definition_set_sub_range_read(variable_definition, read_observable_sub_range);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/OBSERVATIONS/irradiance[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -830,9 +908,10 @@ static void register_radiance_product_variables(harp_product_definition *product
     char path[MAX_PATH_LENGTH];
 
     description = "zero-based index of the pixel within the scanline";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "scan_subindex", harp_type_int16, 1,
-                                                    dimension_type, NULL, description, NULL, NULL, read_scan_subindex);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "scan_subindex",
+                                                                      harp_type_int16, 1, dimension_type, NULL,
+                                                                      description, NULL, NULL, get_optimal_range_length,
+                                                                      read_scan_subindex);
     description =
         "the scanline and ground pixel dimensions are collapsed into a single temporal dimension; the index "
         "of the pixel within the scanline is computed as the index on this temporal dimension modulo the "
@@ -860,35 +939,39 @@ static void register_radiance_product_variables(harp_product_definition *product
 
     /* Geographic. */
     description = "latitude of the ground pixel center (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "latitude", harp_type_float, 1,
-                                                                     dimension_type, NULL, description, "degree_north",
-                                                                     NULL, read_latitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_float,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_north", NULL, get_optimal_range_length,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_float(variable_definition, -90.0f, 90.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/latitude[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "longitude of the ground pixel center (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "longitude", harp_type_float,
-                                                                     1, dimension_type, NULL, description,
-                                                                     "degree_east", NULL, read_longitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_float,
+                                                                      1, dimension_type, NULL, description,
+                                                                      "degree_east", NULL, get_optimal_range_length,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_float(variable_definition, -180.0f, 180.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/longitude[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "latitudes of the ground pixel corners (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "latitude_bounds",
-                                                                     harp_type_float, 2, bounds_dimension_type,
-                                                                     bounds_dimension, description, "degree_north",
-                                                                     NULL, read_latitude_bounds);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude_bounds",
+                                                                      harp_type_float, 2, bounds_dimension_type,
+                                                                      bounds_dimension, description, "degree_north",
+                                                                      NULL, get_optimal_range_length,
+                                                                      read_latitude_bounds);
     harp_variable_definition_set_valid_range_float(variable_definition, -90.0f, 90.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/latitude_bounds[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "longitudes of the ground pixel corners (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "longitude_bounds",
-                                                                     harp_type_float, 2, bounds_dimension_type,
-                                                                     bounds_dimension, description, "degree_east",
-                                                                     NULL, read_longitude_bounds);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude_bounds",
+                                                                      harp_type_float, 2, bounds_dimension_type,
+                                                                      bounds_dimension, description, "degree_east",
+                                                                      NULL, get_optimal_range_length,
+                                                                      read_longitude_bounds);
     harp_variable_definition_set_valid_range_float(variable_definition, -180.0f, 180.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/longitude_bounds[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -923,54 +1006,60 @@ static void register_radiance_product_variables(harp_product_definition *product
 
     /* Angles. */
     description = "zenith angle of the Sun at the ground pixel location (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "solar_zenith_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_solar_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_zenith_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_zenith_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, 0.0f, 180.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/solar_zenith_angle[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "azimuth angle of the Sun at the ground pixel location (WGS84), measured East-of-North";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "solar_azimuth_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_solar_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_azimuth_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_solar_azimuth_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, 0.0f, 360.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/solar_azimuth_angle[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "zenith angle of the satellite at the ground pixel location (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "sensor_zenith_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_viewing_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_zenith_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_viewing_zenith_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, 0.0f, 180.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/viewing_zenith_angle[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "azimuth angle of the satellite at the ground pixel location (WGS84), measured East-of-North";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "sensor_azimuth_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_viewing_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_azimuth_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_viewing_azimuth_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, 0.0f, 360.0f);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/GEODATA/viewing_azimuth_angle[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* Radiance. */
     description = "nominal wavelength";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "wavelength", harp_type_float, 2,
-                                                    dimension_type, NULL, description, "nm", NULL, read_wavelength);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "wavelength", harp_type_float,
+                                                                      2, dimension_type, NULL, description, "nm", NULL,
+                                                                      get_optimal_range_length, read_wavelength);
+    harp_variable_definition_set_sub_range_read(variable_definition, read_wavelength_sub_range);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/INSTRUMENT/nominal_wavelength[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "spectral photon radiance";
-    variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "photon_radiance", harp_type_float, 2,
-                                                    dimension_type, NULL, description, "mol/(s.m^2.nm.sr)", NULL,
-                                                    read_observable);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "photon_radiance",
+                                                                      harp_type_float, 2, dimension_type, NULL,
+                                                                      description, "mol/(s.m^2.nm.sr)", NULL,
+                                                                      get_optimal_range_length, read_observable);
+    harp_variable_definition_set_sub_range_read(variable_definition, read_observable_sub_range);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/OBSERVATIONS/radiance[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -853,6 +853,37 @@ static int read_dataset(coda_cursor cursor, const char *dataset_name, harp_data_
     return 0;
 }
 
+static int read_partial_dataset(coda_cursor cursor, const char *dataset_name, long offset, long length,
+                                harp_array data)
+{
+    harp_scalar fill_value;
+
+    if (coda_cursor_goto_record_field_by_name(&cursor, dataset_name) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_float_partial_array(&cursor, offset, length, data.float_data) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_goto(&cursor, "@FillValue[0]") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_float(&cursor, &fill_value.float_data) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    /* Replace values equal to the _FillValue variable attribute by NaN. */
+    harp_array_replace_fill_value(harp_type_float, length, data, fill_value);
+
+    return 0;
+}
+
 static int read_surface_layer_status(ingest_info *info)
 {
     harp_array data;
@@ -948,6 +979,14 @@ static int read_dimensions(void *user_data, long dimension[HARP_NUM_DIM_TYPES])
     return 0;
 }
 
+static long get_optimal_range_length(void *user_data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+
+    /* read (at least) a full scanline at a time */
+    return info->num_pixels;
+}
+
 static int read_scan_subindex(void *user_data, long index, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -1073,20 +1112,20 @@ static int read_orbit_index(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_geolocation_latitude_bounds(void *user_data, harp_array data)
+static int read_geolocation_latitude_bounds(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geolocation_cursor, "latitude_bounds", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_corners, data);
+    return read_partial_dataset(info->geolocation_cursor, "latitude_bounds", index_offset * info->num_corners,
+                                index_length * info->num_corners, data);
 }
 
-static int read_geolocation_longitude_bounds(void *user_data, harp_array data)
+static int read_geolocation_longitude_bounds(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geolocation_cursor, "longitude_bounds", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_corners, data);
+    return read_partial_dataset(info->geolocation_cursor, "longitude_bounds", index_offset * info->num_corners,
+                                index_length * info->num_corners, data);
 }
 
 static int read_geolocation_satellite_altitude(void *user_data, harp_array data)
@@ -1132,60 +1171,55 @@ static int read_geolocation_satellite_longitude(void *user_data, harp_array data
     return 0;
 }
 
-static int read_geolocation_solar_azimuth_angle(void *user_data, harp_array data)
+static int read_geolocation_solar_azimuth_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geolocation_cursor, "solar_azimuth_angle", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->geolocation_cursor, "solar_azimuth_angle", index_offset, index_length, data);
 }
 
-static int read_geolocation_solar_zenith_angle(void *user_data, harp_array data)
+static int read_geolocation_solar_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geolocation_cursor, "solar_zenith_angle", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->geolocation_cursor, "solar_zenith_angle", index_offset, index_length, data);
 }
 
-static int read_geolocation_viewing_azimuth_angle(void *user_data, harp_array data)
+static int read_geolocation_viewing_azimuth_angle(void *user_data, long index_offset, long index_length,
+                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geolocation_cursor, "viewing_azimuth_angle", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->geolocation_cursor, "viewing_azimuth_angle", index_offset, index_length, data);
 }
 
-static int read_geolocation_viewing_zenith_angle(void *user_data, harp_array data)
+static int read_geolocation_viewing_zenith_angle(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->geolocation_cursor, "viewing_zenith_angle", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->geolocation_cursor, "viewing_zenith_angle", index_offset, index_length, data);
 }
 
-static int read_input_aerosol_index_340_380(void *user_data, harp_array data)
+static int read_input_aerosol_index_340_380(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "aerosol_index_340_380", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "aerosol_index_340_380", index_offset, index_length, data);
 }
 
-static int read_input_aerosol_index_354_388(void *user_data, harp_array data)
+static int read_input_aerosol_index_354_388(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "aerosol_index_354_388", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "aerosol_index_354_388", index_offset, index_length, data);
 }
 
-static int read_input_altitude(void *user_data, harp_array data)
+static int read_input_altitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "altitude", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_levels, data);
+    return read_partial_dataset(info->input_data_cursor, "altitude", index_offset * info->num_levels,
+                                index_length * info->num_levels, data);
 }
 
 static int read_input_altitude_bounds(void *user_data, harp_array data)
@@ -1236,140 +1270,137 @@ static int read_input_altitude_bounds(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_input_cloud_albedo_crb(void *user_data, harp_array data)
+static int read_input_cloud_albedo_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_albedo_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_albedo_crb", index_offset, index_length, data);
 }
 
-static int read_input_cloud_albedo_crb_precision(void *user_data, harp_array data)
+static int read_input_cloud_albedo_crb_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_albedo_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_albedo_crb_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_input_cloud_base_height(void *user_data, harp_array data)
+static int read_input_cloud_base_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_base_height", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_base_height", index_offset, index_length, data);
 }
 
-static int read_input_cloud_base_height_precision(void *user_data, harp_array data)
+static int read_input_cloud_base_height_precision(void *user_data, long index_offset, long index_length,
+                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_base_height_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_base_height_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_input_cloud_base_pressure(void *user_data, harp_array data)
+static int read_input_cloud_base_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_base_pressure", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_base_pressure", index_offset, index_length, data);
 }
 
-static int read_input_cloud_base_pressure_precision(void *user_data, harp_array data)
+static int read_input_cloud_base_pressure_precision(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_base_pressure_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_base_pressure_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_input_cloud_fraction_viirs_swir(void *user_data, harp_array data)
+static int read_input_cloud_fraction_viirs_swir(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_fraction_VIIRS_SWIR_IFOV", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_fraction_VIIRS_SWIR_IFOV", index_offset, index_length,
+                                data);
 }
 
-static int read_input_cloud_height_crb(void *user_data, harp_array data)
+static int read_input_cloud_height_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_height_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_height_crb", index_offset, index_length, data);
 }
 
-static int read_input_cloud_height_crb_precision(void *user_data, harp_array data)
+static int read_input_cloud_height_crb_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_height_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_height_crb_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_input_cloud_optical_thickness(void *user_data, harp_array data)
+static int read_input_cloud_optical_thickness(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_optical_thickness", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_optical_thickness", index_offset, index_length, data);
 }
 
-static int read_input_cloud_optical_thickness_precision(void *user_data, harp_array data)
+static int read_input_cloud_optical_thickness_precision(void *user_data, long index_offset, long index_length,
+                                                        harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_optical_thickness_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_optical_thickness_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_input_cloud_pressure_crb(void *user_data, harp_array data)
+static int read_input_cloud_pressure_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_pressure_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_pressure_crb", index_offset, index_length, data);
 }
 
-static int read_input_cloud_pressure_crb_precision(void *user_data, harp_array data)
+static int read_input_cloud_pressure_crb_precision(void *user_data, long index_offset, long index_length,
+                                                   harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_pressure_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_pressure_crb_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_input_cloud_top_height(void *user_data, harp_array data)
+static int read_input_cloud_top_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_top_height", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_top_height", index_offset, index_length, data);
 }
 
-static int read_input_cloud_top_height_precision(void *user_data, harp_array data)
+static int read_input_cloud_top_height_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_top_height_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_top_height_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_input_cloud_top_pressure(void *user_data, harp_array data)
+static int read_input_cloud_top_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_top_pressure", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_top_pressure", index_offset, index_length, data);
 }
 
-static int read_input_cloud_top_pressure_precision(void *user_data, harp_array data)
+static int read_input_cloud_top_pressure_precision(void *user_data, long index_offset, long index_length,
+                                                   harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "cloud_top_pressure_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "cloud_top_pressure_precision", index_offset, index_length,
+                                data);
 }
 
 static int read_input_dry_air_subcolumns_inverted(void *user_data, harp_array data)
@@ -1402,36 +1433,39 @@ static int read_input_methane_profile_apriori_inverted(void *user_data, harp_arr
     return harp_array_invert(harp_type_float, 1, 2, dimension, data);
 }
 
-static int read_input_ozone_total_vertical_column(void *user_data, harp_array data)
+static int read_input_ozone_total_vertical_column(void *user_data, long index_offset, long index_length,
+                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "ozone_total_vertical_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "ozone_total_vertical_column", index_offset, index_length,
+                                data);
 }
 
-static int read_input_ozone_total_vertical_column_precision(void *user_data, harp_array data)
+static int read_input_ozone_total_vertical_column_precision(void *user_data, long index_offset, long index_length,
+                                                            harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "ozone_total_vertical_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "ozone_total_vertical_column_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_input_ozone_profile_apriori(void *user_data, harp_array data)
+static int read_input_ozone_profile_apriori(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "ozone_profile_apriori", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_levels, data);
+    return read_partial_dataset(info->input_data_cursor, "ozone_profile_apriori", index_offset * info->num_levels,
+                                index_length * info->num_levels, data);
 }
 
-static int read_input_ozone_profile_apriori_uncertainty(void *user_data, harp_array data)
+static int read_input_ozone_profile_apriori_uncertainty(void *user_data, long index_offset, long index_length,
+                                                        harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "ozone_profile_apriori_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_levels, data);
+    return read_partial_dataset(info->input_data_cursor, "ozone_profile_apriori_precision",
+                                index_offset * info->num_levels, index_length * info->num_levels, data);
 }
 
 static int read_input_ozone_profile_apriori_covariance(void *user_data, harp_array data)
@@ -1457,7 +1491,7 @@ static int read_input_ozone_profile_apriori_covariance(void *user_data, harp_arr
                        num_elements * num_levels * sizeof(float), __FILE__, __LINE__);
         return -1;
     }
-    if (read_input_altitude(user_data, altitude) != 0)
+    if (read_input_altitude(user_data, 0, num_elements, altitude) != 0)
     {
         free(altitude.float_data);
         return -1;
@@ -1471,7 +1505,7 @@ static int read_input_ozone_profile_apriori_covariance(void *user_data, harp_arr
         free(altitude.float_data);
         return -1;
     }
-    if (read_input_ozone_profile_apriori_uncertainty(user_data, stddev) != 0)
+    if (read_input_ozone_profile_apriori_uncertainty(user_data, 0, num_elements, stddev) != 0)
     {
         free(altitude.float_data);
         free(stddev.float_data);
@@ -1512,20 +1546,19 @@ static int read_input_ozone_profile_apriori_covariance(void *user_data, harp_arr
     return 0;
 }
 
-static int read_input_pressure(void *user_data, harp_array data)
+static int read_input_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "pressure", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_levels, data);
+    return read_partial_dataset(info->input_data_cursor, "pressure", index_offset * info->num_levels,
+                                index_length * info->num_levels, data);
 }
 
-static int read_input_pressure_at_tropopause(void *user_data, harp_array data)
+static int read_input_pressure_at_tropopause(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "pressure_at_tropopause", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "pressure_at_tropopause", index_offset, index_length, data);
 }
 
 static int read_input_pressure_bounds(void *user_data, harp_array data)
@@ -1604,60 +1637,57 @@ static int read_input_pressure_bounds(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_input_surface_albedo(void *user_data, harp_array data)
+static int read_input_surface_albedo(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "surface_albedo", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "surface_albedo", index_offset, index_length, data);
 }
 
-static int read_input_surface_albedo_assumed(void *user_data, harp_array data)
+static int read_input_surface_albedo_assumed(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "surface_albedo_assumed", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "surface_albedo_assumed", index_offset, index_length, data);
 }
 
-static int read_input_surface_albedo_nitrogendioxide_window(void *user_data, harp_array data)
+static int read_input_surface_albedo_nitrogendioxide_window(void *user_data, long index_offset, long index_length,
+                                                            harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "surface_albedo_nitrogendioxide_window", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "surface_albedo_nitrogendioxide_window", index_offset,
+                                index_length, data);
 }
 
-static int read_input_surface_altitude(void *user_data, harp_array data)
+static int read_input_surface_altitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "surface_altitude", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "surface_altitude", index_offset, index_length, data);
 }
 
-static int read_input_surface_altitude_precision(void *user_data, harp_array data)
+static int read_input_surface_altitude_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "surface_altitude_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "surface_altitude_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_input_surface_pressure(void *user_data, harp_array data)
+static int read_input_surface_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "surface_pressure", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->input_data_cursor, "surface_pressure", index_offset, index_length, data);
 }
 
-static int read_input_temperature(void *user_data, harp_array data)
+static int read_input_temperature(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->input_data_cursor, "temperature", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_levels, data);
+    return read_partial_dataset(info->input_data_cursor, "temperature", index_offset * info->num_levels,
+                                index_length * info->num_levels, data);
 }
 
 static int read_input_tm5_pressure(void *user_data, harp_array data)
@@ -1731,20 +1761,19 @@ static int read_input_tm5_pressure(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_product_air_mass_factor_total(void *user_data, harp_array data)
+static int read_product_air_mass_factor_total(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "air_mass_factor_total", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "air_mass_factor_total", index_offset, index_length, data);
 }
 
-static int read_product_air_mass_factor_troposphere(void *user_data, harp_array data)
+static int read_product_air_mass_factor_troposphere(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "air_mass_factor_troposphere", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "air_mass_factor_troposphere", index_offset, index_length, data);
 }
 
 static int read_product_aerosol_index(void *user_data, harp_array data)
@@ -1791,236 +1820,229 @@ static int read_product_aerosol_index_precision(void *user_data, harp_array data
                         data);
 }
 
-static int read_product_aerosol_mid_height(void *user_data, harp_array data)
+static int read_product_aerosol_mid_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "aerosol_mid_height", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "aerosol_mid_height", index_offset, index_length, data);
 }
 
-static int read_product_aerosol_mid_height_precision(void *user_data, harp_array data)
+static int read_product_aerosol_mid_height_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "aerosol_mid_height_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "aerosol_mid_height_precision", index_offset, index_length, data);
 }
 
-static int read_product_aerosol_mid_pressure(void *user_data, harp_array data)
+static int read_product_aerosol_mid_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "aerosol_mid_pressure", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "aerosol_mid_pressure", index_offset, index_length, data);
 }
 
-static int read_product_aerosol_mid_pressure_precision(void *user_data, harp_array data)
+static int read_product_aerosol_mid_pressure_precision(void *user_data, long index_offset, long index_length,
+                                                       harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "aerosol_mid_pressure_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "aerosol_mid_pressure_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_product_averaging_kernel(void *user_data, harp_array data)
+static int read_product_averaging_kernel(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "averaging_kernel", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_layers, data);
+    return read_partial_dataset(info->product_cursor, "averaging_kernel", index_offset * info->num_layers,
+                                index_length * info->num_layers, data);
 }
 
-static int read_product_carbonmonoxide_total_column(void *user_data, harp_array data)
+static int read_product_carbonmonoxide_total_column(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "carbonmonoxide_total_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "carbonmonoxide_total_column", index_offset, index_length, data);
 }
 
-static int read_product_carbonmonoxide_total_column_precision(void *user_data, harp_array data)
+static int read_product_carbonmonoxide_total_column_precision(void *user_data, long index_offset, long index_length,
+                                                              harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "carbonmonoxide_total_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "carbonmonoxide_total_column_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_product_cloud_albedo_crb(void *user_data, harp_array data)
+static int read_product_cloud_albedo_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_albedo_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_albedo_crb", index_offset, index_length, data);
 }
 
-static int read_product_cloud_albedo_crb_precision(void *user_data, harp_array data)
+static int read_product_cloud_albedo_crb_precision(void *user_data, long index_offset, long index_length,
+                                                   harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_albedo_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_albedo_crb_precision", index_offset, index_length, data);
 }
 
-static int read_product_cloud_base_height(void *user_data, harp_array data)
+static int read_product_cloud_base_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_base_height", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_base_height", index_offset, index_length, data);
 }
 
-static int read_product_cloud_base_height_precision(void *user_data, harp_array data)
+static int read_product_cloud_base_height_precision(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_base_height_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_base_height_precision", index_offset, index_length, data);
 }
 
-static int read_product_cloud_base_pressure(void *user_data, harp_array data)
+static int read_product_cloud_base_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_base_pressure", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_base_pressure", index_offset, index_length, data);
 }
 
-static int read_product_cloud_base_pressure_precision(void *user_data, harp_array data)
+static int read_product_cloud_base_pressure_precision(void *user_data, long index_offset, long index_length,
+                                                      harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_base_pressure_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_base_pressure_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_product_cloud_fraction(void *user_data, harp_array data)
+static int read_product_cloud_fraction(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_fraction", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_fraction", index_offset, index_length, data);
 }
 
-static int read_product_cloud_fraction_precision(void *user_data, harp_array data)
+static int read_product_cloud_fraction_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_fraction_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_fraction_precision", index_offset, index_length, data);
 }
 
-static int read_product_cloud_fraction_crb(void *user_data, harp_array data)
+static int read_product_cloud_fraction_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_fraction_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_fraction_crb", index_offset, index_length, data);
 }
 
-static int read_product_cloud_fraction_crb_precision(void *user_data, harp_array data)
+static int read_product_cloud_fraction_crb_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_fraction_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_fraction_crb_precision", index_offset, index_length, data);
 }
 
-static int read_product_cloud_height_crb(void *user_data, harp_array data)
+static int read_product_cloud_height_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_height_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_height_crb", index_offset, index_length, data);
 }
 
-static int read_product_cloud_height_crb_precision(void *user_data, harp_array data)
+static int read_product_cloud_height_crb_precision(void *user_data, long index_offset, long index_length,
+                                                   harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_height_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_height_crb_precision", index_offset, index_length, data);
 }
 
-static int read_product_cloud_optical_thickness(void *user_data, harp_array data)
+static int read_product_cloud_optical_thickness(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_optical_thickness", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_optical_thickness", index_offset, index_length, data);
 }
 
-static int read_product_cloud_optical_thickness_precision(void *user_data, harp_array data)
+static int read_product_cloud_optical_thickness_precision(void *user_data, long index_offset, long index_length,
+                                                          harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_optical_thickness_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_optical_thickness_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_product_cloud_pressure_crb(void *user_data, harp_array data)
+static int read_product_cloud_pressure_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_pressure_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_pressure_crb", index_offset, index_length, data);
 }
 
-static int read_product_cloud_pressure_crb_precision(void *user_data, harp_array data)
+static int read_product_cloud_pressure_crb_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_pressure_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_pressure_crb_precision", index_offset, index_length, data);
 }
 
-static int read_product_cloud_top_height(void *user_data, harp_array data)
+static int read_product_cloud_top_height(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_top_height", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_top_height", index_offset, index_length, data);
 }
 
-static int read_product_cloud_top_height_precision(void *user_data, harp_array data)
+static int read_product_cloud_top_height_precision(void *user_data, long index_offset, long index_length,
+                                                   harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_top_height_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_top_height_precision", index_offset, index_length, data);
 }
 
-static int read_product_cloud_top_pressure(void *user_data, harp_array data)
+static int read_product_cloud_top_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_top_pressure", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_top_pressure", index_offset, index_length, data);
 }
 
-static int read_product_cloud_top_pressure_precision(void *user_data, harp_array data)
+static int read_product_cloud_top_pressure_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "cloud_top_pressure_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "cloud_top_pressure_precision", index_offset, index_length, data);
 }
 
-static int read_product_formaldehyde_tropospheric_vertical_column(void *user_data, harp_array data)
+static int read_product_formaldehyde_tropospheric_vertical_column(void *user_data, long index_offset, long index_length,
+                                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "formaldehyde_tropospheric_vertical_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "formaldehyde_tropospheric_vertical_column", index_offset,
+                                index_length, data);
 }
 
-static int read_product_formaldehyde_tropospheric_vertical_column_precision(void *user_data, harp_array data)
+static int read_product_formaldehyde_tropospheric_vertical_column_precision(void *user_data, long index_offset,
+                                                                            long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "formaldehyde_tropospheric_vertical_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "formaldehyde_tropospheric_vertical_column_precision",
+                                index_offset, index_length, data);
 }
 
 static int read_product_layer_inverted(void *user_data, harp_array data)
@@ -2084,92 +2106,96 @@ static int read_product_longitude(void *user_data, harp_array data)
                         data);
 }
 
-static int read_product_methane_mixing_ratio_precision(void *user_data, harp_array data)
+static int read_product_methane_mixing_ratio_precision(void *user_data, long index_offset, long index_length,
+                                                       harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "methane_mixing_ratio_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "methane_mixing_ratio_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_product_nitrogendioxide_tropospheric_column(void *user_data, harp_array data)
+static int read_product_nitrogendioxide_tropospheric_column(void *user_data, long index_offset, long index_length,
+                                                            harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "nitrogendioxide_tropospheric_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "nitrogendioxide_tropospheric_column", index_offset, index_length,
+                                data);
 }
 
-static int read_product_nitrogendioxide_tropospheric_column_precision(void *user_data, harp_array data)
+static int read_product_nitrogendioxide_tropospheric_column_precision(void *user_data, long index_offset,
+                                                                      long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "nitrogendioxide_tropospheric_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "nitrogendioxide_tropospheric_column_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_product_ozone_profile(void *user_data, harp_array data)
+static int read_product_ozone_profile(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_profile", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_levels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_profile", index_offset * info->num_levels,
+                                index_length * info->num_levels, data);
 }
 
-static int read_product_ozone_profile_precision(void *user_data, harp_array data)
+static int read_product_ozone_profile_precision(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_profile_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_levels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_profile_precision", index_offset * info->num_levels,
+                                index_length * info->num_levels, data);
 }
 
-static int read_product_ozone_total_column(void *user_data, harp_array data)
+static int read_product_ozone_total_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_total_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_total_column", index_offset, index_length, data);
 }
 
-static int read_product_ozone_total_column_precision(void *user_data, harp_array data)
+static int read_product_ozone_total_column_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_total_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_total_column_precision", index_offset, index_length, data);
 }
 
-static int read_product_ozone_total_vertical_column(void *user_data, harp_array data)
+static int read_product_ozone_total_vertical_column(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_total_vertical_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_total_vertical_column", index_offset, index_length, data);
 }
 
-static int read_product_ozone_total_vertical_column_precision(void *user_data, harp_array data)
+static int read_product_ozone_total_vertical_column_precision(void *user_data, long index_offset, long index_length,
+                                                              harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_total_vertical_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_total_vertical_column_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_product_ozone_tropospheric_column(void *user_data, harp_array data)
+static int read_product_ozone_tropospheric_column(void *user_data, long index_offset, long index_length,
+                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_tropospheric_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_tropospheric_column", index_offset, index_length, data);
 }
 
-static int read_product_ozone_tropospheric_column_precision(void *user_data, harp_array data)
+static int read_product_ozone_tropospheric_column_precision(void *user_data, long index_offset, long index_length,
+                                                            harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->product_cursor, "ozone_tropospheric_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->product_cursor, "ozone_tropospheric_column_precision", index_offset, index_length,
+                                data);
 }
 
 static int read_product_qa_value(void *user_data, harp_array data)
@@ -2200,37 +2226,41 @@ static int read_results_aerosol_mid_altitude(void *user_data, harp_array data)
                         info->num_scanlines * info->num_pixels, data);
 }
 
-static int read_results_aerosol_optical_thickness(void *user_data, harp_array data)
+static int read_results_aerosol_optical_thickness(void *user_data, long index_offset, long index_length,
+                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "aerosol_optical_thickness", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "aerosol_optical_thickness", index_offset, index_length,
+                                data);
 }
 
-static int read_results_aerosol_optical_thickness_precision(void *user_data, harp_array data)
+static int read_results_aerosol_optical_thickness_precision(void *user_data, long index_offset, long index_length,
+                                                            harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "aerosol_optical_thickness_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "aerosol_optical_thickness_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_results_aerosol_optical_thickness_swir(void *user_data, harp_array data)
+static int read_results_aerosol_optical_thickness_swir(void *user_data, long index_offset, long index_length,
+                                                       harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "aerosol_optical_thickness_SWIR", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "aerosol_optical_thickness_SWIR", index_offset,
+                                index_length, data);
 }
 
 
-static int read_results_air_mass_factor_stratosphere(void *user_data, harp_array data)
+static int read_results_air_mass_factor_stratosphere(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "air_mass_factor_stratosphere", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "air_mass_factor_stratosphere", index_offset,
+                                index_length, data);
 }
 
 static int read_results_averaging_kernel_2d(void *user_data, harp_array data)
@@ -2241,52 +2271,52 @@ static int read_results_averaging_kernel_2d(void *user_data, harp_array data)
                         info->num_scanlines * info->num_pixels * info->num_levels * info->num_levels, data);
 }
 
-static int read_results_averaging_kernel_1d(void *user_data, harp_array data)
+static int read_results_averaging_kernel_1d(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "averaging_kernel", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_layers, data);
+    return read_partial_dataset(info->detailed_results_cursor, "averaging_kernel", index_offset * info->num_layers,
+                                index_length * info->num_layers, data);
 }
 
-static int read_results_cloud_albedo_crb(void *user_data, harp_array data)
+static int read_results_cloud_albedo_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_albedo_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_albedo_crb", index_offset, index_length, data);
 }
 
-static int read_results_cloud_albedo_crb_precision(void *user_data, harp_array data)
+static int read_results_cloud_albedo_crb_precision(void *user_data, long index_offset, long index_length,
+                                                   harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_albedo_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_albedo_crb_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_results_cloud_fraction_apriori(void *user_data, harp_array data)
+static int read_results_cloud_fraction_apriori(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_fraction_apriori", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_fraction_apriori", index_offset, index_length,
+                                data);
 }
 
-static int read_results_cloud_fraction_crb(void *user_data, harp_array data)
+static int read_results_cloud_fraction_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_fraction_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_fraction_crb", index_offset, index_length, data);
 }
 
-static int read_results_cloud_fraction_crb_precision(void *user_data, harp_array data)
+static int read_results_cloud_fraction_crb_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_fraction_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_fraction_crb_precision", index_offset,
+                                index_length, data);
 }
 
 static int read_results_cloud_fraction_nitrogendioxide_window(void *user_data, harp_array data)
@@ -2302,36 +2332,36 @@ static int read_results_cloud_fraction_nitrogendioxide_window(void *user_data, h
                         info->num_scanlines * info->num_pixels, data);
 }
 
-static int read_results_cloud_height_crb(void *user_data, harp_array data)
+static int read_results_cloud_height_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_height_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_height_crb", index_offset, index_length, data);
 }
 
-static int read_results_cloud_height_crb_precision(void *user_data, harp_array data)
+static int read_results_cloud_height_crb_precision(void *user_data, long index_offset, long index_length,
+                                                   harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_height_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_height_crb_precision", index_offset, index_length,
+                                data);
 }
 
-static int read_results_cloud_pressure_crb(void *user_data, harp_array data)
+static int read_results_cloud_pressure_crb(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_pressure_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_pressure_crb", index_offset, index_length, data);
 }
 
-static int read_results_cloud_pressure_crb_precision(void *user_data, harp_array data)
+static int read_results_cloud_pressure_crb_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "cloud_pressure_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "cloud_pressure_crb_precision", index_offset,
+                                index_length, data);
 }
 
 static int read_results_column_averaging_kernel_inverted(void *user_data, harp_array data)
@@ -2367,44 +2397,47 @@ static int read_results_column_averaging_kernel_inverted_scaled(void *user_data,
     return 0;
 }
 
-static int read_results_degrees_of_freedom(void *user_data, harp_array data)
+static int read_results_degrees_of_freedom(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "degrees_of_freedom", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "degrees_of_freedom", index_offset, index_length, data);
 }
 
-static int read_results_formaldehyde_slant_column_corrected(void *user_data, harp_array data)
+static int read_results_formaldehyde_slant_column_corrected(void *user_data, long index_offset, long index_length,
+                                                            harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "formaldehyde_slant_column_corrected", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "formaldehyde_slant_column_corrected", index_offset,
+                                index_length, data);
 }
 
-static int read_results_formaldehyde_slant_column_corrected_trueness(void *user_data, harp_array data)
+static int read_results_formaldehyde_slant_column_corrected_trueness(void *user_data, long index_offset,
+                                                                     long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "formaldehyde_slant_column_corrected_trueness", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "formaldehyde_slant_column_corrected_trueness",
+                                index_offset, index_length, data);
 }
 
-static int read_results_formaldehyde_profile_apriori(void *user_data, harp_array data)
+static int read_results_formaldehyde_profile_apriori(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "formaldehyde_profile_apriori", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_layers, data);
+    return read_partial_dataset(info->detailed_results_cursor, "formaldehyde_profile_apriori",
+                                index_offset * info->num_layers, index_length * info->num_layers, data);
 }
 
-static int read_results_formaldehyde_tropospheric_air_mass_factor(void *user_data, harp_array data)
+static int read_results_formaldehyde_tropospheric_air_mass_factor(void *user_data, long index_offset, long index_length,
+                                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "formaldehyde_tropospheric_air_mass_factor", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "formaldehyde_tropospheric_air_mass_factor",
+                                index_offset, index_length, data);
 }
 
 static int read_results_formaldehyde_tropospheric_air_mass_factor_precision(void *user_data, harp_array data)
@@ -2431,20 +2464,21 @@ static int read_results_formaldehyde_tropospheric_vertical_column_trueness(void
                         harp_type_float, info->num_scanlines * info->num_pixels, data);
 }
 
-static int read_results_height_scattering_layer(void *user_data, harp_array data)
+static int read_results_height_scattering_layer(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "height_scattering_layer", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "height_scattering_layer", index_offset, index_length,
+                                data);
 }
 
-static int read_results_nitrogendioxide_slant_column_density(void *user_data, harp_array data)
+static int read_results_nitrogendioxide_slant_column_density(void *user_data, long index_offset, long index_length,
+                                                             harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "nitrogendioxide_slant_column_density", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "nitrogendioxide_slant_column_density", index_offset,
+                                index_length, data);
 }
 
 static int read_results_nitrogendioxide_slant_column_density_precision(void *user_data, harp_array data)
@@ -2455,12 +2489,13 @@ static int read_results_nitrogendioxide_slant_column_density_precision(void *use
                         harp_type_float, info->num_scanlines * info->num_pixels, data);
 }
 
-static int read_results_nitrogendioxide_stratospheric_column(void *user_data, harp_array data)
+static int read_results_nitrogendioxide_stratospheric_column(void *user_data, long index_offset, long index_length,
+                                                             harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "nitrogendioxide_stratospheric_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "nitrogendioxide_stratospheric_column", index_offset,
+                                index_length, data);
 }
 
 static int read_results_nitrogendioxide_stratospheric_column_precision(void *user_data, harp_array data)
@@ -2471,28 +2506,31 @@ static int read_results_nitrogendioxide_stratospheric_column_precision(void *use
                         harp_type_float, info->num_scanlines * info->num_pixels, data);
 }
 
-static int read_results_ozone_effective_temperature(void *user_data, harp_array data)
+static int read_results_ozone_effective_temperature(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "ozone_effective_temperature", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "ozone_effective_temperature", index_offset,
+                                index_length, data);
 }
 
-static int read_results_ozone_total_air_mass_factor(void *user_data, harp_array data)
+static int read_results_ozone_total_air_mass_factor(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "ozone_total_air_mass_factor", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "ozone_total_air_mass_factor", index_offset,
+                                index_length, data);
 }
 
-static int read_results_ozone_total_air_mass_factor_trueness(void *user_data, harp_array data)
+static int read_results_ozone_total_air_mass_factor_trueness(void *user_data, long index_offset, long index_length,
+                                                             harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "ozone_total_air_mass_factor_trueness", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "ozone_total_air_mass_factor_trueness", index_offset,
+                                index_length, data);
 }
 
 static int read_results_ozone_profile_error_covariance_matrix(void *user_data, harp_array data)
@@ -2503,12 +2541,13 @@ static int read_results_ozone_profile_error_covariance_matrix(void *user_data, h
                         info->num_scanlines * info->num_pixels * info->num_levels * info->num_levels, data);
 }
 
-static int read_results_ozone_slant_column_ring_corrected(void *user_data, harp_array data)
+static int read_results_ozone_slant_column_ring_corrected(void *user_data, long index_offset, long index_length,
+                                                          harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "ozone_slant_column_ring_corrected", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "ozone_slant_column_ring_corrected", index_offset,
+                                index_length, data);
 }
 
 static int read_results_pressure_levels_as_bounds_inverted(void *user_data, harp_array data)
@@ -2592,84 +2631,91 @@ static int read_results_processing_quality_flags(void *user_data, harp_array dat
     return 0;
 }
 
-static int read_results_scattering_optical_thickness_SWIR(void *user_data, harp_array data)
+static int read_results_scattering_optical_thickness_SWIR(void *user_data, long index_offset, long index_length,
+                                                          harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "scattering_optical_thickness_SWIR", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "scattering_optical_thickness_SWIR", index_offset,
+                                index_length, data);
 }
 
-static int read_results_shannon_information_content(void *user_data, harp_array data)
+static int read_results_shannon_information_content(void *user_data, long index_offset, long index_length,
+                                                    harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "shannon_information_content", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "shannon_information_content", index_offset,
+                                index_length, data);
 }
 
-static int read_results_sulfurdioxide_profile_apriori(void *user_data, harp_array data)
+static int read_results_sulfurdioxide_profile_apriori(void *user_data, long index_offset, long index_length,
+                                                      harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "sulfurdioxide_profile_apriori", harp_type_float,
-                        info->num_scanlines * info->num_pixels * info->num_layers, data);
+    return read_partial_dataset(info->detailed_results_cursor, "sulfurdioxide_profile_apriori",
+                                index_offset * info->num_layers, index_length * info->num_layers, data);
 }
 
-static int read_results_sulfurdioxide_slant_column_corrected(void *user_data, harp_array data)
+static int read_results_sulfurdioxide_slant_column_corrected(void *user_data, long index_offset, long index_length,
+                                                             harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "sulfurdioxide_slant_column_corrected", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "sulfurdioxide_slant_column_corrected", index_offset,
+                                index_length, data);
 }
 
-static int read_results_surface_albedo_fitted(void *user_data, harp_array data)
+static int read_results_surface_albedo_fitted(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "surface_albedo_fitted", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "surface_albedo_fitted", index_offset, index_length,
+                                data);
 }
 
-static int read_results_surface_albedo_fitted_precision(void *user_data, harp_array data)
+static int read_results_surface_albedo_fitted_precision(void *user_data, long index_offset, long index_length,
+                                                        harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "surface_albedo_fitted_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "surface_albedo_fitted_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_results_surface_albedo_fitted_crb(void *user_data, harp_array data)
+static int read_results_surface_albedo_fitted_crb(void *user_data, long index_offset, long index_length,
+                                                  harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "surface_albedo_fitted_crb", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "surface_albedo_fitted_crb", index_offset, index_length,
+                                data);
 }
 
-static int read_results_surface_albedo_fitted_crb_precision(void *user_data, harp_array data)
+static int read_results_surface_albedo_fitted_crb_precision(void *user_data, long index_offset, long index_length,
+                                                            harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "surface_albedo_fitted_crb_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "surface_albedo_fitted_crb_precision", index_offset,
+                                index_length, data);
 }
 
-static int read_results_water_total_column(void *user_data, harp_array data)
+static int read_results_water_total_column(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "water_total_column", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "water_total_column", index_offset, index_length, data);
 }
 
-static int read_results_water_total_column_precision(void *user_data, harp_array data)
+static int read_results_water_total_column_precision(void *user_data, long index_offset, long index_length,
+                                                     harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_dataset(info->detailed_results_cursor, "water_total_column_precision", harp_type_float,
-                        info->num_scanlines * info->num_pixels, data);
+    return read_partial_dataset(info->detailed_results_cursor, "water_total_column_precision", index_offset,
+                                index_length, data);
 }
 
 static int read_co_surface_pressure(void *user_data, harp_array data)
@@ -3148,7 +3194,7 @@ static int read_no2_column_stratospheric_avk(void *user_data, harp_array data)
         free(layer_data.int32_data);
         return -1;
     }
-    if (read_product_air_mass_factor_total(user_data, amf_data) != 0)
+    if (read_product_air_mass_factor_total(user_data, 0, info->num_scanlines * info->num_pixels, amf_data) != 0)
     {
         free(amf_data.float_data);
         free(layer_data.int32_data);
@@ -3177,7 +3223,7 @@ static int read_no2_column_stratospheric_avk(void *user_data, harp_array data)
     }
     free(layer_data.int32_data);
 
-    if (read_results_air_mass_factor_stratosphere(user_data, amf_data) != 0)
+    if (read_results_air_mass_factor_stratosphere(user_data, 0, info->num_scanlines * info->num_pixels, amf_data) != 0)
     {
         free(amf_data.float_data);
         return -1;
@@ -3229,7 +3275,7 @@ static int read_no2_column_tropospheric_avk(void *user_data, harp_array data)
         free(layer_data.int32_data);
         return -1;
     }
-    if (read_product_air_mass_factor_total(user_data, amf_data) != 0)
+    if (read_product_air_mass_factor_total(user_data, 0, info->num_scanlines * info->num_pixels, amf_data) != 0)
     {
         free(amf_data.float_data);
         free(layer_data.int32_data);
@@ -3258,7 +3304,7 @@ static int read_no2_column_tropospheric_avk(void *user_data, harp_array data)
     }
     free(layer_data.int32_data);
 
-    if (read_product_air_mass_factor_troposphere(user_data, amf_data) != 0)
+    if (read_product_air_mass_factor_troposphere(user_data, 0, info->num_scanlines * info->num_pixels, amf_data) != 0)
     {
         free(amf_data.float_data);
         return -1;
@@ -3950,20 +3996,22 @@ static void register_additional_geolocation_variables(harp_product_definition *p
 
     /* latitude_bounds */
     description = "latitudes of the ground pixel corners (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "latitude_bounds",
-                                                                     harp_type_float, 2, bounds_dimension_type,
-                                                                     bounds_dimension, description, "degree_north",
-                                                                     NULL, read_geolocation_latitude_bounds);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude_bounds",
+                                                                      harp_type_float, 2, bounds_dimension_type,
+                                                                      bounds_dimension, description, "degree_north",
+                                                                      NULL, get_optimal_range_length,
+                                                                      read_geolocation_latitude_bounds);
     harp_variable_definition_set_valid_range_float(variable_definition, -90.0f, 90.0f);
     path = "/PRODUCT/SUPPORT_DATA/GEOLOCATIONS/latitude_bounds[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* longitude_bounds */
     description = "longitudes of the ground pixel corners (WGS84)";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "longitude_bounds",
-                                                                     harp_type_float, 2, bounds_dimension_type,
-                                                                     bounds_dimension, description, "degree_east",
-                                                                     NULL, read_geolocation_longitude_bounds);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude_bounds",
+                                                                      harp_type_float, 2, bounds_dimension_type,
+                                                                      bounds_dimension, description, "degree_east",
+                                                                      NULL, get_optimal_range_length,
+                                                                      read_geolocation_longitude_bounds);
     harp_variable_definition_set_valid_range_float(variable_definition, -180.0f, 180.0f);
     path = "/PRODUCT/SUPPORT_DATA/GEOLOCATIONS/longitude_bounds[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -4003,20 +4051,22 @@ static void register_additional_geolocation_variables(harp_product_definition *p
 
     /* solar_zenith_angle */
     description = "zenith angle of the Sun at the ground pixel location (WGS84); angle measured away from the vertical";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "solar_zenith_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_geolocation_solar_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_zenith_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_geolocation_solar_zenith_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, 0.0f, 180.0f);
     path = "/PRODUCT/SUPPORT_DATA/GEOLOCATIONS/solar_zenith_angle[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* solar_azimuth_angle */
     description = "azimuth angle of the Sun at the ground pixel location (WGS84); angle measured East-of-North";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "solar_azimuth_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_geolocation_solar_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "solar_azimuth_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_geolocation_solar_azimuth_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, -180.0f, 180.0f);
     path = "/PRODUCT/SUPPORT_DATA/GEOLOCATIONS/solar_azimuth_angle[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -4024,20 +4074,22 @@ static void register_additional_geolocation_variables(harp_product_definition *p
     /* sensor_zenith_angle */
     description = "zenith angle of the satellite at the ground pixel location (WGS84); angle measured away from the "
         "vertical";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "sensor_zenith_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_geolocation_viewing_zenith_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_zenith_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_geolocation_viewing_zenith_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, 0.0f, 180.0f);
     path = "/PRODUCT/SUPPORT_DATA/GEOLOCATIONS/viewing_zenith_angle[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* sensor_azimuth_angle */
     description = "azimuth angle of the satellite at the ground pixel location (WGS84); angle measured East-of-North";
-    variable_definition = harp_ingestion_register_variable_full_read(product_definition, "sensor_azimuth_angle",
-                                                                     harp_type_float, 1, dimension_type, NULL,
-                                                                     description, "degree", NULL,
-                                                                     read_geolocation_viewing_azimuth_angle);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "sensor_azimuth_angle",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "degree", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_geolocation_viewing_azimuth_angle);
     harp_variable_definition_set_valid_range_float(variable_definition, -180.0f, 180.0f);
     path = "/PRODUCT/SUPPORT_DATA/GEOLOCATIONS/viewing_azimuth_angle[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
@@ -4052,19 +4104,21 @@ static void register_cloud_variables(harp_product_definition *product_definition
 
     /* cloud_albedo */
     description = "cloud albedo";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_cloud_albedo_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_albedo_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_albedo_crb";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_albedo_uncertainty */
     description = "uncertainty of the cloud albedo";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_cloud_albedo_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_albedo_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_albedo_crb_precision";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4092,37 +4146,37 @@ static void register_cloud_variables(harp_product_definition *product_definition
 
     /* cloud_altitude */
     description = "cloud altitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_altitude", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "km", NULL,
-                                                   read_input_cloud_height_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_altitude",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "km", NULL, get_optimal_range_length,
+                                                                      read_input_cloud_height_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_height_crb";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_altitude_uncertainty */
     description = "uncertainty of the cloud altitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_altitude_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "km", NULL,
-                                                   read_input_cloud_height_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_altitude_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "km", NULL, get_optimal_range_length,
+                                                                      read_input_cloud_height_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_height_crb_precision";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "cloud pressure";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_input_cloud_pressure_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_input_cloud_pressure_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_pressure_crb";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "uncertainty of the cloud pressure";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_input_cloud_pressure_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_input_cloud_pressure_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_pressure_crb_precision";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -4136,19 +4190,20 @@ static void register_surface_variables(harp_product_definition *product_definiti
 
     /* surface_altitude */
     description = "surface altitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_altitude", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_input_surface_altitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_altitude",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_input_surface_altitude);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_altitude[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_altitude_uncertainty */
     description = "surface altitude precision";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_altitude_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "m", NULL,
-                                                   read_input_surface_altitude_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "surface_altitude_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "m", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_surface_altitude_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_altitude_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4157,10 +4212,11 @@ static void register_surface_variables(harp_product_definition *product_definiti
     {
         description = "surface pressure";
         path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_pressure[]";
-        variable_definition =
-            harp_ingestion_register_variable_full_read(product_definition, "surface_pressure", harp_type_float, 1,
-                                                       dimension_type, NULL, description, "Pa", NULL,
-                                                       read_input_surface_pressure);
+        variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_pressure",
+                                                                          harp_type_float, 1, dimension_type, NULL,
+                                                                          description, "Pa", NULL,
+                                                                          get_optimal_range_length,
+                                                                          read_input_surface_pressure);
         harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
     }
 }
@@ -4270,19 +4326,19 @@ static void register_aer_lh_product(void)
 
     /* aerosol_height */
     description = "altitude of center of aerosol layer";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "aerosol_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_product_aerosol_mid_height);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "aerosol_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_aerosol_mid_height);
     path = "/PRODUCT/aerosol_mid_height[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* aerosol_height_uncertainty */
     description = "uncertainty of altitude of center of aerosol layer";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "aerosol_height_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_product_aerosol_mid_height_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "aerosol_height_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_aerosol_mid_height_precision);
     path = "/PRODUCT/aerosol_mid_height_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4296,37 +4352,39 @@ static void register_aer_lh_product(void)
 
     /* aerosol_pressure */
     description = "pressure at center of aerosol layer";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "aerosol_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_aerosol_mid_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "aerosol_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_product_aerosol_mid_pressure);
     path = "/PRODUCT/aerosol_mid_pressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* aerosol_pressure_uncertainty */
     description = "uncertainty of pressure at center of aerosol layer";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "aerosol_pressure_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_aerosol_mid_pressure_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "aerosol_pressure_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "Pa", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_aerosol_mid_pressure_precision);
     path = "/PRODUCT/aerosol_mid_pressure_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* aerosol_optical_depth */
     description = "aerosol optical thickness";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "aerosol_optical_depth", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_results_aerosol_optical_thickness);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "aerosol_optical_depth",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_results_aerosol_optical_thickness);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/aerosol_optical_thickness[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* aerosol_optical_depth_uncertainty */
     description = "uncertainty of the aerosol optical thickness";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "aerosol_optical_depth_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "m", NULL,
-                                                   read_results_aerosol_optical_thickness_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "aerosol_optical_depth_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_results_aerosol_optical_thickness_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/aerosol_optical_thickness_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4400,10 +4458,11 @@ static void register_ch4_product(void)
     /* CH4_column_volume_mixing_ratio_dry_air_uncertainty */
     description = "uncertainty of the column averaged dry air mixing ratio of methane (1 sigma error)";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition,
-                                                   "CH4_column_volume_mixing_ratio_dry_air_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "ppbv", NULL,
-                                                   read_product_methane_mixing_ratio_precision);
+        harp_ingestion_register_variable_range_read(product_definition,
+                                                    "CH4_column_volume_mixing_ratio_dry_air_uncertainty",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "ppbv", NULL,
+                                                    get_optimal_range_length,
+                                                    read_product_methane_mixing_ratio_precision);
     path = "/PRODUCT/methane_mixing_ratio_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4449,28 +4508,31 @@ static void register_ch4_product(void)
 
     /* H2O_column_number_density */
     description = "H2O total column density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "H2O_column_number_density", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "mol/m^2", NULL,
-                                                   read_results_water_total_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "H2O_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_water_total_column);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/water_total_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* H2O_column_number_density_uncertainty */
     description = "uncertainty of the H2O column density (standard error)";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "H2O_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_results_water_total_column_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "H2O_column_number_density_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_water_total_column_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/water_total_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction */
     description = "cloud fraction from VIIRS data in the SWIR channel for the instantaneous field of view";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "",
-                                                   NULL, read_input_cloud_fraction_viirs_swir);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "", NULL, get_optimal_range_length,
+                                                                      read_input_cloud_fraction_viirs_swir);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_fraction_VIIRS_SWIR_IFOV[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4487,10 +4549,10 @@ static void register_ch4_product(void)
 
     /* aerosol_optical_depth */
     description = "aerosol optical thicknesss in the SWIR band";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "aerosol_optical_depth",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "",
-                                                   NULL, read_results_aerosol_optical_thickness_swir);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "aerosol_optical_depth",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "", NULL, get_optimal_range_length,
+                                                                      read_results_aerosol_optical_thickness_swir);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/aerosol_optical_thickness_SWIR[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -4558,19 +4620,21 @@ static void register_co_product(void)
 
     /* CO_column_number_density */
     description = "vertically integrated CO column density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "CO_column_number_density", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "mol/m^2", NULL,
-                                                   read_product_carbonmonoxide_total_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "CO_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_carbonmonoxide_total_column);
     path = "/PRODUCT/carbonmonoxide_total_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* CO_column_number_density_uncertainty */
     description = "uncertainty of the vertically integrated CO column density (standard error)";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "CO_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_product_carbonmonoxide_total_column_precision);
+        harp_ingestion_register_variable_range_read(product_definition, "CO_column_number_density_uncertainty",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_product_carbonmonoxide_total_column_precision);
     path = "/PRODUCT/carbonmonoxide_total_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4606,37 +4670,40 @@ static void register_co_product(void)
 
     /* H2O_column_number_density */
     description = "H2O total column density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "H2O_column_number_density", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "mol/m^2", NULL,
-                                                   read_results_water_total_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "H2O_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_water_total_column);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/water_total_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* H2O_column_number_density_uncertainty */
     description = "uncertainty of the H2O column density (standard error)";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "H2O_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_results_water_total_column_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "H2O_column_number_density_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_water_total_column_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/water_total_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_height */
     description = "Scattering layer height";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_results_height_scattering_layer);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_results_height_scattering_layer);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/height_scattering_layer[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_optical_depth */
     description = "Scattering optical thickness SWIR";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_optical_depth", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "", NULL,
-                                                   read_results_scattering_optical_thickness_SWIR);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_optical_depth",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "", NULL, get_optimal_range_length,
+                                                                      read_results_scattering_optical_thickness_SWIR);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/scattering_optical_thickness_SWIR[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -4676,20 +4743,21 @@ static void register_hcho_product(void)
     /* tropospheric_HCHO_column_number_density */
     description = "tropospheric HCHO column number density";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "tropospheric_HCHO_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_product_formaldehyde_tropospheric_vertical_column);
+        harp_ingestion_register_variable_range_read(product_definition, "tropospheric_HCHO_column_number_density",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_product_formaldehyde_tropospheric_vertical_column);
     path = "/PRODUCT/formaldehyde_tropospheric_vertical_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_HCHO_column_number_density_uncertainty_random */
     description = "uncertainty of the tropospheric HCHO column number density due to random effects";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition,
-                                                   "tropospheric_HCHO_column_number_density_uncertainty_random",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL,
-                                                   read_product_formaldehyde_tropospheric_vertical_column_precision);
+        harp_ingestion_register_variable_range_read(product_definition,
+                                                    "tropospheric_HCHO_column_number_density_uncertainty_random",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_product_formaldehyde_tropospheric_vertical_column_precision);
     path = "/PRODUCT/formaldehyde_tropospheric_vertical_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4715,19 +4783,23 @@ static void register_hcho_product(void)
 
     /* HCHO_column_number_density_avk */
     description = "averaging kernel for the total HCHO column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "HCHO_column_number_density_avk",
-                                                   harp_type_float, 2, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, NULL, read_results_averaging_kernel_1d);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "HCHO_column_number_density_avk", harp_type_float,
+                                                                      2, dimension_type, NULL, description,
+                                                                      HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_averaging_kernel_1d);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/averaging_kernel[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* HCHO_volume_mixing_ratio_dry_air_apriori */
     description = "HCHO apriori profile in volume mixing ratios (with regard to dry air)";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "HCHO_volume_mixing_ratio_dry_air_apriori",
-                                                   harp_type_float, 2, dimension_type, NULL, description, "ppv",
-                                                   exclude_hcho_apriori, read_results_formaldehyde_profile_apriori);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "HCHO_volume_mixing_ratio_dry_air_apriori",
+                                                                      harp_type_float, 2, dimension_type, NULL,
+                                                                      description, "ppv", exclude_hcho_apriori,
+                                                                      get_optimal_range_length,
+                                                                      read_results_formaldehyde_profile_apriori);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/formaldehyde_profile_apriori[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI or processor version >= 01.00.00", path,
                                          NULL);
@@ -4735,10 +4807,10 @@ static void register_hcho_product(void)
     /* tropospheric_HCHO_column_number_density_amf */
     description = "tropospheric air mass factor";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "tropospheric_HCHO_column_number_density_amf",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_formaldehyde_tropospheric_air_mass_factor);
+        harp_ingestion_register_variable_range_read(product_definition, "tropospheric_HCHO_column_number_density_amf",
+                                                    harp_type_float, 1, dimension_type, NULL, description,
+                                                    HARP_UNIT_DIMENSIONLESS, NULL, get_optimal_range_length,
+                                                    read_results_formaldehyde_tropospheric_air_mass_factor);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/formaldehyde_tropospheric_air_mass_factor[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4766,28 +4838,32 @@ static void register_hcho_product(void)
 
     /* HCHO_slant_column_number_density */
     description = "HCHO slant column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "HCHO_slant_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_results_formaldehyde_slant_column_corrected);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "HCHO_slant_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_formaldehyde_slant_column_corrected);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/formaldehyde_slant_column_corrected[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* HCHO_slant_column_number_density_uncertainty */
     description = "uncertainty of the HCHO slant column number density";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "HCHO_slant_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_results_formaldehyde_slant_column_corrected_trueness);
+        harp_ingestion_register_variable_range_read(product_definition, "HCHO_slant_column_number_density_uncertainty",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_results_formaldehyde_slant_column_corrected_trueness);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/formaldehyde_slant_column_corrected_trueness[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* absorbing_aerosol_index */
     description = "aerosol index";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "absorbing_aerosol_index", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS,
-                                                   exclude_nrti, read_input_aerosol_index_340_380);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "absorbing_aerosol_index",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS,
+                                                                      exclude_nrti, get_optimal_range_length,
+                                                                      read_input_aerosol_index_340_380);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/aerosol_index_340_380";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
@@ -4795,10 +4871,11 @@ static void register_hcho_product(void)
 
     /* surface_albedo */
     description = "surface albedo";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_surface_albedo);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_surface_albedo);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_albedo";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4843,19 +4920,21 @@ static void register_o3_product(void)
 
     /* O3_column_number_density */
     description = "O3 column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "mol/m^2", NULL,
-                                                   read_product_ozone_total_vertical_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_ozone_total_vertical_column);
     path = "/PRODUCT/ozone_total_vertical_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_column_number_density_uncertainty */
     description = "uncertainty of the O3 column number density";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_product_ozone_total_vertical_column_precision);
+        harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density_uncertainty",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_product_ozone_total_vertical_column_precision);
     path = "/PRODUCT/ozone_total_vertical_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -4893,94 +4972,104 @@ static void register_o3_product(void)
 
     /* O3_column_number_density_amf */
     description = "O3 column number density total air mass factor";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density_amf", harp_type_float,
-                                                   1, dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS,
-                                                   exclude_non_nrti, read_results_ozone_total_air_mass_factor);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_column_number_density_amf", harp_type_float,
+                                                                      1, dimension_type, NULL, description,
+                                                                      HARP_UNIT_DIMENSIONLESS, exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_results_ozone_total_air_mass_factor);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/ozone_total_air_mass_factor[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* O3_column_number_density_amf_uncertainty */
     description = "uncertainty of the O3 column number density total air mass factor";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density_amf_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, exclude_non_nrti,
-                                                   read_results_ozone_total_air_mass_factor_trueness);
+        harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density_amf_uncertainty",
+                                                    harp_type_float, 1, dimension_type, NULL, description,
+                                                    HARP_UNIT_DIMENSIONLESS, exclude_non_nrti, get_optimal_range_length,
+                                                    read_results_ozone_total_air_mass_factor_trueness);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/ozone_total_air_mass_factor_trueness[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* O3_column_number_density_dfs */
     description = "degrees of freedom of the O3 column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density_dfs",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, exclude_nrti,
-                                                   read_results_degrees_of_freedom);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_column_number_density_dfs", harp_type_float,
+                                                                      1, dimension_type, NULL, description,
+                                                                      HARP_UNIT_DIMENSIONLESS, exclude_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_results_degrees_of_freedom);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/degrees_of_freedom[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* O3_column_number_density_sic */
     description = "Shannon information content of the O3 column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density_sic",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, exclude_nrti,
-                                                   read_results_shannon_information_content);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_column_number_density_sic", harp_type_float,
+                                                                      1, dimension_type, NULL, description,
+                                                                      HARP_UNIT_DIMENSIONLESS, exclude_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_results_shannon_information_content);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/shannon_information_content[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* O3_slant_column_number_density */
     description = "O3 ring corrected slant column number density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_slant_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   exclude_non_nrti, read_results_ozone_slant_column_ring_corrected);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_slant_column_number_density", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "mol/m^2",
+                                                                      exclude_non_nrti, get_optimal_range_length,
+                                                                      read_results_ozone_slant_column_ring_corrected);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/ozone_slant_column_ring_corrected[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* O3_effective_temperature */
     description = "ozone cross section effective temperature";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_effective_temperature",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "K",
-                                                   NULL, read_results_ozone_effective_temperature);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_effective_temperature",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "K", NULL, get_optimal_range_length,
+                                                                      read_results_ozone_effective_temperature);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/ozone_effective_temperature[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_base_height */
     description = "cloud base height calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", exclude_non_nrti,
-                                                   read_input_cloud_base_height);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_base_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_base_height);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_base_height[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_base_height_uncertainty */
     description = "error of the cloud base height calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_height_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "m", exclude_non_nrti,
-                                                   read_input_cloud_base_height_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_base_height_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "m",
+                                                                      exclude_non_nrti, get_optimal_range_length,
+                                                                      read_input_cloud_base_height_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_base_height_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_base_pressure */
     description = "cloud base pressure calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", exclude_non_nrti,
-                                                   read_input_cloud_base_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_base_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_base_pressure);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_base_pressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_base_pressure_uncertainty */
     description = "error of the cloud base pressure calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_pressure_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "Pa",
-                                                   exclude_non_nrti, read_input_cloud_base_pressure_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_base_pressure_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_base_pressure_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_base_pressure_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
@@ -5008,120 +5097,133 @@ static void register_o3_product(void)
 
     /* cloud_optical_depth */
     description = "retrieved cloud optical depth using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_optical_depth", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", exclude_non_nrti,
-                                                   read_input_cloud_optical_thickness);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_optical_depth",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_optical_thickness);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_optical_thickness[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_optical_depth_uncertainty */
     description = "uncertainty of the retrieved cloud optical depth using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_optical_depth_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "m",
-                                                   exclude_non_nrti, read_input_cloud_optical_thickness_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_optical_depth_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_optical_thickness_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_optical_thickness_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_top_pressure */
     description = "retrieved atmospheric pressure at the level of cloud top using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", exclude_non_nrti,
-                                                   read_input_cloud_top_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_top_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_top_pressure);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_top_pressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_top_pressure_uncertainty */
     description = "uncertainty of the retrieved atmospheric pressure at the level of cloud top using the OCRA/ROCINN "
         "CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_pressure_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "Pa",
-                                                   exclude_non_nrti, read_input_cloud_top_pressure_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_top_pressure_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "Pa",
+                                                                      exclude_non_nrti, get_optimal_range_length,
+                                                                      read_input_cloud_top_pressure_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_top_pressure_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_top_height */
     description = "retrieved altitude of the cloud top using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", exclude_non_nrti,
-                                                   read_input_cloud_top_height);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_top_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", exclude_non_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_top_height);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_top_height[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_top_height_uncertainty */
     description = "uncertainty of the retrieved altitude of the cloud top using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_height_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "m", exclude_non_nrti,
-                                                   read_input_cloud_top_height_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_top_height_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "m",
+                                                                      exclude_non_nrti, get_optimal_range_length,
+                                                                      read_input_cloud_top_height_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_top_height_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "NRTI", path, NULL);
 
     /* cloud_albedo */
     description = "albedo of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS,
-                                                   exclude_nrti, read_input_cloud_albedo_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS,
+                                                                      exclude_nrti, get_optimal_range_length,
+                                                                      read_input_cloud_albedo_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_albedo_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* cloud_albedo_uncertainty */
     description = "uncertainty of the albedo of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, exclude_nrti,
-                                                   read_input_cloud_albedo_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS,
+                                                                      exclude_nrti, get_optimal_range_length,
+                                                                      read_input_cloud_albedo_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_albedo_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* cloud_height */
     description = "retrieved altitude at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", exclude_nrti,
-                                                   read_input_cloud_height_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", exclude_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_height_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_height_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* cloud_height_uncertainty */
     description = "error of the retrieved altitude at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_height_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "m", exclude_nrti,
-                                                   read_input_cloud_height_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_height_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", exclude_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_height_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_height_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* cloud_pressure */
     description = "retrieved atmospheric pressure at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", exclude_nrti,
-                                                   read_input_cloud_pressure_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", exclude_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_pressure_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_pressure_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "error of the retrieved atmospheric pressure at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "Pa",
-                                                   exclude_nrti, read_input_cloud_pressure_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", exclude_nrti,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_pressure_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_pressure_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
     /* surface_albedo */
     description = "surface albedo";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_surface_albedo);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_surface_albedo);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_albedo[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5138,35 +5240,38 @@ static void register_o3_profile_variables(harp_product_definition *product_defin
 
     /* pressure */
     description = "pressure";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "pressure", harp_type_float, 2, dimension_type,
-                                                   NULL, description, "Pa", NULL, read_input_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "pressure", harp_type_float,
+                                                                      2, dimension_type, NULL, description, "Pa", NULL,
+                                                                      get_optimal_range_length, read_input_pressure);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/pressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* altitude */
     description = "altitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "altitude", harp_type_float, 2, dimension_type,
-                                                   NULL, description, "m", NULL, read_input_altitude);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "altitude", harp_type_float,
+                                                                      2, dimension_type, NULL, description, "m", NULL,
+                                                                      get_optimal_range_length, read_input_altitude);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/altitude[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_volume_mixing_ratio */
     description = "O3 volume mixing ratio";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_volume_mixing_ratio", harp_type_float, 2,
-                                                   dimension_type, NULL, description, "ppmv", NULL,
-                                                   read_product_ozone_profile);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_volume_mixing_ratio",
+                                                                      harp_type_float, 2, dimension_type, NULL,
+                                                                      description, "ppmv", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_ozone_profile);
     path = "/PRODUCT/ozone_profile[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_volume_mixing_ratio_uncertainty */
     description = "uncertainty of the O3 volume mixing ratio";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_volume_mixing_ratio_uncertainty",
-                                                   harp_type_float, 2, dimension_type, NULL, description, "ppmv", NULL,
-                                                   read_product_ozone_profile_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_volume_mixing_ratio_uncertainty",
+                                                                      harp_type_float, 2, dimension_type, NULL,
+                                                                      description, "ppmv", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_ozone_profile_precision);
     path = "/PRODUCT/ozone_profile_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5189,10 +5294,11 @@ static void register_o3_profile_variables(harp_product_definition *product_defin
 
     /* O3_volume_mixing_ratio_apriori */
     description = "O3 volume mixing ratio apriori";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_volume_mixing_ratio_apriori",
-                                                   harp_type_float, 2, dimension_type, NULL, description, "ppmv", NULL,
-                                                   read_input_ozone_profile_apriori);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_volume_mixing_ratio_apriori", harp_type_float,
+                                                                      2, dimension_type, NULL, description, "ppmv",
+                                                                      NULL, get_optimal_range_length,
+                                                                      read_input_ozone_profile_apriori);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/ozone_profile_apriori[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5219,83 +5325,91 @@ static void register_o3_profile_variables(harp_product_definition *product_defin
 
     /* O3_column_number_density */
     description = "O3 total column";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "mol/m^2", NULL,
-                                                   read_product_ozone_total_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_ozone_total_column);
     path = "/PRODUCT/ozone_total_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_column_number_density_uncertainty */
     description = "uncertainty of the O3 total column";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_product_ozone_total_column_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_column_number_density_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_ozone_total_column_precision);
     path = "/PRODUCT/ozone_total_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_O3_column_number_density */
     description = "O3 tropospheric column";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "tropospheric_O3_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_product_ozone_tropospheric_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "tropospheric_O3_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_ozone_tropospheric_column);
     path = "/PRODUCT/ozone_tropospheric_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_O3_column_number_density_uncertainty */
     description = "uncertainty of the O3 tropospheric column";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition,
-                                                   "tropospheric_O3_column_number_density_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "mol/m^2", NULL,
-                                                   read_product_ozone_tropospheric_column_precision);
+        harp_ingestion_register_variable_range_read(product_definition,
+                                                    "tropospheric_O3_column_number_density_uncertainty",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_product_ozone_tropospheric_column_precision);
     path = "/PRODUCT/ozone_tropospheric_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "air pressure at cloud optical centroid";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_input_cloud_pressure_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_input_cloud_pressure_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_pressure_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction */
     description = "effective wavelenght-dependent cloud fraction";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_fraction_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_fraction_crb);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_fraction_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction_uncertainty */
     description = "precision of the effective wavelenght-dependent cloud fraction";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_fraction_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_fraction_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_fraction_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropopause_pressure */
     description = "tropopause pressure";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "tropopause_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_input_pressure_at_tropopause);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "tropopause_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_input_pressure_at_tropopause);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/pressure_at_tropopause[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* temperature */
     description = "temperature";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "temperature", harp_type_float, 2,
-                                                   dimension_type, NULL, description, "K", NULL,
-                                                   read_input_temperature);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "temperature",
+                                                                      harp_type_float, 2, dimension_type, NULL,
+                                                                      description, "K", NULL, get_optimal_range_length,
+                                                                      read_input_temperature);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/temperature[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -5591,20 +5705,23 @@ static void register_no2_product(void)
 
     /* tropospheric_NO2_column_number_density */
     description = "tropospheric vertical column of NO2";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "tropospheric_NO2_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_product_nitrogendioxide_tropospheric_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "tropospheric_NO2_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_nitrogendioxide_tropospheric_column);
     path = "/PRODUCT/nitrogendioxide_tropospheric_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* tropospheric_NO2_column_number_density_uncertainty */
     description = "uncertainty of the tropospheric vertical column of NO2 (standard error)";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition,
-                                                   "tropospheric_NO2_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_product_nitrogendioxide_tropospheric_column_precision);
+        harp_ingestion_register_variable_range_read(product_definition,
+                                                    "tropospheric_NO2_column_number_density_uncertainty",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_product_nitrogendioxide_tropospheric_column_precision);
     path = "/PRODUCT/nitrogendioxide_tropospheric_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5620,11 +5737,12 @@ static void register_no2_product(void)
     /* tropospheric_NO2_column_number_density_amf */
     description = "tropospheric air mass factor, computed by integrating the altitude dependent air mass factor over "
         "the atmospheric layers from the surface up to and including the layer with the tropopause";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "tropospheric_NO2_column_number_density_amf",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_air_mass_factor_troposphere);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "tropospheric_NO2_column_number_density_amf",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_air_mass_factor_troposphere);
     path = "/PRODUCT/air_mass_factor_troposphere[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5667,29 +5785,34 @@ static void register_no2_product(void)
     /* NO2_column_number_density_amf */
     description = "total air mass factor, computed by integrating the altitude dependent air mass factor over the "
         "atmospheric layers from the surface to top-of-atmosphere";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "NO2_column_number_density_amf", harp_type_float,
-                                                   1, dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_air_mass_factor_total);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "NO2_column_number_density_amf", harp_type_float,
+                                                                      1, dimension_type, NULL, description,
+                                                                      HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_air_mass_factor_total);
     path = "/PRODUCT/air_mass_factor_total[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* NO2_column_number_density_avk */
     description = "averaging kernel for the air mass factor correction, describing the NO2 profile sensitivity of the "
         "vertical column density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "NO2_column_number_density_avk", harp_type_float,
-                                                   2, dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_averaging_kernel);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "NO2_column_number_density_avk", harp_type_float,
+                                                                      2, dimension_type, NULL, description,
+                                                                      HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_averaging_kernel);
     path = "/PRODUCT/averaging_kernel[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* stratospheric_NO2_column_number_density */
     description = "stratospheric vertical column of NO2";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "stratospheric_NO2_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_results_nitrogendioxide_stratospheric_column);
+        harp_ingestion_register_variable_range_read(product_definition, "stratospheric_NO2_column_number_density",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_results_nitrogendioxide_stratospheric_column);
     path = "/PRODUCT/nitrogendioxide_tropospheric_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5705,11 +5828,12 @@ static void register_no2_product(void)
 
     /* stratospheric_NO2_column_number_density_amf */
     description = "stratospheric air mass factor";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "stratospheric_NO2_column_number_density_amf",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_air_mass_factor_stratosphere);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "stratospheric_NO2_column_number_density_amf",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_air_mass_factor_stratosphere);
     path = "/PRODUCT/air_mass_factor_troposphere[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5728,9 +5852,10 @@ static void register_no2_product(void)
     /* NO2_slant_column_number_density */
     description = "slant column of NO2";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "NO2_slant_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_results_nitrogendioxide_slant_column_density);
+        harp_ingestion_register_variable_range_read(product_definition, "NO2_slant_column_number_density",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_results_nitrogendioxide_slant_column_density);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/nitrogendioxide_slant_column_density[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5756,37 +5881,40 @@ static void register_no2_product(void)
 
     /* absorbing_aerosol_index */
     description = "aerosol index";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "absorbing_aerosol_index", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_aerosol_index_354_388);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "absorbing_aerosol_index",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_aerosol_index_354_388);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/aerosol_index_354_388";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_albedo */
     description = "cloud albedo";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_cloud_albedo_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_cloud_albedo_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_albedo_crb";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "cloud pressure";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_input_cloud_pressure_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_input_cloud_pressure_crb);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/cloud_pressure_crb";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_albedo */
     description = "surface albedo";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_surface_albedo_nitrogendioxide_window);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_surface_albedo_nitrogendioxide_window);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_albedo_nitrogendioxide_window";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -5950,56 +6078,64 @@ static void register_so2_product(void)
 
     /* SO2_column_number_density_avk */
     description = "averaging kernel for the SO2 vertical column density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "SO2_column_number_density_avk", harp_type_float,
-                                                   2, dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_averaging_kernel_1d);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "SO2_column_number_density_avk", harp_type_float,
+                                                                      2, dimension_type, NULL, description,
+                                                                      HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_averaging_kernel_1d);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/averaging_kernel[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* SO2_volume_mixing_ratio_dry_air_apriori */
     description = "SO2 apriori profile in volume mixing ratios";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "SO2_volume_mixing_ratio_dry_air_apriori",
-                                                   harp_type_float, 2, dimension_type, NULL, description, "ppv",
-                                                   exclude_so2_apriori_profile,
-                                                   read_results_sulfurdioxide_profile_apriori);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "SO2_volume_mixing_ratio_dry_air_apriori",
+                                                                      harp_type_float, 2, dimension_type, NULL,
+                                                                      description, "ppv", exclude_so2_apriori_profile,
+                                                                      get_optimal_range_length,
+                                                                      read_results_sulfurdioxide_profile_apriori);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/sulfurdioxide_profile_apriori[]";
     harp_variable_definition_add_mapping(variable_definition, "so2_column unset", NULL, path, NULL);
 
     /* SO2_slant_column_number_density */
     description = "SO2 slant column density";
     variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "SO2_slant_column_number_density",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_results_sulfurdioxide_slant_column_corrected);
+        harp_ingestion_register_variable_range_read(product_definition, "SO2_slant_column_number_density",
+                                                    harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
+                                                    NULL, get_optimal_range_length,
+                                                    read_results_sulfurdioxide_slant_column_corrected);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/sulfurdioxide_slant_column_corrected[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_column_number_density */
     description = "O3 vertical column density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "mol/m^2", NULL,
-                                                   read_input_ozone_total_vertical_column);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "O3_column_number_density",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_ozone_total_vertical_column);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/ozone_total_vertical_column[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* O3_column_number_density_uncertainty */
     description = "random component of the uncertainty of the O3 vertical column density";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "O3_column_number_density_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "mol/m^2",
-                                                   NULL, read_input_ozone_total_vertical_column_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "O3_column_number_density_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "mol/m^2", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_ozone_total_vertical_column_precision);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/ozone_total_vertical_column_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* absorbing_aerosol_index */
     description = "aerosol index";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "absorbing_aerosol_index", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS,
-                                                   exclude_nrti, read_input_aerosol_index_340_380);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "absorbing_aerosol_index",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS,
+                                                                      exclude_nrti, get_optimal_range_length,
+                                                                      read_input_aerosol_index_340_380);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/aerosol_index_340_380";
     harp_variable_definition_add_mapping(variable_definition, NULL, "OFFL", path, NULL);
 
@@ -6034,20 +6170,22 @@ static void register_cloud_cal_variables(harp_product_definition *product_defini
 
     /* cloud_fraction */
     description = "retrieved fraction of horizontal area occupied by clouds using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_cloud_fraction);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_fraction);
     path = "/PRODUCT/cloud_fraction[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction_uncertainty */
     description = "uncertainty of the retrieved fraction of horizontal area occupied by clouds using the OCRA/ROCINN "
         "CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_cloud_fraction_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_fraction_precision);
     path = "/PRODUCT/cloud_fraction_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -6061,120 +6199,127 @@ static void register_cloud_cal_variables(harp_product_definition *product_defini
 
     /* cloud_fraction_apriori */
     description = "effective radiometric cloud fraction a priori";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_apriori", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_fraction_apriori);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_apriori",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_fraction_apriori);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_fraction_apriori[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_base_pressure */
     description = "cloud base pressure calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_cloud_base_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_base_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_base_pressure);
     path = "/PRODUCT/cloud_base_pressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_base_pressure_uncertainty */
     description = "error of the cloud base pressure calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_pressure_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_cloud_base_pressure_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_base_pressure_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_base_pressure_precision);
     path = "/PRODUCT/cloud_base_pressure_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_base_height */
     description = "cloud base height calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_base_height);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_base_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_base_height);
     path = "/PRODUCT/cloud_base_height[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_base_height_uncertainty */
     description = "error of the cloud base height calculated using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_base_height_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_base_height_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_base_height_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "m", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_base_height_precision);
     path = "/PRODUCT/cloud_base_height_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_top_pressure */
     description = "retrieved atmospheric pressure at the level of cloud top using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_cloud_top_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_top_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_top_pressure);
     path = "/PRODUCT/cloud_top_pressure[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_top_pressure_uncertainty */
     description = "uncertainty of the retrieved atmospheric pressure at the level of cloud top using the OCRA/ROCINN "
         "CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_pressure_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_cloud_top_pressure_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_top_pressure_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "Pa", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_top_pressure_precision);
     path = "/PRODUCT/cloud_top_pressure_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_top_height */
     description = "retrieved altitude of the cloud top using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_top_height);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_top_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_top_height);
     path = "/PRODUCT/cloud_top_height[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_top_height_uncertainty */
     description = "uncertainty of the altitude of the cloud top using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_top_height_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_top_height_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_top_height_uncertainty", harp_type_float,
+                                                                      1, dimension_type, NULL, description, "m", NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_top_height_precision);
     path = "/PRODUCT/cloud_top_height_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_optical_depth */
     description = "retrieved cloud optical depth using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_optical_depth", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_optical_thickness);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_optical_depth",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_optical_thickness);
     path = "/PRODUCT/cloud_optical_thickness[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_optical_depth_uncertainty */
     description = "uncertainty of the retrieved cloud optical depth using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_optical_depth_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_optical_thickness_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
+                                                                      "cloud_optical_depth_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_optical_thickness_precision);
     path = "/PRODUCT/cloud_optical_thickness_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_albedo */
     description = "surface albedo fitted using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_surface_albedo_fitted);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_surface_albedo_fitted);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/surface_albedo_fitted[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_albedo_uncertainty */
     description = "uncertainty of the surface albedo fitted using the OCRA/ROCINN CAL model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_surface_albedo_fitted_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_surface_albedo_fitted_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/surface_albedo_fitted_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -6195,19 +6340,21 @@ static void register_cloud_crb_variables(harp_product_definition *product_defini
 
     /* cloud_fraction */
     description = "retrieved effective radiometric cloud fraction using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_fraction_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_fraction_crb);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_fraction_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction_uncertainty */
     description = "uncertainty of the retrieved effective radiometric cloud fraction using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_fraction_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_fraction_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_fraction_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -6221,84 +6368,87 @@ static void register_cloud_crb_variables(harp_product_definition *product_defini
 
     /* cloud_fraction_apriori */
     description = "effective radiometric cloud fraction a priori";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_apriori", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_fraction_apriori);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_apriori",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_fraction_apriori);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_fraction_apriori[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure */
     description = "retrieved atmospheric pressure at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_results_cloud_pressure_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_results_cloud_pressure_crb);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_pressure_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "error of the retrieved atmospheric pressure at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description, "Pa", NULL,
-                                                   read_results_cloud_pressure_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_results_cloud_pressure_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_pressure_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_height */
     description = "retrieved altitude at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_results_cloud_height_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_results_cloud_height_crb);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_height_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_height_uncertainty */
     description = "error of the retrieved altitude at the level of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_height_uncertainty", harp_type_float,
-                                                   1, dimension_type, NULL, description, "m", NULL,
-                                                   read_results_cloud_height_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_height_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_results_cloud_height_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_height_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_albedo */
     description = "albedo of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_albedo_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_albedo_crb);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_albedo_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_albedo_uncertainty */
     description = "uncertainty of the albedo of cloud using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_cloud_albedo_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_cloud_albedo_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/cloud_albedo_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_albedo */
     description = "surface albedo fitted using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_surface_albedo_fitted_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_surface_albedo_fitted_crb);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/surface_albedo_fitted_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_albedo_uncertainty */
     description = "uncertainty of the surface albedo fitted using the OCRA/ROCINN CRB model";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo_uncertainty",
-                                                   harp_type_float, 1, dimension_type, NULL, description,
-                                                   HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_results_surface_albedo_fitted_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_results_surface_albedo_fitted_crb_precision);
     path = "/PRODUCT/SUPPORT_DATA/DETAILED_RESULTS/surface_albedo_fitted_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -6347,19 +6497,21 @@ static void register_fresco_product(void)
 
     /* cloud_fraction */
     description = "effective cloud fraction retrieved from the O2 A-band";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_cloud_fraction_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_fraction_crb);
     path = "/PRODUCT/cloud_fraction_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_fraction_uncertainty */
     description = "uncertainty of the effective cloud fraction";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_fraction_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_cloud_fraction_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_fraction_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_fraction_crb_precision);
     path = "/PRODUCT/cloud_fraction_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -6373,64 +6525,67 @@ static void register_fresco_product(void)
 
     /* cloud_pressure */
     description = "cloud optical centroid pressure retrieved from the O2 A-band";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_cloud_pressure_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_pressure_crb);
     path = "/PRODUCT/cloud_pressure_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_pressure_uncertainty */
     description = "uncertainty of the cloud optical centroid pressure";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_pressure_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa", NULL,
-                                                   read_product_cloud_pressure_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_pressure_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_pressure_crb_precision);
     path = "/PRODUCT/cloud_pressure_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_height */
     description = "cloud optical centroid altitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_height", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_height_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_height",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_height_crb);
     path = "/PRODUCT/cloud_height_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_height_uncertainty */
     description = "uncertainty of the cloud optical centroid altitude";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_height_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "m", NULL,
-                                                   read_product_cloud_height_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_height_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "m", NULL, get_optimal_range_length,
+                                                                      read_product_cloud_height_crb_precision);
     path = "/PRODUCT/cloud_height_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_albedo */
     description = "cloud albedo; this is a fixed value for FRESCO";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_cloud_albedo_crb);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_albedo_crb);
     path = "/PRODUCT/cloud_albedo_crb[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* cloud_albedo_uncertainty */
     description = "cloud albedo error; since cloud albedo is fixed for FRESCO, this value is set to NaN";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "cloud_albedo_uncertainty", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_product_cloud_albedo_crb_precision);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "cloud_albedo_uncertainty",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_product_cloud_albedo_crb_precision);
     path = "/PRODUCT/cloud_albedo_crb_precision[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     /* surface_albedo */
     description = "assumed surface albedo at 758nm";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_albedo", harp_type_float, 1,
-                                                   dimension_type, NULL, description, HARP_UNIT_DIMENSIONLESS, NULL,
-                                                   read_input_surface_albedo_assumed);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_albedo",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, HARP_UNIT_DIMENSIONLESS, NULL,
+                                                                      get_optimal_range_length,
+                                                                      read_input_surface_albedo_assumed);
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_albedo_assumed[]";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
@@ -6439,10 +6594,11 @@ static void register_fresco_product(void)
     /* surface_pressure */
     description = "surface pressure";
     path = "/PRODUCT/SUPPORT_DATA/INPUT_DATA/surface_pressure[]";
-    variable_definition =
-        harp_ingestion_register_variable_full_read(product_definition, "surface_pressure", harp_type_float, 1,
-                                                   dimension_type, NULL, description, "Pa",
-                                                   exclude_before_procver_010000, read_input_surface_pressure);
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_pressure",
+                                                                      harp_type_float, 1, dimension_type, NULL,
+                                                                      description, "Pa", exclude_before_procver_010000,
+                                                                      get_optimal_range_length,
+                                                                      read_input_surface_pressure);
     harp_variable_definition_add_mapping(variable_definition, NULL, "processor version >= 01.00.00", path, NULL);
 
     register_snow_ice_flag_variables(product_definition, 1);
@@ -34,6 +34,7 @@
 #include "hashtable.h"
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -312,6 +313,7 @@ static int variable_definition_new(const char *name, harp_data_type data_type, i
     variable_definition->read_range = read_range;
     variable_definition->get_optimal_range_length = get_optimal_range_length;
     variable_definition->read_block = read_block;
+    variable_definition->read_sub_range = NULL;
 
     variable_definition->num_mappings = 0;
     variable_definition->mapping = NULL;
@@ -387,6 +389,7 @@ static int product_definition_new(const char *name, const char *description,
     product_definition->variable_definition = NULL;
     product_definition->variable_definition_hash_data = NULL;
     product_definition->read_dimensions = read_dimensions;
+    product_definition->read_datetime_range = NULL;
     product_definition->ingestion_option = NULL;
     product_definition->mapping_description = NULL;
 
@@ -545,6 +548,8 @@ static void ingestion_option_definition_delete(harp_ingestion_option_definition
     }
 }
 
+static void ingestion_module_delete(harp_ingestion_module *module);
+
 static int ingestion_module_new(const char *name, const char *product_group, const char *product_class,
                                 const char *product_type, const char *description,
                                 int (*ingestion_init_coda) (const harp_ingestion_module *module, coda_product *product,
@@ -598,13 +603,25 @@ static int ingestion_module_new(const char *name, const char *product_group, con
     }
     module->num_product_definitions = 0;
     module->product_definition = NULL;
+    module->product_definition_hash_data = NULL;
     module->num_option_definitions = 0;
     module->option_definition = NULL;
+    module->option_definition_hash_data = NULL;
     module->ingestion_init_coda = ingestion_init_coda;
     module->verify_product_type = verify_product_type;
     module->ingestion_init_custom = ingestion_init_custom;
     module->ingestion_done = ingestion_done;
 
+    module->product_definition_hash_data = hashtable_new(1);
+    module->option_definition_hash_data = hashtable_new(1);
+    if (module->product_definition_hash_data == NULL || module->option_definition_hash_data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        ingestion_module_delete(module);
+        return -1;
+    }
+
     *new_module = module;
     return 0;
 }
@@ -641,6 +658,10 @@ static void ingestion_module_delete(harp_ingestion_module *module)
 
             free(module->product_definition);
         }
+        if (module->product_definition_hash_data != NULL)
+        {
+            hashtable_delete(module->product_definition_hash_data);
+        }
 
         if (module->option_definition != NULL)
         {
@@ -653,6 +674,10 @@ static void ingestion_module_delete(harp_ingestion_module *module)
 
             free(module->option_definition);
         }
+        if (module->option_definition_hash_data != NULL)
+        {
+            hashtable_delete(module->option_definition_hash_data);
+        }
 
         free(module);
     }
@@ -660,17 +685,7 @@ static void ingestion_module_delete(harp_ingestion_module *module)
 
 static int ingestion_module_get_option_index(const harp_ingestion_module *module, const char *name)
 {
-    int i;
-
-    for (i = 0; i < module->num_option_definitions; i++)
-    {
-        if (strcmp(module->option_definition[i]->name, name) == 0)
-        {
-            return i;
-        }
-    }
-
-    return -1;
+    return (int)hashtable_get_index_from_name(module->option_definition_hash_data, name);
 }
 
 static int ingestion_module_has_option(const harp_ingestion_module *module, const char *name)
@@ -683,6 +698,7 @@ static int ingestion_module_add_option(harp_ingestion_module *module, harp_inges
     assert(module != NULL);
     assert(option != NULL);
     assert(!ingestion_module_has_option(module, option->name));
+    assert(strcmp(option->name, HARP_INGESTION_MODULE_OPTION) != 0);
 
     if (module->num_option_definitions % BLOCK_SIZE == 0)
     {
@@ -701,6 +717,13 @@ static int ingestion_module_add_option(harp_ingestion_module *module, harp_inges
     }
     module->option_definition[module->num_option_definitions++] = option;
 
+    if (hashtable_add_name(module->option_definition_hash_data, option->name) != 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "option '%s' already exists in ingestion module '%s'",
+                       option->name, module->name);
+        return -1;
+    }
+
     return 0;
 }
 
@@ -726,11 +749,34 @@ static int ingestion_module_add_product(harp_ingestion_module *module, harp_prod
     }
     module->product_definition[module->num_product_definitions++] = product;
 
+    /* if multiple product definitions share a name, lookups by name resolve to the first one */
+    hashtable_insert_name(module->product_definition_hash_data, module->num_product_definitions - 1, product->name);
+
     return 0;
 }
 
+/* returns the key '<product class>/<product type>' that is used for the module lookup by product type */
+static char *product_type_key_new(const char *product_class, const char *product_type)
+{
+    char *key;
+
+    key = (char *)malloc(strlen(product_class) + strlen(product_type) + 2);
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(product_class) + strlen(product_type) + 2, __FILE__, __LINE__);
+        return NULL;
+    }
+    sprintf(key, "%s/%s", product_class, product_type);
+
+    return key;
+}
+
 static int ingestion_register_module(harp_ingestion_module *module)
 {
+    char *key;
+    int index;
+
     if (module_register == NULL)
     {
         harp_set_error(HARP_ERROR_INGESTION, "ingestion module register unavailable (%s:%u)", __FILE__, __LINE__);
@@ -746,6 +792,7 @@ static int ingestion_register_module(harp_ingestion_module *module)
     if (module_register->num_ingestion_modules % BLOCK_SIZE == 0)
     {
         harp_ingestion_module **new_ingestion_module;
+        char **new_product_type_key;
         size_t new_size;
 
         new_size = (module_register->num_ingestion_modules + BLOCK_SIZE) * sizeof(harp_ingestion_module *);
@@ -758,9 +805,40 @@ static int ingestion_register_module(harp_ingestion_module *module)
         }
 
         module_register->ingestion_module = new_ingestion_module;
+
+        new_size = (module_register->num_ingestion_modules + BLOCK_SIZE) * sizeof(char *);
+        new_product_type_key = (char **)realloc(module_register->product_type_key, new_size);
+        if (new_product_type_key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", new_size,
+                           __FILE__, __LINE__);
+            return -1;
+        }
+        module_register->product_type_key = new_product_type_key;
+    }
+
+    index = module_register->num_ingestion_modules;
+    module_register->product_type_key[index] = NULL;
+    if (module->product_class != NULL && module->product_type != NULL)
+    {
+        key = product_type_key_new(module->product_class, module->product_type);
+        if (key == NULL)
+        {
+            return -1;
+        }
+        /* if multiple modules support the same product type then the module that was registered first is used */
+        if (hashtable_insert_name(module_register->product_type_hash_data, index, key) == 0)
+        {
+            module_register->product_type_key[index] = key;
+        }
+        else
+        {
+            free(key);
+        }
     }
+    hashtable_insert_name(module_register->module_name_hash_data, index, module->name);
 
-    module_register->ingestion_module[module_register->num_ingestion_modules] = module;
+    module_register->ingestion_module[index] = module;
     module_register->num_ingestion_modules++;
 
     return 0;
@@ -1050,6 +1128,22 @@ void harp_variable_definition_set_enumeration_values(harp_variable_definition *v
     }
 }
 
+/* Set a callback that reads only part of the second dimension of a variable for a single index of the first dimension.
+ * The callback should store sub_length elements in data (which points to the location of element sub_offset).
+ * The ingestion uses this callback instead of reading the full second dimension when the dimension masks for the
+ * second dimension select only a small window of it (e.g. a wavelength filter on a spectral variable).
+ */
+void harp_variable_definition_set_sub_range_read(harp_variable_definition *variable_definition,
+                                                 int (*read_sub_range) (void *user_data, long index, long sub_offset,
+                                                                        long sub_length, harp_array data))
+{
+    assert(variable_definition->num_dimensions == 2);
+    assert(variable_definition->dimension_type[1] != harp_dimension_independent);
+    assert(variable_definition->data_type != harp_type_string);
+
+    variable_definition->read_sub_range = read_sub_range;
+}
+
 int harp_variable_definition_has_dimension_types(const harp_variable_definition *variable_definition,
                                                  int num_dimensions, const harp_dimension_type *dimension_type)
 {
@@ -1113,6 +1207,21 @@ void harp_product_definition_add_mapping(harp_product_definition *product_defini
     }
 }
 
+/* Set a callback that determines the datetime range of a product without reading the datetime variables in full.
+ * This is used when only the metadata of a product is retrieved (e.g. for a dataset listing). The callback should
+ * provide the minimum and maximum of the (valid) values of the datetime variables of the product (i.e. the result
+ * should equal that of the full scan) in seconds since 2000-01-01, using e.g. header information or only the first and
+ * last samples of a time ordered product. It should return 1 if this is not possible for the product at hand (the
+ * datetime variables are then read in full instead).
+ */
+void harp_product_definition_set_datetime_range_read(harp_product_definition *product_definition,
+                                                     int (*read_datetime_range) (void *user_data,
+                                                                                 double *datetime_start,
+                                                                                 double *datetime_stop))
+{
+    product_definition->read_datetime_range = read_datetime_range;
+}
+
 int harp_product_definition_has_dimension_type(const harp_product_definition *product_definition,
                                                harp_dimension_type dimension_type)
 {
@@ -1158,6 +1267,16 @@ int harp_product_definition_get_variable_index(const harp_product_definition *pr
     return (int)index;
 }
 
+harp_product_definition *harp_ingestion_module_find_product_definition(const harp_ingestion_module *module,
+                                                                       const char *name)
+{
+    long index;
+
+    index = hashtable_get_index_from_name(module->product_definition_hash_data, name);
+    assert(index >= -1 && index < module->num_product_definitions);
+    return (index >= 0 ? module->product_definition[index] : NULL);
+}
+
 int harp_ingestion_module_validate_options(harp_ingestion_module *module, const harp_ingestion_options *options)
 {
     int i;
@@ -1181,6 +1300,17 @@ int harp_ingestion_module_validate_options(harp_ingestion_module *module, const
         int j;
 
         option = options->option[i];
+        if (strcmp(option->name, HARP_INGESTION_MODULE_OPTION) == 0)
+        {
+            /* selection of the module itself (see harp_ingestion_find_module()) */
+            if (strcmp(option->value, module->name) != 0)
+            {
+                harp_set_error(HARP_ERROR_INVALID_INGESTION_OPTION_VALUE, "invalid value '%s' for option '%s' of "
+                               "ingestion module '%s'", option->value, option->name, module->name);
+                return -1;
+            }
+            continue;
+        }
         index = ingestion_module_get_option_index(module, option->name);
         if (index < 0)
         {
@@ -1206,29 +1336,100 @@ int harp_ingestion_module_validate_options(harp_ingestion_module *module, const
     return 0;
 }
 
-int harp_ingestion_find_module(const char *filename, harp_ingestion_module **module, coda_product **cproduct)
+static int open_coda_product(const char *filename, const harp_ingestion_module *module, coda_product **product)
 {
-    coda_product *product;
     int result;
-    int i;
-
-    assert(module_register != NULL);
-    assert(filename != NULL);
-    assert(cproduct != NULL);
 
-    /* Try to identify the product using CODA. */
-    result = coda_open(filename, &product);
+    /* if the module is known then CODA does not need to perform its own product type detection */
+    if (module != NULL)
+    {
+        result = coda_open_as(filename, module->product_class, module->product_type, -1, product);
+    }
+    else
+    {
+        result = coda_open(filename, product);
+    }
     if (result != 0 && coda_errno == CODA_ERROR_FILE_OPEN && coda_get_option_use_mmap())
     {
         /* There may not be enough memory space available to map the file into memory => temporarily disable memory
          * mapping of files and try again.
          */
         coda_set_option_use_mmap(0);
-        result = coda_open(filename, &product);
+        if (module != NULL)
+        {
+            result = coda_open_as(filename, module->product_class, module->product_type, -1, product);
+        }
+        else
+        {
+            result = coda_open(filename, product);
+        }
         coda_set_option_use_mmap(1);
     }
-
     if (result == 0)
+    {
+        harp_io_statistics_add_open(harp_io_backend_coda);
+    }
+
+    return result;
+}
+
+static void close_coda_product(coda_product *product)
+{
+    harp_io_statistics_add_close(harp_io_backend_coda);
+    coda_close(product);
+}
+
+/* Find the ingestion module for a product.
+ * If the ingestion option 'module' is set then that module is used without performing any product type detection.
+ * Otherwise the product class/type as determined by CODA is looked up in the module register; modules that use a
+ * custom verify_product_type() are only tried if CODA does not recognize the product.
+ * The options are optional (can be NULL).
+ */
+int harp_ingestion_find_module(const char *filename, const harp_ingestion_options *options,
+                               harp_ingestion_module **module, coda_product **cproduct)
+{
+    coda_product *product;
+    long index;
+    int i;
+
+    assert(module_register != NULL);
+    assert(filename != NULL);
+    assert(cproduct != NULL);
+
+    if (options != NULL && harp_ingestion_options_has_option(options, HARP_INGESTION_MODULE_OPTION))
+    {
+        harp_ingestion_module *ingestion_module;
+        const char *module_name;
+
+        if (harp_ingestion_options_get_option(options, HARP_INGESTION_MODULE_OPTION, &module_name) != 0)
+        {
+            return -1;
+        }
+        index = hashtable_get_index_from_name(module_register->module_name_hash_data, module_name);
+        if (index < 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_INGESTION_OPTION_VALUE, "unknown ingestion module '%s'", module_name);
+            return -1;
+        }
+        ingestion_module = module_register->ingestion_module[index];
+
+        if (ingestion_module->product_class != NULL && ingestion_module->product_type != NULL)
+        {
+            if (open_coda_product(filename, ingestion_module, &product) != 0)
+            {
+                harp_set_error(HARP_ERROR_CODA, NULL);
+                harp_add_error_message(" (%s)", filename);
+                return -1;
+            }
+            *cproduct = product;
+        }
+
+        *module = ingestion_module;
+        return 0;
+    }
+
+    /* Try to identify the product using CODA. */
+    if (open_coda_product(filename, NULL, &product) == 0)
     {
         const char *product_class;
         const char *product_type;
@@ -1236,51 +1437,43 @@ int harp_ingestion_find_module(const char *filename, harp_ingestion_module **mod
         if (coda_get_product_class(product, &product_class) != 0)
         {
             harp_set_error(HARP_ERROR_CODA, NULL);
-            coda_close(product);
+            close_coda_product(product);
             return -1;
         }
         if (coda_get_product_type(product, &product_type) != 0)
         {
             harp_set_error(HARP_ERROR_CODA, NULL);
-            coda_close(product);
+            close_coda_product(product);
             return -1;
         }
 
-        /* Look for a compatible ingestion module by comparing product_class and product_type. */
+        /* Look for a compatible ingestion module based on product_class and product_type. */
         if (product_class != NULL && product_type != NULL)
         {
-            for (i = 0; i < module_register->num_ingestion_modules; i++)
-            {
-                harp_ingestion_module *ingestion_module;
-
-                ingestion_module = module_register->ingestion_module[i];
-                if (ingestion_module->product_class == NULL || ingestion_module->product_type == NULL)
-                {
-                    continue;
-                }
-
-                if (strcmp(ingestion_module->product_class, product_class) != 0)
-                {
-                    continue;
-                }
-
-                if (strcmp(ingestion_module->product_type, product_type) != 0)
-                {
-                    continue;
-                }
+            char *key;
 
-                *module = ingestion_module;
+            key = product_type_key_new(product_class, product_type);
+            if (key == NULL)
+            {
+                close_coda_product(product);
+                return -1;
+            }
+            index = hashtable_get_index_from_name(module_register->product_type_hash_data, key);
+            free(key);
+            if (index >= 0)
+            {
+                *module = module_register->ingestion_module[index];
                 *cproduct = product;
                 return 0;
             }
 
             harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, "%s: unsupported product class/type '%s/%s'", filename,
                            product_class, product_type);
-            coda_close(product);
+            close_coda_product(product);
             return -1;
         }
 
-        coda_close(product);
+        close_coda_product(product);
     }
     else
     {
@@ -1339,6 +1532,16 @@ int harp_ingestion_init(void)
     }
     module_register->num_ingestion_modules = 0;
     module_register->ingestion_module = NULL;
+    module_register->product_type_key = NULL;
+    module_register->module_name_hash_data = hashtable_new(1);
+    module_register->product_type_hash_data = hashtable_new(1);
+    if (module_register->module_name_hash_data == NULL || module_register->product_type_hash_data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_ingestion_done();
+        return -1;
+    }
 
     /* Make sure that udunits gets initialized as well (so we can use asserts later on) */
     if (!harp_unit_is_valid(""))
@@ -1394,6 +1597,28 @@ void harp_ingestion_done(void)
 
             free(module_register->ingestion_module);
         }
+        if (module_register->product_type_key != NULL)
+        {
+            int i;
+
+            for (i = 0; i < module_register->num_ingestion_modules; i++)
+            {
+                if (module_register->product_type_key[i] != NULL)
+                {
+                    free(module_register->product_type_key[i]);
+                }
+            }
+
+            free(module_register->product_type_key);
+        }
+        if (module_register->module_name_hash_data != NULL)
+        {
+            hashtable_delete(module_register->module_name_hash_data);
+        }
+        if (module_register->product_type_hash_data != NULL)
+        {
+            hashtable_delete(module_register->product_type_hash_data);
+        }
 
         free(module_register);
         module_register = NULL;
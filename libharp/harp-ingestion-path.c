@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-ingestion.h"
+#include "hashtable.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A path that has been resolved into the record field/array element index to move to at each level */
+typedef struct resolved_path_struct
+{
+    char *path;
+    int num_steps;
+    long step[CODA_CURSOR_MAXDEPTH];
+} resolved_path;
+
+struct harp_coda_path_cache_struct
+{
+    int num_paths;
+    resolved_path **resolved;
+    hashtable *hash_data;
+};
+
+static void resolved_path_delete(resolved_path *resolved)
+{
+    if (resolved->path != NULL)
+    {
+        free(resolved->path);
+    }
+    free(resolved);
+}
+
+static int resolved_path_new(const coda_cursor *cursor, const char *path, resolved_path **new_resolved)
+{
+    resolved_path *resolved;
+    coda_cursor target;
+    int base_depth;
+    int depth;
+    int i;
+
+    /* only relative paths that descend from the cursor position can be replayed on other cursors */
+    if (path[0] == '/' || strchr(path, '@') != NULL || strstr(path, "..") != NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "path '%s' can not be cached (%s:%u)", path, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    target = *cursor;
+    if (coda_cursor_get_depth(&target, &base_depth) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_goto(&target, path) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_get_depth(&target, &depth) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    assert(depth >= base_depth);
+
+    resolved = (resolved_path *)malloc(sizeof(resolved_path));
+    if (resolved == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(resolved_path), __FILE__, __LINE__);
+        return -1;
+    }
+    resolved->num_steps = depth - base_depth;
+    resolved->path = strdup(path);
+    if (resolved->path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        resolved_path_delete(resolved);
+        return -1;
+    }
+
+    /* walk back up to the starting position, recording the index at each level */
+    for (i = resolved->num_steps - 1; i >= 0; i--)
+    {
+        if (coda_cursor_get_index(&target, &resolved->step[i]) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            resolved_path_delete(resolved);
+            return -1;
+        }
+        if (coda_cursor_goto_parent(&target) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            resolved_path_delete(resolved);
+            return -1;
+        }
+    }
+
+    *new_resolved = resolved;
+
+    return 0;
+}
+
+static int resolved_path_goto(const resolved_path *resolved, coda_cursor *cursor)
+{
+    int i;
+
+    for (i = 0; i < resolved->num_steps; i++)
+    {
+        coda_type_class type_class;
+
+        if (coda_cursor_get_type_class(cursor, &type_class) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (type_class == coda_record_class)
+        {
+            if (coda_cursor_goto_record_field_by_index(cursor, resolved->step[i]) != 0)
+            {
+                harp_set_error(HARP_ERROR_CODA, NULL);
+                return -1;
+            }
+        }
+        else
+        {
+            assert(type_class == coda_array_class);
+            if (coda_cursor_goto_array_element_by_index(cursor, resolved->step[i]) != 0)
+            {
+                harp_set_error(HARP_ERROR_CODA, NULL);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Create a new cache for CODA cursor paths.
+ * The cache allows ingestion modules to repeatedly move cursors along the same path (e.g. once for each record of a
+ * dataset) without having to parse the path and look up record fields by name each time.
+ * \param new_cache Pointer to the C variable where the new cache will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_coda_path_cache_new(harp_coda_path_cache **new_cache)
+{
+    harp_coda_path_cache *cache;
+
+    cache = (harp_coda_path_cache *)malloc(sizeof(harp_coda_path_cache));
+    if (cache == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_coda_path_cache), __FILE__, __LINE__);
+        return -1;
+    }
+    cache->num_paths = 0;
+    cache->resolved = NULL;
+    cache->hash_data = hashtable_new(1);
+    if (cache->hash_data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        free(cache);
+        return -1;
+    }
+
+    *new_cache = cache;
+
+    return 0;
+}
+
+/** Delete a CODA cursor path cache.
+ * \param cache Cache that should be deleted.
+ */
+void harp_coda_path_cache_delete(harp_coda_path_cache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    hashtable_delete(cache->hash_data);
+    if (cache->resolved != NULL)
+    {
+        int i;
+
+        for (i = 0; i < cache->num_paths; i++)
+        {
+            resolved_path_delete(cache->resolved[i]);
+        }
+        free(cache->resolved);
+    }
+    free(cache);
+}
+
+/** Move a cursor along a path, using the cache to avoid resolving the path more than once.
+ * The first time a path is used it is resolved with coda_cursor_goto() and the record field/array element index at
+ * each level is stored. Subsequent calls for the same path only move the cursor using these indices.
+ * The path should be relative (i.e. not start with '/'), may not contain attributes ('@') or '..', and all cursors
+ * that are used with the same path need to point to data of the same type (e.g. elements of the same array).
+ * \param cache Cursor path cache.
+ * \param cursor Cursor that will be moved.
+ * \param path Path (in coda_cursor_goto() syntax) relative to the current position of the cursor.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_coda_path_cache_goto(harp_coda_path_cache *cache, coda_cursor *cursor, const char *path)
+{
+    resolved_path *resolved;
+    long index;
+
+    index = hashtable_get_index_from_name(cache->hash_data, path);
+    if (index >= 0)
+    {
+        return resolved_path_goto(cache->resolved[index], cursor);
+    }
+
+    if (cache->num_paths % BLOCK_SIZE == 0)
+    {
+        resolved_path **new_resolved;
+
+        new_resolved = (resolved_path **)realloc(cache->resolved, (cache->num_paths + BLOCK_SIZE) *
+                                                 sizeof(resolved_path *));
+        if (new_resolved == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (cache->num_paths + BLOCK_SIZE) * sizeof(resolved_path *), __FILE__, __LINE__);
+            return -1;
+        }
+        cache->resolved = new_resolved;
+    }
+    if (resolved_path_new(cursor, path, &resolved) != 0)
+    {
+        return -1;
+    }
+    if (hashtable_add_name(cache->hash_data, resolved->path) != 0)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not add path to hashtable) (%s:%u)",
+                       __FILE__, __LINE__);
+        resolved_path_delete(resolved);
+        return -1;
+    }
+    cache->resolved[cache->num_paths] = resolved;
+    cache->num_paths++;
+
+    return resolved_path_goto(resolved, cursor);
+}
@@ -51,6 +51,7 @@ typedef struct read_buffer_struct
     long num_elements;
     size_t buffer_size;
     harp_array data;
+    struct read_buffer_struct *next;    /* next buffer in the buffer pool of the ingestion */
 } read_buffer;
 
 typedef struct ingest_info_struct
@@ -77,8 +78,22 @@ typedef struct ingest_info_struct
     long block_buffer_index_offset;     /* index of first block in the buffer */
     long block_buffer_max_blocks;       /* total number of blocks for the variable */
     long block_buffer_num_blocks;       /* number of blocks that can fit in the buffer */
+
+    read_buffer *buffer_pool;   /* scratch buffers that are available for reuse (all released in ingestion_done()) */
+
+    double *variable_read_time; /* if not NULL, the wall time spent on reading each variable is stored here */
 } ingest_info;
 
+struct harp_ingest_stream_struct
+{
+    ingest_info *info;
+    harp_ingestion_options *option_list;
+    harp_program *program;      /* program that is executed on each chunk (not owned by the stream) */
+    char *filename;     /* copy of the filename (info->basename points into this string) */
+    long chunk_size;    /* maximum number of time samples that is ingested for each chunk */
+    long offset;        /* index of the first time sample of the next chunk */
+};
+
 static void read_buffer_free_string_data(read_buffer *buffer)
 {
     if (buffer->data_type == harp_type_string)
@@ -104,10 +119,10 @@ static void read_buffer_delete(read_buffer *buffer)
         if (buffer->data.ptr != NULL)
         {
             read_buffer_free_string_data(buffer);
-            free(buffer->data.ptr);
+            harp_free(buffer->data.ptr);
         }
 
-        free(buffer);
+        harp_free(buffer);
     }
 }
 
@@ -115,9 +130,11 @@ static int read_buffer_new(harp_data_type data_type, long num_elements, read_buf
 {
     read_buffer *buffer;
 
-    buffer = (read_buffer *)malloc(sizeof(read_buffer));
+    buffer = (read_buffer *)harp_malloc(sizeof(read_buffer));
     if (buffer == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(read_buffer), __FILE__, __LINE__);
         return -1;
     }
 
@@ -125,15 +142,16 @@ static int read_buffer_new(harp_data_type data_type, long num_elements, read_buf
     buffer->num_elements = num_elements;
     buffer->buffer_size = num_elements * harp_get_size_for_type(data_type);
     buffer->data.ptr = NULL;
+    buffer->next = NULL;
 
     if (buffer->buffer_size > 0)
     {
-        buffer->data.ptr = malloc(buffer->buffer_size);
+        buffer->data.ptr = harp_malloc(buffer->buffer_size);
         if (buffer->data.ptr == NULL)
         {
-            read_buffer_delete(buffer);
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                            buffer->buffer_size, __FILE__, __LINE__);
+            read_buffer_delete(buffer);
             return -1;
         }
 
@@ -152,7 +170,7 @@ static int read_buffer_resize(read_buffer *buffer, harp_data_type data_type, lon
     {
         void *ptr;
 
-        ptr = realloc(buffer->data.ptr, new_buffer_size);
+        ptr = harp_realloc(buffer->data.ptr, new_buffer_size);
         if (ptr == NULL)
         {
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
@@ -173,12 +191,70 @@ static int read_buffer_resize(read_buffer *buffer, harp_data_type data_type, lon
     return 0;
 }
 
+/* Get a scratch buffer for num_elements elements of the given data type.
+ * A buffer from the buffer pool of the ingestion is reused if available (the smallest one that is large enough, or
+ * else the largest one, which then gets enlarged), such that repeated reads do not each allocate (and page in) new
+ * memory. The buffer should be given back with read_buffer_release().
+ */
+static int read_buffer_acquire(ingest_info *info, harp_data_type data_type, long num_elements,
+                               read_buffer **new_buffer)
+{
+    size_t buffer_size = num_elements * harp_get_size_for_type(data_type);
+    read_buffer **best_entry = NULL;
+    read_buffer **entry;
+    read_buffer *buffer;
+
+    for (entry = &info->buffer_pool; *entry != NULL; entry = &(*entry)->next)
+    {
+        if (best_entry == NULL)
+        {
+            best_entry = entry;
+        }
+        else if ((*best_entry)->buffer_size < buffer_size)
+        {
+            if ((*entry)->buffer_size > (*best_entry)->buffer_size)
+            {
+                best_entry = entry;
+            }
+        }
+        else if ((*entry)->buffer_size >= buffer_size && (*entry)->buffer_size < (*best_entry)->buffer_size)
+        {
+            best_entry = entry;
+        }
+    }
+    if (best_entry == NULL)
+    {
+        return read_buffer_new(data_type, num_elements, new_buffer);
+    }
+
+    buffer = *best_entry;
+    *best_entry = buffer->next;
+    buffer->next = NULL;
+    if (read_buffer_resize(buffer, data_type, num_elements) != 0)
+    {
+        read_buffer_delete(buffer);
+        return -1;
+    }
+
+    *new_buffer = buffer;
+    return 0;
+}
+
+/* Give a buffer that was obtained with read_buffer_acquire() back to the buffer pool of the ingestion. */
+static void read_buffer_release(ingest_info *info, read_buffer *buffer)
+{
+    read_buffer_free_string_data(buffer);
+    buffer->next = info->buffer_pool;
+    info->buffer_pool = buffer;
+}
+
 static void ingestion_done(ingest_info *info)
 {
     if (info != NULL)
     {
         if (info->cproduct != NULL)
         {
+            harp_io_statistics_add_close(harp_io_backend_coda);
             coda_close(info->cproduct);
         }
 
@@ -199,6 +275,19 @@ static void ingestion_done(ingest_info *info)
 
         read_buffer_delete(info->block_buffer);
 
+        while (info->buffer_pool != NULL)
+        {
+            read_buffer *buffer = info->buffer_pool;
+
+            info->buffer_pool = buffer->next;
+            read_buffer_delete(buffer);
+        }
+
+        if (info->variable_read_time != NULL)
+        {
+            free(info->variable_read_time);
+        }
+
         free(info);
     }
 }
@@ -227,6 +316,8 @@ static int ingestion_init(ingest_info **new_info)
     info->product = NULL;
     info->block_buffer = NULL;
     info->block_buffer_read_all = NULL;
+    info->buffer_pool = NULL;
+    info->variable_read_time = NULL;
 
     if (harp_dimension_mask_set_new(&info->dimension_mask_set) != 0)
     {
@@ -238,6 +329,28 @@ static int ingestion_init(ingest_info **new_info)
     return 0;
 }
 
+/* Record a read request of an ingestion module for num_blocks blocks (i.e. elements of the first dimension) of a
+ * variable in the I/O statistics.
+ */
+static void add_read_statistics(const ingest_info *info, const harp_variable_definition *variable_def, long num_blocks)
+{
+    int64_t num_elements = num_blocks;
+    int i;
+
+    for (i = 1; i < variable_def->num_dimensions; i++)
+    {
+        if (variable_def->dimension_type[i] == harp_dimension_independent)
+        {
+            num_elements *= variable_def->dimension[i];
+        }
+        else
+        {
+            num_elements *= info->dimension[variable_def->dimension_type[i]];
+        }
+    }
+    harp_io_statistics_add_read(harp_io_backend_coda, num_elements * harp_get_size_for_type(variable_def->data_type));
+}
+
 static int read_all(ingest_info *info, const harp_variable_definition *variable_def, harp_array data)
 {
     long dimension[HARP_MAX_NUM_DIMS];
@@ -247,11 +360,6 @@ static int read_all(ingest_info *info, const harp_variable_definition *variable_
     long index;
     int i;
 
-    if (variable_def->read_all != NULL)
-    {
-        return variable_def->read_all(info->user_data, data);
-    }
-
     for (i = 0; i < variable_def->num_dimensions; i++)
     {
         if (variable_def->dimension_type[i] == harp_dimension_independent)
@@ -265,11 +373,18 @@ static int read_all(ingest_info *info, const harp_variable_definition *variable_
     }
     num_elements = harp_get_num_elements(variable_def->num_dimensions, dimension);
 
+    if (variable_def->read_all != NULL)
+    {
+        add_read_statistics(info, variable_def, variable_def->num_dimensions == 0 ? 1 : dimension[0]);
+        return variable_def->read_all(info->user_data, data);
+    }
+
     if (variable_def->read_range != NULL)
     {
         /* read_range() should have only been set for variables that have one or more dimensions */
         assert(variable_def->num_dimensions > 0);
 
+        add_read_statistics(info, variable_def, dimension[0]);
         return variable_def->read_range(info->user_data, 0, dimension[0], data);
     }
 
@@ -277,6 +392,7 @@ static int read_all(ingest_info *info, const harp_variable_definition *variable_
 
     if (variable_def->num_dimensions == 0 || variable_def->dimension[0] == 1)
     {
+        add_read_statistics(info, variable_def, 1);
         return variable_def->read_block(info->user_data, 0, data);
     }
 
@@ -285,6 +401,7 @@ static int read_all(ingest_info *info, const harp_variable_definition *variable_
 
     for (index = 0; index < dimension[0]; index++)
     {
+        add_read_statistics(info, variable_def, 1);
         if (variable_def->read_block(info->user_data, index, block) != 0)
         {
             return -1;
@@ -299,6 +416,7 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
 {
     if (variable_def->read_block != NULL)
     {
+        add_read_statistics(info, variable_def, 1);
         return variable_def->read_block(info->user_data, index, data);
     }
     if (variable_def->read_all != NULL)
@@ -306,6 +424,7 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
         if (variable_def->num_dimensions == 0 || variable_def->dimension[0] == 1)
         {
             /* there is only one block, so read directly into the target buffer */
+            add_read_statistics(info, variable_def, 1);
             return variable_def->read_all(info->user_data, data);
         }
 
@@ -343,6 +462,7 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
                     return -1;
                 }
             }
+            add_read_statistics(info, variable_def, dimension[0]);
             if (variable_def->read_all(info->user_data, info->block_buffer->data) != 0)
             {
                 return -1;
@@ -421,6 +541,7 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
             {
                 num_blocks = info->block_buffer_max_blocks - info->block_buffer_index_offset;
             }
+            add_read_statistics(info, variable_def, num_blocks);
             if (variable_def->read_range(info->user_data, info->block_buffer_index_offset, num_blocks,
                                          info->block_buffer->data) != 0)
             {
@@ -437,6 +558,48 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
     return 0;
 }
 
+/* Read the block at the given index for a variable with a (partial) dimension mask on its second dimension.
+ * Only the elements within the window spanned by the selected elements of the mask are read if the window is small
+ * compared to the full length of the dimension (elements outside the window are left uninitialised in data, which is
+ * fine since harp_array_filter() only accesses the selected elements).
+ */
+static int read_masked_sub_range(ingest_info *info, const harp_variable_definition *variable_def, long index,
+                                 long length, const uint8_t *mask, harp_array data)
+{
+    long first;
+    long last;
+
+    assert(variable_def->read_sub_range != NULL);
+
+    first = 0;
+    while (first < length && !mask[first])
+    {
+        first++;
+    }
+    if (first == length)
+    {
+        /* nothing selected for this block */
+        return 0;
+    }
+    last = length - 1;
+    while (!mask[last])
+    {
+        last--;
+    }
+
+    if (2 * (last - first + 1) > length)
+    {
+        /* reading the full block will be at least as efficient */
+        return read_block(info, variable_def, index, data);
+    }
+
+    data.ptr = (void *)(((char *)data.ptr) + first * harp_get_size_for_type(variable_def->data_type));
+    harp_io_statistics_add_read(harp_io_backend_coda,
+                                (last - first + 1) * harp_get_size_for_type(variable_def->data_type));
+
+    return variable_def->read_sub_range(info->user_data, index, first, last - first + 1, data);
+}
+
 static int get_variable(ingest_info *info, const harp_variable_definition *variable_def,
                         const harp_dimension_mask_set *dimension_mask_set, harp_variable **new_variable)
 {
@@ -554,14 +717,14 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
 
             /* we read the whole non-time-dependent variable data once (in full) and then filter for each sample */
             num_buffer_elements = harp_get_num_elements(num_dimensions - 1, &dimension[1]);
-            if (read_buffer_new(variable->data_type, num_buffer_elements, &buffer) != 0)
+            if (read_buffer_acquire(info, variable->data_type, num_buffer_elements, &buffer) != 0)
             {
                 harp_variable_delete(variable);
                 return -1;
             }
             if (read_all(info, variable_def, buffer->data) != 0)
             {
-                read_buffer_delete(buffer);
+                read_buffer_release(info, buffer);
                 harp_variable_delete(variable);
                 return -1;
             }
@@ -610,7 +773,7 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
                 }
             }
 
-            read_buffer_delete(buffer);
+            read_buffer_release(info, buffer);
         }
         else
         {
@@ -638,7 +801,7 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
                     read_buffer *buffer;
 
                     num_buffer_elements = harp_get_num_elements(variable_def->num_dimensions - 1, &dimension[1]);
-                    if (read_buffer_new(variable->data_type, num_buffer_elements, &buffer) != 0)
+                    if (read_buffer_acquire(info, variable->data_type, num_buffer_elements, &buffer) != 0)
                     {
                         harp_variable_delete(variable);
                         return -1;
@@ -670,9 +833,19 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
                     {
                         if (mask[0] == NULL || mask[0][i])
                         {
-                            if (read_block(info, variable_def, i, buffer->data) != 0)
+                            if (variable_def->read_sub_range != NULL && mask[1] != NULL)
+                            {
+                                if (read_masked_sub_range(info, variable_def, i, dimension[1], mask[1],
+                                                          buffer->data) != 0)
+                                {
+                                    read_buffer_release(info, buffer);
+                                    harp_variable_delete(variable);
+                                    return -1;
+                                }
+                            }
+                            else if (read_block(info, variable_def, i, buffer->data) != 0)
                             {
-                                read_buffer_delete(buffer);
+                                read_buffer_release(info, buffer);
                                 harp_variable_delete(variable);
                                 return -1;
                             }
@@ -693,18 +866,75 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
                         }
                     }
 
-                    read_buffer_delete(buffer);
+                    read_buffer_release(info, buffer);
                 }
                 else
                 {
+                    long max_range_length = 0;
+
                     /* we can read directly into the variable */
                     assert(dimension_mask[0] != NULL);
+
+                    if (variable_def->read_block == NULL && variable_def->read_range != NULL)
+                    {
+                        /* runs of selected samples that span at least the maximum range length are read directly
+                         * using read_range() (in pieces of at most the maximum range length); shorter runs are read
+                         * via the buffered read_block() path */
+                        max_range_length = variable_def->get_optimal_range_length(info->user_data);
+                        if (max_range_length < 1)
+                        {
+                            max_range_length = 1;
+                        }
+                    }
+
                     for (i = 0; i < dimension[0]; i++)
                     {
                         if (!dimension_mask[0]->mask[i])
                         {
                             continue;
                         }
+                        if (max_range_length > 0)
+                        {
+                            long range_length = 1;
+
+                            while (i + range_length < dimension[0] && dimension_mask[0]->mask[i + range_length])
+                            {
+                                range_length++;
+                            }
+                            if (range_length < max_range_length)
+                            {
+                                for (j = 0; j < range_length; j++)
+                                {
+                                    if (read_block(info, variable_def, i + j, block) != 0)
+                                    {
+                                        harp_variable_delete(variable);
+                                        return -1;
+                                    }
+                                    block.ptr = (void *)(((char *)block.ptr) + block_stride);
+                                }
+                            }
+                            else
+                            {
+                                for (j = 0; j < range_length; j += max_range_length)
+                                {
+                                    long length = range_length - j;
+
+                                    if (length > max_range_length)
+                                    {
+                                        length = max_range_length;
+                                    }
+                                    add_read_statistics(info, variable_def, length);
+                                    if (variable_def->read_range(info->user_data, i + j, length, block) != 0)
+                                    {
+                                        harp_variable_delete(variable);
+                                        return -1;
+                                    }
+                                    block.ptr = (void *)(((char *)block.ptr) + length * block_stride);
+                                }
+                            }
+                            i += range_length - 1;
+                            continue;
+                        }
                         if (read_block(info, variable_def, i, block) != 0)
                         {
                             harp_variable_delete(variable);
@@ -941,14 +1171,14 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
 
     if (variable_def->num_dimensions == 0)
     {
-        if (read_buffer_new(variable_def->data_type, 1, &buffer) != 0)
+        if (read_buffer_acquire(info, variable_def->data_type, 1, &buffer) != 0)
         {
             return -1;
         }
 
         if (read_block(info, variable_def, 0, buffer->data) != 0)
         {
-            read_buffer_delete(buffer);
+            read_buffer_release(info, buffer);
             return -1;
         }
 
@@ -973,13 +1203,13 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
             if (result < 0)
             {
-                read_buffer_delete(buffer);
+                read_buffer_release(info, buffer);
                 return -1;
             }
             info->product_mask = result;
         }
 
-        read_buffer_delete(buffer);
+        read_buffer_release(info, buffer);
     }
     else if (variable_def->num_dimensions == 1 && variable_def->dimension_type[0] != harp_dimension_independent)
     {
@@ -1008,7 +1238,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
         }
 
-        if (read_buffer_new(variable_def->data_type, 1, &buffer) != 0)
+        if (read_buffer_acquire(info, variable_def->data_type, 1, &buffer) != 0)
         {
             if (info->dimension_mask_set[dimension_type]->num_dimensions == 2)
             {
@@ -1027,7 +1257,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
                     {
                         harp_dimension_mask_delete(dimension_mask);
                     }
-                    read_buffer_delete(buffer);
+                    read_buffer_release(info, buffer);
                     return -1;
                 }
 
@@ -1060,7 +1290,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
                             {
                                 harp_dimension_mask_delete(dimension_mask);
                             }
-                            read_buffer_delete(buffer);
+                            read_buffer_release(info, buffer);
                             return -1;
                         }
                         dimension_mask->mask[i] = result;
@@ -1073,7 +1303,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
         }
 
-        read_buffer_delete(buffer);
+        read_buffer_release(info, buffer);
 
         if (info->dimension_mask_set[dimension_type]->num_dimensions == 2)
         {
@@ -1131,7 +1361,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
         }
         dimension_mask = info->dimension_mask_set[dimension_type];
 
-        if (read_buffer_new(variable_def->data_type, info->dimension[dimension_type], &buffer) != 0)
+        if (read_buffer_acquire(info, variable_def->data_type, info->dimension[dimension_type], &buffer) != 0)
         {
             return -1;
         }
@@ -1145,50 +1375,50 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
 
                 if (read_block(info, variable_def, i, buffer->data) != 0)
                 {
-                    read_buffer_delete(buffer);
+                    read_buffer_release(info, buffer);
                     return -1;
                 }
 
-                for (j = 0; j < info->dimension[dimension_type]; j++)
+                for (k = 0; k < num_operations; k++)
                 {
-                    if (dimension_mask->mask[index])
+                    harp_operation *operation = program->operation[program->current_index + k];
+
+                    if (harp_operation_is_string_value_filter(operation))
                     {
-                        for (k = 0; k < num_operations; k++)
+                        harp_operation_string_value_filter *string_operation;
+
+                        string_operation = (harp_operation_string_value_filter *)operation;
+                        for (j = 0; j < info->dimension[dimension_type]; j++)
                         {
-                            if (dimension_mask->mask[index])
+                            if (dimension_mask->mask[index + j])
                             {
-                                harp_operation *operation = program->operation[program->current_index + k];
                                 int result;
 
-                                if (harp_operation_is_string_value_filter(operation))
-                                {
-                                    harp_operation_string_value_filter *string_operation;
-
-                                    string_operation = (harp_operation_string_value_filter *)operation;
-                                    result = string_operation->eval(string_operation, variable_def->num_enum_values,
-                                                                    variable_def->enum_name, variable_def->data_type,
-                                                                    &buffer->data.int8_data[j * data_type_size]);
-                                }
-                                else
-                                {
-                                    harp_operation_numeric_value_filter *numeric_operation;
-
-                                    numeric_operation = (harp_operation_numeric_value_filter *)operation;
-                                    result = numeric_operation->eval(numeric_operation, variable_def->data_type,
-                                                                     &buffer->data.int8_data[j * data_type_size]);
-                                }
+                                result = string_operation->eval(string_operation, variable_def->num_enum_values,
+                                                                variable_def->enum_name, variable_def->data_type,
+                                                                &buffer->data.int8_data[j * data_type_size]);
                                 if (result < 0)
                                 {
-                                    read_buffer_delete(buffer);
+                                    read_buffer_release(info, buffer);
                                     return -1;
                                 }
-                                dimension_mask->mask[index] = result;
+                                dimension_mask->mask[index + j] = result;
                             }
                         }
-                        if (dimension_mask->mask[index])
-                        {
-                            new_dimension_length++;
-                        }
+                    }
+                    else if (harp_operation_filter_numeric_values(operation, variable_def->data_type,
+                                                                  info->dimension[dimension_type], buffer->data.ptr,
+                                                                  &dimension_mask->mask[index]) != 0)
+                    {
+                        read_buffer_release(info, buffer);
+                        return -1;
+                    }
+                }
+                for (j = 0; j < info->dimension[dimension_type]; j++)
+                {
+                    if (dimension_mask->mask[index])
+                    {
+                        new_dimension_length++;
                     }
                     index++;
                 }
@@ -1211,7 +1441,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
         }
 
-        read_buffer_delete(buffer);
+        read_buffer_release(info, buffer);
     }
     else
     {
@@ -1234,11 +1464,13 @@ static int execute_point_filter(ingest_info *info, harp_program *program)
 {
     harp_variable_definition *latitude_def;
     harp_variable_definition *longitude_def;
+    harp_spherical_point *point;
     harp_variable *latitude;
     harp_variable *longitude;
     uint8_t *mask;
     int num_operations = 1;
     long num_points;
+    long num_removed;
     long i;
     int k;
 
@@ -1336,41 +1568,52 @@ static int execute_point_filter(ingest_info *info, harp_program *program)
 
     mask = info->dimension_mask_set[harp_dimension_time]->mask;
 
+    point = (harp_spherical_point *)malloc(num_points * sizeof(harp_spherical_point));
+    if (point == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_points * sizeof(harp_spherical_point), __FILE__, __LINE__);
+        harp_variable_delete(latitude);
+        harp_variable_delete(longitude);
+        return -1;
+    }
+
+    num_removed = 0;
     for (i = 0; i < num_points; i++)
     {
         if (mask[i])
         {
-            harp_spherical_point point;
-
-            point.lat = latitude->data.double_data[i];
-            point.lon = longitude->data.double_data[i];
-            harp_spherical_point_rad_from_deg(&point);
-            harp_spherical_point_check(&point);
-
-            for (k = 0; k < num_operations; k++)
-            {
-                if (mask[i])
-                {
-                    harp_operation_point_filter *operation;
-                    int result;
+            point[i].lat = latitude->data.double_data[i];
+            point[i].lon = longitude->data.double_data[i];
+            harp_spherical_point_rad_from_deg(&point[i]);
+            harp_spherical_point_check(&point[i]);
+            num_removed++;
+        }
+        else
+        {
+            point[i].lat = 0;
+            point[i].lon = 0;
+        }
+    }
 
-                    operation = (harp_operation_point_filter *)program->operation[program->current_index + k];
-                    result = operation->eval(operation, &point);
-                    if (result < 0)
-                    {
-                        harp_variable_delete(latitude);
-                        harp_variable_delete(longitude);
-                        return -1;
-                    }
-                    mask[i] = result;
-                }
-            }
-            if (!mask[i])
-            {
-                info->dimension_mask_set[harp_dimension_time]->masked_dimension_length--;
-            }
+    for (k = 0; k < num_operations; k++)
+    {
+        if (harp_operation_filter_points(program->operation[program->current_index + k], num_points, point, mask)
+            != 0)
+        {
+            harp_variable_delete(latitude);
+            harp_variable_delete(longitude);
+            free(point);
+            return -1;
         }
     }
+    free(point);
+
+    for (i = 0; i < num_points; i++)
+    {
+        num_removed -= mask[i];
+    }
+    info->dimension_mask_set[harp_dimension_time]->masked_dimension_length -= num_removed;
 
     if (dimension_mask_set_has_empty_masks(info->dimension_mask_set))
     {
@@ -1712,6 +1955,9 @@ static int evaluate_ingestion_mask(ingest_info *info, harp_program *program)
             case operation_bin_full:
             case operation_bin_spatial:
             case operation_bin_with_variable:
+            case operation_bit_round:
+            case operation_compute:
+            case operation_derive_all:
             case operation_derive_variable:
             case operation_derive_smoothed_column_collocated_dataset:
             case operation_derive_smoothed_column_collocated_product:
@@ -1719,11 +1965,15 @@ static int evaluate_ingestion_mask(ingest_info *info, harp_program *program)
             case operation_regrid:
             case operation_regrid_collocated_dataset:
             case operation_regrid_collocated_product:
+            case operation_regrid_spatial:
             case operation_rename:
+            case operation_sample_grid:
             case operation_set:
             case operation_smooth_collocated_dataset:
             case operation_smooth_collocated_product:
             case operation_sort:
+            case operation_sort_spatial:
+            case operation_sparsify:
             case operation_wrap:
                 /* these operations can only be performed on in-memory data */
                 return 0;
@@ -1740,12 +1990,8 @@ static int evaluate_ingestion_mask(ingest_info *info, harp_program *program)
     return 0;
 }
 
-/* Ingest a product while taking into account filter operations at the head of program.
- */
-static int get_product(ingest_info *info, harp_program *program)
+static int init_product(ingest_info *info)
 {
-    int i;
-
     if (harp_product_new(&info->product) != 0)
     {
         return -1;
@@ -1759,10 +2005,16 @@ static int get_product(ingest_info *info, harp_program *program)
         return -1;
     }
 
-    if (init_product_dimensions(info) != 0)
-    {
-        return -1;
-    }
+    return 0;
+}
+
+/* Read the variables of the product (applying the dimension masks that are already set) while taking into account
+ * filter operations at the head of program. The remaining operations are then executed on the in-memory product.
+ */
+static int read_product(ingest_info *info, harp_program *program)
+{
+    int i;
+
     if (init_variable_mask(info) != 0)
     {
         return -1;
@@ -1796,17 +2048,44 @@ static int get_product(ingest_info *info, harp_program *program)
     for (i = 0; i < info->product_definition->num_variable_definitions; i++)
     {
         harp_variable *variable;
+        double start_time = 0;
+        double start_cpu_time = 0;
 
         if (!info->variable_mask[i])
         {
             continue;
         }
 
+        if (info->variable_read_time != NULL || harp_option_profile)
+        {
+            start_cpu_time = harp_get_cpu_time();
+            start_time = harp_get_wall_time();
+        }
+        harp_trace_begin("ingest(%s)", info->product_definition->variable_definition[i]->name);
         if (get_variable(info, info->product_definition->variable_definition[i], info->dimension_mask_set,
                          &variable) != 0)
         {
+            harp_trace_end();
             return -1;
         }
+        harp_trace_end();
+        if (info->variable_read_time != NULL || harp_option_profile)
+        {
+            double wall_time = harp_get_wall_time() - start_time;
+
+            if (info->variable_read_time != NULL)
+            {
+                info->variable_read_time[i] += wall_time;
+            }
+            if (harp_option_profile)
+            {
+                char profile_name[256];
+
+                snprintf(profile_name, sizeof(profile_name), "ingest(%s)", variable->name);
+                harp_profile_add(profile_name, wall_time, harp_get_cpu_time() - start_cpu_time,
+                                 variable->num_elements * harp_get_size_for_type(variable->data_type));
+            }
+        }
 
         if (harp_product_add_variable(info->product, variable) != 0)
         {
@@ -1830,8 +2109,68 @@ static int get_product(ingest_info *info, harp_program *program)
     return 0;
 }
 
-static int ingest(const char *filename, harp_program *program, const harp_ingestion_options *option_list,
-                  harp_product **product)
+/* Ingest a product while taking into account filter operations at the head of program.
+ */
+static int get_product(ingest_info *info, harp_program *program)
+{
+    if (init_product(info) != 0)
+    {
+        return -1;
+    }
+    if (init_product_dimensions(info) != 0)
+    {
+        return -1;
+    }
+
+    return read_product(info, program);
+}
+
+/* Ingest the time samples [offset, offset + length) of a product while taking into account filter operations at the
+ * head of program. The product dimensions should already have been initialized.
+ * If the product has no time dimension then the full product is ingested.
+ */
+static int get_product_time_range(ingest_info *info, harp_program *program, long offset, long length)
+{
+    /* reset the state of a possible previous range */
+    harp_product_delete(info->product);
+    info->product = NULL;
+    if (info->variable_mask != NULL)
+    {
+        free(info->variable_mask);
+        info->variable_mask = NULL;
+    }
+    harp_dimension_mask_set_delete(info->dimension_mask_set);
+    info->dimension_mask_set = NULL;
+    info->product_mask = 1;
+
+    if (harp_dimension_mask_set_new(&info->dimension_mask_set) != 0)
+    {
+        return -1;
+    }
+    if (info->dimension[harp_dimension_time] > 0)
+    {
+        harp_dimension_mask *time_mask;
+        long dimension = info->dimension[harp_dimension_time];
+
+        if (harp_dimension_mask_new(1, &dimension, &info->dimension_mask_set[harp_dimension_time]) != 0)
+        {
+            return -1;
+        }
+        time_mask = info->dimension_mask_set[harp_dimension_time];
+        memset(time_mask->mask, 0, (size_t)dimension * sizeof(uint8_t));
+        memset(&time_mask->mask[offset], 1, (size_t)length * sizeof(uint8_t));
+        time_mask->masked_dimension_length = length;
+    }
+
+    if (init_product(info) != 0)
+    {
+        return -1;
+    }
+
+    return read_product(info, program);
+}
+
+static int open_product(const char *filename, const harp_ingestion_options *option_list, ingest_info **new_info)
 {
     ingest_info *info;
 
@@ -1839,7 +2178,7 @@ static int ingest(const char *filename, harp_program *program, const harp_ingest
     {
         return -1;
     }
-    if (harp_ingestion_find_module(filename, &info->module, &info->cproduct) != 0)
+    if (harp_ingestion_find_module(filename, option_list, &info->module, &info->cproduct) != 0)
     {
         ingestion_done(info);
         return -1;
@@ -1849,11 +2188,13 @@ static int ingest(const char *filename, harp_program *program, const harp_ingest
         ingestion_done(info);
         return -1;
     }
+    harp_trace_begin("open(%s)", info->module->name);
     if (info->cproduct != NULL && info->module->ingestion_init_coda != NULL)
     {
         if (info->module->ingestion_init_coda(info->module, info->cproduct, option_list, &info->product_definition,
                                               &info->user_data) != 0)
         {
+            harp_trace_end();
             ingestion_done(info);
             return -1;
         }
@@ -1864,14 +2205,30 @@ static int ingest(const char *filename, harp_program *program, const harp_ingest
         if (info->module->ingestion_init_custom(info->module, filename, option_list, &info->product_definition,
                                                 &info->user_data) != 0)
         {
+            harp_trace_end();
             ingestion_done(info);
             return -1;
         }
     }
+    harp_trace_end();
     assert(info->product_definition != NULL);
 
     info->basename = harp_basename(filename);
 
+    *new_info = info;
+    return 0;
+}
+
+static int ingest(const char *filename, harp_program *program, const harp_ingestion_options *option_list,
+                  harp_product **product)
+{
+    ingest_info *info;
+
+    if (open_product(filename, option_list, &info) != 0)
+    {
+        return -1;
+    }
+
     /* ingest the product */
     if (get_product(info, program) != 0)
     {
@@ -1887,9 +2244,32 @@ static int ingest(const char *filename, harp_program *program, const harp_ingest
     return 0;
 }
 
-int harp_ingest(const char *filename, const char *operations, const char *options, harp_product **product)
+static void set_coda_options(int *perform_conversions, int *perform_boundary_checks)
 {
-    harp_program *program;
+    /* all ingestion routines that use CODA are build on the assumption that 'perform conversions' is enabled, so we
+     * explicitly enable it here just in case it was disabled somewhere else */
+    *perform_conversions = coda_get_option_perform_conversions();
+    coda_set_option_perform_conversions(1);
+
+    /* we also disable the boundary checks of libcoda for increased ingestion performance */
+    *perform_boundary_checks = coda_get_option_perform_boundary_checks();
+    coda_set_option_perform_boundary_checks(0);
+}
+
+static void restore_coda_options(int perform_conversions, int perform_boundary_checks)
+{
+    /* set the libcoda options back to their original values */
+    coda_set_option_perform_boundary_checks(perform_boundary_checks);
+    coda_set_option_perform_conversions(perform_conversions);
+}
+
+/* Ingest a product using an ingestion module.
+ * The program is optional (can be NULL); it is executed from its first operation and can be reused for other
+ * ingestions afterwards.
+ */
+int harp_ingest(const char *filename, harp_program *program, const char *options, harp_product **product)
+{
+    harp_program *empty_program = NULL;
     harp_ingestion_options *option_list;
     int perform_conversions;
     int perform_boundary_checks;
@@ -1912,26 +2292,20 @@ int harp_ingest(const char *filename, const char *operations, const char *option
         return -1;
     }
 
-    if (operations == NULL)
+    if (program == NULL)
     {
-        if (harp_program_new(&program) != 0)
-        {
-            return -1;
-        }
-    }
-    else
-    {
-        if (harp_program_from_string(operations, &program) != 0)
+        if (harp_program_new(&empty_program) != 0)
         {
             return -1;
         }
+        program = empty_program;
     }
 
     if (options == NULL)
     {
         if (harp_ingestion_options_new(&option_list) != 0)
         {
-            harp_program_delete(program);
+            harp_program_delete(empty_program);
             return -1;
         }
     }
@@ -1939,31 +2313,178 @@ int harp_ingest(const char *filename, const char *operations, const char *option
     {
         if (harp_ingestion_options_from_string(options, &option_list) != 0)
         {
-            harp_program_delete(program);
+            harp_program_delete(empty_program);
             return -1;
         }
     }
 
-    /* all ingestion routines that use CODA are build on the assumption that 'perform conversions' is enabled, so we
-     * explicitly enable it here just in case it was disabled somewhere else */
-    perform_conversions = coda_get_option_perform_conversions();
-    coda_set_option_perform_conversions(1);
-
-    /* we also disable the boundary checks of libcoda for increased ingestion performance */
-    perform_boundary_checks = coda_get_option_perform_boundary_checks();
-    coda_set_option_perform_boundary_checks(0);
-
+    set_coda_options(&perform_conversions, &perform_boundary_checks);
+    harp_program_start_execution(program);
     status = ingest(filename, program, option_list, product);
-
-    /* set the libcoda options back to their original values */
-    coda_set_option_perform_boundary_checks(perform_boundary_checks);
-    coda_set_option_perform_conversions(perform_conversions);
+    harp_program_end_execution(program);
+    restore_coda_options(perform_conversions, perform_boundary_checks);
 
     harp_ingestion_options_delete(option_list);
-    harp_program_delete(program);
+    harp_program_delete(empty_program);
     return status;
 }
 
+/* Close an ingestion stream and release all its resources.
+ */
+void harp_ingest_stream_close(harp_ingest_stream *stream)
+{
+    if (stream != NULL)
+    {
+        ingestion_done(stream->info);
+        harp_ingestion_options_delete(stream->option_list);
+        if (stream->filename != NULL)
+        {
+            free(stream->filename);
+        }
+        free(stream);
+    }
+}
+
+/* Open a product for ingestion in chunks of (at most) chunk_size time samples using an ingestion module.
+ * The ingestion module (and the underlying file) stays open until the stream is closed; this allows the ingestion
+ * module to read each chunk using its read_range/read_block callbacks without having to read the full product.
+ * The program is executed on each chunk separately (from its first operation), so it should only contain operations
+ * that treat each time sample independently (see harp_program_verify_sample_independent()).
+ * The program is not copied and should remain available (and unmodified) until the stream is closed.
+ */
+int harp_ingest_stream_open(const char *filename, harp_program *program, const char *options, long chunk_size,
+                            harp_ingest_stream **new_stream)
+{
+    harp_ingest_stream *stream;
+    int perform_conversions;
+    int perform_boundary_checks;
+    int status;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (program == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "program is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (chunk_size <= 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid chunk size (%ld) (%s:%u)", chunk_size, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    if (harp_ingestion_init() != 0)
+    {
+        return -1;
+    }
+
+    stream = (harp_ingest_stream *)malloc(sizeof(harp_ingest_stream));
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_ingest_stream), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->info = NULL;
+    stream->option_list = NULL;
+    stream->program = program;
+    stream->filename = NULL;
+    stream->chunk_size = chunk_size;
+    stream->offset = 0;
+
+    stream->filename = strdup(filename);
+    if (stream->filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_ingest_stream_close(stream);
+        return -1;
+    }
+
+    if (options == NULL)
+    {
+        status = harp_ingestion_options_new(&stream->option_list);
+    }
+    else
+    {
+        status = harp_ingestion_options_from_string(options, &stream->option_list);
+    }
+    if (status != 0)
+    {
+        harp_ingest_stream_close(stream);
+        return -1;
+    }
+
+    set_coda_options(&perform_conversions, &perform_boundary_checks);
+    status = open_product(stream->filename, stream->option_list, &stream->info);
+    if (status == 0)
+    {
+        status = init_product_dimensions(stream->info);
+    }
+    restore_coda_options(perform_conversions, perform_boundary_checks);
+    if (status != 0)
+    {
+        harp_ingest_stream_close(stream);
+        return -1;
+    }
+
+    *new_stream = stream;
+    return 0;
+}
+
+/* Ingest the next chunk of time samples of a stream.
+ * Chunks for which no samples remain after executing the program are skipped.
+ * At the end of the stream *product is set to NULL.
+ */
+int harp_ingest_stream_next(harp_ingest_stream *stream, harp_product **product)
+{
+    ingest_info *info = stream->info;
+    long num_samples;
+
+    /* a product without time dimension is ingested as a single chunk */
+    num_samples = info->dimension[harp_dimension_time] > 0 ? info->dimension[harp_dimension_time] : 1;
+
+    while (stream->offset < num_samples)
+    {
+        int perform_conversions;
+        int perform_boundary_checks;
+        long length;
+        int status;
+
+        length = num_samples - stream->offset;
+        if (length > stream->chunk_size)
+        {
+            length = stream->chunk_size;
+        }
+
+        set_coda_options(&perform_conversions, &perform_boundary_checks);
+        harp_program_start_execution(stream->program);
+        status = get_product_time_range(info, stream->program, stream->offset, length);
+        harp_program_end_execution(stream->program);
+        restore_coda_options(perform_conversions, perform_boundary_checks);
+        if (status != 0)
+        {
+            return -1;
+        }
+
+        stream->offset += length;
+
+        if (info->product_mask != 0 && !harp_product_is_empty(info->product))
+        {
+            *product = info->product;
+            info->product = NULL;
+            return 0;
+        }
+    }
+
+    *product = NULL;
+    return 0;
+}
+
 static int ingest_metadata(const char *filename, const harp_ingestion_options *option_list, double *datetime_start,
                            double *datetime_stop, long dimension[])
 {
@@ -1974,7 +2495,7 @@ static int ingest_metadata(const char *filename, const harp_ingestion_options *o
     {
         return -1;
     }
-    if (harp_ingestion_find_module(filename, &info->module, &info->cproduct) != 0)
+    if (harp_ingestion_find_module(filename, option_list, &info->module, &info->cproduct) != 0)
     {
         ingestion_done(info);
         return -1;
@@ -2040,6 +2561,29 @@ static int ingest_metadata(const char *filename, const harp_ingestion_options *o
         return 0;
     }
 
+    if (info->product_definition->read_datetime_range != NULL)
+    {
+        double start;
+        double stop;
+        int result;
+
+        /* let the ingestion module determine the range without reading the full datetime variables */
+        result = info->product_definition->read_datetime_range(info->user_data, &start, &stop);
+        if (result < 0)
+        {
+            ingestion_done(info);
+            return -1;
+        }
+        if (result == 0)
+        {
+            /* convert from seconds since 2000 to days since 2000 */
+            *datetime_start = start / 86400.0;
+            *datetime_stop = stop / 86400.0;
+            ingestion_done(info);
+            return 0;
+        }
+    }
+
     /* read all (available) variables whose name starts with 'datetime' */
     for (i = 0; i < info->product_definition->num_variable_definitions; i++)
     {
@@ -2080,6 +2624,146 @@ static int ingest_metadata(const char *filename, const harp_ingestion_options *o
     return 0;
 }
 
+/* Ingest a product using an ingestion module and report the time spent on opening the product and on reading it, the
+ * size of the product file and the size of the ingested data (optionally also per variable).
+ * Results are printed using the provided print function (which should resemble printf()).
+ */
+int harp_ingest_benchmark(const char *filename, const char *options, int show_variables,
+                          int (*print) (const char *, ...))
+{
+    harp_ingestion_options *option_list;
+    harp_program *program;
+    ingest_info *info;
+    int64_t file_size;
+    int64_t data_size;
+    double start_time;
+    double start_cpu_time;
+    double open_time;
+    double read_time;
+    int perform_conversions;
+    int perform_boundary_checks;
+    int status;
+    int i;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (harp_get_file_size(filename, &file_size) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_ingestion_init() != 0)
+    {
+        return -1;
+    }
+
+    if (options == NULL)
+    {
+        status = harp_ingestion_options_new(&option_list);
+    }
+    else
+    {
+        status = harp_ingestion_options_from_string(options, &option_list);
+    }
+    if (status != 0)
+    {
+        return -1;
+    }
+    if (harp_program_new(&program) != 0)
+    {
+        harp_ingestion_options_delete(option_list);
+        return -1;
+    }
+
+    set_coda_options(&perform_conversions, &perform_boundary_checks);
+
+    start_time = harp_get_wall_time();
+    start_cpu_time = harp_get_cpu_time();
+    status = open_product(filename, option_list, &info);
+    open_time = harp_get_wall_time() - start_time;
+    if (status == 0)
+    {
+        info->variable_read_time = calloc(info->product_definition->num_variable_definitions, sizeof(double));
+        if (info->variable_read_time == NULL && info->product_definition->num_variable_definitions > 0)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           info->product_definition->num_variable_definitions * sizeof(double), __FILE__,
+                           __LINE__);
+            ingestion_done(info);
+            status = -1;
+        }
+    }
+    if (status == 0)
+    {
+        harp_program_start_execution(program);
+        status = get_product(info, program);
+        harp_program_end_execution(program);
+        if (status != 0)
+        {
+            ingestion_done(info);
+        }
+    }
+    read_time = harp_get_wall_time() - start_time - open_time;
+
+    restore_coda_options(perform_conversions, perform_boundary_checks);
+    harp_program_delete(program);
+    harp_ingestion_options_delete(option_list);
+
+    if (status != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_get_storage_size(info->product, 0, &data_size) != 0)
+    {
+        ingestion_done(info);
+        return -1;
+    }
+
+    print("module: %s\n", info->module->name);
+    print("product definition: %s\n", info->product_definition->name);
+    print("file size: %ld bytes\n", (long)file_size);
+    print("ingested data size: %ld bytes\n", (long)data_size);
+    print("number of variables: %d\n", info->product->num_variables);
+    print("open time: %.6f s\n", open_time);
+    print("read time: %.6f s\n", read_time);
+    print("cpu time: %.6f s\n", harp_get_cpu_time() - start_cpu_time);
+    if (open_time + read_time > 0)
+    {
+        print("throughput: %.3f MB/s (file), %.3f MB/s (ingested data)\n",
+              file_size / (open_time + read_time) / 1.0e6, data_size / (open_time + read_time) / 1.0e6);
+    }
+    if (show_variables)
+    {
+        for (i = 0; i < info->product_definition->num_variable_definitions; i++)
+        {
+            harp_variable *variable;
+
+            if (!info->variable_mask[i])
+            {
+                continue;
+            }
+            if (harp_product_get_variable_by_name(info->product,
+                                                  info->product_definition->variable_definition[i]->name,
+                                                  &variable) != 0)
+            {
+                /* variable was removed by the ingestion mask evaluation */
+                continue;
+            }
+            print("variable %s: %.6f s, %ld bytes\n", variable->name, info->variable_read_time[i],
+                  variable->num_elements * harp_get_size_for_type(variable->data_type));
+        }
+    }
+
+    ingestion_done(info);
+
+    return 0;
+}
+
 int harp_ingest_global_attributes(const char *filename, const char *options, double *datetime_start,
                                   double *datetime_stop, long dimension[], char **source_product)
 {
@@ -2203,7 +2887,7 @@ int harp_ingest_test(const char *filename, int (*print) (const char *, ...))
     perform_boundary_checks = coda_get_option_perform_boundary_checks();
     coda_set_option_perform_boundary_checks(0);
 
-    result = harp_ingestion_find_module(filename, &module, &product);
+    result = harp_ingestion_find_module(filename, NULL, &module, &product);
     if (result == 0)
     {
         num_options = module->num_option_definitions;
@@ -2325,6 +3009,7 @@ int harp_ingest_test(const char *filename, int (*print) (const char *, ...))
     }
     if (product != NULL)
     {
+        harp_io_statistics_add_close(harp_io_backend_coda);
         coda_close(product);
     }
 
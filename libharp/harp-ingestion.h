@@ -84,6 +84,9 @@ typedef struct harp_variable_definition_struct
     int (*read_range) (void *user_data, long index_offset, long index_length, harp_array data);
     long (*get_optimal_range_length) (void *user_data);
     int (*read_block) (void *user_data, long index, harp_array data);
+    /* optional; reads elements [sub_offset, sub_offset + sub_length) of the second dimension for a single index of the
+     * first dimension (used when a dimension mask only selects part of the second dimension) */
+    int (*read_sub_range) (void *user_data, long index, long sub_offset, long sub_length, harp_array data);
 
     int num_mappings;
     harp_mapping_description **mapping;
@@ -99,6 +102,9 @@ typedef struct harp_product_definition_struct
     struct hashtable_struct *variable_definition_hash_data;
 
     int (*read_dimensions) (void *user_data, long dimension[HARP_NUM_DIM_TYPES]);
+    /* optional; determines the datetime range (in seconds since 2000-01-01) that the datetime variables of the product
+     * cover without reading them in full (returns 1 if the range can not be determined this way) */
+    int (*read_datetime_range) (void *user_data, double *datetime_start, double *datetime_stop);
 
     char *ingestion_option;
     char *mapping_description;
@@ -119,9 +125,11 @@ struct harp_ingestion_module_struct
 
     int num_product_definitions;
     harp_product_definition **product_definition;
+    struct hashtable_struct *product_definition_hash_data;
 
     int num_option_definitions;
     harp_ingestion_option_definition **option_definition;
+    struct hashtable_struct *option_definition_hash_data;
 
     int (*verify_product_type) (const harp_ingestion_module *module, const char *filename);
     int (*ingestion_init_coda) (const harp_ingestion_module *module, coda_product *product,
@@ -137,8 +145,16 @@ typedef struct harp_ingestion_module_register_struct
 {
     int num_ingestion_modules;
     harp_ingestion_module **ingestion_module;
+
+    /* lookup of modules by name and by '<product class>/<product type>'; both map to an index in ingestion_module */
+    struct hashtable_struct *module_name_hash_data;
+    struct hashtable_struct *product_type_hash_data;
+    char **product_type_key;
 } harp_ingestion_module_register;
 
+/* Name of the ingestion option that selects the ingestion module directly (skipping product type detection). */
+#define HARP_INGESTION_MODULE_OPTION "module"
+
 /* Ingestion options. */
 int harp_ingestion_options_new(harp_ingestion_options **new_options);
 int harp_ingestion_options_copy(const harp_ingestion_options *other_options, harp_ingestion_options **new_options);
@@ -167,6 +183,9 @@ void harp_variable_definition_set_valid_range_double(harp_variable_definition *v
                                                      double valid_max);
 void harp_variable_definition_set_enumeration_values(harp_variable_definition *variable_definition, int num_enum_values,
                                                      const char **enum_name);
+void harp_variable_definition_set_sub_range_read(harp_variable_definition *variable_definition,
+                                                 int (*read_sub_range) (void *user_data, long index, long sub_offset,
+                                                                        long sub_length, harp_array data));
 
 int harp_variable_definition_has_dimension_types(const harp_variable_definition *variable_definition,
                                                  int num_dimensions, const harp_dimension_type *dimension_type);
@@ -177,6 +196,10 @@ int harp_variable_definition_exclude(const harp_variable_definition *variable_de
 /* Product definition. */
 void harp_product_definition_add_mapping(harp_product_definition *product_definition, const char *mapping_description,
                                          const char *ingestion_option);
+void harp_product_definition_set_datetime_range_read(harp_product_definition *product_definition,
+                                                     int (*read_datetime_range) (void *user_data,
+                                                                                 double *datetime_start,
+                                                                                 double *datetime_stop));
 int harp_product_definition_has_dimension_type(const harp_product_definition *product_definition,
                                                harp_dimension_type dimension_type);
 int harp_product_definition_has_variable(const harp_product_definition *product_definition, const char *name);
@@ -185,10 +208,13 @@ harp_variable_definition *harp_product_definition_find_variable(const harp_produ
 int harp_product_definition_get_variable_index(const harp_product_definition *product_definition, const char *name);
 
 /* Ingestion module. */
+harp_product_definition *harp_ingestion_module_find_product_definition(const harp_ingestion_module *module,
+                                                                       const char *name);
 int harp_ingestion_module_validate_options(harp_ingestion_module *module, const harp_ingestion_options *options);
 
 /* Module register. */
-int harp_ingestion_find_module(const char *filename, harp_ingestion_module **module, coda_product **product);
+int harp_ingestion_find_module(const char *filename, const harp_ingestion_options *options,
+                               harp_ingestion_module **module, coda_product **product);
 harp_ingestion_module_register *harp_ingestion_get_module_register(void);
 
 /* Convenience functions. */
@@ -242,6 +268,13 @@ harp_variable_definition *harp_ingestion_register_variable_block_read(harp_produ
                                                                       int (*read_block) (void *user_data, long index,
                                                                                          harp_array data));
 
+/* CODA cursor path cache. */
+typedef struct harp_coda_path_cache_struct harp_coda_path_cache;
+
+int harp_coda_path_cache_new(harp_coda_path_cache **new_cache);
+void harp_coda_path_cache_delete(harp_coda_path_cache *cache);
+int harp_coda_path_cache_goto(harp_coda_path_cache *cache, coda_cursor *cursor, const char *path);
+
 /* Initialization and clean-up. */
 int harp_ingestion_init(void);
 
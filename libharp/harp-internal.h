@@ -62,21 +62,167 @@
 /* maximum length for file paths */
 #define HARP_MAX_PATH_LENGTH 4096
 
+/* maximum value for the num_threads option */
+#define HARP_MAX_NUM_THREADS 1024
+
+/* range for the percentile_compression option */
+#define HARP_MIN_PERCENTILE_COMPRESSION 10
+#define HARP_MAX_PERCENTILE_COMPRESSION 10000
+
 /* clamp function */
 #define HARP_CLAMP(var, min, max) if (var < min) var = min; if (var > max) var = max;
 
-extern int harp_option_enable_aux_afgl86;
-extern int harp_option_enable_aux_usstd76;
+extern int harp_option_enable_dataset_index;
+extern int harp_option_optimize_operations;
+extern int harp_option_keep_float;
+extern int harp_option_trusted_import;
+extern int harp_option_profile;
+extern int harp_option_trace;
+extern int64_t harp_option_memory_limit;
+extern int harp_option_huge_pages;
+extern int harp_option_numa_policy;
+extern int64_t harp_option_buffer_pool_size;
+extern int harp_option_num_threads;
+extern int64_t harp_option_product_cache_size;
+extern int64_t harp_option_collocated_product_cache_size;
+extern int harp_option_percentile_compression;
+
+/* The options that can be changed by the set() operation.
+ * Each execution of a program (see harp_program_start_execution()) gets its own copy of these options, which is used
+ * instead of the process-wide values by the thread that executes the program (and by the tasks it runs), such that
+ * concurrent executions do not affect each other or the process-wide values.
+ */
+typedef struct harp_execution_options_struct
+{
+    int enable_aux_afgl86;
+    int enable_aux_usstd76;
+    int regrid_out_of_bounds;
+    int wgs84_point_distance;
+} harp_execution_options;
+
+harp_execution_options *harp_get_execution_options(void);
+void harp_set_execution_options(harp_execution_options *options);
 
 typedef int (*harp_conversion_function) (harp_variable *variable, const harp_variable **source_variable);
 typedef int (*harp_conversion_enabled_function) (void);
 
+/* Describes whether the data of a conversion can be calculated in parts (on separate threads).
+ * element parallel: each element of the result only depends on the elements with the same index in the sources
+ *   (all sources have the same number of elements as the result).
+ * time parallel: each time sample of the result only depends on the same time sample of the sources
+ *   (the result and all sources have time as first dimension).
+ */
+typedef enum harp_conversion_parallelism_enum
+{
+    harp_conversion_sequential,
+    harp_conversion_element_parallel,
+    harp_conversion_time_parallel
+} harp_conversion_parallelism;
+
 typedef enum harp_collocation_filter_type_enum
 {
     harp_collocation_left,
     harp_collocation_right
 } harp_collocation_filter_type;
 
+/* file access backends for which I/O statistics are kept (see harp_get_io_statistics()) */
+typedef enum harp_io_backend_enum
+{
+    harp_io_backend_coda,
+    harp_io_backend_hdf4,
+    harp_io_backend_hdf5,
+    harp_io_backend_netcdf,
+    harp_io_backend_zarr,
+    harp_io_backend_arrow
+} harp_io_backend;
+
+#define HARP_NUM_IO_BACKENDS 6
+
+/* statistics that the binning operations can compute per variable in addition to the (default) average */
+typedef enum harp_bin_aggregation_type_enum
+{
+    harp_bin_aggregation_mean,  /* the default average of the binned variable itself */
+    harp_bin_aggregation_sum,
+    harp_bin_aggregation_count,
+    harp_bin_aggregation_min,
+    harp_bin_aggregation_max,
+    harp_bin_aggregation_stdev,
+    harp_bin_aggregation_weighted_mean, /* average weighted by 1/uncertainty^2 */
+    harp_bin_aggregation_median,
+    harp_bin_aggregation_percentile     /* percentile 'p<N>' (N = 0..100) */
+} harp_bin_aggregation_type;
+
+typedef struct harp_bin_aggregation_list_struct
+{
+    long num_aggregations;
+    char **variable_name;
+    harp_bin_aggregation_type *type;
+    int *percentile;    /* percentile for median (50) and percentile aggregations (0 for all other types) */
+} harp_bin_aggregation_list;
+
+/* instructions of the compiled form of a compute() expression
+ * an expression is stored as a postfix program that operates on a stack of blocks of values
+ */
+typedef enum harp_expression_opcode_enum
+{
+    harp_expression_push_constant,      /* argument = index in constant list */
+    harp_expression_push_variable,      /* argument = index in variable list */
+    harp_expression_negate,
+    harp_expression_logical_not,
+    harp_expression_add,
+    harp_expression_subtract,
+    harp_expression_multiply,
+    harp_expression_divide,
+    harp_expression_power,
+    harp_expression_equal,
+    harp_expression_not_equal,
+    harp_expression_less,
+    harp_expression_less_equal,
+    harp_expression_greater,
+    harp_expression_greater_equal,
+    harp_expression_logical_and,
+    harp_expression_logical_or,
+    harp_expression_bit_and,
+    harp_expression_bit_or,
+    harp_expression_abs,
+    harp_expression_sqrt,
+    harp_expression_exp,
+    harp_expression_log,
+    harp_expression_log10,
+    harp_expression_sin,
+    harp_expression_cos,
+    harp_expression_tan,
+    harp_expression_asin,
+    harp_expression_acos,
+    harp_expression_atan,
+    harp_expression_floor,
+    harp_expression_ceil,
+    harp_expression_round,
+    harp_expression_isnan,
+    harp_expression_atan2,
+    harp_expression_min,
+    harp_expression_max,
+    harp_expression_where
+} harp_expression_opcode;
+
+typedef struct harp_expression_instruction_struct
+{
+    harp_expression_opcode opcode;
+    int argument;
+} harp_expression_instruction;
+
+typedef struct harp_expression_struct
+{
+    int num_instructions;
+    harp_expression_instruction *instruction;
+    int num_constants;
+    double *constant;
+    int num_variables;
+    char **variable_name;
+    char **variable_unit;       /* unit to which the variable is converted before evaluation (can be NULL) */
+    int stack_size;     /* maximum number of blocks on the evaluation stack */
+} harp_expression;
+
 /* dimsvar_name is the variable name prefixed with HARP_MAX_NUM_DIMS characters defining the dimension types
  * dimsvar_name is thus the unique name for the combination of variable name + dimension types
  * the character code for a dimension type is: '0' + dimension_type, which gives:
@@ -108,6 +254,7 @@ typedef struct harp_variable_conversion_struct
     char *source_description;
     harp_conversion_function set_variable_data;
     harp_conversion_enabled_function enabled;
+    harp_conversion_parallelism parallelism;
 } harp_variable_conversion;
 
 typedef struct harp_variable_conversion_list_struct
@@ -129,6 +276,35 @@ extern harp_derived_variable_list *harp_derived_variable_conversions;
 int harp_path_find_file(const char *searchpath, const char *filename, char **location);
 int harp_path_from_path(const char *initialpath, int is_filepath, const char *appendpath, char **resultpath);
 int harp_path_for_program(const char *argv0, char **location);
+int harp_get_file_size(const char *filename, int64_t *size);
+int harp_is_remote_url(const char *filename);
+double harp_get_wall_time(void);
+double harp_get_cpu_time(void);
+void harp_profile_add(const char *name, double wall_time, double cpu_time, int64_t size_change);
+void harp_profile_done(void);
+int harp_trace_open(const char *filename);
+void harp_trace_close(void);
+const char *harp_trace_get_filename(void);
+void harp_trace_begin(const char *format, ...);
+void harp_trace_end(void);
+int harp_product_cache_set_directory(const char *directory);
+const char *harp_product_cache_get_directory(void);
+int harp_product_cache_get_entry_path(const char *filename, const harp_program *program, const char *options,
+                                      char **path);
+int harp_product_cache_has_entry(const char *path);
+void harp_product_cache_remove_entry(const char *path);
+void harp_product_cache_add_entry(const char *path, const harp_product *product);
+int harp_memory_reserve(int64_t size);
+void harp_memory_release(int64_t size);
+int harp_memory_set_large_block_allocator(int enable);
+int harp_memory_set_buffer_pool_size(int64_t max_size);
+void *harp_malloc(size_t size);
+void *harp_calloc(size_t num_elements, size_t element_size);
+void *harp_realloc(void *ptr, size_t size);
+void harp_free(void *ptr);
+void harp_io_statistics_add_open(harp_io_backend backend);
+void harp_io_statistics_add_close(harp_io_backend backend);
+void harp_io_statistics_add_read(harp_io_backend backend, int64_t num_bytes);
 int harp_is_identifier(const char *name);
 long harp_parse_double(const char *buffer, long buffer_length, double *dst, int ignore_trailing_bytes);
 long harp_get_max_string_length(long num_strings, char **string_data);
@@ -138,9 +314,14 @@ long harp_get_num_elements(int num_dimensions, const long *dimension);
 void harp_array_null(harp_data_type data_type, long num_elements, harp_array data);
 void harp_array_replace_fill_value(harp_data_type data_type, long num_elements, harp_array data,
                                    harp_scalar fill_value);
+long harp_array_replace_invalid_values(harp_data_type data_type, long num_elements, harp_array data,
+                                       const harp_scalar *fill_value, const harp_scalar *valid_min,
+                                       const harp_scalar *valid_max);
 int harp_array_invert(harp_data_type data_type, int dim_id, int num_dimensions, const long *dimension, harp_array data);
 int harp_array_transpose(harp_data_type data_type, int num_dimensions, const long *dimension, const int *order,
                          harp_array data);
+int harp_array_transpose_to(harp_data_type data_type, int num_dimensions, const long *dimension, const int *order,
+                            harp_array src, harp_array dst);
 
 /* Auxiliary data sources */
 int harp_aux_afgl86_get_profile(const char *name, double datetime, double latitude, int *num_vertical,
@@ -162,11 +343,35 @@ int harp_variable_get_flag_meanings_string(const harp_variable *variable, char *
 int harp_variable_set_enumeration_values_using_flag_meanings(harp_variable *variable, const char *flag_meanings);
 int harp_variable_add_dimension(harp_variable *variable, int dim_index, harp_dimension_type dimension_type,
                                 long length);
+/* a data buffer released by a rearranged variable that can be reused for the next variable (size is in bytes) */
+typedef struct harp_spare_buffer_struct
+{
+    void *data;
+    int64_t size;
+} harp_spare_buffer;
+
+void harp_spare_buffer_done(harp_spare_buffer *spare);
+int harp_variable_permute_dimension(harp_variable *variable, int dim_index, const long *permutation,
+                                    harp_spare_buffer *spare);
+int harp_variable_move_dimension(harp_variable *variable, int dim_index, int new_dim_index, harp_spare_buffer *spare);
 int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, long num_dim_elements,
                                       const long *dim_element_ids);
+int harp_variable_rearrange_dimension_with_spare(harp_variable *variable, int dim_index, long num_dim_elements,
+                                                 const long *dim_element_ids, harp_spare_buffer *spare);
 int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const uint8_t *mask);
 int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long length);
+int harp_variable_reserve_time_dimension(harp_variable *variable, long length);
 int harp_variable_remove_dimension(harp_variable *variable, int dim_index, long index);
+int harp_variable_reallocate_data(harp_variable *variable, long num_elements);
+int harp_variable_set_string_data_from_char_array(harp_variable *variable, long string_length, const char *buffer);
+void harp_variable_free_strings(harp_variable *variable, long offset, long num_elements);
+int harp_variable_make_strings_owned(harp_variable *variable);
+int harp_variable_new_with_shared_block(const char *name, harp_data_type data_type, int num_dimensions,
+                                        const harp_dimension_type *dimension_type, const long *dimension, void *data,
+                                        void *block, harp_variable **new_variable);
+int harp_shared_block_new(void *ptr, int64_t size, void (*release) (void *ptr, int64_t size), void **new_block);
+void harp_shared_block_release(void *block);
+int harp_variable_verify_structure(const harp_variable *variable);
 
 /* Products */
 int harp_product_rearrange_dimension(harp_product *product, harp_dimension_type dimension_type, long num_dim_elements,
@@ -174,48 +379,121 @@ int harp_product_rearrange_dimension(harp_product *product, harp_dimension_type
 int harp_product_filter_by_index(harp_product *product, const char *index_variable, long num_elements, int32_t *index);
 int harp_product_filter_dimension(harp_product *product, harp_dimension_type dimension_type, const uint8_t *mask);
 int harp_product_remove_dimension(harp_product *product, harp_dimension_type dimension_type);
+int harp_product_resize_dimension(harp_product *product, harp_dimension_type dimension_type, long length);
+int harp_product_make_time_dependent(harp_product *product);
 void harp_product_remove_all_variables(harp_product *product);
+int harp_product_verify_structure(const harp_product *product);
 int harp_product_get_datetime_range(const harp_product *product, double *datetime_start, double *datetime_stop);
+int harp_product_get_spatial_extent(const harp_product *product, double *latitude_min, double *latitude_max,
+                                    double *longitude_min, double *longitude_max);
 int harp_product_get_derived_bounds_for_grid(harp_product *product, harp_variable *grid, harp_variable **bounds);
-int harp_product_get_storage_size(const harp_product *product, int with_attributes, int64_t *size);
-int harp_product_bin_full(harp_product *product);
+int harp_product_get_time_slice(const harp_product *product, long offset, long length, harp_product **new_product);
+int harp_product_sparsify(harp_product *product);
+int harp_product_sort_spatial(harp_product *product, double time_step);
+int harp_product_bin_full(harp_product *product, const harp_bin_aggregation_list *aggregation);
 int harp_product_bin_spatial_full(harp_product *product, long num_latitude_edges, double *latitude_edges,
-                                  long num_longitude_edges, double *longitude_edges);
-int harp_product_bin_with_collocated_dataset(harp_product *product, harp_collocation_result *collocation_result);
-int harp_product_bin_with_variable(harp_product *product, const char *variable_name);
+                                  long num_longitude_edges, double *longitude_edges,
+                                  const harp_bin_aggregation_list *aggregation, const char *weights_filename);
+int harp_product_bin_with_collocated_dataset(harp_product *product, harp_collocation_result *collocation_result,
+                                             const harp_bin_aggregation_list *aggregation);
+int harp_product_bin_with_variable(harp_product *product, const char *variable_name,
+                                   const harp_bin_aggregation_list *aggregation);
+
+/* Binning aggregations */
+int harp_bin_aggregation_list_new(harp_bin_aggregation_list **new_list);
+int harp_bin_aggregation_list_add(harp_bin_aggregation_list *list, const char *specification);
+void harp_bin_aggregation_list_delete(harp_bin_aggregation_list *list);
+
+/* Expressions */
+int harp_expression_new_constant(double value, harp_expression **new_expression);
+int harp_expression_new_variable(const char *variable_name, const char *unit, harp_expression **new_expression);
+int harp_expression_new_operation(harp_expression_opcode opcode, int num_arguments, harp_expression **argument,
+                                  harp_expression **new_expression);
+int harp_expression_new_function(const char *function_name, int num_arguments, harp_expression **argument,
+                                 harp_expression **new_expression);
+void harp_expression_delete(harp_expression *expression);
+int harp_product_compute_variable(harp_product *product, const char *variable_name, const harp_data_type *data_type,
+                                  const char *unit, const harp_expression *expression);
+
+/* Dataset */
+int harp_dataset_add_product_unsorted(harp_dataset *dataset, const char *source_product,
+                                      harp_product_metadata *metadata);
+int harp_dataset_sort_products(harp_dataset *dataset);
+
+/* Archive index */
+#define HARP_ARCHIVE_INDEX_EXTENSION ".harpidx"
+int harp_archive_index_import(harp_dataset *dataset, const char *filename, const char *options,
+                              const harp_program *program);
 
 /* Import */
+void harp_program_get_included_variables(const harp_program *program, int num_variables, const char **variable_name,
+                                         uint8_t *include);
+int harp_program_is_leading_value_filter_variable(const harp_program *program, const char *variable_name);
+int harp_program_get_leading_value_filter_time_range(harp_program *program, harp_product *product, long *offset,
+                                                     long *length);
+int harp_program_datetime_range_can_pass(const harp_program *program, double datetime_start, double datetime_stop);
+
+/* Export */
+int harp_program_get_projected_variables(const harp_program *program, const harp_product *product, uint8_t *include);
+int harp_program_spatial_extent_can_pass(const harp_program *program, double latitude_min, double latitude_max,
+                                         double longitude_min, double longitude_max);
+int harp_program_verify_sample_independent(const harp_program *program);
 #ifdef HAVE_HDF4
-int harp_import_hdf4(const char *filename, harp_product **product);
+int harp_import_hdf4(const char *filename, harp_program *program, harp_product **product);
 #endif
 #ifdef HAVE_HDF5
-int harp_import_hdf5(const char *filename, harp_product **product);
+int harp_import_hdf5(const char *filename, harp_program *program, harp_product **product);
+int harp_import_hdf5_from_memory(const void *buffer, long size, harp_program *program, harp_product **product);
+typedef struct harp_hdf5_file_struct harp_hdf5_file;
+int harp_import_hdf5_or_hold(const char *filename, harp_program *program, harp_product **product,
+                             harp_hdf5_file **held_file);
+void harp_hdf5_release_file(harp_hdf5_file *file);
 #endif
-int harp_import_netcdf(const char *filename, harp_product **product);
+int harp_import_netcdf(const char *filename, harp_program *program, harp_product **product);
+int harp_import_netcdf_from_memory(const void *buffer, long size, harp_program *program, harp_product **product);
+int harp_import_zarr(const char *filename, harp_program *program, harp_product **product);
 
 #ifdef HAVE_HDF4
 int harp_export_hdf4(const char *filename, const harp_product *product);
 #endif
 #ifdef HAVE_HDF5
 int harp_export_hdf5(const char *filename, const harp_product *product);
+int harp_export_hdf5_to_memory(const harp_product *product, void **buffer, long *size);
 #endif
 int harp_export_netcdf(const char *filename, const harp_product *product);
+int harp_export_netcdf_to_memory(const harp_product *product, void **buffer, long *size);
+typedef struct harp_netcdf_export_stream_struct harp_netcdf_export_stream;
+int harp_export_netcdf_stream_open(const char *filename, harp_netcdf_export_stream **new_stream);
+int harp_export_netcdf_stream_append(harp_netcdf_export_stream *stream, harp_product *product);
+int harp_export_netcdf_stream_close(harp_netcdf_export_stream *stream);
+int harp_export_zarr(const char *filename, const harp_product *product);
+int harp_export_arrow(const char *filename, const harp_product *product);
 
 #ifdef HAVE_HDF4
 int harp_import_global_attributes_hdf4(const char *filename, double *datetime_start, double *datetime_stop,
-                                       long dimension[], char **source_product);
+                                       double *spatial_extent, long dimension[], char **source_product);
 #endif
 #ifdef HAVE_HDF5
 int harp_import_global_attributes_hdf5(const char *filename, double *datetime_start, double *datetime_stop,
-                                       long dimension[], char **source_product);
+                                       double *spatial_extent, long dimension[], char **source_product);
 #endif
 int harp_import_global_attributes_netcdf(const char *filename, double *datetime_start, double *datetime_stop,
-                                         long dimension[], char **source_product);
+                                         double *spatial_extent, long dimension[], char **source_product);
+int harp_import_global_attributes_zarr(const char *filename, double *datetime_start, double *datetime_stop,
+                                       double *spatial_extent, long dimension[], char **source_product);
 int harp_parse_file_convention(const char *str, int *major, int *minor);
 
 /* Ingest */
-int harp_ingest(const char *filename, const char *operations, const char *options, harp_product **product);
+typedef struct harp_ingest_stream_struct harp_ingest_stream;
+
+int harp_ingest(const char *filename, harp_program *program, const char *options, harp_product **product);
+int harp_ingest_stream_open(const char *filename, harp_program *program, const char *options, long chunk_size,
+                            harp_ingest_stream **new_stream);
+int harp_ingest_stream_next(harp_ingest_stream *stream, harp_product **product);
+void harp_ingest_stream_close(harp_ingest_stream *stream);
 int harp_ingest_test(const char *filename, int (*print) (const char *, ...));
+int harp_ingest_benchmark(const char *filename, const char *options, int show_variables,
+                          int (*print) (const char *, ...));
 int harp_ingest_global_attributes(const char *filename, const char *options, double *datetime_start,
                                   double *datetime_stop, long dimension[], char **source_product);
 void harp_ingestion_done(void);
@@ -225,6 +503,8 @@ typedef struct harp_unit_converter_struct harp_unit_converter;
 int harp_unit_converter_new(const char *from_unit, const char *to_unit, harp_unit_converter **new_unit_converter);
 void harp_unit_converter_delete(harp_unit_converter *unit_converter);
 double harp_unit_converter_convert(const harp_unit_converter *unit_converter, double value);
+void harp_unit_converter_convert_array(const harp_unit_converter *unit_converter, long num_values, double *value);
+int harp_variable_convert_unit_keep_float(harp_variable *variable, const char *target_unit);
 int harp_unit_compare(const char *unit_a, const char *unit_b);
 int harp_unit_is_valid(const char *str);
 void harp_unit_done(void);
@@ -239,6 +519,8 @@ int harp_variable_conversion_add_source(harp_variable_conversion *conversion, co
                                         harp_dimension_type *dimension_type, long independent_dimension_length);
 int harp_variable_conversion_set_enabled_function(harp_variable_conversion *conversion,
                                                   harp_conversion_enabled_function enabled);
+int harp_variable_conversion_set_parallelism(harp_variable_conversion *conversion,
+                                              harp_conversion_parallelism parallelism);
 int harp_variable_conversion_set_source_description(harp_variable_conversion *conversion, const char *description);
 void harp_variable_conversion_delete(harp_variable_conversion *conversion);
 
@@ -246,15 +528,29 @@ void harp_variable_conversion_delete(harp_variable_conversion *conversion);
 int harp_derived_variable_list_init(void);
 int harp_derived_variable_list_add_conversion(harp_variable_conversion *conversion);
 void harp_derived_variable_list_done(void);
+void harp_derived_variable_plan_cache_done(void);
+
+typedef struct harp_derivation_session_struct harp_derivation_session;
+int harp_derivation_session_new(const harp_product *product, harp_derivation_session **new_session);
+int harp_derivation_session_add_target(harp_derivation_session *session, const char *name, int num_dimensions,
+                                       const harp_dimension_type *dimension_type);
+void harp_derivation_session_enter(harp_derivation_session *session);
+void harp_derivation_session_leave(harp_derivation_session *session);
+void harp_derivation_session_clear(harp_derivation_session *session);
+void harp_derivation_session_delete(harp_derivation_session *session);
 
 /* Analysis functions */
 double harp_fraction_of_day_from_datetime(double datetime);
 double harp_fraction_of_year_from_datetime(double datetime);
 
 double harp_frequency_from_wavelength(double wavelength);
+void harp_frequency_from_wavelength_array(long num_elements, const double *wavelength, double *result);
 double harp_frequency_from_wavenumber(double wavenumber);
+void harp_frequency_from_wavenumber_array(long num_elements, const double *wavenumber, double *result);
 double harp_gravity_at_surface_from_latitude(double latitude);
 double harp_gravity_from_latitude_and_height(double latitude, double height);
+void harp_gravity_terms_from_latitude(double latitude, double *surface_gravity, double *height_factor);
+double harp_gravity_from_gravity_terms_and_height(double surface_gravity, double height_factor, double height);
 double harp_local_curvature_radius_at_surface_from_latitude(double latitude);
 double harp_normalized_radiance_from_radiance_and_solar_irradiance(double radiance, double solar_irradiance);
 double harp_normalized_radiance_from_reflectance_and_solar_zenith_angle(double reflectance, double solar_zenith_angle);
@@ -282,6 +578,9 @@ double harp_reflectance_from_normalized_radiance_and_solar_zenith_angle(double n
                                                                         double solar_zenith_angle);
 double harp_scattering_angle_from_sensor_and_solar_angles(double sensor_zenith_angle, double solar_zenith_angle,
                                                           double relative_azimuth_angle);
+void harp_scattering_angle_from_sensor_and_solar_angles_array(long num_elements, const double *sensor_zenith_angle,
+                                                              const double *solar_zenith_angle,
+                                                              const double *relative_azimuth_angle, double *result);
 double harp_sea_surface_temperature_skin_from_subskin_wind_speed_and_solar_zenith_angle(double sst_skin,
                                                                                         double wind_speed,
                                                                                         double solar_zenith_angle);
@@ -290,16 +589,34 @@ double harp_sea_surface_temperature_subskin_from_skin_wind_speed_and_solar_zenit
                                                                                         double solar_zenith_angle);
 double harp_solar_azimuth_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
                                                                double solar_hour_angle, double solar_zenith_angle);
+void harp_solar_azimuth_angle_from_latitude_and_solar_angles_array(long num_elements, const double *latitude,
+                                                                   const double *solar_declination_angle,
+                                                                   const double *solar_hour_angle,
+                                                                   const double *solar_zenith_angle, double *result);
 double harp_solar_declination_angle_from_datetime(double datetime);
+void harp_solar_declination_angle_from_datetime_array(long num_elements, const double *datetime, double *result);
 double harp_solar_hour_angle_from_datetime_and_longitude(double datetime, double longitude);
+void harp_solar_hour_angle_from_datetime_and_longitude_array(long num_elements, const double *datetime,
+                                                             const double *longitude, double *result);
 double harp_solar_zenith_angle_from_latitude_and_solar_angles(double latitude, double solar_declination_angle,
                                                               double solar_hour_angle);
+void harp_solar_zenith_angle_from_latitude_and_solar_angles_array(long num_elements, const double *latitude,
+                                                                  const double *solar_declination_angle,
+                                                                  const double *solar_hour_angle, double *result);
 double harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles(double sensor_azimuth_angle,
                                                                         double solar_azimuth_angle);
+void harp_relative_azimuth_angle_from_sensor_and_solar_azimuth_angles_array(long num_elements,
+                                                                            const double *sensor_azimuth_angle,
+                                                                            const double *solar_azimuth_angle,
+                                                                            double *result);
 double harp_elevation_angle_from_zenith_angle(double zenith_angle);
+void harp_elevation_angle_from_zenith_angle_array(long num_elements, const double *zenith_angle, double *result);
 double harp_zenith_angle_from_elevation_angle(double elevation_angle);
+void harp_zenith_angle_from_elevation_angle_array(long num_elements, const double *elevation_angle, double *result);
 double harp_sensor_angle_from_viewing_angle(double viewing_angle);
+void harp_sensor_angle_from_viewing_angle_array(long num_elements, const double *viewing_angle, double *result);
 double harp_viewing_angle_from_sensor_angle(double sensor_angle);
+void harp_viewing_angle_from_sensor_angle_array(long num_elements, const double *sensor_angle, double *result);
 int harp_sensor_geometry_angles_at_altitude_from_other_altitude(double source_altitude,
                                                                 double source_solar_zenith_angle,
                                                                 double source_sensor_zenith_angle,
@@ -318,13 +635,39 @@ int harp_sensor_geometry_angle_profiles_from_sensor_geometry_angles(double altit
                                                                     double *sensor_zenith_angle_profile,
                                                                     double *relative_azimuth_angle_profile);
 double harp_wavelength_from_frequency(double frequency);
+void harp_wavelength_from_frequency_array(long num_elements, const double *frequency, double *result);
 double harp_wavelength_from_wavenumber(double wavenumber);
+void harp_wavelength_from_wavenumber_array(long num_elements, const double *wavenumber, double *result);
 double harp_wavenumber_from_frequency(double frequency);
+void harp_wavenumber_from_frequency_array(long num_elements, const double *frequency, double *result);
 double harp_wavenumber_from_wavelength(double wavelength);
+void harp_wavenumber_from_wavelength_array(long num_elements, const double *wavelength, double *result);
 double harp_wrap(double value, double min, double max);
+void harp_wrap_array(long num_elements, double *value, double min, double max);
 
 /* Interpolation */
+
+/* precomputed (log/log) linear interpolation of a single target grid point from a source array y */
+typedef struct harp_interpolation_weight_struct
+{
+    enum
+    {
+        harp_interpolation_nan, /* NaN (target point is outside the source grid) */
+        harp_interpolation_copy,        /* y[index] */
+        harp_interpolation_interpolate, /* interpolate between y[index] and y[index + 1] using factor v */
+        harp_interpolation_extrapolate  /* extrapolate from y[index] and y[index2] using factor v */
+    } type;
+    long index;
+    long index2;
+    double v;
+} harp_interpolation_weight;
+
 void harp_interpolate_find_index(long source_length, const double *source_grid, double target_grid_point, long *index);
+typedef struct harp_spline_struct harp_spline;
+
+int harp_spline_new(long n, const double *xx, const double *yy, harp_spline **new_spline);
+void harp_spline_delete(harp_spline *spline);
+int harp_spline_evaluate(const harp_spline *spline, long num_points, const double *xp, double *yp);
 int harp_cubic_spline_interpolation(const double *xx, const double *yy, long n, const double xp, double *new_yp);
 int harp_bicubic_spline_interpolation(const double *xx, const double *yy, const double **zz, long m, long n,
                                       double xp, double yp, double *new_zp);
@@ -346,16 +689,44 @@ void harp_interpolate_array_logloglinear(long source_length, const double *sourc
 void harp_interval_interpolate_array_linear(long source_length, const double *source_grid_boundaries,
                                             const double *source_array, long target_length,
                                             const double *target_grid_boundaries, double *target_array);
+void harp_interpolate_weights_linear(long source_length, const double *source_grid, long target_length,
+                                     const double *target_grid, int out_of_bound_flag,
+                                     harp_interpolation_weight *weight);
+void harp_interpolate_profiles_linear_with_weights(long target_length, const harp_interpolation_weight *weight,
+                                                   long num_profiles, const double *source_array,
+                                                   double *target_array);
+void harp_interpolate_weights_logloglinear(long source_length, const double *source_grid, long target_length,
+                                           const double *target_grid, int out_of_bound_flag,
+                                           harp_interpolation_weight *weight);
+void harp_interpolate_profiles_logloglinear_with_weights(long target_length, const harp_interpolation_weight *weight,
+                                                         long num_profiles, const double *source_array,
+                                                         double *target_array);
+int harp_interval_interpolate_weights_linear(long source_length, const double *source_grid_boundaries,
+                                             long target_length, const double *target_grid_boundaries, long *offset,
+                                             long *max_num_weights, long **source_index, double **weight);
+void harp_interval_interpolate_profiles_linear_with_weights(long target_length, const long *offset,
+                                                            const long *source_index, const double *weight,
+                                                            long num_profiles, const double *source_array,
+                                                            double *target_array);
 void harp_bounds_from_midpoints_linear(long num_midpoints, const double *midpoints, int extrapolate, double *intervals);
 void harp_bounds_from_midpoints_loglinear(long num_midpoints, const double *midpoints, int extrapolate,
                                           double *intervals);
 
 /* Collocation */
-int harp_collocation_result_shallow_copy(const harp_collocation_result *collocation_result,
-                                         harp_collocation_result **new_result);
-void harp_collocation_result_shallow_delete(harp_collocation_result *collocation_result);
+int harp_collocation_result_get_view_for_source_product_a(const harp_collocation_result *collocation_result,
+                                                         const char *source_product,
+                                                         harp_collocation_result **new_view);
+int harp_collocation_result_get_view_for_source_product_b(const harp_collocation_result *collocation_result,
+                                                         const char *source_product,
+                                                         harp_collocation_result **new_view);
+int harp_collocation_result_get_view_for_collocation_indices(const harp_collocation_result *collocation_result,
+                                                             long num_indices, const int32_t *collocation_index,
+                                                             harp_collocation_result **new_view);
+void harp_collocation_result_view_delete(harp_collocation_result *view);
 
 int harp_collocation_result_get_filtered_product_b(harp_collocation_result *collocation_result,
                                                    const char *source_product, harp_product **product);
+int harp_import_collocated_product(const char *filename, harp_product **product);
+void harp_collocated_product_cache_clear(void);
 
 #endif
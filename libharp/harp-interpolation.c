@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 /* Given arrays x[0..n-1] and y[0..n-1] containing a tabulated function, i.e., yi = f(xi), with
  * x1 < x2 < ... < xN , and given values d0 and dnmin1 for the first derivative of the interpolating
@@ -369,34 +370,130 @@ void harp_interpolate_find_index(long source_length, const double *source_grid,
     }
 }
 
-int harp_cubic_spline_interpolation(const double *xx, const double *yy, long n, const double xp, double *yp)
+struct harp_spline_struct
+{
+    long n;
+    double *xx;
+    double *yy;
+    double *second_derivatives;
+};
+
+/* Create a natural cubic spline through the points (xx[i], yy[i]) (0 <= i < n), with xx in ascending order.
+ * The second derivatives are calculated once, such that the spline can be evaluated at any number of points using
+ * harp_spline_evaluate(). The spline holds its own copy of xx and yy.
+ */
+int harp_spline_new(long n, const double *xx, const double *yy, harp_spline **new_spline)
 {
     double d0 = 1.0e30; /* First derivative of the interpolating function at points 0. */
     double dnmin1 = 1.0e30;     /* First derivative of the interpolating function at points n-1. */
-    double *second_derivatives = NULL;  /* Second derivatives */
+    harp_spline *spline;
+
+    spline = (harp_spline *)malloc(sizeof(harp_spline));
+    if (spline == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_spline), __FILE__, __LINE__);
+        return -1;
+    }
+    spline->n = n;
+    spline->xx = NULL;
+    spline->yy = NULL;
+    spline->second_derivatives = NULL;
+
+    spline->xx = malloc((size_t)n * sizeof(double));
+    if (spline->xx == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       n * sizeof(double), __FILE__, __LINE__);
+        harp_spline_delete(spline);
+        return -1;
+    }
+    memcpy(spline->xx, xx, (size_t)n * sizeof(double));
+    spline->yy = malloc((size_t)n * sizeof(double));
+    if (spline->yy == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       n * sizeof(double), __FILE__, __LINE__);
+        harp_spline_delete(spline);
+        return -1;
+    }
+    memcpy(spline->yy, yy, (size_t)n * sizeof(double));
 
     /* Get the second derivatives of the interpolating function at the tabulated points */
-    second_derivatives = calloc((size_t)n, sizeof(double));
-    if (second_derivatives == NULL)
+    spline->second_derivatives = calloc((size_t)n, sizeof(double));
+    if (spline->second_derivatives == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        n * sizeof(double), __FILE__, __LINE__);
+        harp_spline_delete(spline);
         return -1;
     }
-    if (get_second_derivatives(xx, yy, n, d0, dnmin1, second_derivatives) != 0)
+    if (get_second_derivatives(spline->xx, spline->yy, n, d0, dnmin1, spline->second_derivatives) != 0)
     {
-        free(second_derivatives);
+        harp_spline_delete(spline);
         return -1;
     }
 
-    /* Interpolate */
-    if (execute_cubic_spline_interpolation(xx, yy, second_derivatives, n, xp, yp) != 0)
+    *new_spline = spline;
+    return 0;
+}
+
+void harp_spline_delete(harp_spline *spline)
+{
+    if (spline != NULL)
     {
-        free(second_derivatives);
+        if (spline->xx != NULL)
+        {
+            free(spline->xx);
+        }
+        if (spline->yy != NULL)
+        {
+            free(spline->yy);
+        }
+        if (spline->second_derivatives != NULL)
+        {
+            free(spline->second_derivatives);
+        }
+        free(spline);
+    }
+}
+
+/* Evaluate the spline at the num_points points xp[0..num_points-1] and store the results in yp[0..num_points-1] */
+int harp_spline_evaluate(const harp_spline *spline, long num_points, const double *xp, double *yp)
+{
+    long i;
+
+    for (i = 0; i < num_points; i++)
+    {
+        if (execute_cubic_spline_interpolation(spline->xx, spline->yy, spline->second_derivatives, spline->n, xp[i],
+                                               &yp[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Cubic spline interpolation of a single point.
+ * If the spline is evaluated at more than one point for the same xx and yy, use harp_spline_new() and
+ * harp_spline_evaluate() instead, so the spline is only set up once.
+ */
+int harp_cubic_spline_interpolation(const double *xx, const double *yy, long n, const double xp, double *yp)
+{
+    harp_spline *spline;
+
+    if (harp_spline_new(n, xx, yy, &spline) != 0)
+    {
+        return -1;
+    }
+    if (harp_spline_evaluate(spline, 1, &xp, yp) != 0)
+    {
+        harp_spline_delete(spline);
         return -1;
     }
+    harp_spline_delete(spline);
 
-    free(second_derivatives);
     return 0;
 }
 
@@ -771,13 +868,149 @@ void harp_interpolate_array_logloglinear(long source_length, const double *sourc
     }
 }
 
+static void get_interval(const double *grid_boundaries, long index, double *xmin, double *xmax)
+{
+    if (grid_boundaries[2 * index] < grid_boundaries[2 * index + 1])
+    {
+        *xmin = grid_boundaries[2 * index];
+        *xmax = grid_boundaries[2 * index + 1];
+    }
+    else
+    {
+        *xmin = grid_boundaries[2 * index + 1];
+        *xmax = grid_boundaries[2 * index];
+    }
+}
+
+/* Determine the ordering of the source intervals.
+ * Returns 1 if both the lower and upper interval edges are non-decreasing, -1 if they are both non-increasing, and 0
+ * otherwise (e.g. if a boundary is NaN).
+ */
+static int get_interval_ordering(long length, const double *grid_boundaries)
+{
+    int increasing = 1;
+    int decreasing = 1;
+    double prev_xmin, prev_xmax;
+    long i;
+
+    if (length == 0)
+    {
+        return 1;
+    }
+    get_interval(grid_boundaries, 0, &prev_xmin, &prev_xmax);
+    if (harp_isnan(prev_xmin) || harp_isnan(prev_xmax))
+    {
+        return 0;
+    }
+    for (i = 1; i < length && (increasing || decreasing); i++)
+    {
+        double xmin, xmax;
+
+        get_interval(grid_boundaries, i, &xmin, &xmax);
+        if (!(xmin >= prev_xmin && xmax >= prev_xmax))
+        {
+            increasing = 0;
+        }
+        if (!(xmin <= prev_xmin && xmax <= prev_xmax))
+        {
+            decreasing = 0;
+        }
+        prev_xmin = xmin;
+        prev_xmax = xmax;
+    }
+
+    return increasing ? 1 : (decreasing ? -1 : 0);
+}
+
+/* Determine the range [*first, *last) of source intervals that overlap with the target interval [xminb, xmaxb].
+ * ordering should be the result of get_interval_ordering() and should not be 0.
+ * Source intervals are overlapping if xmina < xmaxb and xmaxa > xminb. Since both xmina and xmaxa are sorted, the
+ * overlapping intervals form a consecutive range. The positions *lower and *upper are the boundaries of this range in
+ * increasing order of the intervals and are moved starting from their previous values, which makes a sweep over a
+ * sorted target grid linear in the number of source and target intervals.
+ */
+static void find_overlapping_intervals(long source_length, const double *source_grid_boundaries, int ordering,
+                                       double xminb, double xmaxb, long *lower, long *upper, long *first, long *last)
+{
+    double xmina, xmaxa;
+    long lo = *lower;
+    long hi = *upper;
+
+#define SOURCE_INTERVAL(k) get_interval(source_grid_boundaries, ordering > 0 ? (k) : source_length - 1 - (k), \
+                                        &xmina, &xmaxa)
+
+    /* lo = first position for which xmaxa > xminb */
+    while (lo < source_length)
+    {
+        SOURCE_INTERVAL(lo);
+        if (xmaxa > xminb)
+        {
+            break;
+        }
+        lo++;
+    }
+    while (lo > 0)
+    {
+        SOURCE_INTERVAL(lo - 1);
+        if (!(xmaxa > xminb))
+        {
+            break;
+        }
+        lo--;
+    }
+
+    /* hi = first position for which xmina >= xmaxb */
+    while (hi < source_length)
+    {
+        SOURCE_INTERVAL(hi);
+        if (!(xmina < xmaxb))
+        {
+            break;
+        }
+        hi++;
+    }
+    while (hi > 0)
+    {
+        SOURCE_INTERVAL(hi - 1);
+        if (xmina < xmaxb)
+        {
+            break;
+        }
+        hi--;
+    }
+
+#undef SOURCE_INTERVAL
+
+    *lower = lo;
+    *upper = hi;
+    if (hi < lo)
+    {
+        hi = lo;
+    }
+    if (ordering > 0)
+    {
+        *first = lo;
+        *last = hi;
+    }
+    else
+    {
+        *first = source_length - hi;
+        *last = source_length - lo;
+    }
+}
+
 /* Interpolate array from source grid to target grid using linear interpolation
  * Both source_grid_boundaries and target_grid_boundaries need to be strict monotonic.
+ * For sorted grids (increasing or decreasing) only the overlapping source intervals are visited for each target
+ * interval, so the cost is linear in source_length + target_length.
  */
 void harp_interval_interpolate_array_linear(long source_length, const double *source_grid_boundaries,
                                             const double *source_array, long target_length,
                                             const double *target_grid_boundaries, double *target_array)
 {
+    int ordering = get_interval_ordering(source_length, source_grid_boundaries);
+    long lower = 0;
+    long upper = 0;
     long i, j;
 
     for (i = 0; i < target_length; i++)
@@ -785,32 +1018,21 @@ void harp_interval_interpolate_array_linear(long source_length, const double *so
         long num_valid_contributions = 0;
         double sum = 0.0;
         double xminb, xmaxb;
+        long first = 0;
+        long last = source_length;
 
-        if (target_grid_boundaries[2 * i] < target_grid_boundaries[2 * i + 1])
+        get_interval(target_grid_boundaries, i, &xminb, &xmaxb);
+        if (ordering != 0 && !harp_isnan(xminb) && !harp_isnan(xmaxb))
         {
-            xminb = target_grid_boundaries[2 * i];
-            xmaxb = target_grid_boundaries[2 * i + 1];
-        }
-        else
-        {
-            xminb = target_grid_boundaries[2 * i + 1];
-            xmaxb = target_grid_boundaries[2 * i];
+            find_overlapping_intervals(source_length, source_grid_boundaries, ordering, xminb, xmaxb, &lower, &upper,
+                                       &first, &last);
         }
 
-        for (j = 0; j < source_length; j++)
+        for (j = first; j < last; j++)
         {
             double xmina, xmaxa;
 
-            if (source_grid_boundaries[2 * j] < source_grid_boundaries[2 * j + 1])
-            {
-                xmina = source_grid_boundaries[2 * j];
-                xmaxa = source_grid_boundaries[2 * j + 1];
-            }
-            else
-            {
-                xmina = source_grid_boundaries[2 * j + 1];
-                xmaxa = source_grid_boundaries[2 * j];
-            }
+            get_interval(source_grid_boundaries, j, &xmina, &xmaxa);
 
             if (!(xmina >= xmaxb || xminb >= xmaxa || harp_isnan(source_array[j])))
             {
@@ -839,6 +1061,366 @@ void harp_interval_interpolate_array_linear(long source_length, const double *so
     }
 }
 
+/* Determine the weights for interpolating an array from source grid to target grid using linear interpolation.
+ * The weights can be applied to any number of source arrays using harp_interpolate_profiles_linear_with_weights(),
+ * which gives the same result as harp_interpolate_array_linear().
+ * The weight array should be able to hold target_length elements.
+ */
+void harp_interpolate_weights_linear(long source_length, const double *source_grid, long target_length,
+                                     const double *target_grid, int out_of_bound_flag,
+                                     harp_interpolation_weight *weight)
+{
+    long pos = 0;
+    long i;
+
+    assert(source_length > 1);
+    assert(out_of_bound_flag == 0 || out_of_bound_flag == 1 || out_of_bound_flag == 2);
+
+    for (i = 0; i < target_length; i++)
+    {
+        double target_grid_point = target_grid[i];
+
+        harp_interpolate_find_index(source_length, source_grid, target_grid_point, &pos);
+
+        if (pos == -1 || pos == source_length)
+        {
+            /* grid point is before source_grid[0] or after source_grid[source_length - 1] */
+            long edge = pos == -1 ? 0 : source_length - 1;
+            long next = pos == -1 ? 1 : source_length - 2;
+
+            if (out_of_bound_flag == 1)
+            {
+                weight[i].type = harp_interpolation_copy;
+                weight[i].index = edge;
+            }
+            else if (out_of_bound_flag == 2)
+            {
+                weight[i].type = harp_interpolation_extrapolate;
+                weight[i].index = edge;
+                weight[i].index2 = next;
+                weight[i].v = (target_grid_point - source_grid[edge]) / (source_grid[edge] - source_grid[next]);
+            }
+            else
+            {
+                weight[i].type = harp_interpolation_nan;
+            }
+        }
+        else if (target_grid_point == source_grid[pos])
+        {
+            /* don't interpolate, but take exact point */
+            weight[i].type = harp_interpolation_copy;
+            weight[i].index = pos;
+        }
+        else if (target_grid_point == source_grid[pos + 1])
+        {
+            /* don't interpolate, but take exact point */
+            weight[i].type = harp_interpolation_copy;
+            weight[i].index = pos + 1;
+        }
+        else
+        {
+            /* grid point is between source_grid[pos] and source_grid[pos + 1] */
+            weight[i].type = harp_interpolation_interpolate;
+            weight[i].index = pos;
+            weight[i].v = (target_grid_point - source_grid[pos]) / (source_grid[pos + 1] - source_grid[pos]);
+        }
+    }
+}
+
+/* Apply weights from harp_interpolate_weights_linear() to num_profiles source profiles at once.
+ * The profiles are stored interleaved, i.e. source_array is a [source_length, num_profiles] array and target_array a
+ * [target_length, num_profiles] array (with num_profiles == 1 this is a single profile). For each profile this gives
+ * the same result as harp_interpolate_array_linear(). The source and target arrays should not overlap.
+ */
+void harp_interpolate_profiles_linear_with_weights(long target_length, const harp_interpolation_weight *weight,
+                                                   long num_profiles, const double *source_array,
+                                                   double *target_array)
+{
+    double nan_value = harp_nan();
+    long i, l;
+
+    for (i = 0; i < target_length; i++)
+    {
+        double *target = &target_array[i * num_profiles];
+        const double *source;
+        const double *source2;
+        double v = weight[i].v;
+
+        switch (weight[i].type)
+        {
+            case harp_interpolation_nan:
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = nan_value;
+                }
+                break;
+            case harp_interpolation_copy:
+                source = &source_array[weight[i].index * num_profiles];
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = source[l];
+                }
+                break;
+            case harp_interpolation_interpolate:
+                source = &source_array[weight[i].index * num_profiles];
+                source2 = &source_array[(weight[i].index + 1) * num_profiles];
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = (1 - v) * source[l] + v * source2[l];
+                }
+                break;
+            case harp_interpolation_extrapolate:
+                source = &source_array[weight[i].index * num_profiles];
+                source2 = &source_array[weight[i].index2 * num_profiles];
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = source[l] + v * (source[l] - source2[l]);
+                }
+                break;
+        }
+    }
+}
+
+/* Determine the weights for interpolating an array from source grid to target grid using log/log linear
+ * interpolation. The weights can be applied to any number of source arrays using
+ * harp_interpolate_profiles_logloglinear_with_weights(), which gives the same result as
+ * harp_interpolate_array_logloglinear().
+ * The weight array should be able to hold target_length elements.
+ */
+void harp_interpolate_weights_logloglinear(long source_length, const double *source_grid, long target_length,
+                                           const double *target_grid, int out_of_bound_flag,
+                                           harp_interpolation_weight *weight)
+{
+    long pos = 0;
+    long i;
+
+    assert(source_length > 1);
+    assert(out_of_bound_flag == 0 || out_of_bound_flag == 1 || out_of_bound_flag == 2);
+
+    for (i = 0; i < target_length; i++)
+    {
+        double target_grid_point = target_grid[i];
+
+        harp_interpolate_find_index(source_length, source_grid, target_grid_point, &pos);
+
+        if (pos == -1 || pos == source_length)
+        {
+            /* grid point is before source_grid[0] or after source_grid[source_length - 1] */
+            long edge = pos == -1 ? 0 : source_length - 1;
+            long next = pos == -1 ? 1 : source_length - 2;
+
+            if (out_of_bound_flag == 1)
+            {
+                weight[i].type = harp_interpolation_copy;
+                weight[i].index = edge;
+            }
+            else if (out_of_bound_flag == 2)
+            {
+                weight[i].type = harp_interpolation_extrapolate;
+                weight[i].index = edge;
+                weight[i].index2 = next;
+                weight[i].v = log(target_grid_point / source_grid[edge]) / log(source_grid[edge] / source_grid[next]);
+            }
+            else
+            {
+                weight[i].type = harp_interpolation_nan;
+            }
+        }
+        else if (target_grid_point == source_grid[pos])
+        {
+            /* don't interpolate, but take exact point */
+            weight[i].type = harp_interpolation_copy;
+            weight[i].index = pos;
+        }
+        else if (target_grid_point == source_grid[pos + 1])
+        {
+            /* don't interpolate, but take exact point */
+            weight[i].type = harp_interpolation_copy;
+            weight[i].index = pos + 1;
+        }
+        else
+        {
+            /* grid point is between source_grid[pos] and source_grid[pos + 1] */
+            weight[i].type = harp_interpolation_interpolate;
+            weight[i].index = pos;
+            weight[i].v = log(target_grid_point / source_grid[pos]) / log(source_grid[pos + 1] / source_grid[pos]);
+        }
+    }
+}
+
+/* Apply weights from harp_interpolate_weights_logloglinear() to num_profiles source profiles at once.
+ * See harp_interpolate_profiles_linear_with_weights() for the layout of the source and target arrays.
+ */
+void harp_interpolate_profiles_logloglinear_with_weights(long target_length, const harp_interpolation_weight *weight,
+                                                         long num_profiles, const double *source_array,
+                                                         double *target_array)
+{
+    double nan_value = harp_nan();
+    long i, l;
+
+    for (i = 0; i < target_length; i++)
+    {
+        double *target = &target_array[i * num_profiles];
+        const double *source;
+        const double *source2;
+        double v = weight[i].v;
+
+        switch (weight[i].type)
+        {
+            case harp_interpolation_nan:
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = nan_value;
+                }
+                break;
+            case harp_interpolation_copy:
+                source = &source_array[weight[i].index * num_profiles];
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = source[l];
+                }
+                break;
+            case harp_interpolation_interpolate:
+                source = &source_array[weight[i].index * num_profiles];
+                source2 = &source_array[(weight[i].index + 1) * num_profiles];
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = exp((1 - v) * log(source[l]) + v * log(source2[l]));
+                }
+                break;
+            case harp_interpolation_extrapolate:
+                source = &source_array[weight[i].index * num_profiles];
+                source2 = &source_array[weight[i].index2 * num_profiles];
+                for (l = 0; l < num_profiles; l++)
+                {
+                    target[l] = exp((1 + v) * log(source[l]) - v * log(source2[l]));
+                }
+                break;
+        }
+    }
+}
+
+/* Determine the weights for interval interpolation of an array from source grid to target grid.
+ * The weights are stored as a sparse matrix: the weights for target interval i are stored at positions
+ * offset[i] .. offset[i + 1] - 1 of the source_index and weight arrays (offset should be able to hold target_length + 1
+ * elements). The source_index and weight arrays are (re)allocated as needed; *max_num_weights holds their allocated
+ * size. The weights can be applied to any number of source arrays using
+ * harp_interval_interpolate_profiles_linear_with_weights(), which gives the same result as
+ * harp_interval_interpolate_array_linear().
+ */
+int harp_interval_interpolate_weights_linear(long source_length, const double *source_grid_boundaries,
+                                             long target_length, const double *target_grid_boundaries, long *offset,
+                                             long *max_num_weights, long **source_index, double **weight)
+{
+    int ordering = get_interval_ordering(source_length, source_grid_boundaries);
+    long num_weights = 0;
+    long lower = 0;
+    long upper = 0;
+    long i, j;
+
+    for (i = 0; i < target_length; i++)
+    {
+        double xminb, xmaxb;
+        long first = 0;
+        long last = source_length;
+
+        offset[i] = num_weights;
+
+        get_interval(target_grid_boundaries, i, &xminb, &xmaxb);
+        if (ordering != 0 && !harp_isnan(xminb) && !harp_isnan(xmaxb))
+        {
+            find_overlapping_intervals(source_length, source_grid_boundaries, ordering, xminb, xmaxb, &lower, &upper,
+                                       &first, &last);
+        }
+
+        for (j = first; j < last; j++)
+        {
+            double xmina, xmaxa;
+
+            get_interval(source_grid_boundaries, j, &xmina, &xmaxa);
+
+            if (!(xmina >= xmaxb || xminb >= xmaxa))
+            {
+                double xminc, xmaxc;
+
+                /* there is overlap and interval A is not empty */
+
+                if (num_weights == *max_num_weights)
+                {
+                    long new_max_num_weights = *max_num_weights == 0 ? source_length : 2 * (*max_num_weights);
+                    long *new_source_index;
+                    double *new_weight;
+
+                    new_source_index = realloc(*source_index, new_max_num_weights * sizeof(long));
+                    if (new_source_index == NULL)
+                    {
+                        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) "
+                                       "(%s:%u)", new_max_num_weights * sizeof(long), __FILE__, __LINE__);
+                        return -1;
+                    }
+                    *source_index = new_source_index;
+                    new_weight = realloc(*weight, new_max_num_weights * sizeof(double));
+                    if (new_weight == NULL)
+                    {
+                        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) "
+                                       "(%s:%u)", new_max_num_weights * sizeof(double), __FILE__, __LINE__);
+                        return -1;
+                    }
+                    *weight = new_weight;
+                    *max_num_weights = new_max_num_weights;
+                }
+
+                /* calculate intersection interval C of intervals A and B */
+                xminc = xmina < xminb ? xminb : xmina;
+                xmaxc = xmaxa > xmaxb ? xmaxb : xmaxa;
+
+                (*source_index)[num_weights] = j;
+                (*weight)[num_weights] = (xmaxc - xminc) / (xmaxa - xmina);
+                num_weights++;
+            }
+        }
+    }
+    offset[target_length] = num_weights;
+
+    return 0;
+}
+
+/* Apply weights from harp_interval_interpolate_weights_linear() to num_profiles source profiles at once.
+ * See harp_interpolate_profiles_linear_with_weights() for the layout of the source and target arrays.
+ */
+void harp_interval_interpolate_profiles_linear_with_weights(long target_length, const long *offset,
+                                                            const long *source_index, const double *weight,
+                                                            long num_profiles, const double *source_array,
+                                                            double *target_array)
+{
+    double nan_value = harp_nan();
+    long i, j, l;
+
+    for (i = 0; i < target_length; i++)
+    {
+        double *target = &target_array[i * num_profiles];
+
+        /* the target value stays NaN until at least one source interval with a valid value contributes */
+        for (l = 0; l < num_profiles; l++)
+        {
+            target[l] = nan_value;
+        }
+        for (j = offset[i]; j < offset[i + 1]; j++)
+        {
+            const double *source = &source_array[source_index[j] * num_profiles];
+            double w = weight[j];
+
+            for (l = 0; l < num_profiles; l++)
+            {
+                if (!harp_isnan(source[l]))
+                {
+                    target[l] = (harp_isnan(target[l]) ? 0.0 : target[l]) + w * source[l];
+                }
+            }
+        }
+    }
+}
+
 /* Determine boundary intervals based on linear inter-/extrapolation of mid points.
  * The bounds array will be treated as a [num_midpoints,2] array and should thus be allocated
  * to hold '2 * num_midpoints' values.
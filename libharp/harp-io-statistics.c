@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "harp-internal.h"
+#include "harp-thread.h"
+
+#include <string.h>
+
+/* I/O statistics per file access backend (see harp_get_io_statistics()) */
+
+static const char *backend_name[HARP_NUM_IO_BACKENDS] = { "coda", "hdf4", "hdf5", "netcdf", "zarr", "arrow" };
+
+static harp_mutex io_statistics_mutex = HARP_MUTEX_INITIALIZER;
+static harp_io_statistics io_statistics[HARP_NUM_IO_BACKENDS];
+
+/* Record that a file was opened (or created) using the given backend */
+void harp_io_statistics_add_open(harp_io_backend backend)
+{
+    harp_mutex_lock(&io_statistics_mutex);
+    io_statistics[backend].num_open++;
+    harp_mutex_unlock(&io_statistics_mutex);
+}
+
+/* Record that a file was closed using the given backend */
+void harp_io_statistics_add_close(harp_io_backend backend)
+{
+    harp_mutex_lock(&io_statistics_mutex);
+    io_statistics[backend].num_close++;
+    harp_mutex_unlock(&io_statistics_mutex);
+}
+
+/* Record a single read request of num_bytes bytes of data using the given backend */
+void harp_io_statistics_add_read(harp_io_backend backend, int64_t num_bytes)
+{
+    harp_mutex_lock(&io_statistics_mutex);
+    io_statistics[backend].num_read_calls++;
+    io_statistics[backend].bytes_read += num_bytes;
+    harp_mutex_unlock(&io_statistics_mutex);
+}
+
+/** \addtogroup harp_general
+ * @{
+ */
+
+/** Retrieve the I/O statistics of a file access backend.
+ * HARP keeps track of the number of files that are opened and closed, and of the number of read requests and the
+ * amount of data that is requested, for each file access backend. The available backends are:
+ *  - \c coda: products that are read using the ingestion modules (a read request is a single read of a block, a range
+ *    of blocks, or a full variable by an ingestion module)
+ *  - \c hdf4: HARP products in HDF4 format
+ *  - \c hdf5: HARP products in HDF5 format
+ *  - \c netcdf: HARP products in netCDF format
+ *  - \c zarr: HARP products in Zarr format (a read request is the read of a single chunk)
+ *  - \c arrow: Arrow files (export only)
+ *
+ * Files that are created by an export are included in the open and close counts.
+ * The statistics are accumulated over all threads since the start of the program (or since the last call to
+ * harp_reset_io_statistics()). To get the statistics for a single product, reset the statistics (or retrieve them)
+ * before and retrieve them after the import.
+ * \param backend Name of the backend.
+ * \param statistics Pointer to the variable where the current statistics will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_get_io_statistics(const char *backend, harp_io_statistics *statistics)
+{
+    int i;
+
+    if (backend == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "backend is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (statistics == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "statistics is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < HARP_NUM_IO_BACKENDS; i++)
+    {
+        if (strcmp(backend, backend_name[i]) == 0)
+        {
+            harp_mutex_lock(&io_statistics_mutex);
+            *statistics = io_statistics[i];
+            harp_mutex_unlock(&io_statistics_mutex);
+            return 0;
+        }
+    }
+
+    harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unknown I/O backend '%s'", backend);
+    return -1;
+}
+
+/** Reset the I/O statistics of all file access backends to zero.
+ * \see harp_get_io_statistics()
+ */
+LIBHARP_API void harp_reset_io_statistics(void)
+{
+    harp_mutex_lock(&io_statistics_mutex);
+    memset(io_statistics, 0, sizeof(io_statistics));
+    harp_mutex_unlock(&io_statistics_mutex);
+}
+
+/** @} */
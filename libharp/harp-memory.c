@@ -0,0 +1,707 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* needed for mremap() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "harp-internal.h"
+#include "harp-thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#define USE_MMAP
+#endif
+#if defined(USE_MMAP) && defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Blocks of at least this size are 'large blocks' for harp_set_option_huge_pages() and harp_set_option_numa_policy()
+ * (this is the size of a transparent huge page on most systems).
+ */
+#define LARGE_BLOCK_MIN_SIZE 2097152
+
+/* Each block of the large block allocator starts with a header (the size keeps the data 64 byte aligned) */
+#define LARGE_BLOCK_HEADER_SIZE 64
+
+/* Value of MPOL_INTERLEAVE from <linux/mempolicy.h> (which is not always available) */
+#define LARGE_BLOCK_MPOL_INTERLEAVE 3
+
+/* Allocations of at least this size are recycled by the buffer pool (see harp_set_option_buffer_pool_size()) */
+#define BUFFER_POOL_MIN_SIZE 65536
+
+/* The pooled block sizes are rounded up to a quarter of a power of two; the smallest step is BUFFER_POOL_MIN_SIZE/4 */
+#define BUFFER_POOL_MIN_STEP_EXPONENT 14
+#define BUFFER_POOL_NUM_SIZE_CLASSES (4 * (64 - BUFFER_POOL_MIN_STEP_EXPONENT))
+
+/* While the buffer pool is enabled, each block starts with a header (the size keeps the data 64 byte aligned) */
+#define BUFFER_POOL_HEADER_SIZE 64
+
+typedef struct large_block_header_struct
+{
+    size_t size;        /* number of bytes that were requested */
+    size_t mapped_size; /* size of the memory mapping (including the header), or 0 if the block came from malloc() */
+} large_block_header;
+
+typedef struct buffer_pool_header_struct
+{
+    size_t capacity;    /* number of usable bytes of the block */
+    int size_class;     /* size class of the block, or -1 if the block is too small to be pooled */
+    struct buffer_pool_header_struct *next;     /* next block in the list of unused blocks of the same size class */
+} buffer_pool_header;
+
+static void *large_block_malloc(size_t size);
+static void *large_block_realloc(void *ptr, size_t size);
+static void large_block_free(void *ptr);
+
+/* Allocator that is used for the data of variables and for the scratch buffers of ingestions
+ * (see harp_set_allocator()).
+ */
+static void *(*allocator_malloc) (size_t size) = malloc;
+static void *(*allocator_realloc) (void *ptr, size_t size) = realloc;
+static void (*allocator_free) (void *ptr) = free;
+static long allocator_num_allocations = 0;      /* number of blocks currently allocated using the allocator */
+static int allocator_is_custom = 0;     /* whether the allocator was set using harp_set_allocator() */
+
+/* Accounting of the memory that is used for the data of variables (see harp_set_option_memory_limit()).
+ * The element arrays of all variables with data that is owned by HARP are included (for string variables this is the
+ * array of string pointers; the strings themselves are not included).
+ */
+
+static harp_mutex memory_mutex = HARP_MUTEX_INITIALIZER;
+static int64_t memory_current_size = 0;
+static int64_t memory_peak_size = 0;
+
+/* Buffer pool: released blocks of BUFFER_POOL_MIN_SIZE bytes or more are kept (up to buffer_pool_max_size bytes in
+ * total) and handed out again for allocations of the same size class, such that importing many products with the same
+ * layout does not keep returning memory to the system and paging it in again. Unused blocks are not included in
+ * memory_current_size. The pool is protected by memory_mutex.
+ */
+static int64_t buffer_pool_max_size = 0;        /* 0 if the buffer pool is disabled */
+static int64_t buffer_pool_size = 0;    /* total capacity of the unused blocks in the pool */
+static buffer_pool_header *buffer_pool_list[BUFFER_POOL_NUM_SIZE_CLASSES];
+
+/* Account for an allocation of size bytes of variable data.
+ * Fails with HARP_ERROR_OUT_OF_MEMORY (without accounting anything) if this would exceed the memory limit.
+ */
+int harp_memory_reserve(int64_t size)
+{
+    int64_t limit = harp_option_memory_limit;
+
+    harp_mutex_lock(&memory_mutex);
+    if (limit > 0 && memory_current_size + size > limit)
+    {
+        char size_str[21];
+        char current_size_str[21];
+        char limit_str[21];
+
+        harp_str64(size, size_str);
+        harp_str64(memory_current_size, current_size_str);
+        harp_str64(limit, limit_str);
+        harp_mutex_unlock(&memory_mutex);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "memory limit exceeded (could not allocate %s bytes with %s of %s "
+                       "bytes in use)", size_str, current_size_str, limit_str);
+        return -1;
+    }
+    memory_current_size += size;
+    if (memory_current_size > memory_peak_size)
+    {
+        memory_peak_size = memory_current_size;
+    }
+    harp_mutex_unlock(&memory_mutex);
+
+    return 0;
+}
+
+/* Account for the release of size bytes of variable data (which were accounted for using harp_memory_reserve()). */
+void harp_memory_release(int64_t size)
+{
+    harp_mutex_lock(&memory_mutex);
+    memory_current_size -= size;
+    harp_mutex_unlock(&memory_mutex);
+}
+
+#ifdef USE_MMAP
+/* Map a new (zero filled) large block of memory and apply the huge page and NUMA options to it.
+ * The pages of the block are only assigned when they are first written to, so with the default (local) NUMA policy
+ * each page ends up on the node of the thread that first writes to it.
+ */
+static void *map_large_block(size_t mapped_size)
+{
+    void *base;
+
+    base = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    /* the options below are hints; the block is still usable if they can not be applied */
+#ifdef MADV_HUGEPAGE
+    if (harp_option_huge_pages)
+    {
+        madvise(base, mapped_size, MADV_HUGEPAGE);
+    }
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+    if (harp_option_numa_policy == 2)
+    {
+        /* interleave over all nodes (the kernel restricts this to the nodes that are available to the process) */
+        unsigned long nodemask = ~0UL;
+
+        syscall(SYS_mbind, base, mapped_size, LARGE_BLOCK_MPOL_INTERLEAVE, &nodemask, sizeof(nodemask) * 8, 0);
+    }
+#endif
+
+    return base;
+}
+#endif
+
+/* Allocator that is used instead of malloc()/realloc()/free() if huge pages or a NUMA policy are enabled.
+ * Large blocks are allocated using anonymous memory mappings; smaller blocks come from malloc().
+ */
+static void *large_block_malloc(size_t size)
+{
+    large_block_header *header;
+
+#ifdef USE_MMAP
+    if (size >= LARGE_BLOCK_MIN_SIZE)
+    {
+        size_t mapped_size = size + LARGE_BLOCK_HEADER_SIZE;
+
+        header = (large_block_header *)map_large_block(mapped_size);
+        if (header == NULL)
+        {
+            return NULL;
+        }
+        header->size = size;
+        header->mapped_size = mapped_size;
+        return (char *)header + LARGE_BLOCK_HEADER_SIZE;
+    }
+#endif
+    header = (large_block_header *)malloc(size + LARGE_BLOCK_HEADER_SIZE);
+    if (header == NULL)
+    {
+        return NULL;
+    }
+    header->size = size;
+    header->mapped_size = 0;
+
+    return (char *)header + LARGE_BLOCK_HEADER_SIZE;
+}
+
+static void *large_block_realloc(void *ptr, size_t size)
+{
+    large_block_header *header;
+    void *new_ptr;
+
+    if (ptr == NULL)
+    {
+        return large_block_malloc(size);
+    }
+    header = (large_block_header *)((char *)ptr - LARGE_BLOCK_HEADER_SIZE);
+    if (header->mapped_size == 0 && size < LARGE_BLOCK_MIN_SIZE)
+    {
+        header = (large_block_header *)realloc(header, size + LARGE_BLOCK_HEADER_SIZE);
+        if (header == NULL)
+        {
+            return NULL;
+        }
+        header->size = size;
+        return (char *)header + LARGE_BLOCK_HEADER_SIZE;
+    }
+#if defined(USE_MMAP) && defined(MREMAP_MAYMOVE)
+    if (header->mapped_size != 0 && size >= LARGE_BLOCK_MIN_SIZE)
+    {
+        /* moving the mapping keeps its huge page and NUMA settings and avoids copying the data */
+        size_t mapped_size = size + LARGE_BLOCK_HEADER_SIZE;
+        void *base;
+
+        base = mremap(header, header->mapped_size, mapped_size, MREMAP_MAYMOVE);
+        if (base == MAP_FAILED)
+        {
+            return NULL;
+        }
+        header = (large_block_header *)base;
+        header->size = size;
+        header->mapped_size = mapped_size;
+        return (char *)header + LARGE_BLOCK_HEADER_SIZE;
+    }
+#endif
+    new_ptr = large_block_malloc(size);
+    if (new_ptr == NULL)
+    {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, header->size < size ? header->size : size);
+    large_block_free(ptr);
+
+    return new_ptr;
+}
+
+static void large_block_free(void *ptr)
+{
+    large_block_header *header;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+    header = (large_block_header *)((char *)ptr - LARGE_BLOCK_HEADER_SIZE);
+#ifdef USE_MMAP
+    if (header->mapped_size != 0)
+    {
+        munmap(header, header->mapped_size);
+        return;
+    }
+#endif
+    free(header);
+}
+
+/* Determine the size class of a block that should hold size bytes and the (rounded up) capacity of blocks of that
+ * class. Returns -1 if the block is too small to be pooled.
+ */
+static int buffer_pool_size_class(size_t size, size_t *capacity)
+{
+    size_t step;
+    int exponent = 0;
+
+    if (size < BUFFER_POOL_MIN_SIZE)
+    {
+        return -1;
+    }
+    /* determine the step such that size / step is in [4, 8) */
+    while ((size >> exponent) >= 8)
+    {
+        exponent++;
+    }
+    step = (size_t)1 << exponent;
+    *capacity = (size + step - 1) & ~(step - 1);
+
+    /* a capacity of 8 steps is the first size class of the next exponent, which is what this formula gives */
+    return (exponent - BUFFER_POOL_MIN_STEP_EXPONENT) * 4 + (int)(*capacity >> exponent) - 4;
+}
+
+/* Release unused blocks of the buffer pool until at most max_size bytes are kept (largest size classes first).
+ * The memory_mutex should be locked by the caller.
+ */
+static void buffer_pool_trim(int64_t max_size)
+{
+    int i;
+
+    for (i = BUFFER_POOL_NUM_SIZE_CLASSES - 1; i >= 0 && buffer_pool_size > max_size; i--)
+    {
+        while (buffer_pool_list[i] != NULL && buffer_pool_size > max_size)
+        {
+            buffer_pool_header *header = buffer_pool_list[i];
+
+            buffer_pool_list[i] = header->next;
+            buffer_pool_size -= header->capacity;
+            allocator_free(header);
+            allocator_num_allocations--;
+        }
+    }
+}
+
+/* Allocate a block from the buffer pool (or a new block if the pool has no unused block of the right size class).
+ * reused is set to 1 if the block was reused (and thus does not have zero filled content).
+ */
+static void *buffer_pool_malloc(size_t size, int *reused)
+{
+    buffer_pool_header *header;
+    size_t capacity = size;
+    int size_class;
+
+    *reused = 0;
+    size_class = buffer_pool_size_class(size, &capacity);
+    if (size_class >= 0)
+    {
+        harp_mutex_lock(&memory_mutex);
+        header = buffer_pool_list[size_class];
+        if (header != NULL)
+        {
+            buffer_pool_list[size_class] = header->next;
+            buffer_pool_size -= header->capacity;
+            harp_mutex_unlock(&memory_mutex);
+            *reused = 1;
+            return (char *)header + BUFFER_POOL_HEADER_SIZE;
+        }
+        harp_mutex_unlock(&memory_mutex);
+    }
+
+    header = (buffer_pool_header *)allocator_malloc(capacity + BUFFER_POOL_HEADER_SIZE);
+    if (header == NULL)
+    {
+        return NULL;
+    }
+    header->capacity = capacity;
+    header->size_class = size_class;
+    header->next = NULL;
+    harp_mutex_lock(&memory_mutex);
+    allocator_num_allocations++;
+    harp_mutex_unlock(&memory_mutex);
+
+    return (char *)header + BUFFER_POOL_HEADER_SIZE;
+}
+
+/* Give a block back to the buffer pool (or release it if it can not be pooled or if the pool is full) */
+static void buffer_pool_free(void *ptr)
+{
+    buffer_pool_header *header = (buffer_pool_header *)((char *)ptr - BUFFER_POOL_HEADER_SIZE);
+
+    harp_mutex_lock(&memory_mutex);
+    if (header->size_class >= 0 && buffer_pool_size + (int64_t)header->capacity <= buffer_pool_max_size)
+    {
+        header->next = buffer_pool_list[header->size_class];
+        buffer_pool_list[header->size_class] = header;
+        buffer_pool_size += header->capacity;
+        harp_mutex_unlock(&memory_mutex);
+        return;
+    }
+    allocator_num_allocations--;
+    harp_mutex_unlock(&memory_mutex);
+    allocator_free(header);
+}
+
+static void *buffer_pool_realloc(void *ptr, size_t size)
+{
+    buffer_pool_header *header = (buffer_pool_header *)((char *)ptr - BUFFER_POOL_HEADER_SIZE);
+    size_t capacity = size;
+    int size_class;
+    int reused;
+    void *new_ptr;
+
+    size_class = buffer_pool_size_class(size, &capacity);
+    if (size_class >= 0 && size_class == header->size_class)
+    {
+        /* the block already has the right size */
+        return ptr;
+    }
+    if (size_class < 0 && header->size_class < 0)
+    {
+        header = (buffer_pool_header *)allocator_realloc(header, size + BUFFER_POOL_HEADER_SIZE);
+        if (header == NULL)
+        {
+            return NULL;
+        }
+        header->capacity = size;
+        return (char *)header + BUFFER_POOL_HEADER_SIZE;
+    }
+
+    new_ptr = buffer_pool_malloc(size, &reused);
+    if (new_ptr == NULL)
+    {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, header->capacity < size ? header->capacity : size);
+    buffer_pool_free(ptr);
+
+    return new_ptr;
+}
+
+/* Set the maximum number of bytes that the buffer pool keeps in unused blocks (0 disables the pool).
+ * This is used by harp_set_option_buffer_pool_size() (which should update the option after a successful call).
+ * The pool can only be enabled or disabled while no memory is allocated with the current allocator, since this
+ * changes the layout of the allocated blocks; the size of an enabled pool can be changed at any moment.
+ */
+int harp_memory_set_buffer_pool_size(int64_t max_size)
+{
+    harp_mutex_lock(&memory_mutex);
+    buffer_pool_trim(max_size);
+    if ((buffer_pool_max_size > 0) != (max_size > 0))
+    {
+        if (allocator_num_allocations != 0)
+        {
+            long num_allocations = allocator_num_allocations;
+
+            harp_mutex_unlock(&memory_mutex);
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot enable or disable the buffer pool while %ld blocks "
+                           "of memory are allocated", num_allocations);
+            return -1;
+        }
+    }
+    buffer_pool_max_size = max_size;
+    harp_mutex_unlock(&memory_mutex);
+
+    return 0;
+}
+
+/* Switch the default allocator between the C library functions and the large block allocator.
+ * This is used by harp_set_option_huge_pages() and harp_set_option_numa_policy() (which should update the options
+ * after a successful call). If a custom allocator is set using harp_set_allocator() then that allocator remains in
+ * use (and the large block allocator will be used once the default allocator is restored).
+ * Fails if memory is still allocated with the current (default) allocator.
+ */
+int harp_memory_set_large_block_allocator(int enable)
+{
+    harp_mutex_lock(&memory_mutex);
+    /* unused blocks of the buffer pool came from the current allocator */
+    buffer_pool_trim(0);
+    if (!allocator_is_custom && (allocator_malloc == large_block_malloc) != (enable != 0))
+    {
+        if (allocator_num_allocations != 0)
+        {
+            long num_allocations = allocator_num_allocations;
+
+            harp_mutex_unlock(&memory_mutex);
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot change memory allocation options while %ld blocks of "
+                           "memory are allocated", num_allocations);
+            return -1;
+        }
+        allocator_malloc = enable ? large_block_malloc : malloc;
+        allocator_realloc = enable ? large_block_realloc : realloc;
+        allocator_free = enable ? large_block_free : free;
+    }
+    harp_mutex_unlock(&memory_mutex);
+
+    return 0;
+}
+
+/* Allocate size bytes using the allocator that was set with harp_set_allocator().
+ * Memory allocated with this function should be reallocated with harp_realloc() and released with harp_free().
+ */
+void *harp_malloc(size_t size)
+{
+    void *ptr;
+
+    if (buffer_pool_max_size > 0)
+    {
+        int reused;
+
+        return buffer_pool_malloc(size, &reused);
+    }
+    ptr = allocator_malloc(size);
+    if (ptr != NULL)
+    {
+        harp_mutex_lock(&memory_mutex);
+        allocator_num_allocations++;
+        harp_mutex_unlock(&memory_mutex);
+    }
+
+    return ptr;
+}
+
+/* Allocate a zero filled block of num_elements * element_size bytes (see harp_malloc()).
+ * Blocks from an anonymous memory mapping are not explicitly zeroed, such that their pages do not get assigned (to the
+ * NUMA node of the calling thread) until the data is written.
+ */
+void *harp_calloc(size_t num_elements, size_t element_size)
+{
+    size_t size = num_elements * element_size;
+    void *ptr;
+
+    if (buffer_pool_max_size > 0)
+    {
+        int reused;
+
+        ptr = buffer_pool_malloc(size, &reused);
+        if (ptr == NULL)
+        {
+            return NULL;
+        }
+        if (!reused && allocator_malloc == large_block_malloc &&
+            ((large_block_header *)((char *)ptr - BUFFER_POOL_HEADER_SIZE - LARGE_BLOCK_HEADER_SIZE))->mapped_size !=
+            0)
+        {
+            return ptr;
+        }
+        memset(ptr, 0, size);
+        return ptr;
+    }
+    ptr = harp_malloc(size);
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+    if (allocator_malloc == large_block_malloc &&
+        ((large_block_header *)((char *)ptr - LARGE_BLOCK_HEADER_SIZE))->mapped_size != 0)
+    {
+        return ptr;
+    }
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+/* Reallocate a block that was allocated with harp_malloc() (or allocate a new block if ptr is NULL). */
+void *harp_realloc(void *ptr, size_t size)
+{
+    void *new_ptr;
+
+    if (buffer_pool_max_size > 0)
+    {
+        if (ptr == NULL)
+        {
+            int reused;
+
+            return buffer_pool_malloc(size, &reused);
+        }
+        return buffer_pool_realloc(ptr, size);
+    }
+    new_ptr = allocator_realloc(ptr, size);
+    if (ptr == NULL && new_ptr != NULL)
+    {
+        harp_mutex_lock(&memory_mutex);
+        allocator_num_allocations++;
+        harp_mutex_unlock(&memory_mutex);
+    }
+
+    return new_ptr;
+}
+
+/* Release a block that was allocated with harp_malloc() or harp_realloc(). */
+void harp_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        if (buffer_pool_max_size > 0)
+        {
+            buffer_pool_free(ptr);
+            return;
+        }
+        allocator_free(ptr);
+        harp_mutex_lock(&memory_mutex);
+        allocator_num_allocations--;
+        harp_mutex_unlock(&memory_mutex);
+    }
+}
+
+/** \addtogroup harp_general
+ * @{
+ */
+
+/** Set the functions that HARP uses to allocate memory.
+ * The functions are used for the data arrays of variables (for string variables only the array of string pointers;
+ * the strings themselves are always allocated using the system malloc()) and for the scratch buffers that are used
+ * during ingestion. This makes it possible to use e.g. a different malloc implementation or an allocator that uses
+ * huge pages for the bulk of the memory that HARP uses.
+ *
+ * The functions should have the same semantics as the C library malloc(), realloc() and free() functions and should
+ * be safe to call from multiple threads if HARP is used from multiple threads.
+ *
+ * The allocator can only be changed while no memory is allocated with the current allocator (i.e. before any product
+ * or variable is created, or after they have all been deleted).
+ * Passing NULL for all three functions restores the default allocator (the C library functions).
+ * The harp_set_option_huge_pages() and harp_set_option_numa_policy() options only apply to the default allocator.
+ * \param malloc_function Function that allocates a block of memory.
+ * \param realloc_function Function that changes the size of a block of memory.
+ * \param free_function Function that releases a block of memory.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_allocator(void *(*malloc_function) (size_t size),
+                                   void *(*realloc_function) (void *ptr, size_t size),
+                                   void (*free_function) (void *ptr))
+{
+    int is_custom = 1;
+
+    if (malloc_function == NULL && realloc_function == NULL && free_function == NULL)
+    {
+        if (harp_option_huge_pages || harp_option_numa_policy != 0)
+        {
+            malloc_function = large_block_malloc;
+            realloc_function = large_block_realloc;
+            free_function = large_block_free;
+        }
+        else
+        {
+            malloc_function = malloc;
+            realloc_function = realloc;
+            free_function = free;
+        }
+        is_custom = 0;
+    }
+    else if (malloc_function == NULL || realloc_function == NULL || free_function == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "either all or none of the allocator functions should be NULL "
+                       "(%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_mutex_lock(&memory_mutex);
+    /* unused blocks of the buffer pool came from the current allocator */
+    buffer_pool_trim(0);
+    if (allocator_num_allocations != 0)
+    {
+        long num_allocations = allocator_num_allocations;
+
+        harp_mutex_unlock(&memory_mutex);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot change allocator while %ld blocks of memory are allocated "
+                       "with the current allocator", num_allocations);
+        return -1;
+    }
+    allocator_malloc = malloc_function;
+    allocator_realloc = realloc_function;
+    allocator_free = free_function;
+    allocator_is_custom = is_custom;
+    harp_mutex_unlock(&memory_mutex);
+
+    return 0;
+}
+
+/** Retrieve the amount of memory that is in use for the data of variables.
+ * This includes the data of all variables in the process whose data is owned by HARP (i.e. excluding data borrowed
+ * using harp_variable_new_with_borrowed_data()). For string variables only the array of string pointers is included.
+ * \see harp_set_option_memory_limit()
+ * \param current_size Pointer to the variable where the number of bytes currently in use will be stored (can be NULL).
+ * \param peak_size Pointer to the variable where the maximum number of bytes that was in use at any time since the
+ * start of the program (or since the last call to harp_reset_peak_memory_usage()) will be stored (can be NULL).
+ */
+LIBHARP_API void harp_get_memory_usage(int64_t *current_size, int64_t *peak_size)
+{
+    harp_mutex_lock(&memory_mutex);
+    if (current_size != NULL)
+    {
+        *current_size = memory_current_size;
+    }
+    if (peak_size != NULL)
+    {
+        *peak_size = memory_peak_size;
+    }
+    harp_mutex_unlock(&memory_mutex);
+}
+
+/** Reset the peak memory usage to the amount of memory that is currently in use.
+ * \see harp_get_memory_usage()
+ */
+LIBHARP_API void harp_reset_peak_memory_usage(void)
+{
+    harp_mutex_lock(&memory_mutex);
+    memory_peak_size = memory_current_size;
+    harp_mutex_unlock(&memory_mutex);
+}
+
+/** @} */
@@ -38,6 +38,9 @@
 
 #include "netcdf.h"
 
+/* number of bytes of free space to reserve after the header of a newly written file */
+#define NETCDF_HEADER_RESERVE 4096
+
 typedef enum netcdf_dimension_type_enum
 {
     netcdf_dimension_time,
@@ -56,6 +59,12 @@ typedef struct netcdf_dimensions_struct
     long *length;
 } netcdf_dimensions;
 
+static int close_file(int ncid)
+{
+    harp_io_statistics_add_close(harp_io_backend_netcdf);
+    return nc_close(ncid);
+}
+
 static const char *get_dimension_type_name(netcdf_dimension_type dimension_type)
 {
     switch (dimension_type)
@@ -425,7 +434,11 @@ static int read_numeric_attribute(int ncid, int varid, const char *name, harp_da
     return 0;
 }
 
-static int read_variable(harp_product *product, int ncid, int varid, netcdf_dimensions *dimensions)
+/* Read a variable from the product. If time_length >= 0, only the time samples in the range
+ * [time_offset, time_offset + time_length) will be read for a variable that depends on the time dimension.
+ */
+static int read_variable(harp_product *product, int ncid, int varid, netcdf_dimensions *dimensions, long time_offset,
+                         long time_length)
 {
     harp_variable *variable;
     harp_data_type data_type;
@@ -436,6 +449,8 @@ static int read_variable(harp_product *product, int ncid, int varid, netcdf_dime
     nc_type netcdf_data_type;
     int netcdf_num_dimensions;
     int netcdf_dim_id[NC_MAX_VAR_DIMS];
+    size_t start[NC_MAX_VAR_DIMS];
+    size_t count[NC_MAX_VAR_DIMS];
     int result;
     long i;
 
@@ -489,9 +504,21 @@ static int read_variable(harp_product *product, int ncid, int varid, netcdf_dime
         }
     }
 
+    for (i = 0; i < netcdf_num_dimensions; i++)
+    {
+        start[i] = 0;
+        count[i] = dimensions->length[netcdf_dim_id[i]];
+    }
+    if (time_length >= 0 && num_dimensions > 0 && dimension_type[0] == harp_dimension_time)
+    {
+        assert(time_offset + time_length <= (long)count[0]);
+        start[0] = time_offset;
+        count[0] = time_length;
+    }
+
     for (i = 0; i < num_dimensions; i++)
     {
-        dimension[i] = dimensions->length[netcdf_dim_id[i]];
+        dimension[i] = count[i];
     }
 
     if (harp_variable_new(netcdf_name, data_type, num_dimensions, dimension_type, dimension, &variable) != 0)
@@ -522,30 +549,19 @@ static int read_variable(harp_product *product, int ncid, int varid, netcdf_dime
             return -1;
         }
 
-        result = nc_get_var_text(ncid, varid, buffer);
+        result = nc_get_vara_text(ncid, varid, start, count, buffer);
         if (result != NC_NOERR)
         {
             harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
             free(buffer);
             return -1;
         }
+        harp_io_statistics_add_read(harp_io_backend_netcdf, variable->num_elements * length * sizeof(char));
 
-        for (i = 0; i < variable->num_elements; i++)
+        if (harp_variable_set_string_data_from_char_array(variable, (long)length, buffer) != 0)
         {
-            char *str;
-
-            str = malloc((length + 1) * sizeof(char));
-            if (str == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (length + 1) * sizeof(char), __FILE__, __LINE__);
-                free(buffer);
-                return -1;
-            }
-
-            memcpy(str, &buffer[i * length], length);
-            str[length] = '\0';
-            variable->data.string_data[i] = str;
+            free(buffer);
+            return -1;
         }
 
         free(buffer);
@@ -555,19 +571,19 @@ static int read_variable(harp_product *product, int ncid, int varid, netcdf_dime
         switch (data_type)
         {
             case harp_type_int8:
-                result = nc_get_var_schar(ncid, varid, variable->data.int8_data);
+                result = nc_get_vara_schar(ncid, varid, start, count, variable->data.int8_data);
                 break;
             case harp_type_int16:
-                result = nc_get_var_short(ncid, varid, variable->data.int16_data);
+                result = nc_get_vara_short(ncid, varid, start, count, variable->data.int16_data);
                 break;
             case harp_type_int32:
-                result = nc_get_var_int(ncid, varid, variable->data.int32_data);
+                result = nc_get_vara_int(ncid, varid, start, count, variable->data.int32_data);
                 break;
             case harp_type_float:
-                result = nc_get_var_float(ncid, varid, variable->data.float_data);
+                result = nc_get_vara_float(ncid, varid, start, count, variable->data.float_data);
                 break;
             case harp_type_double:
-                result = nc_get_var_double(ncid, varid, variable->data.double_data);
+                result = nc_get_vara_double(ncid, varid, start, count, variable->data.double_data);
                 break;
             default:
                 assert(0);
@@ -579,6 +595,8 @@ static int read_variable(harp_product *product, int ncid, int varid, netcdf_dime
             harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
             return -1;
         }
+        harp_io_statistics_add_read(harp_io_backend_netcdf,
+                                    variable->num_elements * harp_get_size_for_type(variable->data_type));
     }
 
     /* Read attributes. */
@@ -714,7 +732,161 @@ static int verify_product(int ncid)
     return -1;
 }
 
-static int read_product(int ncid, harp_product *product, netcdf_dimensions *dimensions)
+/* Determine which variables need to be read, based on the keep()/exclude() operations at the start of the program */
+static int get_included_variables(int ncid, int num_variables, const harp_program *program, uint8_t *include)
+{
+    char (*name)[NC_MAX_NAME + 1];
+    const char **variable_name;
+    int result;
+    int i;
+
+    if (program == NULL)
+    {
+        memset(include, 1, num_variables * sizeof(uint8_t));
+        return 0;
+    }
+
+    name = malloc(num_variables * sizeof(*name));
+    if (name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_variables * sizeof(*name), __FILE__, __LINE__);
+        return -1;
+    }
+    variable_name = (const char **)malloc(num_variables * sizeof(const char *));
+    if (variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_variables * sizeof(const char *), __FILE__, __LINE__);
+        free(name);
+        return -1;
+    }
+
+    for (i = 0; i < num_variables; i++)
+    {
+        result = nc_inq_varname(ncid, i, name[i]);
+        if (result != NC_NOERR)
+        {
+            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+            free(variable_name);
+            free(name);
+            return -1;
+        }
+        variable_name[i] = name[i];
+    }
+
+    harp_program_get_included_variables(program, num_variables, variable_name, include);
+
+    free(variable_name);
+    free(name);
+
+    return 0;
+}
+
+/* Determine the range of time samples that needs to be read, based on the value filters that follow the
+ * keep()/exclude() operations at the start of the program. The filters are evaluated on the one-dimensional time
+ * dependent variables that they refer to. If all time samples need to be read, time_length will be set to -1.
+ */
+static int get_time_range(int ncid, int num_variables, const uint8_t *include, harp_program *program,
+                          netcdf_dimensions *dimensions, long *time_offset, long *time_length)
+{
+    harp_product *filter_product;
+    int i;
+
+    *time_offset = 0;
+    *time_length = -1;
+
+    if (program == NULL)
+    {
+        return 0;
+    }
+
+    if (harp_product_new(&filter_product) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < num_variables; i++)
+    {
+        char name[NC_MAX_NAME + 1];
+        int netcdf_num_dimensions;
+        int netcdf_dim_id[NC_MAX_VAR_DIMS];
+        int result;
+
+        if (!include[i])
+        {
+            continue;
+        }
+
+        result = nc_inq_var(ncid, i, name, NULL, &netcdf_num_dimensions, netcdf_dim_id, NULL);
+        if (result != NC_NOERR)
+        {
+            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+            harp_product_delete(filter_product);
+            return -1;
+        }
+
+        /* only one-dimensional time dependent variables (which includes string variables with a time dimension) */
+        if (netcdf_num_dimensions < 1 || netcdf_num_dimensions > 2 ||
+            dimensions->type[netcdf_dim_id[0]] != netcdf_dimension_time ||
+            (netcdf_num_dimensions == 2 && dimensions->type[netcdf_dim_id[1]] != netcdf_dimension_string))
+        {
+            continue;
+        }
+
+        if (!harp_program_is_leading_value_filter_variable(program, name))
+        {
+            continue;
+        }
+
+        if (read_variable(filter_product, ncid, i, dimensions, 0, -1) != 0)
+        {
+            harp_product_delete(filter_product);
+            return -1;
+        }
+    }
+
+    if (filter_product->num_variables > 0)
+    {
+        long offset;
+        long length;
+        int result;
+
+        /* collocation filters need the source product to select the collocation mask */
+        result = nc_inq_att(ncid, NC_GLOBAL, "source_product", NULL, NULL);
+        if (result == NC_NOERR)
+        {
+            if (read_string_attribute(ncid, NC_GLOBAL, "source_product", &filter_product->source_product) != 0)
+            {
+                harp_product_delete(filter_product);
+                return -1;
+            }
+        }
+        else if (result != NC_ENOTATT)
+        {
+            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+            harp_product_delete(filter_product);
+            return -1;
+        }
+
+        if (harp_program_get_leading_value_filter_time_range(program, filter_product, &offset, &length) != 0)
+        {
+            harp_product_delete(filter_product);
+            return -1;
+        }
+        if (length < filter_product->dimension[harp_dimension_time])
+        {
+            *time_offset = offset;
+            *time_length = length;
+        }
+    }
+
+    harp_product_delete(filter_product);
+
+    return 0;
+}
+
+static int read_product(int ncid, harp_program *program, harp_product *product, netcdf_dimensions *dimensions)
 {
     int num_dimensions;
     int num_variables;
@@ -755,12 +927,48 @@ static int read_product(int ncid, harp_product *product, netcdf_dimensions *dime
         }
     }
 
-    for (i = 0; i < num_variables; i++)
+    if (num_variables > 0)
     {
-        if (read_variable(product, ncid, i, dimensions) != 0)
+        uint8_t *include;
+        long time_offset = 0;
+        long time_length = -1;
+
+        include = (uint8_t *)malloc(num_variables * sizeof(uint8_t));
+        if (include == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_variables * sizeof(uint8_t), __FILE__, __LINE__);
+            return -1;
+        }
+
+        if (get_included_variables(ncid, num_variables, program, include) != 0)
+        {
+            free(include);
+            return -1;
+        }
+
+        if (get_time_range(ncid, num_variables, include, program, dimensions, &time_offset, &time_length) != 0)
         {
+            free(include);
             return -1;
         }
+
+        for (i = 0; i < num_variables; i++)
+        {
+            if (!include[i])
+            {
+                /* variable would be removed by the program anyway, so don't read its data */
+                continue;
+            }
+
+            if (read_variable(product, ncid, i, dimensions, time_offset, time_length) != 0)
+            {
+                free(include);
+                return -1;
+            }
+        }
+
+        free(include);
     }
 
     result = nc_inq_att(ncid, NC_GLOBAL, "source_product", NULL, NULL);
@@ -794,51 +1002,38 @@ static int read_product(int ncid, harp_product *product, netcdf_dimensions *dime
     return 0;
 }
 
-int harp_import_netcdf(const char *filename, harp_product **product)
+/* read the product from an opened netCDF file; the file will always be closed by this function */
+static int import_and_close(int ncid, harp_program *program, harp_product **product)
 {
     harp_product *new_product;
     netcdf_dimensions dimensions;
-    int ncid;
     int result;
 
-    if (filename == NULL)
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
-        return -1;
-    }
-
-    result = nc_open(filename, 0, &ncid);
-    if (result != NC_NOERR)
-    {
-        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
-        return -1;
-    }
-
     if (verify_product(ncid) != 0)
     {
-        nc_close(ncid);
+        close_file(ncid);
         return -1;
     }
 
     if (harp_product_new(&new_product) != 0)
     {
-        nc_close(ncid);
+        close_file(ncid);
         return -1;
     }
 
     dimensions_init(&dimensions);
 
-    if (read_product(ncid, new_product, &dimensions) != 0)
+    if (read_product(ncid, program, new_product, &dimensions) != 0)
     {
         dimensions_done(&dimensions);
         harp_product_delete(new_product);
-        nc_close(ncid);
+        close_file(ncid);
         return -1;
     }
 
     dimensions_done(&dimensions);
 
-    result = nc_close(ncid);
+    result = close_file(ncid);
     if (result != NC_NOERR)
     {
         harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
@@ -850,12 +1045,70 @@ int harp_import_netcdf(const char *filename, harp_product **product)
     return 0;
 }
 
+int harp_import_netcdf(const char *filename, harp_program *program, harp_product **product)
+{
+    int ncid;
+    int result;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    result = nc_open(filename, 0, &ncid);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_netcdf);
+
+    return import_and_close(ncid, program, product);
+}
+
+/* the buffer is only read from and needs to remain available until the import is finished */
+int harp_import_netcdf_from_memory(const void *buffer, long size, harp_program *program, harp_product **product)
+{
+    int ncid;
+    int result;
+
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "buffer is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid buffer size (%ld) (%s:%u)", size, __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* the memory of an in-memory file that is opened read-only is never modified */
+    result = nc_open_mem("<memory>", 0, (size_t)size, (void *)buffer, &ncid);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_netcdf);
+
+    return import_and_close(ncid, program, product);
+}
+
+static const char *spatial_extent_attribute_name[4] = {
+    "geospatial_lat_min", "geospatial_lat_max", "geospatial_lon_min", "geospatial_lon_max"
+};
+
+/* the spatial extent (if not NULL) is read as latitude_min, latitude_max, longitude_min, longitude_max; values for
+ * which the attribute is not present are set to NaN */
 int harp_import_global_attributes_netcdf(const char *filename, double *datetime_start, double *datetime_stop,
-                                         long dimension[], char **source_product)
+                                         double *spatial_extent, long dimension[], char **source_product)
 {
     char *attr_source_product = NULL;
     harp_scalar attr_datetime_start;
     harp_scalar attr_datetime_stop;
+    double attr_spatial_extent[4];
     harp_data_type attr_data_type;
     long attr_dimension[HARP_NUM_DIM_TYPES];
     int result;
@@ -874,10 +1127,11 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
         harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
         return -1;
     }
+    harp_io_statistics_add_open(harp_io_backend_netcdf);
 
     if (verify_product(ncid) != 0)
     {
-        nc_close(ncid);
+        close_file(ncid);
         return -1;
     }
 
@@ -887,14 +1141,14 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
         {
             if (read_numeric_attribute(ncid, NC_GLOBAL, "datetime_start", &attr_data_type, &attr_datetime_start) != 0)
             {
-                nc_close(ncid);
+                close_file(ncid);
                 return -1;
             }
 
             if (attr_data_type != harp_type_double)
             {
                 harp_set_error(HARP_ERROR_IMPORT, "attribute 'datetime_start' has invalid type");
-                nc_close(ncid);
+                close_file(ncid);
                 return -1;
             }
         }
@@ -910,14 +1164,14 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
         {
             if (read_numeric_attribute(ncid, NC_GLOBAL, "datetime_stop", &attr_data_type, &attr_datetime_stop) != 0)
             {
-                nc_close(ncid);
+                close_file(ncid);
                 return -1;
             }
 
             if (attr_data_type != harp_type_double)
             {
                 harp_set_error(HARP_ERROR_IMPORT, "attribute 'datetime_stop' has invalid type");
-                nc_close(ncid);
+                close_file(ncid);
                 return -1;
             }
         }
@@ -927,6 +1181,33 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
         }
     }
 
+    if (spatial_extent != NULL)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            attr_spatial_extent[i] = harp_nan();
+            if (nc_inq_att(ncid, NC_GLOBAL, spatial_extent_attribute_name[i], NULL, NULL) == NC_NOERR)
+            {
+                harp_scalar value;
+
+                if (read_numeric_attribute(ncid, NC_GLOBAL, spatial_extent_attribute_name[i], &attr_data_type,
+                                           &value) != 0)
+                {
+                    close_file(ncid);
+                    return -1;
+                }
+                if (attr_data_type != harp_type_double)
+                {
+                    harp_set_error(HARP_ERROR_IMPORT, "attribute '%s' has invalid type",
+                                   spatial_extent_attribute_name[i]);
+                    close_file(ncid);
+                    return -1;
+                }
+                attr_spatial_extent[i] = value.double_data;
+            }
+        }
+    }
+
     if (dimension != NULL)
     {
         int num_dimensions;
@@ -982,7 +1263,7 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
         {
             if (read_string_attribute(ncid, NC_GLOBAL, "source_product", &attr_source_product) != 0)
             {
-                nc_close(ncid);
+                close_file(ncid);
                 return -1;
             }
         }
@@ -999,7 +1280,7 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
         }
     }
 
-    result = nc_close(ncid);
+    result = close_file(ncid);
     if (result != NC_NOERR)
     {
         harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
@@ -1017,6 +1298,14 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
         *datetime_stop = attr_datetime_stop.double_data;
     }
 
+    if (spatial_extent != NULL)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            spatial_extent[i] = attr_spatial_extent[i];
+        }
+    }
+
     if (source_product != NULL)
     {
         *source_product = attr_source_product;
@@ -1036,7 +1325,8 @@ int harp_import_global_attributes_netcdf(const char *filename, double *datetime_
     return 0;
 }
 
-static int write_dimensions(int ncid, const netcdf_dimensions *dimensions)
+/* if unlimited_time is set, the time dimension is created as the (extendable) record dimension */
+static int write_dimensions(int ncid, const netcdf_dimensions *dimensions, int unlimited_time)
 {
     int result;
     int i;
@@ -1059,6 +1349,10 @@ static int write_dimensions(int ncid, const netcdf_dimensions *dimensions)
             sprintf(name, "string_%ld", dimensions->length[i]);
             result = nc_def_dim(ncid, name, dimensions->length[i], &dim_id);
         }
+        else if (dimensions->type[i] == netcdf_dimension_time && unlimited_time)
+        {
+            result = nc_def_dim(ncid, get_dimension_type_name(dimensions->type[i]), NC_UNLIMITED, &dim_id);
+        }
         else
         {
             result = nc_def_dim(ncid, get_dimension_type_name(dimensions->type[i]), dimensions->length[i], &dim_id);
@@ -1126,6 +1420,21 @@ static int write_numeric_attribute(int ncid, int varid, const char *name, harp_d
     return 0;
 }
 
+/* Returns the length of the string dimension that is used for a string variable (with a minimum length of 1). */
+static long get_string_dimension_length(const harp_variable *variable)
+{
+    long length;
+
+    /* netCDF does not support zero length dimensions, so ensure a minimum length of 1 */
+    length = harp_get_max_string_length(variable->num_elements, variable->data.string_data);
+    if (length == 0)
+    {
+        length = 1;
+    }
+
+    return length;
+}
+
 static int write_variable_definition(int ncid, const harp_variable *variable, netcdf_dimensions *dimensions, int *varid)
 {
     int num_dimensions;
@@ -1152,18 +1461,10 @@ static int write_variable_definition(int ncid, const harp_variable *variable, ne
      */
     if (variable->data_type == harp_type_string)
     {
-        long length;
-
         assert((num_dimensions + 1) < NC_MAX_VAR_DIMS);
 
-        /* determine length for the string dimension (ensure a minimum length of 1) */
-        length = harp_get_max_string_length(variable->num_elements, variable->data.string_data);
-        if (length == 0)
-        {
-            length = 1;
-        }
-
-        dim_id[num_dimensions] = dimensions_find(dimensions, netcdf_dimension_string, length);
+        dim_id[num_dimensions] = dimensions_find(dimensions, netcdf_dimension_string,
+                                                 get_string_dimension_length(variable));
         assert(dim_id[num_dimensions] >= 0);
 
         num_dimensions++;
@@ -1241,38 +1542,59 @@ static int write_variable_definition(int ncid, const harp_variable *variable, ne
     return 0;
 }
 
-static int write_variable(int ncid, int varid, const harp_variable *variable)
+/* Write the data of a variable. For time dependent variables the data is written starting at the given time_offset
+ * (which should be 0 if the time dimension is not the record dimension). String variables are written using
+ * string_length characters per string (this should be at least the length of the longest string).
+ */
+static int write_variable(int ncid, int varid, const harp_variable *variable, long time_offset, long string_length)
 {
+    size_t start[NC_MAX_VAR_DIMS];
+    size_t count[NC_MAX_VAR_DIMS];
     int result = NC_NOERR;
+    int i;
+
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        start[i] = 0;
+        count[i] = (size_t)variable->dimension[i];
+    }
+    if (variable->num_dimensions > 0 && variable->dimension_type[0] == harp_dimension_time)
+    {
+        start[0] = (size_t)time_offset;
+    }
 
     switch (variable->data_type)
     {
         case harp_type_int8:
-            result = nc_put_var_schar(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_schar(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_int16:
-            result = nc_put_var_short(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_short(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_int32:
-            result = nc_put_var_int(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_int(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_float:
-            result = nc_put_var_float(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_float(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_double:
-            result = nc_put_var_double(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_double(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_string:
             {
                 char *buffer;
+                long length;
 
-                if (harp_get_char_array_from_string_array(variable->num_elements, variable->data.string_data, 1, NULL,
-                                                          &buffer) != 0)
+                if (harp_get_char_array_from_string_array(variable->num_elements, variable->data.string_data,
+                                                          string_length, &length, &buffer) != 0)
                 {
                     return -1;
                 }
+                assert(length == string_length);
+                start[variable->num_dimensions] = 0;
+                count[variable->num_dimensions] = (size_t)length;
 
-                result = nc_put_var_text(ncid, varid, buffer);
+                result = nc_put_vara_text(ncid, varid, start, count, buffer);
                 free(buffer);
             }
             break;
@@ -1287,13 +1609,24 @@ static int write_variable(int ncid, int varid, const harp_variable *variable)
     return 0;
 }
 
-static int write_product(int ncid, const harp_product *product, netcdf_dimensions *dimensions)
+/* if unlimited_time is set, the time dimension is created as the record dimension, such that more time samples can
+ * be appended to the file afterwards */
+static int write_product(int ncid, const harp_product *product, netcdf_dimensions *dimensions, int unlimited_time)
 {
     harp_scalar datetime_start;
     harp_scalar datetime_stop;
+    harp_scalar spatial_extent[4];
     int result;
     int i;
 
+    /* all variables get written completely, so prefilling them with fill values is not needed */
+    result = nc_set_fill(ncid, NC_NOFILL, NULL);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+
     /* write conventions */
     if (write_string_attribute(ncid, NC_GLOBAL, "Conventions", HARP_CONVENTION) != 0)
     {
@@ -1314,6 +1647,19 @@ static int write_product(int ncid, const harp_product *product, netcdf_dimension
         }
     }
 
+    if (harp_product_get_spatial_extent(product, &spatial_extent[0].double_data, &spatial_extent[1].double_data,
+                                        &spatial_extent[2].double_data, &spatial_extent[3].double_data) == 0)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            if (write_numeric_attribute(ncid, NC_GLOBAL, spatial_extent_attribute_name[i], harp_type_double,
+                                        spatial_extent[i]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
     if (product->source_product != NULL && strcmp(product->source_product, "") != 0)
     {
         if (write_string_attribute(ncid, NC_GLOBAL, "source_product", product->source_product) != 0)
@@ -1350,16 +1696,7 @@ static int write_product(int ncid, const harp_product *product, netcdf_dimension
 
         if (variable->data_type == harp_type_string)
         {
-            long length;
-
-            /* determine length for the string dimension (ensure a minimum length of 1) */
-            length = harp_get_max_string_length(variable->num_elements, variable->data.string_data);
-            if (length == 0)
-            {
-                length = 1;
-            }
-
-            if (dimensions_add(dimensions, netcdf_dimension_string, length) < 0)
+            if (dimensions_add(dimensions, netcdf_dimension_string, get_string_dimension_length(variable)) < 0)
             {
                 return -1;
             }
@@ -1367,7 +1704,7 @@ static int write_product(int ncid, const harp_product *product, netcdf_dimension
     }
 
     /* write dimensions */
-    if (write_dimensions(ncid, dimensions) != 0)
+    if (write_dimensions(ncid, dimensions, unlimited_time) != 0)
     {
         return -1;
     }
@@ -1384,20 +1721,37 @@ static int write_product(int ncid, const harp_product *product, netcdf_dimension
         assert(varid == i);
     }
 
-    result = nc_enddef(ncid);
+    /* reserve free space after the header such that attributes can be updated or added afterwards without having
+     * to move all variable data */
+    result = nc__enddef(ncid, NETCDF_HEADER_RESERVE, 4, 0, 4);
     if (result != NC_NOERR)
     {
         harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        if (result == NC_EVARSIZE)
+        {
+            harp_add_error_message(" (netCDF-3 limits the size of each variable to 4GB; use HDF5 for larger "
+                                   "variables)");
+        }
         return -1;
     }
 
     /* write variable data */
     for (i = 0; i < product->num_variables; i++)
     {
-        if (write_variable(ncid, i, product->variable[i]) != 0)
+        harp_variable *variable = product->variable[i];
+        long string_length = 0;
+
+        if (variable->data_type == harp_type_string)
         {
+            string_length = get_string_dimension_length(variable);
+        }
+        harp_trace_begin("export(%s)", variable->name);
+        if (write_variable(ncid, i, variable, 0, string_length) != 0)
+        {
+            harp_trace_end();
             return -1;
         }
+        harp_trace_end();
     }
 
     return 0;
@@ -1439,20 +1793,21 @@ int harp_export_netcdf(const char *filename, const harp_product *product)
         harp_add_error_message(" (%s)", filename);
         return -1;
     }
+    harp_io_statistics_add_open(harp_io_backend_netcdf);
 
     dimensions_init(&dimensions);
 
-    if (write_product(ncid, product, &dimensions) != 0)
+    if (write_product(ncid, product, &dimensions, 0) != 0)
     {
         harp_add_error_message(" (%s)", filename);
-        nc_close(ncid);
+        close_file(ncid);
         dimensions_done(&dimensions);
         return -1;
     }
 
     dimensions_done(&dimensions);
 
-    result = nc_close(ncid);
+    result = close_file(ncid);
     if (result != NC_NOERR)
     {
         harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
@@ -1462,3 +1817,488 @@ int harp_export_netcdf(const char *filename, const harp_product *product)
 
     return 0;
 }
+
+/* the returned buffer should be freed by the caller using free() */
+int harp_export_netcdf_to_memory(const harp_product *product, void **buffer, long *size)
+{
+    netcdf_dimensions dimensions;
+    NC_memio memio;
+    int64_t storage_size;
+    int flags = 0;
+    int result;
+    int ncid;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL");
+        return -1;
+    }
+    if (buffer == NULL || size == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "buffer is NULL");
+        return -1;
+    }
+
+    if (harp_product_get_storage_size(product, 1, &storage_size) != 0)
+    {
+        return -1;
+    }
+    if (storage_size > 1073741824)
+    {
+        /* files larger than 1GB will be stored using 64-bit offsets */
+        flags |= NC_64BIT_OFFSET;
+    }
+    /* use the storage size as initial allocation to avoid having to grow the buffer */
+    result = nc_create_mem("<memory>", flags, (size_t)storage_size, &ncid);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_netcdf);
+
+    dimensions_init(&dimensions);
+
+    if (write_product(ncid, product, &dimensions, 0) != 0)
+    {
+        close_file(ncid);
+        dimensions_done(&dimensions);
+        return -1;
+    }
+
+    dimensions_done(&dimensions);
+
+    harp_io_statistics_add_close(harp_io_backend_netcdf);
+    result = nc_close_memio(ncid, &memio);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+
+    *buffer = memio.memory;
+    *size = (long)memio.size;
+
+    return 0;
+}
+
+/* layout of a variable in a streamed export (as defined by the first product) */
+typedef struct netcdf_stream_variable_struct
+{
+    char *name;
+    harp_data_type data_type;
+    int num_dimensions;
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    int num_enum_values;
+    long string_length; /* length of the string dimension (only for string variables) */
+} netcdf_stream_variable;
+
+struct harp_netcdf_export_stream_struct
+{
+    char *filename;
+    int ncid;
+    int num_variables;  /* -1 as long as no product has been appended */
+    netcdf_stream_variable *variable;
+    long dimension[HARP_NUM_DIM_TYPES]; /* length of each dimension as defined by the first product */
+    long num_records;   /* number of time samples that have been written */
+    int has_datetime_range;
+    double datetime_start;
+    double datetime_stop;
+    int has_spatial_extent;
+    double spatial_extent[4];
+};
+
+static void stream_delete(harp_netcdf_export_stream *stream)
+{
+    if (stream->variable != NULL)
+    {
+        int i;
+
+        for (i = 0; i < stream->num_variables; i++)
+        {
+            if (stream->variable[i].name != NULL)
+            {
+                free(stream->variable[i].name);
+            }
+        }
+        free(stream->variable);
+    }
+    if (stream->filename != NULL)
+    {
+        free(stream->filename);
+    }
+    free(stream);
+}
+
+/* store the layout of the first product, which defines the layout of the file */
+static int stream_set_layout(harp_netcdf_export_stream *stream, const harp_product *product)
+{
+    int i;
+
+    stream->variable = malloc(product->num_variables * sizeof(netcdf_stream_variable));
+    if (stream->variable == NULL && product->num_variables > 0)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(netcdf_stream_variable), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->num_variables = product->num_variables;
+    for (i = 0; i < product->num_variables; i++)
+    {
+        stream->variable[i].name = NULL;
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        const harp_variable *variable = product->variable[i];
+        netcdf_stream_variable *layout = &stream->variable[i];
+        int j;
+
+        if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables need to be time dependent (%s)", variable->name);
+            return -1;
+        }
+        layout->name = strdup(variable->name);
+        if (layout->name == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            return -1;
+        }
+        layout->data_type = variable->data_type;
+        layout->num_dimensions = variable->num_dimensions;
+        for (j = 0; j < variable->num_dimensions; j++)
+        {
+            layout->dimension_type[j] = variable->dimension_type[j];
+            layout->dimension[j] = variable->dimension[j];
+        }
+        layout->num_enum_values = variable->num_enum_values;
+        layout->string_length = 0;
+        if (variable->data_type == harp_type_string)
+        {
+            layout->string_length = get_string_dimension_length(variable);
+        }
+    }
+    for (i = 0; i < HARP_NUM_DIM_TYPES; i++)
+    {
+        stream->dimension[i] = product->dimension[i];
+    }
+
+    return 0;
+}
+
+/* verify that the product matches the layout of the file; dimensions that are shorter than in the file are extended */
+static int stream_align_product(harp_netcdf_export_stream *stream, harp_product *product)
+{
+    harp_dimension_type dimension_type;
+    int i;
+
+    if (product->num_variables != stream->num_variables)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "products don't have the same number of variables");
+        return -1;
+    }
+    for (i = 0; i < stream->num_variables; i++)
+    {
+        if (!harp_product_has_variable(product, stream->variable[i].name))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "products don't both have variable '%s'",
+                           stream->variable[i].name);
+            return -1;
+        }
+    }
+
+    for (dimension_type = 0; dimension_type < HARP_NUM_DIM_TYPES; dimension_type++)
+    {
+        if (dimension_type == harp_dimension_time)
+        {
+            continue;
+        }
+        if (product->dimension[dimension_type] > stream->dimension[dimension_type])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "length of %s dimension (%ld) exceeds the length in the "
+                           "output file (%ld)", harp_get_dimension_type_name(dimension_type),
+                           product->dimension[dimension_type], stream->dimension[dimension_type]);
+            return -1;
+        }
+        if (product->dimension[dimension_type] < stream->dimension[dimension_type])
+        {
+            if (harp_product_resize_dimension(product, dimension_type, stream->dimension[dimension_type]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    for (i = 0; i < stream->num_variables; i++)
+    {
+        const netcdf_stream_variable *layout = &stream->variable[i];
+        harp_variable *variable;
+        int j;
+
+        if (harp_product_get_variable_by_name(product, layout->name, &variable) != 0)
+        {
+            return -1;
+        }
+        if (variable->data_type != layout->data_type)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables don't have the same datatype (%s)", layout->name);
+            return -1;
+        }
+        if (variable->num_dimensions != layout->num_dimensions)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables don't have the same number of dimensions (%s)",
+                           layout->name);
+            return -1;
+        }
+        if (variable->num_enum_values != layout->num_enum_values)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables don't have the same number of enumeration values "
+                           "(%s)", layout->name);
+            return -1;
+        }
+        if (variable->dimension_type[0] != harp_dimension_time)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables need to be time dependent (%s)", layout->name);
+            return -1;
+        }
+        for (j = 1; j < layout->num_dimensions; j++)
+        {
+            if (variable->dimension_type[j] != layout->dimension_type[j])
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables (%s) don't have the same type of dimensions",
+                               layout->name);
+                return -1;
+            }
+            if (variable->dimension[j] != layout->dimension[j])
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables (%s) don't have the same dimension lengths",
+                               layout->name);
+                return -1;
+            }
+        }
+        if (layout->data_type == harp_type_string)
+        {
+            long length = get_string_dimension_length(variable);
+
+            if (length > layout->string_length)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "length of string (%ld) for variable '%s' exceeds the "
+                               "string length in the output file (%ld)", length, layout->name, layout->string_length);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int stream_append(harp_netcdf_export_stream *stream, harp_product *product)
+{
+    double datetime_start;
+    double datetime_stop;
+    double extent[4];
+    int i;
+
+    if (stream->num_variables < 0)
+    {
+        netcdf_dimensions dimensions;
+
+        /* the first product defines the layout of the file */
+        if (stream_set_layout(stream, product) != 0)
+        {
+            return -1;
+        }
+        dimensions_init(&dimensions);
+        if (write_product(stream->ncid, product, &dimensions, 1) != 0)
+        {
+            dimensions_done(&dimensions);
+            return -1;
+        }
+        dimensions_done(&dimensions);
+    }
+    else
+    {
+        if (stream_align_product(stream, product) != 0)
+        {
+            return -1;
+        }
+        for (i = 0; i < stream->num_variables; i++)
+        {
+            harp_variable *variable;
+
+            if (harp_product_get_variable_by_name(product, stream->variable[i].name, &variable) != 0)
+            {
+                return -1;
+            }
+            harp_trace_begin("export(%s)", variable->name);
+            if (write_variable(stream->ncid, i, variable, stream->num_records, stream->variable[i].string_length) != 0)
+            {
+                harp_trace_end();
+                return -1;
+            }
+            harp_trace_end();
+        }
+    }
+
+    /* the datetime attributes can only be updated afterwards if they were written for the first product */
+    if ((stream->num_records == 0 || stream->has_datetime_range) &&
+        harp_product_get_datetime_range(product, &datetime_start, &datetime_stop) == 0)
+    {
+        if (!stream->has_datetime_range || datetime_start < stream->datetime_start)
+        {
+            stream->datetime_start = datetime_start;
+        }
+        if (!stream->has_datetime_range || datetime_stop > stream->datetime_stop)
+        {
+            stream->datetime_stop = datetime_stop;
+        }
+        stream->has_datetime_range = 1;
+    }
+    /* same for the spatial extent */
+    if ((stream->num_records == 0 || stream->has_spatial_extent) &&
+        harp_product_get_spatial_extent(product, &extent[0], &extent[1], &extent[2], &extent[3]) == 0)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            /* even indices are minimum values, odd indices are maximum values */
+            if (!stream->has_spatial_extent || (i % 2 == 0 ? extent[i] < stream->spatial_extent[i] :
+                                                extent[i] > stream->spatial_extent[i]))
+            {
+                stream->spatial_extent[i] = extent[i];
+            }
+        }
+        stream->has_spatial_extent = 1;
+    }
+    stream->num_records += product->dimension[harp_dimension_time];
+
+    return 0;
+}
+
+/* Create a netCDF file to which products can be appended one at a time (along the time dimension).
+ * The time dimension is stored as the record dimension of the file, so only the data of the product that is
+ * being appended needs to be in memory.
+ */
+int harp_export_netcdf_stream_open(const char *filename, harp_netcdf_export_stream **new_stream)
+{
+    harp_netcdf_export_stream *stream;
+    int result;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL");
+        return -1;
+    }
+
+    stream = malloc(sizeof(harp_netcdf_export_stream));
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_netcdf_export_stream), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->filename = NULL;
+    stream->ncid = -1;
+    stream->num_variables = -1;
+    stream->variable = NULL;
+    stream->num_records = 0;
+    stream->has_datetime_range = 0;
+    stream->datetime_start = 0;
+    stream->datetime_stop = 0;
+    stream->has_spatial_extent = 0;
+
+    stream->filename = strdup(filename);
+    if (stream->filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        stream_delete(stream);
+        return -1;
+    }
+
+    /* the final size is not known in advance, so always use 64-bit offsets */
+    result = nc_create(filename, NC_64BIT_OFFSET, &stream->ncid);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        harp_add_error_message(" (%s)", filename);
+        stream_delete(stream);
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_netcdf);
+
+    *new_stream = stream;
+
+    return 0;
+}
+
+/* Append the time samples of a product to the file.
+ * All variables of the product should be time dependent. The first product defines the layout of the file; all
+ * products that follow should have the same variables. Dimensions of a product that are shorter than those of the
+ * first product are extended (as for harp_product_append()), longer dimensions result in an error.
+ */
+int harp_export_netcdf_stream_append(harp_netcdf_export_stream *stream, harp_product *product)
+{
+    if (stream_append(stream, product) != 0)
+    {
+        harp_add_error_message(" (%s)", stream->filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Finalize the global attributes, close the file, and release all resources of the stream. */
+int harp_export_netcdf_stream_close(harp_netcdf_export_stream *stream)
+{
+    int status = 0;
+    int result;
+
+    if (stream->num_variables < 0)
+    {
+        /* no products were appended */
+        status = write_string_attribute(stream->ncid, NC_GLOBAL, "Conventions", HARP_CONVENTION);
+    }
+    else if (stream->has_datetime_range)
+    {
+        harp_scalar datetime;
+
+        /* the attributes were written for the first product; replacing a value of the same size is allowed in data
+         * mode */
+        datetime.double_data = stream->datetime_start;
+        status = write_numeric_attribute(stream->ncid, NC_GLOBAL, "datetime_start", harp_type_double, datetime);
+        if (status == 0)
+        {
+            datetime.double_data = stream->datetime_stop;
+            status = write_numeric_attribute(stream->ncid, NC_GLOBAL, "datetime_stop", harp_type_double, datetime);
+        }
+    }
+    if (status == 0 && stream->num_variables >= 0 && stream->has_spatial_extent)
+    {
+        harp_scalar value;
+        int i;
+
+        for (i = 0; status == 0 && i < 4; i++)
+        {
+            value.double_data = stream->spatial_extent[i];
+            status = write_numeric_attribute(stream->ncid, NC_GLOBAL, spatial_extent_attribute_name[i],
+                                             harp_type_double, value);
+        }
+    }
+
+    result = close_file(stream->ncid);
+    if (status == 0 && result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        status = -1;
+    }
+    if (status != 0)
+    {
+        harp_add_error_message(" (%s)", stream->filename);
+    }
+    stream_delete(stream);
+
+    return status;
+}
@@ -50,9 +50,13 @@
 #include <string.h>
 #include "harp-operation.h"
 #include "harp-program.h"
+#include "harp-thread.h"
 
 static harp_program *parsed_program;
 
+/* the generated parser and scanner use global state, so only one string can be parsed at a time */
+static harp_mutex parser_mutex = HARP_MUTEX_INITIALIZER;
+
 /* tokenizer declarations */
 int harp_operation_parser_lex(void);
 void *harp_operation_parser__scan_string(const char *yy_str);
@@ -190,6 +194,164 @@ int harp_sized_array_add_int32(harp_sized_array *sized_array, int32_t value)
     return 0;
 }
 
+/* create a bin_spatial operation for a grid with regularly spaced latitude and longitude edges */
+static int bin_spatial_regular_new(int32_t num_latitude_edges, double latitude_offset, double latitude_step,
+                                   int32_t num_longitude_edges, double longitude_offset, double longitude_step,
+                                   harp_sized_array *aggregation, const char *weights_filename,
+                                   harp_operation **new_operation)
+{
+    harp_sized_array *lat_array = NULL;
+    harp_sized_array *lon_array = NULL;
+    long i;
+
+    if (harp_sized_array_new(harp_type_double, &lat_array) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges; i++)
+    {
+        if (harp_sized_array_add_double(lat_array, latitude_offset + i * latitude_step) != 0)
+        {
+            harp_sized_array_delete(lat_array);
+            return -1;
+        }
+    }
+    if (harp_sized_array_new(harp_type_double, &lon_array) != 0)
+    {
+        harp_sized_array_delete(lat_array);
+        return -1;
+    }
+    for (i = 0; i < num_longitude_edges; i++)
+    {
+        if (harp_sized_array_add_double(lon_array, longitude_offset + i * longitude_step) != 0)
+        {
+            harp_sized_array_delete(lat_array);
+            harp_sized_array_delete(lon_array);
+            return -1;
+        }
+    }
+    if (harp_operation_bin_spatial_new(lat_array->num_elements, lat_array->array.double_data,
+                                       lon_array->num_elements, lon_array->array.double_data,
+                                       aggregation == NULL ? 0 : aggregation->num_elements,
+                                       aggregation == NULL ? NULL : (const char **)aggregation->array.string_data,
+                                       weights_filename, new_operation) != 0)
+    {
+        harp_sized_array_delete(lat_array);
+        harp_sized_array_delete(lon_array);
+        return -1;
+    }
+    harp_sized_array_delete(lat_array);
+    harp_sized_array_delete(lon_array);
+
+    return 0;
+}
+
+/* create a regrid_spatial operation for a grid with regularly spaced latitude and longitude edges */
+static int regrid_spatial_regular_new(int32_t num_latitude_edges, double latitude_offset, double latitude_step,
+                                      int32_t num_longitude_edges, double longitude_offset, double longitude_step,
+                                      harp_operation **new_operation)
+{
+    double *latitude_edges;
+    double *longitude_edges;
+    long i;
+
+    if (num_latitude_edges < 2 || num_longitude_edges < 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "regrid_spatial needs at least two latitude and two longitude "
+                       "edges");
+        return -1;
+    }
+    latitude_edges = malloc(num_latitude_edges * sizeof(double));
+    if (latitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_latitude_edges * sizeof(double), __FILE__, __LINE__);
+        return -1;
+    }
+    longitude_edges = malloc(num_longitude_edges * sizeof(double));
+    if (longitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_longitude_edges * sizeof(double), __FILE__, __LINE__);
+        free(latitude_edges);
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges; i++)
+    {
+        latitude_edges[i] = latitude_offset + i * latitude_step;
+    }
+    for (i = 0; i < num_longitude_edges; i++)
+    {
+        longitude_edges[i] = longitude_offset + i * longitude_step;
+    }
+    if (harp_operation_regrid_spatial_new(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges,
+                                          new_operation) != 0)
+    {
+        free(latitude_edges);
+        free(longitude_edges);
+        return -1;
+    }
+    free(latitude_edges);
+    free(longitude_edges);
+
+    return 0;
+}
+
+static int expression_unary_new(harp_expression_opcode opcode, harp_expression *operand,
+                                harp_expression **new_expression)
+{
+    return harp_expression_new_operation(opcode, 1, &operand, new_expression);
+}
+
+static int expression_binary_new(harp_expression_opcode opcode, harp_expression *left, harp_expression *right,
+                                 harp_expression **new_expression)
+{
+    harp_expression *argument[2];
+
+    argument[0] = left;
+    argument[1] = right;
+    return harp_expression_new_operation(opcode, 2, argument, new_expression);
+}
+
+static int expression_number_new(char *value, harp_expression **new_expression)
+{
+    long length = (long)strlen(value);
+    double double_value;
+
+    if (harp_parse_double(value, length, &double_value, 0) != length)
+    {
+        free(value);
+        return -1;
+    }
+    free(value);
+    return harp_expression_new_constant(double_value, new_expression);
+}
+
+/* a reference to a variable in an expression ('nan' and 'inf' are interpreted as constants) */
+static int expression_identifier_new(char *name, char *unit, harp_expression **new_expression)
+{
+    int result;
+
+    if (unit == NULL && strcmp(name, "nan") == 0)
+    {
+        result = harp_expression_new_constant(harp_nan(), new_expression);
+    }
+    else if (unit == NULL && strcmp(name, "inf") == 0)
+    {
+        result = harp_expression_new_constant(harp_plusinf(), new_expression);
+    }
+    else
+    {
+        result = harp_expression_new_variable(name, unit, new_expression);
+    }
+    free(name);
+    if (unit != NULL)
+    {
+        free(unit);
+    }
+    return result;
+}
+
 /* *INDENT-OFF* */
 
 %}
@@ -202,6 +364,7 @@ int harp_sized_array_add_int32(harp_sized_array *sized_array, int32_t value)
     harp_operation *operation;
     harp_sized_array *array;
     harp_program *program;
+    harp_expression *expression;
 
     harp_comparison_operator_type comparison_operator;
     harp_bit_mask_operator_type bit_mask_operator;
@@ -223,9 +386,12 @@ int harp_sized_array_add_int32(harp_sized_array *sized_array, int32_t value)
 %token                  FUNC_AREA_INTERSECTS_AREA
 %token                  FUNC_BIN
 %token                  FUNC_BIN_SPATIAL
+%token                  FUNC_BIT_ROUND
 %token                  FUNC_COLLOCATE_LEFT
 %token                  FUNC_COLLOCATE_RIGHT
+%token                  FUNC_COMPUTE
 %token                  FUNC_DERIVE
+%token                  FUNC_DERIVE_ALL
 %token                  FUNC_DERIVE_SMOOTHED_COLUMN
 %token                  FUNC_EXCLUDE
 %token                  FUNC_FLATTEN
@@ -234,21 +400,34 @@ int harp_sized_array_add_int32(harp_sized_array *sized_array, int32_t value)
 %token                  FUNC_POINT_DISTANCE
 %token                  FUNC_POINT_IN_AREA
 %token                  FUNC_REGRID
+%token                  FUNC_REGRID_SPATIAL
 %token                  FUNC_RENAME
+%token                  FUNC_SAMPLE_GRID
 %token                  FUNC_SET
 %token                  FUNC_SMOOTH
 %token                  FUNC_SORT
+%token                  FUNC_SORT_SPATIAL
+%token                  FUNC_SPARSIFY
 %token                  FUNC_VALID
 %token                  FUNC_WRAP
 %token                  NAN
 %token                  INF
 %token                  IN
-%left                   EQUAL NOT_EQUAL GREATER_EQUAL LESS_EQUAL
+%left                   LOGICAL_OR
+%left                   LOGICAL_AND
+%left                   '|'
+%left                   '&'
+%left                   EQUAL NOT_EQUAL
+%left                   GREATER_EQUAL LESS_EQUAL '<' '>'
 %left                   BIT_NAND BIT_AND
+%left                   '+' '-'
+%left                   '*' '/'
 %nonassoc               NOT
+%right                  UNARY
+%right                  '^'
 
 %type   <program>               program
-%type   <operation>             operation
+%type   <operation>             operation derivespec derivespec_list
 %type   <int32_val>             int32_value
 %type   <double_val>            double_value
 %type   <string_val>            identifier
@@ -257,10 +436,12 @@ int harp_sized_array_add_int32(harp_sized_array *sized_array, int32_t value)
 %type   <membership_operator>   membership_operator;
 %type   <comparison_operator>   comparison_operator;
 %type   <bit_mask_operator>     bit_mask_operator;
+%type   <expression>            expression;
 
 %destructor { harp_sized_array_delete($$); } double_array string_array identifier_array dimension_array dimensionspec
-%destructor { harp_operation_delete($$); } operation
+%destructor { harp_operation_delete($$); } operation derivespec derivespec_list
 %destructor { harp_program_delete($$); } program
+%destructor { harp_expression_delete($$); } expression
 %destructor { free($$); } STRING_VALUE INTEGER_VALUE DOUBLE_VALUE NAME UNIT identifier
 
 %error-verbose
@@ -287,9 +468,12 @@ reserved_identifier:
     | FUNC_AREA_INTERSECTS_AREA { $$ = "area_intersects_area"; }
     | FUNC_BIN { $$ = "bin"; }
     | FUNC_BIN_SPATIAL { $$ = "bin_spatial"; }
+    | FUNC_BIT_ROUND { $$ = "bit_round"; }
     | FUNC_COLLOCATE_LEFT { $$ = "collocate_left"; }
     | FUNC_COLLOCATE_RIGHT { $$ = "collocate_right"; }
+    | FUNC_COMPUTE { $$ = "compute"; }
     | FUNC_DERIVE { $$ = "derive"; }
+    | FUNC_DERIVE_ALL { $$ = "derive_all"; }
     | FUNC_DERIVE_SMOOTHED_COLUMN { $$ = "derive_smoothed_column"; }
     | FUNC_EXCLUDE { $$ = "exclude"; }
     | FUNC_FLATTEN { $$ = "flatten"; }
@@ -298,10 +482,14 @@ reserved_identifier:
     | FUNC_POINT_DISTANCE { $$ = "point_distance"; }
     | FUNC_POINT_IN_AREA { $$ = "point_in_area"; }
     | FUNC_REGRID { $$ = "regrid"; }
+    | FUNC_REGRID_SPATIAL { $$ = "regrid_spatial"; }
     | FUNC_RENAME { $$ = "rename"; }
+    | FUNC_SAMPLE_GRID { $$ = "sample_grid"; }
     | FUNC_SET { $$ = "set"; }
     | FUNC_SMOOTH { $$ = "smooth"; }
     | FUNC_SORT { $$ = "sort"; }
+    | FUNC_SORT_SPATIAL { $$ = "sort_spatial"; }
+    | FUNC_SPARSIFY { $$ = "sparsify"; }
     | FUNC_VALID { $$ = "valid"; }
     | FUNC_WRAP { $$ = "wrap"; }
     ;
@@ -443,6 +631,190 @@ dimensionspec:
     | '{' '}' { if (harp_sized_array_new(harp_type_int32, &$$) != 0) YYERROR; }
     ;
 
+derivespec:
+      identifier dimensionspec {
+            if (harp_operation_derive_variable_new($1, NULL, $2->num_elements, $2->array.int32_data, NULL,
+                                                   &$$) != 0)
+            {
+                free($1);
+                harp_sized_array_delete($2);
+                YYERROR;
+            }
+            free($1);
+            harp_sized_array_delete($2);
+        }
+    | identifier dimensionspec UNIT {
+            if (harp_operation_derive_variable_new($1, NULL, $2->num_elements, $2->array.int32_data, $3,
+                                                   &$$) != 0)
+            {
+                free($1);
+                harp_sized_array_delete($2);
+                free($3);
+                YYERROR;
+            }
+            free($1);
+            harp_sized_array_delete($2);
+            free($3);
+        }
+    | identifier DATATYPE dimensionspec {
+            harp_data_type data_type = $2;
+
+            if (harp_operation_derive_variable_new($1, &data_type, $3->num_elements, $3->array.int32_data, NULL, &$$) !=
+                0)
+            {
+                free($1);
+                harp_sized_array_delete($3);
+                YYERROR;
+            }
+            free($1);
+            harp_sized_array_delete($3);
+        }
+    | identifier DATATYPE dimensionspec UNIT {
+            harp_data_type data_type = $2;
+
+            if (harp_operation_derive_variable_new($1, &data_type, $3->num_elements, $3->array.int32_data, $4, &$$) !=
+                0)
+            {
+                free($1);
+                harp_sized_array_delete($3);
+                free($4);
+                YYERROR;
+            }
+            free($1);
+            harp_sized_array_delete($3);
+            free($4);
+        }
+    ;
+
+derivespec_list:
+      derivespec_list ',' derivespec {
+            if (harp_operation_derive_all_add_variable((harp_operation_derive_all *)$1, $3) != 0)
+            {
+                harp_operation_delete($1);
+                harp_operation_delete($3);
+                YYERROR;
+            }
+            $$ = $1;
+        }
+    | derivespec {
+            if (harp_operation_derive_all_new(&$$) != 0)
+            {
+                harp_operation_delete($1);
+                YYERROR;
+            }
+            if (harp_operation_derive_all_add_variable((harp_operation_derive_all *)$$, $1) != 0)
+            {
+                harp_operation_delete($1);
+                harp_operation_delete($$);
+                YYERROR;
+            }
+        }
+    ;
+
+expression:
+      INTEGER_VALUE {
+            if (expression_number_new($1, &$$) != 0) YYERROR;
+        }
+    | DOUBLE_VALUE {
+            if (expression_number_new($1, &$$) != 0) YYERROR;
+        }
+    | identifier {
+            if (expression_identifier_new($1, NULL, &$$) != 0) YYERROR;
+        }
+    | identifier UNIT {
+            if (expression_identifier_new($1, $2, &$$) != 0) YYERROR;
+        }
+    | NAME '(' expression ')' {
+            harp_expression *argument[1];
+
+            argument[0] = $3;
+            if (harp_expression_new_function($1, 1, argument, &$$) != 0)
+            {
+                free($1);
+                YYERROR;
+            }
+            free($1);
+        }
+    | NAME '(' expression ',' expression ')' {
+            harp_expression *argument[2];
+
+            argument[0] = $3;
+            argument[1] = $5;
+            if (harp_expression_new_function($1, 2, argument, &$$) != 0)
+            {
+                free($1);
+                YYERROR;
+            }
+            free($1);
+        }
+    | NAME '(' expression ',' expression ',' expression ')' {
+            harp_expression *argument[3];
+
+            argument[0] = $3;
+            argument[1] = $5;
+            argument[2] = $7;
+            if (harp_expression_new_function($1, 3, argument, &$$) != 0)
+            {
+                free($1);
+                YYERROR;
+            }
+            free($1);
+        }
+    | '(' expression ')' { $$ = $2; }
+    | '+' expression %prec UNARY { $$ = $2; }
+    | '-' expression %prec UNARY {
+            if (expression_unary_new(harp_expression_negate, $2, &$$) != 0) YYERROR;
+        }
+    | '!' expression %prec UNARY {
+            if (expression_unary_new(harp_expression_logical_not, $2, &$$) != 0) YYERROR;
+        }
+    | expression '+' expression {
+            if (expression_binary_new(harp_expression_add, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '-' expression {
+            if (expression_binary_new(harp_expression_subtract, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '*' expression {
+            if (expression_binary_new(harp_expression_multiply, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '/' expression {
+            if (expression_binary_new(harp_expression_divide, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '^' expression {
+            if (expression_binary_new(harp_expression_power, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression EQUAL expression {
+            if (expression_binary_new(harp_expression_equal, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression NOT_EQUAL expression {
+            if (expression_binary_new(harp_expression_not_equal, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '<' expression {
+            if (expression_binary_new(harp_expression_less, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression LESS_EQUAL expression {
+            if (expression_binary_new(harp_expression_less_equal, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '>' expression {
+            if (expression_binary_new(harp_expression_greater, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression GREATER_EQUAL expression {
+            if (expression_binary_new(harp_expression_greater_equal, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression LOGICAL_AND expression {
+            if (expression_binary_new(harp_expression_logical_and, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression LOGICAL_OR expression {
+            if (expression_binary_new(harp_expression_logical_or, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '&' expression {
+            if (expression_binary_new(harp_expression_bit_and, $1, $3, &$$) != 0) YYERROR;
+        }
+    | expression '|' expression {
+            if (expression_binary_new(harp_expression_bit_or, $1, $3, &$$) != 0) YYERROR;
+        }
+    ;
+
 comparison_operator:
       EQUAL { $$ = operator_eq; }
     | NOT_EQUAL { $$ = operator_ne; }
@@ -821,87 +1193,184 @@ operation:
             free($3);
         }
     | FUNC_BIN '(' ')' {
-            if (harp_operation_bin_full_new(&$$) != 0)
+            if (harp_operation_bin_full_new(0, NULL, &$$) != 0)
+            {
+                YYERROR;
+            }
+        }
+    | FUNC_BIN '(' '(' string_array ')' ')' {
+            if (harp_operation_bin_full_new($4->num_elements, (const char **)$4->array.string_data, &$$) != 0)
             {
+                harp_sized_array_delete($4);
                 YYERROR;
             }
+            harp_sized_array_delete($4);
         }
     | FUNC_BIN '(' identifier ')' {
-            if (harp_operation_bin_with_variable_new($3, &$$) != 0)
+            if (harp_operation_bin_with_variable_new($3, 0, NULL, &$$) != 0)
             {
                 free($3);
                 YYERROR;
             }
             free($3);
         }
+    | FUNC_BIN '(' identifier ',' '(' string_array ')' ')' {
+            if (harp_operation_bin_with_variable_new($3, $6->num_elements, (const char **)$6->array.string_data,
+                                                     &$$) != 0)
+            {
+                free($3);
+                harp_sized_array_delete($6);
+                YYERROR;
+            }
+            free($3);
+            harp_sized_array_delete($6);
+        }
     | FUNC_BIN '(' STRING_VALUE ',' ID_A ')' {
-            if (harp_operation_bin_collocated_new($3, 'a', &$$) != 0)
+            if (harp_operation_bin_collocated_new($3, 'a', 0, NULL, &$$) != 0)
             {
                 free($3);
                 YYERROR;
             }
             free($3);
         }
+    | FUNC_BIN '(' STRING_VALUE ',' ID_A ',' '(' string_array ')' ')' {
+            if (harp_operation_bin_collocated_new($3, 'a', $8->num_elements, (const char **)$8->array.string_data,
+                                                  &$$) != 0)
+            {
+                free($3);
+                harp_sized_array_delete($8);
+                YYERROR;
+            }
+            free($3);
+            harp_sized_array_delete($8);
+        }
     | FUNC_BIN '(' STRING_VALUE ',' ID_B ')' {
-            if (harp_operation_bin_collocated_new($3, 'b', &$$) != 0)
+            if (harp_operation_bin_collocated_new($3, 'b', 0, NULL, &$$) != 0)
             {
                 free($3);
                 YYERROR;
             }
             free($3);
         }
+    | FUNC_BIN '(' STRING_VALUE ',' ID_B ',' '(' string_array ')' ')' {
+            if (harp_operation_bin_collocated_new($3, 'b', $8->num_elements, (const char **)$8->array.string_data,
+                                                  &$$) != 0)
+            {
+                free($3);
+                harp_sized_array_delete($8);
+                YYERROR;
+            }
+            free($3);
+            harp_sized_array_delete($8);
+        }
     | FUNC_BIN_SPATIAL '(' '(' double_array ')' ',' '(' double_array ')' ')' {
             if (harp_operation_bin_spatial_new($4->num_elements, $4->array.double_data,
-                                               $8->num_elements, $8->array.double_data, &$$) != 0)
+                                               $8->num_elements, $8->array.double_data, 0, NULL, NULL, &$$) != 0)
+            {
+                harp_sized_array_delete($4);
+                harp_sized_array_delete($8);
+                YYERROR;
+            }
+            harp_sized_array_delete($4);
+            harp_sized_array_delete($8);
+        }
+    | FUNC_BIN_SPATIAL '(' '(' double_array ')' ',' '(' double_array ')' ',' STRING_VALUE ')' {
+            if (harp_operation_bin_spatial_new($4->num_elements, $4->array.double_data,
+                                               $8->num_elements, $8->array.double_data, 0, NULL, $11, &$$) != 0)
+            {
+                harp_sized_array_delete($4);
+                harp_sized_array_delete($8);
+                free($11);
+                YYERROR;
+            }
+            harp_sized_array_delete($4);
+            harp_sized_array_delete($8);
+            free($11);
+        }
+    | FUNC_BIN_SPATIAL '(' '(' double_array ')' ',' '(' double_array ')' ',' '(' string_array ')' ')' {
+            if (harp_operation_bin_spatial_new($4->num_elements, $4->array.double_data,
+                                               $8->num_elements, $8->array.double_data, $12->num_elements,
+                                               (const char **)$12->array.string_data, NULL, &$$) != 0)
             {
                 harp_sized_array_delete($4);
                 harp_sized_array_delete($8);
+                harp_sized_array_delete($12);
                 YYERROR;
             }
             harp_sized_array_delete($4);
             harp_sized_array_delete($8);
+            harp_sized_array_delete($12);
+        }
+    | FUNC_BIN_SPATIAL '(' '(' double_array ')' ',' '(' double_array ')' ',' '(' string_array ')' ','
+      STRING_VALUE ')' {
+            if (harp_operation_bin_spatial_new($4->num_elements, $4->array.double_data,
+                                               $8->num_elements, $8->array.double_data, $12->num_elements,
+                                               (const char **)$12->array.string_data, $15, &$$) != 0)
+            {
+                harp_sized_array_delete($4);
+                harp_sized_array_delete($8);
+                harp_sized_array_delete($12);
+                free($15);
+                YYERROR;
+            }
+            harp_sized_array_delete($4);
+            harp_sized_array_delete($8);
+            harp_sized_array_delete($12);
+            free($15);
         }
     | FUNC_BIN_SPATIAL '(' int32_value ',' double_value ',' double_value ',' int32_value ',' double_value ','
       double_value ')' {
-            harp_sized_array *lat_array;
-            harp_sized_array *lon_array;
-            long i;
-
-            if (harp_sized_array_new(harp_type_double, &lat_array) != 0)
+            if (bin_spatial_regular_new($3, $5, $7, $9, $11, $13, NULL, NULL, &$$) != 0)
             {
                 YYERROR;
             }
-            for (i = 0; i < $3; i++)
+        }
+    | FUNC_BIN_SPATIAL '(' int32_value ',' double_value ',' double_value ',' int32_value ',' double_value ','
+      double_value ',' STRING_VALUE ')' {
+            if (bin_spatial_regular_new($3, $5, $7, $9, $11, $13, NULL, $15, &$$) != 0)
             {
-                if (harp_sized_array_add_double(lat_array, $5 + i * $7) != 0)
-                {
-                    harp_sized_array_delete(lat_array);
-                    YYERROR;
-                }
+                free($15);
+                YYERROR;
             }
-            if (harp_sized_array_new(harp_type_double, &lon_array) != 0)
+            free($15);
+        }
+    | FUNC_BIN_SPATIAL '(' int32_value ',' double_value ',' double_value ',' int32_value ',' double_value ','
+      double_value ',' '(' string_array ')' ')' {
+            if (bin_spatial_regular_new($3, $5, $7, $9, $11, $13, $16, NULL, &$$) != 0)
             {
-                harp_sized_array_delete(lat_array);
+                harp_sized_array_delete($16);
                 YYERROR;
             }
-            for (i = 0; i < $9; i++)
+            harp_sized_array_delete($16);
+        }
+    | FUNC_BIN_SPATIAL '(' int32_value ',' double_value ',' double_value ',' int32_value ',' double_value ','
+      double_value ',' '(' string_array ')' ',' STRING_VALUE ')' {
+            if (bin_spatial_regular_new($3, $5, $7, $9, $11, $13, $16, $19, &$$) != 0)
             {
-                if (harp_sized_array_add_double(lon_array, $11 + i * $13) != 0)
-                {
-                    harp_sized_array_delete(lat_array);
-                    harp_sized_array_delete(lon_array);
-                    YYERROR;
-                }
+                harp_sized_array_delete($16);
+                free($19);
+                YYERROR;
             }
-            if (harp_operation_bin_spatial_new(lat_array->num_elements, lat_array->array.double_data,
-                                               lon_array->num_elements, lon_array->array.double_data, &$$) != 0)
+            harp_sized_array_delete($16);
+            free($19);
+        }
+    | FUNC_BIT_ROUND '(' identifier ',' int32_value ')' {
+            if (harp_operation_bit_round_new($3, $5, NULL, &$$) != 0)
             {
-                harp_sized_array_delete(lat_array);
-                harp_sized_array_delete(lon_array);
+                free($3);
                 YYERROR;
             }
-            harp_sized_array_delete(lat_array);
-            harp_sized_array_delete(lon_array);
+            free($3);
+        }
+    | FUNC_BIT_ROUND '(' identifier ',' identifier ')' {
+            if (harp_operation_bit_round_new($3, 0, $5, &$$) != 0)
+            {
+                free($3);
+                free($5);
+                YYERROR;
+            }
+            free($3);
+            free($5);
         }
     | FUNC_COLLOCATE_LEFT '(' STRING_VALUE ')' {
             if (harp_operation_collocation_filter_new($3, harp_collocation_left, &$$) != 0)
@@ -919,6 +1388,46 @@ operation:
             }
             free($3);
         }
+    | FUNC_COMPUTE '(' identifier '=' expression ')' {
+            if (harp_operation_compute_new($3, NULL, NULL, $5, &$$) != 0)
+            {
+                free($3);
+                YYERROR;
+            }
+            free($3);
+        }
+    | FUNC_COMPUTE '(' identifier UNIT '=' expression ')' {
+            if (harp_operation_compute_new($3, NULL, $4, $6, &$$) != 0)
+            {
+                free($3);
+                free($4);
+                YYERROR;
+            }
+            free($3);
+            free($4);
+        }
+    | FUNC_COMPUTE '(' identifier DATATYPE '=' expression ')' {
+            harp_data_type data_type = $4;
+
+            if (harp_operation_compute_new($3, &data_type, NULL, $6, &$$) != 0)
+            {
+                free($3);
+                YYERROR;
+            }
+            free($3);
+        }
+    | FUNC_COMPUTE '(' identifier DATATYPE UNIT '=' expression ')' {
+            harp_data_type data_type = $4;
+
+            if (harp_operation_compute_new($3, &data_type, $5, $7, &$$) != 0)
+            {
+                free($3);
+                free($5);
+                YYERROR;
+            }
+            free($3);
+            free($5);
+        }
     | FUNC_DERIVE '(' identifier ')' {
             /* even though it does nothing, we don't want this case to throw errors */
             /* it can also be used to perform an assert that a certain variable is available
@@ -1014,6 +1523,7 @@ operation:
             harp_sized_array_delete($5);
             free($6);
         }
+    | FUNC_DERIVE_ALL '(' derivespec_list ')' { $$ = $3; }
     | FUNC_DERIVE_SMOOTHED_COLUMN '(' identifier dimensionspec UNIT ',' identifier UNIT ',' STRING_VALUE ',' ID_A ','
       STRING_VALUE ')' {
             if (harp_operation_derive_smoothed_column_collocated_dataset_new($3, $4->num_elements, $4->array.int32_data,
@@ -1280,7 +1790,7 @@ operation:
             harp_sized_array_delete($9);
         }
     | FUNC_REGRID '(' DIMENSION ',' identifier UNIT ',' int32_value ',' double_value ',' double_value ')' {
-            harp_sized_array *array;
+            harp_sized_array *array = NULL;
             long i;
 
             if (harp_sized_array_new(harp_type_double, &array) != 0)
@@ -1350,6 +1860,24 @@ operation:
             free($6);
             free($8);
         }
+    | FUNC_REGRID_SPATIAL '(' '(' double_array ')' ',' '(' double_array ')' ')' {
+            if (harp_operation_regrid_spatial_new($4->num_elements, $4->array.double_data, $8->num_elements,
+                                                  $8->array.double_data, &$$) != 0)
+            {
+                harp_sized_array_delete($4);
+                harp_sized_array_delete($8);
+                YYERROR;
+            }
+            harp_sized_array_delete($4);
+            harp_sized_array_delete($8);
+        }
+    | FUNC_REGRID_SPATIAL '(' int32_value ',' double_value ',' double_value ',' int32_value ',' double_value ','
+      double_value ')' {
+            if (regrid_spatial_regular_new($3, $5, $7, $9, $11, $13, &$$) != 0)
+            {
+                YYERROR;
+            }
+        }
     | FUNC_RENAME '(' identifier ',' identifier ')' {
             if (harp_operation_rename_new($3, $5, &$$) != 0)
             {
@@ -1360,6 +1888,24 @@ operation:
             free($3);
             free($5);
         }
+    | FUNC_SAMPLE_GRID '(' STRING_VALUE ')' {
+            if (harp_operation_sample_grid_new($3, NULL, &$$) != 0)
+            {
+                free($3);
+                YYERROR;
+            }
+            free($3);
+        }
+    | FUNC_SAMPLE_GRID '(' STRING_VALUE ',' identifier ')' {
+            if (harp_operation_sample_grid_new($3, $5, &$$) != 0)
+            {
+                free($3);
+                free($5);
+                YYERROR;
+            }
+            free($3);
+            free($5);
+        }
     | FUNC_SET '(' STRING_VALUE ',' STRING_VALUE ')' {
             if (harp_operation_set_new($3, $5, &$$) != 0)
             {
@@ -1469,13 +2015,27 @@ operation:
             free($10);
             free($12);
         }
-    | FUNC_SORT '(' identifier ')' {
-            if (harp_operation_sort_new($3, &$$) != 0)
+    | FUNC_SORT '(' identifier_array ')' {
+            if (harp_operation_sort_new($3->num_elements, (const char **)$3->array.string_data, &$$) != 0)
             {
-                free($3);
+                harp_sized_array_delete($3);
                 YYERROR;
             }
-            free($3);
+            harp_sized_array_delete($3);
+        }
+    | FUNC_SORT_SPATIAL '(' ')' {
+            if (harp_operation_sort_spatial_new(0, NULL, &$$) != 0) YYERROR;
+        }
+    | FUNC_SORT_SPATIAL '(' double_value UNIT ')' {
+            if (harp_operation_sort_spatial_new($3, $4, &$$) != 0)
+            {
+                free($4);
+                YYERROR;
+            }
+            free($4);
+        }
+    | FUNC_SPARSIFY '(' ')' {
+            if (harp_operation_sparsify_new(&$$) != 0) YYERROR;
         }
     | FUNC_VALID '(' identifier ')' {
             if (harp_operation_valid_range_filter_new($3, &$$) != 0)
@@ -1537,13 +2097,27 @@ program:
 
 /* *INDENT-ON* */
 
-int harp_program_from_string(const char *str, harp_program **program)
+/** Compile a list of operations into a HARP program.
+ * \ingroup harp_product
+ * The resulting program can be used for any number of calls to harp_import_with_program(), which avoids having to
+ * parse the operations (and read any referenced area mask files) again for each import.
+ * A program keeps state while it is executed, so the same program should not be used by multiple threads at the same
+ * time.
+ * \param str Operations; should be specified as a semi-colon separated string of operations.
+ * \param program Pointer to the C variable where the new program will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_program_from_string(const char *str, harp_program **program)
 {
+    harp_program *new_program;
     void *bufstate;
 
     /* if this doesn't hold we need to introduce a separate harp_sized_array for enums */
     assert(sizeof(int32_t) == sizeof(harp_dimension_type));
 
+    harp_mutex_lock(&parser_mutex);
     harp_errno = 0;
     parsed_program = NULL;
     bufstate = (void *)harp_operation_parser__scan_string(str);
@@ -1554,10 +2128,23 @@ int harp_program_from_string(const char *str, harp_program **program)
             harp_set_error(HARP_ERROR_OPERATION_SYNTAX, NULL);
         }
         harp_operation_parser__delete_buffer(bufstate);
+        harp_mutex_unlock(&parser_mutex);
         return -1;
     }
     harp_operation_parser__delete_buffer(bufstate);
-    *program = parsed_program;
+    new_program = parsed_program;
+    harp_mutex_unlock(&parser_mutex);
+
+    /* keep the operations string such that the product cache can use it as part of its key */
+    new_program->operations = strdup(str);
+    if (new_program->operations == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_program_delete(new_program);
+        return -1;
+    }
+    *program = new_program;
 
     return 0;
 }
@@ -367,6 +367,15 @@ static int eval_membership(harp_operation_membership_filter *operation, harp_dat
 
 static int eval_point_distance(harp_operation_point_distance_filter *operation, harp_spherical_point *point)
 {
+    if (harp_get_option_wgs84_point_distance())
+    {
+        harp_vector3d vector;
+
+        harp_wgs84_ellipsoid_parametric_vector3d_from_spherical_point(&vector, point);
+        return harp_wgs84_ellipsoid_parametric_vector3d_distance(&operation->parametric_point, &vector) <=
+            operation->distance;
+    }
+
     return (harp_spherical_point_distance(&operation->point, point) * CONST_EARTH_RADIUS_WGS84_SPHERE <=
             operation->distance);
 }
@@ -597,15 +606,23 @@ static void bin_collocated_delete(harp_operation_bin_collocated *operation)
         {
             free(operation->collocation_result);
         }
+        if (operation->aggregation != NULL)
+        {
+            harp_bin_aggregation_list_delete(operation->aggregation);
+        }
 
         free(operation);
     }
 }
 
-static void bin_full_delete(harp_operation *operation)
+static void bin_full_delete(harp_operation_bin_full *operation)
 {
     if (operation != NULL)
     {
+        if (operation->aggregation != NULL)
+        {
+            harp_bin_aggregation_list_delete(operation->aggregation);
+        }
         free(operation);
     }
 }
@@ -622,6 +639,14 @@ static void bin_spatial_delete(harp_operation_bin_spatial *operation)
         {
             free(operation->longitude_edges);
         }
+        if (operation->aggregation != NULL)
+        {
+            harp_bin_aggregation_list_delete(operation->aggregation);
+        }
+        if (operation->weights_filename != NULL)
+        {
+            free(operation->weights_filename);
+        }
         free(operation);
     }
 }
@@ -634,6 +659,10 @@ static void bin_with_variable_delete(harp_operation_bin_with_variable *operation
         {
             free(operation->variable_name);
         }
+        if (operation->aggregation != NULL)
+        {
+            harp_bin_aggregation_list_delete(operation->aggregation);
+        }
 
         free(operation);
     }
@@ -652,6 +681,23 @@ static void bit_mask_filter_delete(harp_operation_bit_mask_filter *operation)
     }
 }
 
+static void bit_round_delete(harp_operation_bit_round *operation)
+{
+    if (operation != NULL)
+    {
+        if (operation->variable_name != NULL)
+        {
+            free(operation->variable_name);
+        }
+        if (operation->uncertainty_variable_name != NULL)
+        {
+            free(operation->uncertainty_variable_name);
+        }
+
+        free(operation);
+    }
+}
+
 static void collocation_filter_delete(harp_operation_collocation_filter *operation)
 {
     if (operation != NULL)
@@ -660,6 +706,10 @@ static void collocation_filter_delete(harp_operation_collocation_filter *operati
         {
             free(operation->filename);
         }
+        if (operation->collocation_mask_set != NULL)
+        {
+            harp_collocation_mask_set_delete(operation->collocation_mask_set);
+        }
         if (operation->collocation_mask != NULL)
         {
             harp_collocation_mask_delete(operation->collocation_mask);
@@ -689,6 +739,10 @@ static void comparison_filter_delete(harp_operation_comparison_filter *operation
         {
             harp_unit_converter_delete(operation->unit_converter);
         }
+        if (operation->value_unit != NULL)
+        {
+            free(operation->value_unit);
+        }
 
         free(operation);
     }
@@ -711,6 +765,42 @@ static void derive_variable_delete(harp_operation_derive_variable *operation)
     }
 }
 
+static void compute_delete(harp_operation_compute *operation)
+{
+    if (operation != NULL)
+    {
+        if (operation->variable_name != NULL)
+        {
+            free(operation->variable_name);
+        }
+        if (operation->unit != NULL)
+        {
+            free(operation->unit);
+        }
+        harp_expression_delete(operation->expression);
+        free(operation);
+    }
+}
+
+static void derive_all_delete(harp_operation_derive_all *operation)
+{
+    if (operation != NULL)
+    {
+        if (operation->variable != NULL)
+        {
+            int i;
+
+            for (i = 0; i < operation->num_variables; i++)
+            {
+                derive_variable_delete(operation->variable[i]);
+            }
+            free(operation->variable);
+        }
+
+        free(operation);
+    }
+}
+
 static void derive_smoothed_column_collocated_dataset_delete
     (harp_operation_derive_smoothed_column_collocated_dataset *operation)
 {
@@ -837,6 +927,10 @@ static void longitude_range_filter_delete(harp_operation_longitude_range_filter
         {
             harp_unit_converter_delete(operation->unit_converter);
         }
+        if (operation->value_unit != NULL)
+        {
+            free(operation->value_unit);
+        }
 
         free(operation);
     }
@@ -862,6 +956,10 @@ static void membership_filter_delete(harp_operation_membership_filter *operation
         {
             harp_unit_converter_delete(operation->unit_converter);
         }
+        if (operation->value_unit != NULL)
+        {
+            free(operation->value_unit);
+        }
 
         free(operation);
     }
@@ -955,6 +1053,22 @@ static void regrid_collocated_product_delete(harp_operation_regrid_collocated_pr
     }
 }
 
+static void regrid_spatial_delete(harp_operation_regrid_spatial *operation)
+{
+    if (operation != NULL)
+    {
+        if (operation->latitude_edges != NULL)
+        {
+            free(operation->latitude_edges);
+        }
+        if (operation->longitude_edges != NULL)
+        {
+            free(operation->longitude_edges);
+        }
+        free(operation);
+    }
+}
+
 static void rename_delete(harp_operation_rename *operation)
 {
     if (operation != NULL)
@@ -972,6 +1086,19 @@ static void rename_delete(harp_operation_rename *operation)
     }
 }
 
+static void sample_grid_delete(harp_operation_sample_grid *operation)
+{
+    if (operation != NULL)
+    {
+        if (operation->filename != NULL)
+        {
+            free(operation->filename);
+        }
+
+        free(operation);
+    }
+}
+
 static void set_delete(harp_operation_set *operation)
 {
     if (operation != NULL)
@@ -1067,6 +1194,16 @@ static void sort_delete(harp_operation_sort *operation)
     {
         if (operation->variable_name != NULL)
         {
+            int i;
+
+            for (i = 0; i < operation->num_variables; i++)
+            {
+                if (operation->variable_name[i] != NULL)
+                {
+                    free(operation->variable_name[i]);
+                }
+            }
+
             free(operation->variable_name);
         }
 
@@ -1074,6 +1211,22 @@ static void sort_delete(harp_operation_sort *operation)
     }
 }
 
+static void sort_spatial_delete(harp_operation_sort_spatial *operation)
+{
+    if (operation != NULL)
+    {
+        free(operation);
+    }
+}
+
+static void sparsify_delete(harp_operation *operation)
+{
+    if (operation != NULL)
+    {
+        free(operation);
+    }
+}
+
 static void string_comparison_filter_delete(harp_operation_string_comparison_filter *operation)
 {
     if (operation != NULL)
@@ -1169,7 +1322,7 @@ void harp_operation_delete(harp_operation *operation)
             bin_collocated_delete((harp_operation_bin_collocated *)operation);
             break;
         case operation_bin_full:
-            bin_full_delete(operation);
+            bin_full_delete((harp_operation_bin_full *)operation);
             break;
         case operation_bin_spatial:
             bin_spatial_delete((harp_operation_bin_spatial *)operation);
@@ -1180,12 +1333,21 @@ void harp_operation_delete(harp_operation *operation)
         case operation_bit_mask_filter:
             bit_mask_filter_delete((harp_operation_bit_mask_filter *)operation);
             break;
+        case operation_bit_round:
+            bit_round_delete((harp_operation_bit_round *)operation);
+            break;
         case operation_collocation_filter:
             collocation_filter_delete((harp_operation_collocation_filter *)operation);
             break;
         case operation_comparison_filter:
             comparison_filter_delete((harp_operation_comparison_filter *)operation);
             break;
+        case operation_compute:
+            compute_delete((harp_operation_compute *)operation);
+            break;
+        case operation_derive_all:
+            derive_all_delete((harp_operation_derive_all *)operation);
+            break;
         case operation_derive_variable:
             derive_variable_delete((harp_operation_derive_variable *)operation);
             break;
@@ -1227,9 +1389,15 @@ void harp_operation_delete(harp_operation *operation)
         case operation_regrid_collocated_product:
             regrid_collocated_product_delete((harp_operation_regrid_collocated_product *)operation);
             break;
+        case operation_regrid_spatial:
+            regrid_spatial_delete((harp_operation_regrid_spatial *)operation);
+            break;
         case operation_rename:
             rename_delete((harp_operation_rename *)operation);
             break;
+        case operation_sample_grid:
+            sample_grid_delete((harp_operation_sample_grid *)operation);
+            break;
         case operation_set:
             set_delete((harp_operation_set *)operation);
             break;
@@ -1242,6 +1410,12 @@ void harp_operation_delete(harp_operation *operation)
         case operation_sort:
             sort_delete((harp_operation_sort *)operation);
             break;
+        case operation_sort_spatial:
+            sort_spatial_delete((harp_operation_sort_spatial *)operation);
+            break;
+        case operation_sparsify:
+            sparsify_delete(operation);
+            break;
         case operation_string_comparison_filter:
             string_comparison_filter_delete((harp_operation_string_comparison_filter *)operation);
             break;
@@ -1525,8 +1699,40 @@ int harp_operation_area_intersects_area_filter_new(const char *filename, int num
     return 0;
 }
 
+/* create the aggregation list for a binning operation from its '<variable>:<statistic>[,...]' specifications
+ * (*new_list is set to NULL if there are no aggregations)
+ */
+static int get_bin_aggregation_list(long num_aggregations, const char **aggregation,
+                                    harp_bin_aggregation_list **new_list)
+{
+    harp_bin_aggregation_list *list;
+    long i;
+
+    *new_list = NULL;
+    if (num_aggregations == 0)
+    {
+        return 0;
+    }
+
+    if (harp_bin_aggregation_list_new(&list) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < num_aggregations; i++)
+    {
+        if (harp_bin_aggregation_list_add(list, aggregation[i]) != 0)
+        {
+            harp_bin_aggregation_list_delete(list);
+            return -1;
+        }
+    }
+
+    *new_list = list;
+    return 0;
+}
+
 int harp_operation_bin_collocated_new(const char *collocation_result, const char target_dataset,
-                                      harp_operation **new_operation)
+                                      long num_aggregations, const char **aggregation, harp_operation **new_operation)
 {
     harp_operation_bin_collocated *operation;
 
@@ -1542,6 +1748,7 @@ int harp_operation_bin_collocated_new(const char *collocation_result, const char
     operation->type = operation_bin_collocated;
     operation->collocation_result = NULL;
     operation->target_dataset = target_dataset;
+    operation->aggregation = NULL;
 
     operation->collocation_result = strdup(collocation_result);
     if (operation->collocation_result == NULL)
@@ -1551,30 +1758,43 @@ int harp_operation_bin_collocated_new(const char *collocation_result, const char
         bin_collocated_delete(operation);
         return -1;
     }
+    if (get_bin_aggregation_list(num_aggregations, aggregation, &operation->aggregation) != 0)
+    {
+        bin_collocated_delete(operation);
+        return -1;
+    }
 
     *new_operation = (harp_operation *)operation;
     return 0;
 }
 
-int harp_operation_bin_full_new(harp_operation **new_operation)
+int harp_operation_bin_full_new(long num_aggregations, const char **aggregation, harp_operation **new_operation)
 {
-    harp_operation *operation;
+    harp_operation_bin_full *operation;
 
-    operation = (harp_operation *)malloc(sizeof(harp_operation));
+    operation = (harp_operation_bin_full *)malloc(sizeof(harp_operation_bin_full));
     if (operation == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       sizeof(harp_operation), __FILE__, __LINE__);
+                       sizeof(harp_operation_bin_full), __FILE__, __LINE__);
         return -1;
     }
     operation->type = operation_bin_full;
+    operation->aggregation = NULL;
 
-    *new_operation = operation;
+    if (get_bin_aggregation_list(num_aggregations, aggregation, &operation->aggregation) != 0)
+    {
+        bin_full_delete(operation);
+        return -1;
+    }
+
+    *new_operation = (harp_operation *)operation;
     return 0;
 }
 
 int harp_operation_bin_spatial_new(long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
-                                   double *longitude_edges, harp_operation **new_operation)
+                                   double *longitude_edges, long num_aggregations, const char **aggregation,
+                                   const char *weights_filename, harp_operation **new_operation)
 {
     harp_operation_bin_spatial *operation;
     long i;
@@ -1591,6 +1811,8 @@ int harp_operation_bin_spatial_new(long num_latitude_edges, double *latitude_edg
     operation->latitude_edges = NULL;
     operation->num_longitude_edges = num_longitude_edges;
     operation->longitude_edges = NULL;
+    operation->aggregation = NULL;
+    operation->weights_filename = NULL;
 
     operation->latitude_edges = malloc(num_latitude_edges * sizeof(double));
     if (operation->latitude_edges == NULL)
@@ -1618,11 +1840,30 @@ int harp_operation_bin_spatial_new(long num_latitude_edges, double *latitude_edg
         operation->longitude_edges[i] = longitude_edges[i];
     }
 
+    if (get_bin_aggregation_list(num_aggregations, aggregation, &operation->aggregation) != 0)
+    {
+        bin_spatial_delete(operation);
+        return -1;
+    }
+
+    if (weights_filename != NULL)
+    {
+        operation->weights_filename = strdup(weights_filename);
+        if (operation->weights_filename == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            bin_spatial_delete(operation);
+            return -1;
+        }
+    }
+
     *new_operation = (harp_operation *)operation;
     return 0;
 }
 
-int harp_operation_bin_with_variable_new(const char *variable_name, harp_operation **new_operation)
+int harp_operation_bin_with_variable_new(const char *variable_name, long num_aggregations, const char **aggregation,
+                                         harp_operation **new_operation)
 {
     harp_operation_bin_with_variable *operation;
 
@@ -1637,6 +1878,7 @@ int harp_operation_bin_with_variable_new(const char *variable_name, harp_operati
     }
     operation->type = operation_bin_with_variable;
     operation->variable_name = NULL;
+    operation->aggregation = NULL;
 
     operation->variable_name = strdup(variable_name);
     if (operation->variable_name == NULL)
@@ -1646,6 +1888,11 @@ int harp_operation_bin_with_variable_new(const char *variable_name, harp_operati
         bin_with_variable_delete(operation);
         return -1;
     }
+    if (get_bin_aggregation_list(num_aggregations, aggregation, &operation->aggregation) != 0)
+    {
+        bin_with_variable_delete(operation);
+        return -1;
+    }
 
     *new_operation = (harp_operation *)operation;
     return 0;
@@ -1684,6 +1931,55 @@ int harp_operation_bit_mask_filter_new(const char *variable_name, harp_bit_mask_
     return 0;
 }
 
+int harp_operation_bit_round_new(const char *variable_name, int num_bits, const char *uncertainty_variable_name,
+                                 harp_operation **new_operation)
+{
+    harp_operation_bit_round *operation;
+
+    assert(variable_name != NULL);
+
+    if (uncertainty_variable_name == NULL && num_bits < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid number of bits (%d) for bit_round operation", num_bits);
+        return -1;
+    }
+
+    operation = (harp_operation_bit_round *)malloc(sizeof(harp_operation_bit_round));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation_bit_round), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_bit_round;
+    operation->variable_name = NULL;
+    operation->num_bits = num_bits;
+    operation->uncertainty_variable_name = NULL;
+
+    operation->variable_name = strdup(variable_name);
+    if (operation->variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        bit_round_delete(operation);
+        return -1;
+    }
+    if (uncertainty_variable_name != NULL)
+    {
+        operation->uncertainty_variable_name = strdup(uncertainty_variable_name);
+        if (operation->uncertainty_variable_name == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            bit_round_delete(operation);
+            return -1;
+        }
+    }
+
+    *new_operation = (harp_operation *)operation;
+    return 0;
+}
+
 int harp_operation_collocation_filter_new(const char *filename, harp_collocation_filter_type filter_type,
                                           harp_operation **new_operation)
 {
@@ -1700,6 +1996,7 @@ int harp_operation_collocation_filter_new(const char *filename, harp_collocation
     operation->eval = eval_collocation;
     operation->filename = NULL;
     operation->filter_type = filter_type;
+    operation->collocation_mask_set = NULL;
     operation->collocation_mask = NULL;
     operation->num_values = 0;
     operation->value = NULL;
@@ -1738,6 +2035,7 @@ int harp_operation_comparison_filter_new(const char *variable_name, harp_compari
     operation->value = value;
     operation->unit = NULL;
     operation->unit_converter = NULL;
+    operation->value_unit = NULL;
 
     operation->variable_name = strdup(variable_name);
     if (operation->variable_name == NULL)
@@ -1764,60 +2062,45 @@ int harp_operation_comparison_filter_new(const char *variable_name, harp_compari
     return 0;
 }
 
-int harp_operation_derive_variable_new(const char *variable_name, const harp_data_type *data_type, int num_dimensions,
-                                       const harp_dimension_type *dimension_type, const char *unit,
-                                       harp_operation **new_operation)
+/* the operation takes ownership of the expression (also when an error occurs) */
+int harp_operation_compute_new(const char *variable_name, const harp_data_type *data_type, const char *unit,
+                               harp_expression *expression, harp_operation **new_operation)
 {
-    harp_operation_derive_variable *operation;
-    int i;
+    harp_operation_compute *operation;
 
     assert(variable_name != NULL);
+    assert(expression != NULL);
 
-    operation = (harp_operation_derive_variable *)malloc(sizeof(harp_operation_derive_variable));
+    if (data_type != NULL && *data_type == harp_type_string)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "compute operation can not produce a variable of type string");
+        harp_expression_delete(expression);
+        return -1;
+    }
+
+    operation = (harp_operation_compute *)malloc(sizeof(harp_operation_compute));
     if (operation == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       sizeof(harp_operation_derive_variable), __FILE__, __LINE__);
+                       sizeof(harp_operation_compute), __FILE__, __LINE__);
+        harp_expression_delete(expression);
         return -1;
     }
-    operation->type = operation_derive_variable;
+    operation->type = operation_compute;
     operation->variable_name = NULL;
-    if (data_type != NULL)
-    {
-        operation->has_data_type = 1;
-        operation->data_type = *data_type;
-    }
-    else
-    {
-        operation->has_data_type = 0;
-        operation->data_type = harp_type_double;
-    }
-    if (num_dimensions < 0)
-    {
-        operation->has_dimensions = 0;
-        operation->num_dimensions = 0;
-    }
-    else
-    {
-        operation->has_dimensions = 1;
-        operation->num_dimensions = num_dimensions;
-    }
+    operation->has_data_type = (data_type != NULL);
+    operation->data_type = (data_type != NULL ? *data_type : harp_type_double);
     operation->unit = NULL;
+    operation->expression = expression;
 
     operation->variable_name = strdup(variable_name);
     if (operation->variable_name == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
                        __LINE__);
-        derive_variable_delete(operation);
+        compute_delete(operation);
         return -1;
     }
-
-    for (i = 0; i < num_dimensions; i++)
-    {
-        operation->dimension_type[i] = dimension_type[i];
-    }
-
     if (unit != NULL)
     {
         operation->unit = strdup(unit);
@@ -1825,7 +2108,7 @@ int harp_operation_derive_variable_new(const char *variable_name, const harp_dat
         {
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
                            __LINE__);
-            derive_variable_delete(operation);
+            compute_delete(operation);
             return -1;
         }
     }
@@ -1834,14 +2117,134 @@ int harp_operation_derive_variable_new(const char *variable_name, const harp_dat
     return 0;
 }
 
-int harp_operation_derive_smoothed_column_collocated_dataset_new(const char *variable_name, int num_dimensions,
-                                                                 const harp_dimension_type *dimension_type,
-                                                                 const char *unit, const char *axis_variable_name,
-                                                                 const char *axis_unit, const char *collocation_result,
-                                                                 const char target_dataset, const char *dataset_dir,
-                                                                 harp_operation **new_operation)
+int harp_operation_derive_all_new(harp_operation **new_operation)
 {
-    harp_operation_derive_smoothed_column_collocated_dataset *operation;
+    harp_operation_derive_all *operation;
+
+    operation = (harp_operation_derive_all *)malloc(sizeof(harp_operation_derive_all));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation_derive_all), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_derive_all;
+    operation->num_variables = 0;
+    operation->variable = NULL;
+
+    *new_operation = (harp_operation *)operation;
+    return 0;
+}
+
+/* Add a variable (specified as a derive operation) to the list of variables that should be derived.
+ * The derive_all operation takes ownership of derive_operation on success.
+ */
+int harp_operation_derive_all_add_variable(harp_operation_derive_all *operation, harp_operation *derive_operation)
+{
+    assert(derive_operation->type == operation_derive_variable);
+    assert(((harp_operation_derive_variable *)derive_operation)->has_dimensions);
+
+    if (operation->num_variables % BLOCK_SIZE == 0)
+    {
+        harp_operation_derive_variable **variable;
+
+        variable = (harp_operation_derive_variable **)realloc(operation->variable,
+                                                              (operation->num_variables + BLOCK_SIZE) *
+                                                              sizeof(harp_operation_derive_variable *));
+        if (variable == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (operation->num_variables + BLOCK_SIZE) * sizeof(harp_operation_derive_variable *),
+                           __FILE__, __LINE__);
+            return -1;
+        }
+        operation->variable = variable;
+    }
+
+    operation->variable[operation->num_variables] = (harp_operation_derive_variable *)derive_operation;
+    operation->num_variables++;
+
+    return 0;
+}
+
+int harp_operation_derive_variable_new(const char *variable_name, const harp_data_type *data_type, int num_dimensions,
+                                       const harp_dimension_type *dimension_type, const char *unit,
+                                       harp_operation **new_operation)
+{
+    harp_operation_derive_variable *operation;
+    int i;
+
+    assert(variable_name != NULL);
+
+    operation = (harp_operation_derive_variable *)malloc(sizeof(harp_operation_derive_variable));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation_derive_variable), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_derive_variable;
+    operation->variable_name = NULL;
+    if (data_type != NULL)
+    {
+        operation->has_data_type = 1;
+        operation->data_type = *data_type;
+    }
+    else
+    {
+        operation->has_data_type = 0;
+        operation->data_type = harp_type_double;
+    }
+    if (num_dimensions < 0)
+    {
+        operation->has_dimensions = 0;
+        operation->num_dimensions = 0;
+    }
+    else
+    {
+        operation->has_dimensions = 1;
+        operation->num_dimensions = num_dimensions;
+    }
+    operation->unit = NULL;
+
+    operation->variable_name = strdup(variable_name);
+    if (operation->variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        derive_variable_delete(operation);
+        return -1;
+    }
+
+    for (i = 0; i < num_dimensions; i++)
+    {
+        operation->dimension_type[i] = dimension_type[i];
+    }
+
+    if (unit != NULL)
+    {
+        operation->unit = strdup(unit);
+        if (operation->unit == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            derive_variable_delete(operation);
+            return -1;
+        }
+    }
+
+    *new_operation = (harp_operation *)operation;
+    return 0;
+}
+
+int harp_operation_derive_smoothed_column_collocated_dataset_new(const char *variable_name, int num_dimensions,
+                                                                 const harp_dimension_type *dimension_type,
+                                                                 const char *unit, const char *axis_variable_name,
+                                                                 const char *axis_unit, const char *collocation_result,
+                                                                 const char target_dataset, const char *dataset_dir,
+                                                                 harp_operation **new_operation)
+{
+    harp_operation_derive_smoothed_column_collocated_dataset *operation;
     int i;
 
     assert(variable_name != NULL);
@@ -2145,6 +2548,7 @@ int harp_operation_longitude_range_filter_new(double min, const char *min_unit,
     operation->min = min;
     operation->max = max;
     operation->unit_converter = NULL;
+    operation->value_unit = NULL;
 
     if (min_unit != NULL)
     {
@@ -2195,6 +2599,7 @@ int harp_operation_membership_filter_new(const char *variable_name, harp_members
     operation->value = NULL;
     operation->unit = NULL;
     operation->unit_converter = NULL;
+    operation->value_unit = NULL;
 
     operation->variable_name = strdup(variable_name);
     if (operation->variable_name == NULL)
@@ -2288,6 +2693,7 @@ int harp_operation_point_distance_filter_new(double latitude, const char *latitu
 
     harp_spherical_point_rad_from_deg(&operation->point);
     harp_spherical_point_check(&operation->point);
+    harp_wgs84_ellipsoid_parametric_vector3d_from_spherical_point(&operation->parametric_point, &operation->point);
 
     *new_operation = (harp_operation *)operation;
     return 0;
@@ -2581,6 +2987,55 @@ int harp_operation_regrid_collocated_product_new(harp_dimension_type dimension_t
     return 0;
 }
 
+int harp_operation_regrid_spatial_new(long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
+                                      double *longitude_edges, harp_operation **new_operation)
+{
+    harp_operation_regrid_spatial *operation;
+    long i;
+
+    operation = (harp_operation_regrid_spatial *)malloc(sizeof(harp_operation_regrid_spatial));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation_regrid_spatial), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_regrid_spatial;
+    operation->num_latitude_edges = num_latitude_edges;
+    operation->latitude_edges = NULL;
+    operation->num_longitude_edges = num_longitude_edges;
+    operation->longitude_edges = NULL;
+
+    operation->latitude_edges = malloc(num_latitude_edges * sizeof(double));
+    if (operation->latitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_latitude_edges * sizeof(double), __FILE__, __LINE__);
+        regrid_spatial_delete(operation);
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges; i++)
+    {
+        operation->latitude_edges[i] = latitude_edges[i];
+    }
+
+    operation->longitude_edges = malloc(num_longitude_edges * sizeof(double));
+    if (operation->longitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_longitude_edges * sizeof(double), __FILE__, __LINE__);
+        regrid_spatial_delete(operation);
+        return -1;
+    }
+    for (i = 0; i < num_longitude_edges; i++)
+    {
+        operation->longitude_edges[i] = longitude_edges[i];
+    }
+
+    *new_operation = (harp_operation *)operation;
+    return 0;
+}
+
 int harp_operation_rename_new(const char *variable_name, const char *new_variable_name, harp_operation **new_operation)
 {
     harp_operation_rename *operation;
@@ -2620,6 +3075,51 @@ int harp_operation_rename_new(const char *variable_name, const char *new_variabl
     return 0;
 }
 
+int harp_operation_sample_grid_new(const char *filename, const char *method, harp_operation **new_operation)
+{
+    harp_operation_sample_grid *operation;
+    int nearest = 0;
+
+    assert(filename != NULL);
+
+    if (method != NULL)
+    {
+        if (strcmp(method, "nearest") == 0)
+        {
+            nearest = 1;
+        }
+        else if (strcmp(method, "bilinear") != 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid interpolation method '%s' (expected 'bilinear' or "
+                           "'nearest')", method);
+            return -1;
+        }
+    }
+
+    operation = (harp_operation_sample_grid *)malloc(sizeof(harp_operation_sample_grid));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation_sample_grid), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_sample_grid;
+    operation->filename = NULL;
+    operation->nearest = nearest;
+
+    operation->filename = strdup(filename);
+    if (operation->filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        sample_grid_delete(operation);
+        return -1;
+    }
+
+    *new_operation = (harp_operation *)operation;
+    return 0;
+}
+
 int harp_operation_set_new(const char *option, const char *value, harp_operation **new_operation)
 {
     harp_operation_set *operation;
@@ -2843,10 +3343,12 @@ int harp_operation_smooth_collocated_product_new(int num_variables, const char *
     return 0;
 }
 
-int harp_operation_sort_new(const char *variable_name, harp_operation **new_operation)
+int harp_operation_sort_new(int num_variables, const char **variable_name, harp_operation **new_operation)
 {
     harp_operation_sort *operation;
+    int i;
 
+    assert(num_variables > 0);
     assert(variable_name != NULL);
 
     operation = (harp_operation_sort *)malloc(sizeof(harp_operation_sort));
@@ -2857,21 +3359,82 @@ int harp_operation_sort_new(const char *variable_name, harp_operation **new_oper
         return -1;
     }
     operation->type = operation_sort;
+    operation->num_variables = 0;
     operation->variable_name = NULL;
 
-    operation->variable_name = strdup(variable_name);
+    operation->variable_name = (char **)malloc(num_variables * sizeof(char *));
     if (operation->variable_name == NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                       __LINE__);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_variables * sizeof(char *), __FILE__, __LINE__);
         sort_delete(operation);
         return -1;
     }
+    for (i = 0; i < num_variables; i++)
+    {
+        operation->variable_name[i] = strdup(variable_name[i]);
+        if (operation->variable_name[i] == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            sort_delete(operation);
+            return -1;
+        }
+        operation->num_variables++;
+    }
+
+    *new_operation = (harp_operation *)operation;
+    return 0;
+}
+
+int harp_operation_sort_spatial_new(double time_step, const char *unit, harp_operation **new_operation)
+{
+    harp_operation_sort_spatial *operation;
+
+    if (unit != NULL)
+    {
+        if (harp_convert_unit(unit, "s", 1, &time_step) != 0)
+        {
+            return -1;
+        }
+        if (!(time_step > 0))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "time step for spatial sort should be positive");
+            return -1;
+        }
+    }
+
+    operation = (harp_operation_sort_spatial *)malloc(sizeof(harp_operation_sort_spatial));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation_sort_spatial), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_sort_spatial;
+    operation->time_step = unit != NULL ? time_step : 0;
 
     *new_operation = (harp_operation *)operation;
     return 0;
 }
 
+int harp_operation_sparsify_new(harp_operation **new_operation)
+{
+    harp_operation *operation;
+
+    operation = (harp_operation *)malloc(sizeof(harp_operation));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_sparsify;
+
+    *new_operation = operation;
+    return 0;
+}
+
 int harp_operation_string_comparison_filter_new(const char *variable_name, harp_comparison_operator_type operator_type,
                                                 const char *value, harp_operation **new_operation)
 {
@@ -3145,36 +3708,525 @@ int harp_operation_is_value_filter(const harp_operation *operation)
     }
 }
 
-int harp_operation_prepare_collocation_filter(harp_operation *operation, const char *source_product)
-{
-    harp_operation_collocation_filter *collocation_operation = (harp_operation_collocation_filter *)operation;
-    harp_collocation_mask *collocation_mask;
-    int i;
-
-    /* make sure we start with a clean state */
-    if (collocation_operation->collocation_mask != NULL)
-    {
-        harp_collocation_mask_delete(collocation_operation->collocation_mask);
-    }
-    if (collocation_operation->value != NULL)
-    {
-        free(collocation_operation->value);
-    }
-    collocation_operation->collocation_mask = NULL;
-    collocation_operation->num_values = 0;
-    collocation_operation->value = NULL;
+/* number of values that are converted to double at once when filtering an array of values */
+#define FILTER_BLOCK_SIZE 1024
 
-    if (harp_collocation_mask_import(collocation_operation->filename, collocation_operation->filter_type,
-                                     source_product, &collocation_mask) != 0)
-    {
-        return -1;
-    }
-    collocation_operation->collocation_mask = collocation_mask;
+/* Get num_values values starting at offset from data as doubles.
+ * For double data without unit conversion the data itself is returned, otherwise the values are stored in buffer.
+ */
+static const double *get_double_values(harp_data_type data_type, const void *data, long offset, long num_values,
+                                       const harp_unit_converter *unit_converter, double *buffer)
+{
+    long i;
 
-    collocation_operation->value = (int32_t *)malloc(collocation_mask->num_index_pairs * sizeof(int32_t));
-    if (collocation_operation->value == NULL)
+    switch (data_type)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+        case harp_type_int8:
+            for (i = 0; i < num_values; i++)
+            {
+                buffer[i] = (double)((const int8_t *)data)[offset + i];
+            }
+            break;
+        case harp_type_int16:
+            for (i = 0; i < num_values; i++)
+            {
+                buffer[i] = (double)((const int16_t *)data)[offset + i];
+            }
+            break;
+        case harp_type_int32:
+            for (i = 0; i < num_values; i++)
+            {
+                buffer[i] = (double)((const int32_t *)data)[offset + i];
+            }
+            break;
+        case harp_type_float:
+            for (i = 0; i < num_values; i++)
+            {
+                buffer[i] = (double)((const float *)data)[offset + i];
+            }
+            break;
+        case harp_type_double:
+            if (unit_converter == NULL)
+            {
+                return &((const double *)data)[offset];
+            }
+            memcpy(buffer, &((const double *)data)[offset], num_values * sizeof(double));
+            break;
+        case harp_type_string:
+            assert(0);
+            exit(1);
+    }
+
+    if (unit_converter != NULL)
+    {
+        harp_unit_converter_convert_array(unit_converter, num_values, buffer);
+    }
+
+    return buffer;
+}
+
+static int filter_bit_mask(harp_operation_bit_mask_filter *operation, harp_data_type data_type, long num_elements,
+                           const void *data, uint8_t *mask)
+{
+    uint32_t bit_mask = operation->bit_mask;
+    int any = operation->operator_type == operator_bit_mask_any;
+    long i;
+
+    switch (data_type)
+    {
+        case harp_type_int8:
+            for (i = 0; i < num_elements; i++)
+            {
+                mask[i] &= ((((const uint8_t *)data)[i] & bit_mask) != 0) == any;
+            }
+            break;
+        case harp_type_int16:
+            for (i = 0; i < num_elements; i++)
+            {
+                mask[i] &= ((((const uint16_t *)data)[i] & bit_mask) != 0) == any;
+            }
+            break;
+        case harp_type_int32:
+            for (i = 0; i < num_elements; i++)
+            {
+                mask[i] &= ((((const uint32_t *)data)[i] & bit_mask) != 0) == any;
+            }
+            break;
+        default:
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot perform bitmask filter for data type: %s",
+                           harp_get_data_type_name(data_type));
+            return -1;
+    }
+
+    return 0;
+}
+
+static int filter_comparison(harp_operation_comparison_filter *operation, harp_data_type data_type, long num_elements,
+                             const void *data, uint8_t *mask)
+{
+    double buffer[FILTER_BLOCK_SIZE];
+    double reference = operation->value;
+    long offset;
+
+    if (data_type == harp_type_string)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot perform numerical comparison filter for data type: %s",
+                       harp_get_data_type_name(data_type));
+        return -1;
+    }
+
+    for (offset = 0; offset < num_elements; offset += FILTER_BLOCK_SIZE)
+    {
+        long num_values = num_elements - offset < FILTER_BLOCK_SIZE ? num_elements - offset : FILTER_BLOCK_SIZE;
+        const double *value;
+        uint8_t *block_mask = &mask[offset];
+        long i;
+
+        value = get_double_values(data_type, data, offset, num_values, operation->unit_converter, buffer);
+        switch (operation->operator_type)
+        {
+            case operator_eq:
+                for (i = 0; i < num_values; i++)
+                {
+                    block_mask[i] &= value[i] == reference;
+                }
+                break;
+            case operator_ne:
+                for (i = 0; i < num_values; i++)
+                {
+                    block_mask[i] &= value[i] != reference;
+                }
+                break;
+            case operator_lt:
+                for (i = 0; i < num_values; i++)
+                {
+                    block_mask[i] &= value[i] < reference;
+                }
+                break;
+            case operator_le:
+                for (i = 0; i < num_values; i++)
+                {
+                    block_mask[i] &= value[i] <= reference;
+                }
+                break;
+            case operator_gt:
+                for (i = 0; i < num_values; i++)
+                {
+                    block_mask[i] &= value[i] > reference;
+                }
+                break;
+            case operator_ge:
+                for (i = 0; i < num_values; i++)
+                {
+                    block_mask[i] &= value[i] >= reference;
+                }
+                break;
+        }
+    }
+
+    return 0;
+}
+
+static int filter_longitude_range(harp_operation_longitude_range_filter *operation, harp_data_type data_type,
+                                  long num_elements, const void *data, uint8_t *mask)
+{
+    double buffer[FILTER_BLOCK_SIZE];
+    double min = operation->min;
+    double max = operation->max;
+    long offset;
+
+    if (data_type == harp_type_string)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot perform longitude range filter for data type: %s",
+                       harp_get_data_type_name(data_type));
+        return -1;
+    }
+
+    for (offset = 0; offset < num_elements; offset += FILTER_BLOCK_SIZE)
+    {
+        long num_values = num_elements - offset < FILTER_BLOCK_SIZE ? num_elements - offset : FILTER_BLOCK_SIZE;
+        const double *value;
+        long i;
+
+        value = get_double_values(data_type, data, offset, num_values, operation->unit_converter, buffer);
+        for (i = 0; i < num_values; i++)
+        {
+            /* map longitude to [min,min+360) */
+            mask[offset + i] &= value[i] - 360.0 * floor((value[i] - min) / 360.0) <= max;
+        }
+    }
+
+    return 0;
+}
+
+static int filter_membership(harp_operation_membership_filter *operation, harp_data_type data_type, long num_elements,
+                             const void *data, uint8_t *mask)
+{
+    double buffer[FILTER_BLOCK_SIZE];
+    uint8_t is_member[FILTER_BLOCK_SIZE];
+    uint8_t member_result = operation->operator_type == operator_in ? 1 : 0;
+    long offset;
+
+    if (data_type == harp_type_string)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot perform numerical membership filter for data type: %s",
+                       harp_get_data_type_name(data_type));
+        return -1;
+    }
+
+    for (offset = 0; offset < num_elements; offset += FILTER_BLOCK_SIZE)
+    {
+        long num_values = num_elements - offset < FILTER_BLOCK_SIZE ? num_elements - offset : FILTER_BLOCK_SIZE;
+        const double *value;
+        long i;
+        int j;
+
+        value = get_double_values(data_type, data, offset, num_values, operation->unit_converter, buffer);
+        memset(is_member, 0, num_values);
+        for (j = 0; j < operation->num_values; j++)
+        {
+            double reference = operation->value[j];
+
+            for (i = 0; i < num_values; i++)
+            {
+                is_member[i] |= value[i] == reference;
+            }
+        }
+        for (i = 0; i < num_values; i++)
+        {
+            mask[offset + i] &= is_member[i] == member_result;
+        }
+    }
+
+    return 0;
+}
+
+static int filter_valid_range(harp_operation_valid_range_filter *operation, harp_data_type data_type,
+                              long num_elements, const void *data, uint8_t *mask)
+{
+    double buffer[FILTER_BLOCK_SIZE];
+    double valid_min = operation->valid_min;
+    double valid_max = operation->valid_max;
+    long offset;
+
+    if (data_type == harp_type_string)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot perform valid range filter for data type: %s",
+                       harp_get_data_type_name(data_type));
+        return -1;
+    }
+
+    for (offset = 0; offset < num_elements; offset += FILTER_BLOCK_SIZE)
+    {
+        long num_values = num_elements - offset < FILTER_BLOCK_SIZE ? num_elements - offset : FILTER_BLOCK_SIZE;
+        const double *value;
+        long i;
+
+        value = get_double_values(data_type, data, offset, num_values, NULL, buffer);
+        for (i = 0; i < num_values; i++)
+        {
+            /* comparisons with NaN are always false, so NaN values are masked out */
+            mask[offset + i] &= value[i] >= valid_min && value[i] <= valid_max;
+        }
+    }
+
+    return 0;
+}
+
+/* Apply a numeric value filter to an array of values.
+ * For each element that does not pass the filter the corresponding mask value is set to 0 (mask values that are
+ * already 0 remain 0). Unlike calling the eval function of the operation for each element, this processes whole
+ * blocks of values at once (with the operator and data type resolved outside the inner loops).
+ */
+int harp_operation_filter_numeric_values(harp_operation *operation, harp_data_type data_type, long num_elements,
+                                         const void *data, uint8_t *mask)
+{
+    long i;
+
+    if (num_elements == 0)
+    {
+        return 0;
+    }
+
+    switch (operation->type)
+    {
+        case operation_bit_mask_filter:
+            return filter_bit_mask((harp_operation_bit_mask_filter *)operation, data_type, num_elements, data, mask);
+        case operation_comparison_filter:
+            return filter_comparison((harp_operation_comparison_filter *)operation, data_type, num_elements, data,
+                                     mask);
+        case operation_longitude_range_filter:
+            return filter_longitude_range((harp_operation_longitude_range_filter *)operation, data_type,
+                                          num_elements, data, mask);
+        case operation_membership_filter:
+            return filter_membership((harp_operation_membership_filter *)operation, data_type, num_elements, data,
+                                     mask);
+        case operation_valid_range_filter:
+            return filter_valid_range((harp_operation_valid_range_filter *)operation, data_type, num_elements, data,
+                                      mask);
+        default:
+            break;
+    }
+
+    /* fall back to evaluating each element separately */
+    for (i = 0; i < num_elements; i++)
+    {
+        if (mask[i])
+        {
+            harp_operation_numeric_value_filter *numeric_operation = (harp_operation_numeric_value_filter *)operation;
+            int result;
+
+            result = numeric_operation->eval(numeric_operation, data_type,
+                                             (void *)&((const int8_t *)data)[i * harp_get_size_for_type(data_type)]);
+            if (result < 0)
+            {
+                return -1;
+            }
+            mask[i] = result;
+        }
+    }
+
+    return 0;
+}
+
+/* margins for the fast accept/reject tests of the point distance filter; points that fall within the margins are
+ * evaluated using the exact distance function so the outcome is identical to that of the eval function */
+#define POINT_DISTANCE_LATITUDE_MARGIN 1.0E-6
+#define POINT_DISTANCE_COSINE_MARGIN 1.0E-12
+
+static int filter_point_distance(harp_operation_point_distance_filter *operation, long num_points,
+                                 const harp_spherical_point *point, uint8_t *mask)
+{
+    double angle = operation->distance / CONST_EARTH_RADIUS_WGS84_SPHERE;
+    double latitude_band = angle + POINT_DISTANCE_LATITUDE_MARGIN;
+    double reference_latitude = operation->point.lat;
+    double max_reject_cos;
+    double min_accept_cos;
+    harp_vector3d reference;
+    long i;
+
+    if (harp_get_option_wgs84_point_distance())
+    {
+        /* the distance on the ellipsoid is at least b(1-f) times the difference in (geodetic) latitude; we use
+         * (1-2f) to stay well clear of the approximation error of the distance function */
+        latitude_band = operation->distance / (CONST_SEMI_MINOR_AXIS_WGS84_ELLIPSOID *
+                                               (1 - 2 * CONST_FLATTENING_WGS84_ELLIPSOID)) +
+            POINT_DISTANCE_LATITUDE_MARGIN;
+        for (i = 0; i < num_points; i++)
+        {
+            if (mask[i] && fabs(point[i].lat - reference_latitude) <= latitude_band)
+            {
+                mask[i] = eval_point_distance(operation, (harp_spherical_point *)&point[i]);
+            }
+            else
+            {
+                mask[i] = 0;
+            }
+        }
+        return 0;
+    }
+
+    if (!(angle >= 0 && angle < M_PI))
+    {
+        for (i = 0; i < num_points; i++)
+        {
+            if (mask[i])
+            {
+                mask[i] = eval_point_distance(operation, (harp_spherical_point *)&point[i]);
+            }
+        }
+        return 0;
+    }
+
+    /* the distance to a point is at least the difference in latitude */
+    for (i = 0; i < num_points; i++)
+    {
+        mask[i] &= fabs(point[i].lat - reference_latitude) <= latitude_band;
+    }
+
+    /* compare the cosine of the distance (the dot product of the unit vectors) against the cosine of the maximum
+     * distance */
+    harp_vector3d_from_spherical_point(&reference, &operation->point);
+    max_reject_cos = cos(angle) - POINT_DISTANCE_COSINE_MARGIN;
+    min_accept_cos = cos(angle) + POINT_DISTANCE_COSINE_MARGIN;
+    for (i = 0; i < num_points; i++)
+    {
+        if (mask[i])
+        {
+            double cos_latitude = cos(point[i].lat);
+            double cos_distance = reference.x * cos_latitude * cos(point[i].lon) +
+                reference.y * cos_latitude * sin(point[i].lon) + reference.z * sin(point[i].lat);
+
+            if (cos_distance < max_reject_cos)
+            {
+                mask[i] = 0;
+            }
+            else if (cos_distance <= min_accept_cos)
+            {
+                mask[i] = eval_point_distance(operation, (harp_spherical_point *)&point[i]);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int filter_point_in_area(harp_operation_point_in_area_filter *operation, long num_points,
+                                const harp_spherical_point *point, uint8_t *mask)
+{
+    const harp_area_mask *area_mask = operation->area_mask;
+    double min_latitude = M_PI_2;
+    double max_latitude = -M_PI_2;
+    long i;
+
+    /* determine the latitude range covered by the bounding caps of the polygons of the mask */
+    for (i = 0; i < area_mask->num_polygons; i++)
+    {
+        if (area_mask->cap[i].latitude - area_mask->cap[i].radius < min_latitude)
+        {
+            min_latitude = area_mask->cap[i].latitude - area_mask->cap[i].radius;
+        }
+        if (area_mask->cap[i].latitude + area_mask->cap[i].radius > max_latitude)
+        {
+            max_latitude = area_mask->cap[i].latitude + area_mask->cap[i].radius;
+        }
+    }
+
+    for (i = 0; i < num_points; i++)
+    {
+        mask[i] &= point[i].lat >= min_latitude && point[i].lat <= max_latitude;
+    }
+
+    for (i = 0; i < num_points; i++)
+    {
+        if (mask[i])
+        {
+            mask[i] = harp_area_mask_covers_point(area_mask, &point[i]);
+        }
+    }
+
+    return 0;
+}
+
+/* Apply a point filter to an array of points (in radians, normalized with harp_spherical_point_check()).
+ * For each point that does not pass the filter the corresponding mask value is set to 0 (mask values that are
+ * already 0 remain 0). Unlike calling the eval function of the operation for each point, this allows each filter
+ * to precompute its reference data once and to reject most points using cheap tests.
+ */
+int harp_operation_filter_points(harp_operation *operation, long num_points, const harp_spherical_point *point,
+                                 uint8_t *mask)
+{
+    long i;
+
+    switch (operation->type)
+    {
+        case operation_point_distance_filter:
+            return filter_point_distance((harp_operation_point_distance_filter *)operation, num_points, point, mask);
+        case operation_point_in_area_filter:
+            return filter_point_in_area((harp_operation_point_in_area_filter *)operation, num_points, point, mask);
+        default:
+            break;
+    }
+
+    /* fall back to evaluating each point separately */
+    for (i = 0; i < num_points; i++)
+    {
+        if (mask[i])
+        {
+            harp_operation_point_filter *point_operation = (harp_operation_point_filter *)operation;
+            int result;
+
+            result = point_operation->eval(point_operation, (harp_spherical_point *)&point[i]);
+            if (result < 0)
+            {
+                return -1;
+            }
+            mask[i] = result;
+        }
+    }
+
+    return 0;
+}
+
+int harp_operation_prepare_collocation_filter(harp_operation *operation, const char *source_product)
+{
+    harp_operation_collocation_filter *collocation_operation = (harp_operation_collocation_filter *)operation;
+    harp_collocation_mask *collocation_mask;
+    int i;
+
+    /* make sure we start with a clean state */
+    if (collocation_operation->collocation_mask != NULL)
+    {
+        harp_collocation_mask_delete(collocation_operation->collocation_mask);
+    }
+    if (collocation_operation->value != NULL)
+    {
+        free(collocation_operation->value);
+    }
+    collocation_operation->collocation_mask = NULL;
+    collocation_operation->num_values = 0;
+    collocation_operation->value = NULL;
+
+    /* the collocation result file is only read once; the masks for all products are kept with the operation */
+    if (collocation_operation->collocation_mask_set == NULL)
+    {
+        if (harp_collocation_mask_set_import(collocation_operation->filename, collocation_operation->filter_type,
+                                             &collocation_operation->collocation_mask_set) != 0)
+        {
+            return -1;
+        }
+    }
+    if (harp_collocation_mask_set_get_mask(collocation_operation->collocation_mask_set, source_product,
+                                           &collocation_mask) != 0)
+    {
+        return -1;
+    }
+    collocation_operation->collocation_mask = collocation_mask;
+
+    collocation_operation->value = (int32_t *)malloc(collocation_mask->num_index_pairs * sizeof(int32_t));
+    if (collocation_operation->value == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        collocation_mask->num_index_pairs * sizeof(int32_t), __FILE__, __LINE__);
         return -1;
     }
@@ -3247,32 +4299,48 @@ int harp_operation_set_value_unit(harp_operation *operation, const char *unit)
 {
     const char *target_unit;
     harp_unit_converter **unit_converter;
+    char **value_unit;
 
     switch (operation->type)
     {
         case operation_comparison_filter:
             target_unit = ((harp_operation_comparison_filter *)operation)->unit;
             unit_converter = &((harp_operation_comparison_filter *)operation)->unit_converter;
+            value_unit = &((harp_operation_comparison_filter *)operation)->value_unit;
             break;
         case operation_longitude_range_filter:
             target_unit = "degree_east";
             unit_converter = &((harp_operation_longitude_range_filter *)operation)->unit_converter;
+            value_unit = &((harp_operation_longitude_range_filter *)operation)->value_unit;
             break;
         case operation_membership_filter:
             target_unit = ((harp_operation_membership_filter *)operation)->unit;
             unit_converter = &((harp_operation_membership_filter *)operation)->unit_converter;
+            value_unit = &((harp_operation_membership_filter *)operation)->value_unit;
             break;
         default:
             /* no need to perform unit conversion */
             return 0;
     }
 
+    /* if the operation is executed again (e.g. as part of a reused program) for values with the same unit then we can
+     * keep using the current unit converter */
+    if (*value_unit != NULL && unit != NULL && strcmp(*value_unit, unit) == 0)
+    {
+        return 0;
+    }
+
     /* remove previous unit converter if there was one */
     if (*unit_converter != NULL)
     {
         harp_unit_converter_delete(*unit_converter);
         *unit_converter = NULL;
     }
+    if (*value_unit != NULL)
+    {
+        free(*value_unit);
+        *value_unit = NULL;
+    }
 
     /* if the operation did not have a unit then we don't have to perform a unit conversion */
     if (target_unit == NULL)
@@ -3280,11 +4348,24 @@ int harp_operation_set_value_unit(harp_operation *operation, const char *unit)
         return 0;
     }
 
-    if (harp_unit_compare(unit, target_unit) == 0)
+    if (harp_unit_compare(unit, target_unit) != 0)
     {
-        /* no need to perform unit conversion */
-        return 0;
+        if (harp_unit_converter_new(unit, target_unit, unit_converter) != 0)
+        {
+            return -1;
+        }
     }
 
-    return harp_unit_converter_new(unit, target_unit, unit_converter);
+    if (unit != NULL)
+    {
+        *value_unit = strdup(unit);
+        if (*value_unit == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            return -1;
+        }
+    }
+
+    return 0;
 }
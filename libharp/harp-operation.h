@@ -48,8 +48,11 @@ typedef enum harp_operation_type_enum
     operation_bin_spatial,
     operation_bin_with_variable,
     operation_bit_mask_filter,
+    operation_bit_round,
     operation_collocation_filter,
     operation_comparison_filter,
+    operation_compute,
+    operation_derive_all,
     operation_derive_variable,
     operation_derive_smoothed_column_collocated_dataset,
     operation_derive_smoothed_column_collocated_product,
@@ -63,11 +66,15 @@ typedef enum harp_operation_type_enum
     operation_regrid,
     operation_regrid_collocated_dataset,
     operation_regrid_collocated_product,
+    operation_regrid_spatial,
     operation_rename,
+    operation_sample_grid,
     operation_set,
     operation_smooth_collocated_dataset,
     operation_smooth_collocated_product,
     operation_sort,
+    operation_sort_spatial,
+    operation_sparsify,
     operation_string_comparison_filter,
     operation_string_membership_filter,
     operation_valid_range_filter,
@@ -121,6 +128,9 @@ typedef enum harp_membership_operator_type_enum
  *   |-  harp_operation_bin_full
  *   |-  harp_operation_bin_spatial
  *   |-  harp_operation_bin_with_variable
+ *   |-  harp_operation_bit_round
+ *   |-  harp_operation_compute
+ *   |-  harp_operation_derive_all
  *   |-  harp_operation_derive_variable
  *   |-  harp_operation_derive_smoothed_column_collocated_dataset
  *   |-  harp_operation_derive_smoothed_column_collocated_product
@@ -130,11 +140,15 @@ typedef enum harp_membership_operator_type_enum
  *   |-  harp_operation_regrid
  *   |-  harp_operation_regrid_collocated_dataset
  *   |-  harp_operation_regrid_collocated_product
+ *   |-  harp_operation_regrid_spatial
  *   |-  harp_operation_rename
+ *   |-  harp_operation_sample_grid
  *   |-  harp_operation_set
  *   |-  harp_operation_smooth_collocated_dataset
  *   |-  harp_operation_smooth_collocated_product
  *   |-  harp_operation_sort
+ *   |-  harp_operation_sort_spatial
+ *   |-  harp_operation_sparsify
  *   |-  harp_operation_wrap
  */
 
@@ -214,8 +228,16 @@ typedef struct harp_operation_bin_collocated_struct
     /* parameters */
     char *collocation_result;
     char target_dataset;
+    harp_bin_aggregation_list *aggregation;
 } harp_operation_bin_collocated;
 
+typedef struct harp_operation_bin_full_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    harp_bin_aggregation_list *aggregation;
+} harp_operation_bin_full;
+
 typedef struct harp_operation_bin_spatial_struct
 {
     harp_operation_type type;
@@ -224,6 +246,8 @@ typedef struct harp_operation_bin_spatial_struct
     double *latitude_edges;
     long num_longitude_edges;
     double *longitude_edges;
+    harp_bin_aggregation_list *aggregation;
+    char *weights_filename;     /* spatial weights file (NULL if the weights are calculated for each product) */
 } harp_operation_bin_spatial;
 
 typedef struct harp_operation_bin_with_variable_struct
@@ -231,6 +255,7 @@ typedef struct harp_operation_bin_with_variable_struct
     harp_operation_type type;
     /* parameters */
     char *variable_name;
+    harp_bin_aggregation_list *aggregation;
 } harp_operation_bin_with_variable;
 
 typedef struct harp_operation_bit_mask_filter_struct
@@ -243,6 +268,15 @@ typedef struct harp_operation_bit_mask_filter_struct
     uint32_t bit_mask;
 } harp_operation_bit_mask_filter;
 
+typedef struct harp_operation_bit_round_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    char *variable_name;
+    int num_bits;       /* number of mantissa bits to keep (only used if uncertainty_variable_name is NULL) */
+    char *uncertainty_variable_name;
+} harp_operation_bit_round;
+
 typedef struct harp_operation_collocation_filter_struct
 {
     harp_operation_type type;
@@ -251,6 +285,7 @@ typedef struct harp_operation_collocation_filter_struct
     char *filename;
     harp_collocation_filter_type filter_type;
     /* extra */
+    harp_collocation_mask_set *collocation_mask_set;    /* masks for all products; read once per operation */
     harp_collocation_mask *collocation_mask;
     /* extra (for membership filter that is only used for the ingestion phase) */
     int num_values;
@@ -268,8 +303,20 @@ typedef struct harp_operation_comparison_filter_struct
     char *unit;
     /* extra */
     harp_unit_converter *unit_converter;
+    char *value_unit;   /* unit of the variable values for which unit_converter was set up */
 } harp_operation_comparison_filter;
 
+typedef struct harp_operation_compute_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    char *variable_name;
+    int has_data_type;
+    harp_data_type data_type;
+    char *unit;
+    harp_expression *expression;
+} harp_operation_compute;
+
 typedef struct harp_operation_derive_variable_struct
 {
     harp_operation_type type;
@@ -283,6 +330,14 @@ typedef struct harp_operation_derive_variable_struct
     char *unit;
 } harp_operation_derive_variable;
 
+typedef struct harp_operation_derive_all_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    int num_variables;
+    harp_operation_derive_variable **variable;
+} harp_operation_derive_all;
+
 typedef struct harp_operation_derive_smoothed_column_collocated_dataset_struct
 {
     harp_operation_type type;
@@ -343,6 +398,7 @@ typedef struct harp_operation_longitude_range_filter_struct
     double max;
     /* extra */
     harp_unit_converter *unit_converter;
+    char *value_unit;   /* unit of the variable values for which unit_converter was set up */
 } harp_operation_longitude_range_filter;
 
 typedef struct harp_operation_membership_filter_struct
@@ -357,6 +413,7 @@ typedef struct harp_operation_membership_filter_struct
     char *unit;
     /* extra */
     harp_unit_converter *unit_converter;
+    char *value_unit;   /* unit of the variable values for which unit_converter was set up */
 } harp_operation_membership_filter;
 
 typedef struct harp_operation_point_distance_filter_struct
@@ -366,6 +423,8 @@ typedef struct harp_operation_point_distance_filter_struct
     /* parameters */
     harp_spherical_point point;
     double distance;
+    /* extra */
+    harp_vector3d parametric_point;     /* point on the auxiliary sphere (for distances on the WGS84 ellipsoid) */
 } harp_operation_point_distance_filter;
 
 typedef struct harp_operation_point_in_area_filter_struct
@@ -408,6 +467,16 @@ typedef struct harp_operation_regrid_collocated_product_struct
     char *filename;
 } harp_operation_regrid_collocated_product;
 
+typedef struct harp_operation_regrid_spatial_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    long num_latitude_edges;
+    double *latitude_edges;
+    long num_longitude_edges;
+    double *longitude_edges;
+} harp_operation_regrid_spatial;
+
 typedef struct harp_operation_rename_struct
 {
     harp_operation_type type;
@@ -416,6 +485,14 @@ typedef struct harp_operation_rename_struct
     char *new_variable_name;
 } harp_operation_rename;
 
+typedef struct harp_operation_sample_grid_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    char *filename;
+    int nearest;        /* 1: nearest grid point, 0: bilinear interpolation */
+} harp_operation_sample_grid;
+
 typedef struct harp_operation_set_struct
 {
     harp_operation_type type;
@@ -454,9 +531,17 @@ typedef struct harp_operation_sort_struct
 {
     harp_operation_type type;
     /* parameters */
-    char *variable_name;
+    int num_variables;
+    char **variable_name;
 } harp_operation_sort;
 
+typedef struct harp_operation_sort_spatial_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    double time_step;   /* length of the time intervals in seconds (0 if the samples are only sorted spatially) */
+} harp_operation_sort_spatial;
+
 typedef struct harp_operation_string_comparison_filter_struct
 {
     harp_operation_type type;
@@ -510,6 +595,10 @@ int harp_operation_is_polygon_filter(const harp_operation *operation);
 int harp_operation_is_string_value_filter(const harp_operation *operation);
 int harp_operation_is_value_filter(const harp_operation *operation);
 int harp_operation_set_value_unit(harp_operation *operation, const char *unit);
+int harp_operation_filter_numeric_values(harp_operation *operation, harp_data_type data_type, long num_elements,
+                                         const void *data, uint8_t *mask);
+int harp_operation_filter_points(harp_operation *operation, long num_points, const harp_spherical_point *point,
+                                 uint8_t *mask);
 
 /* Specific operations */
 int harp_operation_area_covers_area_filter_new(const char *filename, int num_latitudes, double *latitude,
@@ -525,17 +614,25 @@ int harp_operation_area_intersects_area_filter_new(const char *filename, int num
                                                    const char *longitude_unit, double *min_fraction,
                                                    harp_operation **new_operation);
 int harp_operation_bin_collocated_new(const char *collocation_result, const char target_dataset,
-                                      harp_operation **new_operation);
-int harp_operation_bin_full_new(harp_operation **new_operation);
+                                      long num_aggregations, const char **aggregation, harp_operation **new_operation);
+int harp_operation_bin_full_new(long num_aggregations, const char **aggregation, harp_operation **new_operation);
 int harp_operation_bin_spatial_new(long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
-                                   double *longitude_edges, harp_operation **new_operation);
-int harp_operation_bin_with_variable_new(const char *variable_name, harp_operation **new_operation);
+                                   double *longitude_edges, long num_aggregations, const char **aggregation,
+                                   const char *weights_filename, harp_operation **new_operation);
+int harp_operation_bin_with_variable_new(const char *variable_name, long num_aggregations, const char **aggregation,
+                                         harp_operation **new_operation);
 int harp_operation_bit_mask_filter_new(const char *variable_name, harp_bit_mask_operator_type operator_type,
                                        uint32_t bit_mask, harp_operation **new_operation);
+int harp_operation_bit_round_new(const char *variable_name, int num_bits, const char *uncertainty_variable_name,
+                                 harp_operation **new_operation);
 int harp_operation_collocation_filter_new(const char *filename, harp_collocation_filter_type filter_type,
                                           harp_operation **new_operation);
 int harp_operation_comparison_filter_new(const char *variable_name, harp_comparison_operator_type operator_type,
                                          double value, const char *unit, harp_operation **new_operation);
+int harp_operation_compute_new(const char *variable_name, const harp_data_type *data_type, const char *unit,
+                               harp_expression *expression, harp_operation **new_operation);
+int harp_operation_derive_all_new(harp_operation **new_operation);
+int harp_operation_derive_all_add_variable(harp_operation_derive_all *operation, harp_operation *derive_operation);
 int harp_operation_derive_variable_new(const char *variable_name, const harp_data_type *data_type, int num_dimensions,
                                        const harp_dimension_type *dimension_type, const char *unit,
                                        harp_operation **new_operation);
@@ -574,7 +671,10 @@ int harp_operation_regrid_collocated_dataset_new(harp_dimension_type dimension_t
 int harp_operation_regrid_collocated_product_new(harp_dimension_type dimension_type, const char *axis_variable_name,
                                                  const char *axis_unit, const char *filename,
                                                  harp_operation **new_operation);
+int harp_operation_regrid_spatial_new(long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
+                                      double *longitude_edges, harp_operation **new_operation);
 int harp_operation_rename_new(const char *variable_name, const char *new_variable_name, harp_operation **new_operation);
+int harp_operation_sample_grid_new(const char *filename, const char *method, harp_operation **new_operation);
 int harp_operation_set_new(const char *option, const char *value, harp_operation **new_operation);
 int harp_operation_smooth_collocated_dataset_new(int num_variables, const char **variable_name,
                                                  harp_dimension_type dimension_type, const char *axis_variable_name,
@@ -585,7 +685,9 @@ int harp_operation_smooth_collocated_product_new(int num_variables, const char *
                                                  harp_dimension_type dimension_type, const char *axis_variable_name,
                                                  const char *axis_unit, const char *filename,
                                                  harp_operation **new_operation);
-int harp_operation_sort_new(const char *variable_name, harp_operation **new_operation);
+int harp_operation_sort_new(int num_variables, const char **variable_name, harp_operation **new_operation);
+int harp_operation_sort_spatial_new(double time_step, const char *unit, harp_operation **new_operation);
+int harp_operation_sparsify_new(harp_operation **new_operation);
 int harp_operation_string_comparison_filter_new(const char *variable_name, harp_comparison_operator_type operator_type,
                                                 const char *value, harp_operation **new_operation);
 int harp_operation_string_membership_filter_new(const char *variable_name, harp_membership_operator_type operator_type,
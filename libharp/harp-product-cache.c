@@ -0,0 +1,575 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+#include "harp-program.h"
+#include "harp-thread.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
+#ifdef WIN32
+#include "windows.h"
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+/* Product cache (see harp_set_option_product_cache()).
+ * Each entry is a HARP netCDF file '<key>.nc' in the cache directory, where the key is a 64-bit FNV-1a hash (as 16 hex
+ * digits) of the HARP version, the absolute path, size and modification time of the input file, the ingestion
+ * options, the operations string without whitespace, and the global options that influence the result of an import.
+ * The modification time of an entry is updated on each hit, such that evicting the entries with the oldest
+ * modification time removes the least recently used entries.
+ */
+
+#define CACHE_KEY_LENGTH 16
+#define CACHE_ENTRY_EXTENSION ".nc"
+
+typedef struct cache_entry_struct
+{
+    char *filename;
+    long mtime;
+    int64_t size;
+} cache_entry;
+
+static harp_mutex cache_mutex = HARP_MUTEX_INITIALIZER;
+static char *cache_directory = NULL;
+static long cache_num_hits = 0;
+static long cache_num_misses = 0;
+
+static void hash_update(uint64_t *hash, const char *str)
+{
+    /* include the terminating zero, such that consecutive fields can not run into each other */
+    do
+    {
+        *hash ^= (unsigned char)*str;
+        *hash *= 1099511628211ULL;
+    } while (*str++ != '\0');
+}
+
+/* update the hash with the operations string, ignoring all whitespace outside of quoted strings */
+static void hash_update_operations(uint64_t *hash, const char *operations)
+{
+    int in_string = 0;
+
+    while (*operations != '\0')
+    {
+        char c = *operations;
+
+        if (in_string)
+        {
+            if (c == '\\' && operations[1] != '\0')
+            {
+                *hash ^= (unsigned char)c;
+                *hash *= 1099511628211ULL;
+                operations++;
+                c = *operations;
+            }
+            else if (c == '"')
+            {
+                in_string = 0;
+            }
+        }
+        else if (c == '"')
+        {
+            in_string = 1;
+        }
+        else if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            operations++;
+            continue;
+        }
+        *hash ^= (unsigned char)c;
+        *hash *= 1099511628211ULL;
+        operations++;
+    }
+    hash_update(hash, "");
+}
+
+/* operations that use data from other files can not be cached, since a change of those files would go unnoticed */
+static int program_uses_external_data(const harp_program *program)
+{
+    int i;
+
+    for (i = 0; i < program->num_operations; i++)
+    {
+        switch (program->operation[i]->type)
+        {
+            case operation_area_covers_area_filter:
+            case operation_area_inside_area_filter:
+            case operation_area_intersects_area_filter:
+            case operation_bin_collocated:
+            case operation_collocation_filter:
+            case operation_derive_smoothed_column_collocated_dataset:
+            case operation_derive_smoothed_column_collocated_product:
+            case operation_point_in_area_filter:
+            case operation_regrid_collocated_dataset:
+            case operation_regrid_collocated_product:
+            case operation_sample_grid:
+            case operation_smooth_collocated_dataset:
+            case operation_smooth_collocated_product:
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    return 0;
+}
+
+static int is_cache_entry_name(const char *name)
+{
+    int i;
+
+    if (strlen(name) != CACHE_KEY_LENGTH + strlen(CACHE_ENTRY_EXTENSION) ||
+        strcmp(&name[CACHE_KEY_LENGTH], CACHE_ENTRY_EXTENSION) != 0)
+    {
+        return 0;
+    }
+    for (i = 0; i < CACHE_KEY_LENGTH; i++)
+    {
+        if (!((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f')))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int harp_product_cache_set_directory(const char *directory)
+{
+    char *new_directory = NULL;
+
+    if (directory != NULL)
+    {
+        struct stat statbuf;
+
+        if (stat(directory, &statbuf) != 0 || !(statbuf.st_mode & S_IFDIR))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product cache directory '%s' does not exist", directory);
+            return -1;
+        }
+        new_directory = strdup(directory);
+        if (new_directory == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            return -1;
+        }
+    }
+
+    harp_mutex_lock(&cache_mutex);
+    if (cache_directory != NULL)
+    {
+        free(cache_directory);
+    }
+    cache_directory = new_directory;
+    harp_mutex_unlock(&cache_mutex);
+
+    return 0;
+}
+
+const char *harp_product_cache_get_directory(void)
+{
+    return cache_directory;
+}
+
+/* Determine the path of the cache entry for an import of a file.
+ * If the import can not be cached (the cache is disabled, the program was not created from an operations string or
+ * uses data from other files, or the file can not be accessed) then *path is set to NULL.
+ */
+int harp_product_cache_get_entry_path(const char *filename, const harp_program *program, const char *options,
+                                      char **path)
+{
+    char absolute_path[HARP_MAX_PATH_LENGTH];
+    char buffer[128];
+    struct stat statbuf;
+    uint64_t hash = 14695981039346656037ULL;
+    char *entry_path;
+
+    *path = NULL;
+    if (cache_directory == NULL)
+    {
+        return 0;
+    }
+    if (program != NULL && (program->operations == NULL || program_uses_external_data(program)))
+    {
+        return 0;
+    }
+    if (stat(filename, &statbuf) != 0 || (statbuf.st_mode & S_IFDIR))
+    {
+        return 0;
+    }
+#ifdef WIN32
+    if (_fullpath(absolute_path, filename, HARP_MAX_PATH_LENGTH) == NULL)
+#else
+    if (realpath(filename, absolute_path) == NULL)
+#endif
+    {
+        return 0;
+    }
+
+    hash_update(&hash, HARP_VERSION);
+    hash_update(&hash, absolute_path);
+    sprintf(buffer, "%ld %ld", (long)statbuf.st_size, (long)statbuf.st_mtime);
+    hash_update(&hash, buffer);
+    hash_update(&hash, options != NULL ? options : "");
+    hash_update_operations(&hash, program != NULL ? program->operations : "");
+    sprintf(buffer, "%d %d %d %d %d %d", harp_get_option_enable_aux_afgl86(), harp_get_option_enable_aux_usstd76(),
+            harp_get_option_regrid_out_of_bounds(), harp_get_option_wgs84_point_distance(),
+            harp_option_optimize_operations, harp_option_keep_float);
+    hash_update(&hash, buffer);
+
+    entry_path = malloc(strlen(cache_directory) + 1 + CACHE_KEY_LENGTH + strlen(CACHE_ENTRY_EXTENSION) + 1);
+    if (entry_path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(cache_directory) + 1 + CACHE_KEY_LENGTH + strlen(CACHE_ENTRY_EXTENSION) + 1,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+#ifdef WIN32
+    sprintf(entry_path, "%s\\%08lx%08lx%s", cache_directory, (unsigned long)(hash >> 32),
+            (unsigned long)(hash & 0xFFFFFFFFUL), CACHE_ENTRY_EXTENSION);
+#else
+    sprintf(entry_path, "%s/%08lx%08lx%s", cache_directory, (unsigned long)(hash >> 32),
+            (unsigned long)(hash & 0xFFFFFFFFUL), CACHE_ENTRY_EXTENSION);
+#endif
+    *path = entry_path;
+
+    return 0;
+}
+
+/* Check whether a cache entry exists; this also updates the hit/miss statistics and marks the entry as recently used */
+int harp_product_cache_has_entry(const char *path)
+{
+    struct stat statbuf;
+    int found = (stat(path, &statbuf) == 0);
+
+    if (found)
+    {
+        utime(path, NULL);
+    }
+    harp_mutex_lock(&cache_mutex);
+    if (found)
+    {
+        cache_num_hits++;
+    }
+    else
+    {
+        cache_num_misses++;
+    }
+    harp_mutex_unlock(&cache_mutex);
+
+    return found;
+}
+
+/* Remove an entry that could not be read (the lookup then counts as a miss instead of a hit) */
+void harp_product_cache_remove_entry(const char *path)
+{
+    harp_report_warning("removing unreadable product cache entry '%s' (%s)", path, harp_errno_to_string(harp_errno));
+    remove(path);
+    harp_mutex_lock(&cache_mutex);
+    cache_num_hits--;
+    cache_num_misses++;
+    harp_mutex_unlock(&cache_mutex);
+}
+
+static int compare_cache_entry_mtime(const void *a, const void *b)
+{
+    const cache_entry *entry_a = (const cache_entry *)a;
+    const cache_entry *entry_b = (const cache_entry *)b;
+
+    if (entry_a->mtime != entry_b->mtime)
+    {
+        return entry_a->mtime < entry_b->mtime ? -1 : 1;
+    }
+    return strcmp(entry_a->filename, entry_b->filename);
+}
+
+static int add_cache_entry(const char *directory, const char *name, cache_entry **entry, long *num_entries)
+{
+    struct stat statbuf;
+    char *filename;
+
+    if (!is_cache_entry_name(name))
+    {
+        return 0;
+    }
+    filename = malloc(strlen(directory) + 1 + strlen(name) + 1);
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(directory) + 1 + strlen(name) + 1, __FILE__, __LINE__);
+        return -1;
+    }
+#ifdef WIN32
+    sprintf(filename, "%s\\%s", directory, name);
+#else
+    sprintf(filename, "%s/%s", directory, name);
+#endif
+    if (stat(filename, &statbuf) != 0)
+    {
+        /* the entry may have been removed by another process */
+        free(filename);
+        return 0;
+    }
+    if (*num_entries % BLOCK_SIZE == 0)
+    {
+        cache_entry *new_entry;
+
+        new_entry = realloc(*entry, (*num_entries + BLOCK_SIZE) * sizeof(cache_entry));
+        if (new_entry == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (*num_entries + BLOCK_SIZE) * sizeof(cache_entry), __FILE__, __LINE__);
+            free(filename);
+            return -1;
+        }
+        *entry = new_entry;
+    }
+    (*entry)[*num_entries].filename = filename;
+    (*entry)[*num_entries].mtime = (long)statbuf.st_mtime;
+    (*entry)[*num_entries].size = (int64_t)statbuf.st_size;
+    (*num_entries)++;
+
+    return 0;
+}
+
+static int get_cache_entries(const char *directory, cache_entry **entry, long *num_entries)
+{
+#ifdef WIN32
+    WIN32_FIND_DATA FileData;
+    HANDLE hSearch;
+    char *pattern;
+
+    pattern = malloc(strlen(directory) + 4 + 1);
+    if (pattern == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(directory) + 4 + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    sprintf(pattern, "%s\\*.*", directory);
+    hSearch = FindFirstFile(pattern, &FileData);
+    free(pattern);
+    if (hSearch == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+    do
+    {
+        if (add_cache_entry(directory, FileData.cFileName, entry, num_entries) != 0)
+        {
+            FindClose(hSearch);
+            return -1;
+        }
+    } while (FindNextFile(hSearch, &FileData));
+    FindClose(hSearch);
+#else
+    DIR *dirp;
+    struct dirent *dp;
+
+    dirp = opendir(directory);
+    if (dirp == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not open directory %s", directory);
+        return -1;
+    }
+    while ((dp = readdir(dirp)) != NULL)
+    {
+        if (add_cache_entry(directory, dp->d_name, entry, num_entries) != 0)
+        {
+            closedir(dirp);
+            return -1;
+        }
+    }
+    closedir(dirp);
+#endif
+
+    return 0;
+}
+
+/* Remove the least recently used entries until the total size of the cache is within the size limit */
+static int evict_cache_entries(const char *directory)
+{
+    cache_entry *entry = NULL;
+    long num_entries = 0;
+    int64_t total_size = 0;
+    long i;
+
+    if (get_cache_entries(directory, &entry, &num_entries) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < num_entries; i++)
+    {
+        total_size += entry[i].size;
+    }
+    if (total_size > harp_option_product_cache_size)
+    {
+        qsort(entry, num_entries, sizeof(cache_entry), compare_cache_entry_mtime);
+        for (i = 0; i < num_entries && total_size > harp_option_product_cache_size; i++)
+        {
+            if (remove(entry[i].filename) == 0)
+            {
+                total_size -= entry[i].size;
+            }
+        }
+    }
+    for (i = 0; i < num_entries; i++)
+    {
+        free(entry[i].filename);
+    }
+    if (entry != NULL)
+    {
+        free(entry);
+    }
+
+    return 0;
+}
+
+/* Store an imported product in the cache.
+ * The product is first written to a temporary file, which is then renamed, such that other processes never see a
+ * partially written entry. A failure to store the product only results in a warning.
+ */
+void harp_product_cache_add_entry(const char *path, const harp_product *product)
+{
+    char *directory;
+    char *tmp_path;
+    int64_t size;
+
+    if (harp_product_is_empty(product))
+    {
+        return;
+    }
+
+    tmp_path = malloc(strlen(path) + 32);
+    if (tmp_path == NULL)
+    {
+        harp_report_warning("could not add product cache entry '%s' (out of memory)", path);
+        return;
+    }
+#ifdef WIN32
+    sprintf(tmp_path, "%s.%d.tmp", path, (int)_getpid());
+#else
+    sprintf(tmp_path, "%s.%ld.tmp", path, (long)getpid());
+#endif
+    if (harp_export(tmp_path, "netcdf", product) != 0)
+    {
+        harp_report_warning("could not add product cache entry '%s' (%s)", path, harp_errno_to_string(harp_errno));
+        remove(tmp_path);
+        free(tmp_path);
+        return;
+    }
+    if (harp_get_file_size(tmp_path, &size) != 0 || size > harp_option_product_cache_size)
+    {
+        /* the product would not fit in the cache */
+        remove(tmp_path);
+        free(tmp_path);
+        return;
+    }
+#ifdef WIN32
+    /* rename() does not replace an existing file on Windows */
+    remove(path);
+#endif
+    if (rename(tmp_path, path) != 0)
+    {
+        harp_report_warning("could not add product cache entry '%s' (%s)", path, strerror(errno));
+        remove(tmp_path);
+        free(tmp_path);
+        return;
+    }
+    free(tmp_path);
+
+    harp_mutex_lock(&cache_mutex);
+    directory = cache_directory != NULL ? strdup(cache_directory) : NULL;
+    harp_mutex_unlock(&cache_mutex);
+    if (directory != NULL)
+    {
+        if (evict_cache_entries(directory) != 0)
+        {
+            harp_report_warning("could not clean up product cache '%s' (%s)", directory,
+                                harp_errno_to_string(harp_errno));
+        }
+        free(directory);
+    }
+}
+
+/** \addtogroup harp_general
+ * @{
+ */
+
+/** Retrieve the number of hits and misses of the product cache.
+ * Each import that is eligible for caching (see harp_set_option_product_cache()) counts as either a hit (the product
+ * was taken from the cache) or a miss (the product was imported from the file itself).
+ * \param num_hits Pointer to the variable where the number of hits will be stored (can be NULL).
+ * \param num_misses Pointer to the variable where the number of misses will be stored (can be NULL).
+ */
+LIBHARP_API void harp_get_product_cache_statistics(long *num_hits, long *num_misses)
+{
+    harp_mutex_lock(&cache_mutex);
+    if (num_hits != NULL)
+    {
+        *num_hits = cache_num_hits;
+    }
+    if (num_misses != NULL)
+    {
+        *num_misses = cache_num_misses;
+    }
+    harp_mutex_unlock(&cache_mutex);
+}
+
+/** Reset the hit and miss counts of the product cache to zero.
+ * \see harp_get_product_cache_statistics()
+ */
+LIBHARP_API void harp_reset_product_cache_statistics(void)
+{
+    harp_mutex_lock(&cache_mutex);
+    cache_num_hits = 0;
+    cache_num_misses = 0;
+    harp_mutex_unlock(&cache_mutex);
+}
+
+/** @} */
@@ -98,6 +98,10 @@ LIBHARP_API int harp_product_metadata_new(harp_product_metadata **new_metadata)
 
     metadata->datetime_start = 0.0;
     metadata->datetime_stop = 0.0;
+    metadata->latitude_min = harp_nan();
+    metadata->latitude_max = harp_nan();
+    metadata->longitude_min = harp_nan();
+    metadata->longitude_max = harp_nan();
 
     *new_metadata = metadata;
 
@@ -35,6 +35,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -48,6 +49,7 @@
  * - an array of dimension lengths for each dimension type (unvailable dimensions have length -1)
  * - the `source_product` global attribute (can be NULL)
  * - the `history` global attribute (can be NULL)
+ * - a lookup table from variable name to variable index (maintained by the harp_product_ functions)
  *
  * Note that the `Conventions` global attribute is not included as this is automatically handled by the import/export
  * functions of HARP. Similar, the `datetime_start` and `datetime_stop` attributes are handled by the export function.
@@ -124,71 +126,373 @@ static int get_arguments(int argc, char *argv[], char **new_arguments)
     return 0;
 }
 
-static harp_variable *comparison_variable;
+/* numerical sort key for an element of the dimension that is sorted by harp_product_sort_by_variables() */
+typedef struct sort_key_struct
+{
+    uint64_t value;     /* value mapped to an unsigned integer with the same ordering */
+    long index;
+} sort_key;
+
+/* string sort key for an element of the dimension that is sorted by harp_product_sort_by_variables() */
+typedef struct string_sort_key_struct
+{
+    const char *value;
+    long index;
+    long position;      /* position before sorting (makes the sort stable) */
+} string_sort_key;
 
-static int compare_variable_elements(const void *a, const void *b)
+static int compare_string_sort_keys(const void *a, const void *b)
 {
-    long index_a = *(long *)a;
-    long index_b = *(long *)b;
+    const string_sort_key *key_a = (const string_sort_key *)a;
+    const string_sort_key *key_b = (const string_sort_key *)b;
+    int result;
 
-    switch (comparison_variable->data_type)
+    result = strcmp(key_a->value, key_b->value);
+    if (result != 0)
     {
-        case harp_type_int8:
-            if (comparison_variable->data.int8_data[index_a] < comparison_variable->data.int8_data[index_b])
-            {
-                return -1;
-            }
-            else if (comparison_variable->data.int8_data[index_a] > comparison_variable->data.int8_data[index_b])
-            {
-                return 1;
-            }
-            return 0;
-        case harp_type_int16:
-            if (comparison_variable->data.int16_data[index_a] < comparison_variable->data.int16_data[index_b])
-            {
-                return -1;
-            }
-            else if (comparison_variable->data.int16_data[index_a] > comparison_variable->data.int16_data[index_b])
-            {
-                return 1;
-            }
-            return 0;
-        case harp_type_int32:
-            if (comparison_variable->data.int32_data[index_a] < comparison_variable->data.int32_data[index_b])
-            {
-                return -1;
-            }
-            else if (comparison_variable->data.int32_data[index_a] > comparison_variable->data.int32_data[index_b])
-            {
-                return 1;
-            }
-            return 0;
-        case harp_type_float:
-            if (comparison_variable->data.float_data[index_a] < comparison_variable->data.float_data[index_b])
-            {
-                return -1;
-            }
-            else if (comparison_variable->data.float_data[index_a] > comparison_variable->data.float_data[index_b])
-            {
-                return 1;
-            }
-            return 0;
-        case harp_type_double:
-            if (comparison_variable->data.double_data[index_a] < comparison_variable->data.double_data[index_b])
+        return result;
+    }
+
+    return (key_a->position > key_b->position) - (key_a->position < key_b->position);
+}
+
+/* map a floating point value to an unsigned integer with the same ordering (NaN values are mapped to the maximum) */
+static uint64_t get_sort_key_value_for_double(double value)
+{
+    uint64_t bits;
+
+    if (harp_isnan(value))
+    {
+        return UINT64_MAX;
+    }
+    if (value == 0)
+    {
+        /* make -0 and +0 equal */
+        value = 0;
+    }
+    memcpy(&bits, &value, sizeof(uint64_t));
+
+    return (bits & ((uint64_t)1 << 63)) ? ~bits : bits | ((uint64_t)1 << 63);
+}
+
+/* map a signed integer value to an unsigned integer with the same ordering */
+static uint64_t get_sort_key_value_for_integer(int32_t value)
+{
+    return (uint64_t)(int64_t)value ^ ((uint64_t)1 << 63);
+}
+
+/* Sort the keys using a (stable) LSD radix sort with 8-bit digits.
+ * Passes for a digit that is the same for all keys (such as the upper bytes of small integers) are skipped.
+ * On return *key will point to the sorted keys and *buffer to the other buffer (the two may have been swapped).
+ */
+static void radix_sort_keys(long num_keys, sort_key **key, sort_key **buffer)
+{
+    long count[8][256];
+    sort_key *source = *key;
+    sort_key *target = *buffer;
+    long i;
+    int d;
+
+    memset(count, 0, sizeof(count));
+
+    /* determine the histograms for all digits in a single pass */
+    for (i = 0; i < num_keys; i++)
+    {
+        for (d = 0; d < 8; d++)
+        {
+            count[d][(source[i].value >> (8 * d)) & 0xff]++;
+        }
+    }
+
+    for (d = 0; d < 8; d++)
+    {
+        long offset = 0;
+        int shift = 8 * d;
+
+        if (count[d][(source[0].value >> shift) & 0xff] == num_keys)
+        {
+            continue;
+        }
+        /* turn the histogram into the start offset for each digit value */
+        for (i = 0; i < 256; i++)
+        {
+            long digit_num_keys = count[d][i];
+
+            count[d][i] = offset;
+            offset += digit_num_keys;
+        }
+        for (i = 0; i < num_keys; i++)
+        {
+            target[count[d][(source[i].value >> shift) & 0xff]++] = source[i];
+        }
+        {
+            sort_key *swap = source;
+
+            source = target;
+            target = swap;
+        }
+    }
+
+    *key = source;
+    *buffer = target;
+}
+
+/* Stable sort of the permutation on the values of the given one dimensional variable
+ * (i.e. permutation[i] is replaced by permutation[j], where j is the position of the i-th smallest value of
+ * variable[permutation[...]]).
+ */
+static int sort_permutation(const harp_variable *variable, long num_elements, long *permutation)
+{
+    long i;
+
+    if (variable->data_type == harp_type_string)
+    {
+        string_sort_key *key;
+
+        key = malloc(num_elements * sizeof(string_sort_key));
+        if (key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_elements * sizeof(string_sort_key), __FILE__, __LINE__);
+            return -1;
+        }
+        for (i = 0; i < num_elements; i++)
+        {
+            const char *value = variable->data.string_data[permutation[i]];
+
+            /* a NULL string is sorted as an empty string */
+            key[i].value = value == NULL ? "" : value;
+            key[i].index = permutation[i];
+            key[i].position = i;
+        }
+        qsort(key, num_elements, sizeof(string_sort_key), compare_string_sort_keys);
+        for (i = 0; i < num_elements; i++)
+        {
+            permutation[i] = key[i].index;
+        }
+        free(key);
+    }
+    else
+    {
+        sort_key *key;
+        sort_key *buffer;
+
+        key = malloc(2 * num_elements * sizeof(sort_key));
+        if (key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           2 * num_elements * sizeof(sort_key), __FILE__, __LINE__);
+            return -1;
+        }
+        buffer = &key[num_elements];
+        switch (variable->data_type)
+        {
+            case harp_type_int8:
+                for (i = 0; i < num_elements; i++)
+                {
+                    key[i].value = get_sort_key_value_for_integer(variable->data.int8_data[permutation[i]]);
+                }
+                break;
+            case harp_type_int16:
+                for (i = 0; i < num_elements; i++)
+                {
+                    key[i].value = get_sort_key_value_for_integer(variable->data.int16_data[permutation[i]]);
+                }
+                break;
+            case harp_type_int32:
+                for (i = 0; i < num_elements; i++)
+                {
+                    key[i].value = get_sort_key_value_for_integer(variable->data.int32_data[permutation[i]]);
+                }
+                break;
+            case harp_type_float:
+                for (i = 0; i < num_elements; i++)
+                {
+                    key[i].value = get_sort_key_value_for_double(variable->data.float_data[permutation[i]]);
+                }
+                break;
+            case harp_type_double:
+                for (i = 0; i < num_elements; i++)
+                {
+                    key[i].value = get_sort_key_value_for_double(variable->data.double_data[permutation[i]]);
+                }
+                break;
+            case harp_type_string:
+                assert(0);
+                exit(1);
+        }
+        for (i = 0; i < num_elements; i++)
+        {
+            key[i].index = permutation[i];
+        }
+        {
+            sort_key *sorted_key = key;
+
+            radix_sort_keys(num_elements, &sorted_key, &buffer);
+            for (i = 0; i < num_elements; i++)
             {
-                return -1;
+                permutation[i] = sorted_key[i].index;
             }
-            else if (comparison_variable->data.double_data[index_a] > comparison_variable->data.double_data[index_b])
+        }
+        free(key);
+    }
+
+    return 0;
+}
+
+/* Name lookup table for the variables of a product.
+ * The table contains copies of the variable names, so it stays valid when a variable in the product gets replaced by
+ * a variable with the same name. Any removal of a variable invalidates the table; it is then rebuilt on the next
+ * addition of a variable. Lookups fall back to a linear search whenever there is no (valid) table.
+ */
+typedef struct variable_index_struct
+{
+    hashtable *table;
+    char **name;
+    int num_names;
+} variable_index;
+
+static void variable_index_delete(variable_index *index)
+{
+    if (index != NULL)
+    {
+        if (index->table != NULL)
+        {
+            hashtable_delete(index->table);
+        }
+        if (index->name != NULL)
+        {
+            int i;
+
+            for (i = 0; i < index->num_names; i++)
             {
-                return 1;
+                free(index->name[i]);
             }
-            return 0;
-        case harp_type_string:
-            return strcmp(comparison_variable->data.string_data[index_a],
-                          comparison_variable->data.string_data[index_b]);
+            free(index->name);
+        }
+        free(index);
+    }
+}
+
+static variable_index *variable_index_new(void)
+{
+    variable_index *index;
+
+    index = (variable_index *)malloc(sizeof(variable_index));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    index->name = NULL;
+    index->num_names = 0;
+    index->table = hashtable_new(1);
+    if (index->table == NULL)
+    {
+        free(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+static int variable_index_add(variable_index *index, const char *name)
+{
+    char *name_copy;
+
+    if (index->num_names % BLOCK_SIZE == 0)
+    {
+        char **new_name;
+
+        new_name = (char **)realloc(index->name, (index->num_names + BLOCK_SIZE) * sizeof(char *));
+        if (new_name == NULL)
+        {
+            return -1;
+        }
+        index->name = new_name;
+    }
+    name_copy = strdup(name);
+    if (name_copy == NULL)
+    {
+        return -1;
+    }
+    if (hashtable_add_name(index->table, name_copy) != 0)
+    {
+        free(name_copy);
+        return -1;
+    }
+    index->name[index->num_names] = name_copy;
+    index->num_names++;
+
+    return 0;
+}
+
+static void invalidate_variable_index(harp_product *product)
+{
+    variable_index_delete((variable_index *)product->variable_index);
+    product->variable_index = NULL;
+}
+
+/* Make the lookup table cover the last variable of the product (rebuilding the table if needed).
+ * Failure to update the table is not an error; the product will then just use linear lookups.
+ */
+static void update_variable_index_on_variable_add(harp_product *product)
+{
+    variable_index *index = (variable_index *)product->variable_index;
+    int i;
+
+    if (index != NULL && index->num_names == product->num_variables - 1)
+    {
+        if (variable_index_add(index, product->variable[product->num_variables - 1]->name) != 0)
+        {
+            invalidate_variable_index(product);
+        }
+        return;
+    }
+
+    invalidate_variable_index(product);
+    index = variable_index_new();
+    if (index == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < product->num_variables; i++)
+    {
+        if (variable_index_add(index, product->variable[i]->name) != 0)
+        {
+            variable_index_delete(index);
+            return;
+        }
+    }
+    product->variable_index = index;
+}
+
+/* Returns the index of the variable with the given name, or -1 if the product has no such variable. */
+static int find_variable_index(const harp_product *product, const char *name)
+{
+    const variable_index *index = (const variable_index *)product->variable_index;
+    int i;
+
+    if (index != NULL && index->num_names == product->num_variables)
+    {
+        long table_index = hashtable_get_index_from_name(index->table, name);
+
+        if (table_index >= 0 && strcmp(product->variable[table_index]->name, name) == 0)
+        {
+            return (int)table_index;
+        }
+        /* a variable may have been renamed with harp_variable_rename() while part of the product, so a miss (or a
+         * stale hit) is not conclusive; fall back to a linear search */
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        if (strcmp(product->variable[i]->name, name) == 0)
+        {
+            return i;
+        }
     }
-    assert(0);
-    exit(1);
+
+    return -1;
 }
 
 static void sync_product_dimensions_on_variable_add(harp_product *product, const harp_variable *variable)
@@ -325,6 +629,7 @@ int harp_product_make_time_dependent(harp_product *product)
 int harp_product_rearrange_dimension(harp_product *product, harp_dimension_type dimension_type, long num_dim_elements,
                                      const long *dim_element_ids)
 {
+    harp_spare_buffer spare = { NULL, 0 };
     int i;
 
     if (dimension_type == harp_dimension_independent)
@@ -354,6 +659,7 @@ int harp_product_rearrange_dimension(harp_product *product, harp_dimension_type
         return 0;
     }
 
+    /* the buffer that is released by one variable is reused for the next variable where possible */
     for (i = 0; i < product->num_variables; i++)
     {
         harp_variable *variable = product->variable[i];
@@ -366,12 +672,15 @@ int harp_product_rearrange_dimension(harp_product *product, harp_dimension_type
                 continue;
             }
 
-            if (harp_variable_rearrange_dimension(variable, j, num_dim_elements, dim_element_ids) != 0)
+            if (harp_variable_rearrange_dimension_with_spare(variable, j, num_dim_elements, dim_element_ids, &spare)
+                != 0)
             {
+                harp_spare_buffer_done(&spare);
                 return -1;
             }
         }
     }
+    harp_spare_buffer_done(&spare);
 
     product->dimension[dimension_type] = num_dim_elements;
 
@@ -588,6 +897,7 @@ void harp_product_remove_all_variables(harp_product *product)
         free(product->variable);
     }
 
+    invalidate_variable_index(product);
     memset(product->dimension, 0, HARP_NUM_DIM_TYPES * sizeof(long));
     product->num_variables = 0;
     product->variable = NULL;
@@ -725,49 +1035,299 @@ int harp_product_get_datetime_range(const harp_product *product, double *datetim
     return 0;
 }
 
-int harp_product_get_storage_size(const harp_product *product, int with_attributes, int64_t *size)
+/* Extend the range [*range_min, *range_max] with the non-NaN values of the variable (if the product has it), in the
+ * given unit. Only float and double variables are taken into account.
+ * Values outside the valid range of the variable are included as well, since value filters also compare against
+ * those values (i.e. the range stays conservative when it is used to skip products based on their metadata).
+ */
+static int update_value_range(const harp_product *product, const char *name, const char *unit, double *range_min,
+                              double *range_max)
 {
-    int64_t total_size = 0;
-    int i;
+    harp_variable *variable;
+    double value_min = harp_plusinf();
+    double value_max = harp_mininf();
+    long i;
 
-    if (with_attributes)
+    if (harp_product_get_variable_by_name(product, name, &variable) != 0)
     {
-        if (product->source_product != NULL)
+        /* variable is optional */
+        return 0;
+    }
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        double value;
+
+        if (variable->data_type == harp_type_float)
         {
-            total_size += strlen(product->source_product);
+            value = variable->data.float_data[i];
         }
-        if (product->history != NULL)
+        else if (variable->data_type == harp_type_double)
         {
-            total_size += strlen(product->history);
+            value = variable->data.double_data[i];
         }
-    }
-
-    for (i = 0; i < product->num_variables; i++)
-    {
-        harp_variable *variable = product->variable[i];
-
-        total_size += variable->num_elements * harp_get_size_for_type(variable->data_type);
-        if (with_attributes)
+        else
         {
-            if (variable->description != 0)
+            break;
+        }
+        if (!harp_isnan(value))
+        {
+            if (value < value_min)
             {
-                total_size += strlen(variable->description);
+                value_min = value;
             }
-            if (variable->unit != 0)
+            if (value > value_max)
             {
-                total_size += strlen(variable->unit);
+                value_max = value;
             }
         }
     }
+    if (value_min > value_max)
+    {
+        /* only NaN values (or unsupported data type) */
+        return 0;
+    }
+
+    if (variable->unit != NULL && harp_unit_compare(variable->unit, unit) != 0)
+    {
+        /* angle conversions are linear and increasing, so the converted extremes are the extremes */
+        if (harp_convert_unit(variable->unit, unit, 1, &value_min) != 0)
+        {
+            return -1;
+        }
+        if (harp_convert_unit(variable->unit, unit, 1, &value_max) != 0)
+        {
+            return -1;
+        }
+    }
+    if (value_min < *range_min)
+    {
+        *range_min = value_min;
+    }
+    if (value_max > *range_max)
+    {
+        *range_max = value_max;
+    }
 
-    *size = total_size;
     return 0;
 }
 
-/** \addtogroup harp_product
- * @{
- */
-
+/**
+ * Determine the spatial extent of the product, i.e. the range of the values of the latitude and longitude variables
+ * (including the latitude_bounds and longitude_bounds variables if the product has them). Longitudes are not
+ * normalized, so the longitude range is in terms of the longitude values as they are stored in the product.
+ *
+ * \param  product       Product to compute the spatial extent of.
+ * \param  latitude_min  Pointer to the location where the minimum latitude [degree_north] will be stored.
+ * \param  latitude_max  Pointer to the location where the maximum latitude [degree_north] will be stored.
+ * \param  longitude_min Pointer to the location where the minimum longitude [degree_east] will be stored.
+ * \param  longitude_max Pointer to the location where the maximum longitude [degree_east] will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_product_get_spatial_extent(const harp_product *product, double *latitude_min, double *latitude_max,
+                                    double *longitude_min, double *longitude_max)
+{
+    double lat_min = harp_plusinf();
+    double lat_max = harp_mininf();
+    double lon_min = harp_plusinf();
+    double lon_max = harp_mininf();
+
+    if (update_value_range(product, "latitude", "degree_north", &lat_min, &lat_max) != 0)
+    {
+        return -1;
+    }
+    if (update_value_range(product, "latitude_bounds", "degree_north", &lat_min, &lat_max) != 0)
+    {
+        return -1;
+    }
+    if (update_value_range(product, "longitude", "degree_east", &lon_min, &lon_max) != 0)
+    {
+        return -1;
+    }
+    if (update_value_range(product, "longitude_bounds", "degree_east", &lon_min, &lon_max) != 0)
+    {
+        return -1;
+    }
+    if (lat_min > lat_max || lon_min > lon_max)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot determine spatial extent");
+        return -1;
+    }
+
+    *latitude_min = lat_min;
+    *latitude_max = lat_max;
+    *longitude_min = lon_min;
+    *longitude_max = lon_max;
+
+    return 0;
+}
+
+/** Determine the amount of memory that is used for storing the contents of a product.
+ * The size is based on the data of all variables (and, if \a with_attributes is set, on the length of the
+ * source_product, history, description, and unit attributes). Memory used for administrative structures is not
+ * included.
+ * \param product Product for which to determine the size.
+ * \param with_attributes Whether the size of the attributes should be included.
+ * \param size Pointer to the C variable where the size in bytes will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_get_storage_size(const harp_product *product, int with_attributes, int64_t *size)
+{
+    int64_t total_size = 0;
+    int i;
+
+    if (with_attributes)
+    {
+        if (product->source_product != NULL)
+        {
+            total_size += strlen(product->source_product);
+        }
+        if (product->history != NULL)
+        {
+            total_size += strlen(product->history);
+        }
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        harp_variable *variable = product->variable[i];
+
+        total_size += variable->num_elements * harp_get_size_for_type(variable->data_type);
+        if (with_attributes)
+        {
+            if (variable->description != 0)
+            {
+                total_size += strlen(variable->description);
+            }
+            if (variable->unit != 0)
+            {
+                total_size += strlen(variable->unit);
+            }
+        }
+    }
+
+    *size = total_size;
+    return 0;
+}
+
+static int get_variable_time_slice(const harp_variable *variable, long offset, long length,
+                                   harp_variable **new_variable)
+{
+    harp_variable *slice;
+    long dimension[HARP_MAX_NUM_DIMS];
+    long block_size;
+    long i;
+
+    if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        return harp_variable_copy(variable, new_variable);
+    }
+
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        dimension[i] = variable->dimension[i];
+    }
+    dimension[0] = length;
+
+    if (harp_variable_new(variable->name, variable->data_type, variable->num_dimensions, variable->dimension_type,
+                          dimension, &slice) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_copy_attributes(variable, slice) != 0)
+    {
+        harp_variable_delete(slice);
+        return -1;
+    }
+    slice->valid_min = variable->valid_min;
+    slice->valid_max = variable->valid_max;
+
+    /* the time dimension is always the first dimension, so the slice is a contiguous block of elements */
+    block_size = variable->num_elements / variable->dimension[0];
+    if (variable->data_type == harp_type_string)
+    {
+        for (i = 0; i < slice->num_elements; i++)
+        {
+            slice->data.string_data[i] = strdup(variable->data.string_data[offset * block_size + i]);
+            if (slice->data.string_data[i] == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)",
+                               __FILE__, __LINE__);
+                harp_variable_delete(slice);
+                return -1;
+            }
+        }
+    }
+    else
+    {
+        long element_size = harp_get_size_for_type(variable->data_type);
+
+        memcpy(slice->data.int8_data, &variable->data.int8_data[offset * block_size * element_size],
+               (size_t)slice->num_elements * element_size);
+    }
+
+    *new_variable = slice;
+    return 0;
+}
+
+/* Create a new product that contains the time samples [offset, offset + length) of product.
+ * Variables that do not depend on the time dimension are copied as a whole.
+ */
+int harp_product_get_time_slice(const harp_product *product, long offset, long length, harp_product **new_product)
+{
+    harp_product *slice;
+    int i;
+
+    if (harp_product_new(&slice) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        harp_variable *variable;
+
+        if (get_variable_time_slice(product->variable[i], offset, length, &variable) != 0)
+        {
+            harp_product_delete(slice);
+            return -1;
+        }
+        if (harp_product_add_variable(slice, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            harp_product_delete(slice);
+            return -1;
+        }
+    }
+
+    if (product->source_product != NULL)
+    {
+        if (harp_product_set_source_product(slice, product->source_product) != 0)
+        {
+            harp_product_delete(slice);
+            return -1;
+        }
+    }
+    if (product->history != NULL)
+    {
+        if (harp_product_set_history(slice, product->history) != 0)
+        {
+            harp_product_delete(slice);
+            return -1;
+        }
+    }
+
+    *new_product = slice;
+    return 0;
+}
+
+/** \addtogroup harp_product
+ * @{
+ */
+
 /** Create new product.
  * The product will be intialized with 0 variables and 0 attributes.
  * \param new_product Pointer to the C variable where the new HARP product will be stored.
@@ -792,6 +1352,7 @@ LIBHARP_API int harp_product_new(harp_product **new_product)
     product->variable = NULL;
     product->source_product = NULL;
     product->history = NULL;
+    product->variable_index = NULL;
 
     *new_product = product;
     return 0;
@@ -827,19 +1388,13 @@ LIBHARP_API void harp_product_delete(harp_product *product)
             free(product->history);
         }
 
+        variable_index_delete((variable_index *)product->variable_index);
+
         free(product);
     }
 }
 
-/** Create a copy of a product.
- * The function will create a deep-copy of the given product, also creating copyies of all attributes and variables.
- * \param other_product Product that should be copied.
- * \param new_product Pointer to the variable where the new HARP product will be stored.
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
- */
-LIBHARP_API int harp_product_copy(const harp_product *other_product, harp_product **new_product)
+static int product_copy(const harp_product *other_product, int share_data, harp_product **new_product)
 {
     harp_product *product;
     int i;
@@ -853,7 +1408,15 @@ LIBHARP_API int harp_product_copy(const harp_product *other_product, harp_produc
     {
         harp_variable *variable;
 
-        if (harp_variable_copy(other_product->variable[i], &variable) != 0)
+        if (share_data)
+        {
+            if (harp_variable_copy_shared(other_product->variable[i], &variable) != 0)
+            {
+                harp_product_delete(product);
+                return -1;
+            }
+        }
+        else if (harp_variable_copy(other_product->variable[i], &variable) != 0)
         {
             harp_product_delete(product);
             return -1;
@@ -895,6 +1458,34 @@ LIBHARP_API int harp_product_copy(const harp_product *other_product, harp_produc
     return 0;
 }
 
+/** Create a copy of a product.
+ * The function will create a deep-copy of the given product, also creating copyies of all attributes and variables.
+ * \param other_product Product that should be copied.
+ * \param new_product Pointer to the variable where the new HARP product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_copy(const harp_product *other_product, harp_product **new_product)
+{
+    return product_copy(other_product, 0, new_product);
+}
+
+/** Create a copy of a product whose variables share their data with the original product (copy-on-write).
+ * The variables are copied using harp_variable_copy_shared(), so the cost of the copy only depends on the number of
+ * variables and not on the amount of data. The data of a variable is only duplicated once it gets modified in either
+ * the copy or the original product (e.g. by harp_product_execute_operations()).
+ * \param other_product Product that should be copied.
+ * \param new_product Pointer to the variable where the new HARP product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_copy_shared(const harp_product *other_product, harp_product **new_product)
+{
+    return product_copy(other_product, 1, new_product);
+}
+
 /** Append one product to another.
  * The 'index' variable, if present, will be removed.
  * All variables in both products will have a 'time' dimension introduced as first dimension.
@@ -1011,6 +1602,66 @@ LIBHARP_API int harp_product_append(harp_product *product, harp_product *other_p
     return 0;
 }
 
+/** Allocate memory such that the time dimension of a product can grow up to the given length.
+ * This can be used before appending products (with harp_product_append()) when the final length of the time
+ * dimension is known (or when an upper bound is known), such that memory for each variable only needs to be
+ * allocated once. The dimensions of the product are not changed. Only time dependent variables are affected.
+ * \param product Product for which memory should be reserved.
+ * \param length Length of the time dimension for which memory should be available.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_reserve_time_dimension(harp_product *product, long length)
+{
+    int i;
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        harp_variable *variable = product->variable[i];
+
+        if (variable->num_dimensions > 0 && variable->dimension_type[0] == harp_dimension_time)
+        {
+            if (harp_variable_reserve_time_dimension(variable, length) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Prepare a product for appending products with the given maximum dimension lengths.
+ * Each non-time dimension that the product uses and that is shorter than the given length is extended to that length
+ * (padding the data of the variables in the same way as harp_product_append() would do) and memory is reserved for a
+ * time dimension of length dimension[#harp_dimension_time] (see harp_product_reserve_time_dimension()).
+ * When the lengths are known in advance (e.g. from the metadata of the products), this ensures that the product only
+ * needs to be resized once. harp_product_append() will then only need to extend the products that are appended.
+ * \param product Product for which memory should be reserved.
+ * \param dimension Maximum length of each dimension type (0 for unknown/unused dimensions).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_reserve_dimensions(harp_product *product, const long dimension[HARP_NUM_DIM_TYPES])
+{
+    int i;
+
+    for (i = 0; i < HARP_NUM_DIM_TYPES; i++)
+    {
+        if (i != harp_dimension_time && product->dimension[i] > 0 && product->dimension[i] < dimension[i])
+        {
+            if (harp_product_resize_dimension(product, i, dimension[i]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return harp_product_reserve_time_dimension(product, dimension[harp_dimension_time]);
+}
+
 /** Set the source product attribute of the specified product.
  * Stores the base name of \a product_path as the value of the source product attribute of the specified product.
  * The previous value (if any) will be freed.
@@ -1151,6 +1802,8 @@ LIBHARP_API int harp_product_add_variable(harp_product *product, harp_variable *
     /* Update product dimensions. */
     sync_product_dimensions_on_variable_add(product, variable);
 
+    update_variable_index_on_variable_add(product);
+
     return 0;
 }
 
@@ -1188,6 +1841,9 @@ LIBHARP_API int harp_product_detach_variable(harp_product *product, const harp_v
             }
             product->num_variables--;
 
+            /* Variable indices have shifted, so the lookup table will be rebuilt on the next variable addition. */
+            invalidate_variable_index(product);
+
             return 0;
         }
     }
@@ -1320,22 +1976,12 @@ LIBHARP_API int harp_product_replace_variable(harp_product *product, harp_variab
  */
 LIBHARP_API int harp_product_has_variable(const harp_product *product, const char *name)
 {
-    int i;
-
     if (name == NULL)
     {
         return 0;
     }
 
-    for (i = 0; i < product->num_variables; i++)
-    {
-        if (strcmp(product->variable[i]->name, name) == 0)
-        {
-            return 1;
-        }
-    }
-
-    return 0;
+    return find_variable_index(product, name) >= 0;
 }
 
 /** Find variable with a given name for a product.
@@ -1364,13 +2010,11 @@ LIBHARP_API int harp_product_get_variable_by_name(const harp_product *product, c
         return -1;
     }
 
-    for (i = 0; i < product->num_variables; i++)
+    i = find_variable_index(product, name);
+    if (i >= 0)
     {
-        if (strcmp(product->variable[i]->name, name) == 0)
-        {
-            *variable = product->variable[i];
-            return 0;
-        }
+        *variable = product->variable[i];
+        return 0;
     }
 
     harp_set_error(HARP_ERROR_VARIABLE_NOT_FOUND, "variable '%s' does not exist", name);
@@ -1402,13 +2046,11 @@ LIBHARP_API int harp_product_get_variable_index_by_name(const harp_product *prod
         return -1;
     }
 
-    for (i = 0; i < product->num_variables; i++)
+    i = find_variable_index(product, name);
+    if (i >= 0)
     {
-        if (strcmp(product->variable[i]->name, name) == 0)
-        {
-            *index = i;
-            return 0;
-        }
+        *index = i;
+        return 0;
     }
 
     harp_set_error(HARP_ERROR_VARIABLE_NOT_FOUND, "variable '%s' does not exist", name);
@@ -1522,13 +2164,7 @@ LIBHARP_API int harp_product_update_history(harp_product *product, const char *e
     return 0;
 }
 
-/** Verify that a product is internally consistent and complies with conventions.
- * \param product Product to verify.
- * \return
- *   \arg \c 0, Product verified successfully.
- *   \arg \c -1, Error occurred (check #harp_errno).
- */
-LIBHARP_API int harp_product_verify(const harp_product *product)
+static int product_verify(const harp_product *product, int check_conventions)
 {
     hashtable *variable_names;
     int i;
@@ -1562,7 +2198,7 @@ LIBHARP_API int harp_product_verify(const harp_product *product)
     }
 
     /* Make sure that units module gets initialized so we report on initialization errors early and separately */
-    if (!harp_unit_is_valid(""))
+    if (check_conventions && !harp_unit_is_valid(""))
     {
         return -1;
     }
@@ -1578,7 +2214,7 @@ LIBHARP_API int harp_product_verify(const harp_product *product)
             return -1;
         }
 
-        if (harp_variable_verify(variable) != 0)
+        if ((check_conventions ? harp_variable_verify(variable) : harp_variable_verify_structure(variable)) != 0)
         {
             if (variable->name == NULL)
             {
@@ -1643,13 +2279,32 @@ LIBHARP_API int harp_product_verify(const harp_product *product)
     return 0;
 }
 
-/** Print a harp_product struct using the specified print function.
- * \param product Product to print.
- * \param show_attributes Whether or not to print the attributes of variables.
- * \param show_data Whether or not to print the data arrays of the variables
- * \param print Print function to use
- */
-LIBHARP_API void harp_product_print(const harp_product *product, int show_attributes, int show_data,
+/** Verify that a product is internally consistent and complies with conventions.
+ * \param product Product to verify.
+ * \return
+ *   \arg \c 0, Product verified successfully.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_verify(const harp_product *product)
+{
+    return product_verify(product, 1);
+}
+
+/* Same as harp_product_verify(), but only verifies the structure of the product and its variables (see
+ * harp_variable_verify_structure()). This is used for imports of HARP products when the 'trusted_import' option is set.
+ */
+int harp_product_verify_structure(const harp_product *product)
+{
+    return product_verify(product, 0);
+}
+
+/** Print a harp_product struct using the specified print function.
+ * \param product Product to print.
+ * \param show_attributes Whether or not to print the attributes of variables.
+ * \param show_data Whether or not to print the data arrays of the variables
+ * \param print Print function to use
+ */
+LIBHARP_API void harp_product_print(const harp_product *product, int show_attributes, int show_data,
                                     int (*print) (const char *, ...))
 {
     int i;
@@ -1725,6 +2380,7 @@ LIBHARP_API void harp_product_print(const harp_product *product, int show_attrib
  */
 LIBHARP_API int harp_product_flatten_dimension(harp_product *product, harp_dimension_type dimension_type)
 {
+    harp_spare_buffer spare = { NULL, 0 };
     harp_variable *var;
     long dim_length = product->dimension[dimension_type];
     int i, j;
@@ -1788,7 +2444,6 @@ LIBHARP_API int harp_product_flatten_dimension(harp_product *product, harp_dimen
 
     for (i = product->num_variables - 1; i >= 0; i--)
     {
-        int order[HARP_MAX_NUM_DIMS];
         int dim_index = -1;
         int count = 0;
 
@@ -1810,6 +2465,7 @@ LIBHARP_API int harp_product_flatten_dimension(harp_product *product, harp_dimen
                 /* add the dimension to be flattened in the right place; this effectively extends time appropriately */
                 if (harp_variable_add_dimension(var, 1, dimension_type, dim_length) != 0)
                 {
+                    harp_spare_buffer_done(&spare);
                     return -1;
                 }
                 dim_index = 1;
@@ -1831,41 +2487,33 @@ LIBHARP_API int harp_product_flatten_dimension(harp_product *product, harp_dimen
         /* the variable must be time-dependend */
         if (var->dimension_type[0] != harp_dimension_time)
         {
+            /* move the dimension to the front before the data gets replicated for each time sample, such that the
+             * transpose (if any) is performed on the smaller array */
+            if (harp_variable_move_dimension(var, dim_index, 0, &spare) != 0)
+            {
+                harp_spare_buffer_done(&spare);
+                return -1;
+            }
             if (product->dimension[harp_dimension_time] == 0)
             {
                 product->dimension[harp_dimension_time] = 1;
             }
             if (harp_variable_add_dimension(var, 0, harp_dimension_time, product->dimension[harp_dimension_time]))
             {
+                harp_spare_buffer_done(&spare);
                 return -1;
             }
-
-            dim_index++;
+            dim_index = 1;
         }
 
-        /* derive the new order of dimensions, splicing in dim_index at position 1 *if necessary* */
-        if (dim_index != 1)
+        /* move the dimension directly after time; this only updates the dimension info if the memory layout is not
+         * affected (e.g. when dim_index is already 1) */
+        if (harp_variable_move_dimension(var, dim_index, 1, &spare) != 0)
         {
-            order[0] = 0;
-            order[1] = dim_index;
-            for (j = 2; j < var->num_dimensions; j++)
-            {
-                if (j <= dim_index)
-                {
-                    order[j] = j - 1;
-                }
-                else
-                {
-                    order[j] = j;
-                }
-            }
-
-            /* reorder dimensions */
-            if (harp_array_transpose(var->data_type, var->num_dimensions, var->dimension, order, var->data) != 0)
-            {
-                return -1;
-            }
+            harp_spare_buffer_done(&spare);
+            return -1;
         }
+        dim_index = 1;
 
         /* update the dimension info */
         var->dimension[harp_dimension_time] *= var->dimension[dim_index];
@@ -1877,6 +2525,7 @@ LIBHARP_API int harp_product_flatten_dimension(harp_product *product, harp_dimen
 
         var->num_dimensions--;
     }
+    harp_spare_buffer_done(&spare);
 
     /* update the dimension info of the product */
     product->dimension[harp_dimension_time] *= dim_length;
@@ -1885,10 +2534,210 @@ LIBHARP_API int harp_product_flatten_dimension(harp_product *product, harp_dimen
     return 0;
 }
 
+/* Returns whether a variable is taken into account when determining which grid cells are empty */
+static int is_sparse_grid_variable(const harp_product *product, const harp_variable *variable)
+{
+    long name_length;
+
+    if (variable->data_type != harp_type_float && variable->data_type != harp_type_double)
+    {
+        return 0;
+    }
+    if (!harp_variable_has_dimension_type(variable, harp_dimension_latitude) &&
+        !harp_variable_has_dimension_type(variable, harp_dimension_longitude))
+    {
+        return 0;
+    }
+    if (product->dimension[harp_dimension_time] > 0 && (variable->num_dimensions == 0 ||
+                                                        variable->dimension_type[0] != harp_dimension_time))
+    {
+        /* static fields (such as a land/sea mask or the cell area) do not tell whether a grid cell has data */
+        return 0;
+    }
+    /* skip binning weights, which are never NaN */
+    name_length = (long)strlen(variable->name);
+    if (name_length >= 6 && strcmp(&variable->name[name_length - 6], "weight") == 0)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/** Convert a gridded product into a sparse representation in which only the non-empty grid cells are kept
+ *
+ * The latitude and longitude dimensions are flattened into the time dimension (see harp_product_flatten_dimension())
+ * and all resulting time samples for which each time dependent floating point variable that depended on latitude
+ * and/or longitude only contains NaN values are removed. Each remaining time sample thus represents a single grid cell
+ * (for a single time) that contains data, with the position of the cell given by the (now time dependent) latitude
+ * and longitude variables and their bounds.
+ * For mostly empty grids this considerably reduces the memory needed for the product and the size of exported files.
+ * A sparse product can be turned back into a grid using harp_product_bin_spatial() with the original grid edges.
+ *
+ * If the product does not depend on the latitude and longitude dimensions then the product is left unchanged.
+ * If none of the variables qualifies for determining whether a grid cell is empty, then all grid cells are kept.
+ *
+ * \param product HARP product.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_product_sparsify(harp_product *product)
+{
+    long num_time = product->dimension[harp_dimension_time];
+    long num_latitude = product->dimension[harp_dimension_latitude];
+    long num_longitude = product->dimension[harp_dimension_longitude];
+    long num_cells;
+    uint8_t *mask;
+    int has_grid_variable = 0;
+    long i;
+    int k;
+
+    if (num_latitude == 0 && num_longitude == 0)
+    {
+        return 0;
+    }
+
+    /* the time, latitude and longitude dimension end up flattened in this order (with time varying slowest) */
+    num_cells = (num_time > 0 ? num_time : 1) * (num_latitude > 0 ? num_latitude : 1) *
+        (num_longitude > 0 ? num_longitude : 1);
+    mask = (uint8_t *)calloc(num_cells, sizeof(uint8_t));
+    if (mask == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_cells * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (k = 0; k < product->num_variables; k++)
+    {
+        const harp_variable *variable = product->variable[k];
+        long stride[HARP_MAX_NUM_DIMS];
+        long length[HARP_MAX_NUM_DIMS];
+        int j;
+
+        if (!is_sparse_grid_variable(product, variable))
+        {
+            continue;
+        }
+        has_grid_variable = 1;
+
+        /* per dimension, the step in the flattened cell index for a step in that dimension */
+        for (j = 0; j < variable->num_dimensions; j++)
+        {
+            length[j] = variable->dimension[j];
+            switch (variable->dimension_type[j])
+            {
+                case harp_dimension_time:
+                    stride[j] = (num_latitude > 0 ? num_latitude : 1) * (num_longitude > 0 ? num_longitude : 1);
+                    break;
+                case harp_dimension_latitude:
+                    stride[j] = (num_longitude > 0 ? num_longitude : 1);
+                    break;
+                case harp_dimension_longitude:
+                    stride[j] = 1;
+                    break;
+                default:
+                    stride[j] = 0;
+                    break;
+            }
+        }
+
+        for (i = 0; i < variable->num_elements; i++)
+        {
+            long index = i;
+            long cell = 0;
+            int is_valid;
+
+            if (variable->data_type == harp_type_float)
+            {
+                is_valid = !harp_isnan(variable->data.float_data[i]);
+            }
+            else
+            {
+                is_valid = !harp_isnan(variable->data.double_data[i]);
+            }
+            if (!is_valid)
+            {
+                continue;
+            }
+            for (j = variable->num_dimensions - 1; j >= 0; j--)
+            {
+                cell += (index % length[j]) * stride[j];
+                index /= length[j];
+            }
+            mask[cell] = 1;
+        }
+    }
+
+    if (!has_grid_variable)
+    {
+        memset(mask, 1, num_cells);
+    }
+
+    if (harp_product_flatten_dimension(product, harp_dimension_latitude) != 0)
+    {
+        free(mask);
+        return -1;
+    }
+    if (harp_product_flatten_dimension(product, harp_dimension_longitude) != 0)
+    {
+        free(mask);
+        return -1;
+    }
+    if (product->dimension[harp_dimension_time] == 0)
+    {
+        /* a single grid cell without time dimension */
+        free(mask);
+        return 0;
+    }
+    assert(product->dimension[harp_dimension_time] == num_cells);
+
+    if (harp_product_filter_dimension(product, harp_dimension_time, mask) != 0)
+    {
+        free(mask);
+        return -1;
+    }
+
+    free(mask);
+
+    return 0;
+}
+
+/* apply the permutation to the given dimension of each variable using a single gather pass per variable (reusing the
+ * buffer that is released by one variable for the next one) */
+static int permute_dimension(harp_product *product, harp_dimension_type dimension_type, const long *permutation)
+{
+    harp_spare_buffer spare = { NULL, 0 };
+    int k;
+
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable = product->variable[k];
+        int j;
+
+        for (j = 0; j < variable->num_dimensions; j++)
+        {
+            if (variable->dimension_type[j] == dimension_type)
+            {
+                if (harp_variable_permute_dimension(variable, j, permutation, &spare) != 0)
+                {
+                    harp_spare_buffer_done(&spare);
+                    return -1;
+                }
+            }
+        }
+    }
+    harp_spare_buffer_done(&spare);
+
+    return 0;
+}
+
 /** Reorder a dimension for all variables in a product such that the variable with the given name ends up sorted.
  *
  * A variable for the provided variable_name should exist in the product and this variable should be a one dimensional
  * variable. The dimension that will be reordered is this single dimension of the referenced variable.
+ * The sort is stable (elements with equal values keep their relative order). NaN values end up at the end.
  *
  * \param product HARP product
  * \param variable_name Name of the variable to should end up sorted
@@ -1898,48 +2747,306 @@ LIBHARP_API int harp_product_flatten_dimension(harp_product *product, harp_dimen
  */
 LIBHARP_API int harp_product_sort(harp_product *product, const char *variable_name)
 {
-    long num_elements;
-    long *dim_element_ids;
+    return harp_product_sort_by_variables(product, 1, &variable_name);
+}
+
+/** Reorder a dimension for all variables in a product such that it ends up sorted by the given variables.
+ *
+ * The elements are sorted by the first variable, elements with equal values for the first variable are sorted by the
+ * second variable, etc. All variables should be one dimensional variables for the same dimension, which is the
+ * dimension that will be reordered. The sort is stable (elements with equal values for all variables keep their
+ * relative order). NaN values end up at the end.
+ *
+ * \param product HARP product
+ * \param num_variables Number of variables to sort by
+ * \param variable_name Names of the variables to sort by (most significant first)
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_sort_by_variables(harp_product *product, int num_variables, const char **variable_name)
+{
+    harp_dimension_type dimension_type = harp_dimension_independent;
+    harp_variable *variable;
+    long *permutation;
+    long num_elements = 0;
+    int needs_shuffle = 0;
     long i;
+    int k;
 
-    if (harp_product_get_variable_by_name(product, variable_name, &comparison_variable) != 0)
+    if (num_variables <= 0)
     {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_variables argument <= 0 (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
-    if (comparison_variable->num_dimensions != 1)
+    for (k = 0; k < num_variables; k++)
+    {
+        if (harp_product_get_variable_by_name(product, variable_name[k], &variable) != 0)
+        {
+            return -1;
+        }
+        if (variable->num_dimensions != 1)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable for sorting should be a one dimensional array");
+            return -1;
+        }
+        if (variable->dimension_type[0] == harp_dimension_independent)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot sort independent dimension");
+            return -1;
+        }
+        if (k == 0)
+        {
+            dimension_type = variable->dimension_type[0];
+            num_elements = variable->num_elements;
+        }
+        else if (variable->dimension_type[0] != dimension_type)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variables for sorting should all depend on the same "
+                           "dimension");
+            return -1;
+        }
+    }
+    if (num_elements == 0)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable for sorting should be a one dimensional array");
+        return 0;
+    }
+
+    permutation = malloc(num_elements * sizeof(long));
+    if (permutation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(long), __FILE__, __LINE__);
         return -1;
     }
-    if (comparison_variable->dimension_type[0] == harp_dimension_independent)
+    for (i = 0; i < num_elements; i++)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot sort independent dimension");
+        permutation[i] = i;
+    }
+
+    /* sort by the least significant variable first; since each sort is stable, the end result is sorted by all */
+    for (k = num_variables - 1; k >= 0; k--)
+    {
+        harp_product_get_variable_by_name(product, variable_name[k], &variable);
+        if (sort_permutation(variable, num_elements, permutation) != 0)
+        {
+            free(permutation);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < num_elements; i++)
+    {
+        if (permutation[i] != i)
+        {
+            needs_shuffle = 1;
+            break;
+        }
+    }
+    if (needs_shuffle)
+    {
+        if (permute_dimension(product, dimension_type, permutation) != 0)
+        {
+            free(permutation);
+            return -1;
+        }
+    }
+
+    free(permutation);
+
+    return 0;
+}
+
+/* Map a position on a 2^16 x 2^16 grid to its distance along a Hilbert curve that covers the grid */
+static uint32_t get_hilbert_index(uint32_t x, uint32_t y)
+{
+    uint32_t n = (uint32_t)1 << 16;
+    uint32_t d = 0;
+    uint32_t s;
+
+    for (s = n / 2; s > 0; s /= 2)
+    {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+
+        d += s * s * ((3 * rx) ^ ry);
+        /* rotate the quadrant such that the curve in the sub quadrant has the right orientation */
+        if (ry == 0)
+        {
+            uint32_t t;
+
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            t = x;
+            x = y;
+            y = t;
+        }
+    }
+
+    return d;
+}
+
+/* get a copy of a time dependent variable of the product, converted to double values in the given unit */
+static int get_time_coordinate(const harp_product *product, const char *name, const char *unit,
+                               harp_variable **coordinate)
+{
+    harp_variable *variable;
+
+    if (harp_product_get_variable_by_name(product, name, &variable) != 0)
+    {
+        return -1;
+    }
+    if (variable->num_dimensions != 1 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable '%s' should be one dimensional and depend on the time "
+                       "dimension", name);
+        return -1;
+    }
+    if (harp_variable_copy(variable, coordinate) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_convert_unit(*coordinate, unit) != 0)
+    {
+        harp_variable_delete(*coordinate);
         return -1;
     }
-    num_elements = comparison_variable->num_elements;
 
-    dim_element_ids = malloc(num_elements * sizeof(long));
-    if (dim_element_ids == NULL)
+    return 0;
+}
+
+/** Reorder the time dimension for all variables in a product such that samples that are close to each other on the
+ * Earth are also close to each other in the product.
+ * The samples are sorted by the position of their latitude and longitude along a Hilbert curve that covers the globe
+ * (with a resolution of 2^16 cells in both latitude and longitude). If \a time_step is positive, the samples are first
+ * grouped into intervals of time_step seconds (based on the datetime variable) and only sorted spatially within each
+ * interval.
+ * The sort is stable. Samples with a NaN latitude, longitude, or datetime end up at the end.
+ * Storing products in this order improves the locality of spatial subsets (e.g. for chunked reading or for the
+ * compression of neighbouring values).
+ * \param product HARP product.
+ * \param time_step Length of the time intervals in seconds (0 to sort the samples spatially only).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_product_sort_spatial(harp_product *product, double time_step)
+{
+    harp_variable *latitude;
+    harp_variable *longitude;
+    harp_variable *datetime = NULL;
+    sort_key *key;
+    sort_key *buffer;
+    sort_key *sorted_key;
+    long *permutation;
+    long num_elements = product->dimension[harp_dimension_time];
+    long i;
+
+    if (num_elements == 0)
+    {
+        return 0;
+    }
+    if (get_time_coordinate(product, "latitude", "degree_north", &latitude) != 0)
+    {
+        return -1;
+    }
+    if (get_time_coordinate(product, "longitude", "degree_east", &longitude) != 0)
+    {
+        harp_variable_delete(latitude);
+        return -1;
+    }
+    if (time_step > 0)
+    {
+        if (get_time_coordinate(product, "datetime", "s since 2000-01-01", &datetime) != 0)
+        {
+            harp_variable_delete(longitude);
+            harp_variable_delete(latitude);
+            return -1;
+        }
+    }
+
+    key = malloc(2 * num_elements * sizeof(sort_key));
+    if (key == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_elements * sizeof(long), __FILE__, __LINE__);
+                       2 * num_elements * sizeof(sort_key), __FILE__, __LINE__);
+        harp_variable_delete(datetime);
+        harp_variable_delete(longitude);
+        harp_variable_delete(latitude);
         return -1;
     }
+    buffer = &key[num_elements];
     for (i = 0; i < num_elements; i++)
     {
-        dim_element_ids[i] = i;
+        double latitude_value = latitude->data.double_data[i];
+        double longitude_value = longitude->data.double_data[i];
+        uint64_t interval = 0;
+        uint64_t position;
+
+        if (harp_isnan(latitude_value) || harp_isnan(longitude_value))
+        {
+            position = UINT32_MAX;
+        }
+        else
+        {
+            double x = harp_wrap(longitude_value, -180, 180);
+            double y = latitude_value;
+
+            HARP_CLAMP(y, -90, 90);
+            x = floor((x + 180) / 360 * 65536);
+            y = floor((y + 90) / 180 * 65536);
+            HARP_CLAMP(x, 0, 65535);
+            HARP_CLAMP(y, 0, 65535);
+            position = get_hilbert_index((uint32_t)x, (uint32_t)y);
+        }
+        if (datetime != NULL)
+        {
+            double value = datetime->data.double_data[i];
+
+            if (harp_isnan(value))
+            {
+                interval = UINT32_MAX;
+            }
+            else
+            {
+                value = floor(value / time_step) + 2147483648.0;
+                HARP_CLAMP(value, 0, 4294967294.0);
+                interval = (uint64_t)value;
+            }
+        }
+        key[i].value = (interval << 32) | position;
+        key[i].index = i;
     }
+    harp_variable_delete(datetime);
+    harp_variable_delete(longitude);
+    harp_variable_delete(latitude);
 
-    qsort(dim_element_ids, num_elements, sizeof(long), compare_variable_elements);
+    sorted_key = key;
+    radix_sort_keys(num_elements, &sorted_key, &buffer);
 
-    if (harp_product_rearrange_dimension(product, comparison_variable->dimension_type[0], num_elements, dim_element_ids)
-        != 0)
+    permutation = malloc(num_elements * sizeof(long));
+    if (permutation == NULL)
     {
-        free(dim_element_ids);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(long), __FILE__, __LINE__);
+        free(key);
         return -1;
     }
+    for (i = 0; i < num_elements; i++)
+    {
+        permutation[i] = sorted_key[i].index;
+    }
+    free(key);
 
-    free(dim_element_ids);
+    if (permute_dimension(product, harp_dimension_time, permutation) != 0)
+    {
+        free(permutation);
+        return -1;
+    }
+    free(permutation);
 
     return 0;
 }
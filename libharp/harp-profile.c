@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "harp-internal.h"
+#include "harp-thread.h"
+#include "hashtable.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Accumulated timings for the profiling mode (see harp_set_option_profile()).
+ * Entries are identified by name (e.g. an operation or an ingested variable) and are accumulated over all calls.
+ */
+
+typedef struct profile_entry_struct
+{
+    char *name;
+    long count;
+    double wall_time;
+    double cpu_time;
+    int64_t size_change;
+} profile_entry;
+
+static harp_mutex profile_mutex = HARP_MUTEX_INITIALIZER;
+static hashtable *profile_index = NULL;
+static profile_entry *profile_entries = NULL;
+static long profile_num_entries = 0;
+
+/* Add a measurement to the profile entry with the given name.
+ * Errors (i.e. out of memory) are ignored, since profiling should never make an operation fail.
+ */
+void harp_profile_add(const char *name, double wall_time, double cpu_time, int64_t size_change)
+{
+    long index;
+
+    harp_mutex_lock(&profile_mutex);
+    if (profile_index == NULL)
+    {
+        profile_index = hashtable_new(1);
+        if (profile_index == NULL)
+        {
+            harp_mutex_unlock(&profile_mutex);
+            return;
+        }
+    }
+    index = hashtable_get_index_from_name(profile_index, name);
+    if (index < 0)
+    {
+        profile_entry *entries;
+        char *entry_name;
+
+        if (profile_num_entries % BLOCK_SIZE == 0)
+        {
+            entries = realloc(profile_entries, (profile_num_entries + BLOCK_SIZE) * sizeof(profile_entry));
+            if (entries == NULL)
+            {
+                harp_mutex_unlock(&profile_mutex);
+                return;
+            }
+            profile_entries = entries;
+        }
+        entry_name = strdup(name);
+        if (entry_name == NULL)
+        {
+            harp_mutex_unlock(&profile_mutex);
+            return;
+        }
+        if (hashtable_add_name(profile_index, entry_name) != 0)
+        {
+            free(entry_name);
+            harp_mutex_unlock(&profile_mutex);
+            return;
+        }
+        index = profile_num_entries;
+        profile_entries[index].name = entry_name;
+        profile_entries[index].count = 0;
+        profile_entries[index].wall_time = 0;
+        profile_entries[index].cpu_time = 0;
+        profile_entries[index].size_change = 0;
+        profile_num_entries++;
+    }
+    profile_entries[index].count++;
+    profile_entries[index].wall_time += wall_time;
+    profile_entries[index].cpu_time += cpu_time;
+    profile_entries[index].size_change += size_change;
+    harp_mutex_unlock(&profile_mutex);
+}
+
+static int compare_entry_by_wall_time(const void *a, const void *b)
+{
+    const profile_entry *entry_a = (const profile_entry *)a;
+    const profile_entry *entry_b = (const profile_entry *)b;
+
+    if (entry_a->wall_time > entry_b->wall_time)
+    {
+        return -1;
+    }
+    if (entry_a->wall_time < entry_b->wall_time)
+    {
+        return 1;
+    }
+    return strcmp(entry_a->name, entry_b->name);
+}
+
+/* Print a summary table of all profile entries (sorted by decreasing wall time) to stderr and clear the profile.
+ */
+void harp_profile_done(void)
+{
+    long i;
+
+    harp_mutex_lock(&profile_mutex);
+    if (profile_num_entries > 0)
+    {
+        /* the hashtable refers to the entries by index, so it is deleted before the entries get reordered */
+        hashtable_delete(profile_index);
+        profile_index = NULL;
+        qsort(profile_entries, profile_num_entries, sizeof(profile_entry), compare_entry_by_wall_time);
+
+        fprintf(stderr, "HARP profile:\n");
+        fprintf(stderr, "%10s %14s %14s %20s  %s\n", "calls", "wall time [s]", "cpu time [s]", "size change [bytes]",
+                "name");
+        for (i = 0; i < profile_num_entries; i++)
+        {
+            fprintf(stderr, "%10ld %14.6f %14.6f %20ld  %s\n", profile_entries[i].count, profile_entries[i].wall_time,
+                    profile_entries[i].cpu_time, (long)profile_entries[i].size_change, profile_entries[i].name);
+            free(profile_entries[i].name);
+        }
+    }
+    if (profile_index != NULL)
+    {
+        hashtable_delete(profile_index);
+        profile_index = NULL;
+    }
+    if (profile_entries != NULL)
+    {
+        free(profile_entries);
+        profile_entries = NULL;
+    }
+    profile_num_entries = 0;
+    harp_mutex_unlock(&profile_mutex);
+}
@@ -37,9 +37,18 @@
 #include "harp-vertical-profiles.h"
 
 #include <assert.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* maximum length of the name under which an operation is recorded in the profile */
+#define MAX_PROFILE_NAME_LENGTH 256
+
+/* margin that is used when comparing filter values against a range of values from product metadata (i.e. days for
+ * datetime ranges and degrees for the spatial extent) */
+#define METADATA_RANGE_MARGIN 1e-6
+
 int harp_program_new(harp_program **new_program)
 {
     harp_program *program;
@@ -56,26 +65,28 @@ int harp_program_new(harp_program **new_program)
     program->operation = NULL;
     program->current_index = 0;
 
-    program->option_enable_aux_afgl86 = harp_get_option_enable_aux_afgl86();
-    program->option_enable_aux_usstd76 = harp_get_option_enable_aux_usstd76();
-    program->option_regrid_out_of_bounds = harp_get_option_regrid_out_of_bounds();
+    program->options.enable_aux_afgl86 = harp_get_option_enable_aux_afgl86();
+    program->options.enable_aux_usstd76 = harp_get_option_enable_aux_usstd76();
+    program->options.regrid_out_of_bounds = harp_get_option_regrid_out_of_bounds();
+    program->options.wgs84_point_distance = harp_get_option_wgs84_point_distance();
+    program->previous_options = NULL;
 
-    /* we only explicitly set the regrid_out_of_bounds option */
-    harp_set_option_regrid_out_of_bounds(0);
+    program->original_operation = NULL;
+    program->is_reordered = 0;
+    program->operations = NULL;
 
     *new_program = program;
     return 0;
 }
 
-void harp_program_delete(harp_program *program)
+/** Delete a HARP program.
+ * \ingroup harp_product
+ * \param program Program that should be deleted.
+ */
+LIBHARP_API void harp_program_delete(harp_program *program)
 {
     if (program != NULL)
     {
-        /* reset global HARP options to initial values */
-        harp_set_option_enable_aux_afgl86(program->option_enable_aux_afgl86);
-        harp_set_option_enable_aux_usstd76(program->option_enable_aux_usstd76);
-        harp_set_option_regrid_out_of_bounds(program->option_regrid_out_of_bounds);
-
         if (program->operation != NULL)
         {
             int i;
@@ -87,13 +98,75 @@ void harp_program_delete(harp_program *program)
 
             free(program->operation);
         }
+        if (program->original_operation != NULL)
+        {
+            free(program->original_operation);
+        }
+        if (program->operations != NULL)
+        {
+            free(program->operations);
+        }
 
         free(program);
     }
 }
 
+static void restore_operation_order(harp_program *program)
+{
+    if (program->is_reordered)
+    {
+        memcpy(program->operation, program->original_operation, program->num_operations * sizeof(harp_operation *));
+        program->is_reordered = 0;
+    }
+}
+
+/* Prepare a program for (another) execution.
+ * This resets the program to its first operation and gives the execution its own copy of the HARP options that can be
+ * modified by the operations of the program (initialized with the options that are currently in effect for the
+ * calling thread). Until harp_program_end_execution() is called, the calling thread uses this copy, such that set()
+ * operations never modify the process-wide options or the options of executions on other threads.
+ * A program can only be executed by one thread at a time.
+ */
+void harp_program_start_execution(harp_program *program)
+{
+    restore_operation_order(program);
+    program->current_index = 0;
+
+    program->options.enable_aux_afgl86 = harp_get_option_enable_aux_afgl86();
+    program->options.enable_aux_usstd76 = harp_get_option_enable_aux_usstd76();
+    program->options.wgs84_point_distance = harp_get_option_wgs84_point_distance();
+    /* we only explicitly set the regrid_out_of_bounds option */
+    program->options.regrid_out_of_bounds = 0;
+
+    program->previous_options = harp_get_execution_options();
+    harp_set_execution_options(&program->options);
+}
+
+/* Make the calling thread use the HARP options that were in effect when harp_program_start_execution() was called and
+ * undo any reordering of operations that was performed during the execution.
+ */
+void harp_program_end_execution(harp_program *program)
+{
+    restore_operation_order(program);
+    harp_set_execution_options(program->previous_options);
+    program->previous_options = NULL;
+}
+
 int harp_program_add_operation(harp_program *program, harp_operation *operation)
 {
+    restore_operation_order(program);
+    if (program->original_operation != NULL)
+    {
+        free(program->original_operation);
+        program->original_operation = NULL;
+    }
+    /* the program no longer corresponds to the operations string it was created from */
+    if (program->operations != NULL)
+    {
+        free(program->operations);
+        program->operations = NULL;
+    }
+
     if (program->num_operations % BLOCK_SIZE == 0)
     {
         harp_operation **operation;
@@ -116,778 +189,1097 @@ int harp_program_add_operation(harp_program *program, harp_operation *operation)
     return 0;
 }
 
-static int execute_value_filter(harp_product *product, harp_program *program)
+static int get_variable_name_index(int num_variables, const char **variable_name, const char *name)
 {
-    harp_dimension_mask_set *dimension_mask_set = NULL;
-    harp_variable *variable;
-    const char *variable_name;
-    int num_operations = 1;
-    int data_type_size;
-    long i, j;
-    int k;
+    int i;
 
-    if (harp_operation_get_variable_name(program->operation[program->current_index], &variable_name) != 0)
+    for (i = 0; i < num_variables; i++)
     {
-        return -1;
+        if (strcmp(variable_name[i], name) == 0)
+        {
+            return i;
+        }
     }
 
-    /* if the next operations are also value filters on the same variable then include them */
-    while (program->current_index + num_operations < program->num_operations)
+    return -1;
+}
+
+/* Determine which variables of a product need to be read when the product is imported for the given program.
+ * This evaluates the keep() and exclude() operations at the start of the program (the program may be NULL) on the
+ * list of names of all variables in the product. On return, include[i] is 0 if variable i would be removed by these
+ * operations and 1 otherwise. If the operations would fail (e.g. by trying to keep a non-existent variable) or would
+ * remove all variables, then all variables are included, such that executing the program on the imported product
+ * behaves exactly as if all variables were read.
+ */
+void harp_program_get_included_variables(const harp_program *program, int num_variables, const char **variable_name,
+                                         uint8_t *include)
+{
+    int num_included = num_variables;
+    int i, j;
+
+    for (i = 0; i < num_variables; i++)
+    {
+        include[i] = 1;
+    }
+
+    if (program == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < program->num_operations && num_included > 0; i++)
     {
-        const char *next_variable_name;
+        const harp_operation *operation = program->operation[i];
 
-        if (!harp_operation_is_value_filter(program->operation[program->current_index + num_operations]))
+        if (operation->type == operation_exclude_variable)
         {
-            break;
+            const harp_operation_exclude_variable *exclude = (const harp_operation_exclude_variable *)operation;
+
+            for (j = 0; j < exclude->num_variables; j++)
+            {
+                int index = get_variable_name_index(num_variables, variable_name, exclude->variable_name[j]);
+
+                if (index >= 0 && include[index])
+                {
+                    include[index] = 0;
+                    num_included--;
+                }
+            }
         }
-        if (harp_operation_get_variable_name(program->operation[program->current_index + num_operations],
-                                             &next_variable_name) != 0)
+        else if (operation->type == operation_keep_variable)
         {
-            return -1;
+            const harp_operation_keep_variable *keep = (const harp_operation_keep_variable *)operation;
+
+            for (j = 0; j < keep->num_variables; j++)
+            {
+                int index = get_variable_name_index(num_variables, variable_name, keep->variable_name[j]);
+
+                if (index < 0 || !include[index])
+                {
+                    /* leave it to the program to report the error */
+                    num_included = 0;
+                    break;
+                }
+            }
+            for (j = 0; j < num_variables && num_included > 0; j++)
+            {
+                if (include[j] && get_variable_name_index(keep->num_variables, (const char **)keep->variable_name,
+                                                          variable_name[j]) < 0)
+                {
+                    include[j] = 0;
+                    num_included--;
+                }
+            }
         }
-        if (strcmp(variable_name, next_variable_name) != 0)
+        else
         {
             break;
         }
-        num_operations++;
     }
 
-    if (harp_product_get_variable_by_name(product, variable_name, &variable) != 0)
+    if (num_included == 0)
     {
-        return -1;
+        for (i = 0; i < num_variables; i++)
+        {
+            include[i] = 1;
+        }
     }
-    data_type_size = harp_get_size_for_type(variable->data_type);
+}
 
-    if (variable->unit != NULL)
+/* Determine which variables of a product remain after executing a program that only consists of keep() and exclude()
+ * operations, without modifying the product. On return, include[i] is 1 if variable i of the product remains and 0
+ * otherwise. Returns 1 if the program only consists of keep() and exclude() operations, 0 if it contains any other
+ * operation (in which case include is not set), and -1 if executing the program would fail.
+ */
+int harp_program_get_projected_variables(const harp_program *program, const harp_product *product, uint8_t *include)
+{
+    int i, j;
+
+    for (i = 0; i < program->num_operations; i++)
     {
-        for (k = 0; k < num_operations; k++)
+        if (program->operation[i]->type != operation_exclude_variable &&
+            program->operation[i]->type != operation_keep_variable)
         {
-            if (harp_operation_set_value_unit(program->operation[program->current_index + k], variable->unit) != 0)
-            {
-                return -1;
-            }
+            return 0;
         }
     }
 
-    if (variable->num_dimensions == 0)
+    for (i = 0; i < product->num_variables; i++)
     {
-        for (k = 0; k < num_operations; k++)
+        include[i] = 1;
+    }
+
+    for (i = 0; i < program->num_operations; i++)
+    {
+        const harp_operation *operation = program->operation[i];
+        int index;
+
+        if (operation->type == operation_exclude_variable)
         {
-            int result;
+            const harp_operation_exclude_variable *exclude = (const harp_operation_exclude_variable *)operation;
 
-            if (harp_operation_is_string_value_filter(program->operation[program->current_index + k]))
+            for (j = 0; j < exclude->num_variables; j++)
             {
-                harp_operation_string_value_filter *operation;
-
-                operation = (harp_operation_string_value_filter *)program->operation[program->current_index + k];
-                result = operation->eval(operation, variable->num_enum_values, variable->enum_name,
-                                         variable->data_type, variable->data.ptr);
+                if (harp_product_get_variable_index_by_name(product, exclude->variable_name[j], &index) == 0)
+                {
+                    include[index] = 0;
+                }
             }
-            else
-            {
-                harp_operation_numeric_value_filter *operation;
+        }
+        else
+        {
+            const harp_operation_keep_variable *keep = (const harp_operation_keep_variable *)operation;
 
-                operation = (harp_operation_numeric_value_filter *)program->operation[program->current_index + k];
-                result = operation->eval(operation, variable->data_type, variable->data.ptr);
-            }
-            if (result < 0)
+            for (j = 0; j < keep->num_variables; j++)
             {
-                return -1;
+                if (harp_product_get_variable_index_by_name(product, keep->variable_name[j], &index) != 0 ||
+                    include[index] == 0)
+                {
+                    harp_set_error(HARP_ERROR_OPERATION, "cannot keep non-existent variable %s",
+                                   keep->variable_name[j]);
+                    return -1;
+                }
+                /* mark the kept variables (that are still included) with 2 */
+                include[index] = 2;
             }
-            if (result == 0)
+            for (j = 0; j < product->num_variables; j++)
             {
-                /* the full product is masked out so remove all variables to make it empty */
-                harp_product_remove_all_variables(product);
-                return 0;
+                include[j] = (include[j] == 2);
             }
         }
     }
-    else if (variable->num_dimensions == 1 && variable->dimension_type[0] != harp_dimension_independent)
-    {
-        harp_dimension_mask *dimension_mask;
 
-        if (harp_dimension_mask_set_new(&dimension_mask_set) != 0)
-        {
-            return -1;
-        }
+    return 1;
+}
 
-        if (harp_dimension_mask_new(variable->num_dimensions, variable->dimension, &dimension_mask) != 0)
-        {
-            return -1;
-        }
-        dimension_mask_set[variable->dimension_type[0]] = dimension_mask;
+/* Apply a single value filter to all elements of the variable and update the mask accordingly */
+static int apply_value_filter(harp_operation *operation, harp_variable *variable, uint8_t *mask)
+{
+    if (harp_operation_is_string_value_filter(operation))
+    {
+        harp_operation_string_value_filter *string_operation = (harp_operation_string_value_filter *)operation;
+        int data_type_size = harp_get_size_for_type(variable->data_type);
+        long i;
 
         for (i = 0; i < variable->num_elements; i++)
         {
-            for (k = 0; k < num_operations; k++)
+            if (mask[i])
             {
-                if (dimension_mask->mask[i])
-                {
-                    harp_operation *operation;
-                    int result;
-
-                    operation = program->operation[program->current_index + k];
-                    if (harp_operation_is_string_value_filter(operation))
-                    {
-                        harp_operation_string_value_filter *string_operation;
-
-                        string_operation = (harp_operation_string_value_filter *)operation;
-                        result = string_operation->eval(string_operation, variable->num_enum_values,
-                                                        variable->enum_name, variable->data_type,
-                                                        &variable->data.int8_data[i * data_type_size]);
-                    }
-                    else
-                    {
-                        harp_operation_numeric_value_filter *numeric_operation;
+                int result;
 
-                        numeric_operation = (harp_operation_numeric_value_filter *)operation;
-                        result = numeric_operation->eval(numeric_operation, variable->data_type,
-                                                         &variable->data.int8_data[i * data_type_size]);
-                    }
-                    if (result < 0)
-                    {
-                        harp_dimension_mask_set_delete(dimension_mask_set);
-                        return -1;
-                    }
-                    dimension_mask->mask[i] = result;
+                result = string_operation->eval(string_operation, variable->num_enum_values, variable->enum_name,
+                                                variable->data_type, &variable->data.int8_data[i * data_type_size]);
+                if (result < 0)
+                {
+                    return -1;
                 }
-            }
-            if (!dimension_mask->mask[i])
-            {
-                dimension_mask->masked_dimension_length--;
+                mask[i] = result;
             }
         }
 
-        if (harp_product_filter(product, dimension_mask_set) != 0)
+        return 0;
+    }
+
+    return harp_operation_filter_numeric_values(operation, variable->data_type, variable->num_elements,
+                                                variable->data.ptr, mask);
+}
+
+/* Determine the range [*first_filter, *first_filter + *num_filters) of the value filters that directly follow the
+ * keep() and exclude() operations at the start of the program.
+ * Collocation filters (collocate_left/collocate_right) are included as well; they act as a filter on 'index'.
+ */
+static void get_leading_value_filters(const harp_program *program, int *first_filter, int *num_filters)
+{
+    int i = 0;
+
+    while (i < program->num_operations && (program->operation[i]->type == operation_exclude_variable ||
+                                           program->operation[i]->type == operation_keep_variable))
+    {
+        i++;
+    }
+    *first_filter = i;
+
+    while (i < program->num_operations && (harp_operation_is_value_filter(program->operation[i]) ||
+                                           program->operation[i]->type == operation_collocation_filter))
+    {
+        i++;
+    }
+    *num_filters = i - *first_filter;
+}
+
+/* Returns 1 if the variable is used by one of the value filters that directly follow the keep() and exclude()
+ * operations at the start of the program (the program may be NULL), and 0 otherwise.
+ */
+int harp_program_is_leading_value_filter_variable(const harp_program *program, const char *variable_name)
+{
+    int first_filter;
+    int num_filters;
+    int i;
+
+    if (program == NULL)
+    {
+        return 0;
+    }
+
+    get_leading_value_filters(program, &first_filter, &num_filters);
+    for (i = first_filter; i < first_filter + num_filters; i++)
+    {
+        const char *filter_variable_name;
+
+        if (harp_operation_get_variable_name(program->operation[i], &filter_variable_name) == 0 &&
+            strcmp(filter_variable_name, variable_name) == 0)
         {
-            harp_dimension_mask_set_delete(dimension_mask_set);
-            return -1;
+            return 1;
         }
+    }
 
-        harp_dimension_mask_set_delete(dimension_mask_set);
+    return 0;
+}
+
+/* Determine the smallest range of time indices that contains all samples that pass the value filters that directly
+ * follow the keep() and exclude() operations at the start of the program.
+ * Only filters on one-dimensional time dependent variables that are available in product are taken into account (the
+ * other filters can only reduce the range further). This allows importers to only read the time samples in the range
+ * [*offset, *offset + *length) for all time dependent variables; the program itself still needs to be executed on the
+ * imported product. If no sample passes the filters then the full time range is returned (such that the regular
+ * execution of the program determines the result).
+ * Collocation filters are only taken into account if the product has an int32 'index' variable and a source_product
+ * (a positional index can not be reconstructed once only a part of the time samples is read).
+ */
+int harp_program_get_leading_value_filter_time_range(harp_program *program, harp_product *product, long *offset,
+                                                     long *length)
+{
+    uint8_t *mask;
+    long num_samples;
+    long first;
+    long last;
+    int first_filter;
+    int num_filters;
+    int i;
+
+    num_samples = product->dimension[harp_dimension_time];
+    *offset = 0;
+    *length = num_samples;
+    if (program == NULL || num_samples == 0)
+    {
+        return 0;
     }
-    else if (variable->num_dimensions == 2 && variable->dimension_type[0] == harp_dimension_time &&
-             variable->dimension_type[1] != harp_dimension_independent &&
-             variable->dimension_type[1] != harp_dimension_time)
+
+    mask = (uint8_t *)malloc(num_samples * sizeof(uint8_t));
+    if (mask == NULL)
     {
-        harp_dimension_type dimension_type;
-        harp_dimension_mask *time_mask;
-        harp_dimension_mask *dimension_mask;
-        long index = 0;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_samples * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    memset(mask, 1, num_samples * sizeof(uint8_t));
 
-        dimension_type = variable->dimension_type[1];
+    get_leading_value_filters(program, &first_filter, &num_filters);
+    for (i = first_filter; i < first_filter + num_filters; i++)
+    {
+        harp_operation *operation = program->operation[i];
+        harp_variable *variable;
+        const char *variable_name;
 
-        if (harp_dimension_mask_set_new(&dimension_mask_set) != 0)
+        if (harp_operation_get_variable_name(operation, &variable_name) != 0)
         {
+            free(mask);
             return -1;
         }
-
-        if (harp_dimension_mask_new(1, variable->dimension, &dimension_mask_set[harp_dimension_time]) != 0)
+        if (!harp_product_has_variable(product, variable_name))
         {
-            return -1;
+            /* filter can not be evaluated on this product; leave it to the regular execution of the program */
+            continue;
         }
-        time_mask = dimension_mask_set[harp_dimension_time];
-
-        if (harp_dimension_mask_new(variable->num_dimensions, variable->dimension, &dimension_mask_set[dimension_type])
-            != 0)
+        if (harp_product_get_variable_by_name(product, variable_name, &variable) != 0)
         {
+            free(mask);
             return -1;
         }
-        dimension_mask = dimension_mask_set[dimension_type];
-
-        dimension_mask->masked_dimension_length = 0;
-        for (i = 0; i < variable->dimension[0]; i++)
+        if (variable->num_dimensions != 1 || variable->dimension_type[0] != harp_dimension_time)
         {
-            long new_dimension_length = 0;
-
-            for (j = 0; j < variable->dimension[1]; j++)
+            continue;
+        }
+        if (operation->type == operation_collocation_filter)
+        {
+            if (variable->data_type != harp_type_int32 || product->source_product == NULL)
             {
-                for (k = 0; k < num_operations; k++)
-                {
-                    if (dimension_mask->mask[index])
-                    {
-                        harp_operation *operation;
-                        int result;
-
-                        operation = program->operation[program->current_index + k];
-                        if (harp_operation_is_string_value_filter(operation))
-                        {
-                            harp_operation_string_value_filter *string_operation;
-
-                            string_operation = (harp_operation_string_value_filter *)operation;
-                            result = string_operation->eval(string_operation, variable->num_enum_values,
-                                                            variable->enum_name, variable->data_type,
-                                                            &variable->data.int8_data[index * data_type_size]);
-                        }
-                        else
-                        {
-                            harp_operation_numeric_value_filter *numeric_operation;
-
-                            numeric_operation = (harp_operation_numeric_value_filter *)operation;
-                            result = numeric_operation->eval(numeric_operation, variable->data_type,
-                                                             &variable->data.int8_data[index * data_type_size]);
-                        }
-                        if (result < 0)
-                        {
-                            harp_dimension_mask_set_delete(dimension_mask_set);
-                            return -1;
-                        }
-                        dimension_mask->mask[index] = result;
-                    }
-                }
-                if (dimension_mask->mask[index])
-                {
-                    new_dimension_length++;
-                }
-                index++;
+                continue;
             }
-            if (new_dimension_length == 0)
+            /* select the collocation mask for this product (this also sets the index values to filter on) */
+            if (harp_operation_prepare_collocation_filter(operation, product->source_product) != 0)
             {
-                time_mask->mask[i] = 0;
-                time_mask->masked_dimension_length--;
+                free(mask);
+                return -1;
             }
-            else if (new_dimension_length > dimension_mask->masked_dimension_length)
+        }
+        else if (variable->unit != NULL)
+        {
+            if (harp_operation_set_value_unit(operation, variable->unit) != 0)
             {
-                dimension_mask->masked_dimension_length = new_dimension_length;
+                free(mask);
+                return -1;
             }
         }
-
-        if (harp_product_filter(product, dimension_mask_set) != 0)
+        if (apply_value_filter(operation, variable, mask) != 0)
         {
-            harp_dimension_mask_set_delete(dimension_mask_set);
+            free(mask);
             return -1;
         }
+    }
 
-        harp_dimension_mask_set_delete(dimension_mask_set);
+    for (first = 0; first < num_samples && !mask[first]; first++)
+    {
     }
-    else
+    for (last = num_samples - 1; last > first && !mask[last]; last--)
     {
-        harp_set_error(HARP_ERROR_OPERATION, "variable '%s' has invalid dimensions for filtering", variable_name);
-        return -1;
     }
+    free(mask);
 
-    /* jump to the last operation in the list that we performed */
-    program->current_index += num_operations - 1;
+    if (first < num_samples)
+    {
+        *offset = first;
+        *length = last - first + 1;
+    }
 
     return 0;
 }
 
-static int execute_point_filter(harp_product *product, harp_program *program)
+/* Returns whether a sample value in the range [range_min, range_max] can pass a comparison/membership filter for
+ * the given (already converted) filter values.
+ */
+static int range_can_pass_filter(const harp_operation *operation, double range_min, double range_max, int num_values,
+                                 const double *value)
 {
-    harp_dimension_type dimension_type = harp_dimension_time;
-    harp_data_type data_type = harp_type_double;
-    harp_variable *latitude;
-    harp_variable *longitude;
-    uint8_t *mask;
-    int num_operations = 1;
-    long num_points;
-    long i;
-    int k;
+    int i;
 
-    if (harp_product_get_derived_variable(product, "latitude", &data_type, "degree_north", 1, &dimension_type,
-                                          &latitude) != 0)
+    if (operation->type == operation_comparison_filter)
     {
-        return -1;
+        switch (((const harp_operation_comparison_filter *)operation)->operator_type)
+        {
+            case operator_eq:
+                return range_min <= value[0] && value[0] <= range_max;
+            case operator_ne:
+                return !(range_min == value[0] && range_max == value[0]);
+            case operator_lt:
+                return range_min < value[0];
+            case operator_le:
+                return range_min <= value[0];
+            case operator_gt:
+                return range_max > value[0];
+            case operator_ge:
+                return range_max >= value[0];
+        }
+        return 1;
     }
-    if (harp_product_get_derived_variable(product, "longitude", &data_type, "degree_east", 1, &dimension_type,
-                                          &longitude) != 0)
+
+    assert(operation->type == operation_membership_filter);
+    if (((const harp_operation_membership_filter *)operation)->operator_type == operator_not_in)
     {
-        harp_variable_delete(latitude);
-        return -1;
+        return 1;
     }
-
-    num_points = latitude->dimension[0];
-
-    /* if the next operations are also point filters then include them */
-    while (program->current_index + num_operations < program->num_operations)
+    for (i = 0; i < num_values; i++)
     {
-        if (!harp_operation_is_point_filter(program->operation[program->current_index + num_operations]))
+        if (range_min <= value[i] && value[i] <= range_max)
         {
-            break;
+            return 1;
         }
-        num_operations++;
     }
 
-    mask = (uint8_t *)malloc(num_points * sizeof(uint8_t));
-    if (mask == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_points * sizeof(uint8_t), __FILE__, __LINE__);
-        return -1;
-    }
+    return 0;
+}
 
-    for (i = 0; i < num_points; i++)
+/* Determine whether samples of a product for which all values of the given variables (NULL terminated list of names)
+ * are within [range_min, range_max] (in the given unit) can pass the value filters that directly follow the keep()
+ * and exclude() operations at the start of the program.
+ * Only comparison and membership filters that have an explicit unit are taken into account. Filters for which the unit
+ * can not be converted are ignored (the regular execution of the program will report the error).
+ * Returns 1 if samples can pass the filters and 0 if all samples will be removed by the filters.
+ */
+static int value_range_can_pass(const harp_program *program, const char **range_variable_name, const char *range_unit,
+                                double range_min, double range_max)
+{
+    int first_filter;
+    int num_filters;
+    int i;
+
+    if (harp_isnan(range_min) || harp_isnan(range_max))
     {
-        harp_spherical_point point;
+        return 1;
+    }
 
-        point.lat = latitude->data.double_data[i];
-        point.lon = longitude->data.double_data[i];
-        harp_spherical_point_rad_from_deg(&point);
-        harp_spherical_point_check(&point);
+    get_leading_value_filters(program, &first_filter, &num_filters);
+    for (i = first_filter; i < first_filter + num_filters; i++)
+    {
+        harp_operation *operation = program->operation[i];
+        const char *variable_name;
+        const char *unit;
+        double *value;
+        int num_values;
+        int j;
 
-        mask[i] = 1;
-        for (k = 0; k < num_operations; k++)
+        if (operation->type == operation_comparison_filter)
         {
-            if (mask[i])
+            variable_name = ((harp_operation_comparison_filter *)operation)->variable_name;
+            unit = ((harp_operation_comparison_filter *)operation)->unit;
+            num_values = 1;
+        }
+        else if (operation->type == operation_membership_filter)
+        {
+            variable_name = ((harp_operation_membership_filter *)operation)->variable_name;
+            unit = ((harp_operation_membership_filter *)operation)->unit;
+            num_values = ((harp_operation_membership_filter *)operation)->num_values;
+        }
+        else
+        {
+            continue;
+        }
+        if (unit == NULL || num_values == 0)
+        {
+            continue;
+        }
+        for (j = 0; range_variable_name[j] != NULL; j++)
+        {
+            if (strcmp(variable_name, range_variable_name[j]) == 0)
             {
-                harp_operation_point_filter *operation;
-                int result;
+                break;
+            }
+        }
+        if (range_variable_name[j] == NULL)
+        {
+            continue;
+        }
 
-                operation = (harp_operation_point_filter *)program->operation[program->current_index + k];
-                result = operation->eval(operation, &point);
-                if (result < 0)
-                {
-                    harp_variable_delete(latitude);
-                    harp_variable_delete(longitude);
-                    free(mask);
-                    return -1;
-                }
-                mask[i] = result;
+        value = malloc(num_values * sizeof(double));
+        if (value == NULL)
+        {
+            /* just don't use the filter */
+            continue;
+        }
+        if (operation->type == operation_comparison_filter)
+        {
+            value[0] = ((harp_operation_comparison_filter *)operation)->value;
+        }
+        else
+        {
+            for (j = 0; j < num_values; j++)
+            {
+                value[j] = ((harp_operation_membership_filter *)operation)->value[j];
+            }
+        }
+        if (harp_convert_unit(unit, range_unit, num_values, value) == 0)
+        {
+            /* widen the range slightly to allow for rounding differences between the unit conversions */
+            if (!range_can_pass_filter(operation, range_min - METADATA_RANGE_MARGIN, range_max + METADATA_RANGE_MARGIN,
+                                       num_values, value))
+            {
+                free(value);
+                return 0;
             }
         }
+        free(value);
     }
 
-    harp_variable_delete(latitude);
-    harp_variable_delete(longitude);
+    return 1;
+}
 
-    if (harp_product_filter_dimension(product, harp_dimension_time, mask) != 0)
+/* Determine whether samples of a product that covers the datetime range [datetime_start, datetime_stop] (in days
+ * since 2000-01-01, e.g. as provided by the product metadata) can pass the leading value filters of the program.
+ * Only filters on datetime, datetime_start, and datetime_stop are taken into account (the values of these variables
+ * are all within the datetime range of the product); see value_range_can_pass().
+ * Returns 1 if samples can pass the filters and 0 if all samples will be removed by the filters.
+ */
+int harp_program_datetime_range_can_pass(const harp_program *program, double datetime_start, double datetime_stop)
+{
+    const char *variable_name[] = { "datetime", "datetime_start", "datetime_stop", NULL };
+
+    if (program == NULL)
     {
-        free(mask);
-        return -1;
+        return 1;
     }
-    free(mask);
-
-    /* jump to the last operation in the list that we performed */
-    program->current_index += num_operations - 1;
 
-    return 0;
+    return value_range_can_pass(program, variable_name, "days since 2000-01-01", datetime_start, datetime_stop);
 }
 
-static int execute_polygon_filter(harp_product *product, harp_program *program)
+/* Determine whether samples of a product with the given spatial extent (in degree_north/degree_east, e.g. as provided
+ * by the product metadata; NaN values mean that the extent is unknown) can pass the leading value filters of the
+ * program. Only filters on latitude, latitude_bounds, longitude, and longitude_bounds are taken into account; see
+ * value_range_can_pass(). Note that longitude values are compared as is (i.e. without wrapping).
+ * Returns 1 if samples can pass the filters and 0 if all samples will be removed by the filters.
+ */
+int harp_program_spatial_extent_can_pass(const harp_program *program, double latitude_min, double latitude_max,
+                                         double longitude_min, double longitude_max)
 {
-    harp_dimension_type dimension_type[2] = { harp_dimension_time, harp_dimension_independent };
-    harp_data_type data_type = harp_type_double;
-    harp_variable *latitude_bounds;
-    harp_variable *longitude_bounds;
-    uint8_t *mask;
-    int num_operations = 1;
-    long num_areas;
-    long num_points;
-    long i;
-    int k;
+    const char *latitude_name[] = { "latitude", "latitude_bounds", NULL };
+    const char *longitude_name[] = { "longitude", "longitude_bounds", NULL };
 
-    if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, "degree_north", 2, dimension_type,
-                                          &latitude_bounds) != 0)
-    {
-        return -1;
-    }
-    if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, "degree_east", 2, dimension_type,
-                                          &longitude_bounds) != 0)
+    if (program == NULL)
     {
-        harp_variable_delete(latitude_bounds);
-        return -1;
+        return 1;
     }
 
-    if (latitude_bounds->dimension[1] != longitude_bounds->dimension[1])
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "the length of the independent dimension of variable "
-                       "'latitude_bounds' (%ld) does not match the length of the independent dimension of variable "
-                       "'longitude_bounds' (%ld)", latitude_bounds->dimension[1], longitude_bounds->dimension[1]);
-        harp_variable_delete(latitude_bounds);
-        harp_variable_delete(longitude_bounds);
-        return -1;
-    }
-    if (latitude_bounds->dimension[1] < 3)
+    return value_range_can_pass(program, latitude_name, "degree_north", latitude_min, latitude_max) &&
+        value_range_can_pass(program, longitude_name, "degree_east", longitude_min, longitude_max);
+}
+
+/* Verify that executing the program on consecutive parts of the time dimension of a product, and concatenating the
+ * results, gives the same result as executing the program on the full product. This is the case if each operation
+ * treats each time sample independently of all other time samples.
+ * Returns 0 if this is the case, and -1 (with HARP_ERROR_OPERATION) otherwise.
+ */
+int harp_program_verify_sample_independent(const harp_program *program)
+{
+    int i;
+
+    if (program == NULL)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "the length of the independent dimension of variables "
-                       "'latitude_bounds' and 'longitude_bounds' should be 3 or more");
-        harp_variable_delete(latitude_bounds);
-        harp_variable_delete(longitude_bounds);
-        return -1;
+        return 0;
     }
 
-    num_areas = latitude_bounds->dimension[0];
-    num_points = latitude_bounds->dimension[1];
-
-    /* if the next operations are also polygon filters then include them */
-    while (program->current_index + num_operations < program->num_operations)
+    for (i = 0; i < program->num_operations; i++)
     {
-        if (!harp_operation_is_polygon_filter(program->operation[program->current_index + num_operations]))
+        const harp_operation *operation = program->operation[i];
+        harp_dimension_type dimension_type = harp_dimension_independent;
+
+        switch (operation->type)
         {
-            break;
+            case operation_bin_collocated:
+            case operation_bin_full:
+            case operation_bin_spatial:
+            case operation_bin_with_variable:
+            case operation_sort:
+            case operation_sort_spatial:
+                harp_set_error(HARP_ERROR_OPERATION, "operation %d combines time samples and can not be performed on "
+                               "a part of a product", i + 1);
+                return -1;
+            case operation_flatten:
+                dimension_type = ((const harp_operation_flatten *)operation)->dimension_type;
+                break;
+            case operation_regrid:
+                dimension_type = ((const harp_operation_regrid *)operation)->axis_variable->dimension_type[0];
+                break;
+            case operation_regrid_collocated_dataset:
+                dimension_type = ((const harp_operation_regrid_collocated_dataset *)operation)->dimension_type;
+                break;
+            case operation_regrid_collocated_product:
+                dimension_type = ((const harp_operation_regrid_collocated_product *)operation)->dimension_type;
+                break;
+            case operation_smooth_collocated_dataset:
+                dimension_type = ((const harp_operation_smooth_collocated_dataset *)operation)->dimension_type;
+                break;
+            case operation_smooth_collocated_product:
+                dimension_type = ((const harp_operation_smooth_collocated_product *)operation)->dimension_type;
+                break;
+            default:
+                break;
+        }
+        if (dimension_type == harp_dimension_time)
+        {
+            harp_set_error(HARP_ERROR_OPERATION, "operation %d acts along the time dimension and can not be "
+                           "performed on a part of a product", i + 1);
+            return -1;
         }
-        num_operations++;
     }
 
-    mask = (uint8_t *)malloc(latitude_bounds->dimension[0] * sizeof(uint8_t));
-    if (mask == NULL)
+    return 0;
+}
+
+/* Evaluate the value filters [first_index, first_index + num_operations) on 'variable' and combine the result with the
+ * dimension mask of the dimension that the variable depends on.
+ * The masks are only combined here; applying them to the product is left to the caller.
+ * Returns 1 if the product is (partially) retained, 0 if the full product is masked out, and -1 on error.
+ */
+static int add_value_filter_to_mask_set(harp_program *program, int first_index, int num_operations,
+                                        harp_variable *variable, harp_dimension_mask_set *dimension_mask_set)
+{
+    harp_dimension_mask *dimension_mask;
+    harp_dimension_type dimension_type;
+    int k;
+
+    if (variable->num_dimensions == 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       latitude_bounds->dimension[0] * sizeof(uint8_t), __FILE__, __LINE__);
-        return -1;
+        for (k = 0; k < num_operations; k++)
+        {
+            int result;
+
+            if (harp_operation_is_string_value_filter(program->operation[first_index + k]))
+            {
+                harp_operation_string_value_filter *operation;
+
+                operation = (harp_operation_string_value_filter *)program->operation[first_index + k];
+                result = operation->eval(operation, variable->num_enum_values, variable->enum_name,
+                                         variable->data_type, variable->data.ptr);
+            }
+            else
+            {
+                harp_operation_numeric_value_filter *operation;
+
+                operation = (harp_operation_numeric_value_filter *)program->operation[first_index + k];
+                result = operation->eval(operation, variable->data_type, variable->data.ptr);
+            }
+            if (result <= 0)
+            {
+                return result;
+            }
+        }
+        return 1;
     }
 
-    for (i = 0; i < num_areas; i++)
+    if (variable->num_dimensions == 1 && variable->dimension_type[0] != harp_dimension_independent)
     {
-        harp_spherical_polygon *area;
+        harp_dimension_mask *filter_mask;
+        int result = 0;
 
-        if (harp_spherical_polygon_from_latitude_longitude_bounds(0, num_points,
-                                                                  &latitude_bounds->data.double_data[i * num_points],
-                                                                  &longitude_bounds->data.double_data[i * num_points],
-                                                                  &area) != 0)
+        dimension_type = variable->dimension_type[0];
+        dimension_mask = dimension_mask_set[dimension_type];
+        if (dimension_mask == NULL)
         {
-            harp_variable_delete(latitude_bounds);
-            harp_variable_delete(longitude_bounds);
-            free(mask);
-            return -1;
+            if (harp_dimension_mask_new(1, variable->dimension, &dimension_mask_set[dimension_type]) != 0)
+            {
+                return -1;
+            }
+            dimension_mask = dimension_mask_set[dimension_type];
         }
-        else
+        if (dimension_mask->num_dimensions == 1)
         {
-            mask[i] = 1;
+            /* the filters only clear mask entries, so they can be evaluated directly on the existing mask */
             for (k = 0; k < num_operations; k++)
             {
-                if (mask[i])
+                if (apply_value_filter(program->operation[first_index + k], variable, dimension_mask->mask) != 0)
                 {
-                    harp_operation_polygon_filter *operation;
-                    int result;
-
-                    operation = (harp_operation_polygon_filter *)program->operation[program->current_index + k];
-                    result = operation->eval(operation, area);
-                    if (result < 0)
-                    {
-                        harp_variable_delete(latitude_bounds);
-                        harp_variable_delete(longitude_bounds);
-                        harp_spherical_polygon_delete(area);
-                        free(mask);
-                        return -1;
-                    }
-                    mask[i] = result;
+                    return -1;
                 }
             }
+            return 1;
         }
-        harp_spherical_polygon_delete(area);
-    }
 
-    harp_variable_delete(latitude_bounds);
-    harp_variable_delete(longitude_bounds);
+        /* the dimension already has a 2-D mask; evaluate on a 1-D mask and broadcast it over the time dimension */
+        if (harp_dimension_mask_new(1, variable->dimension, &filter_mask) != 0)
+        {
+            return -1;
+        }
+        for (k = 0; k < num_operations; k++)
+        {
+            if (apply_value_filter(program->operation[first_index + k], variable, filter_mask->mask) != 0)
+            {
+                result = -1;
+                break;
+            }
+        }
+        if (result == 0)
+        {
+            result = harp_dimension_mask_merge(filter_mask, 1, dimension_mask) != 0 ? -1 : 1;
+        }
+        harp_dimension_mask_delete(filter_mask);
+        return result;
+    }
 
-    if (harp_product_filter_dimension(product, harp_dimension_time, mask) != 0)
+    if (variable->num_dimensions == 2 && variable->dimension_type[0] == harp_dimension_time &&
+        variable->dimension_type[1] != harp_dimension_independent &&
+        variable->dimension_type[1] != harp_dimension_time)
     {
-        free(mask);
-        return -1;
+        dimension_type = variable->dimension_type[1];
+        dimension_mask = dimension_mask_set[dimension_type];
+        if (dimension_mask == NULL)
+        {
+            if (harp_dimension_mask_new(2, variable->dimension, &dimension_mask_set[dimension_type]) != 0)
+            {
+                return -1;
+            }
+            dimension_mask = dimension_mask_set[dimension_type];
+        }
+        else if (dimension_mask->num_dimensions == 1)
+        {
+            /* only now does the earlier 1-D filter need to be materialised for every time sample */
+            if (harp_dimension_mask_prepend_dimension(dimension_mask, variable->dimension[0]) != 0)
+            {
+                return -1;
+            }
+        }
+        for (k = 0; k < num_operations; k++)
+        {
+            if (apply_value_filter(program->operation[first_index + k], variable, dimension_mask->mask) != 0)
+            {
+                return -1;
+            }
+        }
+        return 1;
     }
-    free(mask);
-
-    /* jump to the last operation in the list that we performed */
-    program->current_index += num_operations - 1;
 
-    return 0;
+    harp_set_error(HARP_ERROR_OPERATION, "variable '%s' has invalid dimensions for filtering", variable->name);
+    return -1;
 }
 
-static int execute_collocation_filter(harp_product *product, harp_operation_collocation_filter *operation)
+/* Execute the run of consecutive value filters starting at program->current_index.
+ * Instead of filtering the product after each variable, the masks of all filters in the run are combined per dimension
+ * and the product is filtered only once at the end of the run.
+ */
+static int execute_value_filter(harp_product *product, harp_program *program)
 {
-    if (product->source_product == NULL)
+    harp_dimension_mask_set *dimension_mask_set = NULL;
+    int num_operations = 0;
+    int i;
+
+    if (harp_dimension_mask_set_new(&dimension_mask_set) != 0)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product attribute 'source_product' is NULL");
         return -1;
     }
 
-    /* Check for the presence of the 'collocation_index' or 'index' variable.
-     * Either variable should be 1-D and should depend on the time dimension.
-     * Even though subsequent functions will also verify this, this is important for the consistency of
-     * error messages with ingestion.
-     */
-    if (!harp_product_has_variable(product, "collocation_index") && !harp_product_has_variable(product, "index"))
+    while (program->current_index + num_operations < program->num_operations &&
+           harp_operation_is_value_filter(program->operation[program->current_index + num_operations]))
     {
-        harp_dimension_type dimension_type = harp_dimension_time;
+        int first_index = program->current_index + num_operations;
+        int num_variable_operations = 1;
+        harp_variable *variable;
+        const char *variable_name;
+        int result;
+        int k;
 
-        if (harp_product_add_derived_variable(product, "index", NULL, NULL, 1, &dimension_type) != 0)
+        if (harp_operation_get_variable_name(program->operation[first_index], &variable_name) != 0)
         {
+            harp_dimension_mask_set_delete(dimension_mask_set);
             return -1;
         }
-    }
-
-    if (harp_operation_prepare_collocation_filter((harp_operation *)operation, product->source_product) != 0)
-    {
-        return -1;
-    }
-
-    return harp_product_apply_collocation_mask(product, operation->collocation_mask);
-}
-
-static int execute_bin_collocated(harp_product *product, harp_operation_bin_collocated *operation)
-{
-    harp_collocation_result *collocation_result = NULL;
-
-    if (harp_collocation_result_read(operation->collocation_result, &collocation_result) != 0)
-    {
-        return -1;
-    }
-
-    if (operation->target_dataset == 'a')
-    {
-        harp_collocation_result_swap_datasets(collocation_result);
-    }
-
-    if (harp_product_bin_with_collocated_dataset(product, collocation_result) != 0)
-    {
-        harp_collocation_result_delete(collocation_result);
-        return -1;
-    }
-
-
-    return 0;
-}
-
-static int execute_bin_spatial(harp_product *product, harp_operation_bin_spatial *operation)
-{
-    return harp_product_bin_spatial_full(product, operation->num_latitude_edges, operation->latitude_edges,
-                                         operation->num_longitude_edges, operation->longitude_edges);
-}
 
-static int execute_bin_with_variable(harp_product *product, harp_operation_bin_with_variable *operation)
-{
-    return harp_product_bin_with_variable(product, operation->variable_name);
-}
+        /* if the next operations are also value filters on the same variable then include them */
+        while (first_index + num_variable_operations < program->num_operations)
+        {
+            const char *next_variable_name;
 
-static int execute_derive_variable(harp_product *product, harp_operation_derive_variable *operation)
-{
-    if (!operation->has_dimensions)
-    {
-        harp_variable *variable;
+            if (!harp_operation_is_value_filter(program->operation[first_index + num_variable_operations]))
+            {
+                break;
+            }
+            if (harp_operation_get_variable_name(program->operation[first_index + num_variable_operations],
+                                                 &next_variable_name) != 0)
+            {
+                harp_dimension_mask_set_delete(dimension_mask_set);
+                return -1;
+            }
+            if (strcmp(variable_name, next_variable_name) != 0)
+            {
+                break;
+            }
+            num_variable_operations++;
+        }
 
-        /* we only perform unit and/or data type conversion; the variable should already be there */
-        if (harp_product_get_variable_by_name(product, operation->variable_name, &variable) != 0)
+        if (harp_product_get_variable_by_name(product, variable_name, &variable) != 0)
         {
+            harp_dimension_mask_set_delete(dimension_mask_set);
             return -1;
         }
-        if (operation->unit != NULL)
+
+        if (variable->unit != NULL)
         {
-            if (harp_variable_has_unit(variable, operation->unit))
+            for (k = 0; k < num_variable_operations; k++)
             {
-                if (strcmp(variable->unit, operation->unit) != 0)
-                {
-                    /* make sure that the unit becomes syntactically the same */
-                    if (harp_variable_set_unit(variable, operation->unit) != 0)
-                    {
-                        return -1;
-                    }
-                }
-            }
-            else
-            {
-                if (harp_variable_convert_unit(variable, operation->unit) != 0)
+                if (harp_operation_set_value_unit(program->operation[first_index + k], variable->unit) != 0)
                 {
+                    harp_dimension_mask_set_delete(dimension_mask_set);
                     return -1;
                 }
             }
         }
-        if (operation->has_data_type)
+
+        result = add_value_filter_to_mask_set(program, first_index, num_variable_operations, variable,
+                                              dimension_mask_set);
+        if (result < 0)
         {
-            if (harp_variable_convert_data_type(variable, operation->data_type) != 0)
+            harp_dimension_mask_set_delete(dimension_mask_set);
+            return -1;
+        }
+        num_operations += num_variable_operations;
+        if (result == 0)
+        {
+            /* the full product is masked out so remove all variables to make it empty */
+            harp_dimension_mask_set_delete(dimension_mask_set);
+            harp_product_remove_all_variables(product);
+            program->current_index += num_operations - 1;
+            return 0;
+        }
+    }
+
+    /* combine the masks: update the masked lengths, make the time mask consistent with the 2-D masks, and drop masks
+     * that do not remove anything */
+    for (i = 0; i < HARP_NUM_DIM_TYPES; i++)
+    {
+        if (dimension_mask_set[i] != NULL && dimension_mask_set[i]->num_dimensions == 1)
+        {
+            if (harp_dimension_mask_update_masked_length(dimension_mask_set[i]) != 0)
             {
+                harp_dimension_mask_set_delete(dimension_mask_set);
                 return -1;
             }
         }
-        return 0;
     }
-    if (operation->has_data_type)
+    if (harp_dimension_mask_set_simplify(dimension_mask_set) != 0)
     {
-        return harp_product_add_derived_variable(product, operation->variable_name, &operation->data_type,
-                                                 operation->unit, operation->num_dimensions, operation->dimension_type);
+        harp_dimension_mask_set_delete(dimension_mask_set);
+        return -1;
     }
-    return harp_product_add_derived_variable(product, operation->variable_name, NULL, operation->unit,
-                                             operation->num_dimensions, operation->dimension_type);
-}
-
-static int execute_derive_smoothed_column_collocated_dataset
-    (harp_product *product, harp_operation_derive_smoothed_column_collocated_dataset *operation)
-{
-    harp_collocation_result *collocation_result = NULL;
-    harp_variable *variable;
 
-    if (harp_collocation_result_read(operation->collocation_result, &collocation_result) != 0)
+    if (harp_product_filter(product, dimension_mask_set) != 0)
     {
+        harp_dimension_mask_set_delete(dimension_mask_set);
         return -1;
     }
+    harp_dimension_mask_set_delete(dimension_mask_set);
 
-    if (operation->target_dataset == 'a')
-    {
-        harp_collocation_result_swap_datasets(collocation_result);
-    }
-    if (harp_dataset_import(collocation_result->dataset_b, operation->dataset_dir, NULL) != 0)
+    /* jump to the last operation in the list that we performed */
+    program->current_index += num_operations - 1;
+
+    return 0;
+}
+
+static int execute_point_filter(harp_product *product, harp_program *program)
+{
+    harp_dimension_type dimension_type = harp_dimension_time;
+    harp_data_type data_type = harp_type_double;
+    harp_spherical_point *point;
+    harp_variable *latitude;
+    harp_variable *longitude;
+    uint8_t *mask;
+    int num_operations = 1;
+    long num_points;
+    long i;
+    int k;
+
+    if (harp_product_get_derived_variable(product, "latitude", &data_type, "degree_north", 1, &dimension_type,
+                                          &latitude) != 0)
     {
-        harp_collocation_result_delete(collocation_result);
         return -1;
     }
-
-    /* execute the operation */
-    if (harp_product_get_smoothed_column_using_collocated_dataset(product, operation->variable_name, operation->unit,
-                                                                  operation->num_dimensions, operation->dimension_type,
-                                                                  operation->axis_variable_name, operation->axis_unit,
-                                                                  collocation_result, &variable) != 0)
+    if (harp_product_get_derived_variable(product, "longitude", &data_type, "degree_east", 1, &dimension_type,
+                                          &longitude) != 0)
     {
-        harp_collocation_result_delete(collocation_result);
+        harp_variable_delete(latitude);
         return -1;
     }
-    harp_collocation_result_delete(collocation_result);
 
-    if (harp_product_has_variable(product, variable->name))
-    {
-        if (harp_product_replace_variable(product, variable) != 0)
-        {
-            harp_variable_delete(variable);
-            return -1;
-        }
-    }
-    else
+    num_points = latitude->dimension[0];
+
+    /* if the next operations are also point filters then include them */
+    while (program->current_index + num_operations < program->num_operations)
     {
-        if (harp_product_add_variable(product, variable) != 0)
+        if (!harp_operation_is_point_filter(program->operation[program->current_index + num_operations]))
         {
-            harp_variable_delete(variable);
-            return -1;
+            break;
         }
+        num_operations++;
     }
 
-    return 0;
-}
-
-static int execute_derive_smoothed_column_collocated_product
-    (harp_product *product, harp_operation_derive_smoothed_column_collocated_product *operation)
-{
-    harp_product *collocated_product = NULL;
-    harp_variable *variable;
-
-    if (harp_import(operation->filename, NULL, NULL, &collocated_product) != 0)
+    mask = (uint8_t *)malloc(num_points * sizeof(uint8_t));
+    if (mask == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_points * sizeof(uint8_t), __FILE__, __LINE__);
+        harp_variable_delete(latitude);
+        harp_variable_delete(longitude);
         return -1;
     }
-
-    /* execute the operation */
-    if (harp_product_get_smoothed_column_using_collocated_product(product, operation->variable_name, operation->unit,
-                                                                  operation->num_dimensions, operation->dimension_type,
-                                                                  operation->axis_variable_name, operation->axis_unit,
-                                                                  collocated_product, &variable) != 0)
+    point = (harp_spherical_point *)malloc(num_points * sizeof(harp_spherical_point));
+    if (point == NULL)
     {
-        harp_product_delete(collocated_product);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_points * sizeof(harp_spherical_point), __FILE__, __LINE__);
+        harp_variable_delete(latitude);
+        harp_variable_delete(longitude);
+        free(mask);
         return -1;
     }
-    harp_product_delete(collocated_product);
 
-    if (harp_product_has_variable(product, variable->name))
+    for (i = 0; i < num_points; i++)
     {
-        if (harp_product_replace_variable(product, variable) != 0)
-        {
-            harp_variable_delete(variable);
-            return -1;
-        }
+        point[i].lat = latitude->data.double_data[i];
+        point[i].lon = longitude->data.double_data[i];
+        harp_spherical_point_rad_from_deg(&point[i]);
+        harp_spherical_point_check(&point[i]);
+        mask[i] = 1;
     }
-    else
+
+    for (k = 0; k < num_operations; k++)
     {
-        if (harp_product_add_variable(product, variable) != 0)
+        if (harp_operation_filter_points(program->operation[program->current_index + k], num_points, point, mask)
+            != 0)
         {
-            harp_variable_delete(variable);
+            harp_variable_delete(latitude);
+            harp_variable_delete(longitude);
+            free(point);
+            free(mask);
             return -1;
         }
     }
+    free(point);
 
-    return 0;
-}
-
-static int execute_exclude_variable(harp_product *product, harp_operation_exclude_variable *operation)
-{
-    int j;
+    harp_variable_delete(latitude);
+    harp_variable_delete(longitude);
 
-    for (j = 0; j < operation->num_variables; j++)
+    if (harp_product_filter_dimension(product, harp_dimension_time, mask) != 0)
     {
-        if (harp_product_has_variable(product, operation->variable_name[j]))
-        {
-            if (harp_product_remove_variable_by_name(product, operation->variable_name[j]) != 0)
-            {
-                return -1;
-            }
-        }
+        free(mask);
+        return -1;
     }
+    free(mask);
 
-    return 0;
-}
+    /* jump to the last operation in the list that we performed */
+    program->current_index += num_operations - 1;
 
-static int execute_flatten(harp_product *product, harp_operation_flatten *operation)
-{
-    return harp_product_flatten_dimension(product, operation->dimension_type);
+    return 0;
 }
 
-static int execute_keep_variable(harp_product *product, harp_operation_keep_variable *operation)
+static int execute_polygon_filter(harp_product *product, harp_program *program)
 {
-    uint8_t *included;
-    int index;
-    int j;
+    harp_dimension_type dimension_type[2] = { harp_dimension_time, harp_dimension_independent };
+    harp_data_type data_type = harp_type_double;
+    harp_variable *latitude_bounds;
+    harp_variable *longitude_bounds;
+    uint8_t *mask;
+    int num_operations = 1;
+    long num_areas;
+    long num_points;
+    long i;
+    int k;
 
-    included = (uint8_t *)calloc(product->num_variables, sizeof(uint8_t));
-    if (included == NULL)
+    if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, "degree_north", 2, dimension_type,
+                                          &latitude_bounds) != 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       product->num_variables * sizeof(uint8_t), __FILE__, __LINE__);
         return -1;
     }
-
-    /* assume all variables are excluded */
-    for (j = 0; j < product->num_variables; j++)
+    if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, "degree_east", 2, dimension_type,
+                                          &longitude_bounds) != 0)
     {
-        included[j] = 0;
+        harp_variable_delete(latitude_bounds);
+        return -1;
     }
 
-    /* set the 'keep' flags in the mask */
-    for (j = 0; j < operation->num_variables; j++)
+    if (latitude_bounds->dimension[1] != longitude_bounds->dimension[1])
     {
-        if (harp_product_get_variable_index_by_name(product, operation->variable_name[j], &index) != 0)
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "the length of the independent dimension of variable "
+                       "'latitude_bounds' (%ld) does not match the length of the independent dimension of variable "
+                       "'longitude_bounds' (%ld)", latitude_bounds->dimension[1], longitude_bounds->dimension[1]);
+        harp_variable_delete(latitude_bounds);
+        harp_variable_delete(longitude_bounds);
+        return -1;
+    }
+    if (latitude_bounds->dimension[1] < 3)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "the length of the independent dimension of variables "
+                       "'latitude_bounds' and 'longitude_bounds' should be 3 or more");
+        harp_variable_delete(latitude_bounds);
+        harp_variable_delete(longitude_bounds);
+        return -1;
+    }
+
+    num_areas = latitude_bounds->dimension[0];
+    num_points = latitude_bounds->dimension[1];
+
+    /* if the next operations are also polygon filters then include them */
+    while (program->current_index + num_operations < program->num_operations)
+    {
+        if (!harp_operation_is_polygon_filter(program->operation[program->current_index + num_operations]))
         {
-            harp_set_error(HARP_ERROR_OPERATION, "cannot keep non-existent variable %s", operation->variable_name[j]);
-            free(included);
-            return -1;
+            break;
         }
+        num_operations++;
+    }
 
-        included[index] = 1;
+    mask = (uint8_t *)malloc(latitude_bounds->dimension[0] * sizeof(uint8_t));
+    if (mask == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       latitude_bounds->dimension[0] * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
     }
 
-    /* filter the variables using the mask */
-    for (j = product->num_variables - 1; j >= 0; j--)
+    for (i = 0; i < num_areas; i++)
     {
-        if (!included[j])
+        harp_spherical_polygon *area;
+
+        if (harp_spherical_polygon_from_latitude_longitude_bounds(0, num_points,
+                                                                  &latitude_bounds->data.double_data[i * num_points],
+                                                                  &longitude_bounds->data.double_data[i * num_points],
+                                                                  &area) != 0)
         {
-            if (harp_product_remove_variable(product, product->variable[j]) != 0)
+            harp_variable_delete(latitude_bounds);
+            harp_variable_delete(longitude_bounds);
+            free(mask);
+            return -1;
+        }
+        else
+        {
+            mask[i] = 1;
+            for (k = 0; k < num_operations; k++)
             {
-                free(included);
-                return -1;
+                if (mask[i])
+                {
+                    harp_operation_polygon_filter *operation;
+                    int result;
+
+                    operation = (harp_operation_polygon_filter *)program->operation[program->current_index + k];
+                    result = operation->eval(operation, area);
+                    if (result < 0)
+                    {
+                        harp_variable_delete(latitude_bounds);
+                        harp_variable_delete(longitude_bounds);
+                        harp_spherical_polygon_delete(area);
+                        free(mask);
+                        return -1;
+                    }
+                    mask[i] = result;
+                }
             }
         }
+        harp_spherical_polygon_delete(area);
     }
 
-    free(included);
+    harp_variable_delete(latitude_bounds);
+    harp_variable_delete(longitude_bounds);
+
+    if (harp_product_filter_dimension(product, harp_dimension_time, mask) != 0)
+    {
+        free(mask);
+        return -1;
+    }
+    free(mask);
+
+    /* jump to the last operation in the list that we performed */
+    program->current_index += num_operations - 1;
 
     return 0;
 }
 
-static int execute_regrid(harp_product *product, harp_operation_regrid *operation)
+static int execute_collocation_filter(harp_product *product, harp_operation_collocation_filter *operation)
 {
-    harp_variable *target_grid = NULL;
-
-    if (operation->axis_variable->dimension_type[0] == harp_dimension_independent)
+    if (product->source_product == NULL)
     {
-        harp_set_error(HARP_ERROR_OPERATION, "regridding of '%s' dimension not supported",
-                       harp_get_dimension_type_name(operation->axis_variable->dimension_type[0]));
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product attribute 'source_product' is NULL");
         return -1;
     }
 
-    if (harp_product_regrid_with_axis_variable(product, operation->axis_variable, operation->axis_bounds_variable) != 0)
+    /* Check for the presence of the 'collocation_index' or 'index' variable.
+     * Either variable should be 1-D and should depend on the time dimension.
+     * Even though subsequent functions will also verify this, this is important for the consistency of
+     * error messages with ingestion.
+     */
+    if (!harp_product_has_variable(product, "collocation_index") && !harp_product_has_variable(product, "index"))
+    {
+        harp_dimension_type dimension_type = harp_dimension_time;
+
+        if (harp_product_add_derived_variable(product, "index", NULL, NULL, 1, &dimension_type) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (harp_operation_prepare_collocation_filter((harp_operation *)operation, product->source_product) != 0)
     {
-        harp_variable_delete(target_grid);
         return -1;
     }
-    return 0;
+
+    return harp_product_apply_collocation_mask(product, operation->collocation_mask);
 }
 
-static int execute_regrid_collocated_dataset(harp_product *product, harp_operation_regrid_collocated_dataset *operation)
+static int execute_bin_collocated(harp_product *product, harp_operation_bin_collocated *operation)
 {
     harp_collocation_result *collocation_result = NULL;
 
@@ -900,147 +1292,369 @@ static int execute_regrid_collocated_dataset(harp_product *product, harp_operati
     {
         harp_collocation_result_swap_datasets(collocation_result);
     }
-    if (harp_dataset_import(collocation_result->dataset_b, operation->dataset_dir, NULL) != 0)
-    {
-        harp_collocation_result_delete(collocation_result);
-        return -1;
-    }
 
-    if (harp_product_regrid_with_collocated_dataset(product, operation->dimension_type, operation->axis_variable_name,
-                                                    operation->axis_unit, collocation_result) != 0)
+    if (harp_product_bin_with_collocated_dataset(product, collocation_result, operation->aggregation) != 0)
     {
         harp_collocation_result_delete(collocation_result);
         return -1;
     }
 
-    harp_collocation_result_delete(collocation_result);
+
     return 0;
 }
 
-static int execute_regrid_collocated_product(harp_product *product, harp_operation_regrid_collocated_product *operation)
+static int execute_bin_spatial(harp_product *product, harp_operation_bin_spatial *operation)
 {
-    harp_product *collocated_product = NULL;
+    return harp_product_bin_spatial_full(product, operation->num_latitude_edges, operation->latitude_edges,
+                                         operation->num_longitude_edges, operation->longitude_edges,
+                                         operation->aggregation, operation->weights_filename);
+}
 
-    if (harp_import(operation->filename, NULL, NULL, &collocated_product) != 0)
+static int execute_bin_with_variable(harp_product *product, harp_operation_bin_with_variable *operation)
+{
+    return harp_product_bin_with_variable(product, operation->variable_name, operation->aggregation);
+}
+
+/* Round a value to num_bits explicit mantissa bits (round half to even). NaN and Inf are kept as is, and values that
+ * would round up to Inf are truncated instead.
+ */
+static double bit_round_double(double value, int num_bits)
+{
+    const uint64_t exponent_mask = (uint64_t)0x7ff << 52;
+    uint64_t bits;
+    uint64_t rounded_bits;
+    uint64_t mask;
+    int shift;
+
+    if (num_bits >= 52)
     {
-        return -1;
+        return value;
+    }
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & exponent_mask) == exponent_mask)
+    {
+        return value;
+    }
+    shift = 52 - num_bits;
+    mask = ((uint64_t)1 << shift) - 1;
+    rounded_bits = (bits + (mask >> 1) + ((bits >> shift) & 1)) & ~mask;
+    if ((rounded_bits & exponent_mask) == exponent_mask)
+    {
+        rounded_bits = bits & ~mask;
     }
+    memcpy(&value, &rounded_bits, sizeof(value));
 
-    if (harp_product_regrid_with_collocated_product(product, operation->dimension_type, operation->axis_variable_name,
-                                                    operation->axis_unit, collocated_product) != 0)
+    return value;
+}
+
+static float bit_round_float(float value, int num_bits)
+{
+    const uint32_t exponent_mask = (uint32_t)0xff << 23;
+    uint32_t bits;
+    uint32_t rounded_bits;
+    uint32_t mask;
+    int shift;
+
+    if (num_bits >= 23)
     {
-        harp_product_delete(collocated_product);
-        return -1;
+        return value;
+    }
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & exponent_mask) == exponent_mask)
+    {
+        return value;
+    }
+    shift = 23 - num_bits;
+    mask = ((uint32_t)1 << shift) - 1;
+    rounded_bits = (bits + (mask >> 1) + ((bits >> shift) & 1)) & ~mask;
+    if ((rounded_bits & exponent_mask) == exponent_mask)
+    {
+        rounded_bits = bits & ~mask;
     }
+    memcpy(&value, &rounded_bits, sizeof(value));
 
-    harp_product_delete(collocated_product);
-    return 0;
+    return value;
 }
 
-static int execute_rename(harp_product *product, harp_operation_rename *operation)
+/* Returns the number of mantissa bits that need to be kept for value such that the rounding error stays within half
+ * the uncertainty, or -1 if the value should not be rounded.
+ */
+static int get_num_significant_bits(double value, double uncertainty)
 {
-    harp_variable *variable = NULL;
-    char *new_name;
+    int value_exponent;
+    int uncertainty_exponent;
 
-    if (harp_product_get_variable_by_name(product, operation->variable_name, &variable) != 0)
+    if (!harp_isfinite(value) || value == 0 || !harp_isfinite(uncertainty) || !(uncertainty > 0))
     {
         return -1;
     }
+    /* for value in [2^(e-1),2^e) the spacing of values with n mantissa bits is 2^(e-1-n), so the rounding error is at
+     * most half the uncertainty if 2^(e-1-n) <= uncertainty, which holds for n = e - eu with uncertainty in
+     * [2^(eu-1),2^eu) */
+    frexp(value, &value_exponent);
+    frexp(uncertainty, &uncertainty_exponent);
+    if (value_exponent - uncertainty_exponent < 0)
+    {
+        return 0;
+    }
 
-    new_name = strdup(operation->new_variable_name);
-    if (new_name == NULL)
+    return value_exponent - uncertainty_exponent;
+}
+
+static int execute_bit_round(harp_product *product, harp_operation_bit_round *operation)
+{
+    harp_variable *variable;
+    harp_variable *uncertainty;
+    long i;
+
+    if (harp_product_get_variable_by_name(product, operation->variable_name, &variable) != 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                       __LINE__);
         return -1;
     }
-
-    if (harp_product_detach_variable(product, variable) != 0)
+    if (variable->data_type != harp_type_float && variable->data_type != harp_type_double)
     {
-        free(new_name);
+        harp_set_error(HARP_ERROR_OPERATION, "cannot bit round variable '%s' of type '%s'", variable->name,
+                       harp_get_data_type_name(variable->data_type));
         return -1;
     }
-    free(variable->name);
-    variable->name = new_name;
 
-    if (harp_product_add_variable(product, variable) != 0)
+    /* the variable data is rounded in place */
+    if (harp_variable_make_data_owned(variable) != 0)
     {
-        harp_variable_delete(variable);
         return -1;
     }
 
-    return 0;
-}
-
-static int execute_set(harp_product *product, harp_operation_set *operation)
-{
-    (void)product;
-
-    if (strcmp(operation->option, "afgl86") == 0)
+    if (operation->uncertainty_variable_name == NULL)
     {
-        if (strcmp(operation->value, "enabled") == 0)
-        {
-            harp_set_option_enable_aux_afgl86(1);
-            harp_set_option_enable_aux_usstd76(0);
-        }
-        else if (strcmp(operation->value, "disabled") == 0)
-        {
-            harp_set_option_enable_aux_afgl86(0);
-            harp_set_option_enable_aux_usstd76(0);
-        }
-        else if (strcmp(operation->value, "usstd76") == 0)
+        if (variable->data_type == harp_type_float)
         {
-            harp_set_option_enable_aux_afgl86(0);
-            harp_set_option_enable_aux_usstd76(1);
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                variable->data.float_data[i] = bit_round_float(variable->data.float_data[i], operation->num_bits);
+            }
         }
         else
         {
-            harp_set_error(HARP_ERROR_OPERATION, "invalid value '%s' for option '%s'", operation->value,
-                           operation->option);
-            return -1;
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                variable->data.double_data[i] = bit_round_double(variable->data.double_data[i], operation->num_bits);
+            }
         }
+        return 0;
     }
-    else if (strcmp(operation->option, "regrid_out_of_bounds") == 0)
+
+    if (harp_product_get_variable_by_name(product, operation->uncertainty_variable_name, &uncertainty) != 0)
     {
-        if (strcmp(operation->value, "nan") == 0)
-        {
-            harp_set_option_regrid_out_of_bounds(0);
-        }
-        else if (strcmp(operation->value, "edge") == 0)
-        {
-            harp_set_option_regrid_out_of_bounds(1);
-        }
-        else if (strcmp(operation->value, "extrapolate") == 0)
+        return -1;
+    }
+    if (uncertainty->num_dimensions != variable->num_dimensions)
+    {
+        harp_set_error(HARP_ERROR_OPERATION, "variable '%s' does not have the same dimensions as variable '%s'",
+                       uncertainty->name, variable->name);
+        return -1;
+    }
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        if (uncertainty->dimension_type[i] != variable->dimension_type[i] ||
+            uncertainty->dimension[i] != variable->dimension[i])
         {
-            harp_set_option_regrid_out_of_bounds(2);
+            harp_set_error(HARP_ERROR_OPERATION, "variable '%s' does not have the same dimensions as variable '%s'",
+                           uncertainty->name, variable->name);
+            return -1;
         }
-        else
+    }
+    /* use a double precision copy of the uncertainty in the unit of the variable */
+    if (harp_variable_copy(uncertainty, &uncertainty) != 0)
+    {
+        return -1;
+    }
+    if (variable->unit != NULL && uncertainty->unit != NULL)
+    {
+        if (harp_variable_convert_unit(uncertainty, variable->unit) != 0)
         {
-            harp_set_error(HARP_ERROR_OPERATION, "invalid value '%s' for option '%s'", operation->value,
-                           operation->option);
+            harp_variable_delete(uncertainty);
             return -1;
         }
     }
-    else
+    else if (harp_variable_convert_data_type(uncertainty, harp_type_double) != 0)
     {
-        harp_set_error(HARP_ERROR_OPERATION, "invalid option '%s'", operation->option);
+        harp_variable_delete(uncertainty);
         return -1;
     }
 
-    return 0;
-}
-
-static int execute_smooth_collocated_dataset(harp_product *product, harp_operation_smooth_collocated_dataset *operation)
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        int num_bits;
+
+        if (variable->data_type == harp_type_float)
+        {
+            num_bits = get_num_significant_bits(variable->data.float_data[i], uncertainty->data.double_data[i]);
+            if (num_bits >= 0)
+            {
+                variable->data.float_data[i] = bit_round_float(variable->data.float_data[i], num_bits);
+            }
+        }
+        else
+        {
+            num_bits = get_num_significant_bits(variable->data.double_data[i], uncertainty->data.double_data[i]);
+            if (num_bits >= 0)
+            {
+                variable->data.double_data[i] = bit_round_double(variable->data.double_data[i], num_bits);
+            }
+        }
+    }
+
+    harp_variable_delete(uncertainty);
+
+    return 0;
+}
+
+static int execute_derive_variable(harp_product *product, harp_operation_derive_variable *operation)
 {
-    harp_collocation_result *collocation_result = NULL;
+    if (!operation->has_dimensions)
+    {
+        harp_variable *variable;
 
-    if (operation->dimension_type != harp_dimension_vertical)
+        /* we only perform unit and/or data type conversion; the variable should already be there */
+        if (harp_product_get_variable_by_name(product, operation->variable_name, &variable) != 0)
+        {
+            return -1;
+        }
+        if (operation->unit != NULL)
+        {
+            if (harp_variable_has_unit(variable, operation->unit))
+            {
+                if (strcmp(variable->unit, operation->unit) != 0)
+                {
+                    /* make sure that the unit becomes syntactically the same */
+                    if (harp_variable_set_unit(variable, operation->unit) != 0)
+                    {
+                        return -1;
+                    }
+                }
+            }
+            else
+            {
+                if (harp_variable_convert_unit_keep_float(variable, operation->unit) != 0)
+                {
+                    return -1;
+                }
+            }
+        }
+        if (operation->has_data_type)
+        {
+            if (harp_variable_convert_data_type(variable, operation->data_type) != 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (operation->has_data_type)
     {
-        harp_set_error(HARP_ERROR_OPERATION, "regridding of '%s' dimension not supported",
-                       harp_get_dimension_type_name(operation->dimension_type));
+        return harp_product_add_derived_variable(product, operation->variable_name, &operation->data_type,
+                                                 operation->unit, operation->num_dimensions, operation->dimension_type);
+    }
+    return harp_product_add_derived_variable(product, operation->variable_name, NULL, operation->unit,
+                                             operation->num_dimensions, operation->dimension_type);
+}
+
+/* All variables are derived from the product as it was before the operation and only then added to the product.
+ * The derivations are planned together, such that intermediate variables that are needed for more than one of the
+ * variables are only derived once, and are released as soon as the last variable that needs them has been derived.
+ */
+static int execute_derive_all(harp_product *product, harp_operation_derive_all *operation)
+{
+    harp_derivation_session *derivation_session;
+    harp_variable **variable;
+    int result = 0;
+    int i;
+
+    variable = (harp_variable **)malloc(operation->num_variables * sizeof(harp_variable *));
+    if (variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       operation->num_variables * sizeof(harp_variable *), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < operation->num_variables; i++)
+    {
+        variable[i] = NULL;
+    }
+
+    if (harp_derivation_session_new(product, &derivation_session) != 0)
+    {
+        free(variable);
         return -1;
     }
 
+    /* plan all derivations first (this also makes sure that we fail before anything is derived) */
+    for (i = 0; i < operation->num_variables; i++)
+    {
+        harp_operation_derive_variable *derive_operation = operation->variable[i];
+
+        if (harp_derivation_session_add_target(derivation_session, derive_operation->variable_name,
+                                               derive_operation->num_dimensions, derive_operation->dimension_type) != 0)
+        {
+            result = -1;
+            break;
+        }
+    }
+
+    if (result == 0)
+    {
+        harp_derivation_session_enter(derivation_session);
+        for (i = 0; i < operation->num_variables; i++)
+        {
+            harp_operation_derive_variable *derive_operation = operation->variable[i];
+
+            if (harp_product_get_derived_variable(product, derive_operation->variable_name,
+                                                  derive_operation->has_data_type ? &derive_operation->data_type : NULL,
+                                                  derive_operation->unit, derive_operation->num_dimensions,
+                                                  derive_operation->dimension_type, &variable[i]) != 0)
+            {
+                result = -1;
+                break;
+            }
+        }
+        harp_derivation_session_leave(derivation_session);
+    }
+    harp_derivation_session_delete(derivation_session);
+
+    for (i = 0; i < operation->num_variables; i++)
+    {
+        if (result == 0)
+        {
+            if (harp_product_has_variable(product, variable[i]->name))
+            {
+                result = harp_product_replace_variable(product, variable[i]);
+            }
+            else
+            {
+                result = harp_product_add_variable(product, variable[i]);
+            }
+            if (result == 0)
+            {
+                /* the product now owns the variable */
+                variable[i] = NULL;
+            }
+        }
+        if (variable[i] != NULL)
+        {
+            harp_variable_delete(variable[i]);
+        }
+    }
+    free(variable);
+
+    return result;
+}
+
+static int execute_derive_smoothed_column_collocated_dataset
+    (harp_product *product, harp_operation_derive_smoothed_column_collocated_dataset *operation)
+{
+    harp_collocation_result *collocation_result = NULL;
+    harp_variable *variable;
+
     if (harp_collocation_result_read(operation->collocation_result, &collocation_result) != 0)
     {
         return -1;
@@ -1056,253 +1670,1052 @@ static int execute_smooth_collocated_dataset(harp_product *product, harp_operati
         return -1;
     }
 
-    if (harp_product_smooth_vertical_with_collocated_dataset(product, operation->num_variables,
-                                                             (const char **)operation->variable_name,
-                                                             operation->axis_variable_name, operation->axis_unit,
-                                                             collocation_result) != 0)
+    /* execute the operation */
+    if (harp_product_get_smoothed_column_using_collocated_dataset(product, operation->variable_name, operation->unit,
+                                                                  operation->num_dimensions, operation->dimension_type,
+                                                                  operation->axis_variable_name, operation->axis_unit,
+                                                                  collocation_result, &variable) != 0)
     {
         harp_collocation_result_delete(collocation_result);
         return -1;
     }
-
     harp_collocation_result_delete(collocation_result);
+
+    if (harp_product_has_variable(product, variable->name))
+    {
+        if (harp_product_replace_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+    else
+    {
+        if (harp_product_add_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+
     return 0;
 }
 
-static int execute_smooth_collocated_product(harp_product *product, harp_operation_smooth_collocated_product *operation)
+static int execute_derive_smoothed_column_collocated_product
+    (harp_product *product, harp_operation_derive_smoothed_column_collocated_product *operation)
 {
     harp_product *collocated_product = NULL;
+    harp_variable *variable;
 
-    if (operation->dimension_type != harp_dimension_vertical)
+    if (harp_import(operation->filename, NULL, NULL, &collocated_product) != 0)
     {
-        harp_set_error(HARP_ERROR_OPERATION, "regridding of '%s' dimension not supported",
-                       harp_get_dimension_type_name(operation->dimension_type));
         return -1;
     }
 
-    if (harp_import(operation->filename, NULL, NULL, &collocated_product) != 0)
+    /* execute the operation */
+    if (harp_product_get_smoothed_column_using_collocated_product(product, operation->variable_name, operation->unit,
+                                                                  operation->num_dimensions, operation->dimension_type,
+                                                                  operation->axis_variable_name, operation->axis_unit,
+                                                                  collocated_product, &variable) != 0)
     {
+        harp_product_delete(collocated_product);
         return -1;
     }
+    harp_product_delete(collocated_product);
 
-    if (harp_product_smooth_vertical_with_collocated_product(product, operation->num_variables,
-                                                             (const char **)operation->variable_name,
-                                                             operation->axis_variable_name, operation->axis_unit,
-                                                             collocated_product) != 0)
+    if (harp_product_has_variable(product, variable->name))
     {
-        harp_product_delete(collocated_product);
-        return -1;
+        if (harp_product_replace_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+    else
+    {
+        if (harp_product_add_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
     }
 
-    harp_product_delete(collocated_product);
     return 0;
 }
 
-static int execute_sort(harp_product *product, harp_operation_sort *operation)
+static int execute_exclude_variable(harp_product *product, harp_operation_exclude_variable *operation)
+{
+    int j;
+
+    for (j = 0; j < operation->num_variables; j++)
+    {
+        if (harp_product_has_variable(product, operation->variable_name[j]))
+        {
+            if (harp_product_remove_variable_by_name(product, operation->variable_name[j]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int execute_flatten(harp_product *product, harp_operation_flatten *operation)
 {
-    return harp_product_sort(product, operation->variable_name);
+    return harp_product_flatten_dimension(product, operation->dimension_type);
 }
 
-static int execute_wrap(harp_product *product, harp_operation_wrap *operation)
+static int execute_keep_variable(harp_product *product, harp_operation_keep_variable *operation)
 {
-    harp_variable *variable;
-    long i;
+    uint8_t *included;
+    int index;
+    int j;
 
-    if (harp_product_get_variable_by_name(product, operation->variable_name, &variable) != 0)
+    included = (uint8_t *)calloc(product->num_variables, sizeof(uint8_t));
+    if (included == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(uint8_t), __FILE__, __LINE__);
         return -1;
     }
-    if (operation->unit != NULL)
+
+    /* assume all variables are excluded */
+    for (j = 0; j < product->num_variables; j++)
     {
-        if (harp_variable_convert_unit(variable, operation->unit) != 0)
-        {
-            return -1;
-        }
+        included[j] = 0;
     }
-    else
+
+    /* set the 'keep' flags in the mask */
+    for (j = 0; j < operation->num_variables; j++)
     {
-        if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
+        if (harp_product_get_variable_index_by_name(product, operation->variable_name[j], &index) != 0)
         {
+            harp_set_error(HARP_ERROR_OPERATION, "cannot keep non-existent variable %s", operation->variable_name[j]);
+            free(included);
             return -1;
         }
+
+        included[index] = 1;
     }
 
-    for (i = 0; i < variable->num_elements; i++)
+    /* filter the variables using the mask */
+    for (j = product->num_variables - 1; j >= 0; j--)
     {
-        variable->data.double_data[i] = harp_wrap(variable->data.double_data[i], operation->min, operation->max);
+        if (!included[j])
+        {
+            if (harp_product_remove_variable(product, product->variable[j]) != 0)
+            {
+                free(included);
+                return -1;
+            }
+        }
     }
 
-    variable->valid_min.double_data = operation->min;
-    variable->valid_max.double_data = operation->max;
+    free(included);
 
     return 0;
 }
 
-/* this will start with the operation at program->current_index */
-int harp_product_execute_program(harp_product *product, harp_program *program)
+static int execute_regrid(harp_product *product, harp_operation_regrid *operation)
 {
-    while (program->current_index < program->num_operations)
-    {
-        harp_operation *operation = program->operation[program->current_index];
+    harp_variable *target_grid = NULL;
 
-        /* note that some consecutive filter operations can be executed together for optimization purposes */
-        /* so the filter functions below may increase program->current_index itself */
-        switch (operation->type)
+    if (operation->axis_variable->dimension_type[0] == harp_dimension_independent)
+    {
+        harp_set_error(HARP_ERROR_OPERATION, "regridding of '%s' dimension not supported",
+                       harp_get_dimension_type_name(operation->axis_variable->dimension_type[0]));
+        return -1;
+    }
+
+    if (harp_product_regrid_with_axis_variable(product, operation->axis_variable, operation->axis_bounds_variable) != 0)
+    {
+        harp_variable_delete(target_grid);
+        return -1;
+    }
+    return 0;
+}
+
+static int execute_regrid_collocated_dataset(harp_product *product, harp_operation_regrid_collocated_dataset *operation)
+{
+    harp_collocation_result *collocation_result = NULL;
+
+    if (harp_collocation_result_read(operation->collocation_result, &collocation_result) != 0)
+    {
+        return -1;
+    }
+
+    if (operation->target_dataset == 'a')
+    {
+        harp_collocation_result_swap_datasets(collocation_result);
+    }
+    if (harp_dataset_import(collocation_result->dataset_b, operation->dataset_dir, NULL) != 0)
+    {
+        harp_collocation_result_delete(collocation_result);
+        return -1;
+    }
+
+    if (harp_product_regrid_with_collocated_dataset(product, operation->dimension_type, operation->axis_variable_name,
+                                                    operation->axis_unit, collocation_result) != 0)
+    {
+        harp_collocation_result_delete(collocation_result);
+        return -1;
+    }
+
+    harp_collocation_result_delete(collocation_result);
+    return 0;
+}
+
+static int execute_regrid_collocated_product(harp_product *product, harp_operation_regrid_collocated_product *operation)
+{
+    harp_product *collocated_product = NULL;
+
+    if (harp_import(operation->filename, NULL, NULL, &collocated_product) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_regrid_with_collocated_product(product, operation->dimension_type, operation->axis_variable_name,
+                                                    operation->axis_unit, collocated_product) != 0)
+    {
+        harp_product_delete(collocated_product);
+        return -1;
+    }
+
+    harp_product_delete(collocated_product);
+    return 0;
+}
+
+static int execute_regrid_spatial(harp_product *product, harp_operation_regrid_spatial *operation)
+{
+    return harp_product_regrid_spatial(product, operation->num_latitude_edges, operation->latitude_edges,
+                                       operation->num_longitude_edges, operation->longitude_edges);
+}
+
+static int execute_compute(harp_product *product, harp_operation_compute *operation)
+{
+    return harp_product_compute_variable(product, operation->variable_name,
+                                         operation->has_data_type ? &operation->data_type : NULL, operation->unit,
+                                         operation->expression);
+}
+
+static int execute_sample_grid(harp_product *product, harp_operation_sample_grid *operation)
+{
+    harp_product *grid_product = NULL;
+
+    if (harp_import_collocated_product(operation->filename, &grid_product) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_sample_grid(product, grid_product, operation->nearest) != 0)
+    {
+        harp_product_delete(grid_product);
+        return -1;
+    }
+
+    harp_product_delete(grid_product);
+    return 0;
+}
+
+static int execute_rename(harp_product *product, harp_operation_rename *operation)
+{
+    harp_variable *variable = NULL;
+    char *new_name;
+
+    if (harp_product_get_variable_by_name(product, operation->variable_name, &variable) != 0)
+    {
+        return -1;
+    }
+
+    new_name = strdup(operation->new_variable_name);
+    if (new_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    if (harp_product_detach_variable(product, variable) != 0)
+    {
+        free(new_name);
+        return -1;
+    }
+    free(variable->name);
+    variable->name = new_name;
+
+    if (harp_product_add_variable(product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int execute_set(harp_product *product, harp_operation_set *operation)
+{
+    (void)product;
+
+    if (strcmp(operation->option, "afgl86") == 0)
+    {
+        if (strcmp(operation->value, "enabled") == 0)
         {
-            case operation_bit_mask_filter:
-            case operation_comparison_filter:
-            case operation_longitude_range_filter:
-            case operation_membership_filter:
-            case operation_string_comparison_filter:
-            case operation_string_membership_filter:
-            case operation_valid_range_filter:
-                if (execute_value_filter(product, program) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_point_distance_filter:
-            case operation_point_in_area_filter:
-                if (execute_point_filter(product, program) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_area_covers_area_filter:
-            case operation_area_covers_point_filter:
-            case operation_area_inside_area_filter:
-            case operation_area_intersects_area_filter:
-                if (execute_polygon_filter(product, program) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_collocation_filter:
-                if (execute_collocation_filter(product, (harp_operation_collocation_filter *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_bin_collocated:
-                if (execute_bin_collocated(product, (harp_operation_bin_collocated *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_bin_full:
-                if (harp_product_bin_full(product) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_bin_spatial:
-                if (execute_bin_spatial(product, (harp_operation_bin_spatial *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_bin_with_variable:
-                if (execute_bin_with_variable(product, (harp_operation_bin_with_variable *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_derive_variable:
-                if (execute_derive_variable(product, (harp_operation_derive_variable *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_derive_smoothed_column_collocated_dataset:
-                if (execute_derive_smoothed_column_collocated_dataset
-                    (product, (harp_operation_derive_smoothed_column_collocated_dataset *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_derive_smoothed_column_collocated_product:
-                if (execute_derive_smoothed_column_collocated_product
-                    (product, (harp_operation_derive_smoothed_column_collocated_product *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_exclude_variable:
-                if (execute_exclude_variable(product, (harp_operation_exclude_variable *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_flatten:
-                if (execute_flatten(product, (harp_operation_flatten *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_keep_variable:
-                if (execute_keep_variable(product, (harp_operation_keep_variable *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_regrid:
-                if (execute_regrid(product, (harp_operation_regrid *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_regrid_collocated_dataset:
-                if (execute_regrid_collocated_dataset(product, (harp_operation_regrid_collocated_dataset *)operation) !=
-                    0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_regrid_collocated_product:
-                if (execute_regrid_collocated_product(product, (harp_operation_regrid_collocated_product *)operation) !=
-                    0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_rename:
-                if (execute_rename(product, (harp_operation_rename *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_set:
-                if (execute_set(product, (harp_operation_set *)operation) != 0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_smooth_collocated_dataset:
-                if (execute_smooth_collocated_dataset(product, (harp_operation_smooth_collocated_dataset *)operation) !=
-                    0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_smooth_collocated_product:
-                if (execute_smooth_collocated_product(product, (harp_operation_smooth_collocated_product *)operation) !=
-                    0)
-                {
-                    return -1;
-                }
-                break;
-            case operation_sort:
-                if (execute_sort(product, (harp_operation_sort *)operation) != 0)
-                {
-                    return -1;
-                }
+            harp_set_option_enable_aux_afgl86(1);
+            harp_set_option_enable_aux_usstd76(0);
+        }
+        else if (strcmp(operation->value, "disabled") == 0)
+        {
+            harp_set_option_enable_aux_afgl86(0);
+            harp_set_option_enable_aux_usstd76(0);
+        }
+        else if (strcmp(operation->value, "usstd76") == 0)
+        {
+            harp_set_option_enable_aux_afgl86(0);
+            harp_set_option_enable_aux_usstd76(1);
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_OPERATION, "invalid value '%s' for option '%s'", operation->value,
+                           operation->option);
+            return -1;
+        }
+    }
+    else if (strcmp(operation->option, "regrid_out_of_bounds") == 0)
+    {
+        if (strcmp(operation->value, "nan") == 0)
+        {
+            harp_set_option_regrid_out_of_bounds(0);
+        }
+        else if (strcmp(operation->value, "edge") == 0)
+        {
+            harp_set_option_regrid_out_of_bounds(1);
+        }
+        else if (strcmp(operation->value, "extrapolate") == 0)
+        {
+            harp_set_option_regrid_out_of_bounds(2);
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_OPERATION, "invalid value '%s' for option '%s'", operation->value,
+                           operation->option);
+            return -1;
+        }
+    }
+    else if (strcmp(operation->option, "point_distance") == 0)
+    {
+        if (strcmp(operation->value, "sphere") == 0)
+        {
+            harp_set_option_wgs84_point_distance(0);
+        }
+        else if (strcmp(operation->value, "wgs84") == 0)
+        {
+            harp_set_option_wgs84_point_distance(1);
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_OPERATION, "invalid value '%s' for option '%s'", operation->value,
+                           operation->option);
+            return -1;
+        }
+    }
+    else
+    {
+        harp_set_error(HARP_ERROR_OPERATION, "invalid option '%s'", operation->option);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int execute_smooth_collocated_dataset(harp_product *product, harp_operation_smooth_collocated_dataset *operation)
+{
+    harp_collocation_result *collocation_result = NULL;
+
+    if (operation->dimension_type != harp_dimension_vertical)
+    {
+        harp_set_error(HARP_ERROR_OPERATION, "regridding of '%s' dimension not supported",
+                       harp_get_dimension_type_name(operation->dimension_type));
+        return -1;
+    }
+
+    if (harp_collocation_result_read(operation->collocation_result, &collocation_result) != 0)
+    {
+        return -1;
+    }
+
+    if (operation->target_dataset == 'a')
+    {
+        harp_collocation_result_swap_datasets(collocation_result);
+    }
+    if (harp_dataset_import(collocation_result->dataset_b, operation->dataset_dir, NULL) != 0)
+    {
+        harp_collocation_result_delete(collocation_result);
+        return -1;
+    }
+
+    if (harp_product_smooth_vertical_with_collocated_dataset(product, operation->num_variables,
+                                                             (const char **)operation->variable_name,
+                                                             operation->axis_variable_name, operation->axis_unit,
+                                                             collocation_result) != 0)
+    {
+        harp_collocation_result_delete(collocation_result);
+        return -1;
+    }
+
+    harp_collocation_result_delete(collocation_result);
+    return 0;
+}
+
+static int execute_smooth_collocated_product(harp_product *product, harp_operation_smooth_collocated_product *operation)
+{
+    harp_product *collocated_product = NULL;
+
+    if (operation->dimension_type != harp_dimension_vertical)
+    {
+        harp_set_error(HARP_ERROR_OPERATION, "regridding of '%s' dimension not supported",
+                       harp_get_dimension_type_name(operation->dimension_type));
+        return -1;
+    }
+
+    if (harp_import(operation->filename, NULL, NULL, &collocated_product) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_smooth_vertical_with_collocated_product(product, operation->num_variables,
+                                                             (const char **)operation->variable_name,
+                                                             operation->axis_variable_name, operation->axis_unit,
+                                                             collocated_product) != 0)
+    {
+        harp_product_delete(collocated_product);
+        return -1;
+    }
+
+    harp_product_delete(collocated_product);
+    return 0;
+}
+
+static int execute_sort(harp_product *product, harp_operation_sort *operation)
+{
+    return harp_product_sort_by_variables(product, operation->num_variables,
+                                          (const char **)operation->variable_name);
+}
+
+static int execute_wrap(harp_product *product, harp_operation_wrap *operation)
+{
+    harp_variable *variable;
+
+    if (harp_product_get_variable_by_name(product, operation->variable_name, &variable) != 0)
+    {
+        return -1;
+    }
+    if (operation->unit != NULL)
+    {
+        if (harp_variable_convert_unit(variable, operation->unit) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* the data type conversion does not copy data that is already double, so the data may not be owned yet */
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
+    harp_wrap_array(variable->num_elements, variable->data.double_data, operation->min, operation->max);
+
+    variable->valid_min.double_data = operation->min;
+    variable->valid_max.double_data = operation->max;
+
+    return 0;
+}
+
+/* Returns whether a derive operation commutes with a filter on the time dimension.
+ * This is the case for plain unit/data type conversions and for variables that have time as first dimension (values
+ * are derived independently for each time sample). The exception is 'index', which depends on the position of the
+ * samples.
+ */
+static int derive_commutes_with_time_filter(const harp_operation_derive_variable *operation)
+{
+    if (!operation->has_dimensions)
+    {
+        return 1;
+    }
+    if (operation->num_dimensions == 0 || operation->dimension_type[0] != harp_dimension_time)
+    {
+        return 0;
+    }
+    return strcmp(operation->variable_name, "index") != 0;
+}
+
+/* Returns whether the filter only depends on existing variables that were not derived by the derive operations in
+ * the range [first_index, last_index) and whether the filter only reduces the time dimension.
+ */
+static int filter_can_move_before_derive(const harp_product *product, const harp_program *program, int filter_index,
+                                         int first_index, int last_index)
+{
+    const harp_operation *operation = program->operation[filter_index];
+    const char *variable_name[2];
+    int num_variables;
+    int i, j;
+
+    if (harp_operation_is_value_filter(operation))
+    {
+        if (harp_operation_get_variable_name(operation, &variable_name[0]) != 0)
+        {
+            return 0;
+        }
+        num_variables = 1;
+    }
+    else if (harp_operation_is_point_filter(operation))
+    {
+        variable_name[0] = "latitude";
+        variable_name[1] = "longitude";
+        num_variables = 2;
+    }
+    else if (harp_operation_is_polygon_filter(operation))
+    {
+        variable_name[0] = "latitude_bounds";
+        variable_name[1] = "longitude_bounds";
+        num_variables = 2;
+    }
+    else
+    {
+        return 0;
+    }
+
+    for (i = 0; i < num_variables; i++)
+    {
+        harp_variable *variable;
+        int index;
+
+        if (harp_product_get_variable_index_by_name(product, variable_name[i], &index) != 0)
+        {
+            return 0;
+        }
+        variable = product->variable[index];
+        if (harp_operation_is_value_filter(operation))
+        {
+            if (variable->num_dimensions > 1 ||
+                (variable->num_dimensions == 1 && variable->dimension_type[0] != harp_dimension_time))
+            {
+                return 0;
+            }
+        }
+        else if (harp_operation_is_point_filter(operation))
+        {
+            if (variable->num_dimensions != 1 || variable->dimension_type[0] != harp_dimension_time)
+            {
+                return 0;
+            }
+        }
+        else if (variable->num_dimensions != 2 || variable->dimension_type[0] != harp_dimension_time ||
+                 variable->dimension_type[1] != harp_dimension_independent)
+        {
+            return 0;
+        }
+
+        for (j = first_index; j < last_index; j++)
+        {
+            const harp_operation_derive_variable *derive_operation;
+
+            derive_operation = (const harp_operation_derive_variable *)program->operation[j];
+            if (strcmp(derive_operation->variable_name, variable_name[i]) == 0)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Move filters that follow one or more derive operations to before those derive operations (if this does not change
+ * the result), such that variables only get derived for the samples that remain and such that the filters can be
+ * combined with the filters that precede the derive operations. Only filters on existing variables that reduce the
+ * time dimension are moved and only across derive operations that are performed independently per time sample.
+ * The original order of the operations is restored when the execution of the program ends.
+ */
+static int reorder_operations(const harp_product *product, harp_program *program)
+{
+    int insert_index;
+    int i;
+
+    /* skip the filters that will be executed first (the moved filters will be put directly after them) */
+    insert_index = program->current_index;
+    while (insert_index < program->num_operations &&
+           (harp_operation_is_value_filter(program->operation[insert_index]) ||
+            harp_operation_is_point_filter(program->operation[insert_index]) ||
+            harp_operation_is_polygon_filter(program->operation[insert_index])))
+    {
+        insert_index++;
+    }
+
+    for (i = insert_index; i < program->num_operations; i++)
+    {
+        harp_operation *operation = program->operation[i];
+
+        if (operation->type == operation_derive_variable)
+        {
+            if (!derive_commutes_with_time_filter((harp_operation_derive_variable *)operation))
+            {
                 break;
-            case operation_wrap:
-                if (execute_wrap(product, (harp_operation_wrap *)operation) != 0)
+            }
+        }
+        else if (i > insert_index && filter_can_move_before_derive(product, program, i, insert_index, i))
+        {
+            if (!program->is_reordered)
+            {
+                if (program->original_operation == NULL)
                 {
-                    return -1;
+                    program->original_operation =
+                        (harp_operation **)malloc(program->num_operations * sizeof(harp_operation *));
+                    if (program->original_operation == NULL)
+                    {
+                        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) "
+                                       "(%s:%u)", program->num_operations * sizeof(harp_operation *), __FILE__,
+                                       __LINE__);
+                        return -1;
+                    }
                 }
-                break;
+                memcpy(program->original_operation, program->operation,
+                       program->num_operations * sizeof(harp_operation *));
+                program->is_reordered = 1;
+            }
+            memmove(&program->operation[insert_index + 1], &program->operation[insert_index],
+                    (i - insert_index) * sizeof(harp_operation *));
+            program->operation[insert_index] = operation;
+            insert_index++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* Get the name under which the execution of the operation is recorded in the profile (see harp_set_option_profile())
+ * and in the trace (see harp_set_option_trace()).
+ * Consecutive filters that are executed together are recorded under the name of the first filter.
+ */
+static void get_profile_name(const harp_operation *operation, char *name, size_t size)
+{
+    const char *operation_name = "unknown";
+
+    switch (operation->type)
+    {
+        case operation_area_covers_area_filter:
+            operation_name = "area_covers_area";
+            break;
+        case operation_area_covers_point_filter:
+            operation_name = "area_covers_point";
+            break;
+        case operation_area_inside_area_filter:
+            operation_name = "area_inside_area";
+            break;
+        case operation_area_intersects_area_filter:
+            operation_name = "area_intersects_area";
+            break;
+        case operation_bin_collocated:
+            operation_name = "bin (collocated)";
+            break;
+        case operation_bin_full:
+            operation_name = "bin";
+            break;
+        case operation_bin_spatial:
+            operation_name = "bin_spatial";
+            break;
+        case operation_bin_with_variable:
+            operation_name = "bin (variable)";
+            break;
+        case operation_bit_mask_filter:
+            operation_name = "bit mask filter";
+            break;
+        case operation_bit_round:
+            operation_name = "bit_round";
+            break;
+        case operation_collocation_filter:
+            operation_name = "collocate";
+            break;
+        case operation_comparison_filter:
+            operation_name = "comparison filter";
+            break;
+        case operation_compute:
+            snprintf(name, size, "compute(%s)", ((const harp_operation_compute *)operation)->variable_name);
+            return;
+        case operation_derive_all:
+            operation_name = "derive_all";
+            break;
+        case operation_derive_variable:
+            snprintf(name, size, "derive(%s)", ((const harp_operation_derive_variable *)operation)->variable_name);
+            return;
+        case operation_derive_smoothed_column_collocated_dataset:
+        case operation_derive_smoothed_column_collocated_product:
+            operation_name = "derive_smoothed_column";
+            break;
+        case operation_exclude_variable:
+            operation_name = "exclude";
+            break;
+        case operation_flatten:
+            operation_name = "flatten";
+            break;
+        case operation_keep_variable:
+            operation_name = "keep";
+            break;
+        case operation_longitude_range_filter:
+            operation_name = "longitude range filter";
+            break;
+        case operation_membership_filter:
+            operation_name = "membership filter";
+            break;
+        case operation_point_distance_filter:
+            operation_name = "point_distance";
+            break;
+        case operation_point_in_area_filter:
+            operation_name = "point_in_area";
+            break;
+        case operation_regrid:
+        case operation_regrid_collocated_dataset:
+        case operation_regrid_collocated_product:
+            operation_name = "regrid";
+            break;
+        case operation_regrid_spatial:
+            operation_name = "regrid_spatial";
+            break;
+        case operation_rename:
+            operation_name = "rename";
+            break;
+        case operation_sample_grid:
+            operation_name = "sample_grid";
+            break;
+        case operation_set:
+            operation_name = "set";
+            break;
+        case operation_smooth_collocated_dataset:
+        case operation_smooth_collocated_product:
+            operation_name = "smooth";
+            break;
+        case operation_sort:
+            operation_name = "sort";
+            break;
+        case operation_sort_spatial:
+            operation_name = "sort_spatial";
+            break;
+        case operation_sparsify:
+            operation_name = "sparsify";
+            break;
+        case operation_string_comparison_filter:
+            operation_name = "string comparison filter";
+            break;
+        case operation_string_membership_filter:
+            operation_name = "string membership filter";
+            break;
+        case operation_valid_range_filter:
+            operation_name = "valid";
+            break;
+        case operation_wrap:
+            operation_name = "wrap";
+            break;
+    }
+
+    snprintf(name, size, "%s", operation_name);
+}
+
+/* Execute the operation at program->current_index.
+ * Some consecutive filter operations can be executed together for optimization purposes, so this function may also
+ * increase program->current_index itself.
+ */
+static int execute_operation(harp_product *product, harp_program *program, harp_operation *operation)
+{
+    switch (operation->type)
+    {
+        case operation_bit_mask_filter:
+        case operation_comparison_filter:
+        case operation_longitude_range_filter:
+        case operation_membership_filter:
+        case operation_string_comparison_filter:
+        case operation_string_membership_filter:
+        case operation_valid_range_filter:
+            if (execute_value_filter(product, program) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_point_distance_filter:
+        case operation_point_in_area_filter:
+            if (execute_point_filter(product, program) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_area_covers_area_filter:
+        case operation_area_covers_point_filter:
+        case operation_area_inside_area_filter:
+        case operation_area_intersects_area_filter:
+            if (execute_polygon_filter(product, program) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_collocation_filter:
+            if (execute_collocation_filter(product, (harp_operation_collocation_filter *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_bin_collocated:
+            if (execute_bin_collocated(product, (harp_operation_bin_collocated *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_bin_full:
+            if (harp_product_bin_full(product, ((harp_operation_bin_full *)operation)->aggregation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_bin_spatial:
+            if (execute_bin_spatial(product, (harp_operation_bin_spatial *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_bin_with_variable:
+            if (execute_bin_with_variable(product, (harp_operation_bin_with_variable *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_bit_round:
+            if (execute_bit_round(product, (harp_operation_bit_round *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_compute:
+            if (execute_compute(product, (harp_operation_compute *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_derive_all:
+            if (execute_derive_all(product, (harp_operation_derive_all *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_derive_variable:
+            if (execute_derive_variable(product, (harp_operation_derive_variable *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_derive_smoothed_column_collocated_dataset:
+            if (execute_derive_smoothed_column_collocated_dataset
+                (product, (harp_operation_derive_smoothed_column_collocated_dataset *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_derive_smoothed_column_collocated_product:
+            if (execute_derive_smoothed_column_collocated_product
+                (product, (harp_operation_derive_smoothed_column_collocated_product *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_exclude_variable:
+            if (execute_exclude_variable(product, (harp_operation_exclude_variable *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_flatten:
+            if (execute_flatten(product, (harp_operation_flatten *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_keep_variable:
+            if (execute_keep_variable(product, (harp_operation_keep_variable *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_regrid:
+            if (execute_regrid(product, (harp_operation_regrid *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_regrid_collocated_dataset:
+            if (execute_regrid_collocated_dataset(product, (harp_operation_regrid_collocated_dataset *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_regrid_collocated_product:
+            if (execute_regrid_collocated_product(product, (harp_operation_regrid_collocated_product *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_regrid_spatial:
+            if (execute_regrid_spatial(product, (harp_operation_regrid_spatial *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_rename:
+            if (execute_rename(product, (harp_operation_rename *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_sample_grid:
+            if (execute_sample_grid(product, (harp_operation_sample_grid *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_set:
+            if (execute_set(product, (harp_operation_set *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_smooth_collocated_dataset:
+            if (execute_smooth_collocated_dataset(product, (harp_operation_smooth_collocated_dataset *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_smooth_collocated_product:
+            if (execute_smooth_collocated_product(product, (harp_operation_smooth_collocated_product *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_sort:
+            if (execute_sort(product, (harp_operation_sort *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_sort_spatial:
+            if (harp_product_sort_spatial(product, ((harp_operation_sort_spatial *)operation)->time_step) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_sparsify:
+            if (harp_product_sparsify(product) != 0)
+            {
+                return -1;
+            }
+            break;
+        case operation_wrap:
+            if (execute_wrap(product, (harp_operation_wrap *)operation) != 0)
+            {
+                return -1;
+            }
+            break;
+    }
+
+    return 0;
+}
+
+/* Returns whether the derive operation will only add a new variable to the product (and leaves the other variables
+ * untouched), in which case intermediate variables that were derived before can still be used afterwards.
+ */
+static int derive_only_adds_variable(const harp_product *product, const harp_operation_derive_variable *operation)
+{
+    return operation->has_dimensions && !harp_product_has_variable(product, operation->variable_name);
+}
+
+static int execute_program(harp_product *product, harp_program *program, harp_derivation_session *derivation_session)
+{
+    char profile_name[MAX_PROFILE_NAME_LENGTH];
+    int64_t start_size = 0;
+    double start_time = 0;
+    double start_cpu_time = 0;
+    int result;
+
+    while (program->current_index < program->num_operations)
+    {
+        harp_operation *operation;
+
+        if (harp_option_optimize_operations)
+        {
+            if (reorder_operations(product, program) != 0)
+            {
+                return -1;
+            }
+        }
+        operation = program->operation[program->current_index];
+
+        if (harp_option_profile || harp_option_trace)
+        {
+            get_profile_name(operation, profile_name, sizeof(profile_name));
+        }
+        if (harp_option_profile)
+        {
+            if (harp_product_get_storage_size(product, 0, &start_size) != 0)
+            {
+                return -1;
+            }
+            start_cpu_time = harp_get_cpu_time();
+            start_time = harp_get_wall_time();
+        }
+
+        harp_trace_begin("%s", profile_name);
+        if (operation->type == operation_derive_variable)
+        {
+            int keep_derived_variables;
+
+            keep_derived_variables = derive_only_adds_variable(product, (harp_operation_derive_variable *)operation);
+            harp_derivation_session_enter(derivation_session);
+            result = execute_operation(product, program, operation);
+            harp_derivation_session_leave(derivation_session);
+            if (!keep_derived_variables)
+            {
+                harp_derivation_session_clear(derivation_session);
+            }
+        }
+        else
+        {
+            /* any other operation may modify the product */
+            result = execute_operation(product, program, operation);
+            harp_derivation_session_clear(derivation_session);
+        }
+        harp_trace_end();
+        if (result != 0)
+        {
+            return -1;
+        }
+
+        if (harp_option_profile)
+        {
+            double wall_time = harp_get_wall_time() - start_time;
+            double cpu_time = harp_get_cpu_time() - start_cpu_time;
+            int64_t size;
+
+            if (harp_product_get_storage_size(product, 0, &size) != 0)
+            {
+                return -1;
+            }
+            harp_profile_add(profile_name, wall_time, cpu_time, size - start_size);
         }
 
         if (harp_product_is_empty(product))
@@ -1316,6 +2729,23 @@ int harp_product_execute_program(harp_product *product, harp_program *program)
     return 0;
 }
 
+/* this will start with the operation at program->current_index */
+int harp_product_execute_program(harp_product *product, harp_program *program)
+{
+    harp_derivation_session *derivation_session;
+    int result;
+
+    /* intermediate variables that are derived by consecutive derive operations are shared via a derivation session */
+    if (harp_derivation_session_new(product, &derivation_session) != 0)
+    {
+        return -1;
+    }
+    result = execute_program(product, program, derivation_session);
+    harp_derivation_session_delete(derivation_session);
+
+    return result;
+}
+
 /** \addtogroup harp_product
  * @{
  */
@@ -1352,11 +2782,14 @@ LIBHARP_API int harp_product_execute_operations(harp_product *product, const cha
         return -1;
     }
 
+    harp_program_start_execution(program);
     if (harp_product_execute_program(product, program) != 0)
     {
+        harp_program_end_execution(program);
         harp_program_delete(program);
         return -1;
     }
+    harp_program_end_execution(program);
 
     harp_program_delete(program);
 
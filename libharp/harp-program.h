@@ -34,28 +34,31 @@
 
 #include "harp-operation.h"
 
-/* HARP programs are lists of harp_operations */
-typedef struct harp_program_struct
+/* HARP programs are lists of harp_operations (the harp_program typedef is part of the public interface) */
+struct harp_program_struct
 {
     int num_operations;
     harp_operation **operation;
 
     /* state information used during execution of the program */
     int current_index;  /* index of operation that is next to be executed */
-    /* initial global HARP options */
-    int option_enable_aux_afgl86;
-    int option_enable_aux_usstd76;
-    int option_regrid_out_of_bounds;
-} harp_program;
+    /* options that are used (and can be changed by set() operations) during the execution */
+    harp_execution_options options;
+    /* options that the executing thread used before the execution (restored at the end of the execution) */
+    harp_execution_options *previous_options;
+    /* copy of the original operation order (only used when operations got reordered during execution) */
+    harp_operation **original_operation;
+    int is_reordered;
+    /* operations string from which the program was created (NULL if the program was not created from a string) */
+    char *operations;
+};
 
 int harp_program_new(harp_program **new_program);
-void harp_program_delete(harp_program *program);
 int harp_program_add_operation(harp_program *program, harp_operation *operation);
 
-/* Parser */
-int harp_program_from_string(const char *str, harp_program **new_program);
-
 /* Execution */
+void harp_program_start_execution(harp_program *program);
+void harp_program_end_execution(harp_program *program);
 int harp_product_execute_program(harp_product *product, harp_program *program);
 
 #endif
@@ -30,6 +30,8 @@
  */
 
 #include "harp-internal.h"
+#include "harp-constants.h"
+#include "harp-thread.h"
 
 #include <assert.h>
 #include <math.h>
@@ -39,6 +41,9 @@
 
 #define MAX_NAME_LENGTH 128
 
+/* minimum number of regridded variable elements per thread when regridding using multiple threads */
+#define MIN_NUM_ELEMENTS_PER_THREAD 65536
+
 typedef enum resample_type_enum
 {
     resample_skip,
@@ -46,9 +51,45 @@ typedef enum resample_type_enum
     resample_linear,
     resample_log,       /* interpolate linear using coordinates [x,log(y)] */
     resample_loglog,    /* interpolate linear using coordinates [log(x),log(y)] */
-    resample_interval
+    resample_interval,
+    resample_angle      /* average as unit vectors [cos(x),sin(x)] (only used for spatial regridding) */
 } resample_type;
 
+/* shared (read-only) state for regridding the variables of a product */
+typedef struct regrid_info_struct
+{
+    harp_product *product;
+    const resample_type *variable_type;
+    harp_dimension_type dimension_type;
+    const harp_variable *source_grid;
+    const harp_variable *source_bounds;
+    const harp_variable *target_grid;
+    const harp_variable *local_target_grid;
+    const harp_variable *local_target_bounds;
+    int source_grid_num_dims;
+    int target_grid_num_dims;
+    long source_grid_max_dim_elements;
+    long target_grid_max_dim_elements;
+    long source_max_dim_elements;
+    long max_num_elements;
+    int out_of_bound_flag;
+    int need_linear_weights;
+    int need_loglog_weights;
+    int need_interval_weights;
+    long num_grids;
+} regrid_info;
+
+/* a task regrids the blocks of grids [first_grid, end_grid); for each grid only part 'part' of 'num_parts' equal
+ * parts of the blocks is regridded (this allows a single grid to be split over multiple tasks) */
+typedef struct regrid_task_struct
+{
+    const regrid_info *info;
+    long first_grid;
+    long end_grid;
+    long part;
+    long num_parts;
+} regrid_task;
+
 
 static long get_unpadded_length(double *vector, long vector_length)
 {
@@ -237,54 +278,874 @@ int harp_product_get_derived_bounds_for_grid(harp_product *product, harp_variabl
     bounds_name = malloc(strlen(grid->name) + 7 + 1);
     if (!bounds_name)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string)"
-                       " (%s:%u)", __FILE__, __LINE__);
-        return -1;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string)"
+                       " (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    strcpy(bounds_name, grid->name);
+    strcat(bounds_name, "_bounds");
+
+    if (harp_product_get_derived_variable(product, bounds_name, &grid->data_type, grid->unit, grid->num_dimensions + 1,
+                                          dim_type, bounds) != 0)
+    {
+        free(bounds_name);
+        return -1;
+    }
+    free(bounds_name);
+
+    return 0;
+}
+
+static int get_bounds_for_grid_from_variable(harp_variable *grid, harp_variable **bounds)
+{
+    harp_product *product = NULL;
+
+    /* Create a dummy product to allow deriving the bounds for the target grid */
+    if (harp_product_new(&product) != 0)
+    {
+        return -1;
+    }
+    if (harp_product_add_variable(product, grid) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    if (harp_product_get_derived_bounds_for_grid(product, grid, bounds) != 0)
+    {
+        if (harp_product_detach_variable(product, grid) == 0)
+        {
+            harp_product_delete(product);
+        }
+        return -1;
+    }
+    if (harp_product_detach_variable(product, grid) != 0)
+    {
+        /* we can't delete the product since it still contains the grid (which we can't delete) */
+        return -1;
+    }
+    harp_product_delete(product);
+
+    return 0;
+}
+
+/* Determine the layout of a variable as a [num_blocks, <regrid dimension>, num_elements] array */
+static void get_regrid_layout(const harp_variable *variable, harp_dimension_type dimension_type, long *num_blocks,
+                              long *num_elements)
+{
+    long j = 0;
+
+    *num_blocks = 1;
+    *num_elements = 1;
+    assert(variable->num_dimensions > 0);
+    while (variable->dimension_type[j] != dimension_type)
+    {
+        assert(j < variable->num_dimensions - 1);
+        *num_blocks *= variable->dimension[j];
+        j++;
+    }
+    j++;        /* skip dimension that is going to be regridded */
+    while (j < variable->num_dimensions)
+    {
+        *num_elements *= variable->dimension[j];
+        j++;
+    }
+}
+
+static int regrid_task_run(void *arg)
+{
+    regrid_task *regrid = (regrid_task *)arg;
+    const regrid_info *info = regrid->info;
+    harp_product *product = info->product;
+    long source_max_dim_elements = info->source_max_dim_elements;
+    long source_grid_max_dim_elements = info->source_grid_max_dim_elements;
+    long target_grid_max_dim_elements = info->target_grid_max_dim_elements;
+    long source_grid_num_dim_elements;
+    long target_grid_num_dim_elements;
+    long max_num_interval_weights = 0;
+    double nan_value = harp_nan();
+    harp_variable *variable;
+    long g, i;
+
+    /* owned memory */
+    double *source_buffer = NULL;
+    harp_interpolation_weight *linear_weight = NULL;
+    harp_interpolation_weight *loglog_weight = NULL;
+    long *interval_offset = NULL;
+    long *interval_source_index = NULL;
+    double *interval_weight = NULL;
+
+    /* allocate the buffer that holds a copy of the source block (i.e. all profiles for one grid) */
+    source_buffer = (double *)malloc(source_max_dim_elements * info->max_num_elements * (size_t)sizeof(double));
+    if (source_buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       source_max_dim_elements * info->max_num_elements * sizeof(double), __FILE__, __LINE__);
+        goto error;
+    }
+
+    /* allocate the interpolation weights; these are calculated once per grid and then applied to all variables */
+    if (info->need_linear_weights)
+    {
+        linear_weight = malloc(target_grid_max_dim_elements * sizeof(harp_interpolation_weight));
+        if (linear_weight == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           target_grid_max_dim_elements * sizeof(harp_interpolation_weight), __FILE__, __LINE__);
+            goto error;
+        }
+    }
+    if (info->need_loglog_weights)
+    {
+        loglog_weight = malloc(target_grid_max_dim_elements * sizeof(harp_interpolation_weight));
+        if (loglog_weight == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           target_grid_max_dim_elements * sizeof(harp_interpolation_weight), __FILE__, __LINE__);
+            goto error;
+        }
+    }
+    if (info->need_interval_weights)
+    {
+        interval_offset = malloc((target_grid_max_dim_elements + 1) * sizeof(long));
+        if (interval_offset == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (target_grid_max_dim_elements + 1) * sizeof(long), __FILE__, __LINE__);
+            goto error;
+        }
+    }
+
+    for (g = regrid->first_grid; g < regrid->end_grid; g++)
+    {
+        long source_time_index = info->source_grid_num_dims == 2 ? g : 0;
+        long target_time_index = info->target_grid_num_dims == 2 ? g : 0;
+        double *source_grid_data =
+            &info->source_grid->data.double_data[source_time_index * source_grid_max_dim_elements];
+        double *target_grid_data =
+            &info->local_target_grid->data.double_data[target_time_index * target_grid_max_dim_elements];
+
+        source_grid_num_dim_elements = get_unpadded_length(source_grid_data, source_grid_max_dim_elements);
+        target_grid_num_dim_elements =
+            get_unpadded_length(&info->target_grid->data.double_data[target_time_index * target_grid_max_dim_elements],
+                                target_grid_max_dim_elements);
+
+        if (info->need_linear_weights)
+        {
+            harp_interpolate_weights_linear(source_grid_num_dim_elements, source_grid_data,
+                                            target_grid_num_dim_elements, target_grid_data, info->out_of_bound_flag,
+                                            linear_weight);
+        }
+        if (info->need_loglog_weights)
+        {
+            harp_interpolate_weights_logloglinear(source_grid_num_dim_elements, source_grid_data,
+                                                  target_grid_num_dim_elements, target_grid_data,
+                                                  info->out_of_bound_flag, loglog_weight);
+        }
+        if (info->need_interval_weights)
+        {
+            double *source_bounds_data =
+                &info->source_bounds->data.double_data[source_time_index * source_grid_max_dim_elements * 2];
+            double *target_bounds_data =
+                &info->local_target_bounds->data.double_data[target_time_index * target_grid_max_dim_elements * 2];
+
+            if (harp_interval_interpolate_weights_linear(source_grid_num_dim_elements, source_bounds_data,
+                                                         target_grid_num_dim_elements, target_bounds_data,
+                                                         interval_offset, &max_num_interval_weights,
+                                                         &interval_source_index, &interval_weight) != 0)
+            {
+                goto error;
+            }
+        }
+
+        /* regrid the part of each variable that uses this grid */
+        for (i = product->num_variables - 1; i >= 0; i--)
+        {
+            long num_blocks;
+            long num_elements;
+            long first_block;
+            long end_block;
+            long j;
+
+            if (info->variable_type[i] == resample_skip)
+            {
+                continue;
+            }
+            variable = product->variable[i];
+
+            /* treat variable as a [num_blocks, source_max_dim_elements, num_elements] array with indices [j,k,l] */
+            get_regrid_layout(variable, info->dimension_type, &num_blocks, &num_elements);
+
+            /* with multiple grids the variable starts with a time dimension, and num_blocks can capture more than
+             * just the time dimension */
+            num_blocks /= info->num_grids;
+            first_block = g * num_blocks + num_blocks * regrid->part / regrid->num_parts;
+            end_block = g * num_blocks + num_blocks * (regrid->part + 1) / regrid->num_parts;
+            for (j = first_block; j < end_block; j++)
+            {
+                double *block = &variable->data.double_data[j * source_max_dim_elements * num_elements];
+                long k;
+
+                /* regrid all num_elements profiles of the block at once; the profiles are interleaved in the
+                 * variable data, and the result is written in place (hence the copy of the source profiles) */
+                memcpy(source_buffer, block, source_grid_num_dim_elements * num_elements * sizeof(double));
+                if (info->variable_type[i] == resample_linear)
+                {
+                    harp_interpolate_profiles_linear_with_weights(target_grid_num_dim_elements, linear_weight,
+                                                                  num_elements, source_buffer, block);
+                }
+                else if (info->variable_type[i] == resample_loglog)
+                {
+                    harp_interpolate_profiles_logloglinear_with_weights(target_grid_num_dim_elements, loglog_weight,
+                                                                        num_elements, source_buffer, block);
+                }
+                else
+                {
+                    harp_interval_interpolate_profiles_linear_with_weights(target_grid_num_dim_elements,
+                                                                           interval_offset, interval_source_index,
+                                                                           interval_weight, num_elements,
+                                                                           source_buffer, block);
+                }
+                for (k = target_grid_num_dim_elements * num_elements; k < target_grid_max_dim_elements * num_elements;
+                     k++)
+                {
+                    block[k] = nan_value;
+                }
+            }
+        }
+    }
+
+    free(source_buffer);
+    free(linear_weight);
+    free(loglog_weight);
+    free(interval_offset);
+    free(interval_source_index);
+    free(interval_weight);
+
+    return 0;
+
+  error:
+    free(source_buffer);
+    free(linear_weight);
+    free(loglog_weight);
+    free(interval_offset);
+    free(interval_source_index);
+    free(interval_weight);
+
+    return -1;
+}
+
+/* shared data for preparing the variables of a product for regridding in parallel */
+typedef struct prepare_info_struct
+{
+    harp_product *product;
+    const resample_type *variable_type;
+    long num_time_elements;     /* length of the time dimension to add to time independent variables (0 for none) */
+} prepare_info;
+
+static int prepare_variable(void *arg, long index)
+{
+    prepare_info *info = (prepare_info *)arg;
+    harp_variable *variable = info->product->variable[index];
+
+    if (info->variable_type[index] == resample_skip)
+    {
+        return 0;
+    }
+
+    /* Ensure that the variable data consists of doubles */
+    if (variable->data_type != harp_type_double && harp_variable_convert_data_type(variable, harp_type_double) != 0)
+    {
+        return -1;
+    }
+
+    /* the variable data gets regridded in place */
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
+
+    if (info->num_time_elements > 0 && variable->dimension_type[0] != harp_dimension_time)
+    {
+        if (harp_variable_add_dimension(variable, 0, harp_dimension_time, info->num_time_elements) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* weights for regridding one horizontal axis, stored per target cell in compressed row format:
+ * target cell i gets contributions weight[k] * source[index[k]] for k in [offset[i], offset[i + 1]) */
+typedef struct spatial_axis_weights_struct
+{
+    long num_cells;
+    long *offset;
+    long *index;
+    double *weight;
+} spatial_axis_weights;
+
+/* shared (read-only) state for the spatial regridding of the variables of a product */
+typedef struct regrid_spatial_info_struct
+{
+    harp_product *product;
+    const resample_type *variable_type;
+    const spatial_axis_weights *latitude_weights;
+    const spatial_axis_weights *longitude_weights;
+} regrid_spatial_info;
+
+static resample_type get_spatial_resample_type(harp_variable *variable)
+{
+    int num_latitude_dims = 0;
+    int num_longitude_dims = 0;
+    int i;
+
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        if (variable->dimension_type[i] == harp_dimension_latitude)
+        {
+            num_latitude_dims++;
+        }
+        else if (variable->dimension_type[i] == harp_dimension_longitude)
+        {
+            num_longitude_dims++;
+        }
+    }
+
+    if (num_latitude_dims == 0 && num_longitude_dims == 0)
+    {
+        /* if the variable has no horizontal dimension, we should always skip */
+        return resample_skip;
+    }
+
+    /* remove all variables with more than one latitude or longitude dimension */
+    if (num_latitude_dims > 1 || num_longitude_dims > 1)
+    {
+        return resample_remove;
+    }
+
+    /* we can't resample strings, enumeration values, or data without a unit */
+    if (variable->data_type == harp_type_string || variable->num_enum_values > 0 || variable->unit == NULL)
+    {
+        return resample_remove;
+    }
+
+    /* uncertainty propagation needs to be handled differently (remove for now) */
+    if (strstr(variable->name, "_uncertainty") != NULL)
+    {
+        return resample_remove;
+    }
+
+    /* we can't resample averaging kernels */
+    if (strstr(variable->name, "_avk") != NULL)
+    {
+        return resample_remove;
+    }
+
+    /* the latitude/longitude axis variables are replaced by the target grid */
+    if (strstr(variable->name, "latitude") != NULL || strstr(variable->name, "longitude") != NULL)
+    {
+        return resample_remove;
+    }
+
+    if (strstr(variable->name, "angle") != NULL || strstr(variable->name, "direction") != NULL)
+    {
+        return resample_angle;
+    }
+
+    return resample_linear;
+}
+
+static int check_spatial_regrid_grid(long num_latitude_edges, const double *latitude_edges, long num_longitude_edges,
+                                     const double *longitude_edges)
+{
+    long i;
+
+    if (num_latitude_edges < 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "need at least 2 latitude edges to perform spatial regridding");
+        return -1;
+    }
+    if (num_longitude_edges < 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "need at least 2 longitude edges to perform spatial regridding");
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges; i++)
+    {
+        if (latitude_edges[i] < -90.0 || latitude_edges[i] > 90.0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "latitude edge value (%lf) needs to be in the range [-90,90] "
+                           "for spatial regridding", latitude_edges[i]);
+            return -1;
+        }
+        if (i > 0 && latitude_edges[i] <= latitude_edges[i - 1])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
+                           "latitude edge values need to be in strict ascending order for spatial regridding");
+            return -1;
+        }
+    }
+    for (i = 1; i < num_longitude_edges; i++)
+    {
+        if (longitude_edges[i] <= longitude_edges[i - 1])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
+                           "longitude edge values need to be in strict ascending order for spatial regridding");
+            return -1;
+        }
+    }
+    if (longitude_edges[num_longitude_edges - 1] - longitude_edges[0] > 360)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "longitude edge range (%lf .. %lf) cannot exceed 360 degrees",
+                       longitude_edges[0], longitude_edges[num_longitude_edges - 1]);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Return the area weight of the overlap of the source and target latitude ranges.
+ * Since the area of a lat/lon cell is proportional to the difference of the sine of its latitude edges, this is the
+ * overlap of both ranges in sin(latitude).
+ */
+static double get_latitude_overlap(double source_lower, double source_upper, double target_lower,
+                                   double target_upper)
+{
+    double lower;
+    double upper;
+
+    if (source_lower > source_upper)
+    {
+        double swap = source_lower;
+
+        source_lower = source_upper;
+        source_upper = swap;
+    }
+    /* bounds that are extrapolated from the midpoints can end up beyond the poles */
+    if (source_lower < -90.0)
+    {
+        source_lower = -90.0;
+    }
+    if (source_upper > 90.0)
+    {
+        source_upper = 90.0;
+    }
+
+    lower = source_lower > target_lower ? source_lower : target_lower;
+    upper = source_upper < target_upper ? source_upper : target_upper;
+    if (upper <= lower)
+    {
+        return 0;
+    }
+
+    return sin(upper * CONST_DEG2RAD) - sin(lower * CONST_DEG2RAD);
+}
+
+/* Return the overlap (in degrees) of the source and target longitude ranges, taking the wrap-around at 360 degrees
+ * into account.
+ */
+static double get_longitude_overlap(double source_lower, double source_upper, double target_lower,
+                                    double target_upper)
+{
+    double overlap = 0;
+    double width;
+    double shift;
+
+    if (source_lower > source_upper)
+    {
+        double swap = source_lower;
+
+        source_lower = source_upper;
+        source_upper = swap;
+    }
+    width = source_upper - source_lower;
+    if (width > 360.0)
+    {
+        width = 360.0;
+    }
+
+    /* start with the first shifted copy of the source range that ends after the start of the target range */
+    shift = 360.0 * ceil((target_lower - source_upper) / 360.0);
+    for (source_lower += shift; source_lower < target_upper; source_lower += 360.0)
+    {
+        double lower = source_lower > target_lower ? source_lower : target_lower;
+        double upper = source_lower + width < target_upper ? source_lower + width : target_upper;
+
+        if (upper > lower)
+        {
+            overlap += upper - lower;
+        }
+    }
+
+    return overlap;
+}
+
+static void spatial_axis_weights_delete(spatial_axis_weights *weights)
+{
+    if (weights != NULL)
+    {
+        if (weights->offset != NULL)
+        {
+            free(weights->offset);
+        }
+        if (weights->index != NULL)
+        {
+            free(weights->index);
+        }
+        if (weights->weight != NULL)
+        {
+            free(weights->weight);
+        }
+        free(weights);
+    }
+}
+
+/* Calculate the conservative (area overlap) weights of the source cells (given by source_bounds [num_source_cells,2])
+ * for each of the target cells (given by the num_edges ascending target edges).
+ */
+static int spatial_axis_weights_new(const harp_variable *source_bounds, long num_edges, const double *edges,
+                                    harp_dimension_type dimension_type, spatial_axis_weights **new_weights)
+{
+    spatial_axis_weights *weights;
+    const double *bounds = source_bounds->data.double_data;
+    long num_source_cells = source_bounds->dimension[0];
+    long num_weights;
+    int pass;
+    long i, j;
+
+    weights = malloc(sizeof(spatial_axis_weights));
+    if (weights == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(spatial_axis_weights), __FILE__, __LINE__);
+        return -1;
+    }
+    weights->num_cells = num_edges - 1;
+    weights->offset = NULL;
+    weights->index = NULL;
+    weights->weight = NULL;
+
+    weights->offset = malloc(num_edges * sizeof(long));
+    if (weights->offset == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_edges * sizeof(long), __FILE__, __LINE__);
+        spatial_axis_weights_delete(weights);
+        return -1;
+    }
+
+    /* the first pass counts the non-zero weights, the second pass stores them */
+    for (pass = 0; pass < 2; pass++)
+    {
+        num_weights = 0;
+        for (i = 0; i < weights->num_cells; i++)
+        {
+            weights->offset[i] = num_weights;
+            for (j = 0; j < num_source_cells; j++)
+            {
+                double weight;
+
+                if (dimension_type == harp_dimension_latitude)
+                {
+                    weight = get_latitude_overlap(bounds[2 * j], bounds[2 * j + 1], edges[i], edges[i + 1]);
+                }
+                else
+                {
+                    weight = get_longitude_overlap(bounds[2 * j], bounds[2 * j + 1], edges[i], edges[i + 1]);
+                }
+                if (weight > 0)
+                {
+                    if (pass == 1)
+                    {
+                        weights->index[num_weights] = j;
+                        weights->weight[num_weights] = weight;
+                    }
+                    num_weights++;
+                }
+            }
+        }
+        weights->offset[weights->num_cells] = num_weights;
+
+        if (pass == 0 && num_weights > 0)
+        {
+            weights->index = malloc(num_weights * sizeof(long));
+            if (weights->index == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_weights * sizeof(long), __FILE__, __LINE__);
+                spatial_axis_weights_delete(weights);
+                return -1;
+            }
+            weights->weight = malloc(num_weights * sizeof(double));
+            if (weights->weight == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_weights * sizeof(double), __FILE__, __LINE__);
+                spatial_axis_weights_delete(weights);
+                return -1;
+            }
+        }
+    }
+
+    *new_weights = weights;
+    return 0;
+}
+
+/* Regrid a [num_blocks, <first axis>, num_middle, <second axis>, num_elements] array from source to target.
+ * Each target value is the weighted average of all non-NaN source values using the product of the weights of both
+ * axes. Since the weights are separable, this is calculated as two consecutive weighted sums (first along the second
+ * axis and then along the first axis) for both the weighted values and the weights of the non-NaN values.
+ * If second_weights is NULL then the array only has a single horizontal axis (and the second axis has length 1).
+ * The buffer should be able to hold 2 * num_blocks * first_length * num_middle * <second target length> *
+ * num_elements values.
+ */
+static void regrid_spatial_array(long num_blocks, long first_length, const spatial_axis_weights *first_weights,
+                                 long num_middle, long second_length, const spatial_axis_weights *second_weights,
+                                 long num_elements, const double *source, double *buffer, double *target)
+{
+    long num_second_cells = second_weights == NULL ? 1 : second_weights->num_cells;
+    long num_rows = num_blocks * first_length * num_middle;
+    long block_length = num_middle * num_second_cells * num_elements;
+    long num_partial = num_rows * num_second_cells * num_elements;
+    double *partial_sum = buffer;
+    double *partial_weight = &buffer[num_partial];
+    long row, i, k, l;
+
+    /* weighted sum along the second axis */
+    for (row = 0; row < num_rows; row++)
+    {
+        const double *source_row = &source[row * second_length * num_elements];
+
+        for (i = 0; i < num_second_cells; i++)
+        {
+            double *sum = &partial_sum[(row * num_second_cells + i) * num_elements];
+            double *weight = &partial_weight[(row * num_second_cells + i) * num_elements];
+
+            if (second_weights == NULL)
+            {
+                for (l = 0; l < num_elements; l++)
+                {
+                    double value = source_row[l];
+
+                    sum[l] = harp_isnan(value) ? 0 : value;
+                    weight[l] = harp_isnan(value) ? 0 : 1;
+                }
+                continue;
+            }
+
+            for (l = 0; l < num_elements; l++)
+            {
+                sum[l] = 0;
+                weight[l] = 0;
+            }
+            for (k = second_weights->offset[i]; k < second_weights->offset[i + 1]; k++)
+            {
+                const double *value = &source_row[second_weights->index[k] * num_elements];
+                double w = second_weights->weight[k];
+
+                for (l = 0; l < num_elements; l++)
+                {
+                    if (!harp_isnan(value[l]))
+                    {
+                        sum[l] += w * value[l];
+                        weight[l] += w;
+                    }
+                }
+            }
+        }
+    }
+
+    /* weighted sum along the first axis (using the sum of the weights of the second target axis as denominator) */
+    for (row = 0; row < num_blocks; row++)
+    {
+        for (i = 0; i < first_weights->num_cells; i++)
+        {
+            double *value = &target[(row * first_weights->num_cells + i) * block_length];
+            double total_weight;
+
+            for (l = 0; l < block_length; l++)
+            {
+                double sum = 0;
+
+                total_weight = 0;
+                for (k = first_weights->offset[i]; k < first_weights->offset[i + 1]; k++)
+                {
+                    long offset = (row * first_length + first_weights->index[k]) * block_length + l;
+
+                    sum += first_weights->weight[k] * partial_sum[offset];
+                    total_weight += first_weights->weight[k] * partial_weight[offset];
+                }
+                value[l] = total_weight > 0 ? sum / total_weight : harp_nan();
+            }
+        }
+    }
+}
+
+static int regrid_spatial_variable(void *arg, long index)
+{
+    regrid_spatial_info *info = (regrid_spatial_info *)arg;
+    harp_variable *variable = info->product->variable[index];
+    const spatial_axis_weights *first_weights = NULL;
+    const spatial_axis_weights *second_weights = NULL;
+    harp_variable *new_variable = NULL;
+    long dimension[HARP_MAX_NUM_DIMS];
+    long num_blocks = 1;
+    long first_length = 0;
+    long num_middle = 1;
+    long second_length = 1;
+    long num_elements = 1;
+    long num_buffer_elements;
+    double *source = NULL;
+    double *buffer = NULL;
+    int i;
+
+    if (info->variable_type[index] == resample_skip)
+    {
+        return 0;
     }
-    strcpy(bounds_name, grid->name);
-    strcat(bounds_name, "_bounds");
+    assert(info->variable_type[index] == resample_linear || info->variable_type[index] == resample_angle);
 
-    if (harp_product_get_derived_variable(product, bounds_name, &grid->data_type, grid->unit, grid->num_dimensions + 1,
-                                          dim_type, bounds) != 0)
+    /* Ensure that the variable data consists of doubles */
+    if (variable->data_type != harp_type_double && harp_variable_convert_data_type(variable, harp_type_double) != 0)
     {
-        free(bounds_name);
         return -1;
     }
-    free(bounds_name);
 
-    return 0;
-}
+    /* determine the layout as [num_blocks, <first axis>, num_middle, <second axis>, num_elements] */
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        const spatial_axis_weights *weights = NULL;
 
-static int get_bounds_for_grid_from_variable(harp_variable *grid, harp_variable **bounds)
-{
-    harp_product *product = NULL;
+        dimension[i] = variable->dimension[i];
+        if (variable->dimension_type[i] == harp_dimension_latitude)
+        {
+            weights = info->latitude_weights;
+        }
+        else if (variable->dimension_type[i] == harp_dimension_longitude)
+        {
+            weights = info->longitude_weights;
+        }
+        if (weights != NULL)
+        {
+            dimension[i] = weights->num_cells;
+            if (first_weights == NULL)
+            {
+                first_weights = weights;
+                first_length = variable->dimension[i];
+            }
+            else
+            {
+                second_weights = weights;
+                second_length = variable->dimension[i];
+            }
+        }
+        else if (first_weights == NULL)
+        {
+            num_blocks *= variable->dimension[i];
+        }
+        else if (second_weights == NULL)
+        {
+            num_middle *= variable->dimension[i];
+        }
+        else
+        {
+            num_elements *= variable->dimension[i];
+        }
+    }
+    assert(first_weights != NULL);
+    if (second_weights == NULL)
+    {
+        /* with only one horizontal axis, all trailing dimensions are elements */
+        num_elements = num_middle;
+        num_middle = 1;
+    }
 
-    /* Create a dummy product to allow deriving the bounds for the target grid */
-    if (harp_product_new(&product) != 0)
+    if (harp_variable_new(variable->name, harp_type_double, variable->num_dimensions, variable->dimension_type,
+                          dimension, &new_variable) != 0)
     {
         return -1;
     }
-    if (harp_product_add_variable(product, grid) != 0)
+    if (harp_variable_copy_attributes(variable, new_variable) != 0)
     {
-        harp_product_delete(product);
+        harp_variable_delete(new_variable);
         return -1;
     }
-    if (harp_product_get_derived_bounds_for_grid(product, grid, bounds) != 0)
+
+    num_buffer_elements = 2 * num_blocks * first_length * num_middle *
+        (second_weights == NULL ? 1 : second_weights->num_cells) * num_elements;
+    buffer = malloc((size_t)num_buffer_elements * sizeof(double));
+    if (buffer == NULL)
     {
-        if (harp_product_detach_variable(product, grid) == 0)
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (size_t)num_buffer_elements * sizeof(double), __FILE__, __LINE__);
+        harp_variable_delete(new_variable);
+        return -1;
+    }
+
+    if (info->variable_type[index] == resample_angle)
+    {
+        long num_source_elements = variable->num_elements;
+        long num_target_elements = new_variable->num_elements;
+        long j;
+
+        /* average angles as unit vectors [cos(x),sin(x)]; the source is stored as [cos,sin] followed by the target
+         * [sin] values */
+        source = malloc((size_t)(2 * num_source_elements + num_target_elements) * sizeof(double));
+        if (source == NULL)
         {
-            harp_product_delete(product);
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (size_t)(2 * num_source_elements + num_target_elements) * sizeof(double), __FILE__,
+                           __LINE__);
+            goto error;
+        }
+        memcpy(source, variable->data.double_data, (size_t)num_source_elements * sizeof(double));
+        if (harp_convert_unit(variable->unit, "rad", num_source_elements, source) != 0)
+        {
+            goto error;
+        }
+        for (j = 0; j < num_source_elements; j++)
+        {
+            source[num_source_elements + j] = sin(source[j]);
+            source[j] = cos(source[j]);
+        }
+        regrid_spatial_array(num_blocks, first_length, first_weights, num_middle, second_length, second_weights,
+                             num_elements, source, buffer, new_variable->data.double_data);
+        regrid_spatial_array(num_blocks, first_length, first_weights, num_middle, second_length, second_weights,
+                             num_elements, &source[num_source_elements], buffer, &source[2 * num_source_elements]);
+        for (j = 0; j < num_target_elements; j++)
+        {
+            new_variable->data.double_data[j] = atan2(source[2 * num_source_elements + j],
+                                                      new_variable->data.double_data[j]);
+        }
+        free(source);
+        source = NULL;
+        if (harp_convert_unit("rad", new_variable->unit, num_target_elements, new_variable->data.double_data) != 0)
+        {
+            goto error;
         }
-        return -1;
     }
-    if (harp_product_detach_variable(product, grid) != 0)
+    else
     {
-        /* we can't delete the product since it still contains the grid (which we can't delete) */
-        return -1;
+        regrid_spatial_array(num_blocks, first_length, first_weights, num_middle, second_length, second_weights,
+                             num_elements, variable->data.double_data, buffer, new_variable->data.double_data);
     }
-    harp_product_delete(product);
+    free(buffer);
+
+    /* replace variable in product with new variable */
+    info->product->variable[index] = new_variable;
+    harp_variable_delete(variable);
 
     return 0;
+
+  error:
+    if (source != NULL)
+    {
+        free(source);
+    }
+    free(buffer);
+    harp_variable_delete(new_variable);
+    return -1;
 }
 
 /** \addtogroup harp_product
@@ -324,13 +1185,19 @@ LIBHARP_API int harp_product_regrid_with_axis_variable(harp_product *product, ha
     harp_dimension_type dimension_type;
     long source_max_dim_elements;       /* actual elems + NaN padding */
     long source_grid_max_dim_elements;
-    long source_grid_num_dim_elements;
     long target_grid_max_dim_elements;
-    long target_grid_num_dim_elements;
     long source_num_time_elements;
     int source_grid_num_dims = 1;
     int target_grid_num_dims;
     int out_of_bound_flag;
+    int need_linear_weights = 0;
+    int need_loglog_weights = 0;
+    int need_interval_weights = 0;
+    long num_regrid_elements = 0;
+    long max_num_elements = 1;
+    prepare_info prepare;
+    regrid_info info;
+    int num_tasks;
     harp_variable *variable;
     long i;
 
@@ -339,8 +1206,9 @@ LIBHARP_API int harp_product_regrid_with_axis_variable(harp_product *product, ha
     harp_variable *source_bounds = NULL;
     harp_variable *local_target_grid = NULL;
     harp_variable *local_target_bounds = NULL;
-    double *source_buffer = NULL;
-    double *target_buffer = NULL;
+    resample_type *variable_type = NULL;
+    regrid_task *regrid = NULL;
+    harp_task *task = NULL;
 
     out_of_bound_flag = harp_get_option_regrid_out_of_bounds();
 
@@ -511,6 +1379,15 @@ LIBHARP_API int harp_product_regrid_with_axis_variable(harp_product *product, ha
     /* Use loglin interpolation if vertical pressure grid */
     if (dimension_type == harp_dimension_vertical && strcmp(local_target_grid->name, "pressure") == 0)
     {
+        /* the derived source grid and bounds can share their data (e.g. with a derivation session) */
+        if (harp_variable_make_data_owned(source_grid) != 0)
+        {
+            goto error;
+        }
+        if (source_bounds != NULL && harp_variable_make_data_owned(source_bounds) != 0)
+        {
+            goto error;
+        }
         for (i = 0; i < source_grid->num_elements; i++)
         {
             source_grid->data.double_data[i] = log(source_grid->data.double_data[i]);
@@ -545,161 +1422,135 @@ LIBHARP_API int harp_product_regrid_with_axis_variable(harp_product *product, ha
         source_max_dim_elements = target_grid_max_dim_elements;
     }
 
-    /* allocate the buffers for the interpolation */
-    source_buffer = (double *)malloc(source_max_dim_elements * (size_t)sizeof(double));
-    if (source_buffer == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       source_max_dim_elements * sizeof(double), __FILE__, __LINE__);
-        goto error;
-    }
-    target_buffer = (double *)malloc(target_grid_max_dim_elements * (size_t)sizeof(double));
-    if (target_buffer == NULL)
+    variable_type = malloc(product->num_variables * sizeof(resample_type));
+    if (variable_type == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       target_grid_max_dim_elements * sizeof(double), __FILE__, __LINE__);
+                       product->num_variables * sizeof(resample_type), __FILE__, __LINE__);
         goto error;
     }
 
-    /* regrid each variable */
-    for (i = product->num_variables - 1; i >= 0; i--)
+    /* prepare each variable for regridding */
+    for (i = 0; i < product->num_variables; i++)
     {
         resample_type type;
-        long source_time_index;
-        long target_time_index;
         long num_blocks;
         long num_elements;
-        long j;
 
         variable = product->variable[i];
 
         /* Check if we can resample this kind of variable */
         type = get_resample_type(variable, dimension_type);
+        variable_type[i] = type;
 
         assert(type != resample_remove);
         if (type == resample_skip)
         {
             continue;
         }
-
-        /* Ensure that the variable data consists of doubles */
-        if (variable->data_type != harp_type_double && harp_variable_convert_data_type(variable, harp_type_double) != 0)
+        num_regrid_elements += variable->num_elements;
+        get_regrid_layout(variable, dimension_type, &num_blocks, &num_elements);
+        if (num_elements > max_num_elements)
         {
-            goto error;
+            max_num_elements = num_elements;
         }
-
-        /* Make time independent variables time dependent if source grid or target grid is 2D (i.e. time dependent) */
-        if (source_grid_num_dims > 1 || target_grid_num_dims > 1)
+        if (type == resample_linear)
         {
-            if (variable->dimension_type[0] != harp_dimension_time)
-            {
-                if (harp_variable_add_dimension(variable, 0, harp_dimension_time, source_num_time_elements) != 0)
-                {
-                    return -1;
-                }
-            }
+            need_linear_weights = 1;
         }
-
-        /* treat variable as a [num_blocks, source_max_dim_elements, num_elements] array with indices [j,k,l] */
-        num_blocks = 1;
-        num_elements = 1;
-        j = 0;
-        assert(variable->num_dimensions > 0);
-        while (variable->dimension_type[j] != dimension_type)
+        else if (type == resample_loglog)
         {
-            assert(j < variable->num_dimensions - 1);
-            num_blocks *= variable->dimension[j];
-            j++;
+            need_loglog_weights = 1;
         }
-        j++;    /* skip dimension that is going to be regridded */
-        while (j < variable->num_dimensions)
+        else if (type == resample_interval)
         {
-            num_elements *= variable->dimension[j];
-            j++;
+            need_interval_weights = 1;
         }
-
-        /* interpolate the data of the variable over the given dimension */
-        /* keep track of time index separately since num_blocks can capture more than just the time dimension */
-        source_time_index = 0;
-        target_time_index = 0;
-        source_grid_num_dim_elements = get_unpadded_length(source_grid->data.double_data, source_grid_max_dim_elements);
-        target_grid_num_dim_elements = get_unpadded_length(target_grid->data.double_data, target_grid_max_dim_elements);
-        for (j = 0; j < num_blocks; j++)
+        else
         {
-            long k, l;
+            /* other resampling methods are not supported, but should also never be set */
+            assert(0);
+            exit(1);
+        }
 
-            /* keep track of time index for 2D grids */
-            if (j % (num_blocks / source_num_time_elements) == 0)
-            {
-                if (source_grid_num_dims == 2 && j > 0)
-                {
-                    source_time_index++;
-                    source_grid_num_dim_elements =
-                        get_unpadded_length(&source_grid->data.double_data[source_time_index *
-                                                                           source_grid_max_dim_elements],
-                                            source_grid_max_dim_elements);
-                }
-                if (target_grid_num_dims == 2 && j > 0)
-                {
-                    target_time_index++;
-                    target_grid_num_dim_elements =
-                        get_unpadded_length(&target_grid->data.double_data[target_time_index *
-                                                                           target_grid_max_dim_elements],
-                                            target_grid_max_dim_elements);
-                }
-            }
+    }
 
-            for (l = 0; l < num_elements; l++)
-            {
-                /* we need to regrid by taking a slice for each sub element 'l' */
-                for (k = 0; k < source_grid_num_dim_elements; k++)
-                {
-                    source_buffer[k] = variable->data.double_data[(j * source_max_dim_elements + k) * num_elements + l];
-                }
-                if (type == resample_linear)
-                {
-                    harp_interpolate_array_linear
-                        (source_grid_num_dim_elements,
-                         &source_grid->data.double_data[source_time_index * source_grid_max_dim_elements],
-                         source_buffer, target_grid_num_dim_elements,
-                         &local_target_grid->data.double_data[target_time_index * target_grid_max_dim_elements],
-                         out_of_bound_flag, target_buffer);
-                }
-                else if (type == resample_loglog)
-                {
-                    harp_interpolate_array_logloglinear
-                        (source_grid_num_dim_elements,
-                         &source_grid->data.double_data[source_time_index * source_grid_max_dim_elements],
-                         source_buffer, target_grid_num_dim_elements,
-                         &local_target_grid->data.double_data[target_time_index * target_grid_max_dim_elements],
-                         out_of_bound_flag, target_buffer);
-                }
-                else if (type == resample_interval)
-                {
-                    harp_interval_interpolate_array_linear
-                        (source_grid_num_dim_elements,
-                         &source_bounds->data.double_data[source_time_index * source_grid_max_dim_elements * 2],
-                         source_buffer, target_grid_num_dim_elements,
-                         &local_target_bounds->data.double_data[target_time_index * target_grid_max_dim_elements * 2],
-                         target_buffer);
-                }
-                else
-                {
-                    /* other resampling methods are not supported, but should also never be set */
-                    assert(0);
-                    exit(1);
-                }
+    /* convert the data of the variables to double and make time independent variables time dependent if the source
+     * grid or target grid is 2D (i.e. time dependent); this is done for all variables in parallel */
+    prepare.product = product;
+    prepare.variable_type = variable_type;
+    prepare.num_time_elements = (source_grid_num_dims > 1 || target_grid_num_dims > 1) ? source_num_time_elements : 0;
+    if (harp_run_for_each(product->num_variables, num_regrid_elements, MIN_NUM_ELEMENTS_PER_THREAD, prepare_variable,
+                          &prepare) != 0)
+    {
+        goto error;
+    }
 
-                for (k = 0; k < target_grid_num_dim_elements; k++)
-                {
-                    variable->data.double_data[(j * source_max_dim_elements + k) * num_elements + l] = target_buffer[k];
-                }
-                for (k = target_grid_num_dim_elements; k < target_grid_max_dim_elements; k++)
-                {
-                    variable->data.double_data[(j * source_max_dim_elements + k) * num_elements + l] = harp_nan();
-                }
-            }
+    info.product = product;
+    info.variable_type = variable_type;
+    info.dimension_type = dimension_type;
+    info.source_grid = source_grid;
+    info.source_bounds = source_bounds;
+    info.target_grid = target_grid;
+    info.local_target_grid = local_target_grid;
+    info.local_target_bounds = local_target_bounds;
+    info.source_grid_num_dims = source_grid_num_dims;
+    info.target_grid_num_dims = target_grid_num_dims;
+    info.source_grid_max_dim_elements = source_grid_max_dim_elements;
+    info.target_grid_max_dim_elements = target_grid_max_dim_elements;
+    info.source_max_dim_elements = source_max_dim_elements;
+    info.max_num_elements = max_num_elements;
+    info.out_of_bound_flag = out_of_bound_flag;
+    info.need_linear_weights = need_linear_weights;
+    info.need_loglog_weights = need_loglog_weights;
+    info.need_interval_weights = need_interval_weights;
+
+    /* a time dependent source or target grid provides a separate grid for each time sample */
+    info.num_grids = (source_grid_num_dims == 2 || target_grid_num_dims == 2) ? source_num_time_elements : 1;
+
+    /* each task regrids either a range of the grids, or (if there is only one grid) a part of the blocks */
+    num_tasks = harp_get_num_tasks(num_regrid_elements, MIN_NUM_ELEMENTS_PER_THREAD);
+    if (info.num_grids > 1 && num_tasks > info.num_grids)
+    {
+        num_tasks = (int)info.num_grids;
+    }
+    regrid = malloc(num_tasks * sizeof(regrid_task));
+    if (regrid == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(regrid_task), __FILE__, __LINE__);
+        goto error;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        goto error;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        regrid[i].info = &info;
+        if (info.num_grids > 1)
+        {
+            regrid[i].first_grid = info.num_grids * i / num_tasks;
+            regrid[i].end_grid = info.num_grids * (i + 1) / num_tasks;
+            regrid[i].part = 0;
+            regrid[i].num_parts = 1;
         }
+        else
+        {
+            regrid[i].first_grid = 0;
+            regrid[i].end_grid = 1;
+            regrid[i].part = i;
+            regrid[i].num_parts = num_tasks;
+        }
+        task[i].function = regrid_task_run;
+        task[i].arg = &regrid[i];
+    }
+    if (harp_run_tasks(num_tasks, task) != 0)
+    {
+        goto error;
     }
 
     /* Resize the dimension in the target product to minimal size */
@@ -740,8 +1591,9 @@ LIBHARP_API int harp_product_regrid_with_axis_variable(harp_product *product, ha
     harp_variable_delete(source_bounds);
     harp_variable_delete(local_target_grid);
     harp_variable_delete(local_target_bounds);
-    free(source_buffer);
-    free(target_buffer);
+    free(variable_type);
+    free(regrid);
+    free(task);
 
     return 0;
 
@@ -750,8 +1602,9 @@ LIBHARP_API int harp_product_regrid_with_axis_variable(harp_product *product, ha
     harp_variable_delete(source_bounds);
     harp_variable_delete(local_target_grid);
     harp_variable_delete(local_target_bounds);
-    free(source_buffer);
-    free(target_buffer);
+    free(variable_type);
+    free(regrid);
+    free(task);
 
     return -1;
 }
@@ -961,24 +1814,17 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
         return -1;
     }
 
-    /* copy the collocation result for filtering */
-    if (harp_collocation_result_shallow_copy(collocation_result, &filtered_collocation_result) != 0)
-    {
-        return -1;
-    }
-
-    /* reduce the collocation result to only pairs that include the source product */
-    if (harp_collocation_result_filter_for_collocation_indices(filtered_collocation_result,
-                                                               collocation_index->num_elements,
-                                                               collocation_index->data.int32_data) != 0)
+    /* get a view on the pairs of the collocation result that include the source product */
+    if (harp_collocation_result_get_view_for_collocation_indices(collocation_result, collocation_index->num_elements,
+                                                                 collocation_index->data.int32_data,
+                                                                 &filtered_collocation_result) != 0)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
         return -1;
     }
     if (filtered_collocation_result->num_pairs != collocation_index->num_elements)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product and collocation result are inconsistent");
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -995,7 +1841,7 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
                                                            &collocated_product) != 0)
         {
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1016,21 +1862,21 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
                 harp_add_error_message(" for collocated dataset");
                 harp_product_delete(collocated_product);
                 harp_product_delete(merged_product);
-                harp_collocation_result_shallow_delete(filtered_collocation_result);
+                harp_collocation_result_view_delete(filtered_collocation_result);
                 return -1;
             }
             if (harp_product_get_variable_by_name(collocated_product, axis_name, &target_grid) != 0)
             {
                 harp_product_delete(collocated_product);
                 harp_product_delete(merged_product);
-                harp_collocation_result_shallow_delete(filtered_collocation_result);
+                harp_collocation_result_view_delete(filtered_collocation_result);
                 return -1;
             }
             if (harp_variable_add_dimension(target_grid, 1, dimension_type, 1) != 0)
             {
                 harp_product_delete(collocated_product);
                 harp_product_delete(merged_product);
-                harp_collocation_result_shallow_delete(filtered_collocation_result);
+                harp_collocation_result_view_delete(filtered_collocation_result);
                 return -1;
             }
             collocated_product->dimension[dimension_type] = 1;
@@ -1046,7 +1892,7 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
             harp_add_error_message(" for collocated dataset");
             harp_product_delete(collocated_product);
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1067,7 +1913,7 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
                 {
                     harp_product_delete(collocated_product);
                     harp_product_delete(merged_product);
-                    harp_collocation_result_shallow_delete(filtered_collocation_result);
+                    harp_collocation_result_view_delete(filtered_collocation_result);
                     return -1;
                 }
             }
@@ -1084,7 +1930,7 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
                 harp_add_error_message(" for collocated dataset");
                 harp_product_delete(collocated_product);
                 harp_product_delete(merged_product);
-                harp_collocation_result_shallow_delete(filtered_collocation_result);
+                harp_collocation_result_view_delete(filtered_collocation_result);
                 return -1;
             }
             harp_product_delete(collocated_product);
@@ -1093,7 +1939,7 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
 
     if (merged_product == NULL)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocated dataset does not contain any matching pairs");
         return -1;
     }
@@ -1104,7 +1950,7 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
     {
         harp_add_error_message(" for collocated dataset");
         harp_product_delete(merged_product);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -1116,15 +1962,230 @@ LIBHARP_API int harp_product_regrid_with_collocated_dataset(harp_product *produc
     if (harp_product_regrid_with_axis_variable(product, target_grid, target_bounds) != 0)
     {
         harp_product_delete(merged_product);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
     /* cleanup */
     harp_product_delete(merged_product);
-    harp_collocation_result_shallow_delete(filtered_collocation_result);
+    harp_collocation_result_view_delete(filtered_collocation_result);
+
+    return 0;
+}
+
+/**
+ * Regrid the product's variables from its latitude/longitude grid to a new latitude/longitude grid.
+ * The target grid will have 'num_latitude_edges-1' latitudes and 'num_longitude_edges-1' longitudes.
+ * The latitude_edges and longitude_edges arrays provide the boundaries of the grid cells in degrees and need to be
+ * provided in a strict ascending order. The latitude edge values need to be between -90 and 90 and for the longitude
+ * edge values the constraint is that the difference between the last and first edge should be <= 360.
+ *
+ * The product should have both a latitude and a longitude dimension. The source grid cells are determined by
+ * performing a variable derivation of latitude_bounds {latitude,2} and longitude_bounds {longitude,2} on the product
+ * (which, if needed, will derive the bounds from the latitude {latitude} and longitude {longitude} midpoints).
+ *
+ * The regridding is area conservative: each target cell will be the area weighted average of all source cells that
+ * overlap with it, where the overlap is calculated independently for the latitude (using the sine of the latitude) and
+ * longitude axis. The weights for both axes are calculated once and then applied to all variables that have a latitude
+ * and/or longitude dimension (other dimensions are retained). Source values that are NaN are excluded from the average
+ * (and target cells that have no overlapping valid values will be set to NaN).
+ *
+ * Variables with a latitude and/or longitude dimension will be removed if they have no unit, use a string data type,
+ * have enumeration values, are uncertainty or averaging kernel variables, or have more than one latitude or longitude
+ * dimension. All latitude and longitude variables will be removed and latitude_bounds {latitude,2} and
+ * longitude_bounds {longitude,2} variables for the target grid will be added.
+ * Angle variables (with 'angle' or 'direction' in their name) are averaged as unit vectors.
+ * All regridded variables are converted to a double data type.
+ *
+ * \param product Product to regrid.
+ * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
+ * \param latitude_edges latitude grid edge vales
+ * \param num_longitude_edges Number of edges for the longitude grid
+ *        (number of longitude columns = num_longitude_edges - 1)
+ * \param longitude_edges longitude grid edge vales
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_regrid_spatial(harp_product *product, long num_latitude_edges,
+                                            const double *latitude_edges, long num_longitude_edges,
+                                            const double *longitude_edges)
+{
+    harp_dimension_type dimension_type[2];
+    long dimension[2];
+    regrid_spatial_info info;
+    spatial_axis_weights *latitude_weights = NULL;
+    spatial_axis_weights *longitude_weights = NULL;
+    harp_variable *source_bounds = NULL;
+    harp_variable *variable;
+    resample_type *variable_type = NULL;
+    long num_regrid_elements = 0;
+    long i;
+    int k;
+
+    if (check_spatial_regrid_grid(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges) != 0)
+    {
+        return -1;
+    }
+    if (product->dimension[harp_dimension_latitude] == 0 || product->dimension[harp_dimension_longitude] == 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product should have a latitude and longitude dimension for "
+                       "spatial regridding");
+        return -1;
+    }
+
+    /* calculate the weights for both axes from the source grid cells */
+    dimension_type[0] = harp_dimension_latitude;
+    dimension_type[1] = harp_dimension_independent;
+    if (harp_product_get_derived_variable(product, "latitude_bounds", NULL, HARP_UNIT_LATITUDE, 2, dimension_type,
+                                          &source_bounds) != 0)
+    {
+        return -1;
+    }
+    if (source_bounds->dimension[1] != 2 || harp_variable_convert_data_type(source_bounds, harp_type_double) != 0 ||
+        spatial_axis_weights_new(source_bounds, num_latitude_edges, latitude_edges, harp_dimension_latitude,
+                                 &latitude_weights) != 0)
+    {
+        if (source_bounds->dimension[1] != 2)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "latitude_bounds should have exactly 2 values per latitude "
+                           "for spatial regridding");
+        }
+        harp_variable_delete(source_bounds);
+        return -1;
+    }
+    harp_variable_delete(source_bounds);
+    source_bounds = NULL;
+
+    dimension_type[0] = harp_dimension_longitude;
+    if (harp_product_get_derived_variable(product, "longitude_bounds", NULL, HARP_UNIT_LONGITUDE, 2, dimension_type,
+                                          &source_bounds) != 0)
+    {
+        spatial_axis_weights_delete(latitude_weights);
+        return -1;
+    }
+    if (source_bounds->dimension[1] != 2 || harp_variable_convert_data_type(source_bounds, harp_type_double) != 0 ||
+        spatial_axis_weights_new(source_bounds, num_longitude_edges, longitude_edges, harp_dimension_longitude,
+                                 &longitude_weights) != 0)
+    {
+        if (source_bounds->dimension[1] != 2)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "longitude_bounds should have exactly 2 values per longitude "
+                           "for spatial regridding");
+        }
+        harp_variable_delete(source_bounds);
+        spatial_axis_weights_delete(latitude_weights);
+        return -1;
+    }
+    harp_variable_delete(source_bounds);
+
+    /* remove all variables that can't be regridded */
+    for (k = product->num_variables - 1; k >= 0; k--)
+    {
+        if (get_spatial_resample_type(product->variable[k]) == resample_remove)
+        {
+            if (harp_product_remove_variable(product, product->variable[k]) != 0)
+            {
+                goto error;
+            }
+        }
+    }
+
+    if (product->num_variables > 0)
+    {
+        variable_type = malloc(product->num_variables * sizeof(resample_type));
+        if (variable_type == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           product->num_variables * sizeof(resample_type), __FILE__, __LINE__);
+            goto error;
+        }
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        variable_type[k] = get_spatial_resample_type(product->variable[k]);
+        if (variable_type[k] != resample_skip)
+        {
+            num_regrid_elements += product->variable[k]->num_elements;
+        }
+    }
+
+    /* regrid all variables using the same weights */
+    info.product = product;
+    info.variable_type = variable_type;
+    info.latitude_weights = latitude_weights;
+    info.longitude_weights = longitude_weights;
+    if (harp_run_for_each(product->num_variables, num_regrid_elements, MIN_NUM_ELEMENTS_PER_THREAD,
+                          regrid_spatial_variable, &info) != 0)
+    {
+        goto error;
+    }
+    product->dimension[harp_dimension_latitude] = num_latitude_edges - 1;
+    product->dimension[harp_dimension_longitude] = num_longitude_edges - 1;
+
+    if (variable_type != NULL)
+    {
+        free(variable_type);
+    }
+    spatial_axis_weights_delete(latitude_weights);
+    spatial_axis_weights_delete(longitude_weights);
+
+    /* add latitude_bounds and longitude_bounds variables for the target grid */
+    dimension_type[0] = harp_dimension_latitude;
+    dimension[0] = num_latitude_edges - 1;
+    dimension_type[1] = harp_dimension_independent;
+    dimension[1] = 2;
+    if (harp_variable_new("latitude_bounds", harp_type_double, 2, dimension_type, dimension, &variable) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        variable->data.double_data[2 * i] = latitude_edges[i];
+        variable->data.double_data[2 * i + 1] = latitude_edges[i + 1];
+    }
+    if (harp_product_add_variable(product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+    if (harp_variable_set_unit(variable, HARP_UNIT_LATITUDE) != 0)
+    {
+        return -1;
+    }
+
+    dimension_type[0] = harp_dimension_longitude;
+    dimension[0] = num_longitude_edges - 1;
+    if (harp_variable_new("longitude_bounds", harp_type_double, 2, dimension_type, dimension, &variable) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        variable->data.double_data[2 * i] = longitude_edges[i];
+        variable->data.double_data[2 * i + 1] = longitude_edges[i + 1];
+    }
+    if (harp_product_add_variable(product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+    if (harp_variable_set_unit(variable, HARP_UNIT_LONGITUDE) != 0)
+    {
+        return -1;
+    }
 
     return 0;
+
+  error:
+    if (variable_type != NULL)
+    {
+        free(variable_type);
+    }
+    spatial_axis_weights_delete(latitude_weights);
+    spatial_axis_weights_delete(longitude_weights);
+    return -1;
 }
 
 /**
@@ -0,0 +1,634 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum number of grid cells that contribute to a sampled value (2 times x 2 latitudes x 2 longitudes) */
+#define MAX_NUM_CORNERS 8
+
+/* Relative tolerance that is used to determine whether an axis is regular */
+#define REGULAR_AXIS_TOLERANCE 1e-6
+
+typedef struct grid_axis_struct
+{
+    long length;
+    const double *value;
+    double step;        /* grid spacing if the axis is regular, 0 otherwise */
+    int periodic;       /* whether the axis covers the full circle (for a regular longitude axis) */
+} grid_axis;
+
+typedef struct sampled_variable_struct
+{
+    const harp_variable *source;        /* variable of the gridded product */
+    harp_variable *target;      /* sampled variable */
+    int has_time;       /* whether the source variable depends on the time dimension of the gridded product */
+    long block_size;    /* number of elements per grid cell (i.e. the product of the remaining dimensions) */
+} sampled_variable;
+
+static int init_axis(grid_axis *axis, const harp_variable *variable, int allow_periodic)
+{
+    double step;
+    long i;
+
+    axis->length = variable->num_elements;
+    axis->value = variable->data.double_data;
+    axis->step = 0;
+    axis->periodic = 0;
+
+    if (axis->length < 2)
+    {
+        return 0;
+    }
+
+    step = (axis->value[axis->length - 1] - axis->value[0]) / (axis->length - 1);
+    for (i = 1; i < axis->length; i++)
+    {
+        if (!(step > 0 ? axis->value[i] > axis->value[i - 1] : axis->value[i] < axis->value[i - 1]))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable '%s' of the gridded product is not strictly "
+                           "monotonic", variable->name);
+            return -1;
+        }
+    }
+    for (i = 1; i < axis->length; i++)
+    {
+        if (fabs(axis->value[i] - (axis->value[0] + i * step)) > REGULAR_AXIS_TOLERANCE * fabs(step))
+        {
+            /* irregular axis (e.g. the latitudes of a Gaussian grid) */
+            return 0;
+        }
+    }
+    axis->step = step;
+    axis->periodic = allow_periodic && fabs(fabs(step) * axis->length - 360.0) < REGULAR_AXIS_TOLERANCE * 360.0;
+
+    return 0;
+}
+
+/* Determine the grid positions (and the weight of the second position) that should be used for sampling the axis at x.
+ * For a regular axis the position is calculated directly from the grid spacing; only for irregular axes a search is
+ * needed. Values beyond the first/last grid point (but within half a grid cell) get the value of that grid point.
+ * Returns 1 if x is covered by the axis and 0 otherwise.
+ */
+static int get_axis_position(const grid_axis *axis, double x, int nearest, long *index0, long *index1, double *weight)
+{
+    double u;
+
+    if (harp_isnan(x))
+    {
+        return 0;
+    }
+    if (axis->length == 1)
+    {
+        *index0 = 0;
+        *index1 = 0;
+        *weight = 0;
+        return 1;
+    }
+
+    if (axis->step != 0)
+    {
+        u = (x - axis->value[0]) / axis->step;
+        if (axis->periodic)
+        {
+            u -= floor(u / axis->length) * axis->length;
+            *index0 = (long)floor(u);
+            if (*index0 >= axis->length)
+            {
+                /* rounding error */
+                *index0 = axis->length - 1;
+            }
+            *index1 = (*index0 + 1) % axis->length;
+            *weight = u - *index0;
+            if (nearest)
+            {
+                if (*weight >= 0.5)
+                {
+                    *index0 = *index1;
+                }
+                *index1 = *index0;
+                *weight = 0;
+            }
+            return 1;
+        }
+    }
+    else
+    {
+        long n = axis->length;
+        long pos = 0;
+
+        harp_interpolate_find_index(n, axis->value, x, &pos);
+        if (pos < 0)
+        {
+            u = (x - axis->value[0]) / (axis->value[1] - axis->value[0]);
+        }
+        else if (pos >= n - 1)
+        {
+            u = (n - 1) + (x - axis->value[n - 1]) / (axis->value[n - 1] - axis->value[n - 2]);
+        }
+        else
+        {
+            u = pos + (x - axis->value[pos]) / (axis->value[pos + 1] - axis->value[pos]);
+        }
+    }
+
+    if (u < -0.5 || u > axis->length - 0.5)
+    {
+        return 0;
+    }
+    if (u <= 0)
+    {
+        *index0 = 0;
+        *index1 = 0;
+        *weight = 0;
+    }
+    else if (u >= axis->length - 1)
+    {
+        *index0 = axis->length - 1;
+        *index1 = axis->length - 1;
+        *weight = 0;
+    }
+    else
+    {
+        *index0 = (long)floor(u);
+        *index1 = *index0 + 1;
+        *weight = u - *index0;
+        if (nearest)
+        {
+            if (*weight >= 0.5)
+            {
+                *index0 = *index1;
+            }
+            *index1 = *index0;
+            *weight = 0;
+        }
+    }
+
+    return 1;
+}
+
+static double get_value(const harp_variable *variable, long index)
+{
+    switch (variable->data_type)
+    {
+        case harp_type_int8:
+            return variable->data.int8_data[index];
+        case harp_type_int16:
+            return variable->data.int16_data[index];
+        case harp_type_int32:
+            return variable->data.int32_data[index];
+        case harp_type_float:
+            return variable->data.float_data[index];
+        case harp_type_double:
+            return variable->data.double_data[index];
+        case harp_type_string:
+            break;
+    }
+    assert(0);
+    exit(1);
+}
+
+/* Create the (empty) sampled variable for a variable of the gridded product.
+ * Sets *target to NULL if the variable does not depend on the latitude and longitude dimensions of the grid.
+ */
+static int new_sampled_variable(const harp_product *product, const harp_product *grid_product,
+                                const harp_variable *source, sampled_variable *sampled)
+{
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    int num_dimensions;
+    int first;
+    int i;
+
+    sampled->source = source;
+    sampled->target = NULL;
+    sampled->has_time = 0;
+    sampled->block_size = 1;
+
+    if (source->data_type == harp_type_string || source->num_dimensions < 2)
+    {
+        return 0;
+    }
+    sampled->has_time = source->dimension_type[0] == harp_dimension_time &&
+        grid_product->dimension[harp_dimension_time] > 0;
+    first = sampled->has_time ? 1 : 0;
+    if (source->num_dimensions < first + 2 || source->dimension_type[first] != harp_dimension_latitude ||
+        source->dimension_type[first + 1] != harp_dimension_longitude)
+    {
+        return 0;
+    }
+
+    if (harp_product_has_variable(product, source->name))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product already contains a variable '%s'", source->name);
+        return -1;
+    }
+
+    dimension_type[0] = harp_dimension_time;
+    dimension[0] = product->dimension[harp_dimension_time];
+    num_dimensions = 1;
+    for (i = first + 2; i < source->num_dimensions; i++)
+    {
+        harp_dimension_type type = source->dimension_type[i];
+
+        if (type == harp_dimension_time || type == harp_dimension_latitude || type == harp_dimension_longitude)
+        {
+            /* not a regular HARP variable; ignore it */
+            return 0;
+        }
+        if (type != harp_dimension_independent && product->dimension[type] != 0 &&
+            product->dimension[type] != source->dimension[i])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "%s dimension of variable '%s' of the gridded product (%ld) "
+                           "is inconsistent with the product (%ld)", harp_get_dimension_type_name(type), source->name,
+                           source->dimension[i], product->dimension[type]);
+            return -1;
+        }
+        dimension_type[num_dimensions] = type;
+        dimension[num_dimensions] = source->dimension[i];
+        sampled->block_size *= source->dimension[i];
+        num_dimensions++;
+    }
+
+    if (harp_variable_new(source->name, harp_type_double, num_dimensions, dimension_type, dimension,
+                          &sampled->target) != 0)
+    {
+        return -1;
+    }
+    if (source->unit != NULL && harp_variable_set_unit(sampled->target, source->unit) != 0)
+    {
+        return -1;
+    }
+    if (source->description != NULL && harp_variable_set_description(sampled->target, source->description) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int get_grid_axis_variable(const harp_product *grid_product, const char *name,
+                                  harp_dimension_type dimension_type, const char *unit, harp_variable **variable)
+{
+    harp_variable *grid_variable;
+
+    if (harp_product_get_variable_by_name(grid_product, name, &grid_variable) != 0)
+    {
+        harp_add_error_message(" in gridded product");
+        return -1;
+    }
+    if (grid_variable->num_dimensions != 1 || grid_variable->dimension_type[0] != dimension_type)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable '%s' of the gridded product should be one dimensional "
+                       "and depend on the %s dimension", name, harp_get_dimension_type_name(dimension_type));
+        return -1;
+    }
+    if (harp_variable_copy(grid_variable, variable) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_convert_data_type(*variable, harp_type_double) != 0 ||
+        harp_variable_convert_unit(*variable, unit) != 0)
+    {
+        harp_variable_delete(*variable);
+        *variable = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/** \addtogroup harp_product
+ * @{
+ */
+
+/** Sample the variables of a gridded product at the location (and time) of each sample of a product.
+ * The gridded product should have one dimensional latitude {latitude} and longitude {longitude} axis variables (e.g. a
+ * regular latitude/longitude grid or a Gaussian grid). If the gridded product has a time dimension with more than one
+ * element, it should also have a datetime {time} variable and the samples are also interpolated in time using the
+ * datetime of the product.
+ * Each variable of the gridded product with dimensions {[time,] latitude, longitude, ...} is added to the product as a
+ * variable with dimensions {time, ...} (the remaining dimensions, such as the vertical dimension, should have the same
+ * length as in the product). The product should not already contain variables with the same names.
+ * For a regular axis the grid position of a sample is calculated directly from the grid spacing, so the cost of the
+ * operation only depends on the number of samples in the product. A global regular longitude axis wraps around.
+ * Samples that lie beyond the grid by more than half a grid cell get NaN values.
+ * \param product Product whose time samples determine the sampling locations.
+ * \param grid_product Gridded product that is sampled.
+ * \param nearest Use the value of the nearest grid point if set to 1, or bilinear interpolation (which is also linear
+ * in time) if set to 0.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_sample_grid(harp_product *product, const harp_product *grid_product, int nearest)
+{
+    harp_dimension_type time_dimension_type = harp_dimension_time;
+    harp_data_type data_type = harp_type_double;
+    harp_variable *grid_latitude = NULL;
+    harp_variable *grid_longitude = NULL;
+    harp_variable *grid_datetime = NULL;
+    harp_variable *latitude = NULL;
+    harp_variable *longitude = NULL;
+    harp_variable *datetime = NULL;
+    sampled_variable *sampled = NULL;
+    grid_axis latitude_axis;
+    grid_axis longitude_axis;
+    grid_axis time_axis;
+    long num_latitudes, num_longitudes;
+    long num_samples;
+    int num_sampled = 0;
+    int result = -1;
+    long i;
+    int k;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (grid_product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "grid_product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (product->dimension[harp_dimension_time] == 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product has no time dimension");
+        return -1;
+    }
+    num_samples = product->dimension[harp_dimension_time];
+    num_latitudes = grid_product->dimension[harp_dimension_latitude];
+    num_longitudes = grid_product->dimension[harp_dimension_longitude];
+    if (num_latitudes == 0 || num_longitudes == 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "gridded product should have a latitude and longitude dimension");
+        return -1;
+    }
+
+    if (get_grid_axis_variable(grid_product, "latitude", harp_dimension_latitude, "degree_north", &grid_latitude) != 0)
+    {
+        goto cleanup;
+    }
+    if (get_grid_axis_variable(grid_product, "longitude", harp_dimension_longitude, "degree_east", &grid_longitude)
+        != 0)
+    {
+        goto cleanup;
+    }
+    if (init_axis(&latitude_axis, grid_latitude, 0) != 0 || init_axis(&longitude_axis, grid_longitude, 1) != 0)
+    {
+        goto cleanup;
+    }
+    if (harp_product_get_derived_variable(product, "latitude", &data_type, "degree_north", 1, &time_dimension_type,
+                                          &latitude) != 0)
+    {
+        goto cleanup;
+    }
+    if (harp_product_get_derived_variable(product, "longitude", &data_type, "degree_east", 1, &time_dimension_type,
+                                          &longitude) != 0)
+    {
+        goto cleanup;
+    }
+    time_axis.length = 1;
+    time_axis.value = NULL;
+    time_axis.step = 0;
+    time_axis.periodic = 0;
+    if (grid_product->dimension[harp_dimension_time] > 1)
+    {
+        if (get_grid_axis_variable(grid_product, "datetime", harp_dimension_time, "s since 2000-01-01",
+                                   &grid_datetime) != 0)
+        {
+            goto cleanup;
+        }
+        if (init_axis(&time_axis, grid_datetime, 0) != 0)
+        {
+            goto cleanup;
+        }
+        if (harp_product_get_derived_variable(product, "datetime", &data_type, "s since 2000-01-01", 1,
+                                              &time_dimension_type, &datetime) != 0)
+        {
+            goto cleanup;
+        }
+    }
+
+    sampled = (sampled_variable *)malloc(grid_product->num_variables * sizeof(sampled_variable));
+    if (sampled == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       grid_product->num_variables * sizeof(sampled_variable), __FILE__, __LINE__);
+        goto cleanup;
+    }
+    for (k = 0; k < grid_product->num_variables; k++)
+    {
+        if (new_sampled_variable(product, grid_product, grid_product->variable[k], &sampled[num_sampled]) != 0)
+        {
+            if (sampled[num_sampled].target != NULL)
+            {
+                harp_variable_delete(sampled[num_sampled].target);
+            }
+            goto cleanup;
+        }
+        if (sampled[num_sampled].target != NULL)
+        {
+            num_sampled++;
+        }
+    }
+    if (num_sampled == 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "gridded product has no variables that depend on the latitude and "
+                       "longitude dimensions");
+        goto cleanup;
+    }
+
+    for (i = 0; i < num_samples; i++)
+    {
+        long corner_index[MAX_NUM_CORNERS];
+        double corner_weight[MAX_NUM_CORNERS];
+        long time_index[2] = { 0, 0 };
+        double time_weight = 0;
+        long lat_index[2], lon_index[2];
+        double lat_weight, lon_weight;
+        int is_valid;
+        int is_valid_time = 1;
+
+        is_valid = get_axis_position(&latitude_axis, latitude->data.double_data[i], nearest, &lat_index[0],
+                                     &lat_index[1], &lat_weight);
+        is_valid = is_valid && get_axis_position(&longitude_axis, longitude->data.double_data[i], nearest,
+                                                 &lon_index[0], &lon_index[1], &lon_weight);
+        if (datetime != NULL)
+        {
+            is_valid_time = get_axis_position(&time_axis, datetime->data.double_data[i], nearest, &time_index[0],
+                                              &time_index[1], &time_weight);
+            if (!is_valid_time)
+            {
+                /* time independent variables can still be sampled */
+                time_index[0] = 0;
+                time_index[1] = 0;
+                time_weight = 0;
+            }
+        }
+        if (is_valid)
+        {
+            int t, y, x;
+
+            /* corners are stored as time index (0/1) * 4 + latitude index (0/1) * 2 + longitude index (0/1) */
+            for (t = 0; t < 2; t++)
+            {
+                for (y = 0; y < 2; y++)
+                {
+                    for (x = 0; x < 2; x++)
+                    {
+                        int c = t * 4 + y * 2 + x;
+
+                        corner_index[c] = (time_index[t] * num_latitudes + lat_index[y]) * num_longitudes +
+                            lon_index[x];
+                        corner_weight[c] = (t ? time_weight : 1 - time_weight) * (y ? lat_weight : 1 - lat_weight) *
+                            (x ? lon_weight : 1 - lon_weight);
+                    }
+                }
+            }
+        }
+
+        for (k = 0; k < num_sampled; k++)
+        {
+            const harp_variable *source = sampled[k].source;
+            long block_size = sampled[k].block_size;
+            double *target = &sampled[k].target->data.double_data[i * block_size];
+            long j;
+
+            if (!is_valid || (sampled[k].has_time && !is_valid_time))
+            {
+                for (j = 0; j < block_size; j++)
+                {
+                    target[j] = harp_nan();
+                }
+                continue;
+            }
+            for (j = 0; j < block_size; j++)
+            {
+                target[j] = 0;
+            }
+            if (sampled[k].has_time)
+            {
+                int c;
+
+                for (c = 0; c < MAX_NUM_CORNERS; c++)
+                {
+                    if (corner_weight[c] > 0)
+                    {
+                        long offset = corner_index[c] * block_size;
+
+                        for (j = 0; j < block_size; j++)
+                        {
+                            target[j] += corner_weight[c] * get_value(source, offset + j);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                int c;
+
+                /* the variable does not depend on time, so combine the weights of both time indices */
+                for (c = 0; c < MAX_NUM_CORNERS / 2; c++)
+                {
+                    double weight = corner_weight[c] + corner_weight[c + MAX_NUM_CORNERS / 2];
+
+                    if (weight > 0)
+                    {
+                        long offset = (corner_index[c] - time_index[0] * num_latitudes * num_longitudes) * block_size;
+
+                        for (j = 0; j < block_size; j++)
+                        {
+                            target[j] += weight * get_value(source, offset + j);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (k = 0; k < num_sampled; k++)
+    {
+        if (harp_product_add_variable(product, sampled[k].target) != 0)
+        {
+            goto cleanup;
+        }
+        sampled[k].target = NULL;
+    }
+
+    result = 0;
+
+  cleanup:
+    if (sampled != NULL)
+    {
+        for (k = 0; k < num_sampled; k++)
+        {
+            if (sampled[k].target != NULL)
+            {
+                harp_variable_delete(sampled[k].target);
+            }
+        }
+        free(sampled);
+    }
+    if (grid_latitude != NULL)
+    {
+        harp_variable_delete(grid_latitude);
+    }
+    if (grid_longitude != NULL)
+    {
+        harp_variable_delete(grid_longitude);
+    }
+    if (grid_datetime != NULL)
+    {
+        harp_variable_delete(grid_datetime);
+    }
+    if (latitude != NULL)
+    {
+        harp_variable_delete(latitude);
+    }
+    if (longitude != NULL)
+    {
+        harp_variable_delete(longitude);
+    }
+    if (datetime != NULL)
+    {
+        harp_variable_delete(datetime);
+    }
+
+    return result;
+}
+
+/** @} */
@@ -0,0 +1,752 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(HAVE_SHM_OPEN) && defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define USE_SHARED_MEMORY
+#endif
+
+/* A product is published in a named (POSIX) shared memory segment using the following layout:
+ *   - a fixed size header (shm_header)
+ *   - a table with an entry for each variable (shm_variable)
+ *   - a string area with all (zero terminated) names, attribute values, and string data of the product
+ *   - the data of each variable, with each data buffer starting at a multiple of SHM_DATA_ALIGNMENT bytes
+ * All offsets are in bytes relative to the start of the segment (an offset of 0 means 'not present') and all values
+ * use the native byte order (the segment is only meant to be used by processes on the same host).
+ * The data of a string variable is an array of offsets (one for each element) into the string area.
+ * The enumeration labels of a variable are stored in the same way as the data of a string variable.
+ */
+
+#define SHM_MAGIC "HARPSHM"
+#define SHM_FORMAT_VERSION 1
+#define SHM_DATA_ALIGNMENT 64
+
+typedef struct shm_header_struct
+{
+    char magic[8];      /* SHM_MAGIC (zero terminated) */
+    uint32_t version;   /* SHM_FORMAT_VERSION */
+    uint32_t num_variables;
+    uint64_t size;      /* total size of the segment */
+    uint64_t source_product_offset;
+    uint64_t history_offset;
+    uint64_t reserved[3];
+} shm_header;
+
+typedef struct shm_variable_struct
+{
+    uint64_t name_offset;
+    uint64_t description_offset;
+    uint64_t unit_offset;
+    uint64_t enum_name_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    int32_t data_type;
+    int32_t num_dimensions;
+    int32_t num_enum_values;
+    int32_t reserved;
+    int32_t dimension_type[HARP_MAX_NUM_DIMS];
+    int64_t dimension[HARP_MAX_NUM_DIMS];
+    harp_scalar valid_min;
+    harp_scalar valid_max;
+} shm_variable;
+
+#ifdef USE_SHARED_MEMORY
+
+/* The layout of a product in a segment is determined in two passes: the first pass (with base set to NULL) only
+ * determines the size of the string area and of the data area, the second pass writes the segment.
+ */
+typedef struct shm_layout_struct
+{
+    uint8_t *base;
+    uint64_t string_offset;     /* offset of the next string in the string area */
+    uint64_t data_offset;       /* offset of the end of the last data buffer in the data area */
+} shm_layout;
+
+static uint64_t add_string(shm_layout *layout, const char *str)
+{
+    uint64_t offset;
+    size_t length;
+
+    if (str == NULL)
+    {
+        return 0;
+    }
+    offset = layout->string_offset;
+    length = strlen(str) + 1;
+    if (layout->base != NULL)
+    {
+        memcpy(&layout->base[offset], str, length);
+    }
+    layout->string_offset += length;
+
+    return offset;
+}
+
+/* Reserve a data buffer of size bytes; if data is not NULL it is copied into the buffer. */
+static uint64_t add_data(shm_layout *layout, const void *data, uint64_t size)
+{
+    uint64_t offset;
+
+    offset = (layout->data_offset + SHM_DATA_ALIGNMENT - 1) & ~(uint64_t)(SHM_DATA_ALIGNMENT - 1);
+    if (layout->base != NULL && data != NULL && size > 0)
+    {
+        memcpy(&layout->base[offset], data, (size_t)size);
+    }
+    layout->data_offset = offset + size;
+
+    return offset;
+}
+
+/* Store an array of strings as an array of offsets into the string area. */
+static uint64_t add_string_array(shm_layout *layout, long num_elements, char **str)
+{
+    uint64_t offset;
+    long i;
+
+    offset = add_data(layout, NULL, (uint64_t)num_elements * sizeof(uint64_t));
+    for (i = 0; i < num_elements; i++)
+    {
+        uint64_t string_offset = add_string(layout, str[i]);
+
+        if (layout->base != NULL)
+        {
+            memcpy(&layout->base[offset + i * sizeof(uint64_t)], &string_offset, sizeof(uint64_t));
+        }
+    }
+
+    return offset;
+}
+
+static void layout_product(const harp_product *product, shm_layout *layout)
+{
+    shm_variable *table = NULL;
+    shm_header header;
+    int i;
+
+    memset(&header, 0, sizeof(shm_header));
+    header.version = SHM_FORMAT_VERSION;
+    header.num_variables = (uint32_t)product->num_variables;
+    header.source_product_offset = add_string(layout, product->source_product);
+    header.history_offset = add_string(layout, product->history);
+
+    if (layout->base != NULL)
+    {
+        table = (shm_variable *)&layout->base[sizeof(shm_header)];
+    }
+    for (i = 0; i < product->num_variables; i++)
+    {
+        const harp_variable *variable = product->variable[i];
+        shm_variable entry;
+        int k;
+
+        memset(&entry, 0, sizeof(shm_variable));
+        entry.name_offset = add_string(layout, variable->name);
+        entry.description_offset = add_string(layout, variable->description);
+        entry.unit_offset = add_string(layout, variable->unit);
+        entry.data_type = (int32_t)variable->data_type;
+        entry.num_dimensions = (int32_t)variable->num_dimensions;
+        for (k = 0; k < variable->num_dimensions; k++)
+        {
+            entry.dimension_type[k] = (int32_t)variable->dimension_type[k];
+            entry.dimension[k] = (int64_t)variable->dimension[k];
+        }
+        entry.valid_min = variable->valid_min;
+        entry.valid_max = variable->valid_max;
+        if (variable->data_type == harp_type_string)
+        {
+            entry.data_size = (uint64_t)variable->num_elements * sizeof(uint64_t);
+            entry.data_offset = add_string_array(layout, variable->num_elements, variable->data.string_data);
+        }
+        else
+        {
+            entry.data_size = (uint64_t)variable->num_elements * harp_get_size_for_type(variable->data_type);
+            entry.data_offset = add_data(layout, variable->data.ptr, entry.data_size);
+        }
+        if (variable->num_enum_values > 0 && variable->enum_name != NULL)
+        {
+            entry.num_enum_values = (int32_t)variable->num_enum_values;
+            entry.enum_name_offset = add_string_array(layout, variable->num_enum_values, variable->enum_name);
+        }
+        if (table != NULL)
+        {
+            memcpy(&table[i], &entry, sizeof(shm_variable));
+        }
+    }
+
+    if (layout->base != NULL)
+    {
+        header.size = layout->data_offset;
+        /* the magic is written last, such that a segment that is mapped before it is complete will be rejected */
+        memcpy(layout->base, &header, sizeof(shm_header));
+        memcpy(layout->base, SHM_MAGIC, sizeof(SHM_MAGIC));
+    }
+}
+
+/* Returns the name of the shared memory object for a segment name (which gets a leading '/' if it does not have one).
+ */
+static char *get_object_name(const char *name)
+{
+    char *object_name;
+
+    if (name == NULL || name[0] == '\0' || strchr(&name[1], '/') != NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid shared memory name '%s' (%s:%u)",
+                       name == NULL ? "(null)" : name, __FILE__, __LINE__);
+        return NULL;
+    }
+    object_name = malloc(strlen(name) + 2);
+    if (object_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(name) + 2, __FILE__, __LINE__);
+        return NULL;
+    }
+    if (name[0] == '/')
+    {
+        strcpy(object_name, name);
+    }
+    else
+    {
+        object_name[0] = '/';
+        strcpy(&object_name[1], name);
+    }
+
+    return object_name;
+}
+
+static void unmap_segment(void *ptr, int64_t size)
+{
+    munmap(ptr, (size_t)size);
+}
+
+/* Returns the zero terminated string at the given offset, or NULL if the offset is 0. Sets is_valid to 0 if the
+ * offset does not refer to a zero terminated string within the string area.
+ */
+static const char *get_string(const uint8_t *base, uint64_t string_area_offset, uint64_t string_area_end,
+                              uint64_t offset, int *is_valid)
+{
+    if (offset == 0)
+    {
+        return NULL;
+    }
+    if (offset < string_area_offset || offset >= string_area_end ||
+        memchr(&base[offset], '\0', (size_t)(string_area_end - offset)) == NULL)
+    {
+        *is_valid = 0;
+        return NULL;
+    }
+
+    return (const char *)&base[offset];
+}
+
+static int read_string_array(const uint8_t *base, uint64_t size, uint64_t string_area_offset,
+                             uint64_t string_area_end, uint64_t offset, long num_elements, const char **str)
+{
+    int is_valid = 1;
+    long i;
+
+    if (offset % sizeof(uint64_t) != 0 || offset > size || (uint64_t)num_elements > (size - offset) / sizeof(uint64_t))
+    {
+        return -1;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        uint64_t string_offset;
+
+        memcpy(&string_offset, &base[offset + i * sizeof(uint64_t)], sizeof(uint64_t));
+        str[i] = get_string(base, string_area_offset, string_area_end, string_offset, &is_valid);
+    }
+
+    return is_valid ? 0 : -1;
+}
+
+static int invalid_segment(const char *name)
+{
+    harp_set_error(HARP_ERROR_IMPORT, "shared memory segment '%s' does not contain a valid HARP product", name);
+    return -1;
+}
+
+/* Create a variable from an entry of the variable table. Numeric data is not copied; the variable refers to the data
+ * in the segment directly (and keeps a reference to the mapping of the segment).
+ */
+static int read_variable(const char *name, const uint8_t *base, uint64_t size, const shm_variable *entry,
+                         uint64_t string_area_offset, uint64_t string_area_end, void *block,
+                         harp_variable **new_variable)
+{
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    harp_variable *variable;
+    const char *variable_name;
+    const char *description;
+    const char *unit;
+    int is_valid = 1;
+    long num_elements = 1;
+    int i;
+
+    variable_name = get_string(base, string_area_offset, string_area_end, entry->name_offset, &is_valid);
+    description = get_string(base, string_area_offset, string_area_end, entry->description_offset, &is_valid);
+    unit = get_string(base, string_area_offset, string_area_end, entry->unit_offset, &is_valid);
+    if (!is_valid || variable_name == NULL || entry->data_type < 0 || entry->data_type > harp_type_string ||
+        entry->num_dimensions < 0 || entry->num_dimensions > HARP_MAX_NUM_DIMS || entry->num_enum_values < 0)
+    {
+        return invalid_segment(name);
+    }
+    for (i = 0; i < entry->num_dimensions; i++)
+    {
+        if (entry->dimension_type[i] < harp_dimension_independent ||
+            entry->dimension_type[i] > harp_dimension_spectral || entry->dimension[i] < 0)
+        {
+            return invalid_segment(name);
+        }
+        dimension_type[i] = (harp_dimension_type)entry->dimension_type[i];
+        dimension[i] = (long)entry->dimension[i];
+        num_elements *= dimension[i];
+    }
+    if (entry->data_offset > size || entry->data_size > size - entry->data_offset ||
+        entry->data_size != (uint64_t)num_elements * (entry->data_type == harp_type_string ? sizeof(uint64_t) :
+                                                      (uint64_t)harp_get_size_for_type(entry->data_type)))
+    {
+        return invalid_segment(name);
+    }
+
+    if (entry->data_type == harp_type_string)
+    {
+        const char **str = NULL;
+
+        if (harp_variable_new(variable_name, harp_type_string, entry->num_dimensions, dimension_type, dimension,
+                              &variable) != 0)
+        {
+            return -1;
+        }
+        if (num_elements > 0)
+        {
+            str = malloc(num_elements * sizeof(char *));
+            if (str == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_elements * sizeof(char *), __FILE__, __LINE__);
+                harp_variable_delete(variable);
+                return -1;
+            }
+            if (read_string_array(base, size, string_area_offset, string_area_end, entry->data_offset, num_elements,
+                                  str) != 0)
+            {
+                free(str);
+                harp_variable_delete(variable);
+                return invalid_segment(name);
+            }
+            for (i = 0; i < num_elements; i++)
+            {
+                if (str[i] != NULL && harp_variable_set_string_data_element(variable, i, str[i]) != 0)
+                {
+                    free(str);
+                    harp_variable_delete(variable);
+                    return -1;
+                }
+            }
+            free(str);
+        }
+    }
+    else if (num_elements == 0)
+    {
+        if (harp_variable_new(variable_name, (harp_data_type)entry->data_type, entry->num_dimensions, dimension_type,
+                              dimension, &variable) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        if (entry->data_offset % harp_get_size_for_type(entry->data_type) != 0)
+        {
+            return invalid_segment(name);
+        }
+        /* the const is cast away since the data of the variable is borrowed (and will never be modified) */
+        if (harp_variable_new_with_shared_block(variable_name, (harp_data_type)entry->data_type,
+                                                entry->num_dimensions, dimension_type, dimension,
+                                                (void *)&base[entry->data_offset], block, &variable) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (description != NULL && harp_variable_set_description(variable, description) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+    if (unit != NULL && harp_variable_set_unit(variable, unit) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+    if (entry->data_type != harp_type_string)
+    {
+        variable->valid_min = entry->valid_min;
+        variable->valid_max = entry->valid_max;
+    }
+    if (entry->num_enum_values > 0)
+    {
+        const char **enum_name;
+
+        enum_name = malloc(entry->num_enum_values * sizeof(char *));
+        if (enum_name == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           entry->num_enum_values * sizeof(char *), __FILE__, __LINE__);
+            harp_variable_delete(variable);
+            return -1;
+        }
+        if (read_string_array(base, size, string_area_offset, string_area_end, entry->enum_name_offset,
+                              entry->num_enum_values, enum_name) != 0)
+        {
+            free(enum_name);
+            harp_variable_delete(variable);
+            return invalid_segment(name);
+        }
+        for (i = 0; i < entry->num_enum_values; i++)
+        {
+            if (enum_name[i] == NULL)
+            {
+                free(enum_name);
+                harp_variable_delete(variable);
+                return invalid_segment(name);
+            }
+        }
+        if (harp_variable_set_enumeration_values(variable, entry->num_enum_values, enum_name) != 0)
+        {
+            free(enum_name);
+            harp_variable_delete(variable);
+            return -1;
+        }
+        free(enum_name);
+    }
+
+    *new_variable = variable;
+    return 0;
+}
+
+static int read_product(const char *name, const uint8_t *base, uint64_t size, void *block, harp_product *product)
+{
+    const shm_header *header = (const shm_header *)base;
+    const shm_variable *table = (const shm_variable *)&base[sizeof(shm_header)];
+    uint64_t string_area_offset;
+    uint64_t string_area_end;
+    const char *source_product;
+    const char *history;
+    int is_valid = 1;
+    uint32_t i;
+
+    if (memcmp(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0 || header->size != size)
+    {
+        return invalid_segment(name);
+    }
+    if (header->version != SHM_FORMAT_VERSION)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "unsupported version (%lu) of shared memory segment '%s'",
+                       (unsigned long)header->version, name);
+        return -1;
+    }
+    if (header->num_variables > (size - sizeof(shm_header)) / sizeof(shm_variable))
+    {
+        return invalid_segment(name);
+    }
+    /* the string area runs from the end of the variable table up to the first data buffer (or the end of the segment) */
+    string_area_offset = sizeof(shm_header) + header->num_variables * sizeof(shm_variable);
+    string_area_end = size;
+    for (i = 0; i < header->num_variables; i++)
+    {
+        if (table[i].data_offset >= string_area_offset && table[i].data_offset < string_area_end)
+        {
+            string_area_end = table[i].data_offset;
+        }
+    }
+
+    source_product = get_string(base, string_area_offset, string_area_end, header->source_product_offset, &is_valid);
+    history = get_string(base, string_area_offset, string_area_end, header->history_offset, &is_valid);
+    if (!is_valid)
+    {
+        return invalid_segment(name);
+    }
+    if (source_product != NULL && harp_product_set_source_product(product, source_product) != 0)
+    {
+        return -1;
+    }
+    if (history != NULL && harp_product_set_history(product, history) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < header->num_variables; i++)
+    {
+        harp_variable *variable;
+
+        if (read_variable(name, base, size, &table[i], string_area_offset, string_area_end, block, &variable) != 0)
+        {
+            return -1;
+        }
+        if (harp_product_add_variable(product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+#endif
+
+/** \addtogroup harp_product
+ * @{
+ */
+
+/** Publish a product in a named shared memory segment.
+ * The segment contains a fixed size header, a table with an entry for each variable, and the data of each variable
+ * in a separate buffer (aligned to 64 bytes), such that other processes on the same host can map the product without
+ * having to copy or decode its data (see harp_product_map_shared_memory()).
+ * The segment should not exist yet. It is kept until it is removed using harp_shared_memory_unlink() (also after the
+ * calling process has ended). Other processes should only map the product once this function has returned.
+ * Shared memory segments are only supported on platforms that provide POSIX shared memory (shm_open()).
+ * \param product Product to publish.
+ * \param name Name of the shared memory segment (a leading '/' is added if the name does not start with one). The name
+ * should not contain any other '/' characters.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_publish_shared_memory(const harp_product *product, const char *name)
+{
+#ifdef USE_SHARED_MEMORY
+    shm_layout layout;
+    uint64_t data_area_offset;
+    uint64_t size;
+    char *object_name;
+    void *base;
+    int fd;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    object_name = get_object_name(name);
+    if (object_name == NULL)
+    {
+        return -1;
+    }
+
+    /* determine the size of the string area and of the data area */
+    layout.base = NULL;
+    layout.string_offset = sizeof(shm_header) + product->num_variables * sizeof(shm_variable);
+    layout.data_offset = 0;
+    layout_product(product, &layout);
+    data_area_offset = (layout.string_offset + SHM_DATA_ALIGNMENT - 1) & ~(uint64_t)(SHM_DATA_ALIGNMENT - 1);
+    size = data_area_offset + layout.data_offset;
+
+    fd = shm_open(object_name, O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd == -1)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create shared memory segment '%s' (%s)", name, strerror(errno));
+        free(object_name);
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "could not resize shared memory segment '%s' (%s)", name, strerror(errno));
+        close(fd);
+        shm_unlink(object_name);
+        free(object_name);
+        return -1;
+    }
+    base = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "could not map shared memory segment '%s' (%s)", name, strerror(errno));
+        shm_unlink(object_name);
+        free(object_name);
+        return -1;
+    }
+
+    layout.base = (uint8_t *)base;
+    layout.string_offset = sizeof(shm_header) + product->num_variables * sizeof(shm_variable);
+    layout.data_offset = data_area_offset;
+    layout_product(product, &layout);
+    assert(layout.data_offset == size);
+
+    munmap(base, (size_t)size);
+    free(object_name);
+
+    return 0;
+#else
+    (void)product;
+    (void)name;
+    harp_set_error(HARP_ERROR_OPERATION, "shared memory products are not supported on this platform");
+    return -1;
+#endif
+}
+
+/** Map a product that was published in a named shared memory segment.
+ * The data of the numeric variables of the product is not copied; the variables refer to a read-only mapping of the
+ * segment directly. As for variables with borrowed data (see harp_variable_new_with_borrowed_data()), such data is
+ * first copied into memory that is owned by HARP when the product gets modified (e.g. by
+ * harp_product_execute_operations()). The mapping is kept until the product (and any copies that share its data) is
+ * deleted, which can also be after the segment was removed using harp_shared_memory_unlink().
+ * The data of string variables (and all attributes) is copied.
+ * \param name Name of the shared memory segment (see harp_product_publish_shared_memory()).
+ * \param product Pointer to the C variable where the mapped product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_map_shared_memory(const char *name, harp_product **product)
+{
+#ifdef USE_SHARED_MEMORY
+    harp_product *new_product;
+    struct stat statbuf;
+    char *object_name;
+    void *block;
+    void *base;
+    int fd;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    object_name = get_object_name(name);
+    if (object_name == NULL)
+    {
+        return -1;
+    }
+    fd = shm_open(object_name, O_RDONLY, 0);
+    free(object_name);
+    if (fd == -1)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not open shared memory segment '%s' (%s)", name, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &statbuf) != 0)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "could not retrieve size of shared memory segment '%s' (%s)", name,
+                       strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if ((uint64_t)statbuf.st_size < sizeof(shm_header))
+    {
+        close(fd);
+        return invalid_segment(name);
+    }
+    base = mmap(NULL, (size_t)statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "could not map shared memory segment '%s' (%s)", name, strerror(errno));
+        return -1;
+    }
+    if (harp_shared_block_new(base, (int64_t)statbuf.st_size, unmap_segment, &block) != 0)
+    {
+        munmap(base, (size_t)statbuf.st_size);
+        return -1;
+    }
+
+    if (harp_product_new(&new_product) != 0)
+    {
+        harp_shared_block_release(block);
+        return -1;
+    }
+    if (read_product(name, (const uint8_t *)base, (uint64_t)statbuf.st_size, block, new_product) != 0)
+    {
+        harp_product_delete(new_product);
+        harp_shared_block_release(block);
+        return -1;
+    }
+    /* from here on the mapping is only kept alive by the variables that refer to it */
+    harp_shared_block_release(block);
+
+    *product = new_product;
+    return 0;
+#else
+    (void)name;
+    (void)product;
+    harp_set_error(HARP_ERROR_OPERATION, "shared memory products are not supported on this platform");
+    return -1;
+#endif
+}
+
+/** Remove a named shared memory segment.
+ * Processes that have mapped a product from the segment can keep using that product; the memory of the segment is
+ * released once all mappings are gone.
+ * \param name Name of the shared memory segment (see harp_product_publish_shared_memory()).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_shared_memory_unlink(const char *name)
+{
+#ifdef USE_SHARED_MEMORY
+    char *object_name;
+
+    object_name = get_object_name(name);
+    if (object_name == NULL)
+    {
+        return -1;
+    }
+    if (shm_unlink(object_name) != 0)
+    {
+        harp_set_error(HARP_ERROR_OPERATION, "could not remove shared memory segment '%s' (%s)", name,
+                       strerror(errno));
+        free(object_name);
+        return -1;
+    }
+    free(object_name);
+
+    return 0;
+#else
+    (void)name;
+    harp_set_error(HARP_ERROR_OPERATION, "shared memory products are not supported on this platform");
+    return -1;
+#endif
+}
+
+/** @} */
@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+#include "harp-thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* Tasks are run by a pool of worker threads that is shared by all callers of harp_run_tasks() (including calls from
+ * different application threads and nested calls from within a task). The pool is created on first use with
+ * harp_option_num_threads - 1 workers (the calling thread always takes part in running its own tasks) and is grown
+ * when the number of threads option is increased. The total number of threads that run tasks is therefore bounded by
+ * the number of threads option plus the number of application threads, regardless of how many parallel operations
+ * are active at the same time.
+ * A caller of harp_run_tasks() does not wait idle; it takes unclaimed tasks from its own group and runs them itself,
+ * so a group always completes, even if all workers are busy with other groups.
+ */
+
+/* depth of task nesting for the current thread (0 if the thread is not running a task) */
+static HARP_THREAD_LOCAL int task_depth = 0;
+
+#ifdef HAVE_PTHREAD_H
+typedef struct task_group_struct
+{
+    harp_task *task;
+    int num_tasks;
+    int next_task;      /* index of the first task that has not been claimed yet */
+    int num_finished;
+    pthread_cond_t finished;
+    struct task_group_struct *next;
+} task_group;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work_available = PTHREAD_COND_INITIALIZER;
+static task_group *pool_queue_head = NULL;
+static task_group *pool_queue_tail = NULL;
+static pthread_t pool_worker[HARP_MAX_NUM_THREADS];
+static int pool_num_workers = 0;
+static int pool_stop = 0;
+#endif
+
+static void task_run(harp_task *task)
+{
+    harp_execution_options *options = harp_get_execution_options();
+
+    /* a task uses the same options as the program execution (if any) from which it was started */
+    harp_set_execution_options(task->options);
+    task_depth++;
+    harp_trace_begin("task");
+    task->result = task->function(task->arg);
+    harp_trace_end();
+    task_depth--;
+    harp_set_execution_options(options);
+    if (task->result != 0)
+    {
+        task->error_code = harp_errno;
+        task->error_message = strdup(harp_errno_to_string(harp_errno));
+    }
+}
+
+#ifdef HAVE_PTHREAD_H
+/* Claim the next task of a group; should be called with the pool mutex held.
+ * A group is removed from the queue once all its tasks have been claimed.
+ */
+static harp_task *claim_task(task_group *group)
+{
+    harp_task *task = &group->task[group->next_task];
+
+    group->next_task++;
+    if (group->next_task == group->num_tasks)
+    {
+        task_group *prev = NULL;
+        task_group *current = pool_queue_head;
+
+        while (current != group)
+        {
+            prev = current;
+            current = current->next;
+        }
+        if (prev == NULL)
+        {
+            pool_queue_head = group->next;
+        }
+        else
+        {
+            prev->next = group->next;
+        }
+        if (pool_queue_tail == group)
+        {
+            pool_queue_tail = prev;
+        }
+        group->next = NULL;
+    }
+
+    return task;
+}
+
+/* Mark a task of a group as finished; should be called with the pool mutex held */
+static void finish_task(task_group *group)
+{
+    group->num_finished++;
+    if (group->num_finished == group->num_tasks)
+    {
+        pthread_cond_signal(&group->finished);
+    }
+}
+
+static void *worker_run(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (;;)
+    {
+        task_group *group;
+        harp_task *task;
+
+        while (pool_queue_head == NULL && !pool_stop)
+        {
+            pthread_cond_wait(&pool_work_available, &pool_mutex);
+        }
+        if (pool_stop)
+        {
+            break;
+        }
+        group = pool_queue_head;
+        task = claim_task(group);
+        pthread_mutex_unlock(&pool_mutex);
+        task_run(task);
+        pthread_mutex_lock(&pool_mutex);
+        finish_task(group);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    return NULL;
+}
+
+/* Make sure the pool has (up to) harp_option_num_threads - 1 workers; should be called with the pool mutex held.
+ * If a worker can not be created, the pool just continues with fewer workers.
+ */
+static void grow_pool(void)
+{
+    while (pool_num_workers < harp_option_num_threads - 1)
+    {
+        if (pthread_create(&pool_worker[pool_num_workers], NULL, worker_run, NULL) != 0)
+        {
+            break;
+        }
+        pool_num_workers++;
+    }
+}
+
+static void run_task_group(int num_tasks, harp_task *task)
+{
+    task_group group;
+
+    group.task = task;
+    group.num_tasks = num_tasks;
+    group.next_task = 0;
+    group.num_finished = 0;
+    group.next = NULL;
+    pthread_cond_init(&group.finished, NULL);
+
+    pthread_mutex_lock(&pool_mutex);
+    grow_pool();
+    if (pool_queue_tail == NULL)
+    {
+        pool_queue_head = &group;
+    }
+    else
+    {
+        pool_queue_tail->next = &group;
+    }
+    pool_queue_tail = &group;
+    pthread_cond_broadcast(&pool_work_available);
+
+    /* run our own tasks until all of them have been claimed */
+    while (group.next_task < group.num_tasks)
+    {
+        harp_task *current = claim_task(&group);
+
+        pthread_mutex_unlock(&pool_mutex);
+        task_run(current);
+        pthread_mutex_lock(&pool_mutex);
+        finish_task(&group);
+    }
+    while (group.num_finished < group.num_tasks)
+    {
+        pthread_cond_wait(&group.finished, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    pthread_cond_destroy(&group.finished);
+}
+#endif
+
+/* Run all tasks using the shared pool of worker threads (the calling thread also runs tasks).
+ * If tasks are run from within a task (nested parallelism), or if no workers are available, the tasks are run on the
+ * calling thread in task order.
+ * If one or more tasks fail, the error of the first failing task (in task order) is reported.
+ * Since each task writes its own results, the outcome does not depend on which thread runs which task or in which
+ * order; callers that combine task results should do so in task order after this function returns.
+ */
+int harp_run_tasks(int num_tasks, harp_task *task)
+{
+    int result = 0;
+    int i;
+
+    for (i = 0; i < num_tasks; i++)
+    {
+        task[i].result = 0;
+        task[i].error_code = HARP_SUCCESS;
+        task[i].error_message = NULL;
+        task[i].options = harp_get_execution_options();
+    }
+
+#ifdef HAVE_PTHREAD_H
+    if (num_tasks > 1 && task_depth == 0 && harp_option_num_threads > 1)
+    {
+        run_task_group(num_tasks, task);
+    }
+    else
+#endif
+    {
+        for (i = 0; i < num_tasks; i++)
+        {
+            task_run(&task[i]);
+        }
+    }
+
+    for (i = 0; i < num_tasks; i++)
+    {
+        if (task[i].result != 0 && result == 0)
+        {
+            harp_set_error(task[i].error_code, "%s", task[i].error_message != NULL ? task[i].error_message : "");
+            result = -1;
+        }
+        if (task[i].error_message != NULL)
+        {
+            free(task[i].error_message);
+        }
+    }
+
+    return result;
+}
+
+/* Determine the number of tasks to use for an amount of work, given the minimum amount of work per task.
+ * The number of tasks only depends on the amount of work and the number of threads option (and not on the current
+ * load of the pool), such that the partitioning of the work, and thereby the result, is reproducible.
+ * Within a task a single task is used, since the outer level of parallelism already occupies the pool.
+ */
+int harp_get_num_tasks(long work_size, long min_work_size_per_task)
+{
+#ifdef HAVE_PTHREAD_H
+    long num_tasks = work_size / min_work_size_per_task;
+
+    if (task_depth > 0)
+    {
+        return 1;
+    }
+    if (num_tasks > harp_option_num_threads)
+    {
+        num_tasks = harp_option_num_threads;
+    }
+    if (num_tasks > 1)
+    {
+        return (int)num_tasks;
+    }
+#else
+    (void)work_size;
+    (void)min_work_size_per_task;
+#endif
+
+    return 1;
+}
+
+/* a task of harp_run_for_each() handles the items first, first + step, first + 2 * step, ... (up to num_items) */
+typedef struct for_each_task_struct
+{
+    int (*function) (void *arg, long index);
+    void *arg;
+    long first;
+    long step;
+    long num_items;
+    long failed_index;  /* index of the first item for which function failed (-1 if none) */
+    int error_code;
+    char *error_message;
+} for_each_task;
+
+static int for_each_task_run(void *arg)
+{
+    for_each_task *task = (for_each_task *)arg;
+    long i;
+
+    for (i = task->first; i < task->num_items; i += task->step)
+    {
+        if (task->function(task->arg, i) != 0)
+        {
+            task->failed_index = i;
+            task->error_code = harp_errno;
+            task->error_message = strdup(harp_errno_to_string(harp_errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Call function(arg, index) for each index in [0, num_items) using the shared pool of worker threads.
+ * The calls for different indices should be independent of each other (e.g. each call only modifies the variable with
+ * the given index of a product). work_size and min_work_size_per_task determine the number of tasks (see
+ * harp_get_num_tasks()). The items are dealt out to the tasks in an interleaved way, such that large and small items
+ * (e.g. variables of very different size) are distributed evenly.
+ * Each task stops at its first failing item. If any item fails, the error of the failing item with the lowest index is
+ * reported, which is the same error that a sequential loop over all items would report.
+ */
+int harp_run_for_each(long num_items, long work_size, long min_work_size_per_task,
+                      int (*function) (void *arg, long index), void *arg)
+{
+    for_each_task *for_each;
+    harp_task *task;
+    long failed_index = -1;
+    int failed_task = -1;
+    int num_tasks;
+    int i;
+
+    num_tasks = harp_get_num_tasks(work_size, min_work_size_per_task);
+    if (num_tasks > num_items)
+    {
+        num_tasks = (int)num_items;
+    }
+    if (num_tasks <= 1)
+    {
+        long k;
+
+        for (k = 0; k < num_items; k++)
+        {
+            if (function(arg, k) != 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    for_each = malloc(num_tasks * sizeof(for_each_task));
+    if (for_each == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(for_each_task), __FILE__, __LINE__);
+        return -1;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        free(for_each);
+        return -1;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        for_each[i].function = function;
+        for_each[i].arg = arg;
+        for_each[i].first = i;
+        for_each[i].step = num_tasks;
+        for_each[i].num_items = num_items;
+        for_each[i].failed_index = -1;
+        for_each[i].error_code = HARP_SUCCESS;
+        for_each[i].error_message = NULL;
+        task[i].function = for_each_task_run;
+        task[i].arg = &for_each[i];
+    }
+    harp_run_tasks(num_tasks, task);
+
+    for (i = 0; i < num_tasks; i++)
+    {
+        if (for_each[i].failed_index >= 0 && (failed_index < 0 || for_each[i].failed_index < failed_index))
+        {
+            failed_index = for_each[i].failed_index;
+            failed_task = i;
+        }
+    }
+    if (failed_task >= 0)
+    {
+        harp_set_error(for_each[failed_task].error_code, "%s", for_each[failed_task].error_message != NULL ?
+                       for_each[failed_task].error_message : "");
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        if (for_each[i].error_message != NULL)
+        {
+            free(for_each[i].error_message);
+        }
+    }
+    free(task);
+    free(for_each);
+
+    return failed_task >= 0 ? -1 : 0;
+}
+
+/* Stop and join all worker threads of the pool; should only be called when no tasks are running (i.e. by the final
+ * harp_done())
+ */
+void harp_thread_done(void)
+{
+#ifdef HAVE_PTHREAD_H
+    int i;
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_stop = 1;
+    pthread_cond_broadcast(&pool_work_available);
+    pthread_mutex_unlock(&pool_mutex);
+    for (i = 0; i < pool_num_workers; i++)
+    {
+        pthread_join(pool_worker[i], NULL);
+    }
+    pool_num_workers = 0;
+    pool_stop = 0;
+#endif
+}
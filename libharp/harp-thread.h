@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HARP_THREAD_H
+#define HARP_THREAD_H
+
+/* Primitives for making libharp safe for use from multiple threads.
+ * HARP_THREAD_LOCAL marks a static variable as having a separate instance per thread.
+ * A harp_mutex should be statically initialized with HARP_MUTEX_INITIALIZER.
+ * If threads are not supported on the platform the mutex functions are no-ops.
+ */
+
+#if defined(_MSC_VER)
+#define HARP_THREAD_LOCAL __declspec(thread)
+#else
+#define HARP_THREAD_LOCAL __thread
+#endif
+
+#if defined(WIN32)
+#include <windows.h>
+typedef SRWLOCK harp_mutex;
+#define HARP_MUTEX_INITIALIZER SRWLOCK_INIT
+#define harp_mutex_lock(mutex) AcquireSRWLockExclusive(mutex)
+#define harp_mutex_unlock(mutex) ReleaseSRWLockExclusive(mutex)
+#elif defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+typedef pthread_mutex_t harp_mutex;
+#define HARP_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define harp_mutex_lock(mutex) pthread_mutex_lock(mutex)
+#define harp_mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#else
+typedef int harp_mutex;
+#define HARP_MUTEX_INITIALIZER 0
+#define harp_mutex_lock(mutex) ((void)(mutex))
+#define harp_mutex_unlock(mutex) ((void)(mutex))
+#endif
+
+/* A unit of work that can be run on a separate thread (see harp_run_tasks()) */
+typedef struct harp_task_struct
+{
+    int (*function) (void *);
+    void *arg;
+    int result;
+    int error_code;
+    char *error_message;
+    struct harp_execution_options_struct *options;      /* execution options of the thread that submitted the task */
+} harp_task;
+
+int harp_run_tasks(int num_tasks, harp_task *task);
+int harp_get_num_tasks(long work_size, long min_work_size_per_task);
+int harp_run_for_each(long num_items, long work_size, long min_work_size_per_task,
+                      int (*function) (void *arg, long index), void *arg);
+void harp_thread_done(void);
+
+#endif
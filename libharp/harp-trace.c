@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "harp-internal.h"
+#include "harp-thread.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum length of the name of an event (longer names are truncated) */
+#define MAX_TRACE_NAME_LENGTH 1024
+
+/* Event tracing (see harp_set_option_trace()).
+ * Events are written as 'duration' begin/end events in the Chrome Trace Event (JSON array) format, which can be viewed
+ * with e.g. chrome://tracing or Perfetto. Each thread that emits events gets its own (sequential) thread id.
+ */
+
+static harp_mutex trace_mutex = HARP_MUTEX_INITIALIZER;
+static FILE *trace_file = NULL;
+static char *trace_filename = NULL;
+static double trace_start_time = 0;
+static long trace_num_events = 0;
+static int trace_num_threads = 0;
+static HARP_THREAD_LOCAL int trace_thread_id = -1;
+
+static void write_json_string(FILE *f, const char *str)
+{
+    fputc('"', f);
+    while (*str != '\0')
+    {
+        unsigned char c = (unsigned char)*str;
+
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', f);
+            fputc(c, f);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(f, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, f);
+        }
+        str++;
+    }
+    fputc('"', f);
+}
+
+static void write_event(const char *name, char phase)
+{
+    double timestamp;
+
+    if (!harp_option_trace)
+    {
+        return;
+    }
+    timestamp = harp_get_wall_time();
+
+    harp_mutex_lock(&trace_mutex);
+    if (trace_file == NULL)
+    {
+        harp_mutex_unlock(&trace_mutex);
+        return;
+    }
+    if (trace_thread_id < 0)
+    {
+        trace_thread_id = trace_num_threads;
+        trace_num_threads++;
+    }
+    fprintf(trace_file, "%s\n{", trace_num_events > 0 ? "," : "");
+    if (name != NULL)
+    {
+        fputs("\"name\":", trace_file);
+        write_json_string(trace_file, name);
+        fputc(',', trace_file);
+    }
+    fprintf(trace_file, "\"cat\":\"harp\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%d}", phase,
+            (timestamp - trace_start_time) * 1e6, trace_thread_id);
+    trace_num_events++;
+    harp_mutex_unlock(&trace_mutex);
+}
+
+/* Emit the start of an event for the calling thread; the event name is constructed from a printf-style format.
+ * Each call should be matched by a call to harp_trace_end() from the same thread.
+ * This function does nothing if tracing is disabled.
+ */
+void harp_trace_begin(const char *format, ...)
+{
+    char name[MAX_TRACE_NAME_LENGTH];
+    va_list ap;
+
+    if (!harp_option_trace)
+    {
+        return;
+    }
+    va_start(ap, format);
+    vsnprintf(name, MAX_TRACE_NAME_LENGTH, format, ap);
+    va_end(ap);
+    write_event(name, 'B');
+}
+
+/* Emit the end of the most recently started event of the calling thread (see harp_trace_begin()).
+ */
+void harp_trace_end(void)
+{
+    write_event(NULL, 'E');
+}
+
+/* Start writing trace events to the given file (an existing file will be overwritten).
+ * Any previously opened trace file should have been closed first (using harp_trace_close()).
+ */
+int harp_trace_open(const char *filename)
+{
+    FILE *f;
+    char *name;
+
+    name = strdup(filename);
+    if (name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    f = fopen(filename, "w");
+    if (f == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not open trace file '%s'", filename);
+        free(name);
+        return -1;
+    }
+    fputc('[', f);
+
+    harp_mutex_lock(&trace_mutex);
+    trace_file = f;
+    trace_filename = name;
+    trace_start_time = harp_get_wall_time();
+    trace_num_events = 0;
+    harp_mutex_unlock(&trace_mutex);
+
+    return 0;
+}
+
+/* Finish and close the trace file (if one is open).
+ */
+void harp_trace_close(void)
+{
+    harp_mutex_lock(&trace_mutex);
+    if (trace_file != NULL)
+    {
+        fputs("\n]\n", trace_file);
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    if (trace_filename != NULL)
+    {
+        free(trace_filename);
+        trace_filename = NULL;
+    }
+    harp_mutex_unlock(&trace_mutex);
+}
+
+/* Return the name of the file that trace events are written to (or NULL if tracing is disabled).
+ */
+const char *harp_trace_get_filename(void)
+{
+    return trace_filename;
+}
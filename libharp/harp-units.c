@@ -30,9 +30,14 @@
  */
 
 #include "harp-internal.h"
+#include "harp-thread.h"
+
+#include "hashtable.h"
 
 #include <assert.h>
 #include <errno.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -42,11 +47,179 @@ static char *harp_udunits2_xml_path = NULL;
 
 static ut_system *unit_system = NULL;
 
+/* udunits keeps global state (e.g. the unit parser and the status of the last call), so all udunits calls that use the
+ * unit system are serialized using this mutex.
+ */
+static harp_mutex unit_system_mutex = HARP_MUTEX_INITIALIZER;
+
+typedef enum harp_affine_conversion_type_enum
+{
+    affine_none,        /* not affine; use udunits */
+    affine_scale,       /* value * scale */
+    affine_offset,      /* value + offset */
+    affine_scale_offset /* value * scale + offset */
+} harp_affine_conversion_type;
+
+/* maximum number of entries in each of the unit caches */
+#define MAX_NUM_CACHED_UNITS 1024
+
 struct harp_unit_converter_struct
 {
     cv_converter *converter;
+    int is_cached;      /* is the converter owned by the converter cache? */
+    /* if the conversion is affine we perform it ourselves as 'value * scale + offset' */
+    harp_affine_conversion_type affine_type;
+    double scale;
+    double offset;
 };
 
+/* Parsing unit strings and creating converters using udunits is expensive, and the same units get used over and over
+ * again, so we keep a cache of parsed units (keyed by the unit string) and of converters (keyed by '<from>\n<to>').
+ * Entries are only removed by harp_unit_done(). Just like the unit system itself, the caches are protected by the
+ * unit_system_mutex. A cv_converter does not change once it is created, so a cached converter can be used for
+ * conversions without holding the mutex.
+ */
+typedef struct unit_cache_struct
+{
+    int num_entries;
+    char **key;
+    void **value;
+    hashtable *hash_data;
+} unit_cache;
+
+static unit_cache *parsed_unit_cache = NULL;
+static unit_cache *converter_cache = NULL;
+
+static void *unit_cache_get(unit_cache *cache, const char *key)
+{
+    long index;
+
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    index = hashtable_get_index_from_name(cache->hash_data, key);
+    if (index < 0)
+    {
+        return NULL;
+    }
+
+    return cache->value[index];
+}
+
+/* returns 0 if the value was added to the cache (which then takes ownership of the value), 1 if the cache is full, and
+ * -1 on error.
+ */
+static int unit_cache_add(unit_cache **cache, const char *key, void *value)
+{
+    unit_cache *new_cache = *cache;
+    char *new_key;
+
+    if (new_cache == NULL)
+    {
+        new_cache = (unit_cache *)malloc(sizeof(unit_cache));
+        if (new_cache == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(unit_cache), __FILE__, __LINE__);
+            return -1;
+        }
+        new_cache->num_entries = 0;
+        new_cache->key = NULL;
+        new_cache->value = NULL;
+        new_cache->hash_data = hashtable_new(1);
+        if (new_cache->hash_data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                           __LINE__);
+            free(new_cache);
+            return -1;
+        }
+        *cache = new_cache;
+    }
+
+    if (new_cache->num_entries == MAX_NUM_CACHED_UNITS)
+    {
+        return 1;
+    }
+
+    if (new_cache->num_entries % BLOCK_SIZE == 0)
+    {
+        char **key_list;
+        void **value_list;
+
+        key_list = realloc(new_cache->key, (new_cache->num_entries + BLOCK_SIZE) * sizeof(char *));
+        if (key_list == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (new_cache->num_entries + BLOCK_SIZE) * sizeof(char *), __FILE__, __LINE__);
+            return -1;
+        }
+        new_cache->key = key_list;
+        value_list = realloc(new_cache->value, (new_cache->num_entries + BLOCK_SIZE) * sizeof(void *));
+        if (value_list == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (new_cache->num_entries + BLOCK_SIZE) * sizeof(void *), __FILE__, __LINE__);
+            return -1;
+        }
+        new_cache->value = value_list;
+    }
+
+    new_key = strdup(key);
+    if (new_key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    if (hashtable_add_name(new_cache->hash_data, new_key) != 0)
+    {
+        /* the key was already in the cache */
+        free(new_key);
+        return 1;
+    }
+    new_cache->key[new_cache->num_entries] = new_key;
+    new_cache->value[new_cache->num_entries] = value;
+    new_cache->num_entries++;
+
+    return 0;
+}
+
+static void unit_cache_delete(unit_cache *cache, void (*delete_value) (void *))
+{
+    if (cache != NULL)
+    {
+        int i;
+
+        for (i = 0; i < cache->num_entries; i++)
+        {
+            free(cache->key[i]);
+            delete_value(cache->value[i]);
+        }
+        if (cache->key != NULL)
+        {
+            free(cache->key);
+        }
+        if (cache->value != NULL)
+        {
+            free(cache->value);
+        }
+        hashtable_delete(cache->hash_data);
+        free(cache);
+    }
+}
+
+static void delete_parsed_unit(void *unit)
+{
+    ut_free((ut_unit *)unit);
+}
+
+static void delete_converter(void *converter)
+{
+    cv_free((cv_converter *)converter);
+}
+
 static void handle_udunits_error(void)
 {
     switch (ut_get_status())
@@ -254,6 +427,11 @@ static int unit_system_init(void)
 
 static void unit_system_done(void)
 {
+    unit_cache_delete(converter_cache, delete_converter);
+    converter_cache = NULL;
+    unit_cache_delete(parsed_unit_cache, delete_parsed_unit);
+    parsed_unit_cache = NULL;
+
     if (unit_system != NULL)
     {
         ut_free_system(unit_system);
@@ -292,16 +470,56 @@ static int parse_unit(const char *str, ut_unit **new_unit)
     return 0;
 }
 
-int harp_unit_is_valid(const char *str)
+/* Get the parsed unit for the given unit string.
+ * If is_temp is set to 1, the unit is not cached and should be freed by the caller using ut_free().
+ */
+static int get_unit(const char *str, ut_unit **unit, int *is_temp)
+{
+    int result;
+
+    *is_temp = 0;
+
+    if (str == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unit is NULL (%s:%lu)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    *unit = (ut_unit *)unit_cache_get(parsed_unit_cache, str);
+    if (*unit != NULL)
+    {
+        return 0;
+    }
+
+    if (parse_unit(str, unit) != 0)
+    {
+        return -1;
+    }
+    result = unit_cache_add(&parsed_unit_cache, str, *unit);
+    if (result < 0)
+    {
+        ut_free(*unit);
+        return -1;
+    }
+    *is_temp = result;
+
+    return 0;
+}
+
+static int unit_is_valid(const char *str)
 {
     ut_unit *unit;
+    int is_temp;
 
-    if (parse_unit(str, &unit) != 0)
+    if (get_unit(str, &unit, &is_temp) != 0)
     {
         return 0;
     }
 
-    ut_free(unit);
+    if (is_temp)
+    {
+        ut_free(unit);
+    }
 
     return 1;
 }
@@ -310,7 +528,7 @@ void harp_unit_converter_delete(harp_unit_converter *unit_converter)
 {
     if (unit_converter != NULL)
     {
-        if (unit_converter->converter != NULL)
+        if (unit_converter->converter != NULL && !unit_converter->is_cached)
         {
             cv_free(unit_converter->converter);
         }
@@ -319,28 +537,144 @@ void harp_unit_converter_delete(harp_unit_converter *unit_converter)
     }
 }
 
-int harp_unit_converter_new(const char *from_unit, const char *to_unit, harp_unit_converter **new_unit_converter)
+static int get_converter(const char *from_unit, const char *to_unit, cv_converter **converter)
 {
-    harp_unit_converter *unit_converter;
     ut_unit *from_udunit;
     ut_unit *to_udunit;
+    int from_is_temp;
+    int to_is_temp;
 
-    if (parse_unit(from_unit, &from_udunit) != 0)
+    if (get_unit(from_unit, &from_udunit, &from_is_temp) != 0)
     {
         return -1;
     }
 
-    if (parse_unit(to_unit, &to_udunit) != 0)
+    if (get_unit(to_unit, &to_udunit, &to_is_temp) != 0)
     {
-        ut_free(from_udunit);
+        if (from_is_temp)
+        {
+            ut_free(from_udunit);
+        }
         return -1;
     }
 
     if (!ut_are_convertible(from_udunit, to_udunit))
     {
         harp_set_error(HARP_ERROR_UNIT_CONVERSION, "unit '%s' cannot be converted to unit '%s'", from_unit, to_unit);
+        *converter = NULL;
+    }
+    else
+    {
+        *converter = ut_get_converter(from_udunit, to_udunit);
+        if (*converter == NULL)
+        {
+            handle_udunits_error();
+        }
+    }
+
+    if (to_is_temp)
+    {
         ut_free(to_udunit);
+    }
+    if (from_is_temp)
+    {
         ut_free(from_udunit);
+    }
+
+    return *converter == NULL ? -1 : 0;
+}
+
+/* Determine whether the conversion is affine (e.g. hPa -> Pa, K -> degC) and if so store the scale and offset.
+ * udunits does not expose the structure of a converter, so we derive scale and offset from converted values. The
+ * conversion is only marked as affine if applying the scale and offset ourselves gives exactly the same results as
+ * udunits for a range of test values.
+ */
+static void detect_affine_conversion(harp_unit_converter *unit_converter)
+{
+    static const double test_value[] = {
+        1.0, -1.0, 2.0, 0.5, 3.14159, -273.15, 1.0e-7, 1.0e5, 6.02214076e23, 1.0e-30, 1.0e30, 12345.678, -0.1
+    };
+    cv_converter *converter = unit_converter->converter;
+    double scale;
+    double offset;
+    int i;
+
+    unit_converter->affine_type = affine_none;
+
+    offset = cv_convert_double(converter, 0.0);
+    scale = cv_convert_double(converter, 1.0) - offset;
+    if (!harp_isfinite(offset) || !harp_isfinite(scale) || scale == 0)
+    {
+        return;
+    }
+    if (offset == 0)
+    {
+        scale = cv_convert_double(converter, 1.0);
+    }
+    else
+    {
+        int exponent;
+        double value;
+
+        /* use a value for which the offset falls below the precision of the result to get the exact scale */
+        frexp(fabs(offset / scale), &exponent);
+        exponent += 55;
+        if (exponent > 900)
+        {
+            return;
+        }
+        value = ldexp(1.0, exponent);
+        scale = cv_convert_double(converter, value) / value;
+        if (!harp_isfinite(scale) || scale == 0)
+        {
+            return;
+        }
+    }
+
+    for (i = 0; i < (int)(sizeof(test_value) / sizeof(test_value[0])); i++)
+    {
+        double expected = cv_convert_double(converter, test_value[i]);
+
+        if (offset == 0)
+        {
+            if (test_value[i] * scale != expected)
+            {
+                return;
+            }
+        }
+        else if (scale == 1)
+        {
+            if (test_value[i] + offset != expected)
+            {
+                return;
+            }
+        }
+        else if (test_value[i] * scale + offset != expected)
+        {
+            return;
+        }
+    }
+
+    if (offset == 0)
+    {
+        unit_converter->affine_type = affine_scale;
+    }
+    else
+    {
+        unit_converter->affine_type = scale == 1 ? affine_offset : affine_scale_offset;
+    }
+    unit_converter->scale = scale;
+    unit_converter->offset = offset;
+}
+
+static int unit_converter_new(const char *from_unit, const char *to_unit, harp_unit_converter **new_unit_converter)
+{
+    harp_unit_converter *unit_converter;
+    char *key = NULL;
+
+    if (from_unit == NULL || to_unit == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unit is NULL (%s:%lu)", __FILE__, __LINE__);
         return -1;
     }
 
@@ -349,72 +683,191 @@ int harp_unit_converter_new(const char *from_unit, const char *to_unit, harp_uni
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        sizeof(harp_unit_converter), __FILE__, __LINE__);
-        ut_free(to_udunit);
-        ut_free(from_udunit);
         return -1;
     }
+    unit_converter->converter = NULL;
+    unit_converter->is_cached = 0;
 
-    unit_converter->converter = ut_get_converter(from_udunit, to_udunit);
-    if (unit_converter->converter == NULL)
+    /* unit strings containing a newline can not be stored in the converter cache */
+    if (strchr(from_unit, '\n') == NULL && strchr(to_unit, '\n') == NULL)
     {
-        handle_udunits_error();
+        key = malloc(strlen(from_unit) + strlen(to_unit) + 2);
+        if (key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           strlen(from_unit) + strlen(to_unit) + 2, __FILE__, __LINE__);
+            harp_unit_converter_delete(unit_converter);
+            return -1;
+        }
+        sprintf(key, "%s\n%s", from_unit, to_unit);
+
+        unit_converter->converter = (cv_converter *)unit_cache_get(converter_cache, key);
+        if (unit_converter->converter != NULL)
+        {
+            unit_converter->is_cached = 1;
+            free(key);
+            detect_affine_conversion(unit_converter);
+            *new_unit_converter = unit_converter;
+            return 0;
+        }
+    }
+
+    if (get_converter(from_unit, to_unit, &unit_converter->converter) != 0)
+    {
+        if (key != NULL)
+        {
+            free(key);
+        }
         harp_unit_converter_delete(unit_converter);
-        ut_free(to_udunit);
-        ut_free(from_udunit);
         return -1;
     }
 
-    ut_free(to_udunit);
-    ut_free(from_udunit);
+    if (key != NULL)
+    {
+        int result;
+
+        result = unit_cache_add(&converter_cache, key, unit_converter->converter);
+        free(key);
+        if (result < 0)
+        {
+            harp_unit_converter_delete(unit_converter);
+            return -1;
+        }
+        unit_converter->is_cached = (result == 0);
+    }
+
+    detect_affine_conversion(unit_converter);
 
     *new_unit_converter = unit_converter;
     return 0;
 }
 
+int harp_unit_is_valid(const char *str)
+{
+    int result;
+
+    harp_mutex_lock(&unit_system_mutex);
+    result = unit_is_valid(str);
+    harp_mutex_unlock(&unit_system_mutex);
+
+    return result;
+}
+
+int harp_unit_converter_new(const char *from_unit, const char *to_unit, harp_unit_converter **new_unit_converter)
+{
+    int result;
+
+    harp_mutex_lock(&unit_system_mutex);
+    result = unit_converter_new(from_unit, to_unit, new_unit_converter);
+    harp_mutex_unlock(&unit_system_mutex);
+
+    return result;
+}
+
 double harp_unit_converter_convert(const harp_unit_converter *unit_converter, double value)
 {
+    switch (unit_converter->affine_type)
+    {
+        case affine_scale:
+            return value * unit_converter->scale;
+        case affine_offset:
+            return value + unit_converter->offset;
+        case affine_scale_offset:
+            return value * unit_converter->scale + unit_converter->offset;
+        case affine_none:
+            break;
+    }
+
     return cv_convert_double(unit_converter->converter, value);
 }
 
 void harp_unit_converter_convert_array(const harp_unit_converter *unit_converter, long num_values, double *value)
 {
-    double *value_end;
+    double scale = unit_converter->scale;
+    double offset = unit_converter->offset;
+    long i;
 
-    for (value_end = value + num_values; value != value_end; value++)
+    /* the loops for affine conversions are kept simple such that the compiler can vectorize them */
+    switch (unit_converter->affine_type)
     {
-        *value = cv_convert_double(unit_converter->converter, *value);
+        case affine_scale:
+            for (i = 0; i < num_values; i++)
+            {
+                value[i] = value[i] * scale;
+            }
+            break;
+        case affine_offset:
+            for (i = 0; i < num_values; i++)
+            {
+                value[i] = value[i] + offset;
+            }
+            break;
+        case affine_scale_offset:
+            for (i = 0; i < num_values; i++)
+            {
+                value[i] = value[i] * scale + offset;
+            }
+            break;
+        case affine_none:
+            for (i = 0; i < num_values; i++)
+            {
+                value[i] = cv_convert_double(unit_converter->converter, value[i]);
+            }
+            break;
     }
 }
 
-/**
- * Compare the two specified units. Units can compare equal even if their string representations are not, e.g. consider
- * "W" (Watt) and "J/s" (Joule per second).
- * \return
- *   \arg \c <0, \a unit_a is considered less than \a unit_b.
- *   \arg \c 0, \a unit_a and \a unit_b are considered equal.
- *   \arg \c >0, \a unit_a is considered greater than \a unit_b.
- */
-int harp_unit_compare(const char *unit_a, const char *unit_b)
+static int unit_compare(const char *unit_a, const char *unit_b)
 {
     ut_unit *udunit_a;
     ut_unit *udunit_b;
+    int a_is_temp;
+    int b_is_temp;
     int result;
 
-    if (parse_unit(unit_a, &udunit_a) != 0)
+    if (get_unit(unit_a, &udunit_a, &a_is_temp) != 0)
     {
         return -1;
     }
 
-    if (parse_unit(unit_b, &udunit_b) != 0)
+    if (get_unit(unit_b, &udunit_b, &b_is_temp) != 0)
     {
-        ut_free(udunit_a);
+        if (a_is_temp)
+        {
+            ut_free(udunit_a);
+        }
         return -1;
     }
 
     result = ut_compare(udunit_a, udunit_b);
 
-    ut_free(udunit_b);
-    ut_free(udunit_a);
+    if (b_is_temp)
+    {
+        ut_free(udunit_b);
+    }
+    if (a_is_temp)
+    {
+        ut_free(udunit_a);
+    }
+    return result;
+}
+
+/**
+ * Compare the two specified units. Units can compare equal even if their string representations are not, e.g. consider
+ * "W" (Watt) and "J/s" (Joule per second).
+ * \return
+ *   \arg \c <0, \a unit_a is considered less than \a unit_b.
+ *   \arg \c 0, \a unit_a and \a unit_b are considered equal.
+ *   \arg \c >0, \a unit_a is considered greater than \a unit_b.
+ */
+int harp_unit_compare(const char *unit_a, const char *unit_b)
+{
+    int result;
+
+    harp_mutex_lock(&unit_system_mutex);
+    result = unit_compare(unit_a, unit_b);
+    harp_mutex_unlock(&unit_system_mutex);
+
     return result;
 }
 
@@ -466,10 +919,17 @@ LIBHARP_API int harp_variable_convert_unit(harp_variable *variable, const char *
         harp_add_error_message(" (in unit conversion of variable '%s')", variable->name);
         return -1;
     }
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        harp_unit_converter_delete(unit_converter);
+        return -1;
+    }
+    harp_trace_begin("convert_unit(%s)", variable->name);
 
     /* Convert to double */
     if (harp_variable_convert_data_type(variable, harp_type_double) != 0)
     {
+        harp_trace_end();
         harp_unit_converter_delete(unit_converter);
         return -1;
     }
@@ -487,6 +947,47 @@ LIBHARP_API int harp_variable_convert_unit(harp_variable *variable, const char *
 
     variable->unit = strdup(target_unit);
     if (variable->unit == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_trace_end();
+        harp_unit_converter_delete(unit_converter);
+        return -1;
+    }
+
+    harp_trace_end();
+    harp_unit_converter_delete(unit_converter);
+    return 0;
+}
+
+/* Same as harp_variable_convert_unit(), but if the 'keep_float' option is enabled then a variable of type float keeps
+ * its data type (the conversion itself is still performed in double precision).
+ */
+int harp_variable_convert_unit_keep_float(harp_variable *variable, const char *target_unit)
+{
+    harp_unit_converter *unit_converter;
+    char *unit;
+    long i;
+
+    if (!harp_option_keep_float || variable->data_type != harp_type_float)
+    {
+        return harp_variable_convert_unit(variable, target_unit);
+    }
+
+    if (harp_unit_converter_new(variable->unit, target_unit, &unit_converter) != 0)
+    {
+        harp_add_error_message(" (in unit conversion of variable '%s')", variable->name);
+        return -1;
+    }
+
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        harp_unit_converter_delete(unit_converter);
+        return -1;
+    }
+
+    unit = strdup(target_unit);
+    if (unit == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
                        __LINE__);
@@ -494,11 +995,26 @@ LIBHARP_API int harp_variable_convert_unit(harp_variable *variable, const char *
         return -1;
     }
 
+    harp_trace_begin("convert_unit(%s)", variable->name);
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        variable->data.float_data[i] = (float)harp_unit_converter_convert(unit_converter, variable->data.float_data[i]);
+    }
+    variable->valid_min.float_data = (float)harp_unit_converter_convert(unit_converter, variable->valid_min.float_data);
+    variable->valid_max.float_data = (float)harp_unit_converter_convert(unit_converter, variable->valid_max.float_data);
+
+    harp_trace_end();
+
+    free(variable->unit);
+    variable->unit = unit;
+
     harp_unit_converter_delete(unit_converter);
     return 0;
 }
 
 void harp_unit_done()
 {
+    harp_mutex_lock(&unit_system_mutex);
     unit_system_done();
+    harp_mutex_unlock(&unit_system_mutex);
 }
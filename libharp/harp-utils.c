@@ -40,9 +40,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
 
 int harp_is_identifier(const char *name)
 {
@@ -440,6 +446,64 @@ int harp_path_for_program(const char *argv0, char **location)
     return 0;
 }
 
+/* Get the size of a file in bytes.
+ */
+int harp_get_file_size(const char *filename, int64_t *size)
+{
+    struct stat statbuf;
+
+    if (stat(filename, &statbuf) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_NOT_FOUND, "could not find %s", filename);
+        return -1;
+    }
+    *size = (int64_t)statbuf.st_size;
+
+    return 0;
+}
+
+/* Returns 1 if the filename is an s3://, http:// or https:// url of a file in (S3 compatible) remote object storage,
+ * and 0 otherwise.
+ */
+int harp_is_remote_url(const char *filename)
+{
+    if (filename == NULL)
+    {
+        return 0;
+    }
+    return strncmp(filename, "s3://", 5) == 0 || strncmp(filename, "http://", 7) == 0 ||
+        strncmp(filename, "https://", 8) == 0;
+}
+
+/* Return the elapsed (wall clock) time in seconds since an arbitrary starting point (only differences between two
+ * calls are meaningful).
+ */
+double harp_get_wall_time(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return (double)tv.tv_sec + 1.0e-6 * (double)tv.tv_usec;
+#endif
+}
+
+/* Return the processor time used by the process in seconds.
+ */
+double harp_get_cpu_time(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
 /** Returns the name of a data type.
  * \param data_type HARP basic data type
  * \return if the data type is known a string containing the name of the type, otherwise the string "unknown".
@@ -1265,77 +1329,171 @@ void harp_array_null(harp_data_type data_type, long num_elements, harp_array dat
     }
 }
 
-/** Replace each occurrence of a specific (fill) value in an array with the default HARP fill value for the specified
- *  data type.
- * \param data_type Data type of the array.
- * \param num_elements Number of elements in the array.
- * \param data Array to operate on.
- * \param fill_value Value to be replaced by the default HARP fill value for \a data_type.
- */
-void harp_array_replace_fill_value(harp_data_type data_type, long num_elements, harp_array data, harp_scalar fill_value)
+static long replace_invalid_int8(long num_elements, int8_t *data, int check_fill, int8_t fill_value, int8_t valid_min,
+                                 int8_t valid_max, int8_t harp_fill_value)
 {
-    harp_scalar harp_fill_value;
+    long num_invalid = 0;
     long i;
 
-    if (harp_is_fill_value_for_type(data_type, fill_value))
+    for (i = 0; i < num_elements; i++)
     {
-        return;
+        int8_t value = data[i];
+        int is_invalid = (check_fill & (value == fill_value)) | (value < valid_min) | (value > valid_max);
+
+        data[i] = is_invalid ? harp_fill_value : value;
+        num_invalid += is_invalid;
+    }
+
+    return num_invalid;
+}
+
+static long replace_invalid_int16(long num_elements, int16_t *data, int check_fill, int16_t fill_value,
+                                  int16_t valid_min, int16_t valid_max, int16_t harp_fill_value)
+{
+    long num_invalid = 0;
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        int16_t value = data[i];
+        int is_invalid = (check_fill & (value == fill_value)) | (value < valid_min) | (value > valid_max);
+
+        data[i] = is_invalid ? harp_fill_value : value;
+        num_invalid += is_invalid;
+    }
+
+    return num_invalid;
+}
+
+static long replace_invalid_int32(long num_elements, int32_t *data, int check_fill, int32_t fill_value,
+                                  int32_t valid_min, int32_t valid_max, int32_t harp_fill_value)
+{
+    long num_invalid = 0;
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        int32_t value = data[i];
+        int is_invalid = (check_fill & (value == fill_value)) | (value < valid_min) | (value > valid_max);
+
+        data[i] = is_invalid ? harp_fill_value : value;
+        num_invalid += is_invalid;
+    }
+
+    return num_invalid;
+}
+
+static long replace_invalid_float(long num_elements, float *data, int check_fill, float fill_value, float valid_min,
+                                  float valid_max, float harp_fill_value)
+{
+    long num_invalid = 0;
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        float value = data[i];
+        /* NaN is the only value that does not compare equal to itself */
+        int is_invalid = (value != value) | (check_fill & (value == fill_value)) | (value < valid_min) |
+            (value > valid_max);
+
+        data[i] = is_invalid ? harp_fill_value : value;
+        num_invalid += is_invalid;
+    }
+
+    return num_invalid;
+}
+
+static long replace_invalid_double(long num_elements, double *data, int check_fill, double fill_value, double valid_min,
+                                   double valid_max, double harp_fill_value)
+{
+    long num_invalid = 0;
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        double value = data[i];
+        /* NaN is the only value that does not compare equal to itself */
+        int is_invalid = (value != value) | (check_fill & (value == fill_value)) | (value < valid_min) |
+            (value > valid_max);
+
+        data[i] = is_invalid ? harp_fill_value : value;
+        num_invalid += is_invalid;
+    }
+
+    return num_invalid;
+}
+
+/* Replace all invalid values in an array by the default HARP fill value for the specified data type in a single pass.
+ * A value is invalid if it equals \a fill_value (if not NULL), if it is less than \a valid_min (if not NULL), if it is
+ * greater than \a valid_max (if not NULL), or if it is NaN (for floating point data; this also normalizes all NaN
+ * values to the HARP NaN).
+ * The conditions are evaluated without branches such that the compiler can vectorize the loop for each data type.
+ * Returns the number of invalid elements.
+ */
+long harp_array_replace_invalid_values(harp_data_type data_type, long num_elements, harp_array data,
+                                       const harp_scalar *fill_value, const harp_scalar *valid_min,
+                                       const harp_scalar *valid_max)
+{
+    harp_scalar harp_fill_value = harp_get_fill_value_for_type(data_type);
+    harp_scalar fill = harp_fill_value;
+    harp_scalar min = harp_get_valid_min_for_type(data_type);
+    harp_scalar max = harp_get_valid_max_for_type(data_type);
+    int check_fill = 0;
+
+    if (fill_value != NULL)
+    {
+        fill = *fill_value;
+        check_fill = 1;
+    }
+    if (valid_min != NULL)
+    {
+        min = *valid_min;
+    }
+    if (valid_max != NULL)
+    {
+        max = *valid_max;
     }
 
-    harp_fill_value = harp_get_fill_value_for_type(data_type);
     switch (data_type)
     {
         case harp_type_int8:
-            for (i = 0; i < num_elements; i++)
-            {
-                if (data.int8_data[i] == fill_value.int8_data)
-                {
-                    data.int8_data[i] = harp_fill_value.int8_data;
-                }
-            }
-            break;
+            return replace_invalid_int8(num_elements, data.int8_data, check_fill, fill.int8_data, min.int8_data,
+                                        max.int8_data, harp_fill_value.int8_data);
         case harp_type_int16:
-            for (i = 0; i < num_elements; i++)
-            {
-                if (data.int16_data[i] == fill_value.int16_data)
-                {
-                    data.int16_data[i] = harp_fill_value.int16_data;
-                }
-            }
-            break;
+            return replace_invalid_int16(num_elements, data.int16_data, check_fill, fill.int16_data, min.int16_data,
+                                         max.int16_data, harp_fill_value.int16_data);
         case harp_type_int32:
-            for (i = 0; i < num_elements; i++)
-            {
-                if (data.int32_data[i] == fill_value.int32_data)
-                {
-                    data.int32_data[i] = harp_fill_value.int32_data;
-                }
-            }
-            break;
+            return replace_invalid_int32(num_elements, data.int32_data, check_fill, fill.int32_data, min.int32_data,
+                                         max.int32_data, harp_fill_value.int32_data);
         case harp_type_float:
-            for (i = 0; i < num_elements; i++)
-            {
-                if (data.float_data[i] == fill_value.float_data)
-                {
-                    data.float_data[i] = harp_fill_value.float_data;
-                }
-            }
-            break;
+            return replace_invalid_float(num_elements, data.float_data, check_fill, fill.float_data, min.float_data,
+                                         max.float_data, harp_fill_value.float_data);
         case harp_type_double:
-            for (i = 0; i < num_elements; i++)
-            {
-                if (data.double_data[i] == fill_value.double_data)
-                {
-                    data.double_data[i] = harp_fill_value.double_data;
-                }
-            }
-            break;
+            return replace_invalid_double(num_elements, data.double_data, check_fill, fill.double_data,
+                                          min.double_data, max.double_data, harp_fill_value.double_data);
         default:
             assert(0);
             exit(1);
     }
 }
 
+/** Replace each occurrence of a specific (fill) value in an array with the default HARP fill value for the specified
+ *  data type.
+ * \param data_type Data type of the array.
+ * \param num_elements Number of elements in the array.
+ * \param data Array to operate on.
+ * \param fill_value Value to be replaced by the default HARP fill value for \a data_type.
+ */
+void harp_array_replace_fill_value(harp_data_type data_type, long num_elements, harp_array data, harp_scalar fill_value)
+{
+    if (harp_is_fill_value_for_type(data_type, fill_value))
+    {
+        return;
+    }
+
+    harp_array_replace_invalid_values(data_type, num_elements, data, &fill_value, NULL, NULL);
+}
+
 /** Invert the array across a given dimension
  * \param data_type Data type of the array.
  * \param dim_id Index of the dimension that should be inverted.
@@ -1463,213 +1621,290 @@ int harp_array_invert(harp_data_type data_type, int dim_id, int num_dimensions,
     return 0;
 }
 
-/** Permute the dimensions of an array.
+#define TRANSPOSE_BLOCK_SIZE 32
+
+/* Copy a plane of num_rows x num_columns elements from src[i * src_stride + j] to dst[i + j * dst_stride] (strides are
+ * in elements). The plane is processed in square blocks, such that the cache lines that are touched for reading as well
+ * as for writing are reused within a block.
+ */
+static void transpose_plane(uint8_t *dst, const uint8_t *src, long num_rows, long num_columns, long src_stride,
+                            long dst_stride, long element_size)
+{
+    long row_block, column_block;
+
+    for (row_block = 0; row_block < num_rows; row_block += TRANSPOSE_BLOCK_SIZE)
+    {
+        long row_end = row_block + TRANSPOSE_BLOCK_SIZE < num_rows ? row_block + TRANSPOSE_BLOCK_SIZE : num_rows;
+
+        for (column_block = 0; column_block < num_columns; column_block += TRANSPOSE_BLOCK_SIZE)
+        {
+            long column_end = column_block + TRANSPOSE_BLOCK_SIZE < num_columns ?
+                column_block + TRANSPOSE_BLOCK_SIZE : num_columns;
+            long i, j;
+
+#define TRANSPOSE_BLOCK(type) \
+            for (j = column_block; j < column_end; j++) \
+            { \
+                type *dst_column = &((type *)dst)[j * dst_stride]; \
+                const type *src_column = &((const type *)src)[j]; \
+                \
+                for (i = row_block; i < row_end; i++) \
+                { \
+                    dst_column[i] = src_column[i * src_stride]; \
+                } \
+            }
+
+            switch (element_size)
+            {
+                case 1:
+                    TRANSPOSE_BLOCK(uint8_t);
+                    break;
+                case 2:
+                    TRANSPOSE_BLOCK(uint16_t);
+                    break;
+                case 4:
+                    TRANSPOSE_BLOCK(uint32_t);
+                    break;
+                case 8:
+                    TRANSPOSE_BLOCK(uint64_t);
+                    break;
+                default:
+                    assert(0);
+                    exit(1);
+            }
+
+#undef TRANSPOSE_BLOCK
+        }
+    }
+}
+
+/** Permute the dimensions of an array and store the result in a separate destination array.
  *
- * If \a order is NULL, the order of the dimensions of the source array will be reversed, i.e. the array will be
- * transposed. For example, if the dimensions of the source array are [10, 20, 30], the dimensions of the destination
- * array will be [30, 20, 10]. (This is equivalent to specifying an order of [2, 1, 0].)
+ * The dimensions of the destination array are [dimension[order[0]], dimension[order[1]], ...]. If \a order is NULL,
+ * the order of the dimensions will be reversed (see also harp_array_transpose()). The source and destination array
+ * should not overlap.
  *
- * Otherwise, the order of the dimensions of the source array will permuted according to \a order. For example, if the
- * dimensions of the source array are [10, 20, 30] and the specified order is [1, 0, 2], the dimensions of the
- * destination array will be [20, 10, 30].
+ * The permutation is performed as a set of two-dimensional transposes of the planes that are spanned by the fastest
+ * running dimension of the source array and the fastest running dimension of the destination array, each of which is
+ * processed in cache sized blocks. Trailing dimensions that keep their position are copied as contiguous blocks.
  *
  * \param data_type Data type of the array.
  * \param num_dimensions Number of dimensions in the array.
- * \param dimension Dimension lengths of the array.
+ * \param dimension Dimension lengths of the source array.
  * \param order If NULL, reverse the order of the dimensions of the array, otherwise permute the order of the dimensions
  *   of the array according to the order specified.
- * \param data Array of which the dimensions should be permuted.
+ * \param src Array of which the dimensions should be permuted.
+ * \param dst Array in which the permuted data will be stored (should have room for all elements of \a src).
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-int harp_array_transpose(harp_data_type data_type, int num_dimensions, const long *dimension, const int *order,
-                         harp_array data)
+int harp_array_transpose_to(harp_data_type data_type, int num_dimensions, const long *dimension, const int *order,
+                            harp_array src, harp_array dst)
 {
-    long rindex[HARP_MAX_NUM_DIMS] = { 0 };     /* reversed index in multi-dimensional array */
-    long rdim[HARP_MAX_NUM_DIMS];       /* reversed order of dim[] */
-    long stride[HARP_MAX_NUM_DIMS];     /* stride in the destination array (in reverse order) */
+    int dst_order[HARP_MAX_NUM_DIMS];   /* map from destination dimension index to source dimension index */
+    int iorder[HARP_MAX_NUM_DIMS];      /* map from source dimension index to destination dimension index */
+    long dim[HARP_MAX_NUM_DIMS];        /* (collapsed) dimensions of the source array */
+    long src_stride[HARP_MAX_NUM_DIMS]; /* stride in the source array for each source dimension */
+    long dst_stride[HARP_MAX_NUM_DIMS]; /* stride in the destination array for each source dimension */
+    long outer_index[HARP_MAX_NUM_DIMS];
+    int outer_dim[HARP_MAX_NUM_DIMS];
+    int num_outer = 0;
     long num_elements;
+    long num_blocks;
     long element_size;
-    long index = 0;
-    long i;
-    uint8_t *src;
-    uint8_t *dst;
-
-    if (num_dimensions <= 1)
-    {
-        /* nothing to do */
-        return 0;
-    }
+    long src_offset = 0;
+    long dst_offset = 0;
+    long block;
+    int row_dim;
+    int column_dim;
+    int i;
 
+    element_size = harp_get_size_for_type(data_type);
     num_elements = harp_get_num_elements(num_dimensions, dimension);
-    if (num_elements <= 1)
-    {
-        /* nothing to do */
-        return 0;
-    }
-
-    for (i = 0; i < num_dimensions; i++)
-    {
-        rdim[i] = dimension[num_dimensions - 1 - i];
-    }
 
     if (order == NULL)
     {
-        /* By default, reverse the order of the dimensions. */
-        stride[num_dimensions - 1] = 1;
-        for (i = num_dimensions - 1; i > 0; i--)
+        for (i = 0; i < num_dimensions; i++)
         {
-            stride[i - 1] = stride[i] * rdim[i];
+            dst_order[i] = num_dimensions - 1 - i;
         }
     }
     else
     {
-        int iorder[HARP_MAX_NUM_DIMS] = { 0 };  /* map from destination dimension index to source dimension index */
-
-        /* Compute the map from destination dimension index to source dimension index (i.e. the inverse of order, which
-         * is the map from source dimension index to destination dimension index.
-         */
+        for (i = 0; i < num_dimensions; i++)
+        {
+            iorder[i] = -1;
+        }
         for (i = 0; i < num_dimensions; i++)
         {
             if (order[i] < 0 || order[i] >= num_dimensions)
             {
                 harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dimension index '%d' out of bounds at index %d of "
-                               "dimension order (%s:%lu)", order[i], i, __FILE__, __LINE__);
+                               "dimension order (%s:%u)", order[i], i, __FILE__, __LINE__);
                 return -1;
             }
-
-            if (iorder[order[i]] != 0)
+            if (iorder[order[i]] != -1)
             {
                 harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "duplicate dimension index '%d' at index %d of dimension "
                                "order (%s:%u)", order[i], i, __FILE__, __LINE__);
                 return -1;
             }
-
             iorder[order[i]] = i;
+            dst_order[i] = order[i];
         }
+    }
 
-        /* Compute the stride in the destination array for each dimension of the source array in reverse order. For
-         * example, stride[0] is the stride in the destination array when moving along the fastest running dimension of
-         * the source array (i.e. the dimension with index num_dimensions - 1).
-         */
-        for (i = 0; i < num_dimensions; i++)
+    for (i = 0; i < num_dimensions; i++)
+    {
+        dim[i] = dimension[i];
+    }
+
+    /* collapse trailing dimensions that keep their position into a single dimension */
+    while (num_dimensions > 1 && dst_order[num_dimensions - 1] == num_dimensions - 1 &&
+           dst_order[num_dimensions - 2] == num_dimensions - 2)
+    {
+        dim[num_dimensions - 2] *= dim[num_dimensions - 1];
+        num_dimensions--;
+    }
+
+    if (num_elements <= 1 || num_dimensions <= 1)
+    {
+        memcpy(dst.ptr, src.ptr, num_elements * element_size);
+        return 0;
+    }
+
+    src_stride[num_dimensions - 1] = 1;
+    for (i = num_dimensions - 2; i >= 0; i--)
+    {
+        src_stride[i] = src_stride[i + 1] * dim[i + 1];
+    }
+    dst_stride[dst_order[num_dimensions - 1]] = 1;
+    for (i = num_dimensions - 2; i >= 0; i--)
+    {
+        dst_stride[dst_order[i]] = dst_stride[dst_order[i + 1]] * dim[dst_order[i + 1]];
+    }
+
+    /* The plane to transpose is spanned by the fastest running dimension of the destination array (rows) and the
+     * fastest running dimension of the source array (columns). If these are the same dimension then its elements are
+     * contiguous in both arrays and are copied as a single run.
+     */
+    row_dim = dst_order[num_dimensions - 1];
+    column_dim = num_dimensions - 1;
+    if (row_dim == column_dim)
+    {
+        num_blocks = num_elements / dim[column_dim];
+    }
+    else
+    {
+        num_blocks = num_elements / (dim[row_dim] * dim[column_dim]);
+    }
+    for (i = 0; i < num_dimensions; i++)
+    {
+        if (i != row_dim && i != column_dim)
+        {
+            outer_dim[num_outer] = i;
+            outer_index[num_outer] = 0;
+            num_outer++;
+        }
+    }
+
+    for (block = 0; block < num_blocks; block++)
+    {
+        if (row_dim == column_dim)
+        {
+            memcpy((uint8_t *)dst.ptr + dst_offset * element_size, (uint8_t *)src.ptr + src_offset * element_size,
+                   dim[column_dim] * element_size);
+        }
+        else
+        {
+            transpose_plane((uint8_t *)dst.ptr + dst_offset * element_size,
+                            (uint8_t *)src.ptr + src_offset * element_size, dim[row_dim], dim[column_dim],
+                            src_stride[row_dim], dst_stride[column_dim], element_size);
+        }
+
+        /* advance the (row-major) index of the remaining dimensions */
+        for (i = num_outer - 1; i >= 0; i--)
         {
-            long j;
+            int k = outer_dim[i];
 
-            stride[num_dimensions - 1 - i] = 1;
-            for (j = iorder[i] + 1; j < num_dimensions; j++)
+            outer_index[i]++;
+            src_offset += src_stride[k];
+            dst_offset += dst_stride[k];
+            if (outer_index[i] < dim[k])
             {
-                stride[num_dimensions - 1 - i] *= dimension[order[j]];
+                break;
             }
+            src_offset -= outer_index[i] * src_stride[k];
+            dst_offset -= outer_index[i] * dst_stride[k];
+            outer_index[i] = 0;
         }
     }
 
-    element_size = harp_get_size_for_type(data_type);
-    src = (uint8_t *)data.ptr;
+    return 0;
+}
+
+/** Permute the dimensions of an array.
+ *
+ * If \a order is NULL, the order of the dimensions of the source array will be reversed, i.e. the array will be
+ * transposed. For example, if the dimensions of the source array are [10, 20, 30], the dimensions of the destination
+ * array will be [30, 20, 10]. (This is equivalent to specifying an order of [2, 1, 0].)
+ *
+ * Otherwise, the order of the dimensions of the source array will permuted according to \a order. For example, if the
+ * dimensions of the source array are [10, 20, 30] and the specified order is [1, 0, 2], the dimensions of the
+ * destination array will be [20, 10, 30].
+ *
+ * The permutation is performed in a temporary buffer, which is copied back into \a data afterwards. Use
+ * harp_array_transpose_to() to store the result directly in a separate array.
+ *
+ * \param data_type Data type of the array.
+ * \param num_dimensions Number of dimensions in the array.
+ * \param dimension Dimension lengths of the array.
+ * \param order If NULL, reverse the order of the dimensions of the array, otherwise permute the order of the dimensions
+ *   of the array according to the order specified.
+ * \param data Array of which the dimensions should be permuted.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_array_transpose(harp_data_type data_type, int num_dimensions, const long *dimension, const int *order,
+                         harp_array data)
+{
+    harp_array dst;
+    long num_elements;
+    long element_size;
 
-    dst = (uint8_t *)malloc(num_elements * element_size);
-    if (dst == NULL)
+    if (num_dimensions <= 1)
+    {
+        /* nothing to do */
+        return 0;
+    }
+
+    num_elements = harp_get_num_elements(num_dimensions, dimension);
+    if (num_elements <= 1)
+    {
+        /* nothing to do */
+        return 0;
+    }
+
+    element_size = harp_get_size_for_type(data_type);
+    dst.ptr = malloc(num_elements * element_size);
+    if (dst.ptr == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        num_elements * element_size, __FILE__, __LINE__);
         return -1;
     }
 
-    switch (element_size)
+    if (harp_array_transpose_to(data_type, num_dimensions, dimension, order, data, dst) != 0)
     {
-        case 1:
-            dst[index] = src[i];
-            index = stride[0];
-            rindex[0] = 1;
-            for (i = 1; i < num_elements; i++)
-            {
-                int j = 0;
-
-                while (rindex[j] == rdim[j])
-                {
-                    rindex[j] = 0;
-                    index -= stride[j] * rdim[j];
-                    j++;
-                    index += stride[j];
-                    rindex[j]++;
-                }
-                dst[index] = src[i];
-                index += stride[0];
-                rindex[0]++;
-            }
-            break;
-        case 2:
-            ((uint16_t *)dst)[0] = ((uint16_t *)src)[0];
-            index = stride[0];
-            rindex[0] = 1;
-            for (i = 1; i < num_elements; i++)
-            {
-                int j = 0;
-
-                while (rindex[j] == rdim[j])
-                {
-                    rindex[j] = 0;
-                    index -= stride[j] * rdim[j];
-                    j++;
-                    index += stride[j];
-                    rindex[j]++;
-                }
-                ((uint16_t *)dst)[index] = ((uint16_t *)src)[i];
-                index += stride[0];
-                rindex[0]++;
-            }
-            break;
-        case 4:
-            ((uint32_t *)dst)[0] = ((uint32_t *)src)[0];
-            index = stride[0];
-            rindex[0] = 1;
-            for (i = 1; i < num_elements; i++)
-            {
-                int j = 0;
-
-                while (rindex[j] == rdim[j])
-                {
-                    rindex[j] = 0;
-                    index -= stride[j] * rdim[j];
-                    j++;
-                    index += stride[j];
-                    rindex[j]++;
-                }
-                ((uint32_t *)dst)[index] = ((uint32_t *)src)[i];
-                index += stride[0];
-                rindex[0]++;
-            }
-            break;
-        case 8:
-            ((uint64_t *)dst)[0] = ((uint64_t *)src)[0];
-            index = stride[0];
-            rindex[0] = 1;
-            for (i = 1; i < num_elements; i++)
-            {
-                long j = 0;
-
-                while (rindex[j] == rdim[j])
-                {
-                    rindex[j] = 0;
-                    index -= stride[j] * rdim[j];
-                    j++;
-                    index += stride[j];
-                    rindex[j]++;
-                }
-                ((uint64_t *)dst)[index] = ((uint64_t *)src)[i];
-                index += stride[0];
-                rindex[0]++;
-            }
-            break;
-        default:
-            assert(0);
-            exit(1);
+        free(dst.ptr);
+        return -1;
     }
 
-    memcpy(data.ptr, dst, num_elements * element_size);
+    memcpy(data.ptr, dst.ptr, num_elements * element_size);
 
-    free(dst);
+    free(dst.ptr);
 
     return 0;
 }
@@ -30,6 +30,7 @@
  */
 
 #include "harp-internal.h"
+#include "harp-thread.h"
 
 #include <assert.h>
 #include <math.h>
@@ -37,6 +38,233 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Reference counted block of variable data that is shared by several variables (see harp_variable_copy_shared()).
+ * Each variable that refers to the block has its borrowed_data flag set, such that it will first make its own copy
+ * of the data before modifying it (unless it is the last variable that refers to the block).
+ * A block can also be external memory (e.g. a shared memory mapping, see harp_shared_block_new()) that holds the data
+ * of several variables. Such a block is given back using its release function and is never taken over by a variable.
+ */
+typedef struct shared_data_struct
+{
+    long ref_count;
+    void *ptr;
+    int64_t size;       /* number of allocated bytes (as accounted for using harp_memory_reserve()) */
+    void (*release) (void *ptr, int64_t size);  /* release function for external blocks (NULL otherwise) */
+} shared_data;
+
+static harp_mutex shared_data_mutex = HARP_MUTEX_INITIALIZER;
+
+/* Remove the reference of a variable to a shared data block; the block is freed when no references are left. */
+static void shared_data_release(shared_data *block)
+{
+    long ref_count;
+
+    harp_mutex_lock(&shared_data_mutex);
+    block->ref_count--;
+    ref_count = block->ref_count;
+    harp_mutex_unlock(&shared_data_mutex);
+
+    if (ref_count == 0)
+    {
+        if (block->release != NULL)
+        {
+            block->release(block->ptr, block->size);
+        }
+        else
+        {
+            harp_free(block->ptr);
+            harp_memory_release(block->size);
+        }
+        free(block);
+    }
+}
+
+/* Create a reference counted block for external memory that will hold the data of one or more variables (see
+ * harp_variable_new_with_shared_block()). The caller holds the initial reference, which should be given up using
+ * harp_shared_block_release(); release() is called once no references to the block are left.
+ */
+int harp_shared_block_new(void *ptr, int64_t size, void (*release) (void *ptr, int64_t size), void **new_block)
+{
+    shared_data *block;
+
+    block = (shared_data *)malloc(sizeof(shared_data));
+    if (block == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(shared_data), __FILE__, __LINE__);
+        return -1;
+    }
+    block->ref_count = 1;
+    block->ptr = ptr;
+    block->size = size;
+    block->release = release;
+
+    *new_block = block;
+    return 0;
+}
+
+/* Give up a reference to a block that was created using harp_shared_block_new(). */
+void harp_shared_block_release(void *block)
+{
+    shared_data_release((shared_data *)block);
+}
+
+/* Block of memory into which the strings of a string variable can point.
+ * Strings in the arena are not allocated individually; they are released together with the arena when the variable is
+ * deleted. Consecutive elements with the same value may point to the same string in the arena. A variable can have a
+ * mix of strings in its arena and individually allocated strings (e.g. after harp_variable_set_string_data_element()).
+ */
+typedef struct string_arena_struct
+{
+    char *ptr;
+    size_t size;        /* number of allocated bytes */
+    size_t used;        /* number of bytes in use */
+} string_arena;
+
+static int is_arena_string(const harp_variable *variable, const char *str)
+{
+    const string_arena *arena = (const string_arena *)variable->string_arena;
+
+    return arena != NULL && str >= arena->ptr && str < arena->ptr + arena->size;
+}
+
+/* Free a string of a string variable, unless it is stored in the string arena of the variable */
+static void free_string(const harp_variable *variable, char *str)
+{
+    if (str != NULL && !is_arena_string(variable, str))
+    {
+        free(str);
+    }
+}
+
+static void string_arena_delete(string_arena *arena)
+{
+    if (arena != NULL)
+    {
+        if (arena->ptr != NULL)
+        {
+            free(arena->ptr);
+        }
+        free(arena);
+    }
+}
+
+/* Make sure that the string arena of a variable has room for at least 'size' more bytes.
+ * If the arena needs to be moved, all strings of the variable that point into the arena are updated.
+ */
+static int string_arena_reserve(harp_variable *variable, size_t size)
+{
+    string_arena *arena = (string_arena *)variable->string_arena;
+    size_t new_size;
+    char *ptr;
+    long i;
+
+    if (arena == NULL)
+    {
+        arena = (string_arena *)malloc(sizeof(string_arena));
+        if (arena == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(string_arena), __FILE__, __LINE__);
+            return -1;
+        }
+        arena->ptr = NULL;
+        arena->size = 0;
+        arena->used = 0;
+        variable->string_arena = arena;
+    }
+    if (arena->used + size <= arena->size)
+    {
+        return 0;
+    }
+
+    new_size = arena->size + arena->size / 2;
+    if (new_size < arena->used + size)
+    {
+        new_size = arena->used + size;
+    }
+    ptr = (char *)malloc(new_size);
+    if (ptr == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", new_size,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    if (arena->ptr != NULL)
+    {
+        memcpy(ptr, arena->ptr, arena->used);
+        for (i = 0; i < variable->num_elements; i++)
+        {
+            if (variable->data.string_data[i] != NULL && is_arena_string(variable, variable->data.string_data[i]))
+            {
+                variable->data.string_data[i] = ptr + (variable->data.string_data[i] - arena->ptr);
+            }
+        }
+        free(arena->ptr);
+    }
+    arena->ptr = ptr;
+    arena->size = new_size;
+
+    return 0;
+}
+
+/* Copy a string of the given length (which does not need to be zero terminated) into the string arena.
+ * The arena should have room for at least length + 1 bytes (see string_arena_reserve()).
+ */
+static char *string_arena_add(harp_variable *variable, const char *str, size_t length)
+{
+    string_arena *arena = (string_arena *)variable->string_arena;
+    char *arena_str = arena->ptr + arena->used;
+
+    assert(arena->used + length + 1 <= arena->size);
+    memcpy(arena_str, str, length);
+    arena_str[length] = '\0';
+    arena->used += length + 1;
+
+    return arena_str;
+}
+
+/* Store copies of 'num_strings' strings at element 'offset' onwards of a string variable using the string arena.
+ * Elements that equal the previous element (such as repeated station identifiers or source product names) share
+ * their copy in the arena. NULL strings are kept as NULL. The target elements should not contain any strings yet.
+ */
+static int set_string_data_from_strings(harp_variable *variable, long offset, long num_strings, char **string_data)
+{
+    size_t size = 0;
+    long i;
+
+    for (i = 0; i < num_strings; i++)
+    {
+        if (string_data[i] != NULL && (i == 0 || string_data[i - 1] == NULL ||
+                                       strcmp(string_data[i], string_data[i - 1]) != 0))
+        {
+            size += strlen(string_data[i]) + 1;
+        }
+    }
+    if (size > 0 && string_arena_reserve(variable, size) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < num_strings; i++)
+    {
+        if (string_data[i] == NULL)
+        {
+            variable->data.string_data[offset + i] = NULL;
+        }
+        else if (i > 0 && string_data[i - 1] != NULL && strcmp(string_data[i], string_data[i - 1]) == 0)
+        {
+            variable->data.string_data[offset + i] = variable->data.string_data[offset + i - 1];
+        }
+        else
+        {
+            variable->data.string_data[offset + i] = string_arena_add(variable, string_data[i],
+                                                                      strlen(string_data[i]));
+        }
+    }
+
+    return 0;
+}
+
 /** \defgroup harp_variable HARP Variables
  * The HARP Variables module contains everything related to HARP variables.
  */
@@ -318,156 +546,670 @@ int harp_variable_set_enumeration_values_using_flag_meanings(harp_variable *vari
     return 0;
 }
 
-/** Rearrange the data of a variable in one dimension.
- * This function allows data of a variable to be rearranged according to the order of the indices in dim_element_id.
- * The number of indices (num_dim_elements) in dim_element_id does not have to correspond to the number of
- * elements in the specified (dim_index) dimension. This means that the data block will grow/shrink when the amount of
- * elements in dim_element_id is larger/smaller (note that the amount of elements can only become larger if elements
- * are duplicated).
- *
- * \param variable Pointer to variable that should have its data rearranged.
- * \param dim_index The id of the dimension in which the rearrangement should take place.
- * \param num_dim_elements Number of elements in dim_element_id.
- * \param dim_element_ids An array containing the ids in dimension dim_index in the new arrangement (ids may occur more
- * than once and the number of ids may be smaller or larger than the length of dimension dim_index).
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
+/* Change the amount of memory that is allocated for the data of a variable to num_elements elements (keeping the
+ * existing content); the change in memory usage is accounted for using harp_memory_reserve()/harp_memory_release().
  */
-int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, long num_dim_elements,
-                                      const long *dim_element_ids)
+int harp_variable_reallocate_data(harp_variable *variable, long num_elements)
 {
-    char *buffer;
-    long *move_to_id;
-    int8_t *moved;
-    long new_num_elements;
-    long num_groups;
-    long num_block_elements;
-    long element_size;
-    long filter_block_size;
-    long i_increment;
-    long i;
-    int needs_shuffle;
+    int64_t element_size = harp_get_size_for_type(variable->data_type);
+    int64_t size_change;
+    void *data;
 
-    /* The multidimensional array is split in three parts:
-     *   num_elements = num_groups * dim[dim_index] * num_block_elements
-     *   new_num_elements = num_groups * num_dim_elements * num_block_elements */
-    if (variable == NULL)
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is NULL (%s:%u)", __FILE__, __LINE__);
-        return -1;
-    }
-    if (num_dim_elements <= 0)
+    if (harp_variable_make_data_owned(variable) != 0)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_dim_elements argument <= 0 (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
-    if (dim_element_ids == NULL)
+    size_change = (num_elements - variable->num_allocated_elements) * element_size;
+    if (size_change > 0 && harp_memory_reserve(size_change) != 0)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dim_element_ids argument is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
-    if (dim_index < 0 || dim_index >= variable->num_dimensions)
+    data = harp_realloc(variable->data.ptr, (size_t)(num_elements * element_size));
+    if (data == NULL)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dim_index argument (%d) is not in the range [0,%d) (%s:%u)",
-                       dim_index, variable->num_dimensions, __FILE__, __LINE__);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (size_t)(num_elements * element_size), __FILE__, __LINE__);
+        if (size_change > 0)
+        {
+            harp_memory_release(size_change);
+        }
         return -1;
     }
-    if (variable->num_elements == 0)
+    if (size_change < 0)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot reshape variable '%s' (variable has 0 elements) (%s:%u)",
-                       variable->name, __FILE__, __LINE__);
-        return -1;
+        harp_memory_release(-size_change);
     }
+    variable->data.ptr = data;
+    variable->num_allocated_elements = num_elements;
 
-    needs_shuffle = num_dim_elements != variable->dimension[dim_index];
-    for (i = 0; i < num_dim_elements; i++)
+    return 0;
+}
+
+/* Returns the length of a string of at most max_length characters that is not necessarily zero terminated */
+static size_t fixed_string_length(const char *str, long max_length)
+{
+    const char *end = (const char *)memchr(str, '\0', (size_t)max_length);
+
+    return end != NULL ? (size_t)(end - str) : (size_t)max_length;
+}
+
+/* Free the strings of elements offset .. offset + num_elements - 1 of a string variable (taking the string arena of
+ * the variable into account) and set these elements to NULL.
+ */
+void harp_variable_free_strings(harp_variable *variable, long offset, long num_elements)
+{
+    long i;
+
+    for (i = offset; i < offset + num_elements; i++)
     {
-        if (dim_element_ids[i] < 0 || dim_element_ids[i] >= variable->dimension[dim_index])
-        {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
-                           "dim_element_ids[%d] argument (%d) is not in the range [0,%d) (%s:%u)",
-                           i, dim_element_ids[i], variable->dimension[dim_index], __FILE__, __LINE__);
-            return -1;
-        }
-        if (dim_element_ids[i] != i)
-        {
-            needs_shuffle = 1;
-        }
+        free_string(variable, variable->data.string_data[i]);
+        variable->data.string_data[i] = NULL;
     }
-    if (!needs_shuffle)
+}
+
+/* Give each string of a string variable its own allocation and remove the string arena of the variable.
+ * This is needed before passing the string data to functions that free strings individually.
+ */
+int harp_variable_make_strings_owned(harp_variable *variable)
+{
+    long i;
+
+    if (variable->string_arena == NULL)
     {
-        /* all ellements are already in the right location, don't do anything */
         return 0;
     }
-
-    /* Calculate the number of times we have to reshuffle the indices (i.e. the product of the higher dimensions). */
-    num_groups = 1;
-    for (i = 0; i < (long)dim_index; i++)
+    for (i = 0; i < variable->num_elements; i++)
     {
-        num_groups *= variable->dimension[i];
+        if (variable->data.string_data[i] != NULL && is_arena_string(variable, variable->data.string_data[i]))
+        {
+            char *str = strdup(variable->data.string_data[i]);
+
+            if (str == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)",
+                               __FILE__, __LINE__);
+                return -1;
+            }
+            variable->data.string_data[i] = str;
+        }
     }
+    string_arena_delete((string_arena *)variable->string_arena);
+    variable->string_arena = NULL;
 
-    /* Calculate the number of elements per block - a block can be moved with one memcpy(). */
-    num_block_elements = variable->num_elements / (num_groups * variable->dimension[dim_index]);
+    return 0;
+}
 
-    /* Calculate the new total number of elements. */
-    new_num_elements = num_groups * num_dim_elements * num_block_elements;
+/* Set all elements of a string variable from a buffer of fixed length strings (as read from e.g. a netCDF char
+ * array). Each string consists of at most string_length characters and ends at the first zero character (if any).
+ * All strings are stored in the string arena of the variable, which avoids a separate allocation for each element.
+ * The variable should not contain any strings yet.
+ */
+int harp_variable_set_string_data_from_char_array(harp_variable *variable, long string_length, const char *buffer)
+{
+    size_t size = 0;
+    long i;
 
-    /* Calculate the element size and block size */
-    element_size = harp_get_size_for_type(variable->data_type);
-    filter_block_size = num_block_elements * element_size;
+    assert(variable->data_type == harp_type_string);
 
-    /* If num_dim_elements > dimension[dim_index] then increase the memory for variable->data. */
-    if (num_dim_elements > variable->dimension[dim_index])
+    for (i = 0; i < variable->num_elements; i++)
     {
-        void *variable_data;
+        const char *str = &buffer[i * string_length];
 
-        variable_data = realloc(variable->data.ptr, (size_t)new_num_elements * element_size);
-        if (variable_data == NULL)
+        if (i == 0 || memcmp(str, str - string_length, (size_t)string_length) != 0)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %u bytes) (%s:%u)",
-                           new_num_elements * element_size, __FILE__, __LINE__);
-            return -1;
+            size += fixed_string_length(str, string_length) + 1;
         }
-
-        variable->data.ptr = variable_data;
     }
-
-    /* Determine the positions where the old elements should end up.
-     * In case an element will end up in more than one position we determine the first. */
-    move_to_id = (long *)malloc((size_t)variable->dimension[dim_index] * sizeof(long));
-    if (move_to_id == NULL)
+    if (size > 0 && string_arena_reserve(variable, size) != 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       variable->dimension[dim_index] * sizeof(long), __FILE__, __LINE__);
         return -1;
     }
-    for (i = 0; i < variable->dimension[dim_index]; i++)
-    {
-        move_to_id[i] = -1;     /* by default an element will be removed */
-    }
-    for (i = 0; i < num_dim_elements; i++)
+    for (i = 0; i < variable->num_elements; i++)
     {
-        if (move_to_id[dim_element_ids[i]] == -1)
+        const char *str = &buffer[i * string_length];
+
+        if (i > 0 && memcmp(str, str - string_length, (size_t)string_length) == 0)
         {
-            move_to_id[dim_element_ids[i]] = i;
+            variable->data.string_data[i] = variable->data.string_data[i - 1];
+        }
+        else
+        {
+            variable->data.string_data[i] = string_arena_add(variable, str, fixed_string_length(str, string_length));
         }
     }
 
-    /* Temporary storage room for a block */
-    buffer = (char *)malloc((size_t)filter_block_size);
-    if (buffer == NULL)
-    {
-        free(move_to_id);
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %u bytes) (%s:%u)",
-                       filter_block_size, __FILE__, __LINE__);
-        return -1;
-    }
+    return 0;
+}
 
-    /* Create temporary array that indicates whether a block has already been moved to its 'move_to_id' position */
-    moved = (int8_t *)malloc((size_t)variable->dimension[dim_index] * sizeof(int8_t));
-    if (moved == NULL)
+/* Gather blocks along a dimension: for each group, the block with index dim_element_ids[j] in source ends up at index j
+ * in target. Runs of consecutive ids are moved with a single memmove(), which also allows target == source if the ids
+ * are strictly increasing (the data then only moves towards the start of the buffer).
+ */
+static void gather_blocks(char *target, const char *source, long num_groups, long dimension_length,
+                          long num_dim_elements, const long *dim_element_ids, long block_size)
+{
+    long i;
+
+    for (i = 0; i < num_groups; i++)
+    {
+        const char *group_source = source + i * dimension_length * block_size;
+        char *group_target = target + i * num_dim_elements * block_size;
+        long j = 0;
+
+        while (j < num_dim_elements)
+        {
+            long run_length = 1;
+
+            while (j + run_length < num_dim_elements &&
+                   dim_element_ids[j + run_length] == dim_element_ids[j] + run_length)
+            {
+                run_length++;
+            }
+            if (run_length == 1 && block_size == 8)
+            {
+                memcpy(&group_target[j * 8], &group_source[dim_element_ids[j] * 8], 8);
+            }
+            else if (run_length == 1 && block_size == 4)
+            {
+                memcpy(&group_target[j * 4], &group_source[dim_element_ids[j] * 4], 4);
+            }
+            else if (&group_target[j * block_size] != &group_source[dim_element_ids[j] * block_size])
+            {
+                memmove(&group_target[j * block_size], &group_source[dim_element_ids[j] * block_size],
+                        (size_t)(run_length * block_size));
+            }
+            j += run_length;
+        }
+    }
+}
+
+/** Release a spare data buffer (see harp_variable_rearrange_dimension_with_spare()).
+ * \param spare Spare buffer that should be released.
+ */
+void harp_spare_buffer_done(harp_spare_buffer *spare)
+{
+    if (spare->data != NULL)
+    {
+        harp_free(spare->data);
+        harp_memory_release(spare->size);
+    }
+    spare->data = NULL;
+    spare->size = 0;
+}
+
+/* Release the current data buffer of a variable (the data should already have been moved elsewhere). A buffer that is
+ * owned by the variable is kept as spare buffer (if spare is not NULL and the buffer is larger than the current spare
+ * buffer), such that it can be reused for the next variable.
+ */
+static void release_data_buffer(harp_variable *variable, harp_spare_buffer *spare)
+{
+    if (variable->shared_data != NULL)
+    {
+        shared_data_release((shared_data *)variable->shared_data);
+        variable->shared_data = NULL;
+    }
+    else if (!variable->borrowed_data)
+    {
+        int64_t size = (int64_t)variable->num_allocated_elements * harp_get_size_for_type(variable->data_type);
+
+        if (spare != NULL && size > spare->size)
+        {
+            harp_spare_buffer_done(spare);
+            spare->data = variable->data.ptr;
+            spare->size = size;
+        }
+        else
+        {
+            harp_free(variable->data.ptr);
+            harp_memory_release(size);
+        }
+    }
+    variable->data.ptr = NULL;
+    variable->borrowed_data = 0;
+}
+
+/* Allocate a buffer for new_num_elements elements of the data type of the variable (taken from spare if that is large
+ * enough). Returns 1 if no buffer could be allocated (with the HARP error set).
+ */
+static int allocate_new_buffer(const harp_variable *variable, long new_num_elements, harp_spare_buffer *spare,
+                               char **data, long *num_allocated_elements)
+{
+    int64_t element_size = harp_get_size_for_type(variable->data_type);
+    int64_t size = (int64_t)new_num_elements * element_size;
+
+    if (spare != NULL && spare->data != NULL && spare->size >= size && spare->size <= 2 * size)
+    {
+        /* (a much larger spare buffer is not used, to avoid keeping too much memory allocated for a small variable)
+         * only account for the part of the spare buffer that can hold whole elements */
+        *data = spare->data;
+        *num_allocated_elements = (long)(spare->size / element_size);
+        harp_memory_release(spare->size - *num_allocated_elements * element_size);
+        spare->data = NULL;
+        spare->size = 0;
+        return 0;
+    }
+
+    if (harp_memory_reserve(size) != 0)
+    {
+        return 1;
+    }
+    *data = (char *)harp_malloc((size_t)size);
+    if (*data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", (long)size,
+                       __FILE__, __LINE__);
+        harp_memory_release(size);
+        return 1;
+    }
+    *num_allocated_elements = new_num_elements;
+
+    return 0;
+}
+
+/* Gather the selected elements of a dimension of a variable into a new buffer (taken from spare if that is large
+ * enough), which becomes the (owned) data of the variable. For string variables the string pointers are moved to the
+ * new buffer, so dim_element_ids should not contain duplicates and should include all ids of the dimension.
+ * Returns 1 if no new buffer could be allocated (with the HARP error set), in which case the variable is unchanged.
+ */
+static int gather_into_new_buffer(harp_variable *variable, int dim_index, long num_dim_elements,
+                                  const long *dim_element_ids, harp_spare_buffer *spare)
+{
+    int64_t element_size;
+    long num_allocated_elements;
+    long new_num_elements;
+    long num_groups;
+    long dimension_length;
+    long filter_block_size;
+    char *data;
+    long i;
+
+    num_groups = 1;
+    for (i = 0; i < dim_index; i++)
+    {
+        num_groups *= variable->dimension[i];
+    }
+    dimension_length = variable->dimension[dim_index];
+    element_size = harp_get_size_for_type(variable->data_type);
+    filter_block_size = (variable->num_elements / (num_groups * dimension_length)) * element_size;
+    new_num_elements = (variable->num_elements / dimension_length) * num_dim_elements;
+
+    if (allocate_new_buffer(variable, new_num_elements, spare, &data, &num_allocated_elements) != 0)
+    {
+        return 1;
+    }
+
+    gather_blocks(data, (const char *)variable->data.ptr, num_groups, dimension_length, num_dim_elements,
+                  dim_element_ids, filter_block_size);
+
+    release_data_buffer(variable, spare);
+    variable->data.ptr = data;
+    variable->num_elements = new_num_elements;
+    variable->num_allocated_elements = num_allocated_elements;
+    variable->dimension[dim_index] = num_dim_elements;
+
+    return 0;
+}
+
+/* Reorder the elements of a dimension of a variable according to a permutation (i.e. a list of ids in which each id
+ * of the dimension occurs exactly once).
+ * The data are gathered into a new buffer in a single sequential pass, which is faster than the in-place shuffle of
+ * harp_variable_rearrange_dimension(). The new buffer is taken from spare when possible (spare may be NULL) and the old
+ * buffer is handed back as spare. If the memory for the new buffer is not available, the in-place shuffle is used
+ * instead.
+ */
+int harp_variable_permute_dimension(harp_variable *variable, int dim_index, const long *permutation,
+                                    harp_spare_buffer *spare)
+{
+    int result;
+
+    assert(dim_index >= 0 && dim_index < variable->num_dimensions);
+
+    if (variable->num_elements == 0)
+    {
+        return 0;
+    }
+    if (variable->data_type == harp_type_string && (variable->borrowed_data || variable->shared_data != NULL))
+    {
+        /* the strings themselves should be owned by the variable */
+        if (harp_variable_make_data_owned(variable) != 0)
+        {
+            return -1;
+        }
+    }
+
+    result = gather_into_new_buffer(variable, dim_index, variable->dimension[dim_index], permutation, spare);
+    if (result == 1)
+    {
+        /* not enough memory for a second buffer (within the memory limit) */
+        return harp_variable_rearrange_dimension(variable, dim_index, variable->dimension[dim_index], permutation);
+    }
+
+    return result;
+}
+
+/* Move dimension dim_index of a variable to position new_dim_index (the dimensions in between shift by one position).
+ * If this does not change the memory layout of the data (i.e. if the moved dimension or all dimensions that it moves
+ * past have length 1) then only the dimension information is updated. Otherwise the data is transposed in a single
+ * pass into a new buffer (taken from spare when possible, spare may be NULL) and the old buffer is handed back as spare.
+ */
+int harp_variable_move_dimension(harp_variable *variable, int dim_index, int new_dim_index, harp_spare_buffer *spare)
+{
+    harp_dimension_type dimension_type;
+    long dimension_length;
+    long num_passed_elements = 1;
+    int step = (new_dim_index > dim_index ? 1 : -1);
+    int i;
+
+    assert(dim_index >= 0 && dim_index < variable->num_dimensions);
+    assert(new_dim_index >= 0 && new_dim_index < variable->num_dimensions);
+
+    if (dim_index == new_dim_index)
+    {
+        return 0;
+    }
+
+    dimension_type = variable->dimension_type[dim_index];
+    dimension_length = variable->dimension[dim_index];
+    for (i = dim_index + step; i != new_dim_index + step; i += step)
+    {
+        num_passed_elements *= variable->dimension[i];
+    }
+
+    if (dimension_length > 1 && num_passed_elements > 1 && variable->num_elements > 0)
+    {
+        int order[HARP_MAX_NUM_DIMS];
+        long num_allocated_elements;
+        harp_array data;
+        char *buffer;
+
+        /* order maps each destination dimension to its source dimension */
+        for (i = 0; i < variable->num_dimensions; i++)
+        {
+            order[i] = i;
+        }
+        for (i = dim_index; i != new_dim_index; i += step)
+        {
+            order[i] = i + step;
+        }
+        order[new_dim_index] = dim_index;
+
+        if (variable->data_type == harp_type_string && (variable->borrowed_data || variable->shared_data != NULL))
+        {
+            /* the strings themselves should be owned by the variable */
+            if (harp_variable_make_data_owned(variable) != 0)
+            {
+                return -1;
+            }
+        }
+        if (allocate_new_buffer(variable, variable->num_elements, spare, &buffer, &num_allocated_elements) != 0)
+        {
+            return -1;
+        }
+        data.ptr = buffer;
+        if (harp_array_transpose_to(variable->data_type, variable->num_dimensions, variable->dimension, order,
+                                    variable->data, data) != 0)
+        {
+            harp_free(data.ptr);
+            harp_memory_release((int64_t)num_allocated_elements * harp_get_size_for_type(variable->data_type));
+            return -1;
+        }
+        release_data_buffer(variable, spare);
+        variable->data = data;
+        variable->num_allocated_elements = num_allocated_elements;
+    }
+
+    for (i = dim_index; i != new_dim_index; i += step)
+    {
+        variable->dimension[i] = variable->dimension[i + step];
+        variable->dimension_type[i] = variable->dimension_type[i + step];
+    }
+    variable->dimension[new_dim_index] = dimension_length;
+    variable->dimension_type[new_dim_index] = dimension_type;
+
+    return 0;
+}
+
+/* Keep only the elements of a dimension with the given (strictly increasing) ids, compacting the data in place.
+ * The data of the variable should be owned by the variable.
+ */
+static int select_in_place(harp_variable *variable, int dim_index, long num_dim_elements, const long *dim_element_ids)
+{
+    long dimension_length = variable->dimension[dim_index];
+    long num_groups;
+    long num_block_elements;
+    long new_num_elements;
+    long i;
+
+    num_groups = 1;
+    for (i = 0; i < dim_index; i++)
+    {
+        num_groups *= variable->dimension[i];
+    }
+    num_block_elements = variable->num_elements / (num_groups * dimension_length);
+    new_num_elements = num_groups * num_dim_elements * num_block_elements;
+
+    if (variable->data_type == harp_type_string)
+    {
+        /* remove all strings for the blocks that get discarded */
+        for (i = 0; i < num_groups; i++)
+        {
+            long offset = i * dimension_length * num_block_elements;
+            long from_id = 0;
+            long j;
+
+            for (j = 0; j <= num_dim_elements; j++)
+            {
+                long to_id = j < num_dim_elements ? dim_element_ids[j] : dimension_length;
+
+                if (to_id > from_id)
+                {
+                    long k;
+
+                    for (k = from_id * num_block_elements; k < to_id * num_block_elements; k++)
+                    {
+                        if (variable->data.string_data[offset + k] != NULL)
+                        {
+                            free_string(variable, variable->data.string_data[offset + k]);
+                        }
+                    }
+                }
+                from_id = to_id + 1;
+            }
+        }
+    }
+
+    gather_blocks((char *)variable->data.ptr, (const char *)variable->data.ptr, num_groups, dimension_length,
+                  num_dim_elements, dim_element_ids, num_block_elements * harp_get_size_for_type(variable->data_type));
+
+    if (harp_variable_reallocate_data(variable, new_num_elements) != 0)
+    {
+        return -1;
+    }
+
+    variable->num_elements = new_num_elements;
+    variable->dimension[dim_index] = num_dim_elements;
+
+    return 0;
+}
+
+/** Rearrange the data of a variable in one dimension.
+ * This function allows data of a variable to be rearranged according to the order of the indices in dim_element_id.
+ * The number of indices (num_dim_elements) in dim_element_id does not have to correspond to the number of
+ * elements in the specified (dim_index) dimension. This means that the data block will grow/shrink when the amount of
+ * elements in dim_element_id is larger/smaller (note that the amount of elements can only become larger if elements
+ * are duplicated).
+ *
+ * \param variable Pointer to variable that should have its data rearranged.
+ * \param dim_index The id of the dimension in which the rearrangement should take place.
+ * \param num_dim_elements Number of elements in dim_element_id.
+ * \param dim_element_ids An array containing the ids in dimension dim_index in the new arrangement (ids may occur more
+ * than once and the number of ids may be smaller or larger than the length of dimension dim_index).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, long num_dim_elements,
+                                      const long *dim_element_ids)
+{
+    return harp_variable_rearrange_dimension_with_spare(variable, dim_index, num_dim_elements, dim_element_ids, NULL);
+}
+
+/* Same as harp_variable_rearrange_dimension(), but if the data is gathered into a new buffer then this buffer is taken
+ * from spare when possible, and the old buffer of the variable is handed back as spare (spare may be NULL). This
+ * allows a single buffer to be reused when rearranging all variables of a product.
+ * Strictly increasing ids (i.e. a selection of elements) are always handled in place.
+ */
+int harp_variable_rearrange_dimension_with_spare(harp_variable *variable, int dim_index, long num_dim_elements,
+                                                 const long *dim_element_ids, harp_spare_buffer *spare)
+{
+    char *buffer;
+    long *move_to_id;
+    int8_t *moved;
+    long new_num_elements;
+    long num_groups;
+    long num_block_elements;
+    long element_size;
+    long filter_block_size;
+    long i_increment;
+    long i;
+    int needs_shuffle;
+    int is_increasing = 1;
+
+    /* The multidimensional array is split in three parts:
+     *   num_elements = num_groups * dim[dim_index] * num_block_elements
+     *   new_num_elements = num_groups * num_dim_elements * num_block_elements */
+    if (variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (num_dim_elements <= 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_dim_elements argument <= 0 (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (dim_element_ids == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dim_element_ids argument is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (dim_index < 0 || dim_index >= variable->num_dimensions)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dim_index argument (%d) is not in the range [0,%d) (%s:%u)",
+                       dim_index, variable->num_dimensions, __FILE__, __LINE__);
+        return -1;
+    }
+    if (variable->num_elements == 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot reshape variable '%s' (variable has 0 elements) (%s:%u)",
+                       variable->name, __FILE__, __LINE__);
+        return -1;
+    }
+
+    needs_shuffle = num_dim_elements != variable->dimension[dim_index];
+    for (i = 0; i < num_dim_elements; i++)
+    {
+        if (dim_element_ids[i] < 0 || dim_element_ids[i] >= variable->dimension[dim_index])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT,
+                           "dim_element_ids[%d] argument (%d) is not in the range [0,%d) (%s:%u)",
+                           i, dim_element_ids[i], variable->dimension[dim_index], __FILE__, __LINE__);
+            return -1;
+        }
+        if (dim_element_ids[i] != i)
+        {
+            needs_shuffle = 1;
+        }
+        if (i > 0 && dim_element_ids[i] <= dim_element_ids[i - 1])
+        {
+            is_increasing = 0;
+        }
+    }
+    if (!needs_shuffle)
+    {
+        /* all ellements are already in the right location, don't do anything */
+        return 0;
+    }
+    if (variable->borrowed_data && variable->data_type != harp_type_string)
+    {
+        /* gather the selected elements directly into a buffer of our own instead of first copying all data */
+        return gather_into_new_buffer(variable, dim_index, num_dim_elements, dim_element_ids, spare) == 0 ? 0 : -1;
+    }
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
+    if (is_increasing)
+    {
+        return select_in_place(variable, dim_index, num_dim_elements, dim_element_ids);
+    }
+    if (variable->data_type != harp_type_string &&
+        gather_into_new_buffer(variable, dim_index, num_dim_elements, dim_element_ids, spare) == 0)
+    {
+        return 0;
+    }
+    /* (if there is not enough memory for a second buffer the data is shuffled in place) */
+
+    /* Calculate the number of times we have to reshuffle the indices (i.e. the product of the higher dimensions). */
+    num_groups = 1;
+    for (i = 0; i < (long)dim_index; i++)
+    {
+        num_groups *= variable->dimension[i];
+    }
+
+    /* Calculate the number of elements per block - a block can be moved with one memcpy(). */
+    num_block_elements = variable->num_elements / (num_groups * variable->dimension[dim_index]);
+
+    /* Calculate the new total number of elements. */
+    new_num_elements = num_groups * num_dim_elements * num_block_elements;
+
+    /* Calculate the element size and block size */
+    element_size = harp_get_size_for_type(variable->data_type);
+    filter_block_size = num_block_elements * element_size;
+
+    /* If num_dim_elements > dimension[dim_index] then increase the memory for variable->data. */
+    if (num_dim_elements > variable->dimension[dim_index])
+    {
+        if (harp_variable_reallocate_data(variable, new_num_elements) != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* Determine the positions where the old elements should end up.
+     * In case an element will end up in more than one position we determine the first. */
+    move_to_id = (long *)malloc((size_t)variable->dimension[dim_index] * sizeof(long));
+    if (move_to_id == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       variable->dimension[dim_index] * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < variable->dimension[dim_index]; i++)
+    {
+        move_to_id[i] = -1;     /* by default an element will be removed */
+    }
+    for (i = 0; i < num_dim_elements; i++)
+    {
+        if (move_to_id[dim_element_ids[i]] == -1)
+        {
+            move_to_id[dim_element_ids[i]] = i;
+        }
+    }
+
+    /* Temporary storage room for a block */
+    buffer = (char *)malloc((size_t)filter_block_size);
+    if (buffer == NULL)
+    {
+        free(move_to_id);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %u bytes) (%s:%u)",
+                       filter_block_size, __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* Create temporary array that indicates whether a block has already been moved to its 'move_to_id' position */
+    moved = (int8_t *)malloc((size_t)variable->dimension[dim_index] * sizeof(int8_t));
+    if (moved == NULL)
     {
         free(move_to_id);
         free(buffer);
@@ -521,7 +1263,7 @@ int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, lo
                     {
                         if (string_data[k] != NULL)
                         {
-                            free(string_data[k]);
+                            free_string(variable, string_data[k]);
                         }
                     }
                 }
@@ -642,16 +1384,10 @@ int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, lo
     /* if num_dim_elements < dimension[dim_index] then make data block smaller */
     if (num_dim_elements < variable->dimension[dim_index])
     {
-        void *variable_data;
-
-        variable_data = realloc(variable->data.ptr, (size_t)new_num_elements * element_size);
-        if (variable_data == NULL)
+        if (harp_variable_reallocate_data(variable, new_num_elements) != 0)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %u bytes) (%s:%u)",
-                           new_num_elements * element_size, __FILE__, __LINE__);
             return -1;
         }
-        variable->data.ptr = variable_data;
     }
 
     /* update variable properties */
@@ -677,7 +1413,6 @@ int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, lo
  */
 int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const uint8_t *mask)
 {
-    void *variable_data;
     long num_dim_elements;
     long new_num_elements;
     long num_groups;
@@ -694,6 +1429,10 @@ int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable argument is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
     if (mask == NULL)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "mask argument is NULL (%s:%u)", __FILE__, __LINE__);
@@ -753,18 +1492,27 @@ int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const
         long from_id;
         long to_id = 0;
 
-        for (from_id = 0; from_id < variable->dimension[dim_index]; from_id++)
+        from_id = 0;
+        while (from_id < variable->dimension[dim_index])
         {
             char *from_ptr = &from_block_ptr[from_id * filter_block_size];
             char *to_ptr = &to_block_ptr[to_id * filter_block_size];
 
             if (mask[from_id])
             {
+                long run_length = 1;
+
+                /* move a run of consecutive included elements at once */
+                while (from_id + run_length < variable->dimension[dim_index] && mask[from_id + run_length])
+                {
+                    run_length++;
+                }
                 if (to_ptr != from_ptr)
                 {
-                    memmove(to_ptr, from_ptr, (size_t)(filter_block_size));
+                    memmove(to_ptr, from_ptr, (size_t)(run_length * filter_block_size));
                 }
-                to_id++;
+                to_id += run_length;
+                from_id += run_length;
             }
             else
             {
@@ -778,22 +1526,19 @@ int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const
                     {
                         if (string_data[k] != NULL)
                         {
-                            free(string_data[k]);
+                            free_string(variable, string_data[k]);
                         }
                     }
                 }
+                from_id++;
             }
         }
     }
 
-    variable_data = realloc(variable->data.ptr, (size_t)new_num_elements * element_size);
-    if (variable_data == NULL)
+    if (harp_variable_reallocate_data(variable, new_num_elements) != 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %u bytes) (%s:%u)",
-                       new_num_elements * element_size, __FILE__, __LINE__);
         return -1;
     }
-    variable->data.ptr = variable_data;
 
     /* update variable properties */
     variable->num_elements = new_num_elements;
@@ -814,7 +1559,6 @@ int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const
  */
 int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long length)
 {
-    void *data;
     long element_size;
     long new_num_elements;
     long num_block_elements;
@@ -826,6 +1570,10 @@ int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable argument is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
     if (dim_index < 0 || dim_index >= variable->num_dimensions)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dim_index argument (%d) is not in the range [0:%d) (%s:%u)",
@@ -872,7 +1620,7 @@ int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long
                 {
                     if (variable->data.string_data[from_offset + j] != NULL)
                     {
-                        free(variable->data.string_data[from_offset + j]);
+                        free_string(variable, variable->data.string_data[from_offset + j]);
                     }
                 }
             }
@@ -886,15 +1634,10 @@ int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long
         }
     }
 
-    data = realloc(variable->data.ptr, (size_t)new_num_elements * element_size);
-    if (data == NULL)
+    if (harp_variable_reallocate_data(variable, new_num_elements) != 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY,
-                       "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (size_t)new_num_elements * element_size, __FILE__, __LINE__);
         return -1;
     }
-    variable->data.ptr = data;
 
     if (length > variable->dimension[dim_index])
     {
@@ -957,7 +1700,6 @@ int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long
  */
 int harp_variable_add_dimension(harp_variable *variable, int dim_index, harp_dimension_type dimension_type, long length)
 {
-    void *data;
     long element_size;
     long new_num_elements;
     long num_block_elements;
@@ -969,6 +1711,10 @@ int harp_variable_add_dimension(harp_variable *variable, int dim_index, harp_dim
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
     if (dim_index < 0 || dim_index > variable->num_dimensions)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dim_index argument (%d) is not in the range [0:%d] (%s:%u)",
@@ -1035,14 +1781,10 @@ int harp_variable_add_dimension(harp_variable *variable, int dim_index, harp_dim
 
     new_num_elements = num_blocks * length * num_block_elements;
 
-    data = realloc(variable->data.ptr, (size_t)new_num_elements * element_size);
-    if (data == NULL)
+    if (harp_variable_reallocate_data(variable, new_num_elements) != 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (size_t)new_num_elements * element_size, __FILE__, __LINE__);
         return -1;
     }
-    variable->data.ptr = data;
 
     for (i = num_blocks - 1; i >= 0; i--)
     {
@@ -1122,24 +1864,75 @@ int harp_variable_remove_dimension(harp_variable *variable, int dim_index, long
     return 0;
 }
 
-/** \addtogroup harp_variable
- * @{
- */
-
-/** Create new variable.
- * \param name Name of the variable.
- * \param data_type Storage type of the variable data.
- * \param num_dimensions Number of array dimensions (use '0' for scalar data).
- * \param dimension_type Array with the dimension type for each of the dimensions.
- * \param dimension Array with length for each of the dimensions.
- * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
+/** Make sure that the data of a variable is owned by the variable.
+ * If the variable refers to borrowed data (see harp_variable_new_with_borrowed_data()) or to data that is shared with
+ * other variables (see harp_variable_copy_shared()) then the data is replaced by a copy that is owned by the variable
+ * (if the variable is the last one referring to shared data, it takes over the data without making a copy).
+ * This function should be called before modifying the data of a variable directly (i.e. via \a variable->data).
+ * The HARP functions that modify variable data already do this themselves.
+ * \param variable Variable whose data should be owned.
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, int num_dimensions,
-                                  const harp_dimension_type *dimension_type, const long *dimension,
-                                  harp_variable **new_variable)
+LIBHARP_API int harp_variable_make_data_owned(harp_variable *variable)
+{
+    size_t size;
+    void *data;
+
+    if (!variable->borrowed_data)
+    {
+        return 0;
+    }
+
+    if (variable->shared_data != NULL)
+    {
+        shared_data *block = (shared_data *)variable->shared_data;
+        long ref_count;
+
+        harp_mutex_lock(&shared_data_mutex);
+        ref_count = block->ref_count;
+        harp_mutex_unlock(&shared_data_mutex);
+        if (ref_count == 1 && block->release == NULL)
+        {
+            /* no other variable refers to the data anymore, so we can just take it over */
+            variable->num_allocated_elements = (long)(block->size / harp_get_size_for_type(variable->data_type));
+            variable->shared_data = NULL;
+            variable->borrowed_data = 0;
+            free(block);
+            return 0;
+        }
+    }
+
+    size = (size_t)variable->num_elements * harp_get_size_for_type(variable->data_type);
+    if (harp_memory_reserve((int64_t)size) != 0)
+    {
+        return -1;
+    }
+    data = harp_malloc(size > 0 ? size : 1);
+    if (data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", size,
+                       __FILE__, __LINE__);
+        harp_memory_release((int64_t)size);
+        return -1;
+    }
+    memcpy(data, variable->data.ptr, size);
+    if (variable->shared_data != NULL)
+    {
+        shared_data_release((shared_data *)variable->shared_data);
+        variable->shared_data = NULL;
+    }
+    variable->data.ptr = data;
+    variable->num_allocated_elements = variable->num_elements;
+    variable->borrowed_data = 0;
+
+    return 0;
+}
+
+static int variable_new(const char *name, harp_data_type data_type, int num_dimensions,
+                        const harp_dimension_type *dimension_type, const long *dimension, int borrow_data,
+                        void *data, harp_variable **new_variable)
 {
     harp_variable *variable;
     int i;
@@ -1200,43 +1993,145 @@ LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, in
     variable->data_type = data_type;
     variable->num_dimensions = num_dimensions;
     variable->data.ptr = NULL;
+    variable->num_allocated_elements = 0;
+    variable->borrowed_data = 0;
+    variable->shared_data = NULL;
+    variable->string_arena = NULL;
     variable->description = NULL;
     variable->unit = NULL;
     variable->num_enum_values = 0;
     variable->enum_name = NULL;
 
-    variable->num_elements = 1;
-    for (i = 0; i < num_dimensions; i++)
+    variable->num_elements = 1;
+    for (i = 0; i < num_dimensions; i++)
+    {
+        variable->dimension_type[i] = (dimension_type == NULL ? harp_dimension_independent : dimension_type[i]);
+        variable->dimension[i] = dimension[i];
+        variable->num_elements *= dimension[i];
+    }
+
+    variable->name = strdup(name);
+    if (variable->name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_variable_delete(variable);
+        return -1;
+    }
+
+    if (borrow_data)
+    {
+        variable->data.ptr = data;
+        variable->borrowed_data = 1;
+    }
+    else
+    {
+        if (harp_memory_reserve((int64_t)variable->num_elements * harp_get_size_for_type(data_type)) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+        variable->data.ptr = harp_calloc((size_t)variable->num_elements, harp_get_size_for_type(data_type));
+        if (variable->data.ptr == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           variable->num_elements * harp_get_size_for_type(data_type), __FILE__, __LINE__);
+            harp_memory_release((int64_t)variable->num_elements * harp_get_size_for_type(data_type));
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+    variable->num_allocated_elements = variable->num_elements;
+
+    if (data_type != harp_type_string)
     {
-        variable->dimension_type[i] = (dimension_type == NULL ? harp_dimension_independent : dimension_type[i]);
-        variable->dimension[i] = dimension[i];
-        variable->num_elements *= dimension[i];
+        variable->valid_min = harp_get_valid_min_for_type(data_type);
+        variable->valid_max = harp_get_valid_max_for_type(data_type);
     }
 
-    variable->name = strdup(name);
-    if (variable->name == NULL)
+    *new_variable = variable;
+    return 0;
+}
+
+/** \addtogroup harp_variable
+ * @{
+ */
+
+/** Create new variable.
+ * \param name Name of the variable.
+ * \param data_type Storage type of the variable data.
+ * \param num_dimensions Number of array dimensions (use '0' for scalar data).
+ * \param dimension_type Array with the dimension type for each of the dimensions.
+ * \param dimension Array with length for each of the dimensions.
+ * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, int num_dimensions,
+                                  const harp_dimension_type *dimension_type, const long *dimension,
+                                  harp_variable **new_variable)
+{
+    return variable_new(name, data_type, num_dimensions, dimension_type, dimension, 0, NULL, new_variable);
+}
+
+/** Create new variable that uses existing memory for its data.
+ * The variable will refer to \a data directly (no copy is made) and HARP will never free or reallocate this memory.
+ * The caller remains the owner of the memory and should keep it available (and unmodified) until the variable is
+ * deleted. \a data should contain the elements of the array in row-major order.
+ * Variables with borrowed data are meant for read-only use (e.g. harp_export() of a product). When operations are
+ * executed on a product (see harp_product_execute_operations()) any borrowed data of its variables is first copied
+ * into memory that is owned by HARP.
+ * Borrowing data is not supported for variables of type string.
+ * \param name Name of the variable.
+ * \param data_type Storage type of the variable data.
+ * \param num_dimensions Number of array dimensions (use '0' for scalar data).
+ * \param dimension_type Array with the dimension type for each of the dimensions.
+ * \param dimension Array with length for each of the dimensions.
+ * \param data Memory containing the data of the variable.
+ * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_new_with_borrowed_data(const char *name, harp_data_type data_type, int num_dimensions,
+                                                     const harp_dimension_type *dimension_type, const long *dimension,
+                                                     void *data, harp_variable **new_variable)
+{
+    if (data_type == harp_type_string)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                       __LINE__);
-        harp_variable_delete(variable);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "borrowing data is not supported for string variables (%s:%u)",
+                       __FILE__, __LINE__);
         return -1;
     }
-
-    variable->data.ptr = malloc((size_t)variable->num_elements * harp_get_size_for_type(data_type));
-    if (variable->data.ptr == NULL)
+    if (data == NULL)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       variable->num_elements * harp_get_size_for_type(data_type), __FILE__, __LINE__);
-        harp_variable_delete(variable);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "data is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
-    memset(variable->data.ptr, 0, (size_t)variable->num_elements * harp_get_size_for_type(data_type));
 
-    if (data_type != harp_type_string)
+    return variable_new(name, data_type, num_dimensions, dimension_type, dimension, 1, data, new_variable);
+}
+
+/* Create new variable whose data lies within a block of external memory (see harp_shared_block_new()).
+ * The variable holds a reference to the block for as long as it refers to the data. As for borrowed data, the data is
+ * first copied into memory that is owned by HARP before the variable gets modified.
+ */
+int harp_variable_new_with_shared_block(const char *name, harp_data_type data_type, int num_dimensions,
+                                        const harp_dimension_type *dimension_type, const long *dimension, void *data,
+                                        void *block, harp_variable **new_variable)
+{
+    harp_variable *variable;
+
+    if (harp_variable_new_with_borrowed_data(name, data_type, num_dimensions, dimension_type, dimension, data,
+                                             &variable) != 0)
     {
-        variable->valid_min = harp_get_valid_min_for_type(data_type);
-        variable->valid_max = harp_get_valid_max_for_type(data_type);
+        return -1;
     }
+    harp_mutex_lock(&shared_data_mutex);
+    ((shared_data *)block)->ref_count++;
+    harp_mutex_unlock(&shared_data_mutex);
+    variable->shared_data = block;
 
     *new_variable = variable;
     return 0;
@@ -1256,7 +2151,7 @@ LIBHARP_API void harp_variable_delete(harp_variable *variable)
     {
         free(variable->name);
     }
-    if (variable->data.ptr != NULL)
+    if (variable->data.ptr != NULL && !variable->borrowed_data)
     {
         if (variable->data_type == harp_type_string)
         {
@@ -1266,11 +2161,20 @@ LIBHARP_API void harp_variable_delete(harp_variable *variable)
             {
                 if (variable->data.string_data[i] != NULL)
                 {
-                    free(variable->data.string_data[i]);
+                    free_string(variable, variable->data.string_data[i]);
                 }
             }
         }
-        free(variable->data.ptr);
+        harp_free(variable->data.ptr);
+        harp_memory_release((int64_t)variable->num_allocated_elements * harp_get_size_for_type(variable->data_type));
+    }
+    if (variable->shared_data != NULL)
+    {
+        shared_data_release((shared_data *)variable->shared_data);
+    }
+    if (variable->string_arena != NULL)
+    {
+        string_arena_delete((string_arena *)variable->string_arena);
     }
     if (variable->description != NULL)
     {
@@ -1297,15 +2201,45 @@ LIBHARP_API void harp_variable_delete(harp_variable *variable)
     free(variable);
 }
 
-/** Create a copy of a variable.
- * The function will create a deep-copy of the given HARP variable, also creating copyies of all attributes.
- * \param other_variable Variable that should be copied.
- * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
+/* Let a variable refer to the data of another variable, turning that data into a shared data block if needed.
+ * The data of other_variable should be owned by HARP (i.e. not borrowed from the caller).
  */
-LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_variable **new_variable)
+static int variable_share_data(harp_variable *variable, harp_variable *other_variable)
+{
+    shared_data *block;
+
+    harp_mutex_lock(&shared_data_mutex);
+    block = (shared_data *)other_variable->shared_data;
+    if (block == NULL)
+    {
+        block = (shared_data *)malloc(sizeof(shared_data));
+        if (block == NULL)
+        {
+            harp_mutex_unlock(&shared_data_mutex);
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(shared_data), __FILE__, __LINE__);
+            return -1;
+        }
+        block->ref_count = 1;
+        block->ptr = other_variable->data.ptr;
+        block->size = (int64_t)other_variable->num_allocated_elements *
+            harp_get_size_for_type(other_variable->data_type);
+        block->release = NULL;
+        other_variable->shared_data = block;
+        other_variable->borrowed_data = 1;
+    }
+    block->ref_count++;
+    harp_mutex_unlock(&shared_data_mutex);
+
+    variable->data = other_variable->data;
+    variable->num_allocated_elements = other_variable->num_allocated_elements;
+    variable->borrowed_data = 1;
+    variable->shared_data = block;
+
+    return 0;
+}
+
+static int variable_copy(const harp_variable *other_variable, int share_data, harp_variable **new_variable)
 {
     harp_variable *variable;
     long i;
@@ -1327,6 +2261,10 @@ LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_var
     }
     variable->num_elements = other_variable->num_elements;
     variable->data.ptr = NULL;
+    variable->num_allocated_elements = 0;
+    variable->borrowed_data = 0;
+    variable->shared_data = NULL;
+    variable->string_arena = NULL;
     variable->description = NULL;
     variable->unit = NULL;
     variable->valid_min = other_variable->valid_min;
@@ -1391,27 +2329,42 @@ LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_var
         }
     }
 
-    variable->data.ptr = malloc((size_t)variable->num_elements * harp_get_size_for_type(variable->data_type));
+    if (share_data && variable->data_type != harp_type_string && variable->num_elements > 0 &&
+        (!other_variable->borrowed_data || other_variable->shared_data != NULL))
+    {
+        /* the const is cast away since the data of the original variable also becomes shared */
+        if (variable_share_data(variable, (harp_variable *)other_variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+
+        *new_variable = variable;
+        return 0;
+    }
+
+    if (harp_memory_reserve((int64_t)variable->num_elements * harp_get_size_for_type(variable->data_type)) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+    variable->data.ptr = harp_malloc((size_t)variable->num_elements * harp_get_size_for_type(variable->data_type));
     if (variable->data.ptr == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        variable->num_elements * harp_get_size_for_type(variable->data_type), __FILE__, __LINE__);
+        harp_memory_release((int64_t)variable->num_elements * harp_get_size_for_type(variable->data_type));
         harp_variable_delete(variable);
         return -1;
     }
+    variable->num_allocated_elements = variable->num_elements;
     if (variable->data_type == harp_type_string)
     {
         memset(variable->data.ptr, 0, (size_t)variable->num_elements * harp_get_size_for_type(harp_type_string));
-        for (i = 0; i < variable->num_elements; i++)
+        if (set_string_data_from_strings(variable, 0, variable->num_elements, other_variable->data.string_data) != 0)
         {
-            variable->data.string_data[i] = strdup(other_variable->data.string_data[i]);
-            if (variable->data.string_data[i] == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                               __LINE__);
-                harp_variable_delete(variable);
-                return -1;
-            }
+            harp_variable_delete(variable);
+            return -1;
         }
     }
     else
@@ -1424,6 +2377,40 @@ LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_var
     return 0;
 }
 
+/** Create a copy of a variable.
+ * The function will create a deep-copy of the given HARP variable, also creating copyies of all attributes.
+ * \param other_variable Variable that should be copied.
+ * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_variable **new_variable)
+{
+    return variable_copy(other_variable, 0, new_variable);
+}
+
+/** Create a copy of a variable that shares its data with the original variable (copy-on-write).
+ * This is the same as harp_variable_copy(), except that the data of a (non-string) variable is not copied. Instead,
+ * both variables refer to the same reference counted block of memory and each variable makes its own copy of the data
+ * only when the data gets modified (the last remaining variable takes over the memory without a copy). This makes
+ * the copy cheap when e.g. several different operations need to be tried on the same data.
+ *
+ * The HARP functions that modify variable data take care of this automatically. Code that modifies the data of a
+ * variable (of either the copy or, since its data now also becomes shared, the original) directly via
+ * \a variable->data should call harp_variable_make_data_owned() first.
+ * Variables with borrowed data (see harp_variable_new_with_borrowed_data()) and string variables are deep-copied.
+ * \param other_variable Variable that should be copied.
+ * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_copy_shared(const harp_variable *other_variable, harp_variable **new_variable)
+{
+    return variable_copy(other_variable, 1, new_variable);
+}
+
 /** Copy all attributes of a variable to a target variable.
  * This will copy all attribute information of a variable that is not available as a parameter of \a harp_variable_new.
  * \param variable Variable from which the attributes should be copied.
@@ -1453,6 +2440,45 @@ LIBHARP_API int harp_variable_copy_attributes(const harp_variable *variable, har
     return 0;
 }
 
+/* make sure that memory is allocated for (at least) num_elements elements; num_elements itself is not changed */
+static int variable_reserve(harp_variable *variable, long num_elements)
+{
+    if (num_elements <= variable->num_allocated_elements)
+    {
+        return 0;
+    }
+
+    return harp_variable_reallocate_data(variable, num_elements);
+}
+
+/** Allocate memory such that the time dimension of a variable can grow up to the given length.
+ * This only reserves memory; the dimensions of the variable are not changed. Appending data (using
+ * harp_variable_append()) will not need to reallocate memory as long as the time dimension stays within \a length.
+ * The variable needs to have the 'time' dimension as first dimension.
+ * \param variable Variable for which memory should be reserved.
+ * \param length Length of the time dimension for which memory should be available.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_variable_reserve_time_dimension(harp_variable *variable, long length)
+{
+    long num_sub_elements;
+
+    if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable needs to be time dependent (%s)", variable->name);
+        return -1;
+    }
+    if (variable->dimension[0] == 0 || length <= variable->dimension[0])
+    {
+        return 0;
+    }
+    num_sub_elements = variable->num_elements / variable->dimension[0];
+
+    return variable_reserve(variable, length * num_sub_elements);
+}
+
 /** Append one variable to another.
  * Both variables need to have the 'time' dimension as first dimension.
  * And all non-time dimensions need to be the same for both variables.
@@ -1464,7 +2490,6 @@ LIBHARP_API int harp_variable_copy_attributes(const harp_variable *variable, har
  */
 LIBHARP_API int harp_variable_append(harp_variable *variable, const harp_variable *other_variable)
 {
-    void *data;
     long element_size;
     long new_num_elements;
     long i;
@@ -1514,30 +2539,36 @@ LIBHARP_API int harp_variable_append(harp_variable *variable, const harp_variabl
         }
     }
 
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
+
     element_size = harp_get_size_for_type(variable->data_type);
     new_num_elements = variable->num_elements + other_variable->num_elements;
-    data = realloc(variable->data.ptr, (size_t)new_num_elements * element_size);
-    if (data == NULL)
+    if (new_num_elements > variable->num_allocated_elements)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (size_t)new_num_elements * element_size, __FILE__, __LINE__);
-        return -1;
+        /* grow the allocated memory geometrically such that repeated appends take amortized linear time */
+        long num_allocated_elements = variable->num_allocated_elements + variable->num_allocated_elements / 2;
+
+        if (num_allocated_elements < new_num_elements)
+        {
+            num_allocated_elements = new_num_elements;
+        }
+        if (variable_reserve(variable, num_allocated_elements) != 0)
+        {
+            return -1;
+        }
     }
-    variable->data.ptr = data;
 
     if (variable->data_type == harp_type_string)
     {
         memset(&variable->data.string_data[variable->num_elements], 0,
                (size_t)other_variable->num_elements * element_size);
-        for (i = 0; i < other_variable->num_elements; i++)
+        if (set_string_data_from_strings(variable, variable->num_elements, other_variable->num_elements,
+                                         other_variable->data.string_data) != 0)
         {
-            variable->data.string_data[variable->num_elements + i] = strdup(other_variable->data.string_data[i]);
-            if (variable->data.string_data[variable->num_elements + i] == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                               __LINE__);
-                return -1;
-            }
+            return -1;
         }
     }
     else
@@ -1812,19 +2843,193 @@ LIBHARP_API int harp_variable_set_string_data_element(harp_variable *variable, l
 
     if (variable->data.string_data[index] != NULL)
     {
-        free(variable->data.string_data[index]);
+        free_string(variable, variable->data.string_data[index]);
+    }
+
+    variable->data.string_data[index] = strdup(str);
+
+    if (variable->data.string_data[index] == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    return 0;
+}
+
+#define CONVERT_BLOCK_SIZE 256
+
+/* Convert num_elements numeric values of type source_type at source to values of type target_type at target.
+ * Source and target may refer to the same memory (for an in-place conversion). The values are converted one block at a
+ * time via an intermediate buffer, going forward if the target type is not larger than the source type and backward
+ * otherwise, such that no value gets overwritten before it has been read.
+ */
+static void convert_elements(harp_data_type source_type, const void *source, harp_data_type target_type, void *target,
+                             long num_elements)
+{
+    union
+    {
+        int8_t int8_data[CONVERT_BLOCK_SIZE];
+        int16_t int16_data[CONVERT_BLOCK_SIZE];
+        int32_t int32_data[CONVERT_BLOCK_SIZE];
+        float float_data[CONVERT_BLOCK_SIZE];
+        double double_data[CONVERT_BLOCK_SIZE];
+    } buffer;
+    long source_size = harp_get_size_for_type(source_type);
+    long target_size = harp_get_size_for_type(target_type);
+    long num_blocks = (num_elements + CONVERT_BLOCK_SIZE - 1) / CONVERT_BLOCK_SIZE;
+    long block;
+
+    for (block = 0; block < num_blocks; block++)
+    {
+        long offset = (target_size > source_size ? num_blocks - 1 - block : block) * CONVERT_BLOCK_SIZE;
+        long length = num_elements - offset < CONVERT_BLOCK_SIZE ? num_elements - offset : CONVERT_BLOCK_SIZE;
+        long i;
+
+#define CONVERT_BLOCK(stype, ttype, member) \
+        for (i = 0; i < length; i++) \
+        { \
+            buffer.member[i] = (ttype)((const stype *)source)[offset + i]; \
+        }
+
+#define CONVERT_FROM(stype) \
+        switch (target_type) \
+        { \
+            case harp_type_int8: \
+                CONVERT_BLOCK(stype, int8_t, int8_data); \
+                break; \
+            case harp_type_int16: \
+                CONVERT_BLOCK(stype, int16_t, int16_data); \
+                break; \
+            case harp_type_int32: \
+                CONVERT_BLOCK(stype, int32_t, int32_data); \
+                break; \
+            case harp_type_float: \
+                CONVERT_BLOCK(stype, float, float_data); \
+                break; \
+            case harp_type_double: \
+                CONVERT_BLOCK(stype, double, double_data); \
+                break; \
+            default: \
+                assert(0); \
+                exit(1); \
+        }
+
+        switch (source_type)
+        {
+            case harp_type_int8:
+                CONVERT_FROM(int8_t);
+                break;
+            case harp_type_int16:
+                CONVERT_FROM(int16_t);
+                break;
+            case harp_type_int32:
+                CONVERT_FROM(int32_t);
+                break;
+            case harp_type_float:
+                CONVERT_FROM(float);
+                break;
+            case harp_type_double:
+                CONVERT_FROM(double);
+                break;
+            default:
+                assert(0);
+                exit(1);
+        }
+
+#undef CONVERT_FROM
+#undef CONVERT_BLOCK
+
+        memcpy((char *)target + offset * target_size, &buffer, (size_t)(length * target_size));
+    }
+}
+
+static double scalar_as_double(harp_data_type data_type, harp_scalar value)
+{
+    switch (data_type)
+    {
+        case harp_type_int8:
+            return (double)value.int8_data;
+        case harp_type_int16:
+            return (double)value.int16_data;
+        case harp_type_int32:
+            return (double)value.int32_data;
+        case harp_type_float:
+            return (double)value.float_data;
+        case harp_type_double:
+            return value.double_data;
+        default:
+            assert(0);
+            exit(1);
+    }
+}
+
+static harp_scalar scalar_from_double(harp_data_type data_type, double value)
+{
+    harp_scalar result;
+
+    switch (data_type)
+    {
+        case harp_type_int8:
+            result.int8_data = (int8_t)value;
+            break;
+        case harp_type_int16:
+            result.int16_data = (int16_t)value;
+            break;
+        case harp_type_int32:
+            result.int32_data = (int32_t)value;
+            break;
+        case harp_type_float:
+            result.float_data = (float)value;
+            break;
+        case harp_type_double:
+            result.double_data = value;
+            break;
+        default:
+            assert(0);
+            exit(1);
+    }
+
+    return result;
+}
+
+/* Convert the valid range of a numeric variable to the target data type. When converting to a data type with a smaller
+ * range (i.e. one that comes earlier in the order int8, int16, int32, float, double), values outside the range of the
+ * target data type are replaced by the valid min/max of that type.
+ */
+static void convert_valid_range(harp_variable *variable, harp_data_type target_data_type)
+{
+    double valid_min = scalar_as_double(variable->data_type, variable->valid_min);
+    double valid_max = scalar_as_double(variable->data_type, variable->valid_max);
+
+    if (target_data_type < variable->data_type)
+    {
+        harp_scalar type_valid_min = harp_get_valid_min_for_type(target_data_type);
+        harp_scalar type_valid_max = harp_get_valid_max_for_type(target_data_type);
+
+        if (valid_min < scalar_as_double(target_data_type, type_valid_min))
+        {
+            variable->valid_min = type_valid_min;
+        }
+        else
+        {
+            variable->valid_min = scalar_from_double(target_data_type, valid_min);
+        }
+        if (valid_max > scalar_as_double(target_data_type, type_valid_max))
+        {
+            variable->valid_max = type_valid_max;
+        }
+        else
+        {
+            variable->valid_max = scalar_from_double(target_data_type, valid_max);
+        }
     }
-
-    variable->data.string_data[index] = strdup(str);
-
-    if (variable->data.string_data[index] == NULL)
+    else
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                       __LINE__);
-        return -1;
+        variable->valid_min = scalar_from_double(target_data_type, valid_min);
+        variable->valid_max = scalar_from_double(target_data_type, valid_max);
     }
-
-    return 0;
 }
 
 /** Convert the data for the variable such that it matches the given data type.
@@ -1839,10 +3044,8 @@ LIBHARP_API int harp_variable_set_string_data_element(harp_variable *variable, l
  */
 LIBHARP_API int harp_variable_convert_data_type(harp_variable *variable, harp_data_type target_data_type)
 {
-    harp_scalar valid_min;
-    harp_scalar valid_max;
-    harp_array data;
-    int i;
+    long source_size;
+    long target_size;
 
     if (variable == NULL)
     {
@@ -1869,398 +3072,106 @@ LIBHARP_API int harp_variable_convert_data_type(harp_variable *variable, harp_da
     }
     if (variable->num_elements == 0 || variable->data.ptr == NULL)
     {
-        /* nothing to convert */
+        /* nothing to convert; drop any remaining allocation since its size is specific to the old data type */
+        if (variable->data.ptr != NULL && !variable->borrowed_data)
+        {
+            harp_free(variable->data.ptr);
+            harp_memory_release((int64_t)variable->num_allocated_elements *
+                                harp_get_size_for_type(variable->data_type));
+            variable->data.ptr = NULL;
+            variable->num_allocated_elements = 0;
+        }
         variable->data_type = target_data_type;
         return 0;
     }
 
-    valid_min = harp_get_valid_min_for_type(target_data_type);
-    valid_max = harp_get_valid_max_for_type(target_data_type);
+    source_size = harp_get_size_for_type(variable->data_type);
+    target_size = harp_get_size_for_type(target_data_type);
 
-    switch (target_data_type)
+    if (variable->borrowed_data || variable->shared_data != NULL)
     {
-        case harp_type_int8:
-            data.ptr = malloc((size_t)variable->num_elements * sizeof(int8_t));
-            if (data.ptr == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               variable->num_elements * sizeof(int8_t), __FILE__, __LINE__);
-                return -1;
-            }
-            switch (variable->data_type)
-            {
-                case harp_type_int16:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int8_data[i] = (int8_t)variable->data.int16_data[i];
-                    }
-                    if (variable->valid_min.int16_data < valid_min.int8_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int8_data = (int8_t)variable->valid_min.int16_data;
-                    }
-                    if (variable->valid_max.int16_data > valid_max.int8_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int8_data = (int8_t)variable->valid_max.int16_data;
-                    }
-                    break;
-                case harp_type_int32:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int8_data[i] = (int8_t)variable->data.int32_data[i];
-                    }
-                    if (variable->valid_min.int32_data < valid_min.int8_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int8_data = (int8_t)variable->valid_min.int32_data;
-                    }
-                    if (variable->valid_max.int32_data > valid_max.int8_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int8_data = (int8_t)variable->valid_max.int32_data;
-                    }
-                    break;
-                case harp_type_float:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int8_data[i] = (int8_t)variable->data.float_data[i];
-                    }
-                    if (variable->valid_min.float_data < valid_min.int8_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int8_data = (int8_t)variable->valid_min.float_data;
-                    }
-                    if (variable->valid_max.float_data > valid_max.int8_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int8_data = (int8_t)variable->valid_max.float_data;
-                    }
-                    break;
-                case harp_type_double:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int8_data[i] = (int8_t)variable->data.double_data[i];
-                    }
-                    if (variable->valid_min.double_data < valid_min.int8_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int8_data = (int8_t)variable->valid_min.double_data;
-                    }
-                    if (variable->valid_max.double_data > valid_max.int8_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int8_data = (int8_t)variable->valid_max.double_data;
-                    }
-                    break;
-                default:
-                    assert(0);
-                    exit(1);
-            }
-            break;
-        case harp_type_int16:
-            data.ptr = malloc((size_t)variable->num_elements * sizeof(int16_t));
-            if (data.ptr == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               variable->num_elements * sizeof(int16_t), __FILE__, __LINE__);
-                return -1;
-            }
-            switch (variable->data_type)
-            {
-                case harp_type_int8:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int16_data[i] = (int16_t)variable->data.int8_data[i];
-                    }
-                    variable->valid_min.int16_data = (int16_t)variable->valid_min.int8_data;
-                    variable->valid_max.int16_data = (int16_t)variable->valid_max.int8_data;
-                    break;
-                case harp_type_int32:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int16_data[i] = (int16_t)variable->data.int32_data[i];
-                    }
-                    if (variable->valid_min.int32_data < valid_min.int16_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int16_data = (int16_t)variable->valid_min.int32_data;
-                    }
-                    if (variable->valid_max.int32_data > valid_max.int16_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int16_data = (int16_t)variable->valid_max.int32_data;
-                    }
-                    break;
-                case harp_type_float:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int16_data[i] = (int16_t)variable->data.float_data[i];
-                    }
-                    if (variable->valid_min.float_data < valid_min.int16_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int16_data = (int16_t)variable->valid_min.float_data;
-                    }
-                    if (variable->valid_max.float_data > valid_max.int16_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int16_data = (int16_t)variable->valid_max.float_data;
-                    }
-                    break;
-                case harp_type_double:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int16_data[i] = (int16_t)variable->data.double_data[i];
-                    }
-                    if (variable->valid_min.double_data < valid_min.int16_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int16_data = (int16_t)variable->valid_min.double_data;
-                    }
-                    if (variable->valid_max.double_data > valid_max.int16_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int16_data = (int16_t)variable->valid_max.double_data;
-                    }
-                    break;
-                default:
-                    assert(0);
-                    exit(1);
-            }
-            break;
-        case harp_type_int32:
-            data.ptr = malloc((size_t)variable->num_elements * sizeof(int32_t));
-            if (data.ptr == NULL)
+        void *data;
+
+        /* convert into a new buffer of our own */
+        if (harp_memory_reserve((int64_t)variable->num_elements * target_size) != 0)
+        {
+            return -1;
+        }
+        data = harp_malloc((size_t)(variable->num_elements * target_size));
+        if (data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (size_t)(variable->num_elements * target_size), __FILE__, __LINE__);
+            harp_memory_release((int64_t)variable->num_elements * target_size);
+            return -1;
+        }
+        convert_elements(variable->data_type, variable->data.ptr, target_data_type, data, variable->num_elements);
+        if (variable->shared_data != NULL)
+        {
+            shared_data_release((shared_data *)variable->shared_data);
+            variable->shared_data = NULL;
+        }
+        variable->data.ptr = data;
+        variable->num_allocated_elements = variable->num_elements;
+        variable->borrowed_data = 0;
+    }
+    else
+    {
+        void *data;
+
+        /* convert in place; the buffer is grown before a widening conversion and shrunk after a narrowing one */
+        if (target_size > source_size)
+        {
+            int64_t size_change = (int64_t)variable->num_elements * target_size -
+                (int64_t)variable->num_allocated_elements * source_size;
+
+            if (size_change > 0 && harp_memory_reserve(size_change) != 0)
             {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               variable->num_elements * sizeof(int32_t), __FILE__, __LINE__);
                 return -1;
             }
-            switch (variable->data_type)
-            {
-                case harp_type_int8:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int32_data[i] = (int32_t)variable->data.int8_data[i];
-                    }
-                    variable->valid_min.int32_data = (int32_t)variable->valid_min.int8_data;
-                    variable->valid_max.int32_data = (int32_t)variable->valid_max.int8_data;
-                    break;
-                case harp_type_int16:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int32_data[i] = (int32_t)variable->data.int16_data[i];
-                    }
-                    variable->valid_min.int32_data = (int32_t)variable->valid_min.int16_data;
-                    variable->valid_max.int32_data = (int32_t)variable->valid_max.int16_data;
-                    break;
-                case harp_type_float:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int32_data[i] = (int32_t)variable->data.float_data[i];
-                    }
-                    if (variable->valid_min.float_data < valid_min.int32_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int32_data = (int32_t)variable->valid_min.float_data;
-                    }
-                    if (variable->valid_max.float_data > valid_max.int32_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int32_data = (int32_t)variable->valid_max.float_data;
-                    }
-                    break;
-                case harp_type_double:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.int32_data[i] = (int32_t)variable->data.double_data[i];
-                    }
-                    if (variable->valid_min.double_data < valid_min.int32_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.int32_data = (int32_t)variable->valid_min.double_data;
-                    }
-                    if (variable->valid_max.double_data > valid_max.int32_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.int32_data = (int32_t)variable->valid_max.double_data;
-                    }
-                    break;
-                default:
-                    assert(0);
-                    exit(1);
-            }
-            break;
-        case harp_type_float:
-            data.ptr = malloc((size_t)variable->num_elements * sizeof(float));
-            if (data.ptr == NULL)
+            data = harp_realloc(variable->data.ptr, (size_t)(variable->num_elements * target_size));
+            if (data == NULL)
             {
                 harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               variable->num_elements * sizeof(float), __FILE__, __LINE__);
+                               (size_t)(variable->num_elements * target_size), __FILE__, __LINE__);
+                if (size_change > 0)
+                {
+                    harp_memory_release(size_change);
+                }
                 return -1;
             }
-            switch (variable->data_type)
-            {
-                case harp_type_int8:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.float_data[i] = (float)variable->data.int8_data[i];
-                    }
-                    variable->valid_min.float_data = (float)variable->valid_min.int8_data;
-                    variable->valid_max.float_data = (float)variable->valid_max.int8_data;
-                    break;
-                case harp_type_int16:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.float_data[i] = (float)variable->data.int16_data[i];
-                    }
-                    variable->valid_min.float_data = (float)variable->valid_min.int16_data;
-                    variable->valid_max.float_data = (float)variable->valid_max.int16_data;
-                    break;
-                case harp_type_int32:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.float_data[i] = (float)variable->data.int32_data[i];
-                    }
-                    variable->valid_min.float_data = (float)variable->valid_min.int32_data;
-                    variable->valid_max.float_data = (float)variable->valid_max.int32_data;
-                    break;
-                case harp_type_double:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.float_data[i] = (float)variable->data.double_data[i];
-                    }
-                    if (variable->valid_min.double_data < valid_min.float_data)
-                    {
-                        variable->valid_min = valid_min;
-                    }
-                    else
-                    {
-                        variable->valid_min.float_data = (float)variable->valid_min.double_data;
-                    }
-                    if (variable->valid_max.double_data > valid_max.float_data)
-                    {
-                        variable->valid_max = valid_max;
-                    }
-                    else
-                    {
-                        variable->valid_max.float_data = (float)variable->valid_max.double_data;
-                    }
-                    break;
-                default:
-                    assert(0);
-                    exit(1);
-            }
-            break;
-        case harp_type_double:
-            data.ptr = malloc((size_t)variable->num_elements * sizeof(double));
-            if (data.ptr == NULL)
+            if (size_change < 0)
             {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               variable->num_elements * sizeof(double), __FILE__, __LINE__);
-                return -1;
+                harp_memory_release(-size_change);
             }
-            switch (variable->data_type)
+            variable->data.ptr = data;
+            variable->num_allocated_elements = variable->num_elements;
+        }
+        else
+        {
+            /* the size of the allocation stays the same (target_size is a divisor of source_size) */
+            variable->num_allocated_elements = (long)(((int64_t)variable->num_allocated_elements * source_size) /
+                                                      target_size);
+        }
+
+        convert_elements(variable->data_type, variable->data.ptr, target_data_type, variable->data.ptr,
+                         variable->num_elements);
+
+        if (target_size < source_size && variable->num_allocated_elements > variable->num_elements)
+        {
+            /* release the memory that is no longer needed (the larger buffer is kept if this fails) */
+            data = harp_realloc(variable->data.ptr, (size_t)(variable->num_elements * target_size));
+            if (data != NULL)
             {
-                case harp_type_int8:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.double_data[i] = (double)variable->data.int8_data[i];
-                    }
-                    variable->valid_min.double_data = (double)variable->valid_min.int8_data;
-                    variable->valid_max.double_data = (double)variable->valid_max.int8_data;
-                    break;
-                case harp_type_int16:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.double_data[i] = (double)variable->data.int16_data[i];
-                    }
-                    variable->valid_min.double_data = (double)variable->valid_min.int16_data;
-                    variable->valid_max.double_data = (double)variable->valid_max.int16_data;
-                    break;
-                case harp_type_int32:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.double_data[i] = (double)variable->data.int32_data[i];
-                    }
-                    variable->valid_min.double_data = (double)variable->valid_min.int32_data;
-                    variable->valid_max.double_data = (double)variable->valid_max.int32_data;
-                    break;
-                case harp_type_float:
-                    for (i = 0; i < variable->num_elements; i++)
-                    {
-                        data.double_data[i] = (double)variable->data.float_data[i];
-                    }
-                    variable->valid_min.double_data = (double)variable->valid_min.float_data;
-                    variable->valid_max.double_data = (double)variable->valid_max.float_data;
-                    break;
-                default:
-                    assert(0);
-                    exit(1);
+                harp_memory_release((int64_t)(variable->num_allocated_elements - variable->num_elements) *
+                                    target_size);
+                variable->data.ptr = data;
+                variable->num_allocated_elements = variable->num_elements;
             }
-            break;
-        default:
-            assert(0);
-            exit(1);
+        }
     }
 
-    free(variable->data.ptr);
-    variable->data.ptr = data.ptr;
+    convert_valid_range(variable, target_data_type);
     variable->data_type = target_data_type;
 
     return 0;
@@ -2332,13 +3243,7 @@ LIBHARP_API int harp_variable_has_unit(const harp_variable *variable, const char
     return (harp_unit_compare(variable->unit, unit) == 0);
 }
 
-/** Verify that a variable is internally consistent and complies with conventions.
- * \param variable Variable to verify.
- * \return
- *   \arg \c 0, Variable verified successfully.
- *   \arg \c -1, Error occurred (check #harp_errno).
- */
-LIBHARP_API int harp_variable_verify(const harp_variable *variable)
+static int variable_verify(const harp_variable *variable, int check_conventions)
 {
     long dimension[HARP_MAX_NUM_DIMS] = { 0 };
     int dimension_index[HARP_MAX_NUM_DIMS] = { 0 };
@@ -2455,7 +3360,7 @@ LIBHARP_API int harp_variable_verify(const harp_variable *variable)
         return -1;
     }
 
-    if (variable->unit != NULL && !harp_unit_is_valid(variable->unit))
+    if (check_conventions && variable->unit != NULL && !harp_unit_is_valid(variable->unit))
     {
         harp_set_error(HARP_ERROR_INVALID_VARIABLE, "invalid unit '%s'", variable->unit);
         return -1;
@@ -2489,7 +3394,7 @@ LIBHARP_API int harp_variable_verify(const harp_variable *variable)
                 harp_set_error(HARP_ERROR_INVALID_VARIABLE, "empty enumeration value (%d)", i);
                 return -1;
             }
-            if (!harp_is_identifier(variable->enum_name[i]))
+            if (check_conventions && !harp_is_identifier(variable->enum_name[i]))
             {
                 harp_set_error(HARP_ERROR_INVALID_VARIABLE, "enumeration value '%s' is not a valid identifier",
                                variable->enum_name[i]);
@@ -2508,6 +3413,26 @@ LIBHARP_API int harp_variable_verify(const harp_variable *variable)
     return 0;
 }
 
+/** Verify that a variable is internally consistent and complies with conventions.
+ * \param variable Variable to verify.
+ * \return
+ *   \arg \c 0, Variable verified successfully.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_verify(const harp_variable *variable)
+{
+    return variable_verify(variable, 1);
+}
+
+/* Same as harp_variable_verify(), but only verifies the structure of the variable (name, data type, dimensions, number
+ * of elements, data and enumeration metadata). The (expensive) parsing of the unit and the identifier check of the
+ * enumeration names are skipped.
+ */
+int harp_variable_verify_structure(const harp_variable *variable)
+{
+    return variable_verify(variable, 0);
+}
+
 /** Print a harp_variable struct using the specified print function.
  * \param variable Variable to print.
  * \param show_attributes Whether or not to print the attributes.
@@ -41,6 +41,9 @@
 
 #define MAX_NAME_LENGTH 128
 
+/* number of profiles that are integrated together by the hydrostatic profile conversions */
+#define PROFILE_BLOCK_SIZE 16
+
 typedef enum profile_resample_type_enum
 {
     profile_resample_skip,
@@ -50,12 +53,7 @@ typedef enum profile_resample_type_enum
     profile_resample_interval
 } profile_resample_type;
 
-/** Convert geopotential height to geometric height (= altitude)
- * \param gph  Geopotential height [m]
- * \param latitude   Latitude [degree_north]
- * \return the altitude [m]
- */
-double harp_altitude_from_gph_and_latitude(double gph, double latitude)
+static double get_altitude_from_gph_and_latitude(double gph, double latitude)
 {
     double altitude;
     double g0 = (double)CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE;    /* gravitational accel. [m s-2] at latitude 45o32'33'' */
@@ -69,6 +67,65 @@ double harp_altitude_from_gph_and_latitude(double gph, double latitude)
     return altitude;
 }
 
+/** Convert geopotential height to geometric height (= altitude)
+ * \param gph  Geopotential height [m]
+ * \param latitude   Latitude [degree_north]
+ * \return the altitude [m]
+ */
+double harp_altitude_from_gph_and_latitude(double gph, double latitude)
+{
+    return get_altitude_from_gph_and_latitude(gph, latitude);
+}
+
+/** Array version of harp_altitude_from_gph_and_latitude().
+ * \param num_elements Number of elements of each array.
+ * \param gph Geopotential height [m] (array of \a num_elements values)
+ * \param latitude Latitude [degree_north] (array of \a num_elements values)
+ * \param result Array in which the altitude [m] values will be stored.
+ */
+void harp_altitude_from_gph_and_latitude_array(long num_elements, const double *gph, const double *latitude,
+                                               double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_altitude_from_gph_and_latitude(gph[i], latitude[i]);
+    }
+}
+
+/* Determine for each profile of a block of profiles the data index of the level at the surface and the step to the
+ * next level (the profiles are integrated starting from the surface). The axis of a profile is from TOA to surface if
+ * its values are increasing (invert_if_increasing == 1, e.g. pressure) or decreasing (invert_if_increasing == 0, e.g.
+ * altitude). Returns the number of profiles in the block that starts at first_profile.
+ */
+static long get_profile_block_levels(long num_profiles, long num_levels, const double *profile, long first_profile,
+                                     int invert_if_increasing, long *index, long *step)
+{
+    long num_block_profiles = num_profiles - first_profile;
+    long j;
+
+    if (num_block_profiles > PROFILE_BLOCK_SIZE)
+    {
+        num_block_profiles = PROFILE_BLOCK_SIZE;
+    }
+    for (j = 0; j < num_block_profiles; j++)
+    {
+        const double *column = &profile[(first_profile + j) * num_levels];
+
+        index[j] = (first_profile + j) * num_levels;
+        step[j] = 1;
+        if (invert_if_increasing ? column[0] < column[num_levels - 1] : column[0] > column[num_levels - 1])
+        {
+            /* vertical axis is from TOA to surface -> invert the loop index */
+            index[j] += num_levels - 1;
+            step[j] = -1;
+        }
+    }
+
+    return num_block_profiles;
+}
+
 /** Convert a pressure profile to an altitude profile
  * \param num_levels Length of vertical axis
  * \param pressure_profile Pressure vertical profile [Pa]
@@ -78,59 +135,128 @@ double harp_altitude_from_gph_and_latitude(double gph, double latitude)
  * \param surface_height Surface height [m]
  * \param latitude Latitude [degree_north]
  * \param altitude_profile variable in which the vertical profile will be stored [m]
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
  */
 void harp_profile_altitude_from_pressure(long num_levels, const double *pressure_profile,
                                          const double *temperature_profile, const double *molar_mass_air,
                                          double surface_pressure, double surface_height, double latitude,
                                          double *altitude_profile)
 {
-    double z, prev_z = 0, p, prev_p = 0, T, prev_T = 0, M, prev_M = 0, g;
-    long i;
+    harp_profile_altitude_from_pressure_array(1, num_levels, pressure_profile, temperature_profile, molar_mass_air,
+                                              &surface_pressure, &surface_height, &latitude, altitude_profile);
+}
 
-    for (i = 0; i < num_levels; i++)
+/** Array version of harp_profile_altitude_from_pressure().
+ * The profiles are integrated in blocks, level by level for all profiles of a block, such that the integrations of
+ * the different profiles are independent of each other in the inner loop. The latitude dependent gravity terms are
+ * calculated only once per profile.
+ * \param num_profiles Number of profiles
+ * \param num_levels Length of vertical axis
+ * \param pressure_profile Pressure vertical profiles [Pa] (\a num_profiles x \a num_levels values)
+ * \param temperature_profile Temperature vertical profiles [K] (\a num_profiles x \a num_levels values)
+ * \param molar_mass_air Molar mass of total air [g/mol] (\a num_profiles x \a num_levels values)
+ * \param surface_pressure Surface pressure [Pa] (\a num_profiles values)
+ * \param surface_height Surface height [m] (\a num_profiles values)
+ * \param latitude Latitude [degree_north] (\a num_profiles values)
+ * \param altitude_profile Array in which the vertical profiles will be stored [m]
+ */
+void harp_profile_altitude_from_pressure_array(long num_profiles, long num_levels, const double *pressure_profile,
+                                               const double *temperature_profile, const double *molar_mass_air,
+                                               const double *surface_pressure, const double *surface_height,
+                                               const double *latitude, double *altitude_profile)
+{
+    long index[PROFILE_BLOCK_SIZE];
+    long step[PROFILE_BLOCK_SIZE];
+    double surface_gravity[PROFILE_BLOCK_SIZE];
+    double height_factor[PROFILE_BLOCK_SIZE];
+    double prev_z[PROFILE_BLOCK_SIZE], prev_p[PROFILE_BLOCK_SIZE], prev_T[PROFILE_BLOCK_SIZE];
+    double prev_M[PROFILE_BLOCK_SIZE];
+    long first_profile;
+
+    if (num_levels <= 0)
     {
-        long k = i;
+        return;
+    }
 
-        if (pressure_profile[0] < pressure_profile[num_levels - 1])
-        {
-            /* vertical axis is from TOA to surface -> invert the loop index */
-            k = num_levels - 1 - i;
-        }
+    for (first_profile = 0; first_profile < num_profiles; first_profile += PROFILE_BLOCK_SIZE)
+    {
+        long num_block_profiles;
+        long i, j;
 
-        p = pressure_profile[k];
-        M = molar_mass_air[k];
-        T = temperature_profile[k];
+        num_block_profiles = get_profile_block_levels(num_profiles, num_levels, pressure_profile, first_profile, 1,
+                                                      index, step);
 
-        if (i == 0)
+        for (j = 0; j < num_block_profiles; j++)
         {
-            g = harp_gravity_at_surface_from_latitude(latitude);
-            z = surface_height + 1e3 * (T / M) * (CONST_MOLAR_GAS / g) * log(surface_pressure / p);
+            long k = index[j];
+            double p = pressure_profile[k];
+            double M = molar_mass_air[k];
+            double T = temperature_profile[k];
+            double g;
+
+            harp_gravity_terms_from_latitude(latitude[first_profile + j], &surface_gravity[j], &height_factor[j]);
+            g = surface_gravity[j];
+            prev_z[j] = surface_height[first_profile + j] + 1e3 * (T / M) * (CONST_MOLAR_GAS / g) *
+                log(surface_pressure[first_profile + j] / p);
+            altitude_profile[k] = prev_z[j];
+            prev_p[j] = p;
+            prev_M[j] = M;
+            prev_T[j] = T;
         }
-        else
+
+        for (i = 1; i < num_levels; i++)
         {
-            g = harp_gravity_from_latitude_and_height(latitude, prev_z);
-            z = prev_z + 1e3 * ((prev_T + T) / (prev_M + M)) * (CONST_MOLAR_GAS / g) * log(prev_p / p);
+            for (j = 0; j < num_block_profiles; j++)
+            {
+                long k = index[j] + i * step[j];
+                double p = pressure_profile[k];
+                double M = molar_mass_air[k];
+                double T = temperature_profile[k];
+                double g, z;
+
+                g = harp_gravity_from_gravity_terms_and_height(surface_gravity[j], height_factor[j], prev_z[j]);
+                z = prev_z[j] + 1e3 * ((prev_T[j] + T) / (prev_M[j] + M)) * (CONST_MOLAR_GAS / g) * log(prev_p[j] / p);
+                altitude_profile[k] = z;
+                prev_p[j] = p;
+                prev_M[j] = M;
+                prev_T[j] = T;
+                prev_z[j] = z;
+            }
         }
-
-        altitude_profile[k] = z;
-
-        prev_p = p;
-        prev_M = M;
-        prev_T = T;
-        prev_z = z;
     }
 }
 
+static double get_geopotential_from_gph(double gph)
+{
+    return CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE * gph;
+}
+
 /** Convert geopotential height to geopotential
  * \param gph Geopotential height [m]
  * \return the geopotential [m2/s2]
  */
 double harp_geopotential_from_gph(double gph)
 {
-    return CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE * gph;
+    return get_geopotential_from_gph(gph);
+}
+
+/** Array version of harp_geopotential_from_gph().
+ * \param num_elements Number of elements of each array.
+ * \param gph Geopotential height [m] (array of \a num_elements values)
+ * \param result Array in which the geopotential [m2/s2] values will be stored.
+ */
+void harp_geopotential_from_gph_array(long num_elements, const double *gph, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_geopotential_from_gph(gph[i]);
+    }
+}
+
+static double get_gph_from_geopotential(double geopotential)
+{
+    return geopotential / CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE;
 }
 
 /** Convert geopotential to geopotential height
@@ -139,15 +265,25 @@ double harp_geopotential_from_gph(double gph)
  */
 double harp_gph_from_geopotential(double geopotential)
 {
-    return geopotential / CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE;
+    return get_gph_from_geopotential(geopotential);
 }
 
-/** Convert geometric height (= altitude) to geopotential height
- * \param altitude  Altitude [m]
- * \param latitude   Latitude [degree_north]
- * \return the geopotential height [m]
+/** Array version of harp_gph_from_geopotential().
+ * \param num_elements Number of elements of each array.
+ * \param geopotential Geopotential [m2/s2] (array of \a num_elements values)
+ * \param result Array in which the geopotential height [m] values will be stored.
  */
-double harp_gph_from_altitude_and_latitude(double altitude, double latitude)
+void harp_gph_from_geopotential_array(long num_elements, const double *geopotential, double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_gph_from_geopotential(geopotential[i]);
+    }
+}
+
+static double get_gph_from_altitude_and_latitude(double altitude, double latitude)
 {
     double gsurf;       /* gravitational acceleration at surface [m] */
     double Rsurf;       /* local curvature radius [m] */
@@ -158,6 +294,33 @@ double harp_gph_from_altitude_and_latitude(double altitude, double latitude)
     return (gsurf / CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE) * Rsurf * altitude / (altitude + Rsurf);
 }
 
+/** Convert geometric height (= altitude) to geopotential height
+ * \param altitude  Altitude [m]
+ * \param latitude   Latitude [degree_north]
+ * \return the geopotential height [m]
+ */
+double harp_gph_from_altitude_and_latitude(double altitude, double latitude)
+{
+    return get_gph_from_altitude_and_latitude(altitude, latitude);
+}
+
+/** Array version of harp_gph_from_altitude_and_latitude().
+ * \param num_elements Number of elements of each array.
+ * \param altitude Altitude [m] (array of \a num_elements values)
+ * \param latitude Latitude [degree_north] (array of \a num_elements values)
+ * \param result Array in which the geopotential height [m] values will be stored.
+ */
+void harp_gph_from_altitude_and_latitude_array(long num_elements, const double *altitude, const double *latitude,
+                                               double *result)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        result[i] = get_gph_from_altitude_and_latitude(altitude[i], latitude[i]);
+    }
+}
+
 /** Convert geometric height (= altitude) to geopotential height
  * \param surface_pressure Surface pressure [Pa]
  * \param num_levels Length of vertical axis
@@ -290,40 +453,79 @@ void harp_profile_gph_from_pressure(long num_levels, const double *pressure_prof
                                     const double *molar_mass_air, double surface_pressure, double surface_height,
                                     double *gph_profile)
 {
-    double z, prev_z = 0, p, prev_p = 0, T, prev_T = 0, M, prev_M = 0;
-    long i;
+    harp_profile_gph_from_pressure_array(1, num_levels, pressure_profile, temperature_profile, molar_mass_air,
+                                         &surface_pressure, &surface_height, gph_profile);
+}
 
-    for (i = 0; i < num_levels; i++)
+/** Array version of harp_profile_gph_from_pressure().
+ * The profiles are integrated in blocks, level by level for all profiles of a block.
+ * \param num_profiles Number of profiles
+ * \param num_levels Length of vertical axis
+ * \param pressure_profile Pressure vertical profiles [Pa] (\a num_profiles x \a num_levels values)
+ * \param temperature_profile Temperature vertical profiles [K] (\a num_profiles x \a num_levels values)
+ * \param molar_mass_air Molar mass of total air [g/mol] (\a num_profiles x \a num_levels values)
+ * \param surface_pressure Surface pressure [Pa] (\a num_profiles values)
+ * \param surface_height Surface height [m] (\a num_profiles values)
+ * \param gph_profile Array in which the vertical profiles will be stored [m]
+ */
+void harp_profile_gph_from_pressure_array(long num_profiles, long num_levels, const double *pressure_profile,
+                                          const double *temperature_profile, const double *molar_mass_air,
+                                          const double *surface_pressure, const double *surface_height,
+                                          double *gph_profile)
+{
+    long index[PROFILE_BLOCK_SIZE];
+    long step[PROFILE_BLOCK_SIZE];
+    double prev_z[PROFILE_BLOCK_SIZE], prev_p[PROFILE_BLOCK_SIZE], prev_T[PROFILE_BLOCK_SIZE];
+    double prev_M[PROFILE_BLOCK_SIZE];
+    long first_profile;
+
+    if (num_levels <= 0)
     {
-        long k = i;
+        return;
+    }
 
-        if (pressure_profile[0] < pressure_profile[num_levels - 1])
-        {
-            /* vertical axis is from TOA to surface -> invert the loop index */
-            k = num_levels - 1 - i;
-        }
+    for (first_profile = 0; first_profile < num_profiles; first_profile += PROFILE_BLOCK_SIZE)
+    {
+        long num_block_profiles;
+        long i, j;
 
-        p = pressure_profile[k];
-        M = molar_mass_air[k];
-        T = temperature_profile[k];
+        num_block_profiles = get_profile_block_levels(num_profiles, num_levels, pressure_profile, first_profile, 1,
+                                                      index, step);
 
-        if (i == 0)
+        for (j = 0; j < num_block_profiles; j++)
         {
-            z = surface_height + 1e3 * (T / M) * (CONST_MOLAR_GAS / CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE) *
-                log(surface_pressure / p);
+            long k = index[j];
+            double p = pressure_profile[k];
+            double M = molar_mass_air[k];
+            double T = temperature_profile[k];
+
+            prev_z[j] = surface_height[first_profile + j] + 1e3 * (T / M) *
+                (CONST_MOLAR_GAS / CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE) * log(surface_pressure[first_profile + j] / p);
+            gph_profile[k] = prev_z[j];
+            prev_p[j] = p;
+            prev_M[j] = M;
+            prev_T[j] = T;
         }
-        else
+
+        for (i = 1; i < num_levels; i++)
         {
-            z = prev_z + 1e3 * ((prev_T + T) / (prev_M + M)) * (CONST_MOLAR_GAS / CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE) *
-                log(prev_p / p);
+            for (j = 0; j < num_block_profiles; j++)
+            {
+                long k = index[j] + i * step[j];
+                double p = pressure_profile[k];
+                double M = molar_mass_air[k];
+                double T = temperature_profile[k];
+                double z;
+
+                z = prev_z[j] + 1e3 * ((prev_T[j] + T) / (prev_M[j] + M)) *
+                    (CONST_MOLAR_GAS / CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE) * log(prev_p[j] / p);
+                gph_profile[k] = z;
+                prev_p[j] = p;
+                prev_M[j] = M;
+                prev_T[j] = T;
+                prev_z[j] = z;
+            }
         }
-
-        gph_profile[k] = z;
-
-        prev_p = p;
-        prev_M = M;
-        prev_T = T;
-        prev_z = z;
     }
 }
 
@@ -357,6 +559,108 @@ double harp_profile_column_from_partial_column(long num_levels, const double *pa
     return column;
 }
 
+/** Array version of harp_profile_column_from_partial_column().
+ * \param num_profiles            Number of profiles
+ * \param num_levels              Number of levels of each partial column profile
+ * \param partial_column_profile  Partial column profiles [molec/m2] (\a num_profiles x \a num_levels values)
+ * \param column                  Array in which the integrated columns [molec/m2] will be stored
+ */
+void harp_profile_column_from_partial_column_array(long num_profiles, long num_levels,
+                                                   const double *partial_column_profile, double *column)
+{
+    long i;
+
+    for (i = 0; i < num_profiles; i++)
+    {
+        column[i] = harp_profile_column_from_partial_column(num_levels, &partial_column_profile[i * num_levels]);
+    }
+}
+
+/** Integrate partial column profiles below and above the tropopause to obtain tropospheric and stratospheric columns
+ * Both columns are determined in a single pass over each profile. A layer that contains the tropopause is split
+ * linearly in altitude between the tropospheric and stratospheric column. Layers for which the partial column or the
+ * altitude bounds are NaN are ignored. A column is set to NaN if the tropopause altitude is NaN or if all layers were
+ * ignored.
+ * \param num_profiles            Number of profiles
+ * \param num_levels              Number of levels of each partial column profile
+ * \param partial_column_profile  Partial column profiles [molec/m2] (\a num_profiles x \a num_levels values)
+ * \param altitude_bounds         Altitude boundaries [m] (\a num_profiles x \a num_levels x 2 values)
+ * \param tropopause_altitude     Tropopause altitude [m] (\a num_profiles values)
+ * \param tropospheric_column     Array in which the tropospheric columns [molec/m2] will be stored (can be NULL)
+ * \param stratospheric_column    Array in which the stratospheric columns [molec/m2] will be stored (can be NULL)
+ */
+void harp_profile_tropopause_columns_from_partial_column_array(long num_profiles, long num_levels,
+                                                               const double *partial_column_profile,
+                                                               const double *altitude_bounds,
+                                                               const double *tropopause_altitude,
+                                                               double *tropospheric_column,
+                                                               double *stratospheric_column)
+{
+    long i, k;
+
+    for (i = 0; i < num_profiles; i++)
+    {
+        const double *partial_column = &partial_column_profile[i * num_levels];
+        const double *bounds = &altitude_bounds[i * num_levels * 2];
+        double tropopause = tropopause_altitude[i];
+        double troposphere = 0;
+        double stratosphere = 0;
+        int empty = 1;
+
+        if (!harp_isnan(tropopause))
+        {
+            for (k = 0; k < num_levels; k++)
+            {
+                double lower = bounds[2 * k];
+                double upper = bounds[2 * k + 1];
+                double fraction;
+
+                if (harp_isnan(partial_column[k]) || harp_isnan(lower) || harp_isnan(upper))
+                {
+                    continue;
+                }
+                if (lower > upper)
+                {
+                    double tmp = lower;
+
+                    lower = upper;
+                    upper = tmp;
+                }
+                /* fraction of the layer that is below the tropopause */
+                if (upper <= tropopause)
+                {
+                    fraction = 1;
+                }
+                else if (lower >= tropopause)
+                {
+                    fraction = 0;
+                }
+                else
+                {
+                    fraction = (tropopause - lower) / (upper - lower);
+                }
+                troposphere += fraction * partial_column[k];
+                stratosphere += (1 - fraction) * partial_column[k];
+                empty = 0;
+            }
+        }
+
+        if (empty)
+        {
+            troposphere = harp_nan();
+            stratosphere = harp_nan();
+        }
+        if (tropospheric_column != NULL)
+        {
+            tropospheric_column[i] = troposphere;
+        }
+        if (stratospheric_column != NULL)
+        {
+            stratospheric_column[i] = stratosphere;
+        }
+    }
+}
+
 /** Convert an altitude profile to a pressure profile
  * \param num_levels Length of vertical axis
  * \param altitude_profile Altitude profile [m]
@@ -372,40 +676,88 @@ void harp_profile_pressure_from_altitude(long num_levels, const double *altitude
                                          double surface_pressure, double surface_height, double latitude,
                                          double *pressure_profile)
 {
-    double z, prev_z = 0, p, prev_p = 0, T, prev_T = 0, M, prev_M = 0, g;
-    long i;
+    harp_profile_pressure_from_altitude_array(1, num_levels, altitude_profile, temperature_profile, molar_mass_air,
+                                              &surface_pressure, &surface_height, &latitude, pressure_profile);
+}
 
-    for (i = 0; i < num_levels; i++)
+/** Array version of harp_profile_pressure_from_altitude().
+ * The profiles are integrated in blocks, level by level for all profiles of a block. The latitude dependent gravity
+ * terms are calculated only once per profile.
+ * \param num_profiles Number of profiles
+ * \param num_levels Length of vertical axis
+ * \param altitude_profile Altitude profiles [m] (\a num_profiles x \a num_levels values)
+ * \param temperature_profile Temperature vertical profiles [K] (\a num_profiles x \a num_levels values)
+ * \param molar_mass_air Molar mass of total air [g/mol] (\a num_profiles x \a num_levels values)
+ * \param surface_pressure Surface pressure [Pa] (\a num_profiles values)
+ * \param surface_height Surface height [m] (\a num_profiles values)
+ * \param latitude Latitude [degree_north] (\a num_profiles values)
+ * \param pressure_profile Array in which the vertical profiles will be stored [Pa]
+ */
+void harp_profile_pressure_from_altitude_array(long num_profiles, long num_levels, const double *altitude_profile,
+                                               const double *temperature_profile, const double *molar_mass_air,
+                                               const double *surface_pressure, const double *surface_height,
+                                               const double *latitude, double *pressure_profile)
+{
+    long index[PROFILE_BLOCK_SIZE];
+    long step[PROFILE_BLOCK_SIZE];
+    double surface_gravity[PROFILE_BLOCK_SIZE];
+    double height_factor[PROFILE_BLOCK_SIZE];
+    double prev_z[PROFILE_BLOCK_SIZE], prev_p[PROFILE_BLOCK_SIZE], prev_T[PROFILE_BLOCK_SIZE];
+    double prev_M[PROFILE_BLOCK_SIZE];
+    long first_profile;
+
+    if (num_levels <= 0)
     {
-        long k = i;
+        return;
+    }
 
-        if (altitude_profile[0] > altitude_profile[num_levels - 1])
-        {
-            /* vertical axis is from TOA to surface -> invert the loop index */
-            k = num_levels - 1 - i;
-        }
+    for (first_profile = 0; first_profile < num_profiles; first_profile += PROFILE_BLOCK_SIZE)
+    {
+        long num_block_profiles;
+        long i, j;
 
-        z = altitude_profile[k];
-        M = molar_mass_air[k];
-        T = temperature_profile[k];
+        num_block_profiles = get_profile_block_levels(num_profiles, num_levels, altitude_profile, first_profile, 0,
+                                                      index, step);
 
-        if (i == 0)
+        for (j = 0; j < num_block_profiles; j++)
         {
-            g = harp_gravity_from_latitude_and_height(latitude, (z + surface_height) / 2);
-            p = surface_pressure * exp(-1e-3 * (M / T) * (g / CONST_MOLAR_GAS) * (z - surface_height));
+            long k = index[j];
+            double z = altitude_profile[k];
+            double M = molar_mass_air[k];
+            double T = temperature_profile[k];
+            double h = surface_height[first_profile + j];
+            double g;
+
+            harp_gravity_terms_from_latitude(latitude[first_profile + j], &surface_gravity[j], &height_factor[j]);
+            g = harp_gravity_from_gravity_terms_and_height(surface_gravity[j], height_factor[j], (z + h) / 2);
+            prev_p[j] = surface_pressure[first_profile + j] * exp(-1e-3 * (M / T) * (g / CONST_MOLAR_GAS) * (z - h));
+            pressure_profile[k] = prev_p[j];
+            prev_M[j] = M;
+            prev_T[j] = T;
+            prev_z[j] = z;
         }
-        else
+
+        for (i = 1; i < num_levels; i++)
         {
-            g = harp_gravity_from_latitude_and_height(latitude, (prev_z + z) / 2);
-            p = prev_p * exp(-1e-3 * ((prev_M + M) / (prev_T + T)) * (g / CONST_MOLAR_GAS) * (z - prev_z));
+            for (j = 0; j < num_block_profiles; j++)
+            {
+                long k = index[j] + i * step[j];
+                double z = altitude_profile[k];
+                double M = molar_mass_air[k];
+                double T = temperature_profile[k];
+                double g, p;
+
+                g = harp_gravity_from_gravity_terms_and_height(surface_gravity[j], height_factor[j],
+                                                               (prev_z[j] + z) / 2);
+                p = prev_p[j] * exp(-1e-3 * ((prev_M[j] + M) / (prev_T[j] + T)) * (g / CONST_MOLAR_GAS) *
+                                    (z - prev_z[j]));
+                pressure_profile[k] = p;
+                prev_p[j] = p;
+                prev_M[j] = M;
+                prev_T[j] = T;
+                prev_z[j] = z;
+            }
         }
-
-        pressure_profile[k] = p;
-
-        prev_p = p;
-        prev_M = M;
-        prev_T = T;
-        prev_z = z;
     }
 }
 
@@ -422,60 +774,121 @@ void harp_profile_pressure_from_gph(long num_levels, const double *gph_profile,
                                     const double *molar_mass_air, double surface_pressure, double surface_height,
                                     double *pressure_profile)
 {
-    double z, prev_z = 0, p, prev_p = 0, T, prev_T = 0, M, prev_M = 0;
-    long i;
+    harp_profile_pressure_from_gph_array(1, num_levels, gph_profile, temperature_profile, molar_mass_air,
+                                         &surface_pressure, &surface_height, pressure_profile);
+}
 
-    for (i = 0; i < num_levels; i++)
+/** Array version of harp_profile_pressure_from_gph().
+ * The profiles are integrated in blocks, level by level for all profiles of a block.
+ * \param num_profiles Number of profiles
+ * \param num_levels Length of vertical axis
+ * \param gph_profile Geopotential height profiles [m] (\a num_profiles x \a num_levels values)
+ * \param temperature_profile Temperature vertical profiles [K] (\a num_profiles x \a num_levels values)
+ * \param molar_mass_air Molar mass of total air [g/mol] (\a num_profiles x \a num_levels values)
+ * \param surface_pressure Surface pressure [Pa] (\a num_profiles values)
+ * \param surface_height Surface height [m] (\a num_profiles values)
+ * \param pressure_profile Array in which the vertical profiles will be stored [Pa]
+ */
+void harp_profile_pressure_from_gph_array(long num_profiles, long num_levels, const double *gph_profile,
+                                          const double *temperature_profile, const double *molar_mass_air,
+                                          const double *surface_pressure, const double *surface_height,
+                                          double *pressure_profile)
+{
+    long index[PROFILE_BLOCK_SIZE];
+    long step[PROFILE_BLOCK_SIZE];
+    double prev_z[PROFILE_BLOCK_SIZE], prev_p[PROFILE_BLOCK_SIZE], prev_T[PROFILE_BLOCK_SIZE];
+    double prev_M[PROFILE_BLOCK_SIZE];
+    long first_profile;
+
+    if (num_levels <= 0)
     {
-        long k = i;
+        return;
+    }
 
-        if (gph_profile[0] > gph_profile[num_levels - 1])
-        {
-            /* vertical axis is from TOA to surface -> invert the loop index */
-            k = num_levels - 1 - i;
-        }
+    for (first_profile = 0; first_profile < num_profiles; first_profile += PROFILE_BLOCK_SIZE)
+    {
+        long num_block_profiles;
+        long i, j;
 
-        z = gph_profile[k];
-        M = molar_mass_air[k];
-        T = temperature_profile[k];
+        num_block_profiles = get_profile_block_levels(num_profiles, num_levels, gph_profile, first_profile, 0,
+                                                      index, step);
 
-        if (i == 0)
+        for (j = 0; j < num_block_profiles; j++)
         {
-            p = surface_pressure * exp(-1e-3 * (M / T) * (CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE / CONST_MOLAR_GAS) *
-                                       (z - surface_height));
+            long k = index[j];
+            double z = gph_profile[k];
+            double M = molar_mass_air[k];
+            double T = temperature_profile[k];
+
+            prev_p[j] = surface_pressure[first_profile + j] *
+                exp(-1e-3 * (M / T) * (CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE / CONST_MOLAR_GAS) *
+                    (z - surface_height[first_profile + j]));
+            pressure_profile[k] = prev_p[j];
+            prev_M[j] = M;
+            prev_T[j] = T;
+            prev_z[j] = z;
         }
-        else
+
+        for (i = 1; i < num_levels; i++)
         {
-            p = prev_p * exp(-1e-3 * ((prev_M + M) / (prev_T + T)) *
-                             (CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE / CONST_MOLAR_GAS) * (z - prev_z));
+            for (j = 0; j < num_block_profiles; j++)
+            {
+                long k = index[j] + i * step[j];
+                double z = gph_profile[k];
+                double M = molar_mass_air[k];
+                double T = temperature_profile[k];
+                double p;
+
+                p = prev_p[j] * exp(-1e-3 * ((prev_M[j] + M) / (prev_T[j] + T)) *
+                                    (CONST_GRAV_ACCEL_45LAT_WGS84_SPHERE / CONST_MOLAR_GAS) * (z - prev_z[j]));
+                pressure_profile[k] = p;
+                prev_p[j] = p;
+                prev_M[j] = M;
+                prev_T[j] = T;
+                prev_z[j] = z;
+            }
         }
-
-        pressure_profile[k] = p;
-
-        prev_p = p;
-        prev_M = M;
-        prev_T = T;
-        prev_z = z;
     }
 }
 
+/* The AVK conversions below operate on a batch of num_profiles AVK matrices {num_profiles,vertical,vertical} (e.g. all
+ * time samples of a variable at once). Scaling the rows and columns of a matrix is performed in a single row-major
+ * pass (with the row factor fixed and the column factors broadcast along each row), which keeps the memory access
+ * contiguous and allows the inner loops to be vectorized. Each element is computed using the same operations, in the
+ * same order, as a separate row pass followed by a column pass would use (only elements of rows that are set to zero
+ * are no longer multiplied by a non-finite column factor).
+ */
+
 /** Sum the columns of the 2D averaging kernal to arrive at a 1D column averaging kernel
  * The 2D averaging kernel needs to be a partial column number density AVK.
+ * \param num_profiles          Number of averaging kernels
  * \param num_levels            Number of vertical levels
- * \param column_density_avk_2d 2D column number density averaging kernel {num_levels,num_levels}
- * \param column_density_avk_1d 1D column number density averaging kernel {num_levels}
+ * \param column_density_avk_2d 2D column number density averaging kernels {num_profiles,num_levels,num_levels}
+ * \param column_density_avk_1d 1D column number density averaging kernels {num_profiles,num_levels}
  */
-void harp_profile_column_avk_from_partial_column_avk(long num_levels, const double *column_density_avk_2d,
+void harp_profile_column_avk_from_partial_column_avk(long num_profiles, long num_levels,
+                                                     const double *column_density_avk_2d,
                                                      double *column_density_avk_1d)
 {
-    long i, j;
+    long k, i, j;
 
-    for (j = 0; j < num_levels; j++)
+    for (k = 0; k < num_profiles; k++)
     {
-        column_density_avk_1d[j] = column_density_avk_2d[j];
+        const double *avk_2d = &column_density_avk_2d[k * num_levels * num_levels];
+        double *avk_1d = &column_density_avk_1d[k * num_levels];
+
+        for (j = 0; j < num_levels; j++)
+        {
+            avk_1d[j] = avk_2d[j];
+        }
         for (i = 1; i < num_levels; i++)
         {
-            column_density_avk_1d[j] += column_density_avk_2d[i * num_levels + j];
+            const double *row = &avk_2d[i * num_levels];
+
+            for (j = 0; j < num_levels; j++)
+            {
+                avk_1d[j] += row[j];
+            }
         }
     }
 }
@@ -483,172 +896,155 @@ void harp_profile_column_avk_from_partial_column_avk(long num_levels, const doub
 /** Convert a partial column avk to a density avk using the altitude boundaries profile
  * This is a generic routine to convert partial columns to a densities. It works for all cases where the
  * conversion is a matter of dividing the partial column value by the altitude height to get the density value.
+ * \param num_profiles Number of averaging kernels
  * \param num_levels Number of vertical levels
- * \param partial_column_avk Partial column avk {vertical,vertical}
- * \param altitude_bounds Lower and upper altitude [m] boundaries for each level {vertical,2}
- * \param density_avk variable in which the density avk {vertical,vertical} will be stored
+ * \param partial_column_avk Partial column avk {num_profiles,vertical,vertical}
+ * \param altitude_bounds Lower and upper altitude [m] boundaries for each level {num_profiles,vertical,2}
+ * \param density_avk variable in which the density avk {num_profiles,vertical,vertical} will be stored
  */
-void harp_density_avk_from_partial_column_avk_and_altitude_bounds(long num_levels, const double *partial_column_avk,
+void harp_density_avk_from_partial_column_avk_and_altitude_bounds(long num_profiles, long num_levels,
+                                                                  const double *partial_column_avk,
                                                                   const double *altitude_bounds, double *density_avk)
 {
-    long i, j;
+    long k, i, j;
 
-    for (i = 0; i < num_levels; i++)
+    for (k = 0; k < num_profiles; k++)
     {
-        double height = fabs(altitude_bounds[i * 2 + 1] - altitude_bounds[i * 2]);
+        const double *bounds = &altitude_bounds[k * num_levels * 2];
 
-        if (height < EPSILON)
+        for (i = 0; i < num_levels; i++)
         {
-            for (j = 0; j < num_levels; j++)
+            const double *src = &partial_column_avk[(k * num_levels + i) * num_levels];
+            double *dst = &density_avk[(k * num_levels + i) * num_levels];
+            double height = fabs(bounds[i * 2 + 1] - bounds[i * 2]);
+
+            if (height < EPSILON)
             {
-                density_avk[i * num_levels + j] = 0;
+                for (j = 0; j < num_levels; j++)
+                {
+                    dst[j] = 0;
+                }
             }
-        }
-        else
-        {
-            for (j = 0; j < num_levels; j++)
+            else
             {
-                density_avk[i * num_levels + j] = partial_column_avk[i * num_levels + j] / height;
+                for (j = 0; j < num_levels; j++)
+                {
+                    dst[j] = src[j] / height * fabs(bounds[j * 2 + 1] - bounds[j * 2]);
+                }
             }
         }
     }
-    for (j = 0; j < num_levels; j++)
-    {
-        double height = fabs(altitude_bounds[j * 2 + 1] - altitude_bounds[j * 2]);
-
-        for (i = 0; i < num_levels; i++)
-        {
-            density_avk[i * num_levels + j] *= height;
-        }
-    }
 }
 
 /** Convert a partial column profile to a density profile using the altitude boundaries as provided
  * This is a generic routine to convert densities to partial columns. It works for all cases where the conversion is a
  * matter of multiplying the density value by the altitude height to get the partial column value.
+ * \param num_profiles Number of averaging kernels
  * \param num_levels Number of vertical levels
- * \param density_avk Density avk {vertical,vertical}
- * \param altitude_bounds Lower and upper altitude [m] boundaries for each level {vertical,2}
- * \param partial_column_avk variable in which the partial column avk {vertical,vertical} will be stored
+ * \param density_avk Density avk {num_profiles,vertical,vertical}
+ * \param altitude_bounds Lower and upper altitude [m] boundaries for each level {num_profiles,vertical,2}
+ * \param partial_column_avk variable in which the partial column avk {num_profiles,vertical,vertical} will be stored
  */
-void harp_partial_column_avk_from_density_avk_and_altitude_bounds(long num_levels, const double *density_avk,
+void harp_partial_column_avk_from_density_avk_and_altitude_bounds(long num_profiles, long num_levels,
+                                                                  const double *density_avk,
                                                                   const double *altitude_bounds,
                                                                   double *partial_column_avk)
 {
-    long i, j;
+    long k, i, j;
 
-    for (i = 0; i < num_levels; i++)
+    for (k = 0; k < num_profiles; k++)
     {
-        double height = fabs(altitude_bounds[i * 2 + 1] - altitude_bounds[i * 2]);
+        const double *bounds = &altitude_bounds[k * num_levels * 2];
 
-        for (j = 0; j < num_levels; j++)
+        for (i = 0; i < num_levels; i++)
         {
-            partial_column_avk[i * num_levels + j] = density_avk[i * num_levels + j] * height;
-        }
-    }
-    for (j = 0; j < num_levels; j++)
-    {
-        double height = fabs(altitude_bounds[j * 2 + 1] - altitude_bounds[j * 2]);
+            const double *src = &density_avk[(k * num_levels + i) * num_levels];
+            double *dst = &partial_column_avk[(k * num_levels + i) * num_levels];
+            double height = fabs(bounds[i * 2 + 1] - bounds[i * 2]);
 
-        if (height < EPSILON)
-        {
-            for (i = 0; i < num_levels; i++)
-            {
-                partial_column_avk[i * num_levels + j] = 0;
-            }
-        }
-        else
-        {
-            for (i = 0; i < num_levels; i++)
+            for (j = 0; j < num_levels; j++)
             {
-                partial_column_avk[i * num_levels + j] /= height;
+                double column_height = fabs(bounds[j * 2 + 1] - bounds[j * 2]);
+
+                dst[j] = column_height < EPSILON ? 0 : src[j] * height / column_height;
             }
         }
     }
 }
 
 /** Convert a volume mixing ratio avk to a number density avk using the air number density profile
+ * \param num_profiles Number of averaging kernels
  * \param num_levels Number of vertical levels
- * \param volume_mixing_ratio_avk Volume mixing ratio avk {vertical,vertical}
- * \param number_density_air Number density of air [molec/cm3] {vertical}
- * \param number_density_avk variable in which the number density avk [(molec/cm3)/(molec/cm3)] {vertical,vertical}
- * will be stored
+ * \param volume_mixing_ratio_avk Volume mixing ratio avk {num_profiles,vertical,vertical}
+ * \param number_density_air Number density of air [molec/cm3] {num_profiles,vertical}
+ * \param number_density_avk variable in which the number density avk [(molec/cm3)/(molec/cm3)]
+ * {num_profiles,vertical,vertical} will be stored
  */
-void harp_number_density_avk_from_volume_mixing_ratio_avk(long num_levels, const double *volume_mixing_ratio_avk,
+void harp_number_density_avk_from_volume_mixing_ratio_avk(long num_profiles, long num_levels,
+                                                          const double *volume_mixing_ratio_avk,
                                                           const double *number_density_air, double *number_density_avk)
 {
-    long i, j;
+    long k, i, j;
 
-    for (i = 0; i < num_levels; i++)
+    for (k = 0; k < num_profiles; k++)
     {
-        double number_density = number_density_air[i];
+        const double *number_density = &number_density_air[k * num_levels];
 
-        for (j = 0; j < num_levels; j++)
+        for (i = 0; i < num_levels; i++)
         {
-            number_density_avk[i * num_levels + j] = volume_mixing_ratio_avk[i * num_levels + j] * number_density;
-        }
-    }
-    for (j = 0; j < num_levels; j++)
-    {
-        double number_density = number_density_air[j];
+            const double *src = &volume_mixing_ratio_avk[(k * num_levels + i) * num_levels];
+            double *dst = &number_density_avk[(k * num_levels + i) * num_levels];
+            double row_number_density = number_density[i];
 
-        if (fabs(number_density) < EPSILON)
-        {
-            for (i = 0; i < num_levels; i++)
-            {
-                number_density_avk[i * num_levels + j] = 0;
-            }
-        }
-        else
-        {
-            for (i = 0; i < num_levels; i++)
+            for (j = 0; j < num_levels; j++)
             {
-                number_density_avk[i * num_levels + j] /= number_density;
+                dst[j] = fabs(number_density[j]) < EPSILON ? 0 : src[j] * row_number_density / number_density[j];
             }
         }
     }
 }
 
 /** Convert a number density avk to a volume mixing ratio avk using the air number density profile
+ * \param num_profiles Number of averaging kernels
  * \param num_levels Number of vertical levels
- * \param number_density_avk Number density avk [(molec/cm3)/(molec/cm3)] {vertical,vertical}
- * \param number_density_air Number density of air [molec/cm3] {vertical}
- * \param volume_mixing_ratio_avk variable in which the volume mixing ratio avk {vertical,vertical} will be stored
+ * \param number_density_avk Number density avk [(molec/cm3)/(molec/cm3)] {num_profiles,vertical,vertical}
+ * \param number_density_air Number density of air [molec/cm3] {num_profiles,vertical}
+ * \param volume_mixing_ratio_avk variable in which the volume mixing ratio avk {num_profiles,vertical,vertical} will
+ * be stored
  */
-void harp_volume_mixing_ratio_avk_from_number_density_avk(long num_levels, const double *number_density_avk,
+void harp_volume_mixing_ratio_avk_from_number_density_avk(long num_profiles, long num_levels,
+                                                          const double *number_density_avk,
                                                           const double *number_density_air,
                                                           double *volume_mixing_ratio_avk)
 {
-    long i, j;
+    long k, i, j;
 
-    for (i = 0; i < num_levels; i++)
+    for (k = 0; k < num_profiles; k++)
     {
-        double number_density = number_density_air[i];
+        const double *number_density = &number_density_air[k * num_levels];
 
-        if (fabs(number_density) < EPSILON)
+        for (i = 0; i < num_levels; i++)
         {
-            for (j = 0; j < num_levels; j++)
+            const double *src = &number_density_avk[(k * num_levels + i) * num_levels];
+            double *dst = &volume_mixing_ratio_avk[(k * num_levels + i) * num_levels];
+            double row_number_density = number_density[i];
+
+            if (fabs(row_number_density) < EPSILON)
             {
-                volume_mixing_ratio_avk[i * num_levels + j] = 0;
+                for (j = 0; j < num_levels; j++)
+                {
+                    dst[j] = 0;
+                }
             }
-        }
-        else
-        {
-            for (j = 0; j < num_levels; j++)
+            else
             {
-                volume_mixing_ratio_avk[i * num_levels + j] = number_density_avk[i * num_levels + j] / number_density;
+                for (j = 0; j < num_levels; j++)
+                {
+                    dst[j] = src[j] / row_number_density * number_density[j];
+                }
             }
         }
     }
-    for (j = 0; j < num_levels; j++)
-    {
-        double number_density = number_density_air[j];
-
-        for (i = 0; i < num_levels; i++)
-        {
-            volume_mixing_ratio_avk[i * num_levels + j] *= number_density;
-        }
-    }
 }
 
 static long get_unpadded_vector_length(double *vector, long vector_length)
@@ -692,6 +1088,7 @@ LIBHARP_API int harp_variable_smooth_vertical(harp_variable *variable, harp_vari
                                               harp_variable *averaging_kernel, harp_variable *apriori)
 {
     double *vector = NULL;
+    long *valid_index = NULL;
     long max_vertical_elements;
     long num_blocks;
     long k, l;
@@ -784,6 +1181,12 @@ LIBHARP_API int harp_variable_smooth_vertical(harp_variable *variable, harp_vari
         }
     }
 
+    /* the variable is smoothed in place */
+    if (harp_variable_make_data_owned(variable) != 0)
+    {
+        return -1;
+    }
+
     /* allocate memory for the temporary vertical profile vector */
     vector = malloc(max_vertical_elements * sizeof(double));
     if (!vector)
@@ -792,12 +1195,21 @@ LIBHARP_API int harp_variable_smooth_vertical(harp_variable *variable, harp_vari
                        max_vertical_elements * sizeof(double), __FILE__, __LINE__);
         return -1;
     }
+    valid_index = malloc(max_vertical_elements * sizeof(long));
+    if (!valid_index)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       max_vertical_elements * sizeof(long), __FILE__, __LINE__);
+        free(vector);
+        return -1;
+    }
 
     /* calculate the number of blocks in this datetime slice of the variable */
     num_blocks = variable->num_elements / variable->dimension[0] / max_vertical_elements;
 
     for (k = 0; k < variable->dimension[0]; k++)
     {
+        const double *avk = &averaging_kernel->data.double_data[k * max_vertical_elements * max_vertical_elements];
         long num_vertical_elements = max_vertical_elements;
 
         if (vertical_axis != NULL)
@@ -809,58 +1221,103 @@ LIBHARP_API int harp_variable_smooth_vertical(harp_variable *variable, harp_vari
 
         for (l = 0; l < num_blocks; l++)
         {
-            long blockoffset = (k * num_blocks + l) * max_vertical_elements;
+            double *profile = &variable->data.double_data[(k * num_blocks + l) * max_vertical_elements];
+            long num_valid = 0;
             long i, j;
 
-            /* store profile in temporary vector */
+            /* store profile in temporary vector, subtract a priori, and keep track of the valid elements */
             for (i = 0; i < num_vertical_elements; i++)
             {
-                vector[i] = variable->data.double_data[blockoffset + i];
-            }
-
-            /* subtract a priori */
-            if (apriori != NULL)
-            {
-                for (i = 0; i < num_vertical_elements; i++)
+                vector[i] = profile[i];
+                if (apriori != NULL)
                 {
                     vector[i] -= apriori->data.double_data[k * max_vertical_elements + i];
                 }
+                if (!harp_isnan(vector[i]))
+                {
+                    valid_index[num_valid] = i;
+                    num_valid++;
+                }
+            }
+            if (num_valid == 0)
+            {
+                /* nothing to smooth (all elements remain NaN) */
+                continue;
             }
 
-            /* multiply by avk */
-            for (i = 0; i < num_vertical_elements; i++)
+            /* multiply by avk (only the valid elements contribute) */
+            i = 0;
+            if (num_valid == num_vertical_elements)
             {
-                if (!harp_isnan(vector[i]))
+                /* all elements are valid: process four rows at a time so each vector element is loaded once for
+                 * four independent sums (the summation order of each row is unchanged) */
+                for (; i + 3 < num_vertical_elements; i += 4)
                 {
-                    long avk_offset = (k * max_vertical_elements + i) * max_vertical_elements;
-                    long num_valid = 0;
+                    const double *row0 = &avk[i * max_vertical_elements];
+                    const double *row1 = row0 + max_vertical_elements;
+                    const double *row2 = row1 + max_vertical_elements;
+                    const double *row3 = row2 + max_vertical_elements;
+                    double sum0 = 0;
+                    double sum1 = 0;
+                    double sum2 = 0;
+                    double sum3 = 0;
 
-                    variable->data.double_data[blockoffset + i] = 0;
                     for (j = 0; j < num_vertical_elements; j++)
                     {
-                        if (!harp_isnan(vector[j]))
-                        {
-                            variable->data.double_data[blockoffset + i] +=
-                                averaging_kernel->data.double_data[avk_offset + j] * vector[j];
-                            num_valid++;
-                        }
+                        sum0 += row0[j] * vector[j];
+                        sum1 += row1[j] * vector[j];
+                        sum2 += row2[j] * vector[j];
+                        sum3 += row3[j] * vector[j];
                     }
+                    profile[i] = sum0;
+                    profile[i + 1] = sum1;
+                    profile[i + 2] = sum2;
+                    profile[i + 3] = sum3;
+                }
+                for (; i < num_vertical_elements; i++)
+                {
+                    const double *row = &avk[i * max_vertical_elements];
+                    double sum = 0;
 
-                    /* add the apriori again */
-                    if (apriori != NULL)
+                    for (j = 0; j < num_vertical_elements; j++)
                     {
-                        variable->data.double_data[blockoffset + i] +=
-                            apriori->data.double_data[k * max_vertical_elements + i];
+                        sum += row[j] * vector[j];
                     }
-                    else if (num_valid == 0)
+                    profile[i] = sum;
+                }
+            }
+            else
+            {
+                long m;
+
+                for (m = 0; m < num_valid; m++)
+                {
+                    const double *row;
+                    double sum = 0;
+
+                    i = valid_index[m];
+                    row = &avk[i * max_vertical_elements];
+                    for (j = 0; j < num_valid; j++)
                     {
-                        variable->data.double_data[blockoffset + i] = harp_nan();
+                        sum += row[valid_index[j]] * vector[valid_index[j]];
                     }
+                    profile[i] = sum;
+                }
+            }
+
+            /* add the apriori again */
+            if (apriori != NULL)
+            {
+                for (j = 0; j < num_valid; j++)
+                {
+                    i = valid_index[j];
+                    profile[i] += apriori->data.double_data[k * max_vertical_elements + i];
                 }
             }
         }
     }
 
+    free(valid_index);
     free(vector);
 
     return 0;
@@ -1122,24 +1579,17 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
         return -1;
     }
 
-    /* copy the collocation result for filtering */
-    if (harp_collocation_result_shallow_copy(collocation_result, &filtered_collocation_result) != 0)
-    {
-        return -1;
-    }
-
-    /* Reduce the collocation result to only pairs that include the source product */
-    if (harp_collocation_result_filter_for_collocation_indices(filtered_collocation_result,
-                                                               collocation_index->num_elements,
-                                                               collocation_index->data.int32_data) != 0)
+    /* Get a view on the pairs of the collocation result that include the source product */
+    if (harp_collocation_result_get_view_for_collocation_indices(collocation_result, collocation_index->num_elements,
+                                                                 collocation_index->data.int32_data,
+                                                                 &filtered_collocation_result) != 0)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
         return -1;
     }
     if (filtered_collocation_result->num_pairs != collocation_index->num_elements)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product and collocation result are inconsistent");
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -1156,7 +1606,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
                                                            &collocated_product) != 0)
         {
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1175,7 +1625,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
         {
             harp_product_delete(collocated_product);
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1185,7 +1635,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
         {
             harp_product_delete(collocated_product);
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1204,7 +1654,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
             {
                 harp_product_delete(collocated_product);
                 harp_product_delete(merged_product);
-                harp_collocation_result_shallow_delete(filtered_collocation_result);
+                harp_collocation_result_view_delete(filtered_collocation_result);
                 return -1;
             }
 
@@ -1227,7 +1677,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
                 {
                     harp_product_delete(collocated_product);
                     harp_product_delete(merged_product);
-                    harp_collocation_result_shallow_delete(filtered_collocation_result);
+                    harp_collocation_result_view_delete(filtered_collocation_result);
                     return -1;
                 }
             }
@@ -1243,7 +1693,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
             {
                 harp_product_delete(collocated_product);
                 harp_product_delete(merged_product);
-                harp_collocation_result_shallow_delete(filtered_collocation_result);
+                harp_collocation_result_view_delete(filtered_collocation_result);
                 return -1;
             }
             harp_product_delete(collocated_product);
@@ -1252,7 +1702,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
 
     if (merged_product == NULL)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocated dataset does not contain any matching pairs");
         return -1;
     }
@@ -1262,7 +1712,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
                                      collocation_index->data.int32_data) != 0)
     {
         harp_product_delete(merged_product);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -1271,7 +1721,7 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
     if (harp_product_regrid_with_axis_variable(product, vertical_grid, vertical_bounds) != 0)
     {
         harp_product_delete(merged_product);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -1290,14 +1740,14 @@ LIBHARP_API int harp_product_smooth_vertical_with_collocated_dataset(harp_produc
         if (harp_variable_smooth_vertical(variable, vertical_grid, avk, apriori) != 0)
         {
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
     }
 
     /* cleanup */
     harp_product_delete(merged_product);
-    harp_collocation_result_shallow_delete(filtered_collocation_result);
+    harp_collocation_result_view_delete(filtered_collocation_result);
 
     return 0;
 }
@@ -1748,24 +2198,17 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
         return -1;
     }
 
-    /* copy the collocation result for filtering */
-    if (harp_collocation_result_shallow_copy(collocation_result, &filtered_collocation_result) != 0)
-    {
-        return -1;
-    }
-
-    /* Reduce the collocation result to only pairs that include the source product */
-    if (harp_collocation_result_filter_for_collocation_indices(filtered_collocation_result,
-                                                               collocation_index->num_elements,
-                                                               collocation_index->data.int32_data) != 0)
+    /* Get a view on the pairs of the collocation result that include the source product */
+    if (harp_collocation_result_get_view_for_collocation_indices(collocation_result, collocation_index->num_elements,
+                                                                 collocation_index->data.int32_data,
+                                                                 &filtered_collocation_result) != 0)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
         return -1;
     }
     if (filtered_collocation_result->num_pairs != collocation_index->num_elements)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product and collocation result are inconsistent");
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -1784,7 +2227,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
                                                            &collocated_product) != 0)
         {
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1803,7 +2246,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
         {
             harp_product_delete(collocated_product);
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1813,7 +2256,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
         {
             harp_product_delete(collocated_product);
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1829,7 +2272,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
         {
             harp_product_delete(collocated_product);
             harp_product_delete(merged_product);
-            harp_collocation_result_shallow_delete(filtered_collocation_result);
+            harp_collocation_result_view_delete(filtered_collocation_result);
             return -1;
         }
 
@@ -1851,7 +2294,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
                 {
                     harp_product_delete(collocated_product);
                     harp_product_delete(merged_product);
-                    harp_collocation_result_shallow_delete(filtered_collocation_result);
+                    harp_collocation_result_view_delete(filtered_collocation_result);
                     return -1;
                 }
             }
@@ -1867,7 +2310,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
             {
                 harp_product_delete(collocated_product);
                 harp_product_delete(merged_product);
-                harp_collocation_result_shallow_delete(filtered_collocation_result);
+                harp_collocation_result_view_delete(filtered_collocation_result);
                 return -1;
             }
             harp_product_delete(collocated_product);
@@ -1876,7 +2319,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
 
     if (merged_product == NULL)
     {
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "collocated dataset does not contain any matching pairs");
         return -1;
     }
@@ -1886,7 +2329,7 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
                                      collocation_index->data.int32_data) != 0)
     {
         harp_product_delete(merged_product);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
@@ -1901,13 +2344,13 @@ LIBHARP_API int harp_product_get_smoothed_column_using_collocated_dataset(harp_p
                                          variable) != 0)
     {
         harp_product_delete(merged_product);
-        harp_collocation_result_shallow_delete(filtered_collocation_result);
+        harp_collocation_result_view_delete(filtered_collocation_result);
         return -1;
     }
 
     /* cleanup */
     harp_product_delete(merged_product);
-    harp_collocation_result_shallow_delete(filtered_collocation_result);
+    harp_collocation_result_view_delete(filtered_collocation_result);
 
     return 0;
 }
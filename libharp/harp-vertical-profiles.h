@@ -36,9 +36,15 @@
 
 /* Conversions */
 double harp_geopotential_from_gph(double gph);
+void harp_geopotential_from_gph_array(long num_elements, const double *gph, double *result);
 double harp_gph_from_geopotential(double geopotential);
+void harp_gph_from_geopotential_array(long num_elements, const double *geopotential, double *result);
 double harp_altitude_from_gph_and_latitude(double gph, double latitude);
+void harp_altitude_from_gph_and_latitude_array(long num_elements, const double *gph, const double *latitude,
+                                               double *result);
 double harp_gph_from_altitude_and_latitude(double altitude, double latitude);
+void harp_gph_from_altitude_and_latitude_array(long num_elements, const double *altitude, const double *latitude,
+                                               double *result);
 double harp_gph_from_pressure(double pressure);
 
 double harp_column_mass_density_from_surface_pressure_and_profile(double surface_pressure, long num_levels,
@@ -53,32 +59,61 @@ void harp_profile_altitude_from_pressure(long num_levels, const double *pressure
                                          const double *temperature_profile, const double *molar_mass_air,
                                          double surface_pressure, double surface_height, double latitude,
                                          double *altitude_profile);
+void harp_profile_altitude_from_pressure_array(long num_profiles, long num_levels, const double *pressure_profile,
+                                               const double *temperature_profile, const double *molar_mass_air,
+                                               const double *surface_pressure, const double *surface_height,
+                                               const double *latitude, double *altitude_profile);
 void harp_profile_gph_from_pressure(long num_levels, const double *pressure_profile, const double *temperature_profile,
                                     const double *molar_mass_air, double surface_pressure, double surface_height,
                                     double *gph_profile);
+void harp_profile_gph_from_pressure_array(long num_profiles, long num_levels, const double *pressure_profile,
+                                          const double *temperature_profile, const double *molar_mass_air,
+                                          const double *surface_pressure, const double *surface_height,
+                                          double *gph_profile);
 void harp_profile_pressure_from_altitude(long num_levels, const double *altitude_profile,
                                          const double *temperature_profile, const double *molar_mass_air,
                                          double surface_pressure, double surface_height, double latitude,
                                          double *pressure_profile);
+void harp_profile_pressure_from_altitude_array(long num_profiles, long num_levels, const double *altitude_profile,
+                                               const double *temperature_profile, const double *molar_mass_air,
+                                               const double *surface_pressure, const double *surface_height,
+                                               const double *latitude, double *pressure_profile);
 void harp_profile_pressure_from_gph(long num_levels, const double *gph_profile, const double *temperature_profile,
                                     const double *molar_mass_air, double surface_pressure, double surface_height,
                                     double *pressure_profile);
+void harp_profile_pressure_from_gph_array(long num_profiles, long num_levels, const double *gph_profile,
+                                          const double *temperature_profile, const double *molar_mass_air,
+                                          const double *surface_pressure, const double *surface_height,
+                                          double *pressure_profile);
 
 double harp_profile_column_from_partial_column(long num_levels, const double *partial_column_profile);
+void harp_profile_column_from_partial_column_array(long num_profiles, long num_levels,
+                                                   const double *partial_column_profile, double *column);
+void harp_profile_tropopause_columns_from_partial_column_array(long num_profiles, long num_levels,
+                                                               const double *partial_column_profile,
+                                                               const double *altitude_bounds,
+                                                               const double *tropopause_altitude,
+                                                               double *tropospheric_column,
+                                                               double *stratospheric_column);
 double harp_profile_column_uncertainty_from_partial_column_uncertainty
     (long num_levels, const double *partial_column_uncertainty_profile);
 
-/* AVK conversions */
-void harp_profile_column_avk_from_partial_column_avk(long num_levels, const double *column_density_avk_2d,
+/* AVK conversions (for a batch of num_profiles AVKs) */
+void harp_profile_column_avk_from_partial_column_avk(long num_profiles, long num_levels,
+                                                     const double *column_density_avk_2d,
                                                      double *column_density_avk_1d);
-void harp_density_avk_from_partial_column_avk_and_altitude_bounds(long num_levels, const double *partial_column_avk,
+void harp_density_avk_from_partial_column_avk_and_altitude_bounds(long num_profiles, long num_levels,
+                                                                  const double *partial_column_avk,
                                                                   const double *altitude_bounds, double *density_avk);
-void harp_partial_column_avk_from_density_avk_and_altitude_bounds(long num_levels, const double *density_avk,
+void harp_partial_column_avk_from_density_avk_and_altitude_bounds(long num_profiles, long num_levels,
+                                                                  const double *density_avk,
                                                                   const double *altitude_bounds,
                                                                   double *partial_column_avk);
-void harp_number_density_avk_from_volume_mixing_ratio_avk(long num_levels, const double *volume_mixing_ratio_avk,
+void harp_number_density_avk_from_volume_mixing_ratio_avk(long num_profiles, long num_levels,
+                                                          const double *volume_mixing_ratio_avk,
                                                           const double *number_density_air, double *number_density_avk);
-void harp_volume_mixing_ratio_avk_from_number_density_avk(long num_levels, const double *number_density_avk,
+void harp_volume_mixing_ratio_avk_from_number_density_avk(long num_profiles, long num_levels,
+                                                          const double *number_density_avk,
                                                           const double *number_density_air,
                                                           double *volume_mixing_ratio_avk);
 
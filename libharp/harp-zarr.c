@@ -0,0 +1,2766 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+#include "harp-thread.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef WIN32
+#include <direct.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/* A product is stored as a Zarr (version 2) directory store. The root of the store is a group that holds the global
+ * attributes and that contains an array (a directory with one file per chunk) for each variable. Variable attributes
+ * are the same as for the netCDF format and the dimensions of each variable are stored in the _ARRAY_DIMENSIONS
+ * attribute (the convention used by xarray). String variables are stored as fixed length byte strings.
+ * Variables are only split into chunks along the time dimension (see harp_set_option_zarr_chunk_size()), and chunks
+ * are compressed using zlib at its fastest level (if zlib is available). Chunks are written and read using multiple
+ * tasks (see harp_set_option_num_threads()).
+ * All metadata is also stored as consolidated metadata in the .zmetadata file at the root of the store; this is the
+ * only metadata that is read on import.
+ */
+
+#ifdef WORDS_BIGENDIAN
+#define NATIVE_BYTE_ORDER '>'
+#else
+#define NATIVE_BYTE_ORDER '<'
+#endif
+
+#define ZLIB_COMPRESSION_LEVEL 1
+
+/* maximum nesting depth of JSON arrays and objects */
+#define JSON_MAX_DEPTH 64
+
+/* maximum length of a chunk key ("<index>" followed by ".0" for each additional dimension) */
+#define MAX_CHUNK_KEY_LENGTH (24 + 2 * HARP_MAX_NUM_DIMS)
+
+typedef enum json_type_enum
+{
+    json_null,
+    json_boolean,
+    json_number,
+    json_string,
+    json_array,
+    json_object
+} json_type;
+
+typedef struct json_value_struct
+{
+    json_type type;
+    double number;      /* value of a number (or 0/1 for a boolean) */
+    char *string;       /* value of a string */
+    long num_elements;  /* number of elements of an array or number of members of an object */
+    struct json_value_struct **element;
+    char **key; /* member names of an object */
+} json_value;
+
+typedef struct json_parser_struct
+{
+    const char *str;
+    long length;
+    long pos;
+} json_parser;
+
+typedef struct json_buffer_struct
+{
+    char *data;
+    long length;
+    long size;
+} json_buffer;
+
+/* Description of an array in a Zarr store */
+typedef struct zarr_array_struct
+{
+    const char *name;
+    harp_data_type data_type;
+    long item_size;     /* size in bytes of an element (the fixed string length for strings) */
+    int swap_bytes;     /* whether the byte order of the elements differs from the native byte order */
+    int compressed;     /* whether chunks are compressed using zlib */
+    double fill_value;  /* value of elements of chunks that are not present */
+    int num_dimensions;
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    long chunk_length;  /* length of the chunks along the first dimension (all other dimensions are not chunked) */
+    const json_value *attributes;
+} zarr_array;
+
+/* A consecutive range of chunks along the first dimension of an array that gets written or read by a single task.
+ * A block is the data of a single index of the first dimension (i.e. all elements of the trailing dimensions).
+ */
+typedef struct chunk_range_struct
+{
+    const char *directory;      /* directory of the array */
+    const zarr_array *array;    /* only used on import */
+    int num_dimensions;         /* number of dimensions used for the chunk keys */
+    uint8_t *data;      /* data of all blocks of the (selected range of the) variable */
+    long num_blocks;    /* number of blocks in data */
+    long block_offset;  /* index of the first block in data along the first dimension of the array */
+    long block_size;    /* size in bytes of a block */
+    long chunk_length;  /* number of blocks per chunk */
+    long first_chunk;
+    long num_chunks;
+    int compress;
+    int64_t num_bytes_read;
+} chunk_range;
+
+static void json_value_delete(json_value *value)
+{
+    long i;
+
+    if (value == NULL)
+    {
+        return;
+    }
+    if (value->string != NULL)
+    {
+        free(value->string);
+    }
+    if (value->element != NULL)
+    {
+        for (i = 0; i < value->num_elements; i++)
+        {
+            json_value_delete(value->element[i]);
+        }
+        free(value->element);
+    }
+    if (value->key != NULL)
+    {
+        for (i = 0; i < value->num_elements; i++)
+        {
+            free(value->key[i]);
+        }
+        free(value->key);
+    }
+    free(value);
+}
+
+static int json_value_new(json_type type, json_value **new_value)
+{
+    json_value *value;
+
+    value = (json_value *)malloc(sizeof(json_value));
+    if (value == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(json_value), __FILE__, __LINE__);
+        return -1;
+    }
+    value->type = type;
+    value->number = 0;
+    value->string = NULL;
+    value->num_elements = 0;
+    value->element = NULL;
+    value->key = NULL;
+
+    *new_value = value;
+
+    return 0;
+}
+
+/* Add an element to an array or a member to an object (key should be NULL for arrays).
+ * Ownership of key and element is always transferred (also if the function fails).
+ */
+static int json_value_add(json_value *value, char *key, json_value *element)
+{
+    if (value->num_elements % BLOCK_SIZE == 0)
+    {
+        json_value **new_element;
+
+        new_element = realloc(value->element, (value->num_elements + BLOCK_SIZE) * sizeof(json_value *));
+        if (new_element == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (value->num_elements + BLOCK_SIZE) * sizeof(json_value *), __FILE__, __LINE__);
+            free(key);
+            json_value_delete(element);
+            return -1;
+        }
+        value->element = new_element;
+        if (value->type == json_object)
+        {
+            char **new_key;
+
+            new_key = realloc(value->key, (value->num_elements + BLOCK_SIZE) * sizeof(char *));
+            if (new_key == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               (value->num_elements + BLOCK_SIZE) * sizeof(char *), __FILE__, __LINE__);
+                free(key);
+                json_value_delete(element);
+                return -1;
+            }
+            value->key = new_key;
+        }
+    }
+    if (value->type == json_object)
+    {
+        value->key[value->num_elements] = key;
+    }
+    value->element[value->num_elements] = element;
+    value->num_elements++;
+
+    return 0;
+}
+
+/* Returns the value of the member with the given name, or NULL if value is not an object or has no such member */
+static const json_value *json_object_get(const json_value *value, const char *key)
+{
+    long i;
+
+    if (value == NULL || value->type != json_object)
+    {
+        return NULL;
+    }
+    for (i = 0; i < value->num_elements; i++)
+    {
+        if (strcmp(value->key[i], key) == 0)
+        {
+            return value->element[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Returns the string value of the member with the given name, or NULL if there is no such string member */
+static const char *json_object_get_string(const json_value *value, const char *key)
+{
+    const json_value *member = json_object_get(value, key);
+
+    if (member == NULL || member->type != json_string)
+    {
+        return NULL;
+    }
+
+    return member->string;
+}
+
+static int json_parse_error(const json_parser *parser, const char *message)
+{
+    harp_set_error(HARP_ERROR_INVALID_FORMAT, "invalid JSON (%s at byte %ld)", message, parser->pos);
+    return -1;
+}
+
+static void json_skip_whitespace(json_parser *parser)
+{
+    while (parser->pos < parser->length && (parser->str[parser->pos] == ' ' || parser->str[parser->pos] == '\t' ||
+                                            parser->str[parser->pos] == '\n' || parser->str[parser->pos] == '\r'))
+    {
+        parser->pos++;
+    }
+}
+
+/* Returns 1 and skips the keyword if it is at the current position, and 0 otherwise */
+static int json_match_keyword(json_parser *parser, const char *keyword)
+{
+    long length = (long)strlen(keyword);
+
+    if (parser->length - parser->pos >= length && memcmp(&parser->str[parser->pos], keyword, length) == 0)
+    {
+        parser->pos += length;
+        return 1;
+    }
+
+    return 0;
+}
+
+static int json_parse_hex4(json_parser *parser, long *code)
+{
+    int i;
+
+    if (parser->length - parser->pos < 4)
+    {
+        return json_parse_error(parser, "invalid unicode escape");
+    }
+    *code = 0;
+    for (i = 0; i < 4; i++)
+    {
+        char c = parser->str[parser->pos + i];
+
+        *code *= 16;
+        if (c >= '0' && c <= '9')
+        {
+            *code += c - '0';
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            *code += c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            *code += c - 'A' + 10;
+        }
+        else
+        {
+            return json_parse_error(parser, "invalid unicode escape");
+        }
+    }
+    parser->pos += 4;
+
+    return 0;
+}
+
+/* Parse a string; the current position should be at the opening quote */
+static int json_parse_string(json_parser *parser, char **new_str)
+{
+    char *str;
+    long length = 0;
+
+    parser->pos++;
+    /* the decoded string is never longer than the encoded string */
+    str = malloc(parser->length - parser->pos + 1);
+    if (str == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       parser->length - parser->pos + 1, __FILE__, __LINE__);
+        return -1;
+    }
+
+    while (parser->pos < parser->length && parser->str[parser->pos] != '"')
+    {
+        char c = parser->str[parser->pos];
+
+        if ((unsigned char)c < 0x20)
+        {
+            free(str);
+            return json_parse_error(parser, "control character in string");
+        }
+        parser->pos++;
+        if (c != '\\')
+        {
+            str[length++] = c;
+            continue;
+        }
+        if (parser->pos >= parser->length)
+        {
+            break;
+        }
+        c = parser->str[parser->pos];
+        parser->pos++;
+        switch (c)
+        {
+            case '"':
+            case '\\':
+            case '/':
+                str[length++] = c;
+                break;
+            case 'b':
+                str[length++] = '\b';
+                break;
+            case 'f':
+                str[length++] = '\f';
+                break;
+            case 'n':
+                str[length++] = '\n';
+                break;
+            case 'r':
+                str[length++] = '\r';
+                break;
+            case 't':
+                str[length++] = '\t';
+                break;
+            case 'u':
+                {
+                    long code;
+
+                    if (json_parse_hex4(parser, &code) != 0)
+                    {
+                        free(str);
+                        return -1;
+                    }
+                    if (code >= 0xD800 && code < 0xDC00 && parser->length - parser->pos >= 6 &&
+                        parser->str[parser->pos] == '\\' && parser->str[parser->pos + 1] == 'u')
+                    {
+                        long low_code;
+
+                        /* surrogate pair */
+                        parser->pos += 2;
+                        if (json_parse_hex4(parser, &low_code) != 0)
+                        {
+                            free(str);
+                            return -1;
+                        }
+                        if (low_code < 0xDC00 || low_code >= 0xE000)
+                        {
+                            free(str);
+                            return json_parse_error(parser, "invalid unicode surrogate pair");
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low_code - 0xDC00);
+                    }
+                    /* store as UTF-8 */
+                    if (code < 0x80)
+                    {
+                        str[length++] = (char)code;
+                    }
+                    else if (code < 0x800)
+                    {
+                        str[length++] = (char)(0xC0 | (code >> 6));
+                        str[length++] = (char)(0x80 | (code & 0x3F));
+                    }
+                    else if (code < 0x10000)
+                    {
+                        str[length++] = (char)(0xE0 | (code >> 12));
+                        str[length++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                        str[length++] = (char)(0x80 | (code & 0x3F));
+                    }
+                    else
+                    {
+                        str[length++] = (char)(0xF0 | (code >> 18));
+                        str[length++] = (char)(0x80 | ((code >> 12) & 0x3F));
+                        str[length++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                        str[length++] = (char)(0x80 | (code & 0x3F));
+                    }
+                }
+                break;
+            default:
+                free(str);
+                return json_parse_error(parser, "invalid escape sequence in string");
+        }
+    }
+    if (parser->pos >= parser->length)
+    {
+        free(str);
+        return json_parse_error(parser, "unterminated string");
+    }
+    parser->pos++;
+    str[length] = '\0';
+
+    *new_str = str;
+
+    return 0;
+}
+
+static int json_parse_value(json_parser *parser, int depth, json_value **new_value);
+
+/* Parse the elements of an array or the members of an object; the current position should be at the opening bracket
+ * or brace */
+static int json_parse_elements(json_parser *parser, int depth, json_value *value)
+{
+    char end_char = value->type == json_object ? '}' : ']';
+
+    if (depth >= JSON_MAX_DEPTH)
+    {
+        return json_parse_error(parser, "maximum nesting depth exceeded");
+    }
+
+    parser->pos++;
+    json_skip_whitespace(parser);
+    if (parser->pos < parser->length && parser->str[parser->pos] == end_char)
+    {
+        parser->pos++;
+        return 0;
+    }
+
+    for (;;)
+    {
+        json_value *element;
+        char *key = NULL;
+
+        if (value->type == json_object)
+        {
+            if (parser->pos >= parser->length || parser->str[parser->pos] != '"')
+            {
+                return json_parse_error(parser, "expected member name");
+            }
+            if (json_parse_string(parser, &key) != 0)
+            {
+                return -1;
+            }
+            json_skip_whitespace(parser);
+            if (parser->pos >= parser->length || parser->str[parser->pos] != ':')
+            {
+                free(key);
+                return json_parse_error(parser, "expected ':'");
+            }
+            parser->pos++;
+        }
+        if (json_parse_value(parser, depth + 1, &element) != 0)
+        {
+            if (key != NULL)
+            {
+                free(key);
+            }
+            return -1;
+        }
+        if (json_value_add(value, key, element) != 0)
+        {
+            return -1;
+        }
+        json_skip_whitespace(parser);
+        if (parser->pos < parser->length && parser->str[parser->pos] == ',')
+        {
+            parser->pos++;
+            json_skip_whitespace(parser);
+            continue;
+        }
+        if (parser->pos < parser->length && parser->str[parser->pos] == end_char)
+        {
+            parser->pos++;
+            return 0;
+        }
+
+        return json_parse_error(parser, value->type == json_object ? "expected ',' or '}'" : "expected ',' or ']'");
+    }
+}
+
+/* Parse a value. Besides standard JSON, the NaN, Infinity, and -Infinity values (as produced by the Python json module
+ * and used by Zarr for fill values) are accepted as numbers.
+ */
+static int json_parse_value(json_parser *parser, int depth, json_value **new_value)
+{
+    json_value *value;
+    char c;
+
+    json_skip_whitespace(parser);
+    if (parser->pos >= parser->length)
+    {
+        return json_parse_error(parser, "unexpected end of input");
+    }
+
+    c = parser->str[parser->pos];
+    if (c == '{' || c == '[')
+    {
+        if (json_value_new(c == '{' ? json_object : json_array, &value) != 0)
+        {
+            return -1;
+        }
+        if (json_parse_elements(parser, depth, value) != 0)
+        {
+            json_value_delete(value);
+            return -1;
+        }
+    }
+    else if (c == '"')
+    {
+        if (json_value_new(json_string, &value) != 0)
+        {
+            return -1;
+        }
+        if (json_parse_string(parser, &value->string) != 0)
+        {
+            json_value_delete(value);
+            return -1;
+        }
+    }
+    else if (json_match_keyword(parser, "null"))
+    {
+        if (json_value_new(json_null, &value) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (json_match_keyword(parser, "true") || json_match_keyword(parser, "false"))
+    {
+        if (json_value_new(json_boolean, &value) != 0)
+        {
+            return -1;
+        }
+        value->number = parser->str[parser->pos - 1] == 'e' && parser->str[parser->pos - 2] == 'u';
+    }
+    else
+    {
+        double number;
+
+        if (json_match_keyword(parser, "NaN"))
+        {
+            number = harp_nan();
+        }
+        else if (json_match_keyword(parser, "Infinity"))
+        {
+            number = harp_plusinf();
+        }
+        else if (json_match_keyword(parser, "-Infinity"))
+        {
+            number = harp_mininf();
+        }
+        else
+        {
+            long length;
+
+            if (c != '-' && (c < '0' || c > '9'))
+            {
+                return json_parse_error(parser, "unexpected character");
+            }
+            length = harp_parse_double(&parser->str[parser->pos], parser->length - parser->pos, &number, 1);
+            if (length <= 0)
+            {
+                return json_parse_error(parser, "invalid number");
+            }
+            parser->pos += length;
+        }
+        if (json_value_new(json_number, &value) != 0)
+        {
+            return -1;
+        }
+        value->number = number;
+    }
+
+    *new_value = value;
+
+    return 0;
+}
+
+static int json_parse(const char *str, long length, json_value **value)
+{
+    json_parser parser;
+
+    parser.str = str;
+    parser.length = length;
+    parser.pos = 0;
+
+    if (json_parse_value(&parser, 0, value) != 0)
+    {
+        return -1;
+    }
+    json_skip_whitespace(&parser);
+    if (parser.pos != parser.length)
+    {
+        json_value_delete(*value);
+        return json_parse_error(&parser, "trailing characters");
+    }
+
+    return 0;
+}
+
+static void json_buffer_init(json_buffer *buffer)
+{
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->size = 0;
+}
+
+static void json_buffer_done(json_buffer *buffer)
+{
+    if (buffer->data != NULL)
+    {
+        free(buffer->data);
+    }
+    json_buffer_init(buffer);
+}
+
+static int json_buffer_append(json_buffer *buffer, const char *str, long length)
+{
+    if (buffer->length + length + 1 > buffer->size)
+    {
+        long new_size = buffer->size > 0 ? buffer->size : 1024;
+        char *new_data;
+
+        while (new_size < buffer->length + length + 1)
+        {
+            new_size *= 2;
+        }
+        new_data = realloc(buffer->data, new_size);
+        if (new_data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (unsigned long)new_size, __FILE__, __LINE__);
+            return -1;
+        }
+        buffer->data = new_data;
+        buffer->size = new_size;
+    }
+    memcpy(&buffer->data[buffer->length], str, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+
+    return 0;
+}
+
+static int json_buffer_append_text(json_buffer *buffer, const char *str)
+{
+    return json_buffer_append(buffer, str, (long)strlen(str));
+}
+
+/* Append a quoted and escaped JSON string */
+static int json_buffer_append_string(json_buffer *buffer, const char *str)
+{
+    const char *start = str;
+
+    if (json_buffer_append(buffer, "\"", 1) != 0)
+    {
+        return -1;
+    }
+    while (*str != '\0')
+    {
+        unsigned char c = (unsigned char)*str;
+
+        if (c == '"' || c == '\\' || c < 0x20)
+        {
+            char escape[8];
+
+            if (json_buffer_append(buffer, start, (long)(str - start)) != 0)
+            {
+                return -1;
+            }
+            switch (c)
+            {
+                case '"':
+                    strcpy(escape, "\\\"");
+                    break;
+                case '\\':
+                    strcpy(escape, "\\\\");
+                    break;
+                case '\n':
+                    strcpy(escape, "\\n");
+                    break;
+                case '\r':
+                    strcpy(escape, "\\r");
+                    break;
+                case '\t':
+                    strcpy(escape, "\\t");
+                    break;
+                default:
+                    sprintf(escape, "\\u%04x", (unsigned int)c);
+                    break;
+            }
+            if (json_buffer_append_text(buffer, escape) != 0)
+            {
+                return -1;
+            }
+            start = str + 1;
+        }
+        str++;
+    }
+    if (json_buffer_append(buffer, start, (long)(str - start)) != 0)
+    {
+        return -1;
+    }
+
+    return json_buffer_append(buffer, "\"", 1);
+}
+
+static int json_buffer_append_long(json_buffer *buffer, long value)
+{
+    char str[32];
+
+    sprintf(str, "%ld", value);
+
+    return json_buffer_append_text(buffer, str);
+}
+
+static int json_buffer_append_double(json_buffer *buffer, double value)
+{
+    char str[32];
+
+    if (harp_isnan(value))
+    {
+        strcpy(str, "NaN");
+    }
+    else if (harp_isplusinf(value))
+    {
+        strcpy(str, "Infinity");
+    }
+    else if (harp_ismininf(value))
+    {
+        strcpy(str, "-Infinity");
+    }
+    else
+    {
+        sprintf(str, "%.17g", value);
+    }
+
+    return json_buffer_append_text(buffer, str);
+}
+
+/* Append the name of an object member (preceded by a separator if it is not the first member) */
+static int json_buffer_append_key(json_buffer *buffer, const char *key)
+{
+    if (buffer->length > 0 && buffer->data[buffer->length - 1] != '{')
+    {
+        if (json_buffer_append_text(buffer, ", ") != 0)
+        {
+            return -1;
+        }
+    }
+    if (json_buffer_append_string(buffer, key) != 0)
+    {
+        return -1;
+    }
+
+    return json_buffer_append_text(buffer, ": ");
+}
+
+static int json_buffer_append_scalar(json_buffer *buffer, harp_data_type data_type, harp_scalar value)
+{
+    switch (data_type)
+    {
+        case harp_type_int8:
+            return json_buffer_append_long(buffer, value.int8_data);
+        case harp_type_int16:
+            return json_buffer_append_long(buffer, value.int16_data);
+        case harp_type_int32:
+            return json_buffer_append_long(buffer, value.int32_data);
+        case harp_type_float:
+            return json_buffer_append_double(buffer, value.float_data);
+        case harp_type_double:
+            return json_buffer_append_double(buffer, value.double_data);
+        default:
+            assert(0);
+            exit(1);
+    }
+}
+
+/* Returns path/name/filename (or path/filename if name is NULL); the result should be freed by the caller */
+static char *get_path(const char *path, const char *name, const char *filename)
+{
+    char *result;
+    size_t length;
+
+    length = strlen(path) + 1 + (name != NULL ? strlen(name) + 1 : 0) + strlen(filename) + 1;
+    result = malloc(length);
+    if (result == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)length, __FILE__, __LINE__);
+        return NULL;
+    }
+    if (name != NULL)
+    {
+        sprintf(result, "%s/%s/%s", path, name, filename);
+    }
+    else
+    {
+        sprintf(result, "%s/%s", path, filename);
+    }
+
+    return result;
+}
+
+static void get_chunk_key(long index, int num_dimensions, char *key)
+{
+    int i;
+
+    key += sprintf(key, "%ld", index);
+    for (i = 1; i < num_dimensions; i++)
+    {
+        strcpy(key, ".0");
+        key += 2;
+    }
+}
+
+static int make_directory(const char *path)
+{
+#ifdef WIN32
+    if (_mkdir(path) != 0)
+#else
+    if (mkdir(path, 0777) != 0)
+#endif
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create directory %s (%s)", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int write_file(const char *path, const void *data, long size)
+{
+    FILE *f;
+
+    f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create %s (%s)", path, strerror(errno));
+        return -1;
+    }
+    if (size > 0 && fwrite(data, 1, size, f) != (size_t)size)
+    {
+        harp_set_error(HARP_ERROR_FILE_WRITE, "could not write to %s (%s)", path, strerror(errno));
+        fclose(f);
+        return -1;
+    }
+    if (fclose(f) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "could not close %s (%s)", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Read the full content of a file. If the file does not exist and found is not NULL, *found is set to 0 (and *data
+ * to NULL) instead of failing. The buffer is zero terminated and should be freed by the caller.
+ */
+static int read_file(const char *path, char **data, long *size, int *found)
+{
+    struct stat statbuf;
+    char *buffer;
+    FILE *f;
+
+    if (stat(path, &statbuf) != 0)
+    {
+        if (errno == ENOENT)
+        {
+            if (found != NULL)
+            {
+                *found = 0;
+                *data = NULL;
+                *size = 0;
+                return 0;
+            }
+            harp_set_error(HARP_ERROR_FILE_NOT_FOUND, "could not find %s", path);
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "could not open %s (%s)", path, strerror(errno));
+        }
+        return -1;
+    }
+
+    buffer = malloc((size_t)statbuf.st_size + 1);
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)statbuf.st_size + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not open %s (%s)", path, strerror(errno));
+        free(buffer);
+        return -1;
+    }
+    if (statbuf.st_size > 0 && fread(buffer, 1, (size_t)statbuf.st_size, f) != (size_t)statbuf.st_size)
+    {
+        harp_set_error(HARP_ERROR_FILE_READ, "could not read %s (%s)", path, strerror(errno));
+        fclose(f);
+        free(buffer);
+        return -1;
+    }
+    fclose(f);
+    buffer[statbuf.st_size] = '\0';
+
+    if (found != NULL)
+    {
+        *found = 1;
+    }
+    *data = buffer;
+    *size = (long)statbuf.st_size;
+
+    return 0;
+}
+
+static int write_chunk_range(void *arg)
+{
+    chunk_range *range = (chunk_range *)arg;
+    long chunk_data_size = range->chunk_length * range->block_size;
+    uint8_t *chunk_data;
+    uint8_t *buffer = NULL;
+    char *path;
+    long i;
+
+    path = malloc(strlen(range->directory) + 1 + MAX_CHUNK_KEY_LENGTH + 1);
+    if (path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(range->directory) + 1 + MAX_CHUNK_KEY_LENGTH + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    chunk_data = malloc(chunk_data_size);
+    if (chunk_data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)chunk_data_size, __FILE__, __LINE__);
+        free(path);
+        return -1;
+    }
+#ifdef HAVE_ZLIB
+    if (range->compress)
+    {
+        buffer = malloc(compressBound(chunk_data_size));
+        if (buffer == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (unsigned long)compressBound(chunk_data_size), __FILE__, __LINE__);
+            free(chunk_data);
+            free(path);
+            return -1;
+        }
+    }
+#endif
+
+    for (i = range->first_chunk; i < range->first_chunk + range->num_chunks; i++)
+    {
+        long num_blocks = range->chunk_length;
+        const uint8_t *data = chunk_data;
+        long size = chunk_data_size;
+        int length;
+
+        /* chunks always have the full chunk size; the edge chunk is padded with zeros */
+        if ((i + 1) * range->chunk_length > range->num_blocks)
+        {
+            num_blocks = range->num_blocks - i * range->chunk_length;
+        }
+        memcpy(chunk_data, &range->data[i * range->chunk_length * range->block_size], num_blocks * range->block_size);
+        if (num_blocks < range->chunk_length)
+        {
+            memset(&chunk_data[num_blocks * range->block_size], 0,
+                   (range->chunk_length - num_blocks) * range->block_size);
+        }
+
+#ifdef HAVE_ZLIB
+        if (range->compress)
+        {
+            uLongf buffer_size = compressBound(chunk_data_size);
+            int result;
+
+            result = compress2(buffer, &buffer_size, chunk_data, chunk_data_size, ZLIB_COMPRESSION_LEVEL);
+            if (result != Z_OK)
+            {
+                harp_set_error(HARP_ERROR_EXPORT, "could not compress chunk (zlib error %d)", result);
+                free(buffer);
+                free(chunk_data);
+                free(path);
+                return -1;
+            }
+            data = buffer;
+            size = (long)buffer_size;
+        }
+#endif
+
+        length = sprintf(path, "%s/", range->directory);
+        get_chunk_key(i, range->num_dimensions, &path[length]);
+        if (write_file(path, data, size) != 0)
+        {
+            if (buffer != NULL)
+            {
+                free(buffer);
+            }
+            free(chunk_data);
+            free(path);
+            return -1;
+        }
+    }
+
+    if (buffer != NULL)
+    {
+        free(buffer);
+    }
+    free(chunk_data);
+    free(path);
+
+    return 0;
+}
+
+/* Split the chunks of a range over multiple tasks and run them */
+static int run_chunk_ranges(chunk_range *range, int (*function) (void *))
+{
+    chunk_range *task_range;
+    harp_task *task;
+    long first_chunk = range->first_chunk;
+    int num_tasks;
+    int result;
+    int i;
+
+    num_tasks = harp_get_num_tasks(range->num_chunks, 1);
+    if (num_tasks <= 1)
+    {
+        return function(range);
+    }
+
+    task_range = malloc(num_tasks * sizeof(chunk_range));
+    if (task_range == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(chunk_range), __FILE__, __LINE__);
+        return -1;
+    }
+    task = malloc(num_tasks * sizeof(harp_task));
+    if (task == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(harp_task), __FILE__, __LINE__);
+        free(task_range);
+        return -1;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        long next_chunk = range->first_chunk + (range->num_chunks * (i + 1)) / num_tasks;
+
+        task_range[i] = *range;
+        task_range[i].first_chunk = first_chunk;
+        task_range[i].num_chunks = next_chunk - first_chunk;
+        task_range[i].num_bytes_read = 0;
+        task[i].function = function;
+        task[i].arg = &task_range[i];
+        first_chunk = next_chunk;
+    }
+
+    result = harp_run_tasks(num_tasks, task);
+
+    for (i = 0; i < num_tasks; i++)
+    {
+        range->num_bytes_read += task_range[i].num_bytes_read;
+    }
+    free(task);
+    free(task_range);
+
+    return result;
+}
+
+static long get_string_length(const harp_variable *variable)
+{
+    long length;
+
+    /* Zarr does not support zero length strings, so ensure a minimum length of 1 */
+    length = harp_get_max_string_length(variable->num_elements, variable->data.string_data);
+    if (length == 0)
+    {
+        length = 1;
+    }
+
+    return length;
+}
+
+static long get_chunk_length(const harp_variable *variable)
+{
+    long chunk_size = harp_get_option_zarr_chunk_size();
+
+    if (variable->num_dimensions == 0)
+    {
+        return 1;
+    }
+    if (variable->dimension_type[0] == harp_dimension_time && chunk_size > 0 && chunk_size < variable->dimension[0])
+    {
+        return chunk_size;
+    }
+
+    return variable->dimension[0] > 0 ? variable->dimension[0] : 1;
+}
+
+static int write_array_metadata(json_buffer *buffer, const harp_variable *variable, long string_length,
+                                long chunk_length)
+{
+    char dtype[32];
+    int i;
+
+    if (variable->data_type == harp_type_string)
+    {
+        sprintf(dtype, "|S%ld", string_length);
+    }
+    else if (variable->data_type == harp_type_int8)
+    {
+        strcpy(dtype, "|i1");
+    }
+    else
+    {
+        sprintf(dtype, "%c%c%ld", NATIVE_BYTE_ORDER,
+                (variable->data_type == harp_type_float || variable->data_type == harp_type_double) ? 'f' : 'i',
+                harp_get_size_for_type(variable->data_type));
+    }
+
+    if (json_buffer_append_text(buffer, "{") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "chunks") != 0 || json_buffer_append_text(buffer, "[") != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        long length = i == 0 ? chunk_length : (variable->dimension[i] > 0 ? variable->dimension[i] : 1);
+
+        if ((i > 0 && json_buffer_append_text(buffer, ", ") != 0) || json_buffer_append_long(buffer, length) != 0)
+        {
+            return -1;
+        }
+    }
+    if (json_buffer_append_text(buffer, "]") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "compressor") != 0)
+    {
+        return -1;
+    }
+#ifdef HAVE_ZLIB
+    if (json_buffer_append_text(buffer, "{\"id\": \"zlib\", \"level\": ") != 0 ||
+        json_buffer_append_long(buffer, ZLIB_COMPRESSION_LEVEL) != 0 || json_buffer_append_text(buffer, "}") != 0)
+    {
+        return -1;
+    }
+#else
+    if (json_buffer_append_text(buffer, "null") != 0)
+    {
+        return -1;
+    }
+#endif
+    if (json_buffer_append_key(buffer, "dtype") != 0 || json_buffer_append_string(buffer, dtype) != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "fill_value") != 0 || json_buffer_append_text(buffer, "null") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "filters") != 0 || json_buffer_append_text(buffer, "null") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "order") != 0 || json_buffer_append_string(buffer, "C") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "shape") != 0 || json_buffer_append_text(buffer, "[") != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        if ((i > 0 && json_buffer_append_text(buffer, ", ") != 0) ||
+            json_buffer_append_long(buffer, variable->dimension[i]) != 0)
+        {
+            return -1;
+        }
+    }
+    if (json_buffer_append_text(buffer, "]") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "zarr_format") != 0 || json_buffer_append_long(buffer, 2) != 0)
+    {
+        return -1;
+    }
+
+    return json_buffer_append_text(buffer, "}");
+}
+
+static int write_array_attributes(json_buffer *buffer, const harp_variable *variable)
+{
+    int i;
+
+    if (json_buffer_append_text(buffer, "{") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "_ARRAY_DIMENSIONS") != 0 || json_buffer_append_text(buffer, "[") != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        char name[32];
+
+        if (variable->dimension_type[i] == harp_dimension_independent)
+        {
+            sprintf(name, "independent_%ld", variable->dimension[i]);
+        }
+        else
+        {
+            strcpy(name, harp_get_dimension_type_name(variable->dimension_type[i]));
+        }
+        if ((i > 0 && json_buffer_append_text(buffer, ", ") != 0) || json_buffer_append_string(buffer, name) != 0)
+        {
+            return -1;
+        }
+    }
+    if (json_buffer_append_text(buffer, "]") != 0)
+    {
+        return -1;
+    }
+
+    if (variable->description != NULL && strcmp(variable->description, "") != 0)
+    {
+        if (json_buffer_append_key(buffer, "description") != 0 ||
+            json_buffer_append_string(buffer, variable->description) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (variable->unit != NULL)
+    {
+        if (json_buffer_append_key(buffer, "units") != 0 || json_buffer_append_string(buffer, variable->unit) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (variable->data_type != harp_type_string)
+    {
+        if (!harp_is_valid_min_for_type(variable->data_type, variable->valid_min))
+        {
+            if (json_buffer_append_key(buffer, "valid_min") != 0 ||
+                json_buffer_append_scalar(buffer, variable->data_type, variable->valid_min) != 0)
+            {
+                return -1;
+            }
+        }
+
+        if (!harp_is_valid_max_for_type(variable->data_type, variable->valid_max))
+        {
+            if (json_buffer_append_key(buffer, "valid_max") != 0 ||
+                json_buffer_append_scalar(buffer, variable->data_type, variable->valid_max) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    if (variable->num_enum_values > 0 && variable->data_type == harp_type_int8)
+    {
+        char *flag_meanings;
+
+        if (json_buffer_append_key(buffer, "flag_values") != 0 || json_buffer_append_text(buffer, "[") != 0)
+        {
+            return -1;
+        }
+        for (i = 0; i < variable->num_enum_values; i++)
+        {
+            if ((i > 0 && json_buffer_append_text(buffer, ", ") != 0) || json_buffer_append_long(buffer, i) != 0)
+            {
+                return -1;
+            }
+        }
+        if (json_buffer_append_text(buffer, "]") != 0)
+        {
+            return -1;
+        }
+
+        if (harp_variable_get_flag_meanings_string(variable, &flag_meanings) != 0)
+        {
+            return -1;
+        }
+        if (json_buffer_append_key(buffer, "flag_meanings") != 0 ||
+            json_buffer_append_string(buffer, flag_meanings) != 0)
+        {
+            free(flag_meanings);
+            return -1;
+        }
+        free(flag_meanings);
+    }
+
+    return json_buffer_append_text(buffer, "}");
+}
+
+static const char *spatial_extent_attribute_name[4] = {
+    "geospatial_lat_min", "geospatial_lat_max", "geospatial_lon_min", "geospatial_lon_max"
+};
+
+static int write_group_attributes(json_buffer *buffer, const harp_product *product)
+{
+    double datetime_start;
+    double datetime_stop;
+    double spatial_extent[4];
+    int i;
+
+    if (json_buffer_append_text(buffer, "{") != 0)
+    {
+        return -1;
+    }
+    if (json_buffer_append_key(buffer, "Conventions") != 0 || json_buffer_append_string(buffer, HARP_CONVENTION) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_get_datetime_range(product, &datetime_start, &datetime_stop) == 0)
+    {
+        if (json_buffer_append_key(buffer, "datetime_start") != 0 ||
+            json_buffer_append_double(buffer, datetime_start) != 0)
+        {
+            return -1;
+        }
+        if (json_buffer_append_key(buffer, "datetime_stop") != 0 ||
+            json_buffer_append_double(buffer, datetime_stop) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (harp_product_get_spatial_extent(product, &spatial_extent[0], &spatial_extent[1], &spatial_extent[2],
+                                        &spatial_extent[3]) == 0)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            if (json_buffer_append_key(buffer, spatial_extent_attribute_name[i]) != 0 ||
+                json_buffer_append_double(buffer, spatial_extent[i]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    if (product->source_product != NULL && strcmp(product->source_product, "") != 0)
+    {
+        if (json_buffer_append_key(buffer, "source_product") != 0 ||
+            json_buffer_append_string(buffer, product->source_product) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (product->history != NULL && strcmp(product->history, "") != 0)
+    {
+        if (json_buffer_append_key(buffer, "history") != 0 || json_buffer_append_string(buffer, product->history) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return json_buffer_append_text(buffer, "}");
+}
+
+/* Write a metadata document to its own file and add it to the consolidated metadata */
+static int write_metadata(const char *store, const char *name, const char *filename, const json_buffer *document,
+                          json_buffer *consolidated)
+{
+    char *path;
+    char *key;
+
+    path = get_path(store, name, filename);
+    if (path == NULL)
+    {
+        return -1;
+    }
+    if (write_file(path, document->data, document->length) != 0)
+    {
+        free(path);
+        return -1;
+    }
+    free(path);
+
+    /* the key of the document in the consolidated metadata is its path relative to the root of the store */
+    key = malloc((name != NULL ? strlen(name) + 1 : 0) + strlen(filename) + 1);
+    if (key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (name != NULL ? strlen(name) + 1 : 0) + strlen(filename) + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    if (name != NULL)
+    {
+        sprintf(key, "%s/%s", name, filename);
+    }
+    else
+    {
+        strcpy(key, filename);
+    }
+    if (json_buffer_append_key(consolidated, key) != 0)
+    {
+        free(key);
+        return -1;
+    }
+    free(key);
+
+    return json_buffer_append(consolidated, document->data, document->length);
+}
+
+static int write_variable(const char *store, const harp_variable *variable, json_buffer *consolidated)
+{
+    json_buffer document;
+    chunk_range range;
+    char *directory;
+    char *char_data = NULL;
+    long string_length = 0;
+    long chunk_length;
+    int i;
+
+    if (variable->data_type == harp_type_string)
+    {
+        string_length = get_string_length(variable);
+    }
+    chunk_length = get_chunk_length(variable);
+
+    directory = get_path(store, NULL, variable->name);
+    if (directory == NULL)
+    {
+        return -1;
+    }
+    if (make_directory(directory) != 0)
+    {
+        free(directory);
+        return -1;
+    }
+
+    json_buffer_init(&document);
+    if (write_array_metadata(&document, variable, string_length, chunk_length) != 0)
+    {
+        json_buffer_done(&document);
+        free(directory);
+        return -1;
+    }
+    if (write_metadata(store, variable->name, ".zarray", &document, consolidated) != 0)
+    {
+        json_buffer_done(&document);
+        free(directory);
+        return -1;
+    }
+    document.length = 0;
+    if (write_array_attributes(&document, variable) != 0)
+    {
+        json_buffer_done(&document);
+        free(directory);
+        return -1;
+    }
+    if (write_metadata(store, variable->name, ".zattrs", &document, consolidated) != 0)
+    {
+        json_buffer_done(&document);
+        free(directory);
+        return -1;
+    }
+    json_buffer_done(&document);
+
+    if (variable->num_elements == 0)
+    {
+        /* chunks that are not present are empty */
+        free(directory);
+        return 0;
+    }
+
+    range.directory = directory;
+    range.array = NULL;
+    range.num_dimensions = variable->num_dimensions > 0 ? variable->num_dimensions : 1;
+    range.num_blocks = variable->num_dimensions > 0 ? variable->dimension[0] : 1;
+    range.block_offset = 0;
+    range.block_size = variable->data_type == harp_type_string ? string_length :
+        harp_get_size_for_type(variable->data_type);
+    for (i = 1; i < variable->num_dimensions; i++)
+    {
+        range.block_size *= variable->dimension[i];
+    }
+    range.chunk_length = chunk_length;
+    range.first_chunk = 0;
+    range.num_chunks = (range.num_blocks + chunk_length - 1) / chunk_length;
+#ifdef HAVE_ZLIB
+    range.compress = 1;
+#else
+    range.compress = 0;
+#endif
+    range.num_bytes_read = 0;
+
+    if (variable->data_type == harp_type_string)
+    {
+        if (harp_get_char_array_from_string_array(variable->num_elements, variable->data.string_data, string_length,
+                                                  NULL, &char_data) != 0)
+        {
+            free(directory);
+            return -1;
+        }
+        range.data = (uint8_t *)char_data;
+    }
+    else
+    {
+        range.data = (uint8_t *)variable->data.ptr;
+    }
+
+    if (run_chunk_ranges(&range, write_chunk_range) != 0)
+    {
+        if (char_data != NULL)
+        {
+            free(char_data);
+        }
+        free(directory);
+        return -1;
+    }
+
+    if (char_data != NULL)
+    {
+        free(char_data);
+    }
+    free(directory);
+
+    return 0;
+}
+
+int harp_export_zarr(const char *filename, const harp_product *product)
+{
+    json_buffer consolidated;
+    json_buffer document;
+    int i;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL");
+        return -1;
+    }
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL");
+        return -1;
+    }
+
+    /* an existing store is never overwritten, since that would require removing a full directory tree */
+    if (make_directory(filename) != 0)
+    {
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_zarr);
+
+    json_buffer_init(&consolidated);
+    json_buffer_init(&document);
+
+    if (json_buffer_append_text(&consolidated, "{\"metadata\": {") != 0 ||
+        json_buffer_append_text(&document, "{\"zarr_format\": 2}") != 0 ||
+        write_metadata(filename, NULL, ".zgroup", &document, &consolidated) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        json_buffer_done(&document);
+        json_buffer_done(&consolidated);
+        harp_io_statistics_add_close(harp_io_backend_zarr);
+        return -1;
+    }
+    document.length = 0;
+    if (write_group_attributes(&document, product) != 0 ||
+        write_metadata(filename, NULL, ".zattrs", &document, &consolidated) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        json_buffer_done(&document);
+        json_buffer_done(&consolidated);
+        harp_io_statistics_add_close(harp_io_backend_zarr);
+        return -1;
+    }
+    json_buffer_done(&document);
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        harp_trace_begin("export(%s)", product->variable[i]->name);
+        if (write_variable(filename, product->variable[i], &consolidated) != 0)
+        {
+            harp_trace_end();
+            harp_add_error_message(" (%s)", filename);
+            json_buffer_done(&consolidated);
+            harp_io_statistics_add_close(harp_io_backend_zarr);
+            return -1;
+        }
+        harp_trace_end();
+    }
+
+    /* the consolidated metadata is written last, such that a store is only recognized as complete once all data has
+     * been written */
+    if (json_buffer_append_text(&consolidated, "}, \"zarr_consolidated_format\": 1}") != 0)
+    {
+        json_buffer_done(&consolidated);
+        harp_io_statistics_add_close(harp_io_backend_zarr);
+        return -1;
+    }
+    {
+        char *path = get_path(filename, NULL, ".zmetadata");
+
+        if (path == NULL || write_file(path, consolidated.data, consolidated.length) != 0)
+        {
+            if (path != NULL)
+            {
+                free(path);
+            }
+            harp_add_error_message(" (%s)", filename);
+            json_buffer_done(&consolidated);
+            harp_io_statistics_add_close(harp_io_backend_zarr);
+            return -1;
+        }
+        free(path);
+    }
+    json_buffer_done(&consolidated);
+    harp_io_statistics_add_close(harp_io_backend_zarr);
+
+    return 0;
+}
+
+/* Read the consolidated metadata of a store; returns the 'metadata' member in 'metadata' */
+static int read_consolidated_metadata(const char *filename, json_value **root, const json_value **metadata)
+{
+    char *path;
+    char *data;
+    long size;
+
+    path = get_path(filename, NULL, ".zmetadata");
+    if (path == NULL)
+    {
+        return -1;
+    }
+    if (read_file(path, &data, &size, NULL) != 0)
+    {
+        free(path);
+        if (harp_errno == HARP_ERROR_FILE_NOT_FOUND)
+        {
+            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, "not a HARP product (Zarr store without consolidated "
+                           "metadata)");
+        }
+        return -1;
+    }
+    free(path);
+
+    if (json_parse(data, size, root) != 0)
+    {
+        harp_add_error_message(" (.zmetadata)");
+        free(data);
+        return -1;
+    }
+    free(data);
+
+    *metadata = json_object_get(*root, "metadata");
+    if (*metadata == NULL || (*metadata)->type != json_object)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "invalid consolidated metadata (missing 'metadata' object)");
+        json_value_delete(*root);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int verify_product(const json_value *metadata)
+{
+    const char *convention_str;
+    int major, minor;
+
+    convention_str = json_object_get_string(json_object_get(metadata, ".zattrs"), "Conventions");
+    if (convention_str != NULL && harp_parse_file_convention(convention_str, &major, &minor) == 0)
+    {
+        if (major > HARP_FORMAT_VERSION_MAJOR ||
+            (major == HARP_FORMAT_VERSION_MAJOR && minor > HARP_FORMAT_VERSION_MINOR))
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "unsupported HARP format version %d.%d", major, minor);
+            return -1;
+        }
+        return 0;
+    }
+
+    harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, "not a HARP product");
+
+    return -1;
+}
+
+static int get_long_array(const json_value *value, int max_num_elements, long *element)
+{
+    long i;
+
+    if (value == NULL || value->type != json_array || value->num_elements > max_num_elements)
+    {
+        return -1;
+    }
+    for (i = 0; i < value->num_elements; i++)
+    {
+        if (value->element[i]->type != json_number || value->element[i]->number < 0)
+        {
+            return -1;
+        }
+        element[i] = (long)value->element[i]->number;
+    }
+
+    return (int)value->num_elements;
+}
+
+static int parse_dtype(const char *dtype, zarr_array *array)
+{
+    char byte_order;
+    char kind;
+    long size;
+    int num_consumed;
+
+    if (dtype == NULL || sscanf(dtype, "%c%c%ld%n", &byte_order, &kind, &size, &num_consumed) != 3 ||
+        (size_t)num_consumed != strlen(dtype) || (byte_order != '<' && byte_order != '>' && byte_order != '|'))
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "invalid dtype '%s'", dtype != NULL ? dtype : "");
+        return -1;
+    }
+
+    if (kind == 'S' && size > 0)
+    {
+        array->data_type = harp_type_string;
+    }
+    else if (kind == 'i' && size == 1)
+    {
+        array->data_type = harp_type_int8;
+    }
+    else if (kind == 'i' && size == 2)
+    {
+        array->data_type = harp_type_int16;
+    }
+    else if (kind == 'i' && size == 4)
+    {
+        array->data_type = harp_type_int32;
+    }
+    else if (kind == 'f' && size == 4)
+    {
+        array->data_type = harp_type_float;
+    }
+    else if (kind == 'f' && size == 8)
+    {
+        array->data_type = harp_type_double;
+    }
+    else
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "unsupported dtype '%s'", dtype);
+        return -1;
+    }
+    array->item_size = size;
+    array->swap_bytes = array->data_type != harp_type_string && size > 1 && byte_order != '|' &&
+        byte_order != NATIVE_BYTE_ORDER;
+
+    return 0;
+}
+
+/* Retrieve the description of an array from its .zarray and .zattrs metadata */
+static int parse_array(const char *name, const json_value *zarray, const json_value *zattrs, zarr_array *array)
+{
+    const json_value *value;
+    long chunks[HARP_MAX_NUM_DIMS];
+    const char *order;
+    int num_chunk_dims;
+    int i;
+
+    array->name = name;
+    array->attributes = zattrs;
+
+    value = json_object_get(zarray, "zarr_format");
+    if (value == NULL || value->type != json_number || value->number != 2)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "unsupported Zarr format for array '%s'", name);
+        return -1;
+    }
+    order = json_object_get_string(zarray, "order");
+    if (order != NULL && strcmp(order, "C") != 0)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "unsupported order '%s' for array '%s'", order, name);
+        return -1;
+    }
+    value = json_object_get(zarray, "filters");
+    if (value != NULL && value->type != json_null && !(value->type == json_array && value->num_elements == 0))
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "unsupported filters for array '%s'", name);
+        return -1;
+    }
+    value = json_object_get(zarray, "compressor");
+    if (value == NULL || value->type == json_null)
+    {
+        array->compressed = 0;
+    }
+    else
+    {
+        const char *id = json_object_get_string(value, "id");
+
+        if (id == NULL || strcmp(id, "zlib") != 0)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "unsupported compressor '%s' for array '%s'", id != NULL ? id : "",
+                           name);
+            return -1;
+        }
+#ifndef HAVE_ZLIB
+        harp_set_error(HARP_ERROR_IMPORT, "zlib compressed array '%s' can not be read (HARP was built without zlib)",
+                       name);
+        return -1;
+#endif
+        array->compressed = 1;
+    }
+    if (parse_dtype(json_object_get_string(zarray, "dtype"), array) != 0)
+    {
+        harp_add_error_message(" (array '%s')", name);
+        return -1;
+    }
+    value = json_object_get(zarray, "fill_value");
+    array->fill_value = (value != NULL && value->type == json_number) ? value->number : 0;
+
+    array->num_dimensions = get_long_array(json_object_get(zarray, "shape"), HARP_MAX_NUM_DIMS, array->dimension);
+    if (array->num_dimensions < 0)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "invalid shape for array '%s'", name);
+        return -1;
+    }
+    num_chunk_dims = get_long_array(json_object_get(zarray, "chunks"), HARP_MAX_NUM_DIMS, chunks);
+    if (num_chunk_dims != array->num_dimensions)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "invalid chunks for array '%s'", name);
+        return -1;
+    }
+    array->chunk_length = 1;
+    if (array->num_dimensions > 0)
+    {
+        array->chunk_length = chunks[0];
+        if (array->chunk_length < 1)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "invalid chunks for array '%s'", name);
+            return -1;
+        }
+    }
+    for (i = 1; i < array->num_dimensions; i++)
+    {
+        if (chunks[i] < array->dimension[i])
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "unsupported chunking for array '%s' (only the first dimension can be "
+                           "chunked)", name);
+            return -1;
+        }
+    }
+
+    value = json_object_get(zattrs, "_ARRAY_DIMENSIONS");
+    if (value == NULL || value->type != json_array || value->num_elements != array->num_dimensions)
+    {
+        harp_set_error(HARP_ERROR_IMPORT, "missing or invalid _ARRAY_DIMENSIONS attribute for array '%s'", name);
+        return -1;
+    }
+    for (i = 0; i < array->num_dimensions; i++)
+    {
+        const char *dimension_name = value->element[i]->string;
+        int num_consumed;
+        long length;
+
+        if (value->element[i]->type != json_string)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "invalid _ARRAY_DIMENSIONS attribute for array '%s'", name);
+            return -1;
+        }
+        if (sscanf(dimension_name, "independent_%ld%n", &length, &num_consumed) == 1 &&
+            (size_t)num_consumed == strlen(dimension_name))
+        {
+            array->dimension_type[i] = harp_dimension_independent;
+        }
+        else if (harp_parse_dimension_type(dimension_name, &array->dimension_type[i]) != 0)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "unsupported dimension '%s' for array '%s'", dimension_name, name);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Collect the description of all arrays in the consolidated metadata (in the order in which they are stored). The
+ * names in the array descriptions point into the metadata. The array list should be freed by the caller. */
+static int get_arrays(const json_value *metadata, int *num_arrays, zarr_array **array_list)
+{
+    zarr_array *array;
+    char *name = NULL;
+    long i;
+
+    *num_arrays = 0;
+    array = malloc((metadata->num_elements + 1) * sizeof(zarr_array));
+    if (array == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (metadata->num_elements + 1) * sizeof(zarr_array), __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < metadata->num_elements; i++)
+    {
+        const char *key = metadata->key[i];
+        size_t length = strlen(key);
+        const json_value *zattrs;
+        char *attrs_key;
+
+        if (length <= 8 || strcmp(&key[length - 8], "/.zarray") != 0)
+        {
+            continue;
+        }
+        name = malloc(length - 8 + 1);
+        attrs_key = malloc(length + 1);
+        if (name == NULL || attrs_key == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (unsigned long)length + 1, __FILE__, __LINE__);
+            if (name != NULL)
+            {
+                free(name);
+            }
+            free(array);
+            return -1;
+        }
+        memcpy(name, key, length - 8);
+        name[length - 8] = '\0';
+        sprintf(attrs_key, "%s/.zattrs", name);
+        zattrs = json_object_get(metadata, attrs_key);
+        free(attrs_key);
+        if (strchr(name, '/') != NULL)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "unsupported array '%s' in sub group", name);
+            free(name);
+            free(array);
+            return -1;
+        }
+        if (parse_array(name, metadata->element[i], zattrs, &array[*num_arrays]) != 0)
+        {
+            free(name);
+            free(array);
+            return -1;
+        }
+        free(name);
+        /* use the name as stored in the metadata key (which stays available for the life time of the metadata) */
+        array[*num_arrays].name = key;
+        (*num_arrays)++;
+    }
+
+    *array_list = array;
+
+    return 0;
+}
+
+/* Returns the length of the array name, which is the part of array->name before "/.zarray" */
+static int get_array_name_length(const zarr_array *array)
+{
+    return (int)strlen(array->name) - 8;
+}
+
+static void swap_bytes(uint8_t *data, long num_elements, long element_size)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        uint8_t *element = &data[i * element_size];
+        long j;
+
+        for (j = 0; j < element_size / 2; j++)
+        {
+            uint8_t value = element[j];
+
+            element[j] = element[element_size - 1 - j];
+            element[element_size - 1 - j] = value;
+        }
+    }
+}
+
+static void fill_blocks(const zarr_array *array, uint8_t *data, long num_elements)
+{
+    long i;
+
+    if (array->fill_value == 0 || array->data_type == harp_type_string)
+    {
+        memset(data, 0, num_elements * array->item_size);
+        return;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        switch (array->data_type)
+        {
+            case harp_type_int8:
+                ((int8_t *)data)[i] = (int8_t)array->fill_value;
+                break;
+            case harp_type_int16:
+                ((int16_t *)data)[i] = (int16_t)array->fill_value;
+                break;
+            case harp_type_int32:
+                ((int32_t *)data)[i] = (int32_t)array->fill_value;
+                break;
+            case harp_type_float:
+                ((float *)data)[i] = (float)array->fill_value;
+                break;
+            case harp_type_double:
+                ((double *)data)[i] = array->fill_value;
+                break;
+            default:
+                assert(0);
+                exit(1);
+        }
+    }
+}
+
+/* Read a range of chunks and copy the blocks that fall within [block_offset, block_offset + num_blocks) */
+static int read_chunk_range(void *arg)
+{
+    chunk_range *range = (chunk_range *)arg;
+    const zarr_array *array = range->array;
+    long chunk_data_size = range->chunk_length * range->block_size;
+    uint8_t *chunk_data = NULL;
+    char *path;
+    long i;
+
+    path = malloc(strlen(range->directory) + 1 + MAX_CHUNK_KEY_LENGTH + 1);
+    if (path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(range->directory) + 1 + MAX_CHUNK_KEY_LENGTH + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    if (array->compressed)
+    {
+        chunk_data = malloc(chunk_data_size);
+        if (chunk_data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (unsigned long)chunk_data_size, __FILE__, __LINE__);
+            free(path);
+            return -1;
+        }
+    }
+
+    for (i = range->first_chunk; i < range->first_chunk + range->num_chunks; i++)
+    {
+        long first_block = i * range->chunk_length;
+        long end_block = first_block + range->chunk_length;
+        uint8_t *data;
+        char *file_data;
+        long size;
+        int found;
+        int length;
+
+        /* only copy the blocks that were requested */
+        if (first_block < range->block_offset)
+        {
+            first_block = range->block_offset;
+        }
+        if (end_block > range->block_offset + range->num_blocks)
+        {
+            end_block = range->block_offset + range->num_blocks;
+        }
+        data = &range->data[(first_block - range->block_offset) * range->block_size];
+
+        length = sprintf(path, "%s/", range->directory);
+        get_chunk_key(i, range->num_dimensions, &path[length]);
+        if (read_file(path, &file_data, &size, &found) != 0)
+        {
+            if (chunk_data != NULL)
+            {
+                free(chunk_data);
+            }
+            free(path);
+            return -1;
+        }
+        if (!found)
+        {
+            fill_blocks(array, data, (end_block - first_block) * range->block_size / array->item_size);
+            continue;
+        }
+        range->num_bytes_read += size;
+
+        if (array->compressed)
+        {
+#ifdef HAVE_ZLIB
+            uLongf uncompressed_size = chunk_data_size;
+            int result;
+
+            result = uncompress(chunk_data, &uncompressed_size, (const Bytef *)file_data, size);
+            free(file_data);
+            if (result != Z_OK || (long)uncompressed_size != chunk_data_size)
+            {
+                harp_set_error(HARP_ERROR_IMPORT, "could not decompress chunk %s (zlib error %d)", path, result);
+                free(chunk_data);
+                free(path);
+                return -1;
+            }
+            file_data = (char *)chunk_data;
+#endif
+        }
+        else if (size != chunk_data_size)
+        {
+            harp_set_error(HARP_ERROR_IMPORT, "chunk %s has invalid size (%ld bytes; expected %ld)", path, size,
+                           chunk_data_size);
+            free(file_data);
+            free(path);
+            return -1;
+        }
+        if (array->swap_bytes)
+        {
+            swap_bytes((uint8_t *)file_data, chunk_data_size / array->item_size, array->item_size);
+        }
+        memcpy(data, &file_data[(first_block - i * range->chunk_length) * range->block_size],
+               (end_block - first_block) * range->block_size);
+        if (!array->compressed)
+        {
+            free(file_data);
+        }
+    }
+
+    if (chunk_data != NULL)
+    {
+        free(chunk_data);
+    }
+    free(path);
+
+    return 0;
+}
+
+static int read_attributes(harp_variable *variable, const json_value *attributes)
+{
+    const char *str;
+    int i;
+
+    str = json_object_get_string(attributes, "description");
+    if (str != NULL)
+    {
+        variable->description = strdup(str);
+        if (variable->description == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            return -1;
+        }
+    }
+
+    str = json_object_get_string(attributes, "units");
+    if (str != NULL)
+    {
+        variable->unit = strdup(str);
+        if (variable->unit == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            return -1;
+        }
+    }
+
+    if (variable->data_type != harp_type_string)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            const json_value *value = json_object_get(attributes, i == 0 ? "valid_min" : "valid_max");
+            harp_scalar *scalar = i == 0 ? &variable->valid_min : &variable->valid_max;
+
+            if (value == NULL)
+            {
+                continue;
+            }
+            if (value->type != json_number)
+            {
+                harp_set_error(HARP_ERROR_IMPORT, "attribute '%s' of variable '%s' has invalid type",
+                               i == 0 ? "valid_min" : "valid_max", variable->name);
+                return -1;
+            }
+            switch (variable->data_type)
+            {
+                case harp_type_int8:
+                    scalar->int8_data = (int8_t)value->number;
+                    break;
+                case harp_type_int16:
+                    scalar->int16_data = (int16_t)value->number;
+                    break;
+                case harp_type_int32:
+                    scalar->int32_data = (int32_t)value->number;
+                    break;
+                case harp_type_float:
+                    scalar->float_data = (float)value->number;
+                    break;
+                case harp_type_double:
+                    scalar->double_data = value->number;
+                    break;
+                default:
+                    assert(0);
+                    exit(1);
+            }
+        }
+    }
+
+    if (variable->data_type == harp_type_int8)
+    {
+        str = json_object_get_string(attributes, "flag_meanings");
+        if (str != NULL)
+        {
+            if (harp_variable_set_enumeration_values_using_flag_meanings(variable, str) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Read an array as a variable. If time_length >= 0, only the time samples in the range
+ * [time_offset, time_offset + time_length) will be read for an array that depends on the time dimension.
+ */
+static int read_variable(harp_product *product, const char *filename, const zarr_array *array, long time_offset,
+                         long time_length)
+{
+    harp_variable *variable;
+    long dimension[HARP_MAX_NUM_DIMS];
+    chunk_range range;
+    char *name;
+    char *directory;
+    char *char_data = NULL;
+    int name_length = get_array_name_length(array);
+    int i;
+
+    name = malloc(name_length + 1);
+    if (name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (unsigned long)name_length + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    memcpy(name, array->name, name_length);
+    name[name_length] = '\0';
+
+    for (i = 0; i < array->num_dimensions; i++)
+    {
+        dimension[i] = array->dimension[i];
+    }
+    range.block_offset = 0;
+    if (time_length >= 0 && array->num_dimensions > 0 && array->dimension_type[0] == harp_dimension_time)
+    {
+        assert(time_offset + time_length <= dimension[0]);
+        range.block_offset = time_offset;
+        dimension[0] = time_length;
+    }
+
+    if (harp_variable_new(name, array->data_type, array->num_dimensions, array->dimension_type, dimension,
+                          &variable) != 0)
+    {
+        free(name);
+        return -1;
+    }
+    if (harp_product_add_variable(product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        free(name);
+        return -1;
+    }
+
+    if (read_attributes(variable, array->attributes) != 0)
+    {
+        harp_add_error_message(" (variable '%s')", name);
+        free(name);
+        return -1;
+    }
+
+    if (variable->num_elements == 0)
+    {
+        free(name);
+        return 0;
+    }
+
+    directory = get_path(filename, NULL, name);
+    free(name);
+    if (directory == NULL)
+    {
+        return -1;
+    }
+
+    range.directory = directory;
+    range.array = array;
+    range.num_dimensions = array->num_dimensions > 0 ? array->num_dimensions : 1;
+    range.num_blocks = array->num_dimensions > 0 ? dimension[0] : 1;
+    range.block_size = array->item_size;
+    for (i = 1; i < array->num_dimensions; i++)
+    {
+        range.block_size *= dimension[i];
+    }
+    range.chunk_length = array->chunk_length;
+    range.first_chunk = range.block_offset / range.chunk_length;
+    range.num_chunks = (range.block_offset + range.num_blocks - 1) / range.chunk_length - range.first_chunk + 1;
+    range.compress = array->compressed;
+    range.num_bytes_read = 0;
+
+    if (array->data_type == harp_type_string)
+    {
+        char_data = malloc(variable->num_elements * array->item_size);
+        if (char_data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           variable->num_elements * array->item_size, __FILE__, __LINE__);
+            free(directory);
+            return -1;
+        }
+        range.data = (uint8_t *)char_data;
+    }
+    else
+    {
+        range.data = (uint8_t *)variable->data.ptr;
+    }
+
+    if (run_chunk_ranges(&range, read_chunk_range) != 0)
+    {
+        harp_add_error_message(" (variable '%s')", variable->name);
+        if (char_data != NULL)
+        {
+            free(char_data);
+        }
+        free(directory);
+        return -1;
+    }
+    free(directory);
+    harp_io_statistics_add_read(harp_io_backend_zarr, range.num_bytes_read);
+
+    if (char_data != NULL)
+    {
+        if (harp_variable_set_string_data_from_char_array(variable, array->item_size, char_data) != 0)
+        {
+            free(char_data);
+            return -1;
+        }
+        free(char_data);
+    }
+
+    return 0;
+}
+
+/* Determine the range of time samples that needs to be read, based on the value filters that follow the
+ * keep()/exclude() operations at the start of the program (see the netCDF backend). If all time samples need to be
+ * read, time_length will be set to -1.
+ */
+static int get_time_range(const char *filename, const json_value *metadata, int num_arrays, const zarr_array *array,
+                          const uint8_t *include, harp_program *program, long *time_offset, long *time_length)
+{
+    harp_product *filter_product;
+    int i;
+
+    *time_offset = 0;
+    *time_length = -1;
+
+    if (program == NULL)
+    {
+        return 0;
+    }
+
+    if (harp_product_new(&filter_product) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < num_arrays; i++)
+    {
+        char name[256];
+        int name_length = get_array_name_length(&array[i]);
+
+        if (!include[i] || array[i].num_dimensions != 1 || array[i].dimension_type[0] != harp_dimension_time ||
+            name_length >= (int)sizeof(name))
+        {
+            continue;
+        }
+        memcpy(name, array[i].name, name_length);
+        name[name_length] = '\0';
+        if (!harp_program_is_leading_value_filter_variable(program, name))
+        {
+            continue;
+        }
+
+        if (read_variable(filter_product, filename, &array[i], 0, -1) != 0)
+        {
+            harp_product_delete(filter_product);
+            return -1;
+        }
+    }
+
+    if (filter_product->num_variables > 0)
+    {
+        const char *source_product;
+        long offset;
+        long length;
+
+        /* collocation filters need the source product to select the collocation mask */
+        source_product = json_object_get_string(json_object_get(metadata, ".zattrs"), "source_product");
+        if (source_product != NULL)
+        {
+            if (harp_product_set_source_product(filter_product, source_product) != 0)
+            {
+                harp_product_delete(filter_product);
+                return -1;
+            }
+        }
+
+        if (harp_program_get_leading_value_filter_time_range(program, filter_product, &offset, &length) != 0)
+        {
+            harp_product_delete(filter_product);
+            return -1;
+        }
+        if (length < filter_product->dimension[harp_dimension_time])
+        {
+            *time_offset = offset;
+            *time_length = length;
+        }
+    }
+
+    harp_product_delete(filter_product);
+
+    return 0;
+}
+
+static int read_product(const char *filename, const json_value *metadata, harp_program *program,
+                        harp_product *product)
+{
+    const json_value *attributes;
+    const char *str;
+    zarr_array *array;
+    int num_arrays;
+    int i;
+
+    if (get_arrays(metadata, &num_arrays, &array) != 0)
+    {
+        return -1;
+    }
+
+    if (num_arrays > 0)
+    {
+        const char **variable_name;
+        uint8_t *include;
+        long time_offset = 0;
+        long time_length = -1;
+
+        include = (uint8_t *)malloc(num_arrays * sizeof(uint8_t));
+        if (include == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_arrays * sizeof(uint8_t), __FILE__, __LINE__);
+            free(array);
+            return -1;
+        }
+        memset(include, 1, num_arrays * sizeof(uint8_t));
+
+        if (program != NULL)
+        {
+            variable_name = (const char **)malloc(num_arrays * sizeof(const char *));
+            if (variable_name == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_arrays * sizeof(const char *), __FILE__, __LINE__);
+                free(include);
+                free(array);
+                return -1;
+            }
+            /* the names need to be zero terminated without the "/.zarray" postfix */
+            for (i = 0; i < num_arrays; i++)
+            {
+                int name_length = get_array_name_length(&array[i]);
+                char *name = malloc(name_length + 1);
+
+                if (name == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   (unsigned long)name_length + 1, __FILE__, __LINE__);
+                    while (--i >= 0)
+                    {
+                        free((char *)variable_name[i]);
+                    }
+                    free(variable_name);
+                    free(include);
+                    free(array);
+                    return -1;
+                }
+                memcpy(name, array[i].name, name_length);
+                name[name_length] = '\0';
+                variable_name[i] = name;
+            }
+            harp_program_get_included_variables(program, num_arrays, variable_name, include);
+            for (i = 0; i < num_arrays; i++)
+            {
+                free((char *)variable_name[i]);
+            }
+            free(variable_name);
+        }
+
+        if (get_time_range(filename, metadata, num_arrays, array, include, program, &time_offset, &time_length) != 0)
+        {
+            free(include);
+            free(array);
+            return -1;
+        }
+
+        for (i = 0; i < num_arrays; i++)
+        {
+            if (!include[i])
+            {
+                /* variable would be removed by the program anyway, so don't read its data */
+                continue;
+            }
+
+            if (read_variable(product, filename, &array[i], time_offset, time_length) != 0)
+            {
+                free(include);
+                free(array);
+                return -1;
+            }
+        }
+
+        free(include);
+    }
+    free(array);
+
+    attributes = json_object_get(metadata, ".zattrs");
+    str = json_object_get_string(attributes, "source_product");
+    if (str != NULL)
+    {
+        if (harp_product_set_source_product(product, str) != 0)
+        {
+            return -1;
+        }
+    }
+    str = json_object_get_string(attributes, "history");
+    if (str != NULL)
+    {
+        if (harp_product_set_history(product, str) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int harp_import_zarr(const char *filename, harp_program *program, harp_product **product)
+{
+    harp_product *new_product;
+    const json_value *metadata;
+    json_value *root;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (read_consolidated_metadata(filename, &root, &metadata) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_zarr);
+
+    if (verify_product(metadata) != 0)
+    {
+        json_value_delete(root);
+        harp_io_statistics_add_close(harp_io_backend_zarr);
+        return -1;
+    }
+
+    if (harp_product_new(&new_product) != 0)
+    {
+        json_value_delete(root);
+        harp_io_statistics_add_close(harp_io_backend_zarr);
+        return -1;
+    }
+
+    if (read_product(filename, metadata, program, new_product) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        harp_product_delete(new_product);
+        json_value_delete(root);
+        harp_io_statistics_add_close(harp_io_backend_zarr);
+        return -1;
+    }
+
+    json_value_delete(root);
+    harp_io_statistics_add_close(harp_io_backend_zarr);
+
+    *product = new_product;
+
+    return 0;
+}
+
+/* the spatial extent (if not NULL) is read as latitude_min, latitude_max, longitude_min, longitude_max; values for
+ * which the attribute is not present are set to NaN */
+int harp_import_global_attributes_zarr(const char *filename, double *datetime_start, double *datetime_stop,
+                                       double *spatial_extent, long dimension[], char **source_product)
+{
+    const json_value *attributes;
+    const json_value *metadata;
+    const json_value *value;
+    json_value *root;
+    int i;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (read_consolidated_metadata(filename, &root, &metadata) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        return -1;
+    }
+    harp_io_statistics_add_open(harp_io_backend_zarr);
+
+    if (verify_product(metadata) != 0)
+    {
+        json_value_delete(root);
+        harp_io_statistics_add_close(harp_io_backend_zarr);
+        return -1;
+    }
+    attributes = json_object_get(metadata, ".zattrs");
+
+    if (datetime_start != NULL)
+    {
+        value = json_object_get(attributes, "datetime_start");
+        *datetime_start = (value != NULL && value->type == json_number) ? value->number : harp_mininf();
+    }
+
+    if (datetime_stop != NULL)
+    {
+        value = json_object_get(attributes, "datetime_stop");
+        *datetime_stop = (value != NULL && value->type == json_number) ? value->number : harp_plusinf();
+    }
+
+    if (spatial_extent != NULL)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            value = json_object_get(attributes, spatial_extent_attribute_name[i]);
+            spatial_extent[i] = (value != NULL && value->type == json_number) ? value->number : harp_nan();
+        }
+    }
+
+    if (dimension != NULL)
+    {
+        zarr_array *array;
+        int num_arrays;
+
+        if (get_arrays(metadata, &num_arrays, &array) != 0)
+        {
+            json_value_delete(root);
+            harp_io_statistics_add_close(harp_io_backend_zarr);
+            return -1;
+        }
+        for (i = 0; i < num_arrays; i++)
+        {
+            int j;
+
+            for (j = 0; j < array[i].num_dimensions; j++)
+            {
+                if (array[i].dimension_type[j] != harp_dimension_independent)
+                {
+                    dimension[array[i].dimension_type[j]] = array[i].dimension[j];
+                }
+            }
+        }
+        free(array);
+    }
+
+    if (source_product != NULL)
+    {
+        const char *str = json_object_get_string(attributes, "source_product");
+
+        /* use filename if there is no source_product attribute */
+        *source_product = strdup(str != NULL ? str : harp_basename(filename));
+        if (*source_product == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            json_value_delete(root);
+            harp_io_statistics_add_close(harp_io_backend_zarr);
+            return -1;
+        }
+    }
+
+    json_value_delete(root);
+    harp_io_statistics_add_close(harp_io_backend_zarr);
+
+    return 0;
+}
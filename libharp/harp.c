@@ -30,6 +30,8 @@
  */
 
 #include "harp-internal.h"
+#include "harp-program.h"
+#include "harp-thread.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -50,20 +52,71 @@
 LIBHARP_API const char *libharp_version = HARP_VERSION;
 
 static int harp_init_counter = 0;
+static harp_mutex harp_init_mutex = HARP_MUTEX_INITIALIZER;
+
+/* The netCDF, HDF4, HDF5, and CODA libraries are not thread-safe, so all access to product files is serialized.
+ * The lock depth is kept per thread such that a nested import (e.g. as part of an operation) does not deadlock.
+ */
+static harp_mutex file_access_mutex = HARP_MUTEX_INITIALIZER;
+static HARP_THREAD_LOCAL int file_access_lock_depth = 0;
+
+/* process-wide values of the options that can be changed by the set() operation (see harp_execution_options) */
+static int harp_option_enable_aux_afgl86 = 0;
+static int harp_option_enable_aux_usstd76 = 0;
+static int harp_option_regrid_out_of_bounds = 0;
+static int harp_option_wgs84_point_distance = 0;
+
+/* options of the program that is being executed by the current thread (NULL if the thread is not executing a program)
+ */
+static HARP_THREAD_LOCAL harp_execution_options *execution_options = NULL;
 
-int harp_option_enable_aux_afgl86 = 0;
-int harp_option_enable_aux_usstd76 = 0;
 int harp_option_hdf5_compression = 0;
-int harp_option_regrid_out_of_bounds = 0;
+long harp_option_hdf5_chunk_size = 1048576;
+int harp_option_hdf5_shuffle = 1;
+int harp_option_hdf5_adaptive_compression = 0;
+long harp_option_hdf5_page_size = 0;
+long harp_option_zarr_chunk_size = 0;
+long harp_option_arrow_batch_size = 65536;
+int harp_option_hdf5_compression_filter = 0;
+int harp_option_enable_dataset_index = 0;
+int harp_option_optimize_operations = 0;
+int harp_option_keep_float = 0;
+int harp_option_trusted_import = 0;
+int harp_option_profile = 0;
+int harp_option_trace = 0;
+int64_t harp_option_memory_limit = 0;
+int harp_option_huge_pages = 0;
+int harp_option_numa_policy = 0;
+int64_t harp_option_buffer_pool_size = 0;
+int harp_option_num_threads = 1;
+int64_t harp_option_product_cache_size = 1073741824;
+int64_t harp_option_collocated_product_cache_size = 268435456;
+int harp_option_percentile_compression = 100;
 
 typedef enum file_format_enum
 {
     format_unknown = -1,
     format_hdf4,
     format_hdf5,
-    format_netcdf
+    format_netcdf,
+    format_zarr,
+    format_arrow
 } file_format;
 
+struct harp_import_stream_struct
+{
+    harp_program *program;      /* operations that are executed on each chunk */
+    harp_ingest_stream *ingest_stream;  /* stream of the ingestion module (if the product is not in HARP format) */
+    harp_product *product;      /* fully imported product (if the product is in HARP format) */
+    long chunk_size;    /* maximum number of time samples of each chunk */
+    long offset;        /* index of the first time sample of the next chunk (if the product is in HARP format) */
+};
+
+struct harp_export_stream_struct
+{
+    harp_netcdf_export_stream *netcdf_stream;   /* stream of the netCDF backend (the only format that is supported) */
+};
+
 static file_format format_from_string(const char *format)
 {
     if (strcasecmp(format, "hdf4") == 0)
@@ -78,6 +131,38 @@ static file_format format_from_string(const char *format)
     {
         return format_netcdf;
     }
+    else if (strcasecmp(format, "zarr") == 0)
+    {
+        return format_zarr;
+    }
+    else if (strcasecmp(format, "arrow") == 0)
+    {
+        return format_arrow;
+    }
+    return format_unknown;
+}
+
+/* determine the file format from the first bytes of a file; size is the total size of the file */
+static file_format format_from_signature(const unsigned char *buffer, long size)
+{
+    /* HDF4 */
+    if (size >= 4 && memcmp(buffer, "\016\003\023\001", 4) == 0)
+    {
+        return format_hdf4;
+    }
+
+    /* HDF5 */
+    if (size >= 8 && memcmp(buffer, "\211HDF\r\n\032\n", 8) == 0)
+    {
+        return format_hdf5;
+    }
+
+    /* netCDF */
+    if (size >= 4 && memcmp(buffer, "CDF", 3) == 0 && (buffer[3] == '\001' || buffer[3] == '\002'))
+    {
+        return format_netcdf;
+    }
+
     return format_unknown;
 }
 
@@ -88,6 +173,19 @@ static int determine_file_format(const char *filename, file_format *format)
     int open_flags;
     int fd;
 
+    if (harp_is_remote_url(filename))
+    {
+        /* remote access is only supported for HARP products in HDF5 format (using ranged reads via HDF5) */
+#ifdef HAVE_HDF5
+        *format = format_hdf5;
+        return 0;
+#else
+        harp_set_error(HARP_ERROR_NO_HDF5_SUPPORT, "could not open %s (remote access requires HDF5 support)",
+                       filename);
+        return -1;
+#endif
+    }
+
     /* Call stat() on the file to be opened. */
     if (stat(filename, &statbuf) != 0)
     {
@@ -102,6 +200,30 @@ static int determine_file_format(const char *filename, file_format *format)
         return -1;
     }
 
+    /* A directory is only supported if it is a Zarr store (i.e. it contains a .zgroup file). */
+    if ((statbuf.st_mode & S_IFDIR) != 0)
+    {
+        char *group_filename;
+
+        group_filename = malloc(strlen(filename) + 9);
+        if (group_filename == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           strlen(filename) + 9, __FILE__, __LINE__);
+            return -1;
+        }
+        sprintf(group_filename, "%s/.zgroup", filename);
+        if (stat(group_filename, &statbuf) == 0 && (statbuf.st_mode & S_IFREG) != 0)
+        {
+            free(group_filename);
+            *format = format_zarr;
+            return 0;
+        }
+        free(group_filename);
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not open %s (not a regular file or Zarr store)", filename);
+        return -1;
+    }
+
     /* Check that the file is a regular file. */
     if ((statbuf.st_mode & S_IFREG) == 0)
     {
@@ -134,29 +256,42 @@ static int determine_file_format(const char *filename, file_format *format)
 
     close(fd);
 
-    /* HDF4 */
-    if (statbuf.st_size >= 4 && memcmp(buffer, "\016\003\023\001", 4) == 0)
+    *format = format_from_signature(buffer, (long)statbuf.st_size);
+
+    return 0;
+}
+
+/* Ingestion modules can only read local files; fails with HARP_ERROR_UNSUPPORTED_PRODUCT for remote urls */
+static int check_ingestable(const char *filename)
+{
+    if (harp_is_remote_url(filename))
     {
-        *format = format_hdf4;
-        return 0;
+        harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, "could not import %s (remote access is only supported for "
+                       "products in HARP HDF5 format)", filename);
+        return -1;
     }
 
-    /* HDF5 */
-    if (statbuf.st_size >= 8 && memcmp(buffer, "\211HDF\r\n\032\n", 8) == 0)
+    return 0;
+}
+
+static void file_access_lock(void)
+{
+    if (file_access_lock_depth == 0)
     {
-        *format = format_hdf5;
-        return 0;
+        harp_trace_begin("wait for file access");
+        harp_mutex_lock(&file_access_mutex);
+        harp_trace_end();
     }
+    file_access_lock_depth++;
+}
 
-    /* netCDF */
-    if (statbuf.st_size >= 4 && memcmp(buffer, "CDF", 3) == 0 && (buffer[3] == '\001' || buffer[3] == '\002'))
+static void file_access_unlock(void)
+{
+    file_access_lock_depth--;
+    if (file_access_lock_depth == 0)
     {
-        *format = format_netcdf;
-        return 0;
+        harp_mutex_unlock(&file_access_mutex);
     }
-
-    *format = format_unknown;
-    return 0;
 }
 
 static int auxiliary_data_init(void)
@@ -172,6 +307,193 @@ static int auxiliary_data_init(void)
     return 0;
 }
 
+static int dataset_index_init(void)
+{
+    if (getenv("HARP_DATASET_INDEX") != NULL)
+    {
+        harp_option_enable_dataset_index = 1;
+    }
+    return 0;
+}
+
+static int optimize_operations_init(void)
+{
+    if (getenv("HARP_OPTIMIZE_OPERATIONS") != NULL)
+    {
+        harp_option_optimize_operations = 1;
+    }
+    return 0;
+}
+
+static int keep_float_init(void)
+{
+    if (getenv("HARP_KEEP_FLOAT") != NULL)
+    {
+        harp_option_keep_float = 1;
+    }
+    return 0;
+}
+
+static int trusted_import_init(void)
+{
+    if (getenv("HARP_TRUSTED_IMPORT") != NULL)
+    {
+        harp_option_trusted_import = 1;
+    }
+    return 0;
+}
+
+static int profile_init(void)
+{
+    if (getenv("HARP_PROFILE") != NULL)
+    {
+        harp_option_profile = 1;
+    }
+    return 0;
+}
+
+static int trace_init(void)
+{
+    const char *filename = getenv("HARP_TRACE");
+
+    if (filename != NULL && *filename != '\0')
+    {
+        if (harp_trace_open(filename) != 0)
+        {
+            return -1;
+        }
+        harp_option_trace = 1;
+    }
+    return 0;
+}
+
+static int memory_limit_init(void)
+{
+    const char *value = getenv("HARP_MEMORY_LIMIT");
+
+    if (value != NULL)
+    {
+        double limit = strtod(value, NULL);
+
+        if (limit > 0)
+        {
+            harp_option_memory_limit = (int64_t)limit;
+        }
+    }
+    return 0;
+}
+
+static int memory_allocation_init(void)
+{
+    const char *value = getenv("HARP_NUMA_POLICY");
+    int huge_pages = getenv("HARP_HUGE_PAGES") != NULL;
+    int numa_policy = 0;
+
+    if (value != NULL)
+    {
+        if (strcmp(value, "first-touch") == 0)
+        {
+            numa_policy = 1;
+        }
+        else if (strcmp(value, "interleave") == 0)
+        {
+            numa_policy = 2;
+        }
+    }
+    if (huge_pages || numa_policy != 0)
+    {
+        if (harp_memory_set_large_block_allocator(1) != 0)
+        {
+            harp_report_warning("memory allocation options ignored (%s)", harp_errno_to_string(harp_errno));
+            return 0;
+        }
+        harp_option_huge_pages = huge_pages;
+        harp_option_numa_policy = numa_policy;
+    }
+    value = getenv("HARP_BUFFER_POOL_SIZE");
+    if (value != NULL)
+    {
+        double size = strtod(value, NULL);
+
+        if (size > 0)
+        {
+            if (harp_memory_set_buffer_pool_size((int64_t)size) != 0)
+            {
+                harp_report_warning("buffer pool option ignored (%s)", harp_errno_to_string(harp_errno));
+                return 0;
+            }
+            harp_option_buffer_pool_size = (int64_t)size;
+        }
+    }
+    return 0;
+}
+
+static int num_threads_init(void)
+{
+    const char *value = getenv("HARP_NUM_THREADS");
+
+    if (value != NULL)
+    {
+        long num_threads = strtol(value, NULL, 10);
+
+        if (num_threads >= 1 && num_threads <= HARP_MAX_NUM_THREADS)
+        {
+            harp_option_num_threads = (int)num_threads;
+        }
+    }
+    return 0;
+}
+
+static int percentile_compression_init(void)
+{
+    const char *value = getenv("HARP_PERCENTILE_COMPRESSION");
+
+    if (value != NULL)
+    {
+        long compression = strtol(value, NULL, 10);
+
+        if (compression >= HARP_MIN_PERCENTILE_COMPRESSION && compression <= HARP_MAX_PERCENTILE_COMPRESSION)
+        {
+            harp_option_percentile_compression = (int)compression;
+        }
+    }
+    return 0;
+}
+
+static int product_cache_init(void)
+{
+    const char *value = getenv("HARP_PRODUCT_CACHE_SIZE");
+
+    if (value != NULL)
+    {
+        double size = strtod(value, NULL);
+
+        if (size > 0)
+        {
+            harp_option_product_cache_size = (int64_t)size;
+        }
+    }
+    value = getenv("HARP_COLLOCATED_PRODUCT_CACHE_SIZE");
+    if (value != NULL)
+    {
+        double size = strtod(value, NULL);
+
+        if (size >= 0)
+        {
+            harp_option_collocated_product_cache_size = (int64_t)size;
+        }
+    }
+    value = getenv("HARP_PRODUCT_CACHE");
+    if (value != NULL && harp_product_cache_get_directory() == NULL)
+    {
+        if (harp_product_cache_set_directory(value) != 0)
+        {
+            harp_report_warning("product cache disabled (%s)", harp_errno_to_string(harp_errno));
+        }
+    }
+    return 0;
+}
+
 /** \defgroup harp_general HARP General
  * The HARP General module contains all general and miscellaneous functions and procedures of HARP.
  */
@@ -314,7 +636,14 @@ LIBHARP_API int harp_set_option_enable_aux_afgl86(int enable)
         return -1;
     }
 
-    harp_option_enable_aux_afgl86 = enable;
+    if (execution_options != NULL)
+    {
+        execution_options->enable_aux_afgl86 = enable;
+    }
+    else
+    {
+        harp_option_enable_aux_afgl86 = enable;
+    }
 
     return 0;
 }
@@ -327,6 +656,10 @@ LIBHARP_API int harp_set_option_enable_aux_afgl86(int enable)
  */
 LIBHARP_API int harp_get_option_enable_aux_afgl86(void)
 {
+    if (execution_options != NULL)
+    {
+        return execution_options->enable_aux_afgl86;
+    }
     return harp_option_enable_aux_afgl86;
 }
 
@@ -363,7 +696,14 @@ LIBHARP_API int harp_set_option_enable_aux_usstd76(int enable)
         return -1;
     }
 
-    harp_option_enable_aux_usstd76 = enable;
+    if (execution_options != NULL)
+    {
+        execution_options->enable_aux_usstd76 = enable;
+    }
+    else
+    {
+        harp_option_enable_aux_usstd76 = enable;
+    }
 
     return 0;
 }
@@ -376,6 +716,10 @@ LIBHARP_API int harp_set_option_enable_aux_usstd76(int enable)
  */
 LIBHARP_API int harp_get_option_enable_aux_usstd76(void)
 {
+    if (execution_options != NULL)
+    {
+        return execution_options->enable_aux_usstd76;
+    }
     return harp_option_enable_aux_usstd76;
 }
 
@@ -408,208 +752,2202 @@ LIBHARP_API int harp_get_option_hdf5_compression(void)
     return harp_option_hdf5_compression;
 }
 
-/** Set how to treat out of bound values during regridding operations.
- * This is only applicable for point interpolation regridding. Any point that falls outside the target grid
- * can be either set to NaN (the default), set to the nearest edge value, or set based on extrapolation (of two nearest
- * points). This global HARP option determines which of the three cases will be used.
- * \param method
- *   \arg 0: Set values outside source grid to NaN
- *   \arg 1: Set value outside source grid to edge value (=min/max of source grid)
- *   \arg 2: Extrapolate based on nearest two edge values
+/** Set the target size in bytes of the chunks that are used for storing compressed variables in HDF5 files.
+ * Each chunk spans whole samples of the leading (time) dimension where possible. Reading a subset of the samples
+ * then only requires decompressing the chunks that contain those samples. The default of 1048576 bytes matches the
+ * default size of the HDF5 chunk cache.
+ * This option only has an effect if compression is enabled (see harp_set_option_hdf5_compression()).
+ * \param chunk_size The target chunk size in bytes or 0 to store each variable in as few chunks as possible.
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_set_option_regrid_out_of_bounds(int method)
+LIBHARP_API int harp_set_option_hdf5_chunk_size(long chunk_size)
 {
-    if (method < 0 || method > 2)
+    if (chunk_size < 0)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "method argument (%d) is not valid (%s:%u)", method, __FILE__,
-                       __LINE__);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "chunk_size argument (%ld) is not valid (%s:%u)", chunk_size,
+                       __FILE__, __LINE__);
         return -1;
     }
 
-    harp_option_regrid_out_of_bounds = method;
+    harp_option_hdf5_chunk_size = chunk_size;
 
     return 0;
 }
 
-/** Retrieve the current setting for treating out of bound values during regridding operations.
- * \see harp_set_option_regrid_out_of_bounds()
- * \return
- *   \arg \c 0 Set values outside source grid to NaN
- *   \arg \c 1 Set value outside source grid to edge value (=min/max of source grid)
- *   \arg \c 2 Extrapolate based on nearest two edge values
+/** Retrieve the target chunk size that is used for storing compressed variables in HDF5 files.
+ * \see harp_set_option_hdf5_chunk_size()
+ * \return Target chunk size in bytes (0 means that each variable is stored in as few chunks as possible).
  */
-LIBHARP_API int harp_get_option_regrid_out_of_bounds(void)
+LIBHARP_API long harp_get_option_hdf5_chunk_size(void)
 {
-    return harp_option_regrid_out_of_bounds;
+    return harp_option_hdf5_chunk_size;
 }
 
-/** Initializes the HARP C library.
- * This function should be called before any other HARP C library function is called (except for
- * harp_set_coda_definition_path(), harp_set_coda_definition_path_conditional(), and harp_set_warning_handler()).
- *
- * HARP may at some point after calling harp_init() also initialize the underlying CODA C library that is used for
- * ingestion of products that are not using the HARP format.
- * The CODA C library may require access to .codadef files that describe the formats of certain product files.
- * In order to tell CODA where these .codadef files are located you will have to either set the CODA_DEFINITION
- * environment variable to the proper path, or set the path programmatically using the
- * harp_set_coda_definition_path() or harp_set_coda_definition_path_conditional() function, before calling harp_init()
- * for the first time.
- *
- * If you use CODA functions directly in combination with HARP functions you should call coda_init() and coda_done()
- * explicitly yourself and not rely on HARP having performed the coda_init() for you.
- *
- * It is valid to perform multiple calls to harp_init() after each other. Only the first call to harp_init() will do
- * the actual initialization and all following calls to harp_init() will only increase an initialization counter. Each
- * call to harp_init() needs to be matched by a call to harp_done() at clean-up time (i.e. the number of calls to
- * harp_done() needs to be equal to the number of calls to harp_init()). Only the final harp_done() call (when the
- * initialization counter has reached 0) will perform the actual clean-up of the HARP C library.
- *
+/** Enable/Disable the use of the shuffle filter for storing compressed variables in HDF5 files.
+ * The shuffle filter reorders the bytes of the data elements before compression, which generally improves the
+ * compression ratio of numerical data. It is enabled by default.
+ * This option only has an effect if compression is enabled (see harp_set_option_hdf5_compression()).
+ * \param enable
+ *   \arg 0: Disable the shuffle filter.
+ *   \arg 1: Enable the shuffle filter.
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_init(void)
+LIBHARP_API int harp_set_option_hdf5_shuffle(int enable)
 {
-    if (harp_init_counter == 0)
+    if (enable != 0 && enable != 1)
     {
-        if (auxiliary_data_init() != 0)
-        {
-            return -1;
-        }
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
     }
 
-    harp_init_counter++;
+    harp_option_hdf5_shuffle = enable;
 
     return 0;
 }
 
-/** Finalizes the HARP C library.
- * This function should be called to let the HARP C library free up any resources it has claimed since initialization.
+/** Retrieve the current setting for the use of the shuffle filter for storing compressed variables in HDF5 files.
+ * \see harp_set_option_hdf5_shuffle()
+ * \return
+ *   \arg \c 0, The shuffle filter is disabled.
+ *   \arg \c 1, The shuffle filter is enabled.
+ */
+LIBHARP_API int harp_get_option_hdf5_shuffle(void)
+{
+    return harp_option_hdf5_shuffle;
+}
+
+/** Enable/Disable adaptive compression of variables in HDF5 files.
+ * With adaptive compression, the compression settings are chosen for each variable separately based on how well a
+ * sample of the data of the variable (64kB, taken from four places spread over the data) compresses:
+ *   - a variable whose sample compresses to more than 90% of its size (at the lowest level) is stored without
+ *     compression.
+ *   - the shuffle filter is only used if it makes the sample compress better (regardless of
+ *     harp_set_option_hdf5_shuffle()).
+ *   - the level set with harp_set_option_hdf5_compression() is only used if it makes the compressed sample at least 10%
+ *     smaller than with the lowest level (1); otherwise the much faster lowest level is used.
  *
- * It is valid to perform multiple calls to harp_init() after each other. Only the first call to harp_init() will do
- * the actual initialization and all following calls to harp_init() will only increase an initialization counter. Each
- * call to harp_init() needs to be matched by a call to harp_done() at clean-up time (i.e. the number of calls to
- * harp_done() needs to be equal to the number of calls to harp_init()). Only the final harp_done() call (when the
- * initialization counter has reached 0) will perform the actual clean-up of the HARP C library.
+ * The chosen settings of each variable are stored in the HDF5 file (as the filter pipeline of the dataset) and are
+ * also recorded in the trace, if enabled (see harp_set_option_trace()).
+ * This option only has an effect if compression is enabled (see harp_set_option_hdf5_compression()) and if HARP was
+ * built with zlib.
+ * \param enable
+ *   \arg 0: Use the same compression settings for all variables (default).
+ *   \arg 1: Choose the compression settings for each variable separately.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_hdf5_adaptive_compression(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_hdf5_adaptive_compression = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for adaptive compression of variables in HDF5 files.
+ * \see harp_set_option_hdf5_adaptive_compression()
+ * \return
+ *   \arg \c 0, The same compression settings are used for all variables.
+ *   \arg \c 1, The compression settings are chosen for each variable separately.
+ */
+LIBHARP_API int harp_get_option_hdf5_adaptive_compression(void)
+{
+    return harp_option_hdf5_adaptive_compression;
+}
+
+/** Set the file space page size in bytes to use for HDF5 files.
+ * If set, HDF5 files are written with the paged file space strategy: the file is divided in pages of the given size
+ * and metadata and raw data are each aggregated into their own pages. All metadata of a product then generally ends
+ * up in a single (or a few) consecutive page(s) near the start of the file, such that opening the file through a
+ * remote access driver (e.g. the HDF5 ROS3 driver for object storage) only requires one or two range requests.
+ * The metadata block size is set to the page size as well. A page size of a few MiB (e.g. 4194304) is a good choice for
+ * object storage. Paged files require HDF5 1.10.1 or later for reading.
+ * \param page_size The page size in bytes (at least 512) or 0 to use the default file space management (default).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_hdf5_page_size(long page_size)
+{
+    if (page_size != 0 && page_size < 512)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "page_size argument (%ld) is not valid (%s:%u)", page_size,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_hdf5_page_size = page_size;
+
+    return 0;
+}
+
+/** Retrieve the file space page size that is used for HDF5 files.
+ * \see harp_set_option_hdf5_page_size()
+ * \return Page size in bytes (0 means that the default file space management is used).
+ */
+LIBHARP_API long harp_get_option_hdf5_page_size(void)
+{
+    return harp_option_hdf5_page_size;
+}
+
+static const char *hdf5_compression_filter_name[] = { "deflate", "zstd", "lz4" };
+
+/** Set the compression filter to use for storing compressed variables in HDF5 files.
+ * Supported filters are:
+ *   - \c deflate: the zlib based compression filter that is built into HDF5 (default).
+ *   - \c zstd: Zstandard compression (registered HDF5 filter 32015).
+ *   - \c lz4: LZ4 compression (registered HDF5 filter 32004).
  *
- * Calling a HARP function other than harp_init() after the final harp_done() call will result in undefined behavior.
+ * The zstd and lz4 filters compress and decompress considerably faster than deflate, but they are not built into
+ * HDF5 and need to be available as a dynamically loaded filter plugin (see the HDF5_PLUGIN_PATH environment variable).
+ * This is also the case for any application that reads the resulting files. If the selected filter is not available
+ * at export time, a warning is given and deflate compression is used instead.
+ * The compression level set with harp_set_option_hdf5_compression() is passed on to the zstd filter; the lz4 filter
+ * has no compression level.
+ * This option only has an effect if compression is enabled (see harp_set_option_hdf5_compression()).
+ * \param name Name of the compression filter (\c deflate, \c zstd, or \c lz4).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API void harp_done(void)
+LIBHARP_API int harp_set_option_hdf5_compression_filter(const char *name)
 {
-    if (harp_init_counter > 0)
+    int i;
+
+    if (name == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "name is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < (int)(sizeof(hdf5_compression_filter_name) / sizeof(hdf5_compression_filter_name[0])); i++)
+    {
+        if (strcmp(name, hdf5_compression_filter_name[i]) == 0)
+        {
+            harp_option_hdf5_compression_filter = i;
+            return 0;
+        }
+    }
+
+    harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "name argument (%s) is not a valid compression filter (%s:%u)", name,
+                   __FILE__, __LINE__);
+    return -1;
+}
+
+/** Retrieve the name of the compression filter that is used for storing compressed variables in HDF5 files.
+ * \see harp_set_option_hdf5_compression_filter()
+ * \return Name of the compression filter (\c deflate, \c zstd, or \c lz4).
+ */
+LIBHARP_API const char *harp_get_option_hdf5_compression_filter(void)
+{
+    return hdf5_compression_filter_name[harp_option_hdf5_compression_filter];
+}
+
+/** Set the number of time samples per chunk to use for Zarr stores.
+ * Each variable in a Zarr store is split along the time dimension into chunks of the given number of time samples
+ * (non time dependent variables are always stored as a single chunk). Each chunk is stored as a separate object, such
+ * that a chunk can be written and read independently of the other chunks (e.g. by parallel readers that each process
+ * a range of time samples).
+ * \param chunk_size Number of time samples per chunk or 0 to store each variable as a single chunk (default).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_zarr_chunk_size(long chunk_size)
+{
+    if (chunk_size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "chunk_size argument (%ld) is not valid (%s:%u)", chunk_size,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_zarr_chunk_size = chunk_size;
+
+    return 0;
+}
+
+/** Retrieve the number of time samples per chunk that is used for Zarr stores.
+ * \see harp_set_option_zarr_chunk_size()
+ * \return Number of time samples per chunk (0 means that each variable is stored as a single chunk).
+ */
+LIBHARP_API long harp_get_option_zarr_chunk_size(void)
+{
+    return harp_option_zarr_chunk_size;
+}
+
+/** Set the number of rows per record batch to use for Arrow export.
+ * Each time sample of a product is a row in an Arrow file. The rows are split into record batches of the given size,
+ * which are encoded in parallel (see harp_set_option_num_threads()) and can be read independently.
+ * \param batch_size Number of rows per record batch or 0 to store all rows in a single record batch (default: 65536).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_arrow_batch_size(long batch_size)
+{
+    if (batch_size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "batch_size argument (%ld) is not valid (%s:%u)", batch_size,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_arrow_batch_size = batch_size;
+
+    return 0;
+}
+
+/** Retrieve the number of rows per record batch that is used for Arrow export.
+ * \see harp_set_option_arrow_batch_size()
+ * \return Number of rows per record batch (0 means that all rows are stored in a single record batch).
+ */
+LIBHARP_API long harp_get_option_arrow_batch_size(void)
+{
+    return harp_option_arrow_batch_size;
+}
+
+/** Set how to treat out of bound values during regridding operations.
+ * This is only applicable for point interpolation regridding. Any point that falls outside the target grid
+ * can be either set to NaN (the default), set to the nearest edge value, or set based on extrapolation (of two nearest
+ * points). This global HARP option determines which of the three cases will be used.
+ * \param method
+ *   \arg 0: Set values outside source grid to NaN
+ *   \arg 1: Set value outside source grid to edge value (=min/max of source grid)
+ *   \arg 2: Extrapolate based on nearest two edge values
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_regrid_out_of_bounds(int method)
+{
+    if (method < 0 || method > 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "method argument (%d) is not valid (%s:%u)", method, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    if (execution_options != NULL)
+    {
+        execution_options->regrid_out_of_bounds = method;
+    }
+    else
+    {
+        harp_option_regrid_out_of_bounds = method;
+    }
+
+    return 0;
+}
+
+/** Retrieve the current setting for treating out of bound values during regridding operations.
+ * \see harp_set_option_regrid_out_of_bounds()
+ * \return
+ *   \arg \c 0 Set values outside source grid to NaN
+ *   \arg \c 1 Set value outside source grid to edge value (=min/max of source grid)
+ *   \arg \c 2 Extrapolate based on nearest two edge values
+ */
+LIBHARP_API int harp_get_option_regrid_out_of_bounds(void)
+{
+    if (execution_options != NULL)
+    {
+        return execution_options->regrid_out_of_bounds;
+    }
+    return harp_option_regrid_out_of_bounds;
+}
+
+/** Enable/Disable the use of the WGS84 ellipsoid for point distance filters.
+ * By default the point_distance filter (and the point_distance criterium of harpcollocate) use the distance on a
+ * sphere with a radius of 6371km, which can deviate up to about 0.5% from the distance on the WGS84 ellipsoid.
+ * If this option is enabled, the distance on the WGS84 ellipsoid is used instead (using the Andoyer-Lambert
+ * approximation, see harp_geometry_get_point_distance_wgs84(), which has a relative error of less than 1.5e-6).
+ * \param enable
+ *   \arg 0: Use the distance on a sphere.
+ *   \arg 1: Use the distance on the WGS84 ellipsoid.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_wgs84_point_distance(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    if (execution_options != NULL)
+    {
+        execution_options->wgs84_point_distance = enable;
+    }
+    else
+    {
+        harp_option_wgs84_point_distance = enable;
+    }
+
+    return 0;
+}
+
+/** Retrieve the current setting for the use of the WGS84 ellipsoid for point distance filters.
+ * \see harp_set_option_wgs84_point_distance()
+ * \return
+ *   \arg \c 0, The distance on a sphere is used.
+ *   \arg \c 1, The distance on the WGS84 ellipsoid is used.
+ */
+LIBHARP_API int harp_get_option_wgs84_point_distance(void)
+{
+    if (execution_options != NULL)
+    {
+        return execution_options->wgs84_point_distance;
+    }
+    return harp_option_wgs84_point_distance;
+}
+
+/* Get the options of the program that is being executed by the current thread (NULL if there is none) */
+harp_execution_options *harp_get_execution_options(void)
+{
+    return execution_options;
+}
+
+/* Make the get/set functions of the options in 'options' use 'options' for the current thread instead of the
+ * process-wide values (or use the process-wide values again if 'options' is NULL).
+ */
+void harp_set_execution_options(harp_execution_options *options)
+{
+    execution_options = options;
+}
+
+/** Enable/Disable the use of dataset index files when importing directories into a dataset.
+ * When enabled, harp_dataset_import() will maintain a '.harp_dataset_index' file in each directory that it imports.
+ * This file caches the product metadata of each product file in the directory together with the modification time and
+ * size of the file. On subsequent imports of the same directory the cached metadata is used for all files that have
+ * not changed, such that only new or modified files need to be opened. The index file is updated whenever files were
+ * added, modified, or removed. If the index file cannot be written (e.g. for a read-only directory) a warning is
+ * given and the import continues without caching.
+ * A cached entry is only used if the metadata was retrieved with the same ingestion options.
+ * By default the use of dataset index files is disabled.
+ * The use of dataset index files can also be enabled by setting the HARP_DATASET_INDEX environment variable.
+ * \param enable
+ *   \arg 0: Disable use of dataset index files.
+ *   \arg 1: Enable use of dataset index files.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_enable_dataset_index(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_enable_dataset_index = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for the usage of dataset index files.
+ * \see harp_set_option_enable_dataset_index()
+ * \return
+ *   \arg \c 0, Use of dataset index files is disabled.
+ *   \arg \c 1, Use of dataset index files is enabled.
+ */
+LIBHARP_API int harp_get_option_enable_dataset_index(void)
+{
+    return harp_option_enable_dataset_index;
+}
+
+/** Enable/Disable the reordering of operations when executing a list of operations.
+ * When enabled, filters on existing variables that only reduce the time dimension are executed before any directly
+ * preceding derive() operations that derive each time sample independently (i.e. where time is the first dimension of
+ * the derived variable). This avoids deriving variables for samples that get removed by such a filter anyway, and
+ * allows the moved filters to be combined with filters that come before the derive() operations.
+ * Filters are never moved before a derive() of any of the variables that the filter uses, or before a derive() of the
+ * 'index' variable. Other operations (such as regrid, bin, keep, exclude, rename, etc.) are never reordered.
+ * Note that, if a moved filter removes all samples, the remaining operations are not performed. This means that an
+ * error in one of the derive() operations that was moved after the filter will not be reported in that case.
+ * By default the reordering of operations is disabled.
+ * The reordering of operations can also be enabled by setting the HARP_OPTIMIZE_OPERATIONS environment variable.
+ * \param enable
+ *   \arg 0: Disable reordering of operations.
+ *   \arg 1: Enable reordering of operations.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_optimize_operations(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_optimize_operations = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for the reordering of operations.
+ * \see harp_set_option_optimize_operations()
+ * \return
+ *   \arg \c 0, Reordering of operations is disabled.
+ *   \arg \c 1, Reordering of operations is enabled.
+ */
+LIBHARP_API int harp_get_option_optimize_operations(void)
+{
+    return harp_option_optimize_operations;
+}
+
+/** Enable/Disable keeping single precision floating point data in single precision.
+ * By default, a unit conversion of a variable (e.g. as part of a derive() operation on an existing variable) and the
+ * averaging of a variable by the temporal and spatial binning operations change the data type of the variable to
+ * 'double'. When this option is enabled, variables of type 'float' keep their data type for these operations. The
+ * computations themselves are still performed in double precision; only the stored result is converted back to
+ * single precision. This halves the memory use of such variables (e.g. for many Sentinel-5P and CCI products, whose
+ * ingestion already provides most variables as 'float').
+ * Operations that explicitly specify a data type (such as derive() with a data type) are not affected.
+ * By default this option is disabled.
+ * The option can also be enabled by setting the HARP_KEEP_FLOAT environment variable.
+ * \param enable
+ *   \arg 0: Disable keeping 'float' data in single precision.
+ *   \arg 1: Enable keeping 'float' data in single precision.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_keep_float(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_keep_float = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for keeping single precision floating point data in single precision.
+ * \see harp_set_option_keep_float()
+ * \return
+ *   \arg \c 0, Keeping 'float' data in single precision is disabled.
+ *   \arg \c 1, Keeping 'float' data in single precision is enabled.
+ */
+LIBHARP_API int harp_get_option_keep_float(void)
+{
+    return harp_option_keep_float;
+}
+
+/** Enable/Disable trusting the consistency of imported HARP products.
+ * Each product that is imported by harp_import() (or harp_import_from_memory()) from a file in HARP format is verified
+ * to be internally consistent and to comply with the HARP conventions (see harp_product_verify()). For large products
+ * or large numbers of products (e.g. products that were written by HARP itself and are merged again) the parsing of
+ * all units can take a considerable part of the import time.
+ * When this option is enabled, only the structure of an imported product is verified (names, data types, dimensions,
+ * number of elements, and consistency of the dimension lengths with the product dimensions). The validation of units
+ * and enumeration names is skipped.
+ * Products that are ingested from non-HARP formats are always fully verified.
+ * By default this option is disabled.
+ * The option can also be enabled by setting the HARP_TRUSTED_IMPORT environment variable.
+ * \param enable
+ *   \arg 0: Disable trusted import (fully verify imported products).
+ *   \arg 1: Enable trusted import (only verify the structure of imported products).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_trusted_import(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_trusted_import = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for trusting the consistency of imported HARP products.
+ * \see harp_set_option_trusted_import()
+ * \return
+ *   \arg \c 0, Imported products are fully verified.
+ *   \arg \c 1, Only the structure of imported products is verified.
+ */
+LIBHARP_API int harp_get_option_trusted_import(void)
+{
+    return harp_option_trusted_import;
+}
+
+/** Enable/Disable the profiling mode.
+ * When this option is enabled, HARP records the wall time, the processor time, and the change in the storage size of
+ * the product for each operation that is executed by harp_import() and harp_product_execute_operations() and for each
+ * variable that is read by an ingestion module. The measurements are accumulated per operation type (and per variable
+ * for derive operations and ingested variables) and a summary table is printed to stderr by the final harp_done().
+ * By default this option is disabled.
+ * The option can also be enabled by setting the HARP_PROFILE environment variable.
+ * \param enable
+ *   \arg 0: Disable profiling.
+ *   \arg 1: Enable profiling.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_profile(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_profile = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for the profiling mode.
+ * \see harp_set_option_profile()
+ * \return
+ *   \arg \c 0, Profiling is disabled.
+ *   \arg \c 1, Profiling is enabled.
+ */
+LIBHARP_API int harp_get_option_profile(void)
+{
+    return harp_option_profile;
+}
+
+/** Write a trace of the processing steps performed by HARP to a file.
+ * If enabled, begin and end events are written for each opening of a product by an ingestion module, each variable
+ * that is read by an ingestion module, each operation that is performed on a product, each import and export of a
+ * product, each variable that is exported, each unit conversion of a variable, and each task that is run on a
+ * separate thread. Events from different threads are recorded on separate timelines.
+ * The events are written in the Chrome Trace Event (JSON) format, which can be viewed using e.g. chrome://tracing or
+ * https://ui.perfetto.dev. The trace file is finalized by the final harp_done() or by a next call to this function.
+ * By default tracing is disabled.
+ * Tracing can also be enabled by setting the HARP_TRACE environment variable to the name of the trace file.
+ * \param filename Name of the file to which the trace should be written (an existing file will be overwritten), or
+ * NULL to disable tracing.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_trace(const char *filename)
+{
+    harp_option_trace = 0;
+    harp_trace_close();
+    if (filename == NULL)
+    {
+        return 0;
+    }
+    if (harp_trace_open(filename) != 0)
+    {
+        return -1;
+    }
+    harp_option_trace = 1;
+
+    return 0;
+}
+
+/** Retrieve the name of the file to which the trace is written.
+ * \see harp_set_option_trace()
+ * \return Name of the trace file, or NULL if tracing is disabled.
+ */
+LIBHARP_API const char *harp_get_option_trace(void)
+{
+    return harp_trace_get_filename();
+}
+
+/** Set a limit on the amount of memory that can be used for the data of variables.
+ * HARP keeps track of the memory that is allocated for the data of all variables (see harp_get_memory_usage()).
+ * If a limit is set then any function that would need to allocate variable data beyond this limit (e.g. an import,
+ * an operation, or a merge of products) will fail with a #HARP_ERROR_OUT_OF_MEMORY error instead.
+ * By default there is no limit.
+ * The limit can also be set using the HARP_MEMORY_LIMIT environment variable (in bytes).
+ * \param limit Maximum number of bytes of variable data, or 0 to disable the limit.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_memory_limit(int64_t limit)
+{
+    if (limit < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "limit argument is negative (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_memory_limit = limit;
+
+    return 0;
+}
+
+/** Retrieve the limit on the amount of memory that can be used for the data of variables.
+ * \see harp_set_option_memory_limit()
+ * \return Maximum number of bytes of variable data (0 means that there is no limit).
+ */
+LIBHARP_API int64_t harp_get_option_memory_limit(void)
+{
+    return harp_option_memory_limit;
+}
+
+/** Enable/disable the use of transparent huge pages for large blocks of variable data.
+ * If enabled, blocks of at least 2MB for the data of variables (and for the scratch buffers of ingestions) are
+ * allocated as separate memory mappings for which the operating system is asked to use huge pages (madvise() with
+ * MADV_HUGEPAGE). This reduces TLB misses when processing large products.
+ * This option only has an effect on systems that support it (e.g. Linux) and only applies to the default allocator
+ * (see harp_set_allocator()).
+ * The option can only be changed while no variable data is allocated (i.e. before any product or variable is created,
+ * or after they have all been deleted).
+ * By default huge pages are not used. The option can also be enabled by setting the HARP_HUGE_PAGES environment
+ * variable.
+ * \param enable
+ *   \arg 0: Disable use of huge pages.
+ *   \arg 1: Enable use of huge pages.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_huge_pages(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    if (harp_memory_set_large_block_allocator(enable || harp_option_numa_policy != 0) != 0)
+    {
+        return -1;
+    }
+    harp_option_huge_pages = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for the use of huge pages for large blocks of variable data.
+ * \see harp_set_option_huge_pages()
+ * \return
+ *   \arg 0, Huge pages are not used.
+ *   \arg 1, Huge pages are used.
+ */
+LIBHARP_API int harp_get_option_huge_pages(void)
+{
+    return harp_option_huge_pages;
+}
+
+/** Set the NUMA memory placement policy for large blocks of variable data.
+ * On systems with multiple NUMA nodes (e.g. multi-socket machines), the memory of a large product is by default placed
+ * on the node of the thread that created (and zero filled or read) the data, such that threads on other nodes (e.g.
+ * the worker threads of a parallel operation, see harp_set_option_num_threads()) pay remote memory latency.
+ * With this option, blocks of at least 2MB for the data of variables are allocated as separate memory mappings with:
+ *   - first-touch (1): the memory of new variables is not explicitly zero filled, so each page is placed on the node of
+ *     the thread that first writes to it (e.g. the worker thread that computes that part of the result).
+ *   - interleave (2): the pages are interleaved over all NUMA nodes (this also implies the first-touch behavior for
+ *     zero filling), which gives all threads the same average memory latency.
+ * This option only has an effect on systems that support it (interleaving is only supported on Linux) and only
+ * applies to the default allocator (see harp_set_allocator()).
+ * The option can only be changed while no variable data is allocated (i.e. before any product or variable is created,
+ * or after they have all been deleted).
+ * The policy can also be set using the HARP_NUMA_POLICY environment variable ('first-touch' or 'interleave').
+ * \param policy
+ *   \arg 0: Default allocation (malloc()).
+ *   \arg 1: First-touch placement.
+ *   \arg 2: Interleaved placement.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_numa_policy(int policy)
+{
+    if (policy < 0 || policy > 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "policy argument (%d) is not valid (%s:%u)", policy, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    if (harp_memory_set_large_block_allocator(harp_option_huge_pages || policy != 0) != 0)
+    {
+        return -1;
+    }
+    harp_option_numa_policy = policy;
+
+    return 0;
+}
+
+/** Retrieve the NUMA memory placement policy for large blocks of variable data.
+ * \see harp_set_option_numa_policy()
+ * \return
+ *   \arg 0, Default allocation.
+ *   \arg 1, First-touch placement.
+ *   \arg 2, Interleaved placement.
+ */
+LIBHARP_API int harp_get_option_numa_policy(void)
+{
+    return harp_option_numa_policy;
+}
+
+/** Set the maximum amount of memory that is kept in a pool of released buffers for reuse.
+ * When many products with the same layout are imported one after the other (e.g. by harpmerge, harpcollocate, or a
+ * batch of harpconvert), each import allocates and releases the same set of large variable data buffers and ingestion
+ * scratch buffers. With a buffer pool, released blocks of at least 64KB are kept (with their size rounded up to a
+ * quarter of a power of two) and are handed out again for the next allocation of the same size class, instead of
+ * returning the memory to the system and paging it in again for the next product. Unused blocks are only kept as long
+ * as their total size does not exceed the given size; they are not included in harp_get_memory_usage().
+ * Note that reused blocks are not placed according to harp_set_option_numa_policy() again.
+ * The pool can only be enabled or disabled while no variable data is allocated (i.e. before any product or variable
+ * is created, or after they have all been deleted); the size of an enabled pool can be changed at any moment.
+ * By default no buffer pool is used. The size can also be set using the HARP_BUFFER_POOL_SIZE environment variable
+ * (in bytes).
+ * \param size Maximum number of bytes of unused blocks that are kept, or 0 to disable the buffer pool.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_buffer_pool_size(int64_t size)
+{
+    if (size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "size argument is negative (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (harp_memory_set_buffer_pool_size(size) != 0)
+    {
+        return -1;
+    }
+    harp_option_buffer_pool_size = size;
+
+    return 0;
+}
+
+/** Retrieve the maximum amount of memory that is kept in the pool of released buffers.
+ * \see harp_set_option_buffer_pool_size()
+ * \return Maximum number of bytes of unused blocks that are kept (0 means that the buffer pool is disabled).
+ */
+LIBHARP_API int64_t harp_get_option_buffer_pool_size(void)
+{
+    return harp_option_buffer_pool_size;
+}
+
+/** Set the number of threads that HARP may use internally for a single operation.
+ * This is currently used by spatial binning (harp_product_bin_spatial() and the bin_spatial() operation), which will
+ * then compute the overlap of the sample footprints with the grid cells and sum up the samples into the grid cells
+ * using multiple threads. The result is identical to that of using a single thread.
+ * It is also used when exporting compressed variables to HDF5 (with the deflate filter, or with the zstd or lz4 filter
+ * if HARP was built with libzstd or liblz4), where chunks are then compressed by multiple threads while the already
+ * compressed chunks are written to the file. Similarly, when importing such compressed variables from HDF5, the chunks
+ * are read and then decompressed by multiple threads.
+ * When a directory is added to a dataset (harp_dataset_import()), the metadata of the product files in the directory is
+ * retrieved by multiple threads (each having at most one file open at a time).
+ * All such work is run on a single pool of worker threads that is shared by all operations (also when HARP is used
+ * from multiple application threads at the same time), so parallel operations do not multiply the number of threads.
+ * A parallel operation that is performed as part of another parallel operation is run on a single thread.
+ * By default a single thread is used.
+ * The number of threads can also be set using the HARP_NUM_THREADS environment variable.
+ * If HARP was built without thread support then this option has no effect.
+ * \param num_threads Number of threads (1 .. 1024).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_num_threads(int num_threads)
+{
+    if (num_threads < 1 || num_threads > HARP_MAX_NUM_THREADS)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_threads argument (%d) is not valid (%s:%u)", num_threads,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_num_threads = num_threads;
+
+    return 0;
+}
+
+/** Retrieve the number of threads that HARP may use internally for a single operation.
+ * \see harp_set_option_num_threads()
+ * \return The number of threads.
+ */
+LIBHARP_API int harp_get_option_num_threads(void)
+{
+    return harp_option_num_threads;
+}
+
+/** Set the directory that is used for caching imported products.
+ * When enabled, each product that is imported using harp_import() or harp_import_with_program() is stored as a HARP
+ * netCDF file in the cache directory, after ingestion and after the operations have been performed. A subsequent
+ * import of the same unchanged file with the same ingestion options and operations then reads the product from the
+ * cache instead.
+ * Cache entries are identified by the HARP version, the absolute path, size, and modification time of the file, the
+ * ingestion options, the operations (ignoring whitespace), and the global options that influence the result of an
+ * import (such as harp_set_option_enable_aux_afgl86()). Imports with a program that was not created using
+ * harp_program_from_string() or that contains operations that read other files (such as collocation filters or area
+ * filters with a polygon file) and imports that result in an empty product are not cached.
+ * When the total size of the cache exceeds the limit (see harp_set_option_product_cache_size()) the least recently
+ * used entries are removed. The cache directory can be shared by multiple processes.
+ * By default the product cache is disabled.
+ * The product cache can also be enabled by setting the HARP_PRODUCT_CACHE environment variable to the cache directory.
+ * \see harp_get_product_cache_statistics()
+ * \param directory Path to an existing directory in which the cache entries are stored, or NULL to disable caching.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_product_cache(const char *directory)
+{
+    return harp_product_cache_set_directory(directory);
+}
+
+/** Retrieve the directory that is used for caching imported products.
+ * \see harp_set_option_product_cache()
+ * \return Path of the cache directory, or NULL if the product cache is disabled.
+ */
+LIBHARP_API const char *harp_get_option_product_cache(void)
+{
+    return harp_product_cache_get_directory();
+}
+
+/** Set the maximum total size of the product cache.
+ * By default the size of the cache is limited to 1GB.
+ * The limit can also be set using the HARP_PRODUCT_CACHE_SIZE environment variable (in bytes).
+ * \see harp_set_option_product_cache()
+ * \param size Maximum number of bytes of all cached products together.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_product_cache_size(int64_t size)
+{
+    if (size <= 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "size argument is not positive (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_product_cache_size = size;
+
+    return 0;
+}
+
+/** Retrieve the maximum total size of the product cache.
+ * \see harp_set_option_product_cache_size()
+ * \return Maximum number of bytes of all cached products together.
+ */
+LIBHARP_API int64_t harp_get_option_product_cache_size(void)
+{
+    return harp_option_product_cache_size;
+}
+
+/** Set the maximum total size of the in-memory cache of collocated products.
+ * Operations that use a collocated dataset, such as regrid() and smooth(), import the collocated product for each
+ * product that they get applied to. The imported collocated products are kept in memory (up to the given total size)
+ * such that products that collocate with the same collocated product (e.g. the file of a ground station) do not need
+ * to import it again. The cache is checked against the modification time and size of the file.
+ * By default the size of the cache is limited to 256MB.
+ * The limit can also be set using the HARP_COLLOCATED_PRODUCT_CACHE_SIZE environment variable (in bytes).
+ * Setting the size will clear the cache.
+ * \param size Maximum number of bytes of all cached collocated products together (0 disables the cache).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_collocated_product_cache_size(int64_t size)
+{
+    if (size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "size argument is negative (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_collocated_product_cache_clear();
+    harp_option_collocated_product_cache_size = size;
+
+    return 0;
+}
+
+/** Retrieve the maximum total size of the in-memory cache of collocated products.
+ * \see harp_set_option_collocated_product_cache_size()
+ * \return Maximum number of bytes of all cached collocated products together.
+ */
+LIBHARP_API int64_t harp_get_option_collocated_product_cache_size(void)
+{
+    return harp_option_collocated_product_cache_size;
+}
+
+/** Set the accuracy of the median and percentile aggregations of the binning operations.
+ * Medians and percentiles (e.g. bin_spatial() with a 'variable:median,p90' aggregation, or the percentile
+ * aggregations of a spatial accumulator) are estimated using a t-digest sketch per grid cell. The compression
+ * determines the maximum number of centroids that such a sketch keeps after compressing (at most about compression/2,
+ * with a buffer of 2 * compression centroids per cell in the worst case). Higher values give more accurate estimates
+ * at the cost of more memory and processing time. Cells with fewer samples than the compression give (nearly) exact
+ * results. Estimates near the tails of the distribution (e.g. p1 or p99) are more accurate than those near the median.
+ * By default a compression of 100 is used.
+ * The compression can also be set using the HARP_PERCENTILE_COMPRESSION environment variable.
+ * \param compression Compression of the sketches (10 .. 10000).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_percentile_compression(int compression)
+{
+    if (compression < HARP_MIN_PERCENTILE_COMPRESSION || compression > HARP_MAX_PERCENTILE_COMPRESSION)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "compression argument (%d) is not valid (%s:%u)", compression,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_percentile_compression = compression;
+
+    return 0;
+}
+
+/** Retrieve the compression of the sketches that are used for the median and percentile aggregations.
+ * \see harp_set_option_percentile_compression()
+ * \return The compression.
+ */
+LIBHARP_API int harp_get_option_percentile_compression(void)
+{
+    return harp_option_percentile_compression;
+}
+
+/** Initializes the HARP C library.
+ * This function should be called before any other HARP C library function is called (except for
+ * harp_set_coda_definition_path(), harp_set_coda_definition_path_conditional(), and harp_set_warning_handler()).
+ *
+ * HARP may at some point after calling harp_init() also initialize the underlying CODA C library that is used for
+ * ingestion of products that are not using the HARP format.
+ * The CODA C library may require access to .codadef files that describe the formats of certain product files.
+ * In order to tell CODA where these .codadef files are located you will have to either set the CODA_DEFINITION
+ * environment variable to the proper path, or set the path programmatically using the
+ * harp_set_coda_definition_path() or harp_set_coda_definition_path_conditional() function, before calling harp_init()
+ * for the first time.
+ *
+ * If you use CODA functions directly in combination with HARP functions you should call coda_init() and coda_done()
+ * explicitly yourself and not rely on HARP having performed the coda_init() for you.
+ *
+ * It is valid to perform multiple calls to harp_init() after each other. Only the first call to harp_init() will do
+ * the actual initialization and all following calls to harp_init() will only increase an initialization counter. Each
+ * call to harp_init() needs to be matched by a call to harp_done() at clean-up time (i.e. the number of calls to
+ * harp_done() needs to be equal to the number of calls to harp_init()). Only the final harp_done() call (when the
+ * initialization counter has reached 0) will perform the actual clean-up of the HARP C library.
+ *
+ * The HARP C library can be used from multiple threads at the same time (e.g. to import several products in
+ * parallel), provided that harp_init() has been called before any of the threads start using HARP and that harp_done()
+ * is only called after all threads have finished. The error state (#harp_errno and the error message) is kept
+ * separately for each thread. Note that all reading and writing of product files (via the netCDF, HDF4, HDF5, and
+ * CODA libraries) is serialized internally, since these underlying libraries are not thread-safe. The functions to
+ * set global options (such as harp_set_option_hdf5_compression()) and harp_set_warning_handler() are not thread-safe
+ * and should only be called before any threads are started.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_init(void)
+{
+    harp_mutex_lock(&harp_init_mutex);
+    if (harp_init_counter == 0)
+    {
+        if (auxiliary_data_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (dataset_index_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (optimize_operations_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (keep_float_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (trusted_import_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (profile_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (trace_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (memory_limit_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (memory_allocation_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (num_threads_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (percentile_compression_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        if (product_cache_init() != 0)
+        {
+            harp_mutex_unlock(&harp_init_mutex);
+            return -1;
+        }
+        /* the list of derived variable conversions and the ingestion modules are initialized on first use */
+    }
+
+    harp_init_counter++;
+    harp_mutex_unlock(&harp_init_mutex);
+
+    return 0;
+}
+
+/** Finalizes the HARP C library.
+ * This function should be called to let the HARP C library free up any resources it has claimed since initialization.
+ *
+ * It is valid to perform multiple calls to harp_init() after each other. Only the first call to harp_init() will do
+ * the actual initialization and all following calls to harp_init() will only increase an initialization counter. Each
+ * call to harp_init() needs to be matched by a call to harp_done() at clean-up time (i.e. the number of calls to
+ * harp_done() needs to be equal to the number of calls to harp_init()). Only the final harp_done() call (when the
+ * initialization counter has reached 0) will perform the actual clean-up of the HARP C library.
+ *
+ * Calling a HARP function other than harp_init() after the final harp_done() call will result in undefined behavior.
+ */
+LIBHARP_API void harp_done(void)
+{
+    harp_mutex_lock(&harp_init_mutex);
+    if (harp_init_counter > 0)
+    {
+        harp_init_counter--;
+        if (harp_init_counter == 0)
+        {
+            harp_profile_done();
+            harp_option_trace = 0;
+            harp_trace_close();
+            harp_unit_done();
+            harp_derived_variable_list_done();
+            harp_collocated_product_cache_clear();
+            harp_ingestion_done();
+            harp_thread_done();
+        }
+    }
+    harp_mutex_unlock(&harp_init_mutex);
+}
+
+/** @} */
+
+/* Import a file that uses the HARP format; should be called with the file access lock held.
+ * Fails with HARP_ERROR_UNSUPPORTED_PRODUCT if the file is not a HARP product.
+ */
+static int import_harp_product(const char *filename, file_format format, harp_program *program,
+                               harp_product **product)
+{
+    switch (format)
+    {
+        case format_hdf4:
+#ifdef HAVE_HDF4
+            return harp_import_hdf4(filename, program, product);
+#else
+            break;
+#endif
+        case format_hdf5:
+#ifdef HAVE_HDF5
+            return harp_import_hdf5(filename, program, product);
+#else
+            break;
+#endif
+        case format_netcdf:
+            return harp_import_netcdf(filename, program, product);
+        case format_zarr:
+            return harp_import_zarr(filename, program, product);
+        default:
+            break;
+    }
+
+    harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+    return -1;
+}
+
+static int import_file(const char *filename, harp_program *program, const char *options, harp_product **product)
+{
+    harp_product *imported_product;
+#ifdef HAVE_HDF5
+    harp_hdf5_file *held_file = NULL;
+#endif
+    file_format format;
+    int result;
+
+    if (determine_file_format(filename, &format) != 0)
+    {
+        return -1;
+    }
+
+    file_access_lock();
+#ifdef HAVE_HDF5
+    if (format == format_hdf5)
+    {
+        /* keep a non-HARP file open during ingestion, such that CODA reuses the file that the HDF5 library already
+         * opened for the HARP product check */
+        result = harp_import_hdf5_or_hold(filename, program, &imported_product, &held_file);
+    }
+    else
+#endif
+    {
+        result = import_harp_product(filename, format, program, &imported_product);
+    }
+    if (result != 0)
+    {
+        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
+        {
+            file_access_unlock();
+            return -1;
+        }
+
+        /* try ingest */
+        result = check_ingestable(filename);
+        if (result == 0)
+        {
+            result = harp_ingest(filename, program, options, &imported_product);
+        }
+#ifdef HAVE_HDF5
+        harp_hdf5_release_file(held_file);
+#endif
+        file_access_unlock();
+        if (result != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        file_access_unlock();
+
+        if ((harp_option_trusted_import ? harp_product_verify_structure(imported_product) :
+             harp_product_verify(imported_product)) != 0)
+        {
+            harp_product_delete(imported_product);
+            return -1;
+        }
+
+        /* set source_product if it was empty; we need this for the 'collocate_xxx()' operations to work */
+        if (imported_product->source_product == NULL)
+        {
+            if (harp_product_set_source_product(imported_product, filename) != 0)
+            {
+                harp_product_delete(imported_product);
+                return -1;
+            }
+        }
+
+        if (program != NULL)
+        {
+            harp_program_start_execution(program);
+            if (harp_product_execute_program(imported_product, program) != 0)
+            {
+                harp_program_end_execution(program);
+                harp_product_delete(imported_product);
+                return -1;
+            }
+            harp_program_end_execution(program);
+        }
+    }
+
+    *product = imported_product;
+
+    return 0;
+}
+
+static int import_product(const char *filename, harp_program *program, const char *options, harp_product **product)
+{
+    char *cache_path;
+    int result;
+
+    if (harp_product_cache_get_entry_path(filename, program, options, &cache_path) != 0)
+    {
+        return -1;
+    }
+
+    harp_trace_begin("import(%s)", filename);
+    if (cache_path != NULL && harp_product_cache_has_entry(cache_path))
+    {
+        if (import_file(cache_path, NULL, NULL, product) == 0)
+        {
+            harp_trace_end();
+            free(cache_path);
+            return 0;
+        }
+        harp_product_cache_remove_entry(cache_path);
+    }
+    result = import_file(filename, program, options, product);
+    harp_trace_end();
+
+    if (result == 0 && cache_path != NULL)
+    {
+        harp_product_cache_add_entry(cache_path, *product);
+    }
+    if (cache_path != NULL)
+    {
+        free(cache_path);
+    }
+
+    return result;
+}
+
+/** Import a product from a file.
+ * \ingroup harp_product
+ * This will first try to import the file as an HDF4, HDF5, or netCDF file that complies to the HARP Data Format.
+ * If the file is not stored using the HARP format then it will try to import it using one of the available ingestion
+ * modules.
+ * The \a options parameter is optional (can be NULL) and describes the ingestion options. The parameter is only
+ * applicable if the file is not already using the HARP format and needs to be converted using one of the ingestion
+ * modules.
+ * The \a operations parameter is optional (can be NULL) and provides the list of operations that will be performed as
+ * part of the import. Some operations, such as filters, can already be performed as part of an import and this may thus
+ * be faster than using a harp_product_execute_operations() after a full import of the product.
+ * Instead of a path, \a filename can also be an s3://, http://, or https:// url of a HARP product in HDF5 format that
+ * is stored in (S3 compatible) object storage. Only the parts of the file that are needed are then transferred, using
+ * ranged reads via the read-only S3 driver of HDF5. The AWS_REGION, AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY, and
+ * AWS_ENDPOINT_URL environment variables are used to configure the access.
+ * \param[in] filename Path to the file that is to be imported.
+ * \param[in] operations string (optional) containing actions to apply as part of the import; should be specified as a
+ * semi-colon separated string of operations.
+ * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used if the file is not in HARP format. The option 'module=<name>' can be used to
+ * select the ingestion module directly, which skips the product type detection.
+ * \param[out] product Pointer to a location where a pointer to the ingested product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import(const char *filename, const char *operations, const char *options, harp_product **product)
+{
+    harp_program *program = NULL;
+    int result;
+
+    if (operations != NULL)
+    {
+        if (harp_program_from_string(operations, &program) != 0)
+        {
+            return -1;
+        }
+    }
+
+    result = import_product(filename, program, options, product);
+
+    harp_program_delete(program);
+
+    return result;
+}
+
+/** Import a product from a file using a compiled set of operations.
+ * \ingroup harp_product
+ * This function is the same as harp_import(), except that the operations are provided as a program that was created
+ * using harp_program_from_string(). When importing many files using the same operations this avoids having to parse
+ * the operations again for each file. The program can be used again for any subsequent imports.
+ * Note that a program should not be used by multiple threads at the same time.
+ * \param[in] filename Path to the file that is to be imported.
+ * \param[in] program Compiled operations (optional) to apply as part of the import.
+ * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used if the file is not in HARP format. The option 'module=<name>' can be used to
+ * select the ingestion module directly, which skips the product type detection.
+ * \param[out] product Pointer to a location where a pointer to the ingested product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_with_program(const char *filename, harp_program *program, const char *options,
+                                         harp_product **product)
+{
+    return import_product(filename, program, options, product);
+}
+
+static int program_has_collocation_filter(const harp_program *program)
+{
+    int i;
+
+    for (i = 0; i < program->num_operations; i++)
+    {
+        if (program->operation[i]->type == operation_collocation_filter)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/** Close an import stream.
+ * \ingroup harp_product
+ * This releases all resources of the stream (and closes the underlying file). Products that were returned by
+ * harp_import_stream_next() are not affected.
+ * \param[in] stream Import stream that should be closed.
+ */
+LIBHARP_API void harp_import_stream_close(harp_import_stream *stream)
+{
+    if (stream != NULL)
+    {
+        if (stream->ingest_stream != NULL)
+        {
+            file_access_lock();
+            harp_ingest_stream_close(stream->ingest_stream);
+            file_access_unlock();
+        }
+        harp_product_delete(stream->product);
+        harp_program_delete(stream->program);
+        free(stream);
+    }
+}
+
+/** Open a product for import in chunks along the time dimension.
+ * \ingroup harp_product
+ * This allows processing of products that are too large to be imported as a whole. Each call to
+ * harp_import_stream_next() returns a product that contains (at most) \a chunk_size consecutive time samples of the
+ * product, with the \a operations applied to it. The concatenation of all returned products is equal to the result of
+ * harp_import() with the same operations.
+ * Because the operations are performed on each chunk separately, only operations that treat each time sample
+ * independently are allowed (e.g. bin(), sort(), and regrid() or flatten() along the time dimension are not allowed).
+ * Products that are not in HARP format are read in chunks by the ingestion module, such that only the data of a single
+ * chunk is kept in memory. Products that are already in HARP format are imported as a whole (taking into account
+ * any leading filters) and are then only provided in chunks; this does not reduce the required amount of memory.
+ * The file stays open until the stream is closed with harp_import_stream_close().
+ * \param[in] filename Path to the file that is to be imported.
+ * \param[in] operations string (optional) containing actions to apply to each chunk; should be specified as a
+ * semi-colon separated string of operations.
+ * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used if the file is not in HARP format. The option 'module=<name>' can be used to
+ * select the ingestion module directly, which skips the product type detection.
+ * \param[in] chunk_size Maximum number of time samples that is read for each chunk.
+ * \param[out] new_stream Pointer to a location where a pointer to the new import stream will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_stream_open(const char *filename, const char *operations, const char *options,
+                                        long chunk_size, harp_import_stream **new_stream)
+{
+    harp_import_stream *stream;
+    file_format format;
+    int result;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (chunk_size <= 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid chunk size (%ld) (%s:%u)", chunk_size, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    if (new_stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "new_stream is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (determine_file_format(filename, &format) != 0)
+    {
+        return -1;
+    }
+
+    stream = (harp_import_stream *)malloc(sizeof(harp_import_stream));
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_import_stream), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->program = NULL;
+    stream->ingest_stream = NULL;
+    stream->product = NULL;
+    stream->chunk_size = chunk_size;
+    stream->offset = 0;
+
+    if (operations != NULL)
+    {
+        result = harp_program_from_string(operations, &stream->program);
+    }
+    else
+    {
+        result = harp_program_new(&stream->program);
+    }
+    if (result != 0)
+    {
+        harp_import_stream_close(stream);
+        return -1;
+    }
+    if (harp_program_verify_sample_independent(stream->program) != 0)
+    {
+        harp_import_stream_close(stream);
+        return -1;
+    }
+
+    file_access_lock();
+    result = import_harp_product(filename, format, stream->program, &stream->product);
+    if (result != 0)
+    {
+        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
+        {
+            file_access_unlock();
+            harp_import_stream_close(stream);
+            return -1;
+        }
+
+        /* try ingest */
+        if (check_ingestable(filename) != 0 ||
+            harp_ingest_stream_open(filename, stream->program, options, chunk_size, &stream->ingest_stream) != 0)
+        {
+            file_access_unlock();
+            harp_import_stream_close(stream);
+            return -1;
+        }
+        file_access_unlock();
+    }
+    else
+    {
+        file_access_unlock();
+
+        if (harp_product_verify(stream->product) != 0)
+        {
+            harp_import_stream_close(stream);
+            return -1;
+        }
+
+        /* set source_product if it was empty; we need this for the 'collocate_xxx()' operations to work */
+        if (stream->product->source_product == NULL)
+        {
+            if (harp_product_set_source_product(stream->product, filename) != 0)
+            {
+                harp_import_stream_close(stream);
+                return -1;
+            }
+        }
+
+        /* a collocation filter on a chunk can not use the position of a sample in the chunk as its index, so we
+         * make sure the index of each sample in the full product is available */
+        if (program_has_collocation_filter(stream->program) && !harp_product_has_variable(stream->product, "index")
+            && !harp_product_has_variable(stream->product, "collocation_index"))
+        {
+            harp_dimension_type dimension_type = harp_dimension_time;
+
+            if (harp_product_add_derived_variable(stream->product, "index", NULL, NULL, 1, &dimension_type) != 0)
+            {
+                harp_import_stream_close(stream);
+                return -1;
+            }
+        }
+    }
+
+    *new_stream = stream;
+    return 0;
+}
+
+/** Import the next chunk of an import stream.
+ * \ingroup harp_product
+ * Chunks that are empty after applying the operations are skipped. Once all chunks have been returned, \a product
+ * will be set to NULL.
+ * Products without a time dimension are returned as a single chunk.
+ * \param[in] stream Import stream from which the next chunk should be imported.
+ * \param[out] product Pointer to a location where a pointer to the imported chunk will be stored (or NULL if there
+ * are no more chunks).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_stream_next(harp_import_stream *stream, harp_product **product)
+{
+    long num_samples;
+
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "stream is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (stream->ingest_stream != NULL)
+    {
+        int result;
+
+        file_access_lock();
+        result = harp_ingest_stream_next(stream->ingest_stream, product);
+        file_access_unlock();
+
+        return result;
+    }
+
+    /* a product without time dimension is provided as a single chunk */
+    num_samples = stream->product->dimension[harp_dimension_time];
+    if (num_samples == 0)
+    {
+        num_samples = 1;
+    }
+
+    while (stream->offset < num_samples)
+    {
+        harp_product *chunk;
+        long length;
+
+        length = num_samples - stream->offset;
+        if (length > stream->chunk_size)
+        {
+            length = stream->chunk_size;
+        }
+
+        if (harp_product_get_time_slice(stream->product, stream->offset, length, &chunk) != 0)
+        {
+            return -1;
+        }
+        stream->offset += length;
+
+        harp_program_start_execution(stream->program);
+        if (harp_product_execute_program(chunk, stream->program) != 0)
+        {
+            harp_program_end_execution(stream->program);
+            harp_product_delete(chunk);
+            return -1;
+        }
+        harp_program_end_execution(stream->program);
+
+        if (!harp_product_is_empty(chunk))
+        {
+            *product = chunk;
+            return 0;
+        }
+        harp_product_delete(chunk);
+    }
+
+    *product = NULL;
+    return 0;
+}
+
+/** Test import of a product.
+ * \ingroup harp_product
+ * If the product is a HARP product then verify that the product is a HARP compliant netCDF/HDF4/HDF5 product.
+ * Otherwise, try to import the product using an applicable ingestion module and test the ingestion for all possible
+ * ingestion options.
+ * Results are printed using the provided \a print function.
+ * The \a print function parameter should be a function that resembles printf().
+ * \param[in] filename Filename of the product to import.
+ * \param[in] print Reference to a printf compatible function.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c 1, Import failed (error is already printed, #harp_errno should be ignored).
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_test(const char *filename, int (*print) (const char *, ...))
+{
+    harp_product *product;
+    file_format format;
+    int result;
+
+    print("product: %s\n", filename);
+
+    if (determine_file_format(filename, &format) != 0)
+    {
+        return -1;
+    }
+
+    file_access_lock();
+    switch (format)
+    {
+        case format_hdf4:
+#ifdef HAVE_HDF4
+            result = harp_import_hdf4(filename, NULL, &product);
+#else
+            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+            result = -1;
+#endif
+            break;
+        case format_hdf5:
+#ifdef HAVE_HDF5
+            result = harp_import_hdf5(filename, NULL, &product);
+#else
+            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+            result = -1;
+#endif
+            break;
+        case format_netcdf:
+            result = harp_import_netcdf(filename, NULL, &product);
+            break;
+        case format_zarr:
+            result = harp_import_zarr(filename, NULL, &product);
+            break;
+        default:
+            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+            result = -1;
+    }
+
+    if (result != 0)
+    {
+        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
+        {
+            file_access_unlock();
+            return -1;
+        }
+        /* try ingest */
+        result = harp_ingest_test(filename, print);
+        file_access_unlock();
+        return result;
+    }
+    file_access_unlock();
+
+    print("import:");
+    if (harp_product_verify(product) != 0)
+    {
+        print(" [FAIL]\n");
+        print("ERROR: %s\n", harp_errno_to_string(harp_errno));
+        harp_product_delete(product);
+        return 1;
+    }
+    print(" [OK]\n");
+
+    harp_product_delete(product);
+
+    return 0;
+}
+
+/** Measure the import performance of a product.
+ * \ingroup harp_product
+ * If the product is a HARP product then the time needed for importing the product is reported.
+ * Otherwise, the product is ingested using the applicable ingestion module and the ingestion module, product
+ * definition, the time spent on opening and reading the product, the file size, and the size of the ingested data are
+ * reported. If \a show_variables is set, the read time and size of each ingested variable is reported as well.
+ * Results are printed using the provided \a print function.
+ * The \a print function parameter should be a function that resembles printf().
+ * \param[in] filename Filename of the product to import.
+ * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pairs; only used if the file is not in HARP format.
+ * \param[in] show_variables Whether to report timings for each variable (only for ingestion).
+ * \param[in] print Reference to a printf compatible function.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_benchmark(const char *filename, const char *options, int show_variables,
+                                      int (*print) (const char *, ...))
+{
+    harp_product *product;
+    file_format format;
+    int64_t file_size;
+    int64_t data_size;
+    double start_time;
+    double start_cpu_time;
+    double import_time;
+    double cpu_time;
+    int result;
+
+    print("product: %s\n", filename);
+
+    if (determine_file_format(filename, &format) != 0)
+    {
+        return -1;
+    }
+    if (harp_get_file_size(filename, &file_size) != 0)
+    {
+        return -1;
+    }
+
+    file_access_lock();
+    start_time = harp_get_wall_time();
+    start_cpu_time = harp_get_cpu_time();
+    result = import_harp_product(filename, format, NULL, &product);
+    import_time = harp_get_wall_time() - start_time;
+    cpu_time = harp_get_cpu_time() - start_cpu_time;
+    if (result != 0)
+    {
+        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
+        {
+            file_access_unlock();
+            return -1;
+        }
+        result = harp_ingest_benchmark(filename, options, show_variables, print);
+        file_access_unlock();
+        return result;
+    }
+    file_access_unlock();
+
+    if (harp_product_get_storage_size(product, 0, &data_size) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+
+    print("format: HARP (%s)\n", format == format_hdf4 ? "hdf4" : format == format_hdf5 ? "hdf5" :
+          format == format_netcdf ? "netcdf" : "zarr");
+    print("file size: %ld bytes\n", (long)file_size);
+    print("imported data size: %ld bytes\n", (long)data_size);
+    print("number of variables: %d\n", product->num_variables);
+    print("read time: %.6f s\n", import_time);
+    print("cpu time: %.6f s\n", cpu_time);
+    if (import_time > 0)
+    {
+        print("throughput: %.3f MB/s (file), %.3f MB/s (imported data)\n", file_size / import_time / 1.0e6,
+              data_size / import_time / 1.0e6);
+    }
+
+    harp_product_delete(product);
+
+    return 0;
+}
+
+/** Retrieve global attributes from a product file.
+ * \ingroup harp_product
+ * This function retrieves the product metadata without performing a full import.
+ * As with harp_import(), \a filename can also be a url of a HARP product in HDF5 format in remote object storage.
+ * \param filename Path to the file for which to retrieve global attributes.
+ * \param options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used if the file is not in HARP format. The option 'module=<name>' can be used to
+ * select the ingestion module directly, which skips the product type detection.
+ * \param new_metadata Pointer to the variable where the metadata should be stored.
+ * \return
+ *   \arg \c 0, Succes.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_product_metadata(const char *filename, const char *options,
+                                             harp_product_metadata **new_metadata)
+{
+    harp_product_metadata *metadata = NULL;
+    double spatial_extent[4];
+    file_format format;
+    int result;
+    int i;
+
+    if (determine_file_format(filename, &format) != 0)
+    {
+        return -1;
+    }
+
+    /* the spatial extent is only available for HARP files that have it stored as global attributes */
+    for (i = 0; i < 4; i++)
+    {
+        spatial_extent[i] = harp_nan();
+    }
+
+    if (harp_product_metadata_new(&metadata) != 0)
+    {
+        return -1;
+    }
+
+    /* set the filename attr */
+    metadata->filename = strdup(filename);
+    if (!metadata->filename)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_product_metadata_delete(metadata);
+        return -1;
+    }
+
+    file_access_lock();
+    switch (format)
+    {
+        case format_hdf4:
+#ifdef HAVE_HDF4
+            result = harp_import_global_attributes_hdf4(filename, &metadata->datetime_start, &metadata->datetime_stop,
+                                                        spatial_extent, metadata->dimension, &metadata->source_product);
+#else
+            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+            result = -1;
+#endif
+            break;
+        case format_hdf5:
+#ifdef HAVE_HDF5
+            result = harp_import_global_attributes_hdf5(filename, &metadata->datetime_start, &metadata->datetime_stop,
+                                                        spatial_extent, metadata->dimension, &metadata->source_product);
+#else
+            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+            result = -1;
+#endif
+            break;
+        case format_netcdf:
+            result = harp_import_global_attributes_netcdf(filename, &metadata->datetime_start, &metadata->datetime_stop,
+                                                          spatial_extent, metadata->dimension,
+                                                          &metadata->source_product);
+            break;
+        case format_zarr:
+            result = harp_import_global_attributes_zarr(filename, &metadata->datetime_start, &metadata->datetime_stop,
+                                                        spatial_extent, metadata->dimension, &metadata->source_product);
+            break;
+        default:
+            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+            result = -1;
+    }
+
+    if (result != 0 && harp_errno == HARP_ERROR_UNSUPPORTED_PRODUCT)
+    {
+        /* try ingest */
+        result = check_ingestable(filename);
+        if (result == 0)
+        {
+            result = harp_ingest_global_attributes(filename, options, &metadata->datetime_start,
+                                                   &metadata->datetime_stop, metadata->dimension,
+                                                   &metadata->source_product);
+        }
+    }
+    file_access_unlock();
+    if (result != 0)
+    {
+        harp_product_metadata_delete(metadata);
+        return -1;
+    }
+    metadata->latitude_min = spatial_extent[0];
+    metadata->latitude_max = spatial_extent[1];
+    metadata->longitude_min = spatial_extent[2];
+    metadata->longitude_max = spatial_extent[3];
+
+    *new_metadata = metadata;
+
+    return 0;
+}
+
+/** Hint that a product file is going to be imported soon.
+ * \ingroup harp_product
+ * This asks the operating system to start reading the content of the file into its file cache in the background
+ * (using posix_fadvise() with POSIX_FADV_WILLNEED), such that a later import of the file does not have to wait for
+ * the storage. This is mainly useful for files on network file systems when the next products of a dataset are known
+ * in advance. The function returns immediately and any problem (including the absence of support for this on the
+ * platform) is silently ignored.
+ * \param filename Path to the file that is going to be imported.
+ */
+LIBHARP_API void harp_prefetch_file(const char *filename)
+{
+#ifdef HAVE_POSIX_FADVISE
+    int fd;
+
+    if (filename == NULL)
+    {
+        return;
+    }
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+#else
+    (void)filename;
+#endif
+}
+
+/** Export HARP product to a file.
+ * \ingroup harp_product
+ * Export product to an HDF4, HDF5, or netCDF file that complies to the HARP Data Format.
+ * With the "zarr" format the product is exported as a Zarr store, which is a directory (that should not exist yet)
+ * containing a separate file for each chunk of each variable (see harp_set_option_zarr_chunk_size()).
+ * With the "arrow" format the product is exported as an Arrow IPC file with a column for each variable and a row for
+ * each time sample (which requires that all variables depend on the time dimension); such a file can only be used
+ * for analysis with other tools and can not be imported by HARP.
+ * \param filename Path to the file to which the product is to be exported.
+ * \param export_format Either "hdf4", "hdf5", "netcdf", "zarr", or "arrow".
+ * \param product Product that should be exported to file.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_export(const char *filename, const char *export_format, const harp_product *product)
+{
+    file_format format;
+    int result;
+
+    format = format_from_string(export_format);
+    if (format == format_unknown)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unsupported export format '%s'", export_format);
+        return -1;
+    }
+
+    harp_trace_begin("export(%s)", filename);
+    file_access_lock();
+    switch (format)
+    {
+        case format_hdf4:
+#ifdef HAVE_HDF4
+            result = harp_export_hdf4(filename, product);
+#else
+            coda_set_error(HARP_ERROR_NO_HDF4_SUPPORT, NULL);
+            result = -1;
+#endif
+            break;
+        case format_hdf5:
+#ifdef HAVE_HDF5
+            result = harp_export_hdf5(filename, product);
+#else
+            coda_set_error(HARP_ERROR_NO_HDF5_SUPPORT, NULL);
+            result = -1;
+#endif
+            break;
+        case format_netcdf:
+            result = harp_export_netcdf(filename, product);
+            break;
+        case format_zarr:
+            result = harp_export_zarr(filename, product);
+            break;
+        case format_arrow:
+            result = harp_export_arrow(filename, product);
+            break;
+        default:
+            assert(0);
+            exit(1);
+    }
+    file_access_unlock();
+    harp_trace_end();
+
+    return result;
+}
+
+/** Export a HARP product after applying operations to it, leaving the product itself unmodified.
+ * \ingroup harp_product
+ * The result is the same as exporting the product after performing the operations on a copy of the product (see
+ * harp_product_execute_operations()).
+ * If the operations only consist of keep() and exclude() operations (e.g. to write several subsets of the variables of
+ * a single product to different files) then the selected variables are exported directly from \a product, without
+ * copying or modifying any variable. For any other operations, the operations are performed on a copy of the product
+ * whose variables share their data with \a product (see harp_product_copy_shared()), so only the data of the variables
+ * that the operations modify gets duplicated.
+ * \param filename Filename of the exported product.
+ * \param export_format File format to use (see harp_export()).
+ * \param product Product that should be exported.
+ * \param operations String containing the operations to apply before exporting the product (can be NULL).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_export_with_operations(const char *filename, const char *export_format, const harp_product *product,
+                                            const char *operations)
+{
+    harp_program *program;
+    harp_product *product_copy;
+    uint8_t *include;
+    int result;
+    int i, j;
+
+    if (operations == NULL || operations[0] == '\0')
+    {
+        return harp_export(filename, export_format, product);
+    }
+
+    if (harp_program_from_string(operations, &program) != 0)
+    {
+        return -1;
+    }
+
+    include = (uint8_t *)malloc((product->num_variables > 0 ? product->num_variables : 1) * sizeof(uint8_t));
+    if (include == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(uint8_t), __FILE__, __LINE__);
+        harp_program_delete(program);
+        return -1;
+    }
+
+    result = harp_program_get_projected_variables(program, product, include);
+    if (result == 1)
+    {
+        harp_product view;
+
+        /* export a view on the product that only refers to the selected variables */
+        memset(&view, 0, sizeof(harp_product));
+        view.source_product = product->source_product;
+        view.history = product->history;
+        view.variable = (harp_variable **)malloc((product->num_variables > 0 ? product->num_variables : 1) *
+                                                 sizeof(harp_variable *));
+        if (view.variable == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           product->num_variables * sizeof(harp_variable *), __FILE__, __LINE__);
+            free(include);
+            harp_program_delete(program);
+            return -1;
+        }
+        for (i = 0; i < product->num_variables; i++)
+        {
+            harp_variable *variable = product->variable[i];
+
+            if (!include[i])
+            {
+                continue;
+            }
+            view.variable[view.num_variables] = variable;
+            view.num_variables++;
+            /* only the dimensions that the remaining variables depend on are part of the product */
+            for (j = 0; j < variable->num_dimensions; j++)
+            {
+                if (variable->dimension_type[j] != harp_dimension_independent)
+                {
+                    view.dimension[variable->dimension_type[j]] = product->dimension[variable->dimension_type[j]];
+                }
+            }
+        }
+        result = harp_export(filename, export_format, &view);
+        free(view.variable);
+    }
+    else if (result == 0)
     {
-        harp_init_counter--;
-        if (harp_init_counter == 0)
+        result = -1;
+        if (harp_product_copy_shared(product, &product_copy) == 0)
         {
-            harp_unit_done();
-            harp_derived_variable_list_done();
-            harp_ingestion_done();
+            if (harp_product_execute_program(product_copy, program) == 0)
+            {
+                result = harp_export(filename, export_format, product_copy);
+            }
+            harp_product_delete(product_copy);
         }
     }
-}
 
-/** @} */
+    free(include);
+    harp_program_delete(program);
 
-/** Import a product from a file.
+    return result;
+}
+
+/** Import a product from a memory buffer.
  * \ingroup harp_product
- * This will first try to import the file as an HDF4, HDF5, or netCDF file that complies to the HARP Data Format.
- * If the file is not stored using the HARP format then it will try to import it using one of the available ingestion
- * modules.
- * The \a options parameter is optional (can be NULL) and describes the ingestion options. The parameter is only
- * applicable if the file is not already using the HARP format and needs to be converted using one of the ingestion
- * modules.
+ * The buffer should contain the full content of an HDF5 or netCDF file that complies to the HARP Data Format (e.g.
+ * as produced by harp_export_to_memory()). Importing non-HARP products (using the ingestion modules) and HARP
+ * products stored as HDF4 is not supported from memory.
+ * The buffer is only read from and is not retained after the import returns.
+ * Since there is no filename, the source_product attribute of the imported product is only set if it was already
+ * present in the buffer.
  * The \a operations parameter is optional (can be NULL) and provides the list of operations that will be performed as
- * part of the import. Some operations, such as filters, can already be performed as part of an import and this may thus
- * be faster than using a harp_product_execute_operations() after a full import of the product.
- * \param[in] filename Path to the file that is to be imported.
+ * part of the import (see harp_import()).
+ * \param[in] buffer Memory buffer containing the content of the product file.
+ * \param[in] buffer_size Size of the buffer in bytes.
  * \param[in] operations string (optional) containing actions to apply as part of the import; should be specified as a
  * semi-colon separated string of operations.
- * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
- * string of key=value pair; only used if the file is not in HARP format.
- * \param[out] product Pointer to a location where a pointer to the ingested product will be stored.
+ * \param[out] product Pointer to a location where a pointer to the imported product will be stored.
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_import(const char *filename, const char *operations, const char *options, harp_product **product)
+LIBHARP_API int harp_import_from_memory(const void *buffer, long buffer_size, const char *operations,
+                                        harp_product **product)
 {
     harp_product *imported_product;
+    harp_program *program = NULL;
     file_format format;
     int result;
 
-    if (determine_file_format(filename, &format) != 0)
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "buffer is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (buffer_size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid buffer size (%ld) (%s:%u)", buffer_size, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    if (product == NULL)
     {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
 
-    switch (format)
+    format = format_from_signature((const unsigned char *)buffer, buffer_size);
+    if (format != format_netcdf && format != format_hdf5)
     {
-        case format_hdf4:
-#ifdef HAVE_HDF4
-            result = harp_import_hdf4(filename, &imported_product);
-#else
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
-            result = -1;
-#endif
-            break;
-        case format_hdf5:
-#ifdef HAVE_HDF5
-            result = harp_import_hdf5(filename, &imported_product);
-#else
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
-            result = -1;
-#endif
-            break;
-        case format_netcdf:
-            result = harp_import_netcdf(filename, &imported_product);
-            break;
-        default:
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
-            result = -1;
+        harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, "import from memory is only supported for HARP products in "
+                       "HDF5 or netCDF format");
+        return -1;
     }
 
-    if (result != 0)
+    if (operations != NULL)
     {
-        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
+        if (harp_program_from_string(operations, &program) != 0)
         {
             return -1;
         }
+    }
 
-        /* try ingest */
-        if (harp_ingest(filename, operations, options, &imported_product) != 0)
-        {
-            return -1;
-        }
+    file_access_lock();
+    if (format == format_hdf5)
+    {
+#ifdef HAVE_HDF5
+        result = harp_import_hdf5_from_memory(buffer, buffer_size, program, &imported_product);
+#else
+        harp_set_error(HARP_ERROR_NO_HDF5_SUPPORT, NULL);
+        result = -1;
+#endif
     }
     else
     {
-        if (harp_product_verify(imported_product) != 0)
-        {
-            harp_product_delete(imported_product);
-            return -1;
-        }
+        result = harp_import_netcdf_from_memory(buffer, buffer_size, program, &imported_product);
+    }
+    file_access_unlock();
+    if (result != 0)
+    {
+        harp_program_delete(program);
+        return -1;
+    }
 
-        /* set source_product if it was empty; we need this for the 'collocate_xxx()' operations to work */
-        if (imported_product->source_product == NULL)
-        {
-            if (harp_product_set_source_product(imported_product, filename) != 0)
-            {
-                harp_product_delete(imported_product);
-                return -1;
-            }
-        }
+    if ((harp_option_trusted_import ? harp_product_verify_structure(imported_product) :
+         harp_product_verify(imported_product)) != 0)
+    {
+        harp_product_delete(imported_product);
+        harp_program_delete(program);
+        return -1;
+    }
 
-        if (operations != NULL)
+    if (program != NULL)
+    {
+        harp_program_start_execution(program);
+        if (harp_product_execute_program(imported_product, program) != 0)
         {
-            if (harp_product_execute_operations(imported_product, operations) != 0)
-            {
-                harp_product_delete(imported_product);
-                return -1;
-            }
+            harp_program_end_execution(program);
+            harp_product_delete(imported_product);
+            harp_program_delete(program);
+            return -1;
         }
+        harp_program_end_execution(program);
+        harp_program_delete(program);
     }
 
     *product = imported_product;
@@ -617,218 +2955,203 @@ LIBHARP_API int harp_import(const char *filename, const char *operations, const
     return 0;
 }
 
-/** Test import of a product.
+/** Export HARP product to a memory buffer.
  * \ingroup harp_product
- * If the product is a HARP product then verify that the product is a HARP compliant netCDF/HDF4/HDF5 product.
- * Otherwise, try to import the product using an applicable ingestion module and test the ingestion for all possible
- * ingestion options.
- * Results are printed using the provided \a print function.
- * The \a print function parameter should be a function that resembles printf().
- * \param[in] filename Filename of the product to import.
- * \param[in] print Reference to a printf compatible function.
+ * Export product to a memory buffer containing the full content of an HDF5 or netCDF file that complies to the HARP
+ * Data Format. The result is identical to what harp_export() would write to a file.
+ * Exporting to memory is not supported for HDF4.
+ * The returned buffer is owned by the caller and should be freed using free().
+ * \param export_format Either "hdf5" or "netcdf".
+ * \param product Product that should be exported.
+ * \param buffer Pointer to a location where a pointer to the newly allocated buffer will be stored.
+ * \param buffer_size Pointer to a location where the size of the buffer in bytes will be stored.
  * \return
  *   \arg \c 0, Success.
- *   \arg \c 1, Import failed (error is already printed, #harp_errno should be ignored).
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_import_test(const char *filename, int (*print) (const char *, ...))
+LIBHARP_API int harp_export_to_memory(const char *export_format, const harp_product *product, void **buffer,
+                                      long *buffer_size)
 {
-    harp_product *product;
     file_format format;
     int result;
 
-    print("product: %s\n", filename);
-
-    if (determine_file_format(filename, &format) != 0)
+    format = format_from_string(export_format);
+    if (format == format_unknown)
     {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unsupported export format '%s'", export_format);
         return -1;
     }
 
+    file_access_lock();
     switch (format)
     {
         case format_hdf4:
-#ifdef HAVE_HDF4
-            result = harp_import_hdf4(filename, &product);
-#else
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+        case format_zarr:
+        case format_arrow:
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "export to memory is not supported for format '%s'",
+                           export_format);
             result = -1;
-#endif
             break;
         case format_hdf5:
 #ifdef HAVE_HDF5
-            result = harp_import_hdf5(filename, &product);
+            result = harp_export_hdf5_to_memory(product, buffer, buffer_size);
 #else
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
+            harp_set_error(HARP_ERROR_NO_HDF5_SUPPORT, NULL);
             result = -1;
 #endif
             break;
         case format_netcdf:
-            result = harp_import_netcdf(filename, &product);
+            result = harp_export_netcdf_to_memory(product, buffer, buffer_size);
             break;
         default:
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
-            result = -1;
-    }
-
-    if (result != 0)
-    {
-        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
-        {
-            return -1;
-        }
-        /* try ingest */
-        return harp_ingest_test(filename, print);
-    }
-
-    print("import:");
-    if (harp_product_verify(product) != 0)
-    {
-        print(" [FAIL]\n");
-        print("ERROR: %s\n", harp_errno_to_string(harp_errno));
-        harp_product_delete(product);
-        return 1;
+            assert(0);
+            exit(1);
     }
-    print(" [OK]\n");
-
-    harp_product_delete(product);
+    file_access_unlock();
 
-    return 0;
+    return result;
 }
 
-/** Retrieve global attributes from a product file.
+/** Create a file to which products can be exported one at a time.
  * \ingroup harp_product
- * This function retrieves the product metadata without performing a full import.
- * \param filename Path to the file for which to retrieve global attributes.
- * \param options Ingestion module specific options (optional); should be specified as a semi-colon separated
- * string of key=value pair; only used if the file is not in HARP format.
- * \param new_metadata Pointer to the variable where the metadata should be stored.
+ * Each product that is passed to harp_export_stream_append() is written to the file directly, such that the file
+ * content ends up being the same as when the products were first concatenated using harp_product_append() and then
+ * exported using harp_export(), but without having to keep the concatenated product in memory.
+ * The first (non-empty) product defines the variables in the file and the length of all dimensions other than the
+ * time dimension (see harp_export_stream_append()). The datetime_start and datetime_stop attributes are updated when
+ * the stream is closed with harp_export_stream_close().
+ * Streaming export is only supported for the netCDF format.
+ * \param[in] filename Path to the file to which the products are to be exported.
+ * \param[in] export_format Export format; only "netcdf" is supported.
+ * \param[out] new_stream Pointer to a location where a pointer to the new export stream will be stored.
  * \return
- *   \arg \c 0, Succes.
+ *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_import_product_metadata(const char *filename, const char *options,
-                                             harp_product_metadata **new_metadata)
+LIBHARP_API int harp_export_stream_open(const char *filename, const char *export_format,
+                                        harp_export_stream **new_stream)
 {
-    harp_product_metadata *metadata = NULL;
+    harp_export_stream *stream;
     file_format format;
     int result;
 
-    if (determine_file_format(filename, &format) != 0)
+    if (filename == NULL)
     {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
-
-    if (harp_product_metadata_new(&metadata) != 0)
+    if (new_stream == NULL)
     {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "new_stream is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
 
-    /* set the filename attr */
-    metadata->filename = strdup(filename);
-    if (!metadata->filename)
+    format = format_from_string(export_format);
+    if (format == format_unknown)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                       __LINE__);
-        harp_product_metadata_delete(metadata);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unsupported export format '%s'", export_format);
+        return -1;
+    }
+    if (format != format_netcdf)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "streaming export is not supported for format '%s'",
+                       export_format);
         return -1;
     }
 
-    switch (format)
+    stream = (harp_export_stream *)malloc(sizeof(harp_export_stream));
+    if (stream == NULL)
     {
-        case format_hdf4:
-#ifdef HAVE_HDF4
-            result = harp_import_global_attributes_hdf4(filename, &metadata->datetime_start, &metadata->datetime_stop,
-                                                        metadata->dimension, &metadata->source_product);
-#else
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
-            result = -1;
-#endif
-            break;
-        case format_hdf5:
-#ifdef HAVE_HDF5
-            result = harp_import_global_attributes_hdf5(filename, &metadata->datetime_start, &metadata->datetime_stop,
-                                                        metadata->dimension, &metadata->source_product);
-#else
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
-            result = -1;
-#endif
-            break;
-        case format_netcdf:
-            result = harp_import_global_attributes_netcdf(filename, &metadata->datetime_start, &metadata->datetime_stop,
-                                                          metadata->dimension, &metadata->source_product);
-            break;
-        default:
-            harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
-            result = -1;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_export_stream), __FILE__, __LINE__);
+        return -1;
     }
 
+    file_access_lock();
+    result = harp_export_netcdf_stream_open(filename, &stream->netcdf_stream);
+    file_access_unlock();
     if (result != 0)
     {
-        if (harp_errno != HARP_ERROR_UNSUPPORTED_PRODUCT)
-        {
-            harp_product_metadata_delete(metadata);
-            return -1;
-        }
-
-        /* try ingest */
-        if (harp_ingest_global_attributes(filename, options, &metadata->datetime_start, &metadata->datetime_stop,
-                                          metadata->dimension, &metadata->source_product) != 0)
-        {
-            harp_product_metadata_delete(metadata);
-            return -1;
-        }
+        free(stream);
+        return -1;
     }
 
-    *new_metadata = metadata;
+    *new_stream = stream;
 
     return 0;
 }
 
-/** Export HARP product to a file.
+/** Append a product to an export stream.
  * \ingroup harp_product
- * Export product to an HDF4, HDF5, or netCDF file that complies to the HARP Data Format.
- * \param filename Path to the file to which the product is to be exported.
- * \param export_format Either "hdf4", "hdf5", or "netcdf".
- * \param product Product that should be exported to file.
+ * The product is modified in the same way as the products that are passed to harp_product_append(): the 'index'
+ * variable and the source_product attribute are removed, all variables are made time dependent, and dimensions
+ * that are shorter than those of the first product that was appended are extended. Unlike harp_product_append(), a
+ * dimension can not be longer than in the first product; this also holds for the length of string values.
+ * Empty products are skipped.
+ * If an error occurs, the file can not be appended to anymore and the stream should be closed.
+ * \param[in] stream Export stream to which the product should be appended.
+ * \param[in] product Product that should be appended.
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_export(const char *filename, const char *export_format, const harp_product *product)
+LIBHARP_API int harp_export_stream_append(harp_export_stream *stream, harp_product *product)
 {
-    file_format format;
+    int result;
 
-    format = format_from_string(export_format);
-    if (format == format_unknown)
+    if (stream == NULL)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unsupported export format '%s'", export_format);
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "stream is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
         return -1;
     }
 
-    switch (format)
+    if (harp_product_is_empty(product))
     {
-        case format_hdf4:
-#ifdef HAVE_HDF4
-            return harp_export_hdf4(filename, product);
-#else
-            coda_set_error(HARP_ERROR_NO_HDF4_SUPPORT, NULL);
-            return -1;
-#endif
-        case format_hdf5:
-#ifdef HAVE_HDF5
-            return harp_export_hdf5(filename, product);
-#else
-            coda_set_error(HARP_ERROR_NO_HDF5_SUPPORT, NULL);
-            return -1;
-#endif
-        case format_netcdf:
-            return harp_export_netcdf(filename, product);
-        default:
-            assert(0);
-            exit(1);
+        return 0;
+    }
+    /* make the product look like it was the result of a merge */
+    if (harp_product_append(product, NULL) != 0)
+    {
+        return -1;
     }
 
-    return 0;
+    file_access_lock();
+    result = harp_export_netcdf_stream_append(stream->netcdf_stream, product);
+    file_access_unlock();
+
+    return result;
+}
+
+/** Close an export stream.
+ * \ingroup harp_product
+ * This finalizes and closes the file and releases all resources of the stream. The stream is released even if an
+ * error occurs.
+ * \param[in] stream Export stream that should be closed.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_export_stream_close(harp_export_stream *stream)
+{
+    int result;
+
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "stream is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    file_access_lock();
+    result = harp_export_netcdf_stream_close(stream->netcdf_stream);
+    file_access_unlock();
+    free(stream);
+
+    return result;
 }
 
 /**
@@ -6,6 +6,8 @@ AC_DEFUN([ST_CHECK_HDF5],
 AC_ARG_VAR([HDF5_INCLUDE],[The HDF5 include directory. If not specified no extra CPPFLAGS are set])
 AC_REQUIRE([ST_CHECK_LIBZ])
 AC_REQUIRE([ST_CHECK_LIBSZ])
+AC_REQUIRE([ST_CHECK_LIBZSTD])
+AC_REQUIRE([ST_CHECK_LIBLZ4])
 old_CPPFLAGS=$CPPFLAGS
 old_LDFLAGS=$LDFLAGS
 if test "$HDF5_LIB" != "" ; then
@@ -25,7 +27,7 @@ if test $ac_cv_header_hdf5_h = no || test $ac_cv_header_hdf5_hl_h = no ||
   LDFLAGS=$old_LDFLAGS
 else
   st_cv_have_hdf5=yes
-  HDF5LIBS="-lhdf5_hl -lhdf5 $ZLIB $SZLIB"
+  HDF5LIBS="-lhdf5_hl -lhdf5 $ZLIB $SZLIB $ZSTDLIB $LZ4LIB"
 fi
 AC_MSG_CHECKING(for HDF5 installation)
 AC_MSG_RESULT($st_cv_have_hdf5)
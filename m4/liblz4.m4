@@ -0,0 +1,14 @@
+# ST_CHECK_LIBLZ4
+# ---------------
+# Check for the availability of the lz4 library
+AC_DEFUN([ST_CHECK_LIBLZ4],
+[LZ4LIB=
+AC_CHECK_LIB(lz4, LZ4_compress_default, ac_cv_lib_lz4=yes, ac_cv_lib_lz4=no)
+AC_CHECK_HEADERS(lz4.h)
+if test $ac_cv_lib_lz4 = yes ; then
+  if test $ac_cv_header_lz4_h = yes ; then
+    LZ4LIB="-llz4"
+    AC_DEFINE(HAVE_LZ4, 1, [Define to 1 if the lz4 library is available.])
+  fi
+fi
+])# ST_CHECK_LIBLZ4
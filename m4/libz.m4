@@ -4,7 +4,11 @@
 AC_DEFUN([ST_CHECK_LIBZ],
 [ZLIB=
 AC_CHECK_LIB(z, compress, ac_cv_lib_z=yes, ac_cv_lib_z=no)
+AC_CHECK_HEADERS(zlib.h)
 if test $ac_cv_lib_z = yes ; then
   ZLIB="-lz"
+  if test $ac_cv_header_zlib_h = yes ; then
+    AC_DEFINE(HAVE_ZLIB, 1, [Define to 1 if zlib is available.])
+  fi
 fi
 ])# ST_CHECK_LIBZ
@@ -0,0 +1,14 @@
+# ST_CHECK_LIBZSTD
+# ----------------
+# Check for the availability of the zstd library
+AC_DEFUN([ST_CHECK_LIBZSTD],
+[ZSTDLIB=
+AC_CHECK_LIB(zstd, ZSTD_compress, ac_cv_lib_zstd=yes, ac_cv_lib_zstd=no)
+AC_CHECK_HEADERS(zstd.h)
+if test $ac_cv_lib_zstd = yes ; then
+  if test $ac_cv_header_zstd_h = yes ; then
+    ZSTDLIB="-lzstd"
+    AC_DEFINE(HAVE_ZSTD, 1, [Define to 1 if the zstd library is available.])
+  fi
+fi
+])# ST_CHECK_LIBZSTD
@@ -22,7 +22,111 @@
 
 #include <string.h>
 
-static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_product **product, int index)
+#define TRANSPOSE_BLOCK_SIZE 32
+
+/* Transpose a two dimensional plane: element (i, j) is read from src[i * src_stride + j] and written to
+ * dst[i + j * dst_stride]. The plane is processed in square blocks, such that the cache lines that are touched for
+ * reading as well as for writing are reused within a block.
+ */
+static void transpose_plane(void *dst, const void *src, long num_rows, long num_columns, long src_stride,
+                            long dst_stride, size_t element_size)
+{
+    long row_block, column_block;
+
+    for (row_block = 0; row_block < num_rows; row_block += TRANSPOSE_BLOCK_SIZE)
+    {
+        long row_end = row_block + TRANSPOSE_BLOCK_SIZE < num_rows ? row_block + TRANSPOSE_BLOCK_SIZE : num_rows;
+
+        for (column_block = 0; column_block < num_columns; column_block += TRANSPOSE_BLOCK_SIZE)
+        {
+            long column_end = column_block + TRANSPOSE_BLOCK_SIZE < num_columns ?
+                column_block + TRANSPOSE_BLOCK_SIZE : num_columns;
+            long i, j;
+
+#define TRANSPOSE_BLOCK(type) \
+            for (j = column_block; j < column_end; j++) \
+            { \
+                for (i = row_block; i < row_end; i++) \
+                { \
+                    ((type *)dst)[i + j * dst_stride] = ((const type *)src)[i * src_stride + j]; \
+                } \
+            }
+
+            switch (element_size)
+            {
+                case 1:
+                    TRANSPOSE_BLOCK(int8_t);
+                    break;
+                case 2:
+                    TRANSPOSE_BLOCK(int16_t);
+                    break;
+                case 4:
+                    TRANSPOSE_BLOCK(int32_t);
+                    break;
+                default:
+                    mxAssert(element_size == 8, "Unsupported element size");
+                    TRANSPOSE_BLOCK(int64_t);
+                    break;
+            }
+
+#undef TRANSPOSE_BLOCK
+        }
+    }
+}
+
+/* Copy row-major HARP data into a column-major MATLAB array with the same dimensions.
+ * The array is handled as a set of planes spanned by the first and the last dimension (one plane for each index of
+ * the dimensions in between), each of which is transposed in blocks.
+ */
+static void copy_to_column_major(void *dst, const void *src, int num_dims, const long *dim, size_t element_size)
+{
+    long middle_index[HARP_MAX_NUM_DIMS];
+    long middle_stride[HARP_MAX_NUM_DIMS];
+    long num_middle = 1;
+    long m;
+    int k;
+
+    if (num_dims < 2)
+    {
+        memcpy(dst, src, (num_dims == 0 ? 1 : dim[0]) * element_size);
+        return;
+    }
+
+    /* the column-major stride (in units of the first dimension) of each dimension in between */
+    for (k = 1; k < num_dims - 1; k++)
+    {
+        middle_index[k] = 0;
+        middle_stride[k] = num_middle;
+        num_middle *= dim[k];
+    }
+
+    for (m = 0; m < num_middle; m++)
+    {
+        long dst_offset = 0;
+
+        for (k = 1; k < num_dims - 1; k++)
+        {
+            dst_offset += middle_index[k] * middle_stride[k];
+        }
+        transpose_plane((char *)dst + dst_offset * dim[0] * element_size,
+                        (const char *)src + m * dim[num_dims - 1] * element_size, dim[0], dim[num_dims - 1],
+                        num_middle * dim[num_dims - 1], dim[0] * num_middle, element_size);
+
+        /* advance the (row-major) index of the dimensions in between */
+        for (k = num_dims - 2; k > 0; k--)
+        {
+            middle_index[k]++;
+            if (middle_index[k] < dim[k])
+            {
+                break;
+            }
+            middle_index[k] = 0;
+        }
+    }
+}
+
+static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_product **product, int index,
+                                                  int row_major)
 {
 
     harp_variable *variable = (**product).variable[index];
@@ -100,7 +204,7 @@ static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_produ
 
     for (i = 0; i < num_dims; i++)
     {
-        matlabdim[i] = (mwSize) dim[i];
+        matlabdim[i] = (mwSize) dim[row_major ? num_dims - 1 - i : i];
     }
 
     matlabdim_type[0] = num_dims;
@@ -115,7 +219,7 @@ static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_produ
 
         for (i = 0; i < num_dims; i++)
         {
-            switch (dim_type[i])
+            switch (dim_type[row_major ? num_dims - 1 - i : i])
             {
                 case -1:
                     {
@@ -157,116 +261,42 @@ static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_produ
     switch (type)
     {
         case harp_type_int8:
-            {
-                long counter = 0;
-                int8_t *data;
-
-                mx_data = mxCreateNumericArray(num_dims, matlabdim, mxINT8_CLASS, mxREAL);
-                data = mxGetData(mx_data);
-
-                while (counter < num_elements)
-                {
-                    mwSize j, k;
-
-                    for (j = 0; j < num_elements / matlabdim[num_dims - 1]; j++)
-                    {
-                        for (k = 0; k < matlabdim[num_dims - 1]; k++)
-                        {
-                            data[j + k * num_elements / matlabdim[num_dims - 1]] = variable_data.int8_data[counter++];
-                        }
-                    }
-                }
-
-            }
-            break;
         case harp_type_int16:
-            {
-                long counter = 0;
-                int16_t *data;
-
-                mx_data = mxCreateNumericArray(num_dims, matlabdim, mxINT16_CLASS, mxREAL);
-                data = mxGetData(mx_data);
-
-                while (counter < num_elements)
-                {
-                    mwSize j, k;
-
-                    for (j = 0; j < num_elements / matlabdim[num_dims - 1]; j++)
-                    {
-                        for (k = 0; k < matlabdim[num_dims - 1]; k++)
-                        {
-                            data[j + k * num_elements / matlabdim[num_dims - 1]] = variable_data.int16_data[counter++];
-                        }
-                    }
-                }
-            }
-            break;
         case harp_type_int32:
+        case harp_type_float:
+        case harp_type_double:
             {
-                long counter = 0;
-                int32_t *data;
+                mxClassID class_id = mxDOUBLE_CLASS;
 
-                mx_data = mxCreateNumericArray(num_dims, matlabdim, mxINT32_CLASS, mxREAL);
-                data = mxGetData(mx_data);
-
-                while (counter < num_elements)
+                switch (type)
                 {
-                    mwSize j, k;
-
-                    for (j = 0; j < num_elements / matlabdim[num_dims - 1]; j++)
-                    {
-                        for (k = 0; k < matlabdim[num_dims - 1]; k++)
-                        {
-                            data[j + k * num_elements / matlabdim[num_dims - 1]] = variable_data.int32_data[counter++];
-                        }
-                    }
+                    case harp_type_int8:
+                        class_id = mxINT8_CLASS;
+                        break;
+                    case harp_type_int16:
+                        class_id = mxINT16_CLASS;
+                        break;
+                    case harp_type_int32:
+                        class_id = mxINT32_CLASS;
+                        break;
+                    case harp_type_float:
+                        class_id = mxSINGLE_CLASS;
+                        break;
+                    default:
+                        break;
                 }
-            }
-            break;
-        case harp_type_double:
-            {
-                long counter = 0;
-                double *data;
 
-                mx_data = mxCreateNumericArray(num_dims, matlabdim, mxDOUBLE_CLASS, mxREAL);
-                data = mxGetData(mx_data);
-
-                while (counter < num_elements)
+                mx_data = mxCreateNumericArray(num_dims, matlabdim, class_id, mxREAL);
+                if (row_major)
                 {
-                    mwSize j, k;
-
-                    for (j = 0; j < num_elements / matlabdim[num_dims - 1]; j++)
-                    {
-                        for (k = 0; k < matlabdim[num_dims - 1]; k++)
-                        {
-                            data[j + k * num_elements / matlabdim[num_dims - 1]] = variable_data.double_data[counter++];
-                        }
-                    }
+                    /* the reversed dimensions make the row-major HARP layout a valid column-major MATLAB layout */
+                    memcpy(mxGetData(mx_data), variable_data.ptr, num_elements * harp_get_size_for_type(type));
                 }
-
-            }
-            break;
-        case harp_type_float:
-            {
-                long counter = 0;
-                float *data;
-
-                mx_data = mxCreateNumericArray(num_dims, matlabdim, mxSINGLE_CLASS, mxREAL);
-                data = mxGetData(mx_data);
-
-                while (counter < num_elements)
+                else
                 {
-                    mwSize j, k;
-
-                    for (j = 0; j < num_elements / matlabdim[num_dims - 1]; j++)
-                    {
-                        for (k = 0; k < matlabdim[num_dims - 1]; k++)
-                        {
-                            data[j + k * num_elements / matlabdim[num_dims - 1]] = variable_data.float_data[counter++];
-                        }
-                    }
+                    copy_to_column_major(mxGetData(mx_data), variable_data.ptr, num_dims, dim,
+                                         harp_get_size_for_type(type));
                 }
-
             }
             break;
         case harp_type_string:
@@ -279,7 +309,7 @@ static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_produ
                 mx_data = mxCreateCellArray(num_dims, matlabdim);
                 for (i = 0; i < num_elements; i++)
                 {
-                    mxSetCell(mx_data, coda_c_index_to_fortran_index(num_dims, dim, i),
+                    mxSetCell(mx_data, row_major ? i : coda_c_index_to_fortran_index(num_dims, dim, i),
                               mxCreateString(variable_data.string_data[i]));
                 }
             }
@@ -298,7 +328,7 @@ static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_produ
 
 }
 
-mxArray *harp_matlab_get_product(harp_product **product)
+mxArray *harp_matlab_get_product(harp_product **product, int row_major)
 {
     mxArray *mx_data = NULL;
     int num_variables;
@@ -334,7 +364,7 @@ mxArray *harp_matlab_get_product(harp_product **product)
     /* add variables for each product */
     for (index = 0; index < num_variables; index++)
     {
-        harp_matlab_add_harp_product_variable(mx_data, product, index);
+        harp_matlab_add_harp_product_variable(mx_data, product, index, row_major);
     }
 
     return mx_data;
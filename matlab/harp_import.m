@@ -27,6 +27,14 @@ function varargout = harp_import(varargin)
 %   as a semi-colon separated string of key=value pairs; only used
 %   if the file is not in HARP format.
 %
+%   PRODUCT = HARP_IMPORT(FILEPATH, OPERATIONS, OPTIONS, ROW_MAJOR)
+%   with ROW_MAJOR set to true returns the data of each variable in
+%   the memory layout that HARP uses, without transposing it. The
+%   dimensions of each variable (and the names in its dimension field)
+%   are then in reverse order, e.g. a {time,vertical} variable becomes
+%   a vertical x time array. This makes importing large products
+%   considerably faster.
+%
 %   More information about HARP products can be found in the HARP Data
 %   Description documentation.
 %
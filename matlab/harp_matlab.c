@@ -187,6 +187,7 @@ static void harp_matlab_import(int nlhs, mxArray *plhs[], int nrhs, const mxArra
     int num_files;
     char *script;
     char *option;
+    int row_major;
     int buflen;
     int i;
 
@@ -195,9 +196,9 @@ static void harp_matlab_import(int nlhs, mxArray *plhs[], int nrhs, const mxArra
     {
         mexErrMsgTxt("Too many output arguments.");
     }
-    if ((nrhs < 1) || (nrhs > 3))
+    if ((nrhs < 1) || (nrhs > 4))
     {
-        mexErrMsgTxt("Function takes either one, two or three arguments.");
+        mexErrMsgTxt("Function takes either one, two, three or four arguments.");
     }
 
     filenames = NULL;
@@ -306,6 +307,16 @@ static void harp_matlab_import(int nlhs, mxArray *plhs[], int nrhs, const mxArra
         }
     }
 
+    row_major = 0;
+    if (nrhs > 3)
+    {
+        if (!(mxIsLogical(prhs[3]) || mxIsNumeric(prhs[3])) || mxGetNumberOfElements(prhs[3]) != 1)
+        {
+            mexErrMsgTxt("Fourth argument should be a logical scalar.");
+        }
+        row_major = mxIsLogicalScalarTrue(prhs[3]) || (mxIsNumeric(prhs[3]) && mxGetScalar(prhs[3]) != 0);
+    }
+
     for (i = 0; i < num_files; i++)
     {
         if (harp_import(filenames[i], script, option, &product) != 0)
@@ -328,7 +339,7 @@ static void harp_matlab_import(int nlhs, mxArray *plhs[], int nrhs, const mxArra
         mxFree(option);
     }
 
-    plhs[0] = harp_matlab_get_product(&product);
+    plhs[0] = harp_matlab_get_product(&product, row_major);
 
     harp_product_delete(product);
 
@@ -31,6 +31,12 @@
 #define free_NC_var harp_free_NC_var
 #define free_NC_vararrayV harp_free_NC_vararrayV
 #define free_NC_vararrayV0 harp_free_NC_vararrayV0
+#define memio_close harp_memio_close
+#define memio_create harp_memio_create
+#define memio_extract harp_memio_extract
+#define memio_filesize harp_memio_filesize
+#define memio_open harp_memio_open
+#define memio_pad_length harp_memio_pad_length
 #define nc__create harp_nc__create
 #define nc__create_mp harp_nc__create_mp
 #define nc__enddef harp_nc__enddef
@@ -44,9 +50,11 @@
 #define NC_check_vlen harp_NC_check_vlen
 #define nc_cktype harp_nc_cktype
 #define nc_close harp_nc_close
+#define nc_close_memio harp_nc_close_memio
 #define nc_copy_att harp_nc_copy_att
 #define nc_copy_var harp_nc_copy_var
 #define nc_create harp_nc_create
+#define nc_create_mem harp_nc_create_mem
 #define nc_def_dim harp_nc_def_dim
 #define nc_def_var harp_nc_def_var
 #define nc_del_att harp_nc_del_att
@@ -137,6 +145,7 @@
 #define nc_inq_vartype harp_nc_inq_vartype
 #define NC_lookupvar harp_NC_lookupvar
 #define nc_open harp_nc_open
+#define nc_open_mem harp_nc_open_mem
 #define nc_put_att harp_nc_put_att
 #define nc_put_att_double harp_nc_put_att_double
 #define nc_put_att_float harp_nc_put_att_float
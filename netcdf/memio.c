@@ -0,0 +1,397 @@
+/*
+ *	Copyright 1996, University Corporation for Atmospheric Research
+ *	See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ */
+
+/*
+ * In-memory implementation of the ncio interface (see ncio.h).
+ * The 'file' is a single contiguous block of memory. A file that is
+ * opened read-only uses the memory of the caller directly; the memory
+ * is only copied if it needs to be extended (e.g. when reading beyond
+ * the end of a file that was written in NOFILL mode).
+ * These are used by nc_open_mem(), nc_create_mem() and nc_close_memio().
+ */
+
+#include <config.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <errno.h>
+#ifndef ENOERR
+#define ENOERR 0
+#endif
+#include <sys/types.h>
+#include <string.h>
+
+#include "ncio.h"
+#include "fbits.h"
+#include "rnd.h"
+
+/* block size that is reported as size hint */
+#define MEMIO_BLOCKSIZE 8192
+
+/* minimum amount by which the memory is extended */
+#define MEMIO_MINEXTENT 1048576
+
+/*
+ * ncid values for in-memory files need to be distinct from
+ * file descriptors of files that are opened using posixio.
+ */
+#define MEMIO_FIRST_PSEUDO_FD 0x10000000
+
+typedef struct ncio_mem {
+	char *memory;
+	size_t size;		/* size of the 'file' */
+	size_t alloc;		/* size of the allocated memory */
+	int owned;		/* whether memory was allocated by us */
+} ncio_mem;
+
+static int memio_next_pseudo_fd = MEMIO_FIRST_PSEUDO_FD;
+
+
+/*
+ * Make sure that memory is available up to endpoint.
+ * Memory beyond the size of the 'file' is always zero.
+ */
+static int
+memio_guarantee(ncio_mem *memp, size_t endpoint)
+{
+	char *memory;
+	size_t alloc;
+
+	if(endpoint <= memp->alloc)
+		return ENOERR;
+
+	alloc = memp->alloc + memp->alloc / 2;
+	if(alloc < memp->alloc + MEMIO_MINEXTENT)
+		alloc = memp->alloc + MEMIO_MINEXTENT;
+	if(alloc < endpoint)
+		alloc = endpoint;
+
+	if(memp->owned)
+	{
+		memory = (char *) realloc(memp->memory, alloc);
+		if(memory == NULL)
+			return ENOMEM;
+	}
+	else
+	{
+		memory = (char *) malloc(alloc);
+		if(memory == NULL)
+			return ENOMEM;
+		if(memp->size > 0)
+			(void) memcpy(memory, memp->memory, memp->size);
+		memp->owned = 1;
+	}
+	(void) memset(memory + memp->size, 0, alloc - memp->size);
+	memp->memory = memory;
+	memp->alloc = alloc;
+
+	return ENOERR;
+}
+
+
+static int
+memio_rel(ncio *const nciop, off_t offset, int rflags)
+{
+	(void) nciop;
+	(void) offset;
+	(void) rflags;
+
+	return ENOERR;
+}
+
+
+static int
+memio_get(ncio *const nciop,
+		off_t offset, size_t extent,
+		int rflags,
+		void **const vpp)
+{
+	ncio_mem *const memp = (ncio_mem *)nciop->pvt;
+	int status;
+
+	if(fIsSet(rflags, RGN_WRITE) && !fIsSet(nciop->ioflags, NC_WRITE))
+		return EPERM; /* attempt to write readonly file */
+
+	status = memio_guarantee(memp, (size_t)offset + extent);
+	if(status != ENOERR)
+		return status;
+
+	if(fIsSet(rflags, RGN_WRITE) && (size_t)offset + extent > memp->size)
+		memp->size = (size_t)offset + extent;
+
+	*vpp = memp->memory + offset;
+
+	return ENOERR;
+}
+
+
+static int
+memio_move(ncio *const nciop, off_t to, off_t from,
+			size_t nbytes, int rflags)
+{
+	ncio_mem *const memp = (ncio_mem *)nciop->pvt;
+	size_t endpoint = (size_t)(to > from ? to : from) + nbytes;
+	int status;
+
+	(void) rflags;
+
+	if(to == from)
+		return ENOERR; /* NOOP */
+
+	if(!fIsSet(nciop->ioflags, NC_WRITE))
+		return EPERM; /* attempt to write readonly file */
+
+	status = memio_guarantee(memp, endpoint);
+	if(status != ENOERR)
+		return status;
+
+	(void) memmove(memp->memory + to, memp->memory + from, nbytes);
+	if((size_t)to + nbytes > memp->size)
+		memp->size = (size_t)to + nbytes;
+
+	return ENOERR;
+}
+
+
+static int
+memio_sync(ncio *const nciop)
+{
+	(void) nciop;
+
+	return ENOERR;
+}
+
+
+static void
+memio_free(void *const pvt)
+{
+	ncio_mem *const memp = (ncio_mem *)pvt;
+
+	if(memp == NULL)
+		return;
+
+	if(memp->owned && memp->memory != NULL)
+		free(memp->memory);
+	memp->memory = NULL;
+	memp->size = 0;
+	memp->alloc = 0;
+	memp->owned = 0;
+}
+
+
+static ncio *
+memio_new(const char *path, int ioflags)
+{
+	size_t sz_ncio = M_RNDUP(sizeof(ncio));
+	size_t sz_path = M_RNDUP(strlen(path) +1);
+	ncio *nciop;
+	ncio_mem *memp;
+
+	nciop = (ncio *) malloc(sz_ncio + sz_path + sizeof(ncio_mem));
+	if(nciop == NULL)
+		return NULL;
+
+	nciop->ioflags = ioflags | NC_INMEMORY;
+	*((int *)&nciop->fd) = memio_next_pseudo_fd++; /* cast away const */
+
+	nciop->path = (char *) ((char *)nciop + sz_ncio);
+	(void) strcpy((char *)nciop->path, path); /* cast away const */
+
+				/* cast away const */
+	*((void **)&nciop->pvt) = (void *)(nciop->path + sz_path);
+
+	*((ncio_relfunc **)&nciop->rel) = memio_rel; /* cast away const */
+	*((ncio_getfunc **)&nciop->get) = memio_get; /* cast away const */
+	*((ncio_movefunc **)&nciop->move) = memio_move; /* cast away const */
+	*((ncio_syncfunc **)&nciop->sync) = memio_sync; /* cast away const */
+	*((ncio_freefunc **)&nciop->free) = memio_free; /* cast away const */
+
+	memp = (ncio_mem *)nciop->pvt;
+	memp->memory = NULL;
+	memp->size = 0;
+	memp->alloc = 0;
+	memp->owned = 0;
+
+	return nciop;
+}
+
+
+/* Public below this point */
+
+/*
+ * Create an in-memory file with an initial allocation of initialsz bytes.
+ * See ncio_create() for a description of the arguments.
+ */
+int
+memio_create(const char *path, int ioflags,
+	size_t initialsz,
+	off_t igeto, size_t igetsz, size_t *sizehintp,
+	ncio **nciopp, void **const igetvpp)
+{
+	ncio *nciop;
+	int status;
+
+	if(initialsz < (size_t)igeto + igetsz)
+		initialsz = (size_t)igeto + igetsz;
+
+	fSet(ioflags, NC_WRITE);
+
+	if(path == NULL || *path == 0)
+		return EINVAL;
+
+	nciop = memio_new(path, ioflags);
+	if(nciop == NULL)
+		return ENOMEM;
+
+	status = memio_guarantee((ncio_mem *)nciop->pvt, initialsz > 0 ? initialsz : MEMIO_BLOCKSIZE);
+	if(status != ENOERR)
+		goto unwind_new;
+
+	*sizehintp = MEMIO_BLOCKSIZE;
+
+	if(igetsz != 0)
+	{
+		status = nciop->get(nciop,
+				igeto, igetsz,
+				RGN_WRITE,
+				igetvpp);
+		if(status != ENOERR)
+			goto unwind_new;
+	}
+
+	*nciopp = nciop;
+	return ENOERR;
+
+unwind_new:
+	nciop->free(nciop->pvt);
+	free(nciop);
+	return status;
+}
+
+
+/*
+ * Open a file that is stored in memory.
+ * The memory needs to remain available until the file is closed.
+ * See ncio_open() for a description of the other arguments.
+ */
+int
+memio_open(const char *path,
+	int ioflags,
+	size_t size, void *memory,
+	off_t igeto, size_t igetsz, size_t *sizehintp,
+	ncio **nciopp, void **const igetvpp)
+{
+	ncio *nciop;
+	ncio_mem *memp;
+	int status;
+
+	if(path == NULL || *path == 0 || memory == NULL)
+		return EINVAL;
+
+	nciop = memio_new(path, ioflags);
+	if(nciop == NULL)
+		return ENOMEM;
+
+	memp = (ncio_mem *)nciop->pvt;
+	memp->memory = (char *)memory;
+	memp->size = size;
+	memp->alloc = size;
+	memp->owned = 0;
+	if(fIsSet(ioflags, NC_WRITE))
+	{
+		/* never modify the memory of the caller */
+		status = memio_guarantee(memp, size + 1);
+		if(status != ENOERR)
+			goto unwind_new;
+	}
+
+	*sizehintp = MEMIO_BLOCKSIZE;
+
+	if(igetsz != 0)
+	{
+		status = nciop->get(nciop,
+				igeto, igetsz,
+				0,
+				igetvpp);
+		if(status != ENOERR)
+			goto unwind_new;
+	}
+
+	*nciopp = nciop;
+	return ENOERR;
+
+unwind_new:
+	nciop->free(nciop->pvt);
+	free(nciop);
+	return status;
+}
+
+
+/*
+ * Hand over the memory of an in-memory file to the caller.
+ * The returned memory needs to be freed by the caller using free().
+ */
+int
+memio_extract(ncio *nciop, size_t *sizep, void **memoryp)
+{
+	ncio_mem *const memp = (ncio_mem *)nciop->pvt;
+
+	if(!memp->owned)
+	{
+		/* make sure we return memory that we allocated ourselves */
+		int status = memio_guarantee(memp, memp->size + 1);
+		if(status != ENOERR)
+			return status;
+	}
+
+	*sizep = memp->size;
+	*memoryp = memp->memory;
+	memp->memory = NULL;
+	memp->size = 0;
+	memp->alloc = 0;
+	memp->owned = 0;
+
+	return ENOERR;
+}
+
+
+int
+memio_filesize(ncio *nciop, off_t *filesizep)
+{
+	*filesizep = (off_t)((ncio_mem *)nciop->pvt)->size;
+
+	return ENOERR;
+}
+
+
+int
+memio_pad_length(ncio *nciop, off_t length)
+{
+	ncio_mem *const memp = (ncio_mem *)nciop->pvt;
+	int status;
+
+	if(!fIsSet(nciop->ioflags, NC_WRITE))
+		return EPERM; /* attempt to write readonly file */
+
+	status = memio_guarantee(memp, (size_t)length);
+	if(status != ENOERR)
+		return status;
+	if((size_t)length > memp->size)
+		memp->size = (size_t)length;
+
+	return ENOERR;
+}
+
+
+int
+memio_close(ncio *nciop)
+{
+	if(nciop == NULL)
+		return EINVAL;
+
+	nciop->free(nciop->pvt);
+	free(nciop);
+
+	return ENOERR;
+}
@@ -919,8 +919,12 @@ nc__create(const char * path, int ioflags, size_t initialsz,
 		chunksizehintp, ncid_ptr);
 }
 
-int
-nc__create_mp(const char * path, int ioflags, size_t initialsz, int basepe,
+/*
+ * Common implementation of nc__create_mp() and nc_create_mem().
+ * If NC_INMEMORY is set in ioflags the file is created in memory.
+ */
+static int
+NC_create(const char * path, int ioflags, size_t initialsz, int basepe,
 	size_t *chunksizehintp, int *ncid_ptr)
 {
 	NC *ncp;
@@ -963,10 +967,16 @@ nc__create_mp(const char * path, int ioflags, size_t initialsz, int basepe,
 
 	assert(ncp->xsz == ncx_len_NC(ncp,sizeof_off_t));
 	
-	status = ncio_create(path, ioflags,
-		initialsz,
-		0, ncp->xsz, &ncp->chunk,
-		&ncp->nciop, &xp);
+	if(fIsSet(ioflags, NC_INMEMORY))
+		status = memio_create(path, ioflags,
+			initialsz,
+			0, ncp->xsz, &ncp->chunk,
+			&ncp->nciop, &xp);
+	else
+		status = ncio_create(path, ioflags,
+			initialsz,
+			0, ncp->xsz, &ncp->chunk,
+			&ncp->nciop, &xp);
 	if(status != NC_NOERR)
 	{
 		/* translate error status */
@@ -1009,6 +1019,28 @@ unwind_alloc:
 	return status;
 }
 
+int
+nc__create_mp(const char * path, int ioflags, size_t initialsz, int basepe,
+	size_t *chunksizehintp, int *ncid_ptr)
+{
+	fClr(ioflags, NC_INMEMORY);
+	return NC_create(path, ioflags, initialsz, basepe,
+		chunksizehintp, ncid_ptr);
+}
+
+/*
+ * Create a file in memory.
+ * The path is only used as a name for the file.
+ * Use nc_close_memio() to retrieve the resulting file content.
+ */
+int
+nc_create_mem(const char * path, int ioflags, size_t initialsize,
+	int *ncid_ptr)
+{
+	fSet(ioflags, NC_INMEMORY);
+	return NC_create(path, ioflags, initialsize, 0, NULL, ncid_ptr);
+}
+
 /* This function sets a default create flag that will be logically
    or'd to whatever flags are passed into nc_create for all future
    calls to nc_create.
@@ -1048,8 +1080,13 @@ nc__open(const char * path, int ioflags,
 		chunksizehintp, ncid_ptr);
 }
 
-int
-nc__open_mp(const char * path, int ioflags, int basepe,
+/*
+ * Common implementation of nc__open_mp() and nc_open_mem().
+ * If memory is not NULL the file content is taken from memory.
+ */
+static int
+NC_open(const char * path, int ioflags, int basepe,
+	size_t size, void *memory,
 	size_t *chunksizehintp, int *ncid_ptr)
 {
 	NC *ncp;
@@ -1075,9 +1112,15 @@ nc__open_mp(const char * path, int ioflags, int basepe,
 		return NC_EINVAL;
 #endif
 
-	status = ncio_open(path, ioflags,
-		0, 0, &ncp->chunk,
-		&ncp->nciop, 0);
+	if(memory != NULL)
+		status = memio_open(path, ioflags,
+			size, memory,
+			0, 0, &ncp->chunk,
+			&ncp->nciop, 0);
+	else
+		status = ncio_open(path, ioflags,
+			0, 0, &ncp->chunk,
+			&ncp->nciop, 0);
 	if(status)
 		goto unwind_alloc;
 
@@ -1115,6 +1158,31 @@ unwind_alloc:
 	return status;
 }
 
+int
+nc__open_mp(const char * path, int ioflags, int basepe,
+	size_t *chunksizehintp, int *ncid_ptr)
+{
+	fClr(ioflags, NC_INMEMORY);
+	return NC_open(path, ioflags, basepe, 0, NULL,
+		chunksizehintp, ncid_ptr);
+}
+
+/*
+ * Open a file of the given size that is stored in memory.
+ * The path is only used as a name for the file.
+ * The memory is not modified and needs to remain available until the
+ * file is closed.
+ */
+int
+nc_open_mem(const char * path, int ioflags, size_t size, void *memory,
+	int *ncid_ptr)
+{
+	if(memory == NULL)
+		return NC_EINVAL;
+	fSet(ioflags, NC_INMEMORY);
+	return NC_open(path, ioflags, 0, size, memory, NULL, ncid_ptr);
+}
+
 int
 nc_open(const char * path, int ioflags, int *ncid_ptr)
 {
@@ -1158,8 +1226,13 @@ nc_enddef(int ncid)
 }
 
 
-int
-nc_close(int ncid)
+/*
+ * Common implementation of nc_close() and nc_close_memio().
+ * If memio is not NULL the content of an in-memory file is handed over
+ * to the caller.
+ */
+static int
+NC_close(int ncid, NC_memio *memio)
 {
 	int status = NC_NOERR;
 	NC *ncp; 
@@ -1205,6 +1278,14 @@ nc_close(int ncid)
 	    }
 	}
 
+	if (status == ENOERR && memio != NULL) {
+	    if (!fIsSet(ncp->nciop->ioflags, NC_INMEMORY))
+		status = NC_EINVAL;
+	    else
+		status = memio_extract(ncp->nciop, &memio->size, &memio->memory);
+	    memio->flags = 0;
+	}
+
 	(void) ncio_close(ncp->nciop, 0);
 	ncp->nciop = NULL;
 
@@ -1215,6 +1296,26 @@ nc_close(int ncid)
 	return status;
 }
 
+int
+nc_close(int ncid)
+{
+	return NC_close(ncid, NULL);
+}
+
+/*
+ * Close a file and, if it is an in-memory file, hand over its content.
+ * The memory returned in memio needs to be freed by the caller using free().
+ */
+int
+nc_close_memio(int ncid, NC_memio *memio)
+{
+	if(memio == NULL)
+		return NC_EINVAL;
+	memio->size = 0;
+	memio->memory = NULL;
+	return NC_close(ncid, memio);
+}
+
 
 int
 nc_delete(const char * path)
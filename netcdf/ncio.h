@@ -144,4 +144,34 @@ ncio_filesize(ncio *nciop, off_t *filesizep);
 extern int
 ncio_pad_length(ncio *nciop, off_t length);
 
+/*
+ * In-memory implementation (see memio.c).
+ * ncio_close(), ncio_filesize() and ncio_pad_length() dispatch to the
+ * memio functions for an ncio that has the NC_INMEMORY flag set.
+ */
+extern int
+memio_create(const char *path, int ioflags,
+	size_t initialsz,
+	off_t igeto, size_t igetsz, size_t *sizehintp,
+	ncio **nciopp, void **const igetvpp);
+
+extern int
+memio_open(const char *path,
+	int ioflags,
+	size_t size, void *memory,
+	off_t igeto, size_t igetsz, size_t *sizehintp,
+	ncio **nciopp, void **const igetvpp);
+
+extern int
+memio_extract(ncio *nciop, size_t *sizep, void **memoryp);
+
+extern int
+memio_close(ncio *nciop);
+
+extern int
+memio_filesize(ncio *nciop, off_t *filesizep);
+
+extern int
+memio_pad_length(ncio *nciop, off_t length);
+
 #endif /* _NCIO_H_ */
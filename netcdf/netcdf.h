@@ -108,6 +108,12 @@ typedef enum {
  */
 #define NC_LOCK		0x0400	/* Use locking if available */
 
+/*
+ * The file is stored in memory (set internally by nc_open_mem() and
+ * nc_create_mem())
+ */
+#define NC_INMEMORY	0x8000
+
 /*
  * Starting with version 3.6, there were two different format netCDF
  * files.  netCDF-4 introduces the third one.
@@ -262,6 +268,24 @@ nc__open(const char *path, int mode,
 EXTERNL int
 nc_open(const char *path, int mode, int *ncidp);
 
+/*
+ * Memory used by nc_open_mem() and returned by nc_close_memio()
+ */
+typedef struct NC_memio {
+	size_t size;
+	void *memory;
+	int flags;
+} NC_memio;
+
+EXTERNL int
+nc_open_mem(const char *path, int mode, size_t size, void *memory, int *ncidp);
+
+EXTERNL int
+nc_create_mem(const char *path, int cmode, size_t initialsize, int *ncidp);
+
+EXTERNL int
+nc_close_memio(int ncid, NC_memio *memio);
+
 EXTERNL int
 nc_set_fill(int ncid, int fillmode, int *old_modep);
 
@@ -20,6 +20,10 @@
 #else
 #include <unistd.h>
 #endif
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#define USE_MMAP_READ 1
+#endif
 
 #ifndef SEEK_SET
 #define SEEK_SET 0
@@ -1341,6 +1345,195 @@ ncio_spx_init(ncio *const nciop)
 }
 
 
+#ifdef USE_MMAP_READ
+
+/* Begin mpx */
+
+/* This is the struct that gets hung of ncio->pvt when a file that is
+   opened read-only (and without NC_SHARE) could be mapped into memory.
+
+   map_base - start of the read-only mapping of the whole file.
+   map_size - size of the mapping (i.e. the file size at open time).
+   bf_offset - file offset corresponding to start of bounce buffer.
+   bf_extent - allocated size of the bounce buffer.
+   bf_base - bounce buffer, only used for regions that extend beyond
+   the end of the file (these get zero filled, like px_pgin does).
+*/
+typedef struct ncio_mpx {
+	void	*map_base;
+	size_t	map_size;
+	/* bounce buffer */
+	off_t	bf_offset;
+	size_t	bf_extent;
+	void	*bf_base;
+} ncio_mpx;
+
+
+/*ARGSUSED*/
+/* Release the region starting at offset. Nothing needs to be done for
+   a read-only mapping.
+*/
+static int
+ncio_mpx_rel(ncio *const nciop, off_t offset, int rflags)
+{
+	ncio_mpx *const mpxp = (ncio_mpx *)nciop->pvt;
+
+	(void)offset;
+	if(fIsSet(rflags, RGN_MODIFIED))
+		return EPERM; /* attempt to write readonly file */
+	mpxp->bf_offset = OFF_NONE;
+	return ENOERR;
+}
+
+
+/* Request that the region (offset, extent) be made available through
+   *vpp.
+
+   Regions that lie within the file are returned as a pointer straight
+   into the mapping, so the caller converts the external data without
+   an intermediate read() into a page buffer. Regions that extend
+   beyond the end of the file are copied into a zero filled bounce
+   buffer.
+*/
+static int
+ncio_mpx_get(ncio *const nciop,
+		off_t offset, size_t extent,
+		int rflags,
+		void **const vpp)
+{
+	ncio_mpx *const mpxp = (ncio_mpx *)nciop->pvt;
+
+	if(fIsSet(rflags, RGN_WRITE))
+		return EPERM; /* attempt to write readonly file */
+
+	if(offset < 0)
+		return EINVAL;
+
+	if((size_t)offset <= mpxp->map_size && extent <= mpxp->map_size - (size_t)offset)
+	{
+		*vpp = (char *)mpxp->map_base + offset;
+		return ENOERR;
+	}
+
+	if(extent > mpxp->bf_extent)
+	{
+		void *base = realloc(mpxp->bf_base, extent);
+		if(base == NULL)
+			return ENOMEM;
+		mpxp->bf_base = base;
+		mpxp->bf_extent = extent;
+	}
+	(void) memset(mpxp->bf_base, 0, extent);
+	if((size_t)offset < mpxp->map_size)
+	{
+		(void) memcpy(mpxp->bf_base, (char *)mpxp->map_base + offset,
+			mpxp->map_size - (size_t)offset);
+	}
+	mpxp->bf_offset = offset;
+
+	*vpp = mpxp->bf_base;
+	return ENOERR;
+}
+
+
+/*ARGSUSED*/
+/* Moving data is not possible for a read-only mapping. */
+static int
+ncio_mpx_move(ncio *const nciop, off_t to, off_t from,
+			size_t nbytes, int rflags)
+{
+	(void)nciop;
+	(void)to;
+	(void)from;
+	(void)nbytes;
+	(void)rflags;
+	return EPERM; /* attempt to write readonly file */
+}
+
+
+/*ARGSUSED*/
+/* There are never any dirty buffers for a read-only mapping. */
+static int
+ncio_mpx_sync(ncio *const nciop)
+{
+	(void)nciop;
+	return ENOERR;
+}
+
+
+/* Internal function called at close to
+   free up anything hanging off pvt.
+*/
+static void
+ncio_mpx_free(void *const pvt)
+{
+	ncio_mpx *const mpxp = (ncio_mpx *)pvt;
+
+	if(mpxp == NULL)
+		return;
+
+	if(mpxp->map_base != NULL)
+	{
+		(void) munmap(mpxp->map_base, mpxp->map_size);
+		mpxp->map_base = NULL;
+		mpxp->map_size = 0;
+	}
+	if(mpxp->bf_base != NULL)
+	{
+		free(mpxp->bf_base);
+		mpxp->bf_base = NULL;
+		mpxp->bf_extent = 0;
+		mpxp->bf_offset = OFF_NONE;
+	}
+}
+
+
+/* Try to map the (already opened) file into memory and, if that
+   succeeds, switch the ncio struct over to the ncio_mpx_* functions.
+
+   This is only attempted for files opened read-only without NC_SHARE
+   (ncio_new reserves room for an ncio_mpx in that case). If the file is
+   empty, too large to map, or mmap() fails, the ncio struct is left
+   untouched and the caller continues with the buffered ncio_px
+   functions.
+
+   Returns non-zero if the mapping is in use.
+*/
+static int
+ncio_mpx_init(ncio *const nciop)
+{
+	ncio_mpx *const mpxp = (ncio_mpx *)nciop->pvt;
+	struct stat sb;
+	void *base;
+
+	assert(nciop->fd >= 0);
+
+	if(fstat(nciop->fd, &sb) < 0 || sb.st_size <= 0)
+		return 0;
+	if((off_t)(size_t)sb.st_size != sb.st_size)
+		return 0;
+
+	base = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, nciop->fd, 0);
+	if(base == MAP_FAILED)
+		return 0;
+
+	*((ncio_relfunc **)&nciop->rel) = ncio_mpx_rel; /* cast away const */
+	*((ncio_getfunc **)&nciop->get) = ncio_mpx_get; /* cast away const */
+	*((ncio_movefunc **)&nciop->move) = ncio_mpx_move; /* cast away const */
+	*((ncio_syncfunc **)&nciop->sync) = ncio_mpx_sync; /* cast away const */
+	*((ncio_freefunc **)&nciop->free) = ncio_mpx_free; /* cast away const */
+
+	mpxp->map_base = base;
+	mpxp->map_size = (size_t)sb.st_size;
+	mpxp->bf_offset = OFF_NONE;
+	mpxp->bf_extent = 0;
+	mpxp->bf_base = NULL;
+
+	return 1;
+}
+
+#endif /* USE_MMAP_READ */
+
 /* */
 
 /* This will call whatever free function is attached to the free
@@ -1381,6 +1574,12 @@ ncio_new(const char *path, int ioflags)
 		sz_ncio_pvt = sizeof(ncio_spx);
 	else
 		sz_ncio_pvt = sizeof(ncio_px);
+#ifdef USE_MMAP_READ
+	/* leave room for switching to ncio_mpx in ncio_open */
+	if(!fIsSet(ioflags, NC_SHARE) && !fIsSet(ioflags, NC_WRITE)
+		&& sz_ncio_pvt < sizeof(ncio_mpx))
+		sz_ncio_pvt = sizeof(ncio_mpx);
+#endif
 
 	nciop = (ncio *) malloc(sz_ncio + sz_path + sz_ncio_pvt);
 	if(nciop == NULL)
@@ -1615,6 +1814,10 @@ ncio_open(const char *path,
 
 	if(fIsSet(nciop->ioflags, NC_SHARE))
 		status = ncio_spx_init2(nciop, sizehintp);
+#ifdef USE_MMAP_READ
+	else if(!fIsSet(nciop->ioflags, NC_WRITE) && ncio_mpx_init(nciop))
+		status = ENOERR;
+#endif
 	else
 		status = ncio_px_init2(nciop, sizehintp, 0);
 
@@ -1651,6 +1854,8 @@ ncio_filesize(ncio *nciop, off_t *filesizep)
     struct stat sb;
 
     assert(nciop != NULL);
+    if (fIsSet(nciop->ioflags, NC_INMEMORY))
+	return memio_filesize(nciop, filesizep);
     if (fstat(nciop->fd, &sb) < 0)
 	return errno;
     *filesizep = sb.st_size;
@@ -1672,6 +1877,9 @@ ncio_pad_length(ncio *nciop, off_t length)
 	if(nciop == NULL)
 		return EINVAL;
 
+	if(fIsSet(nciop->ioflags, NC_INMEMORY))
+		return memio_pad_length(nciop, length);
+
 	if(!fIsSet(nciop->ioflags, NC_WRITE))
 	        return EPERM; /* attempt to write readonly file */
 
@@ -1704,6 +1912,9 @@ ncio_close(ncio *nciop, int doUnlink)
 	if(nciop == NULL)
 		return EINVAL;
 
+	if(fIsSet(nciop->ioflags, NC_INMEMORY))
+		return memio_close(nciop);
+
 	status = nciop->sync(nciop);
 
 	(void) close(nciop->fd);
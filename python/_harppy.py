@@ -36,6 +36,13 @@ import datetime
 import glob
 import numpy
 import os
+import sys
+import threading
+
+try:
+    import queue as _queue
+except ImportError:
+    import Queue as _queue
 
 try:
     from cStringIO import StringIO
@@ -48,7 +55,12 @@ except ImportError:
 from harp._harpc import ffi as _ffi
 
 __all__ = ["Error", "CLibraryError", "UnsupportedTypeError", "UnsupportedDimensionError", "Variable", "Product",
-           "get_encoding", "set_encoding", "version", "import_product", "export_product", "concatenate", "to_dict"]
+           "NativeProduct", "Dataset",
+           "get_encoding", "set_encoding", "version", "import_product", "import_products", "import_product_chunks",
+           "open_dataset",
+           "export_product", "publish_shared_memory", "map_shared_memory", "unlink_shared_memory",
+           "execute_operations", "concatenate",
+           "to_dict", "get_io_statistics", "reset_io_statistics"]
 
 class Error(Exception):
     """Exception base class for all HARP Python interface errors."""
@@ -66,7 +78,7 @@ class CLibraryError(Error):
     """
     def __init__(self, errno=None, strerror=None):
         if errno is None:
-            errno = _lib.harp_errno
+            errno = _lib.harp_get_errno()[0]
 
         if strerror is None:
             strerror = _decode_string(_ffi.string(_lib.harp_errno_to_string(errno)))
@@ -337,6 +349,157 @@ class Product(object):
 
         return stream.getvalue()
 
+class NativeProduct(object):
+    """Handle to a HARP product that is kept in the memory of the HARP C library.
+
+    A NativeProduct is returned by harp.import_product() if native=True, and can
+    also be created from a Product. Operations, derivations, and exports are
+    performed directly on the C product, so chaining them does not require the
+    product to be converted to its Python representation and back in between.
+
+    Variable data is only converted to NumPy arrays when a variable is accessed
+    explicitly, using either the attribute access '.' syntax or the item access
+    '[]' syntax, or when the whole product is converted using to_product(). The
+    variables returned are copies; modifying them does not modify the product.
+    """
+    def __init__(self, product=None):
+        if product is not None and not isinstance(product, Product):
+            raise TypeError("product must be Product, not %r" % product.__class__.__name__)
+
+        c_product_ptr = _ffi.new("harp_product **")
+        if _lib.harp_product_new(c_product_ptr) != 0:
+            raise CLibraryError()
+        self._c_product = _ffi.gc(c_product_ptr[0], _lib.harp_product_delete)
+
+        if product is not None:
+            # The C product outlives the function call, so its variables cannot borrow the memory of the NumPy arrays.
+            _export_product(product, self._c_product)
+
+    @property
+    def source_product(self):
+        if not self._c_product.source_product:
+            return None
+        return _decode_string(_ffi.string(self._c_product.source_product))
+
+    @property
+    def history(self):
+        if not self._c_product.history:
+            return None
+        return _decode_string(_ffi.string(self._c_product.history))
+
+    def _verify_key(self, key):
+        if not isinstance(key, str):
+            raise TypeError("key must be str, not %r" % key.__class__.__name__)
+
+    def __getattr__(self, name):
+        # Only called for attributes that are not found the regular way, i.e. variables.
+        if name.startswith("_"):
+            raise AttributeError(name)
+        try:
+            return self[name]
+        except KeyError:
+            raise AttributeError(name)
+
+    def __getitem__(self, key):
+        self._verify_key(key)
+        c_variable_ptr = _ffi.new("harp_variable **")
+        if _lib.harp_product_has_variable(self._c_product, _encode_string(key)) != 1:
+            raise KeyError(key)
+        if _lib.harp_product_get_variable_by_name(self._c_product, _encode_string(key), c_variable_ptr) != 0:
+            raise CLibraryError()
+        return _import_variable(c_variable_ptr[0])
+
+    def __delitem__(self, key):
+        self._verify_key(key)
+        if _lib.harp_product_has_variable(self._c_product, _encode_string(key)) != 1:
+            raise KeyError(key)
+        if _lib.harp_product_remove_variable_by_name(self._c_product, _encode_string(key)) != 0:
+            raise CLibraryError()
+
+    def __len__(self):
+        return self._c_product.num_variables
+
+    def __iter__(self):
+        c_product = self._c_product
+        return iter([_decode_string(_ffi.string(c_product.variable[i].name)) for i in range(c_product.num_variables)])
+
+    def __contains__(self, name):
+        return isinstance(name, str) and _lib.harp_product_has_variable(self._c_product, _encode_string(name)) == 1
+
+    def __repr__(self):
+        return "<NativeProduct variables=%r>" % list(self)
+
+    def __str__(self):
+        # Describe the variables using the C product only, so no variable data is converted.
+        stream = StringIO()
+        c_product = self._c_product
+        for c_variable in [c_product.variable[i] for i in range(c_product.num_variables)]:
+            stream.write(_c_data_type_name[c_variable.data_type] + " " + _decode_string(_ffi.string(c_variable.name)))
+            if c_variable.num_dimensions > 0:
+                dimension = []
+                for i in range(c_variable.num_dimensions):
+                    dimension_type = _get_py_dimension_type(c_variable.dimension_type[i])
+                    length = str(c_variable.dimension[i])
+                    dimension.append(length if dimension_type is None else dimension_type + "=" + length)
+                stream.write(" {" + ", ".join(dimension) + "}")
+            if c_variable.unit != _ffi.NULL:
+                stream.write(" [%s]" % _decode_string(_ffi.string(c_variable.unit)))
+            stream.write("\n")
+        return stream.getvalue()
+
+    def execute_operations(self, operations):
+        """Apply operations to the product (in place).
+
+        Arguments:
+        operations -- Actions to apply; should be specified as a semi-colon
+                      separated string of operations.
+
+        """
+        if _lib.harp_product_execute_operations(self._c_product, _encode_string(operations)) != 0:
+            raise CLibraryError()
+        _update_c_history(self._c_product, "harp.execute_operations(operations='{0}')".format(operations))
+
+    def derive(self, name, dimension=[], unit=None):
+        """Add a derived variable to the product (in place).
+
+        An existing variable with the same name is replaced by the derived variable
+        (converted to the specified dimensions and unit, if possible).
+
+        Arguments:
+        name -- Name of the variable to derive.
+        dimension -- List of dimension names of the variable to derive.
+        unit -- Unit of the variable to derive; if not provided, the default unit
+                for the variable is used.
+
+        """
+        c_dimension_type = [_get_c_dimension_type(dimension_name) for dimension_name in dimension]
+        c_unit = _ffi.NULL if unit is None else _encode_string(unit)
+        if _lib.harp_product_add_derived_variable(self._c_product, _encode_string(name), _ffi.NULL, c_unit,
+                                                  len(c_dimension_type), c_dimension_type) != 0:
+            raise CLibraryError()
+
+    def copy(self):
+        """Return a copy of the product.
+
+        The copy shares its variable data with this product until either of the
+        two is modified, so making a copy is cheap.
+
+        """
+        c_product_ptr = _ffi.new("harp_product **")
+        if _lib.harp_product_copy_shared(self._c_product, c_product_ptr) != 0:
+            raise CLibraryError()
+        return _wrap_c_product(c_product_ptr[0])
+
+    def to_product(self):
+        """Convert the product to its Python representation (a Product)."""
+        c_product_ptr = _ffi.new("harp_product **")
+        if _lib.harp_product_copy(self._c_product, c_product_ptr) != 0:
+            raise CLibraryError()
+        try:
+            return _import_product(c_product_ptr[0])
+        finally:
+            _lib.harp_product_delete(c_product_ptr[0])
+
 def _get_c_library_filename():
     """Return the filename of the HARP shared library depending on the current
     platform.
@@ -723,7 +886,7 @@ def _import_scalar(c_data_type, c_data):
 
     raise UnsupportedTypeError("unsupported C data type code '%d'" % c_data_type)
 
-def _import_array(c_data_type, c_num_elements, c_data):
+def _import_array(c_data_type, c_num_elements, c_data, c_owner=None, read_only=False):
     if c_data_type == _lib.harp_type_string:
         data = numpy.empty((c_num_elements,), dtype=numpy.object)
         for i in range(c_num_elements):
@@ -731,14 +894,26 @@ def _import_array(c_data_type, c_num_elements, c_data):
             data[i] = _decode_string(_ffi.string(c_data.string_data[i]))
         return data
 
-    # NB. The _ffi.buffer() method, as well as the numpy.frombuffer() method, provide a view on the C array; neither
-    # method incurs a copy.
-    c_data_buffer = _ffi.buffer(c_data.ptr, c_num_elements * _lib.harp_get_size_for_type(c_data_type))
-    return numpy.copy(numpy.frombuffer(c_data_buffer, dtype=_get_py_data_type(c_data_type)))
+    c_data_ptr = c_data.ptr
+    if c_owner is not None:
+        # Take ownership of the C array: the C variable that owns it (and that should already have been detached from
+        # its product) is deleted once the (garbage collected) pointer that backs the numpy array goes away.
+        c_data_ptr = _ffi.gc(c_data_ptr, lambda ptr: _lib.harp_variable_delete(c_owner))
 
-def _import_variable(c_variable):
+    # NB. The _ffi.buffer() method, as well as the numpy.frombuffer() method, provide a view on the C array; neither
+    # method incurs a copy. The buffer keeps the pointer that it was created from alive.
+    c_data_buffer = _ffi.buffer(c_data_ptr, c_num_elements * _lib.harp_get_size_for_type(c_data_type))
+    data = numpy.frombuffer(c_data_buffer, dtype=_get_py_data_type(c_data_type))
+    if c_owner is None:
+        data = numpy.copy(data)
+    elif read_only:
+        # The C array is a read-only memory mapping, so writing to it would crash the process.
+        data.flags.writeable = False
+    return data
+
+def _import_variable(c_variable, c_owner=None, read_only=False):
     # Import variable data.
-    data = _import_array(c_variable.data_type, c_variable.num_elements, c_variable.data)
+    data = _import_array(c_variable.data_type, c_variable.num_elements, c_variable.data, c_owner, read_only)
 
     num_dimensions = c_variable.num_dimensions
     if num_dimensions == 0:
@@ -765,7 +940,7 @@ def _import_variable(c_variable):
 
     return variable
 
-def _import_product(c_product):
+def _import_product(c_product, read_only=False):
     product = Product()
 
     # Import product attributes.
@@ -776,9 +951,15 @@ def _import_product(c_product):
         product.history = _decode_string(_ffi.string(c_product.history))
 
     # Import variables.
-    for i in range(c_product.num_variables):
-        c_variable_ptr = c_product.variable[i]
-        variable = _import_variable(c_variable_ptr[0])
+    for c_variable_ptr in [c_product.variable[i] for i in range(c_product.num_variables)]:
+        c_owner = None
+        if c_variable_ptr[0].data_type != _lib.harp_type_string and c_variable_ptr[0].num_dimensions > 0:
+            # Detach the variable from the product such that the numpy array can reference the C array directly
+            # instead of using a copy; the variable is deleted once the numpy array is garbage collected.
+            if _lib.harp_product_detach_variable(c_product, c_variable_ptr) != 0:
+                raise CLibraryError()
+            c_owner = c_variable_ptr
+        variable = _import_variable(c_variable_ptr[0], c_owner, read_only)
         setattr(product, _decode_string(_ffi.string(c_variable_ptr[0].name)), variable)
 
     return product
@@ -817,7 +998,16 @@ def _export_array(data, c_variable):
         if _lib.harp_variable_set_string_data_element(c_variable, 0, _encode_string(data)) != 0:
             raise CLibraryError()
 
-def _export_variable(name, variable, c_product):
+def _can_borrow_array(data, c_data_type):
+    """Return True if the C library can directly use the memory of the NumPy array
+    as data for a variable of the specified C data type.
+
+    """
+    return (isinstance(data, numpy.ndarray) and data.ndim > 0 and c_data_type != _lib.harp_type_string and
+            data.dtype == numpy.dtype(_get_py_data_type(c_data_type)) and data.flags.c_contiguous and
+            data.flags.aligned)
+
+def _export_variable(name, variable, c_product, borrow_data=False):
     data = getattr(variable, "data", None)
     if data is None:
         raise Error("no data or data is None")
@@ -855,10 +1045,17 @@ def _export_variable(name, variable, c_product):
     c_dimension_type = [_get_c_dimension_type(dimension_name) for dimension_name in dimension]
     c_dimension = _ffi.NULL if not dimension else data.shape
 
-    # Create C variable of the proper size.
+    # Create C variable of the proper size. If allowed, the C variable will refer to the memory of the NumPy array
+    # instead of a copy (the NumPy array then needs to stay alive for as long as the C variable exists).
+    borrow_data = borrow_data and _can_borrow_array(data, c_data_type)
     c_variable_ptr = _ffi.new("harp_variable **")
-    if _lib.harp_variable_new(c_name, c_data_type, c_num_dimensions, c_dimension_type, c_dimension,
-                              c_variable_ptr) != 0:
+    if borrow_data:
+        if _lib.harp_variable_new_with_borrowed_data(c_name, c_data_type, c_num_dimensions, c_dimension_type,
+                                                     c_dimension, _ffi.cast("void *", data.ctypes.data),
+                                                     c_variable_ptr) != 0:
+            raise CLibraryError()
+    elif _lib.harp_variable_new(c_name, c_data_type, c_num_dimensions, c_dimension_type, c_dimension,
+                                c_variable_ptr) != 0:
         raise CLibraryError()
 
     # Add C variable to C product.
@@ -872,7 +1069,8 @@ def _export_variable(name, variable, c_product):
     c_variable = c_variable_ptr[0]
 
     # Copy data into the C variable.
-    _export_array(data, c_variable)
+    if not borrow_data:
+        _export_array(data, c_variable)
 
     # Variable attributes.
     if c_data_type != _lib.harp_type_string:
@@ -937,7 +1135,7 @@ def _export_variable(name, variable, c_product):
                                                               [_ffi.new("char[]", _encode_string(name)) for name in enum]) != 0:
             raise CLibraryError()
 
-def _export_product(product, c_product):
+def _export_product(product, c_product, borrow_data=False):
     # Export product attributes.
     try:
         source_product = product.source_product
@@ -958,14 +1156,31 @@ def _export_product(product, c_product):
     # Export variables.
     for name in product:
         try:
-            _export_variable(name, product[name], c_product)
+            _export_variable(name, product[name], c_product, borrow_data)
         except Error as _error:
             raise Error("variable '%r' could not be exported (%s)" % (name, str(_error)))
 
-def _update_history(product, command):
+def _wrap_c_product(c_product):
+    # Create a NativeProduct that takes ownership of the C product.
+    product = NativeProduct.__new__(NativeProduct)
+    product._c_product = _ffi.gc(c_product, _lib.harp_product_delete)
+    return product
+
+def _get_history_line(command):
     line = datetime.datetime.utcnow().strftime("%Y-%m-%dT%H:%M:%SZ")
     line += " [harp-%s] " % (version())
     line += command
+    return line
+
+def _update_c_history(c_product, command):
+    history = _get_history_line(command)
+    if c_product.history:
+        history = _decode_string(_ffi.string(c_product.history)) + "\n" + history
+    if _lib.harp_product_set_history(c_product, _encode_string(history)) != 0:
+        raise CLibraryError()
+
+def _update_history(product, command):
+    line = _get_history_line(command)
     try:
         product.history += "\n" + line
     except AttributeError:
@@ -991,6 +1206,34 @@ def version():
     """Return the version of the HARP C library."""
     return _decode_string(_ffi.string(_lib.libharp_version))
 
+def get_io_statistics(backend=None):
+    """Return the I/O statistics of the HARP C library.
+
+    The statistics contain the number of files that were opened and closed,
+    the number of read requests, and the number of bytes requested by those
+    read requests since the start of the program (or since the last call to
+    reset_io_statistics()).
+
+    Arguments:
+    backend -- Name of the file access backend ("coda", "hdf4", "hdf5",
+               "netcdf", "zarr", or "arrow"). If not provided, a dictionary
+               with the statistics of all backends is returned.
+
+    """
+    if backend is None:
+        return OrderedDict((name, get_io_statistics(name)) for name in ("coda", "hdf4", "hdf5", "netcdf", "zarr", "arrow"))
+
+    c_statistics = _ffi.new("harp_io_statistics *")
+    if _lib.harp_get_io_statistics(_encode_string(backend), c_statistics) != 0:
+        raise CLibraryError()
+
+    return OrderedDict([("num_open", c_statistics.num_open), ("num_close", c_statistics.num_close),
+                        ("num_read_calls", c_statistics.num_read_calls), ("bytes_read", c_statistics.bytes_read)])
+
+def reset_io_statistics():
+    """Reset the I/O statistics of the HARP C library (see get_io_statistics())."""
+    _lib.harp_reset_io_statistics()
+
 def to_dict(product):
     """Convert a Product to an OrderedDict.
 
@@ -1023,7 +1266,7 @@ def to_dict(product):
 
     return dictionary
 
-def import_product(filename, operations="", options=""):
+def import_product(filename, operations="", options="", native=False):
     """Import a product from a file.
 
     This will first try to import the file as an HDF4, HDF5, or netCDF file that
@@ -1043,6 +1286,9 @@ def import_product(filename, operations="", options=""):
     options -- Ingestion module specific options; should be specified as a semi-
                colon separated string of key=value pairs; only used if the file is not
                in HARP format.
+    native -- If True, return a NativeProduct that keeps the product in the memory of
+              the HARP C library instead of converting it to a Product; multiple files
+              are then merged by the C library.
 
     """
     filenames = None
@@ -1058,20 +1304,49 @@ def import_product(filename, operations="", options=""):
         products = []
         for file in filenames:
             try:
-                product = import_product(file, operations, options)
+                product = import_product(file, operations, options, native)
                 products.append(product)
             except NoDataError:
                 pass
         if len(products) == 0:
             raise NoDataError()
+        if native:
+            # Merge the C products in the same way as harp.concatenate() merges Python products.
+            product = products[0]
+            for other_product in products[1:] or [None]:
+                c_other_product = _ffi.NULL if other_product is None else other_product._c_product
+                if _lib.harp_product_append(product._c_product, c_other_product) != 0:
+                    raise CLibraryError()
+            return product
         return concatenate(products)
 
+    return _import_single_product(filename, operations, options, native)
+
+def _import_single_product(filename, operations, options, native=False):
     c_product_ptr = _ffi.new("harp_product **")
 
-    # Import the product as a C product.
+    # Import the product as a C product. NB. cffi releases the GIL for the duration of the call, so imports that are
+    # performed from different Python threads can run in parallel.
     if _lib.harp_import(_encode_path(filename), _encode_string(operations), _encode_string(options), c_product_ptr) != 0:
         raise CLibraryError()
 
+    command = None
+    if operations or options:
+        command = "harp.import_product('{0}'".format(filename)
+        if operations:
+            command += ",operations='{0}'".format(operations)
+        if options:
+            command += ",options='{0}'".format(options)
+        command += ")"
+
+    if native:
+        product = _wrap_c_product(c_product_ptr[0])
+        if _lib.harp_product_is_empty(product._c_product) == 1:
+            raise NoDataError()
+        if command is not None:
+            _update_c_history(product._c_product, command)
+        return product
+
     try:
         # Raise an exception if the imported C product contains no variables, or variables without data.
         if _lib.harp_product_is_empty(c_product_ptr[0]) == 1:
@@ -1080,14 +1355,8 @@ def import_product(filename, operations="", options=""):
         # Convert the C product into its Python representation.
         product = _import_product(c_product_ptr[0])
 
-        if operations or options:
+        if command is not None:
             # Update history
-            command = "harp.import_product('{0}'".format(filename)
-            if operations:
-                command += ",operations='{0}'".format(operations)
-            if options:
-                command += ",options='{0}'".format(options)
-            command += ")"
             _update_history(product, command)
 
         return product
@@ -1095,20 +1364,433 @@ def import_product(filename, operations="", options=""):
     finally:
         _lib.harp_product_delete(c_product_ptr[0])
 
-def export_product(product, filename, file_format="netcdf", operations="", hdf5_compression=0):
+def _import_products_iter(filenames, operations, options, workers, ordered):
+    tasks = _queue.Queue()
+    for task in enumerate(filenames):
+        tasks.put(task)
+    num_tasks = tasks.qsize()
+    results = _queue.Queue()
+    # Limit the number of imported products that have not been consumed yet.
+    pending = threading.Semaphore(2 * workers)
+    stop = threading.Event()
+
+    def worker():
+        while not stop.is_set():
+            pending.acquire()
+            if stop.is_set():
+                return
+            try:
+                index, filename = tasks.get_nowait()
+            except _queue.Empty:
+                pending.release()
+                return
+            try:
+                result = (index, _import_single_product(filename, operations, options), None)
+            except NoDataError:
+                result = (index, None, None)
+            except Exception:
+                result = (index, None, sys.exc_info()[1])
+            results.put(result)
+
+    threads = [threading.Thread(target=worker) for _ in range(min(workers, num_tasks))]
+    for thread in threads:
+        thread.daemon = True
+        thread.start()
+
+    try:
+        completed = {}
+        next_index = 0
+        for _ in range(num_tasks):
+            index, product, error = results.get()
+            pending.release()
+            if error is not None:
+                raise error
+            if not ordered:
+                if product is not None:
+                    yield product
+                continue
+            completed[index] = product
+            while next_index in completed:
+                product = completed.pop(next_index)
+                next_index += 1
+                if product is not None:
+                    yield product
+    finally:
+        # Stop the workers (e.g. on error or if the caller stops iterating); imports in progress will still finish.
+        stop.set()
+        for _ in threads:
+            pending.release()
+
+def import_products(filename, operations="", options="", workers=None, ordered=True, merge=False):
+    """Import products from multiple files in parallel.
+
+    Each file is imported as with harp.import_product() using a pool of
+    threads. Work done by the HARP C library (e.g. performing operations) for
+    different files can overlap, since the Python interpreter is not blocked while
+    the C library is running. Note that the actual reading of the files is
+    performed one file at a time, since the underlying file format libraries are
+    not thread-safe. Files that result in an empty product are skipped.
+
+    Arguments:
+    filename -- List of filenames or file pattern of the products to import
+    operations -- Actions to apply as part of the import; should be specified as a
+                  semi-colon separated string of operations.
+    options -- Ingestion module specific options; should be specified as a semi-
+               colon separated string of key=value pairs; only used if a file is
+               not in HARP format.
+    workers -- Number of threads to use (default is the HARP number of threads
+               option, which can be set with the HARP_NUM_THREADS environment
+               variable).
+    ordered -- If True, products are returned in the order of the filenames;
+               otherwise, products are returned as soon as they are available.
+    merge -- If True, the imported products are merged with harp.concatenate()
+             (in the order of the filenames) and the merged product is returned.
+
+    Returns an iterator over the imported products, or the merged product if
+    merge is True.
+
+    """
+    if isinstance(filename, bytes) or isinstance(filename, str):
+        filenames = sorted(glob.glob(filename))
+        if len(filenames) == 0:
+            raise Error("no files matching '%s'" % (filename))
+    else:
+        filenames = list(filename)
+
+    if workers is None:
+        workers = _lib.harp_get_option_num_threads()
+    if workers < 1:
+        raise ValueError("number of workers should be at least 1")
+
+    products = _import_products_iter(filenames, operations, options, workers, ordered or merge)
+    if not merge:
+        return products
+
+    products = list(products)
+    if len(products) == 0:
+        raise NoDataError()
+    return concatenate(products)
+
+def _import_product_chunks_iter(filename, operations, options, c_stream):
+    try:
+        c_product_ptr = _ffi.new("harp_product **")
+        while True:
+            if _lib.harp_import_stream_next(c_stream, c_product_ptr) != 0:
+                raise CLibraryError()
+            if c_product_ptr[0] == _ffi.NULL:
+                return
+
+            try:
+                product = _import_product(c_product_ptr[0])
+            finally:
+                _lib.harp_product_delete(c_product_ptr[0])
+
+            if operations or options:
+                # Update history
+                command = "harp.import_product_chunks('{0}'".format(filename)
+                if operations:
+                    command += ",operations='{0}'".format(operations)
+                if options:
+                    command += ",options='{0}'".format(options)
+                command += ")"
+                _update_history(product, command)
+
+            yield product
+    finally:
+        # Close the stream as soon as the iteration ends (instead of waiting for garbage collection).
+        _ffi.gc(c_stream, None)
+        _lib.harp_import_stream_close(c_stream)
+
+def import_product_chunks(filename, chunk_size=10000, operations="", options=""):
+    """Import a product from a file in chunks along the time dimension.
+
+    Each chunk contains at most chunk_size consecutive time samples of the
+    product, with the operations applied to it. This makes it possible to
+    process products that are too large to be imported as a whole. Only
+    operations that treat each time sample independently can be used (e.g. no
+    bin(), sort(), or regrid() along the time dimension). Chunks that are empty
+    after applying the operations are skipped.
+
+    Products that are not in HARP format are read in chunks by the ingestion
+    module. Products that are already in HARP format are imported as a whole
+    and are only returned in chunks.
+
+    Arguments:
+    filename -- Filename of the product to import
+    chunk_size -- Maximum number of time samples of each chunk.
+    operations -- Actions to apply to each chunk; should be specified as a semi-
+                  colon separated string of operations.
+    options -- Ingestion module specific options; should be specified as a semi-
+               colon separated string of key=value pairs; only used if the file
+               is not in HARP format.
+
+    Returns an iterator over the imported chunks.
+
+    """
+    if chunk_size < 1:
+        raise ValueError("chunk size should be at least 1")
+
+    c_stream_ptr = _ffi.new("harp_import_stream **")
+    if _lib.harp_import_stream_open(_encode_path(filename), _encode_string(operations), _encode_string(options),
+                                    int(chunk_size), c_stream_ptr) != 0:
+        raise CLibraryError()
+
+    # The stream is closed by the iterator; the destructor only closes the stream if iteration is never started.
+    c_stream = _ffi.gc(c_stream_ptr[0], _lib.harp_import_stream_close)
+    return _import_product_chunks_iter(filename, operations, options, c_stream)
+
+def _import_product_schema(filename, operations, options):
+    # Import the first non-empty time sample of the product to determine its variables. If the operations can not be
+    # applied to individual time samples, the product is imported as a whole.
+    c_stream_ptr = _ffi.new("harp_import_stream **")
+    if _lib.harp_import_stream_open(_encode_path(filename), _encode_string(operations), _encode_string(options), 1,
+                                    c_stream_ptr) != 0:
+        return _import_single_product(filename, operations, options, native=True)
+
+    try:
+        c_product_ptr = _ffi.new("harp_product **")
+        if _lib.harp_import_stream_next(c_stream_ptr[0], c_product_ptr) != 0:
+            raise CLibraryError()
+        if c_product_ptr[0] == _ffi.NULL:
+            raise NoDataError()
+        return _wrap_c_product(c_product_ptr[0])
+    finally:
+        _lib.harp_import_stream_close(c_stream_ptr[0])
+
+class Dataset(object):
+    """Lazily evaluated view on the products of a HARP dataset.
+
+    A Dataset is returned by harp.open_dataset(). Only the metadata of the
+    products and the variable definitions of the first product are read when the
+    dataset is opened. Each variable can then be accessed (using either the
+    attribute access '.' syntax or the item access '[]' syntax) as a Variable of
+    which the data is a dask array with one chunk per product along the time
+    dimension. A chunk is only read (with the operations applied) when it is
+    computed, and only the variable that is accessed is imported from the
+    product. Variables that do not depend on time are taken from the first
+    product.
+
+    Apart from the time dimension, all products should have the same dimension
+    lengths for a variable (use harp.concatenate() on imported products
+    otherwise).
+    """
+    def __init__(self, filenames, time_length, operations, options):
+        self._filenames = filenames
+        self._time_length = time_length
+        self._operations = operations.strip().rstrip(";")
+        self._options = options
+
+        # Determine the variable definitions from the first product.
+        product = _import_product_schema(filenames[0], self._operations, options)
+        c_product = product._c_product
+        self._schema = OrderedDict()
+        for c_variable in [c_product.variable[i] for i in range(c_product.num_variables)]:
+            num_dimensions = c_variable.num_dimensions
+            dimension = [_get_py_dimension_type(c_variable.dimension_type[i]) for i in range(num_dimensions)]
+            shape = [c_variable.dimension[i] for i in range(num_dimensions)]
+            unit = None if c_variable.unit == _ffi.NULL else _decode_string(_ffi.string(c_variable.unit))
+            description = None
+            if c_variable.description:
+                description = _decode_string(_ffi.string(c_variable.description))
+            self._schema[_decode_string(_ffi.string(c_variable.name))] = \
+                (_get_py_data_type(c_variable.data_type), dimension, shape, unit, description)
+
+    @property
+    def filenames(self):
+        """List of the files of the products in the dataset."""
+        return list(self._filenames)
+
+    def _verify_key(self, key):
+        if not isinstance(key, str):
+            raise TypeError("key must be str, not %r" % key.__class__.__name__)
+
+    def __getattr__(self, name):
+        # Only called for attributes that are not found the regular way, i.e. variables.
+        if name.startswith("_"):
+            raise AttributeError(name)
+        try:
+            return self[name]
+        except KeyError:
+            raise AttributeError(name)
+
+    def __getitem__(self, key):
+        self._verify_key(key)
+        if key not in self._schema:
+            raise KeyError(key)
+        data_type, dimension, shape, unit, description = self._schema[key]
+        return Variable(self._get_array(key), list(dimension), unit=unit, description=description)
+
+    def __len__(self):
+        return len(self._schema)
+
+    def __iter__(self):
+        return iter(self._schema)
+
+    def __contains__(self, name):
+        return name in self._schema
+
+    def __repr__(self):
+        return "<Dataset products=%d variables=%r>" % (len(self._filenames), list(self._schema.keys()))
+
+    def _read_chunk(self, name, index):
+        data_type, dimension, shape, unit, description = self._schema[name]
+        time_dependent = dimension and dimension[0] == "time"
+
+        operations = "keep(%s)" % name
+        if self._operations:
+            operations = self._operations + ";" + operations
+
+        try:
+            product = _import_single_product(self._filenames[index], operations, self._options)
+        except NoDataError:
+            return numpy.empty([0] + shape[1:], dtype=data_type)
+        if name not in product:
+            raise Error("product '%s' does not contain variable '%s'" % (self._filenames[index], name))
+
+        data = numpy.asarray(product[name].data)
+        if list(data.shape[1 if time_dependent else 0:]) != shape[1 if time_dependent else 0:]:
+            raise Error("inconsistent dimension lengths for variable '%s' in product '%s'" %
+                        (name, self._filenames[index]))
+        if time_dependent and self._time_length is not None and data.shape[0] != self._time_length[index]:
+            raise Error("time dimension length of product '%s' does not match its metadata" %
+                        (self._filenames[index],))
+        return data
+
+    def _get_array(self, name):
+        import dask
+        import dask.array
+
+        data_type, dimension, shape, unit, description = self._schema[name]
+
+        if not dimension or dimension[0] != "time":
+            chunk = dask.delayed(self._read_chunk, pure=True)(name, 0)
+            return dask.array.from_delayed(chunk, tuple(shape), dtype=data_type)
+
+        chunks = []
+        for index in range(len(self._filenames)):
+            # Without operations the number of time samples of each product is known from its metadata (empty products
+            # can then be left out); otherwise the chunk sizes along the time dimension are unknown until computed.
+            if self._time_length is None:
+                length = numpy.nan
+            elif self._time_length[index] == 0:
+                continue
+            else:
+                length = self._time_length[index]
+            chunk = dask.delayed(self._read_chunk, pure=True)(name, index)
+            chunks.append(dask.array.from_delayed(chunk, tuple([length] + shape[1:]), dtype=data_type))
+        if len(chunks) == 0:
+            return dask.array.from_array(numpy.empty([0] + shape[1:], dtype=data_type), chunks=-1)
+        return dask.array.concatenate(chunks, axis=0)
+
+    def to_xarray(self):
+        """Return the dataset as an xarray.Dataset that is backed by dask arrays.
+
+        Independent dimensions are named 'independent_<length>'.
+
+        """
+        import xarray
+
+        data_vars = OrderedDict()
+        for name in self._schema:
+            data_type, dimension, shape, unit, description = self._schema[name]
+            dims = [dimension[i] if dimension[i] is not None else "independent_%d" % shape[i]
+                    for i in range(len(dimension))]
+            attrs = OrderedDict()
+            if unit is not None:
+                attrs["units"] = unit
+            if description:
+                attrs["description"] = description
+            data_vars[name] = xarray.Variable(dims, self._get_array(name), attrs)
+        return xarray.Dataset(data_vars)
+
+def open_dataset(filename, operations="", options=""):
+    """Open a set of products as a lazily evaluated Dataset.
+
+    Only the metadata of the products is read, together with the variable
+    definitions of the first product. The data of a variable is read per
+    product when the corresponding chunk of its dask array is computed (this
+    requires the dask package; Dataset.to_xarray() also requires xarray).
+
+    Arguments:
+    filename -- Path to a product file, a directory (all files in the directory
+                are used), a .pth file, a list of those, or a file pattern.
+    operations -- Actions to apply to each product; should be specified as a
+                  semi-colon separated string of operations. Leading filters on
+                  datetime, latitude, and longitude are used to skip products
+                  based on their metadata.
+    options -- Ingestion module specific options; should be specified as a semi-
+               colon separated string of key=value pairs; only used for files
+               that are not in HARP format.
+
+    """
+    paths = filename
+    if isinstance(filename, bytes) or isinstance(filename, str):
+        paths = [filename]
+        if '*' in filename or '?' in filename:
+            # This is a globbing pattern
+            paths = sorted(glob.glob(filename))
+            if len(paths) == 0:
+                raise Error("no files matching '%s'" % (filename))
+
+    c_dataset_ptr = _ffi.new("harp_dataset **")
+    if _lib.harp_dataset_new(c_dataset_ptr) != 0:
+        raise CLibraryError()
+
+    try:
+        c_dataset = c_dataset_ptr[0]
+        for path in paths:
+            if _lib.harp_dataset_import(c_dataset, _encode_path(path), _encode_string(options)) != 0:
+                raise CLibraryError()
+        if operations and _lib.harp_dataset_prefilter(c_dataset, _encode_string(operations)) != 0:
+            raise CLibraryError()
+
+        filenames = []
+        time_length = []
+        for i in range(c_dataset.num_products):
+            c_metadata = c_dataset.metadata[c_dataset.sorted_index[i]]
+            if c_metadata == _ffi.NULL:
+                raise Error("no metadata available for product '%s'" %
+                            _decode_string(_ffi.string(c_dataset.source_product[c_dataset.sorted_index[i]])))
+            filenames.append(_decode_string(_ffi.string(c_metadata.filename)))
+            time_length.append(c_metadata.dimension[_lib.harp_dimension_time])
+    finally:
+        _lib.harp_dataset_delete(c_dataset_ptr[0])
+
+    if len(filenames) == 0:
+        raise NoDataError()
+
+    # With operations, the number of time samples of a product is only known after importing it.
+    return Dataset(filenames, None if operations else time_length, operations, options)
+
+def export_product(product, filename, file_format="netcdf", operations="", hdf5_compression=0,
+                   hdf5_compression_filter="deflate"):
     """Export a HARP compliant product.
 
     Arguments:
-    product          -- Product to export.
+    product          -- Product or NativeProduct to export.
     filename         -- Filename of the exported product.
-    file_format      -- File format to use; one of 'netcdf', 'hdf4', or 'hdf5'.
+    file_format      -- File format to use; one of 'netcdf', 'hdf4', 'hdf5', 'zarr', or
+                        'arrow'.
     operations       -- Actions to apply as part of the export; should be specified as a
                         semi-colon separated string of operations.
     hdf5_compression -- Compression level when exporting to hdf5 (0=disabled, 1=low, ..., 9=high).
+    hdf5_compression_filter -- Compression filter when exporting to hdf5; one of 'deflate', 'zstd', or 'lz4'
+                        (zstd and lz4 require the corresponding HDF5 filter plugin; otherwise deflate is used).
 
     """
+    if isinstance(product, NativeProduct):
+        if not operations:
+            _export_c_product(product._c_product, filename, file_format, hdf5_compression, hdf5_compression_filter)
+            return
+
+        # Apply the operations to a (copy-on-write) copy, such that the product itself is left unmodified.
+        product = product.copy()
+        product.execute_operations(operations)
+        _export_c_product(product._c_product, filename, file_format, hdf5_compression, hdf5_compression_filter)
+        return
+
     if not isinstance(product, Product):
-        raise TypeError("product must be Product, not %r" % product.__class__.__name__)
+        raise TypeError("product must be Product or NativeProduct, not %r" % product.__class__.__name__)
 
     if operations:
         # Update history (but only if the export modifies the product)
@@ -1121,22 +1803,138 @@ def export_product(product, filename, file_format="netcdf", operations="", hdf5_
         raise CLibraryError()
 
     try:
-        # Convert the Python product to its C representation.
-        _export_product(product, c_product_ptr[0])
+        # Convert the Python product to its C representation. The C product can refer to the data of the NumPy arrays
+        # directly, since the product only exists for the duration of this function (any operations will make a copy
+        # of borrowed data before modifying it).
+        _export_product(product, c_product_ptr[0], borrow_data=True)
 
-        if operations:
-            # Apply operations to the product before export
-            _lib.harp_product_execute_operations(c_product_ptr[0], _encode_string(operations))
+        # Any operations are applied as part of the export (variable selections do not modify the C product).
+        _export_c_product(c_product_ptr[0], filename, file_format, hdf5_compression, hdf5_compression_filter,
+                          operations)
+
+    finally:
+        _lib.harp_product_delete(c_product_ptr[0])
+
+def _export_c_product(c_product, filename, file_format, hdf5_compression, hdf5_compression_filter, operations=""):
+    if file_format == 'hdf5':
+        _lib.harp_set_option_hdf5_compression(int(hdf5_compression))
+        if _lib.harp_set_option_hdf5_compression_filter(_encode_string(hdf5_compression_filter)) != 0:
+            raise CLibraryError()
+    if operations:
+        if _lib.harp_export_with_operations(_encode_path(filename), _encode_string(file_format), c_product,
+                                            _encode_string(operations)) != 0:
+            raise CLibraryError()
+    elif _lib.harp_export(_encode_path(filename), _encode_string(file_format), c_product) != 0:
+        raise CLibraryError()
+
+def publish_shared_memory(product, name):
+    """Publish a product in a named shared memory segment.
+
+    Other processes on the same host can then map the product using
+    harp.map_shared_memory() without copying its data. The segment should not
+    exist yet and is kept until it is removed using harp.unlink_shared_memory().
+
+    Arguments:
+    product -- Product or NativeProduct to publish.
+    name    -- Name of the shared memory segment.
 
-        # Export the C product to a file.
-        if file_format == 'hdf5':
-            _lib.harp_set_option_hdf5_compression(int(hdf5_compression))
-        if _lib.harp_export(_encode_path(filename), _encode_string(file_format), c_product_ptr[0]) != 0:
+    """
+    if isinstance(product, NativeProduct):
+        if _lib.harp_product_publish_shared_memory(product._c_product, _encode_string(name)) != 0:
             raise CLibraryError()
+        return
+
+    if not isinstance(product, Product):
+        raise TypeError("product must be Product or NativeProduct, not %r" % product.__class__.__name__)
+
+    c_product_ptr = _ffi.new("harp_product **")
+    if _lib.harp_product_new(c_product_ptr) != 0:
+        raise CLibraryError()
+
+    try:
+        # The C product only exists for the duration of this function, so it can refer to the NumPy arrays directly.
+        _export_product(product, c_product_ptr[0], borrow_data=True)
+        if _lib.harp_product_publish_shared_memory(c_product_ptr[0], _encode_string(name)) != 0:
+            raise CLibraryError()
+    finally:
+        _lib.harp_product_delete(c_product_ptr[0])
+
+def map_shared_memory(name, native=False):
+    """Map a product that was published in a named shared memory segment.
+
+    The NumPy arrays of the numeric variables of the returned Product are read-only
+    views on the shared memory (no data is copied). The mapping is kept for as long
+    as any of these arrays exist, also if the segment is removed in the meantime.
+
+    Arguments:
+    name   -- Name of the shared memory segment.
+    native -- If True, return a NativeProduct (whose numeric variables also refer
+              to the shared memory) instead of a Product.
+
+    """
+    c_product_ptr = _ffi.new("harp_product **")
+    if _lib.harp_product_map_shared_memory(_encode_string(name), c_product_ptr) != 0:
+        raise CLibraryError()
 
+    if native:
+        return _wrap_c_product(c_product_ptr[0])
+
+    try:
+        return _import_product(c_product_ptr[0], read_only=True)
     finally:
         _lib.harp_product_delete(c_product_ptr[0])
 
+def unlink_shared_memory(name):
+    """Remove a named shared memory segment.
+
+    Products that were already mapped from the segment remain valid.
+
+    Arguments:
+    name -- Name of the shared memory segment.
+
+    """
+    if _lib.harp_shared_memory_unlink(_encode_string(name)) != 0:
+        raise CLibraryError()
+
+def execute_operations(product, operations):
+    """Apply operations to a product and return the resulting product.
+
+    The product itself is left unmodified. For a NativeProduct the operations are
+    performed on a (copy-on-write) copy of the C product and a NativeProduct is
+    returned; no data is converted between Python and C. For a Product the
+    product is converted to a C product and the result is converted back.
+
+    Arguments:
+    product -- Product or NativeProduct to apply the operations to.
+    operations -- Actions to apply; should be specified as a semi-colon separated
+                  string of operations.
+
+    """
+    if isinstance(product, NativeProduct):
+        product = product.copy()
+        product.execute_operations(operations)
+        return product
+
+    if not isinstance(product, Product):
+        raise TypeError("product must be Product or NativeProduct, not %r" % product.__class__.__name__)
+
+    c_product_ptr = _ffi.new("harp_product **")
+    if _lib.harp_product_new(c_product_ptr) != 0:
+        raise CLibraryError()
+
+    try:
+        # The variables of the resulting C product are detached and handed over to the NumPy arrays of the new
+        # Product, so they cannot borrow the memory of the NumPy arrays of the original product.
+        _export_product(product, c_product_ptr[0])
+        if _lib.harp_product_execute_operations(c_product_ptr[0], _encode_string(operations)) != 0:
+            raise CLibraryError()
+        result = _import_product(c_product_ptr[0])
+    finally:
+        _lib.harp_product_delete(c_product_ptr[0])
+
+    _update_history(result, "harp.execute_operations(operations='{0}')".format(operations))
+    return result
+
 
 def _get_time_length(product):
     time_length = None
@@ -77,7 +77,7 @@ def read_header_file(filename):
                 continue
 
             # Remove LIBHARP_API prefix.
-            line = re.sub("^\s*LIBHARP_API\s*", "", line)
+            line = re.sub(r"^\s*LIBHARP_API\s*", "", line)
 
             # Remove brackets from #define statements, since in ABI mode cffi only accepts #define followed by a numeric
             # constant.
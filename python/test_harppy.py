@@ -0,0 +1,151 @@
+"""
+Copyright (C) 2015-2018 S[&]T, The Netherlands.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+"""
+
+# Tests for the functions of the Python interface that call into the HARP C library.
+#
+# The tests use the installed harp package and only need numpy (plus HDF5 support in the C library for the HDF5
+# export test). Run them using e.g.:
+#
+#     python -m unittest -v test_harppy
+#
+
+from __future__ import print_function
+
+import numpy
+import os
+import shutil
+import tempfile
+import unittest
+
+import harp
+from harp import _harppy
+
+
+def _create_product(num_samples=10):
+    product = harp.Product()
+    product.datetime = harp.Variable(numpy.arange(num_samples, dtype=numpy.float64), ["time"],
+                                     unit="days since 2000-01-01")
+    product.latitude = harp.Variable(numpy.linspace(-45.0, 45.0, num_samples), ["time"], unit="degree_north")
+    product.longitude = harp.Variable(numpy.linspace(0.0, 90.0, num_samples), ["time"], unit="degree_east")
+    product.value = harp.Variable(numpy.arange(num_samples, dtype=numpy.int32), ["time"])
+    return product
+
+
+class TestPythonInterface(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.filename = os.path.join(self.directory, "product.nc")
+        harp.export_product(_create_product(), self.filename)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def test_error(self):
+        # the error code and message of a C library error are retrieved via harp_get_errno()
+        with self.assertRaises(harp.CLibraryError) as context:
+            harp.import_product(os.path.join(self.directory, "missing.nc"))
+        self.assertEqual(context.exception.errno, _harppy._lib.HARP_ERROR_FILE_NOT_FOUND)
+
+    def test_export_borrowed_data(self):
+        product = _create_product()
+        harp.export_product(product, self.filename)
+        numpy.testing.assert_array_equal(harp.import_product(self.filename).value.data, product.value.data)
+
+    def test_export_with_operations(self):
+        harp.export_product(_create_product(), self.filename, operations="value<5")
+        self.assertEqual(harp.import_product(self.filename).value.data.tolist(), [0, 1, 2, 3, 4])
+
+    def test_export_hdf5_compression_filter(self):
+        filename = os.path.join(self.directory, "product.h5")
+        try:
+            harp.export_product(_create_product(), filename, file_format="hdf5", hdf5_compression=1,
+                                hdf5_compression_filter="deflate")
+        except harp.CLibraryError as error:
+            if error.errno == _harppy._lib.HARP_ERROR_NO_HDF5_SUPPORT:
+                self.skipTest("no HDF5 support")
+            raise
+        self.assertEqual(len(harp.import_product(filename).value.data), 10)
+
+    def test_native_product_copy(self):
+        product = harp.import_product(self.filename, native=True)
+        copy = product.copy()
+        copy.execute_operations("value>=5")
+        self.assertEqual(len(copy.value.data), 5)
+        self.assertEqual(len(product.value.data), 10)
+
+    def test_import_product_chunks(self):
+        chunks = list(harp.import_product_chunks(self.filename, chunk_size=4))
+        self.assertEqual([len(chunk.value.data) for chunk in chunks], [4, 4, 2])
+
+        # a stream that is never iterated is closed by the garbage collector
+        harp.import_product_chunks(self.filename, chunk_size=4)
+
+    def test_import_products(self):
+        # the default number of workers is taken from the number of threads option of the C library
+        products = list(harp.import_products([self.filename, self.filename]))
+        self.assertEqual(len(products), 2)
+
+    def test_open_dataset(self):
+        # the datetime filter is used to skip products based on their metadata (and for the variable definitions)
+        dataset = harp.open_dataset(self.filename, operations="datetime<5 [days since 2000-01-01]")
+        self.assertEqual(dataset.filenames, [self.filename])
+        self.assertTrue("value" in dataset)
+        with self.assertRaises(_harppy.NoDataError):
+            harp.open_dataset(self.filename, operations="datetime>=20 [days since 2000-01-01]")
+
+    def test_shared_memory(self):
+        name = "/harp_test_%d" % os.getpid()
+        try:
+            harp.publish_shared_memory(_create_product(), name)
+        except harp.CLibraryError:
+            self.skipTest("no shared memory support")
+        try:
+            product = harp.map_shared_memory(name)
+            self.assertEqual(product.value.data.tolist(), list(range(10)))
+            self.assertFalse(product.value.data.flags.writeable)
+            native_product = harp.map_shared_memory(name, native=True)
+            self.assertEqual(len(native_product.value.data), 10)
+        finally:
+            harp.unlink_shared_memory(name)
+
+    def test_io_statistics(self):
+        harp.reset_io_statistics()
+        self.assertEqual(harp.get_io_statistics("netcdf")["num_open"], 0)
+        harp.import_product(self.filename)
+        statistics = harp.get_io_statistics()
+        self.assertGreater(statistics["netcdf"]["num_open"], 0)
+        self.assertEqual(statistics["netcdf"]["num_close"], statistics["netcdf"]["num_open"])
+        harp.reset_io_statistics()
+        self.assertEqual(harp.get_io_statistics("netcdf")["num_read_calls"], 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,864 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "harp.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define DEFAULT_NUM_SAMPLES 10000
+#define DEFAULT_NUM_VERTICAL 30
+#define DEFAULT_NUM_REPEATS 5
+
+/* number of samples per (synthetic) orbit */
+#define SAMPLES_PER_ORBIT 5000
+
+/* only every SUBSAMPLE_B-th sample of the synthetic product is used for dataset B of the collocation benchmark */
+#define SUBSAMPLE_B 10
+
+int matchup(int argc, char *argv[]);
+
+typedef struct benchmark_info_struct
+{
+    long num_samples;
+    long num_vertical;
+    int num_repeats;
+    const char *tmpdir;
+    harp_product *product;
+} benchmark_info;
+
+typedef struct benchmark_timer_struct
+{
+    double wall_time;
+    double cpu_time;
+} benchmark_timer;
+
+typedef struct benchmark_struct
+{
+    const char *name;
+    const char *description;
+    /* performs a single iteration of the benchmark and stores the time of the measured part in timer */
+    int (*run) (benchmark_info *info, benchmark_timer *timer);
+} benchmark;
+
+static int print_warning(const char *message, va_list ap)
+{
+    int result;
+
+    fprintf(stderr, "WARNING: ");
+    result = vfprintf(stderr, message, ap);
+    fprintf(stderr, "\n");
+
+    return result;
+}
+
+static double get_wall_time(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return (double)tv.tv_sec + 1.0e-6 * (double)tv.tv_usec;
+#endif
+}
+
+static void timer_start(benchmark_timer *timer)
+{
+    timer->cpu_time = (double)clock() / CLOCKS_PER_SEC;
+    timer->wall_time = get_wall_time();
+}
+
+static void timer_stop(benchmark_timer *timer)
+{
+    timer->wall_time = get_wall_time() - timer->wall_time;
+    timer->cpu_time = (double)clock() / CLOCKS_PER_SEC - timer->cpu_time;
+}
+
+static void get_tmp_filename(benchmark_info *info, const char *name, char *filename, size_t size)
+{
+    snprintf(filename, size, "%s/harpbench_%s", info->tmpdir, name);
+}
+
+/* deterministic pseudo random value in the range [0,1) for the given sample index */
+static double noise(long index, long seed)
+{
+    unsigned long x = (unsigned long)(index * 2654435761UL + seed * 40503UL + 12345UL);
+
+    x ^= x >> 13;
+    x *= 1103515245UL;
+    x ^= x >> 16;
+
+    return (double)(x & 0xffffUL) / 65536.0;
+}
+
+static int add_variable(harp_product *product, const char *name, int num_dimensions,
+                        const harp_dimension_type *dimension_type, const long *dimension, const char *unit,
+                        harp_variable **new_variable)
+{
+    harp_variable *variable;
+
+    if (harp_variable_new(name, harp_type_double, num_dimensions, dimension_type, dimension, &variable) != 0)
+    {
+        return -1;
+    }
+    if (unit != NULL)
+    {
+        if (harp_variable_set_unit(variable, unit) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+    if (harp_product_add_variable(product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+
+    *new_variable = variable;
+
+    return 0;
+}
+
+/* Create a synthetic product that resembles the orbits of a nadir viewing satellite instrument with vertical profiles.
+ * Each sample has a footprint of about 0.5 x 0.5 degree and the samples are placed along 'orbits' that each cover
+ * SAMPLES_PER_ORBIT samples (with one sample per second).
+ * With a sample_step > 1 only every sample_step-th sample is included.
+ */
+static int create_synthetic_product(long num_samples, long num_vertical, long sample_step, harp_product **new_product)
+{
+    harp_dimension_type dimension_type[3];
+    long dimension[3];
+    harp_product *product;
+    harp_variable *datetime;
+    harp_variable *latitude;
+    harp_variable *longitude;
+    harp_variable *latitude_bounds;
+    harp_variable *longitude_bounds;
+    harp_variable *solar_zenith_angle;
+    harp_variable *altitude;
+    harp_variable *altitude_bounds;
+    harp_variable *pressure;
+    harp_variable *temperature;
+    harp_variable *number_density;
+    harp_variable *apriori;
+    long i, k;
+
+    if (harp_product_new(&product) != 0)
+    {
+        return -1;
+    }
+
+    dimension_type[0] = harp_dimension_time;
+    dimension_type[1] = harp_dimension_vertical;
+    dimension_type[2] = harp_dimension_independent;
+    dimension[0] = num_samples;
+    dimension[1] = num_vertical;
+    if (add_variable(product, "datetime", 1, dimension_type, dimension, "seconds since 2000-01-01", &datetime) != 0 ||
+        add_variable(product, "latitude", 1, dimension_type, dimension, "degree_north", &latitude) != 0 ||
+        add_variable(product, "longitude", 1, dimension_type, dimension, "degree_east", &longitude) != 0 ||
+        add_variable(product, "solar_zenith_angle", 1, dimension_type, dimension, "degree",
+                     &solar_zenith_angle) != 0 ||
+        add_variable(product, "altitude", 2, dimension_type, dimension, "km", &altitude) != 0 ||
+        add_variable(product, "pressure", 2, dimension_type, dimension, "hPa", &pressure) != 0 ||
+        add_variable(product, "temperature", 2, dimension_type, dimension, "K", &temperature) != 0 ||
+        add_variable(product, "O3_number_density", 2, dimension_type, dimension, "molec/cm3",
+                     &number_density) != 0 ||
+        add_variable(product, "O3_number_density_apriori", 2, dimension_type, dimension, "molec/cm3", &apriori) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    dimension[2] = 2;
+    if (add_variable(product, "altitude_bounds", 3, dimension_type, dimension, "km", &altitude_bounds) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    dimension_type[1] = harp_dimension_independent;
+    dimension[1] = 4;
+    if (add_variable(product, "latitude_bounds", 2, dimension_type, dimension, "degree_north",
+                     &latitude_bounds) != 0 ||
+        add_variable(product, "longitude_bounds", 2, dimension_type, dimension, "degree_east", &longitude_bounds) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+
+    for (i = 0; i < num_samples; i++)
+    {
+        long sample_index = i * sample_step;
+        double phase = 2 * M_PI * (double)(sample_index % SAMPLES_PER_ORBIT) / SAMPLES_PER_ORBIT;
+        double lat = 80.0 * sin(phase);
+        double lon = fmod((double)(sample_index / SAMPLES_PER_ORBIT) * 25.0 + 5.0 * cos(phase) + 540.0, 360.0) - 180.0;
+
+        datetime->data.double_data[i] = (double)sample_index;
+        latitude->data.double_data[i] = lat;
+        longitude->data.double_data[i] = lon;
+        latitude_bounds->data.double_data[4 * i] = lat - 0.25;
+        latitude_bounds->data.double_data[4 * i + 1] = lat - 0.25;
+        latitude_bounds->data.double_data[4 * i + 2] = lat + 0.25;
+        latitude_bounds->data.double_data[4 * i + 3] = lat + 0.25;
+        longitude_bounds->data.double_data[4 * i] = lon - 0.25;
+        longitude_bounds->data.double_data[4 * i + 1] = lon + 0.25;
+        longitude_bounds->data.double_data[4 * i + 2] = lon + 0.25;
+        longitude_bounds->data.double_data[4 * i + 3] = lon - 0.25;
+        solar_zenith_angle->data.double_data[i] = 20.0 + 80.0 * noise(sample_index, 1);
+
+        for (k = 0; k < num_vertical; k++)
+        {
+            long index = i * num_vertical + k;
+            double z = (double)k + 0.5;
+
+            altitude->data.double_data[index] = z;
+            altitude_bounds->data.double_data[2 * index] = (double)k;
+            altitude_bounds->data.double_data[2 * index + 1] = (double)(k + 1);
+            pressure->data.double_data[index] = 1013.25 * exp(-z / 7.0);
+            temperature->data.double_data[index] = (z < 11 ? 288.15 - 6.5 * z : 216.65) +
+                5.0 * (noise(sample_index, 2) - 0.5);
+            apriori->data.double_data[index] = 5.0e12 * exp(-(z - 22.0) * (z - 22.0) / 50.0);
+            number_density->data.double_data[index] = apriori->data.double_data[index] * (0.8 + 0.4 * noise(index, 3));
+        }
+    }
+
+    *new_product = product;
+
+    return 0;
+}
+
+static int run_operations(benchmark_info *info, const char *operations, benchmark_timer *timer)
+{
+    harp_product *product;
+
+    if (harp_product_copy(info->product, &product) != 0)
+    {
+        return -1;
+    }
+    timer_start(timer);
+    if (harp_product_execute_operations(product, operations) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    timer_stop(timer);
+    harp_product_delete(product);
+
+    return 0;
+}
+
+static int run_filter_value(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "solar_zenith_angle<80;latitude>=-60;latitude<=60", timer);
+}
+
+static int run_filter_point_distance(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "point_distance(52.0,4.0,3000[km])", timer);
+}
+
+static int run_filter_point_in_area(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "point_in_area((-40,-40,40,40),(-100,100,100,-100))", timer);
+}
+
+static int run_filter_area_covers_point(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "area_covers_point(52.0,4.0)", timer);
+}
+
+static int run_filter_area_intersects_area(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "area_intersects_area((-40,-40,40,40),(-100,100,100,-100))", timer);
+}
+
+static int run_bin_spatial(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "bin_spatial(181,-90,1,361,-180,1)", timer);
+}
+
+static int run_regrid(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "regrid(vertical,altitude[km],20,1.0,1.5)", timer);
+}
+
+static int run_derive_vmr(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "derive(O3_volume_mixing_ratio {time,vertical} [ppmv])", timer);
+}
+
+static int run_derive_column(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_operations(info, "derive(O3_column_number_density {time} [DU])", timer);
+}
+
+static int run_smooth(benchmark_info *info, benchmark_timer *timer)
+{
+    harp_dimension_type dimension_type[3] = { harp_dimension_time, harp_dimension_vertical, harp_dimension_vertical };
+    long dimension[3];
+    harp_product *product;
+    harp_variable *variable;
+    harp_variable *apriori;
+    harp_variable *avk;
+    long i, k, l;
+
+    if (harp_product_copy(info->product, &product) != 0)
+    {
+        return -1;
+    }
+    dimension[0] = info->num_samples;
+    dimension[1] = info->num_vertical;
+    dimension[2] = info->num_vertical;
+    if (add_variable(product, "O3_number_density_avk", 3, dimension_type, dimension, "", &avk) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    for (i = 0; i < info->num_samples; i++)
+    {
+        for (k = 0; k < info->num_vertical; k++)
+        {
+            for (l = 0; l < info->num_vertical; l++)
+            {
+                long index = (i * info->num_vertical + k) * info->num_vertical + l;
+
+                avk->data.double_data[index] = exp(-(double)((k - l) * (k - l)) / 8.0) / 5.0;
+            }
+        }
+    }
+    if (harp_product_get_variable_by_name(product, "O3_number_density", &variable) != 0 ||
+        harp_product_get_variable_by_name(product, "O3_number_density_apriori", &apriori) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+
+    timer_start(timer);
+    if (harp_variable_smooth_vertical(variable, NULL, avk, apriori) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    timer_stop(timer);
+    harp_product_delete(product);
+
+    return 0;
+}
+
+static int run_export(benchmark_info *info, const char *format, benchmark_timer *timer)
+{
+    char filename[1024];
+
+    get_tmp_filename(info, format, filename, sizeof(filename));
+    timer_start(timer);
+    if (harp_export(filename, format, info->product) != 0)
+    {
+        return -1;
+    }
+    timer_stop(timer);
+    remove(filename);
+
+    return 0;
+}
+
+static int run_import(benchmark_info *info, const char *format, benchmark_timer *timer)
+{
+    harp_product *product;
+    char filename[1024];
+
+    get_tmp_filename(info, format, filename, sizeof(filename));
+    if (harp_export(filename, format, info->product) != 0)
+    {
+        return -1;
+    }
+    timer_start(timer);
+    if (harp_import(filename, NULL, NULL, &product) != 0)
+    {
+        remove(filename);
+        return -1;
+    }
+    timer_stop(timer);
+    harp_product_delete(product);
+    remove(filename);
+
+    return 0;
+}
+
+static int run_export_netcdf(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_export(info, "netcdf", timer);
+}
+
+static int run_import_netcdf(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_import(info, "netcdf", timer);
+}
+
+static int run_export_hdf5(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_export(info, "hdf5", timer);
+}
+
+static int run_import_hdf5(benchmark_info *info, benchmark_timer *timer)
+{
+    return run_import(info, "hdf5", timer);
+}
+
+static int run_collocate(benchmark_info *info, benchmark_timer *timer)
+{
+    char filename_a[1024];
+    char filename_b[1024];
+    char filename_result[1024];
+    char criterium_datetime[] = "datetime 60 [s]";
+    char criterium_distance[] = "point_distance 50 [km]";
+    char program_name[] = "harpbench";
+    char option_d[] = "-d";
+    char *argv[8];
+    harp_product *product;
+    int result;
+
+    /* dataset A is the synthetic product and dataset B a subsampled version of it */
+    if (create_synthetic_product((info->num_samples + SUBSAMPLE_B - 1) / SUBSAMPLE_B, info->num_vertical,
+                                 SUBSAMPLE_B, &product) != 0)
+    {
+        return -1;
+    }
+
+    get_tmp_filename(info, "collocate_a.nc", filename_a, sizeof(filename_a));
+    get_tmp_filename(info, "collocate_b.nc", filename_b, sizeof(filename_b));
+    get_tmp_filename(info, "collocate_result.csv", filename_result, sizeof(filename_result));
+    if (harp_export(filename_a, "netcdf", info->product) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    if (harp_export(filename_b, "netcdf", product) != 0)
+    {
+        harp_product_delete(product);
+        remove(filename_a);
+        return -1;
+    }
+    harp_product_delete(product);
+
+    argv[0] = program_name;
+    argv[1] = option_d;
+    argv[2] = criterium_datetime;
+    argv[3] = option_d;
+    argv[4] = criterium_distance;
+    argv[5] = filename_a;
+    argv[6] = filename_b;
+    argv[7] = filename_result;
+
+    timer_start(timer);
+    result = matchup(8, argv);
+    timer_stop(timer);
+
+    remove(filename_a);
+    remove(filename_b);
+    remove(filename_result);
+
+    if (result != 0)
+    {
+        if (result == 1)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid arguments for collocation");
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+static benchmark benchmark_list[] = {
+    {"filter_value", "comparison filters on time dependent variables", run_filter_value},
+    {"filter_point_distance", "point_distance() filter", run_filter_point_distance},
+    {"filter_point_in_area", "point_in_area() filter using a polygon", run_filter_point_in_area},
+    {"filter_area_covers_point", "area_covers_point() filter on the sample footprints", run_filter_area_covers_point},
+    {"filter_area_intersects_area", "area_intersects_area() filter on the sample footprints",
+     run_filter_area_intersects_area},
+    {"bin_spatial", "bin_spatial() onto a 1x1 degree grid", run_bin_spatial},
+    {"regrid", "regrid() of all vertical profiles onto a new altitude grid", run_regrid},
+    {"smooth", "harp_variable_smooth_vertical() using an averaging kernel and apriori", run_smooth},
+    {"derive_vmr", "derive() of a volume mixing ratio profile from number density, pressure and temperature",
+     run_derive_vmr},
+    {"derive_column", "derive() of a total column from a number density profile", run_derive_column},
+    {"export_netcdf", "export to netCDF-3", run_export_netcdf},
+    {"import_netcdf", "import of a HARP netCDF-3 product", run_import_netcdf},
+    {"export_hdf5", "export to HDF5", run_export_hdf5},
+    {"import_hdf5", "import of a HARP HDF5 product", run_import_hdf5},
+    {"collocate", "matchup of two datasets on datetime and point_distance (as done by harpcollocate)", run_collocate}
+};
+
+#define NUM_BENCHMARKS ((int)(sizeof(benchmark_list) / sizeof(benchmark_list[0])))
+
+static int run_benchmark(benchmark_info *info, const benchmark *bench, FILE *output, int is_first)
+{
+    benchmark_timer timer;
+    double min_wall_time = 0;
+    double total_wall_time = 0;
+    double total_cpu_time = 0;
+    int i;
+
+    for (i = 0; i < info->num_repeats; i++)
+    {
+        if (bench->run(info, &timer) != 0)
+        {
+            harp_add_error_message(" (benchmark '%s')", bench->name);
+            return -1;
+        }
+        if (i == 0 || timer.wall_time < min_wall_time)
+        {
+            min_wall_time = timer.wall_time;
+        }
+        total_wall_time += timer.wall_time;
+        total_cpu_time += timer.cpu_time;
+    }
+
+    fprintf(output, "%s\n    {\"name\": \"%s\", \"repeats\": %d, \"min_wall_time\": %.6f, \"mean_wall_time\": %.6f, "
+            "\"mean_cpu_time\": %.6f, \"samples_per_second\": %.1f}", is_first ? "" : ",", bench->name,
+            info->num_repeats, min_wall_time, total_wall_time / info->num_repeats, total_cpu_time / info->num_repeats,
+            min_wall_time > 0 ? info->num_samples / min_wall_time : 0.0);
+    fflush(output);
+
+    return 0;
+}
+
+static int is_selected(const char *selection, const char *name)
+{
+    size_t length = strlen(name);
+    const char *item = selection;
+
+    if (selection == NULL)
+    {
+        return 1;
+    }
+    while (*item != '\0')
+    {
+        const char *end = strchr(item, ',');
+        size_t item_length = end == NULL ? strlen(item) : (size_t)(end - item);
+
+        if (item_length == length && strncmp(item, name, length) == 0)
+        {
+            return 1;
+        }
+        if (end == NULL)
+        {
+            break;
+        }
+        item = end + 1;
+    }
+
+    return 0;
+}
+
+static void print_version(void)
+{
+    printf("harpbench version %s\n", libharp_version);
+    printf("Copyright (C) 2015-2018 S[&]T, The Netherlands.\n");
+}
+
+static void print_help(void)
+{
+    printf("Usage:\n");
+    printf("    harpbench [options]\n");
+    printf("        Measure the performance of the HARP core algorithms on synthetic\n");
+    printf("        products. The results are written in JSON format.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            -n, --num-samples <n>\n");
+    printf("                Number of samples (length of the time dimension) of the\n");
+    printf("                synthetic product (default: %d).\n", DEFAULT_NUM_SAMPLES);
+    printf("            -l, --num-levels <n>\n");
+    printf("                Number of vertical levels of the synthetic product\n");
+    printf("                (default: %d).\n", DEFAULT_NUM_VERTICAL);
+    printf("            -r, --repeat <n>\n");
+    printf("                Number of times each benchmark is run (default: %d).\n", DEFAULT_NUM_REPEATS);
+    printf("            -b, --benchmarks <name>[,<name>...]\n");
+    printf("                Only run the given benchmarks (default: all).\n");
+    printf("            -t, --tmpdir <path>\n");
+    printf("                Directory for temporary files (default: $TMPDIR or the\n");
+    printf("                current directory).\n");
+    printf("            -o, --output <file>\n");
+    printf("                Write the results to the given file instead of stdout.\n");
+    printf("\n");
+    printf("    harpbench --list\n");
+    printf("        Show the list of available benchmarks.\n");
+    printf("\n");
+    printf("    harpbench -h, --help\n");
+    printf("        Show help (this text).\n");
+    printf("\n");
+    printf("    harpbench -v, --version\n");
+    printf("        Print the version number of HARP and exit.\n");
+    printf("\n");
+}
+
+static int parse_positive_long(const char *str, long *value)
+{
+    char *end;
+
+    *value = strtol(str, &end, 10);
+    if (*end != '\0' || *value < 1)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int run(int argc, char *argv[])
+{
+    benchmark_info info;
+    const char *selection = NULL;
+    const char *output_filename = NULL;
+    FILE *output = stdout;
+    long value;
+    int num_run = 0;
+    int i;
+
+    info.num_samples = DEFAULT_NUM_SAMPLES;
+    info.num_vertical = DEFAULT_NUM_VERTICAL;
+    info.num_repeats = DEFAULT_NUM_REPEATS;
+    info.tmpdir = getenv("TMPDIR");
+    if (info.tmpdir == NULL)
+    {
+        info.tmpdir = ".";
+    }
+    info.product = NULL;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--num-samples") == 0) && i + 1 < argc)
+        {
+            if (parse_positive_long(argv[i + 1], &info.num_samples) != 0)
+            {
+                return 1;
+            }
+            i++;
+        }
+        else if ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--num-levels") == 0) && i + 1 < argc)
+        {
+            if (parse_positive_long(argv[i + 1], &info.num_vertical) != 0)
+            {
+                return 1;
+            }
+            i++;
+        }
+        else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--repeat") == 0) && i + 1 < argc)
+        {
+            if (parse_positive_long(argv[i + 1], &value) != 0 || value > 1000000)
+            {
+                return 1;
+            }
+            info.num_repeats = (int)value;
+            i++;
+        }
+        else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--benchmarks") == 0) && i + 1 < argc)
+        {
+            selection = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tmpdir") == 0) && i + 1 < argc)
+        {
+            info.tmpdir = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && i + 1 < argc)
+        {
+            output_filename = argv[i + 1];
+            i++;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+
+    if (selection != NULL)
+    {
+        const char *item = selection;
+
+        /* verify that all selected benchmarks exist */
+        while (*item != '\0')
+        {
+            const char *end = strchr(item, ',');
+            size_t item_length = end == NULL ? strlen(item) : (size_t)(end - item);
+            int j;
+
+            for (j = 0; j < NUM_BENCHMARKS; j++)
+            {
+                if (strlen(benchmark_list[j].name) == item_length &&
+                    strncmp(item, benchmark_list[j].name, item_length) == 0)
+                {
+                    break;
+                }
+            }
+            if (j == NUM_BENCHMARKS)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unknown benchmark '%.*s'", (int)item_length, item);
+                return -1;
+            }
+            if (end == NULL)
+            {
+                break;
+            }
+            item = end + 1;
+        }
+    }
+
+    if (create_synthetic_product(info.num_samples, info.num_vertical, 1, &info.product) != 0)
+    {
+        return -1;
+    }
+
+    if (output_filename != NULL)
+    {
+        output = fopen(output_filename, "w");
+        if (output == NULL)
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "could not open '%s' for writing", output_filename);
+            harp_product_delete(info.product);
+            return -1;
+        }
+    }
+
+    fprintf(output, "{\n  \"harp_version\": \"%s\",\n  \"num_samples\": %ld,\n  \"num_vertical\": %ld,\n"
+            "  \"benchmarks\": [", libharp_version, info.num_samples, info.num_vertical);
+    for (i = 0; i < NUM_BENCHMARKS; i++)
+    {
+        if (is_selected(selection, benchmark_list[i].name))
+        {
+            if (run_benchmark(&info, &benchmark_list[i], output, num_run == 0) != 0)
+            {
+                if (output != stdout)
+                {
+                    fclose(output);
+                }
+                harp_product_delete(info.product);
+                return -1;
+            }
+            num_run++;
+        }
+    }
+    fprintf(output, "\n  ]\n}\n");
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+    harp_product_delete(info.product);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+    {
+        print_help();
+        exit(0);
+    }
+
+    if (argc > 1 && (strcmp(argv[1], "-v") == 0 || strcmp(argv[1], "--version") == 0))
+    {
+        print_version();
+        exit(0);
+    }
+
+    if (argc == 2 && strcmp(argv[1], "--list") == 0)
+    {
+        int i;
+
+        for (i = 0; i < NUM_BENCHMARKS; i++)
+        {
+            printf("%-28s %s\n", benchmark_list[i].name, benchmark_list[i].description);
+        }
+        exit(0);
+    }
+
+    if (harp_set_udunits2_xml_path_conditional(argv[0], NULL, "../share/harp/udunits2.xml") != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    harp_set_warning_handler(print_warning);
+
+    if (harp_init() != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    result = run(argc, argv);
+    if (result == -1)
+    {
+        if (harp_errno != HARP_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        }
+        harp_done();
+        exit(1);
+    }
+    else if (result == 1)
+    {
+        fprintf(stderr, "ERROR: invalid arguments\n");
+        print_help();
+        harp_done();
+        exit(1);
+    }
+
+    harp_done();
+
+    return 0;
+}
@@ -35,10 +35,71 @@
 
 #include "harp.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <assert.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#ifdef WIN32
+#include "windows.h"
+#endif
+
+/* maximum value for the --threads option */
+#define MAX_NUM_THREADS 1024
+
+#define MAX_PATH_LENGTH 4096
+
+#define CACHE_HEADER "# harpcheck cache"
+
+/* list of files that should be checked */
+typedef struct file_list_struct
+{
+    long num_files;
+    char **filename;
+} file_list;
+
+/* hash of the content of a file that passed a previous check */
+typedef struct check_cache_entry_struct
+{
+    uint64_t hash;
+    char *filename;     /* file for which the hash was recorded */
+} check_cache_entry;
+
+/* hashes of the contents of all files that passed a previous check */
+typedef struct check_cache_struct
+{
+    const char *filename;       /* path of the cache file */
+    long num_entries;
+    check_cache_entry *entry;   /* sorted by hash */
+} check_cache;
+
+/* result of checking a single file */
+typedef struct check_result_struct
+{
+    int status; /* 0 = ok, 1 = failed, 2 = skipped (found in cache), -1 = error */
+    int has_hash;
+    uint64_t hash;
+    char *output;       /* captured output of the check (only when using multiple threads) */
+    char *error_message;
+} check_result;
+
+typedef struct check_info_struct
+{
+    int num_threads;
+    const char *summary_filename;
+    check_cache *cache;
+} check_info;
 
 static int print_warning(const char *message, va_list ap)
 {
@@ -60,12 +121,48 @@ static void print_version()
 static void print_help()
 {
     printf("Usage:\n");
-    printf("    harpcheck <input product file> [input product file...]\n");
+    printf("    harpcheck [options] <file|dir> [<file|dir> ...]\n");
     printf("        If the product is a HARP product then verify that the\n");
     printf("        product is HARP compliant.\n");
     printf("        Otherwise, try to import the product using an applicable\n");
     printf("        ingestion module and test the ingestion for all possible\n");
     printf("        ingestion options.\n");
+    printf("        For a directory all files in the directory (recursively) are\n");
+    printf("        checked. For a .pth file the paths (one per line) from that\n");
+    printf("        file are checked.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            --threads <N>\n");
+    printf("                Use N threads to check the products (default: 1).\n");
+    printf("                The output for each product is still printed in order.\n");
+    printf("\n");
+    printf("            --summary <file>\n");
+    printf("                Write a summary of the results in csv format to the given\n");
+    printf("                file, with for each product the filename, the result\n");
+    printf("                (ok, failed, error, or skipped), and the error message.\n");
+    printf("\n");
+    printf("            --cache <file>\n");
+    printf("                Keep a hash of the content of each product that passed the\n");
+    printf("                check in the given file. Products whose content matches\n");
+    printf("                a hash in the cache are skipped. The cache is only used\n");
+    printf("                if it was created by the same version of harpcheck.\n");
+    printf("\n");
+    printf("    harpcheck --benchmark [options] <input product file> [input product file...]\n");
+    printf("        Import each product once and report the ingestion module and\n");
+    printf("        product definition that were used, the time spent on opening and\n");
+    printf("        reading the product, the file size, the size of the ingested data,\n");
+    printf("        and the peak memory usage of the process.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            -o, --options <option list>\n");
+    printf("                List of options to pass to the ingestion module.\n");
+    printf("                Only applicable if the input product is not in HARP format.\n");
+    printf("                Options are separated by semi-colons. Each option consists\n");
+    printf("                of an <option name>=<value> pair. An option list needs to be\n");
+    printf("                provided as a single expression.\n");
+    printf("\n");
+    printf("            --variables\n");
+    printf("                Also report the read time and size of each ingested variable.\n");
     printf("\n");
     printf("    harpcheck -h, --help\n");
     printf("        Show help (this text).\n");
@@ -75,11 +172,997 @@ static void print_help()
     printf("\n");
 }
 
-int main(int argc, char *argv[])
+static void print_peak_memory(void)
 {
+#ifdef HAVE_SYS_RESOURCE_H
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        /* ru_maxrss is in kilobytes on Linux (and in bytes on macOS) */
+#ifdef __APPLE__
+        printf("peak memory usage: %ld bytes\n", (long)usage.ru_maxrss);
+#else
+        printf("peak memory usage: %ld bytes\n", (long)usage.ru_maxrss * 1024);
+#endif
+    }
+#endif
+}
+
+static int benchmark(int argc, char *argv[])
+{
+    const char *options = NULL;
+    int show_variables = 0;
     int result = 0;
     int i;
 
+    for (i = 2; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc &&
+            argv[i + 1][0] != '-')
+        {
+            options = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--variables") == 0)
+        {
+            show_variables = 1;
+        }
+        else if (argv[i][0] != '-')
+        {
+            /* assume all arguments from here on are files */
+            break;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: invalid argument: '%s'\n", argv[i]);
+            print_help();
+            return 1;
+        }
+    }
+    if (i == argc)
+    {
+        fprintf(stderr, "ERROR: input product file not specified\n");
+        print_help();
+        return 1;
+    }
+
+    for (; i < argc; i++)
+    {
+        if (harp_import_benchmark(argv[i], options, show_variables, printf) != 0)
+        {
+            fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+            result = 1;
+        }
+        else
+        {
+            print_peak_memory();
+        }
+        printf("\n");
+    }
+
+    return result;
+}
+
+static int file_list_add(file_list *list, const char *filename)
+{
+    if (list->num_files % 256 == 0)
+    {
+        char **new_filename;
+
+        new_filename = realloc(list->filename, (list->num_files + 256) * sizeof(char *));
+        if (new_filename == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (list->num_files + 256) * sizeof(char *), __FILE__, __LINE__);
+            return -1;
+        }
+        list->filename = new_filename;
+    }
+    list->filename[list->num_files] = strdup(filename);
+    if (list->filename[list->num_files] == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    list->num_files++;
+
+    return 0;
+}
+
+static void file_list_done(file_list *list)
+{
+    long i;
+
+    for (i = 0; i < list->num_files; i++)
+    {
+        free(list->filename[i]);
+    }
+    if (list->filename != NULL)
+    {
+        free(list->filename);
+    }
+}
+
+static int compare_filenames(const void *a, const void *b)
+{
+    return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static int add_path(file_list *list, const char *path);
+
+static int add_directory_entry(file_list *list, const char *pathname, const char *filename)
+{
+    char *filepath;
+    int result;
+
+    filepath = malloc(strlen(pathname) + 1 + strlen(filename) + 1);
+    if (filepath == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(pathname) + 1 + strlen(filename) + 1, __FILE__, __LINE__);
+        return -1;
+    }
+#ifdef WIN32
+    sprintf(filepath, "%s\\%s", pathname, filename);
+#else
+    sprintf(filepath, "%s/%s", pathname, filename);
+#endif
+    result = add_path(list, filepath);
+    free(filepath);
+
+    return result;
+}
+
+/* add all files of a directory (recursively); the files of each directory are added in alphabetical order */
+static int add_directory(file_list *list, const char *pathname)
+{
+    file_list entries = { 0, NULL };
+    long i;
+#ifdef WIN32
+    WIN32_FIND_DATA FileData;
+    HANDLE hSearch;
+    BOOL fFinished;
+    char *pattern;
+
+    pattern = malloc(strlen(pathname) + 4 + 1);
+    if (pattern == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(pathname) + 4 + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    sprintf(pattern, "%s\\*.*", pathname);
+    hSearch = FindFirstFile(pattern, &FileData);
+    free(pattern);
+
+    if (hSearch == INVALID_HANDLE_VALUE)
+    {
+        if (GetLastError() == ERROR_FILE_NOT_FOUND || GetLastError() == ERROR_NO_MORE_FILES)
+        {
+            /* no files found */
+            return 0;
+        }
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not access directory '%s'", pathname);
+        return -1;
+    }
+
+    fFinished = FALSE;
+    while (!fFinished)
+    {
+        if (strcmp(FileData.cFileName, ".") != 0 && strcmp(FileData.cFileName, "..") != 0)
+        {
+            if (file_list_add(&entries, FileData.cFileName) != 0)
+            {
+                FindClose(hSearch);
+                file_list_done(&entries);
+                return -1;
+            }
+        }
+
+        if (!FindNextFile(hSearch, &FileData))
+        {
+            if (GetLastError() == ERROR_NO_MORE_FILES)
+            {
+                fFinished = TRUE;
+            }
+            else
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not retrieve directory entry");
+                FindClose(hSearch);
+                file_list_done(&entries);
+                return -1;
+            }
+        }
+    }
+    FindClose(hSearch);
+#else
+    DIR *dirp = NULL;
+    struct dirent *dp = NULL;
+
+    dirp = opendir(pathname);
+    if (dirp == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not open directory %s", pathname);
+        return -1;
+    }
+
+    while ((dp = readdir(dirp)) != NULL)
+    {
+        /* Skip '.' and '..' */
+        if (strcmp(dp->d_name, ".") == 0 || strcmp(dp->d_name, "..") == 0)
+        {
+            continue;
+        }
+        if (file_list_add(&entries, dp->d_name) != 0)
+        {
+            closedir(dirp);
+            file_list_done(&entries);
+            return -1;
+        }
+    }
+
+    closedir(dirp);
+#endif
+
+    if (entries.num_files > 1)
+    {
+        qsort(entries.filename, entries.num_files, sizeof(char *), compare_filenames);
+    }
+    for (i = 0; i < entries.num_files; i++)
+    {
+        if (add_directory_entry(list, pathname, entries.filename[i]) != 0)
+        {
+            file_list_done(&entries);
+            return -1;
+        }
+    }
+    file_list_done(&entries);
+
+    return 0;
+}
+
+static int add_path_file(file_list *list, const char *filename)
+{
+    char line[MAX_PATH_LENGTH];
+    FILE *stream;
+
+    stream = fopen(filename, "r");
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "cannot open pth file '%s'", filename);
+        return -1;
+    }
+
+    while (fgets(line, MAX_PATH_LENGTH, stream) != NULL)
+    {
+        long length = (long)strlen(line);
+
+        /* Trim the line */
+        while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n'))
+        {
+            length--;
+        }
+        line[length] = '\0';
+
+        /* skip empty lines and lines starting with '#' */
+        if (length > 0 && line[0] != '#')
+        {
+            if (add_path(list, line) != 0)
+            {
+                fclose(stream);
+                return -1;
+            }
+        }
+    }
+
+    fclose(stream);
+
+    return 0;
+}
+
+/* Add a product file, all files in a directory, or all paths from a .pth file to the list.
+ * Paths that do not exist are added as is, such that the check reports the error for that file.
+ */
+static int add_path(file_list *list, const char *path)
+{
+    struct stat statbuf;
+    long length = (long)strlen(path);
+
+    if (stat(path, &statbuf) == 0)
+    {
+        if (statbuf.st_mode & S_IFDIR)
+        {
+            return add_directory(list, path);
+        }
+        if (length > 4 && strcmp(&path[length - 4], ".pth") == 0)
+        {
+            return add_path_file(list, path);
+        }
+    }
+
+    return file_list_add(list, path);
+}
+
+/* 64-bit FNV-1a hash of the content of a file */
+static int get_file_hash(const char *filename, uint64_t *hash)
+{
+    unsigned char buffer[65536];
+    uint64_t value = 14695981039346656037ULL;
+    FILE *stream;
+    size_t length;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL)
+    {
+        return -1;
+    }
+    while ((length = fread(buffer, 1, sizeof(buffer), stream)) > 0)
+    {
+        size_t i;
+
+        for (i = 0; i < length; i++)
+        {
+            value ^= buffer[i];
+            value *= 1099511628211ULL;
+        }
+    }
+    if (ferror(stream))
+    {
+        fclose(stream);
+        return -1;
+    }
+    fclose(stream);
+    *hash = value;
+
+    return 0;
+}
+
+static int check_cache_add(check_cache *cache, uint64_t hash, const char *filename)
+{
+    if (cache->num_entries % 256 == 0)
+    {
+        check_cache_entry *new_entry;
+
+        new_entry = realloc(cache->entry, (cache->num_entries + 256) * sizeof(check_cache_entry));
+        if (new_entry == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (cache->num_entries + 256) * sizeof(check_cache_entry), __FILE__, __LINE__);
+            return -1;
+        }
+        cache->entry = new_entry;
+    }
+    cache->entry[cache->num_entries].filename = strdup(filename);
+    if (cache->entry[cache->num_entries].filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    cache->entry[cache->num_entries].hash = hash;
+    cache->num_entries++;
+
+    return 0;
+}
+
+static void check_cache_done(check_cache *cache)
+{
+    long i;
+
+    for (i = 0; i < cache->num_entries; i++)
+    {
+        free(cache->entry[i].filename);
+    }
+    if (cache->entry != NULL)
+    {
+        free(cache->entry);
+    }
+}
+
+static int compare_cache_entries(const void *a, const void *b)
+{
+    uint64_t hash_a = ((const check_cache_entry *)a)->hash;
+    uint64_t hash_b = ((const check_cache_entry *)b)->hash;
+
+    return hash_a < hash_b ? -1 : (hash_a > hash_b ? 1 : 0);
+}
+
+static void check_cache_sort(check_cache *cache)
+{
+    if (cache->num_entries > 1)
+    {
+        qsort(cache->entry, cache->num_entries, sizeof(check_cache_entry), compare_cache_entries);
+    }
+}
+
+static int check_cache_contains(const check_cache *cache, uint64_t hash)
+{
+    long low = 0;
+    long high = cache->num_entries - 1;
+
+    while (low <= high)
+    {
+        long middle = (low + high) / 2;
+
+        if (cache->entry[middle].hash == hash)
+        {
+            return 1;
+        }
+        if (cache->entry[middle].hash < hash)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return 0;
+}
+
+/* read the cache file; a missing cache file or a cache file of a different harpcheck version results in an empty
+ * cache
+ */
+static int check_cache_read(check_cache *cache)
+{
+    char line[MAX_PATH_LENGTH + 32];
+    char header[256];
+    FILE *stream;
+
+    stream = fopen(cache->filename, "r");
+    if (stream == NULL)
+    {
+        return 0;
+    }
+
+    sprintf(header, "%s %s", CACHE_HEADER, libharp_version);
+    if (fgets(line, sizeof(line), stream) == NULL || strncmp(line, header, strlen(header)) != 0 ||
+        (line[strlen(header)] != '\n' && line[strlen(header)] != '\r'))
+    {
+        fclose(stream);
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), stream) != NULL)
+    {
+        long length = (long)strlen(line);
+        uint64_t hash = 0;
+        int i;
+
+        while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n'))
+        {
+            length--;
+        }
+        line[length] = '\0';
+        if (length < 18 || line[16] != ' ')
+        {
+            continue;
+        }
+        for (i = 0; i < 16; i++)
+        {
+            char c = line[i];
+
+            hash <<= 4;
+            if (c >= '0' && c <= '9')
+            {
+                hash |= c - '0';
+            }
+            else if (c >= 'a' && c <= 'f')
+            {
+                hash |= c - 'a' + 10;
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (i == 16 && check_cache_add(cache, hash, &line[17]) != 0)
+        {
+            fclose(stream);
+            return -1;
+        }
+    }
+
+    fclose(stream);
+    check_cache_sort(cache);
+
+    return 0;
+}
+
+static int check_cache_write(const check_cache *cache)
+{
+    FILE *stream;
+    long i;
+
+    stream = fopen(cache->filename, "w");
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create cache file '%s'", cache->filename);
+        return -1;
+    }
+    fprintf(stream, "%s %s\n", CACHE_HEADER, libharp_version);
+    for (i = 0; i < cache->num_entries; i++)
+    {
+        if (i > 0 && cache->entry[i].hash == cache->entry[i - 1].hash)
+        {
+            continue;
+        }
+        fprintf(stream, "%08lx%08lx %s\n", (unsigned long)(cache->entry[i].hash >> 32),
+                (unsigned long)(cache->entry[i].hash & 0xFFFFFFFFUL), cache->entry[i].filename);
+    }
+    if (fclose(stream) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "could not write cache file '%s'", cache->filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void write_csv_string(FILE *stream, const char *str)
+{
+    fputc('"', stream);
+    while (*str != '\0')
+    {
+        if (*str == '"')
+        {
+            fputc('"', stream);
+        }
+        fputc(*str, stream);
+        str++;
+    }
+    fputc('"', stream);
+}
+
+static int write_summary(const char *filename, const file_list *list, const check_result *result)
+{
+    const char *status_name[] = { "error", "ok", "failed", "skipped" };
+    FILE *stream;
+    long i;
+
+    stream = fopen(filename, "w");
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create summary file '%s'", filename);
+        return -1;
+    }
+    fprintf(stream, "filename,result,message\n");
+    for (i = 0; i < list->num_files; i++)
+    {
+        write_csv_string(stream, list->filename[i]);
+        fprintf(stream, ",%s,", status_name[result[i].status + 1]);
+        if (result[i].error_message != NULL)
+        {
+            write_csv_string(stream, result[i].error_message);
+        }
+        fprintf(stream, "\n");
+    }
+    if (fclose(stream) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_CLOSE, "could not write summary file '%s'", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* check a single file; all output of the check is passed to the print function */
+static void check_file(const char *filename, const check_info *info, check_result *result,
+                       int (*print) (const char *, ...))
+{
+    int status;
+
+    if (info->cache != NULL && get_file_hash(filename, &result->hash) == 0)
+    {
+        result->has_hash = 1;
+        if (check_cache_contains(info->cache, result->hash))
+        {
+            print("%s: skipped (content unchanged since last successful check)\n", filename);
+            result->status = 2;
+            return;
+        }
+    }
+
+    status = harp_import_test(filename, print);
+    if (status < 0)
+    {
+        result->status = -1;
+        result->error_message = strdup(harp_errno_to_string(harp_errno));
+    }
+    else
+    {
+        result->status = status > 0 ? 1 : 0;
+    }
+}
+
+/* print the result of the check of a file to stdout/stderr */
+static void print_result(const check_result *result)
+{
+    if (result->output != NULL)
+    {
+        fputs(result->output, stdout);
+    }
+    if (result->status < 0)
+    {
+        /* make sure all output of the check is shown before the error */
+        fflush(stdout);
+        fprintf(stderr, "ERROR: %s\n", result->error_message != NULL ? result->error_message : "out of memory");
+    }
+    printf("\n");
+}
+
+#ifdef HAVE_PTHREAD_H
+/* output buffer that captures the output of a check that runs in a separate thread */
+typedef struct output_buffer_struct
+{
+    char *data;
+    long length;
+    long size;
+    int failed; /* set if (part of) the output could not be stored */
+} output_buffer;
+
+static pthread_key_t output_buffer_key;
+
+/* print function that appends the output to the output buffer of the current thread */
+static int print_to_output_buffer(const char *message, ...)
+{
+    output_buffer *buffer = (output_buffer *)pthread_getspecific(output_buffer_key);
+    va_list ap;
+    int length;
+
+    va_start(ap, message);
+    length = vsnprintf(NULL, 0, message, ap);
+    va_end(ap);
+    if (length < 0)
+    {
+        return length;
+    }
+    if (buffer->length + length + 1 > buffer->size)
+    {
+        long new_size = 2 * buffer->size > buffer->length + length + 1 ? 2 * buffer->size : buffer->length + length + 1;
+        char *new_data;
+
+        new_data = realloc(buffer->data, new_size);
+        if (new_data == NULL)
+        {
+            buffer->failed = 1;
+            return -1;
+        }
+        buffer->data = new_data;
+        buffer->size = new_size;
+    }
+    va_start(ap, message);
+    vsnprintf(&buffer->data[buffer->length], length + 1, message, ap);
+    va_end(ap);
+    buffer->length += length;
+
+    return length;
+}
+
+/* shared administration for the threads that check the files */
+typedef struct check_threads_struct
+{
+    const file_list *list;
+    const check_info *info;
+    check_result *result;
+    pthread_mutex_t mutex;      /* protects all fields below */
+    pthread_cond_t file_done;   /* signalled each time a thread finishes checking a file */
+    long next_check;    /* index of the next file that should be checked */
+    int *done;  /* per file: whether the check has finished */
+} check_threads;
+
+static void *check_thread_run(void *arg)
+{
+    check_threads *threads = (check_threads *)arg;
+    long i;
+
+    for (;;)
+    {
+        output_buffer buffer = { NULL, 0, 0, 0 };
+
+        pthread_mutex_lock(&threads->mutex);
+        if (threads->next_check >= threads->list->num_files)
+        {
+            pthread_mutex_unlock(&threads->mutex);
+            break;
+        }
+        i = threads->next_check;
+        threads->next_check++;
+        if (threads->next_check < threads->list->num_files)
+        {
+            /* let the OS read the next file while this one is being checked */
+            harp_prefetch_file(threads->list->filename[threads->next_check]);
+        }
+        pthread_mutex_unlock(&threads->mutex);
+
+        pthread_setspecific(output_buffer_key, &buffer);
+        check_file(threads->list->filename[i], threads->info, &threads->result[i], print_to_output_buffer);
+        pthread_setspecific(output_buffer_key, NULL);
+        if (buffer.failed && threads->result[i].status >= 0)
+        {
+            /* report an error if we could not capture all output */
+            threads->result[i].status = -1;
+        }
+
+        pthread_mutex_lock(&threads->mutex);
+        threads->result[i].output = buffer.data;
+        threads->done[i] = 1;
+        pthread_cond_broadcast(&threads->file_done);
+        pthread_mutex_unlock(&threads->mutex);
+    }
+
+    return NULL;
+}
+
+/* check the files using multiple threads and print the results in order */
+static int check_files_using_threads(const file_list *list, const check_info *info, check_result *result)
+{
+    check_threads threads;
+    pthread_t *thread;
+    int num_threads = 0;
+    long i;
+
+    threads.list = list;
+    threads.info = info;
+    threads.result = result;
+    threads.next_check = 0;
+    threads.done = calloc(list->num_files, sizeof(int));
+    if (threads.done == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       list->num_files * sizeof(int), __FILE__, __LINE__);
+        return -1;
+    }
+    thread = malloc(info->num_threads * sizeof(pthread_t));
+    if (thread == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->num_threads * sizeof(pthread_t), __FILE__, __LINE__);
+        free(threads.done);
+        return -1;
+    }
+    if (pthread_key_create(&output_buffer_key, NULL) != 0)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "could not create thread specific data key");
+        free(thread);
+        free(threads.done);
+        return -1;
+    }
+    pthread_mutex_init(&threads.mutex, NULL);
+    pthread_cond_init(&threads.file_done, NULL);
+
+    while (num_threads < info->num_threads && num_threads < list->num_files)
+    {
+        if (pthread_create(&thread[num_threads], NULL, check_thread_run, &threads) != 0)
+        {
+            /* continue with the threads that we have */
+            break;
+        }
+        num_threads++;
+    }
+    if (num_threads == 0)
+    {
+        /* check the files from the main thread */
+        check_thread_run(&threads);
+    }
+
+    for (i = 0; i < list->num_files; i++)
+    {
+        pthread_mutex_lock(&threads.mutex);
+        while (!threads.done[i])
+        {
+            pthread_cond_wait(&threads.file_done, &threads.mutex);
+        }
+        pthread_mutex_unlock(&threads.mutex);
+
+        print_result(&result[i]);
+        free(result[i].output);
+        result[i].output = NULL;
+    }
+
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(thread[i], NULL);
+    }
+    pthread_cond_destroy(&threads.file_done);
+    pthread_mutex_destroy(&threads.mutex);
+    pthread_key_delete(output_buffer_key);
+    free(thread);
+    free(threads.done);
+
+    return 0;
+}
+#endif
+
+static int check_files(const file_list *list, const check_info *info, check_result *result)
+{
+    long i;
+
+#ifdef HAVE_PTHREAD_H
+    if (info->num_threads > 1 && list->num_files > 1)
+    {
+        return check_files_using_threads(list, info, result);
+    }
+#endif
+
+    for (i = 0; i < list->num_files; i++)
+    {
+        if (i + 1 < list->num_files)
+        {
+            /* let the OS read the next file while this one is being checked */
+            harp_prefetch_file(list->filename[i + 1]);
+        }
+        check_file(list->filename[i], info, &result[i], printf);
+        print_result(&result[i]);
+    }
+
+    return 0;
+}
+
+static int check(int argc, char *argv[])
+{
+    check_info info;
+    check_cache cache = { NULL, 0, NULL };
+    check_result *result;
+    file_list list = { 0, NULL };
+    int exit_code = 0;
+    int i;
+    long j;
+
+    info.num_threads = 1;
+    info.summary_filename = NULL;
+    info.cache = NULL;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            long value;
+
+            value = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || value < 1 || value > MAX_NUM_THREADS)
+            {
+                fprintf(stderr, "ERROR: invalid %s argument: '%s' (expected a value between 1 and %d)\n", argv[i],
+                        argv[i + 1], MAX_NUM_THREADS);
+                print_help();
+                return 1;
+            }
+            info.num_threads = (int)value;
+            i++;
+        }
+        else if (strcmp(argv[i], "--summary") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            info.summary_filename = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            cache.filename = argv[i + 1];
+            info.cache = &cache;
+            i++;
+        }
+        else if (argv[i][0] != '-')
+        {
+            /* assume all arguments from here on are files */
+            break;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: invalid argument: '%s'\n", argv[i]);
+            print_help();
+            return 1;
+        }
+    }
+    if (i == argc)
+    {
+        fprintf(stderr, "ERROR: input product file not specified\n");
+        print_help();
+        return 1;
+    }
+
+    for (; i < argc; i++)
+    {
+        if (add_path(&list, argv[i]) != 0)
+        {
+            fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+            file_list_done(&list);
+            return 1;
+        }
+    }
+
+    if (info.cache != NULL && check_cache_read(&cache) != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        check_cache_done(&cache);
+        file_list_done(&list);
+        return 1;
+    }
+
+    result = malloc(list.num_files * sizeof(check_result) + 1);
+    if (result == NULL)
+    {
+        fprintf(stderr, "ERROR: out of memory (could not allocate %lu bytes)\n",
+                (unsigned long)(list.num_files * sizeof(check_result)));
+        check_cache_done(&cache);
+        file_list_done(&list);
+        return 1;
+    }
+    for (j = 0; j < list.num_files; j++)
+    {
+        result[j].status = 0;
+        result[j].has_hash = 0;
+        result[j].hash = 0;
+        result[j].output = NULL;
+        result[j].error_message = NULL;
+    }
+
+    if (check_files(&list, &info, result) != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit_code = 1;
+    }
+    else
+    {
+        for (j = 0; j < list.num_files; j++)
+        {
+            if (result[j].status == 1 || result[j].status == -1)
+            {
+                exit_code = 1;
+            }
+        }
+
+        if (info.summary_filename != NULL && write_summary(info.summary_filename, &list, result) != 0)
+        {
+            fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+            exit_code = 1;
+        }
+
+        if (info.cache != NULL)
+        {
+            for (j = 0; j < list.num_files; j++)
+            {
+                if (result[j].status == 0 && result[j].has_hash)
+                {
+                    if (check_cache_add(&cache, result[j].hash, list.filename[j]) != 0)
+                    {
+                        break;
+                    }
+                }
+            }
+            if (j == list.num_files)
+            {
+                check_cache_sort(&cache);
+            }
+            if (j < list.num_files || check_cache_write(&cache) != 0)
+            {
+                fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+                exit_code = 1;
+            }
+        }
+    }
+
+    for (j = 0; j < list.num_files; j++)
+    {
+        if (result[j].error_message != NULL)
+        {
+            free(result[j].error_message);
+        }
+    }
+    free(result);
+    check_cache_done(&cache);
+    file_list_done(&list);
+
+    return exit_code;
+}
+
+int main(int argc, char *argv[])
+{
+    int result = 0;
+
     if (argc == 1 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
     {
         print_help();
@@ -92,14 +1175,6 @@ int main(int argc, char *argv[])
         exit(0);
     }
 
-    if (argv[1][0] == '-')
-    {
-        fprintf(stderr, "ERROR: invalid arguments\n");
-        print_help();
-        exit(1);
-    }
-    /* assume all arguments from here on are files */
-
     if (harp_set_coda_definition_path_conditional(argv[0], NULL, "../share/coda/definitions") != 0)
     {
         fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
@@ -119,21 +1194,13 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
-    for (i = 1; i < argc; i++)
+    if (strcmp(argv[1], "--benchmark") == 0)
     {
-        const char *filename = argv[i];
-        int status;
-
-        status = harp_import_test(filename, printf);
-        if (status != 0)
-        {
-            if (status < 0)
-            {
-                fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
-            }
-            result = 1;
-        }
-        printf("\n");
+        result = benchmark(argc, argv);
+    }
+    else
+    {
+        result = check(argc, argv);
     }
 
     harp_done();
@@ -37,11 +37,102 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+int resample_nearest_a(harp_collocation_result *collocation_result, int difference_index, long k);
+int resample_nearest_b(harp_collocation_result *collocation_result, int difference_index, long k);
+
+#define CONST_PI 3.14159265358979323846
+#define CONST_DEG2RAD 0.01745329251994329547437 /* (2*pi)/360 */
+
+/* angular margin [rad] that is added to all spatial index searches to stay on the safe side of rounding errors */
+#define SPATIAL_INDEX_MARGIN 1.0e-8
+/* samples of which the bounding cap exceeds this angular radius [rad] are not indexed (and always evaluated) */
+#define SPATIAL_INDEX_MAX_CAP_RADIUS 1.4
+/* angular radius [rad] used to size the grid cells if the search radius is only known at query time */
+#define SPATIAL_INDEX_DEFAULT_RADIUS 0.01
+/* minimum edge length of a grid cell (in unit sphere coordinates) */
+#define SPATIAL_INDEX_MIN_CELL_SIZE 1.0e-4
+/* maximum deviation [degree] of a sample location from its regular latitude/longitude grid position */
+#define SPATIAL_INDEX_GRID_TOLERANCE 1.0e-6
+
+/* maximum value for the --threads option */
+#define MAX_NUM_THREADS 1024
+
+/* number of evaluated sample pairs after which the evaluation order of the criteria is updated */
+#define CRITERIUM_REORDER_INTERVAL 4096
+
+typedef struct datetime_index_entry_struct
+{
+    double datetime;
+    long index;
+} datetime_index_entry;
 
-int resample_nearest_a(harp_collocation_result *collocation_result, int difference_index);
-int resample_nearest_b(harp_collocation_result *collocation_result, int difference_index);
+/* Datetime index for the samples of a product from dataset B.
+ * Samples are sorted by datetime such that the samples within the datetime criterium window around a sample of A
+ * can be found with a (moving) window [lower, upper) over the sorted samples.
+ */
+typedef struct datetime_index_struct
+{
+    long num_entries;   /* samples with a valid datetime (samples with a NaN datetime can never match) */
+    datetime_index_entry *entry;        /* samples sorted by datetime and sample index */
+    double last_datetime;       /* datetime of the last query */
+    long lower;         /* first entry of the current window */
+    long upper;         /* one beyond the last entry of the current window */
+    long num_candidates;
+    long *candidate;    /* samples in the current window (sorted by sample index) */
+} datetime_index;
+
+typedef enum spatial_index_type_enum
+{
+    spatial_index_none, /* no spatial criterium -> compare all samples */
+    spatial_index_point_to_point,       /* point of A versus point of B (point_distance) */
+    spatial_index_area_to_point,        /* area of A versus point of B (point-in-area-yx) */
+    spatial_index_area_to_area, /* area of A versus area of B (area-intersects) */
+    spatial_index_point_to_area /* point of A versus area of B (point-in-area-xy) */
+} spatial_index_type;
+
+typedef struct spatial_index_entry_struct
+{
+    int64_t cell;
+    long index;
+} spatial_index_entry;
+
+/* Spatial index for the samples of a product from dataset B.
+ * Each sample is represented by a bounding cap on the unit sphere (a centre unit vector and an angular radius; the
+ * radius is 0 for points). The centres are placed in a regular 3D grid of cubic cells and the (sorted) cell numbers
+ * are used to quickly find the samples that are near a given location.
+ * If the centres form a latitude/longitude grid with regular longitudes (such as a model or L3 grid that was flattened
+ * using flatten(latitude);flatten(longitude)) then the samples near a location are instead determined directly from
+ * the grid rows and columns. Sample (block * num_grid_rows + row) * num_grid_columns + column is then located at
+ * latitude grid_row_latitude[row] and longitude grid_longitude + column * grid_longitude_step [degree].
+ */
+typedef struct spatial_index_struct
+{
+    long num_samples;
+    double cell_size;   /* edge length of a grid cell (in unit sphere coordinates) */
+    long num_cells;     /* number of grid cells along each axis */
+    double *centre;     /* unit vector (x,y,z) for each sample */
+    double *radius;     /* angular radius [rad] of the bounding cap for each sample (NULL if all samples are points) */
+    double max_radius;  /* maximum radius of all indexed samples */
+    long num_entries;
+    spatial_index_entry *entry; /* indexed samples, sorted by cell and sample index */
+    long num_unindexed;
+    long *unindexed;    /* samples without a (valid) bounding cap, these are always a candidate */
+    long num_candidates;
+    long *candidate;    /* result of the last query (sorted by sample index) */
+    long num_grid_blocks;       /* number of repetitions of the grid (e.g. for multiple times) */
+    long num_grid_rows;
+    long num_grid_columns;      /* 0 if the samples do not form a latitude/longitude grid */
+    double *grid_row_latitude;  /* latitude [degree] of each row (strictly increasing or decreasing) */
+    double grid_longitude;      /* longitude [degree] of the first column */
+    double grid_longitude_step; /* longitude difference [degree] between consecutive columns */
+} spatial_index;
 
 typedef struct collocation_criterium_struct
 {
@@ -59,9 +150,28 @@ typedef struct cache_variables_struct
     harp_variable *longitude;   /* copy */
     harp_variable *latitude_bounds;     /* copy */
     harp_variable *longitude_bounds;    /* copy */
+    harp_area_cache *area_cache;        /* polygons for latitude_bounds/longitude_bounds */
+    double *point;      /* unit vector (x,y,z) for each latitude/longitude (NaN if invalid); only for point_to_point */
     harp_variable **criterium;  /* references */
 } cache_variables;
 
+typedef struct nearest_neighbour_entry_struct
+{
+    harp_collocation_pair *pair;
+    long sequence_number;       /* order in which the pairs were added (the earliest pair wins in case of ties) */
+} nearest_neighbour_entry;
+
+/* The (at most k) nearest pairs that were found so far for the samples of a single product of the dataset on which
+ * the first nearest neighbour filter is applied. The entries of each sample form a max-heap on the difference, such
+ * that the pair that is the farthest away (and the first one to be dropped) is always at the root.
+ */
+typedef struct nearest_neighbour_heaps_struct
+{
+    long num_samples;   /* number of samples for which there is room (indexed by sample index) */
+    long *num_entries;  /* number of entries in the heap of each sample */
+    nearest_neighbour_entry *entry;     /* [num_samples, k] */
+} nearest_neighbour_heaps;
+
 typedef struct collocation_info_struct
 {
     /* options */
@@ -74,6 +184,10 @@ typedef struct collocation_info_struct
     int filter_area_intersects;
     int filter_point_in_area_xy;
     int filter_point_in_area_yx;
+    spatial_index_type spatial_index_type;
+    double spatial_index_radius;        /* search radius [rad] for the point_distance criterium */
+    double point_distance_per_radian;   /* distance [m] on the sphere that is used for point_distance */
+    int point_distance_wgs84;   /* use the distance on the WGS84 ellipsoid for point_distance */
     const char *ingest_options_a;
     const char *ingest_options_b;
     const char *operations_a;
@@ -84,23 +198,99 @@ typedef struct collocation_info_struct
     int nearest_neighbour_x_criterium_index;
     char *nearest_neighbour_y_variable_name;
     int nearest_neighbour_y_criterium_index;
+    long num_nearest_neighbours;        /* number of nearest pairs that are kept per sample by -nx/-ny */
+
+    int num_threads;
+    int shard_index;    /* only match the products of dataset A that belong to shard 'shard_index' of 'num_shards' */
+    int num_shards;
+    int64_t max_cache_size_b;   /* maximum size [bytes] of the loaded products of dataset B per thread (0 = no limit) */
+    int verbose;
+    int binary_output;
+    const char *stream_filename;        /* output file to which the pairs are written while matching (--stream) */
+    int stream_started; /* whether the output file has been (re)created for --stream */
 
     /* result */
     harp_collocation_result *collocation_result;
+    harp_collocation_result *previous_result;   /* existing result that is extended (incremental mode) */
+
+    /* state of the first nearest neighbour filter, which is applied while matching (one entry per product of the
+     * filtered dataset of the collocation result)
+     */
+    long num_nearest_neighbour_heaps;
+    nearest_neighbour_heaps **nearest_neighbour_heaps;
+    long nearest_neighbour_sequence_number;
+    long num_removed_pairs;     /* pairs that were pushed out of a heap that are still in the collocation result */
 
     /* state */
     long *sorted_index_a;       /* indices of products sorted by datetime_start/datetime_stop */
     long *sorted_index_b;
-    harp_product *product_a;    /* we only have one product of dataset A loaded at any moment */
-    harp_product **product_b;   /* for dataset B we may have multiple products loaded */
     harp_dataset *dataset_a;
     harp_dataset *dataset_b;
+    uint8_t *is_new_product_a;  /* products that are not in the previous result (NULL if all products are new) */
+    uint8_t *is_new_product_b;
+
+    /* statistics of the product cache for dataset B (summed over all threads) */
+    long cache_b_num_hits;
+    long cache_b_num_misses;
+    long cache_b_num_evictions;
+    long cache_b_num_reingested;
+    int64_t cache_b_peak_size;
+    long num_pairs_pruned;      /* product pairs that were skipped because their spatial extents are too far apart */
+} collocation_info;
+
+/* the products and variables that are loaded while matching products of dataset A against dataset B;
+ * there is one matchup state per thread
+ */
+typedef struct matchup_state_struct
+{
+    long num_products_b;
+    harp_product *product_a;    /* we only have one product of dataset A loaded at any moment */
+    harp_product **product_b;   /* for dataset B we may have multiple products loaded */
+    int64_t *product_b_size;    /* storage size of each loaded product of dataset B */
+    long *product_b_last_use;   /* value of use_counter when a product of dataset B was last used */
+    uint8_t *product_b_evicted; /* whether a product of dataset B was removed because of the cache size limit */
+    int64_t cache_size_b;       /* total storage size of the loaded products of dataset B */
+    long use_counter;
+
+    /* cache statistics */
+    long cache_b_num_hits;
+    long cache_b_num_misses;
+    long cache_b_num_evictions;
+    long cache_b_num_reingested;
+    int64_t cache_b_peak_size;
+    long num_pairs_pruned;
+    spatial_index **spatial_index_b;    /* spatial index for each loaded product of dataset B */
+    datetime_index **datetime_index_b;  /* datetime index for each loaded product of dataset B */
 
     cache_variables variables_a;
     cache_variables variables_b;
 
     double *difference;
-} collocation_info;
+
+    /* order in which the criteria are evaluated; the scalar criteria are sorted such that the criteria that reject
+     * the largest fraction of the sample pairs come first (the point distance is always evaluated last)
+     */
+    int *criterium_order;
+    long *criterium_num_evaluated;
+    long *criterium_num_rejected;
+    long num_pairs_until_reorder;
+
+    /* compiled operations for dataset A and B (each thread has its own programs) */
+    harp_program *program_a;
+    harp_program *program_b;
+
+    /* the operations followed by a keep() of the variables that the matchup needs; this is used instead of the plain
+     * operations such that the other variables do not get read (the keep() is performed during ingestion if all
+     * operations can be performed during ingestion); set to NULL if the keep() turns out to fail for a product
+     */
+    harp_program *keep_program_a;
+    harp_program *keep_program_b;
+
+    /* if set, all matching pairs are stored here (without nearest neighbour filtering) instead of in the final
+     * collocation result; this is used when the products of dataset A are processed by multiple threads
+     */
+    harp_collocation_result *collocation_result;
+} matchup_state;
 
 static void collocation_criterium_delete(collocation_criterium *criterium)
 {
@@ -225,1103 +415,3716 @@ static int collocation_criterium_set_unit(collocation_criterium *criterium, cons
     return 0;
 }
 
-static void collocation_info_delete(collocation_info *info)
+static int compare_long(const void *a, const void *b)
 {
-    int i;
+    long value_a = *(long *)a;
+    long value_b = *(long *)b;
 
-    if (info != NULL)
+    if (value_a < value_b)
     {
-        if (info->criterium != NULL)
-        {
-            for (i = 0; i < info->num_criteria; i++)
-            {
-                if (info->criterium[i] != NULL)
-                {
-                    collocation_criterium_delete(info->criterium[i]);
-                }
-            }
-            free(info->criterium);
-        }
-        if (info->nearest_neighbour_x_variable_name != NULL)
-        {
-            free(info->nearest_neighbour_x_variable_name);
-        }
-        if (info->nearest_neighbour_y_variable_name != NULL)
-        {
-            free(info->nearest_neighbour_y_variable_name);
-        }
-        if (info->collocation_result != NULL)
-        {
-            harp_collocation_result_delete(info->collocation_result);
-        }
-        if (info->sorted_index_a != NULL)
-        {
-            free(info->sorted_index_a);
-        }
-        if (info->sorted_index_b != NULL)
-        {
-            free(info->sorted_index_b);
-        }
-        if (info->product_a != NULL)
-        {
-            harp_product_delete(info->product_a);
-        }
-        if (info->product_b != NULL)
-        {
-            assert(info->dataset_b != NULL);
-            for (i = 0; i < info->dataset_b->num_products; i++)
-            {
-                if (info->product_b[i] != NULL)
-                {
-                    harp_product_delete(info->product_b[i]);
-                }
-            }
-            free(info->product_b);
-        }
-        if (info->dataset_a != NULL)
-        {
-            harp_dataset_delete(info->dataset_a);
-        }
-        if (info->dataset_b != NULL)
-        {
-            harp_dataset_delete(info->dataset_b);
-        }
-        if (info->variables_a.latitude != NULL)
-        {
-            harp_variable_delete(info->variables_a.latitude);
-        }
-        if (info->variables_a.longitude != NULL)
-        {
-            harp_variable_delete(info->variables_a.longitude);
-        }
-        if (info->variables_a.latitude_bounds != NULL)
-        {
-            harp_variable_delete(info->variables_a.latitude_bounds);
-        }
-        if (info->variables_a.longitude_bounds != NULL)
-        {
-            harp_variable_delete(info->variables_a.longitude_bounds);
-        }
-        if (info->variables_a.criterium != NULL)
-        {
-            free(info->variables_a.criterium);
-        }
-        if (info->variables_b.latitude != NULL)
-        {
-            harp_variable_delete(info->variables_b.latitude);
-        }
-        if (info->variables_b.longitude != NULL)
-        {
-            harp_variable_delete(info->variables_b.longitude);
-        }
-        if (info->variables_b.latitude_bounds != NULL)
-        {
-            harp_variable_delete(info->variables_b.latitude_bounds);
-        }
-        if (info->variables_b.longitude_bounds != NULL)
-        {
-            harp_variable_delete(info->variables_b.longitude_bounds);
-        }
-        if (info->variables_b.criterium != NULL)
-        {
-            free(info->variables_b.criterium);
-        }
-        if (info->difference != NULL)
-        {
-            free(info->difference);
-        }
-        free(info);
+        return -1;
+    }
+
+    if (value_a > value_b)
+    {
+        return 1;
     }
+
+    return 0;
 }
 
-static int collocation_info_new(collocation_info **new_info)
+static int compare_spatial_index_entry(const void *a, const void *b)
 {
-    collocation_info *info = NULL;
+    spatial_index_entry *entry_a = (spatial_index_entry *)a;
+    spatial_index_entry *entry_b = (spatial_index_entry *)b;
 
-    info = (collocation_info *)malloc(sizeof(collocation_info));
-    if (info == NULL)
+    if (entry_a->cell < entry_b->cell)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       sizeof(collocation_info), __FILE__, __LINE__);
         return -1;
     }
 
-    info->num_criteria = 0;
-    info->criterium = NULL;
-    info->datetime_index = -1;
-    info->datetime_conversion_factor = 1;
-    info->point_distance_index = -1;
-    info->point_distance_conversion_factor = 1;
-    info->filter_area_intersects = 0;
-    info->filter_point_in_area_xy = 0;
-    info->filter_point_in_area_yx = 0;
-    info->ingest_options_a = NULL;
-    info->ingest_options_b = NULL;
-    info->operations_a = NULL;
-    info->operations_b = NULL;
-    info->perform_nearest_neighbour_x_first = 0;
-    info->nearest_neighbour_x_variable_name = NULL;
-    info->nearest_neighbour_x_criterium_index = -1;
-    info->nearest_neighbour_y_variable_name = NULL;
-    info->nearest_neighbour_y_criterium_index = -1;
-    info->collocation_result = NULL;
-    info->sorted_index_a = NULL;
-    info->sorted_index_b = NULL;
-    info->product_a = NULL;
-    info->product_b = NULL;
-    info->dataset_a = NULL;
-    info->dataset_b = NULL;
-    info->variables_a.index = NULL;
-    info->variables_a.latitude = NULL;
-    info->variables_a.longitude = NULL;
-    info->variables_a.latitude_bounds = NULL;
-    info->variables_a.longitude_bounds = NULL;
-    info->variables_a.criterium = NULL;
-    info->variables_b.index = NULL;
-    info->variables_b.latitude = NULL;
-    info->variables_b.longitude = NULL;
-    info->variables_b.latitude_bounds = NULL;
-    info->variables_b.longitude_bounds = NULL;
-    info->variables_b.criterium = NULL;
-    info->difference = NULL;
-
-    if (harp_dataset_new(&info->dataset_a) != 0)
+    if (entry_a->cell > entry_b->cell)
     {
-        collocation_info_delete(info);
-        return -1;
+        return 1;
     }
-    if (harp_dataset_new(&info->dataset_b) != 0)
+
+    if (entry_a->index < entry_b->index)
     {
-        collocation_info_delete(info);
         return -1;
     }
-    if (harp_collocation_result_new(&info->collocation_result, 0, NULL, NULL) != 0)
+
+    if (entry_a->index > entry_b->index)
     {
-        collocation_info_delete(info);
-        return -1;
+        return 1;
     }
 
-    *new_info = info;
-
     return 0;
 }
 
-static int collocation_info_add_criterium(collocation_info *info, int variable_name_length, const char *variable_name,
-                                          double value, int unit_length, const char *unit)
+/* returns 1 if a unit vector could be determined for the lat/lon point (in [degree]) and 0 otherwise */
+static int unit_vector_from_point(double latitude, double longitude, double *vector)
 {
-    collocation_criterium **new_criterium;
-    collocation_criterium *criterium;
-    int i;
-
-    new_criterium = realloc(info->criterium, (info->num_criteria + 1) * sizeof(collocation_criterium *));
-    if (new_criterium == NULL)
+    if (!harp_isfinite(latitude) || !harp_isfinite(longitude))
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (info->num_criteria + 1) * sizeof(collocation_criterium *), __FILE__, __LINE__);
-        return -1;
+        return 0;
     }
-    info->criterium = new_criterium;
 
-    if (collocation_criterium_new(variable_name_length, variable_name, value, unit_length, unit, &criterium) != 0)
+    latitude *= CONST_DEG2RAD;
+    longitude *= CONST_DEG2RAD;
+    vector[0] = cos(latitude) * cos(longitude);
+    vector[1] = cos(latitude) * sin(longitude);
+    vector[2] = sin(latitude);
+
+    return 1;
+}
+
+/* get the latitude/longitude [degree] of a unit vector */
+static void point_from_unit_vector(const double *vector, double *latitude, double *longitude)
+{
+    *latitude = atan2(vector[2], sqrt(vector[0] * vector[0] + vector[1] * vector[1])) / CONST_DEG2RAD;
+    *longitude = atan2(vector[1], vector[0]) / CONST_DEG2RAD;
+}
+
+/* map a longitude difference [degree] to the range [-180,180) */
+static double wrap_longitude_difference(double difference)
+{
+    return difference - 360.0 * floor((difference + 180.0) / 360.0);
+}
+
+/* get the angular distance [rad] between two unit vectors */
+static double unit_vector_distance(const double *vector_a, const double *vector_b)
+{
+    double cosdist = vector_a[0] * vector_b[0] + vector_a[1] * vector_b[1] + vector_a[2] * vector_b[2];
+
+    if (cosdist > 1.0)
     {
-        return -1;
+        cosdist = 1.0;
     }
-
-    for (i = 0; i < info->num_criteria; i++)
+    else if (cosdist < -1.0)
     {
-        if (strcmp(info->criterium[i]->variable_name, criterium->variable_name) == 0)
-        {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot provide more than one criterium for variable '%s'",
-                           criterium->variable_name);
-            collocation_criterium_delete(criterium);
-            return -1;
-        }
+        cosdist = -1.0;
     }
-    info->criterium[info->num_criteria] = criterium;
-    info->num_criteria++;
 
-    return 0;
+    return acos(cosdist);
 }
 
-static int collocation_info_add_criterium_from_string(collocation_info *info, char *argument)
+/* get the angular distance [rad] between two unit vectors (accurate for both very small and very large distances) */
+static double unit_vector_point_distance(const double *vector_a, const double *vector_b)
 {
-    char *cursor;
-    char *variable_name;
-    char *value_str;
-    char *unit = NULL;
-    double value;
-    int variable_name_length;
-    int unit_length = 0;
+    double cross[3];
+    double cosdist = vector_a[0] * vector_b[0] + vector_a[1] * vector_b[1] + vector_a[2] * vector_b[2];
 
-    cursor = argument;
-    while (*cursor == ' ')
+    cross[0] = vector_a[1] * vector_b[2] - vector_a[2] * vector_b[1];
+    cross[1] = vector_a[2] * vector_b[0] - vector_a[0] * vector_b[2];
+    cross[2] = vector_a[0] * vector_b[1] - vector_a[1] * vector_b[0];
+
+    return atan2(sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), cosdist);
+}
+
+/* Determine a cap (centre unit vector + angular radius [rad]) that fully contains the polygon area.
+ * Returns 1 if a (sufficiently small) bounding cap could be determined and 0 otherwise.
+ */
+static int bounding_cap_from_area(long num_vertices, const double *latitude_bounds, const double *longitude_bounds,
+                                  double *centre, double *radius)
+{
+    double vertex[3];
+    double norm;
+    double distance;
+    long i;
+
+    centre[0] = 0;
+    centre[1] = 0;
+    centre[2] = 0;
+    for (i = 0; i < num_vertices; i++)
     {
-        cursor++;
+        if (!unit_vector_from_point(latitude_bounds[i], longitude_bounds[i], vertex))
+        {
+            return 0;
+        }
+        centre[0] += vertex[0];
+        centre[1] += vertex[1];
+        centre[2] += vertex[2];
     }
-    variable_name = cursor;
-    while (*cursor != ' ' && *cursor != '\0')
+    norm = sqrt(centre[0] * centre[0] + centre[1] * centre[1] + centre[2] * centre[2]);
+    if (!(norm > 1.0e-6 * num_vertices))
     {
-        cursor++;
+        return 0;
     }
-    variable_name_length = (int)(cursor - variable_name);
-    if (variable_name_length == 0)
+    centre[0] /= norm;
+    centre[1] /= norm;
+    centre[2] /= norm;
+
+    /* the cap is convex (radius < pi/2), so it also contains the great circle segments between the vertices */
+    *radius = 0;
+    for (i = 0; i < num_vertices; i++)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid criterium '%s'", argument);
-        return -1;
+        unit_vector_from_point(latitude_bounds[i], longitude_bounds[i], vertex);
+        distance = unit_vector_distance(centre, vertex);
+        if (distance > *radius)
+        {
+            *radius = distance;
+        }
     }
+    *radius += SPATIAL_INDEX_MARGIN;
 
-    while (*cursor == ' ')
+    return *radius <= SPATIAL_INDEX_MAX_CAP_RADIUS;
+}
+
+static long spatial_index_get_cell_coordinate(const spatial_index *index, double value)
+{
+    long coordinate = (long)floor((value + 1.0) / index->cell_size);
+
+    if (coordinate < 0)
     {
-        cursor++;
+        return 0;
     }
-    value_str = cursor;
-    value = strtod(value_str, &cursor);
-    if (cursor == value_str)
+    if (coordinate >= index->num_cells)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "missing value in criterium '%s'", argument);
-        return -1;
+        return index->num_cells - 1;
     }
 
-    while (*cursor == ' ')
-    {
-        cursor++;
-    }
-    if (*cursor != '\0')
+    return coordinate;
+}
+
+static void spatial_index_delete(spatial_index *index)
+{
+    if (index != NULL)
     {
-        if (*cursor != '[')
+        if (index->centre != NULL)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid unit in criterium '%s' (expected '[')", argument);
-            return -1;
+            free(index->centre);
         }
-        cursor++;
-        unit = cursor;
-        while (*cursor != ']' && *cursor != '\0')
+        if (index->radius != NULL)
         {
-            cursor++;
+            free(index->radius);
         }
-        unit_length = (int)(cursor - unit);
-        if (unit_length == 0)
+        if (index->entry != NULL)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid unit in criterium '%s'", argument);
-            return -1;
+            free(index->entry);
         }
-        if (*cursor != ']')
+        if (index->unindexed != NULL)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid unit in criterium '%s' (expected ']')", argument);
-            return -1;
+            free(index->unindexed);
         }
-        cursor++;
-        while (*cursor == ' ')
+        if (index->candidate != NULL)
         {
-            cursor++;
+            free(index->candidate);
         }
-        if (*cursor != '\0')
+        if (index->grid_row_latitude != NULL)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid criterium '%s'", argument);
-            return -1;
+            free(index->grid_row_latitude);
         }
+        free(index);
     }
-
-    return collocation_info_add_criterium(info, variable_name_length, variable_name, value, unit_length, unit);
 }
 
-static int collocation_info_update(collocation_info *info)
+/* Determine whether the centres of all samples form a latitude/longitude grid with regular longitudes (see
+ * spatial_index). Returns 1 if this is the case (and sets the grid properties), 0 if not, and -1 on error.
+ */
+static int spatial_index_detect_grid(spatial_index *index)
 {
-    int i, j;
+    double *row_latitude;
+    double latitude, longitude;
+    double first_longitude;
+    double step;
+    long num_columns;
+    long num_rows;
+    long num_block_rows;
+    long i;
 
-    /* add criteria for the nearest neighbour filters (if they were not there yet) */
-    if (info->nearest_neighbour_x_variable_name != NULL)
+    if (index->num_unindexed > 0 || index->num_samples < 2)
     {
-        for (i = 0; i < info->num_criteria; i++)
-        {
-            if (strcmp(info->criterium[i]->variable_name, info->nearest_neighbour_x_variable_name) == 0)
-            {
-                info->nearest_neighbour_x_criterium_index = i;
-                break;
-            }
-        }
-        if (i == info->num_criteria)
-        {
-            if (collocation_info_add_criterium(info, (int)strlen(info->nearest_neighbour_x_variable_name),
-                                               info->nearest_neighbour_x_variable_name, harp_plusinf(), 0, NULL) != 0)
-            {
-                return -1;
-            }
-            info->nearest_neighbour_x_criterium_index = info->num_criteria - 1;
-        }
+        return 0;
     }
 
-    if (info->nearest_neighbour_y_variable_name != NULL)
+    /* the first row consists of the leading samples with the same latitude */
+    point_from_unit_vector(&index->centre[0], &latitude, &first_longitude);
+    for (num_columns = 1; num_columns < index->num_samples; num_columns++)
     {
-        for (i = 0; i < info->num_criteria; i++)
-        {
-            if (strcmp(info->criterium[i]->variable_name, info->nearest_neighbour_y_variable_name) == 0)
-            {
-                info->nearest_neighbour_y_criterium_index = i;
-                break;
-            }
-        }
-        if (i == info->num_criteria)
+        double column_latitude;
+
+        point_from_unit_vector(&index->centre[3 * num_columns], &column_latitude, &longitude);
+        if (fabs(column_latitude - latitude) > SPATIAL_INDEX_GRID_TOLERANCE)
         {
-            if (collocation_info_add_criterium(info, (int)strlen(info->nearest_neighbour_y_variable_name),
-                                               info->nearest_neighbour_y_variable_name, harp_plusinf(), 0, NULL) != 0)
-            {
-                return -1;
-            }
-            info->nearest_neighbour_y_criterium_index = info->num_criteria - 1;
+            break;
         }
     }
+    if (num_columns < 2 || index->num_samples % num_columns != 0)
+    {
+        return 0;
+    }
+    point_from_unit_vector(&index->centre[3], &latitude, &longitude);
+    step = wrap_longitude_difference(longitude - first_longitude);
+    if (fabs(step) <= SPATIAL_INDEX_GRID_TOLERANCE || num_columns * fabs(step) > 360.0 + SPATIAL_INDEX_GRID_TOLERANCE)
+    {
+        return 0;
+    }
 
-    /* if no criteria are set then all data is kept and no need to collocate */
-    if (info->num_criteria == 0 && !info->filter_area_intersects && !info->filter_point_in_area_xy &&
-        !info->filter_point_in_area_yx)
+    num_rows = index->num_samples / num_columns;
+    row_latitude = malloc(num_rows * sizeof(double));
+    if (row_latitude == NULL)
     {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "no collocation criteria are set");
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_rows * sizeof(double), __FILE__, __LINE__);
         return -1;
     }
+    for (i = 0; i < num_rows; i++)
+    {
+        point_from_unit_vector(&index->centre[3 * i * num_columns], &row_latitude[i], &longitude);
+    }
 
-    /* properly order criteria and identify special treatment */
-    for (i = 0; i < info->num_criteria; i++)
+    /* the row latitudes are strictly monotonic within a block and each block has the same rows */
+    num_block_rows = 1;
+    if (num_rows > 1 && fabs(row_latitude[1] - row_latitude[0]) > SPATIAL_INDEX_GRID_TOLERANCE)
     {
-        if (strcmp(info->criterium[i]->variable_name, "datetime") == 0)
-        {
-            /* make sure that datetime criterium is the first */
-            if (i != 0)
-            {
-                collocation_criterium *criterium;
-                int j;
+        double direction = row_latitude[1] > row_latitude[0] ? 1.0 : -1.0;
 
-                /* put datetime criterium in the first position */
-                criterium = info->criterium[i];
-                for (j = i; j > 0; j--)
-                {
-                    info->criterium[j] = info->criterium[j - 1];
-                }
-                info->criterium[0] = criterium;
-            }
-            info->datetime_index = 0;
-            /* determine conversion factor between threshold unit and internal HARP unit */
-            if (harp_convert_unit(HARP_UNIT_TIME, info->criterium[info->datetime_index]->unit, 1,
-                                  &info->datetime_conversion_factor) != 0)
+        for (num_block_rows = 2; num_block_rows < num_rows; num_block_rows++)
+        {
+            if (!(direction * (row_latitude[num_block_rows] - row_latitude[num_block_rows - 1]) >
+                  SPATIAL_INDEX_GRID_TOLERANCE))
             {
-                return -1;
+                break;
             }
-            break;
         }
     }
-    for (i = 0; i < info->num_criteria; i++)
+    if (num_rows % num_block_rows != 0)
     {
-        if (strcmp(info->criterium[i]->variable_name, "point_distance") == 0)
+        free(row_latitude);
+        return 0;
+    }
+    for (i = 0; i < index->num_samples; i++)
+    {
+        long row = (i / num_columns) % num_block_rows;
+        long column = i % num_columns;
+
+        point_from_unit_vector(&index->centre[3 * i], &latitude, &longitude);
+        /* the longitude of a point at a pole is arbitrary */
+        if (fabs(latitude - row_latitude[row]) > SPATIAL_INDEX_GRID_TOLERANCE ||
+            (fabs(wrap_longitude_difference(longitude - (first_longitude + column * step))) >
+             SPATIAL_INDEX_GRID_TOLERANCE && 90.0 - fabs(latitude) > SPATIAL_INDEX_GRID_TOLERANCE))
         {
-            info->point_distance_index = i;
-            /* determine conversion factor between threshold unit and internal HARP unit */
-            if (harp_convert_unit(HARP_UNIT_LENGTH, info->criterium[info->point_distance_index]->unit, 1,
-                                  &info->point_distance_conversion_factor) != 0)
-            {
-                return -1;
-            }
-            break;
+            free(row_latitude);
+            return 0;
         }
     }
 
-    /* initialize sorted indices */
-    info->sorted_index_a = malloc(info->dataset_a->num_products * sizeof(long));
-    if (info->sorted_index_a == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       info->dataset_a->num_products * sizeof(long), __FILE__, __LINE__);
-        return -1;
-    }
-    for (i = 0; i < info->dataset_a->num_products; i++)
-    {
-        /* start with source_product ordering */
-        info->sorted_index_a[i] = info->dataset_a->sorted_index[i];
+    index->num_grid_blocks = num_rows / num_block_rows;
+    index->num_grid_rows = num_block_rows;
+    index->num_grid_columns = num_columns;
+    index->grid_row_latitude = row_latitude;
+    index->grid_longitude = first_longitude;
+    index->grid_longitude_step = step;
 
-        /* bubble down to make it sorted on datetime start/stop */
-        for (j = i; j > 0; j--)
-        {
-            harp_product_metadata *metadata = info->dataset_a->metadata[info->sorted_index_a[j]];
-            harp_product_metadata *metadata_prev = info->dataset_a->metadata[info->sorted_index_a[j - 1]];
+    return 1;
+}
 
-            if (metadata->datetime_start < metadata_prev->datetime_start ||
-                (metadata->datetime_start == metadata_prev->datetime_start &&
-                 metadata->datetime_stop < metadata_prev->datetime_stop))
-            {
-                long index = info->sorted_index_a[j - 1];
+/* create a spatial index for the samples of product B, using the location variables from 'cache' */
+static int spatial_index_new(collocation_info *info, const cache_variables *cache, long num_samples,
+                             spatial_index **new_index)
+{
+    spatial_index *index;
+    int use_area;
+    long i;
 
-                info->sorted_index_a[j - 1] = info->sorted_index_a[j];
-                info->sorted_index_a[j] = index;
-            }
-        }
-    }
+    assert(info->spatial_index_type != spatial_index_none);
+    use_area = (info->spatial_index_type == spatial_index_area_to_area ||
+                info->spatial_index_type == spatial_index_point_to_area);
 
-    info->sorted_index_b = malloc(info->dataset_b->num_products * sizeof(long));
-    if (info->sorted_index_b == NULL)
+    index = (spatial_index *)malloc(sizeof(spatial_index));
+    if (index == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       info->dataset_b->num_products * sizeof(long), __FILE__, __LINE__);
+                       sizeof(spatial_index), __FILE__, __LINE__);
         return -1;
     }
-    for (i = 0; i < info->dataset_b->num_products; i++)
+    index->num_samples = num_samples;
+    index->cell_size = 2.0;
+    index->num_cells = 1;
+    index->centre = NULL;
+    index->radius = NULL;
+    index->max_radius = 0;
+    index->num_entries = 0;
+    index->entry = NULL;
+    index->num_unindexed = 0;
+    index->unindexed = NULL;
+    index->num_candidates = 0;
+    index->candidate = NULL;
+    index->num_grid_blocks = 0;
+    index->num_grid_rows = 0;
+    index->num_grid_columns = 0;
+    index->grid_row_latitude = NULL;
+    index->grid_longitude = 0;
+    index->grid_longitude_step = 0;
+
+    if (num_samples == 0)
     {
-        info->sorted_index_b[i] = info->dataset_b->sorted_index[i];
-
-        for (j = i; j > 0; j--)
-        {
-            harp_product_metadata *metadata = info->dataset_b->metadata[info->sorted_index_b[j]];
-            harp_product_metadata *metadata_prev = info->dataset_b->metadata[info->sorted_index_b[j - 1]];
-
-            if (metadata->datetime_start < metadata_prev->datetime_start ||
-                (metadata->datetime_start == metadata_prev->datetime_start &&
-                 metadata->datetime_stop < metadata_prev->datetime_stop))
-            {
-                long index = info->sorted_index_b[j - 1];
-
-                info->sorted_index_b[j - 1] = info->sorted_index_b[j];
-                info->sorted_index_b[j] = index;
-            }
-        }
+        *new_index = index;
+        return 0;
     }
 
-    /* initialized product_b array */
-    info->product_b = malloc(info->dataset_b->num_products * sizeof(harp_product *));
-    if (info->product_b == NULL)
+    index->centre = malloc(num_samples * 3 * sizeof(double));
+    if (index->centre == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       info->dataset_b->num_products * sizeof(harp_product *), __FILE__, __LINE__);
+                       num_samples * 3 * sizeof(double), __FILE__, __LINE__);
+        spatial_index_delete(index);
         return -1;
     }
-    for (i = 0; i < info->dataset_b->num_products; i++)
+    if (use_area)
     {
-        info->product_b[i] = NULL;
+        index->radius = malloc(num_samples * sizeof(double));
+        if (index->radius == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_samples * sizeof(double), __FILE__, __LINE__);
+            spatial_index_delete(index);
+            return -1;
+        }
     }
-
-    /* set the differences for the collocation result */
-    info->collocation_result->num_differences = info->num_criteria;
-    info->collocation_result->difference_variable_name = malloc((info->num_criteria + 1) * sizeof(char *));
-    if (info->collocation_result->difference_variable_name == NULL)
+    index->entry = malloc(num_samples * sizeof(spatial_index_entry));
+    if (index->entry == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (info->num_criteria + 1) * sizeof(char *), __FILE__, __LINE__);
+                       num_samples * sizeof(spatial_index_entry), __FILE__, __LINE__);
+        spatial_index_delete(index);
         return -1;
     }
-    info->collocation_result->difference_unit = malloc((info->num_criteria + 1) * sizeof(char *));
-    if (info->collocation_result->difference_unit == NULL)
+    index->unindexed = malloc(num_samples * sizeof(long));
+    if (index->unindexed == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (info->num_criteria + 1) * sizeof(char *), __FILE__, __LINE__);
+                       num_samples * sizeof(long), __FILE__, __LINE__);
+        spatial_index_delete(index);
         return -1;
     }
-    for (i = 0; i < info->num_criteria; i++)
+    index->candidate = malloc(num_samples * sizeof(long));
+    if (index->candidate == NULL)
     {
-        info->collocation_result->difference_variable_name[i] = NULL;
-        info->collocation_result->difference_unit[i] = NULL;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_samples * sizeof(long), __FILE__, __LINE__);
+        spatial_index_delete(index);
+        return -1;
     }
-    for (i = 0; i < info->num_criteria; i++)
+
+    /* determine the bounding cap of each sample */
+    for (i = 0; i < num_samples; i++)
     {
-        if (i == info->point_distance_index)
+        int is_valid;
+
+        if (use_area)
         {
-            info->collocation_result->difference_variable_name[i] = strdup(info->criterium[i]->variable_name);
-            if (info->collocation_result->difference_variable_name[i] == NULL)
+            long num_vertices = cache->latitude_bounds->dimension[1];
+
+            is_valid = bounding_cap_from_area(num_vertices, &cache->latitude_bounds->data.double_data[i * num_vertices],
+                                              &cache->longitude_bounds->data.double_data[i * num_vertices],
+                                              &index->centre[3 * i], &index->radius[i]);
+            if (is_valid && index->radius[i] > index->max_radius)
             {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                               __LINE__);
-                return -1;
+                index->max_radius = index->radius[i];
             }
         }
         else
         {
-            info->collocation_result->difference_variable_name[i] =
-                malloc(strlen(info->criterium[i]->variable_name) + 9);
-            if (info->collocation_result->difference_variable_name == NULL)
+            is_valid = unit_vector_from_point(cache->latitude->data.double_data[i],
+                                              cache->longitude->data.double_data[i], &index->centre[3 * i]);
+            if (!is_valid)
             {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (long)(strlen(info->criterium[i]->variable_name) + 9), __FILE__, __LINE__);
-                return -1;
+                /* this makes the point distance for this sample NaN */
+                index->centre[3 * i] = harp_nan();
+                index->centre[3 * i + 1] = harp_nan();
+                index->centre[3 * i + 2] = harp_nan();
             }
-            strcpy(info->collocation_result->difference_variable_name[i], info->criterium[i]->variable_name);
-            strcat(info->collocation_result->difference_variable_name[i], "_absdiff");
         }
-        /* we only populate the unit if we already have it, we will update this information during matchup */
-        if (info->criterium[i]->unit != NULL)
+        if (is_valid)
         {
-            info->collocation_result->difference_unit[i] = strdup(info->criterium[i]->unit);
-            if (info->collocation_result->difference_unit[i] == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                               __LINE__);
-                return -1;
-            }
+            index->entry[index->num_entries].index = i;
+            index->num_entries++;
+        }
+        else
+        {
+            index->unindexed[index->num_unindexed] = i;
+            index->num_unindexed++;
         }
     }
 
-    /* initialize the arrays to hold the references to the variables for evaluating the criteria */
-    info->variables_a.criterium = malloc(info->num_criteria * sizeof(harp_variable *));
-    if (info->variables_a.criterium == NULL)
+    /* a latitude/longitude grid does not need the 3D cells */
+    switch (spatial_index_detect_grid(index))
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (info->num_criteria) * sizeof(harp_variable *), __FILE__, __LINE__);
-        return -1;
+        case -1:
+            spatial_index_delete(index);
+            return -1;
+        case 1:
+            *new_index = index;
+            return 0;
+        default:
+            break;
     }
-    info->variables_b.criterium = malloc(info->num_criteria * sizeof(harp_variable *));
-    if (info->variables_b.criterium == NULL)
+
+    /* size the cells such that a typical search only needs to look at the direct neighbourhood of a cell */
+    switch (info->spatial_index_type)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (info->num_criteria) * sizeof(harp_variable *), __FILE__, __LINE__);
-        return -1;
+        case spatial_index_point_to_point:
+            index->cell_size = 2 * sin((info->spatial_index_radius + SPATIAL_INDEX_MARGIN) / 2);
+            break;
+        case spatial_index_area_to_area:
+            index->cell_size = 2 * sin(index->max_radius);
+            break;
+        case spatial_index_point_to_area:
+            index->cell_size = 2 * sin(index->max_radius / 2);
+            break;
+        default:
+            index->cell_size = 2 * sin(SPATIAL_INDEX_DEFAULT_RADIUS / 2);
+            break;
     }
-    for (i = 0; i < info->num_criteria; i++)
+    if (!(index->cell_size >= SPATIAL_INDEX_MIN_CELL_SIZE))
+    {
+        index->cell_size = SPATIAL_INDEX_MIN_CELL_SIZE;
+    }
+    if (index->cell_size > 2.0)
     {
-        info->variables_a.criterium[i] = NULL;
-        info->variables_b.criterium[i] = NULL;
+        index->cell_size = 2.0;
     }
+    index->num_cells = (long)ceil(2.0 / index->cell_size) + 1;
 
-    /* initialize array in which the differences are stored */
-    info->difference = malloc(info->num_criteria * sizeof(double));
-    if (info->difference == NULL)
+    for (i = 0; i < index->num_entries; i++)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (info->num_criteria) * sizeof(double), __FILE__, __LINE__);
-        return -1;
+        double *centre = &index->centre[3 * index->entry[i].index];
+
+        index->entry[i].cell = ((int64_t)spatial_index_get_cell_coordinate(index, centre[0]) * index->num_cells +
+                                spatial_index_get_cell_coordinate(index, centre[1])) * index->num_cells +
+            spatial_index_get_cell_coordinate(index, centre[2]);
     }
+    qsort(index->entry, index->num_entries, sizeof(spatial_index_entry), compare_spatial_index_entry);
+
+    *new_index = index;
 
     return 0;
 }
 
-static int perform_matchup_on_measurements(collocation_info *info, long index_a, long product_b_index, long index_b)
+static void spatial_index_add_candidate_if_near(spatial_index *index, const spatial_index_entry *entry,
+                                                const double *centre, double radius, double min_cosdist)
 {
-    double *longitude_bounds_a;
-    double *latitude_bounds_a;
-    double *longitude_bounds_b;
-    double *latitude_bounds_b;
-    double latitude_a;
-    double longitude_a;
-    double latitude_b;
-    double longitude_b;
-    long collocation_index;
-    int num_vertices_a;
-    int num_vertices_b;
-    int i;
+    double *entry_centre = &index->centre[3 * entry->index];
+    double cosdist = centre[0] * entry_centre[0] + centre[1] * entry_centre[1] + centre[2] * entry_centre[2];
 
-    for (i = 0; i < info->num_criteria; i++)
+    if (index->radius != NULL)
     {
-        if (i == info->point_distance_index)
-        {
-            latitude_a = info->variables_a.latitude->data.double_data[index_a];
-            longitude_a = info->variables_a.longitude->data.double_data[index_a];
-            latitude_b = info->variables_b.latitude->data.double_data[index_b];
-            longitude_b = info->variables_b.longitude->data.double_data[index_b];
+        double distance = radius + index->radius[entry->index] + SPATIAL_INDEX_MARGIN;
 
-            if (harp_geometry_get_point_distance(latitude_a, longitude_a, latitude_b, longitude_b, &info->difference[i])
-                != 0)
-            {
-                return -1;
-            }
-            info->difference[i] *= info->point_distance_conversion_factor;
-        }
-        else
+        min_cosdist = distance < CONST_PI ? cos(distance) : -1.0;
+    }
+    if (cosdist >= min_cosdist)
+    {
+        index->candidate[index->num_candidates] = entry->index;
+        index->num_candidates++;
+    }
+}
+
+/* get the first grid row of which the latitude is beyond 'latitude' (strict = 1) or not before 'latitude' (strict = 0),
+ * in the direction in which the row latitudes change
+ */
+static long spatial_index_find_grid_row(const spatial_index *index, double latitude, int strict)
+{
+    double direction = 1.0;
+    long lower = 0;
+    long upper = index->num_grid_rows;
+
+    if (index->num_grid_rows > 1 && index->grid_row_latitude[1] < index->grid_row_latitude[0])
+    {
+        direction = -1.0;
+    }
+    while (lower < upper)
+    {
+        long middle = lower + (upper - lower) / 2;
+        double difference = direction * (index->grid_row_latitude[middle] - latitude);
+
+        if (difference < 0 || (strict && difference == 0))
         {
-            info->difference[i] = fabs(info->variables_a.criterium[i]->data.double_data[index_a] -
-                                       info->variables_b.criterium[i]->data.double_data[index_b]);
-            if (i == info->datetime_index)
-            {
-                info->difference[i] *= info->datetime_conversion_factor;
-            }
+            lower = middle + 1;
         }
-        if (info->criterium[i]->use_modulo)
+        else
         {
-            while (info->difference[i] > info->criterium[i]->modulo_value)
-            {
-                info->difference[i] -= info->criterium[i]->modulo_value;
-            }
-            if (info->difference[i] > info->criterium[i]->modulo_value / 2)
-            {
-                info->difference[i] = info->criterium[i]->modulo_value - info->difference[i];
-            }
+            upper = middle;
         }
-        /* we use !(x<=y) instead of x>y so a NaN value for the difference will also result in a mismatch */
-        if (!(info->difference[i] <= info->criterium[i]->value))
+    }
+
+    return lower;
+}
+
+/* Find all grid samples of which the centre lies within 'search_radius' [rad] of the given centre.
+ * The rows are found with a binary search on the row latitudes and the columns follow from the longitude range that
+ * the search area covers, such that only the samples within (a lat/lon box around) the search area are visited.
+ */
+static void spatial_index_query_grid(spatial_index *index, const double *centre, double search_radius)
+{
+    double min_column[3], max_column[3];
+    double latitude, longitude;
+    double delta_latitude;
+    int num_ranges = 0;
+    long first_row, end_row;
+    long block, row, column;
+    int k;
+
+    point_from_unit_vector(centre, &latitude, &longitude);
+    delta_latitude = search_radius / CONST_DEG2RAD + SPATIAL_INDEX_GRID_TOLERANCE;
+    if (index->num_grid_rows > 1 && index->grid_row_latitude[1] < index->grid_row_latitude[0])
+    {
+        first_row = spatial_index_find_grid_row(index, latitude + delta_latitude, 0);
+        end_row = spatial_index_find_grid_row(index, latitude - delta_latitude, 1);
+    }
+    else
+    {
+        first_row = spatial_index_find_grid_row(index, latitude - delta_latitude, 0);
+        end_row = spatial_index_find_grid_row(index, latitude + delta_latitude, 1);
+    }
+
+    if (fabs(latitude) + delta_latitude >= 90.0)
+    {
+        /* the search area contains a pole */
+        min_column[0] = 0;
+        max_column[0] = index->num_grid_columns - 1;
+        num_ranges = 1;
+    }
+    else
+    {
+        double period = 360.0 / fabs(index->grid_longitude_step);
+        double ratio = sin(search_radius) / cos(latitude * CONST_DEG2RAD);
+        double delta_longitude;
+        double lower, upper;
+
+        delta_longitude = (ratio < 1.0 ? asin(ratio) / CONST_DEG2RAD : 180.0) + SPATIAL_INDEX_GRID_TOLERANCE;
+        longitude = wrap_longitude_difference(longitude - index->grid_longitude);
+        lower = (longitude - delta_longitude) / index->grid_longitude_step;
+        upper = (longitude + delta_longitude) / index->grid_longitude_step;
+        if (lower > upper)
+        {
+            double swap = lower;
+
+            lower = upper;
+            upper = swap;
+        }
+        if (upper - lower >= period)
+        {
+            min_column[0] = 0;
+            max_column[0] = index->num_grid_columns - 1;
+            num_ranges = 1;
+        }
+        else
+        {
+            /* the column range can wrap around; the shifted ranges are in increasing column order */
+            for (k = -1; k <= 1; k++)
+            {
+                min_column[num_ranges] = ceil(lower + k * period);
+                max_column[num_ranges] = floor(upper + k * period);
+                if (min_column[num_ranges] < 0)
+                {
+                    min_column[num_ranges] = 0;
+                }
+                if (max_column[num_ranges] > index->num_grid_columns - 1)
+                {
+                    max_column[num_ranges] = index->num_grid_columns - 1;
+                }
+                if (min_column[num_ranges] <= max_column[num_ranges])
+                {
+                    num_ranges++;
+                }
+            }
+        }
+    }
+
+    index->num_candidates = 0;
+    for (block = 0; block < index->num_grid_blocks; block++)
+    {
+        for (row = first_row; row < end_row; row++)
+        {
+            long offset = (block * index->num_grid_rows + row) * index->num_grid_columns;
+
+            for (k = 0; k < num_ranges; k++)
+            {
+                for (column = (long)min_column[k]; column <= (long)max_column[k]; column++)
+                {
+                    index->candidate[index->num_candidates] = offset + column;
+                    index->num_candidates++;
+                }
+            }
+        }
+    }
+}
+
+/* Find all samples of which the bounding cap may lie within 'radius' [rad] of the given centre.
+ * The resulting candidates (sorted by sample index) are stored in index->candidate.
+ * If the centre is NULL or the radius is not finite then all samples will be returned.
+ */
+static void spatial_index_query(spatial_index *index, const double *centre, double radius)
+{
+    long min_coordinate[3], max_coordinate[3];
+    double search_radius;
+    double min_cosdist;
+    double chord;
+    double num_cells;
+    long i;
+    int k;
+
+    index->num_candidates = 0;
+
+    search_radius = radius + index->max_radius + SPATIAL_INDEX_MARGIN;
+    if (centre == NULL || !(search_radius < CONST_PI))
+    {
+        for (i = 0; i < index->num_samples; i++)
+        {
+            index->candidate[i] = i;
+        }
+        index->num_candidates = index->num_samples;
+        return;
+    }
+    if (index->num_grid_columns > 0)
+    {
+        spatial_index_query_grid(index, centre, search_radius);
+        return;
+    }
+    min_cosdist = cos(radius + SPATIAL_INDEX_MARGIN);
+
+    /* determine the range of cells that cover the search area */
+    chord = 2 * sin(search_radius / 2);
+    num_cells = 1;
+    for (k = 0; k < 3; k++)
+    {
+        min_coordinate[k] = spatial_index_get_cell_coordinate(index, centre[k] - chord - SPATIAL_INDEX_MARGIN);
+        max_coordinate[k] = spatial_index_get_cell_coordinate(index, centre[k] + chord + SPATIAL_INDEX_MARGIN);
+        num_cells *= max_coordinate[k] - min_coordinate[k] + 1;
+    }
+
+    if (num_cells > index->num_entries)
+    {
+        /* a scan over all entries is cheaper than looking up each cell */
+        for (i = 0; i < index->num_entries; i++)
+        {
+            spatial_index_add_candidate_if_near(index, &index->entry[i], centre, radius, min_cosdist);
+        }
+    }
+    else
+    {
+        long x, y, z;
+
+        for (x = min_coordinate[0]; x <= max_coordinate[0]; x++)
+        {
+            for (y = min_coordinate[1]; y <= max_coordinate[1]; y++)
+            {
+                for (z = min_coordinate[2]; z <= max_coordinate[2]; z++)
+                {
+                    int64_t cell = ((int64_t)x * index->num_cells + y) * index->num_cells + z;
+                    long lower = 0;
+                    long upper = index->num_entries;
+
+                    /* find the first entry for this cell */
+                    while (lower < upper)
+                    {
+                        long middle = lower + (upper - lower) / 2;
+
+                        if (index->entry[middle].cell < cell)
+                        {
+                            lower = middle + 1;
+                        }
+                        else
+                        {
+                            upper = middle;
+                        }
+                    }
+                    for (i = lower; i < index->num_entries && index->entry[i].cell == cell; i++)
+                    {
+                        spatial_index_add_candidate_if_near(index, &index->entry[i], centre, radius, min_cosdist);
+                    }
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < index->num_unindexed; i++)
+    {
+        index->candidate[index->num_candidates] = index->unindexed[i];
+        index->num_candidates++;
+    }
+
+    /* keep the original evaluation order of the samples such that the collocation result does not change */
+    qsort(index->candidate, index->num_candidates, sizeof(long), compare_long);
+}
+
+static int compare_datetime_index_entry(const void *a, const void *b)
+{
+    datetime_index_entry *entry_a = (datetime_index_entry *)a;
+    datetime_index_entry *entry_b = (datetime_index_entry *)b;
+
+    if (entry_a->datetime < entry_b->datetime)
+    {
+        return -1;
+    }
+
+    if (entry_a->datetime > entry_b->datetime)
+    {
+        return 1;
+    }
+
+    if (entry_a->index < entry_b->index)
+    {
+        return -1;
+    }
+
+    if (entry_a->index > entry_b->index)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+static void datetime_index_delete(datetime_index *index)
+{
+    if (index != NULL)
+    {
+        if (index->entry != NULL)
+        {
+            free(index->entry);
+        }
+        if (index->candidate != NULL)
+        {
+            free(index->candidate);
+        }
+        free(index);
+    }
+}
+
+/* create a datetime index for the samples of product B using its datetime criterium variable */
+static int datetime_index_new(const harp_variable *datetime, datetime_index **new_index)
+{
+    datetime_index *index;
+    long i;
+
+    index = (datetime_index *)malloc(sizeof(datetime_index));
+    if (index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(datetime_index), __FILE__, __LINE__);
+        return -1;
+    }
+    index->num_entries = 0;
+    index->entry = NULL;
+    index->last_datetime = harp_nan();
+    index->lower = 0;
+    index->upper = 0;
+    index->num_candidates = 0;
+    index->candidate = NULL;
+
+    if (datetime->num_elements == 0)
+    {
+        *new_index = index;
+        return 0;
+    }
+
+    index->entry = malloc(datetime->num_elements * sizeof(datetime_index_entry));
+    if (index->entry == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       datetime->num_elements * sizeof(datetime_index_entry), __FILE__, __LINE__);
+        datetime_index_delete(index);
+        return -1;
+    }
+    index->candidate = malloc(datetime->num_elements * sizeof(long));
+    if (index->candidate == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       datetime->num_elements * sizeof(long), __FILE__, __LINE__);
+        datetime_index_delete(index);
+        return -1;
+    }
+
+    for (i = 0; i < datetime->num_elements; i++)
+    {
+        if (!harp_isnan(datetime->data.double_data[i]))
+        {
+            index->entry[index->num_entries].datetime = datetime->data.double_data[i];
+            index->entry[index->num_entries].index = i;
+            index->num_entries++;
+        }
+    }
+    qsort(index->entry, index->num_entries, sizeof(datetime_index_entry), compare_datetime_index_entry);
+
+    *new_index = index;
+
+    return 0;
+}
+
+/* find the first entry for which entry->datetime >= value (or entry->datetime > value if 'inclusive' is not set) */
+static long datetime_index_find(const datetime_index *index, double value, int inclusive)
+{
+    long lower = 0;
+    long upper = index->num_entries;
+
+    while (lower < upper)
+    {
+        long middle = lower + (upper - lower) / 2;
+
+        if (index->entry[middle].datetime < value || (!inclusive && index->entry[middle].datetime == value))
+        {
+            lower = middle + 1;
+        }
+        else
+        {
+            upper = middle;
+        }
+    }
+
+    return lower;
+}
+
+/* Update the window of the index to all samples with a datetime within [datetime - delta, datetime + delta].
+ * For increasing datetime values the window is moved forward, otherwise it is searched for from scratch.
+ * Returns the number of samples in the window.
+ */
+static long datetime_index_query(datetime_index *index, double datetime, double delta)
+{
+    double datetime_min = datetime - delta;
+    double datetime_max = datetime + delta;
+
+    if (harp_isnan(datetime))
+    {
+        index->lower = 0;
+        index->upper = 0;
+        return 0;
+    }
+
+    if (datetime >= index->last_datetime)
+    {
+        while (index->lower < index->num_entries && index->entry[index->lower].datetime < datetime_min)
+        {
+            index->lower++;
+        }
+        if (index->upper < index->lower)
+        {
+            index->upper = index->lower;
+        }
+        while (index->upper < index->num_entries && index->entry[index->upper].datetime <= datetime_max)
+        {
+            index->upper++;
+        }
+    }
+    else
+    {
+        index->lower = datetime_index_find(index, datetime_min, 1);
+        index->upper = datetime_index_find(index, datetime_max, 0);
+        if (index->upper < index->lower)
+        {
+            index->upper = index->lower;
+        }
+    }
+    index->last_datetime = datetime;
+
+    return index->upper - index->lower;
+}
+
+/* store the samples of the current window in index->candidate (sorted by sample index) */
+static void datetime_index_get_candidates(datetime_index *index)
+{
+    long i;
+
+    index->num_candidates = 0;
+    for (i = index->lower; i < index->upper; i++)
+    {
+        index->candidate[index->num_candidates] = index->entry[i].index;
+        index->num_candidates++;
+    }
+
+    /* keep the original evaluation order of the samples such that the collocation result does not change */
+    qsort(index->candidate, index->num_candidates, sizeof(long), compare_long);
+}
+
+static void nearest_neighbour_heaps_delete(nearest_neighbour_heaps *heaps)
+{
+    if (heaps->num_entries != NULL)
+    {
+        free(heaps->num_entries);
+    }
+    if (heaps->entry != NULL)
+    {
+        free(heaps->entry);
+    }
+    free(heaps);
+}
+
+static void collocation_info_delete(collocation_info *info)
+{
+    int i;
+
+    if (info != NULL)
+    {
+        if (info->criterium != NULL)
+        {
+            for (i = 0; i < info->num_criteria; i++)
+            {
+                if (info->criterium[i] != NULL)
+                {
+                    collocation_criterium_delete(info->criterium[i]);
+                }
+            }
+            free(info->criterium);
+        }
+        if (info->nearest_neighbour_x_variable_name != NULL)
+        {
+            free(info->nearest_neighbour_x_variable_name);
+        }
+        if (info->nearest_neighbour_y_variable_name != NULL)
+        {
+            free(info->nearest_neighbour_y_variable_name);
+        }
+        if (info->collocation_result != NULL)
+        {
+            harp_collocation_result_delete(info->collocation_result);
+        }
+        if (info->previous_result != NULL)
+        {
+            harp_collocation_result_delete(info->previous_result);
+        }
+        if (info->nearest_neighbour_heaps != NULL)
+        {
+            long j;
+
+            for (j = 0; j < info->num_nearest_neighbour_heaps; j++)
+            {
+                if (info->nearest_neighbour_heaps[j] != NULL)
+                {
+                    nearest_neighbour_heaps_delete(info->nearest_neighbour_heaps[j]);
+                }
+            }
+            free(info->nearest_neighbour_heaps);
+        }
+        if (info->sorted_index_a != NULL)
+        {
+            free(info->sorted_index_a);
+        }
+        if (info->sorted_index_b != NULL)
+        {
+            free(info->sorted_index_b);
+        }
+        if (info->dataset_a != NULL)
+        {
+            harp_dataset_delete(info->dataset_a);
+        }
+        if (info->dataset_b != NULL)
+        {
+            harp_dataset_delete(info->dataset_b);
+        }
+        if (info->is_new_product_a != NULL)
+        {
+            free(info->is_new_product_a);
+        }
+        if (info->is_new_product_b != NULL)
+        {
+            free(info->is_new_product_b);
+        }
+        free(info);
+    }
+}
+
+static int collocation_info_new(collocation_info **new_info)
+{
+    collocation_info *info = NULL;
+
+    info = (collocation_info *)malloc(sizeof(collocation_info));
+    if (info == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(collocation_info), __FILE__, __LINE__);
+        return -1;
+    }
+
+    info->num_criteria = 0;
+    info->criterium = NULL;
+    info->datetime_index = -1;
+    info->datetime_conversion_factor = 1;
+    info->point_distance_index = -1;
+    info->point_distance_conversion_factor = 1;
+    info->filter_area_intersects = 0;
+    info->filter_point_in_area_xy = 0;
+    info->filter_point_in_area_yx = 0;
+    info->spatial_index_type = spatial_index_none;
+    info->spatial_index_radius = 0;
+    info->point_distance_per_radian = 0;
+    info->point_distance_wgs84 = 0;
+    info->ingest_options_a = NULL;
+    info->ingest_options_b = NULL;
+    info->operations_a = NULL;
+    info->operations_b = NULL;
+    info->perform_nearest_neighbour_x_first = 0;
+    info->nearest_neighbour_x_variable_name = NULL;
+    info->nearest_neighbour_x_criterium_index = -1;
+    info->nearest_neighbour_y_variable_name = NULL;
+    info->nearest_neighbour_y_criterium_index = -1;
+    info->num_nearest_neighbours = 1;
+    info->num_threads = 1;
+    info->shard_index = 0;
+    info->num_shards = 1;
+    info->max_cache_size_b = 0;
+    info->verbose = 0;
+    info->binary_output = 0;
+    info->stream_filename = NULL;
+    info->stream_started = 0;
+    info->collocation_result = NULL;
+    info->previous_result = NULL;
+    info->num_nearest_neighbour_heaps = 0;
+    info->nearest_neighbour_heaps = NULL;
+    info->nearest_neighbour_sequence_number = 0;
+    info->num_removed_pairs = 0;
+    info->sorted_index_a = NULL;
+    info->sorted_index_b = NULL;
+    info->dataset_a = NULL;
+    info->dataset_b = NULL;
+    info->is_new_product_a = NULL;
+    info->is_new_product_b = NULL;
+    info->cache_b_num_hits = 0;
+    info->cache_b_num_misses = 0;
+    info->cache_b_num_evictions = 0;
+    info->cache_b_num_reingested = 0;
+    info->cache_b_peak_size = 0;
+    info->num_pairs_pruned = 0;
+
+    if (harp_dataset_new(&info->dataset_a) != 0)
+    {
+        collocation_info_delete(info);
+        return -1;
+    }
+    if (harp_dataset_new(&info->dataset_b) != 0)
+    {
+        collocation_info_delete(info);
+        return -1;
+    }
+    if (harp_collocation_result_new(&info->collocation_result, 0, NULL, NULL) != 0)
+    {
+        collocation_info_delete(info);
+        return -1;
+    }
+
+    *new_info = info;
+
+    return 0;
+}
+
+static int collocation_info_add_criterium(collocation_info *info, int variable_name_length, const char *variable_name,
+                                          double value, int unit_length, const char *unit)
+{
+    collocation_criterium **new_criterium;
+    collocation_criterium *criterium;
+    int i;
+
+    new_criterium = realloc(info->criterium, (info->num_criteria + 1) * sizeof(collocation_criterium *));
+    if (new_criterium == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->num_criteria + 1) * sizeof(collocation_criterium *), __FILE__, __LINE__);
+        return -1;
+    }
+    info->criterium = new_criterium;
+
+    if (collocation_criterium_new(variable_name_length, variable_name, value, unit_length, unit, &criterium) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (strcmp(info->criterium[i]->variable_name, criterium->variable_name) == 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "cannot provide more than one criterium for variable '%s'",
+                           criterium->variable_name);
+            collocation_criterium_delete(criterium);
+            return -1;
+        }
+    }
+    info->criterium[info->num_criteria] = criterium;
+    info->num_criteria++;
+
+    return 0;
+}
+
+static int collocation_info_add_criterium_from_string(collocation_info *info, char *argument)
+{
+    char *cursor;
+    char *variable_name;
+    char *value_str;
+    char *unit = NULL;
+    double value;
+    int variable_name_length;
+    int unit_length = 0;
+
+    cursor = argument;
+    while (*cursor == ' ')
+    {
+        cursor++;
+    }
+    variable_name = cursor;
+    while (*cursor != ' ' && *cursor != '\0')
+    {
+        cursor++;
+    }
+    variable_name_length = (int)(cursor - variable_name);
+    if (variable_name_length == 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid criterium '%s'", argument);
+        return -1;
+    }
+
+    while (*cursor == ' ')
+    {
+        cursor++;
+    }
+    value_str = cursor;
+    value = strtod(value_str, &cursor);
+    if (cursor == value_str)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "missing value in criterium '%s'", argument);
+        return -1;
+    }
+
+    while (*cursor == ' ')
+    {
+        cursor++;
+    }
+    if (*cursor != '\0')
+    {
+        if (*cursor != '[')
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid unit in criterium '%s' (expected '[')", argument);
+            return -1;
+        }
+        cursor++;
+        unit = cursor;
+        while (*cursor != ']' && *cursor != '\0')
+        {
+            cursor++;
+        }
+        unit_length = (int)(cursor - unit);
+        if (unit_length == 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid unit in criterium '%s'", argument);
+            return -1;
+        }
+        if (*cursor != ']')
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid unit in criterium '%s' (expected ']')", argument);
+            return -1;
+        }
+        cursor++;
+        while (*cursor == ' ')
+        {
+            cursor++;
+        }
+        if (*cursor != '\0')
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid criterium '%s'", argument);
+            return -1;
+        }
+    }
+
+    return collocation_info_add_criterium(info, variable_name_length, variable_name, value, unit_length, unit);
+}
+
+/* continue from the previous collocation result: the existing pairs are kept and only products that are not yet
+ * part of the previous result need to be matched against all other products
+ */
+static int collocation_info_use_previous_result(collocation_info *info)
+{
+    harp_collocation_result *previous_result = info->previous_result;
+    long i;
+
+    if (previous_result->num_differences != info->num_criteria)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "number of differences in existing collocation result (%d) does "
+                       "not match number of collocation criteria (%d)", previous_result->num_differences,
+                       info->num_criteria);
+        return -1;
+    }
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (strcmp(previous_result->difference_variable_name[i],
+                   info->collocation_result->difference_variable_name[i]) != 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "difference '%s' in existing collocation result does not "
+                           "match collocation criterium '%s'", previous_result->difference_variable_name[i],
+                           info->collocation_result->difference_variable_name[i]);
+            return -1;
+        }
+        if (previous_result->difference_unit[i] == NULL)
+        {
+            continue;
+        }
+        if (info->criterium[i]->unit == NULL)
+        {
+            /* take the unit from the existing result instead of from the first product of dataset A */
+            if (collocation_criterium_set_unit(info->criterium[i], previous_result->difference_unit[i]) != 0)
+            {
+                return -1;
+            }
+        }
+        else if (strcmp(previous_result->difference_unit[i], info->criterium[i]->unit) != 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "unit '%s' of difference '%s' in existing collocation result "
+                           "does not match unit '%s' of collocation criterium", previous_result->difference_unit[i],
+                           previous_result->difference_variable_name[i], info->criterium[i]->unit);
+            return -1;
+        }
+    }
+
+    /* new pairs are appended after the existing ones using a continued collocation_index numbering */
+    if (harp_collocation_result_sort_by_collocation_index(previous_result) != 0)
+    {
+        return -1;
+    }
+
+    info->is_new_product_a = malloc((info->dataset_a->num_products + 1) * sizeof(uint8_t));
+    if (info->is_new_product_a == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->dataset_a->num_products + 1) * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->dataset_a->num_products; i++)
+    {
+        info->is_new_product_a[i] = !harp_dataset_has_product(previous_result->dataset_a,
+                                                              info->dataset_a->metadata[i]->source_product);
+    }
+    info->is_new_product_b = malloc((info->dataset_b->num_products + 1) * sizeof(uint8_t));
+    if (info->is_new_product_b == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->dataset_b->num_products + 1) * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->dataset_b->num_products; i++)
+    {
+        info->is_new_product_b[i] = !harp_dataset_has_product(previous_result->dataset_b,
+                                                              info->dataset_b->metadata[i]->source_product);
+    }
+
+    /* the previous result (with the difference names and units) becomes the result that is extended */
+    harp_collocation_result_delete(info->collocation_result);
+    info->collocation_result = previous_result;
+    info->previous_result = NULL;
+
+    return 0;
+}
+
+static int collocation_info_update(collocation_info *info)
+{
+    int i, j;
+
+    /* add criteria for the nearest neighbour filters (if they were not there yet) */
+    if (info->nearest_neighbour_x_variable_name != NULL)
+    {
+        for (i = 0; i < info->num_criteria; i++)
+        {
+            if (strcmp(info->criterium[i]->variable_name, info->nearest_neighbour_x_variable_name) == 0)
+            {
+                info->nearest_neighbour_x_criterium_index = i;
+                break;
+            }
+        }
+        if (i == info->num_criteria)
+        {
+            if (collocation_info_add_criterium(info, (int)strlen(info->nearest_neighbour_x_variable_name),
+                                               info->nearest_neighbour_x_variable_name, harp_plusinf(), 0, NULL) != 0)
+            {
+                return -1;
+            }
+            info->nearest_neighbour_x_criterium_index = info->num_criteria - 1;
+        }
+    }
+
+    if (info->nearest_neighbour_y_variable_name != NULL)
+    {
+        for (i = 0; i < info->num_criteria; i++)
+        {
+            if (strcmp(info->criterium[i]->variable_name, info->nearest_neighbour_y_variable_name) == 0)
+            {
+                info->nearest_neighbour_y_criterium_index = i;
+                break;
+            }
+        }
+        if (i == info->num_criteria)
+        {
+            if (collocation_info_add_criterium(info, (int)strlen(info->nearest_neighbour_y_variable_name),
+                                               info->nearest_neighbour_y_variable_name, harp_plusinf(), 0, NULL) != 0)
+            {
+                return -1;
+            }
+            info->nearest_neighbour_y_criterium_index = info->num_criteria - 1;
+        }
+    }
+
+    /* if no criteria are set then all data is kept and no need to collocate */
+    if (info->num_criteria == 0 && !info->filter_area_intersects && !info->filter_point_in_area_xy &&
+        !info->filter_point_in_area_yx)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "no collocation criteria are set");
+        return -1;
+    }
+
+    /* properly order criteria and identify special treatment */
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (strcmp(info->criterium[i]->variable_name, "datetime") == 0)
+        {
+            /* make sure that datetime criterium is the first */
+            if (i != 0)
+            {
+                collocation_criterium *criterium;
+                int j;
+
+                /* put datetime criterium in the first position */
+                criterium = info->criterium[i];
+                for (j = i; j > 0; j--)
+                {
+                    info->criterium[j] = info->criterium[j - 1];
+                }
+                info->criterium[0] = criterium;
+            }
+            info->datetime_index = 0;
+            /* determine conversion factor between threshold unit and internal HARP unit */
+            if (harp_convert_unit(HARP_UNIT_TIME, info->criterium[info->datetime_index]->unit, 1,
+                                  &info->datetime_conversion_factor) != 0)
+            {
+                return -1;
+            }
+            break;
+        }
+    }
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (strcmp(info->criterium[i]->variable_name, "point_distance") == 0)
+        {
+            info->point_distance_index = i;
+            /* determine conversion factor between threshold unit and internal HARP unit */
+            if (harp_convert_unit(HARP_UNIT_LENGTH, info->criterium[info->point_distance_index]->unit, 1,
+                                  &info->point_distance_conversion_factor) != 0)
+            {
+                return -1;
+            }
+            break;
+        }
+    }
+
+    /* determine which spatial criterium can be used to index the samples of dataset B */
+    if (info->point_distance_index >= 0)
+    {
+        double distance_per_degree;
+
+        /* the sample distance check is performed on a sphere, so we can convert the distance to an angle */
+        if (harp_geometry_get_point_distance(0, 0, 0, 1, &distance_per_degree) != 0)
+        {
+            return -1;
+        }
+        info->point_distance_per_radian = distance_per_degree / CONST_DEG2RAD;
+        if (info->point_distance_wgs84)
+        {
+            /* on the ellipsoid the shortest distance per degree is along the meridian at the equator; the search
+             * radius is based on that distance (with a margin for the approximation error of the distance function) */
+            if (harp_geometry_get_point_distance_wgs84(0, 0, 1, 0, &distance_per_degree) != 0)
+            {
+                return -1;
+            }
+            distance_per_degree *= 0.999;
+        }
+        info->spatial_index_radius = info->criterium[info->point_distance_index]->value /
+            info->point_distance_conversion_factor / distance_per_degree * CONST_DEG2RAD;
+        if (harp_isfinite(info->spatial_index_radius))
+        {
+            info->spatial_index_type = spatial_index_point_to_point;
+        }
+    }
+    if (info->spatial_index_type == spatial_index_none)
+    {
+        if (info->filter_point_in_area_yx)
+        {
+            info->spatial_index_type = spatial_index_area_to_point;
+        }
+        else if (info->filter_area_intersects)
+        {
+            info->spatial_index_type = spatial_index_area_to_area;
+        }
+        else if (info->filter_point_in_area_xy)
+        {
+            info->spatial_index_type = spatial_index_point_to_area;
+        }
+    }
+
+    /* initialize sorted indices */
+    info->sorted_index_a = malloc(info->dataset_a->num_products * sizeof(long));
+    if (info->sorted_index_a == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->dataset_a->num_products * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->dataset_a->num_products; i++)
+    {
+        /* start with source_product ordering */
+        info->sorted_index_a[i] = info->dataset_a->sorted_index[i];
+
+        /* bubble down to make it sorted on datetime start/stop */
+        for (j = i; j > 0; j--)
+        {
+            harp_product_metadata *metadata = info->dataset_a->metadata[info->sorted_index_a[j]];
+            harp_product_metadata *metadata_prev = info->dataset_a->metadata[info->sorted_index_a[j - 1]];
+
+            if (metadata->datetime_start < metadata_prev->datetime_start ||
+                (metadata->datetime_start == metadata_prev->datetime_start &&
+                 metadata->datetime_stop < metadata_prev->datetime_stop))
+            {
+                long index = info->sorted_index_a[j - 1];
+
+                info->sorted_index_a[j - 1] = info->sorted_index_a[j];
+                info->sorted_index_a[j] = index;
+            }
+        }
+    }
+
+    info->sorted_index_b = malloc(info->dataset_b->num_products * sizeof(long));
+    if (info->sorted_index_b == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->dataset_b->num_products * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->dataset_b->num_products; i++)
+    {
+        info->sorted_index_b[i] = info->dataset_b->sorted_index[i];
+
+        for (j = i; j > 0; j--)
+        {
+            harp_product_metadata *metadata = info->dataset_b->metadata[info->sorted_index_b[j]];
+            harp_product_metadata *metadata_prev = info->dataset_b->metadata[info->sorted_index_b[j - 1]];
+
+            if (metadata->datetime_start < metadata_prev->datetime_start ||
+                (metadata->datetime_start == metadata_prev->datetime_start &&
+                 metadata->datetime_stop < metadata_prev->datetime_stop))
+            {
+                long index = info->sorted_index_b[j - 1];
+
+                info->sorted_index_b[j - 1] = info->sorted_index_b[j];
+                info->sorted_index_b[j] = index;
+            }
+        }
+    }
+
+    /* set the differences for the collocation result */
+    info->collocation_result->num_differences = info->num_criteria;
+    info->collocation_result->difference_variable_name = malloc((info->num_criteria + 1) * sizeof(char *));
+    if (info->collocation_result->difference_variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->num_criteria + 1) * sizeof(char *), __FILE__, __LINE__);
+        return -1;
+    }
+    info->collocation_result->difference_unit = malloc((info->num_criteria + 1) * sizeof(char *));
+    if (info->collocation_result->difference_unit == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->num_criteria + 1) * sizeof(char *), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        info->collocation_result->difference_variable_name[i] = NULL;
+        info->collocation_result->difference_unit[i] = NULL;
+    }
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (i == info->point_distance_index)
+        {
+            info->collocation_result->difference_variable_name[i] = strdup(info->criterium[i]->variable_name);
+            if (info->collocation_result->difference_variable_name[i] == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                               __LINE__);
+                return -1;
+            }
+        }
+        else
+        {
+            info->collocation_result->difference_variable_name[i] =
+                malloc(strlen(info->criterium[i]->variable_name) + 9);
+            if (info->collocation_result->difference_variable_name == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               (long)(strlen(info->criterium[i]->variable_name) + 9), __FILE__, __LINE__);
+                return -1;
+            }
+            strcpy(info->collocation_result->difference_variable_name[i], info->criterium[i]->variable_name);
+            strcat(info->collocation_result->difference_variable_name[i], "_absdiff");
+        }
+        /* we only populate the unit if we already have it, we will update this information during matchup */
+        if (info->criterium[i]->unit != NULL)
+        {
+            info->collocation_result->difference_unit[i] = strdup(info->criterium[i]->unit);
+            if (info->collocation_result->difference_unit[i] == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                               __LINE__);
+                return -1;
+            }
+        }
+    }
+
+    if (info->previous_result != NULL)
+    {
+        if (collocation_info_use_previous_result(info) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void cache_variables_done(cache_variables *cache)
+{
+    if (cache->latitude != NULL)
+    {
+        harp_variable_delete(cache->latitude);
+    }
+    if (cache->longitude != NULL)
+    {
+        harp_variable_delete(cache->longitude);
+    }
+    if (cache->latitude_bounds != NULL)
+    {
+        harp_variable_delete(cache->latitude_bounds);
+    }
+    if (cache->longitude_bounds != NULL)
+    {
+        harp_variable_delete(cache->longitude_bounds);
+    }
+    if (cache->area_cache != NULL)
+    {
+        harp_area_cache_delete(cache->area_cache);
+    }
+    if (cache->point != NULL)
+    {
+        free(cache->point);
+    }
+    if (cache->criterium != NULL)
+    {
+        free(cache->criterium);
+    }
+}
+
+static int cache_variables_init(cache_variables *cache, int num_criteria)
+{
+    int i;
+
+    /* initialize the array to hold the references to the variables for evaluating the criteria */
+    cache->criterium = malloc(num_criteria * sizeof(harp_variable *));
+    if (cache->criterium == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_criteria * sizeof(harp_variable *), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_criteria; i++)
+    {
+        cache->criterium[i] = NULL;
+    }
+
+    return 0;
+}
+
+static void matchup_state_delete(matchup_state *state)
+{
+    long i;
+
+    if (state != NULL)
+    {
+        if (state->product_a != NULL)
+        {
+            harp_product_delete(state->product_a);
+        }
+        if (state->product_b != NULL)
+        {
+            for (i = 0; i < state->num_products_b; i++)
+            {
+                if (state->product_b[i] != NULL)
+                {
+                    harp_product_delete(state->product_b[i]);
+                }
+            }
+            free(state->product_b);
+        }
+        if (state->product_b_size != NULL)
+        {
+            free(state->product_b_size);
+        }
+        if (state->product_b_last_use != NULL)
+        {
+            free(state->product_b_last_use);
+        }
+        if (state->product_b_evicted != NULL)
+        {
+            free(state->product_b_evicted);
+        }
+        if (state->spatial_index_b != NULL)
+        {
+            for (i = 0; i < state->num_products_b; i++)
+            {
+                if (state->spatial_index_b[i] != NULL)
+                {
+                    spatial_index_delete(state->spatial_index_b[i]);
+                }
+            }
+            free(state->spatial_index_b);
+        }
+        if (state->datetime_index_b != NULL)
+        {
+            for (i = 0; i < state->num_products_b; i++)
+            {
+                if (state->datetime_index_b[i] != NULL)
+                {
+                    datetime_index_delete(state->datetime_index_b[i]);
+                }
+            }
+            free(state->datetime_index_b);
+        }
+        cache_variables_done(&state->variables_a);
+        cache_variables_done(&state->variables_b);
+        if (state->difference != NULL)
+        {
+            free(state->difference);
+        }
+        if (state->criterium_order != NULL)
+        {
+            free(state->criterium_order);
+        }
+        if (state->criterium_num_evaluated != NULL)
+        {
+            free(state->criterium_num_evaluated);
+        }
+        if (state->criterium_num_rejected != NULL)
+        {
+            free(state->criterium_num_rejected);
+        }
+        if (state->program_a != NULL)
+        {
+            harp_program_delete(state->program_a);
+        }
+        if (state->program_b != NULL)
+        {
+            harp_program_delete(state->program_b);
+        }
+        if (state->keep_program_a != NULL)
+        {
+            harp_program_delete(state->keep_program_a);
+        }
+        if (state->keep_program_b != NULL)
+        {
+            harp_program_delete(state->keep_program_b);
+        }
+        if (state->collocation_result != NULL)
+        {
+            harp_collocation_result_delete(state->collocation_result);
+        }
+        free(state);
+    }
+}
+
+/* determine whether the matchup needs the latitude/longitude and latitude/longitude bounds of the samples */
+static void get_latlon_requirements(collocation_info *info, int is_dataset_a, int *include_latlon,
+                                    int *include_latlon_bounds)
+{
+    if (is_dataset_a)
+    {
+        *include_latlon = info->point_distance_index >= 0 || info->filter_point_in_area_xy;
+        *include_latlon_bounds = info->filter_area_intersects || info->filter_point_in_area_yx;
+    }
+    else
+    {
+        *include_latlon = info->point_distance_index >= 0 || info->filter_point_in_area_yx;
+        *include_latlon_bounds = info->filter_area_intersects || info->filter_point_in_area_xy;
+    }
+}
+
+/* compile the operations for a dataset followed by a keep() of the variables that the matchup needs
+ * (*program is set to NULL if this is not possible)
+ */
+static int get_keep_program(collocation_info *info, int is_dataset_a, harp_program **program)
+{
+    const char *operations = is_dataset_a ? info->operations_a : info->operations_b;
+    int include_latlon_bounds;
+    int include_latlon;
+    char *keep_operations;
+    long operations_length = 0;
+    long length;
+    long i;
+
+    *program = NULL;
+    get_latlon_requirements(info, is_dataset_a, &include_latlon, &include_latlon_bounds);
+
+    if (operations != NULL)
+    {
+        /* strip trailing white space and operation separators */
+        operations_length = (long)strlen(operations);
+        while (operations_length > 0 && strchr("; \t\n", operations[operations_length - 1]) != NULL)
+        {
+            operations_length--;
+        }
+    }
+
+    /* '<operations>;keep(index,<criteria>,latitude,longitude,latitude_bounds,longitude_bounds)' */
+    length = operations_length + 80;
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        length += (long)strlen(info->criterium[i]->variable_name) + 1;
+    }
+    keep_operations = malloc(length);
+    if (keep_operations == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", length,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    keep_operations[0] = '\0';
+    if (operations_length > 0)
+    {
+        memcpy(keep_operations, operations, operations_length);
+        strcpy(&keep_operations[operations_length], ";");
+    }
+    strcat(keep_operations, "keep(index");
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (i != info->point_distance_index)
+        {
+            strcat(keep_operations, ",");
+            strcat(keep_operations, info->criterium[i]->variable_name);
+        }
+    }
+    if (include_latlon)
+    {
+        strcat(keep_operations, ",latitude,longitude");
+    }
+    if (include_latlon_bounds)
+    {
+        strcat(keep_operations, ",latitude_bounds,longitude_bounds");
+    }
+    strcat(keep_operations, ")");
+
+    if (harp_program_from_string(keep_operations, program) != 0)
+    {
+        /* just use the plain operations */
+        *program = NULL;
+    }
+    free(keep_operations);
+
+    return 0;
+}
+
+static int matchup_state_new(collocation_info *info, matchup_state **new_state)
+{
+    matchup_state *state;
+    long i;
+    int k;
+
+    state = (matchup_state *)malloc(sizeof(matchup_state));
+    if (state == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(matchup_state), __FILE__, __LINE__);
+        return -1;
+    }
+    state->num_products_b = info->dataset_b->num_products;
+    state->product_a = NULL;
+    state->product_b = NULL;
+    state->product_b_size = NULL;
+    state->product_b_last_use = NULL;
+    state->product_b_evicted = NULL;
+    state->cache_size_b = 0;
+    state->use_counter = 0;
+    state->cache_b_num_hits = 0;
+    state->cache_b_num_misses = 0;
+    state->cache_b_num_evictions = 0;
+    state->cache_b_num_reingested = 0;
+    state->cache_b_peak_size = 0;
+    state->num_pairs_pruned = 0;
+    state->spatial_index_b = NULL;
+    state->datetime_index_b = NULL;
+    state->variables_a.index = NULL;
+    state->variables_a.latitude = NULL;
+    state->variables_a.longitude = NULL;
+    state->variables_a.latitude_bounds = NULL;
+    state->variables_a.longitude_bounds = NULL;
+    state->variables_a.area_cache = NULL;
+    state->variables_a.point = NULL;
+    state->variables_a.criterium = NULL;
+    state->variables_b.index = NULL;
+    state->variables_b.latitude = NULL;
+    state->variables_b.longitude = NULL;
+    state->variables_b.latitude_bounds = NULL;
+    state->variables_b.longitude_bounds = NULL;
+    state->variables_b.area_cache = NULL;
+    state->variables_b.point = NULL;
+    state->variables_b.criterium = NULL;
+    state->difference = NULL;
+    state->criterium_order = NULL;
+    state->criterium_num_evaluated = NULL;
+    state->criterium_num_rejected = NULL;
+    state->num_pairs_until_reorder = CRITERIUM_REORDER_INTERVAL;
+    state->program_a = NULL;
+    state->program_b = NULL;
+    state->keep_program_a = NULL;
+    state->keep_program_b = NULL;
+    state->collocation_result = NULL;
+
+    state->product_b = malloc(state->num_products_b * sizeof(harp_product *));
+    if (state->product_b == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       state->num_products_b * sizeof(harp_product *), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    for (i = 0; i < state->num_products_b; i++)
+    {
+        state->product_b[i] = NULL;
+    }
+    state->product_b_size = malloc(state->num_products_b * sizeof(int64_t));
+    if (state->product_b_size == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       state->num_products_b * sizeof(int64_t), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    state->product_b_last_use = malloc(state->num_products_b * sizeof(long));
+    if (state->product_b_last_use == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       state->num_products_b * sizeof(long), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    state->product_b_evicted = malloc(state->num_products_b * sizeof(uint8_t));
+    if (state->product_b_evicted == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       state->num_products_b * sizeof(uint8_t), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    for (i = 0; i < state->num_products_b; i++)
+    {
+        state->product_b_size[i] = 0;
+        state->product_b_last_use[i] = 0;
+        state->product_b_evicted[i] = 0;
+    }
+    state->spatial_index_b = malloc(state->num_products_b * sizeof(spatial_index *));
+    if (state->spatial_index_b == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       state->num_products_b * sizeof(spatial_index *), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    for (i = 0; i < state->num_products_b; i++)
+    {
+        state->spatial_index_b[i] = NULL;
+    }
+    state->datetime_index_b = malloc(state->num_products_b * sizeof(datetime_index *));
+    if (state->datetime_index_b == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       state->num_products_b * sizeof(datetime_index *), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    for (i = 0; i < state->num_products_b; i++)
+    {
+        state->datetime_index_b[i] = NULL;
+    }
+
+    if (cache_variables_init(&state->variables_a, info->num_criteria) != 0)
+    {
+        matchup_state_delete(state);
+        return -1;
+    }
+    if (cache_variables_init(&state->variables_b, info->num_criteria) != 0)
+    {
+        matchup_state_delete(state);
+        return -1;
+    }
+
+    /* compile the operations once instead of for each imported product */
+    if (info->operations_a != NULL)
+    {
+        if (harp_program_from_string(info->operations_a, &state->program_a) != 0)
+        {
+            matchup_state_delete(state);
+            return -1;
+        }
+    }
+    if (info->operations_b != NULL)
+    {
+        if (harp_program_from_string(info->operations_b, &state->program_b) != 0)
+        {
+            matchup_state_delete(state);
+            return -1;
+        }
+    }
+    if (get_keep_program(info, 1, &state->keep_program_a) != 0)
+    {
+        matchup_state_delete(state);
+        return -1;
+    }
+    if (get_keep_program(info, 0, &state->keep_program_b) != 0)
+    {
+        matchup_state_delete(state);
+        return -1;
+    }
+
+    /* initialize array in which the differences are stored */
+    state->difference = malloc(info->num_criteria * sizeof(double));
+    if (state->difference == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->num_criteria) * sizeof(double), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+
+    /* initially evaluate the criteria in the order in which they were specified (with the point distance last) */
+    state->criterium_order = malloc(info->num_criteria * sizeof(int));
+    if (state->criterium_order == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->num_criteria) * sizeof(int), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    state->criterium_num_evaluated = malloc(info->num_criteria * sizeof(long));
+    if (state->criterium_num_evaluated == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->num_criteria) * sizeof(long), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    state->criterium_num_rejected = malloc(info->num_criteria * sizeof(long));
+    if (state->criterium_num_rejected == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (info->num_criteria) * sizeof(long), __FILE__, __LINE__);
+        matchup_state_delete(state);
+        return -1;
+    }
+    k = 0;
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (i != info->point_distance_index)
+        {
+            state->criterium_order[k] = i;
+            k++;
+        }
+        state->criterium_num_evaluated[i] = 0;
+        state->criterium_num_rejected[i] = 0;
+    }
+    if (info->point_distance_index >= 0)
+    {
+        state->criterium_order[k] = info->point_distance_index;
+    }
+
+    *new_state = state;
+
+    return 0;
+}
+
+static void matchup_state_remove_product_b(matchup_state *state, long index_b)
+{
+    if (state->product_b[index_b] != NULL)
+    {
+        harp_product_delete(state->product_b[index_b]);
+        state->product_b[index_b] = NULL;
+        state->cache_size_b -= state->product_b_size[index_b];
+        state->product_b_size[index_b] = 0;
+    }
+    if (state->spatial_index_b[index_b] != NULL)
+    {
+        spatial_index_delete(state->spatial_index_b[index_b]);
+        state->spatial_index_b[index_b] = NULL;
+    }
+    if (state->datetime_index_b[index_b] != NULL)
+    {
+        datetime_index_delete(state->datetime_index_b[index_b]);
+        state->datetime_index_b[index_b] = NULL;
+    }
+}
+
+/* remove the least recently used products of dataset B until 'size' additional bytes fit in the cache
+ * (product 'index_b' is never removed)
+ */
+static void matchup_state_reserve_cache_b(collocation_info *info, matchup_state *state, long index_b, int64_t size)
+{
+    while (state->cache_size_b + size > info->max_cache_size_b)
+    {
+        long lru_index = -1;
+        long i;
+
+        for (i = 0; i < state->num_products_b; i++)
+        {
+            if (i != index_b && state->product_b[i] != NULL &&
+                (lru_index < 0 || state->product_b_last_use[i] < state->product_b_last_use[lru_index]))
+            {
+                lru_index = i;
+            }
+        }
+        if (lru_index < 0)
+        {
+            /* nothing left to remove; a single product is allowed to exceed the limit */
+            return;
+        }
+        matchup_state_remove_product_b(state, lru_index);
+        state->product_b_evicted[lru_index] = 1;
+        state->cache_b_num_evictions++;
+    }
+}
+
+/* add the product cache statistics of a thread to the overall statistics */
+static void matchup_state_add_statistics(collocation_info *info, matchup_state *state)
+{
+    info->cache_b_num_hits += state->cache_b_num_hits;
+    info->cache_b_num_misses += state->cache_b_num_misses;
+    info->cache_b_num_evictions += state->cache_b_num_evictions;
+    info->cache_b_num_reingested += state->cache_b_num_reingested;
+    info->num_pairs_pruned += state->num_pairs_pruned;
+    if (state->cache_b_peak_size > info->cache_b_peak_size)
+    {
+        info->cache_b_peak_size = state->cache_b_peak_size;
+    }
+}
+
+/* get the heap with the nearest pairs for a sample (the heaps are created/extended when needed) */
+static int get_nearest_neighbour_heap(collocation_info *info, long product_index, long sample_index,
+                                      nearest_neighbour_entry **heap, long **num_entries)
+{
+    nearest_neighbour_heaps *heaps;
+    long k = info->num_nearest_neighbours;
+
+    if (product_index >= info->num_nearest_neighbour_heaps)
+    {
+        nearest_neighbour_heaps **new_heaps;
+        long num_heaps = 2 * info->num_nearest_neighbour_heaps;
+        long i;
+
+        if (num_heaps <= product_index)
+        {
+            num_heaps = product_index + 1;
+        }
+        new_heaps = realloc(info->nearest_neighbour_heaps, num_heaps * sizeof(nearest_neighbour_heaps *));
+        if (new_heaps == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_heaps * sizeof(nearest_neighbour_heaps *), __FILE__, __LINE__);
+            return -1;
+        }
+        for (i = info->num_nearest_neighbour_heaps; i < num_heaps; i++)
+        {
+            new_heaps[i] = NULL;
+        }
+        info->nearest_neighbour_heaps = new_heaps;
+        info->num_nearest_neighbour_heaps = num_heaps;
+    }
+    if (info->nearest_neighbour_heaps[product_index] == NULL)
+    {
+        heaps = malloc(sizeof(nearest_neighbour_heaps));
+        if (heaps == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(nearest_neighbour_heaps), __FILE__, __LINE__);
+            return -1;
+        }
+        heaps->num_samples = 0;
+        heaps->num_entries = NULL;
+        heaps->entry = NULL;
+        info->nearest_neighbour_heaps[product_index] = heaps;
+    }
+    heaps = info->nearest_neighbour_heaps[product_index];
+
+    if (sample_index >= heaps->num_samples)
+    {
+        nearest_neighbour_entry *new_entry;
+        long *new_num_entries;
+        long num_samples = heaps->num_samples == 0 ? 1024 : 2 * heaps->num_samples;
+        long i;
+
+        while (num_samples <= sample_index)
+        {
+            num_samples *= 2;
+        }
+        new_num_entries = realloc(heaps->num_entries, num_samples * sizeof(long));
+        if (new_num_entries == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_samples * sizeof(long), __FILE__, __LINE__);
+            return -1;
+        }
+        heaps->num_entries = new_num_entries;
+        new_entry = realloc(heaps->entry, num_samples * k * sizeof(nearest_neighbour_entry));
+        if (new_entry == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_samples * k * sizeof(nearest_neighbour_entry), __FILE__, __LINE__);
+            return -1;
+        }
+        heaps->entry = new_entry;
+        for (i = heaps->num_samples; i < num_samples; i++)
+        {
+            heaps->num_entries[i] = 0;
+        }
+        heaps->num_samples = num_samples;
+    }
+
+    *heap = &heaps->entry[sample_index * k];
+    *num_entries = &heaps->num_entries[sample_index];
+
+    return 0;
+}
+
+/* returns whether 'entry_a' should be dropped before 'entry_b' */
+static int nearest_neighbour_entry_is_farther(const nearest_neighbour_entry *entry_a,
+                                              const nearest_neighbour_entry *entry_b, int difference_index)
+{
+    if (entry_a->pair->difference[difference_index] != entry_b->pair->difference[difference_index])
+    {
+        return entry_a->pair->difference[difference_index] > entry_b->pair->difference[difference_index];
+    }
+    return entry_a->sequence_number > entry_b->sequence_number;
+}
+
+/* Apply the first nearest neighbour filter to a pair that is part of the collocation result.
+ * 'keep' is set to 0 if there are already k pairs for the same sample that are at least as near. If the new pair
+ * pushes the farthest pair out of the heap, that pair gets a negative collocation_index to mark it for removal.
+ */
+static int filter_nearest_neighbour(collocation_info *info, harp_collocation_pair *pair, int *keep)
+{
+    nearest_neighbour_entry *heap;
+    nearest_neighbour_entry entry;
+    long *num_entries;
+    int difference_index;
+    long i;
+
+    if (info->perform_nearest_neighbour_x_first)
+    {
+        /* select nearest x */
+        assert(info->nearest_neighbour_x_criterium_index >= 0);
+        difference_index = info->nearest_neighbour_x_criterium_index;
+        if (get_nearest_neighbour_heap(info, pair->product_index_a, pair->sample_index_a, &heap, &num_entries) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        /* select nearest y */
+        assert(info->nearest_neighbour_y_criterium_index >= 0);
+        difference_index = info->nearest_neighbour_y_criterium_index;
+        if (get_nearest_neighbour_heap(info, pair->product_index_b, pair->sample_index_b, &heap, &num_entries) != 0)
+        {
+            return -1;
+        }
+    }
+
+    entry.pair = pair;
+    entry.sequence_number = info->nearest_neighbour_sequence_number;
+    info->nearest_neighbour_sequence_number++;
+
+    if (*num_entries < info->num_nearest_neighbours)
+    {
+        /* the heap is not full yet -> sift up */
+        i = *num_entries;
+        while (i > 0 && nearest_neighbour_entry_is_farther(&entry, &heap[(i - 1) / 2], difference_index))
+        {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = entry;
+        (*num_entries)++;
+        *keep = 1;
+        return 0;
+    }
+
+    /* the new pair is the latest one, so it only replaces the farthest pair if it is strictly nearer */
+    if (!(pair->difference[difference_index] < heap[0].pair->difference[difference_index]))
+    {
+        *keep = 0;
+        return 0;
+    }
+    heap[0].pair->collocation_index = -1;
+    info->num_removed_pairs++;
+
+    /* replace the root -> sift down */
+    i = 0;
+    while (2 * i + 1 < *num_entries)
+    {
+        long child = 2 * i + 1;
+
+        if (child + 1 < *num_entries && nearest_neighbour_entry_is_farther(&heap[child + 1], &heap[child],
+                                                                           difference_index))
+        {
+            child++;
+        }
+        if (!nearest_neighbour_entry_is_farther(&heap[child], &entry, difference_index))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = entry;
+    *keep = 1;
+
+    return 0;
+}
+
+/* remove the pairs that were pushed out by the nearest neighbour filter from the collocation result */
+static int remove_pushed_out_pairs(collocation_info *info)
+{
+    uint8_t *mask;
+    long i;
+
+    if (info->num_removed_pairs == 0)
+    {
+        return 0;
+    }
+
+    mask = malloc(info->collocation_result->num_pairs * sizeof(uint8_t));
+    if (mask == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->collocation_result->num_pairs * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->collocation_result->num_pairs; i++)
+    {
+        mask[i] = info->collocation_result->pair[i]->collocation_index >= 0;
+    }
+    if (harp_collocation_result_filter(info->collocation_result, mask) != 0)
+    {
+        free(mask);
+        return -1;
+    }
+    free(mask);
+    info->num_removed_pairs = 0;
+
+    return 0;
+}
+
+/* Remove the pushed out pairs that directly precede the last 'num_skip' pairs of the collocation result.
+ * A new pair gets the collocation_index of the last remaining pair plus one. Removing pushed out pairs at the end right
+ * away (which only costs constant time per pair) keeps that numbering the same as if each pushed out pair was removed
+ * as soon as it got replaced.
+ */
+static int remove_trailing_pushed_out_pairs(collocation_info *info, long num_skip)
+{
+    harp_collocation_result *collocation_result = info->collocation_result;
+
+    while (collocation_result->num_pairs > num_skip &&
+           collocation_result->pair[collocation_result->num_pairs - num_skip - 1]->collocation_index < 0)
+    {
+        if (harp_collocation_result_remove_pair_at_index(collocation_result,
+                                                         collocation_result->num_pairs - num_skip - 1) != 0)
+        {
+            return -1;
+        }
+        info->num_removed_pairs--;
+    }
+
+    return 0;
+}
+
+/* initialize the nearest neighbour filtering with the pairs of an existing result */
+static int init_collocation_pairs(collocation_info *info)
+{
+    long i;
+
+    if (info->nearest_neighbour_x_criterium_index >= 0 || info->nearest_neighbour_y_criterium_index >= 0)
+    {
+        for (i = 0; i < info->collocation_result->num_pairs; i++)
+        {
+            harp_collocation_pair *pair = info->collocation_result->pair[i];
+            int keep;
+
+            if (filter_nearest_neighbour(info, pair, &keep) != 0)
+            {
+                return -1;
+            }
+            if (!keep)
+            {
+                pair->collocation_index = -1;
+                info->num_removed_pairs++;
+            }
+        }
+        if (remove_trailing_pushed_out_pairs(info, 0) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int add_collocation_pair(collocation_info *info, const char *source_product_a, long sample_index_a,
+                                const char *source_product_b, long sample_index_b, const double *difference)
+{
+    harp_collocation_result *collocation_result = info->collocation_result;
+    long collocation_index = 0;
+
+    /* the pairs are sorted by collocation_index and the last pair has not been pushed out */
+    if (collocation_result->num_pairs > 0)
+    {
+        collocation_index = collocation_result->pair[collocation_result->num_pairs - 1]->collocation_index + 1;
+    }
+    if (harp_collocation_result_add_pair(collocation_result, collocation_index, source_product_a, sample_index_a,
+                                         source_product_b, sample_index_b, info->num_criteria, difference) != 0)
+    {
+        return -1;
+    }
+
+    /* the second nearest neighbour criterium, if it exists, can only be avaluated at the end of the collocation */
+    if (info->nearest_neighbour_x_criterium_index >= 0 || info->nearest_neighbour_y_criterium_index >= 0)
+    {
+        int keep;
+
+        if (filter_nearest_neighbour(info, collocation_result->pair[collocation_result->num_pairs - 1], &keep) != 0)
+        {
+            return -1;
+        }
+        if (!keep)
+        {
+            /* existing pairs are closer -> remove the new pair again */
+            return harp_collocation_result_remove_pair_at_index(collocation_result, collocation_result->num_pairs - 1);
+        }
+        if (collocation_result->num_pairs > 1 &&
+            collocation_result->pair[collocation_result->num_pairs - 2]->collocation_index < 0)
+        {
+            /* the new pair pushed out the last remaining pair -> renumber the new pair as its replacement */
+            if (remove_trailing_pushed_out_pairs(info, 1) != 0)
+            {
+                return -1;
+            }
+            collocation_result->pair[collocation_result->num_pairs - 1]->collocation_index =
+                collocation_result->num_pairs > 1 ?
+                collocation_result->pair[collocation_result->num_pairs - 2]->collocation_index + 1 : 0;
+        }
+        /* removed pairs are cleaned up in bulk, which keeps the cost per pair constant */
+        if (info->num_removed_pairs > info->collocation_result->num_pairs / 2)
+        {
+            if (remove_pushed_out_pairs(info) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* add the pairs that were found for a single product of dataset A by one of the matchup threads to the final result */
+static int add_collocation_pairs(collocation_info *info, const harp_collocation_result *collocation_result)
+{
+    long i;
+
+    /* the pairs are added in the order in which they were found, so we end up with the same result (including the
+     * nearest neighbour filtering) as when the products were matched on a single thread
+     */
+    for (i = 0; i < collocation_result->num_pairs; i++)
+    {
+        harp_collocation_pair *pair = collocation_result->pair[i];
+
+        if (add_collocation_pair(info, collocation_result->dataset_a->source_product[pair->product_index_a],
+                                 pair->sample_index_a,
+                                 collocation_result->dataset_b->source_product[pair->product_index_b],
+                                 pair->sample_index_b, pair->difference) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* re-sort the scalar criteria on their measured rejection rate (highest first) so mismatching pairs are rejected
+ * as early as possible; the point distance is the most expensive criterium and always remains last
+ */
+static void update_criterium_order(collocation_info *info, matchup_state *state)
+{
+    int num_scalar_criteria;
+    int j, k;
+
+    num_scalar_criteria = info->num_criteria - (info->point_distance_index >= 0 ? 1 : 0);
+    for (k = 1; k < num_scalar_criteria; k++)
+    {
+        int i = state->criterium_order[k];
+        double rate = state->criterium_num_evaluated[i] == 0 ? 1.0 :
+            (double)state->criterium_num_rejected[i] / state->criterium_num_evaluated[i];
+
+        for (j = k; j > 0; j--)
+        {
+            int prev = state->criterium_order[j - 1];
+            double prev_rate = state->criterium_num_evaluated[prev] == 0 ? 1.0 :
+                (double)state->criterium_num_rejected[prev] / state->criterium_num_evaluated[prev];
+
+            if (prev_rate >= rate)
+            {
+                break;
+            }
+            state->criterium_order[j] = prev;
+        }
+        state->criterium_order[j] = i;
+    }
+    state->num_pairs_until_reorder = CRITERIUM_REORDER_INTERVAL;
+}
+
+static int perform_matchup_on_measurements(collocation_info *info, matchup_state *state, long index_a,
+                                           long product_b_index, long index_b)
+{
+    double latitude_a;
+    double longitude_a;
+    double latitude_b;
+    double longitude_b;
+    int k;
+
+    state->num_pairs_until_reorder--;
+    if (state->num_pairs_until_reorder <= 0)
+    {
+        update_criterium_order(info, state);
+    }
+
+    /* stop at the first criterium that fails; all differences are only available (and needed) for matching pairs */
+    for (k = 0; k < info->num_criteria; k++)
+    {
+        int i = state->criterium_order[k];
+
+        state->criterium_num_evaluated[i]++;
+        if (i == info->point_distance_index)
+        {
+            if (info->spatial_index_type == spatial_index_point_to_point && !info->point_distance_wgs84)
+            {
+                /* use the unit vectors of the spatial index instead of starting from latitude/longitude again */
+                state->difference[i] =
+                    unit_vector_point_distance(&state->variables_a.point[3 * index_a],
+                                               &state->spatial_index_b[product_b_index]->centre[3 * index_b]) *
+                    info->point_distance_per_radian;
+            }
+            else
+            {
+                latitude_a = state->variables_a.latitude->data.double_data[index_a];
+                longitude_a = state->variables_a.longitude->data.double_data[index_a];
+                latitude_b = state->variables_b.latitude->data.double_data[index_b];
+                longitude_b = state->variables_b.longitude->data.double_data[index_b];
+
+                if (info->point_distance_wgs84)
+                {
+                    if (harp_geometry_get_point_distance_wgs84(latitude_a, longitude_a, latitude_b, longitude_b,
+                                                               &state->difference[i]) != 0)
+                    {
+                        return -1;
+                    }
+                }
+                else if (harp_geometry_get_point_distance(latitude_a, longitude_a, latitude_b, longitude_b,
+                                                          &state->difference[i]) != 0)
+                {
+                    return -1;
+                }
+            }
+            state->difference[i] *= info->point_distance_conversion_factor;
+        }
+        else
+        {
+            state->difference[i] = fabs(state->variables_a.criterium[i]->data.double_data[index_a] -
+                                        state->variables_b.criterium[i]->data.double_data[index_b]);
+            if (i == info->datetime_index)
+            {
+                state->difference[i] *= info->datetime_conversion_factor;
+            }
+        }
+        if (info->criterium[i]->use_modulo)
+        {
+            while (state->difference[i] > info->criterium[i]->modulo_value)
+            {
+                state->difference[i] -= info->criterium[i]->modulo_value;
+            }
+            if (state->difference[i] > info->criterium[i]->modulo_value / 2)
+            {
+                state->difference[i] = info->criterium[i]->modulo_value - state->difference[i];
+            }
+        }
+        /* we use !(x<=y) instead of x>y so a NaN value for the difference will also result in a mismatch */
+        if (!(state->difference[i] <= info->criterium[i]->value))
+        {
+            state->criterium_num_rejected[i]++;
+            return 0;
+        }
+    }
+
+    /* the area filters are the most expensive checks, so they are performed last (point-in-polygon tests first) */
+    if (info->filter_point_in_area_xy)
+    {
+        int in_area;
+
+        latitude_a = state->variables_a.latitude->data.double_data[index_a];
+        longitude_a = state->variables_a.longitude->data.double_data[index_a];
+        if (harp_area_cache_has_point_in_area(state->variables_b.area_cache, index_b, latitude_a, longitude_a,
+                                              &in_area) != 0)
+        {
+            return -1;
+        }
+        if (!in_area)
+        {
+            return 0;
+        }
+    }
+    if (info->filter_point_in_area_yx)
+    {
+        int in_area;
+
+        latitude_b = state->variables_b.latitude->data.double_data[index_b];
+        longitude_b = state->variables_b.longitude->data.double_data[index_b];
+        if (harp_area_cache_has_point_in_area(state->variables_a.area_cache, index_a, latitude_b, longitude_b,
+                                              &in_area) != 0)
+        {
+            return -1;
+        }
+        if (!in_area)
+        {
+            return 0;
+        }
+    }
+    if (info->filter_area_intersects)
+    {
+        int has_overlap;
+
+        if (harp_area_cache_has_area_overlap(state->variables_a.area_cache, index_a, state->variables_b.area_cache,
+                                             index_b, &has_overlap, NULL) != 0)
+        {
+            return -1;
+        }
+        if (!has_overlap)
+        {
+            return 0;
+        }
+    }
+
+    if (state->collocation_result != NULL)
+    {
+        /* just record the match; the nearest neighbour filtering is performed when merging the pairs into the final
+         * collocation result
+         */
+        if (harp_collocation_result_add_pair(state->collocation_result, state->collocation_result->num_pairs,
+                                             state->product_a->source_product,
+                                             state->variables_a.index->data.int32_data[index_a],
+                                             state->product_b[product_b_index]->source_product,
+                                             state->variables_b.index->data.int32_data[index_b], info->num_criteria,
+                                             state->difference) != 0)
+        {
+            return -1;
+        }
+        return 0;
+    }
+
+    return add_collocation_pair(info, state->product_a->source_product,
+                                state->variables_a.index->data.int32_data[index_a],
+                                state->product_b[product_b_index]->source_product,
+                                state->variables_b.index->data.int32_data[index_b], state->difference);
+}
+
+/* determine the search area for a sample of product A; returns 0 if the sample has no usable location */
+static int get_spatial_search_area(collocation_info *info, matchup_state *state, long index_a, double *centre,
+                                   double *radius)
+{
+    if (info->spatial_index_type == spatial_index_point_to_point)
+    {
+        const double *point = &state->variables_a.point[3 * index_a];
+
+        *radius = info->spatial_index_radius;
+        centre[0] = point[0];
+        centre[1] = point[1];
+        centre[2] = point[2];
+        return harp_isfinite(point[0]);
+    }
+    else if (info->spatial_index_type == spatial_index_point_to_area)
+    {
+        *radius = 0;
+        return unit_vector_from_point(state->variables_a.latitude->data.double_data[index_a],
+                                      state->variables_a.longitude->data.double_data[index_a], centre);
+    }
+    else
+    {
+        long num_vertices = state->variables_a.latitude_bounds->dimension[1];
+
+        return bounding_cap_from_area(num_vertices,
+                                      &state->variables_a.latitude_bounds->data.double_data[index_a * num_vertices],
+                                      &state->variables_a.longitude_bounds->data.double_data[index_a * num_vertices],
+                                      centre, radius);
+    }
+}
+
+static int perform_matchup_on_products(collocation_info *info, matchup_state *state, long product_b_index)
+{
+    spatial_index *spatial_index_b = NULL;
+    datetime_index *datetime_index_b = NULL;
+    double *datetime_a = NULL;
+    double delta_time = 0;
+    long num_samples_b = state->product_b[product_b_index]->dimension[harp_dimension_time];
+    long i, j;
+
+    if (info->spatial_index_type != spatial_index_none)
+    {
+        if (state->spatial_index_b[product_b_index] == NULL)
+        {
+            if (spatial_index_new(info, &state->variables_b, num_samples_b,
+                                  &state->spatial_index_b[product_b_index]) != 0)
+            {
+                return -1;
+            }
+        }
+        spatial_index_b = state->spatial_index_b[product_b_index];
+    }
+    if (info->datetime_index >= 0)
+    {
+        if (state->datetime_index_b[product_b_index] == NULL)
+        {
+            if (datetime_index_new(state->variables_b.criterium[info->datetime_index],
+                                   &state->datetime_index_b[product_b_index]) != 0)
+            {
+                return -1;
+            }
+        }
+        datetime_index_b = state->datetime_index_b[product_b_index];
+        datetime_index_b->last_datetime = harp_nan();
+        datetime_a = state->variables_a.criterium[info->datetime_index]->data.double_data;
+        /* maximum datetime difference (in the internal HARP unit) with a small margin for rounding errors */
+        delta_time = info->criterium[info->datetime_index]->value / info->datetime_conversion_factor;
+        delta_time += 1.0e-9 * fabs(delta_time);
+    }
+
+    if (spatial_index_b == NULL && datetime_index_b == NULL)
+    {
+        for (i = 0; i < state->product_a->dimension[harp_dimension_time]; i++)
+        {
+            for (j = 0; j < num_samples_b; j++)
+            {
+                if (perform_matchup_on_measurements(info, state, i, product_b_index, j) != 0)
+                {
+                    return -1;
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    /* only evaluate the samples from B that are near enough (in time and/or space) to the sample from A */
+    for (i = 0; i < state->product_a->dimension[harp_dimension_time]; i++)
+    {
+        long num_candidates;
+        long *candidate;
+
+        if (datetime_index_b != NULL)
+        {
+            if (datetime_index_query(datetime_index_b, datetime_a[i], delta_time) == 0)
+            {
+                continue;
+            }
+        }
+        if (spatial_index_b != NULL)
+        {
+            double centre[3];
+            double radius;
+
+            if (get_spatial_search_area(info, state, i, centre, &radius))
+            {
+                spatial_index_query(spatial_index_b, centre, radius);
+            }
+            else
+            {
+                spatial_index_query(spatial_index_b, NULL, 0);
+            }
+            num_candidates = spatial_index_b->num_candidates;
+            candidate = spatial_index_b->candidate;
+            if (datetime_index_b != NULL)
+            {
+                const double *datetime_b = state->variables_b.criterium[info->datetime_index]->data.double_data;
+                long k = 0;
+
+                /* only keep the candidates that are also within the datetime window */
+                for (j = 0; j < num_candidates; j++)
+                {
+                    if (fabs(datetime_a[i] - datetime_b[candidate[j]]) <= delta_time)
+                    {
+                        candidate[k] = candidate[j];
+                        k++;
+                    }
+                }
+                num_candidates = k;
+            }
+        }
+        else
+        {
+            datetime_index_get_candidates(datetime_index_b);
+            num_candidates = datetime_index_b->num_candidates;
+            candidate = datetime_index_b->candidate;
+        }
+
+        for (j = 0; j < num_candidates; j++)
+        {
+            if (perform_matchup_on_measurements(info, state, i, product_b_index, candidate[j]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int remove_unused_variables(collocation_info *info, harp_product *product, int include_latlon,
+                                   int include_latlon_bounds)
+{
+    uint8_t *included;
+    int index;
+    int i;
+
+    included = (uint8_t *)malloc(product->num_variables);
+    if (included == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* assume all variables are excluded */
+    for (i = 0; i < product->num_variables; i++)
+    {
+        included[i] = 0;
+    }
+
+    /* always keep 'index' variable */
+    if (harp_product_get_variable_index_by_name(product, "index", &index) != 0)
+    {
+        free(included);
+        return -1;
+    }
+    included[index] = 1;
+
+    /* set the 'keep' flags in the mask */
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (i == info->point_distance_index)
+        {
+            continue;
+        }
+        if (harp_product_get_variable_index_by_name(product, info->criterium[i]->variable_name, &index) != 0)
         {
-            return 0;
+            free(included);
+            return -1;
+        }
+        included[index] = 1;
+    }
+
+    if (include_latlon)
+    {
+        if (harp_product_get_variable_index_by_name(product, "latitude", &index) != 0)
+        {
+            free(included);
+            return -1;
+        }
+        included[index] = 1;
+        if (harp_product_get_variable_index_by_name(product, "longitude", &index) != 0)
+        {
+            free(included);
+            return -1;
+        }
+        included[index] = 1;
+    }
+    if (include_latlon_bounds)
+    {
+        if (harp_product_get_variable_index_by_name(product, "latitude_bounds", &index) != 0)
+        {
+            free(included);
+            return -1;
+        }
+        included[index] = 1;
+        if (harp_product_get_variable_index_by_name(product, "longitude_bounds", &index) != 0)
+        {
+            free(included);
+            return -1;
+        }
+        included[index] = 1;
+    }
+
+    /* filter the variables using the mask */
+    for (i = product->num_variables - 1; i >= 0; i--)
+    {
+        if (!included[i])
+        {
+            if (harp_product_remove_variable(product, product->variable[i]) != 0)
+            {
+                free(included);
+                return -1;
+            }
+        }
+    }
+
+    free(included);
+
+    return 0;
+}
+
+static int filter_product(collocation_info *info, harp_product *product, int is_dataset_a)
+{
+    harp_dimension_type dimension_type[2] = { harp_dimension_time, harp_dimension_independent };
+    harp_data_type data_type;
+    int include_latlon_bounds;
+    int include_latlon;
+    long i;
+
+    get_latlon_requirements(info, is_dataset_a, &include_latlon, &include_latlon_bounds);
+
+    /* make sure that we have an 'index' variable */
+    data_type = harp_type_int32;
+    if (harp_product_add_derived_variable(product, "index", &data_type, NULL, 1, dimension_type) != 0)
+    {
+        return -1;
+    }
+
+    data_type = harp_type_double;
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        const char *unit = NULL;
+
+        if (i == info->point_distance_index)
+        {
+            continue;
+        }
+
+        if (info->criterium[i]->unit == NULL)
+        {
+            harp_variable *variable;
+
+            /* determine the unit automatically from the variable in the product and assign it to the criterium */
+            /* also update the difference information in the collocation result */
+            if (!harp_product_has_variable(product, info->criterium[i]->variable_name))
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not determine unit for '%s' collocation criterium "
+                               "(no such variable in product)", info->criterium[i]->variable_name);
+                return -1;
+            }
+            if (harp_product_get_variable_by_name(product, info->criterium[i]->variable_name, &variable) != 0)
+            {
+                return -1;
+            }
+            if (variable->unit == NULL)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not determine unit for '%s' collocation criterium "
+                               "(variable has no unit)", info->criterium[i]->variable_name);
+                return -1;
+            }
+            if (collocation_criterium_set_unit(info->criterium[i], variable->unit) != 0)
+            {
+                return -1;
+            }
+            assert(info->collocation_result->difference_unit[i] == NULL);
+            info->collocation_result->difference_unit[i] = strdup(variable->unit);
+            if (info->collocation_result->difference_unit[i] == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                               __LINE__);
+                return -1;
+            }
+        }
+        if (i == info->datetime_index)
+        {
+            unit = HARP_UNIT_DATETIME;
+        }
+        else
+        {
+            unit = info->criterium[i]->unit;
+        }
+
+        if (harp_product_add_derived_variable(product, info->criterium[i]->variable_name, &data_type, unit, 1,
+                                              dimension_type)
+            != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* just include lat/lon with default unit (since they may also be used as collocation criteria with a user specified
+     * unit). We change the unit during the comparison if needed.
+     */
+    if (include_latlon)
+    {
+        if (harp_product_add_derived_variable(product, "latitude", &data_type, NULL, 1, dimension_type) != 0)
+        {
+            return -1;
+        }
+        if (harp_product_add_derived_variable(product, "longitude", &data_type, NULL, 1, dimension_type) != 0)
+        {
+            return -1;
+        }
+    }
+    if (include_latlon_bounds)
+    {
+        if (harp_product_add_derived_variable(product, "latitude_bounds", &data_type, NULL, 2, dimension_type) != 0)
+        {
+            return -1;
+        }
+        if (harp_product_add_derived_variable(product, "longitude_bounds", &data_type, NULL, 2, dimension_type) != 0)
+        {
+            return -1;
+        }
+    }
+
+    /* remove all variables that are not needed */
+    if (remove_unused_variables(info, product, include_latlon, include_latlon_bounds) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int assign_variables(collocation_info *info, cache_variables *cache, harp_product *product)
+{
+    harp_dimension_type dimension_type[2] = { harp_dimension_time, harp_dimension_independent };
+    harp_data_type data_type = harp_type_double;
+    long i;
+
+    if (harp_product_get_variable_by_name(product, "index", &cache->index) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_has_variable(product, "latitude"))
+    {
+        if (cache->latitude != NULL)
+        {
+            harp_variable_delete(cache->latitude);
+        }
+        if (cache->longitude != NULL)
+        {
+            harp_variable_delete(cache->longitude);
+        }
+        if (harp_product_get_derived_variable(product, "latitude", &data_type, HARP_UNIT_LATITUDE, 1, dimension_type,
+                                              &cache->latitude) != 0)
+        {
+            return -1;
+        }
+        if (harp_product_get_derived_variable(product, "longitude", &data_type, HARP_UNIT_LONGITUDE, 1, dimension_type,
+                                              &cache->longitude) != 0)
+        {
+            return -1;
+        }
+    }
+    if (harp_product_has_variable(product, "latitude_bounds"))
+    {
+        if (cache->latitude_bounds != NULL)
+        {
+            harp_variable_delete(cache->latitude_bounds);
+        }
+        if (cache->longitude_bounds != NULL)
+        {
+            harp_variable_delete(cache->longitude_bounds);
+        }
+        if (cache->area_cache != NULL)
+        {
+            harp_area_cache_delete(cache->area_cache);
+            cache->area_cache = NULL;
+        }
+        if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, HARP_UNIT_LATITUDE, 2,
+                                              dimension_type, &cache->latitude_bounds) != 0)
+        {
+            return -1;
+        }
+        if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, HARP_UNIT_LONGITUDE, 2,
+                                              dimension_type, &cache->longitude_bounds) != 0)
+        {
+            return -1;
+        }
+        /* the polygon of a measurement is constructed once and reused for all pairs that it is part of */
+        if (harp_area_cache_new(cache->latitude_bounds->dimension[0], (int)cache->latitude_bounds->dimension[1],
+                                cache->latitude_bounds->data.double_data, cache->longitude_bounds->data.double_data,
+                                &cache->area_cache) != 0)
+        {
+            return -1;
+        }
+    }
+
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (i == info->point_distance_index)
+        {
+            continue;
+        }
+        if (harp_product_get_variable_by_name(product, info->criterium[i]->variable_name, &cache->criterium[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* determine the unit vectors of all latitude/longitude points (for the samples of dataset A) */
+static int assign_point_vectors(cache_variables *cache)
+{
+    long num_samples = cache->latitude->dimension[0];
+    double *point;
+    long i;
+
+    point = realloc(cache->point, (num_samples > 0 ? num_samples : 1) * 3 * sizeof(double));
+    if (point == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_samples * 3 * sizeof(double), __FILE__, __LINE__);
+        return -1;
+    }
+    cache->point = point;
+
+    for (i = 0; i < num_samples; i++)
+    {
+        if (!unit_vector_from_point(cache->latitude->data.double_data[i], cache->longitude->data.double_data[i],
+                                    &point[3 * i]))
+        {
+            point[3 * i] = harp_nan();
+            point[3 * i + 1] = harp_nan();
+            point[3 * i + 2] = harp_nan();
         }
     }
 
-    if (info->filter_point_in_area_xy)
-    {
-        int in_area;
+    return 0;
+}
+
+static int import_product(collocation_info *info, matchup_state *state, harp_dataset *dataset, long index,
+                          int is_dataset_a, harp_product **product)
+{
+    harp_program *program = is_dataset_a ? state->program_a : state->program_b;
+    harp_program **keep_program = is_dataset_a ? &state->keep_program_a : &state->keep_program_b;
+    const char *ingest_options = is_dataset_a ? info->ingest_options_a : info->ingest_options_b;
+    int imported = 0;
 
-        latitude_a = info->variables_a.latitude->data.double_data[index_a];
-        longitude_a = info->variables_a.longitude->data.double_data[index_a];
-        num_vertices_b = info->variables_b.latitude_bounds->dimension[1];
-        latitude_bounds_b = &info->variables_b.latitude_bounds->data.double_data[index_b * num_vertices_b];
-        longitude_bounds_b = &info->variables_b.longitude_bounds->data.double_data[index_b * num_vertices_b];
-        if (harp_geometry_has_point_in_area(latitude_a, longitude_a, num_vertices_b, latitude_bounds_b,
-                                            longitude_bounds_b, &in_area) != 0)
+    if (*keep_program != NULL)
+    {
+        if (harp_import_with_program(dataset->metadata[index]->filename, *keep_program, ingest_options, product) == 0)
         {
-            return -1;
+            imported = 1;
         }
-        if (!in_area)
+        else
         {
-            return 0;
+            /* the needed variables are not all directly available (e.g. some have to be derived from other
+             * variables), so import the full product and stop using the keep() for this dataset */
+            harp_program_delete(*keep_program);
+            *keep_program = NULL;
         }
     }
-    if (info->filter_point_in_area_yx)
+    if (!imported)
     {
-        int in_area;
-
-        latitude_b = info->variables_b.latitude->data.double_data[index_b];
-        longitude_b = info->variables_b.longitude->data.double_data[index_b];
-        num_vertices_a = info->variables_a.latitude_bounds->dimension[1];
-        latitude_bounds_a = &info->variables_a.latitude_bounds->data.double_data[index_a * num_vertices_a];
-        longitude_bounds_a = &info->variables_a.longitude_bounds->data.double_data[index_a * num_vertices_a];
-        if (harp_geometry_has_point_in_area(latitude_b, longitude_b, num_vertices_a, latitude_bounds_a,
-                                            longitude_bounds_a, &in_area) != 0)
+        if (harp_import_with_program(dataset->metadata[index]->filename, program, ingest_options, product) != 0)
         {
             return -1;
         }
-        if (!in_area)
-        {
-            return 0;
-        }
     }
-    if (info->filter_area_intersects)
+    if (!harp_product_is_empty(*product))
     {
-        int has_overlap;
-
-        num_vertices_a = info->variables_a.latitude_bounds->dimension[1];
-        latitude_bounds_a = &info->variables_a.latitude_bounds->data.double_data[index_a * num_vertices_a];
-        longitude_bounds_a = &info->variables_a.longitude_bounds->data.double_data[index_a * num_vertices_a];
-        num_vertices_b = info->variables_b.latitude_bounds->dimension[1];
-        latitude_bounds_b = &info->variables_b.latitude_bounds->data.double_data[index_b * num_vertices_b];
-        longitude_bounds_b = &info->variables_b.longitude_bounds->data.double_data[index_b * num_vertices_b];
-
-        if (harp_geometry_has_area_overlap(num_vertices_a, latitude_bounds_a, longitude_bounds_a, num_vertices_b,
-                                           latitude_bounds_b, longitude_bounds_b, &has_overlap, NULL) != 0)
+        if (filter_product(info, *product, is_dataset_a) != 0)
         {
             return -1;
         }
-        if (!has_overlap)
-        {
-            return 0;
-        }
     }
 
-    if (info->nearest_neighbour_x_criterium_index >= 0 || info->nearest_neighbour_y_criterium_index >= 0)
-    {
-        long product_index;
-        long sample_index;
-
-        /* replace any pair that is not closer for the first nearest neighbour criterium */
-        /* since we apply a nearest filter there can only be at most one pair in the collocation result matching */
-        /* the index we are looking for */
-        if (info->perform_nearest_neighbour_x_first)
-        {
-            /* select nearest x */
-            assert(info->nearest_neighbour_x_criterium_index >= 0);
-
-            if (harp_dataset_has_product(info->collocation_result->dataset_a, info->product_a->source_product))
-            {
-                if (harp_dataset_get_index_from_source_product(info->collocation_result->dataset_a,
-                                                               info->product_a->source_product, &product_index) != 0)
-                {
-                    return -1;
-                }
-                sample_index = info->variables_a.index->data.int32_data[index_a];
-
-                for (i = 0; i < info->collocation_result->num_pairs; i++)
-                {
-                    harp_collocation_pair *pair = info->collocation_result->pair[i];
-
-                    if (pair->product_index_a == product_index && pair->sample_index_a == sample_index)
-                    {
-                        if (pair->difference[info->nearest_neighbour_x_criterium_index] <=
-                            info->difference[info->nearest_neighbour_x_criterium_index])
-                        {
-                            /* existing pair is closer -> ignore the new pair */
-                            return 0;
-                        }
-                        /* new pair is closer, remove existing one */
-                        if (harp_collocation_result_remove_pair_at_index(info->collocation_result, i) != 0)
-                        {
-                            return -1;
-                        }
-                        /* stop the search and immediately continue with adding the new pair */
-                        break;
-                    }
-                }
-            }
-        }
-        else
-        {
-            /* select nearest y */
-            assert(info->nearest_neighbour_y_criterium_index >= 0);
-
-            if (harp_dataset_has_product(info->collocation_result->dataset_b,
-                                         info->product_b[product_b_index]->source_product))
-            {
-                if (harp_dataset_get_index_from_source_product(info->collocation_result->dataset_b,
-                                                               info->product_b[product_b_index]->source_product,
-                                                               &product_index) != 0)
-                {
-                    return -1;
-                }
-                sample_index = info->variables_b.index->data.int32_data[index_b];
+    return 0;
+}
 
-                for (i = 0; i < info->collocation_result->num_pairs; i++)
-                {
-                    harp_collocation_pair *pair = info->collocation_result->pair[i];
+/* make sure product 'index_b' of dataset B is loaded (re-ingesting it if it was removed from the cache) */
+static int matchup_state_get_product_b(collocation_info *info, matchup_state *state, long index_b)
+{
+    state->use_counter++;
+    state->product_b_last_use[index_b] = state->use_counter;
 
-                    if (pair->product_index_b == product_index && pair->sample_index_b == sample_index)
-                    {
-                        if (pair->difference[info->nearest_neighbour_y_criterium_index] <=
-                            info->difference[info->nearest_neighbour_y_criterium_index])
-                        {
-                            /* existing pair is closer -> ignore the new pair */
-                            return 0;
-                        }
-                        /* new pair is closer, remove existing one */
-                        if (harp_collocation_result_remove_pair_at_index(info->collocation_result, i) != 0)
-                        {
-                            return -1;
-                        }
-                        /* stop the search and immediately continue with adding the new pair */
-                        break;
-                    }
-                }
-            }
-        }
-        /* the second nearest neighbour criterium, if it exists, can only be avaluated at the end of the collocation */
+    if (state->product_b[index_b] != NULL)
+    {
+        state->cache_b_num_hits++;
+        return 0;
     }
 
-    /* add new pair to result */
-    if (info->collocation_result->num_pairs == 0)
+    state->cache_b_num_misses++;
+    if (state->product_b_evicted[index_b])
     {
-        collocation_index = 0;
+        state->cache_b_num_reingested++;
+        state->product_b_evicted[index_b] = 0;
     }
-    else
+    if (import_product(info, state, info->dataset_b, index_b, 0, &state->product_b[index_b]) != 0)
     {
-        collocation_index =
-            info->collocation_result->pair[info->collocation_result->num_pairs - 1]->collocation_index + 1;
+        return -1;
     }
-    if (harp_collocation_result_add_pair(info->collocation_result, collocation_index, info->product_a->source_product,
-                                         info->variables_a.index->data.int32_data[index_a],
-                                         info->product_b[product_b_index]->source_product,
-                                         info->variables_b.index->data.int32_data[index_b], info->num_criteria,
-                                         info->difference) != 0)
+    if (harp_product_get_storage_size(state->product_b[index_b], 0, &state->product_b_size[index_b]) != 0)
     {
         return -1;
     }
+    if (info->max_cache_size_b > 0)
+    {
+        matchup_state_reserve_cache_b(info, state, index_b, state->product_b_size[index_b]);
+    }
+    state->cache_size_b += state->product_b_size[index_b];
+    if (state->cache_size_b > state->cache_b_peak_size)
+    {
+        state->cache_b_peak_size = state->cache_size_b;
+    }
 
     return 0;
 }
 
-static int perform_matchup_on_products(collocation_info *info, long product_b_index)
+/* Check whether samples from products with the given spatial extents (latitude_min, latitude_max, longitude_min,
+ * longitude_max [degree], NaN if unknown) could be within the point_distance search radius of each other.
+ * Pruning is only done for the point_distance criterium; for the area criteria the edges of an area can bulge beyond
+ * the bounding box of its corners, so products whose extents do not overlap can still match.
+ * Longitudes are not normalized, so the longitude ranges are compared modulo 360 degrees.
+ */
+static int spatial_extents_can_match(const collocation_info *info, const double *extent_a, const double *extent_b)
 {
-    long i, j;
-
-    for (i = 0; i < info->product_a->dimension[harp_dimension_time]; i++)
+    double margin;
+    double max_abs_latitude;
+    double longitude_margin;
+    double ratio;
+    double shift;
+    int k;
+
+    if (info->spatial_index_type != spatial_index_point_to_point)
     {
-        for (j = 0; j < info->product_b[product_b_index]->dimension[harp_dimension_time]; j++)
+        return 1;
+    }
+    for (k = 0; k < 4; k++)
+    {
+        if (harp_isnan(extent_a[k]) || harp_isnan(extent_b[k]))
         {
-            if (perform_matchup_on_measurements(info, i, product_b_index, j) != 0)
-            {
-                return -1;
-            }
+            return 1;
         }
     }
 
-    return 0;
-}
-
-static int remove_unused_variables(collocation_info *info, harp_product *product, int include_latlon,
-                                   int include_latlon_bounds)
-{
-    uint8_t *included;
-    int index;
-    int i;
-
-    included = (uint8_t *)malloc(product->num_variables);
-    if (included == NULL)
+    margin = (info->spatial_index_radius + SPATIAL_INDEX_MARGIN) / CONST_DEG2RAD + SPATIAL_INDEX_GRID_TOLERANCE;
+    if (extent_a[0] - margin > extent_b[1] || extent_b[0] - margin > extent_a[1])
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       product->num_variables * sizeof(uint8_t), __FILE__, __LINE__);
-        return -1;
+        return 0;
     }
 
-    /* assume all variables are excluded */
-    for (i = 0; i < product->num_variables; i++)
+    /* the longitude margin is largest for the sample of A that is closest to a pole */
+    max_abs_latitude = fabs(extent_a[0]) > fabs(extent_a[1]) ? fabs(extent_a[0]) : fabs(extent_a[1]);
+    if (max_abs_latitude + margin >= 90.0)
     {
-        included[i] = 0;
+        return 1;
     }
-
-    /* always keep 'index' variable */
-    if (harp_product_get_variable_index_by_name(product, "index", &index) != 0)
+    ratio = sin(info->spatial_index_radius + SPATIAL_INDEX_MARGIN) / cos(max_abs_latitude * CONST_DEG2RAD);
+    if (ratio >= 1.0)
     {
-        free(included);
-        return -1;
+        return 1;
     }
-    included[index] = 1;
+    longitude_margin = asin(ratio) / CONST_DEG2RAD + SPATIAL_INDEX_GRID_TOLERANCE;
 
-    /* set the 'keep' flags in the mask */
-    for (i = 0; i < info->num_criteria; i++)
+    /* shift the longitude range of B by the smallest multiple of 360 degrees that puts its upper end at or above the
+     * lower end of the (widened) range of A; the ranges overlap if the shifted lower end is within the range of A */
+    shift = 360.0 * ceil((extent_a[2] - longitude_margin - extent_b[3]) / 360.0);
+
+    return extent_b[2] + shift <= extent_a[3] + longitude_margin;
+}
+
+static void get_metadata_spatial_extent(const harp_product_metadata *metadata, double *extent)
+{
+    extent[0] = metadata->latitude_min;
+    extent[1] = metadata->latitude_max;
+    extent[2] = metadata->longitude_min;
+    extent[3] = metadata->longitude_max;
+}
+
+/* Narrow the spatial extent of a product of dataset A down to the range of its ingested sample locations
+ * (after the operations of dataset A have been applied).
+ */
+static void update_spatial_extent_from_variables(const cache_variables *variables, double *extent)
+{
+    double range[4] = { 0, 0, 0, 0 };
+    int found = 0;
+    long i;
+
+    if (variables->latitude == NULL || variables->longitude == NULL)
     {
-        if (i == info->point_distance_index)
+        return;
+    }
+    for (i = 0; i < variables->latitude->num_elements; i++)
+    {
+        double latitude = variables->latitude->data.double_data[i];
+        double longitude = variables->longitude->data.double_data[i];
+
+        if (harp_isnan(latitude) || harp_isnan(longitude))
         {
             continue;
         }
-        if (harp_product_get_variable_index_by_name(product, info->criterium[i]->variable_name, &index) != 0)
+        if (!found)
         {
-            free(included);
-            return -1;
+            range[0] = range[1] = latitude;
+            range[2] = range[3] = longitude;
+            found = 1;
+            continue;
         }
-        included[index] = 1;
-    }
-
-    if (include_latlon)
-    {
-        if (harp_product_get_variable_index_by_name(product, "latitude", &index) != 0)
+        if (latitude < range[0])
         {
-            free(included);
-            return -1;
+            range[0] = latitude;
         }
-        included[index] = 1;
-        if (harp_product_get_variable_index_by_name(product, "longitude", &index) != 0)
+        if (latitude > range[1])
         {
-            free(included);
-            return -1;
+            range[1] = latitude;
         }
-        included[index] = 1;
-    }
-    if (include_latlon_bounds)
-    {
-        if (harp_product_get_variable_index_by_name(product, "latitude_bounds", &index) != 0)
+        if (longitude < range[2])
         {
-            free(included);
-            return -1;
+            range[2] = longitude;
         }
-        included[index] = 1;
-        if (harp_product_get_variable_index_by_name(product, "longitude_bounds", &index) != 0)
+        if (longitude > range[3])
         {
-            free(included);
-            return -1;
+            range[3] = longitude;
         }
-        included[index] = 1;
     }
+    if (found)
+    {
+        memcpy(extent, range, sizeof(range));
+    }
+}
 
-    /* filter the variables using the mask */
-    for (i = product->num_variables - 1; i >= 0; i--)
+/* Collocate the product of dataset A at position 'i' in the sorted list against all products of dataset B */
+static int perform_matchup_on_product_a(collocation_info *info, matchup_state *state, long i, double delta_time)
+{
+    long index_a = info->sorted_index_a[i];
+    double datetime_start_a = info->dataset_a->metadata[index_a]->datetime_start;
+    double datetime_stop_a = info->dataset_a->metadata[index_a]->datetime_stop;
+    int is_new_a = info->is_new_product_a == NULL || info->is_new_product_a[index_a];
+    double extent_a[4];
+    double extent_b[4];
+    long j;
+
+    get_metadata_spatial_extent(info->dataset_a->metadata[index_a], extent_a);
+
+    /* don't ingest the product of dataset A if none of the products of dataset B can produce matches with it
+     * (pairs with products of dataset B that were already matched are in the previous result)
+     */
+    for (j = 0; j < info->dataset_b->num_products; j++)
     {
-        if (!included[i])
+        long index_b = info->sorted_index_b[j];
+
+        if ((is_new_a || info->is_new_product_b[index_b]) &&
+            datetime_start_a <= info->dataset_b->metadata[index_b]->datetime_stop + delta_time &&
+            info->dataset_b->metadata[index_b]->datetime_start - delta_time <= datetime_stop_a)
         {
-            if (harp_product_remove_variable(product, product->variable[i]) != 0)
+            get_metadata_spatial_extent(info->dataset_b->metadata[index_b], extent_b);
+            if (spatial_extents_can_match(info, extent_a, extent_b))
             {
-                free(included);
-                return -1;
+                break;
             }
         }
     }
+    if (j == info->dataset_b->num_products)
+    {
+        return 0;
+    }
 
-    free(included);
-
-    return 0;
-}
-
-static int filter_product(collocation_info *info, harp_product *product, int is_dataset_a)
-{
-    harp_dimension_type dimension_type[2] = { harp_dimension_time, harp_dimension_independent };
-    harp_data_type data_type;
-    int include_latlon_bounds;
-    int include_latlon;
-    long i;
+    /* let the OS read the file of the next product of dataset A while this product is being processed */
+    if (i + 1 < info->dataset_a->num_products)
+    {
+        harp_prefetch_file(info->dataset_a->metadata[info->sorted_index_a[i + 1]]->filename);
+    }
 
-    if (is_dataset_a)
+    /* import product of dataset A */
+    if (import_product(info, state, info->dataset_a, index_a, 1, &state->product_a) != 0)
     {
-        include_latlon = info->point_distance_index >= 0 || info->filter_point_in_area_xy;
-        include_latlon_bounds = info->filter_area_intersects || info->filter_point_in_area_yx;
+        return -1;
     }
-    else
+    if (harp_product_is_empty(state->product_a))
     {
-        include_latlon = info->point_distance_index >= 0 || info->filter_point_in_area_yx;
-        include_latlon_bounds = info->filter_area_intersects || info->filter_point_in_area_xy;
+        harp_product_delete(state->product_a);
+        state->product_a = NULL;
+        return 0;
     }
-
-    /* make sure that we have an 'index' variable */
-    data_type = harp_type_int32;
-    if (harp_product_add_derived_variable(product, "index", &data_type, NULL, 1, dimension_type) != 0)
+    if (assign_variables(info, &state->variables_a, state->product_a) != 0)
     {
         return -1;
     }
-
-    data_type = harp_type_double;
-    for (i = 0; i < info->num_criteria; i++)
+    if (info->spatial_index_type == spatial_index_point_to_point)
     {
-        const char *unit = NULL;
-
-        if (i == info->point_distance_index)
+        /* for dataset B the unit vectors are stored in the spatial index */
+        if (assign_point_vectors(&state->variables_a) != 0)
         {
-            continue;
+            return -1;
         }
+        update_spatial_extent_from_variables(&state->variables_a, extent_a);
+    }
 
-        if (info->criterium[i]->unit == NULL)
-        {
-            harp_variable *variable;
+    for (j = 0; j < info->dataset_b->num_products; j++)
+    {
+        long index_b = info->sorted_index_b[j];
+        double datetime_start_b = info->dataset_b->metadata[index_b]->datetime_start;
+        double datetime_stop_b = info->dataset_b->metadata[index_b]->datetime_stop;
 
-            /* determine the unit automatically from the variable in the product and assign it to the criterium */
-            /* also update the difference information in the collocation result */
-            if (!harp_product_has_variable(product, info->criterium[i]->variable_name))
+        if (datetime_start_a <= datetime_stop_b + delta_time && datetime_start_b - delta_time <= datetime_stop_a)
+        {
+            /* overlap */
+            if (!is_new_a && !info->is_new_product_b[index_b])
             {
-                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not determine unit for '%s' collocation criterium "
-                               "(no such variable in product)", info->criterium[i]->variable_name);
-                return -1;
+                continue;
             }
-            if (harp_product_get_variable_by_name(product, info->criterium[i]->variable_name, &variable) != 0)
+            get_metadata_spatial_extent(info->dataset_b->metadata[index_b], extent_b);
+            if (!spatial_extents_can_match(info, extent_a, extent_b))
             {
-                return -1;
+                /* products of dataset B that are skipped stay in the cache, since they overlap in time */
+                state->num_pairs_pruned++;
+                continue;
             }
-            if (variable->unit == NULL)
+            if (state->product_b[index_b] == NULL && j + 1 < info->dataset_b->num_products)
+            {
+                /* products of dataset B are sorted by datetime, so the next one is likely to be needed next */
+                harp_prefetch_file(info->dataset_b->metadata[info->sorted_index_b[j + 1]]->filename);
+            }
+            if (matchup_state_get_product_b(info, state, index_b) != 0)
             {
-                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not determine unit for '%s' collocation criterium "
-                               "(variable has no unit)", info->criterium[i]->variable_name);
                 return -1;
             }
-            if (collocation_criterium_set_unit(info->criterium[i], variable->unit) != 0)
+            if (harp_product_is_empty(state->product_b[index_b]))
+            {
+                continue;
+            }
+
+            if (assign_variables(info, &state->variables_b, state->product_b[index_b]) != 0)
             {
                 return -1;
             }
-            assert(info->collocation_result->difference_unit[i] == NULL);
-            info->collocation_result->difference_unit[i] = strdup(variable->unit);
-            if (info->collocation_result->difference_unit[i] == NULL)
+
+            if (perform_matchup_on_products(info, state, index_b) != 0)
             {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                               __LINE__);
                 return -1;
             }
         }
-        if (i == info->datetime_index)
+        else if (state->product_b[index_b] != NULL)
         {
-            unit = HARP_UNIT_DATETIME;
+            matchup_state_remove_product_b(state, index_b);
+        }
+    }
+    harp_product_delete(state->product_a);
+    state->product_a = NULL;
+
+    return 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+/* shared administration for the threads that each process a part of the products of dataset A */
+typedef struct matchup_threads_struct
+{
+    collocation_info *info;
+    double delta_time;
+    pthread_mutex_t mutex;      /* protects all fields below */
+    pthread_cond_t product_done;        /* signalled each time a thread finishes a product of dataset A */
+    long next_product_a;        /* position in sorted_index_a of the next product that should be processed */
+    long end_product_a; /* position in sorted_index_a after the last product that should be processed */
+    harp_collocation_result **result;   /* pairs per product of dataset A (by position in sorted_index_a) */
+    int *status;        /* per product of dataset A: 0 = pending, 1 = done, -1 = failed */
+    int abort;          /* set when one of the threads failed or when the main thread wants to stop */
+    int error_code;     /* error of the first product that failed */
+    char *error_message;
+} matchup_threads;
+
+static void matchup_threads_set_failed(matchup_threads *threads)
+{
+    /* only keep the error of the product that failed first */
+    if (!threads->abort)
+    {
+        threads->abort = 1;
+        threads->error_code = harp_errno;
+        threads->error_message = strdup(harp_errno_to_string(harp_errno));
+    }
+}
+
+static void *matchup_thread_run(void *arg)
+{
+    matchup_threads *threads = (matchup_threads *)arg;
+    collocation_info *info = threads->info;
+    matchup_state *state;
+    int result;
+    long i;
+
+    if (matchup_state_new(info, &state) != 0)
+    {
+        pthread_mutex_lock(&threads->mutex);
+        matchup_threads_set_failed(threads);
+        pthread_cond_broadcast(&threads->product_done);
+        pthread_mutex_unlock(&threads->mutex);
+        return NULL;
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&threads->mutex);
+        if (threads->abort || threads->next_product_a >= threads->end_product_a)
+        {
+            pthread_mutex_unlock(&threads->mutex);
+            break;
+        }
+        i = threads->next_product_a;
+        threads->next_product_a++;
+        pthread_mutex_unlock(&threads->mutex);
+
+        result = harp_collocation_result_new(&state->collocation_result, info->num_criteria, NULL, NULL);
+        if (result == 0)
+        {
+            result = perform_matchup_on_product_a(info, state, i, threads->delta_time);
+        }
+
+        pthread_mutex_lock(&threads->mutex);
+        if (result == 0)
+        {
+            threads->result[i] = state->collocation_result;
+            threads->status[i] = 1;
         }
         else
         {
-            unit = info->criterium[i]->unit;
+            threads->status[i] = -1;
+            matchup_threads_set_failed(threads);
+            if (state->collocation_result != NULL)
+            {
+                harp_collocation_result_delete(state->collocation_result);
+            }
         }
+        state->collocation_result = NULL;
+        pthread_cond_broadcast(&threads->product_done);
+        pthread_mutex_unlock(&threads->mutex);
+    }
 
-        if (harp_product_add_derived_variable(product, info->criterium[i]->variable_name, &data_type, unit, 1,
-                                              dimension_type)
-            != 0)
+    pthread_mutex_lock(&threads->mutex);
+    matchup_state_add_statistics(info, state);
+    pthread_mutex_unlock(&threads->mutex);
+    matchup_state_delete(state);
+
+    return NULL;
+}
+
+/* determine whether the units of all criteria are known (these may depend on the first product that is ingested) */
+static int have_criteria_units(collocation_info *info)
+{
+    int i;
+
+    for (i = 0; i < info->num_criteria; i++)
+    {
+        if (i != info->point_distance_index && info->criterium[i]->unit == NULL)
         {
-            return -1;
+            return 0;
         }
     }
 
-    /* just include lat/lon with default unit (since they may also be used as collocation criteria with a user specified
-     * unit). We change the unit during the comparison if needed.
-     */
-    if (include_latlon)
+    return 1;
+}
+
+/* write the pairs that were found so far to the output file and remove them from the result (--stream).
+ * The first write (re)creates the output file, which is postponed until the units of all criteria are known (these
+ * end up in the header) unless this is the final write.
+ */
+static int stream_collocation_pairs(collocation_info *info, int is_final)
+{
+    uint8_t *mask;
+
+    if (info->stream_filename == NULL)
     {
-        if (harp_product_add_derived_variable(product, "latitude", &data_type, NULL, 1, dimension_type) != 0)
+        return 0;
+    }
+    if (!info->stream_started)
+    {
+        if (!is_final && !have_criteria_units(info))
         {
-            return -1;
+            return 0;
         }
-        if (harp_product_add_derived_variable(product, "longitude", &data_type, NULL, 1, dimension_type) != 0)
+        if (harp_collocation_result_write(info->stream_filename, info->collocation_result) != 0)
         {
             return -1;
         }
+        info->stream_started = 1;
     }
-    if (include_latlon_bounds)
+    else if (info->collocation_result->num_pairs > 0)
     {
-        if (harp_product_add_derived_variable(product, "latitude_bounds", &data_type, NULL, 2, dimension_type) != 0)
-        {
-            return -1;
-        }
-        if (harp_product_add_derived_variable(product, "longitude_bounds", &data_type, NULL, 2, dimension_type) != 0)
+        if (harp_collocation_result_append(info->stream_filename, info->collocation_result) != 0)
         {
             return -1;
         }
     }
+    if (info->collocation_result->num_pairs == 0)
+    {
+        return 0;
+    }
 
-    /* remove all variables that are not needed */
-    if (remove_unused_variables(info, product, include_latlon, include_latlon_bounds) != 0)
+    mask = calloc(info->collocation_result->num_pairs, sizeof(uint8_t));
+    if (mask == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->collocation_result->num_pairs * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    if (harp_collocation_result_filter(info->collocation_result, mask) != 0)
     {
+        free(mask);
         return -1;
     }
+    free(mask);
 
     return 0;
 }
 
-static int assign_variables(collocation_info *info, cache_variables *cache, harp_product *product)
+/* Collocate the products of dataset A at positions 'first' up to 'end' using multiple threads */
+static int perform_matchup_using_threads(collocation_info *info, long first, long end, double delta_time)
 {
-    harp_dimension_type dimension_type[2] = { harp_dimension_time, harp_dimension_independent };
-    harp_data_type data_type = harp_type_double;
+    matchup_threads threads;
+    pthread_t *thread;
+    int num_threads = 0;
+    int result = 0;
     long i;
 
-    if (harp_product_get_variable_by_name(product, "index", &cache->index) != 0)
+    threads.info = info;
+    threads.delta_time = delta_time;
+    threads.next_product_a = first;
+    threads.end_product_a = end;
+    threads.abort = 0;
+    threads.error_code = HARP_SUCCESS;
+    threads.error_message = NULL;
+
+    thread = malloc(info->num_threads * sizeof(pthread_t));
+    if (thread == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->num_threads * sizeof(pthread_t), __FILE__, __LINE__);
+        return -1;
+    }
+    threads.result = malloc(info->dataset_a->num_products * sizeof(harp_collocation_result *));
+    if (threads.result == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->dataset_a->num_products * sizeof(harp_collocation_result *), __FILE__, __LINE__);
+        free(thread);
+        return -1;
+    }
+    threads.status = malloc(info->dataset_a->num_products * sizeof(int));
+    if (threads.status == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->dataset_a->num_products * sizeof(int), __FILE__, __LINE__);
+        free(threads.result);
+        free(thread);
         return -1;
     }
+    for (i = 0; i < info->dataset_a->num_products; i++)
+    {
+        threads.result[i] = NULL;
+        threads.status[i] = 0;
+    }
+    pthread_mutex_init(&threads.mutex, NULL);
+    pthread_cond_init(&threads.product_done, NULL);
 
-    if (harp_product_has_variable(product, "latitude"))
+    while (num_threads < info->num_threads)
     {
-        if (cache->latitude != NULL)
-        {
-            harp_variable_delete(cache->latitude);
-        }
-        if (cache->longitude != NULL)
-        {
-            harp_variable_delete(cache->longitude);
-        }
-        if (harp_product_get_derived_variable(product, "latitude", &data_type, HARP_UNIT_LATITUDE, 1, dimension_type,
-                                              &cache->latitude) != 0)
-        {
-            return -1;
-        }
-        if (harp_product_get_derived_variable(product, "longitude", &data_type, HARP_UNIT_LONGITUDE, 1, dimension_type,
-                                              &cache->longitude) != 0)
+        if (pthread_create(&thread[num_threads], NULL, matchup_thread_run, &threads) != 0)
         {
-            return -1;
+            if (num_threads == 0)
+            {
+                harp_set_error(HARP_ERROR_OPERATION, "could not create matchup thread");
+                result = -1;
+            }
+            /* continue with the threads that we have */
+            break;
         }
+        num_threads++;
     }
-    if (harp_product_has_variable(product, "latitude_bounds"))
+
+    /* merge the pairs of each product in the order of the products, while the threads process the next products */
+    for (i = first; result == 0 && i < end; i++)
     {
-        if (cache->latitude_bounds != NULL)
+        harp_collocation_result *collocation_result;
+
+        pthread_mutex_lock(&threads.mutex);
+        while (threads.status[i] == 0 && !threads.abort)
         {
-            harp_variable_delete(cache->latitude_bounds);
+            pthread_cond_wait(&threads.product_done, &threads.mutex);
         }
-        if (cache->longitude_bounds != NULL)
+        if (threads.status[i] != 1)
         {
-            harp_variable_delete(cache->longitude_bounds);
+            pthread_mutex_unlock(&threads.mutex);
+            result = -1;
+            break;
         }
-        if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, HARP_UNIT_LATITUDE, 2,
-                                              dimension_type, &cache->latitude_bounds) != 0)
+        collocation_result = threads.result[i];
+        threads.result[i] = NULL;
+        pthread_mutex_unlock(&threads.mutex);
+
+        /* NN filtering uses the libharp dataset functions of the final result, which are not used by the threads */
+        if (add_collocation_pairs(info, collocation_result) != 0)
         {
-            return -1;
+            harp_collocation_result_delete(collocation_result);
+            pthread_mutex_lock(&threads.mutex);
+            threads.abort = 1;
+            pthread_mutex_unlock(&threads.mutex);
+            result = -1;
+            break;
         }
-        if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, HARP_UNIT_LONGITUDE, 2,
-                                              dimension_type, &cache->longitude_bounds) != 0)
+        harp_collocation_result_delete(collocation_result);
+        if (stream_collocation_pairs(info, 0) != 0)
         {
-            return -1;
+            pthread_mutex_lock(&threads.mutex);
+            threads.abort = 1;
+            pthread_mutex_unlock(&threads.mutex);
+            result = -1;
+            break;
         }
     }
 
-    for (i = 0; i < info->num_criteria; i++)
+    for (i = 0; i < num_threads; i++)
     {
-        if (i == info->point_distance_index)
-        {
-            continue;
-        }
-        if (harp_product_get_variable_by_name(product, info->criterium[i]->variable_name, &cache->criterium[i]) != 0)
+        pthread_join(thread[i], NULL);
+    }
+
+    if (result != 0 && threads.error_code != HARP_SUCCESS)
+    {
+        /* report the error of the thread that failed */
+        harp_set_error(threads.error_code, "%s", threads.error_message != NULL ? threads.error_message : "");
+    }
+
+    for (i = first; i < end; i++)
+    {
+        if (threads.result[i] != NULL)
         {
-            return -1;
+            harp_collocation_result_delete(threads.result[i]);
         }
     }
+    if (threads.error_message != NULL)
+    {
+        free(threads.error_message);
+    }
+    pthread_cond_destroy(&threads.product_done);
+    pthread_mutex_destroy(&threads.mutex);
+    free(threads.status);
+    free(threads.result);
+    free(thread);
 
-    return 0;
+    return result;
 }
+#endif
 
 /* Collocate two datasets */
 static int perform_matchup(collocation_info *info)
 {
-    long i, j;
+    matchup_state *state;
+    long first, end;
+    long i;
     double delta_time;  /* time criterium to efficiently filter for products that could have matching pairs */
 
     if (info->datetime_index >= 0)
@@ -1340,85 +4143,59 @@ static int perform_matchup(collocation_info *info)
         delta_time = harp_plusinf();
     }
 
-    /* loop over products in dataset A */
-    for (i = 0; i < info->dataset_a->num_products; i++)
+    if (init_collocation_pairs(info) != 0)
     {
-        long index_a = info->sorted_index_a[i];
-        double datetime_start_a = info->dataset_a->metadata[index_a]->datetime_start;
-        double datetime_stop_a = info->dataset_a->metadata[index_a]->datetime_stop;
+        return -1;
+    }
 
-        /* import product of dataset A */
-        if (harp_import(info->dataset_a->metadata[index_a]->filename, info->operations_a, info->ingest_options_a,
-                        &info->product_a) != 0)
-        {
-            return -1;
-        }
-        if (harp_product_is_empty(info->product_a))
+    if (matchup_state_new(info, &state) != 0)
+    {
+        return -1;
+    }
+
+    /* a shard is a contiguous range of the products of dataset A in time order, which keeps the number of products
+     * of dataset B that each shard needs to ingest low
+     */
+    first = (long)(((int64_t)info->shard_index * info->dataset_a->num_products) / info->num_shards);
+    end = (long)(((int64_t)(info->shard_index + 1) * info->dataset_a->num_products) / info->num_shards);
+
+    /* loop over products in dataset A */
+    for (i = first; i < end; i++)
+    {
+#ifdef HAVE_PTHREAD_H
+        /* criteria without a unit get the unit of the first non-empty product of dataset A, so only go parallel
+         * once that product has been processed
+         */
+        if (info->num_threads > 1 && have_criteria_units(info))
         {
-            harp_product_delete(info->product_a);
-            info->product_a = NULL;
-            continue;
+            break;
         }
-        if (filter_product(info, info->product_a, 1) != 0)
+#endif
+        if (perform_matchup_on_product_a(info, state, i, delta_time) != 0)
         {
+            matchup_state_delete(state);
             return -1;
         }
-        if (assign_variables(info, &info->variables_a, info->product_a) != 0)
+        if (stream_collocation_pairs(info, 0) != 0)
         {
+            matchup_state_delete(state);
             return -1;
         }
+    }
+    matchup_state_add_statistics(info, state);
+    matchup_state_delete(state);
 
-        for (j = 0; j < info->dataset_b->num_products; j++)
+#ifdef HAVE_PTHREAD_H
+    if (i < end)
+    {
+        if (perform_matchup_using_threads(info, i, end, delta_time) != 0)
         {
-            long index_b = info->sorted_index_b[j];
-            double datetime_start_b = info->dataset_b->metadata[index_b]->datetime_start;
-            double datetime_stop_b = info->dataset_b->metadata[index_b]->datetime_stop;
-
-            if (datetime_start_a <= datetime_stop_b + delta_time && datetime_start_b - delta_time <= datetime_stop_a)
-            {
-                /* overlap */
-                if (info->product_b[index_b] == NULL)
-                {
-                    if (harp_import(info->dataset_b->metadata[index_b]->filename, info->operations_b,
-                                    info->ingest_options_b, &info->product_b[index_b]) != 0)
-                    {
-                        return -1;
-                    }
-                    if (harp_product_is_empty(info->product_b[index_b]))
-                    {
-                        continue;
-                    }
-                    if (filter_product(info, info->product_b[index_b], 0) != 0)
-                    {
-                        return -1;
-                    }
-                }
-                else if (harp_product_is_empty(info->product_b[index_b]))
-                {
-                    continue;
-                }
-
-                if (assign_variables(info, &info->variables_b, info->product_b[index_b]) != 0)
-                {
-                    return -1;
-                }
-
-                if (perform_matchup_on_products(info, index_b) != 0)
-                {
-                    return -1;
-                }
-            }
-            else if (info->product_b[index_b] != NULL)
-            {
-                harp_product_delete(info->product_b[index_b]);
-                info->product_b[index_b] = NULL;
-            }
+            return -1;
         }
-        harp_product_delete(info->product_a);
-        info->product_a = NULL;
     }
+#endif
 
-    return 0;
+    return remove_pushed_out_pairs(info);
 }
 
 int matchup(int argc, char *argv[])
@@ -1454,6 +4231,12 @@ int matchup(int argc, char *argv[])
         {
             info->filter_point_in_area_yx = 1;
         }
+        else if (strcmp(argv[i], "--wgs84") == 0)
+        {
+            /* this also applies to the point_distance filters of the -aa/-ab operations */
+            info->point_distance_wgs84 = 1;
+            harp_set_option_wgs84_point_distance(1);
+        }
         else if (strcmp(argv[i], "-nx") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
         {
             if (info->nearest_neighbour_x_variable_name != NULL)
@@ -1492,6 +4275,20 @@ int matchup(int argc, char *argv[])
             }
             i++;
         }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+
+            info->num_nearest_neighbours = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || info->num_nearest_neighbours < 1)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid number of nearest neighbours '%s' (expected a "
+                               "positive number)", argv[i + 1]);
+                collocation_info_delete(info);
+                return -1;
+            }
+            i++;
+        }
         else if ((strcmp(argv[i], "-oa") == 0 || strcmp(argv[i], "--options_a") == 0) && i + 1 < argc
                  && argv[i + 1][0] != '-')
         {
@@ -1516,6 +4313,95 @@ int matchup(int argc, char *argv[])
             info->operations_b = argv[i + 1];
             i++;
         }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            long num_threads;
+
+            num_threads = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || num_threads < 1 || num_threads > MAX_NUM_THREADS)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid number of threads '%s' (expected a value between "
+                               "1 and %d)", argv[i + 1], MAX_NUM_THREADS);
+                collocation_info_delete(info);
+                return -1;
+            }
+            info->num_threads = (int)num_threads;
+            i++;
+        }
+        else if (strcmp(argv[i], "--buffer-pool") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_buffer_pool_size((int64_t)strtod(argv[i + 1], NULL)) != 0)
+            {
+                collocation_info_delete(info);
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            long shard_index;
+            long num_shards = 0;
+
+            shard_index = strtol(argv[i + 1], &end, 10);
+            if (*end == '/')
+            {
+                num_shards = strtol(end + 1, &end, 10);
+            }
+            if (*end != '\0' || num_shards < 1 || num_shards > 1000000 || shard_index < 1 || shard_index > num_shards)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid shard '%s' (expected <i>/<n> with 1 <= i <= n)",
+                               argv[i + 1]);
+                collocation_info_delete(info);
+                return -1;
+            }
+            info->shard_index = (int)(shard_index - 1);
+            info->num_shards = (int)num_shards;
+            i++;
+        }
+        else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            double cache_size;
+
+            cache_size = strtod(argv[i + 1], &end);
+            if (*end != '\0' || !(cache_size > 0) || cache_size > 1.0e9)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid cache size '%s' (expected a positive number of "
+                               "MB)", argv[i + 1]);
+                collocation_info_delete(info);
+                return -1;
+            }
+            info->max_cache_size_b = (int64_t)(cache_size * 1048576);
+            i++;
+        }
+        else if (strcmp(argv[i], "--incremental") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (info->previous_result != NULL)
+            {
+                collocation_info_delete(info);
+                return 1;
+            }
+            if (harp_collocation_result_read(argv[i + 1], &info->previous_result) != 0)
+            {
+                collocation_info_delete(info);
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--verbose") == 0)
+        {
+            info->verbose = 1;
+        }
+        else if (strcmp(argv[i], "--binary") == 0)
+        {
+            info->binary_output = 1;
+        }
+        else if (strcmp(argv[i], "--stream") == 0)
+        {
+            info->stream_filename = argv[argc - 1];
+        }
         else
         {
             if (argv[i][0] == '-' || i != argc - 3)
@@ -1527,12 +4413,31 @@ int matchup(int argc, char *argv[])
         }
     }
 
-    if (harp_dataset_import(info->dataset_a, argv[argc - 3], info->ingest_options_a) != 0)
+    if (info->stream_filename != NULL)
+    {
+        if (info->binary_output)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "--stream can not be combined with --binary");
+            collocation_info_delete(info);
+            return -1;
+        }
+        if (info->nearest_neighbour_x_variable_name != NULL || info->nearest_neighbour_y_variable_name != NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "--stream can not be combined with -nx or -ny");
+            collocation_info_delete(info);
+            return -1;
+        }
+    }
+
+    /* skip products that can not match the leading filters of the operations according to their metadata */
+    if (harp_dataset_import_with_prefilter(info->dataset_a, argv[argc - 3], info->ingest_options_a,
+                                           info->operations_a) != 0)
     {
         collocation_info_delete(info);
         return -1;
     }
-    if (harp_dataset_import(info->dataset_b, argv[argc - 2], info->ingest_options_b) != 0)
+    if (harp_dataset_import_with_prefilter(info->dataset_b, argv[argc - 2], info->ingest_options_b,
+                                           info->operations_b) != 0)
     {
         collocation_info_delete(info);
         return -1;
@@ -1551,6 +4456,24 @@ int matchup(int argc, char *argv[])
             collocation_info_delete(info);
             return -1;
         }
+        if (info->verbose)
+        {
+            printf("products of dataset B: %ld hits, %ld misses (%ld re-ingested), %ld removed because of the cache "
+                   "size limit, peak cache size %.1f MB\n", info->cache_b_num_hits, info->cache_b_num_misses,
+                   info->cache_b_num_reingested, info->cache_b_num_evictions,
+                   (double)info->cache_b_peak_size / 1048576);
+            if (info->spatial_index_type == spatial_index_point_to_point)
+            {
+                printf("product pairs skipped because of their spatial extent: %ld\n", info->num_pairs_pruned);
+            }
+        }
+    }
+    else if (info->previous_result != NULL)
+    {
+        /* nothing to match, so the result stays as it was */
+        harp_collocation_result_delete(info->collocation_result);
+        info->collocation_result = info->previous_result;
+        info->previous_result = NULL;
     }
 
     if (info->nearest_neighbour_x_criterium_index >= 0 && info->nearest_neighbour_y_criterium_index >= 0)
@@ -1558,7 +4481,8 @@ int matchup(int argc, char *argv[])
         /* perform the second nearest neighbour filtering using a filter on the collocation results */
         if (info->perform_nearest_neighbour_x_first)
         {
-            if (resample_nearest_b(info->collocation_result, info->nearest_neighbour_y_criterium_index) != 0)
+            if (resample_nearest_b(info->collocation_result, info->nearest_neighbour_y_criterium_index,
+                                   info->num_nearest_neighbours) != 0)
             {
                 collocation_info_delete(info);
                 return -1;
@@ -1566,7 +4490,8 @@ int matchup(int argc, char *argv[])
         }
         else
         {
-            if (resample_nearest_a(info->collocation_result, info->nearest_neighbour_x_criterium_index) != 0)
+            if (resample_nearest_a(info->collocation_result, info->nearest_neighbour_x_criterium_index,
+                                   info->num_nearest_neighbours) != 0)
             {
                 collocation_info_delete(info);
                 return -1;
@@ -1579,7 +4504,24 @@ int matchup(int argc, char *argv[])
         }
     }
 
-    if (harp_collocation_result_write(argv[argc - 1], info->collocation_result) != 0)
+    if (info->stream_filename != NULL)
+    {
+        /* write the remaining pairs (this also creates the output file if nothing was written yet) */
+        if (stream_collocation_pairs(info, 1) != 0)
+        {
+            collocation_info_delete(info);
+            return -1;
+        }
+    }
+    else if (info->binary_output)
+    {
+        if (harp_collocation_result_write_binary(argv[argc - 1], info->collocation_result) != 0)
+        {
+            collocation_info_delete(info);
+            return -1;
+        }
+    }
+    else if (harp_collocation_result_write(argv[argc - 1], info->collocation_result) != 0)
     {
         collocation_info_delete(info);
         return -1;
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "harp.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* parse the options that are shared by --merge and --sort; returns the index of the first file argument */
+static int parse_sort_options(int argc, char *argv[], int is_sort, int *binary_output, int64_t *memory_limit,
+                              harp_collocation_sort_order *sort_order)
+{
+    int i = 2;
+
+    while (i < argc && argv[i][0] == '-')
+    {
+        if (strcmp(argv[i], "--binary") == 0)
+        {
+            *binary_output = 1;
+        }
+        else if (strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            double limit;
+
+            limit = strtod(argv[i + 1], &end);
+            if (*end != '\0' || limit < 0)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid memory limit '%s' (expected a number of bytes)",
+                               argv[i + 1]);
+                return -1;
+            }
+            *memory_limit = (int64_t)limit;
+            i++;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            long num_threads;
+
+            num_threads = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || harp_set_option_num_threads((int)num_threads) != 0)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid number of threads '%s'", argv[i + 1]);
+                return -1;
+            }
+            i++;
+        }
+        else if (is_sort && strcmp(argv[i], "--by") == 0 && i + 1 < argc)
+        {
+            if (strcmp(argv[i + 1], "a") == 0)
+            {
+                *sort_order = harp_collocation_sort_by_a;
+            }
+            else if (strcmp(argv[i + 1], "b") == 0)
+            {
+                *sort_order = harp_collocation_sort_by_b;
+            }
+            else if (strcmp(argv[i + 1], "collocation_index") == 0)
+            {
+                *sort_order = harp_collocation_sort_by_collocation_index;
+            }
+            else
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid sort order '%s' (expected a, b, or "
+                               "collocation_index)", argv[i + 1]);
+                return -1;
+            }
+            i++;
+        }
+        else
+        {
+            return 0;
+        }
+        i++;
+    }
+
+    return i;
+}
+
+/* get the input files of --merge/--sort; returns 0 if the arguments are invalid */
+static int get_num_input_files(int argc, char *argv[], int first)
+{
+    int i;
+
+    /* we need at least one input path and an output path */
+    if (first < 2 || argc < first + 2)
+    {
+        return 0;
+    }
+    for (i = first; i < argc; i++)
+    {
+        if (argv[i][0] == '-')
+        {
+            return 0;
+        }
+    }
+
+    return argc - 1 - first;
+}
+
+int merge(int argc, char *argv[])
+{
+    harp_collocation_sort_order sort_order = harp_collocation_sort_by_a;
+    int64_t memory_limit = 0;
+    int binary_output = 0;
+    int num_input_files;
+    int first;
+
+    first = parse_sort_options(argc, argv, 0, &binary_output, &memory_limit, &sort_order);
+    if (first < 0)
+    {
+        return -1;
+    }
+    num_input_files = get_num_input_files(argc, argv, first);
+    if (num_input_files == 0)
+    {
+        return 1;
+    }
+
+    /* the pairs are sorted on source product name and sample index of A and then of B (keeping the order of the
+     * inputs for equal pairs), so the result does not depend on how the pairs were distributed over the inputs
+     */
+    if (harp_collocation_result_merge_files(num_input_files, (const char **)&argv[first], memory_limit,
+                                            argv[argc - 1], binary_output) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+int sort(int argc, char *argv[])
+{
+    harp_collocation_sort_order sort_order = harp_collocation_sort_by_collocation_index;
+    int64_t memory_limit = 0;
+    int binary_output = 0;
+    int num_input_files;
+    int first;
+
+    first = parse_sort_options(argc, argv, 1, &binary_output, &memory_limit, &sort_order);
+    if (first < 0)
+    {
+        return -1;
+    }
+    num_input_files = get_num_input_files(argc, argv, first);
+    if (num_input_files == 0)
+    {
+        return 1;
+    }
+
+    if (harp_collocation_result_sort_files(num_input_files, (const char **)&argv[first], sort_order, memory_limit,
+                                           argv[argc - 1], binary_output) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
@@ -46,6 +46,8 @@ typedef struct resample_info_struct
     long nearest_neighbour_x_criterium_index;
     char *nearest_neighbour_y_variable_name;
     long nearest_neighbour_y_criterium_index;
+    long num_nearest_neighbours;
+    int binary_output;
 } resample_info;
 
 static void resample_info_delete(resample_info *info)
@@ -85,6 +87,8 @@ static int resample_info_new(resample_info **new_info)
     info->nearest_neighbour_x_criterium_index = -1;
     info->nearest_neighbour_y_variable_name = NULL;
     info->nearest_neighbour_y_criterium_index = -1;
+    info->num_nearest_neighbours = 1;
+    info->binary_output = 0;
 
     *new_info = info;
 
@@ -146,72 +150,126 @@ static int resample_info_update(resample_info *info)
     return 0;
 }
 
-int resample_nearest_a(harp_collocation_result *collocation_result, int difference_index)
+typedef struct nearest_candidate_struct
 {
+    double difference;
+    long index;
+} nearest_candidate;
+
+static int compare_nearest_candidate(const void *a, const void *b)
+{
+    const nearest_candidate *candidate_a = (const nearest_candidate *)a;
+    const nearest_candidate *candidate_b = (const nearest_candidate *)b;
+
+    if (candidate_a->difference < candidate_b->difference)
+    {
+        return -1;
+    }
+    if (candidate_a->difference > candidate_b->difference)
+    {
+        return 1;
+    }
+    /* in case of ties the pair that comes first is the nearest */
+    return (candidate_a->index > candidate_b->index) - (candidate_a->index < candidate_b->index);
+}
+
+/* keep the 'k' pairs with the smallest difference for each sample of dataset A (use_b = 0) or dataset B (use_b = 1);
+ * the pairs need to be sorted by the sample of the filtered dataset
+ */
+static int filter_nearest(harp_collocation_result *collocation_result, int difference_index, long k, int use_b)
+{
+    nearest_candidate *candidate;
+    uint8_t *mask;
+    long start, end;
     long i;
 
-    if (harp_collocation_result_sort_by_a(collocation_result) != 0)
+    mask = malloc(collocation_result->num_pairs * sizeof(uint8_t));
+    if (mask == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       collocation_result->num_pairs * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    memset(mask, 1, collocation_result->num_pairs * sizeof(uint8_t));
+    candidate = malloc(collocation_result->num_pairs * sizeof(nearest_candidate));
+    if (candidate == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       collocation_result->num_pairs * sizeof(nearest_candidate), __FILE__, __LINE__);
+        free(mask);
         return -1;
     }
-    for (i = collocation_result->num_pairs - 1; i > 0; i--)
+
+    for (start = 0; start < collocation_result->num_pairs; start = end)
     {
-        if (collocation_result->pair[i]->product_index_a == collocation_result->pair[i - 1]->product_index_a &&
-            collocation_result->pair[i]->sample_index_a == collocation_result->pair[i - 1]->sample_index_a)
+        harp_collocation_pair *first = collocation_result->pair[start];
+
+        for (end = start + 1; end < collocation_result->num_pairs; end++)
         {
-            if (collocation_result->pair[i]->difference[difference_index] >=
-                collocation_result->pair[i - 1]->difference[difference_index])
-            {
-                if (harp_collocation_result_remove_pair_at_index(collocation_result, i) != 0)
-                {
-                    return -1;
-                }
-            }
-            else
+            harp_collocation_pair *pair = collocation_result->pair[end];
+
+            if (use_b ? (pair->product_index_b != first->product_index_b ||
+                         pair->sample_index_b != first->sample_index_b) :
+                (pair->product_index_a != first->product_index_a || pair->sample_index_a != first->sample_index_a))
             {
-                if (harp_collocation_result_remove_pair_at_index(collocation_result, i - 1) != 0)
-                {
-                    return -1;
-                }
+                break;
             }
         }
+        if (end - start <= k)
+        {
+            continue;
+        }
+        for (i = start; i < end; i++)
+        {
+            candidate[i - start].difference = collocation_result->pair[i]->difference[difference_index];
+            candidate[i - start].index = i;
+        }
+        qsort(candidate, end - start, sizeof(nearest_candidate), compare_nearest_candidate);
+        for (i = k; i < end - start; i++)
+        {
+            mask[candidate[i].index] = 0;
+        }
+    }
+    free(candidate);
+
+    if (harp_collocation_result_filter(collocation_result, mask) != 0)
+    {
+        free(mask);
+        return -1;
     }
+    free(mask);
 
     return 0;
 }
 
-int resample_nearest_b(harp_collocation_result *collocation_result, int difference_index)
+int resample_nearest_a(harp_collocation_result *collocation_result, int difference_index, long k)
 {
-    long i;
+    if (harp_collocation_result_sort_by_a(collocation_result) != 0)
+    {
+        return -1;
+    }
+    if (collocation_result->num_pairs <= k)
+    {
+        return 0;
+    }
 
+    /* for each sample of dataset A keep the k pairs with the smallest difference (the first ones in case of ties) */
+    return filter_nearest(collocation_result, difference_index, k, 0);
+}
+
+int resample_nearest_b(harp_collocation_result *collocation_result, int difference_index, long k)
+{
     if (harp_collocation_result_sort_by_b(collocation_result) != 0)
     {
         return -1;
     }
-    for (i = collocation_result->num_pairs - 1; i > 0; i--)
+    if (collocation_result->num_pairs <= k)
     {
-        if (collocation_result->pair[i]->product_index_b == collocation_result->pair[i - 1]->product_index_b &&
-            collocation_result->pair[i]->sample_index_b == collocation_result->pair[i - 1]->sample_index_b)
-        {
-            if (collocation_result->pair[i]->difference[difference_index] >=
-                collocation_result->pair[i - 1]->difference[difference_index])
-            {
-                if (harp_collocation_result_remove_pair_at_index(collocation_result, i) != 0)
-                {
-                    return -1;
-                }
-            }
-            else
-            {
-                if (harp_collocation_result_remove_pair_at_index(collocation_result, i - 1) != 0)
-                {
-                    return -1;
-                }
-            }
-        }
+        return 0;
     }
 
-    return 0;
+    /* for each sample of dataset B keep the k pairs with the smallest difference (the first ones in case of ties) */
+    return filter_nearest(collocation_result, difference_index, k, 1);
 }
 
 int resample(int argc, char *argv[])
@@ -266,6 +324,24 @@ int resample(int argc, char *argv[])
             }
             i++;
         }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+
+            info->num_nearest_neighbours = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || info->num_nearest_neighbours < 1)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid number of nearest neighbours '%s' (expected a "
+                               "positive number)", argv[i + 1]);
+                resample_info_delete(info);
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--binary") == 0)
+        {
+            info->binary_output = 1;
+        }
         else
         {
             if (argv[i][0] == '-' || (i != argc - 1 && i != argc - 2))
@@ -306,7 +382,8 @@ int resample(int argc, char *argv[])
         {
             if (info->nearest_neighbour_x_criterium_index >= 0)
             {
-                if (resample_nearest_a(info->collocation_result, info->nearest_neighbour_x_criterium_index) != 0)
+                if (resample_nearest_a(info->collocation_result, info->nearest_neighbour_x_criterium_index,
+                                       info->num_nearest_neighbours) != 0)
                 {
                     resample_info_delete(info);
                     return -1;
@@ -317,7 +394,8 @@ int resample(int argc, char *argv[])
         {
             if (info->nearest_neighbour_y_criterium_index >= 0)
             {
-                if (resample_nearest_b(info->collocation_result, info->nearest_neighbour_y_criterium_index) != 0)
+                if (resample_nearest_b(info->collocation_result, info->nearest_neighbour_y_criterium_index,
+                                       info->num_nearest_neighbours) != 0)
                 {
                     resample_info_delete(info);
                     return -1;
@@ -332,7 +410,15 @@ int resample(int argc, char *argv[])
         return -1;
     }
 
-    if (harp_collocation_result_write(output, info->collocation_result) != 0)
+    if (info->binary_output)
+    {
+        if (harp_collocation_result_write_binary(output, info->collocation_result) != 0)
+        {
+            resample_info_delete(info);
+            return -1;
+        }
+    }
+    else if (harp_collocation_result_write(output, info->collocation_result) != 0)
     {
         resample_info_delete(info);
         return -1;
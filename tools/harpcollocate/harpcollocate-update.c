@@ -140,16 +140,10 @@ static int update_collocation_result(harp_collocation_result *collocation_result
         }
     }
 
-    for (i = collocation_result->num_pairs - 1; i >= 0; i--)
+    if (harp_collocation_result_filter(collocation_result, mask) != 0)
     {
-        if (!mask[i])
-        {
-            if (harp_collocation_result_remove_pair_at_index(collocation_result, i) != 0)
-            {
-                free(mask);
-                return -1;
-            }
-        }
+        free(mask);
+        return -1;
     }
 
     free(mask);
@@ -162,25 +156,32 @@ int update(int argc, char *argv[])
     harp_collocation_result *collocation_result;
     harp_dataset *dataset;
     const char *output;
+    int binary_output = 0;
+    int i = 2;
 
-    if (argc < 4 || argc > 5 || argv[2][0] == '-' || argv[3][0] == '-')
+    if (argc > 2 && strcmp(argv[2], "--binary") == 0)
+    {
+        binary_output = 1;
+        i++;
+    }
+    if (argc < i + 2 || argc > i + 3 || argv[i][0] == '-' || argv[i + 1][0] == '-')
     {
         return 1;
     }
-    if (argc == 5)
+    if (argc == i + 3)
     {
-        if (argv[4][0] == '-')
+        if (argv[i + 2][0] == '-')
         {
             return 1;
         }
-        output = argv[4];
+        output = argv[i + 2];
     }
     else
     {
-        output = argv[2];
+        output = argv[i];
     }
 
-    if (harp_collocation_result_read(argv[2], &collocation_result) != 0)
+    if (harp_collocation_result_read(argv[i], &collocation_result) != 0)
     {
         return -1;
     }
@@ -195,7 +196,7 @@ int update(int argc, char *argv[])
         harp_collocation_result_delete(collocation_result);
         return -1;
     }
-    if (harp_dataset_import(dataset, argv[3], NULL) != 0)
+    if (harp_dataset_import(dataset, argv[i + 1], NULL) != 0)
     {
         harp_collocation_result_delete(collocation_result);
         harp_dataset_delete(dataset);
@@ -211,7 +212,15 @@ int update(int argc, char *argv[])
 
     harp_dataset_delete(dataset);
 
-    if (harp_collocation_result_write(output, collocation_result) != 0)
+    if (binary_output)
+    {
+        if (harp_collocation_result_write_binary(output, collocation_result) != 0)
+        {
+            harp_collocation_result_delete(collocation_result);
+            return -1;
+        }
+    }
+    else if (harp_collocation_result_write(output, collocation_result) != 0)
     {
         harp_collocation_result_delete(collocation_result);
         return -1;
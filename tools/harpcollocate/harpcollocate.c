@@ -40,7 +40,9 @@
 #include <string.h>
 
 int matchup(int argc, char *argv[]);
+int merge(int argc, char *argv[]);
 int resample(int argc, char *argv[]);
+int sort(int argc, char *argv[]);
 int update(int argc, char *argv[]);
 
 static int print_warning(const char *message, va_list ap)
@@ -66,7 +68,8 @@ static void print_help(void)
     printf("    harpcollocate [options] <path-a> <path-b> <outputpath>\n");
     printf("        Find matching sample pairs between two datasets of HARP files.\n");
     printf("        The path for a dataset can be either a single file or a directory\n");
-    printf("        containing files. The result will be write as a comma separate value\n");
+    printf("        containing files (or a .pth or archive index (.harpidx) file).\n");
+    printf("        The result will be write as a comma separate value\n");
     printf("        (csv) file to the provided output path\n");
     printf("\n");
     printf("        Options:\n");
@@ -91,6 +94,10 @@ static void print_help(void)
     printf("            --point-in-area-yx\n");
     printf("                Specifies that latitude/longitude points from dataset B must\n");
     printf("                fall in polygon areas of dataset A\n");
+    printf("            --wgs84\n");
+    printf("                Use the distance on the WGS84 ellipsoid (instead of the\n");
+    printf("                distance on a sphere) for the point_distance criterium and\n");
+    printf("                for point_distance filters\n");
     printf("            -nx <diffvariable>\n");
     printf("                Filter collocation pairs such that for each sample from\n");
     printf("                dataset A only the nearest sample from dataset B (using the\n");
@@ -98,6 +105,9 @@ static void print_help(void)
     printf("            -ny <diffvariable>\n");
     printf("                Filter collocation pairs such that for each sample from\n");
     printf("                dataset B only the neareset sample from dataset A is kept.\n");
+    printf("            -k <N>\n");
+    printf("                Keep the N nearest samples (default: 1) instead of only the\n");
+    printf("                nearest sample for the -nx and -ny filters.\n");
     printf("            -oa, --options-a <option list>\n");
     printf("                List of options to pass to the ingestion module for ingesting\n");
     printf("                products from the first dataset.\n");
@@ -117,6 +127,53 @@ static void print_help(void)
     printf("            -ab, --operations-b <operation list>\n");
     printf("                List of operations to apply to each product of the second\n");
     printf("                dataset before collocating (see above).\n");
+    printf("            --threads <N>\n");
+    printf("                Use N threads to match the products of dataset A against\n");
+    printf("                dataset B (default: 1). The result is the same as when\n");
+    printf("                using a single thread. Each thread keeps its own set of\n");
+    printf("                products from dataset B in memory.\n");
+    printf("            --buffer-pool <bytes>\n");
+    printf("                Keep up to the given number of bytes of released variable data\n");
+    printf("                and ingestion buffers for reuse by the next product, instead of\n");
+    printf("                returning them to the system. 0=disabled (default).\n");
+    printf("            --incremental <inputpath>\n");
+    printf("                Extend the existing collocation result <inputpath> (which can\n");
+    printf("                be the same file as <outputpath>). Only products of dataset\n");
+    printf("                A or B that are not yet referenced by the existing result are\n");
+    printf("                matched (against all products of the other dataset). The new\n");
+    printf("                pairs are appended with continued collocation_index values.\n");
+    printf("                The criteria need to be the same as for the existing result.\n");
+    printf("                If both -nx and -ny are used, the result can differ from a\n");
+    printf("                full collocation, since pairs that were removed by the second\n");
+    printf("                filter are not reconsidered.\n");
+    printf("            --shard <i>/<n>\n");
+    printf("                Only match the products of dataset A that belong to shard i\n");
+    printf("                (1 <= i <= n) of n, where each shard is a consecutive range of\n");
+    printf("                the products of dataset A sorted by time. The partial results\n");
+    printf("                of all shards can be combined using --merge. When using -ny,\n");
+    printf("                perform this filter after the merge using --resample.\n");
+    printf("            --cache-size <MB>\n");
+    printf("                Maximum amount of memory (in MB) that each thread uses for\n");
+    printf("                keeping ingested products of dataset B (default: no limit).\n");
+    printf("                When the limit is reached, the least recently used products\n");
+    printf("                are removed and get ingested again if they are needed later.\n");
+    printf("                The size is based on the variable data of the products.\n");
+    printf("            --stream\n");
+    printf("                Write the pairs to <outputpath> (csv only) as soon as all\n");
+    printf("                products of dataset B have been matched against a product\n");
+    printf("                of dataset A, instead of keeping the whole result in memory\n");
+    printf("                until the end. Cannot be combined with --binary, -nx, or\n");
+    printf("                -ny. An interrupted run can be resumed by passing the\n");
+    printf("                partial output to --incremental.\n");
+    printf("            --verbose\n");
+    printf("                Print statistics on the reuse of ingested products of dataset B\n");
+    printf("                and on the product pairs that were skipped because of their\n");
+    printf("                spatial extent.\n");
+    printf("            --binary\n");
+    printf("                Write the collocation result in the binary format instead\n");
+    printf("                of csv. This is a compact format that is faster to read for\n");
+    printf("                large collocation results. Collocation result files are\n");
+    printf("                always read using the format of the file.\n");
     printf("        The order in which -nx and -ny are provided determines the order in\n");
     printf("        which the nearest filters are executed.\n");
     printf("        When '[unit]' is not specified, the unit of the variable of the\n");
@@ -134,13 +191,50 @@ static void print_help(void)
     printf("            -ny <diffvariable>\n");
     printf("                Filter collocation pairs such that for each sample from\n");
     printf("                dataset B only the neareset sample from dataset A is kept.\n");
+    printf("            -k <N>\n");
+    printf("                Keep the N nearest samples (default: 1) instead of only the\n");
+    printf("                nearest sample for the -nx and -ny filters.\n");
+    printf("            --binary\n");
+    printf("                Write the collocation result in the binary format.\n");
     printf("        The order in which -nx and -ny are provided determines the order in\n");
     printf("        which the nearest filters are executed.\n");
     printf("\n");
-    printf("    harpcollocate --update <inputpath> <datasetpath> [<outputpath>]\n");
+    printf("    harpcollocate --update [--binary] <inputpath> <datasetpath> [<outputpath>]\n");
     printf("        Update an existing collocation result file by checking the\n");
     printf("        measurements in the given dataset and only keeping pairs\n");
     printf("        for which measurements still exist\n");
+    printf("        With --binary the result is written in the binary format.\n");
+    printf("\n");
+    printf("    harpcollocate --merge [options] <inputpath> [<inputpath>...] <outputpath>\n");
+    printf("        Merge collocation result files (e.g. the results of --shard runs)\n");
+    printf("        into a single collocation result. All results need to have the\n");
+    printf("        same differences. Pairs that occur more than once are only kept\n");
+    printf("        once. The pairs are sorted by product and sample of dataset A and\n");
+    printf("        then of dataset B, and the collocation_index values are renumbered\n");
+    printf("        from 0 in that order.\n");
+    printf("        The pairs do not need to fit in memory (see --sort for the options).\n");
+    printf("\n");
+    printf("    harpcollocate --sort [options] <inputpath> [<inputpath>...] <outputpath>\n");
+    printf("        Sort the pairs of one or more collocation result files (that have\n");
+    printf("        the same differences) into a single collocation result file.\n");
+    printf("        The pairs are read in parts that fit in memory, each part is sorted\n");
+    printf("        and stored in a temporary file, and the sorted parts are merged\n");
+    printf("        into the output file, so the pairs do not need to fit in memory.\n");
+    printf("        The output path can be the same as an input path.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            --by <a|b|collocation_index>\n");
+    printf("                Sort by product and sample of dataset A (and then of B), by\n");
+    printf("                product and sample of dataset B (and then of A), or by\n");
+    printf("                collocation_index (default). Pairs with equal keys keep the\n");
+    printf("                order of the input files.\n");
+    printf("            --memory-limit <bytes>\n");
+    printf("                Maximum amount of memory to use for the pairs that are sorted\n");
+    printf("                at once (default: 256MB).\n");
+    printf("            --threads <N>\n");
+    printf("                Sort each part of the pairs using N threads (default: 1).\n");
+    printf("            --binary\n");
+    printf("                Write the collocation result in the binary format.\n");
     printf("\n");
     printf("    harpcollocate -h, --help\n");
     printf("        Show help (this text).\n");
@@ -193,6 +287,14 @@ int main(int argc, char *argv[])
     {
         result = update(argc, argv);
     }
+    else if (strcmp(argv[1], "--merge") == 0)
+    {
+        result = merge(argc, argv);
+    }
+    else if (strcmp(argv[1], "--sort") == 0)
+    {
+        result = sort(argc, argv);
+    }
     else
     {
         result = matchup(argc, argv);
@@ -39,6 +39,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* maximum value for the --threads option */
+#define MAX_NUM_THREADS 1024
+
+/* maximum length of a line in a batch list file */
+#define MAX_LIST_LINE_LENGTH 8192
+
+/* settings that are shared by all conversions of a single harpconvert run */
+typedef struct convert_info_struct
+{
+    const char *operations;
+    const char *options;
+    const char *output_format;
+    int num_threads;    /* number of threads that convert products (batch mode only) */
+    int argc;   /* command line (for the history attribute) */
+    char **argv;
+} convert_info;
+
+/* a single input/output pair of a batch conversion */
+typedef struct convert_job_struct
+{
+    char *input_filename;
+    char *output_filename;
+    int result; /* 0: converted, -1: failed, -2: empty product */
+} convert_job;
 
 static int print_warning(const char *message, va_list ap)
 {
@@ -61,10 +89,33 @@ static void print_help()
 {
     printf("Usage:\n");
     printf("    harpconvert [options] <input product file> <output product file>\n");
+    printf("    harpconvert [options] --batch <list file>\n");
+    printf("    harpconvert [options] --output-directory <directory> <input product file>...\n");
+    printf("    harpconvert [options] --branch <operation list> <output product file>\n");
+    printf("        [--branch <operation list> <output product file>]... <input product file>\n");
     printf("        Import a product that is stored in HARP format or in one of the\n");
     printf("        supported external formats, perform operations on it (if provided),\n");
     printf("        and save the results to a HARP netCDF/HDF4/HDF5 product.\n");
     printf("\n");
+    printf("        The batch forms convert many products using a single initialization\n");
+    printf("        of the HARP library (and a single compilation of the operations).\n");
+    printf("        With --batch, each line of the list file (or of standard input if\n");
+    printf("        the list file is '-') contains an input and an output filename\n");
+    printf("        separated by white space; empty lines and lines starting with '#'\n");
+    printf("        are skipped. With --output-directory, each output file is stored in\n");
+    printf("        the given directory using the filename of the input file with its\n");
+    printf("        extension replaced by the extension of the output format (.nc,\n");
+    printf("        .hdf, or .h5). A product that can not be converted results in an\n");
+    printf("        error message, after which the remaining products are converted.\n");
+    printf("\n");
+    printf("        With --branch, several output products are created from a single\n");
+    printf("        import of the input product. The operations given with -a are\n");
+    printf("        performed once (as part of the import), after which the operations\n");
+    printf("        of each branch are performed on a copy of the resulting product\n");
+    printf("        that shares its data (until it is modified), and the result is\n");
+    printf("        saved to the output product file of the branch. An empty operation\n");
+    printf("        list ('') saves the product as it is after the common operations.\n");
+    printf("\n");
     printf("        Options:\n");
     printf("            -a, --operations <operation list>\n");
     printf("                List of operations to apply to the product.\n");
@@ -84,13 +135,65 @@ static void print_help()
     printf("                    netcdf (default)\n");
     printf("                    hdf4\n");
     printf("                    hdf5\n");
+    printf("                    zarr (a directory with a file per chunk)\n");
+    printf("                    arrow (export only; all variables need to depend on time)\n");
     printf("\n");
     printf("            --hdf5-compression <level>\n");
     printf("                Set data compression level for storing in HDF5 format.\n");
     printf("                0=disabled, 1=low, ..., 9=high.\n");
     printf("\n");
+    printf("            --hdf5-compression-filter <deflate|zstd|lz4>\n");
+    printf("                Set the compression filter for HDF5 format (default:\n");
+    printf("                deflate). The zstd and lz4 filters are faster, but need\n");
+    printf("                the corresponding HDF5 filter plugin to be available\n");
+    printf("                (also for reading); without it deflate is used instead.\n");
+    printf("\n");
+    printf("            --hdf5-chunk-size <bytes>\n");
+    printf("                Set the target size of the chunks that compressed variables\n");
+    printf("                are stored in for HDF5 format (default: 1048576). Each\n");
+    printf("                chunk covers whole time samples where possible, such that\n");
+    printf("                a subset of the samples can be read efficiently.\n");
+    printf("                0=store each variable in as few chunks as possible.\n");
+    printf("\n");
+    printf("            --hdf5-page-size <bytes>\n");
+    printf("                Write HDF5 files with paged file space management using the\n");
+    printf("                given page size, such that all metadata is stored together\n");
+    printf("                (e.g. 4194304 for files that are read from object storage).\n");
+    printf("                0=use the default file space management (default).\n");
+    printf("\n");
+    printf("            --zarr-chunk-size <samples>\n");
+    printf("                Set the number of time samples per chunk for Zarr format,\n");
+    printf("                such that chunks can be written and read in parallel.\n");
+    printf("                0=store each variable in a single chunk (default).\n");
+    printf("\n");
+    printf("            --arrow-batch-size <rows>\n");
+    printf("                Set the number of rows (time samples) per record batch for\n");
+    printf("                Arrow format (default: 65536). Record batches are encoded\n");
+    printf("                in parallel. 0=store all rows in a single record batch.\n");
+    printf("\n");
+    printf("            --buffer-pool <bytes>\n");
+    printf("                Keep up to the given number of bytes of released variable data\n");
+    printf("                and ingestion buffers for reuse by the next product, instead of\n");
+    printf("                returning them to the system. 0=disabled (default).\n");
+    printf("\n");
+    printf("            --profile\n");
+    printf("                Print the time spent in, and the change in product size\n");
+    printf("                caused by, each ingested variable and each operation to\n");
+    printf("                stderr when the tool exits.\n");
+    printf("\n");
+    printf("            --trace <file>\n");
+    printf("                Write a trace of all processing steps (in Chrome Trace\n");
+    printf("                Event JSON format) to the given file.\n");
+    printf("\n");
+    printf("            --threads <N>\n");
+    printf("                Use N threads to convert products in batch mode\n");
+    printf("                (default: 1).\n");
+    printf("\n");
     printf("        If the imported product is empty, a warning will be printed and the\n");
     printf("        tool will return with exit code 2 (without writing a file).\n");
+    printf("        In batch mode the tool returns with exit code 1 if any product could\n");
+    printf("        not be converted, and otherwise with exit code 2 if any product was\n");
+    printf("        empty.\n");
     printf("\n");
     printf("    harpconvert --generate-documentation [output directory]\n");
     printf("        Generate a series of documentation files in the specified output\n");
@@ -133,34 +236,554 @@ static int generate_doc(int argc, char *argv[])
     return 0;
 }
 
-static int convert(int argc, char *argv[])
+/* Convert a single product; returns 0 on success, -1 on error, and -2 if the product is empty (no file is written) */
+static int convert_file(const convert_info *info, harp_program *program, const char *input_filename,
+                        const char *output_filename)
+{
+    harp_product *product;
+
+    if (harp_import_with_program(input_filename, program, info->options, &product) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_is_empty(product))
+    {
+        harp_product_delete(product);
+        return -2;
+    }
+
+    /* Update the product */
+    if (harp_product_update_history(product, "harpconvert", info->argc, info->argv) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+
+    /* Export the product */
+    if (harp_export(output_filename, info->output_format, product) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+
+    harp_product_delete(product);
+    return 0;
+}
+
+/* Import a single product once and export the result of each branch of operations to its own output file.
+ * Returns 0 on success, -1 on error, and -2 if the imported product is empty (no file is written).
+ */
+static int convert_file_branches(const convert_info *info, harp_program *program, const char *input_filename,
+                                 int num_branches, char **branch_operations, char **branch_output_filename)
 {
     harp_product *product;
-    const char *operations = NULL;
-    const char *options = NULL;
-    const char *output_filename = NULL;
-    const char *output_format = "netcdf";
-    const char *input_filename = NULL;
     int i;
 
+    if (harp_import_with_program(input_filename, program, info->options, &product) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_product_is_empty(product))
+    {
+        harp_product_delete(product);
+        return -2;
+    }
+
+    if (harp_product_update_history(product, "harpconvert", info->argc, info->argv) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+
+    /* the product itself is not modified by the export, so each branch starts from the same product */
+    for (i = 0; i < num_branches; i++)
+    {
+        if (harp_export_with_operations(branch_output_filename[i], info->output_format, product,
+                                        branch_operations[i]) != 0)
+        {
+            harp_product_delete(product);
+            return -1;
+        }
+    }
+
+    harp_product_delete(product);
+    return 0;
+}
+
+/* Perform the conversion of a job and report its outcome */
+static void convert_job_run(const convert_info *info, harp_program *program, convert_job *job)
+{
+    job->result = convert_file(info, program, job->input_filename, job->output_filename);
+    if (job->result == -1)
+    {
+        fprintf(stderr, "ERROR: %s (%s)\n", harp_errno_to_string(harp_errno), job->input_filename);
+    }
+    else if (job->result == -2)
+    {
+        harp_report_warning("product is empty (%s)", job->input_filename);
+    }
+}
+
+static void convert_jobs_delete(long num_jobs, convert_job *job)
+{
+    long i;
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        if (job[i].input_filename != NULL)
+        {
+            free(job[i].input_filename);
+        }
+        if (job[i].output_filename != NULL)
+        {
+            free(job[i].output_filename);
+        }
+    }
+    free(job);
+}
+
+/* Add a job to the list of jobs; takes ownership of both filenames (also on error) */
+static int convert_jobs_add(long *num_jobs, convert_job **job, char *input_filename, char *output_filename)
+{
+    if (input_filename == NULL || output_filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        free(input_filename);
+        free(output_filename);
+        return -1;
+    }
+    if (*num_jobs % 64 == 0)
+    {
+        convert_job *new_job;
+
+        new_job = realloc(*job, (*num_jobs + 64) * sizeof(convert_job));
+        if (new_job == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (*num_jobs + 64) * sizeof(convert_job), __FILE__, __LINE__);
+            free(input_filename);
+            free(output_filename);
+            return -1;
+        }
+        *job = new_job;
+    }
+    (*job)[*num_jobs].input_filename = input_filename;
+    (*job)[*num_jobs].output_filename = output_filename;
+    (*job)[*num_jobs].result = 0;
+    (*num_jobs)++;
+
+    return 0;
+}
+
+/* Read the input/output pairs from a list file ('-' for standard input) */
+static int read_list_file(const char *list_filename, long *num_jobs, convert_job **job)
+{
+    char line[MAX_LIST_LINE_LENGTH];
+    long line_number = 0;
+    int result = 0;
+    FILE *stream;
+
+    if (strcmp(list_filename, "-") == 0)
+    {
+        stream = stdin;
+    }
+    else
+    {
+        stream = fopen(list_filename, "r");
+        if (stream == NULL)
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "could not open list file '%s'", list_filename);
+            return -1;
+        }
+    }
+
+    while (fgets(line, MAX_LIST_LINE_LENGTH, stream) != NULL)
+    {
+        char *input_filename;
+        char *output_filename;
+        char *cursor;
+        long length;
+
+        line_number++;
+        length = (long)strlen(line);
+        if (length == MAX_LIST_LINE_LENGTH - 1 && line[length - 1] != '\n')
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "line %ld of list file '%s' is too long", line_number,
+                           list_filename);
+            result = -1;
+            break;
+        }
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' ' ||
+                              line[length - 1] == '\t'))
+        {
+            length--;
+        }
+        line[length] = '\0';
+
+        cursor = line;
+        while (*cursor == ' ' || *cursor == '\t')
+        {
+            cursor++;
+        }
+        if (*cursor == '\0' || *cursor == '#')
+        {
+            continue;
+        }
+        input_filename = cursor;
+        while (*cursor != '\0' && *cursor != ' ' && *cursor != '\t')
+        {
+            cursor++;
+        }
+        if (*cursor != '\0')
+        {
+            *cursor = '\0';
+            cursor++;
+            while (*cursor == ' ' || *cursor == '\t')
+            {
+                cursor++;
+            }
+        }
+        output_filename = cursor;
+        if (*output_filename == '\0' || strchr(output_filename, ' ') != NULL || strchr(output_filename, '\t') != NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "line %ld of list file '%s' should contain an input and an "
+                           "output filename", line_number, list_filename);
+            result = -1;
+            break;
+        }
+        if (convert_jobs_add(num_jobs, job, strdup(input_filename), strdup(output_filename)) != 0)
+        {
+            result = -1;
+            break;
+        }
+    }
+    if (result == 0 && ferror(stream))
+    {
+        harp_set_error(HARP_ERROR_FILE_READ, "could not read list file '%s'", list_filename);
+        result = -1;
+    }
+    if (stream != stdin)
+    {
+        fclose(stream);
+    }
+
+    return result;
+}
+
+/* Determine the output filename for an input file when using --output-directory */
+static char *get_output_filename(const char *output_directory, const char *input_filename, const char *output_format)
+{
+    const char *basename = harp_basename(input_filename);
+    const char *extension;
+    const char *dot;
+    char *output_filename;
+    long length;
+
+    if (strcmp(output_format, "hdf4") == 0)
+    {
+        extension = ".hdf";
+    }
+    else if (strcmp(output_format, "hdf5") == 0)
+    {
+        extension = ".h5";
+    }
+    else if (strcmp(output_format, "zarr") == 0)
+    {
+        extension = ".zarr";
+    }
+    else if (strcmp(output_format, "arrow") == 0)
+    {
+        extension = ".arrow";
+    }
+    else
+    {
+        extension = ".nc";
+    }
+    dot = strrchr(basename, '.');
+    length = (dot != NULL && dot != basename) ? (long)(dot - basename) : (long)strlen(basename);
+
+    output_filename = malloc(strlen(output_directory) + 1 + length + strlen(extension) + 1);
+    if (output_filename == NULL)
+    {
+        return NULL;
+    }
+    sprintf(output_filename, "%s/%.*s%s", output_directory, (int)length, basename, extension);
+
+    return output_filename;
+}
+
+#ifdef HAVE_PTHREAD_H
+/* shared administration for the threads that perform the jobs of a batch conversion */
+typedef struct convert_threads_struct
+{
+    const convert_info *info;
+    long num_jobs;
+    convert_job *job;
+    pthread_mutex_t mutex;      /* protects next_job */
+    long next_job;
+} convert_threads;
+
+typedef struct convert_thread_struct
+{
+    pthread_t thread;
+    convert_threads *threads;
+    harp_program *program;      /* compiled operations; a program can not be shared between threads */
+} convert_thread;
+
+static void *convert_thread_run(void *arg)
+{
+    convert_threads *threads = ((convert_thread *)arg)->threads;
+    long i;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&threads->mutex);
+        i = threads->next_job;
+        threads->next_job++;
+        pthread_mutex_unlock(&threads->mutex);
+        if (i >= threads->num_jobs)
+        {
+            break;
+        }
+        convert_job_run(threads->info, ((convert_thread *)arg)->program, &threads->job[i]);
+    }
+
+    return NULL;
+}
+
+static int convert_jobs_using_threads(const convert_info *info, long num_jobs, convert_job *job)
+{
+    convert_threads threads;
+    convert_thread *thread;
+    int num_threads = 0;
+    int result = 0;
+    int i;
+
+    threads.info = info;
+    threads.num_jobs = num_jobs;
+    threads.job = job;
+    threads.next_job = 0;
+
+    thread = malloc(info->num_threads * sizeof(convert_thread));
+    if (thread == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->num_threads * sizeof(convert_thread), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->num_threads; i++)
+    {
+        thread[i].threads = &threads;
+        thread[i].program = NULL;
+    }
+    if (info->operations != NULL)
+    {
+        for (i = 0; i < info->num_threads; i++)
+        {
+            if (harp_program_from_string(info->operations, &thread[i].program) != 0)
+            {
+                while (i > 0)
+                {
+                    i--;
+                    harp_program_delete(thread[i].program);
+                }
+                free(thread);
+                return -1;
+            }
+        }
+    }
+    pthread_mutex_init(&threads.mutex, NULL);
+
+    while (num_threads < info->num_threads)
+    {
+        if (pthread_create(&thread[num_threads].thread, NULL, convert_thread_run, &thread[num_threads]) != 0)
+        {
+            if (num_threads == 0)
+            {
+                harp_set_error(HARP_ERROR_OPERATION, "could not create conversion thread");
+                result = -1;
+            }
+            /* continue with the threads that we have */
+            break;
+        }
+        num_threads++;
+    }
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(thread[i].thread, NULL);
+    }
+
+    pthread_mutex_destroy(&threads.mutex);
+    for (i = 0; i < info->num_threads; i++)
+    {
+        if (thread[i].program != NULL)
+        {
+            harp_program_delete(thread[i].program);
+        }
+    }
+    free(thread);
+
+    return result;
+}
+#endif
+
+/* Perform all jobs of a batch conversion.
+ * Returns -1 if the conversion could not be started, -3 if one or more products could not be converted (the errors
+ * have then already been reported), -4 if one or more products were empty, and 0 otherwise.
+ */
+static int convert_jobs(const convert_info *info, long num_jobs, convert_job *job)
+{
+    int num_empty = 0;
+    int num_failed = 0;
+    long i;
+
+#ifdef HAVE_PTHREAD_H
+    if (info->num_threads > 1 && num_jobs > 1)
+    {
+        if (convert_jobs_using_threads(info, num_jobs, job) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+#endif
+    {
+        harp_program *program = NULL;
+
+        if (info->operations != NULL)
+        {
+            /* compile the operations once instead of for each product */
+            if (harp_program_from_string(info->operations, &program) != 0)
+            {
+                return -1;
+            }
+        }
+        for (i = 0; i < num_jobs; i++)
+        {
+            if (i + 1 < num_jobs)
+            {
+                harp_prefetch_file(job[i + 1].input_filename);
+            }
+            convert_job_run(info, program, &job[i]);
+        }
+        if (program != NULL)
+        {
+            harp_program_delete(program);
+        }
+    }
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        if (job[i].result == -1)
+        {
+            num_failed++;
+        }
+        else if (job[i].result == -2)
+        {
+            num_empty++;
+        }
+    }
+    if (num_failed > 0)
+    {
+        fprintf(stderr, "ERROR: %d of %ld products could not be converted\n", num_failed, num_jobs);
+        return -3;
+    }
+    if (num_empty > 0)
+    {
+        return -4;
+    }
+
+    return 0;
+}
+
+static int convert(int argc, char *argv[])
+{
+    convert_info info;
+    convert_job *job = NULL;
+    const char *list_filename = NULL;
+    const char *output_directory = NULL;
+    char **branch_operations = NULL;
+    char **branch_output_filename = NULL;
+    int num_branches = 0;
+    long num_jobs = 0;
+    int result;
+    int i;
+
+    info.operations = NULL;
+    info.options = NULL;
+    info.output_format = "netcdf";
+    info.num_threads = 1;
+    info.argc = argc;
+    info.argv = argv;
+
     for (i = 1; i < argc; i++)
     {
         if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--operations") == 0) && i + 1 < argc &&
             argv[i + 1][0] != '-')
         {
-            operations = argv[i + 1];
+            info.operations = argv[i + 1];
             i++;
         }
         else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) && i + 1 < argc
                  && argv[i + 1][0] != '-')
         {
-            output_format = argv[i + 1];
+            info.output_format = argv[i + 1];
             i++;
         }
         else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc
                  && argv[i + 1][0] != '-')
         {
-            options = argv[i + 1];
+            info.options = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            list_filename = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--output-directory") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            output_directory = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--branch") == 0 && i + 2 < argc && argv[i + 2][0] != '-')
+        {
+            if (num_branches == 0)
+            {
+                /* there can never be more branches than arguments */
+                branch_operations = malloc(argc * sizeof(char *));
+                branch_output_filename = malloc(argc * sizeof(char *));
+                if (branch_operations == NULL || branch_output_filename == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   argc * sizeof(char *), __FILE__, __LINE__);
+                    free(branch_operations);
+                    free(branch_output_filename);
+                    return -1;
+                }
+            }
+            branch_operations[num_branches] = argv[i + 1];
+            branch_output_filename[num_branches] = argv[i + 2];
+            num_branches++;
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            long value;
+
+            value = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || value < 1 || value > MAX_NUM_THREADS)
+            {
+                fprintf(stderr, "ERROR: invalid %s argument: '%s' (expected a value between 1 and %d)\n", argv[i],
+                        argv[i + 1], MAX_NUM_THREADS);
+                print_help();
+                return -1;
+            }
+            info.num_threads = (int)value;
             i++;
         }
         else if (strcmp(argv[i], "--hdf5-compression") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
@@ -173,6 +796,78 @@ static int convert(int argc, char *argv[])
             }
             i++;
         }
+        else if (strcmp(argv[i], "--hdf5-compression-filter") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_compression_filter(argv[i + 1]) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 compression filter argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-chunk-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_chunk_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 chunk size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-page-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_page_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 page size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--zarr-chunk-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_zarr_chunk_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid zarr chunk size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--arrow-batch-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_arrow_batch_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid arrow batch size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--buffer-pool") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_buffer_pool_size((int64_t)strtod(argv[i + 1], NULL)) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid buffer pool argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+        {
+            harp_set_option_profile(1);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_trace(argv[i + 1]) != 0)
+            {
+                return -1;
+            }
+            i++;
+        }
         else if (argv[i][0] != '-')
         {
             /* Assume the next argument is an input file. */
@@ -186,43 +881,106 @@ static int convert(int argc, char *argv[])
         }
     }
 
-    if (i != argc - 2)
+    if (num_branches > 0)
     {
-        fprintf(stderr, "ERROR: input and/or output product file not specified\n");
-        print_help();
-        return -1;
-    }
+        harp_program *program = NULL;
 
-    input_filename = argv[argc - 2];
-    output_filename = argv[argc - 1];
+        if (list_filename != NULL || output_directory != NULL)
+        {
+            fprintf(stderr, "ERROR: --branch can not be combined with --batch or --output-directory\n");
+            print_help();
+            result = -1;
+        }
+        else if (i != argc - 1)
+        {
+            fprintf(stderr, "ERROR: a single input product file needs to be specified with --branch\n");
+            print_help();
+            result = -1;
+        }
+        else if (info.operations != NULL && harp_program_from_string(info.operations, &program) != 0)
+        {
+            result = -1;
+        }
+        else
+        {
+            result = convert_file_branches(&info, program, argv[argc - 1], num_branches, branch_operations,
+                                           branch_output_filename);
+            if (program != NULL)
+            {
+                harp_program_delete(program);
+            }
+        }
+        free(branch_operations);
+        free(branch_output_filename);
+        return result;
+    }
 
-    if (harp_import(input_filename, operations, options, &product) != 0)
+    if (list_filename != NULL && output_directory != NULL)
     {
+        fprintf(stderr, "ERROR: --batch and --output-directory can not be combined\n");
+        print_help();
         return -1;
     }
 
-    if (harp_product_is_empty(product))
+    if (list_filename == NULL && output_directory == NULL)
     {
-        harp_product_delete(product);
-        return -2;
+        harp_program *program = NULL;
+
+        if (i != argc - 2)
+        {
+            fprintf(stderr, "ERROR: input and/or output product file not specified\n");
+            print_help();
+            return -1;
+        }
+        if (info.operations != NULL && harp_program_from_string(info.operations, &program) != 0)
+        {
+            return -1;
+        }
+        result = convert_file(&info, program, argv[argc - 2], argv[argc - 1]);
+        if (program != NULL)
+        {
+            harp_program_delete(program);
+        }
+        return result;
     }
 
-    /* Update the product */
-    if (harp_product_update_history(product, "harpconvert", argc, argv) != 0)
+    if (list_filename != NULL)
     {
-        harp_product_delete(product);
-        return -1;
+        if (i != argc)
+        {
+            fprintf(stderr, "ERROR: product files can not be specified on the command line with --batch\n");
+            print_help();
+            return -1;
+        }
+        if (read_list_file(list_filename, &num_jobs, &job) != 0)
+        {
+            convert_jobs_delete(num_jobs, job);
+            return -1;
+        }
     }
-
-    /* Export the product */
-    if (harp_export(output_filename, output_format, product) != 0)
+    else
     {
-        harp_product_delete(product);
-        return -1;
+        if (i == argc)
+        {
+            fprintf(stderr, "ERROR: input product file(s) not specified\n");
+            print_help();
+            return -1;
+        }
+        for (; i < argc; i++)
+        {
+            if (convert_jobs_add(&num_jobs, &job, strdup(argv[i]),
+                                 get_output_filename(output_directory, argv[i], info.output_format)) != 0)
+            {
+                convert_jobs_delete(num_jobs, job);
+                return -1;
+            }
+        }
     }
 
-    harp_product_delete(product);
-    return 0;
+    result = convert_jobs(&info, num_jobs, job);
+    convert_jobs_delete(num_jobs, job);
+
+    return result;
 }
 
 int main(int argc, char *argv[])
@@ -291,6 +1049,12 @@ int main(int argc, char *argv[])
         harp_done();
         exit(2);
     }
+    else if (result == -3 || result == -4)
+    {
+        /* batch conversion for which errors/warnings were already reported for each product */
+        harp_done();
+        exit(result == -3 ? 1 : 2);
+    }
     else if (result == 1)
     {
         fprintf(stderr, "ERROR: invalid arguments\n");
@@ -39,6 +39,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#define OUTPUT_BUFFER_SIZE 1048576
+
+typedef enum data_format_enum
+{
+    data_format_text,
+    data_format_raw,
+    data_format_csv,
+    data_format_binary
+} data_format;
+
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+static long output_length = 0;
 
 static int print_warning(const char *message, va_list ap)
 {
@@ -83,6 +100,17 @@ static void print_help()
     printf("            -d, --data\n");
     printf("                Show data values for each variable.\n");
     printf("\n");
+    printf("            -f, --format <format>\n");
+    printf("                Only write the data of the variables using the given format:\n");
+    printf("                    raw: one value per line (variables in product order)\n");
+    printf("                    csv: one column per variable (all variables need to\n");
+    printf("                         have the same number of elements)\n");
+    printf("                    binary: the data of all variables as a sequence of\n");
+    printf("                         native (machine byte order) values\n");
+    printf("                Floating point values are written using the shortest\n");
+    printf("                representation that reads back as the same value.\n");
+    printf("                Use e.g. -a 'keep(...)' to select the variables.\n");
+    printf("\n");
     printf("    harpdump --dataset [options] <file|dir> [<file|dir> ...]\n");
     printf("        Print metadata for all files in the dataset in csv format.\n");
     printf("\n");
@@ -241,13 +269,279 @@ static int dump_dataset(int argc, char *argv[])
     return 0;
 }
 
+static void output_flush(void)
+{
+    if (output_length > 0)
+    {
+        fwrite(output_buffer, 1, output_length, stdout);
+        output_length = 0;
+    }
+}
+
+static void output_write(const char *str, long length)
+{
+    if (output_length + length > OUTPUT_BUFFER_SIZE)
+    {
+        output_flush();
+        if (length > OUTPUT_BUFFER_SIZE)
+        {
+            fwrite(str, 1, length, stdout);
+            return;
+        }
+    }
+    memcpy(&output_buffer[output_length], str, length);
+    output_length += length;
+}
+
+static void output_char(char c)
+{
+    if (output_length == OUTPUT_BUFFER_SIZE)
+    {
+        output_flush();
+    }
+    output_buffer[output_length] = c;
+    output_length++;
+}
+
+static void output_long(long value)
+{
+    char digits[24];
+    unsigned long magnitude;
+    int length = 0;
+
+    magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    do
+    {
+        digits[sizeof(digits) - 1 - length] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+        length++;
+    } while (magnitude > 0);
+    if (value < 0)
+    {
+        digits[sizeof(digits) - 1 - length] = '-';
+        length++;
+    }
+    output_write(&digits[sizeof(digits) - length], length);
+}
+
+static int output_special_value(double value)
+{
+    if (harp_isnan(value))
+    {
+        output_write("nan", 3);
+        return 1;
+    }
+    if (harp_isplusinf(value))
+    {
+        output_write("inf", 3);
+        return 1;
+    }
+    if (harp_ismininf(value))
+    {
+        output_write("-inf", 4);
+        return 1;
+    }
+    return 0;
+}
+
+/* Write the shortest representation (using at least 7 significant digits) that reads back as the same float */
+static void output_float(float value)
+{
+    char str[32];
+    int precision;
+    int length;
+
+    if (output_special_value(value))
+    {
+        return;
+    }
+    for (precision = 7; precision < 9; precision++)
+    {
+        length = sprintf(str, "%.*g", precision, (double)value);
+        if ((float)strtod(str, NULL) == value)
+        {
+            output_write(str, length);
+            return;
+        }
+    }
+    length = sprintf(str, "%.9g", (double)value);
+    output_write(str, length);
+}
+
+/* Write the shortest representation (using at least 15 significant digits) that reads back as the same double */
+static void output_double(double value)
+{
+    char str[32];
+    int precision;
+    int length;
+
+    if (output_special_value(value))
+    {
+        return;
+    }
+    for (precision = 15; precision < 17; precision++)
+    {
+        length = sprintf(str, "%.*g", precision, value);
+        if (strtod(str, NULL) == value)
+        {
+            output_write(str, length);
+            return;
+        }
+    }
+    length = sprintf(str, "%.17g", value);
+    output_write(str, length);
+}
+
+static void output_string(const char *str, int quote)
+{
+    const char *quote_char;
+
+    if (str == NULL)
+    {
+        return;
+    }
+    if (!quote)
+    {
+        output_write(str, (long)strlen(str));
+        return;
+    }
+
+    /* csv quoting: enclose in double quotes and double each embedded double quote */
+    output_char('"');
+    while ((quote_char = strchr(str, '"')) != NULL)
+    {
+        output_write(str, (long)(quote_char - str) + 1);
+        output_char('"');
+        str = quote_char + 1;
+    }
+    output_write(str, (long)strlen(str));
+    output_char('"');
+}
+
+static void output_value(const harp_variable *variable, long index, int quote)
+{
+    switch (variable->data_type)
+    {
+        case harp_type_int8:
+            output_long(variable->data.int8_data[index]);
+            break;
+        case harp_type_int16:
+            output_long(variable->data.int16_data[index]);
+            break;
+        case harp_type_int32:
+            output_long(variable->data.int32_data[index]);
+            break;
+        case harp_type_float:
+            output_float(variable->data.float_data[index]);
+            break;
+        case harp_type_double:
+            output_double(variable->data.double_data[index]);
+            break;
+        case harp_type_string:
+            output_string(variable->data.string_data[index], quote);
+            break;
+    }
+}
+
+static int dump_data_raw(const harp_product *product)
+{
+    int i;
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        const harp_variable *variable = product->variable[i];
+        long j;
+
+        for (j = 0; j < variable->num_elements; j++)
+        {
+            output_value(variable, j, 0);
+            output_char('\n');
+        }
+    }
+    output_flush();
+
+    return 0;
+}
+
+static int dump_data_csv(const harp_product *product)
+{
+    long num_elements;
+    long j;
+    int i;
+
+    if (product->num_variables == 0)
+    {
+        return 0;
+    }
+
+    num_elements = product->variable[0]->num_elements;
+    for (i = 1; i < product->num_variables; i++)
+    {
+        if (product->variable[i]->num_elements != num_elements)
+        {
+            fprintf(stderr, "ERROR: variable '%s' has %ld elements (expected %ld) (all variables need to have the "
+                    "same number of elements for csv output)\n", product->variable[i]->name,
+                    product->variable[i]->num_elements, num_elements);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        output_string(product->variable[i]->name, 0);
+        output_char(i < product->num_variables - 1 ? ',' : '\n');
+    }
+    for (j = 0; j < num_elements; j++)
+    {
+        for (i = 0; i < product->num_variables; i++)
+        {
+            output_value(product->variable[i], j, 1);
+            output_char(i < product->num_variables - 1 ? ',' : '\n');
+        }
+    }
+    output_flush();
+
+    return 0;
+}
+
+static int dump_data_binary(const harp_product *product)
+{
+    int i;
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        if (product->variable[i]->data_type == harp_type_string)
+        {
+            fprintf(stderr, "ERROR: variable '%s' is of type string (not supported for binary output)\n",
+                    product->variable[i]->name);
+            return -1;
+        }
+    }
+
+#ifdef WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    for (i = 0; i < product->num_variables; i++)
+    {
+        const harp_variable *variable = product->variable[i];
+
+        output_write((const char *)variable->data.ptr,
+                     variable->num_elements * harp_get_size_for_type(variable->data_type));
+    }
+    output_flush();
+
+    return 0;
+}
+
 static int dump(int argc, char *argv[])
 {
     const char *operations = NULL;
     const char *options = NULL;
     harp_product *product;
+    data_format format = data_format_text;
     int data = 0;
     int list = 0;
+    int result;
     int i;
 
     /* parse arguments */
@@ -273,6 +567,29 @@ static int dump(int argc, char *argv[])
         {
             data = 1;
         }
+        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) && i + 1 < argc &&
+                 argv[i + 1][0] != '-')
+        {
+            if (strcmp(argv[i + 1], "raw") == 0)
+            {
+                format = data_format_raw;
+            }
+            else if (strcmp(argv[i + 1], "csv") == 0)
+            {
+                format = data_format_csv;
+            }
+            else if (strcmp(argv[i + 1], "binary") == 0)
+            {
+                format = data_format_binary;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: invalid format '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
         else if (argv[i][0] != '-')
         {
             /* assume all arguments from here on are files */
@@ -308,11 +625,26 @@ static int dump(int argc, char *argv[])
         }
     }
 
-    harp_product_print(product, !list, data && !list, printf);
+    switch (format)
+    {
+        case data_format_raw:
+            result = dump_data_raw(product);
+            break;
+        case data_format_csv:
+            result = dump_data_csv(product);
+            break;
+        case data_format_binary:
+            result = dump_data_binary(product);
+            break;
+        default:
+            harp_product_print(product, !list, data && !list, printf);
+            result = 0;
+            break;
+    }
 
     harp_product_delete(product);
 
-    return 0;
+    return result;
 }
 
 int main(int argc, char *argv[])
@@ -347,6 +679,9 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+    /* use a large (fully buffered) output buffer; harpdump can produce a lot of output when showing data */
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
     harp_set_warning_handler(print_warning);
 
     if (harp_init() != 0)
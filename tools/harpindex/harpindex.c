@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "harp.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum value for the --threads option */
+#define MAX_NUM_THREADS 1024
+
+static int print_warning(const char *message, va_list ap)
+{
+    int result;
+
+    fprintf(stderr, "WARNING: ");
+    result = vfprintf(stderr, message, ap);
+    fprintf(stderr, "\n");
+
+    return result;
+}
+
+static void print_version()
+{
+    printf("harpindex version %s\n", libharp_version);
+    printf("Copyright (C) 2015-2018 S[&]T, The Netherlands.\n\n");
+}
+
+static void print_help()
+{
+    printf("Usage:\n");
+    printf("    harpindex [options] <file|dir> [<file|dir> ...] <index file>\n");
+    printf("        Create an archive index for all products as specified by the file\n");
+    printf("        and directory paths. The archive index contains the metadata of\n");
+    printf("        each product (filename, datetime range, spatial extent, dimension\n");
+    printf("        lengths, and source product) together with a spatio-temporal\n");
+    printf("        index. The index file should have the extension .harpidx.\n");
+    printf("        An archive index can be used as path for harpmerge and\n");
+    printf("        harpcollocate, which will then only retrieve the products that can\n");
+    printf("        pass the leading datetime, latitude, and longitude filters of the\n");
+    printf("        operations. An existing index file is replaced.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            -o, --options <option list>\n");
+    printf("                List of options to pass to the ingestion module.\n");
+    printf("                Only applicable if the input products are not in HARP format.\n");
+    printf("                Options are separated by semi-colons. Each option consists\n");
+    printf("                of an <option name>=<value> pair. An option list needs to be\n");
+    printf("                provided as a single expression.\n");
+    printf("                The index can only be used with the same ingestion options.\n");
+    printf("\n");
+    printf("            --threads <N>\n");
+    printf("                Use N threads to retrieve the metadata of the products\n");
+    printf("                (default: 1).\n");
+    printf("\n");
+    printf("    harpindex --query [options] <index file>\n");
+    printf("        Print the filenames of the products in the archive index (in order\n");
+    printf("        of their source product) that can pass the leading datetime,\n");
+    printf("        latitude, and longitude filters of the operations.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            -a, --operations <operation list>\n");
+    printf("                List of operations that would be applied to each product.\n");
+    printf("                An operation list needs to be provided as a single expression.\n");
+    printf("                See the 'operations' section of the HARP documentation for\n");
+    printf("                more details.\n");
+    printf("\n");
+    printf("            -o, --options <option list>\n");
+    printf("                The ingestion options that were used to create the index.\n");
+    printf("\n");
+    printf("    harpindex -h, --help\n");
+    printf("        Show help (this text).\n");
+    printf("\n");
+    printf("    harpindex -v, --version\n");
+    printf("        Print the version number of HARP and exit.\n");
+    printf("\n");
+}
+
+static int query(int argc, char *argv[])
+{
+    harp_dataset *dataset;
+    const char *operations = NULL;
+    const char *options = NULL;
+    long i;
+
+    for (i = 2; i < argc - 1; i++)
+    {
+        if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--operations") == 0) && i + 1 < argc - 1)
+        {
+            operations = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc - 1)
+        {
+            options = argv[i + 1];
+            i++;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: invalid argument: '%s'\n", argv[i]);
+            print_help();
+            return -1;
+        }
+    }
+    if (i != argc - 1 || argv[i][0] == '-')
+    {
+        fprintf(stderr, "ERROR: index file not specified\n");
+        print_help();
+        return -1;
+    }
+
+    if (harp_dataset_new(&dataset) != 0)
+    {
+        return -1;
+    }
+    if (harp_dataset_import_with_prefilter(dataset, argv[argc - 1], options, operations) != 0)
+    {
+        harp_dataset_delete(dataset);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        printf("%s\n", dataset->metadata[dataset->sorted_index[i]]->filename);
+    }
+    harp_dataset_delete(dataset);
+
+    return 0;
+}
+
+static int create(int argc, char *argv[])
+{
+    harp_dataset *dataset;
+    const char *options = NULL;
+    int i, j;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc &&
+            argv[i + 1][0] != '-')
+        {
+            options = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *endptr;
+            long value = strtol(argv[i + 1], &endptr, 10);
+
+            if (*endptr != '\0' || value < 1 || value > MAX_NUM_THREADS)
+            {
+                fprintf(stderr, "ERROR: invalid number of threads: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            if (harp_set_option_num_threads((int)value) != 0)
+            {
+                return -1;
+            }
+            i++;
+        }
+        else if (argv[i][0] != '-')
+        {
+            /* assume all arguments from here on are files */
+            break;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: invalid argument: '%s'\n", argv[i]);
+            print_help();
+            return -1;
+        }
+    }
+    if (i >= argc - 1)
+    {
+        fprintf(stderr, "ERROR: %s not specified\n", i == argc ? "input product file" : "index file");
+        print_help();
+        return -1;
+    }
+
+    if (harp_dataset_new(&dataset) != 0)
+    {
+        return -1;
+    }
+    for (j = i; j < argc - 1; j++)
+    {
+        if (harp_dataset_import(dataset, argv[j], options) != 0)
+        {
+            harp_dataset_delete(dataset);
+            return -1;
+        }
+    }
+    if (harp_dataset_write_archive_index(dataset, argv[argc - 1], options) != 0)
+    {
+        harp_dataset_delete(dataset);
+        return -1;
+    }
+    harp_dataset_delete(dataset);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+
+    if (argc == 1 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
+    {
+        print_help();
+        exit(0);
+    }
+
+    if (strcmp(argv[1], "-v") == 0 || strcmp(argv[1], "--version") == 0)
+    {
+        print_version();
+        exit(0);
+    }
+
+    if (harp_set_coda_definition_path_conditional(argv[0], NULL, "../share/coda/definitions") != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+    if (harp_set_udunits2_xml_path_conditional(argv[0], NULL, "../share/harp/udunits2.xml") != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    harp_set_warning_handler(print_warning);
+
+    if (harp_init() != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    if (strcmp(argv[1], "--query") == 0)
+    {
+        result = query(argc, argv);
+    }
+    else
+    {
+        result = create(argc, argv);
+    }
+    if (result != 0)
+    {
+        if (harp_errno != HARP_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        }
+        harp_done();
+        exit(1);
+    }
+
+    harp_done();
+
+    return 0;
+}
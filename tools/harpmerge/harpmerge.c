@@ -35,9 +35,63 @@
 
 #include "harp.h"
 
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* name of the temporary variable that holds the partition of each sample (see get_partitions()) */
+#define PARTITION_VARIABLE_NAME "harpmerge_partition"
+
+/* partition key for samples that do not belong to any partition */
+#define INVALID_PARTITION_KEY LONG_MIN
+
+/* maximum value for the --threads and --max-pending options */
+#define MAX_NUM_THREADS 1024
+#define MAX_NUM_PENDING 65536
+
+/* number of products (in sorted order) after the product that is being imported for which the file content is
+ * prefetched */
+#define PREFETCH_DEPTH 4
+
+/* settings for writing a separate product for each time partition of the merged product (--partition) */
+typedef struct merge_partition_struct
+{
+    long length;        /* length of a partition in seconds, or in samples if by_samples is set */
+    int by_samples;     /* partitions consist of a fixed number of consecutive samples instead of a time interval */
+} merge_partition;
+
+/* administration for writing the merged product directly to the output file (--stream) */
+typedef struct merge_stream_struct
+{
+    harp_export_stream *stream; /* NULL if no partition is being written (only with partitions) */
+    int argc;   /* command line arguments (for the history of the output file) */
+    char **argv;
+    long num_products;  /* number of products that have been written (to the current partition) */
+    const merge_partition *partition;   /* if set, each partition is written to its own output file */
+    const char *output_filename;
+    const char *output_format;
+    char *partition_filename;   /* output file of the current partition */
+    long partition_key; /* key of the current partition (see get_partitions()) */
+    long num_partitions;        /* number of partitions that have been written */
+    long num_samples;   /* number of samples that have been assigned to partitions */
+} merge_stream;
+
+typedef struct merge_info_struct
+{
+    const char *operations;
+    const char *options;
+    int verbose;
+    int num_threads;    /* number of threads that import products */
+    int max_pending;    /* maximum number of imported products that are waiting to be appended */
+    harp_spatial_accumulator *accumulator;      /* if set, products are spatially binned instead of concatenated */
+    long chunk_size;    /* if > 0, products are imported and binned in chunks of this many samples (--chunk-size) */
+    merge_stream *stream;       /* if set, products are written to the output file instead of concatenated in memory */
+} merge_info;
 
 static int print_warning(const char *message, va_list ap)
 {
@@ -62,6 +116,9 @@ static void print_help()
     printf("    harpmerge [options] <file|dir> [<file|dir> ...] <output product file>\n");
     printf("        Concatenate all products as specified by the file and directory paths\n");
     printf("        into a single product.\n");
+    printf("        A path can also be a .pth file or an archive index file\n");
+    printf("        (.harpidx, see harpindex), for which only the products that can\n");
+    printf("        pass the leading filters of the operations are retrieved.\n");
     printf("\n");
     printf("        Options:\n");
     printf("            -a, --operations <operation list>\n");
@@ -70,6 +127,10 @@ static void print_help()
     printf("                See the 'operations' section of the HARP documentation for\n");
     printf("                more details.\n");
     printf("                Operations will be performed before a product is appended.\n");
+    printf("                Products for which a datetime, latitude, or longitude filter\n");
+    printf("                at the start of the operations excludes all samples\n");
+    printf("                (according to the datetime range or spatial extent of the\n");
+    printf("                product) are skipped without being imported.\n");
     printf("\n");
     printf("            -ap, --post-operations <operation list>\n");
     printf("                List of operations to apply to the merged product.\n");
@@ -92,11 +153,153 @@ static void print_help()
     printf("                    netcdf (default)\n");
     printf("                    hdf4\n");
     printf("                    hdf5\n");
+    printf("                    zarr (a directory with a file per chunk)\n");
+    printf("                    arrow (export only; all variables need to depend on time)\n");
+    printf("\n");
+    printf("            --threads <N>\n");
+    printf("                Use N threads to import the products (default: 1).\n");
+    printf("                Products are still appended in the same order as when\n");
+    printf("                using a single thread, so the merged product is the same.\n");
+    printf("\n");
+    printf("            --max-pending <M>\n");
+    printf("                Keep at most M imported products in memory that are waiting\n");
+    printf("                to be appended (default: 2*N). Only used with --threads.\n");
+    printf("\n");
+    printf("            --bin-spatial <lat_edge_length>,<lat_edge_offset>,<lat_edge_step>,\n");
+    printf("                          <lon_edge_length>,<lon_edge_offset>,<lon_edge_step>\n");
+    printf("                Spatially bin each product onto the given latitude/longitude grid\n");
+    printf("                and accumulate the result, instead of concatenating the products.\n");
+    printf("                The grid is defined as for the bin_spatial() operation. The result\n");
+    printf("                is the same as applying bin_spatial() to the merged product, but\n");
+    printf("                memory usage only depends on the size of the grid.\n");
+    printf("                Operations (-a) are performed before a product is binned and\n");
+    printf("                post-operations (-ap) are performed on the binned result.\n");
+    printf("\n");
+    printf("            --chunk-size <samples>\n");
+    printf("                With --bin-spatial, import each product in chunks of at most\n");
+    printf("                the given number of time samples and bin each chunk as soon as\n");
+    printf("                it has been read, such that a product is never kept in memory\n");
+    printf("                as a whole (for products that are not in HARP format, memory\n");
+    printf("                usage is one chunk plus the grid). Only operations that treat\n");
+    printf("                each time sample independently are allowed. Products are\n");
+    printf("                imported one at a time (--threads is not used).\n");
+    printf("\n");
+    printf("            --compact\n");
+    printf("                With --bin-spatial, accumulate averages in single precision\n");
+    printf("                floats with compensated summation and share the weights of\n");
+    printf("                variables that have the same valid cells, which reduces the\n");
+    printf("                memory usage of the grid at a negligible loss of accuracy.\n");
+    printf("                With -l/--list, an estimate of the memory usage of the grid\n");
+    printf("                (based on the first product) is printed before binning starts.\n");
+    printf("\n");
+    printf("            --percentile <variable>:<statistic>[,<statistic>...]\n");
+    printf("                Also include estimated medians and/or percentiles per grid cell\n");
+    printf("                of an averaged variable in the result of --bin-spatial. Each\n");
+    printf("                statistic is either 'median' or 'p<N>' (e.g. p90) and results in\n");
+    printf("                a '<variable>_median' or '<variable>_p<N>' variable. The\n");
+    printf("                estimates are based on a sketch per grid cell whose accuracy\n");
+    printf("                can be set with the HARP_PERCENTILE_COMPRESSION environment\n");
+    printf("                variable (default: 100). This option can be given more than\n");
+    printf("                once and is only used with --bin-spatial.\n");
+    printf("\n");
+    printf("            --stream\n");
+    printf("                Write each product to the output file directly after it has\n");
+    printf("                been imported, instead of keeping the merged product in memory\n");
+    printf("                until all products are merged. The first product determines\n");
+    printf("                the variables in the output file and the length of all\n");
+    printf("                dimensions other than time; dimensions (and strings) of other\n");
+    printf("                products can not be longer. Only supported for netCDF output\n");
+    printf("                and not in combination with -ap or --bin-spatial.\n");
+    printf("\n");
+    printf("            --tiles <latitude size>,<longitude size>\n");
+    printf("                Write a separate product for each tile of the given size (in\n");
+    printf("                whole degrees) that contains samples, instead of a single\n");
+    printf("                product. Samples are assigned to tiles by their latitude and\n");
+    printf("                longitude. The name of the tile (e.g. N30E010 for the tile\n");
+    printf("                with south-west corner 30N,10E) is inserted before the\n");
+    printf("                extension of the output filename. Not supported in\n");
+    printf("                combination with --stream or --bin-spatial.\n");
+    printf("\n");
+    printf("            --partition <hourly|daily|N>\n");
+    printf("                Write a separate product for each hour or day (by the\n");
+    printf("                'datetime' variable, in UTC) or for each block of N\n");
+    printf("                consecutive samples that contains samples, instead of a\n");
+    printf("                single product. The name of the partition (e.g. 20180101\n");
+    printf("                for a day, 20180101T06 for an hour, or 000012 for the 13th\n");
+    printf("                block) is inserted before the extension of the output\n");
+    printf("                filename. With --stream, the output file of a partition is\n");
+    printf("                completed as soon as a product with later samples is\n");
+    printf("                appended, so the products need to be ordered by time. Not\n");
+    printf("                supported in combination with --tiles, --bin-spatial, or\n");
+    printf("                --part.\n");
+    printf("\n");
+    printf("            --part <K>/<N>\n");
+    printf("                Only merge the K-th of N (nearly) equal parts of all products\n");
+    printf("                (in the order in which they would be merged), e.g. to divide\n");
+    printf("                a merge over the jobs of a cluster. Merging the N partial\n");
+    printf("                results (given as separate arguments, in part order) gives\n");
+    printf("                the same product as a merge of all products at once (apart\n");
+    printf("                from the history). Not supported in combination with -ap or\n");
+    printf("                --bin-spatial; apply post-operations when merging the parts.\n");
     printf("\n");
     printf("            --hdf5-compression <level>\n");
     printf("                Set data compression level for storing in HDF5 format.\n");
     printf("                0=disabled, 1=low, ..., 9=high.\n");
     printf("\n");
+    printf("            --hdf5-compression-filter <deflate|zstd|lz4>\n");
+    printf("                Set the compression filter for HDF5 format (default:\n");
+    printf("                deflate). The zstd and lz4 filters are faster, but need\n");
+    printf("                the corresponding HDF5 filter plugin to be available\n");
+    printf("                (also for reading); without it deflate is used instead.\n");
+    printf("\n");
+    printf("            --hdf5-chunk-size <bytes>\n");
+    printf("                Set the target size of the chunks that compressed variables\n");
+    printf("                are stored in for HDF5 format (default: 1048576). Each\n");
+    printf("                chunk covers whole time samples where possible, such that\n");
+    printf("                a subset of the samples can be read efficiently.\n");
+    printf("                0=store each variable in as few chunks as possible.\n");
+    printf("\n");
+    printf("            --hdf5-page-size <bytes>\n");
+    printf("                Write HDF5 files with paged file space management using the\n");
+    printf("                given page size, such that all metadata is stored together\n");
+    printf("                (e.g. 4194304 for files that are read from object storage).\n");
+    printf("                0=use the default file space management (default).\n");
+    printf("\n");
+    printf("            --zarr-chunk-size <samples>\n");
+    printf("                Set the number of time samples per chunk for Zarr format,\n");
+    printf("                such that chunks can be written and read in parallel.\n");
+    printf("                0=store each variable in a single chunk (default).\n");
+    printf("\n");
+    printf("            --arrow-batch-size <rows>\n");
+    printf("                Set the number of rows (time samples) per record batch for\n");
+    printf("                Arrow format (default: 65536). Record batches are encoded\n");
+    printf("                in parallel. 0=store all rows in a single record batch.\n");
+    printf("\n");
+    printf("            --memory-limit <bytes>\n");
+    printf("                Limit the amount of memory that can be used for variable data.\n");
+    printf("                An operation that would exceed the limit fails with an error.\n");
+    printf("                With --threads, no new products are imported while more\n");
+    printf("                than half of the limit is in use and other products are\n");
+    printf("                still waiting to be appended. 0=no limit (default).\n");
+    printf("\n");
+    printf("            --trusted-import\n");
+    printf("                Only verify the structure of imported HARP products and skip\n");
+    printf("                the validation of units and enumeration names.\n");
+    printf("\n");
+    printf("            --buffer-pool <bytes>\n");
+    printf("                Keep up to the given number of bytes of released variable data\n");
+    printf("                and ingestion buffers for reuse by the next product, instead of\n");
+    printf("                returning them to the system. 0=disabled (default).\n");
+    printf("\n");
+    printf("            --profile\n");
+    printf("                Print the time spent in, and the change in product size\n");
+    printf("                caused by, each ingested variable and each operation to\n");
+    printf("                stderr when the tool exits.\n");
+    printf("\n");
+    printf("            --trace <file>\n");
+    printf("                Write a trace of all processing steps (in Chrome Trace\n");
+    printf("                Event JSON format) to the given file.\n");
+    printf("\n");
     printf("        If the merged product is empty, a warning will be printed and the\n");
     printf("        tool will return with exit code 2 (without writing a file).\n");
     printf("\n");
@@ -108,177 +311,1749 @@ static void print_help()
     printf("\n");
 }
 
-int merge_dataset(harp_product **merged_product, harp_dataset *dataset, const char *operations, const char *options,
-                  int verbose)
+/* reserve_dimension contains the expected length of the time dimension of the merged product and the maximum length of
+ * the non-time dimensions over all products (0 if unknown) */
+/* get the latitude, longitude, or datetime of each sample (as double in the given unit) */
+static int get_sample_coordinate(const harp_product *product, const char *option, const char *name, const char *unit,
+                                 harp_variable **coordinate)
 {
-    int i;
+    harp_variable *variable;
 
-    for (i = 0; i < dataset->num_products; i++)
+    if (harp_product_get_variable_by_name(product, name, &variable) != 0)
     {
-        harp_product *product;
-        int index;
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "%s requires a '%s' variable", option, name);
+        return -1;
+    }
+    if (variable->num_dimensions != 1 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "%s requires a '%s' variable with only a time dimension",
+                       option, name);
+        return -1;
+    }
+    if (harp_variable_copy(variable, coordinate) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_convert_unit(*coordinate, unit) != 0 ||
+        harp_variable_convert_data_type(*coordinate, harp_type_double) != 0)
+    {
+        harp_variable_delete(*coordinate);
+        return -1;
+    }
 
-        /* add products in sorted order (sorted by source_product value) */
-        index = dataset->sorted_index[i];
+    return 0;
+}
+
+static int compare_long(const void *a, const void *b)
+{
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* Determine the partition for each sample of the product. The key of a partition is the number of the hour/day since
+ * 2000-01-01 (or the number of the block of samples, where sample_offset is the number of samples that preceded the
+ * product) and the distinct keys are returned in increasing order. Unless the product consists of a single partition,
+ * a temporary PARTITION_VARIABLE_NAME variable is added to the product with, for each sample, the index of its
+ * partition in 'key' (or -1 for samples without a valid datetime, which do not belong to any partition).
+ */
+static int get_partitions(harp_product *product, const merge_partition *partition, long sample_offset,
+                          long *num_keys, long **key)
+{
+    harp_dimension_type dimension_type = harp_dimension_time;
+    harp_variable *datetime = NULL;
+    harp_variable *index;
+    long *sample_key;
+    long dimension;
+    long num_unique = 0;
+    long num_invalid = 0;
+    long i;
 
-        if (verbose)
+    dimension = product->dimension[harp_dimension_time];
+    if (!partition->by_samples)
+    {
+        if (get_sample_coordinate(product, "--partition", "datetime", "s since 2000-01-01", &datetime) != 0)
         {
-            printf("%s\n", dataset->metadata[index]->filename);
+            return -1;
         }
-        if (harp_import(dataset->metadata[index]->filename, operations, options, &product) != 0)
+    }
+    sample_key = malloc((dimension > 0 ? dimension : 1) * sizeof(long));
+    if (sample_key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dimension * sizeof(long), __FILE__, __LINE__);
+        harp_variable_delete(datetime);
+        return -1;
+    }
+    *key = malloc((dimension > 0 ? dimension : 1) * sizeof(long));
+    if (*key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dimension * sizeof(long), __FILE__, __LINE__);
+        free(sample_key);
+        harp_variable_delete(datetime);
+        return -1;
+    }
+    for (i = 0; i < dimension; i++)
+    {
+        if (partition->by_samples)
         {
-            return -1;
+            sample_key[i] = (sample_offset + i) / partition->length;
         }
-        if (!harp_product_is_empty(product))
+        else
         {
-            if (*merged_product == NULL)
+            double value = datetime->data.double_data[i];
+
+            /* the range check also excludes NaN (and values for which the key does not fit in a long) */
+            if (!(value > -1e15 && value < 1e15))
             {
-                *merged_product = product;
-                /* if this remains the only product then make sure it still looks like it was the result of a merge */
-                if (harp_product_append(*merged_product, NULL) != 0)
-                {
-                    return -1;
-                }
+                sample_key[i] = INVALID_PARTITION_KEY;
+                num_invalid++;
+                continue;
             }
-            else
+            sample_key[i] = (long)floor(value / partition->length);
+        }
+        (*key)[num_unique] = sample_key[i];
+        num_unique++;
+    }
+    harp_variable_delete(datetime);
+
+    /* only keep the distinct keys (in increasing order) */
+    qsort(*key, num_unique, sizeof(long), compare_long);
+    *num_keys = 0;
+    for (i = 0; i < num_unique; i++)
+    {
+        if (*num_keys == 0 || (*key)[i] != (*key)[*num_keys - 1])
+        {
+            (*key)[*num_keys] = (*key)[i];
+            (*num_keys)++;
+        }
+    }
+
+    if (*num_keys > 1 || num_invalid > 0)
+    {
+        if (harp_variable_new(PARTITION_VARIABLE_NAME, harp_type_int32, 1, &dimension_type, &dimension, &index) != 0)
+        {
+            free(sample_key);
+            free(*key);
+            return -1;
+        }
+        for (i = 0; i < dimension; i++)
+        {
+            if (sample_key[i] == INVALID_PARTITION_KEY)
             {
-                if (harp_product_append(*merged_product, product) != 0)
-                {
-                    harp_product_delete(product);
-                    return -1;
-                }
-                harp_product_delete(product);
+                index->data.int32_data[i] = -1;
+                continue;
             }
+            index->data.int32_data[i] = (int32_t)(((long *)bsearch(&sample_key[i], *key, *num_keys, sizeof(long),
+                                                                   compare_long)) - *key);
+        }
+        if (harp_product_add_variable(product, index) != 0)
+        {
+            harp_variable_delete(index);
+            free(sample_key);
+            free(*key);
+            return -1;
         }
     }
+    free(sample_key);
 
     return 0;
 }
 
-static int merge(int argc, char *argv[])
+/* get a copy of the product (that shares its data with the product) with only the samples of partition 'index' */
+static int get_partition_product(const harp_product *product, long index, harp_product **partition_product)
 {
-    harp_product *merged_product = NULL;
-    const char *operations = NULL;
-    const char *post_operations = NULL;
-    const char *options = NULL;
-    const char *output_filename = NULL;
-    const char *output_format = "netcdf";
-    int verbose = 0;
-    int i;
+    char operations[128];
 
-    /* parse arguments after list/'export format' */
-    for (i = 1; i < argc; i++)
+    if (harp_product_copy_shared(product, partition_product) != 0)
     {
-        if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--operations") == 0) && i + 1 < argc &&
-            argv[i + 1][0] != '-')
-        {
-            operations = argv[i + 1];
-            i++;
-        }
-        else if ((strcmp(argv[i], "-ap") == 0 || strcmp(argv[i], "--post-operations") == 0) && i + 1 < argc &&
-                 argv[i + 1][0] != '-')
+        return -1;
+    }
+    if (harp_product_has_variable(product, PARTITION_VARIABLE_NAME))
+    {
+        int length;
+
+        length = snprintf(operations, sizeof(operations), "%s==%ld;exclude(%s)", PARTITION_VARIABLE_NAME, index,
+                          PARTITION_VARIABLE_NAME);
+        if (length < 0 || length >= (int)sizeof(operations))
         {
-            post_operations = argv[i + 1];
-            i++;
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid partition index (%ld)", index);
+            harp_product_delete(*partition_product);
+            return -1;
         }
-        else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc &&
-                 argv[i + 1][0] != '-')
+        if (harp_product_execute_operations(*partition_product, operations) != 0)
         {
-            options = argv[i + 1];
-            i++;
+            harp_product_delete(*partition_product);
+            return -1;
         }
-        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) && i + 1 < argc
-                 && argv[i + 1][0] != '-')
+    }
+
+    return 0;
+}
+
+/* insert the suffix before the extension of the output filename */
+static char *get_filename_with_suffix(const char *output_filename, const char *suffix)
+{
+    const char *extension;
+    const char *separator;
+    char *filename;
+    int length;
+
+    separator = strrchr(output_filename, '/');
+    extension = strrchr(separator != NULL ? separator : output_filename, '.');
+    if (extension == NULL)
+    {
+        extension = output_filename + strlen(output_filename);
+    }
+    length = (int)(extension - output_filename);
+    filename = malloc(strlen(output_filename) + strlen(suffix) + 1);
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(output_filename) + strlen(suffix) + 1, __FILE__, __LINE__);
+        return NULL;
+    }
+    sprintf(filename, "%.*s%s%s", length, output_filename, suffix, extension);
+
+    return filename;
+}
+
+/* insert the name of the partition (e.g. '20180101' for a day, '20180101T06' for an hour, or '000012' for the 13th
+ * block of samples) before the extension of the output filename */
+static char *get_partition_filename(const char *output_filename, const merge_partition *partition, long key)
+{
+    char suffix[96];
+    long seconds, days;
+    long era, day_of_era, year_of_era, day_of_year, month_index;
+    long year, month, day;
+    int length;
+
+    if (partition->by_samples)
+    {
+        length = snprintf(suffix, sizeof(suffix), "_%06ld", key);
+        if (length < 0 || length >= (int)sizeof(suffix))
         {
-            output_format = argv[i + 1];
-            i++;
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid partition key (%ld)", key);
+            return NULL;
         }
-        else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--list") == 0)
+        return get_filename_with_suffix(output_filename, suffix);
+    }
+
+    seconds = key * partition->length;
+    days = seconds / 86400 - (seconds % 86400 < 0 ? 1 : 0);
+    seconds -= days * 86400;
+
+    /* convert the number of days since 2000-01-01 to a (proleptic Gregorian) calendar date; eras of 400 years start
+     * at 0000-03-01 */
+    days += 730425;
+    era = (days >= 0 ? days : days - 146096) / 146097;
+    day_of_era = days - era * 146097;
+    year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    month_index = (5 * day_of_year + 2) / 153;
+    day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    month = month_index < 10 ? month_index + 3 : month_index - 9;
+    year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+    if (partition->length < 86400)
+    {
+        length = snprintf(suffix, sizeof(suffix), "_%04ld%02ld%02ldT%02ld", year, month, day, seconds / 3600);
+    }
+    else
+    {
+        length = snprintf(suffix, sizeof(suffix), "_%04ld%02ld%02ld", year, month, day);
+    }
+    if (length < 0 || length >= (int)sizeof(suffix))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid partition key (%ld)", key);
+        return NULL;
+    }
+
+    return get_filename_with_suffix(output_filename, suffix);
+}
+
+/* close the output file of the current partition (if any); the file is removed if it could not be completed */
+static int close_partition_stream(merge_stream *stream)
+{
+    int result = 0;
+
+    if (stream->stream != NULL)
+    {
+        result = harp_export_stream_close(stream->stream);
+        if (result != 0)
         {
-            verbose = 1;
+            remove(stream->partition_filename);
         }
-        else if (strcmp(argv[i], "--hdf5-compression") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        stream->stream = NULL;
+        free(stream->partition_filename);
+        stream->partition_filename = NULL;
+    }
+
+    return result;
+}
+
+/* Write the samples of the product to the output files of the partitions that they belong to. Products need to be
+ * provided in increasing order of time, such that each output file is completed before the next one is started.
+ */
+static int append_product_to_partitions(merge_stream *stream, harp_product *product)
+{
+    long num_keys;
+    long *key;
+    long i;
+
+    if (get_partitions(product, stream->partition, stream->num_samples, &num_keys, &key) != 0)
+    {
+        return -1;
+    }
+    stream->num_samples += product->dimension[harp_dimension_time];
+    if (num_keys > 0 && stream->stream != NULL && key[0] < stream->partition_key)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product contains samples of a partition that has already been "
+                       "written (--partition with --stream requires products to be ordered by time)");
+        free(key);
+        return -1;
+    }
+
+    for (i = 0; i < num_keys; i++)
+    {
+        harp_product *partition_product;
+
+        if (stream->stream == NULL || key[i] != stream->partition_key)
         {
-            if (harp_set_option_hdf5_compression(atoi(argv[i + 1])) != 0)
+            if (close_partition_stream(stream) != 0)
             {
-                fprintf(stderr, "ERROR: invalid hdf5 compression argument: '%s'\n", argv[i]);
-                print_help();
+                free(key);
                 return -1;
             }
-            i++;
+            stream->partition_filename = get_partition_filename(stream->output_filename, stream->partition, key[i]);
+            if (stream->partition_filename == NULL)
+            {
+                free(key);
+                return -1;
+            }
+            if (harp_export_stream_open(stream->partition_filename, stream->output_format, &stream->stream) != 0)
+            {
+                stream->stream = NULL;
+                free(stream->partition_filename);
+                stream->partition_filename = NULL;
+                free(key);
+                return -1;
+            }
+            stream->partition_key = key[i];
+            stream->num_products = 0;
+            stream->num_partitions++;
         }
-        else if (argv[i][0] != '-')
+        if (get_partition_product(product, i, &partition_product) != 0)
         {
-            /* Assume the next argument is the dataset directory path. */
-            break;
+            free(key);
+            return -1;
         }
-        else
+        if (stream->num_products == 0)
         {
-            fprintf(stderr, "ERROR: invalid argument: '%s'\n", argv[i]);
-            print_help();
+            /* the history of the first product is the one that ends up in the output file */
+            if (harp_product_update_history(partition_product, "harpmerge", stream->argc, stream->argv) != 0)
+            {
+                harp_product_delete(partition_product);
+                free(key);
+                return -1;
+            }
+        }
+        if (harp_export_stream_append(stream->stream, partition_product) != 0)
+        {
+            harp_product_delete(partition_product);
+            free(key);
             return -1;
         }
+        harp_product_delete(partition_product);
+        stream->num_products++;
     }
+    free(key);
 
-    if (i == argc - 1)
+    return 0;
+}
+
+static int append_product(harp_product **merged_product, harp_product *product, const merge_info *info,
+                          const long *reserve_dimension)
+{
+    if (harp_product_is_empty(product))
     {
-        fprintf(stderr, "ERROR: invalid arguments\n");
-        print_help();
-        return -1;
+        harp_product_delete(product);
+        return 0;
     }
-    output_filename = argv[argc - 1];
-
-    while (i < argc - 1)
+    if (info->accumulator != NULL)
     {
-        harp_dataset *dataset;
-
-        if (harp_dataset_new(&dataset) != 0)
+        if (harp_spatial_accumulator_add_product(info->accumulator, product) != 0)
         {
+            harp_product_delete(product);
             return -1;
         }
-        if (harp_dataset_import(dataset, argv[i], options) != 0)
+        harp_product_delete(product);
+        return 0;
+    }
+    if (info->stream != NULL && info->stream->partition != NULL)
+    {
+        if (append_product_to_partitions(info->stream, product) != 0)
         {
-            harp_dataset_delete(dataset);
+            harp_product_delete(product);
             return -1;
         }
-        if (merge_dataset(&merged_product, dataset, operations, options, verbose) != 0)
+        harp_product_delete(product);
+        return 0;
+    }
+    if (info->stream != NULL)
+    {
+        if (info->stream->num_products == 0)
         {
-            harp_product_delete(merged_product);
-            harp_dataset_delete(dataset);
+            /* the history of the first product is the one that ends up in the output file */
+            if (harp_product_update_history(product, "harpmerge", info->stream->argc, info->stream->argv) != 0)
+            {
+                harp_product_delete(product);
+                return -1;
+            }
+        }
+        if (harp_export_stream_append(info->stream->stream, product) != 0)
+        {
+            harp_product_delete(product);
             return -1;
         }
-        harp_dataset_delete(dataset);
-        i++;
-    }
-
-    if (merged_product == NULL)
-    {
-        return -2;
-    }
-    if (harp_product_is_empty(merged_product))
-    {
-        harp_product_delete(merged_product);
-        return -2;
+        info->stream->num_products++;
+        harp_product_delete(product);
+        return 0;
     }
-    if (post_operations != NULL)
+    if (*merged_product == NULL)
     {
-        if (harp_product_execute_operations(merged_product, post_operations) != 0)
+        *merged_product = product;
+        /* if this remains the only product then make sure it still looks like it was the result of a merge */
+        if (harp_product_append(*merged_product, NULL) != 0)
         {
-            harp_product_delete(merged_product);
             return -1;
         }
-        if (harp_product_is_empty(merged_product))
+        if (harp_product_reserve_dimensions(*merged_product, reserve_dimension) != 0)
         {
-            harp_product_delete(merged_product);
-            return -2;
+            return -1;
+        }
+    }
+    else
+    {
+        if (harp_product_append(*merged_product, product) != 0)
+        {
+            harp_product_delete(product);
+            return -1;
         }
+        harp_product_delete(product);
     }
 
-    /* update the product history */
-    if (harp_product_update_history(merged_product, "harpmerge", argc, argv) != 0)
+    return 0;
+}
+
+/* Ask the OS to start reading the files of the products that follow the product at position i (in sorted order).
+ * Positions are imported in increasing order, so only the product at i + PREFETCH_DEPTH is new (except at the start).
+ */
+static void prefetch_products(harp_dataset *dataset, long i)
+{
+    long j;
+
+    for (j = (i == 0 ? 1 : i + PREFETCH_DEPTH); j <= i + PREFETCH_DEPTH && j < dataset->num_products; j++)
     {
-        harp_product_delete(merged_product);
-        return -1;
+        harp_prefetch_file(dataset->metadata[dataset->sorted_index[j]]->filename);
+    }
+}
+
+#ifdef HAVE_PTHREAD_H
+/* shared administration for the threads that import the products of a dataset */
+typedef struct merge_threads_struct
+{
+    const merge_info *info;
+    harp_dataset *dataset;
+    pthread_mutex_t mutex;      /* protects all fields below */
+    pthread_cond_t product_done;        /* signalled each time a thread finishes importing a product */
+    pthread_cond_t product_appended;    /* signalled each time a product got appended by the main thread */
+    long next_import;   /* position in sorted_index of the next product that should be imported */
+    long next_append;   /* position in sorted_index of the next product that should be appended */
+    harp_product **product;     /* imported products (by position in sorted_index) */
+    int *status;        /* per product: 0 = pending, 1 = done, -1 = failed */
+    int abort;          /* set when one of the imports failed or when the main thread wants to stop */
+    long error_index;   /* position in sorted_index of the first product that failed */
+    int error_code;     /* error of the first product that failed */
+    char *error_message;
+} merge_threads;
+
+/* administration of a single import thread */
+typedef struct merge_thread_struct
+{
+    pthread_t thread;
+    merge_threads *threads;
+    harp_program *program;      /* compiled operations; a program can not be shared between threads */
+} merge_thread;
+
+/* Returns whether more than half of the memory limit (if any) is in use, in which case no new imports are started
+ * until pending products have been appended.
+ */
+static int memory_limit_reached(void)
+{
+    int64_t memory_limit = harp_get_option_memory_limit();
+    int64_t current_size;
+
+    if (memory_limit == 0)
+    {
+        return 0;
+    }
+    harp_get_memory_usage(&current_size, NULL);
+
+    return current_size > memory_limit / 2;
+}
+
+static void *merge_thread_run(void *arg)
+{
+    merge_threads *threads = ((merge_thread *)arg)->threads;
+    harp_program *program = ((merge_thread *)arg)->program;
+    harp_product *product;
+    int result;
+    long i;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&threads->mutex);
+        while (!threads->abort && threads->next_import < threads->dataset->num_products &&
+               (threads->next_import - threads->next_append >= threads->info->max_pending ||
+                (threads->next_import > threads->next_append && memory_limit_reached())))
+        {
+            pthread_cond_wait(&threads->product_appended, &threads->mutex);
+        }
+        if (threads->abort || threads->next_import >= threads->dataset->num_products)
+        {
+            pthread_mutex_unlock(&threads->mutex);
+            break;
+        }
+        i = threads->next_import;
+        threads->next_import++;
+        pthread_mutex_unlock(&threads->mutex);
+
+        prefetch_products(threads->dataset, i);
+
+        result = harp_import_with_program(threads->dataset->metadata[threads->dataset->sorted_index[i]]->filename,
+                                          program, threads->info->options, &product);
+
+        pthread_mutex_lock(&threads->mutex);
+        if (result == 0)
+        {
+            threads->product[i] = product;
+            threads->status[i] = 1;
+        }
+        else
+        {
+            threads->status[i] = -1;
+            /* keep the error of the product that comes first in sorted order (that is where the main thread stops) */
+            if (i < threads->error_index)
+            {
+                if (threads->error_message != NULL)
+                {
+                    free(threads->error_message);
+                }
+                threads->error_index = i;
+                threads->error_code = harp_errno;
+                threads->error_message = strdup(harp_errno_to_string(harp_errno));
+            }
+            threads->abort = 1;
+        }
+        pthread_cond_broadcast(&threads->product_done);
+        pthread_mutex_unlock(&threads->mutex);
+    }
+
+    return NULL;
+}
+
+/* import the products of the dataset using multiple threads and append them in sorted order */
+static int merge_dataset_using_threads(harp_product **merged_product, harp_dataset *dataset, const merge_info *info,
+                                       const long *reserve_dimension)
+{
+    merge_threads threads;
+    merge_thread *thread;
+    int num_threads = 0;
+    int import_failed = 0;
+    int result = 0;
+    long i;
+
+    threads.info = info;
+    threads.dataset = dataset;
+    threads.next_import = 0;
+    threads.next_append = 0;
+    threads.abort = 0;
+    threads.error_index = dataset->num_products;
+    threads.error_code = HARP_SUCCESS;
+    threads.error_message = NULL;
+
+    thread = malloc(info->num_threads * sizeof(merge_thread));
+    if (thread == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->num_threads * sizeof(merge_thread), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < info->num_threads; i++)
+    {
+        thread[i].threads = &threads;
+        thread[i].program = NULL;
+    }
+    threads.product = malloc(dataset->num_products * sizeof(harp_product *));
+    if (threads.product == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(harp_product *), __FILE__, __LINE__);
+        free(thread);
+        return -1;
+    }
+    threads.status = malloc(dataset->num_products * sizeof(int));
+    if (threads.status == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       dataset->num_products * sizeof(int), __FILE__, __LINE__);
+        free(threads.product);
+        free(thread);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        threads.product[i] = NULL;
+        threads.status[i] = 0;
+    }
+    if (info->operations != NULL)
+    {
+        /* compile the operations once per thread instead of once per product */
+        for (i = 0; i < info->num_threads; i++)
+        {
+            if (harp_program_from_string(info->operations, &thread[i].program) != 0)
+            {
+                while (i > 0)
+                {
+                    i--;
+                    harp_program_delete(thread[i].program);
+                }
+                free(threads.status);
+                free(threads.product);
+                free(thread);
+                return -1;
+            }
+        }
+    }
+    pthread_mutex_init(&threads.mutex, NULL);
+    pthread_cond_init(&threads.product_done, NULL);
+    pthread_cond_init(&threads.product_appended, NULL);
+
+    while (num_threads < info->num_threads)
+    {
+        if (pthread_create(&thread[num_threads].thread, NULL, merge_thread_run, &thread[num_threads]) != 0)
+        {
+            if (num_threads == 0)
+            {
+                harp_set_error(HARP_ERROR_IMPORT, "could not create import thread");
+                result = -1;
+            }
+            /* continue with the threads that we have */
+            break;
+        }
+        num_threads++;
+    }
+
+    /* append the products in sorted order while the threads import the next products */
+    for (i = 0; result == 0 && i < dataset->num_products; i++)
+    {
+        harp_product *product;
+
+        pthread_mutex_lock(&threads.mutex);
+        while (threads.status[i] == 0 && !(threads.abort && i >= threads.next_import))
+        {
+            pthread_cond_wait(&threads.product_done, &threads.mutex);
+        }
+        if (threads.status[i] != 1)
+        {
+            pthread_mutex_unlock(&threads.mutex);
+            import_failed = 1;
+            result = -1;
+            break;
+        }
+        product = threads.product[i];
+        threads.product[i] = NULL;
+        threads.next_append = i + 1;
+        pthread_cond_broadcast(&threads.product_appended);
+        pthread_mutex_unlock(&threads.mutex);
+
+        if (info->verbose)
+        {
+            printf("%s\n", dataset->metadata[dataset->sorted_index[i]]->filename);
+        }
+        if (append_product(merged_product, product, info, reserve_dimension) != 0)
+        {
+            result = -1;
+        }
+    }
+
+    pthread_mutex_lock(&threads.mutex);
+    threads.abort = 1;
+    pthread_cond_broadcast(&threads.product_appended);
+    pthread_mutex_unlock(&threads.mutex);
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(thread[i].thread, NULL);
+    }
+
+    if (import_failed && threads.error_code != HARP_SUCCESS)
+    {
+        /* report the error of the import that failed */
+        harp_set_error(threads.error_code, "%s", threads.error_message != NULL ? threads.error_message : "");
+    }
+
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        if (threads.product[i] != NULL)
+        {
+            harp_product_delete(threads.product[i]);
+        }
+    }
+    if (threads.error_message != NULL)
+    {
+        free(threads.error_message);
+    }
+    pthread_cond_destroy(&threads.product_appended);
+    pthread_cond_destroy(&threads.product_done);
+    pthread_mutex_destroy(&threads.mutex);
+    free(threads.status);
+    free(threads.product);
+    for (i = 0; i < info->num_threads; i++)
+    {
+        harp_program_delete(thread[i].program);
+    }
+    free(thread);
+
+    return result;
+}
+#endif
+
+int merge_dataset(harp_product **merged_product, harp_dataset *dataset, const merge_info *info)
+{
+    harp_program *program = NULL;
+    long reserve_dimension[HARP_NUM_DIM_TYPES] = { 0 };
+    int i;
+    int j;
+
+    if (info->operations == NULL && info->accumulator == NULL && info->stream == NULL)
+    {
+        /* without operations the dimensions of the merged product are known in advance, so we can allocate the
+         * memory for the merged product at once instead of growing it with each append */
+        if (*merged_product != NULL)
+        {
+            for (j = 0; j < HARP_NUM_DIM_TYPES; j++)
+            {
+                reserve_dimension[j] = (*merged_product)->dimension[j];
+            }
+        }
+        for (i = 0; i < dataset->num_products; i++)
+        {
+            reserve_dimension[harp_dimension_time] += dataset->metadata[i]->dimension[harp_dimension_time];
+            if (info->options == NULL)
+            {
+                /* ingestion options may change the non-time dimensions, so only use them for plain imports */
+                for (j = 0; j < HARP_NUM_DIM_TYPES; j++)
+                {
+                    if (j != harp_dimension_time && dataset->metadata[i]->dimension[j] > reserve_dimension[j])
+                    {
+                        reserve_dimension[j] = dataset->metadata[i]->dimension[j];
+                    }
+                }
+            }
+        }
+        if (*merged_product != NULL)
+        {
+            if (harp_product_reserve_dimensions(*merged_product, reserve_dimension) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    if (info->chunk_size > 0)
+    {
+        /* read, filter, and bin each product chunk by chunk, without ever importing the full product */
+        for (i = 0; i < dataset->num_products; i++)
+        {
+            int index = dataset->sorted_index[i];
+
+            if (info->verbose)
+            {
+                printf("%s\n", dataset->metadata[index]->filename);
+            }
+            prefetch_products(dataset, i);
+            if (harp_spatial_accumulator_add_file(info->accumulator, dataset->metadata[index]->filename,
+                                                  info->operations, info->options, info->chunk_size) != 0)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+#ifdef HAVE_PTHREAD_H
+    if (info->num_threads > 1 && dataset->num_products > 1)
+    {
+        return merge_dataset_using_threads(merged_product, dataset, info, reserve_dimension);
+    }
+#endif
+
+    if (info->operations != NULL)
+    {
+        /* compile the operations once instead of for each product */
+        if (harp_program_from_string(info->operations, &program) != 0)
+        {
+            return -1;
+        }
+    }
+
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        harp_product *product;
+        int index;
+
+        /* add products in sorted order (sorted by source_product value) */
+        index = dataset->sorted_index[i];
+
+        if (info->verbose)
+        {
+            printf("%s\n", dataset->metadata[index]->filename);
+        }
+        prefetch_products(dataset, i);
+        if (harp_import_with_program(dataset->metadata[index]->filename, program, info->options, &product) != 0)
+        {
+            harp_program_delete(program);
+            return -1;
+        }
+        if (append_product(merged_product, product, info, reserve_dimension) != 0)
+        {
+            harp_program_delete(program);
+            return -1;
+        }
+    }
+
+    harp_program_delete(program);
+
+    return 0;
+}
+
+/* create a spatial accumulator from a '<lat_edge_length>,<lat_edge_offset>,<lat_edge_step>,<lon_edge_length>,
+ * <lon_edge_offset>,<lon_edge_step>' grid definition
+ */
+static int create_accumulator(const char *grid, harp_spatial_accumulator **accumulator)
+{
+    double *latitude_edges;
+    double *longitude_edges;
+    double latitude_edge_offset, latitude_edge_step;
+    double longitude_edge_offset, longitude_edge_step;
+    long num_latitude_edges, num_longitude_edges;
+    long i;
+
+    if (sscanf(grid, "%ld,%lf,%lf,%ld,%lf,%lf", &num_latitude_edges, &latitude_edge_offset, &latitude_edge_step,
+               &num_longitude_edges, &longitude_edge_offset, &longitude_edge_step) != 6 || num_latitude_edges < 2 ||
+        num_longitude_edges < 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid --bin-spatial argument: '%s'", grid);
+        return -1;
+    }
+
+    latitude_edges = malloc(num_latitude_edges * sizeof(double));
+    if (latitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_latitude_edges * sizeof(double), __FILE__, __LINE__);
+        return -1;
+    }
+    longitude_edges = malloc(num_longitude_edges * sizeof(double));
+    if (longitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_longitude_edges * sizeof(double), __FILE__, __LINE__);
+        free(latitude_edges);
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges; i++)
+    {
+        latitude_edges[i] = latitude_edge_offset + i * latitude_edge_step;
+    }
+    for (i = 0; i < num_longitude_edges; i++)
+    {
+        longitude_edges[i] = longitude_edge_offset + i * longitude_edge_step;
+    }
+
+    if (harp_spatial_accumulator_new(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges,
+                                     accumulator) != 0)
+    {
+        free(longitude_edges);
+        free(latitude_edges);
+        return -1;
+    }
+
+    free(longitude_edges);
+    free(latitude_edges);
+    return 0;
+}
+
+/* print the estimated memory usage of the accumulator, based on the first product that will be binned */
+static int print_accumulator_memory_estimate(harp_dataset **dataset, int num_datasets, const merge_info *info)
+{
+    const char *filename = NULL;
+    harp_product *product;
+    int64_t size;
+    int j;
+
+    for (j = 0; j < num_datasets; j++)
+    {
+        if (dataset[j]->num_products > 0)
+        {
+            filename = dataset[j]->metadata[dataset[j]->sorted_index[0]]->filename;
+            break;
+        }
+    }
+    if (filename == NULL)
+    {
+        return 0;
+    }
+
+    if (info->chunk_size > 0)
+    {
+        harp_import_stream *stream;
+
+        /* a single chunk is enough to know which variables will be accumulated */
+        if (harp_import_stream_open(filename, info->operations, info->options, info->chunk_size, &stream) != 0)
+        {
+            return -1;
+        }
+        if (harp_import_stream_next(stream, &product) != 0)
+        {
+            harp_import_stream_close(stream);
+            return -1;
+        }
+        harp_import_stream_close(stream);
+    }
+    else if (harp_import(filename, info->operations, info->options, &product) != 0)
+    {
+        return -1;
+    }
+    if (product == NULL)
+    {
+        return 0;
+    }
+    if (harp_spatial_accumulator_estimate_memory_usage(info->accumulator, product, &size) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    harp_product_delete(product);
+
+    printf("estimated memory usage of the binning grid: %.1f MB (based on %s)\n", size / (1024.0 * 1024.0), filename);
+
+    return 0;
+}
+
+/* name of the temporary variable that holds the tile of each sample (see export_tiles()) */
+#define TILE_VARIABLE_NAME "harpmerge_tile"
+
+/* insert the tile name (e.g. 'N30E010' for the tile with south-west corner 30N,10E) before the extension of the output
+ * filename */
+static char *get_tile_filename(const char *output_filename, int latitude, int longitude)
+{
+    char suffix[32];
+    int length;
+
+    length = snprintf(suffix, sizeof(suffix), "_%c%02d%c%03d", latitude < 0 ? 'S' : 'N', abs(latitude),
+                      longitude < 0 ? 'W' : 'E', abs(longitude));
+    if (length < 0 || length >= (int)sizeof(suffix))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid tile position (%d,%d)", latitude, longitude);
+        return NULL;
+    }
+
+    return get_filename_with_suffix(output_filename, suffix);
+}
+
+/* Write the product as a separate product for each tile of tile_height x tile_width degrees that contains samples.
+ * Each sample is assigned to a tile by its latitude and longitude; samples without a valid position are not exported.
+ * Returns -2 if no tile contains any samples.
+ */
+static int export_tiles(harp_product *product, const char *output_filename, const char *output_format,
+                        int tile_height, int tile_width)
+{
+    harp_dimension_type dimension_type = harp_dimension_time;
+    harp_variable *latitude = NULL;
+    harp_variable *longitude = NULL;
+    harp_variable *tile;
+    long *tile_count;
+    long dimension;
+    int num_rows = (180 + tile_height - 1) / tile_height;
+    int num_columns = (360 + tile_width - 1) / tile_width;
+    int num_tiles_written = 0;
+    long i;
+
+    dimension = product->dimension[harp_dimension_time];
+    if (get_sample_coordinate(product, "--tiles", "latitude", "degree_north", &latitude) != 0)
+    {
+        return -1;
+    }
+    if (get_sample_coordinate(product, "--tiles", "longitude", "degree_east", &longitude) != 0)
+    {
+        harp_variable_delete(latitude);
+        return -1;
+    }
+    tile_count = calloc(num_rows * num_columns, sizeof(long));
+    if (tile_count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_rows * num_columns * sizeof(long), __FILE__, __LINE__);
+        harp_variable_delete(longitude);
+        harp_variable_delete(latitude);
+        return -1;
+    }
+    if (harp_variable_new(TILE_VARIABLE_NAME, harp_type_int32, 1, &dimension_type, &dimension, &tile) != 0)
+    {
+        free(tile_count);
+        harp_variable_delete(longitude);
+        harp_variable_delete(latitude);
+        return -1;
+    }
+    for (i = 0; i < dimension; i++)
+    {
+        double latitude_value = latitude->data.double_data[i];
+        double longitude_value = longitude->data.double_data[i];
+        int row, column;
+
+        if (!(latitude_value >= -90 && latitude_value <= 90) || !(longitude_value >= -360 && longitude_value <= 360))
+        {
+            tile->data.int32_data[i] = -1;
+            continue;
+        }
+        longitude_value = fmod(longitude_value + 180, 360);
+        if (longitude_value < 0)
+        {
+            longitude_value += 360;
+        }
+        row = (int)floor((latitude_value + 90) / tile_height);
+        column = (int)floor(longitude_value / tile_width);
+        if (row >= num_rows)
+        {
+            /* latitude = 90 */
+            row = num_rows - 1;
+        }
+        if (column >= num_columns)
+        {
+            column = num_columns - 1;
+        }
+        tile->data.int32_data[i] = row * num_columns + column;
+        tile_count[row * num_columns + column]++;
+    }
+    harp_variable_delete(longitude);
+    harp_variable_delete(latitude);
+    if (harp_product_add_variable(product, tile) != 0)
+    {
+        harp_variable_delete(tile);
+        free(tile_count);
+        return -1;
+    }
+
+    for (i = 0; i < num_rows * num_columns; i++)
+    {
+        harp_product *tile_product;
+        char operations[128];
+        char *filename;
+
+        if (tile_count[i] == 0)
+        {
+            continue;
+        }
+        filename = get_tile_filename(output_filename, -90 + (int)(i / num_columns) * tile_height,
+                                     -180 + (int)(i % num_columns) * tile_width);
+        if (filename == NULL)
+        {
+            free(tile_count);
+            return -1;
+        }
+        /* the copy shares the data with the merged product, so only the data of the tile itself gets allocated */
+        if (harp_product_copy_shared(product, &tile_product) != 0)
+        {
+            free(filename);
+            free(tile_count);
+            return -1;
+        }
+        snprintf(operations, sizeof(operations), "%s==%ld;exclude(%s)", TILE_VARIABLE_NAME, i, TILE_VARIABLE_NAME);
+        if (harp_product_execute_operations(tile_product, operations) != 0)
+        {
+            harp_product_delete(tile_product);
+            free(filename);
+            free(tile_count);
+            return -1;
+        }
+        if (harp_export(filename, output_format, tile_product) != 0)
+        {
+            harp_product_delete(tile_product);
+            free(filename);
+            free(tile_count);
+            return -1;
+        }
+        harp_product_delete(tile_product);
+        free(filename);
+        num_tiles_written++;
+    }
+    free(tile_count);
+
+    return num_tiles_written > 0 ? 0 : -2;
+}
+
+/* Write the product as a separate product for each time partition that contains samples.
+ * Returns -2 if no partition contains any samples.
+ */
+static int export_partitions(harp_product *product, const char *output_filename, const char *output_format,
+                             const merge_partition *partition)
+{
+    long num_keys;
+    long *key;
+    long i;
+
+    if (get_partitions(product, partition, 0, &num_keys, &key) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < num_keys; i++)
+    {
+        harp_product *partition_product;
+        char *filename;
+
+        filename = get_partition_filename(output_filename, partition, key[i]);
+        if (filename == NULL)
+        {
+            free(key);
+            return -1;
+        }
+        if (get_partition_product(product, i, &partition_product) != 0)
+        {
+            free(filename);
+            free(key);
+            return -1;
+        }
+        if (harp_export(filename, output_format, partition_product) != 0)
+        {
+            harp_product_delete(partition_product);
+            free(filename);
+            free(key);
+            return -1;
+        }
+        harp_product_delete(partition_product);
+        free(filename);
+    }
+    free(key);
+
+    return num_keys > 0 ? 0 : -2;
+}
+
+/* close the stream (if any) and remove the incomplete output file */
+static void abort_stream(merge_stream *stream, const char *output_filename)
+{
+    if (stream != NULL)
+    {
+        if (stream->partition != NULL)
+        {
+            /* output files of partitions that were already completed are kept */
+            if (stream->stream != NULL)
+            {
+                harp_export_stream_close(stream->stream);
+                remove(stream->partition_filename);
+                free(stream->partition_filename);
+            }
+            return;
+        }
+        harp_export_stream_close(stream->stream);
+        remove(output_filename);
+    }
+}
+
+static void delete_datasets(harp_dataset **dataset, int num_datasets)
+{
+    int i;
+
+    for (i = 0; i < num_datasets; i++)
+    {
+        harp_dataset_delete(dataset[i]);
+    }
+    free(dataset);
+}
+
+/* only keep the products of part 'part' (1 .. num_parts) of the products of all datasets together (in order) */
+static int select_part(harp_dataset **dataset, int num_datasets, int part, int num_parts)
+{
+    long num_products = 0;
+    long first, last;
+    long offset = 0;
+    int i;
+
+    for (i = 0; i < num_datasets; i++)
+    {
+        num_products += dataset[i]->num_products;
+    }
+    first = (long)(((double)num_products * (part - 1)) / num_parts);
+    last = (long)(((double)num_products * part) / num_parts);
+
+    for (i = 0; i < num_datasets; i++)
+    {
+        long num_dataset_products = dataset[i]->num_products;
+        long begin = first - offset;
+        long end = last - offset;
+
+        if (begin < 0)
+        {
+            begin = 0;
+        }
+        if (end > num_dataset_products)
+        {
+            end = num_dataset_products;
+        }
+        if (harp_dataset_keep_sorted_range(dataset[i], begin, end > begin ? end - begin : 0) != 0)
+        {
+            return -1;
+        }
+        offset += num_dataset_products;
+    }
+
+    return 0;
+}
+
+static int merge(int argc, char *argv[])
+{
+    harp_dataset **dataset;
+    harp_product *merged_product = NULL;
+    merge_stream stream;
+    merge_partition partition;
+    merge_info info;
+    const char *post_operations = NULL;
+    const char *output_filename = NULL;
+    const char *output_format = "netcdf";
+    const char *bin_spatial = NULL;
+    int has_percentile = 0;
+    int use_compact = 0;
+    int use_stream = 0;
+    int num_datasets;
+    int part = 1;
+    int num_parts = 1;
+    int tile_height = 0;
+    int tile_width = 0;
+    int use_partition = 0;
+    int i, j;
+
+    info.operations = NULL;
+    info.options = NULL;
+    info.verbose = 0;
+    info.num_threads = 1;
+    info.max_pending = 0;
+    info.accumulator = NULL;
+    info.chunk_size = 0;
+    info.stream = NULL;
+
+    /* parse arguments after list/'export format' */
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--operations") == 0) && i + 1 < argc &&
+            argv[i + 1][0] != '-')
+        {
+            info.operations = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-ap") == 0 || strcmp(argv[i], "--post-operations") == 0) && i + 1 < argc &&
+                 argv[i + 1][0] != '-')
+        {
+            post_operations = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc &&
+                 argv[i + 1][0] != '-')
+        {
+            info.options = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) && i + 1 < argc
+                 && argv[i + 1][0] != '-')
+        {
+            output_format = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--list") == 0)
+        {
+            info.verbose = 1;
+        }
+        else if ((strcmp(argv[i], "--threads") == 0 || strcmp(argv[i], "--max-pending") == 0) && i + 1 < argc &&
+                 argv[i + 1][0] != '-')
+        {
+            int max_value = strcmp(argv[i], "--threads") == 0 ? MAX_NUM_THREADS : MAX_NUM_PENDING;
+            char *end;
+            long value;
+
+            value = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || value < 1 || value > max_value)
+            {
+                fprintf(stderr, "ERROR: invalid %s argument: '%s' (expected a value between 1 and %d)\n", argv[i],
+                        argv[i + 1], max_value);
+                print_help();
+                return -1;
+            }
+            if (strcmp(argv[i], "--threads") == 0)
+            {
+                info.num_threads = (int)value;
+            }
+            else
+            {
+                info.max_pending = (int)value;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--chunk-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+
+            info.chunk_size = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || info.chunk_size < 1)
+            {
+                fprintf(stderr, "ERROR: invalid --chunk-size argument: '%s' (expected a positive number of "
+                        "samples)\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--bin-spatial") == 0 && i + 1 < argc)
+        {
+            bin_spatial = argv[i + 1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--percentile") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            /* the aggregations are added to the accumulator once it has been created */
+            has_percentile = 1;
+            i++;
+        }
+        else if (strcmp(argv[i], "--compact") == 0)
+        {
+            use_compact = 1;
+        }
+        else if (strcmp(argv[i], "--stream") == 0)
+        {
+            use_stream = 1;
+        }
+        else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            int length = 0;
+
+            if (sscanf(argv[i + 1], "%d,%d%n", &tile_height, &tile_width, &length) != 2 ||
+                length != (int)strlen(argv[i + 1]) || tile_height < 1 || tile_height > 180 || tile_width < 1 ||
+                tile_width > 360)
+            {
+                fprintf(stderr, "ERROR: invalid --tiles argument: '%s' (expected <latitude size>,<longitude size> "
+                        "in whole degrees)\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--partition") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            partition.by_samples = 0;
+            if (strcmp(argv[i + 1], "hourly") == 0)
+            {
+                partition.length = 3600;
+            }
+            else if (strcmp(argv[i + 1], "daily") == 0)
+            {
+                partition.length = 86400;
+            }
+            else
+            {
+                char *end;
+
+                partition.by_samples = 1;
+                partition.length = strtol(argv[i + 1], &end, 10);
+                if (*end != '\0' || partition.length < 1)
+                {
+                    fprintf(stderr, "ERROR: invalid --partition argument: '%s' (expected 'hourly', 'daily', or a "
+                            "number of samples)\n", argv[i + 1]);
+                    print_help();
+                    return -1;
+                }
+            }
+            use_partition = 1;
+            i++;
+        }
+        else if (strcmp(argv[i], "--part") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            int length = 0;
+
+            if (sscanf(argv[i + 1], "%d/%d%n", &part, &num_parts, &length) != 2 ||
+                length != (int)strlen(argv[i + 1]) || num_parts < 1 || part < 1 || part > num_parts)
+            {
+                fprintf(stderr, "ERROR: invalid --part argument: '%s' (expected <K>/<N> with 1 <= K <= N)\n",
+                        argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-compression") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_compression(atoi(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 compression argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-compression-filter") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_compression_filter(argv[i + 1]) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 compression filter argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-chunk-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_chunk_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 chunk size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-page-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_page_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 page size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--zarr-chunk-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_zarr_chunk_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid zarr chunk size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--arrow-batch-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_arrow_batch_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid arrow batch size argument: '%s'\n", argv[i]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_memory_limit((int64_t)strtod(argv[i + 1], NULL)) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid memory limit argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--trusted-import") == 0)
+        {
+            harp_set_option_trusted_import(1);
+        }
+        else if (strcmp(argv[i], "--buffer-pool") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_buffer_pool_size((int64_t)strtod(argv[i + 1], NULL)) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid buffer pool argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+        {
+            harp_set_option_profile(1);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_trace(argv[i + 1]) != 0)
+            {
+                return -1;
+            }
+            i++;
+        }
+        else if (argv[i][0] != '-')
+        {
+            /* Assume the next argument is the dataset directory path. */
+            break;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: invalid argument: '%s'\n", argv[i]);
+            print_help();
+            return -1;
+        }
+    }
+
+    if (i == argc - 1)
+    {
+        fprintf(stderr, "ERROR: invalid arguments\n");
+        print_help();
+        return -1;
+    }
+    output_filename = argv[argc - 1];
+    if (info.max_pending == 0)
+    {
+        info.max_pending = 2 * info.num_threads;
+    }
+    if (use_stream && (post_operations != NULL || bin_spatial != NULL))
+    {
+        fprintf(stderr, "ERROR: --stream can not be combined with %s\n",
+                post_operations != NULL ? "--post-operations" : "--bin-spatial");
+        print_help();
+        return -1;
+    }
+    if (tile_height > 0 && (use_stream || bin_spatial != NULL))
+    {
+        fprintf(stderr, "ERROR: --tiles can not be combined with %s\n", use_stream ? "--stream" : "--bin-spatial");
+        print_help();
+        return -1;
+    }
+    if (use_partition && (tile_height > 0 || bin_spatial != NULL || num_parts > 1))
+    {
+        fprintf(stderr, "ERROR: --partition can not be combined with %s\n",
+                tile_height > 0 ? "--tiles" : (bin_spatial != NULL ? "--bin-spatial" : "--part"));
+        print_help();
+        return -1;
+    }
+    if (num_parts > 1 && (post_operations != NULL || bin_spatial != NULL))
+    {
+        fprintf(stderr, "ERROR: --part can not be combined with %s\n",
+                post_operations != NULL ? "--post-operations" : "--bin-spatial");
+        print_help();
+        return -1;
+    }
+    if (info.chunk_size > 0 && bin_spatial == NULL)
+    {
+        fprintf(stderr, "ERROR: --chunk-size requires --bin-spatial\n");
+        print_help();
+        return -1;
+    }
+    if (has_percentile && bin_spatial == NULL)
+    {
+        fprintf(stderr, "ERROR: --percentile requires --bin-spatial\n");
+        print_help();
+        return -1;
+    }
+    if (use_compact && bin_spatial == NULL)
+    {
+        fprintf(stderr, "ERROR: --compact requires --bin-spatial\n");
+        print_help();
+        return -1;
+    }
+    if (bin_spatial != NULL)
+    {
+        if (create_accumulator(bin_spatial, &info.accumulator) != 0)
+        {
+            return -1;
+        }
+        if (harp_spatial_accumulator_set_compact(info.accumulator, use_compact) != 0)
+        {
+            harp_spatial_accumulator_delete(info.accumulator);
+            return -1;
+        }
+        for (j = 1; j < i; j++)
+        {
+            if (strcmp(argv[j], "--percentile") == 0)
+            {
+                if (harp_spatial_accumulator_add_aggregation(info.accumulator, argv[j + 1]) != 0)
+                {
+                    harp_spatial_accumulator_delete(info.accumulator);
+                    return -1;
+                }
+                j++;
+            }
+        }
+    }
+    if (use_stream)
+    {
+        stream.argc = argc;
+        stream.argv = argv;
+        stream.num_products = 0;
+        stream.partition = NULL;
+        stream.stream = NULL;
+        if (use_partition)
+        {
+            /* the output file of each partition is opened once the first sample of the partition is appended */
+            stream.partition = &partition;
+            stream.output_filename = output_filename;
+            stream.output_format = output_format;
+            stream.partition_filename = NULL;
+            stream.partition_key = 0;
+            stream.num_partitions = 0;
+            stream.num_samples = 0;
+        }
+        else if (harp_export_stream_open(output_filename, output_format, &stream.stream) != 0)
+        {
+            return -1;
+        }
+        info.stream = &stream;
+    }
+
+    /* import all datasets first, such that --part can select a range of the products of all datasets together */
+    num_datasets = argc - 1 - i;
+    dataset = malloc(num_datasets * sizeof(harp_dataset *));
+    if (dataset == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_datasets * sizeof(harp_dataset *), __FILE__, __LINE__);
+        harp_spatial_accumulator_delete(info.accumulator);
+        abort_stream(info.stream, output_filename);
+        return -1;
+    }
+    for (j = 0; j < num_datasets; j++)
+    {
+        if (harp_dataset_new(&dataset[j]) != 0)
+        {
+            delete_datasets(dataset, j);
+            harp_spatial_accumulator_delete(info.accumulator);
+            abort_stream(info.stream, output_filename);
+            return -1;
+        }
+        /* skip products that can not match the leading filters of the operations according to their metadata */
+        if (harp_dataset_import_with_prefilter(dataset[j], argv[i + j], info.options, info.operations) != 0)
+        {
+            delete_datasets(dataset, j + 1);
+            harp_spatial_accumulator_delete(info.accumulator);
+            abort_stream(info.stream, output_filename);
+            return -1;
+        }
+    }
+    if (num_parts > 1)
+    {
+        if (select_part(dataset, num_datasets, part, num_parts) != 0)
+        {
+            delete_datasets(dataset, num_datasets);
+            harp_spatial_accumulator_delete(info.accumulator);
+            abort_stream(info.stream, output_filename);
+            return -1;
+        }
+    }
+
+    if (info.accumulator != NULL && info.verbose)
+    {
+        if (print_accumulator_memory_estimate(dataset, num_datasets, &info) != 0)
+        {
+            delete_datasets(dataset, num_datasets);
+            harp_spatial_accumulator_delete(info.accumulator);
+            abort_stream(info.stream, output_filename);
+            return -1;
+        }
+    }
+
+    for (j = 0; j < num_datasets; j++)
+    {
+        if (merge_dataset(&merged_product, dataset[j], &info) != 0)
+        {
+            harp_product_delete(merged_product);
+            delete_datasets(dataset, num_datasets);
+            harp_spatial_accumulator_delete(info.accumulator);
+            abort_stream(info.stream, output_filename);
+            return -1;
+        }
+    }
+    delete_datasets(dataset, num_datasets);
+
+    if (info.accumulator != NULL)
+    {
+        if (harp_spatial_accumulator_get_product(info.accumulator, &merged_product) != 0)
+        {
+            harp_spatial_accumulator_delete(info.accumulator);
+            return -1;
+        }
+        harp_spatial_accumulator_delete(info.accumulator);
+    }
+
+    if (info.stream != NULL && use_partition)
+    {
+        if (close_partition_stream(&stream) != 0)
+        {
+            return -1;
+        }
+        return stream.num_partitions > 0 ? 0 : -2;
+    }
+    if (info.stream != NULL)
+    {
+        if (stream.num_products == 0)
+        {
+            abort_stream(info.stream, output_filename);
+            return -2;
+        }
+        if (harp_export_stream_close(stream.stream) != 0)
+        {
+            remove(output_filename);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (merged_product == NULL)
+    {
+        return -2;
+    }
+    if (harp_product_is_empty(merged_product))
+    {
+        harp_product_delete(merged_product);
+        return -2;
+    }
+    if (post_operations != NULL)
+    {
+        if (harp_product_execute_operations(merged_product, post_operations) != 0)
+        {
+            harp_product_delete(merged_product);
+            return -1;
+        }
+        if (harp_product_is_empty(merged_product))
+        {
+            harp_product_delete(merged_product);
+            return -2;
+        }
+    }
+
+    /* update the product history */
+    if (harp_product_update_history(merged_product, "harpmerge", argc, argv) != 0)
+    {
+        harp_product_delete(merged_product);
+        return -1;
+    }
+
+    if (tile_height > 0)
+    {
+        int result = export_tiles(merged_product, output_filename, output_format, tile_height, tile_width);
+
+        harp_product_delete(merged_product);
+        return result;
+    }
+    if (use_partition)
+    {
+        int result = export_partitions(merged_product, output_filename, output_format, &partition);
+
+        harp_product_delete(merged_product);
+        return result;
     }
 
     /* export the product */
@@ -0,0 +1,835 @@
+/*
+ * Copyright (C) 2015-2018 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "harp.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* maximum value for the --threads option */
+#define MAX_NUM_THREADS 1024
+
+/* number of compiled operation lists that are kept per connection handler */
+#define PROGRAM_CACHE_SIZE 16
+
+/* compiled programs of the most recently used operation lists (a program can not be shared between threads) */
+typedef struct program_cache_struct
+{
+    char *operations[PROGRAM_CACHE_SIZE];
+    harp_program *program[PROGRAM_CACHE_SIZE];
+    long last_use[PROGRAM_CACHE_SIZE];
+    long use_counter;
+} program_cache;
+
+static int listen_fd = -1;
+static volatile sig_atomic_t stop_requested = 0;
+
+static int print_warning(const char *message, va_list ap)
+{
+    int result;
+
+    fprintf(stderr, "WARNING: ");
+    result = vfprintf(stderr, message, ap);
+    fprintf(stderr, "\n");
+
+    return result;
+}
+
+static void print_version()
+{
+    printf("harpserve version %s\n", libharp_version);
+    printf("Copyright (C) 2015-2018 S[&]T, The Netherlands.\n\n");
+}
+
+static void print_help()
+{
+    printf("Usage:\n");
+    printf("    harpserve [options] <socket path>\n");
+    printf("        Run a server that performs conversion and merge requests that are\n");
+    printf("        sent to it over a local (unix domain) socket. The HARP library is\n");
+    printf("        initialized only once and all its caches, as well as the compiled\n");
+    printf("        operations, are kept in memory between requests.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            --threads <N>\n");
+    printf("                Handle up to N client connections at the same time\n");
+    printf("                (default: 1). The requests of a single connection are\n");
+    printf("                always performed one after the other.\n");
+    printf("\n");
+    printf("        Each request is a single line consisting of tab separated fields.\n");
+    printf("        For each request the server sends back a single line, which is\n");
+    printf("        either 'ok', 'empty' (the resulting product was empty and no file\n");
+    printf("        was written), or 'error' followed by a tab and the error message.\n");
+    printf("        The following requests are supported:\n");
+    printf("            convert [-a <operations>] [-o <options>] [-f <format>]\n");
+    printf("                    <input product file> <output product file>\n");
+    printf("                Same as the corresponding harpconvert command.\n");
+    printf("            merge [-a <operations>] [-ap <operations>] [-o <options>]\n");
+    printf("                  [-f <format>] <input product file/dir>... <output file>\n");
+    printf("                Same as the corresponding harpmerge command.\n");
+    printf("            ping\n");
+    printf("                Reply with 'ok'.\n");
+    printf("            shutdown\n");
+    printf("                Reply with 'ok' and stop the server once all connected\n");
+    printf("                clients have disconnected.\n");
+    printf("\n");
+    printf("        The server also stops on SIGINT and SIGTERM. The socket file is\n");
+    printf("        removed when the server stops.\n");
+    printf("\n");
+    printf("    harpserve -h, --help\n");
+    printf("        Show help (this text).\n");
+    printf("\n");
+    printf("    harpserve -v, --version\n");
+    printf("        Print the version number of HARP and exit.\n");
+    printf("\n");
+}
+
+static void request_stop(void)
+{
+    stop_requested = 1;
+    if (listen_fd >= 0)
+    {
+        /* wakes up all threads that are waiting in accept() */
+        shutdown(listen_fd, SHUT_RDWR);
+    }
+}
+
+static void handle_signal(int sig)
+{
+    (void)sig;
+    request_stop();
+}
+
+static void program_cache_init(program_cache *cache)
+{
+    int i;
+
+    for (i = 0; i < PROGRAM_CACHE_SIZE; i++)
+    {
+        cache->operations[i] = NULL;
+        cache->program[i] = NULL;
+        cache->last_use[i] = 0;
+    }
+    cache->use_counter = 0;
+}
+
+static void program_cache_done(program_cache *cache)
+{
+    int i;
+
+    for (i = 0; i < PROGRAM_CACHE_SIZE; i++)
+    {
+        if (cache->operations[i] != NULL)
+        {
+            free(cache->operations[i]);
+            harp_program_delete(cache->program[i]);
+        }
+    }
+}
+
+/* Get the compiled program for an operation list (a NULL operation list results in a NULL program) */
+static int program_cache_get(program_cache *cache, const char *operations, harp_program **program)
+{
+    harp_program *new_program;
+    char *new_operations;
+    int oldest = 0;
+    int i;
+
+    if (operations == NULL)
+    {
+        *program = NULL;
+        return 0;
+    }
+
+    cache->use_counter++;
+    for (i = 0; i < PROGRAM_CACHE_SIZE; i++)
+    {
+        if (cache->operations[i] != NULL && strcmp(cache->operations[i], operations) == 0)
+        {
+            cache->last_use[i] = cache->use_counter;
+            *program = cache->program[i];
+            return 0;
+        }
+        if (cache->last_use[i] < cache->last_use[oldest])
+        {
+            oldest = i;
+        }
+    }
+
+    if (harp_program_from_string(operations, &new_program) != 0)
+    {
+        return -1;
+    }
+    new_operations = strdup(operations);
+    if (new_operations == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_program_delete(new_program);
+        return -1;
+    }
+    if (cache->operations[oldest] != NULL)
+    {
+        free(cache->operations[oldest]);
+        harp_program_delete(cache->program[oldest]);
+    }
+    cache->operations[oldest] = new_operations;
+    cache->program[oldest] = new_program;
+    cache->last_use[oldest] = cache->use_counter;
+    *program = new_program;
+
+    return 0;
+}
+
+/* Parse the options that are shared by the convert and merge requests.
+ * Returns the index of the first positional argument, or -1 on error.
+ */
+static int parse_request_options(int argc, char *argv[], const char **operations, const char **post_operations,
+                                 const char **options, const char **output_format)
+{
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--operations") == 0) && i + 1 < argc)
+        {
+            *operations = argv[i + 1];
+            i++;
+        }
+        else if (post_operations != NULL && (strcmp(argv[i], "-ap") == 0 ||
+                                             strcmp(argv[i], "--post-operations") == 0) && i + 1 < argc)
+        {
+            *post_operations = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc)
+        {
+            *options = argv[i + 1];
+            i++;
+        }
+        else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) && i + 1 < argc)
+        {
+            *output_format = argv[i + 1];
+            i++;
+        }
+        else if (argv[i][0] != '-')
+        {
+            break;
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid argument: '%s'", argv[i]);
+            return -1;
+        }
+    }
+
+    return i;
+}
+
+/* Perform a convert request; returns 0 on success, -1 on error, and -2 if the product is empty */
+static int handle_convert(program_cache *cache, int argc, char *argv[])
+{
+    harp_product *product;
+    harp_program *program;
+    const char *operations = NULL;
+    const char *options = NULL;
+    const char *output_format = "netcdf";
+    int i;
+
+    i = parse_request_options(argc, argv, &operations, NULL, &options, &output_format);
+    if (i < 0)
+    {
+        return -1;
+    }
+    if (i != argc - 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "input and/or output product file not specified");
+        return -1;
+    }
+    if (program_cache_get(cache, operations, &program) != 0)
+    {
+        return -1;
+    }
+
+    if (harp_import_with_program(argv[argc - 2], program, options, &product) != 0)
+    {
+        return -1;
+    }
+    if (harp_product_is_empty(product))
+    {
+        harp_product_delete(product);
+        return -2;
+    }
+    if (harp_product_update_history(product, "harpconvert", argc, argv) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    if (harp_export(argv[argc - 1], output_format, product) != 0)
+    {
+        harp_product_delete(product);
+        return -1;
+    }
+    harp_product_delete(product);
+
+    return 0;
+}
+
+/* Merge the products of a dataset (in sorted order) into the merged product */
+static int merge_dataset(harp_product **merged_product, harp_dataset *dataset, harp_program *program,
+                         const char *options)
+{
+    long i;
+
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        harp_product *product;
+        long index = dataset->sorted_index[i];
+
+        if (i + 1 < dataset->num_products)
+        {
+            harp_prefetch_file(dataset->metadata[dataset->sorted_index[i + 1]]->filename);
+        }
+        if (harp_import_with_program(dataset->metadata[index]->filename, program, options, &product) != 0)
+        {
+            return -1;
+        }
+        if (harp_product_is_empty(product))
+        {
+            harp_product_delete(product);
+            continue;
+        }
+        if (*merged_product == NULL)
+        {
+            *merged_product = product;
+            /* if this remains the only product then make sure it still looks like it was the result of a merge */
+            if (harp_product_append(*merged_product, NULL) != 0)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            if (harp_product_append(*merged_product, product) != 0)
+            {
+                harp_product_delete(product);
+                return -1;
+            }
+            harp_product_delete(product);
+        }
+    }
+
+    return 0;
+}
+
+/* Perform a merge request; returns 0 on success, -1 on error, and -2 if the merged product is empty */
+static int handle_merge(program_cache *cache, int argc, char *argv[])
+{
+    harp_product *merged_product = NULL;
+    harp_program *program;
+    const char *operations = NULL;
+    const char *post_operations = NULL;
+    const char *options = NULL;
+    const char *output_format = "netcdf";
+    int i;
+
+    i = parse_request_options(argc, argv, &operations, &post_operations, &options, &output_format);
+    if (i < 0)
+    {
+        return -1;
+    }
+    if (i > argc - 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "input product file(s) and/or output product file not specified");
+        return -1;
+    }
+    if (program_cache_get(cache, operations, &program) != 0)
+    {
+        return -1;
+    }
+
+    for (; i < argc - 1; i++)
+    {
+        harp_dataset *dataset;
+
+        if (harp_dataset_new(&dataset) != 0)
+        {
+            harp_product_delete(merged_product);
+            return -1;
+        }
+        if (harp_dataset_import(dataset, argv[i], options) != 0 || harp_dataset_prefilter(dataset, operations) != 0 ||
+            merge_dataset(&merged_product, dataset, program, options) != 0)
+        {
+            harp_dataset_delete(dataset);
+            harp_product_delete(merged_product);
+            return -1;
+        }
+        harp_dataset_delete(dataset);
+    }
+
+    if (merged_product == NULL)
+    {
+        return -2;
+    }
+    if (post_operations != NULL)
+    {
+        if (harp_product_execute_operations(merged_product, post_operations) != 0)
+        {
+            harp_product_delete(merged_product);
+            return -1;
+        }
+        if (harp_product_is_empty(merged_product))
+        {
+            harp_product_delete(merged_product);
+            return -2;
+        }
+    }
+    if (harp_product_update_history(merged_product, "harpmerge", argc, argv) != 0)
+    {
+        harp_product_delete(merged_product);
+        return -1;
+    }
+    if (harp_export(argv[argc - 1], output_format, merged_product) != 0)
+    {
+        harp_product_delete(merged_product);
+        return -1;
+    }
+    harp_product_delete(merged_product);
+
+    return 0;
+}
+
+/* Split a request line into its tab separated fields (the fields point into the line) */
+static int split_request(char *line, int *argc, char ***argv)
+{
+    char **field;
+    char *cursor;
+    int num_fields = 1;
+    int i;
+
+    for (cursor = line; *cursor != '\0'; cursor++)
+    {
+        if (*cursor == '\t')
+        {
+            num_fields++;
+        }
+    }
+    field = malloc(num_fields * sizeof(char *));
+    if (field == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_fields * sizeof(char *), __FILE__, __LINE__);
+        return -1;
+    }
+    field[0] = line;
+    i = 1;
+    for (cursor = line; *cursor != '\0'; cursor++)
+    {
+        if (*cursor == '\t')
+        {
+            *cursor = '\0';
+            field[i] = cursor + 1;
+            i++;
+        }
+    }
+    *argc = num_fields;
+    *argv = field;
+
+    return 0;
+}
+
+static void send_reply(FILE *stream, int result)
+{
+    if (result == 0)
+    {
+        fprintf(stream, "ok\n");
+    }
+    else if (result == -2)
+    {
+        fprintf(stream, "empty\n");
+    }
+    else
+    {
+        const char *message = harp_errno_to_string(harp_errno);
+
+        fprintf(stream, "error\t");
+        /* the reply needs to stay on a single line */
+        for (; *message != '\0'; message++)
+        {
+            fputc(*message == '\n' || *message == '\r' ? ' ' : *message, stream);
+        }
+        fprintf(stream, "\n");
+    }
+    fflush(stream);
+}
+
+static void handle_request(program_cache *cache, char *line, FILE *reply_stream)
+{
+    char **argv;
+    int argc;
+    int result;
+
+    if (split_request(line, &argc, &argv) != 0)
+    {
+        send_reply(reply_stream, -1);
+        return;
+    }
+
+    if (strcmp(argv[0], "convert") == 0)
+    {
+        result = handle_convert(cache, argc, argv);
+    }
+    else if (strcmp(argv[0], "merge") == 0)
+    {
+        result = handle_merge(cache, argc, argv);
+    }
+    else if (strcmp(argv[0], "ping") == 0 && argc == 1)
+    {
+        result = 0;
+    }
+    else if (strcmp(argv[0], "shutdown") == 0 && argc == 1)
+    {
+        request_stop();
+        result = 0;
+    }
+    else
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid request '%s'", argv[0]);
+        result = -1;
+    }
+    free(argv);
+
+    send_reply(reply_stream, result);
+}
+
+/* Perform all requests of a single client connection (until the client closes the connection) */
+static void handle_connection(program_cache *cache, int fd)
+{
+    FILE *request_stream;
+    FILE *reply_stream;
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t length;
+    int reply_fd;
+
+    reply_fd = dup(fd);
+    if (reply_fd < 0)
+    {
+        close(fd);
+        return;
+    }
+    request_stream = fdopen(fd, "r");
+    if (request_stream == NULL)
+    {
+        close(fd);
+        close(reply_fd);
+        return;
+    }
+    reply_stream = fdopen(reply_fd, "w");
+    if (reply_stream == NULL)
+    {
+        fclose(request_stream);
+        close(reply_fd);
+        return;
+    }
+
+    while ((length = getline(&line, &line_size, request_stream)) > 0)
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+        {
+            length--;
+        }
+        line[length] = '\0';
+        if (length == 0)
+        {
+            continue;
+        }
+        handle_request(cache, line, reply_stream);
+        if (ferror(reply_stream))
+        {
+            /* client went away */
+            break;
+        }
+    }
+
+    free(line);
+    fclose(reply_stream);
+    fclose(request_stream);
+}
+
+/* Accept and handle client connections until the server is stopped */
+static void *serve(void *arg)
+{
+    program_cache cache;
+
+    (void)arg;
+
+    program_cache_init(&cache);
+    while (!stop_requested)
+    {
+        int fd;
+
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (!stop_requested)
+            {
+                fprintf(stderr, "ERROR: could not accept connection (%s)\n", strerror(errno));
+                request_stop();
+            }
+            break;
+        }
+        handle_connection(&cache, fd);
+    }
+    program_cache_done(&cache);
+
+    return NULL;
+}
+
+/* Create the listening socket; a socket file of a server that is no longer running is replaced */
+static int create_socket(const char *socket_path)
+{
+    struct sockaddr_un address;
+    struct stat statbuf;
+    int fd;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "socket path '%s' is too long", socket_path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not create socket (%s)", strerror(errno));
+        return -1;
+    }
+    if (stat(socket_path, &statbuf) == 0 && S_ISSOCK(statbuf.st_mode))
+    {
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0)
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "there is already a server listening on '%s'", socket_path);
+            close(fd);
+            return -1;
+        }
+        close(fd);
+        unlink(socket_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "could not create socket (%s)", strerror(errno));
+            return -1;
+        }
+    }
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not bind socket to '%s' (%s)", socket_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_OPEN, "could not listen on socket '%s' (%s)", socket_path, strerror(errno));
+        close(fd);
+        unlink(socket_path);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int run_server(int argc, char *argv[])
+{
+    const char *socket_path;
+    int num_threads = 1;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            char *end;
+            long value;
+
+            value = strtol(argv[i + 1], &end, 10);
+            if (*end != '\0' || value < 1 || value > MAX_NUM_THREADS)
+            {
+                fprintf(stderr, "ERROR: invalid %s argument: '%s' (expected a value between 1 and %d)\n", argv[i],
+                        argv[i + 1], MAX_NUM_THREADS);
+                print_help();
+                return -1;
+            }
+            num_threads = (int)value;
+            i++;
+        }
+        else if (argv[i][0] != '-')
+        {
+            break;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: invalid argument: '%s'\n", argv[i]);
+            print_help();
+            return -1;
+        }
+    }
+    if (i != argc - 1)
+    {
+        fprintf(stderr, "ERROR: socket path not specified\n");
+        print_help();
+        return -1;
+    }
+    socket_path = argv[argc - 1];
+
+    listen_fd = create_socket(socket_path);
+    if (listen_fd < 0)
+    {
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+#ifdef HAVE_PTHREAD_H
+    if (num_threads > 1)
+    {
+        pthread_t *thread;
+        int num_created = 0;
+
+        thread = malloc((num_threads - 1) * sizeof(pthread_t));
+        if (thread != NULL)
+        {
+            while (num_created < num_threads - 1)
+            {
+                if (pthread_create(&thread[num_created], NULL, serve, NULL) != 0)
+                {
+                    /* continue with the threads that we have */
+                    break;
+                }
+                num_created++;
+            }
+        }
+        /* the main thread handles connections as well */
+        serve(NULL);
+        for (i = 0; i < num_created; i++)
+        {
+            pthread_join(thread[i], NULL);
+        }
+        if (thread != NULL)
+        {
+            free(thread);
+        }
+    }
+    else
+#endif
+    {
+        serve(NULL);
+    }
+
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+
+    if (argc == 1 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
+    {
+        print_help();
+        exit(0);
+    }
+
+    if (strcmp(argv[1], "-v") == 0 || strcmp(argv[1], "--version") == 0)
+    {
+        print_version();
+        exit(0);
+    }
+
+    if (harp_set_coda_definition_path_conditional(argv[0], NULL, "../share/coda/definitions") != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+    if (harp_set_udunits2_xml_path_conditional(argv[0], NULL, "../share/harp/udunits2.xml") != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    harp_set_warning_handler(print_warning);
+
+    if (harp_init() != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    result = run_server(argc, argv);
+    if (result != 0)
+    {
+        if (harp_errno != HARP_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        }
+        harp_done();
+        exit(1);
+    }
+
+    harp_done();
+    return 0;
+}
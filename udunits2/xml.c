@@ -96,6 +96,7 @@ static ut_status readXml(
 
 static File*            currFile = NULL;
 static ut_system*	unitSystem = NULL;
+static int		reportPrefixOverrides = 1;
 static char*            text = NULL;
 static size_t           nbytes = 0;
 
@@ -699,9 +700,14 @@ mapIdToUnit(
     else {
 	/*
 	 * Take prefixes into account for a prior definition by using
-         * ut_parse().
+         * ut_parse(). This is only used for a diagnostic message, so it is
+         * skipped if error messages are ignored (parsing every identifier
+         * is the largest part of the time that it takes to read the
+         * database).
 	 */
-	prev = ut_parse(unitSystem, id, encoding);
+	prev = reportPrefixOverrides
+            ? ut_parse(unitSystem, id, encoding)
+            : NULL;
 
 	if ((isName
                     ? ut_map_name_to_unit(id, encoding, unit)
@@ -2197,8 +2203,13 @@ ut_read_xml(
         ut_handle_error_message("Couldn't create new unit-system");
     }
     else {
-        ut_status       status;
-        ut_status       openError;
+        ut_status                   status;
+        ut_status                   openError;
+        ut_error_message_handler    handler;
+
+        handler = ut_set_error_message_handler(ut_ignore);
+        (void)ut_set_error_message_handler(handler);
+        reportPrefixOverrides = handler != ut_ignore;
 
         status = readXml(ut_get_path_xml(path, &openError));
 